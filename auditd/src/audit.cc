@@ -25,6 +25,7 @@
 #include <memcached/server_cookie_iface.h>
 #include <nlohmann/json.hpp>
 #include <platform/dirutils.h>
+#include <platform/sysinfo.h>
 #include <utilities/json_utilities.h>
 #include <utilities/logtags.h>
 
@@ -47,6 +48,11 @@ AuditImpl::AuditImpl(std::string config_file,
       configfile(std::move(config_file)),
       cookie_api(sapi),
       hostname(host) {
+    const auto nbuffers = std::max(size_t(1), cb::get_available_cpu_count());
+    for (size_t ii = 0; ii < nbuffers; ++ii) {
+        event_buffers.emplace_back(std::make_unique<EventBuffer>());
+    }
+
     if (!configfile.empty() && !configure()) {
         throw std::runtime_error(
                 "Audit::Audit(): Failed to configure audit daemon");
@@ -281,6 +287,7 @@ bool AuditImpl::configure() {
      * have been enabled or disabled.  Therefore we want to notify all of the
      * current event states whenever we do a reconfigure.
      */
+    update_disabled_events();
     notify_all_event_states();
 
     // create event to say done reconfiguration
@@ -334,20 +341,34 @@ bool AuditImpl::put_event(uint32_t event_id, cb::const_char_buffer payload) {
         return true;
     }
 
+    if (is_event_disabled(event_id)) {
+        // The consumer would just throw it away
+        return true;
+    }
+
     // @todo I think we should do full validation of the content
     //       in debug mode to ensure that developers actually fill
     //       in the correct fields.. if not we should add an
     //       event to the audit trail saying it is one in an illegal
     //       format (or missing fields)
-    try {
-        auto new_event = std::make_unique<Event>(event_id, payload);
-        std::lock_guard<std::mutex> guard(producer_consumer_lock);
-        if (filleventqueue.size() < max_audit_queue) {
-            filleventqueue.push(std::move(new_event));
-            events_arrived.notify_all();
+    if (buffered_events.load() < int64_t(max_audit_queue)) {
+        try {
+            auto& buffer = get_event_buffer();
+            {
+                std::lock_guard<std::mutex> guard(buffer.mutex);
+                buffer.events.emplace_back(event_id, payload);
+            }
+            buffered_events++;
+            // Only wake the consumer if it is waiting; if it is busy
+            // it'll pick up the event once it is done with the current
+            // batch.
+            if (consumer_waiting.load()) {
+                std::lock_guard<std::mutex> guard(producer_consumer_lock);
+                events_arrived.notify_all();
+            }
             return true;
+        } catch (const std::bad_alloc&) {
         }
-    } catch (const std::bad_alloc&) {
     }
 
     dropped_events++;
@@ -357,6 +378,24 @@ bool AuditImpl::put_event(uint32_t event_id, cb::const_char_buffer payload) {
     return false;
 }
 
+AuditImpl::EventBuffer& AuditImpl::get_event_buffer() {
+    static std::atomic<size_t> nextIndex{0};
+    static thread_local const size_t index = nextIndex++;
+    return *event_buffers[index % event_buffers.size()];
+}
+
+void AuditImpl::update_disabled_events() {
+    std::array<uint64_t, MaxPrefilterEventId / 64> bitmap = {};
+    for (const auto& event : events) {
+        if (event.first < MaxPrefilterEventId && !event.second->isEnabled()) {
+            bitmap[event.first / 64] |= uint64_t(1) << (event.first % 64);
+        }
+    }
+    for (size_t ii = 0; ii < bitmap.size(); ++ii) {
+        disabled_events[ii].store(bitmap[ii], std::memory_order_relaxed);
+    }
+}
+
 bool AuditImpl::configure_auditdaemon(const std::string& configfile,
                                       gsl::not_null<const void*> cookie) {
     auto new_event = std::make_unique<ConfigureEvent>(configfile, cookie.get());
@@ -407,17 +446,46 @@ void AuditImpl::stats(const AddStatFn& add_stats,
               cookie.get());
 }
 
+void AuditImpl::drain_event_buffers() {
+    std::vector<Event> batch;
+    for (auto& buffer : event_buffers) {
+        {
+            std::lock_guard<std::mutex> guard(buffer->mutex);
+            if (buffer->events.empty()) {
+                continue;
+            }
+            // Hand our (empty) vector to the producers so the memory
+            // gets reused
+            batch.swap(buffer->events);
+        }
+        buffered_events -= batch.size();
+        for (auto& event : batch) {
+            if (!event.process(*this)) {
+                dropped_events++;
+            }
+        }
+        batch.clear();
+    }
+}
+
 void AuditImpl::consume_events() {
     std::unique_lock<std::mutex> lock(producer_consumer_lock);
     // Tell the main thread that we're up and running
     events_arrived.notify_one();
 
     while (!stop_audit_consumer) {
-        if (filleventqueue.empty()) {
-            events_arrived.wait_for(
-                    lock,
-                    std::chrono::seconds(auditfile.get_seconds_to_rotation()));
-            if (filleventqueue.empty()) {
+        if (filleventqueue.empty() && buffered_events.load() == 0) {
+            // The producers check consumer_waiting after adding the
+            // event so if they missed it we'll see the event count
+            consumer_waiting = true;
+            if (buffered_events.load() == 0) {
+                events_arrived.wait_for(
+                        lock,
+                        std::chrono::seconds(
+                                auditfile.get_seconds_to_rotation()));
+            }
+            consumer_waiting = false;
+            if (filleventqueue.empty() && buffered_events.load() == 0) {
                 // We timed out, so just rotate the files
                 if (auditfile.maybe_rotate_files()) {
                     // If the file was rotated then we need to open a new
@@ -440,10 +508,20 @@ void AuditImpl::consume_events() {
             }
             processeventqueue.pop();
         }
-        auditfile.flush();
+        drain_event_buffers();
+
+        // The events are written to the disk in one go as part of the flush
+        const auto pending = auditfile.get_pending_events();
+        if (!auditfile.flush()) {
+            dropped_events += pending;
+        }
         lock.lock();
     }
 
+    // Don't lose the events added while we were busy with the last batch
+    // (the shutdown event among them)
+    drain_event_buffers();
+
     // close the auditfile
     auditfile.close();
 }
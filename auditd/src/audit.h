@@ -24,6 +24,7 @@
 #include <memcached/audit_interface.h>
 #include <platform/platform_thread.h>
 
+#include <array>
 #include <atomic>
 #include <cinttypes>
 #include <condition_variable>
@@ -104,6 +105,35 @@ protected:
     void create_audit_event(uint32_t event_id, nlohmann::json& payload);
 
     void notify_event_state_changed(uint32_t id, bool enabled) const;
+
+    /**
+     * Check (without locking) if the event is known to be disabled so that
+     * put_event may drop it before copying the payload. Events we don't
+     * know about are not filtered here; they're reported by the consumer.
+     */
+    bool is_event_disabled(uint32_t id) const {
+        if (id >= MaxPrefilterEventId) {
+            return false;
+        }
+        return (disabled_events[id / 64].load(std::memory_order_relaxed) &
+                (uint64_t(1) << (id % 64))) != 0;
+    }
+
+    /// Rebuild disabled_events from the current event descriptors
+    void update_disabled_events();
+
+    /**
+     * Get the buffer the calling thread should add events to (the threads
+     * are spread across the buffers to avoid contending on a single lock)
+     */
+    struct EventBuffer;
+    EventBuffer& get_event_buffer();
+
+    /**
+     * Process all of the events added to the event buffers
+     */
+    void drain_event_buffers();
+
     struct {
         mutable std::mutex mutex;
         std::vector<cb::audit::EventStateListener> clients;
@@ -135,6 +165,34 @@ protected:
     std::condition_variable events_arrived;
     std::mutex producer_consumer_lock;
 
+    /**
+     * The normal audit events are added to one of a number of buffers
+     * (picked by thread) instead of the queues above, so that the front
+     * end threads don't serialize on producer_consumer_lock and the consumer
+     * may pick up all of the events added while it was busy in one go.
+     * The events are stored by value and the vectors are swapped with
+     * the consumer's so their memory is reused.
+     */
+    struct EventBuffer {
+        std::mutex mutex;
+        std::vector<Event> events;
+    };
+    std::vector<std::unique_ptr<EventBuffer>> event_buffers;
+
+    /// The number of events in the event buffers (may briefly be negative
+    /// as it is updated after the event is added)
+    std::atomic<int64_t> buffered_events{0};
+
+    /// Set by the consumer while it is (about to be) waiting for events
+    std::atomic_bool consumer_waiting{false};
+
+    /// Event ids above this aren't tracked in disabled_events
+    static constexpr uint32_t MaxPrefilterEventId = 65536;
+
+    /// Bitmap of the event ids known to be disabled
+    std::array<std::atomic<uint64_t>, MaxPrefilterEventId / 64>
+            disabled_events = {};
+
     /// The number of events currently dropped.
     std::atomic<uint32_t> dropped_events = {0};
 
@@ -111,6 +111,10 @@ bool AuditFile::open() {
         return false;
     }
 
+    // We keep our own buffer of the events and write it in one go, so
+    // there is no point in copying it through the stdio buffer
+    setvbuf(file.get(), nullptr, _IONBF, 0);
+
     current_size = 0;
     open_time = auditd_time();
     return true;
@@ -118,6 +122,7 @@ bool AuditFile::open() {
 
 void AuditFile::close_and_rotate_log() {
     cb_assert(file);
+    write_pending();
     file.reset();
     if (current_size == 0) {
         remove(open_file_name.c_str());
@@ -223,17 +228,12 @@ void AuditFile::cleanup_old_logfile(const std::string& log_path) {
 }
 
 bool AuditFile::write_event_to_disk(nlohmann::json& output) {
-    bool ret = true;
     try {
         const auto content = output.dump();
-        current_size += fprintf(file.get(), "%s\n", content.c_str());
-        if (ferror(file.get())) {
-            LOG_WARNING("Audit: writing to disk error: {}", cb_strerror());
-            ret = false;
-            close_and_rotate_log();
-        } else if (!buffered) {
-            ret = flush();
-        }
+        pending.append(content);
+        pending.push_back('\n');
+        current_size += content.size() + 1;
+        ++pending_events;
     } catch (const std::bad_alloc&) {
         LOG_WARNING(
                 "Audit: memory allocation error for writing audit event to "
@@ -242,9 +242,37 @@ bool AuditFile::write_event_to_disk(nlohmann::json& output) {
         return false;
     }
 
-    return ret;
+    if (!buffered) {
+        return flush();
+    }
+
+    if (pending.size() >= MaxPendingSize && !write_pending()) {
+        close_and_rotate_log();
+        return false;
+    }
+
+    return true;
 }
 
+bool AuditFile::write_pending() {
+    if (pending.empty()) {
+        return true;
+    }
+
+    const auto nevents = pending_events;
+    const auto nw = fwrite(pending.data(), 1, pending.size(), file.get());
+    const bool failed = nw != pending.size() || ferror(file.get());
+    pending.clear();
+    pending_events = 0;
+
+    if (failed) {
+        LOG_WARNING("Audit: writing to disk error: {}. Lost {} events",
+                    cb_strerror(),
+                    nevents);
+        return false;
+    }
+    return true;
+}
 
 void AuditFile::set_log_directory(const std::string &new_directory) {
     if (log_directory == new_directory) {
@@ -277,6 +305,10 @@ void AuditFile::reconfigure(const AuditConfig &config) {
 
 bool AuditFile::flush() {
     if (is_open()) {
+        if (!write_pending()) {
+            close_and_rotate_log();
+            return false;
+        }
         if (fflush(file.get()) != 0) {
             LOG_WARNING("Audit: writing to disk error: {}", cb_strerror());
             close_and_rotate_log();
@@ -61,13 +61,24 @@ public:
     void cleanup_old_logfile(const std::string& log_path);
 
     /**
-     * Write a json formatted object to the disk
+     * Write a json formatted object to the disk. Unless the file is
+     * configured as unbuffered the event is added to a buffer which is
+     * written to the file as a single write by flush() (or once the
+     * buffer is full); a failure to write the buffer is reported by the
+     * call writing it.
      *
      * @param output the data to write
      * @return true if success, false otherwise
      */
     bool write_event_to_disk(nlohmann::json& output);
 
+    /**
+     * Get the number of events buffered but not yet written to the file
+     */
+    size_t get_pending_events() const {
+        return pending_events;
+    }
+
     /**
      * Is the audit file open already?
      */
@@ -82,7 +93,7 @@ public:
     void reconfigure(const AuditConfig &config);
 
     /**
-     * Flush the buffers to the disk
+     * Write the buffered events and flush the buffers to the disk
      */
     bool flush();
 
@@ -93,6 +104,7 @@ public:
 
 private:
     bool open();
+    bool write_pending();
     bool time_to_rotate_log() const;
     void close_and_rotate_log();
     void set_log_directory(const std::string &new_directory);
@@ -119,5 +131,11 @@ private:
     size_t max_log_size = 20 * 1024 * 1024;
     uint32_t rotate_interval = 900;
     bool buffered = true;
+
+    /// The size we let the buffered events grow to before writing them
+    static constexpr size_t MaxPendingSize = 64 * 1024;
+    /// The events written to the file but not yet passed on to the OS
+    std::string pending;
+    size_t pending_events = 0;
 };
 
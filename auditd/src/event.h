@@ -26,8 +26,10 @@ class AuditConfig;
 
 class Event {
 public:
-    const uint32_t id;
-    const std::string payload;
+    // Not const so that the event may be moved in and out of the
+    // per-thread event buffers
+    uint32_t id;
+    std::string payload;
 
     // Constructor required for ConfigureEvent
     Event()
@@ -37,6 +39,9 @@ public:
         : id(event_id), payload(payload.data(), payload.size()) {
     }
 
+    Event(Event&&) = default;
+    Event& operator=(Event&&) = default;
+
     virtual bool process(AuditImpl& audit);
 
     /**
@@ -21,6 +21,7 @@
 #include <nlohmann/json.hpp>
 #include <platform/platform_time.h>
 #include <time.h>
+#include <algorithm>
 #include <atomic>
 #include <cstring>
 #include <iostream>
@@ -271,3 +272,48 @@ TEST_F(AuditFileTest, TestCrashRecoveryGarbeledDate) {
         EXPECT_EQ(1, files.size());
     }
 }
+
+/**
+ * Test that the buffered events are written to the file in one go
+ * when the file is flushed
+ */
+TEST_F(AuditFileTest, TestBufferedWrite) {
+    config.set_rotate_interval(3600);
+    config.set_rotate_size(1024 * 1024);
+    config.set_buffered(true);
+
+    AuditFile auditfile("testing");
+    auditfile.reconfigure(config);
+    ASSERT_TRUE(auditfile.ensure_open());
+
+    for (int ii = 0; ii < 10; ++ii) {
+        EXPECT_TRUE(auditfile.write_event_to_disk(event));
+    }
+    EXPECT_EQ(10, auditfile.get_pending_events());
+    EXPECT_TRUE(cb::io::loadFile(testdir + "/audit.log").empty());
+
+    EXPECT_TRUE(auditfile.flush());
+    EXPECT_EQ(0, auditfile.get_pending_events());
+
+    const auto content = cb::io::loadFile(testdir + "/audit.log");
+    EXPECT_EQ(10, std::count(content.begin(), content.end(), '\n'));
+    auditfile.close();
+}
+
+/**
+ * Test that unbuffered events are written to the disk immediately
+ */
+TEST_F(AuditFileTest, TestUnbufferedWrite) {
+    config.set_rotate_interval(3600);
+    config.set_rotate_size(1024 * 1024);
+    config.set_buffered(false);
+
+    AuditFile auditfile("testing");
+    auditfile.reconfigure(config);
+    ASSERT_TRUE(auditfile.ensure_open());
+
+    EXPECT_TRUE(auditfile.write_event_to_disk(event));
+    EXPECT_EQ(0, auditfile.get_pending_events());
+    EXPECT_EQ(event.dump() + "\n", cb::io::loadFile(testdir + "/audit.log"));
+    auditfile.close();
+}
@@ -262,6 +262,32 @@ TEST_F(UserTest, CreateDummy) {
             meta.getSalt());
 }
 
+/**
+ * The dummy users should be reused (so we don't run PBKDF2 every time
+ * someone tries to log in as an unknown user) until the fallback salt
+ * changes.
+ */
+TEST_F(UserTest, GetDummyIsCached) {
+    using namespace cb::sasl;
+    server::set_scramsha_fallback_salt("WyulJ+YpKKZn+y9f");
+    auto a = pwdb::UserFactory::getDummy("foobar", Mechanism::SCRAM_SHA512);
+    auto b = pwdb::UserFactory::getDummy("foobar", Mechanism::SCRAM_SHA512);
+    EXPECT_TRUE(a.isDummy());
+    EXPECT_EQ(a.getPassword(Mechanism::SCRAM_SHA512).getPassword(),
+              b.getPassword(Mechanism::SCRAM_SHA512).getPassword());
+
+    // A different mechanism is a different entry
+    auto c = pwdb::UserFactory::getDummy("foobar", Mechanism::SCRAM_SHA256);
+    EXPECT_NE(a.getPassword(Mechanism::SCRAM_SHA512).getSalt(),
+              c.getPassword(Mechanism::SCRAM_SHA256).getSalt());
+
+    // Changing the fallback salt drops the cached entries
+    server::set_scramsha_fallback_salt("c2FsdA==");
+    auto d = pwdb::UserFactory::getDummy("foobar", Mechanism::SCRAM_SHA512);
+    EXPECT_NE(a.getPassword(Mechanism::SCRAM_SHA512).getSalt(),
+              d.getPassword(Mechanism::SCRAM_SHA512).getSalt());
+}
+
 class PasswordDatabaseTest : public ::testing::Test {
 public:
     void SetUp() {
@@ -61,6 +61,8 @@ cb::sasl::Error parse_user_db(const std::string content, bool file) {
                 cb::time2text(std::chrono::steady_clock::now() - start));
         cb::sasl::logging::log(cb::sasl::logging::Level::Debug, logmessage);
         pwmgr.swap(db);
+        // A user we used a dummy for may have been added
+        cb::sasl::pwdb::UserFactory::clearDummyCache();
     } catch (std::exception& e) {
         std::string message("Failed loading [");
         message.append(content);
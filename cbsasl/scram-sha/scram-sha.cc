@@ -400,7 +400,7 @@ std::pair<Error, const_char_buffer> ServerBackend::start(
         logging::log(&context,
                      logging::Level::Debug,
                      "User [" + username + "] doesn't exist.. using dummy");
-        user = pwdb::UserFactory::createDummy(username, mechanism);
+        user = pwdb::UserFactory::getDummy(username, mechanism);
     }
 
     const auto& passwordMeta = user.getPassword(mechanism);
@@ -27,6 +27,7 @@
 #include <mutex>
 #include <stdexcept>
 #include <string>
+#include <unordered_map>
 
 namespace cb {
 namespace sasl {
@@ -53,6 +54,48 @@ protected:
     std::vector<uint8_t> data;
 } scramsha_fallback_salt;
 
+/**
+ * Creating a dummy user runs PBKDF2 on a random password, which is as
+ * expensive as it is for a real user. Keep the dummy users we've created
+ * so that a client repeatedly trying to authenticate as an unknown user
+ * doesn't burn CPU on every attempt (the salt of a dummy user is derived
+ * from the username so the client can't tell the difference).
+ */
+class DummyUserCache {
+public:
+    /// The maximum number of dummy users to keep
+    static constexpr size_t MaxEntries = 1024;
+
+    bool lookup(const std::string& key, User& user) {
+        std::lock_guard<std::mutex> guard(mutex);
+        auto iter = users.find(key);
+        if (iter == users.end()) {
+            return false;
+        }
+        user = iter->second;
+        return true;
+    }
+
+    void insert(std::string key, User user) {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (users.size() >= MaxEntries) {
+            // Someone is trying a lot of different usernames; there is
+            // little value in keeping the old ones
+            users.clear();
+        }
+        users[std::move(key)] = std::move(user);
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> guard(mutex);
+        users.clear();
+    }
+
+protected:
+    std::mutex mutex;
+    std::unordered_map<std::string, User> users;
+} dummy_user_cache;
+
 /**
  * Generate a salt and store it base64 encoded into the salt
  */
@@ -112,6 +155,23 @@ User UserFactory::create(const std::string& unm, const std::string& passwd) {
     return ret;
 }
 
+User UserFactory::getDummy(const std::string& unm, const Mechanism& mech) {
+    std::string key{std::to_string(int(mech)) + ":" + unm};
+    User ret;
+    if (dummy_user_cache.lookup(key, ret) &&
+        ret.getPassword(mech).getIterationCount() == IterationCount) {
+        return ret;
+    }
+
+    ret = createDummy(unm, mech);
+    dummy_user_cache.insert(std::move(key), ret);
+    return ret;
+}
+
+void UserFactory::clearDummyCache() {
+    dummy_user_cache.clear();
+}
+
 User UserFactory::createDummy(const std::string& unm, const Mechanism& mech) {
     User ret{unm};
 
@@ -202,6 +262,8 @@ void UserFactory::setDefaultHmacIterationCount(int count) {
 
 void UserFactory::setScramshaFallbackSalt(const std::string& salt) {
     scramsha_fallback_salt.set(salt);
+    // The salt of the dummy users is generated from the fallback salt
+    dummy_user_cache.clear();
 }
 
 void User::generateSecrets(const Mechanism& mech, const std::string& passwd) {
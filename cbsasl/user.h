@@ -223,6 +223,20 @@ public:
      */
     static User createDummy(const std::string& name, const Mechanism& mech);
 
+    /**
+     * Get a dummy user object for the given user. Unlike createDummy()
+     * the object is returned from a (bounded) cache if we've recently
+     * created one for the same user and mechanism.
+     *
+     * @param name username
+     * @param mech the mechanism to generate the password for
+     * @return the dummy object
+     */
+    static User getDummy(const std::string& name, const Mechanism& mech);
+
+    /// Drop all of the cached dummy users
+    static void clearDummyCache();
+
     /**
      * Set the default iteration count to use (may be overridden by
      * the cbsasl property function.
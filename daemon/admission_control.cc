@@ -0,0 +1,70 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "admission_control.h"
+
+const std::chrono::milliseconds AdmissionControl::SampleInterval{100};
+
+bool AdmissionControl::admitMutation(EngineIface& engine, size_t threshold) {
+    if (threshold == 0) {
+        return true;
+    }
+
+    maybeSample(engine);
+    if (level.load(std::memory_order_relaxed) * 100 < threshold) {
+        return true;
+    }
+
+    ++rejected;
+    return false;
+}
+
+cb::engine::Pressure AdmissionControl::getPressure() const {
+    std::lock_guard<std::mutex> guard(mutex);
+    return pressure;
+}
+
+void AdmissionControl::reset() {
+    nextSample.store(0);
+    level.store(0);
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        pressure = {};
+    }
+    rejected.reset();
+}
+
+void AdmissionControl::maybeSample(EngineIface& engine) {
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    auto next = nextSample.load(std::memory_order_relaxed);
+    if (now.count() < next) {
+        return;
+    }
+
+    // Only one of the threads should ask the engine
+    const auto interval =
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    SampleInterval);
+    if (!nextSample.compare_exchange_strong(next,
+                                            (now + interval).count())) {
+        return;
+    }
+
+    const auto sample = engine.getPressure();
+    level.store(sample.getMax(), std::memory_order_relaxed);
+    std::lock_guard<std::mutex> guard(mutex);
+    pressure = sample;
+}
@@ -0,0 +1,83 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <memcached/engine.h>
+#include <relaxed_atomic.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+/**
+ * The admission control for a bucket.
+ *
+ * When the bucket is close to its limits (memory, the disk write queue,
+ * checkpoint memory or the executor backlog, as reported by the engine)
+ * the mutations from connections which aren't high priority (the
+ * replication connections are) are rejected with a temporary failure
+ * before they're executed, instead of being turned into TMPFAILs or
+ * timeouts by the engine after the expensive work is done. The client
+ * should back off and retry the request.
+ *
+ * The pressure is sampled from the engine at most every SampleInterval
+ * (by the front end thread which happens to check admission when the
+ * sample is stale), so the check on the hot path is a couple of atomic
+ * loads.
+ */
+class AdmissionControl {
+public:
+    /// How often the pressure is sampled from the engine
+    static const std::chrono::milliseconds SampleInterval;
+
+    /**
+     * Should the mutation be admitted?
+     *
+     * @param engine the engine for the bucket
+     * @param threshold the pressure (in percent) where we start to shed
+     *                  mutations (0 = disabled)
+     * @return false if the mutation should be rejected
+     */
+    bool admitMutation(EngineIface& engine, size_t threshold);
+
+    /// Get the pressure of the bucket the last time it was sampled
+    cb::engine::Pressure getPressure() const;
+
+    /// Get the number of mutations rejected
+    uint64_t getRejected() const {
+        return rejected;
+    }
+
+    /// Reset the state (when the bucket is deleted)
+    void reset();
+
+protected:
+    void maybeSample(EngineIface& engine);
+
+    /// The time (steady clock ticks) when the pressure should be sampled
+    std::atomic<int64_t> nextSample{0};
+
+    /// The maximum of the signals of the last sample
+    std::atomic<float> level{0};
+
+    mutable std::mutex mutex;
+    /// The last sample (for the stats)
+    cb::engine::Pressure pressure;
+
+    cb::RelaxedAtomic<uint64_t> rejected;
+};
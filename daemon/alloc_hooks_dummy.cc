@@ -73,8 +73,33 @@ bool DummyAllocHooks::get_allocator_property(const char* name, size_t* value) {
     return false;
 }
 
+bool DummyAllocHooks::get_allocation_utilization(const void* ptr,
+                                                 allocator_utilization* util) {
+    return false;
+}
+
 int DummyAllocHooks::set_allocator_property(const char* name,
                                             void* newp,
                                             size_t newlen) {
     return 1;
 }
+
+uint64_t DummyAllocHooks::get_thread_allocated_bytes() {
+    return 0;
+}
+
+bool DummyAllocHooks::create_arena(unsigned* arena, bool huge_pages) {
+    return false;
+}
+
+void DummyAllocHooks::release_arena(unsigned arena) {
+    // empty
+}
+
+void DummyAllocHooks::set_thread_arena(unsigned arena) {
+    // empty
+}
+
+bool DummyAllocHooks::get_arena_stats(unsigned arena, allocator_stats* stats) {
+    return false;
+}
@@ -41,6 +41,16 @@
 #include <malloc.h>
 #endif
 
+#include <array>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
 /* jemalloc checks for this symbol, and it's contents for the config to use. */
 JEMALLOC_EXPORT
 const char* je_malloc_conf =
@@ -219,8 +229,243 @@ bool JemallocHooks::get_allocator_property(const char* name, size_t* value) {
     return jemalloc_get_stats_prop(name, value);
 }
 
+bool JemallocHooks::get_allocation_utilization(const void* ptr,
+                                               allocator_utilization* util) {
+    /* Layout of the output of "experimental.utilization.query" (jemalloc
+     * 5.2 onwards; earlier versions fail the mallctl with ENOENT).
+     */
+    struct {
+        size_t nfree;
+        size_t nregs;
+        size_t size;
+        size_t bin_nfree;
+        size_t bin_nregs;
+        void* slabcur_addr;
+    } out;
+    size_t outlen = sizeof(out);
+    if (je_mallctl("experimental.utilization.query",
+                   &out,
+                   &outlen,
+                   &ptr,
+                   sizeof(ptr)) != 0 ||
+        outlen != sizeof(out)) {
+        return false;
+    }
+    /* Not a small (slab) allocation */
+    if (out.nregs == 0 || out.bin_nregs == 0) {
+        return false;
+    }
+    util->nfree = out.nfree;
+    util->nregs = out.nregs;
+    util->bin_nfree = out.bin_nfree;
+    util->bin_nregs = out.bin_nregs;
+    /* Is the allocation within the slab currently allocated from? */
+    const auto* slab = static_cast<const char*>(out.slabcur_addr);
+    const auto* p = static_cast<const char*>(ptr);
+    util->current_slab =
+            slab != nullptr && p >= slab && p < slab + out.nregs * out.size;
+    return true;
+}
+
 int JemallocHooks::set_allocator_property(const char* name,
                                           void* newp,
                                           size_t newlen) {
     return je_mallctl(name, nullptr, 0, newp, newlen);
 }
+
+uint64_t JemallocHooks::get_thread_allocated_bytes() {
+    /* Look up the address of the calling thread's counter once, so the
+     * cost of each call is just a load (this is read around every command
+     * the front end threads execute). */
+    thread_local uint64_t* allocated = [] {
+        uint64_t* ptr = nullptr;
+        size_t size = sizeof(ptr);
+        if (je_mallctl("thread.allocatedp", &ptr, &size, nullptr, 0) != 0) {
+            return static_cast<uint64_t*>(nullptr);
+        }
+        return ptr;
+    }();
+    return allocated ? *allocated : 0;
+}
+
+/* The arenas released by the buckets, reused by the next create_arena as
+ * jemalloc can't destroy an arena while anything it allocated may still be
+ * referenced. Arenas backed by huge pages are only reused as such. */
+static std::mutex free_arenas_mutex;
+static std::vector<unsigned> free_arenas;
+static std::vector<unsigned> free_huge_page_arenas;
+static std::set<unsigned> huge_page_arenas;
+
+static void jemalloc_purge_arena(unsigned arena) {
+    const auto name = "arena." + std::to_string(arena) + ".purge";
+    int err = je_mallctl(name.c_str(), nullptr, nullptr, nullptr, 0);
+    if (err != 0) {
+        LOG_WARNING("jemalloc_purge_arena({}) error {}", arena, err);
+    }
+}
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+/* The extent hooks of the huge page arenas: jemalloc's own, except that the
+ * memory mapped for the arena is advised to be backed by transparent huge
+ * pages. With opt.retain (the default on Linux) jemalloc maps memory in
+ * growing chunks and carves its slabs out of them, so the slabs of the small
+ * size classes (StoredValues, Blobs) end up on 2MB pages too. */
+static extent_hooks_t* default_extent_hooks;
+static extent_hooks_t huge_page_extent_hooks;
+static const size_t huge_page_size = 2 * 1024 * 1024;
+
+static void* huge_page_extent_alloc(extent_hooks_t*,
+                                    void* new_addr,
+                                    size_t size,
+                                    size_t alignment,
+                                    bool* zero,
+                                    bool* commit,
+                                    unsigned arena_ind) {
+    void* ret = default_extent_hooks->alloc(default_extent_hooks,
+                                            new_addr,
+                                            size,
+                                            alignment,
+                                            zero,
+                                            commit,
+                                            arena_ind);
+    if (ret != nullptr && size >= huge_page_size) {
+        /* Only advise; the kernel may not have huge pages to give */
+        madvise(ret, size, MADV_HUGEPAGE);
+    }
+    return ret;
+}
+
+static extent_hooks_t* get_huge_page_extent_hooks() {
+    static extent_hooks_t* hooks = []() -> extent_hooks_t* {
+        size_t size = sizeof(default_extent_hooks);
+        int err = je_mallctl("arena.0.extent_hooks",
+                             &default_extent_hooks,
+                             &size,
+                             nullptr,
+                             0);
+        if (err != 0) {
+            LOG_WARNING("get_huge_page_extent_hooks() error {}", err);
+            return nullptr;
+        }
+        huge_page_extent_hooks = *default_extent_hooks;
+        huge_page_extent_hooks.alloc = huge_page_extent_alloc;
+        return &huge_page_extent_hooks;
+    }();
+    return hooks;
+}
+#else
+static extent_hooks_t* get_huge_page_extent_hooks() {
+    return nullptr;
+}
+#endif
+
+bool JemallocHooks::create_arena(unsigned* arena, bool huge_pages) {
+    {
+        std::lock_guard<std::mutex> guard(free_arenas_mutex);
+        auto& pool = huge_pages ? free_huge_page_arenas : free_arenas;
+        if (!pool.empty()) {
+            *arena = pool.back();
+            pool.pop_back();
+            return true;
+        }
+    }
+    extent_hooks_t* hooks = nullptr;
+    if (huge_pages) {
+        hooks = get_huge_page_extent_hooks();
+        if (hooks == nullptr) {
+            LOG_WARNING(
+                    "jemalloc_create_arena() huge pages are not supported "
+                    "on this platform");
+            return false;
+        }
+    }
+    size_t size = sizeof(*arena);
+    int err = je_mallctl("arenas.create",
+                         arena,
+                         &size,
+                         hooks ? &hooks : nullptr,
+                         hooks ? sizeof(hooks) : 0);
+    if (err != 0) {
+        LOG_WARNING("jemalloc_create_arena() error {}", err);
+        return false;
+    }
+    if (huge_pages) {
+        std::lock_guard<std::mutex> guard(free_arenas_mutex);
+        huge_page_arenas.insert(*arena);
+    }
+    return true;
+}
+
+void JemallocHooks::release_arena(unsigned arena) {
+    jemalloc_purge_arena(arena);
+    std::lock_guard<std::mutex> guard(free_arenas_mutex);
+    if (huge_page_arenas.count(arena)) {
+        free_huge_page_arenas.push_back(arena);
+    } else {
+        free_arenas.push_back(arena);
+    }
+}
+
+void JemallocHooks::set_thread_arena(unsigned arena) {
+    /* Look up the MIB once, as this is called every time a thread switches
+     * to (or from) a bucket with its own arena. */
+    static const auto mib = [] {
+        std::array<size_t, 2> mib{};
+        size_t miblen = mib.size();
+        if (je_mallctlnametomib("thread.arena", mib.data(), &miblen) != 0) {
+            miblen = 0;
+        }
+        return std::make_pair(mib, miblen);
+    }();
+    if (mib.second == 0) {
+        return;
+    }
+    int err = je_mallctlbymib(mib.first.data(),
+                              mib.second,
+                              nullptr,
+                              nullptr,
+                              &arena,
+                              sizeof(arena));
+    if (err != 0) {
+        LOG_WARNING("jemalloc_set_thread_arena({}) error {}", arena, err);
+    }
+}
+
+bool JemallocHooks::get_arena_stats(unsigned arena, allocator_stats* stats) {
+    size_t epoch = 1;
+    size_t sz = sizeof(epoch);
+    /* jemalloc can cache its statistics - force a refresh */
+    je_mallctl("epoch", &epoch, &sz, &epoch, sz);
+
+    const auto prefix = "stats.arenas." + std::to_string(arena) + ".";
+    auto get = [&prefix](const char* property, size_t* value) {
+        return jemalloc_get_stats_prop((prefix + property).c_str(), value) ==
+               0;
+    };
+
+    size_t small = 0;
+    size_t large = 0;
+    size_t pactive = 0;
+    size_t base = 0;
+    size_t internal = 0;
+    if (!get("small.allocated", &small) || !get("large.allocated", &large) ||
+        !get("pactive", &pactive)) {
+        return false;
+    }
+    get("mapped", &stats->heap_size);
+    get("retained", &stats->retained_size);
+    get("resident", &stats->resident_size);
+    get("base", &base);
+    get("internal", &internal);
+
+    size_t page_size = 0;
+    jemalloc_get_stats_prop("arenas.page", &page_size);
+
+    stats->allocated_size = small + large;
+    stats->metadata_size = base + internal;
+    const size_t active_bytes = pactive * page_size;
+    stats->fragmentation_size = active_bytes > stats->allocated_size
+                                        ? active_bytes - stats->allocated_size
+                                        : 0;
+    return true;
+}
@@ -18,6 +18,7 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdint.h>
 
 typedef void (*malloc_new_hook_t)(const void *ptr, size_t sz);
 typedef void (*malloc_delete_hook_t)(const void *ptr);
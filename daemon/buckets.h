@@ -16,8 +16,12 @@
  */
 #pragma once
 
+#include "admission_control.h"
 #include "cluster_config.h"
+#include "keyspace_timings.h"
 #include "mcbp_validators.h"
+#include "slow_op_log.h"
+#include "stats_push.h"
 #include "timings.h"
 
 #include <memcached/engine.h>
@@ -144,6 +148,21 @@ public:
      */
     Timings timings;
 
+    /**
+     * Per-vbucket and per-collection document operation latency (only
+     * recorded if keyspace_timings is enabled)
+     */
+    cb::KeyspaceTimings keyspaceTimings;
+
+    /// The stats groups recently collected for the stats subscribers
+    StatsPushCache statsPushCache;
+
+    /// Sheds mutations while the bucket is close to its limits
+    AdmissionControl admissionControl;
+
+    /// The slow operation thresholds derived from the timings
+    cb::AdaptiveSlowOpThresholds slowOpThresholds;
+
     /**
      *  Sub-document JSON parser (subjson) operation execution time histogram.
      */
@@ -60,45 +60,50 @@ public:
 
     bool execute(Connection& connection) override {
         auto& bucket = connection.getBucket();
-        auto payload = bucket.clusterConfiguration.getConfiguration();
-        if (payload.first < connection.getClustermapRevno()) {
+        auto config = bucket.clusterConfiguration.getConfiguration();
+        if (!config || config->revision < connection.getClustermapRevno()) {
             // Ignore.. we've already sent a newer cluster config
             return true;
         }
 
-        connection.setClustermapRevno(payload.first);
+        connection.setClustermapRevno(config->revision);
         LOG_INFO("{}: Sending Cluster map revision {}",
                  connection.getId(),
-                 payload.first);
+                 config->revision);
 
         std::string name = bucket.name;
+        const auto payload = config->getPayload(connection.isSnappyEnabled());
 
         using namespace cb::mcbp;
         size_t needed = sizeof(Request) + // packet header
                         4 + // rev number in extdata
-                        name.size() + // the name of the bucket
-                        payload.second->size(); // The actual payload
+                        name.size(); // the name of the bucket
 
         connection.write->ensureCapacity(needed);
         FrameBuilder<Request> builder(connection.write->wdata());
         builder.setMagic(Magic::ServerRequest);
-        builder.setDatatype(cb::mcbp::Datatype::JSON);
+        builder.setDatatype(cb::mcbp::Datatype(payload.datatype));
         builder.setOpcode(ServerOpcode::ClustermapChangeNotification);
 
         // The extras contains the cluster revision number as an uint32_t
-        const uint32_t rev = htonl(payload.first);
+        const uint32_t rev = htonl(config->revision);
         builder.setExtras(
                 {reinterpret_cast<const uint8_t*>(&rev), sizeof(rev)});
         builder.setKey(
                 {reinterpret_cast<const uint8_t*>(name.data()), name.size()});
-        builder.setValue(
-                {reinterpret_cast<const uint8_t*>(payload.second->data()),
-                 payload.second->size()});
+
+        // The payload is sent straight from the configuration shared by
+        // all of the connections
+        auto* header = builder.getFrame();
+        header->setBodylen(header->getBodylen() +
+                           uint32_t(payload.value.size()));
 
         // Inject our packet into the stream!
         connection.addMsgHdr(true);
         connection.addIov(connection.write->wdata().data(), needed);
         connection.write->produced(needed);
+        connection.addIov(payload.value.data(), payload.value.size());
+        connection.pushTempAlloc(std::move(config));
 
         connection.setState(StateMachine::State::send_data);
         connection.setWriteAndGo(StateMachine::State::new_cmd);
@@ -21,11 +21,33 @@
 #include <cstdlib>
 #include <stdexcept>
 
+ClusterConfiguration::Config::Config(int rev, cb::const_char_buffer buffer)
+    : revision(rev), json(buffer.begin(), buffer.end()) {
+    // The configuration compresses well, and with a lot of clients
+    // connected each revision is sent many times, so compress it once
+    // up front (only keeping it if it shrinks)
+    if (!cb::compression::deflate(
+                cb::compression::Algorithm::Snappy, json, compressed) ||
+        compressed.size() >= json.size()) {
+        compressed.resize(0);
+    }
+}
+
+ClusterConfiguration::Config::Payload
+ClusterConfiguration::Config::getPayload(bool snappy) const {
+    if (snappy && compressed.size() != 0) {
+        return {{compressed.data(), compressed.size()},
+                PROTOCOL_BINARY_DATATYPE_JSON |
+                        PROTOCOL_BINARY_DATATYPE_SNAPPY};
+    }
+    return {json, PROTOCOL_BINARY_DATATYPE_JSON};
+}
+
 void ClusterConfiguration::setConfiguration(cb::const_char_buffer buffer,
                                             int rev) {
+    auto next = std::make_shared<const Config>(rev, buffer);
     std::lock_guard<std::mutex> guard(mutex);
-    revision = rev;
-    config = std::make_shared<std::string>(buffer.begin(), buffer.end());
+    config = std::move(next);
 }
 
 void ClusterConfiguration::setConfiguration(cb::const_char_buffer buffer) {
@@ -36,9 +58,7 @@ void ClusterConfiguration::setConfiguration(cb::const_char_buffer buffer) {
                 "revision");
     }
 
-    std::lock_guard<std::mutex> guard(mutex);
-    revision = rev;
-    config = std::make_shared<std::string>(buffer.begin(), buffer.end());
+    setConfiguration(buffer, rev);
 }
 
 int ClusterConfiguration::getRevisionNumber(cb::const_char_buffer buffer) {
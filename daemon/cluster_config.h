@@ -16,6 +16,8 @@
  */
 #pragma once
 
+#include <memcached/protocol_binary.h>
+#include <platform/compress.h>
 #include <platform/sized_buffer.h>
 
 #include <cstdint>
@@ -32,9 +34,39 @@
  */
 class ClusterConfiguration {
 public:
-    ClusterConfiguration()
-        : config(std::make_shared<std::string>()), revision(-1) {
-    }
+    /**
+     * A revision of the configuration. It is built once (when ns_server
+     * sets it) and shared by all of the connections sending it, which
+     * send it straight from here rather than copying it per connection.
+     */
+    class Config {
+    public:
+        Config(int rev, cb::const_char_buffer buffer);
+
+        /// The payload to send to a client, and its datatype
+        struct Payload {
+            cb::const_char_buffer value;
+            protocol_binary_datatype_t datatype;
+        };
+
+        /**
+         * Get the payload to send to a client
+         *
+         * @param snappy if the client negotiated Snappy (in which case it
+         *               gets the compressed configuration)
+         */
+        Payload getPayload(bool snappy) const;
+
+        /// The revision number of the configuration
+        const int revision;
+
+    private:
+        /// The configuration as provided by ns_server
+        const std::string json;
+
+        /// The compressed configuration (empty if it doesn't compress)
+        cb::compression::Buffer compressed;
+    };
 
     void setConfiguration(cb::const_char_buffer buffer, int rev);
 
@@ -43,12 +75,11 @@ public:
     /**
      * Get the current configuration.
      *
-     * @return a pair where the first element is the revision number, and
-     *         the second element is (a copy) of the configuration.
+     * @return the configuration, or nullptr if we don't have one
      */
-    std::pair<int, std::shared_ptr<std::string>> getConfiguration() const {
+    std::shared_ptr<const Config> getConfiguration() const {
         std::lock_guard<std::mutex> guard(mutex);
-        return std::make_pair(revision, config);
+        return config;
     };
 
     /**
@@ -61,10 +92,10 @@ public:
 
 private:
     /**
-     * We use a mutex so that we can get a consistent copy of the revision
-     * number and the configuration. (we cache the revision number to avoid
-     * parsing the JSON every time we have to handle a not my vbucket reply
-     * because we want to be able to avoid sending duplicates of the cluster
+     * The mutex protecting the (pointer to the) current configuration.
+     * (we cache the revision number in the Config to avoid parsing the
+     * JSON every time we have to handle a not my vbucket reply because we
+     * want to be able to avoid sending duplicates of the cluster
      * configuration map to the clients).
      */
     mutable std::mutex mutex;
@@ -72,10 +103,5 @@ private:
     /**
      * The actual config
      */
-    std::shared_ptr<std::string> config;
-
-    /**
-     * Cached revision so we don't have to parse it every time
-     */
-    int revision;
+    std::shared_ptr<const Config> config;
 };
@@ -51,6 +51,10 @@
 #ifndef WIN32
 #include <netinet/tcp.h> // For TCP_NODELAY etc
 #endif
+#if defined(__linux__) && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+#include <linux/errqueue.h>
+#define HAVE_MSG_ZEROCOPY 1
+#endif
 
 std::string to_string(Connection::Priority priority) {
     switch (priority) {
@@ -230,6 +234,23 @@ nlohmann::json Connection::toJSON() const {
     talloc["size"] = temp_alloc.size();
     ret["temp_alloc_list"] = talloc;
 
+    nlohmann::json zc;
+    switch (zerocopy.socket) {
+    case ZeroCopySocketState::Unknown:
+        zc["socket"] = "unknown";
+        break;
+    case ZeroCopySocketState::Enabled:
+        zc["socket"] = "enabled";
+        break;
+    case ZeroCopySocketState::Unsupported:
+        zc["socket"] = "unsupported";
+        break;
+    }
+    zc["sent"] = zerocopy.sent;
+    zc["completed"] = zerocopy.completed;
+    zc["pinned"] = zerocopy.pinned.size();
+    ret["zerocopy"] = zc;
+
     /* @todo we should decode the binary header */
     ret["ssl"] = ssl.toJSON();
     ret["total_recv"] = totalRecv;
@@ -528,6 +549,16 @@ void Connection::enqueueServerEvent(std::unique_ptr<ServerEvent> event) {
     server_events.push(std::move(event));
 }
 
+void Connection::setStatsSubscription(
+        std::unique_ptr<StatsSubscription> subscription) {
+    if (subscription && !statsSubscription) {
+        ++numStatsSubscriptions;
+    } else if (!subscription && statsSubscription) {
+        --numStatsSubscriptions;
+    }
+    statsSubscription = std::move(subscription);
+}
+
 bool Connection::unregisterEvent() {
     if (!registered_in_libevent) {
         LOG_WARNING(
@@ -644,6 +675,12 @@ void Connection::shrinkBuffers() {
     // We share the buffers with the thread, so we don't need to worry
     // about the read and write buffer.
 
+    if (hasCoalescedResponses()) {
+        // The message headers for the queued responses point into the
+        // IO vector (and iovused still counts their entries)
+        return;
+    }
+
     if (msglist.size() > MSG_LIST_HIGHWAT) {
         try {
             msglist.resize(MSG_LIST_INITIAL);
@@ -821,6 +858,12 @@ int Connection::recv(char* dest, size_t nbytes) {
 ssize_t Connection::sendmsg(struct msghdr* m) {
     ssize_t res = 0;
     if (ssl.isEnabled()) {
+        // Move the encryption over to the kernel once the handshake data
+        // is sent (if enabled)
+        ssl.tryEnableKtlsTx(socketDescriptor);
+    }
+
+    if (ssl.isEnabled() && !ssl.isKtlsTxEnabled()) {
         for (int ii = 0; ii < int(m->msg_iovlen); ++ii) {
             int n = sslWrite(reinterpret_cast<char*>(m->msg_iov[ii].iov_base),
                              m->msg_iov[ii].iov_len);
@@ -836,7 +879,11 @@ ssize_t Connection::sendmsg(struct msghdr* m) {
          */
         ssl.drainBioSendPipe(socketDescriptor);
         return res;
+    } else if (!zerocopy.chunks.empty()) {
+        res = sendmsgZeroCopy(m);
     } else {
+        // Plain connection, or a TLS connection where the kernel
+        // encrypts the data
         res = cb::net::sendmsg(socketDescriptor, m, 0);
         if (res > 0) {
             totalSend += res;
@@ -846,6 +893,98 @@ ssize_t Connection::sendmsg(struct msghdr* m) {
     return res;
 }
 
+ssize_t Connection::sendmsgZeroCopy(struct msghdr* m) {
+    ssize_t res;
+#ifdef HAVE_MSG_ZEROCOPY
+    auto isChunk = [this](const iovec& vec) {
+        const auto* ptr = static_cast<const char*>(vec.iov_base);
+        for (const auto& chunk : zerocopy.chunks) {
+            if (ptr >= chunk.data() && ptr < chunk.data() + chunk.size()) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    size_t idx = 0;
+    while (idx < m->msg_iovlen && !isChunk(m->msg_iov[idx])) {
+        ++idx;
+    }
+
+    // Send the data in front of the first chunk with a normal sendmsg (so
+    // that we don't pin our own buffers), or the chunk by itself
+    struct msghdr msg = *m;
+    int flags = 0;
+    if (idx == 0) {
+        msg.msg_iovlen = 1;
+        flags = MSG_ZEROCOPY;
+    } else {
+        msg.msg_iovlen = idx;
+    }
+
+    res = cb::net::sendmsg(socketDescriptor, &msg, flags);
+    if (flags != 0) {
+        if (res > 0) {
+            ++zerocopy.sent;
+        } else if (res == -1 && cb::net::get_socket_error() == ENOBUFS) {
+            // We've hit the limit of pages the kernel allows us to pin
+            // for the socket; fall back to copy the data
+            res = cb::net::sendmsg(socketDescriptor, &msg, 0);
+        }
+    }
+#else
+    res = cb::net::sendmsg(socketDescriptor, m, 0);
+#endif
+    if (res > 0) {
+        totalSend += res;
+    }
+    return res;
+}
+
+void Connection::reapZeroCopyCompletions(bool force) {
+#ifdef HAVE_MSG_ZEROCOPY
+    while (zerocopy.completed != zerocopy.sent &&
+           socketDescriptor != INVALID_SOCKET) {
+        std::array<char, 128> control;
+        struct msghdr msg = {};
+        msg.msg_control = control.data();
+        msg.msg_controllen = control.size();
+        if (::recvmsg(socketDescriptor, &msg, MSG_ERRQUEUE) == -1) {
+            // Nothing more reported by the kernel (yet)
+            break;
+        }
+
+        for (auto* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+             cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (!((cmsg->cmsg_level == SOL_IP &&
+                   cmsg->cmsg_type == IP_RECVERR) ||
+                  (cmsg->cmsg_level == SOL_IPV6 &&
+                   cmsg->cmsg_type == IPV6_RECVERR))) {
+                continue;
+            }
+            const auto* serr = reinterpret_cast<const sock_extended_err*>(
+                    CMSG_DATA(cmsg));
+            if (serr->ee_errno == 0 &&
+                serr->ee_origin == SO_EE_ORIGIN_ZEROCOPY) {
+                // ee_info and ee_data is the inclusive range of the
+                // completed sends
+                zerocopy.completed += serr->ee_data - serr->ee_info + 1;
+            }
+        }
+    }
+#endif
+
+    // The items are pinned in the order they're sent
+    auto iter = zerocopy.pinned.begin();
+    while (iter != zerocopy.pinned.end() &&
+           (force ||
+            static_cast<int32_t>(zerocopy.completed - iter->sends) >= 0)) {
+        iter->engine->release(iter->item);
+        ++iter;
+    }
+    zerocopy.pinned.erase(zerocopy.pinned.begin(), iter);
+}
+
 /**
  * Adjust the msghdr by "removing" n bytes of data from it.
  *
@@ -883,6 +1022,10 @@ size_t adjust_msghdr(cb::Pipe& pipe, struct msghdr* m, ssize_t nbytes) {
 }
 
 Connection::TransmitResult Connection::transmit() {
+    if (!coalesce.pipeIovs.empty()) {
+        relocateWriteIovs();
+    }
+
     if (ssl.isEnabled()) {
         // We use OpenSSL to write data into a buffer before we send it
         // over the wire... Lets go ahead and drain that BIO pipe before
@@ -1151,11 +1294,29 @@ int Connection::sslWrite(const char* src, size_t nbytes) {
     return ret;
 }
 
+size_t Connection::getSendQueueSize() const {
+    size_t ret = 0;
+    for (auto ii = msgcurr; ii < msglist.size(); ++ii) {
+        const auto& m = msglist[ii];
+        for (size_t jj = 0; jj < size_t(m.msg_iovlen); ++jj) {
+            ret += m.msg_iov[jj].iov_len;
+        }
+    }
+    return ret;
+}
+
 void Connection::addMsgHdr(bool reset) {
     if (reset) {
+        if (coalesce.responses != 0) {
+            // Keep on adding to the current message header so that the
+            // queued responses are sent with a single sendmsg
+            return;
+        }
         msgcurr = 0;
         msglist.clear();
         iovused = 0;
+        zerocopy.chunks.clear();
+        coalesce.pipeIovs.clear();
     }
 
     msglist.emplace_back();
@@ -1192,16 +1353,183 @@ void Connection::addIov(const void* buf, size_t len) {
     m->msg_iov[m->msg_iovlen].iov_base = (void*)buf;
     m->msg_iov[m->msg_iovlen].iov_len = len;
 
+    if (write) {
+        // Remember the entries pointing into the write pipe (see
+        // relocateWriteIovs)
+        const auto* ptr = static_cast<const uint8_t*>(buf);
+        const auto rbuf = write->rdata();
+        const auto wbuf = write->wdata();
+        if (ptr >= rbuf.data() && ptr < wbuf.data() + wbuf.size()) {
+            coalesce.pipeIovs.emplace_back(iovused, ptr - rbuf.data());
+        }
+    }
+
     msgbytes += len;
     ++iovused;
     STATS_MAX(this, iovused_high_watermark, gsl::narrow<int>(getIovUsed()));
     m->msg_iovlen++;
 }
 
+void Connection::relocateWriteIovs() {
+    const auto* base = write->rdata().data();
+    for (const auto& entry : coalesce.pipeIovs) {
+        iov[entry.first].iov_base =
+                const_cast<uint8_t*>(base) + entry.second;
+    }
+    coalesce.pipeIovs.clear();
+}
+
+/**
+ * Is the packet one of the commands we allow the response to be queued
+ * up for? The list is limited to the basic data commands whose
+ * responses don't refer to the input packet, and which never change the
+ * bucket or the authentication of the connection.
+ */
+static bool is_coalescing_command(const cb::mcbp::Header& header) {
+    const auto magic = cb::mcbp::Magic(header.getMagic());
+    if (magic != cb::mcbp::Magic::ClientRequest &&
+        magic != cb::mcbp::Magic::AltClientRequest) {
+        return false;
+    }
+
+    switch (header.getRequest().getClientOpcode()) {
+    case cb::mcbp::ClientOpcode::Get:
+    case cb::mcbp::ClientOpcode::Getq:
+    case cb::mcbp::ClientOpcode::Getk:
+    case cb::mcbp::ClientOpcode::Getkq:
+    case cb::mcbp::ClientOpcode::Set:
+    case cb::mcbp::ClientOpcode::Setq:
+    case cb::mcbp::ClientOpcode::Add:
+    case cb::mcbp::ClientOpcode::Addq:
+    case cb::mcbp::ClientOpcode::Replace:
+    case cb::mcbp::ClientOpcode::Replaceq:
+    case cb::mcbp::ClientOpcode::Delete:
+    case cb::mcbp::ClientOpcode::Deleteq:
+    case cb::mcbp::ClientOpcode::Increment:
+    case cb::mcbp::ClientOpcode::Incrementq:
+    case cb::mcbp::ClientOpcode::Decrement:
+    case cb::mcbp::ClientOpcode::Decrementq:
+    case cb::mcbp::ClientOpcode::Append:
+    case cb::mcbp::ClientOpcode::Appendq:
+    case cb::mcbp::ClientOpcode::Prepend:
+    case cb::mcbp::ClientOpcode::Prependq:
+    case cb::mcbp::ClientOpcode::Touch:
+    case cb::mcbp::ClientOpcode::Gat:
+    case cb::mcbp::ClientOpcode::Gatq:
+    case cb::mcbp::ClientOpcode::Noop:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void Connection::updateResponseCoalescing(const cb::mcbp::Header& header) {
+    coalesce.candidate = settings.getResponseCoalescingBytes() != 0 &&
+                         is_coalescing_command(header);
+}
+
+bool Connection::tryCoalesceResponse() {
+    const auto maxBytes = settings.getResponseCoalescingBytes();
+    if (maxBytes == 0 || !coalesce.candidate || isDCP() ||
+        write_and_go != StateMachine::State::new_cmd || numEvents <= 0 ||
+        cookies.size() != 1 ||
+        iovused >= settings.getResponseCoalescingIovecs() ||
+        !isPacketAvailable() || getSendQueueSize() >= maxBytes) {
+        return false;
+    }
+
+    const auto* next =
+            reinterpret_cast<const cb::mcbp::Header*>(read->rdata().data());
+    if (!is_coalescing_command(*next)) {
+        return false;
+    }
+
+    auto& cookie = getCookieObject();
+    if (cookie.getDynamicBuffer().getRoot() != nullptr) {
+        // The response refers to the cookies dynamic buffer
+        return false;
+    }
+
+    // The response may refer to memory owned by the command context
+    // (which would be released when we start the next command)
+    coalesce.contexts.reserve(coalesce.contexts.size() + 1);
+    auto context = cookie.releaseCommandContext();
+    if (context) {
+        coalesce.contexts.emplace_back(std::move(context));
+    }
+    ++coalesce.responses;
+    coalesce.candidate = false;
+    return true;
+}
+
+void Connection::releaseCoalescedResponses() {
+    coalesce.contexts.clear();
+    coalesce.responses = 0;
+}
+
+bool Connection::useZeroCopySend(size_t len) {
+#ifdef HAVE_MSG_ZEROCOPY
+    const auto threshold = settings.getZeroCopySendThreshold();
+    if (threshold == 0 || len < threshold || ssl.isEnabled()) {
+        return false;
+    }
+
+    if (zerocopy.socket == ZeroCopySocketState::Unknown) {
+        const int enable = 1;
+        if (cb::net::setsockopt(socketDescriptor,
+                                SOL_SOCKET,
+                                SO_ZEROCOPY,
+                                reinterpret_cast<const void*>(&enable),
+                                sizeof(enable)) == 0) {
+            zerocopy.socket = ZeroCopySocketState::Enabled;
+        } else {
+            LOG_INFO("{}: Failed to enable SO_ZEROCOPY: {}",
+                     getId(),
+                     cb_strerror(cb::net::get_socket_error()));
+            zerocopy.socket = ZeroCopySocketState::Unsupported;
+        }
+    }
+    return zerocopy.socket == ZeroCopySocketState::Enabled;
+#else
+    return false;
+#endif
+}
+
+void Connection::addItemIov(cb::unique_item_ptr& item,
+                            const void* buf,
+                            size_t len) {
+    if (useZeroCopySend(len)) {
+        if (!reserveItem(item.get())) {
+            throw std::bad_alloc();
+        }
+        item.release();
+        zerocopy.chunks.emplace_back(static_cast<const char*>(buf), len);
+    }
+    addIov(buf, len);
+}
+
+void Connection::addReservedItemIov(const void* buf, size_t len) {
+    if (useZeroCopySend(len)) {
+        zerocopy.chunks.emplace_back(static_cast<const char*>(buf), len);
+    }
+    addIov(buf, len);
+}
+
 void Connection::releaseReservedItems() {
     auto* bucketEngine = getBucket().getEngine();
-    for (auto* it : reservedItems) {
-        bucketEngine->release(it);
+    if (zerocopy.completed != zerocopy.sent) {
+        reapZeroCopyCompletions();
+    }
+
+    if (zerocopy.completed == zerocopy.sent) {
+        for (auto* it : reservedItems) {
+            bucketEngine->release(it);
+        }
+    } else {
+        // The kernel may still be sending directly from the items
+        for (auto* it : reservedItems) {
+            zerocopy.pinned.push_back({bucketEngine, it, zerocopy.sent});
+        }
     }
     reservedItems.clear();
 }
@@ -1287,7 +1615,16 @@ Connection::~Connection() {
         externalAuthManager->logoff(username);
     }
 
+    auto* thr = getThread();
+    if (thr != nullptr) {
+        thr->scheduler.remove(*this);
+    }
+
+    setStatsSubscription({});
     releaseReservedItems();
+    reapZeroCopyCompletions(true);
+    // The queued contexts may live in the arena of one of our cookies
+    releaseCoalescedResponses();
     for (auto* ptr : temp_alloc) {
         cb_free(ptr);
     }
@@ -1378,6 +1715,9 @@ bool Connection::processServerEvents() {
 }
 
 void Connection::runEventLoop(short which) {
+    if (!zerocopy.pinned.empty()) {
+        reapZeroCopyCompletions();
+    }
     conn_loan_buffers(this);
     currentEvent = which;
     numEvents = max_reqs_per_event;
@@ -1545,6 +1885,16 @@ void Connection::setPriority(Connection::Priority priority) {
                                 std::to_string(int(priority)));
 }
 
+ConnectionClass Connection::getConnectionClass() const {
+    if (isDCP() || priority == Priority::Low) {
+        return ConnectionClass::Bulk;
+    }
+    if (isInternal()) {
+        return ConnectionClass::Admin;
+    }
+    return ConnectionClass::Kv;
+}
+
 bool Connection::selectedBucketIsXattrEnabled() const {
     auto* bucketEngine = getBucketEngine();
     if (bucketEngine) {
@@ -1947,8 +2297,8 @@ ENGINE_ERROR_CODE Connection::mutation(uint32_t opaque,
         // Add the key
         addIov(key.data(), key.size());
 
-        // Add the value
-        addIov(buffer.data(), buffer.size());
+        // Add the value (owned by the reserved item)
+        addReservedItemIov(buffer.data(), buffer.size());
 
         return headerSize;
     });
@@ -1985,9 +2335,9 @@ ENGINE_ERROR_CODE Connection::deletionInner(const item_info& info,
         // Add the key
         addIov(key.data(), key.size());
 
-        // Add the optional payload (xattr)
+        // Add the optional payload (xattr, owned by the reserved item)
         if (info.nbytes > 0) {
-            addIov(info.value[0].iov_base, info.nbytes);
+            addReservedItemIov(info.value[0].iov_base, info.nbytes);
         }
 
         // Add the optional meta section
@@ -2300,8 +2650,8 @@ ENGINE_ERROR_CODE Connection::prepare(uint32_t opaque,
         // Add the key
         addIov(key.data(), key.size());
 
-        // Add the value
-        addIov(buffer.data(), buffer.size());
+        // Add the value (owned by the reserved item)
+        addReservedItemIov(buffer.data(), buffer.size());
         return total;
     });
 
@@ -21,6 +21,7 @@
 #include "ssl_context.h"
 #include "statemachine.h"
 #include "stats.h"
+#include "stats_push.h"
 #include "task.h"
 
 #include <cbsasl/client.h>
@@ -40,6 +41,7 @@
 #include <memory>
 #include <queue>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 class Bucket;
@@ -79,6 +81,8 @@ const size_t MaxSavedAgentName = 33;
  */
 const size_t MaxSavedConnectionId = 34;
 
+enum class ConnectionClass;
+
 /**
  * The structure representing a connection in memcached.
  */
@@ -196,6 +200,14 @@ public:
 
     void setPriority(const Priority priority);
 
+    /**
+     * Get the class used by the front end thread when it orders the ready
+     * connections (see ConnectionScheduler). DCP and low priority
+     * connections are bulk traffic, other connections from internal users
+     * are administrative and everything else is latency sensitive KV.
+     */
+    ConnectionClass getConnectionClass() const;
+
     /**
      * Create a JSON representation of the members of the connection
      */
@@ -457,6 +469,11 @@ public:
         return --numEvents;
     }
 
+    /// Get the number of events left in the current timeslice
+    int getNumEvents() const {
+        return numEvents;
+    }
+
     /**
      * Set the number of events to process per timeslice of the worker
      * thread before yielding.
@@ -597,6 +614,12 @@ public:
         return iovused;
     }
 
+    /**
+     * Get the number of bytes in the message list which is not yet
+     * transferred to the socket
+     */
+    size_t getSendQueueSize() const;
+
     /**
      * Adds a message header to a connection.
      *
@@ -615,10 +638,112 @@ public:
     void addIov(const void* buf, size_t len);
 
     /**
-     * Release all of the items we've saved a reference to
+     * Add a chunk of memory owned by the provided item to the IO vector.
+     *
+     * If zerocopy send is enabled and the chunk is big enough the chunk
+     * is sent with MSG_ZEROCOPY, and the connection takes over the
+     * reference to the item (as a reserved item) so that the memory
+     * stays pinned until the kernel reports that it is done with it.
+     *
+     * @param item the item owning the memory (reset if the connection
+     *             took over the reference)
+     * @param buf pointer to the data to send
+     * @param len number of bytes to send
+     * @throws std::bad_alloc
+     */
+    void addItemIov(cb::unique_item_ptr& item, const void* buf, size_t len);
+
+    /**
+     * Add a chunk of memory owned by an item which is already on our list
+     * of reserved items (as the DCP messages are) to the IO vector. As with
+     * addItemIov the chunk is sent with MSG_ZEROCOPY if zerocopy send is
+     * enabled and the chunk is big enough; releaseReservedItems keeps the
+     * item until the kernel is done with it.
+     *
+     * @param buf pointer to the data to send
+     * @param len number of bytes to send
+     */
+    void addReservedItemIov(const void* buf, size_t len);
+
+    /**
+     * Record if the response for the command just executed may be queued
+     * up together with the responses for the following pipelined commands
+     * (must be called while the packet is still available)
+     *
+     * @param header the header for the command just executed
+     */
+    void updateResponseCoalescing(const cb::mcbp::Header& header);
+
+    /**
+     * Try to queue up the response for the current command instead of
+     * sending it right away, so that it is sent together with the
+     * responses for the next pipelined command(s) in a single sendmsg
+     * call. The response is queued if response coalescing is enabled, the
+     * budget isn't used up and the next command is already received (and
+     * is one of the commands we allow to be coalesced).
+     *
+     * @return true if the response was queued and the caller should move
+     *              on to the next command
+     */
+    bool tryCoalesceResponse();
+
+    /// Do we have responses queued up which isn't sent yet?
+    bool hasCoalescedResponses() const {
+        return coalesce.responses != 0;
+    }
+
+    /// Release the resources kept for the queued responses (once sent)
+    void releaseCoalescedResponses();
+
+    /**
+     * The stats sent in the last "stats json" response. Used to send only
+     * the values which changed when the client asks for a delta by
+     * providing the token it got in that response.
+     */
+    StatsSnapshot& getStatsSnapshot() {
+        return statsSnapshot;
+    }
+
+    /**
+     * The subscription to have a stats group pushed to the client (see
+     * stats_push.h), or nullptr if there isn't one
+     */
+    StatsSubscription* getStatsSubscription() {
+        return statsSubscription.get();
+    }
+
+    /// Replace (or with nullptr remove) the stats subscription
+    void setStatsSubscription(std::unique_ptr<StatsSubscription> subscription);
+
+    /**
+     * Set while "stats subscribe" waits for the engine to collect the group
+     * in the background, which can't be done for a push
+     */
+    bool isStatsSubscribeBlocked() const {
+        return statsSubscribeBlocked;
+    }
+
+    void setStatsSubscribeBlocked(bool value) {
+        statsSubscribeBlocked = value;
+    }
+
+    /**
+     * Release all of the items we've saved a reference to. Items
+     * which may still be referenced by a zerocopy send in progress
+     * are kept until the kernel reports completion
      */
     void releaseReservedItems();
 
+    /**
+     * Read the zerocopy completion notifications from the socket error
+     * queue and release the pinned items the kernel is done with
+     *
+     * @param force release all pinned items even if the kernel didn't
+     *              report the send as completed (used when we shut down
+     *              the connection)
+     */
+    void reapZeroCopyCompletions(bool force = false);
+
     /**
      * Put an item on our list of reserved items (which we should release
      * at a later time through releaseReservedItems).
@@ -639,12 +764,21 @@ public:
             cb_free(ptr);
         }
         temp_alloc.resize(0);
+        temp_shared.clear();
     }
 
     void pushTempAlloc(char* ptr) {
         temp_alloc.push_back(ptr);
     }
 
+    /**
+     * Keep a reference to a shared object the connection is sending data
+     * straight from until it is done sending all of the data
+     */
+    void pushTempAlloc(std::shared_ptr<const void> ptr) {
+        temp_shared.push_back(std::move(ptr));
+    }
+
     /**
      * Enable the datatype which corresponds to the feature
      *
@@ -1230,6 +1364,75 @@ protected:
      */
     std::vector<void*> reservedItems;
 
+    enum class ZeroCopySocketState : uint8_t { Unknown, Enabled, Unsupported };
+
+    /**
+     * The state used for coalescing the responses for pipelined commands
+     */
+    struct {
+        /// May the response for the last executed command be queued
+        bool candidate = false;
+        /// The number of queued responses
+        size_t responses = 0;
+        /// The command contexts owning memory used by the queued responses
+        std::vector<std::unique_ptr<CommandContext>> contexts;
+        /**
+         * The entries in the IO vector pointing into the write pipe
+         * (index in iov, offset from the read head of the pipe). The pipe
+         * may relocate its data when it grows while we're queueing up
+         * responses, so we need to update them before we send the data.
+         */
+        std::vector<std::pair<size_t, size_t>> pipeIovs;
+    } coalesce;
+
+    /// Update the IO vector entries pointing into the write pipe
+    void relocateWriteIovs();
+
+    /// The stats sent in the last "stats json" response
+    StatsSnapshot statsSnapshot;
+
+    /// The stats group pushed to the client (if any)
+    std::unique_ptr<StatsSubscription> statsSubscription;
+
+    bool statsSubscribeBlocked = false;
+
+    /// An item kept alive until the kernel is done sending from it
+    struct PinnedItem {
+        EngineIface* engine;
+        void* item;
+        /// The item may be released once this many sends have completed
+        uint32_t sends;
+    };
+
+    /**
+     * The state used for sending document data with MSG_ZEROCOPY
+     */
+    struct {
+        /// Has SO_ZEROCOPY been tried enabled on the socket, and did it work
+        ZeroCopySocketState socket = ZeroCopySocketState::Unknown;
+        /// Chunks in the IO vector which should be sent with MSG_ZEROCOPY
+        std::vector<cb::const_char_buffer> chunks;
+        /// The number of sendmsg calls using MSG_ZEROCOPY
+        uint32_t sent = 0;
+        /// The number of those calls the kernel reported as completed
+        uint32_t completed = 0;
+        /// Items which can't be released before the kernel is done
+        std::vector<PinnedItem> pinned;
+    } zerocopy;
+
+    /**
+     * Send the data in the message header containing one or more chunks
+     * registered with addItemIov. The data before the first chunk is sent
+     * with a normal sendmsg, and each chunk is sent with MSG_ZEROCOPY.
+     */
+    ssize_t sendmsgZeroCopy(struct msghdr* m);
+
+    /**
+     * Should a chunk of the given size be sent with MSG_ZEROCOPY? Enables
+     * SO_ZEROCOPY on the socket the first time it's needed.
+     */
+    bool useZeroCopySend(size_t len);
+
     /**
      * A vector of temporary allocations that should be freed when the
      * the connection is done sending all of the data. Use pushTempAlloc to
@@ -1238,6 +1441,9 @@ protected:
      */
     std::vector<char*> temp_alloc;
 
+    /// The shared objects pushed with pushTempAlloc
+    std::vector<std::shared_ptr<const void>> temp_shared;
+
     /**
      * If the client enabled the mutation seqno feature each mutation
      * command will return the vbucket UUID and sequence number for the
@@ -0,0 +1,87 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "connection_scheduler.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+void ConnectionScheduler::schedule(Connection& connection,
+                                   ConnectionClass cls,
+                                   short which) {
+    auto iter = queued.find(&connection);
+    if (iter != queued.end()) {
+        for (auto& entry : queues[toIndex(iter->second)]) {
+            if (entry.connection == &connection) {
+                entry.which |= which;
+                return;
+            }
+        }
+        throw std::logic_error(
+                "ConnectionScheduler::schedule: connection not found in "
+                "queue");
+    }
+
+    const auto idx = toIndex(cls);
+    if (queues[idx].empty()) {
+        virtualTime[idx] = std::max(virtualTime[idx], virtualNow);
+    }
+    queues[idx].push_back(Entry{&connection, which, cls});
+    queued.emplace(&connection, cls);
+}
+
+ConnectionScheduler::Entry ConnectionScheduler::next() {
+    size_t selected = NumClasses;
+    for (size_t ii = 0; ii < NumClasses; ++ii) {
+        if (!queues[ii].empty() &&
+            (selected == NumClasses ||
+             virtualTime[ii] < virtualTime[selected])) {
+            selected = ii;
+        }
+    }
+
+    if (selected == NumClasses) {
+        throw std::logic_error("ConnectionScheduler::next: queue is empty");
+    }
+
+    auto entry = queues[selected].front();
+    queues[selected].pop_front();
+    queued.erase(entry.connection);
+    virtualNow = virtualTime[selected];
+    return entry;
+}
+
+void ConnectionScheduler::charge(ConnectionClass cls,
+                                 std::chrono::nanoseconds used) {
+    const auto weight = std::max(size_t(1), settings.getQosWeight(cls));
+    virtualTime[toIndex(cls)] += uint64_t(used.count()) / weight;
+}
+
+void ConnectionScheduler::remove(Connection& connection) {
+    auto iter = queued.find(&connection);
+    if (iter == queued.end()) {
+        return;
+    }
+
+    auto& queue = queues[toIndex(iter->second)];
+    queue.erase(std::remove_if(queue.begin(),
+                               queue.end(),
+                               [&connection](const Entry& entry) {
+                                   return entry.connection == &connection;
+                               }),
+                queue.end());
+    queued.erase(iter);
+}
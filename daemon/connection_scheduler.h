@@ -0,0 +1,90 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include "settings.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+
+class Connection;
+
+/**
+ * The ConnectionScheduler decides the order a front end thread serves the
+ * connections the event library reported as ready.
+ *
+ * Each connection class has a FIFO queue of ready connections and a
+ * virtual time (the CPU time used by the class divided by its weight).
+ * The next connection is picked from the class with the lowest virtual
+ * time (weighted fair queueing), so a class which recently used a lot of
+ * time (a slow stats call, a DCP burst) is served after the connections
+ * of the other classes queued behind it. A class becoming ready starts at
+ * the virtual time of the last class served so it can't bank credit while
+ * it is idle.
+ *
+ * The scheduler never dereferences the connections, and it is only
+ * used by the thread owning it (no locking).
+ */
+class ConnectionScheduler {
+public:
+    static constexpr size_t NumClasses = 3;
+
+    struct Entry {
+        Connection* connection;
+        /// The libevent flags the connection was notified with
+        short which;
+        ConnectionClass cls;
+    };
+
+    /**
+     * Add the connection to the queue for the class. If the connection is
+     * already queued the flags are merged into the existing entry.
+     */
+    void schedule(Connection& connection, ConnectionClass cls, short which);
+
+    /// Remove (and return) the next connection to serve
+    Entry next();
+
+    /// Charge the class for the time spent serving one of its connections
+    void charge(ConnectionClass cls, std::chrono::nanoseconds used);
+
+    /// Forget about the connection (it is about to be deleted)
+    void remove(Connection& connection);
+
+    bool empty() const {
+        return queued.empty();
+    }
+
+    size_t size() const {
+        return queued.size();
+    }
+
+protected:
+    static size_t toIndex(ConnectionClass cls) {
+        return static_cast<size_t>(cls);
+    }
+
+    std::array<std::deque<Entry>, NumClasses> queues;
+    std::array<uint64_t, NumClasses> virtualTime{};
+    /// The virtual time of the class served last
+    uint64_t virtualNow = 0;
+    /// The connections currently queued (and the class they're queued in)
+    std::unordered_map<Connection*, ConnectionClass> queued;
+};
@@ -53,10 +53,10 @@ enum class BufferLoan {
 /** Function prototypes ******************************************************/
 
 static BufferLoan loan_single_buffer(Connection& c,
-                                     std::unique_ptr<cb::Pipe>& thread_buf,
+                                     FrontEndThread::BufferPool& pool,
                                      std::unique_ptr<cb::Pipe>& conn_buf);
 static void maybe_return_single_buffer(Connection& c,
-                                       std::unique_ptr<cb::Pipe>& thread_buf,
+                                       FrontEndThread::BufferPool& pool,
                                        std::unique_ptr<cb::Pipe>& conn_buf);
 static void conn_destructor(Connection* c);
 static Connection* allocate_connection(SOCKET sfd,
@@ -143,6 +143,7 @@ void close_all_connections() {
 }
 
 void run_event_loop(Connection* c, short which) {
+    const auto queued = c->getSendQueueSize();
     const auto start = std::chrono::steady_clock::now();
     c->runEventLoop(which);
     const auto stop = std::chrono::steady_clock::now();
@@ -154,6 +155,18 @@ void run_event_loop(Connection* c, short which) {
     auto* thread = c->getThread();
     if (thread != nullptr) {
         scheduler_info[thread->index].add(duration_cast<microseconds>(ns));
+        thread->load.cpu_time.fetch_add(ns.count(), std::memory_order_relaxed);
+
+        // Update the threads view of the data queued for transmission
+        // with the change caused by running this connection
+        const auto now_queued = c->getSendQueueSize();
+        if (now_queued > queued) {
+            thread->load.send_queue_size.fetch_add(now_queued - queued,
+                                                   std::memory_order_relaxed);
+        } else if (now_queued < queued) {
+            thread->load.send_queue_size.fetch_sub(queued - now_queued,
+                                                   std::memory_order_relaxed);
+        }
     }
 
     if (c->shouldDelete()) {
@@ -184,6 +197,7 @@ Connection* conn_new(SOCKET sfd,
     }
 
     c->setThread(thread);
+    thread->load.connections.fetch_add(1, std::memory_order_relaxed);
 
     if (settings.getVerbose() > 1) {
         LOG_DEBUG("<{} new client connection", sfd);
@@ -293,17 +307,44 @@ static void release_connection(Connection* c) {
         connections.conns.erase(iter);
     }
 
+    auto* thread = c->getThread();
+    if (thread != nullptr) {
+        thread->load.connections.fetch_sub(1, std::memory_order_relaxed);
+        thread->load.send_queue_size.fetch_sub(c->getSendQueueSize(),
+                                               std::memory_order_relaxed);
+    }
+
     // Finally free it
     conn_destructor(c);
 }
 
+std::unique_ptr<cb::Pipe> FrontEndThread::BufferPool::pop() {
+    std::unique_ptr<cb::Pipe> ret;
+    if (!buffers.empty()) {
+        ret = std::move(buffers.back());
+        buffers.pop_back();
+    }
+    return ret;
+}
+
+void FrontEndThread::BufferPool::push(std::unique_ptr<cb::Pipe> buffer) {
+    if (buffers.size() < MaxBuffers &&
+        buffer->capacity() <= MaxBufferCapacity) {
+        try {
+            buffers.emplace_back(std::move(buffer));
+        } catch (const std::bad_alloc&) {
+            // Just let the buffer go
+        }
+    }
+}
+
 /**
  * If the connection doesn't already have a populated conn_buff, ensure that
- * it does by either loaning out the threads, or allocating a new one if
- * necessary.
+ * it does by either loaning one from the threads pool, or allocating a new
+ * one if necessary.
  */
 static BufferLoan loan_single_buffer(Connection& c,
-                                     std::unique_ptr<cb::Pipe>& thread_buf,
+                                     FrontEndThread::BufferPool& pool,
                                      std::unique_ptr<cb::Pipe>& conn_buf) {
     /* Already have a (partial) buffer - nothing to do. */
     if (conn_buf) {
@@ -311,8 +352,8 @@ static BufferLoan loan_single_buffer(Connection& c,
     }
 
     // If the thread has a buffer, let's loan that to the connection
-    if (thread_buf) {
-        thread_buf.swap(conn_buf);
+    conn_buf = pool.pop();
+    if (conn_buf) {
         return BufferLoan::Loaned;
     }
 
@@ -335,15 +376,11 @@ static BufferLoan loan_single_buffer(Connection& c,
 }
 
 static void maybe_return_single_buffer(Connection& c,
-                                       std::unique_ptr<cb::Pipe>& thread_buf,
+                                       FrontEndThread::BufferPool& pool,
                                        std::unique_ptr<cb::Pipe>& conn_buf) {
     if (conn_buf && conn_buf->empty()) {
-        // Buffer clean, dispose of it
-        if (thread_buf) {
-            // Already got a thread buffer.. release this one
-            conn_buf.reset();
-        } else {
-            conn_buf.swap(thread_buf);
-        }
+        // Buffer clean, hand it back to the pool (which frees it if
+        // the pool is full)
+        pool.push(std::move(conn_buf));
     }
 }
@@ -17,12 +17,14 @@
 
 #include "cookie.h"
 
+#include "alloc_hooks.h"
 #include "buckets.h"
 #include "connection.h"
 #include "cookie_trace_context.h"
 #include "mcbp.h"
 #include "mcbp_executors.h"
 #include "settings.h"
+#include "slow_op_log.h"
 
 #include <logger/logger.h>
 #include <mcbp/mcbp.h>
@@ -35,6 +37,7 @@
 #include <platform/uuid.h>
 #include <utilities/logtags.h>
 #include <chrono>
+#include <limits>
 
 nlohmann::json Cookie::toJSON() const {
     nlohmann::json ret;
@@ -115,6 +118,8 @@ const std::string& Cookie::getErrorJson() {
 bool Cookie::execute() {
     // Reset ewouldblock state!
     setEwouldblock(false);
+    const auto executeStart = std::chrono::steady_clock::now();
+    const auto allocatedStart = AllocHooks::get_thread_allocated_bytes();
     const auto& header = getHeader();
     if (header.isResponse()) {
         execute_response_packet(*this, header.getResponse());
@@ -123,6 +128,8 @@ bool Cookie::execute() {
         // so it must be a request
         execute_request_packet(*this, header.getRequest());
     }
+    executionTime += std::chrono::steady_clock::now() - executeStart;
+    allocatedBytes += AllocHooks::get_thread_allocated_bytes() - allocatedStart;
 
     return !isEwouldblock();
 }
@@ -232,6 +239,18 @@ void Cookie::setEwouldblock(bool ewouldblock) {
         setAiostat(ENGINE_EWOULDBLOCK);
     }
 
+    if (ewouldblock != Cookie::ewouldblock) {
+        const auto now = std::chrono::steady_clock::now();
+        if (ewouldblock) {
+            blockedSince = now;
+            if (blockedCount < std::numeric_limits<uint8_t>::max()) {
+                ++blockedCount;
+            }
+        } else {
+            blockedTime += now - blockedSince;
+        }
+    }
+
     Cookie::ewouldblock = ewouldblock;
 }
 
@@ -249,9 +268,9 @@ void Cookie::sendDynamicBuffer() {
 }
 
 void Cookie::sendNotMyVBucket() {
-    auto pair = connection.getBucket().clusterConfiguration.getConfiguration();
-    if (pair.first == -1 || (pair.first == connection.getClustermapRevno() &&
-                             settings.isDedupeNmvbMaps())) {
+    auto config = connection.getBucket().clusterConfiguration.getConfiguration();
+    if (!config || (config->revision == connection.getClustermapRevno() &&
+                    settings.isDedupeNmvbMaps())) {
         // We don't have a vbucket map, or we've already sent it to the
         // client
         mcbp_add_header(*this,
@@ -265,25 +284,28 @@ void Cookie::sendNotMyVBucket() {
         return;
     }
 
-    const size_t needed = sizeof(cb::mcbp::Response) + pair.second->size();
-    if (!growDynamicBuffer(needed)) {
-        throw std::bad_alloc();
-    }
-    auto& buffer = getDynamicBuffer();
-    auto* buf = reinterpret_cast<uint8_t*>(buffer.getCurrent());
-    const auto& header = getHeader();
-    cb::mcbp::ResponseBuilder builder({buf, needed});
-    builder.setMagic(cb::mcbp::Magic::ClientResponse);
-    builder.setOpcode(header.getRequest().getClientOpcode());
-    builder.setStatus(cb::mcbp::Status::NotMyVbucket);
-    builder.setOpaque(header.getOpaque());
-    builder.setValue({reinterpret_cast<const uint8_t*>(pair.second->data()),
-                      pair.second->size()});
-    builder.validate();
+    sendClusterConfig(cb::mcbp::Status::NotMyVbucket, std::move(config));
+}
+
+void Cookie::sendClusterConfig(
+        cb::mcbp::Status status,
+        std::shared_ptr<const ClusterConfiguration::Config> config) {
+    const auto payload = config->getPayload(connection.isSnappyEnabled());
+    mcbp_add_header(*this,
+                    status,
+                    0,
+                    0,
+                    uint32_t(payload.value.size()),
+                    connection.getEnabledDatatypes(payload.datatype));
+
+    // Send the configuration straight from the shared copy (rather than
+    // copying it for every client), keeping it until it's sent
+    connection.addIov(payload.value.data(), payload.value.size());
+    connection.setClustermapRevno(config->revision);
+    connection.pushTempAlloc(std::move(config));
 
-    buffer.moveOffset(needed);
-    sendDynamicBuffer();
-    connection.setClustermapRevno(pair.first);
+    connection.setState(StateMachine::State::send_data);
+    connection.setWriteAndGo(StateMachine::State::new_cmd);
 }
 
 void Cookie::sendResponse(cb::mcbp::Status status) {
@@ -453,6 +475,9 @@ void Cookie::logResponse(ENGINE_ERROR_CODE code) const {
 
 void Cookie::setCommandContext(CommandContext* ctx) {
     commandContext.reset(ctx);
+    if (!commandContext) {
+        arena.reset();
+    }
 }
 
 void Cookie::maybeLogSlowCommand(
@@ -508,6 +533,44 @@ void Cookie::maybeLogSlowCommand(
                 c.getPeername(),
                 c.getBucket().name);
     }
+
+    if (cb::slowOpLog.isEnabled()) {
+        const auto adaptive =
+                getConnection().getBucket().slowOpThresholds.get(opcode);
+        if (adaptive.count() != 0 && elapsed > adaptive &&
+            adaptive < limit) {
+            captureSlowCommand(elapsed, adaptive, true);
+        } else if (elapsed > limit) {
+            captureSlowCommand(elapsed, limit, false);
+        }
+    }
+}
+
+void Cookie::captureSlowCommand(std::chrono::steady_clock::duration elapsed,
+                                std::chrono::nanoseconds threshold,
+                                bool adaptive) const {
+    cb::SlowOpRecord record;
+    record.timestamp = std::chrono::system_clock::now();
+    record.duration = elapsed;
+    record.threshold = threshold;
+    record.adaptive = adaptive;
+    record.opcode = getRequest().getClientOpcode();
+    record.start = getStart();
+    const auto spans = tracer.getDurations();
+    record.spans.assign(spans.begin(), spans.end());
+    record.execution = getExecutionTime();
+    record.blocked = getBlockedTime();
+    record.blockedCount = getBlockedCount();
+    record.allocated = getAllocatedBytes();
+
+    const auto& c = getConnection();
+    record.connectionId = c.getId();
+    record.opaque = ntohl(getHeader().getOpaque());
+    record.peer = c.getPeername();
+    record.user = cb::tagUserData(c.getUsername());
+    record.bucket = c.getBucket().name;
+    record.key = getPrintableRequestKey();
+    cb::slowOpLog.record(std::move(record));
 }
 
 Cookie::Cookie(Connection& conn) : connection(conn) {
@@ -521,6 +584,10 @@ void Cookie::initialize(cb::const_byte_buffer header, bool tracing_enabled) {
     start = std::chrono::steady_clock::now();
     tracer.begin(cb::tracing::TraceCode::REQUEST, start);
     ewouldblock = false;
+    blockedTime = {};
+    blockedCount = 0;
+    executionTime = {};
+    allocatedBytes = 0;
     openTracingContext.clear();
 }
 
@@ -531,12 +598,32 @@ void Cookie::reset() {
     packet = {};
     cas = 0;
     commandContext.reset();
+    arena.reset();
     dynamicBuffer.clear();
+    inflatedInputPayload.reset();
+    inflatedInputPayloadSource = {};
     tracer.clear();
     ewouldblock = false;
     openTracingContext.clear();
 }
 
+bool Cookie::inflateInputPayload(cb::const_char_buffer compressed) {
+    if (inflatedInputPayloadSource.data() != nullptr &&
+        inflatedInputPayloadSource.data() == compressed.data() &&
+        inflatedInputPayloadSource.size() == compressed.size()) {
+        return true;
+    }
+
+    inflatedInputPayloadSource = {};
+    if (!cb::compression::inflate(cb::compression::Algorithm::Snappy,
+                                  compressed,
+                                  inflatedInputPayload)) {
+        return false;
+    }
+    inflatedInputPayloadSource = compressed;
+    return true;
+}
+
 void Cookie::setOpenTracingContext(cb::const_byte_buffer context) {
     try {
         openTracingContext.assign(reinterpret_cast<const char*>(context.data()),
@@ -16,7 +16,9 @@
  */
 #pragma once
 
+#include "cluster_config.h"
 #include "dynamic_buffer.h"
+#include "request_arena.h"
 #include "tracing/tracer.h"
 
 #include <mcbp/protocol/datatype.h>
@@ -24,6 +26,7 @@
 #include <memcached/dockey.h>
 #include <memcached/engine_error.h>
 #include <nlohmann/json.hpp>
+#include <platform/compress.h>
 #include <platform/sized_buffer.h>
 #include <chrono>
 
@@ -176,6 +179,22 @@ public:
         return dynamicBuffer;
     }
 
+    /**
+     * Inflate (Snappy compressed) data within the current packet. The
+     * inflated copy is kept until the cookie is reset, so the validator and
+     * the executor of a command share it rather than inflating the same
+     * value once each.
+     *
+     * @param compressed the compressed data
+     * @return true if success, false if the data isn't valid Snappy
+     */
+    bool inflateInputPayload(cb::const_char_buffer compressed);
+
+    /// Get the data inflated by the last call to inflateInputPayload()
+    cb::const_char_buffer getInflatedInputPayload() const {
+        return inflatedInputPayload;
+    }
+
     /**
      * Execute the current packet
      *
@@ -367,6 +386,18 @@ public:
      */
     void sendNotMyVBucket();
 
+    /**
+     * Send a response with the cluster configuration as the value (in
+     * the compressed form if the client negotiated Snappy), and remember
+     * that the client got that revision
+     *
+     * @param status the status of the response
+     * @param config the configuration to send
+     */
+    void sendClusterConfig(
+            cb::mcbp::Status status,
+            std::shared_ptr<const ClusterConfiguration::Config> config);
+
     /**
      * Send a response without a message payload back to the client.
      *
@@ -417,7 +448,7 @@ public:
     ContextType& obtainContext(Args&&... args) {
         auto* context = commandContext.get();
         if (context == nullptr) {
-            auto* ret = new ContextType(std::forward<Args>(args)...);
+            auto* ret = new (arena) ContextType(std::forward<Args>(args)...);
             commandContext.reset(ret);
             return *ret;
         }
@@ -434,11 +465,29 @@ public:
         return commandContext.get();
     }
 
+    /**
+     * Get the arena used for allocations which only live for the duration
+     * of the current request (it is rewound when the cookie is reset)
+     */
+    cb::RequestArena& getArena() {
+        return arena;
+    }
+
+    /**
+     * Release the ownership of the command context (used when the
+     * response refers to memory owned by the context and we want to
+     * reset the cookie before the response is sent)
+     */
+    std::unique_ptr<CommandContext> releaseCommandContext() {
+        return std::move(commandContext);
+    }
+
     void setCommandContext(CommandContext* ctx = nullptr);
 
     /**
      * Log the current connection if its execution time exceeds the
-     * threshold for the command
+     * threshold for the command (and capture its trace in the slow
+     * operation log if it exceeds the SLA or the adaptive threshold)
      *
      * @param elapsed the time elapsed while executing the command
      */
@@ -451,6 +500,37 @@ public:
         return start;
     }
 
+    /**
+     * Get the total time the current command spent blocked (waiting for
+     * the engine to notify completion of an ewouldblock)
+     */
+    std::chrono::steady_clock::duration getBlockedTime() const {
+        return blockedTime;
+    }
+
+    /// Get the number of times the current command blocked
+    uint8_t getBlockedCount() const {
+        return blockedCount;
+    }
+
+    /**
+     * Get the total time the front end thread spent executing the current
+     * command (summed over each time it was executed, including the time
+     * spent in synchronous calls to the engine)
+     */
+    std::chrono::steady_clock::duration getExecutionTime() const {
+        return executionTime;
+    }
+
+    /**
+     * Get the number of bytes the front end thread allocated while
+     * executing the current command (0 if the allocator doesn't track
+     * per-thread allocations)
+     */
+    uint64_t getAllocatedBytes() const {
+        return allocatedBytes;
+    }
+
     bool isTracingEnabled() const {
         return enableTracing;
     }
@@ -513,6 +593,11 @@ public:
     CookieTraceContext extractTraceContext();
 
 protected:
+    /// Add the command to the slow operation log
+    void captureSlowCommand(std::chrono::steady_clock::duration elapsed,
+                            std::chrono::nanoseconds threshold,
+                            bool adaptive) const;
+
     bool enableTracing = false;
     cb::tracing::Tracer tracer;
 
@@ -552,6 +637,11 @@ protected:
      */
     DynamicBuffer dynamicBuffer;
 
+    /// The inflated copy of (a part of) the input packet
+    cb::compression::Buffer inflatedInputPayload;
+    /// The compressed data inflatedInputPayload was inflated from
+    cb::const_char_buffer inflatedInputPayloadSource;
+
     /** The cas to return back to the client */
     uint64_t cas = 0;
 
@@ -561,6 +651,23 @@ protected:
      */
     std::chrono::steady_clock::time_point start;
 
+    /// When the command last returned ewouldblock
+    std::chrono::steady_clock::time_point blockedSince;
+    /// The total time the command spent blocked
+    std::chrono::steady_clock::duration blockedTime{};
+    /// The number of times the command blocked (saturates at 255)
+    uint8_t blockedCount = 0;
+    /// The total time spent in execute() for the command
+    std::chrono::steady_clock::duration executionTime{};
+    /// The bytes allocated by the front end thread in execute()
+    uint64_t allocatedBytes = 0;
+
+    /**
+     * The arena the command context is allocated from. It must be declared
+     * before (and hence outlive) commandContext
+     */
+    cb::RequestArena arena;
+
     /**
      *  command-specific context - for use by command executors to maintain
      *  additional state while executing a command. For example
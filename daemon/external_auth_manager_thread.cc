@@ -21,10 +21,12 @@
 #include "server_event.h"
 #include "start_sasl_auth_task.h"
 
+#include <cbcrypto/cbcrypto.h>
 #include <logger/logger.h>
 #include <mcbp/protocol/framebuilder.h>
 #include <nlohmann/json.hpp>
 #include <platform/base64.h>
+#include <platform/random.h>
 #include <algorithm>
 
 /// The one and only handle to the external authentication manager
@@ -121,6 +123,18 @@ protected:
     const std::string payload;
 };
 
+ExternalAuthManagerThread::ExternalAuthManagerThread()
+    : Couchbase::Thread("mcd:ext_auth") {
+    cacheKeySalt.resize(32);
+    cb::RandomGenerator randomGenerator;
+    if (!randomGenerator.getBytes(const_cast<char*>(cacheKeySalt.data()),
+                                  cacheKeySalt.size())) {
+        throw std::runtime_error(
+                "ExternalAuthManagerThread: Failed to generate the cache "
+                "key salt");
+    }
+}
+
 void ExternalAuthManagerThread::add(Connection& connection) {
     std::lock_guard<std::mutex> guard(mutex);
 
@@ -262,11 +276,14 @@ void ExternalAuthManagerThread::processRequestQueue() {
         while (!incomingRequests.empty()) {
             const std::string msg =
                     R"({"error":{"context":"External auth service is down"}})";
+            auto* request = incomingRequests.front();
+            incomingRequests.pop();
+            if (serveFromCache(*request, getCacheKey(*request))) {
+                continue;
+            }
             incommingResponse.emplace(
                     std::make_unique<AuthResponse>(next, msg));
-            requestMap[next++] =
-                    std::make_pair(nullptr, incomingRequests.front());
-            incomingRequests.pop();
+            requestMap[next++].tasks.push_back(request);
         }
         return;
     }
@@ -280,13 +297,29 @@ void ExternalAuthManagerThread::processRequestQueue() {
     std::vector<std::unique_ptr<AuthenticationRequestServerEvent>> events;
     // Just authenticate if we've got an entry which is newer than 2x of the
     // push interval (and that it is newer than the max rbac cache age)
-    const auto then = std::chrono::steady_clock::now() -
-                      2 * activeUsersPushInterval.load();
+    const auto now = std::chrono::steady_clock::now();
+    const auto then = now - 2 * activeUsersPushInterval.load();
     while (!incomingRequests.empty()) {
         using namespace std::chrono;
 
+        auto* request = incomingRequests.front();
+        incomingRequests.pop();
+
+        auto key = getCacheKey(*request);
+        if (serveFromCache(*request, key)) {
+            continue;
+        }
+
+        auto iter = inflight.find(key);
+        if (iter != inflight.end()) {
+            // We've already asked the provider about these credentials
+            requestMap[iter->second].tasks.push_back(request);
+            ++counters.coalesced;
+            continue;
+        }
+
         const auto ts = cb::rbac::getExternalUserTimestamp(
-                incomingRequests.front()->getUsername());
+                request->getUsername());
         const auto timestamp = ts ? ts.get() : steady_clock::time_point{};
         const uint64_t age = static_cast<uint64_t>(
                 duration_cast<seconds>(timestamp.time_since_epoch()).count());
@@ -295,9 +328,21 @@ void ExternalAuthManagerThread::processRequestQueue() {
                 (timestamp > then) &&
                 (age >= rbacCacheEpoch.load(std::memory_order_acquire));
         events.emplace_back(std::make_unique<AuthenticationRequestServerEvent>(
-                next, *incomingRequests.front(), authOnly));
-        requestMap[next++] = std::make_pair(provider, incomingRequests.front());
-        incomingRequests.pop();
+                next, *request, authOnly));
+        auto& entry = requestMap[next];
+        entry.provider = provider;
+        entry.tasks.push_back(request);
+        entry.sent = now;
+        inflight[key] = next;
+        entry.cacheKey = std::move(key);
+        ++next;
+        ++counters.requests;
+    }
+
+    if (events.empty()) {
+        // Everything was served from the cache (or is waiting for
+        // requests already sent)
+        return;
     }
 
     // We cannot hold the internal lock when we try to lock the front
@@ -331,6 +376,128 @@ void ExternalAuthManagerThread::setRbacCacheEpoch(
     using namespace std::chrono;
     const auto age = duration_cast<seconds>(tp.time_since_epoch()).count();
     rbacCacheEpoch.store(static_cast<uint64_t>(age), std::memory_order_release);
+
+    // The cached results may refer to the old RBAC entries
+    std::lock_guard<std::mutex> guard(mutex);
+    resultCache.clear();
+}
+
+void ExternalAuthManagerThread::setResultCacheTtl(
+        std::chrono::microseconds positive,
+        std::chrono::microseconds negative) {
+    std::lock_guard<std::mutex> guard(mutex);
+    positiveCacheTtl = positive;
+    negativeCacheTtl = negative;
+    if (positive.count() == 0 && negative.count() == 0) {
+        resultCache.clear();
+    }
+}
+
+std::string ExternalAuthManagerThread::getCacheKey(
+        const StartSaslAuthTask& request) const {
+    // Never keep the credentials in memory; only a (salted) hash of them
+    const auto digest = cb::crypto::HMAC(cb::crypto::Algorithm::SHA256,
+                                         cacheKeySalt,
+                                         request.getChallenge());
+    std::string key = request.getMechanism();
+    key.push_back('\0');
+    key.append(request.getUsername());
+    key.push_back('\0');
+    key.append(digest);
+    return key;
+}
+
+bool ExternalAuthManagerThread::serveFromCache(StartSaslAuthTask& request,
+                                               const std::string& key) {
+    auto iter = resultCache.find(key);
+    if (iter == resultCache.end()) {
+        return false;
+    }
+
+    const auto& result = iter->second;
+    if (result.expiry < std::chrono::steady_clock::now() ||
+        (result.status == cb::mcbp::Status::Success &&
+         !cb::rbac::getExternalUserTimestamp(request.getUsername()))) {
+        // Expired, or the RBAC entry for the user is gone
+        resultCache.erase(iter);
+        return false;
+    }
+
+    if (result.status == cb::mcbp::Status::Success) {
+        ++counters.cacheHits;
+    } else {
+        ++counters.negativeCacheHits;
+    }
+    incommingResponse.emplace(std::make_unique<AuthResponse>(
+            next, result.status, result.payload));
+    requestMap[next++].tasks.push_back(&request);
+    return true;
+}
+
+void ExternalAuthManagerThread::cacheResult(const std::string& key,
+                                            cb::mcbp::Status status,
+                                            const std::string& payload) {
+    std::chrono::microseconds ttl;
+    switch (status) {
+    case cb::mcbp::Status::Success:
+        ttl = positiveCacheTtl;
+        break;
+    case cb::mcbp::Status::AuthError:
+    case cb::mcbp::Status::KeyEnoent:
+    case cb::mcbp::Status::KeyEexists:
+        ttl = negativeCacheTtl;
+        break;
+    default:
+        // Don't cache temporary failures
+        return;
+    }
+    if (ttl.count() == 0) {
+        return;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    if (resultCache.size() >= maxCachedResults) {
+        for (auto iter = resultCache.begin(); iter != resultCache.end();) {
+            if (iter->second.expiry < now) {
+                iter = resultCache.erase(iter);
+            } else {
+                ++iter;
+            }
+        }
+        if (resultCache.size() >= maxCachedResults) {
+            return;
+        }
+    }
+    resultCache[key] = CachedResult{status, payload, now + ttl};
+}
+
+void ExternalAuthManagerThread::addStats(const AddStatFn& add_stat,
+                                         const void* cookie) {
+    std::unique_lock<std::mutex> guard(mutex);
+    const auto requests = std::to_string(counters.requests);
+    const auto coalesced = std::to_string(counters.coalesced);
+    const auto cacheHits = std::to_string(counters.cacheHits);
+    const auto negativeCacheHits = std::to_string(counters.negativeCacheHits);
+    const auto cacheSize = std::to_string(resultCache.size());
+    const auto outstanding = std::to_string(inflight.size());
+    const auto latency = providerLatency.to_string();
+    guard.unlock();
+
+    const auto add = [&add_stat, cookie](const std::string& key,
+                                         const std::string& value) {
+        add_stat(key.data(),
+                 gsl::narrow<uint16_t>(key.size()),
+                 value.data(),
+                 gsl::narrow<uint32_t>(value.size()),
+                 cookie);
+    };
+    add("requests", requests);
+    add("coalesced", coalesced);
+    add("cache_hits", cacheHits);
+    add("negative_cache_hits", negativeCacheHits);
+    add("cache_size", cacheSize);
+    add("outstanding", outstanding);
+    add("provider_latency", latency);
 }
 
 void ExternalAuthManagerThread::processResponseQueue() {
@@ -343,10 +510,26 @@ void ExternalAuthManagerThread::processResponseQueue() {
             LOG_WARNING("processResponseQueue(): Ignoring unknown opaque: {}",
                         entry->opaque);
         } else {
-            StartSaslAuthTask* task = iter->second.second;
+            auto request = std::move(iter->second);
             requestMap.erase(iter);
+            if (request.provider) {
+                providerLatency.add(
+                        std::chrono::duration_cast<std::chrono::microseconds>(
+                                std::chrono::steady_clock::now() -
+                                request.sent));
+            }
+            if (!request.cacheKey.empty()) {
+                auto inflightIter = inflight.find(request.cacheKey);
+                if (inflightIter != inflight.end() &&
+                    inflightIter->second == entry->opaque) {
+                    inflight.erase(inflightIter);
+                }
+                cacheResult(request.cacheKey, entry->status, entry->payload);
+            }
             mutex.unlock();
-            task->externalAuthResponse(entry->status, entry->payload);
+            for (auto* task : request.tasks) {
+                task->externalAuthResponse(entry->status, entry->payload);
+            }
             mutex.lock();
         }
         responses.pop();
@@ -362,14 +545,18 @@ void ExternalAuthManagerThread::purgePendingDeadConnections() {
                 R"({"error":{"context":"External auth service is down"}})";
 
         for (auto& req : requestMap) {
-            if (req.second.first == connection) {
+            if (req.second.provider == connection) {
                 // We don't need to check if we've got a response queued
                 // already, as we'll ignore unknown responses..
                 // We need to fix this if we want to redistribute
                 // them over to another provider
                 incommingResponse.emplace(
                         std::make_unique<AuthResponse>(req.first, msg));
-                req.second.first = nullptr;
+                req.second.provider = nullptr;
+                // New requests for the same credentials must not wait for
+                // this one
+                inflight.erase(req.second.cacheKey);
+                req.second.cacheKey.clear();
             }
         }
 
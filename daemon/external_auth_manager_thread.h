@@ -19,12 +19,15 @@
 
 #include <mcbp/protocol/response.h>
 #include <mcbp/protocol/status.h>
+#include <memcached/engine_common.h>
 #include <nlohmann/json_fwd.hpp>
 #include <platform/thread.h>
+#include <utilities/hdrhistogram.h>
 #include <chrono>
 #include <gsl/gsl>
 #include <mutex>
 #include <queue>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -39,11 +42,17 @@ class StartSaslAuthTask;
  * frontend threads, which could cause deadlocks. To avoid locking
  * problems we're using a dedicated thread to communicate with the
  * other threads.
+ *
+ * All of the requests queued are sent to the provider without waiting
+ * for the previous ones to complete, and requests for the same
+ * credentials as a request already sent wait for the result of that
+ * request instead of being sent again. The results may be cached for
+ * a while (see setResultCacheTtl()) so that reconnecting clients don't
+ * need a round trip to the provider.
  */
 class ExternalAuthManagerThread : public Couchbase::Thread {
 public:
-    ExternalAuthManagerThread() : Couchbase::Thread("mcd:ext_auth") {
-    }
+    ExternalAuthManagerThread();
     ExternalAuthManagerThread(const ExternalAuthManagerThread&) = delete;
 
     /**
@@ -102,8 +111,27 @@ public:
         condition_variable.notify_one();
     }
 
+    /**
+     * Set the time the results from the authentication provider may be
+     * reused for the same credentials (0 disables the caching)
+     *
+     * @param positive the time to cache successful authentications
+     * @param negative the time to cache unknown users and failed
+     *                 authentications
+     */
+    void setResultCacheTtl(std::chrono::microseconds positive,
+                           std::chrono::microseconds negative);
+
+    /**
+     * Drop the cached results and make sure that the authentication
+     * provider is asked for a new RBAC entry for entries older than
+     * the provided time point
+     */
     void setRbacCacheEpoch(std::chrono::steady_clock::time_point tp);
 
+    /// Add the statistics for the external authentication
+    void addStats(const AddStatFn& add_stat, const void* cookie);
+
 protected:
     /// The main loop of the thread
     void run() override;
@@ -128,20 +156,83 @@ protected:
     /// Push the list of active users to the authentication provider
     void pushActiveUsers();
 
+    /// Get the key for the credentials of a request in the result cache
+    std::string getCacheKey(const StartSaslAuthTask& request) const;
+
+    /**
+     * Look up the result for a request in the cache and queue the
+     * response for the request if it is found
+     *
+     * @return true if the request was served from the cache
+     */
+    bool serveFromCache(StartSaslAuthTask& request, const std::string& key);
+
+    /// Cache the result from the authentication provider (if allowed)
+    void cacheResult(const std::string& key,
+                     cb::mcbp::Status status,
+                     const std::string& payload);
+
     /// Let the daemon thread run as long as this member is set to true
     bool running = true;
 
     /// The next value to use in the opaque field
     uint32_t next = 0;
 
-    /// The map between the opaque field being used and the SaslAuthTask
+    struct OutstandingRequest {
+        /// The provider the request was sent to (nullptr if it wasn't sent
+        /// or the provider is gone). When we remove a connection we can
+        /// iterate over the entire map and create aborts for the ones we
+        /// don't have anymore (or we could redistribute them O:)
+        Connection* provider = nullptr;
+        /// The tasks waiting for the result
+        std::vector<StartSaslAuthTask*> tasks;
+        /// The key for the result in the cache (empty if the result
+        /// shouldn't be cached)
+        std::string cacheKey;
+        /// When the request was sent to the provider
+        std::chrono::steady_clock::time_point sent;
+    };
+
+    /// The map between the opaque field being used and the SaslAuthTasks
     /// requested the operation
-    /// Second should be a std pair of a connection and a task, so that
-    /// when we remove a connection we can iterate over the entire
-    /// map and create aborts for the one we don't have anymore (or
-    /// we could redistribute them O:)
-    std::unordered_map<uint32_t, std::pair<Connection*, StartSaslAuthTask*>>
-            requestMap;
+    std::unordered_map<uint32_t, OutstandingRequest> requestMap;
+
+    /// The opaque of the request sent to the provider for each of the
+    /// cache keys, so that requests for the same credentials as an
+    /// outstanding request may wait for its result
+    std::unordered_map<std::string, uint32_t> inflight;
+
+    struct CachedResult {
+        cb::mcbp::Status status;
+        std::string payload;
+        std::chrono::steady_clock::time_point expiry;
+    };
+
+    /// The results from the authentication provider, keyed by the cache
+    /// key of the credentials
+    std::unordered_map<std::string, CachedResult> resultCache;
+
+    /// The maximum number of entries in the result cache
+    static const size_t maxCachedResults = 10000;
+
+    /// The (random) key used to hash the credentials in the cache keys
+    std::string cacheKeySalt;
+
+    std::chrono::microseconds positiveCacheTtl{0};
+    std::chrono::microseconds negativeCacheTtl{0};
+
+    struct {
+        /// The number of requests sent to the authentication provider
+        uint64_t requests = 0;
+        /// The number of requests waiting for an identical request
+        uint64_t coalesced = 0;
+        /// The number of requests served from the result cache
+        uint64_t cacheHits = 0;
+        uint64_t negativeCacheHits = 0;
+    } counters;
+
+    /// The time it took for the provider to respond to the requests
+    Hdr1sfMicroSecHistogram providerLatency;
 
     /// The mutex variable used to protect access to _all_ the internal
     /// members
@@ -171,6 +262,11 @@ protected:
               status(cb::mcbp::Status::Etmpfail),
               payload(std::move(payload)) {
         }
+        AuthResponse(uint32_t opaque,
+                     cb::mcbp::Status status,
+                     std::string payload)
+            : opaque(opaque), status(status), payload(std::move(payload)) {
+        }
         AuthResponse(uint32_t opaque,
                      cb::mcbp::Status status,
                      cb::const_byte_buffer value)
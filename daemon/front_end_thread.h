@@ -17,13 +17,18 @@
 
 #pragma once
 
-#include <JSON_checker.h>
+#include "connection_scheduler.h"
+#include "subdocument_lookup_cache.h"
+
 #include <event.h>
 #include <memcached/engine_error.h>
 #include <platform/platform_thread.h>
 #include <platform/socket.h>
 #include <subdoc/operations.h>
+#include <utilities/json_validator.h>
 
+#include <atomic>
+#include <memory>
 #include <mutex>
 #include <queue>
 #include <unordered_map>
@@ -36,6 +41,7 @@ class Pipe;
 
 class Cookie;
 class Connection;
+class ServerSocket;
 struct thread_stats;
 
 using SharedListeningPort = std::shared_ptr<ListeningPort>;
@@ -65,6 +71,16 @@ struct FrontEndThread {
     /// listen event for notify pipe
     struct event notify_event = {};
 
+    /**
+     * Event activated when connections are added to the scheduler so
+     * that they're served (in the order selected by the scheduler) after
+     * the event library is done reporting the ready connections
+     */
+    struct event scheduler_event = {};
+
+    /// The ready connections waiting to be served (if qos scheduling)
+    ConnectionScheduler scheduler;
+
     /**
      * notification pipe.
      *
@@ -116,11 +132,43 @@ struct FrontEndThread {
     /// index of this thread in the threads array
     size_t index = 0;
 
-    /// Shared read buffer for all connections serviced by this thread.
-    std::unique_ptr<cb::Pipe> read;
+    /**
+     * A pool of network buffers shared by all connections serviced by
+     * this thread. A connection borrows a buffer while it has data in
+     * flight and returns it when the buffer is empty, so idle connections
+     * don't hold any buffers and busy connections don't churn the
+     * allocator.
+     */
+    class BufferPool {
+    public:
+        /// The maximum number of buffers kept in the pool
+        static const size_t MaxBuffers = 32;
+
+        /// Buffers bigger than this is freed instead of kept in the pool
+        static const size_t MaxBufferCapacity = 256 * 1024;
+
+        /// Get a buffer from the pool (nullptr if the pool is empty)
+        std::unique_ptr<cb::Pipe> pop();
+
+        /**
+         * Hand the (empty) buffer to the pool. The buffer will be freed
+         * if the pool is full or the buffer is too big to keep around.
+         */
+        void push(std::unique_ptr<cb::Pipe> buffer);
+
+        size_t size() const {
+            return buffers.size();
+        }
+
+    protected:
+        std::vector<std::unique_ptr<cb::Pipe>> buffers;
+    };
+
+    /// Shared read buffers for all connections serviced by this thread.
+    BufferPool read;
 
-    /// Shared write buffer for all connections serviced by this thread.
-    std::unique_ptr<cb::Pipe> write;
+    /// Shared write buffers for all connections serviced by this thread.
+    BufferPool write;
 
     /**
      * Shared sub-document operation for all connections serviced by this
@@ -128,16 +176,48 @@ struct FrontEndThread {
      */
     Subdoc::Operation subdoc_op;
 
+    /**
+     * The results of recent sub-document lookups for the documents
+     * accessed by the connections serviced by this thread
+     */
+    SubdocLookupCache subdoc_lookup_cache;
+
     /**
      * Shared validator used by all connections serviced by this thread
      * when they need to validate a JSON document
      */
-    JSON_checker::Validator validator;
+    cb::json::Validator validator;
 
     /// Is the thread running or not
     std::atomic_bool running{false};
+
+    /**
+     * Load information for this thread. The members are updated by the
+     * worker thread itself and read (without any locking) by the dispatcher
+     * when it selects the thread to serve a new connection.
+     */
+    struct {
+        /// The number of connections currently bound to this thread
+        std::atomic<size_t> connections{0};
+        /// The total number of nanoseconds spent serving connections
+        std::atomic<uint64_t> cpu_time{0};
+        /// The number of bytes queued for transmission by our connections
+        std::atomic<size_t> send_queue_size{0};
+    } load;
+
+    /**
+     * The listening sockets owned by this thread (only used when
+     * reuseport_listeners is enabled). Accepted clients is bound to
+     * this thread without involving the dispatcher.
+     */
+    std::vector<std::unique_ptr<ServerSocket>> listeners;
+
+    /// The generation of the published listeners we've applied
+    uint64_t listeners_generation = 0;
 };
 
 void notify_thread(FrontEndThread& thread);
 void notify_dispatcher();
+/// Notify all of the front end threads (not the dispatcher)
+void notify_worker_threads();
 void drain_notification_channel(evutil_socket_t fd);
\ No newline at end of file
@@ -21,6 +21,7 @@
 #include "connection.h"
 #include "connections.h"
 #include "cookie.h"
+#include "sampling_profiler.h"
 #include "tracing.h"
 #include "utilities/string_utilities.h"
 #include <logger/logger.h>
@@ -142,7 +143,9 @@ static const std::unordered_map<std::string, GetCallbackFunc> ioctl_get_map{
         {"trace.dump.begin", ioctlGetTracingBeginDump},
         {"trace.dump.chunk", ioctlGetTracingDumpChunk},
         {"sla", ioctlGetMcbpSla},
-        {"rbac.db.dump", ioctlRbacDbDump}};
+        {"rbac.db.dump", ioctlRbacDbDump},
+        {"profiler.status", ioctlGetProfilerStatus},
+        {"profiler.dump", ioctlGetProfilerDump}};
 
 ENGINE_ERROR_CODE ioctl_get_property(Cookie& cookie,
                                      const std::string& key,
@@ -190,7 +193,9 @@ static const std::unordered_map<std::string, SetCallbackFunc> ioctl_set_map{
         {"trace.start", ioctlSetTracingStart},
         {"trace.stop", ioctlSetTracingStop},
         {"trace.dump.clear", ioctlSetTracingClearDump},
-        {"sla", ioctlSetMcbpSla}};
+        {"sla", ioctlSetMcbpSla},
+        {"profiler.start", ioctlSetProfilerStart},
+        {"profiler.stop", ioctlSetProfilerStop}};
 
 ENGINE_ERROR_CODE ioctl_set_property(Cookie& cookie,
                                      const std::string& key,
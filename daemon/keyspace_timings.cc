@@ -0,0 +1,288 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "keyspace_timings.h"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace cb {
+
+const double LatencySketch::Gamma =
+        (1 + LatencySketch::RelativeAccuracy) /
+        (1 - LatencySketch::RelativeAccuracy);
+
+static const double inverseLogGamma = 1 / std::log(LatencySketch::Gamma);
+
+/// The upper bound (in microseconds) of the values counted in the bucket
+static double getUpperBound(size_t index) {
+    return std::pow(LatencySketch::Gamma, double(index));
+}
+
+void LatencySketch::add(std::chrono::nanoseconds value) {
+    const double usec = value.count() / 1000.0;
+    size_t index = 0;
+    if (usec > 1) {
+        index = std::min(size_t(std::ceil(std::log(usec) * inverseLogGamma)),
+                         NumBuckets - 1);
+    }
+    ++buckets[index];
+    ++count;
+}
+
+std::chrono::microseconds LatencySketch::getPercentile(
+        double percentile) const {
+    const auto total = getCount();
+    if (total == 0) {
+        return std::chrono::microseconds{0};
+    }
+    // The rank of the value requested (at least the first value)
+    const auto rank = std::max(uint64_t(1),
+                               uint64_t(std::ceil(total * percentile / 100)));
+    uint64_t cumulative = 0;
+    for (size_t ii = 0; ii < NumBuckets; ++ii) {
+        cumulative += buckets[ii].load();
+        if (cumulative >= rank) {
+            if (ii == 0) {
+                return std::chrono::microseconds{1};
+            }
+            // The value within (Gamma^(i-1), Gamma^i] with the smallest
+            // relative error to either bound
+            return std::chrono::microseconds(uint64_t(
+                    std::llround(2 * getUpperBound(ii) / (Gamma + 1))));
+        }
+    }
+    // Values were added while we were reading the buckets
+    return std::chrono::microseconds(
+            uint64_t(std::llround(getUpperBound(NumBuckets - 1))));
+}
+
+nlohmann::json LatencySketch::to_json() const {
+    std::array<uint64_t, NumBuckets> counts;
+    uint64_t total = 0;
+    for (size_t ii = 0; ii < NumBuckets; ++ii) {
+        counts[ii] = buckets[ii].load();
+        total += counts[ii];
+    }
+
+    nlohmann::json data = nlohmann::json::array();
+    uint64_t cumulative = 0;
+    for (size_t ii = 0; ii < NumBuckets; ++ii) {
+        if (counts[ii] == 0) {
+            continue;
+        }
+        cumulative += counts[ii];
+        data.push_back({uint64_t(std::ceil(getUpperBound(ii))),
+                        counts[ii],
+                        100.0 * cumulative / total});
+    }
+
+    nlohmann::json json;
+    json["total"] = total;
+    json["bucketsLow"] = 0;
+    json["data"] = data;
+    return json;
+}
+
+void LatencySketch::reset() {
+    for (auto& bucket : buckets) {
+        bucket.store(0);
+    }
+    count.store(0);
+}
+
+KeyspaceTimings::~KeyspaceTimings() {
+    clear();
+}
+
+bool KeyspaceTimings::isDocumentOpcode(cb::mcbp::ClientOpcode opcode) {
+    using cb::mcbp::ClientOpcode;
+    switch (opcode) {
+    case ClientOpcode::Get:
+    case ClientOpcode::Getq:
+    case ClientOpcode::Getk:
+    case ClientOpcode::Getkq:
+    case ClientOpcode::Set:
+    case ClientOpcode::Setq:
+    case ClientOpcode::Add:
+    case ClientOpcode::Addq:
+    case ClientOpcode::Replace:
+    case ClientOpcode::Replaceq:
+    case ClientOpcode::Delete:
+    case ClientOpcode::Deleteq:
+    case ClientOpcode::Increment:
+    case ClientOpcode::Incrementq:
+    case ClientOpcode::Decrement:
+    case ClientOpcode::Decrementq:
+    case ClientOpcode::Append:
+    case ClientOpcode::Appendq:
+    case ClientOpcode::Prepend:
+    case ClientOpcode::Prependq:
+    case ClientOpcode::Touch:
+    case ClientOpcode::Gat:
+    case ClientOpcode::Gatq:
+    case ClientOpcode::GetReplica:
+    case ClientOpcode::GetLocked:
+    case ClientOpcode::UnlockKey:
+    case ClientOpcode::EvictKey:
+    case ClientOpcode::GetMeta:
+    case ClientOpcode::GetqMeta:
+    case ClientOpcode::SetWithMeta:
+    case ClientOpcode::SetqWithMeta:
+    case ClientOpcode::AddWithMeta:
+    case ClientOpcode::AddqWithMeta:
+    case ClientOpcode::DelWithMeta:
+    case ClientOpcode::DelqWithMeta:
+    case ClientOpcode::ReturnMeta:
+    case ClientOpcode::SubdocGet:
+    case ClientOpcode::SubdocExists:
+    case ClientOpcode::SubdocDictAdd:
+    case ClientOpcode::SubdocDictUpsert:
+    case ClientOpcode::SubdocDelete:
+    case ClientOpcode::SubdocReplace:
+    case ClientOpcode::SubdocArrayPushLast:
+    case ClientOpcode::SubdocArrayPushFirst:
+    case ClientOpcode::SubdocArrayInsert:
+    case ClientOpcode::SubdocArrayAddUnique:
+    case ClientOpcode::SubdocCounter:
+    case ClientOpcode::SubdocMultiLookup:
+    case ClientOpcode::SubdocMultiMutation:
+    case ClientOpcode::SubdocGetCount:
+        return true;
+    default:
+        return false;
+    }
+}
+
+LatencySketch& KeyspaceTimings::getOrCreate(
+        std::atomic<LatencySketch*>& slot) {
+    auto* sketch = slot.load(std::memory_order_acquire);
+    if (sketch == nullptr) {
+        auto* created = new LatencySketch();
+        if (slot.compare_exchange_strong(sketch, created)) {
+            sketch = created;
+        } else {
+            // Another thread beat us to it; sketch now holds its sketch
+            delete created;
+        }
+    }
+    return *sketch;
+}
+
+void KeyspaceTimings::collect(Vbid vbid,
+                              CollectionID cid,
+                              std::chrono::nanoseconds elapsed) {
+    if (vbid.get() < MaxVBuckets) {
+        getOrCreate(vbuckets[vbid.get()]).add(elapsed);
+    }
+
+    const CollectionIDType id = cid;
+    if (id == Unused) {
+        return;
+    }
+    const auto start = std::hash<CollectionIDType>()(id) % MaxCollections;
+    for (size_t ii = 0; ii < MaxCollections; ++ii) {
+        auto& entry = collections[(start + ii) % MaxCollections];
+        auto current = entry.cid.load(std::memory_order_acquire);
+        if (current == Unused &&
+            entry.cid.compare_exchange_strong(current, id)) {
+            current = id;
+        }
+        // If we lost the race for a free entry, it may have been to a
+        // thread claiming it for this collection
+        if (current == id) {
+            getOrCreate(entry.sketch).add(elapsed);
+            return;
+        }
+    }
+    // The table is full; the collection isn't tracked
+}
+
+const LatencySketch* KeyspaceTimings::getVBucket(Vbid vbid) const {
+    if (vbid.get() >= MaxVBuckets) {
+        return nullptr;
+    }
+    return vbuckets[vbid.get()].load(std::memory_order_acquire);
+}
+
+const LatencySketch* KeyspaceTimings::getCollection(CollectionID cid) const {
+    const CollectionIDType id = cid;
+    const auto start = std::hash<CollectionIDType>()(id) % MaxCollections;
+    for (size_t ii = 0; ii < MaxCollections; ++ii) {
+        const auto& entry = collections[(start + ii) % MaxCollections];
+        const auto current = entry.cid.load(std::memory_order_acquire);
+        if (current == Unused) {
+            return nullptr;
+        }
+        if (current == id) {
+            return entry.sketch.load(std::memory_order_acquire);
+        }
+    }
+    return nullptr;
+}
+
+void KeyspaceTimings::forEachVBucket(
+        const std::function<void(Vbid, const LatencySketch&)>& callback)
+        const {
+    for (size_t ii = 0; ii < MaxVBuckets; ++ii) {
+        const auto* sketch = vbuckets[ii].load(std::memory_order_acquire);
+        if (sketch) {
+            callback(Vbid(uint16_t(ii)), *sketch);
+        }
+    }
+}
+
+void KeyspaceTimings::forEachCollection(
+        const std::function<void(CollectionID, const LatencySketch&)>&
+                callback) const {
+    for (const auto& entry : collections) {
+        const auto id = entry.cid.load(std::memory_order_acquire);
+        const auto* sketch = entry.sketch.load(std::memory_order_acquire);
+        if (id != Unused && sketch) {
+            callback(CollectionID(id, CollectionID::SkipIDVerificationTag{}),
+                     *sketch);
+        }
+    }
+}
+
+void KeyspaceTimings::reset() {
+    for (auto& slot : vbuckets) {
+        auto* sketch = slot.load(std::memory_order_acquire);
+        if (sketch) {
+            sketch->reset();
+        }
+    }
+    for (auto& entry : collections) {
+        auto* sketch = entry.sketch.load(std::memory_order_acquire);
+        if (sketch) {
+            sketch->reset();
+        }
+    }
+}
+
+void KeyspaceTimings::clear() {
+    for (auto& slot : vbuckets) {
+        delete slot.exchange(nullptr);
+    }
+    for (auto& entry : collections) {
+        delete entry.sketch.exchange(nullptr);
+        entry.cid.store(Unused);
+    }
+}
+
+} // namespace cb
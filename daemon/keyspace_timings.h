@@ -0,0 +1,166 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <mcbp/protocol/opcode.h>
+#include <memcached/dockey.h>
+#include <memcached/vbucket.h>
+#include <nlohmann/json_fwd.hpp>
+#include <relaxed_atomic.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+namespace cb {
+
+/**
+ * A DDSketch style latency sketch: the values are counted in buckets whose
+ * bounds grow geometrically (by Gamma), so any quantile is estimated with a
+ * relative error of at most RelativeAccuracy while the sketch has a small
+ * fixed size (unlike a HdrHistogram it does not need to be sized for the
+ * range of values up front). Values are recorded in microseconds; values
+ * beyond the last bucket (~200s) are counted in it.
+ *
+ * Recording is lock-free and may happen from any number of threads.
+ */
+class LatencySketch {
+public:
+    /// The maximum relative error of the quantiles estimated
+    static constexpr double RelativeAccuracy = 0.05;
+
+    /// (1 + RelativeAccuracy) / (1 - RelativeAccuracy)
+    static const double Gamma;
+
+    /// Bucket i counts the values in (Gamma^(i-1), Gamma^i] microseconds
+    static constexpr size_t NumBuckets = 192;
+
+    void add(std::chrono::nanoseconds value);
+
+    uint64_t getCount() const {
+        return count.load();
+    }
+
+    /**
+     * Estimate the value at the given percentile
+     *
+     * @param percentile in the range [0, 100]
+     * @return the estimate, or zero if nothing has been recorded
+     */
+    std::chrono::microseconds getPercentile(double percentile) const;
+
+    /**
+     * Get the sketch in the JSON format of HdrHistogram::to_json (as
+     * understood by mctimings): {"total", "bucketsLow", "data"} where data
+     * holds [upper bound (us), count, cumulative percentile] for each
+     * bucket which isn't empty.
+     */
+    nlohmann::json to_json() const;
+
+    void reset();
+
+private:
+    std::array<cb::RelaxedAtomic<uint64_t>, NumBuckets> buckets{};
+    cb::RelaxedAtomic<uint64_t> count{0};
+};
+
+/**
+ * The optional (keyspace_timings setting) per-vbucket and per-collection
+ * latency of the document operations executed against a bucket, used to
+ * find the vbuckets or collections which are hot or slow (e.g. one being
+ * compacted). The sketches are allocated the first time a vbucket or
+ * collection is used, and both sets are bounded: vbuckets above MaxVBuckets
+ * and collections beyond the first MaxCollections seen are not tracked.
+ * That bounds the memory used to ~3MB per bucket.
+ */
+class KeyspaceTimings {
+public:
+    /// The vbuckets tracked are [0, MaxVBuckets)
+    static constexpr size_t MaxVBuckets = 1024;
+
+    /// The number of distinct collections tracked
+    static constexpr size_t MaxCollections = 1024;
+
+    KeyspaceTimings() = default;
+    KeyspaceTimings(const KeyspaceTimings&) = delete;
+    ~KeyspaceTimings();
+
+    /**
+     * Is the opcode operating on a single document (in a vbucket and a
+     * collection)? Only those opcodes are recorded.
+     */
+    static bool isDocumentOpcode(cb::mcbp::ClientOpcode opcode);
+
+    /**
+     * Record the time a document operation took
+     *
+     * @param vbid the vbucket of the document
+     * @param cid the collection of the document
+     * @param elapsed the time the operation took
+     */
+    void collect(Vbid vbid, CollectionID cid, std::chrono::nanoseconds elapsed);
+
+    /// Get the sketch of the vbucket, or nullptr if it hasn't been used
+    const LatencySketch* getVBucket(Vbid vbid) const;
+
+    /// Get the sketch of the collection, or nullptr if it hasn't been used
+    const LatencySketch* getCollection(CollectionID cid) const;
+
+    /// Call the callback for each vbucket recorded (in vbucket order)
+    void forEachVBucket(
+            const std::function<void(Vbid, const LatencySketch&)>& callback)
+            const;
+
+    /// Call the callback for each collection recorded
+    void forEachCollection(
+            const std::function<void(CollectionID, const LatencySketch&)>&
+                    callback) const;
+
+    /**
+     * Clear the values recorded. The sketches (and the collections they
+     * belong to) are kept, as other threads may be recording into them.
+     */
+    void reset();
+
+    /**
+     * Release all of the sketches. Must only be called when no other
+     * thread may be recording (i.e. the bucket is being deleted).
+     */
+    void clear();
+
+private:
+    /// The cid of a free CollectionEntry (not a valid collection id)
+    static constexpr CollectionIDType Unused = CollectionIDType(-1);
+
+    struct CollectionEntry {
+        /// The collection owning the entry, or Unused
+        std::atomic<CollectionIDType> cid{Unused};
+        std::atomic<LatencySketch*> sketch{nullptr};
+    };
+
+    /// Get (or allocate) the sketch stored in the slot
+    static LatencySketch& getOrCreate(std::atomic<LatencySketch*>& slot);
+
+    std::array<std::atomic<LatencySketch*>, MaxVBuckets> vbuckets{};
+
+    /// Open addressed hash table of the collections (never shrinks)
+    std::array<CollectionEntry, MaxCollections> collections;
+};
+
+} // namespace cb
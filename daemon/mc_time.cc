@@ -256,6 +256,10 @@ void mc_time_clock_tick(void) {
 
     // check on tasks to be made runnable in the future
     executorPool->clockTick();
+    if (saslExecutorPool) {
+        // Not created by all of the programs using the clock (unit tests)
+        saslExecutorPool->clockTick();
+    }
 }
 
 static void mc_gather_timing_samples(void) {
@@ -263,4 +267,21 @@ static void mc_gather_timing_samples(void) {
         bucket.timings.sample(std::chrono::seconds(1));
         return true;
     }, nullptr);
+
+    // Merging the histograms of all of the threads is too expensive to
+    // do every tick
+    static int ticks = 0;
+    if (++ticks < 10) {
+        return;
+    }
+    ticks = 0;
+    const auto percentile = settings.getSlowOpPercentile();
+    bucketsForEach(
+            [percentile](Bucket& bucket, void*) -> bool {
+                bucket.slowOpThresholds.update(bucket.timings,
+                                               percentile,
+                                               std::chrono::microseconds(100));
+                return true;
+            },
+            nullptr);
 }
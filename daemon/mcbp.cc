@@ -21,6 +21,8 @@
 #include "cookie_trace_context.h"
 #include "memcached.h"
 #include "opentracing.h"
+#include "request_log.h"
+#include "runtime.h"
 #include "settings.h"
 #include "utilities/logtags.h"
 #include "xattr/utils.h"
@@ -260,7 +262,13 @@ void mcbp_collect_timings(Cookie& cookie) {
     cookie.getTracer().end(cb::tracing::TraceCode::REQUEST, endTime);
 
     // aggregated timing for all buckets
-    all_buckets[0].timings.collect(opcode, elapsed);
+    const auto thread = c->getThread()->index;
+    const auto execution = cookie.getExecutionTime();
+    const auto blocked = cookie.getBlockedTime();
+    const auto allocated = cookie.getAllocatedBytes();
+    all_buckets[0].timings.collect(opcode, elapsed, thread);
+    all_buckets[0].timings.collectCost(
+            opcode, execution, blocked, allocated, thread);
 
     // timing for current bucket
     const auto bucketid = c->getBucketIndex();
@@ -269,12 +277,44 @@ void mcbp_collect_timings(Cookie& cookie) {
      * to delete the bucket you're associated with and your're idle.
      */
     if (bucketid != 0) {
-        all_buckets[bucketid].timings.collect(opcode, elapsed);
+        all_buckets[bucketid].timings.collect(opcode, elapsed, thread);
+        all_buckets[bucketid].timings.collectCost(
+                opcode, execution, blocked, allocated, thread);
+
+        if (settings.isKeyspaceTimingsEnabled() &&
+            cb::KeyspaceTimings::isDocumentOpcode(opcode)) {
+            const auto& request = header.getRequest();
+            CollectionID cid;
+            try {
+                cid = cookie.getRequestKey().getCollectionID();
+            } catch (const std::exception&) {
+                // The request failed validation; count it against the vbucket
+                // and the default collection
+            }
+            all_buckets[bucketid].keyspaceTimings.collect(
+                    request.getVBucket(), cid, elapsed);
+        }
     }
 
     // Log operations taking longer than the "slow" threshold for the opcode.
     cookie.maybeLogSlowCommand(elapsed);
 
+    if (thread < request_logs.size()) {
+        using std::chrono::duration_cast;
+        using std::chrono::microseconds;
+        cb::RequestRecord record;
+        record.end = endTime;
+        record.duration = duration_cast<microseconds>(elapsed);
+        record.blocked = duration_cast<microseconds>(cookie.getBlockedTime());
+        record.connectionId = c->getId();
+        record.opaque = header.getOpaque();
+        record.bodylen = header.getBodylen();
+        record.bucket = uint16_t(bucketid);
+        record.opcode = opcode;
+        record.blockedCount = cookie.getBlockedCount();
+        request_logs[thread]->record(record);
+    }
+
     if (cookie.isOpenTracingEnabled()) {
         OpenTracing::pushTraceLog(cookie.extractTraceContext());
     }
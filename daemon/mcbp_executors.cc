@@ -24,8 +24,10 @@
 #include "mc_time.h"
 #include "mcaudit.h"
 #include "mcbp.h"
+#include "mcbp_opcode_descriptor.h"
 #include "mcbp_privileges.h"
 #include "mcbp_topkeys.h"
+#include "mcbp_validators.h"
 #include "protocol/mcbp/appendprepend_context.h"
 #include "protocol/mcbp/arithmetic_context.h"
 #include "protocol/mcbp/audit_configure_context.h"
@@ -33,6 +35,7 @@
 #include "protocol/mcbp/dcp_deletion.h"
 #include "protocol/mcbp/dcp_expiration.h"
 #include "protocol/mcbp/dcp_mutation.h"
+#include "protocol/mcbp/dcp_stream_req_multi_context.h"
 #include "protocol/mcbp/dcp_system_event_executor.h"
 #include "protocol/mcbp/engine_wrapper.h"
 #include "protocol/mcbp/executors.h"
@@ -91,6 +94,10 @@ static void unlock_executor(Cookie& cookie) {
     cookie.obtainContext<UnlockCommandContext>(cookie).drive();
 }
 
+static void dcp_stream_req_multi_executor(Cookie& cookie) {
+    cookie.obtainContext<DcpStreamReqMultiCommandContext>(cookie).drive();
+}
+
 static void gat_executor(Cookie& cookie) {
     cookie.obtainContext<GatCommandContext>(cookie).drive();
 }
@@ -107,9 +114,11 @@ using HandlerFunction = std::function<void(Cookie&)>;
 
 /**
  * A map between the request packets op-code and the function to handle
- * the request message
+ * the request message (copied into the opcode descriptors)
  */
-std::array<HandlerFunction, 0x100> handlers;
+static std::array<McbpOpcodeDescriptor::Executor, 0x100> handlers;
+
+std::array<McbpOpcodeDescriptor, 0x100> mcbpOpcodeDescriptors;
 
 /**
  * A map between the response packets op-code and the function to handle
@@ -599,9 +608,55 @@ static void setup_response_handler(cb::mcbp::ClientOpcode opcode,
 }
 
 static void setup_handler(cb::mcbp::ClientOpcode opcode,
-                          HandlerFunction function) {
+                          McbpOpcodeDescriptor::Executor function) {
     handlers[std::underlying_type<cb::mcbp::ClientOpcode>::type(opcode)] =
-            std::move(function);
+            function;
+}
+
+/// Does the command modify a document
+static bool is_mutation(cb::mcbp::ClientOpcode opcode) {
+    using cb::mcbp::ClientOpcode;
+    switch (opcode) {
+    case ClientOpcode::Setq:
+    case ClientOpcode::Addq:
+    case ClientOpcode::Replaceq:
+    case ClientOpcode::Deleteq:
+    case ClientOpcode::Incrementq:
+    case ClientOpcode::Decrementq:
+    case ClientOpcode::Appendq:
+    case ClientOpcode::Prependq:
+    case ClientOpcode::Gatq:
+        // The quiet commands don't accept durability requirements
+        return true;
+    default:
+        return McbpValidator::isDurabilitySupported(opcode);
+    }
+}
+
+/**
+ * Populate the opcode descriptors from the validators, the privilege
+ * chains and the executors so that the front end threads only need
+ * a single lookup per request
+ */
+static void initialize_opcode_descriptors() {
+    McbpValidator validator;
+    McbpPrivilegeChains privilegeChains;
+
+    for (size_t ii = 0; ii < mcbpOpcodeDescriptors.size(); ++ii) {
+        const auto opcode = cb::mcbp::ClientOpcode(ii);
+        auto& descriptor = mcbpOpcodeDescriptors[ii];
+        descriptor = McbpOpcodeDescriptor{};
+        descriptor.executor = handlers[ii];
+        if (!cb::mcbp::is_valid_opcode(opcode)) {
+            continue;
+        }
+        descriptor.valid = true;
+        descriptor.reorder = cb::mcbp::is_reorder_supported(opcode);
+        descriptor.durability = McbpValidator::isDurabilitySupported(opcode);
+        descriptor.mutation = is_mutation(opcode);
+        descriptor.validator = validator.getValidator(opcode);
+        descriptor.privileges = privilegeChains.getChain(opcode);
+    }
 }
 
 void initialize_mbcp_lookup_map() {
@@ -674,6 +729,8 @@ void initialize_mbcp_lookup_map() {
                   dcp_seqno_acknowledged_executor);
     setup_handler(cb::mcbp::ClientOpcode::DcpCommit, dcp_commit_executor);
     setup_handler(cb::mcbp::ClientOpcode::DcpAbort, dcp_abort_executor);
+    setup_handler(cb::mcbp::ClientOpcode::DcpStreamReqMulti,
+                  dcp_stream_req_multi_executor);
 
     setup_handler(cb::mcbp::ClientOpcode::CollectionsSetManifest,
                   collections_set_manifest_executor);
@@ -800,16 +857,17 @@ void initialize_mbcp_lookup_map() {
 
     setup_handler(cb::mcbp::ClientOpcode::AdjustTimeofday,
                   adjust_timeofday_executor);
+
+    initialize_opcode_descriptors();
 }
 
 void execute_client_request_packet(Cookie& cookie,
                                    const cb::mcbp::Request& request) {
     auto* c = &cookie.getConnection();
 
-    static McbpPrivilegeChains privilegeChains;
-
     const auto opcode = request.getClientOpcode();
-    const auto res = privilegeChains.invoke(opcode, cookie);
+    const auto& descriptor = getMcbpOpcodeDescriptor(opcode);
+    const auto res = descriptor.checkPrivileges(cookie);
     switch (res) {
     case cb::rbac::PrivilegeAccess::Fail:
         LOG_WARNING("{} {}: no access to command {}",
@@ -825,8 +883,7 @@ void execute_client_request_packet(Cookie& cookie,
         }
         return;
     case cb::rbac::PrivilegeAccess::Ok:
-        handlers[std::underlying_type<cb::mcbp::ClientOpcode>::type(opcode)](
-                cookie);
+        descriptor.executor(cookie);
         return;
     case cb::rbac::PrivilegeAccess::Stale:
         if (c->remapErrorCode(ENGINE_AUTH_STALE) == ENGINE_DISCONNECT) {
@@ -891,6 +948,7 @@ static void execute_server_response_packet(Cookie& cookie,
     switch (response.getServerOpcode()) {
     case cb::mcbp::ServerOpcode::ClustermapChangeNotification:
     case cb::mcbp::ServerOpcode::ActiveExternalUsers:
+    case cb::mcbp::ServerOpcode::StatsPush:
         // ignore
         return;
     case cb::mcbp::ServerOpcode::Authenticate:
@@ -0,0 +1,104 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <mcbp/protocol/opcode.h>
+#include <mcbp/protocol/status.h>
+#include <memcached/rbac.h>
+#include <array>
+#include <cstddef>
+
+class Cookie;
+
+/**
+ * Everything the front end threads need to know about a client opcode
+ * to validate, check the access for and execute a request, so that the
+ * hot path only needs a single lookup into one table (instead of
+ * consulting the validators, the privilege chains and the executors
+ * separately).
+ *
+ * All of the callbacks are plain function pointers (the table is
+ * populated from the validators, privilege chains and executors by
+ * initialize_mbcp_lookup_map()).
+ */
+struct McbpOpcodeDescriptor {
+    using Validator = cb::mcbp::Status (*)(Cookie&);
+    using PrivilegeCheck = cb::rbac::PrivilegeAccess (*)(Cookie&);
+    using Executor = void (*)(Cookie&);
+
+    /// The maximum number of privilege checks for a single opcode
+    static const size_t MaxPrivilegeChecks = 4;
+
+    /**
+     * Validate the request
+     *
+     * @return UnknownCommand for opcodes without a validator
+     */
+    cb::mcbp::Status validate(Cookie& cookie) const {
+        if (validator == nullptr) {
+            return cb::mcbp::Status::UnknownCommand;
+        }
+        return validator(cookie);
+    }
+
+    /**
+     * Run the privilege checks for the request, stopping at the first
+     * check which doesn't return Ok. An opcode without any checks fails
+     * (so that we don't forget to add the rules for new commands)
+     */
+    cb::rbac::PrivilegeAccess checkPrivileges(Cookie& cookie) const {
+        if (privileges[0] == nullptr) {
+            return cb::rbac::PrivilegeAccess::Fail;
+        }
+        for (const auto& check : privileges) {
+            if (check == nullptr) {
+                break;
+            }
+            const auto ret = check(cookie);
+            if (ret != cb::rbac::PrivilegeAccess::Ok) {
+                return ret;
+            }
+        }
+        return cb::rbac::PrivilegeAccess::Ok;
+    }
+
+    /// Is the opcode a known client opcode
+    bool valid = false;
+    /// Does the server support reordering of the command
+    bool reorder = false;
+    /// Does the command support durability requirements
+    bool durability = false;
+    /// Does the command modify a document
+    bool mutation = false;
+
+    Validator validator = nullptr;
+    /// The privilege checks to run (terminated by the first nullptr)
+    std::array<PrivilegeCheck, MaxPrivilegeChecks> privileges{};
+    Executor executor = nullptr;
+};
+
+/// The descriptors for all of the client opcodes, indexed by the opcode
+extern std::array<McbpOpcodeDescriptor, 0x100> mcbpOpcodeDescriptors;
+
+/**
+ * Get the descriptor for the given client opcode. Only valid after
+ * initialize_mbcp_lookup_map() is called.
+ */
+inline const McbpOpcodeDescriptor& getMcbpOpcodeDescriptor(
+        cb::mcbp::ClientOpcode opcode) {
+    return mcbpOpcodeDescriptors[uint8_t(opcode)];
+}
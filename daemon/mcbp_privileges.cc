@@ -17,41 +17,44 @@
 #include "mcbp_privileges.h"
 
 #include "connection.h"
-#include <logger/logger.h>
 #include <memcached/protocol_binary.h>
+#include <stdexcept>
+#include <string>
 
 using namespace cb::rbac;
 
 void McbpPrivilegeChains::setup(cb::mcbp::ClientOpcode command,
                                 cb::rbac::PrivilegeAccess (*f)(Cookie&)) {
-    commandChains[std::underlying_type<cb::mcbp::ClientOpcode>::type(command)]
-            .push_unique(makeFunction<cb::rbac::PrivilegeAccess,
-                                      cb::rbac::PrivilegeAccess::Ok,
-                                      Cookie&>(f));
+    for (auto& entry : commandChains[uint8_t(command)]) {
+        if (entry == f) {
+            return;
+        }
+        if (entry == nullptr) {
+            entry = f;
+            return;
+        }
+    }
+    throw std::logic_error(
+            "McbpPrivilegeChains::setup: Too many privilege checks for " +
+            to_string(command));
 }
 
 PrivilegeAccess McbpPrivilegeChains::invoke(cb::mcbp::ClientOpcode command,
                                             Cookie& cookie) {
-    auto& chain =
-            commandChains[std::underlying_type<cb::mcbp::ClientOpcode>::type(
-                    command)];
-    if (chain.empty()) {
+    const auto& chain = getChain(command);
+    if (chain[0] == nullptr) {
         return cb::rbac::PrivilegeAccess::Fail;
-    } else {
-        try {
-            return chain.invoke(cookie);
-        } catch (const std::bad_function_call&) {
-            LOG_WARNING(
-                    "{}: bad_function_call caught while evaluating access "
-                    "control for opcode: {:x}",
-                    cookie.getConnection().getId(),
-                    std::underlying_type<cb::mcbp::ClientOpcode>::type(
-                            command));
-            // Let the connection catch the exception and shut down the
-            // connection
-            throw;
+    }
+    for (const auto& check : chain) {
+        if (check == nullptr) {
+            break;
+        }
+        const auto ret = check(cookie);
+        if (ret != cb::rbac::PrivilegeAccess::Ok) {
+            return ret;
         }
     }
+    return cb::rbac::PrivilegeAccess::Ok;
 }
 
 template <Privilege T>
@@ -190,6 +193,8 @@ McbpPrivilegeChains::McbpPrivilegeChains() {
           require<Privilege::DcpProducer>);
     setup(cb::mcbp::ClientOpcode::DcpCommit, require<Privilege::DcpConsumer>);
     setup(cb::mcbp::ClientOpcode::DcpAbort, require<Privilege::DcpConsumer>);
+    setup(cb::mcbp::ClientOpcode::DcpStreamReqMulti,
+          require<Privilege::DcpProducer>);
     /* End DCP */
 
     setup(cb::mcbp::ClientOpcode::StopPersistence,
@@ -233,6 +238,9 @@ McbpPrivilegeChains::McbpPrivilegeChains() {
     setup(cb::mcbp::ClientOpcode::AddqWithMeta, require<Privilege::MetaWrite>);
     setup(cb::mcbp::ClientOpcode::DelWithMeta, require<Privilege::MetaWrite>);
     setup(cb::mcbp::ClientOpcode::DelqWithMeta, require<Privilege::MetaWrite>);
+    setup(cb::mcbp::ClientOpcode::GetMetaMulti, require<Privilege::MetaRead>);
+    setup(cb::mcbp::ClientOpcode::SetWithMetaMulti,
+          require<Privilege::MetaWrite>);
 
     /**
      * Command to create a new checkpoint on a given vbucket by force
@@ -264,6 +272,13 @@ McbpPrivilegeChains::McbpPrivilegeChains() {
      */
     setup(cb::mcbp::ClientOpcode::CompactDb,
           require<Privilege::NodeManagement>);
+    /**
+     * Commands to move a vbucket to another node as a file
+     */
+    setup(cb::mcbp::ClientOpcode::VbucketSnapshot,
+          require<Privilege::NodeManagement>);
+    setup(cb::mcbp::ClientOpcode::VbucketInstall,
+          require<Privilege::NodeManagement>);
     /**
      * Command to set cluster configuration
      */
@@ -284,6 +299,9 @@ McbpPrivilegeChains::McbpPrivilegeChains() {
      * Command to get all keys
      */
     setup(cb::mcbp::ClientOpcode::GetKeys, require<Privilege::Read>);
+    setup(cb::mcbp::ClientOpcode::RangeScan, require<Privilege::Read>);
+    setup(cb::mcbp::ClientOpcode::GetMulti, require<Privilege::Read>);
+    setup(cb::mcbp::ClientOpcode::SetMulti, require<Privilege::Upsert>);
     /**
      * Commands for GO-XDCR
      */
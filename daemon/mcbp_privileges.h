@@ -17,7 +17,7 @@
 #pragma once
 
 #include "cookie.h"
-#include "function_chain.h"
+#include "mcbp_opcode_descriptor.h"
 #include <mcbp/protocol/opcode.h>
 #include <memcached/rbac.h>
 #include <array>
@@ -49,16 +49,25 @@ public:
     cb::rbac::PrivilegeAccess invoke(cb::mcbp::ClientOpcode command,
                                      Cookie& cookie);
 
+    using Chain = std::array<McbpOpcodeDescriptor::PrivilegeCheck,
+                             McbpOpcodeDescriptor::MaxPrivilegeChecks>;
+
+    /**
+     * Get the chain for the command (to copy into the opcode descriptor).
+     * The chain is terminated by the first nullptr.
+     */
+    const Chain& getChain(cb::mcbp::ClientOpcode command) const {
+        return commandChains[uint8_t(command)];
+    }
+
 protected:
     /*
      * Silently ignores any attempt to push the same function onto the chain.
+     *
+     * @throws std::logic_error if the chain is full
      */
     void setup(cb::mcbp::ClientOpcode command,
                cb::rbac::PrivilegeAccess (*f)(Cookie&));
 
-    std::array<FunctionChain<cb::rbac::PrivilegeAccess,
-                             cb::rbac::PrivilegeAccess::Ok,
-                             Cookie&>,
-               0x100>
-            commandChains;
+    std::array<Chain, 0x100> commandChains{};
 };
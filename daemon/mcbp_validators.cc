@@ -112,6 +112,7 @@ static bool supportsDurability(cb::mcbp::ClientOpcode opcode) {
     case ClientOpcode::SubdocArrayAddUnique:
     case ClientOpcode::SubdocCounter:
     case ClientOpcode::SubdocMultiMutation:
+    case ClientOpcode::SetMulti:
         return true;
 
     case ClientOpcode::Get:
@@ -190,6 +191,7 @@ static bool supportsDurability(cb::mcbp::ClientOpcode opcode) {
     case ClientOpcode::DcpSeqnoAcknowledged:
     case ClientOpcode::DcpCommit:
     case ClientOpcode::DcpAbort:
+    case ClientOpcode::DcpStreamReqMulti:
     case ClientOpcode::StopPersistence:
     case ClientOpcode::StartPersistence:
     case ClientOpcode::SetParam:
@@ -240,6 +242,12 @@ static bool supportsDurability(cb::mcbp::ClientOpcode opcode) {
     case ClientOpcode::SubdocExists:
     case ClientOpcode::SubdocMultiLookup:
     case ClientOpcode::SubdocGetCount:
+    case ClientOpcode::RangeScan:
+    case ClientOpcode::GetMulti:
+    case ClientOpcode::GetMetaMulti:
+    case ClientOpcode::SetWithMetaMulti:
+    case ClientOpcode::VbucketSnapshot:
+    case ClientOpcode::VbucketInstall:
     case ClientOpcode::Scrub:
     case ClientOpcode::IsaslRefresh:
     case ClientOpcode::SslCertsRefresh:
@@ -260,6 +268,24 @@ static bool supportsDurability(cb::mcbp::ClientOpcode opcode) {
     throw std::runtime_error("supportsDurability: Unknown command");
 }
 
+/**
+ * The result of supportsDurability() for every opcode, computed once so the
+ * hot path is a single lookup
+ */
+static const std::array<bool, 0x100> durabilityOpcodes = []() {
+    std::array<bool, 0x100> ret{};
+    for (size_t ii = 0; ii < ret.size(); ++ii) {
+        const auto opcode = cb::mcbp::ClientOpcode(ii);
+        ret[ii] = cb::mcbp::is_valid_opcode(opcode) &&
+                  supportsDurability(opcode);
+    }
+    return ret;
+}();
+
+bool McbpValidator::isDurabilitySupported(ClientOpcode command) {
+    return durabilityOpcodes[uint8_t(command)];
+}
+
 using ExpectedKeyLen = McbpValidator::ExpectedKeyLen;
 using ExpectedValueLen = McbpValidator::ExpectedValueLen;
 using ExpectedCas = McbpValidator::ExpectedCas;
@@ -387,8 +413,13 @@ Status McbpValidator::verify_header(Cookie& cookie,
         return Status::Einval;
     }
 
-    // Validate the frame id's
+    // Validate the frame id's. Most requests don't carry any, so skip the
+    // parser (and the construction of the std::function wrapping the
+    // callback, which exceeds the small object buffer) for them.
     auto status = Status::Success;
+    if (request.getFramingExtraslen() == 0) {
+        return status;
+    }
     auto opcode = request.getClientOpcode();
 
     try {
@@ -408,7 +439,7 @@ Status McbpValidator::verify_header(Cookie& cookie,
             case cb::mcbp::request::FrameInfoId::DurabilityRequirement:
                 try {
                     cb::durability::Requirements req(data);
-                    if (!supportsDurability(opcode)) {
+                    if (!durabilityOpcodes[uint8_t(opcode)]) {
                         status = Status::Einval;
                         cookie.setErrorContext(
                                 R"(The requested command does not support durability requirements)");
@@ -713,6 +744,27 @@ static Status dcp_stream_req_validator(Cookie& cookie) {
     return verify_common_dcp_restrictions(cookie);
 }
 
+static Status dcp_stream_req_multi_validator(Cookie& cookie) {
+    auto status = McbpValidator::verify_header(cookie,
+                                               0,
+                                               ExpectedKeyLen::Zero,
+                                               ExpectedValueLen::NonZero,
+                                               ExpectedCas::Any,
+                                               PROTOCOL_BINARY_RAW_BYTES);
+    if (status != Status::Success) {
+        return status;
+    }
+
+    using cb::mcbp::request::DcpStreamReqMultiEntry;
+    const auto value = cookie.getHeader().getValue();
+    if (value.size() % sizeof(DcpStreamReqMultiEntry)) {
+        cookie.setErrorContext(
+                "Value must be an array of stream request entries");
+        return Status::Einval;
+    }
+    return verify_common_dcp_restrictions(cookie);
+}
+
 static Status dcp_stream_end_validator(Cookie& cookie) {
     auto status = McbpValidator::verify_header(
             cookie,
@@ -767,12 +819,12 @@ static Status dcp_system_event_validator(Cookie& cookie) {
     return verify_common_dcp_restrictions(cookie);
 }
 
-static bool is_valid_xattr_blob(const cb::mcbp::Request& request) {
-    auto value = request.getValue();
+static bool is_valid_xattr_blob(cb::const_byte_buffer value,
+                                uint8_t datatype) {
     cb::compression::Buffer buffer;
     cb::const_char_buffer xattr{reinterpret_cast<const char*>(value.data()),
                                 value.size()};
-    if (mcbp::datatype::is_snappy(uint8_t(request.getDatatype()))) {
+    if (mcbp::datatype::is_snappy(datatype)) {
         // Inflate the xattr data and validate that.
         if (!cb::compression::inflate(
                     cb::compression::Algorithm::Snappy, xattr, buffer)) {
@@ -784,6 +836,32 @@ static bool is_valid_xattr_blob(const cb::mcbp::Request& request) {
     return cb::xattr::validate(xattr);
 }
 
+/**
+ * Validate the xattrs of a value of the current packet. A compressed value
+ * is inflated into the cookie, so the executor of the command may reuse it
+ * rather than inflating it again.
+ */
+static bool is_valid_xattr_blob(Cookie& cookie,
+                                cb::const_byte_buffer value,
+                                uint8_t datatype) {
+    cb::const_char_buffer xattr{reinterpret_cast<const char*>(value.data()),
+                                value.size()};
+    if (mcbp::datatype::is_snappy(datatype)) {
+        if (!cookie.inflateInputPayload(xattr)) {
+            return false;
+        }
+        xattr = cookie.getInflatedInputPayload();
+    }
+
+    return cb::xattr::validate(xattr);
+}
+
+static bool is_valid_xattr_blob(Cookie& cookie) {
+    const auto& request = cookie.getHeader().getRequest();
+    return is_valid_xattr_blob(
+            cookie, request.getValue(), uint8_t(request.getDatatype()));
+}
+
 static Status dcp_mutation_validator(Cookie& cookie) {
     using cb::mcbp::request::DcpMutationPayload;
 
@@ -802,16 +880,25 @@ static Status dcp_mutation_validator(Cookie& cookie) {
 
     auto& header = cookie.getHeader();
     const auto datatype = header.getDatatype();
+    auto extras = header.getExtdata();
+    const auto* payload =
+            reinterpret_cast<const DcpMutationPayload*>(extras.data());
+
+    // The value is followed by nmeta bytes of (uncompressed) meta data,
+    // which the executor strips off before passing the value on
+    auto value = header.getRequest().getValue();
+    if (payload->getNmeta() > value.size()) {
+        cookie.setErrorContext("nmeta exceeds the value length");
+        return Status::Einval;
+    }
+    value = {value.data(), value.size() - payload->getNmeta()};
 
     if (mcbp::datatype::is_xattr(datatype) &&
-        !is_valid_xattr_blob(header.getRequest())) {
+        !is_valid_xattr_blob(cookie, value, datatype)) {
         cookie.setErrorContext("Xattr blob not valid");
         return Status::XattrEinval;
     }
 
-    auto extras = cookie.getHeader().getExtdata();
-    const auto* payload =
-            reinterpret_cast<const DcpMutationPayload*>(extras.data());
     if (payload->getBySeqno() == 0) {
         cookie.setErrorContext("Invalid seqno(0) for DCP mutation");
         return Status::Einval;
@@ -967,7 +1054,7 @@ static Status dcp_prepare_validator(Cookie& cookie) {
     const auto datatype = header.getDatatype();
 
     if (mcbp::datatype::is_xattr(datatype) &&
-        !is_valid_xattr_blob(header.getRequest())) {
+        !is_valid_xattr_blob(cookie)) {
         cookie.setErrorContext("Xattr blob not valid");
         return Status::XattrEinval;
     }
@@ -1717,7 +1804,7 @@ static Status mutate_with_meta_validator(Cookie& cookie) {
     }
 
     if (mcbp::datatype::is_xattr(header.getDatatype()) &&
-        !is_valid_xattr_blob(header.getRequest())) {
+        !is_valid_xattr_blob(cookie)) {
         cookie.setErrorContext("Xattr blob invalid");
         return Status::XattrEinval;
     }
@@ -1922,12 +2009,27 @@ static Status scrub_validator(Cookie& cookie) {
 }
 
 static Status get_random_key_validator(Cookie& cookie) {
-    return McbpValidator::verify_header(cookie,
-                                        0,
-                                        ExpectedKeyLen::Zero,
-                                        ExpectedValueLen::Zero,
-                                        ExpectedCas::NotSet,
-                                        PROTOCOL_BINARY_RAW_BYTES);
+    const auto extlen = cookie.getHeader().getExtlen();
+
+    // We check extlen below so pass actual extlen as expected extlen to bypass
+    // the check in verify header
+    auto status = McbpValidator::verify_header(cookie,
+                                               extlen,
+                                               ExpectedKeyLen::Zero,
+                                               ExpectedValueLen::Zero,
+                                               ExpectedCas::NotSet,
+                                               PROTOCOL_BINARY_RAW_BYTES);
+    if (status != Status::Success) {
+        return status;
+    }
+
+    if (extlen != 0 &&
+        extlen != sizeof(cb::mcbp::request::GetRandomKeyPayload)) {
+        cookie.setErrorContext("Request extras must be of length 0 or 4");
+        return Status::Einval;
+    }
+
+    return Status::Success;
 }
 
 /**
@@ -2061,6 +2163,220 @@ static Status get_keys_validator(Cookie& cookie) {
     return Status::Success;
 }
 
+static Status range_scan_validator(Cookie& cookie) {
+    using cb::mcbp::request::RangeScanPayload;
+    auto status = McbpValidator::verify_header(cookie,
+                                               sizeof(RangeScanPayload),
+                                               ExpectedKeyLen::NonZero,
+                                               ExpectedValueLen::Any,
+                                               ExpectedCas::NotSet,
+                                               PROTOCOL_BINARY_RAW_BYTES);
+    if (status != Status::Success) {
+        return status;
+    }
+
+    if (!is_document_key_valid(cookie)) {
+        return Status::Einval;
+    }
+
+    auto extras = cookie.getHeader().getExtdata();
+    const auto* payload =
+            reinterpret_cast<const RangeScanPayload*>(extras.data());
+    if (payload->getCount() == 0) {
+        cookie.setErrorContext("Expected a non-zero number of documents");
+        return Status::Einval;
+    }
+    if ((payload->getFlags() & ~RangeScanPayload::KeysOnly) != 0) {
+        cookie.setErrorContext("Request contains invalid flags");
+        return Status::Einval;
+    }
+
+    return Status::Success;
+}
+
+static Status get_multi_validator(Cookie& cookie) {
+    auto status = McbpValidator::verify_header(cookie,
+                                               0,
+                                               ExpectedKeyLen::Zero,
+                                               ExpectedValueLen::NonZero,
+                                               ExpectedCas::NotSet,
+                                               PROTOCOL_BINARY_RAW_BYTES);
+    if (status != Status::Success) {
+        return status;
+    }
+
+    // The value is a list of 16 bit vbucket | 16 bit key length | key
+    const auto maxKeyLen = cookie.getConnection().isCollectionsSupported()
+                                   ? MaxCollectionsKeyLen
+                                   : KEY_MAX_LENGTH;
+    auto value = cookie.getHeader().getValue();
+    while (!value.empty()) {
+        if (value.size() < 2 * sizeof(uint16_t)) {
+            cookie.setErrorContext("Truncated key entry");
+            return Status::Einval;
+        }
+        uint16_t keylen;
+        std::copy(value.data() + sizeof(uint16_t),
+                  value.data() + 2 * sizeof(uint16_t),
+                  reinterpret_cast<uint8_t*>(&keylen));
+        keylen = ntohs(keylen);
+        if (keylen == 0 || keylen > maxKeyLen) {
+            cookie.setErrorContext("Invalid key length: " +
+                                   std::to_string(keylen));
+            return Status::Einval;
+        }
+        if (value.size() < 2 * sizeof(uint16_t) + keylen) {
+            cookie.setErrorContext("Truncated key entry");
+            return Status::Einval;
+        }
+        value = {value.data() + 2 * sizeof(uint16_t) + keylen,
+                 value.size() - 2 * sizeof(uint16_t) - keylen};
+    }
+
+    return Status::Success;
+}
+
+static Status set_multi_validator(Cookie& cookie) {
+    auto status = McbpValidator::verify_header(cookie,
+                                               0,
+                                               ExpectedKeyLen::Zero,
+                                               ExpectedValueLen::NonZero,
+                                               ExpectedCas::NotSet,
+                                               PROTOCOL_BINARY_RAW_BYTES);
+    if (status != Status::Success) {
+        return status;
+    }
+
+    // The value is a list of 16 bit vbucket | 16 bit key length |
+    // 8 bit datatype | 32 bit flags | 32 bit expiration | 32 bit value length |
+    // key | value
+    const size_t headerlen = 2 * sizeof(uint16_t) + sizeof(uint8_t) +
+                             3 * sizeof(uint32_t);
+    auto& connection = cookie.getConnection();
+    const auto maxKeyLen = connection.isCollectionsSupported()
+                                   ? MaxCollectionsKeyLen
+                                   : KEY_MAX_LENGTH;
+    auto value = cookie.getHeader().getValue();
+    while (!value.empty()) {
+        if (value.size() < headerlen) {
+            cookie.setErrorContext("Truncated document entry");
+            return Status::Einval;
+        }
+        uint16_t keylen;
+        uint32_t valuelen;
+        std::copy(value.data() + sizeof(uint16_t),
+                  value.data() + 2 * sizeof(uint16_t),
+                  reinterpret_cast<uint8_t*>(&keylen));
+        std::copy(value.data() + headerlen - sizeof(uint32_t),
+                  value.data() + headerlen,
+                  reinterpret_cast<uint8_t*>(&valuelen));
+        keylen = ntohs(keylen);
+        valuelen = ntohl(valuelen);
+        if (keylen == 0 || keylen > maxKeyLen) {
+            cookie.setErrorContext("Invalid key length: " +
+                                   std::to_string(keylen));
+            return Status::Einval;
+        }
+        const auto datatype = value[2 * sizeof(uint16_t)];
+        if (datatype != PROTOCOL_BINARY_RAW_BYTES &&
+            (datatype != PROTOCOL_BINARY_DATATYPE_JSON ||
+             !connection.isDatatypeEnabled(datatype))) {
+            cookie.setErrorContext("Invalid datatype: " +
+                                   std::to_string(datatype));
+            return Status::Einval;
+        }
+        if (value.size() - headerlen < size_t(keylen) + valuelen) {
+            cookie.setErrorContext("Truncated document entry");
+            return Status::Einval;
+        }
+        const size_t entrylen = headerlen + keylen + valuelen;
+        value = {value.data() + entrylen, value.size() - entrylen};
+    }
+
+    return Status::Success;
+}
+
+static Status set_with_meta_multi_validator(Cookie& cookie) {
+    auto& header = cookie.getHeader();
+
+    // The extras optionally hold the options (as those of SetWithMeta), so
+    // pass the actual extlen to bypass the check in verify_header
+    auto status = McbpValidator::verify_header(cookie,
+                                               header.getExtlen(),
+                                               ExpectedKeyLen::Zero,
+                                               ExpectedValueLen::NonZero,
+                                               ExpectedCas::NotSet,
+                                               PROTOCOL_BINARY_RAW_BYTES);
+    if (status != Status::Success) {
+        return status;
+    }
+    if (header.getExtlen() != 0 && header.getExtlen() != sizeof(uint32_t)) {
+        cookie.setErrorContext("Request extras must be of length 0 or 4");
+        return Status::Einval;
+    }
+
+    // The value is a list of 16 bit vbucket | 16 bit key length |
+    // 8 bit datatype | 8 bit deleted | 32 bit flags | 32 bit expiration |
+    // 64 bit seqno | 64 bit cas | 32 bit value length | key | value
+    const size_t headerlen = 2 * sizeof(uint16_t) + 2 * sizeof(uint8_t) +
+                             2 * sizeof(uint32_t) + 2 * sizeof(uint64_t) +
+                             sizeof(uint32_t);
+    auto& connection = cookie.getConnection();
+    const auto maxKeyLen = connection.isCollectionsSupported()
+                                   ? MaxCollectionsKeyLen
+                                   : KEY_MAX_LENGTH;
+    auto value = header.getValue();
+    while (!value.empty()) {
+        if (value.size() < headerlen) {
+            cookie.setErrorContext("Truncated document entry");
+            return Status::Einval;
+        }
+        uint16_t keylen;
+        uint32_t valuelen;
+        std::copy(value.data() + sizeof(uint16_t),
+                  value.data() + 2 * sizeof(uint16_t),
+                  reinterpret_cast<uint8_t*>(&keylen));
+        std::copy(value.data() + headerlen - sizeof(uint32_t),
+                  value.data() + headerlen,
+                  reinterpret_cast<uint8_t*>(&valuelen));
+        keylen = ntohs(keylen);
+        valuelen = ntohl(valuelen);
+        if (keylen == 0 || keylen > maxKeyLen) {
+            cookie.setErrorContext("Invalid key length: " +
+                                   std::to_string(keylen));
+            return Status::Einval;
+        }
+        const auto datatype = value[2 * sizeof(uint16_t)];
+        const auto deleted = value[2 * sizeof(uint16_t) + sizeof(uint8_t)];
+        if (!mcbp::datatype::is_valid(datatype) ||
+            (datatype != PROTOCOL_BINARY_RAW_BYTES &&
+             !connection.isDatatypeEnabled(datatype))) {
+            cookie.setErrorContext("Invalid datatype: " +
+                                   std::to_string(datatype));
+            return Status::Einval;
+        }
+        if (deleted > 1) {
+            cookie.setErrorContext("Invalid deleted: " +
+                                   std::to_string(deleted));
+            return Status::Einval;
+        }
+        if (value.size() - headerlen < size_t(keylen) + valuelen) {
+            cookie.setErrorContext("Truncated document entry");
+            return Status::Einval;
+        }
+        if (mcbp::datatype::is_xattr(datatype) &&
+            !is_valid_xattr_blob({value.data() + headerlen + keylen, valuelen},
+                                 datatype)) {
+            cookie.setErrorContext("Xattr blob invalid");
+            return Status::XattrEinval;
+        }
+        const size_t entrylen = headerlen + keylen + valuelen;
+        value = {value.data() + entrylen, value.size() - entrylen};
+    }
+
+    return Status::Success;
+}
+
 static Status set_param_validator(Cookie& cookie) {
     using cb::mcbp::request::SetParamPayload;
     auto status = McbpValidator::verify_header(cookie,
@@ -2195,6 +2511,15 @@ static Status compact_db_validator(Cookie& cookie) {
     return Status::Success;
 }
 
+static Status vbucket_file_validator(Cookie& cookie) {
+    return McbpValidator::verify_header(cookie,
+                                        0,
+                                        ExpectedKeyLen::Zero,
+                                        ExpectedValueLen::NonZero,
+                                        ExpectedCas::NotSet,
+                                        PROTOCOL_BINARY_RAW_BYTES);
+}
+
 static Status observe_validator(Cookie& cookie) {
     return McbpValidator::verify_header(cookie,
                                         0,
@@ -2221,7 +2546,7 @@ static Status not_supported_validator(Cookie& cookie) {
 
 Status McbpValidator::validate(ClientOpcode command, Cookie& cookie) {
     const auto idx = std::underlying_type<ClientOpcode>::type(command);
-    if (validators[idx]) {
+    if (validators[idx] != nullptr) {
         return validators[idx](cookie);
     }
     return Status::UnknownCommand;
@@ -2256,6 +2581,8 @@ McbpValidator::McbpValidator() {
           dcp_seqno_acknowledged_validator);
     setup(cb::mcbp::ClientOpcode::DcpCommit, dcp_commit_validator);
     setup(cb::mcbp::ClientOpcode::DcpAbort, dcp_abort_validator);
+    setup(cb::mcbp::ClientOpcode::DcpStreamReqMulti,
+          dcp_stream_req_multi_validator);
     setup(cb::mcbp::ClientOpcode::IsaslRefresh,
           configuration_refresh_validator);
     setup(cb::mcbp::ClientOpcode::SslCertsRefresh,
@@ -2387,6 +2714,12 @@ McbpValidator::McbpValidator() {
     setup(cb::mcbp::ClientOpcode::DisableTraffic,
           enable_disable_traffic_validator);
     setup(cb::mcbp::ClientOpcode::GetKeys, get_keys_validator);
+    setup(cb::mcbp::ClientOpcode::RangeScan, range_scan_validator);
+    setup(cb::mcbp::ClientOpcode::GetMulti, get_multi_validator);
+    setup(cb::mcbp::ClientOpcode::SetMulti, set_multi_validator);
+    setup(cb::mcbp::ClientOpcode::GetMetaMulti, get_multi_validator);
+    setup(cb::mcbp::ClientOpcode::SetWithMetaMulti,
+          set_with_meta_multi_validator);
     setup(cb::mcbp::ClientOpcode::SetParam, set_param_validator);
     setup(cb::mcbp::ClientOpcode::GetReplica, get_validator);
     setup(cb::mcbp::ClientOpcode::ReturnMeta, return_meta_validator);
@@ -2399,6 +2732,8 @@ McbpValidator::McbpValidator() {
     setup(cb::mcbp::ClientOpcode::CheckpointPersistence,
           chekpoint_persistence_validator);
     setup(cb::mcbp::ClientOpcode::CompactDb, compact_db_validator);
+    setup(cb::mcbp::ClientOpcode::VbucketSnapshot, vbucket_file_validator);
+    setup(cb::mcbp::ClientOpcode::VbucketInstall, vbucket_file_validator);
     setup(cb::mcbp::ClientOpcode::Observe, observe_validator);
 
     // Add a validator which returns not supported (we won't execute
@@ -38,6 +38,7 @@ class McbpValidator {
 public:
     using ClientOpcode = cb::mcbp::ClientOpcode;
     using Status = cb::mcbp::Status;
+    using Validator = Status (*)(Cookie&);
 
     enum class ExpectedKeyLen { Zero, NonZero, Any };
     enum class ExpectedValueLen { Zero, NonZero, Any };
@@ -51,6 +52,14 @@ public:
      */
     Status validate(ClientOpcode command, Cookie& cookie);
 
+    /// Get the validator for the command (nullptr if it isn't supported)
+    Validator getValidator(ClientOpcode command) const {
+        return validators[uint8_t(command)];
+    }
+
+    /// Does the command accept the DurabilityRequirement frame info
+    static bool isDurabilitySupported(ClientOpcode command);
+
     static Status verify_header(
             Cookie& cookie,
             uint8_t expected_extlen,
@@ -65,7 +74,10 @@ protected:
      */
     void setup(ClientOpcode command, Status (*f)(Cookie&));
 
-    std::array<std::function<Status(Cookie&)>, 0x100> validators;
+    /// The validator per opcode (nullptr if the opcode isn't supported).
+    /// Plain function pointers avoid the std::function call overhead on
+    /// the hot path
+    std::array<Validator, 0x100> validators{};
 };
 
 /**
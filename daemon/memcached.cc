@@ -47,10 +47,13 @@
 #include "parent_monitor.h"
 #include "protocol/mcbp/engine_wrapper.h"
 #include "runtime.h"
+#include "sampling_profiler.h"
 #include "server_socket.h"
 #include "session_cas.h"
 #include "settings.h"
+#include "slow_op_log.h"
 #include "stats.h"
+#include "stats_push.h"
 #include "subdocument.h"
 #include "timings.h"
 #include "topkeys.h"
@@ -86,7 +89,10 @@
 #include <fcntl.h>
 #include <algorithm>
 #include <chrono>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <thread>
 
 #if HAVE_LIBNUMA
@@ -114,6 +120,57 @@
 static std::mutex buckets_lock;
 std::array<Bucket, cb::limits::TotalBuckets + 1> all_buckets;
 
+/**
+ * The names of the buckets which have released their slot in all_buckets
+ * but whose engine is still being shut down. A bucket can't be created
+ * with one of those names until then (it would share the data files).
+ * Protected by buckets_lock.
+ */
+static std::set<std::string> dying_buckets;
+
+/**
+ * Bounds the number of engines initializing (when creating a bucket) or
+ * shutting down (when deleting one) at the same time. Both are heavy on
+ * the disk (warmup, flushing the outstanding mutations), so creating or
+ * deleting many buckets at once would otherwise make them all step on the
+ * underlying IO together.
+ */
+class BucketOperationLimiter {
+public:
+    /// Block until an operation may start
+    void acquire() {
+        std::unique_lock<std::mutex> guard(mutex);
+        cond.wait(guard, [this] { return running < maxRunning; });
+        ++running;
+    }
+
+    void release() {
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            --running;
+        }
+        cond.notify_one();
+    }
+
+private:
+    static const size_t maxRunning = 4;
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    size_t running = 0;
+};
+
+static BucketOperationLimiter bucket_operation_limiter;
+
+/// Run an engine initialize / shutdown within bucket_operation_limiter
+template <typename Operation>
+static auto limitBucketOperation(Operation&& operation)
+        -> decltype(operation()) {
+    bucket_operation_limiter.acquire();
+    auto release = gsl::finally([] { bucket_operation_limiter.release(); });
+    return operation();
+}
+
 void bucketsForEach(std::function<bool(Bucket&, void*)> fn, void *arg) {
     std::lock_guard<std::mutex> all_bucket_lock(buckets_lock);
     for (Bucket& bucket : all_buckets) {
@@ -134,6 +191,7 @@ std::atomic<bool> memcached_shutdown;
 std::atomic<bool> service_online;
 
 std::unique_ptr<ExecutorPool> executorPool;
+std::unique_ptr<ExecutorPool> saslExecutorPool;
 
 /* Mutex for global stats */
 std::mutex stats_mutex;
@@ -152,6 +210,7 @@ static void register_callback(EngineIface* eh,
                               const void* cb_data);
 
 static void create_listen_sockets();
+static void publish_thread_listeners();
 
 /* stats */
 static void stats_init();
@@ -207,6 +266,11 @@ static void set_stats_reset_time()
 }
 
 void disassociate_bucket(Connection& connection) {
+    // The items pinned by zerocopy sends (or referenced by queued
+    // responses) can't outlive the bucket
+    connection.reapZeroCopyCompletions(true);
+    connection.releaseCoalescedResponses();
+
     Bucket& b = connection.getBucket();
     std::lock_guard<std::mutex> guard(b.mutex);
     b.clients--;
@@ -472,6 +536,15 @@ static void scramsha_fallback_salt_changed_listener(const std::string&,
     cb::sasl::server::set_scramsha_fallback_salt(s.getScramshaFallbackSalt());
 }
 
+static void external_auth_cache_ttl_changed_listener(const std::string&,
+                                                     Settings& s) {
+    if (externalAuthManager) {
+        externalAuthManager->setResultCacheTtl(
+                s.getExternalAuthCacheTtl(),
+                s.getExternalAuthNegativeCacheTtl());
+    }
+}
+
 static void opcode_attributes_override_changed_listener(const std::string&,
                                                         Settings& s) {
     try {
@@ -535,6 +608,12 @@ static void settings_init() {
                                ssl_cipher_list_changed_listener);
     settings.addChangeListener("verbosity", verbosity_changed_listener);
     settings.addChangeListener("interfaces", interfaces_changed_listener);
+    settings.addChangeListener("active_threads",
+                               [](const std::string&, Settings& s) -> void {
+                                   // Let the threads open or close their
+                                   // reuseport listeners
+                                   notify_worker_threads();
+                               });
     settings.addChangeListener("scramsha_fallback_salt",
                                scramsha_fallback_salt_changed_listener);
     settings.addChangeListener(
@@ -545,6 +624,15 @@ static void settings_init() {
                             s.getActiveExternalUsersPushInterval());
                 }
             });
+    settings.addChangeListener(
+            "slow_op_capture_size",
+            [](const std::string&, Settings& s) -> void {
+                cb::slowOpLog.setCapacity(s.getSlowOpCaptureSize());
+            });
+    settings.addChangeListener("external_auth_cache_ttl",
+                               external_auth_cache_ttl_changed_listener);
+    settings.addChangeListener("external_auth_negative_cache_ttl",
+                               external_auth_cache_ttl_changed_listener);
 
     settings.addChangeListener(
             "opentracing_config", [](const std::string&, Settings& s) -> void {
@@ -678,8 +766,11 @@ void disable_listen() {
         ++listen_state.num_disable;
     }
 
-    for (auto& connection : listen_conn) {
-        connection->disable();
+    // The sockets in listen_conn is owned by the dispatcher thread
+    if (is_listen_thread()) {
+        for (auto& connection : listen_conn) {
+            connection->disable();
+        }
     }
 }
 
@@ -852,6 +943,16 @@ void event_handler(evutil_socket_t fd, short which, void *arg) {
     /* sanity */
     cb_assert(fd == c->getSocketDescriptor());
 
+    if (settings.isQosSchedulingEnabled()) {
+        // Let the scheduler pick the order to serve the connections in
+        // once the event library is done reporting the ready connections
+        thr->scheduler.schedule(*c, c->getConnectionClass(), which);
+        event_active(&thr->scheduler_event, EV_TIMEOUT, 0);
+        return;
+    }
+
+    // The scheduling may have been disabled while we were queued
+    thr->scheduler.remove(*c);
     run_event_loop(c, which);
 
     if (memcached_shutdown) {
@@ -869,6 +970,40 @@ void event_handler(evutil_socket_t fd, short which, void *arg) {
     }
 }
 
+void scheduler_event_handler(evutil_socket_t, short, void* arg) {
+    auto& thr = *reinterpret_cast<FrontEndThread*>(arg);
+
+    TRACE_LOCKGUARD_TIMED(thr.mutex,
+                          "mutex",
+                          "scheduler_event_handler::threadLock",
+                          SlowMutexThreshold);
+
+    // No new connections may be scheduled while we're running (that
+    // happens from the event library callbacks on this thread), so this
+    // serves all of the connections which were ready in this round.
+    while (!thr.scheduler.empty()) {
+        const auto entry = thr.scheduler.next();
+        const auto start = std::chrono::steady_clock::now();
+        run_event_loop(entry.connection, entry.which);
+        thr.scheduler.charge(entry.cls,
+                             std::chrono::steady_clock::now() - start);
+    }
+
+    if (memcached_shutdown) {
+        // Someone requested memcached to shut down. If we don't have
+        // any connections bound to this thread we can just shut down
+        int connected = signal_idle_clients(thr);
+        if (connected == 0) {
+            LOG_INFO("Stopping worker thread {}", thr.index);
+            event_base_loopbreak(thr.base);
+        } else {
+            LOG_INFO("Waiting for {} connected clients on worker thread {}",
+                     connected,
+                     thr.index);
+        }
+    }
+}
+
 /**
  * The listen_event_handler is the callback from libevent when someone is
  * connecting to one of the server sockets. It runs in the context of the
@@ -878,6 +1013,12 @@ void listen_event_handler(evutil_socket_t, short, void *arg) {
     auto& c = *reinterpret_cast<ServerSocket*>(arg);
 
     if (memcached_shutdown) {
+        if (c.getOwner() != nullptr) {
+            // The socket is owned by a front end thread, which drops all
+            // of its listening sockets as part of the shutdown
+            c.disable();
+            return;
+        }
         // Someone requested memcached to shut down. The listen thread should
         // be stopped immediately to avoid new connections
         LOG_INFO("Stopping listen thread");
@@ -901,6 +1042,8 @@ static void dispatch_event_handler(evutil_socket_t fd, short, void *) {
         check_listen_conn = false;
 
         bool changes = false;
+        // Set to true if the properties for one of the ports changed
+        bool publish = false;
         auto interfaces = settings.getInterfaces();
 
         // Step one, enable all new ports
@@ -987,6 +1130,7 @@ static void dispatch_event_handler(evutil_socket_t fd, short, void *) {
                             // change the associated description
                             connection->updateSSL(interface.ssl.key,
                                                   interface.ssl.cert);
+                            publish = true;
                         }
                     }
 
@@ -1006,12 +1150,20 @@ static void dispatch_event_handler(evutil_socket_t fd, short, void *) {
         if (changes) {
             create_portnumber_file(false);
         }
+
+        if (changes || publish) {
+            publish_thread_listeners();
+        }
     }
 
     if (is_listen_disabled()) {
         for (auto& connection : listen_conn) {
             connection->enable();
         }
+        if (settings.isReusePortListenersEnabled()) {
+            // Let the front end threads enable their sockets
+            notify_worker_threads();
+        }
     }
 }
 
@@ -1097,6 +1249,18 @@ static SOCKET new_server_socket(struct addrinfo* ai) {
                     cb_strerror(cb::net::get_socket_error()));
     }
 
+#ifdef SO_REUSEPORT
+    if (settings.isReusePortListenersEnabled() &&
+        cb::net::setsockopt(sfd,
+                            SOL_SOCKET,
+                            SO_REUSEPORT,
+                            reinterpret_cast<const void*>(&flags),
+                            sizeof(flags)) != 0) {
+        LOG_WARNING("setsockopt(SO_REUSEPORT): {}",
+                    cb_strerror(cb::net::get_socket_error()));
+    }
+#endif
+
     if (cb::net::setsockopt(sfd,
                             SOL_SOCKET,
                             SO_KEEPALIVE,
@@ -1118,6 +1282,130 @@ static SOCKET new_server_socket(struct addrinfo* ai) {
     return sfd;
 }
 
+/**
+ * When reuseport_listeners is enabled each of the front end threads
+ * create their own socket bound to the same address as each of the
+ * sockets in listen_conn. The dispatcher publish the addresses to bind
+ * to (and bump the generation) every time listen_conn change, and the
+ * front end threads pick up the change the next time they're notified.
+ */
+struct ThreadListener {
+    sockaddr_storage addr;
+    socklen_t addrlen;
+    std::shared_ptr<ListeningPort> interface;
+};
+
+static struct {
+    std::mutex mutex;
+    std::vector<ThreadListener> listeners;
+    uint64_t generation = 0;
+} thread_listeners;
+
+static void publish_thread_listeners() {
+    if (!settings.isReusePortListenersEnabled()) {
+        return;
+    }
+
+    std::vector<ThreadListener> next;
+    for (const auto& connection : listen_conn) {
+        ThreadListener listener;
+        listener.addrlen = sizeof(listener.addr);
+        if (getsockname(connection->getSocket(),
+                        reinterpret_cast<sockaddr*>(&listener.addr),
+                        &listener.addrlen) != 0) {
+            LOG_WARNING("publish_thread_listeners: getsockname(): {}",
+                        cb_strerror(cb::net::get_socket_error()));
+            continue;
+        }
+        listener.interface = connection->getInterface();
+        next.emplace_back(std::move(listener));
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(thread_listeners.mutex);
+        thread_listeners.listeners.swap(next);
+        ++thread_listeners.generation;
+    }
+
+    notify_worker_threads();
+}
+
+void update_thread_listeners(FrontEndThread& me) {
+    // The sockets may have been disabled if we ran out of file descriptors
+    for (auto& listener : me.listeners) {
+        listener->enable();
+    }
+
+    std::vector<ThreadListener> listeners;
+    {
+        std::lock_guard<std::mutex> guard(thread_listeners.mutex);
+        if (me.listeners_generation == thread_listeners.generation) {
+            return;
+        }
+        me.listeners_generation = thread_listeners.generation;
+        listeners = thread_listeners.listeners;
+    }
+
+    std::vector<std::unique_ptr<ServerSocket>> next;
+    for (const auto& listener : listeners) {
+        // Keep the socket if the properties for the port didn't change
+        auto iter = std::find_if(
+                me.listeners.begin(),
+                me.listeners.end(),
+                [&listener](const std::unique_ptr<ServerSocket>& socket) {
+                    return socket &&
+                           socket->getInterface() == listener.interface;
+                });
+        if (iter != me.listeners.end()) {
+            next.emplace_back(std::move(*iter));
+            continue;
+        }
+
+        addrinfo ai = {};
+        ai.ai_family = listener.addr.ss_family;
+        ai.ai_socktype = SOCK_STREAM;
+        ai.ai_protocol = IPPROTO_TCP;
+        ai.ai_addrlen = listener.addrlen;
+        ai.ai_addr = reinterpret_cast<sockaddr*>(
+                const_cast<sockaddr_storage*>(&listener.addr));
+
+        auto sfd = new_server_socket(&ai);
+        if (sfd == INVALID_SOCKET) {
+            LOG_WARNING("Worker thread {}: Failed to create listening socket",
+                        me.index);
+            continue;
+        }
+
+        if (bind(sfd, ai.ai_addr, ai.ai_addrlen) == SOCKET_ERROR) {
+            LOG_WARNING("Worker thread {}: Failed to bind to {} - {}",
+                        me.index,
+                        cb::net::to_string(
+                                reinterpret_cast<sockaddr_storage*>(ai.ai_addr),
+                                listener.addrlen),
+                        cb_strerror(cb::net::get_socket_error()));
+            safe_close(sfd);
+            continue;
+        }
+
+        try {
+            next.emplace_back(std::make_unique<ServerSocket>(
+                    sfd, me.base, listener.interface, &me));
+            stats.daemon_conns++;
+            stats.curr_conns.fetch_add(1, std::memory_order_relaxed);
+        } catch (const std::exception& e) {
+            LOG_WARNING(
+                    "Worker thread {}: Failed to create listening socket: {}",
+                    me.index,
+                    e.what());
+            safe_close(sfd);
+        }
+    }
+
+    // The remaining sockets in the list is no longer in use and will be
+    // closed as part of the swap
+    me.listeners.swap(next);
+}
+
 static bool server_socket(const std::string& tag,
                           const std::string& host,
                           in_port_t port,
@@ -1328,6 +1616,17 @@ static void create_listen_sockets() {
     }
 
     create_portnumber_file(true);
+
+#ifdef SO_REUSEPORT
+    publish_thread_listeners();
+#else
+    if (settings.isReusePortListenersEnabled()) {
+        LOG_WARNING(
+                "reuseport_listeners is not supported on this platform "
+                "(all clients are accepted by the dispatcher thread)");
+        settings.setReusePortListenersEnabled(false);
+    }
+#endif
 }
 
 static void sigint_handler() {
@@ -1742,6 +2041,12 @@ public:
         hooks_api.release_free_memory = AllocHooks::release_free_memory;
         hooks_api.enable_thread_cache = AllocHooks::enable_thread_cache;
         hooks_api.get_allocator_property = AllocHooks::get_allocator_property;
+        hooks_api.get_allocation_utilization =
+                AllocHooks::get_allocation_utilization;
+        hooks_api.create_arena = AllocHooks::create_arena;
+        hooks_api.release_arena = AllocHooks::release_arena;
+        hooks_api.set_thread_arena = AllocHooks::set_thread_arena;
+        hooks_api.get_arena_stats = AllocHooks::get_arena_stats;
 
         core = &core_api;
         callback = &callback_api;
@@ -1797,6 +2102,7 @@ void CreateBucketThread::create() {
     bool found = false;
 
     std::unique_lock<std::mutex> all_bucket_lock(buckets_lock);
+    found = dying_buckets.count(name) != 0;
     for (ii = 0; ii < all_buckets.size() && !found; ++ii) {
         std::lock_guard<std::mutex> guard(all_buckets[ii].mutex);
         if (first_free == all_buckets.size() &&
@@ -1876,7 +2182,8 @@ void CreateBucketThread::create() {
     }
 
     try {
-        result = engine->initialize(config.c_str());
+        result = limitBucketOperation(
+                [this, engine] { return engine->initialize(config.c_str()); });
     } catch (const std::runtime_error& e) {
         LOG_WARNING("{} - Failed to create bucket [{}]: {}",
                     connection.getId(),
@@ -1906,7 +2213,7 @@ void CreateBucketThread::create() {
             std::lock_guard<std::mutex> guard(bucket.mutex);
             bucket.state = Bucket::State::Destroying;
         }
-        engine->destroy(false);
+        limitBucketOperation([engine] { engine->destroy(false); });
         std::lock_guard<std::mutex> guard(bucket.mutex);
         bucket.state = Bucket::State::None;
         bucket.name[0] = '\0';
@@ -1949,7 +2256,12 @@ void DestroyBucketThread::destroy() {
             : std::to_string(connection->getId())};
 
     size_t idx = 0;
-    for (size_t ii = 0; ii < all_buckets.size(); ++ii) {
+    if (dying_buckets.count(name) != 0) {
+        // Already being deleted
+        ret = ENGINE_KEY_EEXISTS;
+    }
+    for (size_t ii = 0; ii < all_buckets.size() && ret == ENGINE_KEY_ENOENT;
+         ++ii) {
         std::lock_guard<std::mutex> guard(all_buckets[ii].mutex);
         if (name == all_buckets[ii].name) {
             idx = ii;
@@ -2091,15 +2403,15 @@ void DestroyBucketThread::destroy() {
         }
     }
 
-    LOG_INFO(
-            "{} Delete bucket [{}]. Shut down the bucket", connection_id, name);
-
-    bucket.getEngine()->destroy(force);
-
-    LOG_INFO("{} Delete bucket [{}]. Clean up allocated resources ",
+    LOG_INFO("{} Delete bucket [{}]. Release the bucket slot",
              connection_id,
              name);
 
+    // Nothing uses the bucket any more, so release its slot (keeping the
+    // name reserved until the engine is gone) before the potentially slow
+    // shutdown of the engine.
+    auto* engine = bucket.getEngine();
+
     // Clean up the stats...
     threadlocal_stats_reset(bucket.stats);
 
@@ -2108,6 +2420,17 @@ void DestroyBucketThread::destroy() {
         handler.clear();
     }
 
+    // don't need lock because all timing data uses atomics
+    bucket.timings.reset();
+    // No connections are using the bucket any more, so nothing may record
+    // into the sketches
+    bucket.keyspaceTimings.clear();
+    bucket.statsPushCache.reset();
+    bucket.admissionControl.reset();
+    bucket.slowOpThresholds.reset();
+
+    all_bucket_lock.lock();
+    dying_buckets.insert(name);
     {
         std::lock_guard<std::mutex> guard(bucket.mutex);
         bucket.state = Bucket::State::None;
@@ -2116,8 +2439,16 @@ void DestroyBucketThread::destroy() {
         bucket.topkeys.reset();
         bucket.responseCounters.fill(0);
     }
-    // don't need lock because all timing data uses atomics
-    bucket.timings.reset();
+    all_bucket_lock.unlock();
+
+    LOG_INFO(
+            "{} Delete bucket [{}]. Shut down the bucket", connection_id, name);
+
+    limitBucketOperation([this, engine] { engine->destroy(force); });
+
+    all_bucket_lock.lock();
+    dying_buckets.erase(name);
+    all_bucket_lock.unlock();
 
     LOG_INFO("{} Delete bucket [{}] complete", connection_id, name);
     result = ENGINE_SUCCESS;
@@ -2134,6 +2465,7 @@ static void initialize_buckets() {
     size_t numthread = settings.getNumWorkerThreads() + 1;
     for (auto &b : all_buckets) {
         b.stats.resize(numthread);
+        b.timings.setNumThreads(numthread);
     }
 
     // To make the life easier for us in the code, index 0
@@ -2149,6 +2481,17 @@ static void initialize_buckets() {
 }
 
 static void cleanup_buckets() {
+    // Wait for the engines of the deleted buckets still shutting down
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> all_bucket_lock(buckets_lock);
+            if (dying_buckets.empty()) {
+                break;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(250));
+    }
+
     for (auto &bucket : all_buckets) {
         bool waiting;
 
@@ -2182,11 +2525,12 @@ static void cleanup_buckets() {
 
 void delete_all_buckets() {
     /*
-     * Delete all of the buckets one by one by using the executor.
-     * We could in theory schedule all of them in parallel, but they
-     * probably have some dirty items they need to write to disk so
-     * instead of having all of the buckets step on the underlying IO
-     * in parallel we'll do them sequentially.
+     * Delete all of the buckets in parallel by using the executor. They
+     * probably have some dirty items they need to write to disk, so
+     * the number of engines shutting down at the same time is bounded
+     * by the bucket_operation_limiter (so that all of the buckets don't
+     * step on the underlying IO in parallel) while the rest wait for
+     * their clients to disconnect.
      */
 
     /**
@@ -2215,38 +2559,33 @@ void delete_all_buckets() {
     };
 
     LOG_INFO("Stop all buckets");
-    bool done;
-    do {
-        done = true;
-        std::shared_ptr<Task> task;
-        std::string name;
-
-        std::unique_lock<std::mutex> all_bucket_lock(buckets_lock);
+    std::vector<std::pair<std::string, std::shared_ptr<Task>>> tasks;
+    {
+        std::lock_guard<std::mutex> all_bucket_lock(buckets_lock);
         /*
          * Start at one (not zero) because zero is reserved for "no bucket".
          * The "no bucket" has a state of Bucket::State::Ready but no name.
          */
-        for (size_t ii = 1; ii < all_buckets.size() && done; ++ii) {
+        for (size_t ii = 1; ii < all_buckets.size(); ++ii) {
             std::lock_guard<std::mutex> bucket_guard(all_buckets[ii].mutex);
             if (all_buckets[ii].state == Bucket::State::Ready) {
-                name.assign(all_buckets[ii].name);
+                std::string name(all_buckets[ii].name);
                 LOG_INFO("Scheduling delete for bucket {}", name);
-                task = std::make_shared<DestroyBucketTask>(name);
+                auto task = std::make_shared<DestroyBucketTask>(name);
                 std::lock_guard<std::mutex> guard(task->getMutex());
                 dynamic_cast<DestroyBucketTask&>(*task).start();
                 executorPool->schedule(task, false);
-                done = false;
+                tasks.emplace_back(std::move(name), std::move(task));
             }
         }
-        all_bucket_lock.unlock();
+    }
 
-        if (task) {
-            auto& dbt = dynamic_cast<DestroyBucketTask&>(*task);
-            LOG_INFO("Waiting for delete of {} to complete", name);
-            dbt.thread.waitForState(Couchbase::ThreadState::Zombie);
-            LOG_INFO("Bucket {} deleted", name);
-        }
-    } while (!done);
+    for (auto& entry : tasks) {
+        auto& dbt = dynamic_cast<DestroyBucketTask&>(*entry.second);
+        LOG_INFO("Waiting for delete of {} to complete", entry.first);
+        dbt.thread.waitForState(Couchbase::ThreadState::Zombie);
+        LOG_INFO("Bucket {} deleted", entry.first);
+    }
 }
 
 /**
@@ -2427,6 +2766,9 @@ extern "C" int memcached_main(int argc, char **argv) {
     externalAuthManager = std::make_unique<ExternalAuthManagerThread>();
     externalAuthManager->setPushActiveUsersInterval(
             settings.getActiveExternalUsersPushInterval());
+    externalAuthManager->setResultCacheTtl(
+            settings.getExternalAuthCacheTtl(),
+            settings.getExternalAuthNegativeCacheTtl());
     externalAuthManager->start();
 
     initialize_audit();
@@ -2491,8 +2833,12 @@ extern "C" int memcached_main(int argc, char **argv) {
 
     executorPool =
             std::make_unique<ExecutorPool>(settings.getNumWorkerThreads());
+    saslExecutorPool = std::make_unique<ExecutorPool>(
+            settings.getNumSaslThreads() == 0 ? settings.getNumWorkerThreads()
+                                              : settings.getNumSaslThreads());
 
     initializeTracing();
+    initializeStatsPush();
     TRACE_GLOBAL0("memcached", "Started");
 
     /*
@@ -2553,6 +2899,7 @@ extern "C" int memcached_main(int argc, char **argv) {
 
     LOG_INFO("Shutting down executor pool");
     executorPool.reset();
+    saslExecutorPool.reset();
 
     LOG_INFO("Releasing signal handlers");
     release_signal_handlers();
@@ -2570,6 +2917,8 @@ extern "C" int memcached_main(int argc, char **argv) {
 
     LOG_INFO("Deinitialising tracing");
     deinitializeTracing();
+    stopSamplingProfiler();
+    shutdownStatsPush();
 
     LOG_INFO("Shutting down engine map");
     shutdown_engine_map();
@@ -58,6 +58,7 @@ class Pipe;
 }
 class Cookie;
 class Connection;
+struct FrontEndThread;
 struct thread_stats;
 
 void associate_initial_bucket(Connection& connection);
@@ -77,6 +78,13 @@ void threads_cleanup();
 
 class ListeningPort;
 void dispatch_conn_new(SOCKET sfd, std::shared_ptr<ListeningPort>& interface);
+/**
+ * Create a new connection for the socket and bind it to the provided
+ * thread (which must be the calling thread).
+ */
+void dispatch_conn_local(FrontEndThread& thread,
+                         SOCKET sfd,
+                         const std::shared_ptr<ListeningPort>& interface);
 
 /* Lock wrappers for cache functions that are called from main loop. */
 int is_listen_thread(void);
@@ -86,10 +94,18 @@ void threadlocal_stats_reset(std::vector<thread_stats>& thread_stats);
 void notify_io_complete(gsl::not_null<const void*> cookie,
                         ENGINE_ERROR_CODE status);
 void safe_close(SOCKET sfd);
+/**
+ * Add the connection (and the cookie's status) to its thread's pending IO
+ *
+ * @return non-zero if the thread needs to be notified (it isn't already
+ *         going to serve the pending IO)
+ */
 int add_conn_to_pending_io_list(Connection* c,
                                 Cookie* cookie,
                                 ENGINE_ERROR_CODE status);
 void event_handler(evutil_socket_t fd, short which, void *arg);
+/// Serve the connections queued in the front end thread's scheduler
+void scheduler_event_handler(evutil_socket_t fd, short which, void* arg);
 void listen_event_handler(evutil_socket_t, short, void *);
 
 void mcbp_collect_timings(Cookie& cookie);
@@ -117,6 +133,12 @@ bool associate_bucket(Connection& connection, const char* name);
 void disassociate_bucket(Connection& connection);
 
 void disable_listen();
+/**
+ * Synchronize the listening sockets owned by the provided front end thread
+ * with the ones published by the dispatcher (only used when
+ * reuseport_listeners is enabled). Must be called from the thread itself.
+ */
+void update_thread_listeners(FrontEndThread& thread);
 bool is_listen_disabled();
 uint64_t get_listen_disabled_num();
 
@@ -128,6 +150,13 @@ uint64_t get_listen_disabled_num();
 class ExecutorPool;
 extern std::unique_ptr<ExecutorPool> executorPool;
 
+/**
+ * The executor pool used to run the SASL authentication tasks (kept
+ * separate from executorPool so that a burst of authentications doesn't
+ * delay the other tasks)
+ */
+extern std::unique_ptr<ExecutorPool> saslExecutorPool;
+
 void iterate_all_connections(std::function<void(Connection&)> callback);
 
 void start_stdin_listener(std::function<void()> function);
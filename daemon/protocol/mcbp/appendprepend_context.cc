@@ -36,6 +36,9 @@ AppendPrependCommandContext::AppendPrependCommandContext(
       vbucket(req.getVBucket()),
       cas(req.getCas()),
       state(State::ValidateInput),
+      // A durable update needs the engine to wait for the SyncWrite, so
+      // it's kept on the get and store path
+      inPlace(!req.getDurabilityRequirements()),
       datatype(uint8_t(req.getDatatype())) {
 }
 
@@ -49,6 +52,9 @@ ENGINE_ERROR_CODE AppendPrependCommandContext::step() {
         case State::InflateInputData:
             ret = inflateInputData();
             break;
+        case State::Update:
+            ret = update();
+            break;
         case State::GetItem:
             ret = getItem();
             break;
@@ -88,7 +94,7 @@ ENGINE_ERROR_CODE AppendPrependCommandContext::validateInput() {
     if (mcbp::datatype::is_snappy(datatype)) {
         state = State::InflateInputData;
     } else {
-        state = State::GetItem;
+        state = inPlace ? State::Update : State::GetItem;
     }
     return ENGINE_SUCCESS;
 }
@@ -101,7 +107,7 @@ ENGINE_ERROR_CODE AppendPrependCommandContext::inflateInputData() {
             return ENGINE_EINVAL;
         }
         value = inputbuffer;
-        state = State::GetItem;
+        state = inPlace ? State::Update : State::GetItem;
     } catch (const std::bad_alloc&) {
         return ENGINE_ENOMEM;
     }
@@ -109,6 +115,56 @@ ENGINE_ERROR_CODE AppendPrependCommandContext::inflateInputData() {
     return ENGINE_SUCCESS;
 }
 
+ENGINE_ERROR_CODE AppendPrependCommandContext::update() {
+    cb::EngineErrorItemPair ret;
+    if (mode == Mode::Append) {
+        // Let the engine append to the current value without copying it
+        ret = bucket_append(cookie, key, vbucket, cas, value);
+        if (ret.first != cb::engine_errc::not_supported) {
+            return storedInPlace(ret);
+        }
+    }
+
+    ret = bucket_update(
+            cookie,
+            key,
+            vbucket,
+            cas,
+            [this](const item_info* existing, cb::UpdatedDocument& document) {
+                if (existing == nullptr) {
+                    return cb::engine_errc::no_such_key;
+                }
+                const cb::const_char_buffer old{
+                        static_cast<const char*>(existing->value[0].iov_base),
+                        existing->value[0].iov_len};
+                document.value.resize(old.size() + value.size());
+                document.datatype = joinValues(
+                        old, existing->datatype, &document.value[0]);
+                return cb::engine_errc::success;
+            });
+
+    if (ret.first == cb::engine_errc::not_supported) {
+        // Fetch and store the document ourself
+        state = State::GetItem;
+        return ENGINE_SUCCESS;
+    }
+    return storedInPlace(ret);
+}
+
+ENGINE_ERROR_CODE AppendPrependCommandContext::storedInPlace(
+        cb::EngineErrorItemPair& ret) {
+    if (ret.first != cb::engine_errc::success) {
+        return ENGINE_ERROR_CODE(ret.first);
+    }
+
+    newitem = std::move(ret.second);
+    item_info info;
+    if (!bucket_get_item_info(connection, newitem.get(), &info)) {
+        return ENGINE_FAILED;
+    }
+    return sendResult(info.cas);
+}
+
 ENGINE_ERROR_CODE AppendPrependCommandContext::getItem() {
     auto ret = bucket_get(cookie, key, vbucket);
     if (ret.first == cb::engine_errc::success) {
@@ -151,6 +207,41 @@ ENGINE_ERROR_CODE AppendPrependCommandContext::getItem() {
     return ENGINE_ERROR_CODE(ret.first);
 }
 
+protocol_binary_datatype_t AppendPrependCommandContext::joinValues(
+        cb::const_char_buffer old,
+        protocol_binary_datatype_t oldDatatype,
+        char* dest) {
+    // The offset into the old item where the actual body start.
+    size_t body_offset = 0;
+
+    // If the existing item had XATTRs we need to preserve the xattrs
+    protocol_binary_datatype_t datatype = PROTOCOL_BINARY_RAW_BYTES;
+    if (mcbp::datatype::is_xattr(oldDatatype)) {
+        datatype |= PROTOCOL_BINARY_DATATYPE_XATTR;
+        body_offset = cb::xattr::get_body_offset(old);
+    }
+
+    // copy the data over..
+    if (mode == Mode::Append) {
+        memcpy(dest, old.buf, old.len);
+        memcpy(dest + old.len, value.buf, value.len);
+    } else {
+        // The xattrs should go first (body_offset == 0 if the object
+        // don't have any xattrs)
+        memcpy(dest, old.buf, body_offset);
+        memcpy(dest + body_offset, value.buf, value.len);
+        memcpy(dest + body_offset + value.len, old.buf + body_offset,
+               old.len - body_offset);
+    }
+    // If the resulting document's data is valid JSON, set the datatype flag
+    // to reflect this.
+    cb::const_byte_buffer buf{
+            reinterpret_cast<const uint8_t*>(dest + body_offset),
+            old.len - body_offset + value.len};
+    setDatatypeJSONFromValue(buf, datatype);
+    return datatype;
+}
+
 ENGINE_ERROR_CODE AppendPrependCommandContext::allocateNewItem() {
     cb::char_buffer old{static_cast<char*>(oldItemInfo.value[0].iov_base),
                         oldItemInfo.nbytes};
@@ -163,11 +254,6 @@ ENGINE_ERROR_CODE AppendPrependCommandContext::allocateNewItem() {
     // tell the underlying engine about how much of the data which
     // should be accounted for in the privileged segment.
     size_t priv_size = 0;
-
-    // The offset into the old item where the actual body start.
-    size_t body_offset = 0;
-
-    // If the existing item had XATTRs we need to preserve the xattrs
     protocol_binary_datatype_t datatype = PROTOCOL_BINARY_RAW_BYTES;
     if (mcbp::datatype::is_xattr(oldItemInfo.datatype)) {
         datatype |= PROTOCOL_BINARY_DATATYPE_XATTR;
@@ -176,7 +262,6 @@ ENGINE_ERROR_CODE AppendPrependCommandContext::allocateNewItem() {
         // compressed as we are already using the decompression buffer as
         // input (see head of function).
         cb::xattr::Blob blob(old, false);
-        body_offset = blob.size();
         priv_size = blob.get_system_size();
     }
 
@@ -190,28 +275,11 @@ ENGINE_ERROR_CODE AppendPrependCommandContext::allocateNewItem() {
                                    vbucket);
 
     newitem = std::move(pair.first);
-    cb::byte_buffer body{static_cast<uint8_t*>(pair.second.value[0].iov_base),
-                         pair.second.value[0].iov_len};
 
-    // copy the data over..
-    if (mode == Mode::Append) {
-        memcpy(body.buf, old.buf, old.len);
-        memcpy(body.buf + old.len, value.buf, value.len);
-    } else {
-        // The xattrs should go first (body_offset == 0 if the object
-        // don't have any xattrs)
-        memcpy(body.buf, old.buf, body_offset);
-        memcpy(body.buf + body_offset, value.buf, value.len);
-        memcpy(body.buf + body_offset + value.len, old.buf + body_offset,
-               old.len - body_offset);
-    }
-    // If the resulting document's data is valid JSON, set the datatype flag
-    // to reflect this.
-    cb::const_byte_buffer buf{
-            reinterpret_cast<const uint8_t*>(body.buf + body_offset),
-            old.len + value.len};
     // Update the documents's datatype and CAS values
-    setDatatypeJSONFromValue(buf, datatype);
+    datatype = joinValues(old,
+                          oldItemInfo.datatype,
+                          static_cast<char*>(pair.second.value[0].iov_base));
     bucket_item_set_datatype(connection, newitem.get(), datatype);
     bucket_item_set_cas(connection, newitem.get(), oldItemInfo.cas);
 
@@ -230,27 +298,7 @@ ENGINE_ERROR_CODE AppendPrependCommandContext::storeItem() {
                                     .getDurabilityRequirements());
 
     if (ret == ENGINE_SUCCESS) {
-        update_topkeys(cookie);
-        cookie.setCas(ncas);
-        if (connection.isSupportsMutationExtras()) {
-            item_info newItemInfo;
-            if (!bucket_get_item_info(
-                        connection, newitem.get(), &newItemInfo)) {
-                return ENGINE_FAILED;
-            }
-            extras.vbucket_uuid = htonll(newItemInfo.vbucket_uuid);
-            extras.seqno = htonll(newItemInfo.seqno);
-            cookie.sendResponse(
-                    cb::mcbp::Status::Success,
-                    {reinterpret_cast<const char*>(&extras), sizeof(extras)},
-                    {},
-                    {},
-                    cb::mcbp::Datatype::Raw,
-                    ncas);
-        } else {
-            cookie.sendResponse(cb::mcbp::Status::Success);
-        }
-        state = State::Done;
+        ret = sendResult(ncas);
     } else if (ret == ENGINE_KEY_EEXISTS && cas == 0) {
         state = State::Reset;
         // We need to return ENGINE_SUCCESS in order to continue processing
@@ -260,6 +308,30 @@ ENGINE_ERROR_CODE AppendPrependCommandContext::storeItem() {
     return ret;
 }
 
+ENGINE_ERROR_CODE AppendPrependCommandContext::sendResult(uint64_t ncas) {
+    update_topkeys(cookie);
+    cookie.setCas(ncas);
+    if (connection.isSupportsMutationExtras()) {
+        item_info newItemInfo;
+        if (!bucket_get_item_info(connection, newitem.get(), &newItemInfo)) {
+            return ENGINE_FAILED;
+        }
+        extras.vbucket_uuid = htonll(newItemInfo.vbucket_uuid);
+        extras.seqno = htonll(newItemInfo.seqno);
+        cookie.sendResponse(
+                cb::mcbp::Status::Success,
+                {reinterpret_cast<const char*>(&extras), sizeof(extras)},
+                {},
+                {},
+                cb::mcbp::Datatype::Raw,
+                ncas);
+    } else {
+        cookie.sendResponse(cb::mcbp::Status::Success);
+    }
+    state = State::Done;
+    return ENGINE_SUCCESS;
+}
+
 ENGINE_ERROR_CODE AppendPrependCommandContext::reset() {
     olditem.reset();
     newitem.reset();
@@ -24,11 +24,13 @@
 
 /**
  * The AppendPrependCommandContext is a state machine used by the memcached
- * core to implement append and prepend by fetching the document from the
- * underlying engine, performing the operation and try to use CAS to replace
- * the document in the underlying engine. Multiple clients operating on the
- * same document will be detected by the CAS store operation returning EEXISTS,
- * and we just retry the operation.
+ * core to implement append and prepend. If the underlying engine can update
+ * the document in place (and the operation isn't durable) it performs the
+ * operation under its lock for the document. Otherwise we fetch the
+ * document from the underlying engine, perform the operation and try to use
+ * CAS to replace the document in the underlying engine. Multiple clients
+ * operating on the same document will be detected by the CAS store operation
+ * returning EEXISTS, and we just retry the operation.
  */
 class AppendPrependCommandContext : public SteppableCommandContext {
 public:
@@ -43,6 +45,8 @@ public:
         // If the client sends compressed data we need to inflate the
         // input data before we can do anything
             InflateInputData,
+        // Ask the engine to update the document in place
+            Update,
         // Look up the item to operate on
             GetItem,
         // Allocate the destination object
@@ -69,6 +73,11 @@ protected:
 
     ENGINE_ERROR_CODE inflateInputData();
 
+    ENGINE_ERROR_CODE update();
+
+    /// Send the result of the engine updating the document in place
+    ENGINE_ERROR_CODE storedInPlace(cb::EngineErrorItemPair& ret);
+
     ENGINE_ERROR_CODE getItem();
 
     ENGINE_ERROR_CODE allocateNewItem();
@@ -77,6 +86,24 @@ protected:
 
     ENGINE_ERROR_CODE reset();
 
+    /**
+     * Join the current (uncompressed) value of the document and the input
+     * data, keeping the extended attributes of the document first
+     *
+     * @param old the current value of the document
+     * @param oldDatatype the datatype of the current value
+     * @param dest where to write the new value (old.size() + value.size()
+     *        bytes)
+     * @return the datatype of the new value
+     */
+    protocol_binary_datatype_t joinValues(
+            cb::const_char_buffer old,
+            protocol_binary_datatype_t oldDatatype,
+            char* dest);
+
+    /// Send the response for the document stored
+    ENGINE_ERROR_CODE sendResult(uint64_t ncas);
+
 private:
     const Mode mode;
     const DocKey key;
@@ -92,6 +119,8 @@ private:
     cb::compression::Buffer buffer;
     cb::compression::Buffer inputbuffer;
     State state;
+    // The engine may be asked to update the document in place
+    const bool inPlace;
 
     // The extras section is used as a buffer to hold extra meta information
     // about the mutation while it is being sent back to the client iff the
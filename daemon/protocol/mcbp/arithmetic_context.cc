@@ -37,7 +37,65 @@ ArithmeticCommandContext::ArithmeticCommandContext(Cookie& cookie,
       cas(req.getCas()),
       vbucket(req.getVBucket()),
       increment(req.getClientOpcode() == cb::mcbp::ClientOpcode::Increment ||
-                req.getClientOpcode() == cb::mcbp::ClientOpcode::Incrementq) {
+                req.getClientOpcode() == cb::mcbp::ClientOpcode::Incrementq),
+      // A durable update needs the engine to wait for the SyncWrite, so
+      // it's kept on the get and store path
+      state(req.getDurabilityRequirements() ? State::GetItem : State::Update) {
+}
+
+ENGINE_ERROR_CODE ArithmeticCommandContext::update() {
+    auto ret = bucket_update(
+            cookie,
+            key,
+            vbucket,
+            cas,
+            [this](const item_info* existing, cb::UpdatedDocument& document) {
+                if (existing == nullptr) {
+                    if (extras.getExpiration() == 0xffffffff) {
+                        return cb::engine_errc::no_such_key;
+                    }
+                    result = extras.getInitial();
+                    document.value = std::to_string(result);
+                    document.exptime = extras.getExpiration();
+                    return cb::engine_errc::success;
+                }
+
+                const cb::const_char_buffer old{
+                        static_cast<const char*>(existing->value[0].iov_base),
+                        existing->value[0].iov_len};
+                return cb::engine_errc(makeNewValue(old,
+                                                    existing->datatype,
+                                                    document.value,
+                                                    document.datatype));
+            });
+
+    switch (ret.first) {
+    case cb::engine_errc::not_supported:
+        // Read and store the document ourself
+        state = State::GetItem;
+        return ENGINE_SUCCESS;
+    case cb::engine_errc::success: {
+        newitem = std::move(ret.second);
+        item_info info;
+        if (!bucket_get_item_info(connection, newitem.get(), &info)) {
+            return ENGINE_FAILED;
+        }
+        cookie.setCas(info.cas);
+        state = State::SendResult;
+        return ENGINE_SUCCESS;
+    }
+    case cb::engine_errc::no_such_key:
+        if (increment) {
+            STATS_INCR(&connection, incr_misses);
+        } else {
+            STATS_INCR(&connection, decr_misses);
+        }
+        break;
+    default:
+        break;
+    }
+
+    return ENGINE_ERROR_CODE(ret.first);
 }
 
 ENGINE_ERROR_CODE ArithmeticCommandContext::getItem() {
@@ -135,28 +193,17 @@ ENGINE_ERROR_CODE ArithmeticCommandContext::storeNewItem() {
     return ret;
 }
 
-ENGINE_ERROR_CODE ArithmeticCommandContext::allocateNewItem() {
-    // Set ptr to point to the beginning of the input buffer.
-    size_t oldsize = oldItemInfo.nbytes;
-    auto* ptr = static_cast<char*>(oldItemInfo.value[0].iov_base);
-    // If the input buffer was compressed we should use the temporary
-    // allocated buffer instead
-    if (buffer.size() != 0) {
-        ptr = buffer.data();
-        oldsize = buffer.size();
-    }
-
+ENGINE_ERROR_CODE ArithmeticCommandContext::makeNewValue(
+        cb::const_char_buffer old,
+        protocol_binary_datatype_t oldDatatype,
+        std::string& value,
+        protocol_binary_datatype_t& datatype) {
     // Preserve the XATTRs of the existing item if it had any
     size_t xattrsize = 0;
-    size_t priv_bytes = 0;
-    if (mcbp::datatype::is_xattr(oldItemInfo.datatype)) {
-        cb::xattr::Blob blob({ptr, oldsize},
-                             mcbp::datatype::is_snappy(oldItemInfo.datatype));
-        priv_bytes = blob.get_system_size();
-        xattrsize = blob.size();
+    if (mcbp::datatype::is_xattr(oldDatatype)) {
+        xattrsize = cb::xattr::get_body_offset(old);
     }
-    ptr += xattrsize;
-    const std::string payload(ptr, oldsize - xattrsize);
+    const std::string payload(old.data() + xattrsize, old.size() - xattrsize);
 
     uint64_t oldval;
     if (!safe_strtoull(payload.c_str(), oldval)) {
@@ -176,18 +223,46 @@ ENGINE_ERROR_CODE ArithmeticCommandContext::allocateNewItem() {
         }
     }
     result = oldval;
-    const std::string value = std::to_string(result);
 
-    protocol_binary_datatype_t datatype = PROTOCOL_BINARY_RAW_BYTES;
+    value.assign(old.data(), xattrsize);
+    value.append(std::to_string(result));
+    datatype = PROTOCOL_BINARY_RAW_BYTES;
     if (xattrsize > 0) {
         datatype |= PROTOCOL_BINARY_DATATYPE_XATTR;
     }
+    return ENGINE_SUCCESS;
+}
+
+ENGINE_ERROR_CODE ArithmeticCommandContext::allocateNewItem() {
+    // Set ptr to point to the beginning of the input buffer.
+    size_t oldsize = oldItemInfo.nbytes;
+    auto* ptr = static_cast<char*>(oldItemInfo.value[0].iov_base);
+    // If the input buffer was compressed we should use the temporary
+    // allocated buffer instead
+    if (buffer.size() != 0) {
+        ptr = buffer.data();
+        oldsize = buffer.size();
+    }
+
+    std::string value;
+    protocol_binary_datatype_t datatype;
+    auto ret = makeNewValue(
+            {ptr, oldsize}, oldItemInfo.datatype, value, datatype);
+    if (ret != ENGINE_SUCCESS) {
+        return ret;
+    }
+
+    size_t priv_bytes = 0;
+    if (mcbp::datatype::is_xattr(datatype)) {
+        cb::xattr::Blob blob({ptr, oldsize}, false);
+        priv_bytes = blob.get_system_size();
+    }
 
     // In order to be backwards compatible with old Couchbase server we
     // continue to use the old expiry time:
     auto pair = bucket_allocate_ex(cookie,
                                    key,
-                                   xattrsize + value.size(),
+                                   value.size(),
                                    priv_bytes,
                                    oldItemInfo.flags,
                                    rel_time_t(oldItemInfo.exptime),
@@ -195,18 +270,7 @@ ENGINE_ERROR_CODE ArithmeticCommandContext::allocateNewItem() {
                                    vbucket);
 
     newitem = std::move(pair.first);
-    cb::byte_buffer body{static_cast<uint8_t*>(pair.second.value[0].iov_base),
-                         pair.second.value[0].iov_len};
-
-    // copy the data over..
-    const auto* src = (const char*)oldItemInfo.value[0].iov_base;
-    if (buffer.size() != 0) {
-        src = buffer.data();
-    }
-
-    // copy the xattr over;
-    memcpy(body.buf, src, xattrsize);
-    memcpy(body.buf + xattrsize, value.data(), value.size());
+    memcpy(pair.second.value[0].iov_base, value.data(), value.size());
     bucket_item_set_cas(connection, newitem.get(), oldItemInfo.cas);
 
     state = State::StoreItem;
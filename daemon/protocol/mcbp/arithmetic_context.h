@@ -36,6 +36,12 @@ class ArithmeticCommandContext : public SteppableCommandContext {
 public:
     /**
      * The internal state diagram for performing an arithmetic operation.
+     * If the engine can update the document in place (and the operation
+     * isn't durable) it's done with one call to the engine:
+     *
+     *    Update -> SendResult -> Done
+     *
+     * Otherwise we read the document and store the new one with CAS.
      * We've got two different paths through the state diagram depending
      * if the counter exists or not:
      *
@@ -57,6 +63,7 @@ public:
      * forever we give up after a 10 times.
      */
     enum class State {
+        Update,
         GetItem,
         CreateNewItem,
         StoreNewItem,
@@ -78,6 +85,9 @@ protected:
         auto ret = ENGINE_SUCCESS;
         do {
             switch (state) {
+            case State::Update:
+                ret = update();
+                break;
             case State::GetItem:
                 ret = getItem();
                 break;
@@ -107,6 +117,8 @@ protected:
         return ret;
     }
 
+    ENGINE_ERROR_CODE update();
+
     ENGINE_ERROR_CODE getItem();
 
     ENGINE_ERROR_CODE createNewItem();
@@ -121,6 +133,22 @@ protected:
 
     ENGINE_ERROR_CODE reset();
 
+    /**
+     * Compute the new value of the counter from the current (uncompressed)
+     * value of the document, preserving its extended attributes
+     *
+     * @param old the current value of the document
+     * @param oldDatatype the datatype of the current value
+     * @param value the new value
+     * @param datatype the datatype of the new value
+     * @return ENGINE_SUCCESS, or ENGINE_DELTA_BADVAL if the document isn't
+     *         a counter
+     */
+    ENGINE_ERROR_CODE makeNewValue(cb::const_char_buffer old,
+                                   protocol_binary_datatype_t oldDatatype,
+                                   std::string& value,
+                                   protocol_binary_datatype_t& datatype);
+
 private:
 
     const DocKey key;
@@ -133,5 +161,5 @@ private:
     cb::unique_item_ptr newitem;
     cb::compression::Buffer buffer;
     uint64_t result = 0;
-    State state = State::GetItem;
+    State state;
 };
@@ -80,17 +80,12 @@ void get_cluster_config_executor(Cookie& cookie) {
         return;
     }
 
-    auto pair = bucket.clusterConfiguration.getConfiguration();
-    if (pair.first == -1) {
+    auto config = bucket.clusterConfiguration.getConfiguration();
+    if (!config) {
         cookie.sendResponse(cb::mcbp::Status::KeyEnoent);
     } else {
-        cookie.sendResponse(cb::mcbp::Status::Success,
-                            {},
-                            {},
-                            {pair.second->data(), pair.second->size()},
-                            cb::mcbp::Datatype::JSON,
-                            0);
-        connection.setClustermapRevno(pair.first);
+        cookie.setCas(0);
+        cookie.sendClusterConfig(cb::mcbp::Status::Success, std::move(config));
     }
 }
 
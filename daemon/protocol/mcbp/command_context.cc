@@ -0,0 +1,64 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "command_context.h"
+
+#include <daemon/request_arena.h>
+#include <new>
+
+/**
+ * Every context is prefixed with a header recording the arena it was
+ * allocated from (nullptr for the heap) so that operator delete knows
+ * where to return it. The header is padded to keep the object aligned.
+ */
+union ContextHeader {
+    cb::RequestArena* arena;
+    std::max_align_t alignment;
+};
+
+void* CommandContext::operator new(std::size_t count) {
+    auto* header = static_cast<ContextHeader*>(
+            ::operator new(sizeof(ContextHeader) + count));
+    header->arena = nullptr;
+    return header + 1;
+}
+
+void* CommandContext::operator new(std::size_t count,
+                                   cb::RequestArena& arena) {
+    auto* header = static_cast<ContextHeader*>(
+            arena.allocate(sizeof(ContextHeader) + count));
+    if (header == nullptr) {
+        return operator new(count);
+    }
+    header->arena = &arena;
+    return header + 1;
+}
+
+void CommandContext::operator delete(void* ptr) noexcept {
+    if (ptr == nullptr) {
+        return;
+    }
+    auto* header = static_cast<ContextHeader*>(ptr) - 1;
+    if (header->arena) {
+        header->arena->deallocate(header);
+    } else {
+        ::operator delete(header);
+    }
+}
+
+void CommandContext::operator delete(void* ptr, cb::RequestArena&) noexcept {
+    operator delete(ptr);
+}
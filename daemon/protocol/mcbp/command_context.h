@@ -18,6 +18,11 @@
 
 #include <memcached/engine_error.h>
 #include <memcached/types.h>
+#include <cstddef>
+
+namespace cb {
+class RequestArena;
+}
 
 /**
  *  A command may need to store command specific context during the duration
@@ -27,11 +32,32 @@
  *  The implementation of such commands should subclass this class and
  *  allocate an instance and store in the commands commandContext member (which
  *  will be deleted and set to nullptr between each command being processed).
+ *
+ *  Contexts are normally created from the cookie's request arena
+ *  (`new (cookie.getArena()) MyContext(...)`, which is what
+ *  Cookie::obtainContext does) to avoid hitting the allocator for every
+ *  command. Contexts created with a plain `new` live on the heap; both may
+ *  be released with `delete` (and hence be owned by a std::unique_ptr).
  */
 class CommandContext {
 public:
     virtual ~CommandContext(){};
 
+    /// Allocate a context from the heap
+    static void* operator new(std::size_t count);
+
+    /**
+     * Allocate a context from the request arena (falls back to the heap
+     * if there isn't enough space left in the arena)
+     */
+    static void* operator new(std::size_t count, cb::RequestArena& arena);
+
+    /// Release a context allocated by any of the above
+    static void operator delete(void* ptr) noexcept;
+
+    /// Called if the constructor throws for an arena allocated context
+    static void operator delete(void* ptr, cb::RequestArena& arena) noexcept;
+
     /**
      * The `pre_link_document()` is a hook called from the underlying engine
      * as part of the `store()` method in the engine API. See the `pre_link()`
@@ -23,7 +23,6 @@
 #include <memcached/limits.h>
 #include <memcached/protocol_binary.h>
 #include <platform/compress.h>
-#include <xattr/blob.h>
 #include <xattr/utils.h>
 #include <limits>
 #include <stdexcept>
@@ -43,10 +42,18 @@ static inline ENGINE_ERROR_CODE do_dcp_mutation(Cookie& cookie) {
 
     uint32_t priv_bytes = 0;
     if (mcbp::datatype::is_xattr(datatype)) {
-        const char* payload = reinterpret_cast<const char*>(value.buf);
-        cb::xattr::Blob blob({const_cast<char*>(payload), value.len},
-                             mcbp::datatype::is_snappy(datatype));
-        priv_bytes = uint32_t(blob.get_system_size());
+        cb::const_char_buffer payload{reinterpret_cast<const char*>(value.buf),
+                                      value.len};
+        if (mcbp::datatype::is_snappy(datatype)) {
+            // Use the copy the validator inflated (the value itself is
+            // passed on to the engine as it is)
+            if (!cookie.inflateInputPayload(payload)) {
+                return ENGINE_EINVAL;
+            }
+            payload = cookie.getInflatedInputPayload();
+        }
+        priv_bytes = uint32_t(cb::xattr::get_system_xattr_size(
+                PROTOCOL_BINARY_DATATYPE_XATTR, payload));
         if (priv_bytes > cb::limits::PrivilegedBytes) {
             return ENGINE_E2BIG;
         }
@@ -20,7 +20,6 @@
 #include <memcached/durability_spec.h>
 #include <memcached/limits.h>
 #include <memcached/protocol_binary.h>
-#include <xattr/blob.h>
 #include <xattr/utils.h>
 
 void dcp_prepare_executor(Cookie& cookie) {
@@ -38,12 +37,23 @@ void dcp_prepare_executor(Cookie& cookie) {
 
         uint32_t priv_bytes = 0;
         if (mcbp::datatype::is_xattr(datatype)) {
-            const char* payload = reinterpret_cast<const char*>(value.buf);
-            cb::xattr::Blob blob({const_cast<char*>(payload), value.len},
-                                 mcbp::datatype::is_snappy(datatype));
-            priv_bytes = uint32_t(blob.get_system_size());
-            if (priv_bytes > cb::limits::PrivilegedBytes) {
-                ret = ENGINE_E2BIG;
+            cb::const_char_buffer payload{
+                    reinterpret_cast<const char*>(value.buf), value.len};
+            if (mcbp::datatype::is_snappy(datatype)) {
+                // Use the copy the validator inflated (the value itself is
+                // passed on to the engine as it is)
+                if (cookie.inflateInputPayload(payload)) {
+                    payload = cookie.getInflatedInputPayload();
+                } else {
+                    ret = ENGINE_EINVAL;
+                }
+            }
+            if (ret == ENGINE_SUCCESS) {
+                priv_bytes = uint32_t(cb::xattr::get_system_xattr_size(
+                        PROTOCOL_BINARY_DATATYPE_XATTR, payload));
+                if (priv_bytes > cb::limits::PrivilegedBytes) {
+                    ret = ENGINE_E2BIG;
+                }
             }
         }
 
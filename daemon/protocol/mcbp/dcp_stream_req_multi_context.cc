@@ -0,0 +1,119 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "dcp_stream_req_multi_context.h"
+#include "engine_errc_2_mcbp.h"
+#include "engine_wrapper.h"
+
+#include <daemon/connection.h>
+#include <daemon/cookie.h>
+
+DcpStreamReqMultiCommandContext::DcpStreamReqMultiCommandContext(
+        Cookie& cookie)
+    : SteppableCommandContext(cookie),
+      entries(reinterpret_cast<
+              const cb::mcbp::request::DcpStreamReqMultiEntry*>(
+              cookie.getRequest().getValue().data())),
+      numEntries(cookie.getRequest().getValue().size() /
+                 sizeof(cb::mcbp::request::DcpStreamReqMultiEntry)) {
+    response.reserve(numEntries *
+                     sizeof(cb::mcbp::response::DcpStreamReqMultiResult));
+}
+
+ENGINE_ERROR_CODE DcpStreamReqMultiCommandContext::addFailoverLog(
+        vbucket_failover_t* entries,
+        size_t nentries,
+        gsl::not_null<const void*> cookie) {
+    auto* ctx = dynamic_cast<DcpStreamReqMultiCommandContext*>(
+            reinterpret_cast<const Cookie*>(cookie.get())->getCommandContext());
+    if (ctx == nullptr) {
+        return ENGINE_FAILED;
+    }
+
+    ctx->failoverLog.clear();
+    for (size_t ii = 0; ii < nentries; ++ii) {
+        vbucket_failover_t entry;
+        entry.uuid = htonll(entries[ii].uuid);
+        entry.seqno = htonll(entries[ii].seqno);
+        ctx->failoverLog.append(reinterpret_cast<const char*>(&entry),
+                                sizeof(entry));
+    }
+    return ENGINE_SUCCESS;
+}
+
+void DcpStreamReqMultiCommandContext::addResult(cb::mcbp::Status status,
+                                                cb::const_char_buffer value) {
+    cb::mcbp::response::DcpStreamReqMultiResult result;
+    result.setVBucket(entries[next].getVBucket());
+    result.setStatus(status);
+    result.setLength(gsl::narrow<uint32_t>(value.size()));
+    response.append(reinterpret_cast<const char*>(&result), sizeof(result));
+    response.append(value.data(), value.size());
+}
+
+ENGINE_ERROR_CODE DcpStreamReqMultiCommandContext::step() {
+    // Every stream of a collection-aware connection streams all collections;
+    // the filter can only be given in a DcpStreamReq
+    boost::optional<cb::const_char_buffer> collections;
+    if (connection.isCollectionsSupported()) {
+        collections = cb::const_char_buffer{};
+    }
+
+    for (; next < numEntries; ++next) {
+        const auto& entry = entries[next];
+        uint64_t rollbackSeqno = 0;
+        failoverLog.clear();
+        auto ret = dcpStreamReq(cookie,
+                                entry.getFlags(),
+                                entry.getOpaque(),
+                                entry.getVBucket(),
+                                entry.getStartSeqno(),
+                                entry.getEndSeqno(),
+                                entry.getVbucketUuid(),
+                                entry.getSnapStartSeqno(),
+                                entry.getSnapEndSeqno(),
+                                &rollbackSeqno,
+                                addFailoverLog,
+                                collections);
+
+        ret = connection.remapErrorCode(ret);
+        switch (ret) {
+        case ENGINE_SUCCESS:
+            addResult(cb::mcbp::Status::Success, failoverLog);
+            break;
+        case ENGINE_ROLLBACK:
+            rollbackSeqno = htonll(rollbackSeqno);
+            addResult(cb::mcbp::Status::Rollback,
+                      {reinterpret_cast<const char*>(&rollbackSeqno),
+                       sizeof(rollbackSeqno)});
+            break;
+        case ENGINE_EWOULDBLOCK:
+        case ENGINE_DISCONNECT:
+            // Resume from (or give up on) this entry
+            return ret;
+        default:
+            addResult(cb::mcbp::to_status(cb::engine_errc(ret)), {});
+        }
+    }
+
+    cookie.sendResponse(cb::mcbp::Status::Success,
+                        {},
+                        {},
+                        response,
+                        cb::mcbp::Datatype::Raw,
+                        0);
+    return ENGINE_SUCCESS;
+}
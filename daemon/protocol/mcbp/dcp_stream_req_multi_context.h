@@ -0,0 +1,63 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include "steppable_command_context.h"
+
+#include <memcached/dcp.h>
+#include <memcached/protocol_binary.h>
+
+#include <string>
+
+/**
+ * The DcpStreamReqMultiCommandContext is a state machine used by the
+ * memcached core to implement DcpStreamReqMulti: the stream requests of
+ * several vbuckets in one message. Each entry is passed to the engine's
+ * stream_req in turn, and the results (the status and failover log or
+ * rollback seqno of each) are returned in a single response.
+ */
+class DcpStreamReqMultiCommandContext : public SteppableCommandContext {
+public:
+    explicit DcpStreamReqMultiCommandContext(Cookie& cookie);
+
+protected:
+    ENGINE_ERROR_CODE step() override;
+
+private:
+    /**
+     * The failover log callback passed to the engine; appends the log to
+     * the result of the current entry
+     */
+    static ENGINE_ERROR_CODE addFailoverLog(vbucket_failover_t* entries,
+                                            size_t nentries,
+                                            gsl::not_null<const void*> cookie);
+
+    /// Append the result of the current entry to the response value
+    void addResult(cb::mcbp::Status status, cb::const_char_buffer value);
+
+    const cb::mcbp::request::DcpStreamReqMultiEntry* const entries;
+    const size_t numEntries;
+
+    /// The entry to request next (the current one if the engine blocked)
+    size_t next = 0;
+
+    /// The failover log the engine returned for the current entry
+    std::string failoverLog;
+
+    /// The results of the entries requested
+    std::string response;
+};
@@ -138,6 +138,44 @@ cb::EngineErrorCasPair bucket_store_if(
     return ret;
 }
 
+cb::EngineErrorItemPair bucket_update(Cookie& cookie,
+                                      const DocKey& key,
+                                      Vbid vbucket,
+                                      uint64_t cas,
+                                      const cb::UpdateFunction& update) {
+    auto& c = cookie.getConnection();
+    auto ret = c.getBucketEngine()->update(&cookie, key, vbucket, cas, update);
+    if (ret.first == cb::engine_errc::success) {
+        using namespace cb::audit::document;
+        add(cookie, Operation::Modify);
+    } else if (ret.first == cb::engine_errc::disconnect) {
+        LOG_WARNING("{}: {} bucket_update return ENGINE_DISCONNECT",
+                    c.getId(),
+                    c.getDescription());
+    }
+
+    return ret;
+}
+
+cb::EngineErrorItemPair bucket_append(Cookie& cookie,
+                                      const DocKey& key,
+                                      Vbid vbucket,
+                                      uint64_t cas,
+                                      cb::const_char_buffer value) {
+    auto& c = cookie.getConnection();
+    auto ret = c.getBucketEngine()->append(&cookie, key, vbucket, cas, value);
+    if (ret.first == cb::engine_errc::success) {
+        using namespace cb::audit::document;
+        add(cookie, Operation::Modify);
+    } else if (ret.first == cb::engine_errc::disconnect) {
+        LOG_WARNING("{}: {} bucket_append return ENGINE_DISCONNECT",
+                    c.getId(),
+                    c.getDescription());
+    }
+
+    return ret;
+}
+
 ENGINE_ERROR_CODE bucket_remove(
         Cookie& cookie,
         const DocKey& key,
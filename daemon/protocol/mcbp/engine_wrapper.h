@@ -71,6 +71,18 @@ cb::EngineErrorCasPair bucket_store_if(
         boost::optional<cb::durability::Requirements> durability,
         DocumentState document_state = DocumentState::Alive);
 
+cb::EngineErrorItemPair bucket_update(Cookie& cookie,
+                                      const DocKey& key,
+                                      Vbid vbucket,
+                                      uint64_t cas,
+                                      const cb::UpdateFunction& update);
+
+cb::EngineErrorItemPair bucket_append(Cookie& cookie,
+                                      const DocKey& key,
+                                      Vbid vbucket,
+                                      uint64_t cas,
+                                      cb::const_char_buffer value);
+
 ENGINE_ERROR_CODE bucket_remove(
         Cookie& cookie,
         const DocKey& key,
@@ -115,7 +115,12 @@ ENGINE_ERROR_CODE GetCommandContext::sendResponse() {
         connection.addIov(key.data(), key.size());
     }
 
-    connection.addIov(payload.buf, payload.len);
+    if (payload.data() == buffer.data()) {
+        // Send the inflated copy of the document
+        connection.addIov(payload.buf, payload.len);
+    } else {
+        connection.addItemIov(it, payload.buf, payload.len);
+    }
     connection.setState(StateMachine::State::send_data);
     cb::audit::document::add(cookie, cb::audit::document::Operation::Read);
 
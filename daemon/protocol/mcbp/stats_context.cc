@@ -24,12 +24,16 @@
 #include <daemon/connection.h>
 #include <daemon/cookie.h>
 #include <daemon/executorpool.h>
+#include <daemon/external_auth_manager_thread.h>
 #include <daemon/mc_time.h>
 #include <daemon/mcaudit.h>
 #include <daemon/memcached.h>
+#include <daemon/request_log.h>
 #include <daemon/runtime.h>
 #include <daemon/settings.h>
+#include <daemon/slow_op_log.h>
 #include <daemon/stats.h>
+#include <daemon/stats_push.h>
 #include <daemon/stats_tasks.h>
 #include <daemon/topkeys.h>
 #include <mcbp/protocol/framebuilder.h>
@@ -39,8 +43,10 @@
 #include <phosphor/stats_callback.h>
 #include <phosphor/trace_log.h>
 #include <platform/checked_snprintf.h>
+#include <utilities/string_utilities.h>
 
 #include <gsl/gsl>
+#include <limits>
 
 /*************************** ADD STAT CALLBACKS ***************************/
 
@@ -229,6 +235,10 @@ static ENGINE_ERROR_CODE server_stats(const AddStatFn& add_stat_callback,
         add_stat(cookie, add_stat_callback, "listen_disabled_num",
                  get_listen_disabled_num());
         add_stat(cookie, add_stat_callback, "rejected_conns", stats.rejected_conns);
+        add_stat(cookie,
+                 add_stat_callback,
+                 "log_messages_dropped",
+                 cb::logger::getDroppedMessageCount());
         add_stat(cookie, add_stat_callback, "threads", settings.getNumWorkerThreads());
         add_stat(cookie, add_stat_callback, "conn_yields", thread_stats.conn_yields);
         add_stat(cookie, add_stat_callback, "rbufs_allocated",
@@ -276,6 +286,30 @@ static ENGINE_ERROR_CODE server_stats(const AddStatFn& add_stat_callback,
                  "total_resp_errors",
                  total_resp_errors);
 
+        const auto& admission =
+                cookie.getConnection().getBucket().admissionControl;
+        const auto pressure = admission.getPressure();
+        add_stat(cookie,
+                 add_stat_callback,
+                 "admission_control_rejected",
+                 admission.getRejected());
+        add_stat(cookie,
+                 add_stat_callback,
+                 "admission_control_pressure_memory",
+                 pressure.memory);
+        add_stat(cookie,
+                 add_stat_callback,
+                 "admission_control_pressure_disk_queue",
+                 pressure.diskQueue);
+        add_stat(cookie,
+                 add_stat_callback,
+                 "admission_control_pressure_checkpoint_memory",
+                 pressure.checkpointMemory);
+        add_stat(cookie,
+                 add_stat_callback,
+                 "admission_control_pressure_executor_backlog",
+                 pressure.executorBacklog);
+
     } catch (const std::bad_alloc&) {
         return ENGINE_ENOMEM;
     }
@@ -379,11 +413,15 @@ static ENGINE_ERROR_CODE stat_reset_executor(const std::string& arg,
         stats_reset(cookie);
         bucket_reset_stats(cookie);
         all_buckets[0].timings.reset();
-        all_buckets[cookie.getConnection().getBucketIndex()].timings.reset();
+        auto& bucket = all_buckets[cookie.getConnection().getBucketIndex()];
+        bucket.timings.reset();
+        bucket.keyspaceTimings.reset();
         return ENGINE_SUCCESS;
     } else if (arg == "timings") {
         // Nuke the command timings section for the connected bucket
-        all_buckets[cookie.getConnection().getBucketIndex()].timings.reset();
+        auto& bucket = all_buckets[cookie.getConnection().getBucketIndex()];
+        bucket.timings.reset();
+        bucket.keyspaceTimings.reset();
         return ENGINE_SUCCESS;
     } else {
         return ENGINE_EINVAL;
@@ -446,6 +484,25 @@ static ENGINE_ERROR_CODE stat_audit_executor(const std::string& arg,
     }
 }
 
+/**
+ * Handler for the <code>stats external_auth</code> used to get statistics
+ * for the requests to the external authentication service
+ *
+ * @param arg - should be empty
+ * @param cookie the command context
+ */
+static ENGINE_ERROR_CODE stat_external_auth_executor(const std::string& arg,
+                                                     Cookie& cookie) {
+    if (arg.empty()) {
+        if (externalAuthManager) {
+            externalAuthManager->addStats(appendStatsFn, &cookie);
+        }
+        return ENGINE_SUCCESS;
+    } else {
+        return ENGINE_EINVAL;
+    }
+}
+
 /**
  * Handler for the <code>stats bucket details</code> used to get information
  * of the buckets (type, state, #clients etc)
@@ -695,6 +752,244 @@ static ENGINE_ERROR_CODE stat_tracing_executor(const std::string& arg,
     }
 }
 
+/**
+ * Handler for the <code>stats slow_requests [count] [seconds]</code>
+ * command used to retrieve the slowest requests (10 by default) which
+ * completed in the last seconds (60 by default) from the request logs
+ * kept by each front end thread. The requests are returned as a JSON
+ * array (slowest first).
+ */
+static ENGINE_ERROR_CODE stat_slow_requests_executor(const std::string& arg,
+                                                     Cookie& cookie) {
+    size_t count = 10;
+    size_t seconds = 60;
+    try {
+        const auto args = split_string(arg, " ");
+        if (args.size() > 2) {
+            return ENGINE_EINVAL;
+        }
+        if (!args.empty() && !args[0].empty()) {
+            count = std::stoul(args[0]);
+        }
+        if (args.size() > 1) {
+            seconds = std::stoul(args[1]);
+        }
+    } catch (const std::exception&) {
+        return ENGINE_EINVAL;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    nlohmann::json array = nlohmann::json::array();
+    for (const auto& record : cb::getSlowestRequests(
+                 request_logs, count, std::chrono::seconds(seconds))) {
+        array.push_back(record.toJSON(now));
+    }
+
+    const auto value = array.dump();
+    const std::string key = "slow_requests";
+    append_stats(key.data(),
+                 gsl::narrow<uint16_t>(key.size()),
+                 value.data(),
+                 gsl::narrow<uint32_t>(value.size()),
+                 &cookie);
+    return ENGINE_SUCCESS;
+}
+
+/**
+ * Handler for the <code>stats slow_ops [count]</code> command used to
+ * retrieve the most recent requests (10 by default) captured in the slow
+ * operation log, with their trace spans and connection details. The
+ * requests are returned as a JSON array (most recent first).
+ */
+static ENGINE_ERROR_CODE stat_slow_ops_executor(const std::string& arg,
+                                                Cookie& cookie) {
+    size_t count = 10;
+    if (!arg.empty()) {
+        try {
+            count = std::stoul(arg);
+        } catch (const std::exception&) {
+            return ENGINE_EINVAL;
+        }
+    }
+
+    nlohmann::json array = nlohmann::json::array();
+    for (const auto& record : cb::slowOpLog.getRecords(count)) {
+        array.push_back(record.toJSON());
+    }
+
+    const auto value = array.dump();
+    const std::string key = "slow_ops";
+    append_stats(key.data(),
+                 gsl::narrow<uint16_t>(key.size()),
+                 value.data(),
+                 gsl::narrow<uint32_t>(value.size()),
+                 &cookie);
+    return ENGINE_SUCCESS;
+}
+
+/**
+ * Handler for the <code>stats opcode_costs [aggregate]</code> command used
+ * to retrieve the resources consumed by each opcode executed against the
+ * connected bucket (or all buckets if "aggregate" is specified). Each
+ * opcode executed is returned as a JSON object holding the number of
+ * commands, the time the front end threads spent executing them and the
+ * time they spent blocked waiting for the engine, and the bytes the front
+ * end threads allocated executing them.
+ */
+static ENGINE_ERROR_CODE stat_opcode_costs_executor(const std::string& arg,
+                                                    Cookie& cookie) {
+    size_t bucketIndex;
+    if (arg.empty()) {
+        bucketIndex = cookie.getConnection().getBucketIndex();
+    } else if (arg == "aggregate") {
+        // index 0 contains the aggregated timings for all buckets
+        bucketIndex = 0;
+    } else {
+        return ENGINE_EINVAL;
+    }
+
+    const auto& timings = all_buckets[bucketIndex].timings;
+    for (int ii = 0; ii < MAX_NUM_OPCODES; ++ii) {
+        const auto opcode = cb::mcbp::ClientOpcode(ii);
+        if (!cb::mcbp::is_valid_opcode(opcode)) {
+            continue;
+        }
+        const auto cost = timings.getCost(opcode);
+        if (cost.count == 0) {
+            continue;
+        }
+        nlohmann::json json;
+        json["count"] = cost.count;
+        json["execution_ns"] = cost.execution.count();
+        json["blocked_ns"] = cost.blocked.count();
+        json["allocated_bytes"] = cost.allocated;
+        const auto key = to_string(opcode);
+        const auto value = json.dump();
+        append_stats(key.data(),
+                     gsl::narrow<uint16_t>(key.size()),
+                     value.data(),
+                     gsl::narrow<uint32_t>(value.size()),
+                     &cookie);
+    }
+    return ENGINE_SUCCESS;
+}
+
+/// Add the summary of a keyspace latency sketch as a JSON object
+static void append_latency_summary(Cookie& cookie,
+                                   const std::string& key,
+                                   const cb::LatencySketch& sketch) {
+    nlohmann::json json;
+    json["count"] = sketch.getCount();
+    json["p50_us"] = sketch.getPercentile(50).count();
+    json["p90_us"] = sketch.getPercentile(90).count();
+    json["p99_us"] = sketch.getPercentile(99).count();
+    json["p999_us"] = sketch.getPercentile(99.9).count();
+    const auto value = json.dump();
+    append_stats(key.data(),
+                 gsl::narrow<uint16_t>(key.size()),
+                 value.data(),
+                 gsl::narrow<uint32_t>(value.size()),
+                 &cookie);
+}
+
+/// Add the histogram of a keyspace latency sketch (nullptr if the sketch
+/// doesn't exist yet) without a key, as expected by mctimings
+static void append_latency_histogram(Cookie& cookie,
+                                     const cb::LatencySketch* sketch) {
+    static const cb::LatencySketch empty;
+    const auto value = (sketch ? sketch : &empty)->to_json().dump();
+    append_stats(nullptr,
+                 0,
+                 value.data(),
+                 gsl::narrow<uint32_t>(value.size()),
+                 &cookie);
+}
+
+/**
+ * Handler for the <code>stats vbucket_timings [vbid]</code> command used
+ * to retrieve the latency of the document operations executed against
+ * each vbucket of the connected bucket (recorded if keyspace_timings is
+ * enabled). Each vbucket used is returned as a JSON object holding the
+ * number of operations and the estimated 50th, 90th, 99th and 99.9th
+ * percentiles. If a vbucket is specified its latency histogram is returned
+ * instead (in the format used by mctimings).
+ */
+static ENGINE_ERROR_CODE stat_vbucket_timings_executor(const std::string& arg,
+                                                       Cookie& cookie) {
+    const auto& timings =
+            all_buckets[cookie.getConnection().getBucketIndex()]
+                    .keyspaceTimings;
+    if (arg.empty()) {
+        timings.forEachVBucket(
+                [&cookie](Vbid vbid, const cb::LatencySketch& sketch) {
+                    append_latency_summary(cookie, vbid.to_string(), sketch);
+                });
+        return ENGINE_SUCCESS;
+    }
+
+    try {
+        size_t pos = 0;
+        const auto vbid = std::stoul(arg, &pos);
+        if (pos != arg.size() ||
+            vbid > std::numeric_limits<Vbid::id_type>::max()) {
+            return ENGINE_EINVAL;
+        }
+        append_latency_histogram(cookie,
+                                 timings.getVBucket(Vbid(Vbid::id_type(vbid))));
+    } catch (const std::exception&) {
+        return ENGINE_EINVAL;
+    }
+    return ENGINE_SUCCESS;
+}
+
+/**
+ * Handler for the <code>stats collection_timings [cid]</code> command
+ * used to retrieve the latency of the document operations executed
+ * against each collection of the connected bucket (recorded if
+ * keyspace_timings is enabled), in the same format as vbucket_timings.
+ * The collection id is given in hex (as in the manifest).
+ */
+static ENGINE_ERROR_CODE stat_collection_timings_executor(
+        const std::string& arg, Cookie& cookie) {
+    const auto& timings =
+            all_buckets[cookie.getConnection().getBucketIndex()]
+                    .keyspaceTimings;
+    if (arg.empty()) {
+        timings.forEachCollection(
+                [&cookie](CollectionID cid, const cb::LatencySketch& sketch) {
+                    append_latency_summary(cookie, cid.to_string(), sketch);
+                });
+        return ENGINE_SUCCESS;
+    }
+
+    try {
+        size_t pos = 0;
+        const auto cid = std::stoul(arg, &pos, 16);
+        if (pos != arg.size() ||
+            cid > std::numeric_limits<CollectionIDType>::max()) {
+            return ENGINE_EINVAL;
+        }
+        append_latency_histogram(
+                cookie,
+                timings.getCollection(
+                        CollectionID(CollectionIDType(cid),
+                                     CollectionID::SkipIDVerificationTag{})));
+    } catch (const std::exception&) {
+        return ENGINE_EINVAL;
+    }
+    return ENGINE_SUCCESS;
+}
+
+ENGINE_ERROR_CODE collect_stats_group(Cookie& cookie,
+                                      const std::string& group,
+                                      const AddStatFn& add_stat) {
+    auto ret = bucket_get_stats(cookie, group, add_stat);
+    if (ret == ENGINE_SUCCESS && group.empty()) {
+        ret = server_stats(add_stat, cookie);
+    }
+    return ret;
+}
+
 static ENGINE_ERROR_CODE stat_all_stats(const std::string& arg,
                                         Cookie& cookie) {
     auto ret = bucket_get_stats(cookie, arg, appendStatsFn);
@@ -709,6 +1004,166 @@ static ENGINE_ERROR_CODE stat_bucket_stats(const std::string& arg,
     return bucket_get_stats(cookie, arg, appendStatsFn);
 }
 
+/**
+ * Handler for the <code>stats json [token=&lt;token&gt;] [group]</code>
+ * command used to retrieve the stats for the group (or the default
+ * bucket and core stats if no group is specified) as a single JSON
+ * document instead of one response per stat. If the token returned in
+ * the previous "stats json" response on the connection is provided only
+ * the stats which changed since then are returned.
+ *
+ * The stats are collected in the front end thread (as the engine
+ * requires), but the comparison with the previous snapshot and the
+ * encoding is performed by a background task.
+ */
+static ENGINE_ERROR_CODE stat_json_executor(const std::string& arg,
+                                            Cookie& cookie) {
+    uint64_t token = 0;
+    std::string group = arg;
+    const std::string prefix = "token=";
+    if (group.compare(0, prefix.size(), prefix) == 0) {
+        auto idx = group.find(' ');
+        const auto value = group.substr(prefix.size(), idx - prefix.size());
+        try {
+            size_t pos = 0;
+            token = std::stoull(value, &pos);
+            if (pos != value.size()) {
+                return ENGINE_EINVAL;
+            }
+        } catch (const std::exception&) {
+            return ENGINE_EINVAL;
+        }
+        group = idx == std::string::npos ? "" : group.substr(idx + 1);
+    }
+
+    std::vector<std::pair<std::string, std::string>> stats;
+    AddStatFn collect = [&stats](const char* key,
+                                 const uint16_t klen,
+                                 const char* val,
+                                 const uint32_t vlen,
+                                 gsl::not_null<const void*>) {
+        stats.emplace_back(std::string{key, klen}, std::string{val, vlen});
+    };
+
+    auto ret = collect_stats_group(cookie, group, collect);
+    if (ret != ENGINE_SUCCESS) {
+        return ret;
+    }
+
+    std::shared_ptr<Task> task = std::make_shared<StatsTaskJsonStats>(
+            cookie.getConnection(),
+            cookie,
+            appendStatsFn,
+            std::move(stats),
+            token);
+    cookie.obtainContext<StatsCommandContext>(cookie).setTask(task);
+    std::lock_guard<std::mutex> guard(task->getMutex());
+    executorPool->schedule(task, true);
+
+    return ENGINE_EWOULDBLOCK;
+}
+
+/**
+ * Handler for the <code>stats subscribe &lt;interval&gt; [group]</code>
+ * command used to have the stats for the group (or the default bucket and
+ * server stats) pushed to the client every interval seconds instead of
+ * polling them. The connection must be in duplex mode, and may only have
+ * one subscription (a new one replaces it). The response holds all of
+ * the stats (as a "stats json" document named "subscribe"), and the
+ * StatsPush messages which follow only the stats which changed since the
+ * previous one. Groups the engine can't collect immediately (it returns
+ * EWOULDBLOCK) can't be subscribed to.
+ */
+static ENGINE_ERROR_CODE stat_subscribe_executor(const std::string& arg,
+                                                 Cookie& cookie) {
+    auto& connection = cookie.getConnection();
+    if (!connection.isDuplexSupported()) {
+        cookie.setErrorContext("Subscribing to stats requires duplex mode");
+        return ENGINE_ENOTSUP;
+    }
+
+    const auto idx = arg.find(' ');
+    const auto value = arg.substr(0, idx);
+    const auto group = idx == std::string::npos ? "" : arg.substr(idx + 1);
+    uint64_t interval;
+    try {
+        size_t pos = 0;
+        interval = std::stoull(value, &pos);
+        if (pos != value.size()) {
+            return ENGINE_EINVAL;
+        }
+    } catch (const std::exception&) {
+        return ENGINE_EINVAL;
+    }
+    if (interval == 0 || interval > 3600) {
+        cookie.setErrorContext("The interval must be 1-3600 seconds");
+        return ENGINE_EINVAL;
+    }
+
+    // The engine may keep the callback (and complete the collection in
+    // the background), so it must own the stats it adds to
+    auto stats = std::make_shared<StatsPushCache::Stats>();
+    AddStatFn collect = [stats](const char* key,
+                                const uint16_t klen,
+                                const char* val,
+                                const uint32_t vlen,
+                                gsl::not_null<const void*>) {
+        stats->emplace_back(std::string{key, klen}, std::string{val, vlen});
+    };
+    const auto ret = collect_stats_group(cookie, group, collect);
+    if (ret == ENGINE_EWOULDBLOCK) {
+        // Let the engine complete the request before rejecting it, as it
+        // will notify the cookie
+        connection.setStatsSubscribeBlocked(true);
+        return ret;
+    }
+    if (connection.isStatsSubscribeBlocked()) {
+        connection.setStatsSubscribeBlocked(false);
+        cookie.setErrorContext(
+                "The stats group is collected in the background and can't "
+                "be pushed");
+        return ENGINE_ENOTSUP;
+    }
+    if (ret != ENGINE_SUCCESS) {
+        return ret;
+    }
+
+    auto& bucket = connection.getBucket();
+    bucket.statsPushCache.put(group, stats);
+
+    auto subscription = std::make_unique<StatsSubscription>();
+    subscription->group = group;
+    subscription->interval = std::chrono::seconds(interval);
+    subscription->bucketIndex = connection.getBucketIndex();
+    subscription->next =
+            std::chrono::steady_clock::now() + subscription->interval;
+    auto values = *stats;
+    const auto doc = makeStatsDocument(subscription->snapshot, values, false);
+    connection.setStatsSubscription(std::move(subscription));
+
+    const auto payload = doc.dump();
+    const std::string key = "subscribe";
+    append_stats(key.data(),
+                 gsl::narrow<uint16_t>(key.size()),
+                 payload.data(),
+                 gsl::narrow<uint32_t>(payload.size()),
+                 &cookie);
+    return ENGINE_SUCCESS;
+}
+
+/**
+ * Handler for the <code>stats unsubscribe</code> command used to cancel
+ * the connection's stats subscription (if any)
+ */
+static ENGINE_ERROR_CODE stat_unsubscribe_executor(const std::string& arg,
+                                                   Cookie& cookie) {
+    if (!arg.empty()) {
+        return ENGINE_EINVAL;
+    }
+    cookie.getConnection().setStatsSubscription({});
+    return ENGINE_SUCCESS;
+}
+
 /***************************** STAT HANDLERS *****************************/
 
 struct command_stat_handler {
@@ -733,6 +1188,7 @@ static std::unordered_map<std::string, struct command_stat_handler>
                 {"reset", {true, stat_reset_executor}},
                 {"worker_thread_info", {false, stat_sched_executor}},
                 {"audit", {true, stat_audit_executor}},
+                {"external_auth", {true, stat_external_auth_executor}},
                 {"bucket_details", {true, stat_bucket_details_executor}},
                 {"aggregate", {false, stat_aggregate_executor}},
                 {"connections", {false, stat_connections_executor}},
@@ -740,6 +1196,15 @@ static std::unordered_map<std::string, struct command_stat_handler>
                 {"topkeys_json", {false, stat_topkeys_json_executor}},
                 {"subdoc_execute", {false, stat_subdoc_execute_executor}},
                 {"responses", {false, stat_responses_json_executor}},
+                {"json", {false, stat_json_executor}},
+                {"subscribe", {true, stat_subscribe_executor}},
+                {"unsubscribe", {false, stat_unsubscribe_executor}},
+                {"slow_requests", {true, stat_slow_requests_executor}},
+                {"slow_ops", {true, stat_slow_ops_executor}},
+                {"opcode_costs", {true, stat_opcode_costs_executor}},
+                {"vbucket_timings", {true, stat_vbucket_timings_executor}},
+                {"collection_timings",
+                 {true, stat_collection_timings_executor}},
                 {"tracing", {true, stat_tracing_executor}}};
 
 /**
@@ -19,10 +19,22 @@
 #include "steppable_command_context.h"
 
 #include <daemon/cookie.h>
+#include <memcached/engine_common.h>
 #include <platform/sized_buffer.h>
 
+#include <string>
+
 class Task;
 
+/**
+ * Collect the stats of a group from the connected bucket (and for the
+ * default group, the server stats too). Used by "stats json" and to push
+ * the stats to the subscribers of a group.
+ */
+ENGINE_ERROR_CODE collect_stats_group(Cookie& cookie,
+                                      const std::string& group,
+                                      const AddStatFn& add_stat);
+
 /**
  * The StatsCommandContext is responsible for implementing all of the
  * various stats commands (including the sub commands).
@@ -0,0 +1,59 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "request_arena.h"
+
+namespace cb {
+
+static constexpr size_t Alignment = alignof(std::max_align_t);
+
+void* RequestArena::allocate(size_t size) {
+    const auto aligned = (size + Alignment - 1) & ~(Alignment - 1);
+    if (aligned < size || aligned > BlockSize - offset) {
+        return nullptr;
+    }
+
+    if (!block) {
+        // operator new[] returns memory aligned for std::max_align_t
+        block.reset(new char[BlockSize]);
+    }
+
+    void* ret = block.get() + offset;
+    offset += aligned;
+    ++live;
+    return ret;
+}
+
+void RequestArena::deallocate(void* ptr) noexcept {
+    // The memory is reclaimed when the arena is rewound; all we need to
+    // track is that the allocation is no longer in use.
+    if (owns(ptr) && live > 0) {
+        --live;
+    }
+}
+
+void RequestArena::reset() {
+    if (live == 0) {
+        offset = 0;
+    }
+}
+
+bool RequestArena::owns(const void* ptr) const {
+    const auto* p = static_cast<const char*>(ptr);
+    return block && p >= block.get() && p < block.get() + BlockSize;
+}
+
+} // namespace cb
@@ -0,0 +1,82 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+namespace cb {
+
+/**
+ * A small bump allocator used for the objects which only live for the
+ * duration of a single request (the command contexts). Each Cookie owns
+ * an arena which is rewound when the cookie is reset, so a connection
+ * executing a stream of commands reuses the same block of memory instead
+ * of going to the allocator for every command.
+ *
+ * The arena keeps track of the number of live allocations and refuses to
+ * rewind while any of them are still in use (for instance a command
+ * context kept alive by a queued response). Allocations which don't fit
+ * in the remaining space return nullptr and the caller should fall back
+ * to the heap.
+ *
+ * The arena is not thread safe; it is owned by a cookie and only used by
+ * the front end thread serving the connection.
+ */
+class RequestArena {
+public:
+    /// The size of the block backing the arena
+    static constexpr size_t BlockSize = 4096;
+
+    RequestArena() = default;
+    RequestArena(const RequestArena&) = delete;
+    RequestArena& operator=(const RequestArena&) = delete;
+
+    /**
+     * Allocate size bytes (aligned for any type) from the arena
+     *
+     * @return the allocated memory or nullptr if it doesn't fit
+     */
+    void* allocate(size_t size);
+
+    /// Release an allocation returned from allocate()
+    void deallocate(void* ptr) noexcept;
+
+    /// Rewind the arena (if there are no live allocations)
+    void reset();
+
+    /// Does the pointer refer to memory inside this arena?
+    bool owns(const void* ptr) const;
+
+    size_t getLiveAllocations() const {
+        return live;
+    }
+
+    size_t getBytesUsed() const {
+        return offset;
+    }
+
+protected:
+    /// The memory backing the arena (allocated on first use)
+    std::unique_ptr<char[]> block;
+    /// The offset of the next free byte in the block
+    size_t offset = 0;
+    /// The number of allocations not yet released
+    size_t live = 0;
+};
+
+} // namespace cb
@@ -0,0 +1,155 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "request_log.h"
+
+#include <nlohmann/json.hpp>
+#include <platform/string_hex.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace cb {
+
+static_assert((RequestLog::Size & (RequestLog::Size - 1)) == 0,
+              "RequestLog::Size must be a power of 2");
+
+static uint64_t saturate32(std::chrono::microseconds value) {
+    return uint64_t(std::min(int64_t(std::numeric_limits<uint32_t>::max()),
+                             std::max(int64_t(0), int64_t(value.count()))));
+}
+
+nlohmann::json RequestRecord::toJSON(
+        std::chrono::steady_clock::time_point now) const {
+    using namespace std::chrono;
+    nlohmann::json ret;
+    const auto completed = system_clock::now() -
+                           duration_cast<system_clock::duration>(now - end);
+    ret["timestamp_us"] =
+            duration_cast<microseconds>(completed.time_since_epoch()).count();
+    try {
+        ret["opcode"] = to_string(opcode);
+    } catch (const std::exception&) {
+        ret["opcode"] = cb::to_hex(uint8_t(opcode));
+    }
+    ret["bucket_index"] = bucket;
+    ret["connection_id"] = connectionId;
+    ret["opaque"] = cb::to_hex(opaque);
+    ret["bodylen"] = bodylen;
+    ret["duration_us"] = duration.count();
+    ret["blocked_us"] = blocked.count();
+    ret["blocked_count"] = blockedCount;
+    return ret;
+}
+
+RequestLog::RequestLog() : slots(new Slot[Size]) {
+}
+
+void RequestLog::record(const RequestRecord& record) {
+    const auto idx = next.load(std::memory_order_relaxed);
+    auto& slot = slots[idx & (Size - 1)];
+
+    // Mark the slot as being written (odd sequence number)
+    const auto sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.words[0].store(uint64_t(record.end.time_since_epoch().count()),
+                        std::memory_order_relaxed);
+    slot.words[1].store(
+            (saturate32(record.duration) << 32) | saturate32(record.blocked),
+            std::memory_order_relaxed);
+    slot.words[2].store((uint64_t(record.connectionId) << 32) |
+                                (uint64_t(record.bucket) << 16) |
+                                (uint64_t(uint8_t(record.opcode)) << 8) |
+                                uint64_t(record.blockedCount),
+                        std::memory_order_relaxed);
+    slot.words[3].store((uint64_t(record.opaque) << 32) | record.bodylen,
+                        std::memory_order_relaxed);
+
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+    next.store(idx + 1, std::memory_order_release);
+}
+
+void RequestLog::getRecords(std::chrono::steady_clock::time_point since,
+                            std::vector<RequestRecord>& records) const {
+    const auto end = next.load(std::memory_order_acquire);
+    const auto begin = end > Size ? end - Size : 0;
+
+    for (auto idx = begin; idx < end; ++idx) {
+        const auto& slot = slots[idx & (Size - 1)];
+        const auto before = slot.sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            // Being written
+            continue;
+        }
+
+        std::array<uint64_t, 4> words;
+        for (size_t ii = 0; ii < words.size(); ++ii) {
+            words[ii] = slot.words[ii].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != before) {
+            // Overwritten while we read it
+            continue;
+        }
+
+        RequestRecord record;
+        record.end = std::chrono::steady_clock::time_point(
+                std::chrono::steady_clock::duration(int64_t(words[0])));
+        if (record.end < since) {
+            continue;
+        }
+        record.duration = std::chrono::microseconds(words[1] >> 32);
+        record.blocked = std::chrono::microseconds(words[1] & 0xffffffff);
+        record.connectionId = uint32_t(words[2] >> 32);
+        record.bucket = uint16_t(words[2] >> 16);
+        record.opcode = cb::mcbp::ClientOpcode(uint8_t(words[2] >> 8));
+        record.blockedCount = uint8_t(words[2]);
+        record.opaque = uint32_t(words[3] >> 32);
+        record.bodylen = uint32_t(words[3]);
+        records.push_back(record);
+    }
+}
+
+std::vector<RequestRecord> getSlowestRequests(
+        const std::vector<std::unique_ptr<RequestLog>>& logs,
+        size_t count,
+        std::chrono::steady_clock::duration window) {
+    const auto since = std::chrono::steady_clock::now() - window;
+    std::vector<RequestRecord> records;
+    for (const auto& log : logs) {
+        if (log) {
+            log->getRecords(since, records);
+        }
+    }
+
+    const auto slowest = [](const RequestRecord& a, const RequestRecord& b) {
+        return a.duration > b.duration;
+    };
+    if (records.size() > count) {
+        std::partial_sort(records.begin(),
+                          records.begin() + count,
+                          records.end(),
+                          slowest);
+        records.resize(count);
+    } else {
+        std::sort(records.begin(), records.end(), slowest);
+    }
+    return records;
+}
+
+} // namespace cb
@@ -0,0 +1,110 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <mcbp/protocol/opcode.h>
+#include <nlohmann/json_fwd.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace cb {
+
+/**
+ * A compact record of a single request executed by a front end thread
+ */
+struct RequestRecord {
+    /// When the request completed
+    std::chrono::steady_clock::time_point end;
+    /// The total time from the request was received until it completed
+    std::chrono::microseconds duration{0};
+    /// The part of the duration spent waiting for the engine
+    std::chrono::microseconds blocked{0};
+    uint32_t connectionId = 0;
+    uint32_t opaque = 0;
+    /// The size of the request body
+    uint32_t bodylen = 0;
+    uint16_t bucket = 0;
+    cb::mcbp::ClientOpcode opcode = cb::mcbp::ClientOpcode::Invalid;
+    /// The number of times the request blocked (saturates at 255)
+    uint8_t blockedCount = 0;
+
+    /**
+     * Get a JSON representation of the record
+     *
+     * @param now the current (steady clock) time used to calculate the
+     *            wall clock time the request completed
+     */
+    nlohmann::json toJSON(std::chrono::steady_clock::time_point now) const;
+};
+
+/**
+ * A fixed size ring buffer of the most recent requests executed by a
+ * front end thread.
+ *
+ * Only the owning thread may record requests, but any thread may read
+ * the records at any time without blocking the writer. Each slot is
+ * protected by a sequence number (a seqlock) so the readers can detect
+ * (and skip) slots which are overwritten while they're being read.
+ */
+class RequestLog {
+public:
+    /// The number of requests kept (must be a power of 2)
+    static constexpr size_t Size = 4096;
+
+    RequestLog();
+    RequestLog(const RequestLog&) = delete;
+
+    /// Record a request (must only be called by the owning thread)
+    void record(const RequestRecord& record);
+
+    /**
+     * Append a copy of all of the records for requests which completed
+     * at or after the provided time to the vector
+     */
+    void getRecords(std::chrono::steady_clock::time_point since,
+                    std::vector<RequestRecord>& records) const;
+
+protected:
+    struct Slot {
+        std::atomic<uint64_t> sequence{0};
+        std::array<std::atomic<uint64_t>, 4> words;
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    /// The number of records written so far
+    std::atomic<uint64_t> next{0};
+};
+
+/**
+ * Get the slowest requests recorded in the logs which completed within
+ * the window, slowest first
+ *
+ * @param logs the logs to search
+ * @param count the maximum number of requests to return
+ * @param window how far back in time to look
+ */
+std::vector<RequestRecord> getSlowestRequests(
+        const std::vector<std::unique_ptr<RequestLog>>& logs,
+        size_t count,
+        std::chrono::steady_clock::duration window);
+
+} // namespace cb
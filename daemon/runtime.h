@@ -24,6 +24,7 @@
 
 #include <openssl/ossl_typ.h>
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -41,3 +42,9 @@ bool is_default_bucket_enabled();
 void set_default_bucket_enabled(bool enabled);
 
 extern std::vector<Hdr1sfMicroSecHistogram> scheduler_info;
+
+namespace cb {
+class RequestLog;
+}
+/// The log of the recent requests executed by each front end thread
+extern std::vector<std::unique_ptr<cb::RequestLog>> request_logs;
@@ -0,0 +1,420 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "sampling_profiler.h"
+
+#include "connection.h"
+#include "cookie.h"
+
+#include <logger/logger.h>
+#include <nlohmann/json.hpp>
+
+#ifdef __linux__
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+/// The deepest stack recorded (deeper stacks lose their outermost frames)
+constexpr size_t MaxDepth = 32;
+
+/// The number of samples the ring buffer holds (~9MB)
+constexpr size_t NumSamples = 32768;
+
+/// The frames of the signal handler and the signal trampoline
+constexpr int HandlerFrames = 2;
+
+/**
+ * One sample, written by the signal handler of the thread being sampled.
+ * The seqno is odd while the sample is being written and 2 * (index + 1)
+ * once sample <index> is complete, so readers can detect (and skip) torn
+ * samples without the handler taking a lock.
+ */
+struct Sample {
+    std::atomic<uint64_t> seqno{0};
+    std::atomic<uint64_t> timestamp{0};
+    std::atomic<pid_t> tid{0};
+    std::atomic<uint32_t> depth{0};
+    std::array<std::atomic<void*>, MaxDepth> frames;
+};
+
+struct SampleBuffer {
+    std::atomic<uint64_t> next{0};
+    std::array<Sample, NumSamples> samples;
+};
+
+/// Allocated on the first start, and never freed as a signal may be
+/// delivered after the profiler was stopped.
+std::atomic<SampleBuffer*> buffer{nullptr};
+std::atomic<bool> running{false};
+std::atomic<uint64_t> dropped{0};
+
+/// Serialises starting, stopping and dumping.
+std::mutex profilerMutex;
+unsigned int frequency = 0;
+uint64_t startTimestamp = 0;
+
+uint64_t monotonicNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * The SIGPROF handler: records the stack of the interrupted thread. Only
+ * uses async-signal-safe calls (backtrace() is made safe by calling it once
+ * before the first signal, which loads the unwinder).
+ */
+void handleSigprof(int, siginfo_t*, void*) {
+    auto* samples = buffer.load(std::memory_order_acquire);
+    if (samples == nullptr || !running.load(std::memory_order_relaxed)) {
+        return;
+    }
+    const int savedErrno = errno;
+
+    std::array<void*, MaxDepth + HandlerFrames> frames;
+    const int depth = backtrace(frames.data(), frames.size());
+    if (depth <= HandlerFrames) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        errno = savedErrno;
+        return;
+    }
+
+    const auto index = samples->next.fetch_add(1, std::memory_order_relaxed);
+    auto& sample = samples->samples[index % NumSamples];
+    sample.seqno.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    sample.timestamp.store(monotonicNs(), std::memory_order_relaxed);
+    sample.tid.store(pid_t(syscall(SYS_gettid)), std::memory_order_relaxed);
+    sample.depth.store(depth - HandlerFrames, std::memory_order_relaxed);
+    for (int ii = HandlerFrames; ii < depth; ++ii) {
+        sample.frames[ii - HandlerFrames].store(frames[ii],
+                                               std::memory_order_relaxed);
+    }
+    sample.seqno.store(2 * (index + 1), std::memory_order_release);
+
+    errno = savedErrno;
+}
+
+void startProfiler(unsigned int hz) {
+    if (buffer.load() == nullptr) {
+        // The first backtrace() call may allocate (loading libgcc_s); make
+        // it here and not in the signal handler.
+        std::array<void*, 1> frame;
+        backtrace(frame.data(), frame.size());
+        buffer.store(new SampleBuffer(), std::memory_order_release);
+
+        struct sigaction sa = {};
+        sa.sa_sigaction = handleSigprof;
+        sa.sa_flags = SA_SIGINFO | SA_RESTART;
+        sigemptyset(&sa.sa_mask);
+        if (sigaction(SIGPROF, &sa, nullptr) != 0) {
+            throw std::system_error(
+                    errno, std::system_category(), "sigaction(SIGPROF)");
+        }
+    }
+
+    startTimestamp = monotonicNs();
+    frequency = hz;
+    running.store(true);
+
+    const auto interval = std::chrono::microseconds(1000000 / hz);
+    itimerval timer = {};
+    timer.it_interval.tv_sec = interval.count() / 1000000;
+    timer.it_interval.tv_usec = interval.count() % 1000000;
+    timer.it_value = timer.it_interval;
+    if (setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+        running.store(false);
+        throw std::system_error(
+                errno, std::system_category(), "setitimer(ITIMER_PROF)");
+    }
+}
+
+void stopProfiler() {
+    // The handler stays installed (the default action of SIGPROF is to
+    // terminate the process) and ignores any signal still in flight.
+    itimerval timer = {};
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    running.store(false);
+}
+
+std::string getThreadName(pid_t tid) {
+    std::ifstream comm("/proc/self/task/" + std::to_string(tid) + "/comm");
+    std::string name;
+    if (comm && std::getline(comm, name) && !name.empty()) {
+        return name;
+    }
+    // The thread has exited since the sample was taken
+    return "tid-" + std::to_string(tid);
+}
+
+std::string symbolize(void* pc, bool innermost) {
+    // Every frame but the innermost holds a return address, which may
+    // belong to the next function; look up the call instruction instead.
+    auto* addr = innermost ? pc : static_cast<char*>(pc) - 1;
+    Dl_info info = {};
+    if (dladdr(addr, &info) == 0) {
+        info = {};
+    }
+    std::string name;
+    if (info.dli_sname != nullptr) {
+        int status;
+        char* demangled =
+                abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+        if (demangled != nullptr) {
+            name = demangled;
+            std::free(demangled);
+        } else {
+            name = info.dli_sname;
+        }
+    } else {
+        char offset[32];
+        if (info.dli_fname != nullptr) {
+            std::string module = info.dli_fname;
+            module = module.substr(module.find_last_of('/') + 1);
+            snprintf(offset,
+                     sizeof(offset),
+                     "+0x%zx",
+                     size_t(static_cast<char*>(addr) -
+                            static_cast<char*>(info.dli_fbase)));
+            name = module + offset;
+        } else {
+            snprintf(offset, sizeof(offset), "%p", addr);
+            name = offset;
+        }
+    }
+    // ';' separates the frames of a folded stack
+    for (auto& c : name) {
+        if (c == ';') {
+            c = ':';
+        }
+    }
+    return name;
+}
+
+/**
+ * Fold the samples taken since the given (CLOCK_MONOTONIC) timestamp into
+ * "<thread>;<frames...> <count>" lines.
+ */
+std::string dumpProfile(uint64_t since) {
+    auto* samples = buffer.load(std::memory_order_acquire);
+    if (samples == nullptr) {
+        return {};
+    }
+
+    // Count the distinct (thread, stack) pairs, innermost frame first
+    std::map<std::pair<pid_t, std::vector<void*>>, size_t> stacks;
+    for (auto& sample : samples->samples) {
+        const auto seqno = sample.seqno.load(std::memory_order_acquire);
+        if (seqno == 0 || (seqno & 1)) {
+            continue;
+        }
+        const auto timestamp = sample.timestamp.load(std::memory_order_relaxed);
+        const auto tid = sample.tid.load(std::memory_order_relaxed);
+        const auto depth = std::min(
+                size_t(sample.depth.load(std::memory_order_relaxed)), MaxDepth);
+        std::vector<void*> frames(depth);
+        for (size_t ii = 0; ii < depth; ++ii) {
+            frames[ii] = sample.frames[ii].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sample.seqno.load(std::memory_order_relaxed) != seqno ||
+            timestamp < since) {
+            continue;
+        }
+        ++stacks[{tid, std::move(frames)}];
+    }
+
+    std::unordered_map<pid_t, std::string> threadNames;
+    std::unordered_map<void*, std::string> innerNames;
+    std::unordered_map<void*, std::string> outerNames;
+    std::string folded;
+    for (const auto& stack : stacks) {
+        const auto tid = stack.first.first;
+        auto name = threadNames.find(tid);
+        if (name == threadNames.end()) {
+            name = threadNames.emplace(tid, getThreadName(tid)).first;
+        }
+        folded += name->second;
+
+        const auto& frames = stack.first.second;
+        for (auto frame = frames.rbegin(); frame != frames.rend(); ++frame) {
+            const bool innermost = (frame + 1) == frames.rend();
+            auto& names = innermost ? innerNames : outerNames;
+            auto symbol = names.find(*frame);
+            if (symbol == names.end()) {
+                symbol = names.emplace(*frame, symbolize(*frame, innermost))
+                                 .first;
+            }
+            folded += ';';
+            folded += symbol->second;
+        }
+        folded += ' ';
+        folded += std::to_string(stack.second);
+        folded += '\n';
+    }
+    return folded;
+}
+
+} // namespace
+
+void stopSamplingProfiler() {
+    std::lock_guard<std::mutex> guard(profilerMutex);
+    if (running) {
+        stopProfiler();
+    }
+}
+
+ENGINE_ERROR_CODE ioctlSetProfilerStart(Cookie& cookie,
+                                        const StrToStrMap&,
+                                        const std::string& value) {
+    unsigned int hz = 99;
+    if (!value.empty()) {
+        try {
+            hz = std::stoul(value);
+        } catch (const std::exception&) {
+            hz = 0;
+        }
+        if (hz < 1 || hz > 1000) {
+            cookie.setErrorContext(
+                    "Sampling frequency must be between 1 and 1000 Hz");
+            return ENGINE_EINVAL;
+        }
+    }
+
+    std::lock_guard<std::mutex> guard(profilerMutex);
+    try {
+        startProfiler(hz);
+    } catch (const std::exception& e) {
+        cookie.setErrorContext(std::string("Failed to start profiler: ") +
+                               e.what());
+        return ENGINE_FAILED;
+    }
+    auto& c = cookie.getConnection();
+    LOG_INFO("{}: {} IOCTL_SET: sampling profiler started at {}Hz",
+             c.getId(),
+             c.getDescription(),
+             hz);
+    return ENGINE_SUCCESS;
+}
+
+ENGINE_ERROR_CODE ioctlSetProfilerStop(Cookie& cookie,
+                                       const StrToStrMap&,
+                                       const std::string&) {
+    std::lock_guard<std::mutex> guard(profilerMutex);
+    stopProfiler();
+    auto& c = cookie.getConnection();
+    LOG_INFO("{}: {} IOCTL_SET: sampling profiler stopped",
+             c.getId(),
+             c.getDescription());
+    return ENGINE_SUCCESS;
+}
+
+ENGINE_ERROR_CODE ioctlGetProfilerStatus(Cookie&,
+                                         const StrToStrMap&,
+                                         std::string& value) {
+    std::lock_guard<std::mutex> guard(profilerMutex);
+    auto* samples = buffer.load();
+    nlohmann::json json;
+    json["running"] = running.load();
+    json["frequency"] = frequency;
+    json["samples"] = samples ? samples->next.load() : 0;
+    json["capacity"] = NumSamples;
+    json["dropped"] = dropped.load();
+    value = json.dump();
+    return ENGINE_SUCCESS;
+}
+
+ENGINE_ERROR_CODE ioctlGetProfilerDump(Cookie& cookie,
+                                       const StrToStrMap& arguments,
+                                       std::string& value) {
+    std::lock_guard<std::mutex> guard(profilerMutex);
+    uint64_t since = startTimestamp;
+    for (const auto& arg : arguments) {
+        if (arg.first != "seconds") {
+            cookie.setErrorContext("Unknown argument: " + arg.first);
+            return ENGINE_EINVAL;
+        }
+        uint64_t seconds;
+        try {
+            seconds = std::stoull(arg.second);
+        } catch (const std::exception&) {
+            cookie.setErrorContext("seconds must be a number");
+            return ENGINE_EINVAL;
+        }
+        const auto now = monotonicNs();
+        const auto window = seconds * 1000000000;
+        since = now > window ? now - window : 0;
+    }
+    value = dumpProfile(since);
+    return ENGINE_SUCCESS;
+}
+
+#else
+
+static ENGINE_ERROR_CODE profilerNotSupported(Cookie& cookie) {
+    cookie.setErrorContext("The sampling profiler is only supported on Linux");
+    return ENGINE_ENOTSUP;
+}
+
+void stopSamplingProfiler() {
+}
+
+ENGINE_ERROR_CODE ioctlSetProfilerStart(Cookie& cookie,
+                                        const StrToStrMap&,
+                                        const std::string&) {
+    return profilerNotSupported(cookie);
+}
+
+ENGINE_ERROR_CODE ioctlSetProfilerStop(Cookie& cookie,
+                                       const StrToStrMap&,
+                                       const std::string&) {
+    return profilerNotSupported(cookie);
+}
+
+ENGINE_ERROR_CODE ioctlGetProfilerStatus(Cookie& cookie,
+                                         const StrToStrMap&,
+                                         std::string&) {
+    return profilerNotSupported(cookie);
+}
+
+ENGINE_ERROR_CODE ioctlGetProfilerDump(Cookie& cookie,
+                                       const StrToStrMap&,
+                                       std::string&) {
+    return profilerNotSupported(cookie);
+}
+
+#endif
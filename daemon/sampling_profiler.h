@@ -0,0 +1,79 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include "utilities/string_utilities.h"
+
+#include <memcached/engine_error.h>
+
+#include <string>
+
+class Cookie;
+
+/*
+ * An opt-in in-process sampling CPU profiler, for nodes where perf can't be
+ * used. While running, a SIGPROF timer (ITIMER_PROF) samples the stack of
+ * whichever thread is using CPU into a fixed size lock-free ring buffer.
+ * Symbolization happens only when the samples are dumped, as "folded"
+ * stacks (one "<thread name>;<outermost frame>;...;<innermost frame> <count>"
+ * line per distinct stack) ready for flamegraph.pl.
+ *
+ * Only supported on Linux; elsewhere the ioctls fail with ENOTSUP.
+ */
+
+/**
+ * Stop the profiler (if running); called on shutdown.
+ */
+void stopSamplingProfiler();
+
+/**
+ * IOCTL Set callback to start the sampling profiler
+ * @param value The sampling frequency in Hz of process CPU time (1-1000,
+ *              default 99)
+ */
+ENGINE_ERROR_CODE ioctlSetProfilerStart(Cookie& cookie,
+                                        const StrToStrMap& arguments,
+                                        const std::string& value);
+
+/**
+ * IOCTL Set callback to stop the sampling profiler. The samples taken are
+ * kept until they are overwritten by a later run.
+ */
+ENGINE_ERROR_CODE ioctlSetProfilerStop(Cookie& cookie,
+                                       const StrToStrMap& arguments,
+                                       const std::string& value);
+
+/**
+ * IOCTL Get callback to get the status of the sampling profiler
+ * @param[out] value JSON object with running, frequency, samples (taken
+ *                   since the process started), capacity (of the sample
+ *                   buffer) and dropped
+ */
+ENGINE_ERROR_CODE ioctlGetProfilerStatus(Cookie& cookie,
+                                         const StrToStrMap& arguments,
+                                         std::string& value);
+
+/**
+ * IOCTL Get callback to export the folded stacks of the samples taken since
+ * the profiler was last started, or with the "seconds" argument
+ * (profiler.dump?seconds=N) of those taken in the last N seconds.
+ * @param[out] value The folded stacks
+ */
+ENGINE_ERROR_CODE ioctlGetProfilerDump(Cookie& cookie,
+                                       const StrToStrMap& arguments,
+                                       std::string& value);
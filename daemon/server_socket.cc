@@ -37,9 +37,11 @@
 
 ServerSocket::ServerSocket(SOCKET fd,
                            event_base* b,
-                           std::shared_ptr<ListeningPort> interf)
+                           std::shared_ptr<ListeningPort> interf,
+                           FrontEndThread* owner)
     : sfd(fd),
       interface(interf),
+      owner(owner),
       sockname(cb::net::getsockname(fd)),
       ev(event_new(b,
                    sfd,
@@ -135,6 +137,12 @@ void ServerSocket::acceptNewClient() {
             LOG_WARNING("Too many open files. Current limit: {}",
                         limit.rlim_cur);
 #endif
+            if (owner != nullptr) {
+                // disable_listen only disables the sockets owned by the
+                // dispatcher. The socket is enabled again the next time
+                // the dispatcher kicks the owning thread.
+                disable();
+            }
             disable_listen();
         } else if (!cb::net::is_blocking(error)) {
             LOG_WARNING("Failed to accept new client: {}", cb_strerror(error));
@@ -183,7 +191,11 @@ void ServerSocket::acceptNewClient() {
         return;
     }
 
-    dispatch_conn_new(client, interface);
+    if (owner == nullptr) {
+        dispatch_conn_new(client, interface);
+    } else {
+        dispatch_conn_local(*owner, client, interface);
+    }
 }
 
 nlohmann::json ServerSocket::toJson() const {
@@ -23,6 +23,7 @@
 
 class ListeningPort;
 class NetworkInterface;
+struct FrontEndThread;
 
 /**
  * The ServerSocket represents the socket used to accept new clients.
@@ -38,10 +39,14 @@ public:
      * @param sfd The socket to operate on
      * @param b The event base to use (the caller owns the event base)
      * @param interf The interface object containing properties to use
+     * @param owner The front end thread accepting (and serving) the clients
+     *              connecting to this socket, or nullptr if the socket is
+     *              served by the dispatcher thread
      */
     ServerSocket(SOCKET sfd,
                  event_base* b,
-                 std::shared_ptr<ListeningPort> interf);
+                 std::shared_ptr<ListeningPort> interf,
+                 FrontEndThread* owner = nullptr);
 
     ~ServerSocket();
 
@@ -62,6 +67,16 @@ public:
         return *interface;
     }
 
+    std::shared_ptr<ListeningPort> getInterface() const {
+        return interface;
+    }
+
+    /// Get the front end thread owning the socket (nullptr for the
+    /// dispatcher thread)
+    FrontEndThread* getOwner() const {
+        return owner;
+    }
+
     /// Update the interface description to use the provided SSL info
     void updateSSL(const std::string& key, const std::string& cert);
 
@@ -77,6 +92,9 @@ protected:
 
     std::shared_ptr<ListeningPort> interface;
 
+    /// The front end thread serving the socket (nullptr for the dispatcher)
+    FrontEndThread* const owner;
+
     /// The sockets name (used for debug)
     const std::string sockname;
 
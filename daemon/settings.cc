@@ -35,6 +35,7 @@
 #include <mcbp/mcbp.h>
 #include <utilities/json_utilities.h>
 #include <utilities/logtags.h>
+#include <utilities/thread_affinity.h>
 
 // the global entry of the settings object
 Settings settings;
@@ -176,6 +177,59 @@ static void handle_threads(Settings& s, const nlohmann::json& obj) {
     s.setNumWorkerThreads(gsl::narrow_cast<size_t>(obj.get<unsigned int>()));
 }
 
+/**
+ * Handle the "sasl_threads" tag in the settings
+ *
+ *  The value must be an integer value
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_sasl_threads(Settings& s, const nlohmann::json& obj) {
+    if (!obj.is_number_unsigned()) {
+        cb::throwJsonTypeError(R"("sasl_threads" must be an unsigned int)");
+    }
+    s.setNumSaslThreads(gsl::narrow_cast<size_t>(obj.get<unsigned int>()));
+}
+
+/**
+ * Handle the "active_threads" tag in the settings
+ *
+ *  The value must be an integer value
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_active_threads(Settings& s, const nlohmann::json& obj) {
+    if (!obj.is_number_unsigned()) {
+        cb::throwJsonTypeError(R"("active_threads" must be an unsigned int)");
+    }
+    s.setNumActiveWorkerThreads(
+            gsl::narrow_cast<size_t>(obj.get<unsigned int>()));
+}
+
+/**
+ * Handle the "connection_dispatch_policy" tag in the settings
+ *
+ *  The value must be a string ("round_robin" or "least_loaded")
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_connection_dispatch_policy(Settings& s,
+                                              const nlohmann::json& obj) {
+    const auto policy = obj.get<std::string>();
+    if (policy == "round_robin") {
+        s.setConnectionDispatchPolicy(ConnectionDispatchPolicy::RoundRobin);
+    } else if (policy == "least_loaded") {
+        s.setConnectionDispatchPolicy(ConnectionDispatchPolicy::LeastLoaded);
+    } else {
+        throw std::invalid_argument(
+                R"("connection_dispatch_policy" must be "round_robin" or )"
+                R"("least_loaded")");
+    }
+}
+
 /**
  * Handle the "topkeys_enabled" tag in the settings
  *
@@ -188,6 +242,28 @@ static void handle_topkeys_enabled(Settings& s, const nlohmann::json& obj) {
     s.setTopkeysEnabled(obj.get<bool>());
 }
 
+/**
+ * Handle the "topkeys_sample_rate" tag in the settings
+ *
+ *  The value must be a numeric value >= 1
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_topkeys_sample_rate(Settings& s,
+                                       const nlohmann::json& obj) {
+    if (!obj.is_number_unsigned()) {
+        cb::throwJsonTypeError(
+                R"("topkeys_sample_rate" must be an unsigned int)");
+    }
+    const auto rate = obj.get<size_t>();
+    if (rate == 0) {
+        throw std::invalid_argument(
+                R"("topkeys_sample_rate" must be greater than 0)");
+    }
+    s.setTopkeysSampleRate(rate);
+}
+
 static void handle_scramsha_fallback_salt(Settings& s,
                                           const nlohmann::json& obj) {
     // Try to base64 decode it to validate that it is a legal value..
@@ -219,6 +295,35 @@ static void handle_active_external_users_push_interval(
     }
 }
 
+/**
+ * Parse a duration specified as a number of seconds or a string
+ * (like "100 ms")
+ */
+static std::chrono::microseconds get_duration(const std::string& name,
+                                              const nlohmann::json& obj) {
+    switch (obj.type()) {
+    case nlohmann::json::value_t::number_unsigned:
+        return std::chrono::seconds(obj.get<int>());
+    case nlohmann::json::value_t::string:
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                cb::text2time(obj.get<std::string>()));
+    default:
+        cb::throwJsonTypeError("\"" + name +
+                               "\" must be a number or string");
+    }
+}
+
+static void handle_external_auth_cache_ttl(Settings& s,
+                                           const nlohmann::json& obj) {
+    s.setExternalAuthCacheTtl(get_duration("external_auth_cache_ttl", obj));
+}
+
+static void handle_external_auth_negative_cache_ttl(
+        Settings& s, const nlohmann::json& obj) {
+    s.setExternalAuthNegativeCacheTtl(
+            get_duration("external_auth_negative_cache_ttl", obj));
+}
+
 /**
  * Handle the "tracing_enabled" tag in the settings
  *
@@ -231,6 +336,72 @@ static void handle_tracing_enabled(Settings& s, const nlohmann::json& obj) {
     s.setTracingEnabled(obj.get<bool>());
 }
 
+/**
+ * Handle the "keyspace_timings" tag in the settings
+ *
+ *  The value must be a boolean value
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_keyspace_timings(Settings& s, const nlohmann::json& obj) {
+    s.setKeyspaceTimingsEnabled(obj.get<bool>());
+}
+
+/**
+ * Handle the "admission_control_threshold" tag in the settings
+ *
+ *  The value must be a numeric value (percent)
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_admission_control_threshold(Settings& s,
+                                               const nlohmann::json& obj) {
+    if (!obj.is_number_unsigned()) {
+        cb::throwJsonTypeError(
+                R"("admission_control_threshold" must be an unsigned int)");
+    }
+    s.setAdmissionControlThreshold(obj.get<size_t>());
+}
+
+/**
+ * Handle the "slow_op_percentile" tag in the settings
+ *
+ *  The value must be a number in the range [0, 100>
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_slow_op_percentile(Settings& s, const nlohmann::json& obj) {
+    if (!obj.is_number()) {
+        cb::throwJsonTypeError(R"("slow_op_percentile" must be a number)");
+    }
+    const auto percentile = obj.get<double>();
+    if (percentile < 0 || percentile >= 100) {
+        throw std::invalid_argument(
+                R"("slow_op_percentile" must be in the range [0, 100>)");
+    }
+    s.setSlowOpPercentile(percentile);
+}
+
+/**
+ * Handle the "slow_op_capture_size" tag in the settings
+ *
+ *  The value must be a numeric value
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_slow_op_capture_size(Settings& s,
+                                        const nlohmann::json& obj) {
+    if (!obj.is_number_unsigned()) {
+        cb::throwJsonTypeError(
+                R"("slow_op_capture_size" must be an unsigned int)");
+    }
+    s.setSlowOpCaptureSize(obj.get<size_t>());
+}
+
 /**
  * Handle the "stdin_listener" tag in the settings
  *
@@ -243,6 +414,49 @@ static void handle_stdin_listener(Settings& s, const nlohmann::json& obj) {
     s.setStdinListenerEnabled(obj.get<bool>());
 }
 
+/**
+ * Handle the "reuseport_listeners" tag in the settings
+ *
+ *  The value must be a boolean value
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_reuseport_listeners(Settings& s,
+                                       const nlohmann::json& obj) {
+    s.setReusePortListenersEnabled(obj.get<bool>());
+}
+
+/**
+ * Handle the "event_loop_changelist" tag in the settings
+ *
+ *  The value must be a boolean value
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_event_loop_changelist(Settings& s,
+                                         const nlohmann::json& obj) {
+    s.setEventLoopChangelistEnabled(obj.get<bool>());
+}
+
+/**
+ * Handle the "front_end_thread_affinity" tag in the settings
+ *
+ *  The value must be a string containing a CPU list ("0-3,8"), a NUMA
+ *  node ("node:1") or be empty
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_front_end_thread_affinity(Settings& s,
+                                             const nlohmann::json& obj) {
+    auto affinity = obj.get<std::string>();
+    // Validate the specification (throws std::invalid_argument)
+    const cb::ThreadAffinity validated(affinity);
+    s.setFrontEndThreadAffinity(affinity);
+}
+
 /**
  * Handle "default_reqs_per_event", "reqs_per_event_high_priority",
  * "reqs_per_event_med_priority" and "reqs_per_event_low_priority" tag in
@@ -287,6 +501,57 @@ static void handle_low_reqs_event(Settings& s, const nlohmann::json& obj) {
             s, obj, EventPriority::Low, "reqs_per_event_low_priority");
 }
 
+/**
+ * Handle the "qos_scheduling_enabled" tag in the settings
+ *
+ *  The value must be a boolean value
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_qos_scheduling_enabled(Settings& s,
+                                          const nlohmann::json& obj) {
+    if (!obj.is_boolean()) {
+        cb::throwJsonTypeError(R"("qos_scheduling_enabled" must be a boolean)");
+    }
+    s.setQosSchedulingEnabled(obj.get<bool>());
+}
+
+/**
+ * Handle the "qos_weight_kv", "qos_weight_bulk" and "qos_weight_admin"
+ * tags in the settings
+ *
+ *  The value must be a numeric value greater than 0
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_qos_weight(Settings& s,
+                              const nlohmann::json& obj,
+                              ConnectionClass cls,
+                              const std::string& msg) {
+    if (!obj.is_number_unsigned()) {
+        cb::throwJsonTypeError(msg + " must be an unsigned int");
+    }
+    const auto weight = obj.get<size_t>();
+    if (weight == 0) {
+        throw std::invalid_argument(msg + " must be greater than 0");
+    }
+    s.setQosWeight(weight, cls);
+}
+
+static void handle_qos_weight_kv(Settings& s, const nlohmann::json& obj) {
+    handle_qos_weight(s, obj, ConnectionClass::Kv, "qos_weight_kv");
+}
+
+static void handle_qos_weight_bulk(Settings& s, const nlohmann::json& obj) {
+    handle_qos_weight(s, obj, ConnectionClass::Bulk, "qos_weight_bulk");
+}
+
+static void handle_qos_weight_admin(Settings& s, const nlohmann::json& obj) {
+    handle_qos_weight(s, obj, ConnectionClass::Admin, "qos_weight_admin");
+}
+
 /**
  * Handle the "verbosity" tag in the settings
  *
@@ -395,6 +660,49 @@ static void handle_ssl_cipher_order(Settings& s, const nlohmann::json& obj) {
     s.setSslCipherOrder(obj.get<bool>());
 }
 
+static void handle_ssl_ktls(Settings& s, const nlohmann::json& obj) {
+    s.setSslKtlsEnabled(obj.get<bool>());
+}
+
+/**
+ * Handle the "ssl_session_cache_size" tag in the settings
+ *
+ *  The value must be a numeric value
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_ssl_session_cache_size(Settings& s,
+                                          const nlohmann::json& obj) {
+    if (!obj.is_number_unsigned()) {
+        cb::throwJsonTypeError(
+                R"("ssl_session_cache_size" must be an unsigned int)");
+    }
+    s.setSslSessionCacheSize(obj.get<size_t>());
+}
+
+static void handle_ssl_session_tickets(Settings& s,
+                                       const nlohmann::json& obj) {
+    s.setSslSessionTicketsEnabled(obj.get<bool>());
+}
+
+/**
+ * Handle the "ssl_session_timeout" tag in the settings
+ *
+ *  The value must be a positive number of seconds
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_ssl_session_timeout(Settings& s,
+                                       const nlohmann::json& obj) {
+    if (!obj.is_number_unsigned() || obj.get<size_t>() == 0) {
+        cb::throwJsonTypeError(
+                R"("ssl_session_timeout" must be a positive int)");
+    }
+    s.setSslSessionTimeout(obj.get<size_t>());
+}
+
 /**
  * Handle the "ssl_minimum_protocol" tag in the settings
  *
@@ -432,6 +740,74 @@ static void handle_max_packet_size(Settings& s, const nlohmann::json& obj) {
                        1024);
 }
 
+/**
+ * Handle the "response_coalescing_bytes" tag in the settings
+ *
+ *  The value must be a numeric value (in bytes)
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_response_coalescing_bytes(Settings& s,
+                                             const nlohmann::json& obj) {
+    if (!obj.is_number_unsigned()) {
+        cb::throwJsonTypeError(
+                R"("response_coalescing_bytes" must be an unsigned int)");
+    }
+    s.setResponseCoalescingBytes(obj.get<size_t>());
+}
+
+/**
+ * Handle the "response_coalescing_iovecs" tag in the settings
+ *
+ *  The value must be a numeric value
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_response_coalescing_iovecs(Settings& s,
+                                              const nlohmann::json& obj) {
+    if (!obj.is_number_unsigned()) {
+        cb::throwJsonTypeError(
+                R"("response_coalescing_iovecs" must be an unsigned int)");
+    }
+    s.setResponseCoalescingIovecs(obj.get<size_t>());
+}
+
+/**
+ * Handle the "subdoc_lookup_cache_size" tag in the settings
+ *
+ *  The value must be a numeric value
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_subdoc_lookup_cache_size(Settings& s,
+                                            const nlohmann::json& obj) {
+    if (!obj.is_number_unsigned()) {
+        cb::throwJsonTypeError(
+                R"("subdoc_lookup_cache_size" must be an unsigned int)");
+    }
+    s.setSubdocLookupCacheSize(obj.get<size_t>());
+}
+
+/**
+ * Handle the "zerocopy_send_threshold" tag in the settings
+ *
+ *  The value must be a numeric value (in bytes)
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_zerocopy_send_threshold(Settings& s,
+                                           const nlohmann::json& obj) {
+    if (!obj.is_number_unsigned()) {
+        cb::throwJsonTypeError(
+                R"("zerocopy_send_threshold" must be an unsigned int)");
+    }
+    s.setZeroCopySendThreshold(obj.get<size_t>());
+}
+
 static void handle_max_connections(Settings& s, const nlohmann::json& obj) {
     if (!obj.is_number_unsigned()) {
         cb::throwJsonTypeError(
@@ -616,6 +992,9 @@ void Settings::reconfigure(const nlohmann::json& json) {
             {"audit_file", handle_audit_file},
             {"error_maps_dir", handle_error_maps_dir},
             {"threads", handle_threads},
+            {"sasl_threads", handle_sasl_threads},
+            {"active_threads", handle_active_threads},
+            {"connection_dispatch_policy", handle_connection_dispatch_policy},
             {"interfaces", handle_interfaces},
             {"extensions", handle_extensions},
             {"logger", handle_logger},
@@ -623,6 +1002,10 @@ void Settings::reconfigure(const nlohmann::json& json) {
             {"reqs_per_event_high_priority", handle_high_reqs_event},
             {"reqs_per_event_med_priority", handle_med_reqs_event},
             {"reqs_per_event_low_priority", handle_low_reqs_event},
+            {"qos_scheduling_enabled", handle_qos_scheduling_enabled},
+            {"qos_weight_kv", handle_qos_weight_kv},
+            {"qos_weight_bulk", handle_qos_weight_bulk},
+            {"qos_weight_admin", handle_qos_weight_admin},
             {"verbosity", handle_verbosity},
             {"connection_idle_time", handle_connection_idle_time},
             {"bio_drain_buffer_sz", handle_bio_drain_buffer_sz},
@@ -631,25 +1014,45 @@ void Settings::reconfigure(const nlohmann::json& json) {
             {"root", handle_root},
             {"ssl_cipher_list", handle_ssl_cipher_list},
             {"ssl_cipher_order", handle_ssl_cipher_order},
+            {"ssl_ktls", handle_ssl_ktls},
+            {"ssl_session_cache_size", handle_ssl_session_cache_size},
+            {"ssl_session_tickets", handle_ssl_session_tickets},
+            {"ssl_session_timeout", handle_ssl_session_timeout},
             {"ssl_minimum_protocol", handle_ssl_minimum_protocol},
             {"breakpad", handle_breakpad},
             {"max_packet_size", handle_max_packet_size},
+            {"zerocopy_send_threshold", handle_zerocopy_send_threshold},
+            {"response_coalescing_bytes", handle_response_coalescing_bytes},
+            {"response_coalescing_iovecs", handle_response_coalescing_iovecs},
+            {"subdoc_lookup_cache_size", handle_subdoc_lookup_cache_size},
             {"max_connections", handle_max_connections},
             {"system_connections", handle_system_connections},
             {"sasl_mechanisms", handle_sasl_mechanisms},
             {"ssl_sasl_mechanisms", handle_ssl_sasl_mechanisms},
             {"stdin_listener", handle_stdin_listener},
+            {"reuseport_listeners", handle_reuseport_listeners},
+            {"event_loop_changelist", handle_event_loop_changelist},
+            {"front_end_thread_affinity", handle_front_end_thread_affinity},
             {"dedupe_nmvb_maps", handle_dedupe_nmvb_maps},
             {"xattr_enabled", handle_xattr_enabled},
             {"client_cert_auth", handle_client_cert_auth},
             {"collections_enabled", handle_collections_enabled},
             {"opcode_attributes_override", handle_opcode_attributes_override},
             {"topkeys_enabled", handle_topkeys_enabled},
+            {"topkeys_sample_rate", handle_topkeys_sample_rate},
             {"tracing_enabled", handle_tracing_enabled},
+            {"keyspace_timings", handle_keyspace_timings},
+            {"admission_control_threshold",
+             handle_admission_control_threshold},
+            {"slow_op_percentile", handle_slow_op_percentile},
+            {"slow_op_capture_size", handle_slow_op_capture_size},
             {"scramsha_fallback_salt", handle_scramsha_fallback_salt},
             {"external_auth_service", handle_external_auth_service},
             {"active_external_users_push_interval",
              handle_active_external_users_push_interval},
+            {"external_auth_cache_ttl", handle_external_auth_cache_ttl},
+            {"external_auth_negative_cache_ttl",
+             handle_external_auth_negative_cache_ttl},
             {"opentracing", handle_opentracing},
             {"portnumber_file", handle_portnumber_file},
             {"parent_identifier", handle_parent_identifier}};
@@ -693,6 +1096,13 @@ void Settings::updateSettings(const Settings& other, bool apply) {
         }
     }
 
+    if (other.has.sasl_threads) {
+        if (other.num_sasl_threads != num_sasl_threads) {
+            throw std::invalid_argument(
+                    "sasl_threads can't be changed dynamically");
+        }
+    }
+
     if (other.has.audit) {
         if (other.audit_file != audit_file) {
             throw std::invalid_argument("audit can't be changed dynamically");
@@ -729,6 +1139,28 @@ void Settings::updateSettings(const Settings& other, bool apply) {
         }
     }
 
+    if (other.has.reuseport_listeners) {
+        if (other.reuseport_listeners.load() != reuseport_listeners.load()) {
+            throw std::invalid_argument(
+                    "reuseport_listeners can't be changed dynamically");
+        }
+    }
+
+    if (other.has.event_loop_changelist) {
+        if (other.event_loop_changelist.load() !=
+            event_loop_changelist.load()) {
+            throw std::invalid_argument(
+                    "event_loop_changelist can't be changed dynamically");
+        }
+    }
+
+    if (other.has.front_end_thread_affinity) {
+        if (other.front_end_thread_affinity != front_end_thread_affinity) {
+            throw std::invalid_argument(
+                    "front_end_thread_affinity can't be changed dynamically");
+        }
+    }
+
     if (other.has.logger) {
         if (other.logger_settings != logger_settings)
             throw std::invalid_argument(
@@ -821,6 +1253,40 @@ void Settings::updateSettings(const Settings& other, bool apply) {
                                             EventPriority::Default);
         }
     }
+    if (other.has.qos_scheduling_enabled) {
+        if (other.isQosSchedulingEnabled() != isQosSchedulingEnabled()) {
+            LOG_INFO("{} qos scheduling",
+                     other.isQosSchedulingEnabled() ? "Enable" : "Disable");
+            setQosSchedulingEnabled(other.isQosSchedulingEnabled());
+        }
+    }
+    if (other.has.qos_weight_kv) {
+        const auto weight = other.getQosWeight(ConnectionClass::Kv);
+        if (weight != getQosWeight(ConnectionClass::Kv)) {
+            LOG_INFO("Change qos weight for kv connections from {} to {}",
+                     getQosWeight(ConnectionClass::Kv),
+                     weight);
+            setQosWeight(weight, ConnectionClass::Kv);
+        }
+    }
+    if (other.has.qos_weight_bulk) {
+        const auto weight = other.getQosWeight(ConnectionClass::Bulk);
+        if (weight != getQosWeight(ConnectionClass::Bulk)) {
+            LOG_INFO("Change qos weight for bulk connections from {} to {}",
+                     getQosWeight(ConnectionClass::Bulk),
+                     weight);
+            setQosWeight(weight, ConnectionClass::Bulk);
+        }
+    }
+    if (other.has.qos_weight_admin) {
+        const auto weight = other.getQosWeight(ConnectionClass::Admin);
+        if (weight != getQosWeight(ConnectionClass::Admin)) {
+            LOG_INFO("Change qos weight for admin connections from {} to {}",
+                     getQosWeight(ConnectionClass::Admin),
+                     weight);
+            setQosWeight(weight, ConnectionClass::Admin);
+        }
+    }
     if (other.has.connection_idle_time) {
         if (other.connection_idle_time != connection_idle_time) {
             LOG_INFO("Change connection idle time from {} to {}",
@@ -837,6 +1303,40 @@ void Settings::updateSettings(const Settings& other, bool apply) {
             setMaxPacketSize(other.max_packet_size);
         }
     }
+    if (other.has.response_coalescing_bytes) {
+        if (other.getResponseCoalescingBytes() !=
+            getResponseCoalescingBytes()) {
+            LOG_INFO("Change response coalescing bytes from {} to {}",
+                     getResponseCoalescingBytes(),
+                     other.getResponseCoalescingBytes());
+            setResponseCoalescingBytes(other.getResponseCoalescingBytes());
+        }
+    }
+    if (other.has.response_coalescing_iovecs) {
+        if (other.getResponseCoalescingIovecs() !=
+            getResponseCoalescingIovecs()) {
+            LOG_INFO("Change response coalescing iovecs from {} to {}",
+                     getResponseCoalescingIovecs(),
+                     other.getResponseCoalescingIovecs());
+            setResponseCoalescingIovecs(other.getResponseCoalescingIovecs());
+        }
+    }
+    if (other.has.subdoc_lookup_cache_size) {
+        if (other.getSubdocLookupCacheSize() != getSubdocLookupCacheSize()) {
+            LOG_INFO("Change subdoc lookup cache size from {} to {}",
+                     getSubdocLookupCacheSize(),
+                     other.getSubdocLookupCacheSize());
+            setSubdocLookupCacheSize(other.getSubdocLookupCacheSize());
+        }
+    }
+    if (other.has.zerocopy_send_threshold) {
+        if (other.getZeroCopySendThreshold() != getZeroCopySendThreshold()) {
+            LOG_INFO("Change zerocopy send threshold from {} to {}",
+                     getZeroCopySendThreshold(),
+                     other.getZeroCopySendThreshold());
+            setZeroCopySendThreshold(other.getZeroCopySendThreshold());
+        }
+    }
     if (other.has.ssl_cipher_list) {
         if (other.ssl_cipher_list != ssl_cipher_list) {
             // this isn't safe!! an other thread could call stats settings
@@ -858,6 +1358,41 @@ void Settings::updateSettings(const Settings& other, bool apply) {
         }
     }
 
+    if (other.has.ssl_ktls) {
+        if (other.isSslKtlsEnabled() != isSslKtlsEnabled()) {
+            LOG_INFO(R"(Change SSL kTLS offload from "{}" to "{}")",
+                     isSslKtlsEnabled() ? "enabled" : "disabled",
+                     other.isSslKtlsEnabled() ? "enabled" : "disabled");
+            setSslKtlsEnabled(other.isSslKtlsEnabled());
+        }
+    }
+    if (other.has.ssl_session_cache_size) {
+        if (other.getSslSessionCacheSize() != getSslSessionCacheSize()) {
+            LOG_INFO("Change SSL session cache size from {} to {}",
+                     getSslSessionCacheSize(),
+                     other.getSslSessionCacheSize());
+            setSslSessionCacheSize(other.getSslSessionCacheSize());
+        }
+    }
+    if (other.has.ssl_session_tickets) {
+        if (other.isSslSessionTicketsEnabled() !=
+            isSslSessionTicketsEnabled()) {
+            LOG_INFO(R"(Change SSL session tickets from "{}" to "{}")",
+                     isSslSessionTicketsEnabled() ? "enabled" : "disabled",
+                     other.isSslSessionTicketsEnabled() ? "enabled"
+                                                        : "disabled");
+            setSslSessionTicketsEnabled(other.isSslSessionTicketsEnabled());
+        }
+    }
+    if (other.has.ssl_session_timeout) {
+        if (other.getSslSessionTimeout() != getSslSessionTimeout()) {
+            LOG_INFO("Change SSL session timeout from {} to {}",
+                     getSslSessionTimeout(),
+                     other.getSslSessionTimeout());
+            setSslSessionTimeout(other.getSslSessionTimeout());
+        }
+    }
+
     if (other.has.client_cert_auth) {
         const auto m = client_cert_mapper.to_string();
         const auto o = other.client_cert_mapper.to_string();
@@ -890,6 +1425,28 @@ void Settings::updateSettings(const Settings& other, bool apply) {
         }
     }
 
+    if (other.has.active_threads) {
+        const auto mine = getNumActiveWorkerThreads();
+        const auto others = other.getNumActiveWorkerThreads();
+        if (mine != others) {
+            LOG_INFO("Change the number of active worker threads from {} to {}",
+                     mine,
+                     others);
+            setNumActiveWorkerThreads(others);
+        }
+    }
+
+    if (other.has.connection_dispatch_policy) {
+        const auto mine = getConnectionDispatchPolicy();
+        const auto others = other.getConnectionDispatchPolicy();
+        if (mine != others) {
+            LOG_INFO(R"(Change connection dispatch policy from "{}" to "{}")",
+                     to_string(mine),
+                     to_string(others));
+            setConnectionDispatchPolicy(others);
+        }
+    }
+
     if (other.has.max_connections) {
         if (other.max_connections != max_connections) {
             LOG_INFO(R"(Change max connections from {} to {})",
@@ -1011,6 +1568,15 @@ void Settings::updateSettings(const Settings& other, bool apply) {
         setTopkeysEnabled(other.isTopkeysEnabled());
     }
 
+    if (other.has.topkeys_sample_rate) {
+        if (other.getTopkeysSampleRate() != getTopkeysSampleRate()) {
+            LOG_INFO("Change topkeys sample rate from {} to {}",
+                     getTopkeysSampleRate(),
+                     other.getTopkeysSampleRate());
+            setTopkeysSampleRate(other.getTopkeysSampleRate());
+        }
+    }
+
     if (other.has.tracing_enabled) {
         if (other.isTracingEnabled() != isTracingEnabled()) {
             LOG_INFO("{} tracing support",
@@ -1019,6 +1585,42 @@ void Settings::updateSettings(const Settings& other, bool apply) {
         setTracingEnabled(other.isTracingEnabled());
     }
 
+    if (other.has.keyspace_timings) {
+        if (other.isKeyspaceTimingsEnabled() != isKeyspaceTimingsEnabled()) {
+            LOG_INFO("{} keyspace timings",
+                     other.isKeyspaceTimingsEnabled() ? "Enable" : "Disable");
+        }
+        setKeyspaceTimingsEnabled(other.isKeyspaceTimingsEnabled());
+    }
+
+    if (other.has.admission_control_threshold) {
+        if (other.getAdmissionControlThreshold() !=
+            getAdmissionControlThreshold()) {
+            LOG_INFO("Change admission control threshold from {}% to {}%",
+                     getAdmissionControlThreshold(),
+                     other.getAdmissionControlThreshold());
+            setAdmissionControlThreshold(other.getAdmissionControlThreshold());
+        }
+    }
+
+    if (other.has.slow_op_percentile) {
+        if (other.getSlowOpPercentile() != getSlowOpPercentile()) {
+            LOG_INFO("Change slow operation percentile from {} to {}",
+                     getSlowOpPercentile(),
+                     other.getSlowOpPercentile());
+            setSlowOpPercentile(other.getSlowOpPercentile());
+        }
+    }
+
+    if (other.has.slow_op_capture_size) {
+        if (other.getSlowOpCaptureSize() != getSlowOpCaptureSize()) {
+            LOG_INFO("Change slow operation capture size from {} to {}",
+                     getSlowOpCaptureSize(),
+                     other.getSlowOpCaptureSize());
+            setSlowOpCaptureSize(other.getSlowOpCaptureSize());
+        }
+    }
+
     if (other.has.scramsha_fallback_salt) {
         const auto o = other.getScramshaFallbackSalt();
         const auto m = getScramshaFallbackSalt();
@@ -1083,6 +1685,35 @@ void Settings::updateSettings(const Settings& other, bool apply) {
         }
     }
 
+    if (other.has.external_auth_cache_ttl) {
+        if (getExternalAuthCacheTtl() != other.getExternalAuthCacheTtl()) {
+            LOG_INFO(R"(Change external auth cache TTL from {}ms to {}ms)",
+                     std::chrono::duration_cast<std::chrono::milliseconds>(
+                             getExternalAuthCacheTtl())
+                             .count(),
+                     std::chrono::duration_cast<std::chrono::milliseconds>(
+                             other.getExternalAuthCacheTtl())
+                             .count());
+            setExternalAuthCacheTtl(other.getExternalAuthCacheTtl());
+        }
+    }
+
+    if (other.has.external_auth_negative_cache_ttl) {
+        if (getExternalAuthNegativeCacheTtl() !=
+            other.getExternalAuthNegativeCacheTtl()) {
+            LOG_INFO(
+                    R"(Change external auth negative cache TTL from {}ms to {}ms)",
+                    std::chrono::duration_cast<std::chrono::milliseconds>(
+                            getExternalAuthNegativeCacheTtl())
+                            .count(),
+                    std::chrono::duration_cast<std::chrono::milliseconds>(
+                            other.getExternalAuthNegativeCacheTtl())
+                            .count());
+            setExternalAuthNegativeCacheTtl(
+                    other.getExternalAuthNegativeCacheTtl());
+        }
+    }
+
     if (other.has.opentracing_config) {
         auto o = other.getOpenTracingConfig();
         auto m = getOpenTracingConfig();
@@ -1235,6 +1866,18 @@ void Settings::notify_changed(const std::string& key) {
     }
 }
 
+std::string to_string(ConnectionDispatchPolicy policy) {
+    switch (policy) {
+    case ConnectionDispatchPolicy::RoundRobin:
+        return "round_robin";
+    case ConnectionDispatchPolicy::LeastLoaded:
+        return "least_loaded";
+    }
+    throw std::invalid_argument(
+            "to_string(ConnectionDispatchPolicy): Unknown policy: " +
+            std::to_string(int(policy)));
+}
+
 std::string Settings::getSaslMechanisms() const {
     return std::string{*sasl_mechanisms.rlock()};
 }
@@ -43,6 +43,33 @@ enum class EventPriority {
     Default
 };
 
+/**
+ * The scheduling class of a connection used when the front end threads
+ * pick which of the ready connections to serve next
+ */
+enum class ConnectionClass {
+    /// Latency sensitive key-value traffic
+    Kv,
+    /// Bulk traffic (DCP and other low priority connections)
+    Bulk,
+    /// Administrative (internal) connections such as stats collection
+    Admin
+};
+
+/**
+ * The policy used by the dispatcher when selecting the front end thread
+ * to serve a newly accepted connection.
+ */
+enum class ConnectionDispatchPolicy {
+    /// Hand out the connections to the worker threads in a round robin order
+    RoundRobin,
+    /// Select the worker thread with the lowest load (number of connections,
+    /// recent CPU usage and the amount of data queued for transmission)
+    LeastLoaded
+};
+
+std::string to_string(ConnectionDispatchPolicy policy);
+
 /* When adding a setting, be sure to update process_stat_settings */
 /**
  * Globally accessible settings as derived from the commandline / JSON config
@@ -133,6 +160,62 @@ public:
         notify_changed("threads");
     }
 
+    /**
+     * Get the number of threads in the executor pool dedicated to running
+     * the SASL authentication tasks (0 means use the same number as the
+     * number of frontend worker threads)
+     */
+    size_t getNumSaslThreads() const {
+        return num_sasl_threads;
+    }
+
+    void setNumSaslThreads(size_t num_sasl_threads) {
+        has.sasl_threads = true;
+        Settings::num_sasl_threads = num_sasl_threads;
+        notify_changed("sasl_threads");
+    }
+
+    /**
+     * Get the number of the frontend worker threads new connections are
+     * dispatched to (0 means all of them)
+     */
+    size_t getNumActiveWorkerThreads() const {
+        return num_active_threads.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Set the number of the frontend worker threads new connections are
+     * dispatched to. The connections of the other threads stay on them
+     * until they disconnect.
+     *
+     * @param num the number of threads (0 means all of them)
+     */
+    void setNumActiveWorkerThreads(size_t num) {
+        num_active_threads.store(num, std::memory_order_release);
+        has.active_threads = true;
+        notify_changed("active_threads");
+    }
+
+    /**
+     * Get the policy the dispatcher use to select the worker thread to
+     * serve new connections
+     */
+    ConnectionDispatchPolicy getConnectionDispatchPolicy() const {
+        return connection_dispatch_policy.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Set the policy the dispatcher use to select the worker thread to
+     * serve new connections
+     *
+     * @param policy the new policy to use
+     */
+    void setConnectionDispatchPolicy(ConnectionDispatchPolicy policy) {
+        connection_dispatch_policy.store(policy, std::memory_order_release);
+        has.connection_dispatch_policy = true;
+        notify_changed("connection_dispatch_policy");
+    }
+
     /**
      * Add a new interface definition to the list of interfaces provided
      * by the server.
@@ -175,6 +258,70 @@ public:
         notify_changed("stdin_listener");
     }
 
+    /**
+     * Should each of the front end threads use their own SO_REUSEPORT
+     * socket for each of the listening ports (and let the kernel spread
+     * the new connections across the threads) in addition to the
+     * socket served by the dispatcher thread?
+     *
+     * @return true if enabled, false otherwise
+     */
+    bool isReusePortListenersEnabled() const {
+        return reuseport_listeners.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Set if each front end thread should have its own listening sockets
+     *
+     * @param enabled the new value
+     */
+    void setReusePortListenersEnabled(bool enabled) {
+        reuseport_listeners.store(enabled, std::memory_order_release);
+        has.reuseport_listeners = true;
+        notify_changed("reuseport_listeners");
+    }
+
+    /**
+     * Should the event bases used by the front end threads defer (and
+     * merge) the changes to the events until the next time they poll
+     * for events (EVENT_BASE_FLAG_EPOLL_USE_CHANGELIST)?
+     *
+     * @return true if enabled, false otherwise
+     */
+    bool isEventLoopChangelistEnabled() const {
+        return event_loop_changelist.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Set if the front end threads should use the changelist
+     *
+     * @param enabled the new value
+     */
+    void setEventLoopChangelistEnabled(bool enabled) {
+        event_loop_changelist.store(enabled, std::memory_order_release);
+        has.event_loop_changelist = true;
+        notify_changed("event_loop_changelist");
+    }
+
+    /**
+     * Get the CPU affinity for the front end threads in the format
+     * accepted by cb::ThreadAffinity ("" (none), "0-3,8" or "node:1")
+     */
+    const std::string& getFrontEndThreadAffinity() const {
+        return front_end_thread_affinity;
+    }
+
+    /**
+     * Set the CPU affinity used by the front end threads
+     *
+     * @param affinity the new affinity (must have been validated)
+     */
+    void setFrontEndThreadAffinity(const std::string& affinity) {
+        front_end_thread_affinity = affinity;
+        has.front_end_thread_affinity = true;
+        notify_changed("front_end_thread_affinity");
+    }
+
     cb::logger::Config getLoggerConfig() const {
         auto config = logger_settings;
         // log_level is synthesised from settings.verbose.
@@ -386,6 +533,59 @@ public:
             "setRequestsPerEventNotification: Unknown priority");
     }
 
+    /**
+     * Should the front end threads order the ready connections by their
+     * connection class (using weighted fair queueing) instead of serving
+     * them in the order the event library reports them?
+     */
+    bool isQosSchedulingEnabled() const {
+        return qos_scheduling_enabled.load(std::memory_order_relaxed);
+    }
+
+    void setQosSchedulingEnabled(bool enabled) {
+        qos_scheduling_enabled.store(enabled, std::memory_order_relaxed);
+        has.qos_scheduling_enabled = true;
+        notify_changed("qos_scheduling_enabled");
+    }
+
+    /**
+     * Set the share of the front end thread time given to the connection
+     * class when there is contention (relative to the weight of the other
+     * classes)
+     */
+    void setQosWeight(size_t weight, ConnectionClass cls) {
+        switch (cls) {
+        case ConnectionClass::Kv:
+            qos_weight_kv.store(weight, std::memory_order_relaxed);
+            has.qos_weight_kv = true;
+            notify_changed("qos_weight_kv");
+            return;
+        case ConnectionClass::Bulk:
+            qos_weight_bulk.store(weight, std::memory_order_relaxed);
+            has.qos_weight_bulk = true;
+            notify_changed("qos_weight_bulk");
+            return;
+        case ConnectionClass::Admin:
+            qos_weight_admin.store(weight, std::memory_order_relaxed);
+            has.qos_weight_admin = true;
+            notify_changed("qos_weight_admin");
+            return;
+        }
+        throw std::invalid_argument("setQosWeight: Unknown connection class");
+    }
+
+    size_t getQosWeight(ConnectionClass cls) const {
+        switch (cls) {
+        case ConnectionClass::Kv:
+            return qos_weight_kv.load(std::memory_order_relaxed);
+        case ConnectionClass::Bulk:
+            return qos_weight_bulk.load(std::memory_order_relaxed);
+        case ConnectionClass::Admin:
+            return qos_weight_admin.load(std::memory_order_relaxed);
+        }
+        throw std::invalid_argument("getQosWeight: Unknown connection class");
+    }
+
     /**
      * Is PROTOCOL_BINARY_DATATYPE_JSON supported or not
      *
@@ -469,6 +669,68 @@ public:
         notify_changed("max_packet_size");
     }
 
+    /**
+     * Get the maximum number of bytes of responses for pipelined commands
+     * we may queue up and send in a single sendmsg call (0 = disabled)
+     */
+    size_t getResponseCoalescingBytes() const {
+        return response_coalescing_bytes.load(std::memory_order_relaxed);
+    }
+
+    void setResponseCoalescingBytes(size_t bytes) {
+        response_coalescing_bytes.store(bytes, std::memory_order_relaxed);
+        has.response_coalescing_bytes = true;
+        notify_changed("response_coalescing_bytes");
+    }
+
+    /**
+     * Get the maximum number of entries in the IO vector we may use for
+     * responses for pipelined commands before we send them
+     */
+    size_t getResponseCoalescingIovecs() const {
+        return response_coalescing_iovecs.load(std::memory_order_relaxed);
+    }
+
+    void setResponseCoalescingIovecs(size_t iovecs) {
+        response_coalescing_iovecs.store(iovecs, std::memory_order_relaxed);
+        has.response_coalescing_iovecs = true;
+        notify_changed("response_coalescing_iovecs");
+    }
+
+    /**
+     * Get the number of documents each front end thread may keep the
+     * sub-document lookup results for (0 = disabled)
+     */
+    size_t getSubdocLookupCacheSize() const {
+        return subdoc_lookup_cache_size.load(std::memory_order_relaxed);
+    }
+
+    void setSubdocLookupCacheSize(size_t size) {
+        subdoc_lookup_cache_size.store(size, std::memory_order_relaxed);
+        has.subdoc_lookup_cache_size = true;
+        notify_changed("subdoc_lookup_cache_size");
+    }
+
+    /**
+     * Get the minimum size of a chunk of document data in a response
+     * before we try to transmit it with MSG_ZEROCOPY (0 = disabled)
+     */
+    size_t getZeroCopySendThreshold() const {
+        return zerocopy_send_threshold.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Set the minimum size of a chunk of document data in a response
+     * before we try to transmit it with MSG_ZEROCOPY
+     *
+     * @param threshold the new size in bytes (0 disables zero copy send)
+     */
+    void setZeroCopySendThreshold(size_t threshold) {
+        zerocopy_send_threshold.store(threshold, std::memory_order_relaxed);
+        has.zerocopy_send_threshold = true;
+        notify_changed("zerocopy_send_threshold");
+    }
+
     /**
      * Get the list of SSL ciphers to use
      *
@@ -500,6 +762,63 @@ public:
         notify_changed("ssl_cipher_order");
     }
 
+    /**
+     * Should TLS connections try to use kernel TLS for the send path
+     * once the handshake is complete?
+     */
+    bool isSslKtlsEnabled() const {
+        return ssl_ktls.load(std::memory_order_acquire);
+    }
+
+    void setSslKtlsEnabled(bool enabled) {
+        ssl_ktls.store(enabled, std::memory_order_release);
+        has.ssl_ktls = true;
+        notify_changed("ssl_ktls");
+    }
+
+    /**
+     * Get the number of TLS sessions kept in the session cache shared by
+     * all of the front end threads (0 = disabled)
+     */
+    size_t getSslSessionCacheSize() const {
+        return ssl_session_cache_size.load(std::memory_order_relaxed);
+    }
+
+    void setSslSessionCacheSize(size_t size) {
+        ssl_session_cache_size.store(size, std::memory_order_relaxed);
+        has.ssl_session_cache_size = true;
+        notify_changed("ssl_session_cache_size");
+    }
+
+    /**
+     * Should all of the connections use the same (rotating) keys for
+     * the session tickets, so that a ticket may be used to resume the
+     * session on a new connection?
+     */
+    bool isSslSessionTicketsEnabled() const {
+        return ssl_session_tickets.load(std::memory_order_acquire);
+    }
+
+    void setSslSessionTicketsEnabled(bool enabled) {
+        ssl_session_tickets.store(enabled, std::memory_order_release);
+        has.ssl_session_tickets = true;
+        notify_changed("ssl_session_tickets");
+    }
+
+    /**
+     * Get the number of seconds a TLS session may be resumed for (and
+     * how often the session ticket keys are rotated)
+     */
+    size_t getSslSessionTimeout() const {
+        return ssl_session_timeout.load(std::memory_order_relaxed);
+    }
+
+    void setSslSessionTimeout(size_t timeout) {
+        ssl_session_timeout.store(timeout, std::memory_order_relaxed);
+        has.ssl_session_timeout = true;
+        notify_changed("ssl_session_timeout");
+    }
+
     /**
      * Get the minimum SSL protocol the node use
      *
@@ -711,6 +1030,21 @@ public:
         notify_changed("topkeys_enabled");
     }
 
+    /**
+     * Get the topkeys sampling rate. 1 records every access in the exact
+     * (mutex protected) topkeys shards, N > 1 records 1 in N accesses in
+     * per thread sketches which are merged when the stats are requested.
+     */
+    size_t getTopkeysSampleRate() const {
+        return topkeys_sample_rate.load(std::memory_order_relaxed);
+    }
+
+    void setTopkeysSampleRate(size_t rate) {
+        topkeys_sample_rate.store(rate, std::memory_order_relaxed);
+        has.topkeys_sample_rate = true;
+        notify_changed("topkeys_sample_rate");
+    }
+
     bool isTracingEnabled() const {
         return tracing_enabled.load(std::memory_order_acquire);
     }
@@ -721,6 +1055,59 @@ public:
         notify_changed("tracing_enabled");
     }
 
+    bool isKeyspaceTimingsEnabled() const {
+        return keyspace_timings.load(std::memory_order_relaxed);
+    }
+
+    void setKeyspaceTimingsEnabled(bool enabled) {
+        keyspace_timings.store(enabled, std::memory_order_relaxed);
+        has.keyspace_timings = true;
+        notify_changed("keyspace_timings");
+    }
+
+    /**
+     * Get the bucket pressure (as a percentage of the limits reported by
+     * the engine) at which mutations from connections which aren't high
+     * priority are rejected with a temporary failure (0 = disabled)
+     */
+    size_t getAdmissionControlThreshold() const {
+        return admission_control_threshold.load(std::memory_order_relaxed);
+    }
+
+    void setAdmissionControlThreshold(size_t percent) {
+        admission_control_threshold.store(percent, std::memory_order_relaxed);
+        has.admission_control_threshold = true;
+        notify_changed("admission_control_threshold");
+    }
+
+    /**
+     * Get the percentile of the latencies of an opcode used as its slow
+     * operation threshold (in addition to its SLA). 0 = disabled
+     */
+    double getSlowOpPercentile() const {
+        return slow_op_percentile.load(std::memory_order_relaxed);
+    }
+
+    void setSlowOpPercentile(double percentile) {
+        slow_op_percentile.store(percentile, std::memory_order_relaxed);
+        has.slow_op_percentile = true;
+        notify_changed("slow_op_percentile");
+    }
+
+    /**
+     * Get the number of slow operations kept with their trace and
+     * connection details (0 = disabled)
+     */
+    size_t getSlowOpCaptureSize() const {
+        return slow_op_capture_size.load(std::memory_order_relaxed);
+    }
+
+    void setSlowOpCaptureSize(size_t size) {
+        slow_op_capture_size.store(size, std::memory_order_relaxed);
+        has.slow_op_capture_size = true;
+        notify_changed("slow_op_capture_size");
+    }
+
     void setScramshaFallbackSalt(const std::string& value) {
         scramsha_fallback_salt.wlock()->assign(value);
         has.scramsha_fallback_salt = true;
@@ -754,6 +1141,27 @@ public:
         notify_changed("active_external_users_push_interval");
     }
 
+    std::chrono::microseconds getExternalAuthCacheTtl() const {
+        return external_auth_cache_ttl.load(std::memory_order_acquire);
+    }
+
+    void setExternalAuthCacheTtl(const std::chrono::microseconds ttl) {
+        external_auth_cache_ttl.store(ttl, std::memory_order_release);
+        has.external_auth_cache_ttl = true;
+        notify_changed("external_auth_cache_ttl");
+    }
+
+    std::chrono::microseconds getExternalAuthNegativeCacheTtl() const {
+        return external_auth_negative_cache_ttl.load(
+                std::memory_order_acquire);
+    }
+
+    void setExternalAuthNegativeCacheTtl(const std::chrono::microseconds ttl) {
+        external_auth_negative_cache_ttl.store(ttl, std::memory_order_release);
+        has.external_auth_negative_cache_ttl = true;
+        notify_changed("external_auth_negative_cache_ttl");
+    }
+
     /**
      * Get the (optional) OpenTracing configuration.
      *
@@ -814,6 +1222,16 @@ protected:
      * */
     size_t num_threads;
 
+    /// The size of the SASL executor pool (0 == num_threads)
+    size_t num_sasl_threads = 0;
+
+    /// The number of worker threads serving new connections (0 == all)
+    std::atomic<size_t> num_active_threads{0};
+
+    /// The policy used to pick the worker thread for new connections
+    std::atomic<ConnectionDispatchPolicy> connection_dispatch_policy{
+            ConnectionDispatchPolicy::RoundRobin};
+
     /// Array of interface settings we are listening on
     folly::Synchronized<std::vector<NetworkInterface>> interfaces;
 
@@ -867,6 +1285,14 @@ protected:
     int reqs_per_event_low_priority;
     int default_reqs_per_event;
 
+    /// Order the ready connections by their connection class
+    std::atomic_bool qos_scheduling_enabled{false};
+
+    /// The weight of each connection class when qos scheduling is enabled
+    std::atomic<size_t> qos_weight_kv{8};
+    std::atomic<size_t> qos_weight_bulk{2};
+    std::atomic<size_t> qos_weight_admin{1};
+
     /**
      * Breakpad crash catcher settings
      */
@@ -880,6 +1306,23 @@ protected:
      */
     uint32_t max_packet_size;
 
+    /**
+     * The budget (in bytes and entries in the IO vector) for queueing up
+     * responses for pipelined commands before we send them
+     */
+    std::atomic<size_t> response_coalescing_bytes{0};
+    std::atomic<size_t> response_coalescing_iovecs{64};
+
+    /// The number of documents per front end thread in the subdoc lookup
+    /// cache
+    std::atomic<size_t> subdoc_lookup_cache_size{0};
+
+    /**
+     * Document data in responses of at least this size is sent with
+     * MSG_ZEROCOPY on plain connections (0 = disabled)
+     */
+    std::atomic<size_t> zerocopy_send_threshold{0};
+
     /**
      * The SSL cipher list to use
      */
@@ -888,6 +1331,18 @@ protected:
     /// if we should use the ssl cipher ordering
     std::atomic_bool ssl_cipher_order{true};
 
+    /// if we should try to offload TLS encryption to the kernel
+    std::atomic_bool ssl_ktls{false};
+
+    /// The number of sessions in the shared TLS session cache
+    std::atomic<size_t> ssl_session_cache_size{0};
+
+    /// if the connections should share the session ticket keys
+    std::atomic_bool ssl_session_tickets{false};
+
+    /// The lifetime of a TLS session (in seconds)
+    std::atomic<size_t> ssl_session_timeout{300};
+
     /**
      * The minimum ssl protocol to use (by default this is TLS1)
      */
@@ -937,16 +1392,49 @@ protected:
      */
     std::atomic_bool topkeys_enabled{false};
 
+    /// Record 1 in topkeys_sample_rate key accesses in topkeys
+    std::atomic<size_t> topkeys_sample_rate{1};
+
     /**
      * Is tracing enabled or not
      */
     std::atomic_bool tracing_enabled{true};
 
+    /**
+     * Record the latency of the document operations per vbucket and per
+     * collection
+     */
+    std::atomic_bool keyspace_timings{false};
+
+    /// The bucket pressure (in percent) at which we start shedding load
+    std::atomic<size_t> admission_control_threshold{0};
+
+    /// The latency percentile used as the slow operation threshold
+    std::atomic<double> slow_op_percentile{0};
+
+    /// The number of slow operations captured
+    std::atomic<size_t> slow_op_capture_size{0};
+
     /**
      * Use standard input listener
      */
     std::atomic_bool stdin_listener{true};
 
+    /**
+     * Should each front end thread have its own SO_REUSEPORT listening
+     * socket for each of the ports
+     */
+    std::atomic_bool reuseport_listeners{false};
+
+    /**
+     * Should the front end threads use a changelist to merge the
+     * changes to the events before they're passed to the kernel
+     */
+    std::atomic_bool event_loop_changelist{false};
+
+    /// The CPUs (or NUMA node) the front end threads should be pinned to
+    std::string front_end_thread_affinity;
+
     /**
      * Should we allow for using the external authentication service or not
      */
@@ -955,6 +1443,16 @@ protected:
     std::atomic<std::chrono::microseconds> active_external_users_push_interval{
             std::chrono::minutes(5)};
 
+    /**
+     * How long a successful (and failed) authentication by the external
+     * authentication service may be reused for the same credentials
+     * without asking the service again (0 means never)
+     */
+    std::atomic<std::chrono::microseconds> external_auth_cache_ttl{
+            std::chrono::microseconds{0}};
+    std::atomic<std::chrono::microseconds> external_auth_negative_cache_ttl{
+            std::chrono::microseconds{0}};
+
     /// The maximum number of connections allowed
     std::atomic<size_t> max_connections{60000};
 
@@ -981,6 +1479,7 @@ public:
         bool rbac_file;
         bool privilege_debug;
         bool threads;
+        bool connection_dispatch_policy;
         bool interfaces;
         bool logger;
         bool audit;
@@ -988,6 +1487,10 @@ public:
         bool reqs_per_event_med_priority;
         bool reqs_per_event_low_priority;
         bool default_reqs_per_event;
+        bool qos_scheduling_enabled;
+        bool qos_weight_kv;
+        bool qos_weight_bulk;
+        bool qos_weight_admin;
         bool verbose;
         bool connection_idle_time;
         bool bio_drain_buffer_sz;
@@ -996,8 +1499,16 @@ public:
         bool root;
         bool breakpad;
         bool max_packet_size;
+        bool zerocopy_send_threshold;
+        bool response_coalescing_bytes;
+        bool response_coalescing_iovecs;
+        bool subdoc_lookup_cache_size;
         bool ssl_cipher_list;
         bool ssl_cipher_order;
+        bool ssl_ktls;
+        bool ssl_session_cache_size;
+        bool ssl_session_tickets;
+        bool ssl_session_timeout;
         bool ssl_minimum_protocol;
         bool client_cert_auth;
         bool topkeys_size;
@@ -1009,11 +1520,23 @@ public:
         bool collections_enabled;
         bool opcode_attributes_override;
         bool topkeys_enabled;
+        bool topkeys_sample_rate;
         bool tracing_enabled;
+        bool keyspace_timings = false;
+        bool admission_control_threshold = false;
+        bool slow_op_percentile = false;
+        bool slow_op_capture_size = false;
         bool stdin_listener;
+        bool reuseport_listeners;
+        bool event_loop_changelist;
+        bool front_end_thread_affinity;
         bool scramsha_fallback_salt;
+        bool sasl_threads = false;
+        bool active_threads = false;
         bool external_auth_service;
         bool active_external_users_push_interval = false;
+        bool external_auth_cache_ttl = false;
+        bool external_auth_negative_cache_ttl = false;
         bool max_connections = false;
         bool system_connections = false;
         bool opentracing_config = false;
@@ -0,0 +1,127 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "slow_op_log.h"
+#include "timings.h"
+
+#include <nlohmann/json.hpp>
+#include <platform/string_hex.h>
+
+#include <algorithm>
+
+namespace cb {
+
+SlowOpLog slowOpLog;
+
+const uint64_t AdaptiveSlowOpThresholds::MinSamples = 1000;
+
+nlohmann::json SlowOpRecord::toJSON() const {
+    using namespace std::chrono;
+    nlohmann::json ret;
+    ret["timestamp_us"] =
+            duration_cast<microseconds>(timestamp.time_since_epoch()).count();
+    try {
+        ret["opcode"] = to_string(opcode);
+    } catch (const std::exception&) {
+        ret["opcode"] = cb::to_hex(uint8_t(opcode));
+    }
+    ret["duration_us"] = duration_cast<microseconds>(duration).count();
+    ret["threshold_us"] = duration_cast<microseconds>(threshold).count();
+    ret["adaptive"] = adaptive;
+    ret["execution_us"] = duration_cast<microseconds>(execution).count();
+    ret["blocked_us"] = duration_cast<microseconds>(blocked).count();
+    ret["blocked_count"] = blockedCount;
+    ret["allocated"] = allocated;
+
+    auto array = nlohmann::json::array();
+    for (const auto& span : spans) {
+        nlohmann::json entry;
+        entry["name"] = to_string(span.code);
+        entry["start_us"] =
+                duration_cast<microseconds>(span.start - start).count();
+        entry["duration_us"] = span.duration.count();
+        array.push_back(entry);
+    }
+    ret["spans"] = array;
+
+    ret["connection_id"] = connectionId;
+    ret["opaque"] = cb::to_hex(opaque);
+    ret["peer"] = peer;
+    ret["user"] = user;
+    ret["bucket"] = bucket;
+    ret["key"] = key;
+    return ret;
+}
+
+void SlowOpLog::setCapacity(size_t size) {
+    std::lock_guard<std::mutex> guard(mutex);
+    capacity = size;
+    while (records.size() > size) {
+        records.pop_front();
+    }
+}
+
+void SlowOpLog::record(SlowOpRecord record) {
+    std::lock_guard<std::mutex> guard(mutex);
+    const size_t size = capacity;
+    if (size == 0) {
+        return;
+    }
+    while (records.size() >= size) {
+        records.pop_front();
+    }
+    records.emplace_back(std::move(record));
+    ++recorded;
+}
+
+std::vector<SlowOpRecord> SlowOpLog::getRecords(size_t count) const {
+    std::lock_guard<std::mutex> guard(mutex);
+    count = std::min(count, records.size());
+    return {records.rbegin(), records.rbegin() + count};
+}
+
+void SlowOpLog::clear() {
+    std::lock_guard<std::mutex> guard(mutex);
+    records.clear();
+}
+
+void AdaptiveSlowOpThresholds::update(const Timings& timings,
+                                      double percentile,
+                                      std::chrono::nanoseconds minimum) {
+    if (percentile <= 0) {
+        reset();
+        return;
+    }
+
+    for (size_t opcode = 0; opcode < thresholds.size(); ++opcode) {
+        uint64_t threshold = 0;
+        auto histogram = timings.get_timing_histogram(uint8_t(opcode));
+        if (histogram && histogram->getValueCount() >= MinSamples) {
+            const std::chrono::nanoseconds value = std::chrono::microseconds(
+                    histogram->getValueAtPercentile(percentile));
+            threshold = uint64_t(std::max(value, minimum).count());
+        }
+        thresholds[opcode].store(threshold, std::memory_order_relaxed);
+    }
+}
+
+void AdaptiveSlowOpThresholds::reset() {
+    for (auto& threshold : thresholds) {
+        threshold.store(0, std::memory_order_relaxed);
+    }
+}
+
+} // namespace cb
@@ -0,0 +1,160 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <mcbp/protocol/opcode.h>
+#include <nlohmann/json_fwd.hpp>
+#include <relaxed_atomic.h>
+#include <tracing/tracer.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class Timings;
+
+namespace cb {
+
+/**
+ * Everything we know about a slow request when it completes: its trace
+ * spans, where the time went (executing, or blocked waiting for the
+ * engine) and the connection it came from.
+ */
+struct SlowOpRecord {
+    /// When the request completed
+    std::chrono::system_clock::time_point timestamp;
+    /// The total time from the request was received until it completed
+    std::chrono::nanoseconds duration{0};
+    /// The threshold the request exceeded
+    std::chrono::nanoseconds threshold{0};
+    /// Was the threshold derived from the latencies of the opcode (or is it
+    /// the SLA configured for the opcode)?
+    bool adaptive = false;
+    cb::mcbp::ClientOpcode opcode = cb::mcbp::ClientOpcode::Invalid;
+
+    /// When the request was received (the spans are relative to it)
+    std::chrono::steady_clock::time_point start;
+    std::vector<cb::tracing::Span> spans;
+
+    /// The time the front end thread spent executing the request
+    std::chrono::nanoseconds execution{0};
+    /// The time the request spent blocked waiting for the engine
+    std::chrono::nanoseconds blocked{0};
+    /// The number of times the request blocked (saturates at 255)
+    uint8_t blockedCount = 0;
+    /// Bytes allocated by the front end thread executing the request
+    uint64_t allocated = 0;
+
+    uint32_t connectionId = 0;
+    uint32_t opaque = 0;
+    std::string peer;
+    std::string user;
+    std::string bucket;
+    /// The key of the request (tagged as user data)
+    std::string key;
+
+    nlohmann::json toJSON() const;
+};
+
+/**
+ * A bounded buffer of the most recent slow requests (shared by all of the
+ * front end threads, which only add to it for the requests exceeding
+ * their threshold).
+ */
+class SlowOpLog {
+public:
+    /// Set the number of requests kept (0 disables the log)
+    void setCapacity(size_t size);
+
+    size_t getCapacity() const {
+        return capacity;
+    }
+
+    bool isEnabled() const {
+        return capacity != 0;
+    }
+
+    /// Add a request, dropping the oldest one if the log is full
+    void record(SlowOpRecord record);
+
+    /// Get (a copy of) the most recent requests, most recent first
+    std::vector<SlowOpRecord> getRecords(size_t count) const;
+
+    /// Get the number of requests recorded (including the ones dropped)
+    uint64_t getNumRecorded() const {
+        return recorded;
+    }
+
+    void clear();
+
+protected:
+    cb::RelaxedAtomic<size_t> capacity{0};
+    cb::RelaxedAtomic<uint64_t> recorded{0};
+
+    mutable std::mutex mutex;
+    std::deque<SlowOpRecord> records;
+};
+
+/**
+ * Slow operation thresholds for each opcode derived from its latency
+ * percentiles (the latencies recorded by the timings of a bucket), so that
+ * the outliers of the fast opcodes are captured too and not only the
+ * requests exceeding the (fixed) SLA.
+ */
+class AdaptiveSlowOpThresholds {
+public:
+    /// Don't derive a threshold from fewer samples than this
+    static const uint64_t MinSamples;
+
+    /**
+     * Get the threshold for the opcode
+     *
+     * @return the threshold, or 0 if there is none (the adaptive
+     *         thresholds are disabled, or there aren't enough samples)
+     */
+    std::chrono::nanoseconds get(cb::mcbp::ClientOpcode opcode) const {
+        return std::chrono::nanoseconds(
+                thresholds[uint8_t(opcode)].load(std::memory_order_relaxed));
+    }
+
+    /**
+     * Derive the thresholds from the latencies recorded
+     *
+     * @param timings the timings to read the latencies from
+     * @param percentile the percentile of the latencies to use as the
+     *                   threshold (0 clears the thresholds)
+     * @param minimum the lowest threshold to use
+     */
+    void update(const Timings& timings,
+                double percentile,
+                std::chrono::nanoseconds minimum);
+
+    void reset();
+
+protected:
+    std::array<std::atomic<uint64_t>, 0x100> thresholds{};
+};
+
+/// The log of the slow requests (sized by "slow_op_capture_size")
+extern SlowOpLog slowOpLog;
+
+} // namespace cb
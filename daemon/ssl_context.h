@@ -75,11 +75,9 @@ public:
     }
 
     /**
-     * Set the status of the connected flag
+     * Set the status of the connected flag (the handshake is complete)
      */
-    void setConnected() {
-        connected = true;
-    }
+    void setConnected();
 
     /**
      * Is there an error on the SSL stream?
@@ -126,6 +124,34 @@ public:
         return !outputPipe.empty();
     }
 
+    /**
+     * Is the encryption of the data we send performed by the kernel
+     * (kTLS)? If so the caller should write plain data to the socket
+     */
+    bool isKtlsTxEnabled() const {
+        return ktls.tx;
+    }
+
+    /**
+     * Try to install the negotiated keys for the send path in the kernel
+     * (if requested in the settings and supported for the negotiated
+     * protocol and cipher). Must be called when the handshake is complete
+     * and all of the handshake data is sent (the method does nothing
+     * otherwise, or if it already tried). The kernel starts at record
+     * sequence 0, so once OpenSSL has encrypted a record after the
+     * handshake the send path stays in OpenSSL.
+     *
+     * @param sfd the socket used by the connection
+     */
+    void tryEnableKtlsTx(SOCKET sfd);
+
+    /**
+     * Called from OpenSSL's keylog callback during the handshake so that
+     * we can pick up the server traffic secret used to derive the keys
+     * for kTLS
+     */
+    void captureKeylogLine(const char* line);
+
     /**
      * Dump the list of available ciphers to the log
      * @param id the connection id. Its only used in the
@@ -152,6 +178,9 @@ public:
 protected:
     bool drainInputSocketBuf();
 
+    /// Stop trying to enable kTLS and forget the traffic secret
+    void abandonKtls();
+
     bool enabled = false;
     bool connected = false;
     bool error = false;
@@ -171,4 +200,18 @@ protected:
     size_t totalRecv = 0;
     // Total number of bytes sent to the network
     size_t totalSend = 0;
+
+    /// The state used for offloading the send path to the kernel
+    struct {
+        /// Should we try to enable kTLS once the handshake is complete
+        bool requested = false;
+        /// Is the send path handled by the kernel
+        bool tx = false;
+        /// The number of bytes OpenSSL had written when the handshake
+        /// completed; any more means it wrote records the kernel can't
+        /// account for in its record sequence
+        uint64_t handshakeWritten = 0;
+        /// The server application traffic secret from the handshake
+        std::vector<uint8_t> secret;
+    } ktls;
 };
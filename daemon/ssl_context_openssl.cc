@@ -19,12 +19,32 @@
 #include "memcached.h"
 #include "runtime.h"
 #include "settings.h"
+#include "ssl_session_cache.h"
 
 #include <logger/logger.h>
 #include <nlohmann/json.hpp>
+#include <openssl/kdf.h>
 #include <platform/socket.h>
 #include <platform/strerror.h>
 #include <utilities/logtags.h>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+#if defined(__linux__) && OPENSSL_VERSION_NUMBER >= 0x10101000L
+#include <linux/tls.h>
+#include <netinet/tcp.h>
+#if defined(TLS_1_3_VERSION) && defined(TLS_CIPHER_AES_GCM_256)
+#define HAVE_KTLS 1
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+#endif
+#endif
 
 SslContext::~SslContext() {
     if (enabled) {
@@ -32,6 +52,163 @@ SslContext::~SslContext() {
     }
 }
 
+#ifdef HAVE_KTLS
+static void keylog_callback(const SSL* ssl, const char* line) {
+    auto* context = reinterpret_cast<SslContext*>(SSL_get_app_data(ssl));
+    if (context != nullptr) {
+        context->captureKeylogLine(line);
+    }
+}
+
+/**
+ * HKDF-Expand-Label as defined in RFC 8446 section 7.1 (with an empty
+ * context)
+ */
+static bool hkdf_expand_label(const EVP_MD* md,
+                              const std::vector<uint8_t>& secret,
+                              const std::string& label,
+                              uint8_t* out,
+                              size_t outlen) {
+    const std::string fullLabel = "tls13 " + label;
+    std::vector<uint8_t> info;
+    info.push_back(uint8_t(outlen >> 8));
+    info.push_back(uint8_t(outlen & 0xff));
+    info.push_back(uint8_t(fullLabel.size()));
+    info.insert(info.end(), fullLabel.begin(), fullLabel.end());
+    info.push_back(0);
+
+    std::unique_ptr<EVP_PKEY_CTX, decltype(&EVP_PKEY_CTX_free)> pctx(
+            EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, nullptr), EVP_PKEY_CTX_free);
+    return pctx && EVP_PKEY_derive_init(pctx.get()) > 0 &&
+           EVP_PKEY_CTX_hkdf_mode(pctx.get(),
+                                  EVP_PKEY_HKDEF_MODE_EXPAND_ONLY) > 0 &&
+           EVP_PKEY_CTX_set_hkdf_md(pctx.get(), md) > 0 &&
+           EVP_PKEY_CTX_set1_hkdf_key(pctx.get(),
+                                      secret.data(),
+                                      int(secret.size())) > 0 &&
+           EVP_PKEY_CTX_add1_hkdf_info(
+                   pctx.get(), info.data(), int(info.size())) > 0 &&
+           EVP_PKEY_derive(pctx.get(), out, &outlen) > 0;
+}
+
+/**
+ * Fill in the kernel's crypto info for the send path of a TLSv1.3
+ * connection (rec_seq is zero as we're called before any application
+ * data is sent)
+ */
+template <typename T>
+static bool build_crypto_info(T& info,
+                              uint16_t cipher_type,
+                              const EVP_MD* md,
+                              const std::vector<uint8_t>& secret) {
+    // The TLSv1.3 IV is the 4 byte salt followed by the 8 byte "iv"
+    std::array<uint8_t, sizeof(info.salt) + sizeof(info.iv)> iv;
+    info.info.version = TLS_1_3_VERSION;
+    info.info.cipher_type = cipher_type;
+    if (!hkdf_expand_label(md, secret, "key", info.key, sizeof(info.key)) ||
+        !hkdf_expand_label(md, secret, "iv", iv.data(), iv.size())) {
+        return false;
+    }
+    std::memcpy(info.salt, iv.data(), sizeof(info.salt));
+    std::memcpy(info.iv, iv.data() + sizeof(info.salt), sizeof(info.iv));
+    std::memset(info.rec_seq, 0, sizeof(info.rec_seq));
+    OPENSSL_cleanse(iv.data(), iv.size());
+    return true;
+}
+#endif
+
+void SslContext::captureKeylogLine(const char* line) {
+    static const std::string label = "SERVER_TRAFFIC_SECRET_0 ";
+    if (strncmp(line, label.c_str(), label.size()) != 0) {
+        return;
+    }
+
+    // The line is: <label> <client random (hex)> <secret (hex)>
+    const char* secret = strrchr(line, ' ');
+    if (secret == nullptr) {
+        return;
+    }
+    ++secret;
+
+    ktls.secret.clear();
+    for (size_t ii = 0; secret[ii] != '\0' && secret[ii + 1] != '\0';
+         ii += 2) {
+        const char hex[3] = {secret[ii], secret[ii + 1], '\0'};
+        ktls.secret.push_back(uint8_t(strtoul(hex, nullptr, 16)));
+    }
+}
+
+void SslContext::setConnected() {
+    connected = true;
+    ktls.handshakeWritten = BIO_number_written(application);
+}
+
+void SslContext::abandonKtls() {
+    ktls.requested = false;
+    OPENSSL_cleanse(ktls.secret.data(), ktls.secret.size());
+    ktls.secret.clear();
+}
+
+void SslContext::tryEnableKtlsTx(SOCKET sfd) {
+    if (!ktls.requested || !connected) {
+        return;
+    }
+
+    if (BIO_number_written(application) != ktls.handshakeWritten) {
+        // OpenSSL encrypted a record after the handshake (e.g. a response
+        // written while the handshake data was still being drained), so
+        // its write sequence is past the 0 the kernel would start at.
+        abandonKtls();
+        return;
+    }
+
+    if (morePendingOutput() || BIO_ctrl_pending(network) != 0) {
+        return;
+    }
+    // Only try once
+    ktls.requested = false;
+
+#ifdef HAVE_KTLS
+    std::vector<uint8_t> secret;
+    secret.swap(ktls.secret);
+    const auto* cipher = SSL_get_current_cipher(client);
+    if (SSL_version(client) != TLS1_3_VERSION || cipher == nullptr ||
+        secret.empty()) {
+        OPENSSL_cleanse(secret.data(), secret.size());
+        return;
+    }
+
+    const std::string name = SSL_CIPHER_get_name(cipher);
+    const auto* md = SSL_CIPHER_get_handshake_digest(cipher);
+    bool success = false;
+    if (name == "TLS_AES_128_GCM_SHA256") {
+        tls12_crypto_info_aes_gcm_128 info = {};
+        success = build_crypto_info(info, TLS_CIPHER_AES_GCM_128, md, secret) &&
+                  cb::net::setsockopt(sfd, SOL_TCP, TCP_ULP, "tls", 4) == 0 &&
+                  cb::net::setsockopt(
+                          sfd, SOL_TLS, TLS_TX, &info, sizeof(info)) == 0;
+        OPENSSL_cleanse(&info, sizeof(info));
+    } else if (name == "TLS_AES_256_GCM_SHA384") {
+        tls12_crypto_info_aes_gcm_256 info = {};
+        success = build_crypto_info(info, TLS_CIPHER_AES_GCM_256, md, secret) &&
+                  cb::net::setsockopt(sfd, SOL_TCP, TCP_ULP, "tls", 4) == 0 &&
+                  cb::net::setsockopt(
+                          sfd, SOL_TLS, TLS_TX, &info, sizeof(info)) == 0;
+        OPENSSL_cleanse(&info, sizeof(info));
+    }
+    OPENSSL_cleanse(secret.data(), secret.size());
+
+    if (success) {
+        ktls.tx = true;
+    } else {
+        LOG_DEBUG("{}: kTLS not available for cipher {}: {}",
+                  sfd,
+                  name,
+                  cb_strerror(cb::net::get_socket_error()));
+    }
+#endif
+}
+
 int SslContext::accept() {
     return SSL_accept(client);
 }
@@ -45,6 +222,11 @@ int SslContext::read(void* buf, int num) {
 }
 
 int SslContext::write(const void* buf, int num) {
+    if (ktls.requested) {
+        // The record is encrypted by OpenSSL (and moves its write
+        // sequence), so the kernel can't take over the send path
+        abandonKtls();
+    }
     return SSL_write(client, buf, num);
 }
 
@@ -71,6 +253,7 @@ bool SslContext::enable(const std::string& cert, const std::string& pkey) {
     }
 
     set_ssl_ctx_cipher_list(ctx);
+    set_ssl_ctx_session_resumption(ctx);
     int ssl_flags = 0;
     switch (settings.getClientCertMode()) {
     case cb::x509::Mode::Mandatory:
@@ -111,6 +294,18 @@ bool SslContext::enable(const std::string& cert, const std::string& pkey) {
     client = SSL_new(ctx);
     SSL_set_bio(client, application, application);
 
+#ifdef HAVE_KTLS
+    if (settings.isSslKtlsEnabled()) {
+        // We can't send the session tickets through OpenSSL after we've
+        // installed the keys in the kernel (and the kernel would need to
+        // know the record sequence number), so disable them.
+        SSL_set_app_data(client, this);
+        SSL_set_num_tickets(client, 0);
+        SSL_CTX_set_keylog_callback(ctx, keylog_callback);
+        ktls.requested = true;
+    }
+#endif
+
     return true;
 }
 
@@ -130,6 +325,7 @@ void SslContext::disable() {
     if (ctx != nullptr) {
         SSL_CTX_free(ctx);
     }
+    abandonKtls();
     enabled = false;
 }
 
@@ -229,6 +425,17 @@ void SslContext::drainBioSendPipe(SOCKET sfd) {
             }
         }
 
+        if (ktls.tx && BIO_ctrl_pending(network) != 0) {
+            // OpenSSL generated a record after we moved the send path to
+            // the kernel (e.g. a response to a KeyUpdate request). We
+            // can't send it without corrupting the stream.
+            LOG_WARNING(
+                    "{}: OpenSSL tried to send data on a kTLS connection",
+                    sfd);
+            error = true;
+            return;
+        }
+
         if (!outputPipe.full()) {
             auto* bio = network;
             auto n = outputPipe.produce([bio](cb::byte_buffer data) -> ssize_t {
@@ -272,6 +479,7 @@ nlohmann::json SslContext::toJSON() const {
         obj["error"] = error;
         obj["total_recv"] = totalRecv;
         obj["total_send"] = totalSend;
+        obj["ktls_tx"] = ktls.tx;
     }
 
     return obj;
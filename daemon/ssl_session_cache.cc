@@ -0,0 +1,304 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "ssl_session_cache.h"
+
+#include "settings.h"
+
+#include <gsl/gsl>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * The sessions of all of the connections, keyed by the session id. The
+ * sessions are kept in their serialized form so that they're independent
+ * of the SSL_CTX they were created by. The oldest sessions are dropped
+ * when the cache is full.
+ */
+class SslSessionCache {
+public:
+    void insert(SSL_SESSION* session) {
+        const size_t maxSize = settings.getSslSessionCacheSize();
+        if (maxSize == 0) {
+            return;
+        }
+
+        unsigned int idlen;
+        const auto* id = SSL_SESSION_get_id(session, &idlen);
+        const int len = i2d_SSL_SESSION(session, nullptr);
+        if (idlen == 0 || len <= 0) {
+            return;
+        }
+
+        Entry entry;
+        entry.id.assign(reinterpret_cast<const char*>(id), idlen);
+        entry.der.resize(len);
+        auto* p = entry.der.data();
+        i2d_SSL_SESSION(session, &p);
+        entry.expiry = std::chrono::steady_clock::now() +
+                       std::chrono::seconds(settings.getSslSessionTimeout());
+
+        std::lock_guard<std::mutex> guard(mutex);
+        erase_UNLOCKED(entry.id);
+        entries.push_back(std::move(entry));
+        index.emplace(entries.back().id, std::prev(entries.end()));
+        while (entries.size() > maxSize) {
+            erase_UNLOCKED(entries.front().id);
+        }
+    }
+
+    /**
+     * Look up a session
+     *
+     * @return a new session object (owned by the caller) or nullptr
+     */
+    SSL_SESSION* lookup(const unsigned char* id, int len) {
+        std::vector<unsigned char> der;
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            auto iter = index.find(
+                    std::string(reinterpret_cast<const char*>(id), len));
+            if (iter == index.end()) {
+                return nullptr;
+            }
+            if (iter->second->expiry < std::chrono::steady_clock::now()) {
+                erase_UNLOCKED(iter->second->id);
+                return nullptr;
+            }
+            der = iter->second->der;
+        }
+
+        const unsigned char* p = der.data();
+        auto* session = d2i_SSL_SESSION(nullptr, &p, long(der.size()));
+        OPENSSL_cleanse(der.data(), der.size());
+        return session;
+    }
+
+    void remove(SSL_SESSION* session) {
+        unsigned int idlen;
+        const auto* id = SSL_SESSION_get_id(session, &idlen);
+        std::lock_guard<std::mutex> guard(mutex);
+        erase_UNLOCKED(std::string(reinterpret_cast<const char*>(id), idlen));
+    }
+
+private:
+    struct Entry {
+        std::string id;
+        std::vector<unsigned char> der;
+        std::chrono::steady_clock::time_point expiry;
+    };
+
+    void erase_UNLOCKED(const std::string& id) {
+        auto iter = index.find(id);
+        if (iter != index.end()) {
+            auto entry = iter->second;
+            index.erase(iter);
+            OPENSSL_cleanse(entry->der.data(), entry->der.size());
+            entries.erase(entry);
+        }
+    }
+
+    std::mutex mutex;
+    /// The sessions, oldest first
+    std::list<Entry> entries;
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+};
+
+struct TicketKey {
+    std::array<unsigned char, 16> name;
+    std::array<unsigned char, 32> aes;
+    std::array<unsigned char, 32> hmac;
+};
+
+/**
+ * The keys used to encrypt the session tickets. A new key is created
+ * every ssl_session_timeout seconds, and the previous key is kept for
+ * another period to decrypt the tickets handed out before the rotation.
+ */
+class TicketKeys {
+public:
+    /**
+     * Get the current (and previous) key, rotating them if it is time
+     *
+     * @return false if we failed to create a key
+     */
+    bool get(TicketKey& current, TicketKey& previous, bool& havePrevious) {
+        const auto now = std::chrono::steady_clock::now();
+        const auto interval =
+                std::chrono::seconds(settings.getSslSessionTimeout());
+
+        std::lock_guard<std::mutex> guard(mutex);
+        if (!initialized || now - rotated >= interval) {
+            TicketKey next;
+            if (RAND_bytes(next.name.data(), int(next.name.size())) != 1 ||
+                RAND_bytes(next.aes.data(), int(next.aes.size())) != 1 ||
+                RAND_bytes(next.hmac.data(), int(next.hmac.size())) != 1) {
+                OPENSSL_cleanse(&next, sizeof(next));
+                return false;
+            }
+            // The previous key is too old if we didn't rotate in time
+            previousValid = initialized && now - rotated < 2 * interval;
+            previousKey = currentKey;
+            currentKey = next;
+            OPENSSL_cleanse(&next, sizeof(next));
+            rotated = now;
+            initialized = true;
+        }
+
+        current = currentKey;
+        previous = previousKey;
+        havePrevious = previousValid;
+        return true;
+    }
+
+private:
+    std::mutex mutex;
+    bool initialized = false;
+    bool previousValid = false;
+    std::chrono::steady_clock::time_point rotated;
+    TicketKey currentKey;
+    TicketKey previousKey;
+};
+
+static SslSessionCache sessionCache;
+static TicketKeys ticketKeys;
+
+static int new_session_callback(SSL*, SSL_SESSION* session) {
+    sessionCache.insert(session);
+    // We keep a copy, not a reference to the session
+    return 0;
+}
+
+static SSL_SESSION* get_session_callback(SSL*,
+                                         const unsigned char* id,
+                                         int len,
+                                         int* copy) {
+    // The session returned is ours; OpenSSL shouldn't add a reference
+    *copy = 0;
+    return sessionCache.lookup(id, len);
+}
+
+static void remove_session_callback(SSL_CTX*, SSL_SESSION* session) {
+    sessionCache.remove(session);
+}
+
+static int ticket_key_callback(SSL*,
+                               unsigned char* name,
+                               unsigned char* iv,
+                               EVP_CIPHER_CTX* cipher,
+                               HMAC_CTX* hmac,
+                               int enc) {
+    TicketKey current;
+    TicketKey previous;
+    bool havePrevious;
+    auto cleanse = gsl::finally([&current, &previous]() {
+        OPENSSL_cleanse(&current, sizeof(current));
+        OPENSSL_cleanse(&previous, sizeof(previous));
+    });
+    if (!ticketKeys.get(current, previous, havePrevious)) {
+        return -1;
+    }
+
+    if (enc) {
+        if (RAND_bytes(iv, EVP_CIPHER_iv_length(EVP_aes_256_cbc())) != 1 ||
+            EVP_EncryptInit_ex(cipher,
+                               EVP_aes_256_cbc(),
+                               nullptr,
+                               current.aes.data(),
+                               iv) != 1 ||
+            HMAC_Init_ex(hmac,
+                         current.hmac.data(),
+                         int(current.hmac.size()),
+                         EVP_sha256(),
+                         nullptr) != 1) {
+            return -1;
+        }
+        std::memcpy(name, current.name.data(), current.name.size());
+        return 1;
+    }
+
+    const TicketKey* key;
+    int ret;
+    if (std::memcmp(name, current.name.data(), current.name.size()) == 0) {
+        key = &current;
+        ret = 1;
+    } else if (havePrevious &&
+               std::memcmp(name, previous.name.data(), previous.name.size()) ==
+                       0) {
+        // Accept the ticket, but let the client have a new one
+        key = &previous;
+        ret = 2;
+    } else {
+        // Unknown (or expired) key; do a full handshake
+        return 0;
+    }
+
+    if (HMAC_Init_ex(hmac,
+                     key->hmac.data(),
+                     int(key->hmac.size()),
+                     EVP_sha256(),
+                     nullptr) != 1 ||
+        EVP_DecryptInit_ex(
+                cipher, EVP_aes_256_cbc(), nullptr, key->aes.data(), iv) !=
+                1) {
+        return -1;
+    }
+    return ret;
+}
+
+void set_ssl_ctx_session_resumption(SSL_CTX* ctx) {
+    const bool tickets = settings.isSslSessionTicketsEnabled();
+    const bool cache = settings.getSslSessionCacheSize() != 0;
+    if (!tickets && !cache) {
+        return;
+    }
+
+    // Only resume the sessions created with the same client certificate
+    // settings
+    const std::string context =
+            "memcached:" + std::to_string(int(settings.getClientCertMode()));
+    SSL_CTX_set_session_id_context(
+            ctx,
+            reinterpret_cast<const unsigned char*>(context.data()),
+            unsigned(context.size()));
+    SSL_CTX_set_timeout(ctx, long(settings.getSslSessionTimeout()));
+
+    if (cache) {
+        SSL_CTX_set_session_cache_mode(
+                ctx, SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_NO_INTERNAL);
+        SSL_CTX_sess_set_new_cb(ctx, new_session_callback);
+        SSL_CTX_sess_set_get_cb(ctx, get_session_callback);
+        SSL_CTX_sess_set_remove_cb(ctx, remove_session_callback);
+    } else {
+        SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+    }
+
+    if (tickets) {
+        SSL_CTX_set_tlsext_ticket_key_cb(ctx, ticket_key_callback);
+    } else {
+        // Without the shared keys a ticket can't be used on another
+        // connection; use the session cache for TLSv1.3 as well
+        SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+    }
+}
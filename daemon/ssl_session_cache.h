@@ -0,0 +1,41 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <memcached/openssl.h>
+
+/**
+ * Set up TLS session resumption for a connection's SSL_CTX.
+ *
+ * Every connection creates its own SSL_CTX (see SslContext::enable), so
+ * OpenSSL's own session cache and session ticket keys (which belong to the
+ * SSL_CTX) are never seen by the next connection from the same client and
+ * every connection had to run a full handshake. Depending on the settings
+ * the context is hooked up to:
+ *
+ *  - a session cache shared by all of the front end threads
+ *    (ssl_session_cache_size), used for session id based resumption and
+ *    the TLSv1.3 (stateful) tickets when the shared ticket keys aren't
+ *    enabled
+ *  - session ticket keys shared by all of the connections
+ *    (ssl_session_tickets), rotated every ssl_session_timeout seconds.
+ *    Tickets encrypted with the previous key are still accepted (and
+ *    renewed).
+ *
+ * The context is left untouched if neither is enabled.
+ */
+void set_ssl_ctx_session_resumption(SSL_CTX* ctx);
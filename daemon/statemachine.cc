@@ -25,6 +25,7 @@
 #include "mcaudit.h"
 #include "mcbp.h"
 #include "mcbp_executors.h"
+#include "mcbp_opcode_descriptor.h"
 #include "sasl_tasks.h"
 #include "settings.h"
 
@@ -287,7 +288,7 @@ bool StateMachine::conn_new_cmd() {
         return true;
     }
 
-    if (!connection.write->empty()) {
+    if (!connection.write->empty() && !connection.hasCoalescedResponses()) {
         LOG_WARNING("{}: Expected write buffer to be empty.. It's not! ({})",
                     connection.getId(),
                     connection.write->rsize());
@@ -298,6 +299,17 @@ bool StateMachine::conn_new_cmd() {
      * connection will only process a certain number of operations
      * before they will back off.
      */
+    if (connection.hasCoalescedResponses() &&
+        (connection.getNumEvents() <= 0 || !connection.isPacketAvailable())) {
+        // The next command isn't received yet (or we're about to back
+        // off), so send the queued responses before we stop processing
+        // commands. The client may be waiting for them (e.g. after a
+        // quiet get miss there is nothing more to send)
+        connection.setWriteAndGo(State::new_cmd);
+        setCurrentState(State::send_data);
+        return true;
+    }
+
     if (connection.decrementNumEvents() >= 0) {
         connection.getCookieObject().reset();
 
@@ -343,8 +355,6 @@ bool StateMachine::conn_new_cmd() {
 }
 
 bool StateMachine::conn_validate() {
-    static McbpValidator packetValidator;
-
     if (is_bucket_dying(connection)) {
         return true;
     }
@@ -358,14 +368,15 @@ bool StateMachine::conn_validate() {
         const auto& request = header.getRequest();
         if (cb::mcbp::is_client_magic(request.getMagic())) {
             auto opcode = request.getClientOpcode();
-            if (!cb::mcbp::is_valid_opcode(opcode)) {
+            const auto& descriptor = getMcbpOpcodeDescriptor(opcode);
+            if (!descriptor.valid) {
                 // We don't know about this command so we can stop
                 // processing it. We know that the header adds
                 cookie.sendResponse(cb::mcbp::Status::UnknownCommand);
                 return true;
             }
 
-            auto result = packetValidator.validate(opcode, cookie);
+            auto result = descriptor.validate(cookie);
             if (result != cb::mcbp::Status::Success) {
                 LOG_WARNING(
                         R"({}: Invalid format specified for "{}" - Status: "{}" - Closing connection. Packet:[{}] Reason:"{}")",
@@ -383,6 +394,20 @@ bool StateMachine::conn_validate() {
                 connection.setWriteAndGo(StateMachine::State::closing);
                 return true;
             }
+
+            if (descriptor.mutation &&
+                connection.getPriority() != Connection::Priority::High &&
+                !connection.getBucket().admissionControl.admitMutation(
+                        *connection.getBucketEngine(),
+                        settings.getAdmissionControlThreshold())) {
+                // Reject the mutation before doing any work for it, so
+                // that the bucket may catch up
+                cookie.setErrorContext(
+                        "Admission control: The bucket is close to its "
+                        "limits, retry later");
+                cookie.sendResponse(cb::mcbp::Status::Etmpfail);
+                return true;
+            }
         } else {
             // We should not be receiving a server command.
             // Audit and log
@@ -421,6 +446,10 @@ bool StateMachine::conn_execute() {
 
     mcbp_collect_timings(cookie);
 
+    // Check if the response may be coalesced with the following ones
+    // while we've still got the packet
+    connection.updateResponseCoalescing(cookie.getHeader());
+
     // Consume the packet we just executed from the input buffer
     connection.read->consume([&cookie](
                                      cb::const_byte_buffer buffer) -> ssize_t {
@@ -513,11 +542,19 @@ bool StateMachine::conn_read_packet_body() {
 bool StateMachine::conn_send_data() {
     bool ret = true;
 
+    if (connection.tryCoalesceResponse()) {
+        // The response is sent together with the response for the
+        // next pipelined command
+        setCurrentState(connection.getWriteAndGo());
+        return true;
+    }
+
     switch (connection.transmit()) {
     case Connection::TransmitResult::Complete:
         // Release all allocated resources
         connection.releaseTempAlloc();
         connection.releaseReservedItems();
+        connection.releaseCoalescedResponses();
 
         // We're done sending the response to the client. Enter the next
         // state in the state machine
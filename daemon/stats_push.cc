@@ -0,0 +1,208 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "stats_push.h"
+
+#include "buckets.h"
+#include "connection.h"
+#include "executorpool.h"
+#include "memcached.h"
+#include "protocol/mcbp/stats_context.h"
+#include "server_event.h"
+
+#include <logger/logger.h>
+#include <mcbp/protocol/framebuilder.h>
+#include <memcached/engine_error.h>
+#include <nlohmann/json.hpp>
+
+std::atomic<size_t> numStatsSubscriptions{0};
+
+/**
+ * Stats collected for another subscriber of the group this long ago are
+ * reused (pushes due in the same tick of the StatsPushTask share them)
+ */
+static const std::chrono::seconds maxStatsAge{1};
+
+std::shared_ptr<const StatsPushCache::Stats> StatsPushCache::get(
+        const std::string& group,
+        std::chrono::steady_clock::duration maxAge) const {
+    std::lock_guard<std::mutex> guard(mutex);
+    auto iter = entries.find(group);
+    if (iter == entries.end() ||
+        iter->second.collected + maxAge < std::chrono::steady_clock::now()) {
+        return {};
+    }
+    return iter->second.stats;
+}
+
+void StatsPushCache::put(const std::string& group,
+                         std::shared_ptr<const Stats> stats) {
+    std::lock_guard<std::mutex> guard(mutex);
+    entries[group] = {std::chrono::steady_clock::now(), std::move(stats)};
+}
+
+void StatsPushCache::reset() {
+    std::lock_guard<std::mutex> guard(mutex);
+    entries.clear();
+}
+
+/**
+ * Push the stats of the connection's subscription which changed since
+ * the previous push. If the stats can't be collected the client is sent
+ * {"error": "reason"} and the subscription is cancelled.
+ */
+class StatsPushServerEvent : public ServerEvent {
+public:
+    std::string getDescription() const override {
+        return "StatsPushServerEvent";
+    }
+
+    bool execute(Connection& connection) override {
+        auto* subscription = connection.getStatsSubscription();
+        if (subscription == nullptr) {
+            // The client unsubscribed after the push was queued
+            return true;
+        }
+        subscription->queued = false;
+        subscription->next =
+                std::chrono::steady_clock::now() + subscription->interval;
+
+        const auto group = subscription->group;
+        std::string error;
+        nlohmann::json doc;
+        if (connection.getBucketIndex() != subscription->bucketIndex) {
+            error = "The connection selected another bucket";
+        } else {
+            auto& bucket = connection.getBucket();
+            auto stats = bucket.statsPushCache.get(group, maxStatsAge);
+            if (!stats) {
+                // The engine may keep the callback, so it must own the
+                // stats it adds to
+                auto collected = std::make_shared<StatsPushCache::Stats>();
+                AddStatFn collect = [collected](const char* key,
+                                                const uint16_t klen,
+                                                const char* val,
+                                                const uint32_t vlen,
+                                                gsl::not_null<const void*>) {
+                    collected->emplace_back(std::string{key, klen},
+                                            std::string{val, vlen});
+                };
+                const auto ret = collect_stats_group(
+                        connection.getCookieObject(), group, collect);
+                if (ret == ENGINE_SUCCESS) {
+                    bucket.statsPushCache.put(group, collected);
+                    stats = collected;
+                } else {
+                    error = "Failed to collect the stats: " +
+                            cb::to_string(cb::engine_errc(ret));
+                }
+            }
+            if (stats) {
+                auto values = *stats;
+                doc = makeStatsDocument(subscription->snapshot, values, true);
+                if (doc["stats"].empty() && doc["removed"].empty()) {
+                    // Nothing changed; don't send an empty delta
+                    return true;
+                }
+            }
+        }
+
+        if (!error.empty()) {
+            LOG_INFO("{}: Cancel the subscription to stats group \"{}\": {}",
+                     connection.getId(),
+                     group,
+                     error);
+            connection.setStatsSubscription({});
+            doc = {{"error", error}};
+        }
+
+        const auto payload = doc.dump();
+        using namespace cb::mcbp;
+        const size_t needed = sizeof(Request) + group.size() + payload.size();
+        connection.write->ensureCapacity(needed);
+        FrameBuilder<Request> builder(connection.write->wdata());
+        builder.setMagic(Magic::ServerRequest);
+        builder.setDatatype(cb::mcbp::Datatype::JSON);
+        builder.setOpcode(ServerOpcode::StatsPush);
+        builder.setKey(
+                {reinterpret_cast<const uint8_t*>(group.data()), group.size()});
+        builder.setValue({reinterpret_cast<const uint8_t*>(payload.data()),
+                          payload.size()});
+
+        // Inject our packet into the stream!
+        connection.addMsgHdr(true);
+        connection.addIov(connection.write->wdata().data(), needed);
+        connection.write->produced(needed);
+
+        connection.setState(StateMachine::State::send_data);
+        connection.setWriteAndGo(StateMachine::State::new_cmd);
+        return true;
+    }
+};
+
+/**
+ * Queue a push on each connection whose subscription is due (the stats
+ * are collected by the connection's front end thread, as the engines
+ * require)
+ */
+class StatsPushTask : public PeriodicTask {
+public:
+    StatsPushTask() : PeriodicTask(std::chrono::seconds(1)) {
+    }
+
+    Status periodicExecute() override {
+        if (numStatsSubscriptions.load() == 0) {
+            return Status::Continue;
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        // Release our lock while we lock the front end threads, as they
+        // hold their lock when scheduling tasks (see
+        // StatsTaskConnectionStats::execute)
+        getMutex().unlock();
+        try {
+            iterate_all_connections([now](Connection& connection) {
+                auto* subscription = connection.getStatsSubscription();
+                if (subscription == nullptr || subscription->queued ||
+                    subscription->next > now) {
+                    return;
+                }
+                subscription->queued = true;
+                connection.enqueueServerEvent(
+                        std::make_unique<StatsPushServerEvent>());
+                connection.signalIfIdle();
+            });
+        } catch (const std::exception& e) {
+            LOG_WARNING("StatsPushTask::periodicExecute: received exception: {}",
+                        e.what());
+        }
+        getMutex().lock();
+        return Status::Continue;
+    }
+};
+
+static std::shared_ptr<StatsPushTask> statsPushTask;
+
+void initializeStatsPush() {
+    statsPushTask = std::make_shared<StatsPushTask>();
+    std::shared_ptr<Task> task = statsPushTask;
+    std::lock_guard<std::mutex> guard(task->getMutex());
+    executorPool->schedule(task);
+}
+
+void shutdownStatsPush() {
+    statsPushTask.reset();
+}
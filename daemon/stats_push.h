@@ -0,0 +1,100 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include "stats_tasks.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class Connection;
+
+/*
+ * Stats push: instead of polling a stats group, a (duplex) client may
+ * subscribe to it with "stats subscribe <interval> [group]". The server
+ * then collects the group every interval and pushes the stats which
+ * changed since the previous push to the client as a StatsPush server
+ * request (see docs/Duplex.md). Subscribers of the same group of a bucket
+ * share the stats collected.
+ */
+
+/**
+ * A connection's subscription to have a stats group pushed to it.
+ * Only accessed from the connection's front end thread (or with the
+ * front end thread's mutex held).
+ */
+struct StatsSubscription {
+    /// The stats group (passed to the engine)
+    std::string group;
+    std::chrono::seconds interval;
+    /// The bucket the subscription was made against
+    size_t bucketIndex = 0;
+    /// When the next push is due
+    std::chrono::steady_clock::time_point next;
+    /// A push is queued on the connection (and not sent yet)
+    bool queued = false;
+    /// The stats sent in the previous push
+    StatsSnapshot snapshot;
+};
+
+/**
+ * The stats groups recently collected for a push from a bucket, so that
+ * all of the subscribers of a group share one collection per interval.
+ */
+class StatsPushCache {
+public:
+    using Stats = std::vector<std::pair<std::string, std::string>>;
+
+    /**
+     * Get the stats collected for the group no more than maxAge ago
+     *
+     * @return the stats, or nullptr if they need to be collected
+     */
+    std::shared_ptr<const Stats> get(
+            const std::string& group,
+            std::chrono::steady_clock::duration maxAge) const;
+
+    /// Store the stats just collected for the group
+    void put(const std::string& group, std::shared_ptr<const Stats> stats);
+
+    void reset();
+
+private:
+    struct Entry {
+        std::chrono::steady_clock::time_point collected;
+        std::shared_ptr<const Stats> stats;
+    };
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+};
+
+/// The number of connections with a StatsSubscription
+extern std::atomic<size_t> numStatsSubscriptions;
+
+/**
+ * Start the periodic task which queues the pushes on the subscribed
+ * connections
+ */
+void initializeStatsPush();
+
+void shutdownStatsPush();
@@ -22,6 +22,9 @@
 #include <logger/logger.h>
 #include <nlohmann/json.hpp>
 
+#include <algorithm>
+#include <atomic>
+
 StatsTaskConnectionStats::StatsTaskConnectionStats(Connection& connection_,
                                                    Cookie& cookie_,
                                                    const AddStatFn& add_stats_,
@@ -65,6 +68,105 @@ Task::Status StatsTaskConnectionStats::execute() {
     return Task::Status::Finished;
 }
 
+/// The token handed out in the next "stats json" response
+static std::atomic<uint64_t> nextStatsToken{1};
+
+/**
+ * Stats values are text; send the ones which are plain unsigned numbers
+ * as JSON numbers to keep the document compact.
+ */
+static nlohmann::json toJsonValue(const std::string& value) {
+    if (!value.empty() && value.size() < 20 &&
+        value.find_first_not_of("0123456789") == std::string::npos &&
+        (value.size() == 1 || value.front() != '0')) {
+        return std::stoull(value);
+    }
+    return value;
+}
+
+StatsTaskJsonStats::StatsTaskJsonStats(
+        Connection& connection_,
+        Cookie& cookie_,
+        const AddStatFn& add_stats_,
+        std::vector<std::pair<std::string, std::string>> stats_,
+        uint64_t token_)
+    : StatsTask(connection_, cookie_, add_stats_),
+      stats(std::move(stats_)),
+      token(token_) {
+}
+
+nlohmann::json makeStatsDocument(
+        StatsSnapshot& snapshot,
+        std::vector<std::pair<std::string, std::string>>& stats,
+        bool delta) {
+    nlohmann::json values = nlohmann::json::object();
+    std::unordered_map<std::string, std::string> next;
+    next.reserve(stats.size());
+    for (auto& entry : stats) {
+        if (!delta) {
+            values[entry.first] = toJsonValue(entry.second);
+        } else {
+            auto iter = snapshot.values.find(entry.first);
+            if (iter == snapshot.values.end() ||
+                iter->second != entry.second) {
+                values[entry.first] = toJsonValue(entry.second);
+            }
+        }
+        next[std::move(entry.first)] = std::move(entry.second);
+    }
+    stats.clear();
+
+    nlohmann::json doc;
+    doc["token"] = nextStatsToken++;
+    doc["delta"] = delta;
+    doc["stats"] = std::move(values);
+    if (delta) {
+        nlohmann::json removed = nlohmann::json::array();
+        for (const auto& entry : snapshot.values) {
+            if (next.find(entry.first) == next.end()) {
+                removed.push_back(entry.first);
+            }
+        }
+        doc["removed"] = std::move(removed);
+    }
+
+    snapshot.token = doc["token"].get<uint64_t>();
+    snapshot.values = std::move(next);
+    return doc;
+}
+
+Task::Status StatsTaskJsonStats::execute() {
+    try {
+        // The connection is blocked waiting for this task, so we're the
+        // only one touching the snapshot
+        auto& snapshot = connection.getStatsSnapshot();
+        const bool delta = token != 0 && token == snapshot.token;
+        const auto doc = makeStatsDocument(snapshot, stats, delta);
+
+        const auto payload = doc.dump();
+        const std::string key = "json";
+        for (size_t offset = 0; offset < payload.size();
+             offset += ChunkSize) {
+            const auto len = std::min(ChunkSize, payload.size() - offset);
+            add_stats(key.data(),
+                      uint16_t(key.size()),
+                      payload.data() + offset,
+                      uint32_t(len),
+                      static_cast<void*>(&cookie));
+        }
+    } catch (const std::exception& exception) {
+        LOG_WARNING(
+                "{}: StatsTaskJsonStats::execute(): An exception "
+                "occurred: {}",
+                connection.getId(),
+                exception.what());
+        cookie.setErrorContext("An exception occurred");
+        command_error = ENGINE_FAILED;
+    }
+
+    return Task::Status::Finished;
+}
+
 StatsTask::StatsTask(Connection& connection_,
                      Cookie& cookie_,
                      const AddStatFn& add_stats_)
@@ -19,6 +19,12 @@
 #include "task.h"
 #include <memcached/engine_common.h>
 #include <memcached/engine_error.h>
+#include <nlohmann/json_fwd.hpp>
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 class Connection;
 
@@ -67,3 +73,68 @@ public:
 protected:
     int64_t fd;
 };
+
+/**
+ * The stats last sent to a client as a JSON document, used to only send
+ * the values which changed the next time.
+ */
+struct StatsSnapshot {
+    uint64_t token = 0;
+    std::unordered_map<std::string, std::string> values;
+};
+
+/**
+ * Build the JSON document (in the format described for StatsTaskJsonStats)
+ * for the stats, and replace the snapshot with them.
+ *
+ * @param snapshot the stats previously sent
+ * @param stats the stats collected (consumed)
+ * @param delta only include the stats which changed since the snapshot
+ */
+nlohmann::json makeStatsDocument(
+        StatsSnapshot& snapshot,
+        std::vector<std::pair<std::string, std::string>>& stats,
+        bool delta);
+
+/**
+ * Encode the stats collected for "stats json" into a single JSON document
+ * and send it (in chunks) as the value of one or more "json" stats.
+ *
+ * The document looks like:
+ *
+ *     {
+ *       "token": 1234,
+ *       "delta": false,
+ *       "stats": { "name": value, ... },
+ *       "removed": [ "name", ... ]
+ *     }
+ *
+ * Numeric values are encoded as JSON numbers and everything else as
+ * strings. If the client provided the token from the previous response
+ * on this connection ("delta" is true) only the stats which changed since
+ * then are present in "stats", and "removed" lists the stats which went
+ * away. Otherwise all of the stats are sent (and "removed" is omitted).
+ */
+class StatsTaskJsonStats : public StatsTask {
+public:
+    /// The maximum size of the value in each of the "json" stats
+    static constexpr size_t ChunkSize = 64 * 1024;
+
+    StatsTaskJsonStats() = delete;
+
+    StatsTaskJsonStats(const StatsTaskJsonStats&) = delete;
+
+    StatsTaskJsonStats(Connection& connection_,
+                       Cookie& cookie_,
+                       const AddStatFn& add_stats_,
+                       std::vector<std::pair<std::string, std::string>> stats_,
+                       uint64_t token_);
+
+    Status execute() override;
+
+protected:
+    /// The stats collected from the bucket / core
+    std::vector<std::pair<std::string, std::string>> stats;
+    /// The token provided by the client (0 if no delta is requested)
+    const uint64_t token;
+};
@@ -293,7 +293,8 @@ static SubdocCmdContext* subdoc_create_context(Cookie& cookie,
                                                doc_flag doc_flags) {
     try {
         std::unique_ptr<SubdocCmdContext> context;
-        context = std::make_unique<SubdocCmdContext>(cookie, traits);
+        context.reset(new (cookie.getArena())
+                              SubdocCmdContext(cookie, traits));
         switch (traits.path) {
         case SubdocPath::SINGLE:
             create_single_path_context(
@@ -662,6 +663,159 @@ static cb::mcbp::Status subdoc_operate_wholedoc(
     }
 }
 
+/**
+ * The locations of the paths looked up in the body of the document for a
+ * lookup command. Each path is only searched for once per request, and
+ * (if enabled) the locations are remembered in the front end thread's
+ * cache for the revision of the document so subsequent requests for the
+ * same paths don't have to parse the document.
+ */
+class SubdocLookupLocations {
+public:
+    SubdocLookupLocations(SubdocCmdContext& context,
+                          cb::const_char_buffer doc)
+        : context(context),
+          doc(doc),
+          enabled(!context.traits.is_mutator &&
+                  context.getCurrentPhase() == SubdocCmdContext::Phase::Body),
+          cacheSize(settings.getSubdocLookupCacheSize()) {
+        if (!enabled) {
+            return;
+        }
+        auto& cache = context.connection.getThread()->subdoc_lookup_cache;
+        if (cacheSize == 0) {
+            if (cache.size() != 0) {
+                cache.clear();
+            }
+            return;
+        }
+        const auto& request = context.cookie.getRequest();
+        const auto* cached = cache.lookup(context.connection.getBucketIndex(),
+                                          request.getVBucket(),
+                                          request.getKey(),
+                                          context.in_cas);
+        if (cached) {
+            results = *cached;
+        }
+    }
+
+    ~SubdocLookupLocations() {
+        if (!dirty || cacheSize == 0) {
+            return;
+        }
+        const auto& request = context.cookie.getRequest();
+        context.connection.getThread()->subdoc_lookup_cache.insert(
+                context.connection.getBucketIndex(),
+                request.getVBucket(),
+                request.getKey(),
+                context.in_cas,
+                std::move(results),
+                cacheSize);
+    }
+
+    /**
+     * Try to fill in the result of the operation from a previous lookup
+     * of the same path
+     *
+     * @return true if the result was found
+     */
+    bool find(SubdocCmdContext::OperationSpec& spec) {
+        if (!isCacheable(spec)) {
+            return false;
+        }
+        for (const auto& entry : results) {
+            if (entry.opcode == spec.traits.mcbpCommand &&
+                entry.path.compare(
+                        0, std::string::npos, spec.path.buf, spec.path.len) ==
+                        0) {
+                spec.status = entry.status;
+                if (entry.status == cb::mcbp::Status::Success) {
+                    spec.result.set_matchloc(
+                            {doc.buf + entry.offset, entry.length});
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// Remember the result of the operation just executed
+    void record(SubdocCmdContext::OperationSpec& spec) {
+        if (!isCacheable(spec) ||
+            results.size() >= SubdocLookupCache::MaxPathsPerDocument) {
+            return;
+        }
+
+        size_t offset = 0;
+        size_t length = 0;
+        if (spec.status == cb::mcbp::Status::Success) {
+            const auto loc = spec.result.matchloc();
+            // Only remember matches which point into the document
+            if (loc.at < doc.buf || loc.at + loc.length > doc.buf + doc.len) {
+                return;
+            }
+            offset = loc.at - doc.buf;
+            length = loc.length;
+        } else if (spec.status != cb::mcbp::Status::SubdocPathEnoent &&
+                   spec.status != cb::mcbp::Status::SubdocPathMismatch) {
+            return;
+        }
+
+        results.push_back({std::string{spec.path.buf, spec.path.len},
+                           spec.traits.mcbpCommand,
+                           spec.status,
+                           offset,
+                           length});
+        dirty = true;
+    }
+
+protected:
+    bool isCacheable(const SubdocCmdContext::OperationSpec& spec) const {
+        return enabled && (spec.traits.mcbpCommand ==
+                                   cb::mcbp::ClientOpcode::SubdocGet ||
+                           spec.traits.mcbpCommand ==
+                                   cb::mcbp::ClientOpcode::SubdocExists);
+    }
+
+    SubdocCmdContext& context;
+    const cb::const_char_buffer doc;
+    const bool enabled;
+    const size_t cacheSize;
+    SubdocLookupResults results;
+    bool dirty = false;
+};
+
+/**
+ * Copy the segments of the result of a mutation into a new temporary
+ * buffer and point doc at it, so that it can be used as the (contiguous)
+ * input of the next subjson call.
+ */
+static void make_contiguous(const std::vector<cb::const_char_buffer>& segments,
+                            std::unique_ptr<char[]>& temp_buffer,
+                            cb::const_char_buffer& doc) {
+    // Determine how much space we now need.
+    size_t new_doc_len = 0;
+    for (const auto& segment : segments) {
+        new_doc_len += segment.len;
+    }
+
+    // We can't simply write into the existing temporary buffer, as that
+    // may be the underlying storage for some of the segments.
+    std::unique_ptr<char[]> temp(new char[new_doc_len]);
+
+    size_t offset = 0;
+    for (const auto& segment : segments) {
+        std::copy(segment.buf, segment.buf + segment.len, temp.get() + offset);
+        offset += segment.len;
+    }
+
+    // Copying complete - safe to delete the old temp_doc (even if it was
+    // the source of some of the segments).
+    temp_buffer.swap(temp);
+    doc.buf = temp_buffer.get();
+    doc.len = new_doc_len;
+}
+
 /**
  * Run through all of the subdoc operations for the current phase on
  * a single 'document' (either the user document, or a XATTR).
@@ -673,27 +827,52 @@ static cb::mcbp::Status subdoc_operate_wholedoc(
  *                    allocations if we need to change the doc.
  * @param modified set to true upon return if any modifications happened
  *                 to the input document.
+ * @param segments if non-null the new document is returned here as the
+ *                 list of segments produced by the last operation (pointing
+ *                 into doc, the operation's value and result) rather than
+ *                 being copied into temp_buffer and doc.
  * @return true if we should continue processing this request,
  *         false if we've sent the error packet and should temrinate
  *               execution for this request
  *
  * @throws std::bad_alloc if allocation fails
  */
-static bool operate_single_doc(SubdocCmdContext& context,
-                                cb::const_char_buffer& doc,
-                                protocol_binary_datatype_t doc_datatype,
-                                std::unique_ptr<char[]>& temp_buffer,
-                                bool& modified) {
+static bool operate_single_doc(
+        SubdocCmdContext& context,
+        cb::const_char_buffer& doc,
+        protocol_binary_datatype_t doc_datatype,
+        std::unique_ptr<char[]>& temp_buffer,
+        bool& modified,
+        std::vector<cb::const_char_buffer>* segments = nullptr) {
     modified = false;
     auto& operations = context.getOperations();
 
+    // The results of the lookups on the body, shared by all of the specs
+    // in the request (and with later requests through the thread's cache)
+    SubdocLookupLocations locations(context, doc);
+
+    // The new document produced by the last successful mutation. It's only
+    // made contiguous when another operation needs it as input (or the
+    // caller wants it in doc), so the final result isn't copied here.
+    std::vector<cb::const_char_buffer> newdoc;
+    bool pending = false;
+
     // 2. Perform each of the operations on document.
     for (auto op = operations.begin(); op != operations.end(); op++) {
+        if (pending) {
+            make_contiguous(newdoc, temp_buffer, doc);
+            pending = false;
+        }
+
         switch (op->traits.scope) {
         case CommandScope::SubJSON:
             if (mcbp::datatype::is_json(doc_datatype)) {
-                // Got JSON, perform the operation.
-                op->status = subdoc_operate_one_path(context, *op, doc);
+                // Got JSON, perform the operation (unless we already know
+                // the result).
+                if (!locations.find(*op)) {
+                    op->status = subdoc_operate_one_path(context, *op, doc);
+                    locations.record(*op);
+                }
             } else {
                 // No good; need to have JSON.
                 op->status = cb::mcbp::Status::SubdocDocNotJson;
@@ -707,36 +886,11 @@ static bool operate_single_doc(SubdocCmdContext& context,
         if (op->status == cb::mcbp::Status::Success) {
             if (context.traits.is_mutator) {
                 modified = true;
-
-                // Determine how much space we now need.
-                size_t new_doc_len = 0;
+                newdoc.clear();
                 for (auto& loc : op->result.newdoc()) {
-                    new_doc_len += loc.length;
+                    newdoc.push_back({loc.at, loc.length});
                 }
-
-                // TODO-PERF: We need to create a contiguous input
-                // region for the next subjson call, from the set of
-                // iovecs in the result. We can't simply write into
-                // the dynamic_buffer, as that may be the underlying
-                // storage for iovecs from the result. Ideally we'd
-                // either permit subjson to take an iovec as input, or
-                // permit subjson to take all the multipaths at once.
-                // For now we make a contiguous region in a temporary
-                // char[], and point in_doc at that.
-                std::unique_ptr<char[]> temp(new char[new_doc_len]);
-
-                size_t offset = 0;
-                for (auto& loc : op->result.newdoc()) {
-                    std::copy(loc.at, loc.at + loc.length, temp.get() + offset);
-                    offset += loc.length;
-                }
-
-                // Copying complete - safe to delete the old temp_doc
-                // (even if it was the source of some of the newdoc
-                // iovecs).
-                temp_buffer.swap(temp);
-                doc.buf = temp_buffer.get();
-                doc.len = new_doc_len;
+                pending = true;
             } else { // lookup
                 // nothing to do.
             }
@@ -768,6 +922,14 @@ static bool operate_single_doc(SubdocCmdContext& context,
         }
     }
 
+    if (pending) {
+        if (segments) {
+            *segments = std::move(newdoc);
+        } else {
+            make_contiguous(newdoc, temp_buffer, doc);
+        }
+    }
+
     return true;
 }
 
@@ -1040,20 +1202,27 @@ static bool do_xattr_phase(SubdocCmdContext& context) {
     // As a temporary solution we did create a full JSON doc for the
     // xattr key, so we should strip off the key and just store the value.
 
-    // The backing store for the blob is currently witin the actual
-    // document.. create a copy we can use for replace.
-    cb::xattr::Blob copy(xattr_blob);
-
     if (document.len > key.len) {
         const char* start = strchr(document.buf, ':') + 1;
         const char* end = document.buf + document.len - 1;
-
-        copy.set(key, {start, size_t(end - start)});
+        const cb::const_char_buffer value{start, size_t(end - start)};
+
+        // The backing store for the blob is currently witin the actual
+        // document.. create a copy we can use for replace, with room for
+        // the new kv-pair (and the length field of the blob, in case it's
+        // empty) so that setting it doesn't reallocate the copy.
+        cb::xattr::Blob copy(
+                xattr_blob,
+                xattr_blob.size() + 4 + 4 + key.len + 1 + value.len + 1);
+        copy.set(key, value);
+        const auto new_xattr = copy.finalize();
+        replace_xattrs(new_xattr, context, bodyoffset, bodysize);
     } else {
+        cb::xattr::Blob copy(xattr_blob);
         copy.remove(key);
+        const auto new_xattr = copy.finalize();
+        replace_xattrs(new_xattr, context, bodyoffset, bodysize);
     }
-    const auto new_xattr = copy.finalize();
-    replace_xattrs(new_xattr, context, bodyoffset, bodysize);
 
     return true;
 }
@@ -1083,10 +1252,15 @@ static bool do_body_phase(SubdocCmdContext& context) {
     }
 
     std::unique_ptr<char[]> temp_doc;
+    std::vector<cb::const_char_buffer> segments;
     bool modified;
 
-    if (!operate_single_doc(
-                context, document, context.in_datatype, temp_doc, modified)) {
+    if (!operate_single_doc(context,
+                            document,
+                            context.in_datatype,
+                            temp_doc,
+                            modified,
+                            &segments)) {
         return false;
     }
 
@@ -1095,24 +1269,18 @@ static bool do_body_phase(SubdocCmdContext& context) {
         return true;
     }
 
-    // There isn't any xattrs associated with the document. We shouldn't
-    // reallocate and move things around but just reuse the temporary
-    // buffer we've already created.
-    if (xattrsize == 0) {
-        context.temp_doc.swap(temp_doc);
-        context.in_doc = { context.temp_doc.get(), document.len };
-        return true;
+    // Rather than building the full document (the unchanged xattrs followed
+    // by the new body) in a temporary buffer, just to copy it again into
+    // the new item, keep it as a list of segments which subdoc_update()
+    // writes straight into the item. The segments may point into the
+    // temporary buffer of a multi-path mutation, so keep that around too.
+    context.body_temp_doc.swap(temp_doc);
+    context.out_segments.clear();
+    if (xattrsize != 0) {
+        context.out_segments.push_back({context.in_doc.buf, xattrsize});
     }
-
-    // Time to rebuild the full document.
-    auto total = xattrsize + document.len;
-    std::unique_ptr<char[]> full_document(new char[total]);;
-
-    memcpy(full_document.get(), context.in_doc.buf, xattrsize);
-    memcpy(full_document.get() + xattrsize, document.buf, document.len);
-
-    context.temp_doc.swap(full_document);
-    context.in_doc = { context.temp_doc.get(), total };
+    context.out_segments.insert(
+            context.out_segments.end(), segments.begin(), segments.end());
 
     return true;
 }
@@ -1184,7 +1352,7 @@ static ENGINE_ERROR_CODE subdoc_update(SubdocCmdContext& context,
         !(context.no_sys_xattrs && context.do_delete_doc)) {
 
         if (ret == ENGINE_SUCCESS) {
-            context.out_doc_len = context.in_doc.len;
+            context.out_doc_len = context.getNewDocumentSize();
             auto allocate_key = cookie.getConnection().makeDocKey(key);
             const size_t priv_bytes =
                 cb::xattr::get_system_xattr_size(context.in_datatype,
@@ -1245,7 +1413,14 @@ static ENGINE_ERROR_CODE subdoc_update(SubdocCmdContext& context,
 
         // Copy the new document into the item.
         char* write_ptr = static_cast<char*>(new_doc_info.value[0].iov_base);
-        std::memcpy(write_ptr, context.in_doc.buf, context.in_doc.len);
+        if (context.out_segments.empty()) {
+            std::memcpy(write_ptr, context.in_doc.buf, context.in_doc.len);
+        } else {
+            for (const auto& segment : context.out_segments) {
+                std::copy(segment.buf, segment.buf + segment.len, write_ptr);
+                write_ptr += segment.len;
+            }
+        }
     }
 
     // And finally, store the new document.
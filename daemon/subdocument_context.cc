@@ -71,6 +71,17 @@ uint64_t SubdocCmdContext::getOperationValueBytesTotal() const {
     return result;
 }
 
+size_t SubdocCmdContext::getNewDocumentSize() const {
+    if (out_segments.empty()) {
+        return in_doc.len;
+    }
+    size_t result = 0;
+    for (const auto& segment : out_segments) {
+        result += segment.len;
+    }
+    return result;
+}
+
 template <typename T>
 std::string SubdocCmdContext::macroToString(T macroValue) {
     std::stringstream ss;
@@ -342,13 +353,25 @@ cb::mcbp::Status SubdocCmdContext::get_document_for_searching(
     in_datatype = info.datatype;
     in_document_state = info.document_state;
 
+    // A lookup which only reads an (ordinary) xattr doesn't need the body,
+    // so there is no need to inflate more than the xattrs
+    const bool xattrsOnly = !traits.is_mutator &&
+                            mcbp::datatype::is_xattr(info.datatype) &&
+                            getOperations(Phase::Body).empty() &&
+                            !xattr_key.empty() &&
+                            !cb::xattr::is_vattr(xattr_key);
+
     if (mcbp::datatype::is_snappy(info.datatype)) {
         // Need to expand before attempting to extract from it.
         try {
             using namespace cb::compression;
-            if (!inflate(Algorithm::Snappy,
-                         in_doc,
-                         inflated_doc_buffer)) {
+            const bool inflated =
+                    xattrsOnly ? cb::xattr::inflate_xattrs(in_doc,
+                                                           inflated_doc_buffer)
+                               : inflate(Algorithm::Snappy,
+                                         in_doc,
+                                         inflated_doc_buffer);
+            if (!inflated) {
                 char clean_key[KEY_MAX_LENGTH + 32];
                 if (buf_to_printable_buffer(
                             clean_key,
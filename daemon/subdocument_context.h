@@ -31,6 +31,7 @@
 #include <iomanip>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 enum class MutationSemantics : uint8_t { Add, Replace, Set };
 
@@ -136,6 +137,10 @@ public:
     // Returns the total size of all Operation values (bytes).
     uint64_t getOperationValueBytesTotal() const;
 
+    // Returns the size of the new document (held in either {out_segments}
+    // or {in_doc}).
+    size_t getNewDocumentSize() const;
+
     // Cookie this command is associated with.
     Cookie& cookie;
 
@@ -152,6 +157,8 @@ public:
     // Either way, it should /not/ be cb_free()d.
     // Note this is *always* in a decompressed form (and hence can safely be
     // read / manipulated directly) - see get_document_for_searching().
+    // For a lookup which only reads an xattr only the xattrs are inflated
+    // (leaving the body empty).
     // TODO: Remove (b), and just use intermediate result.
     cb::const_char_buffer in_doc{};
 
@@ -164,6 +171,18 @@ public:
     // as input for the next multi-path mutation.
     std::unique_ptr<char[]> temp_doc;
 
+    // [Mutations only] The new document as a list of segments if the body
+    // was modified: the xattrs of {in_doc} followed by the result of the
+    // last body operation (pointing into {in_doc}, the values and results
+    // of the operations and {body_temp_doc}). These are copied straight
+    // into the new item, so the document is only copied once. Empty if
+    // {in_doc} holds the new document.
+    std::vector<cb::const_char_buffer> out_segments;
+
+    // Temporary buffer holding the input of the last body operation of a
+    // multi-path mutation (which {out_segments} may point into).
+    std::unique_ptr<char[]> body_temp_doc;
+
     // Temporary buffer used to hold the xattrs in use, as a get request
     // may hold pointers into the repacked xattr buckets
     std::unique_ptr<char[]> xattr_buffer;
@@ -0,0 +1,87 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "subdocument_lookup_cache.h"
+
+std::string SubdocLookupCache::makeKey(int bucket,
+                                       Vbid vbucket,
+                                       cb::const_byte_buffer key) {
+    std::string ret;
+    ret.reserve(sizeof(bucket) + sizeof(uint16_t) + key.size());
+    ret.append(reinterpret_cast<const char*>(&bucket), sizeof(bucket));
+    const auto vb = vbucket.get();
+    ret.append(reinterpret_cast<const char*>(&vb), sizeof(vb));
+    ret.append(reinterpret_cast<const char*>(key.data()), key.size());
+    return ret;
+}
+
+const SubdocLookupResults* SubdocLookupCache::lookup(int bucket,
+                                                     Vbid vbucket,
+                                                     cb::const_byte_buffer key,
+                                                     uint64_t cas) {
+    auto iter = index.find(makeKey(bucket, vbucket, key));
+    if (iter == index.end()) {
+        return nullptr;
+    }
+
+    auto node = iter->second;
+    if (node->cas != cas) {
+        // The document changed; the results are stale
+        lru.erase(node);
+        index.erase(iter);
+        return nullptr;
+    }
+
+    lru.splice(lru.begin(), lru, node);
+    return &node->results;
+}
+
+void SubdocLookupCache::insert(int bucket,
+                               Vbid vbucket,
+                               cb::const_byte_buffer key,
+                               uint64_t cas,
+                               SubdocLookupResults results,
+                               size_t capacity) {
+    if (capacity == 0) {
+        clear();
+        return;
+    }
+
+    if (results.size() > MaxPathsPerDocument) {
+        results.resize(MaxPathsPerDocument);
+    }
+
+    auto k = makeKey(bucket, vbucket, key);
+    auto iter = index.find(k);
+    if (iter != index.end()) {
+        iter->second->cas = cas;
+        iter->second->results = std::move(results);
+        lru.splice(lru.begin(), lru, iter->second);
+    } else {
+        lru.push_front(Node{k, cas, std::move(results)});
+        index.emplace(std::move(k), lru.begin());
+    }
+
+    while (index.size() > capacity) {
+        index.erase(lru.back().key);
+        lru.pop_back();
+    }
+}
+
+void SubdocLookupCache::clear() {
+    index.clear();
+    lru.clear();
+}
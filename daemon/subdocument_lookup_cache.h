@@ -0,0 +1,101 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <mcbp/protocol/opcode.h>
+#include <mcbp/protocol/status.h>
+#include <memcached/vbucket.h>
+#include <platform/sized_buffer.h>
+
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * The result of running a sub-document lookup on a path in a document,
+ * recorded as an offset into the document so it may be reused for any
+ * copy of the same revision of the document.
+ */
+struct SubdocLookupResult {
+    std::string path;
+    cb::mcbp::ClientOpcode opcode;
+    cb::mcbp::Status status;
+    /// Offset of the match from the start of the document
+    size_t offset;
+    /// Length of the match
+    size_t length;
+};
+
+using SubdocLookupResults = std::vector<SubdocLookupResult>;
+
+/**
+ * A small LRU cache of the lookup results for recently used documents,
+ * keyed by (bucket, vbucket, key) and validated with the CAS of the
+ * document (a document with a different CAS is a different revision and
+ * the cached results are discarded).
+ *
+ * Each front end thread owns an instance so no locking is needed.
+ */
+class SubdocLookupCache {
+public:
+    /// The maximum number of paths we'll remember for a single document
+    static constexpr size_t MaxPathsPerDocument = 16;
+
+    /**
+     * Get the cached results for the given document revision
+     *
+     * @return the results or nullptr if nothing is cached
+     */
+    const SubdocLookupResults* lookup(int bucket,
+                                      Vbid vbucket,
+                                      cb::const_byte_buffer key,
+                                      uint64_t cas);
+
+    /**
+     * Store the results for the given document revision, evicting the
+     * least recently used document if the cache holds more than capacity
+     * documents.
+     */
+    void insert(int bucket,
+                Vbid vbucket,
+                cb::const_byte_buffer key,
+                uint64_t cas,
+                SubdocLookupResults results,
+                size_t capacity);
+
+    size_t size() const {
+        return index.size();
+    }
+
+    void clear();
+
+protected:
+    static std::string makeKey(int bucket,
+                               Vbid vbucket,
+                               cb::const_byte_buffer key);
+
+    struct Node {
+        std::string key;
+        uint64_t cas;
+        SubdocLookupResults results;
+    };
+
+    /// The documents, most recently used first
+    std::list<Node> lru;
+    std::unordered_map<std::string, std::list<Node>::iterator> index;
+};
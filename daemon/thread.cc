@@ -10,10 +10,14 @@
 #include "log_macros.h"
 #include "memcached.h"
 #include "opentracing.h"
+#include "request_log.h"
+#include "server_socket.h"
 #include "settings.h"
 #include "stats.h"
+#include "thread_load.h"
 #include "tracing.h"
 #include <utilities/hdrhistogram.h>
+#include <utilities/thread_affinity.h>
 
 #include <memcached/openssl.h>
 #include <nlohmann/json.hpp>
@@ -23,14 +27,17 @@
 #include <platform/strerror.h>
 
 #include <fcntl.h>
+#include <algorithm>
 #include <atomic>
 #include <cerrno>
+#include <chrono>
 #include <condition_variable>
 #include <csignal>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <limits>
 #ifndef WIN32
 #include <netinet/tcp.h> // For TCP_NODELAY etc
 #endif
@@ -93,6 +100,7 @@ void FrontEndThread::NotificationList::swap(std::vector<Connection*>& other) {
  */
 static std::vector<FrontEndThread> threads;
 std::vector<Hdr1sfMicroSecHistogram> scheduler_info;
+std::vector<std::unique_ptr<cb::RequestLog>> request_logs;
 
 /*
  * Number of worker threads that have finished setting themselves up.
@@ -103,6 +111,23 @@ static std::condition_variable init_cond;
 
 static void thread_libevent_process(evutil_socket_t, short, void*);
 
+/**
+ * Get the number of worker threads new connections are dispatched to
+ * (the active_threads setting): the first N of the threads. The other
+ * threads keep serving the connections they already have.
+ */
+static size_t get_active_thread_count() {
+    const auto active = settings.getNumActiveWorkerThreads();
+    if (active == 0 || active > threads.size()) {
+        return threads.size();
+    }
+    return active;
+}
+
+static bool is_active_thread(const FrontEndThread& thread) {
+    return thread.index < get_active_thread_count();
+}
+
 /*
  * Creates a worker thread.
  */
@@ -178,11 +203,29 @@ static void setup_dispatcher(struct event_base *main_base,
     dispatcher_thread.running = true;
 }
 
+/**
+ * Create the event base used by a front end thread
+ */
+static struct event_base* create_event_base() {
+    std::unique_ptr<event_config, decltype(&event_config_free)> config(
+            event_config_new(), event_config_free);
+    if (!config) {
+        return nullptr;
+    }
+
+    if (settings.isEventLoopChangelistEnabled()) {
+        event_config_set_flag(config.get(),
+                              EVENT_BASE_FLAG_EPOLL_USE_CHANGELIST);
+    }
+
+    return event_base_new_with_config(config.get());
+}
+
 /*
  * Set up a thread's information.
  */
 static void setup_thread(FrontEndThread& me) {
-    me.base = event_base_new();
+    me.base = create_event_base();
 
     if (!me.base) {
         FATAL_ERROR(EXIT_FAILURE, "Can't allocate event base");
@@ -198,6 +241,16 @@ static void setup_thread(FrontEndThread& me) {
         (event_add(&me.notify_event, nullptr) == -1)) {
         FATAL_ERROR(EXIT_FAILURE, "Can't monitor libevent notify pipe");
     }
+
+    // Activated (never added) when connections are queued in the scheduler
+    if (event_assign(&me.scheduler_event,
+                     me.base,
+                     -1,
+                     0,
+                     scheduler_event_handler,
+                     &me) == -1) {
+        FATAL_ERROR(EXIT_FAILURE, "Can't set up the connection scheduler");
+    }
 }
 
 /*
@@ -206,6 +259,27 @@ static void setup_thread(FrontEndThread& me) {
 static void worker_libevent(void *arg) {
     auto& me = *reinterpret_cast<FrontEndThread*>(arg);
 
+    const auto& affinity = settings.getFrontEndThreadAffinity();
+    if (!affinity.empty()) {
+        try {
+            const cb::ThreadAffinity pinning(affinity);
+            const auto error = pinning.applyToCurrentThread();
+            if (error.empty()) {
+                LOG_DEBUG("Front end thread {} pinned to {}",
+                          me.index,
+                          pinning.to_string());
+            } else {
+                LOG_WARNING("Failed to pin front end thread {}: {}",
+                            me.index,
+                            error);
+            }
+        } catch (const std::exception& e) {
+            LOG_WARNING("Invalid front end thread affinity \"{}\": {}",
+                        affinity,
+                        e.what());
+        }
+    }
+
     // Any per-thread setup can happen here; thread_init() will block until
     // all threads have finished initializing.
     {
@@ -215,7 +289,11 @@ static void worker_libevent(void *arg) {
         init_cond.notify_all();
     }
 
+    if (is_active_thread(me)) {
+        update_thread_listeners(me);
+    }
     event_base_loop(me.base, 0);
+    me.listeners.clear();
     me.running = false;
 }
 
@@ -243,19 +321,24 @@ void drain_notification_channel(evutil_socket_t fd) {
     }
 }
 
+void dispatch_conn_local(FrontEndThread& thread,
+                         SOCKET sfd,
+                         const SharedListeningPort& interface) {
+    if (conn_new(sfd, *interface, thread.base, &thread) == nullptr) {
+        LOG_WARNING("Failed to dispatch event for socket {}", long(sfd));
+        if (interface->system) {
+            --stats.system_conns;
+        }
+        safe_close(sfd);
+    }
+}
+
 static void dispatch_new_connections(FrontEndThread& me) {
     std::vector<std::pair<SOCKET, SharedListeningPort>> connections;
     me.new_conn_queue.swap(connections);
 
     for (const auto& entry : connections) {
-        if (conn_new(entry.first, *entry.second, me.base, &me) == nullptr) {
-            LOG_WARNING("Failed to dispatch event for socket {}",
-                        long(entry.first));
-            if (entry.second->system) {
-                --stats.system_conns;
-            }
-            safe_close(entry.first);
-        }
+        dispatch_conn_local(me, entry.first, entry.second);
     }
 }
 
@@ -282,11 +365,21 @@ static void thread_libevent_process(evutil_socket_t fd, short, void* arg) {
             return;
         }
 
+        // Stop accepting new clients on the sockets owned by this thread
+        me.listeners.clear();
+
         if (signal_idle_clients(me) == 0) {
             LOG_INFO("Stopping worker thread {}", me.index);
             event_base_loopbreak(me.base);
             return;
         }
+    } else if (is_active_thread(me)) {
+        update_thread_listeners(me);
+    } else if (!me.listeners.empty()) {
+        // No longer active; stop accepting clients on our own sockets (and
+        // recreate them if we're made active again)
+        me.listeners.clear();
+        me.listeners_generation = 0;
     }
 
     dispatch_new_connections(me);
@@ -391,12 +484,38 @@ void notify_io_complete(gsl::not_null<const void*> void_cookie,
 /* Which thread we assigned a connection to most recently. */
 static size_t last_thread = 0;
 
+/// Picks the thread for new connections with the least_loaded policy
+static std::unique_ptr<LeastLoadedSelector> least_loaded_selector;
+
+static size_t select_least_loaded_thread() {
+    return least_loaded_selector->select(
+            get_active_thread_count(),
+            last_thread + 1,
+            [](size_t tid) {
+                const auto& load = threads[tid].load;
+                ThreadLoad ret;
+                ret.connections =
+                        load.connections.load(std::memory_order_relaxed);
+                ret.cpu_time = load.cpu_time.load(std::memory_order_relaxed);
+                ret.send_queue_size =
+                        load.send_queue_size.load(std::memory_order_relaxed);
+                return ret;
+            },
+            std::chrono::steady_clock::now());
+}
+
 /*
  * Dispatches a new connection to another thread. This is only ever called
  * from the main thread, or because of an incoming connection.
  */
 void dispatch_conn_new(SOCKET sfd, SharedListeningPort& interface) {
-    size_t tid = (last_thread + 1) % settings.getNumWorkerThreads();
+    size_t tid;
+    if (settings.getConnectionDispatchPolicy() ==
+        ConnectionDispatchPolicy::LeastLoaded) {
+        tid = select_least_loaded_thread();
+    } else {
+        tid = (last_thread + 1) % get_active_thread_count();
+    }
     auto& thread = threads[tid];
     last_thread = tid;
 
@@ -447,6 +566,11 @@ void thread_init(size_t nthr,
                  struct event_base* main_base,
                  void (*dispatcher_callback)(evutil_socket_t, short, void*)) {
     scheduler_info.resize(nthr);
+    least_loaded_selector = std::make_unique<LeastLoadedSelector>(nthr);
+    request_logs.resize(nthr);
+    for (auto& log : request_logs) {
+        log = std::make_unique<cb::RequestLog>();
+    }
 
     try {
         threads = std::vector<FrontEndThread>(nthr);
@@ -499,6 +623,7 @@ void threads_shutdown() {
 
 void threads_cleanup() {
     for (auto& thread : threads) {
+        thread.listeners.clear();
         event_base_free(thread.base);
     }
 }
@@ -511,6 +636,12 @@ FrontEndThread::~FrontEndThread() {
     }
 }
 
+void notify_worker_threads() {
+    for (auto& thread : threads) {
+        notify_thread(thread);
+    }
+}
+
 void notify_thread(FrontEndThread& thread) {
     if (cb::net::send(thread.notify[1], "", 1, 0) != 1 &&
         !cb::net::is_blocking(cb::net::get_socket_error())) {
@@ -525,13 +656,19 @@ int add_conn_to_pending_io_list(Connection* c,
     auto* thread = c->getThread();
 
     std::lock_guard<std::mutex> lock(thread->pending_io.mutex);
+    // The thread swaps out (and serves) the whole map after draining its
+    // notification pipe, so only the first entry added since then needs to
+    // notify it; the others are served by the same wakeup. This turns the
+    // notifications of a batch of cookies (a bgfetch or durability batch
+    // completing) into a single pipe write per thread.
+    const bool wasEmpty = thread->pending_io.map.empty();
     auto iter = thread->pending_io.map.find(c);
     if (iter == thread->pending_io.map.end()) {
         thread->pending_io.map.emplace(
                 c,
                 std::vector<std::pair<Cookie*, ENGINE_ERROR_CODE>>{
                         {cookie, status}});
-        return 1;
+        return wasEmpty;
     }
 
     for (const auto& pair : iter->second) {
@@ -542,5 +679,5 @@ int add_conn_to_pending_io_list(Connection* c,
         }
     }
     iter->second.emplace_back(cookie, status);
-    return 1;
+    return wasEmpty;
 }
@@ -0,0 +1,67 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "thread_load.h"
+
+#include <algorithm>
+#include <limits>
+
+const std::chrono::milliseconds LeastLoadedSelector::SampleInterval{100};
+const double LeastLoadedSelector::CpuUtilizationWeight = 3.0;
+const double LeastLoadedSelector::SendQueueBytesPerConnection = 64.0 * 1024;
+
+double LeastLoadedSelector::calculateLoad(
+        size_t tid,
+        const ThreadLoad& load,
+        std::chrono::steady_clock::time_point now) {
+    using namespace std::chrono;
+    auto& sample = samples.at(tid);
+    const auto elapsed = now - sample.timestamp;
+    if (elapsed >= SampleInterval) {
+        const auto ns = duration_cast<nanoseconds>(elapsed).count();
+        const auto busy = std::min(
+                1.0, double(load.cpu_time - sample.cpu_time) / double(ns));
+        // Smooth out the value so that a short burst of activity don't
+        // move all of the new connections away from the thread.
+        sample.utilization = (sample.utilization + busy) / 2;
+        sample.cpu_time = load.cpu_time;
+        sample.timestamp = now;
+    }
+
+    return double(load.connections + 1) *
+                   (1.0 + sample.utilization * CpuUtilizationWeight) +
+           double(load.send_queue_size) / SendQueueBytesPerConnection;
+}
+
+size_t LeastLoadedSelector::select(
+        size_t nthreads,
+        size_t first,
+        const std::function<ThreadLoad(size_t)>& getLoad,
+        std::chrono::steady_clock::time_point now) {
+    size_t ret = first % nthreads;
+    double lowest = std::numeric_limits<double>::max();
+
+    for (size_t ii = 0; ii < nthreads; ++ii) {
+        const auto tid = (first + ii) % nthreads;
+        const auto load = calculateLoad(tid, getLoad(tid), now);
+        if (load < lowest) {
+            lowest = load;
+            ret = tid;
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,102 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/// The load counters of a front end thread at a given time
+struct ThreadLoad {
+    /// The number of connections currently bound to the thread
+    size_t connections = 0;
+    /// The total number of nanoseconds spent serving connections
+    uint64_t cpu_time = 0;
+    /// The number of bytes queued for transmission by its connections
+    size_t send_queue_size = 0;
+};
+
+/**
+ * The LeastLoadedSelector is used by the dispatcher (with the least_loaded
+ * connection dispatch policy) to pick the front end thread to serve a new
+ * connection.
+ *
+ * It keeps track of the CPU usage for each of the worker threads the last
+ * time it looked at them so that it may calculate the recent CPU
+ * utilization for the thread (and not the average since the thread was
+ * started). It is only used from the dispatcher thread.
+ */
+class LeastLoadedSelector {
+public:
+    /// The minimum interval between each time we recalculate the utilization
+    static const std::chrono::milliseconds SampleInterval;
+
+    /**
+     * The weight of the CPU utilization when calculating the load for a
+     * thread. A thread being busy all of the time looks as loaded as an
+     * idle thread with (1 + CpuUtilizationWeight) times as many connections.
+     */
+    static const double CpuUtilizationWeight;
+
+    /// Each chunk of this many bytes queued for transmission counts as one
+    /// connection when calculating the load for a thread
+    static const double SendQueueBytesPerConnection;
+
+    explicit LeastLoadedSelector(size_t nthreads) : samples(nthreads) {
+    }
+
+    /**
+     * Calculate the load for the provided thread (and update its CPU
+     * utilization sample if the sample is too old)
+     *
+     * @param tid the thread to calculate the load for
+     * @param load the threads current load counters
+     * @param now the current time
+     */
+    double calculateLoad(size_t tid,
+                         const ThreadLoad& load,
+                         std::chrono::steady_clock::time_point now);
+
+    /**
+     * Select the thread with the lowest load. We start searching at
+     * `first` so that threads with the same load get the connections in a
+     * round robin order (the caller passes the thread following the one it
+     * picked last time).
+     *
+     * @param nthreads the number of threads to select from
+     * @param first the thread to start searching at
+     * @param getLoad callback returning the load counters of a thread
+     * @param now the current time
+     */
+    size_t select(size_t nthreads,
+                  size_t first,
+                  const std::function<ThreadLoad(size_t)>& getLoad,
+                  std::chrono::steady_clock::time_point now);
+
+protected:
+    struct Sample {
+        /// The threads total cpu time when we sampled it
+        uint64_t cpu_time = 0;
+        /// When we sampled the thread
+        std::chrono::steady_clock::time_point timestamp;
+        /// The (smoothed) fraction of the time the thread was busy
+        double utilization = 0.0;
+    };
+    std::vector<Sample> samples;
+};
@@ -17,14 +17,35 @@
 #include "timings.h"
 #include <memcached/protocol_binary.h>
 
+#include <algorithm>
+
 Timings::Timings() {
+    setNumThreads(1);
     reset();
 }
 
+void Timings::setNumThreads(size_t num) {
+    std::lock_guard<std::mutex> guard(histogram_mutex);
+    shards.resize(std::max(size_t(1), num));
+    for (auto& shard : shards) {
+        if (!shard) {
+            shard = std::make_unique<Shard>();
+        }
+    }
+}
+
 void Timings::reset() {
-    for (auto& t : timings) {
-        if (t) {
-            t->reset();
+    for (auto& shard : shards) {
+        for (auto& t : shard->timings) {
+            if (t) {
+                t->reset();
+            }
+        }
+        for (auto& cost : shard->costs) {
+            cost.count = 0;
+            cost.execution_ns = 0;
+            cost.blocked_ns = 0;
+            cost.allocated = 0;
         }
     }
 
@@ -35,22 +56,50 @@ void Timings::reset() {
     }
 }
 
+void Timings::collectCost(cb::mcbp::ClientOpcode opcode,
+                          std::chrono::nanoseconds execution,
+                          std::chrono::nanoseconds blocked,
+                          uint64_t allocated,
+                          size_t thread) {
+    auto& cost = getShard(thread).costs
+            [std::underlying_type<cb::mcbp::ClientOpcode>::type(opcode)];
+    cost.count++;
+    cost.execution_ns += execution.count();
+    cost.blocked_ns += blocked.count();
+    cost.allocated += allocated;
+}
+
+OpcodeCost Timings::getCost(cb::mcbp::ClientOpcode opcode) const {
+    const auto idx = std::underlying_type<cb::mcbp::ClientOpcode>::type(opcode);
+    OpcodeCost ret;
+    std::lock_guard<std::mutex> guard(histogram_mutex);
+    for (const auto& shard : shards) {
+        const auto& cost = shard->costs[idx];
+        ret.count += cost.count.load();
+        ret.execution += std::chrono::nanoseconds(cost.execution_ns.load());
+        ret.blocked += std::chrono::nanoseconds(cost.blocked_ns.load());
+        ret.allocated += cost.allocated.load();
+    }
+    return ret;
+}
+
 void Timings::collect(cb::mcbp::ClientOpcode opcode,
-                      std::chrono::nanoseconds nsec) {
+                      std::chrono::nanoseconds nsec,
+                      size_t thread) {
     using namespace std::chrono;
+    auto& shard = getShard(thread);
     get_or_create_timing_histogram(
-            std::underlying_type<cb::mcbp::ClientOpcode>::type(opcode))
+            shard, std::underlying_type<cb::mcbp::ClientOpcode>::type(opcode))
             .add(duration_cast<microseconds>(nsec));
-    auto& interval = interval_counters
+    auto& interval = shard.interval_counters
             [std::underlying_type<cb::mcbp::ClientOpcode>::type(opcode)];
     interval.count++;
     interval.duration_ns += nsec.count();
 }
 
 std::string Timings::generate(cb::mcbp::ClientOpcode opcode) {
-    auto* histoPtr =
-            timings[std::underlying_type<cb::mcbp::ClientOpcode>::type(opcode)]
-                    .get();
+    auto histoPtr = get_timing_histogram(
+            std::underlying_type<cb::mcbp::ClientOpcode>::type(opcode));
     if (histoPtr) {
         return histoPtr->to_string();
     }
@@ -103,16 +152,23 @@ static const cb::mcbp::ClientOpcode timings_retrievals[] = {
         cb::mcbp::ClientOpcode::SubdocGet,
         cb::mcbp::ClientOpcode::SubdocExists};
 
+uint64_t Timings::get_value_count(cb::mcbp::ClientOpcode opcode) const {
+    const auto idx = std::underlying_type<cb::mcbp::ClientOpcode>::type(opcode);
+    uint64_t ret = 0;
+    std::lock_guard<std::mutex> guard(histogram_mutex);
+    for (const auto& shard : shards) {
+        if (shard->timings[idx]) {
+            ret += shard->timings[idx]->getValueCount();
+        }
+    }
+    return ret;
+}
+
 uint64_t Timings::get_aggregated_mutation_stats() {
 
     uint64_t ret = 0;
     for (auto cmd : timings_mutations) {
-        auto* histoPtr =
-                timings[std::underlying_type<cb::mcbp::ClientOpcode>::type(cmd)]
-                        .get();
-        if (histoPtr) {
-            ret += histoPtr->getValueCount();
-        }
+        ret += get_value_count(cmd);
     }
     return ret;
 }
@@ -121,12 +177,7 @@ uint64_t Timings::get_aggregated_retrival_stats() {
 
     uint64_t ret = 0;
     for (auto cmd : timings_retrievals) {
-        auto* histoPtr =
-                timings[std::underlying_type<cb::mcbp::ClientOpcode>::type(cmd)]
-                        .get();
-        if (histoPtr) {
-            ret += histoPtr->getValueCount();
-        }
+        ret += get_value_count(cmd);
     }
     return ret;
 }
@@ -142,37 +193,51 @@ cb::sampling::Interval Timings::get_interval_lookup_latency() {
 }
 
 Hdr1sfMicroSecHistogram& Timings::get_or_create_timing_histogram(
-        uint8_t opcode) {
-    if (timings[opcode] == nullptr) {
+        Shard& shard, uint8_t opcode) {
+    if (shard.timings[opcode] == nullptr) {
         std::lock_guard<std::mutex> allocLock(histogram_mutex);
-        if (timings[opcode] == nullptr) {
-            timings[opcode] = std::make_unique<Hdr1sfMicroSecHistogram>();
+        if (shard.timings[opcode] == nullptr) {
+            shard.timings[opcode] = std::make_unique<Hdr1sfMicroSecHistogram>();
         }
     }
-    return *timings[opcode];
+    return *shard.timings[opcode];
 }
 
-Hdr1sfMicroSecHistogram* Timings::get_timing_histogram(uint8_t opcode) const {
-    return timings[opcode].get();
+std::unique_ptr<Hdr1sfMicroSecHistogram> Timings::get_timing_histogram(
+        uint8_t opcode) const {
+    std::unique_ptr<Hdr1sfMicroSecHistogram> ret;
+    std::lock_guard<std::mutex> guard(histogram_mutex);
+    for (const auto& shard : shards) {
+        if (shard->timings[opcode]) {
+            if (!ret) {
+                ret = std::make_unique<Hdr1sfMicroSecHistogram>();
+            }
+            *ret += *shard->timings[opcode];
+        }
+    }
+    return ret;
 }
 
 void Timings::sample(std::chrono::seconds sample_interval) {
     cb::sampling::Interval interval_lookup, interval_mutation;
 
-    for (auto op : timings_mutations) {
-        interval_mutation += interval_counters
-                [std::underlying_type<cb::mcbp::ClientOpcode>::type(op)];
-        interval_counters[std::underlying_type<cb::mcbp::ClientOpcode>::type(
-                                  op)]
-                .reset();
-    }
+    for (auto& shard : shards) {
+        auto& interval_counters = shard->interval_counters;
+        for (auto op : timings_mutations) {
+            interval_mutation += interval_counters
+                    [std::underlying_type<cb::mcbp::ClientOpcode>::type(op)];
+            interval_counters
+                    [std::underlying_type<cb::mcbp::ClientOpcode>::type(op)]
+                            .reset();
+        }
 
-    for (auto op : timings_retrievals) {
-        interval_lookup += interval_counters
-                [std::underlying_type<cb::mcbp::ClientOpcode>::type(op)];
-        interval_counters[std::underlying_type<cb::mcbp::ClientOpcode>::type(
-                                  op)]
-                .reset();
+        for (auto op : timings_retrievals) {
+            interval_lookup += interval_counters
+                    [std::underlying_type<cb::mcbp::ClientOpcode>::type(op)];
+            interval_counters
+                    [std::underlying_type<cb::mcbp::ClientOpcode>::type(op)]
+                            .reset();
+        }
     }
 
     {
@@ -22,21 +22,75 @@
 
 #include <utilities/hdrhistogram.h>
 #include <array>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <vector>
 
 #define MAX_NUM_OPCODES 0x100
 
+/// The resources consumed executing all of the commands for an opcode
+struct OpcodeCost {
+    /// The number of commands executed
+    uint64_t count = 0;
+    /// Time the front end threads spent executing the commands
+    std::chrono::nanoseconds execution{};
+    /// Time the commands spent blocked waiting for the engine
+    std::chrono::nanoseconds blocked{};
+    /// Bytes allocated by the front end threads executing the commands
+    uint64_t allocated = 0;
+};
+
 /** Records timings for each memcached opcode. Each opcode has a histogram of
  * times.
+ *
+ * To avoid having all of the front end threads update the same histograms
+ * (and bounce the cache lines between the cores) each thread records
+ * into its own shard, and the shards are merged when the timings are
+ * requested.
  */
 class Timings {
 public:
     Timings();
     Timings(const Timings&) = delete;
 
+    /**
+     * Set the number of shards (one per front end thread). Must be called
+     * before any timings are collected.
+     */
+    void setNumThreads(size_t num);
+
     void reset();
-    void collect(cb::mcbp::ClientOpcode opcode, std::chrono::nanoseconds nsec);
+
+    /**
+     * Record the execution time for a command
+     *
+     * @param opcode the command executed
+     * @param nsec the time it took
+     * @param thread the index of the front end thread executing the command
+     */
+    void collect(cb::mcbp::ClientOpcode opcode,
+                 std::chrono::nanoseconds nsec,
+                 size_t thread);
+
+    /**
+     * Record the resources consumed by a command
+     *
+     * @param opcode the command executed
+     * @param execution the time spent executing it in the front end thread
+     * @param blocked the time it spent blocked waiting for the engine
+     * @param allocated the bytes the front end thread allocated executing it
+     * @param thread the index of the front end thread executing the command
+     */
+    void collectCost(cb::mcbp::ClientOpcode opcode,
+                     std::chrono::nanoseconds execution,
+                     std::chrono::nanoseconds blocked,
+                     uint64_t allocated,
+                     size_t thread);
+
+    /// Get the resources consumed by the opcode (summed over all threads)
+    OpcodeCost getCost(cb::mcbp::ClientOpcode opcode) const;
+
     void sample(std::chrono::seconds sample_interval);
     std::string generate(cb::mcbp::ClientOpcode opcode);
     uint64_t get_aggregated_mutation_stats();
@@ -46,18 +100,45 @@ public:
     cb::sampling::Interval get_interval_lookup_latency();
 
     /**
-     * Get a pointer to the underlying histogram for the specified opcode
-     * @return a pointer to the underling HdrMicroSecHistogram for this opcode
-     * if there isn't one allocated already a nullptr will be returned.
+     * Get the histogram for the specified opcode (merged from all of the
+     * threads)
+     * @return the HdrMicroSecHistogram for this opcode, or a nullptr if
+     * no thread have collected timings for the opcode yet.
      */
-    Hdr1sfMicroSecHistogram* get_timing_histogram(uint8_t opcode) const;
+    std::unique_ptr<Hdr1sfMicroSecHistogram> get_timing_histogram(
+            uint8_t opcode) const;
 
 private:
+    /// The timings collected by a single front end thread
+    struct Shard {
+        // create an array of unique_ptrs as we want to create HdrHistograms
+        // in a lazy manner as their foot print is larger than our old
+        // histogram class
+        std::array<std::unique_ptr<Hdr1sfMicroSecHistogram>, MAX_NUM_OPCODES>
+                timings;
+        std::array<cb::sampling::Interval, MAX_NUM_OPCODES> interval_counters;
+        struct Cost {
+            cb::RelaxedAtomic<uint64_t> count{0};
+            cb::RelaxedAtomic<uint64_t> execution_ns{0};
+            cb::RelaxedAtomic<uint64_t> blocked_ns{0};
+            cb::RelaxedAtomic<uint64_t> allocated{0};
+        };
+        std::array<Cost, MAX_NUM_OPCODES> costs;
+    };
+
+    Shard& getShard(size_t thread) {
+        return *shards[thread % shards.size()];
+    }
+
     /**
      * Method to get histogram for timing, if the histogram hasn't been created
      * yet, for the given opcode then we will allocate one
      */
-    Hdr1sfMicroSecHistogram& get_or_create_timing_histogram(uint8_t opcode);
+    Hdr1sfMicroSecHistogram& get_or_create_timing_histogram(Shard& shard,
+                                                            uint8_t opcode);
+
+    /// Get the total number of values recorded for the opcode
+    uint64_t get_value_count(cb::mcbp::ClientOpcode opcode) const;
 
     // This lock is only held by sample() and some blocks within generate().
     // It guards the various IntervalSeries variables which internally
@@ -66,11 +147,7 @@ private:
 
     cb::sampling::IntervalSeries interval_latency_lookups;
     cb::sampling::IntervalSeries interval_latency_mutations;
-    // create an array of unique_ptrs as we want to create HdrHistograms
-    // in a lazy manner as their foot print is larger than our old
-    // histogram class
-    std::array<std::unique_ptr<Hdr1sfMicroSecHistogram>, MAX_NUM_OPCODES>
-            timings;
-    std::mutex histogram_mutex;
-    std::array<cb::sampling::Interval, MAX_NUM_OPCODES> interval_counters;
+    std::vector<std::unique_ptr<Shard>> shards;
+    // Serialize the allocation of the histograms with the readers
+    mutable std::mutex histogram_mutex;
 };
@@ -22,9 +22,13 @@
 #include <stdlib.h>
 #include <sys/types.h>
 #include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <gsl/gsl>
+#include <limits>
 #include <stdexcept>
+#include <thread>
+#include <unordered_map>
 
 /*
  * Implementation Details
@@ -85,13 +89,30 @@
  * least-recently-used element is selected as a 'victim' and it's
  * contents is replaced by the incoming key.  Finally the linked-list
  * is updated to move the updated element to the head of the list.
+ *
+ * === TopKeys::Sketch ===
+ *
+ * Used instead of the shards when "topkeys_sample_rate" is N > 1. Each
+ * access is selected with a probability of 1/N (using a thread local
+ * random number generator, so the unsampled accesses don't even hash the
+ * key), and the selected ones are recorded in the sketch owned by the
+ * calling thread. Each sketch tracks max_keys * NUM_SHARDS keys using the
+ * Space-Saving algorithm. When the stats are requested the counts for each
+ * key are summed across all of the sketches, multiplied by N and the
+ * max_keys * NUM_SHARDS keys with the highest count are reported.
  */
 
 
-TopKeys::TopKeys(int mkeys) {
+TopKeys::TopKeys(int mkeys) : max_keys(mkeys) {
     for (auto& shard : shards) {
         shard.setMaxKeys(mkeys);
     }
+
+    const auto nthreads = std::max(size_t(1), settings.getNumWorkerThreads());
+    for (size_t ii = 0; ii < nthreads; ++ii) {
+        sketches.emplace_back(std::make_unique<Sketch>());
+        sketches.back()->setCapacity(size_t(mkeys) * NUM_SHARDS);
+    }
 }
 
 TopKeys::~TopKeys() {
@@ -101,7 +122,11 @@ void TopKeys::updateKey(const void* key,
                         size_t nkey,
                         rel_time_t operation_time) {
     if (settings.isTopkeysEnabled()) {
-        doUpdateKey(key, nkey, operation_time);
+        if (settings.getTopkeysSampleRate() > 1) {
+            doSampledUpdateKey(key, nkey, operation_time);
+        } else {
+            doUpdateKey(key, nkey, operation_time);
+        }
     }
 }
 
@@ -217,6 +242,123 @@ void TopKeys::doUpdateKey(const void* key,
     }
 }
 
+/**
+ * A cheap thread local pseudo random number generator (xorshift64*) used
+ * to pick the accesses to sample.
+ */
+static uint64_t nextSampleRandom() {
+    static thread_local uint64_t state =
+            std::hash<std::thread::id>()(std::this_thread::get_id()) | 1;
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545F4914F6CDD1DULL;
+}
+
+TopKeys::Sketch& TopKeys::getSketch() {
+    static std::atomic<size_t> nextIndex{0};
+    static thread_local const size_t index = nextIndex++;
+    return *sketches[index % sketches.size()];
+}
+
+void TopKeys::doSampledUpdateKey(const void* key,
+                                 size_t nkey,
+                                 rel_time_t operation_time) {
+    if (key == nullptr || nkey == 0) {
+        throw std::invalid_argument(
+                "TopKeys::doSampledUpdateKey: key must be specified");
+    }
+
+    if (nextSampleRandom() % settings.getTopkeysSampleRate() != 0) {
+        return;
+    }
+
+    try {
+        cb::const_char_buffer key_buf(static_cast<const char*>(key), nkey);
+        std::hash<cb::const_char_buffer> hash_fn;
+        getSketch().updateKey(key_buf, hash_fn(key_buf), operation_time);
+    } catch (const std::bad_alloc&) {
+        // Failed to increment topkeys, continue...
+    }
+}
+
+void TopKeys::Sketch::updateKey(const cb::const_char_buffer& key,
+                                size_t key_hash,
+                                rel_time_t operation_time) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry* min = nullptr;
+    for (auto& entry : entries) {
+        if (entry.hash == key_hash &&
+            entry.key.compare(0, entry.key.size(), key.buf, key.len) == 0) {
+            entry.count++;
+            return;
+        }
+        if (min == nullptr || entry.count < min->count) {
+            min = &entry;
+        }
+    }
+
+    if (entries.size() < capacity) {
+        entries.emplace_back(Entry{key_hash,
+                                   std::string(key.buf, key.len),
+                                   1,
+                                   operation_time});
+    } else if (min != nullptr) {
+        // Evict the key with the lowest count; the new key inherits its
+        // count as the upper bound of how often it may have been seen.
+        min->hash = key_hash;
+        min->key.assign(key.buf, key.len);
+        min->count++;
+        min->ctime = operation_time;
+    }
+}
+
+std::vector<TopKeys::Sketch::Entry> TopKeys::Sketch::getEntries() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries;
+}
+
+void TopKeys::visitSketches(iterfunc_t visitor_func, void* visitor_ctx) {
+    std::unordered_map<std::string, std::pair<uint64_t, rel_time_t>> merged;
+    for (auto& sketch : sketches) {
+        for (const auto& entry : sketch->getEntries()) {
+            auto iter = merged.find(entry.key);
+            if (iter == merged.end()) {
+                merged.emplace(entry.key,
+                               std::make_pair(entry.count, entry.ctime));
+            } else {
+                iter->second.first += entry.count;
+                iter->second.second =
+                        std::min(iter->second.second, entry.ctime);
+            }
+        }
+    }
+
+    using MergedEntry = decltype(merged)::value_type;
+    std::vector<const MergedEntry*> ordered;
+    ordered.reserve(merged.size());
+    for (const auto& entry : merged) {
+        ordered.push_back(&entry);
+    }
+
+    const auto limit = std::min(ordered.size(), size_t(max_keys) * NUM_SHARDS);
+    std::partial_sort(ordered.begin(),
+                      ordered.begin() + limit,
+                      ordered.end(),
+                      [](const MergedEntry* a, const MergedEntry* b) {
+                          return a->second.first > b->second.first;
+                      });
+
+    const auto rate = settings.getTopkeysSampleRate();
+    const uint64_t maxCount = std::numeric_limits<int>::max();
+    for (size_t ii = 0; ii < limit; ++ii) {
+        topkey_item_t item(ordered[ii]->second.second);
+        item.ti_access_count = int(
+                std::min(maxCount, ordered[ii]->second.first * rate));
+        visitor_func(ordered[ii]->first, item, visitor_ctx);
+    }
+}
+
 struct tk_context {
     tk_context(const void* c,
                const AddStatFn& a,
@@ -288,6 +430,11 @@ ENGINE_ERROR_CODE TopKeys::doStats(const void* cookie,
                                    const AddStatFn& add_stat) {
     struct tk_context context(cookie, add_stat, current_time, nullptr);
 
+    if (settings.getTopkeysSampleRate() > 1) {
+        visitSketches(tk_iterfunc, &context);
+        return ENGINE_SUCCESS;
+    }
+
     for (auto& shard : shards) {
         shard.accept_visitor(tk_iterfunc, &context);
     }
@@ -311,8 +458,12 @@ ENGINE_ERROR_CODE TopKeys::do_json_stats(nlohmann::json& object,
     struct tk_context context(nullptr, nullptr, current_time, &topkeys);
 
     /* Collate the topkeys JSON object */
-    for (auto& shard : shards) {
-        shard.accept_visitor(tk_jsonfunc, &context);
+    if (settings.getTopkeysSampleRate() > 1) {
+        visitSketches(tk_jsonfunc, &context);
+    } else {
+        for (auto& shard : shards) {
+            shard.accept_visitor(tk_jsonfunc, &context);
+        }
     }
 
     object["topkeys"] = topkeys;
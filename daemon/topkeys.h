@@ -23,6 +23,7 @@
 
 #include <mutex>
 #include <list>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -32,6 +33,11 @@
  * Tracks the top N most recently accessed keys. The details are
  * accessible by a stats call, which is used by ns_server to print the
  * top keys list in the GUI.
+ *
+ * By default every access is recorded exactly (see Shard below). If
+ * "topkeys_sample_rate" is set to N > 1 only 1 in N accesses are recorded,
+ * and they're recorded in a per-thread heavy hitter sketch (see Sketch
+ * below) so the front end threads don't contend on the shard mutexes.
  */
 
 struct topkey_item_t {
@@ -80,6 +86,10 @@ public:
 protected:
     void doUpdateKey(const void* key, size_t nkey, rel_time_t operation_time);
 
+    void doSampledUpdateKey(const void* key,
+                            size_t nkey,
+                            rel_time_t operation_time);
+
     ENGINE_ERROR_CODE doStats(const void* cookie,
                               rel_time_t current_time,
                               const AddStatFn& add_stat);
@@ -96,6 +106,23 @@ private:
 
     Shard& getShard(size_t key_hash);
 
+    class Sketch;
+
+    /// Get the sketch owned by the calling thread
+    Sketch& getSketch();
+
+    /// The signature of tk_iterfunc / tk_jsonfunc
+    typedef void (*iterfunc_t)(const std::string& key,
+                               const topkey_item_t& it,
+                               void* arg);
+
+    /**
+     * Merge the per-thread sketches and invoke the visitor for the
+     * (up to) max_keys * NUM_SHARDS keys with the highest estimated access
+     * count. The counts are scaled by the sample rate.
+     */
+    void visitSketches(iterfunc_t visitor_func, void* visitor_ctx);
+
     // One of N Shards which the keyspace has been broken
     // into.
     // Responsible for tracking the top {mkeys} within it's keyspace.
@@ -161,6 +188,50 @@ private:
         key_storage_t storage;
     };
 
+    /**
+     * A "Space-Saving" heavy hitter sketch, tracking a fixed number of keys.
+     * When a key not already tracked is recorded in a full sketch it
+     * replaces the key with the lowest count and inherits that count (plus
+     * one), so the count of a key is never underestimated and any key with
+     * a true count above total / capacity is guaranteed to be present.
+     *
+     * Each sketch is owned by (a subset of) the worker threads, so the
+     * mutex is normally uncontended; it's only there to allow the stats
+     * call to merge the sketches.
+     */
+    class Sketch {
+    public:
+        struct Entry {
+            size_t hash;
+            std::string key;
+            uint64_t count;
+            rel_time_t ctime;
+        };
+
+        void setCapacity(size_t cap) {
+            capacity = cap;
+            entries.reserve(capacity);
+        }
+
+        void updateKey(const cb::const_char_buffer& key,
+                       size_t key_hash,
+                       rel_time_t operation_time);
+
+        /// Get a copy of the current entries
+        std::vector<Entry> getEntries();
+
+    private:
+        size_t capacity = 0;
+        std::mutex mutex;
+        std::vector<Entry> entries;
+    };
+
     // array of topkey shards.
     std::array<Shard, NUM_SHARDS> shards;
+
+    // Maxumum numbers of keys to be tracked per shard.
+    const int max_keys;
+
+    // The per-thread sketches used when sampling (one per worker thread)
+    std::vector<std::unique_ptr<Sketch>> sketches;
 };
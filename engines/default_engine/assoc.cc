@@ -5,6 +5,7 @@
  */
 #include "default_engine_internal.h"
 
+#include <folly/SharedMutex.h>
 #include <logger/logger.h>
 #include <platform/cbassert.h>
 #include <platform/crc32c.h>
@@ -16,6 +17,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <mutex>
 #include <thread>
@@ -25,12 +28,35 @@
 #define hashsize(n) ((size_t)1<<(n))
 #define hashmask(n) (hashsize(n)-1)
 
+/*
+ * The buckets in the hash table are protected by a set of striped locks,
+ * picked by the low bits of the hash. As the table never has fewer buckets
+ * than there are locks, all of the items in a bucket (in both the old and
+ * the new table while we're expanding) map to the same lock.
+ *
+ * The table itself (its size and the vectors) is protected by table_lock;
+ * all of the operations hold it shared (which is cheap as folly's
+ * SharedMutex doesn't make the readers write to a shared cache line) and
+ * it is only held exclusively while we swap in a new table.
+ */
+static const unsigned int item_lock_hashpower = 10;
+static const unsigned int initial_hashpower = 16;
+static_assert(initial_hashpower > item_lock_hashpower,
+              "The hash table must have more buckets than item locks");
+
 struct Assoc {
     Assoc(unsigned int hp) : hashpower(hp) {
         primary_hashtable.resize(hashsize(hashpower));
     }
 
-    /* how many powers of 2's worth of buckets we use */
+    std::mutex& item_lock(uint32_t hash) {
+        return item_locks[hash & hashmask(item_lock_hashpower)];
+    }
+
+    /*
+     * how many powers of 2's worth of buckets we use (only changed
+     * while holding table_lock exclusively)
+     */
     unsigned int hashpower;
 
 
@@ -44,26 +70,45 @@ struct Assoc {
     std::vector<hash_item*> old_hashtable;
 
     /* Number of items in the hash table. */
-    unsigned int hash_items{0};
+    std::atomic<unsigned int> hash_items{0};
+
+    /*
+     * Flag: Are we in the middle of expanding now? (only changed while
+     * holding table_lock exclusively)
+     */
+    std::atomic_bool expanding{false};
 
-    /* Flag: Are we in the middle of expanding now? */
-    bool expanding{false};
+    /* Flag: Is there a thread working on expanding the table? */
+    std::atomic_bool maintenance_running{false};
 
     /*
      * During expansion we migrate values with bucket granularity; this is how
      * far we've gotten so far. Ranges from 0 .. hashsize(hashpower - 1) - 1.
+     * The bucket is moved while holding its item lock so the value
+     * compared to a given bucket only changes while holding its lock.
      */
-    unsigned int expand_bucket{0};
+    std::atomic<unsigned int> expand_bucket{0};
 
-    /*
-     * serialise access to the hashtable
-     */
-    std::mutex mutex;
+    folly::SharedMutex table_lock;
+    std::array<std::mutex, hashsize(item_lock_hashpower)> item_locks;
 };
 
 /* One hashtable for all */
 static struct Assoc* global_assoc = nullptr;
 
+/* Hold the table lock shared and the item lock for the given hash */
+class ItemLockHolder {
+public:
+    explicit ItemLockHolder(uint32_t hash)
+        : table(global_assoc->table_lock),
+          item(global_assoc->item_lock(hash)) {
+    }
+
+private:
+    folly::SharedMutex::ReadHolder table;
+    std::lock_guard<std::mutex> item;
+};
+
 /* assoc factory. returns one new assoc or NULL if out-of-memory */
 static struct Assoc* assoc_consruct(int hashpower) {
     try {
@@ -78,14 +123,14 @@ ENGINE_ERROR_CODE assoc_init(struct default_engine *engine) {
         construct and save away one assoc for use by all buckets.
     */
     if (global_assoc == nullptr) {
-        global_assoc = assoc_consruct(16);
+        global_assoc = assoc_consruct(initial_hashpower);
     }
     return (global_assoc != NULL) ? ENGINE_SUCCESS : ENGINE_ENOMEM;
 }
 
 void assoc_destroy() {
     if (global_assoc != nullptr) {
-        while (global_assoc->expanding) {
+        while (global_assoc->maintenance_running) {
             std::this_thread::sleep_for(std::chrono::microseconds(250));
         }
         delete global_assoc;
@@ -93,51 +138,28 @@ void assoc_destroy() {
     }
 }
 
-hash_item *assoc_find(uint32_t hash, const hash_key *key) {
-    hash_item *it;
+/*
+    returns the bucket the item with the given hash lives in.
+    the ItemLockHolder for the hash is assumed to be held by the caller.
+*/
+static hash_item** _hashitem_bucket(uint32_t hash) {
     unsigned int oldbucket;
-    hash_item *ret = NULL;
-    int depth = 0;
-    std::lock_guard<std::mutex> guard(global_assoc->mutex);
+
     if (global_assoc->expanding &&
         (oldbucket = (hash & hashmask(global_assoc->hashpower - 1))) >= global_assoc->expand_bucket)
     {
-        it = global_assoc->old_hashtable[oldbucket];
-    } else {
-        it = global_assoc->primary_hashtable[hash & hashmask(global_assoc->hashpower)];
+        return &global_assoc->old_hashtable[oldbucket];
     }
-
-    while (it) {
-        const hash_key* it_key = item_get_key(it);
-        if ((hash_key_get_key_len(key) == hash_key_get_key_len(it_key)) &&
-            (memcmp(hash_key_get_key(key),
-                    hash_key_get_key(it_key),
-                    hash_key_get_key_len(key)) == 0)) {
-            ret = it;
-            break;
-        }
-        it = it->h_next;
-        ++depth;
-    }
-    return ret;
+    return &global_assoc->primary_hashtable[hash & hashmask(global_assoc->hashpower)];
 }
 
 /*
     returns the address of the item pointer before the key.  if *item == 0,
     the item wasn't found
-    assoc->lock is assumed to be held by the caller.
+    the ItemLockHolder for the hash is assumed to be held by the caller.
 */
 static hash_item** _hashitem_before(uint32_t hash, const hash_key* key) {
-    hash_item **pos;
-    unsigned int oldbucket;
-
-    if (global_assoc->expanding &&
-        (oldbucket = (hash & hashmask(global_assoc->hashpower - 1))) >= global_assoc->expand_bucket)
-    {
-        pos = &global_assoc->old_hashtable[oldbucket];
-    } else {
-        pos = &global_assoc->primary_hashtable[hash & hashmask(global_assoc->hashpower)];
-    }
+    hash_item** pos = _hashitem_bucket(hash);
 
     while (*pos) {
         const hash_key* pos_key = item_get_key(*pos);
@@ -154,70 +176,58 @@ static hash_item** _hashitem_before(uint32_t hash, const hash_key* key) {
     return pos;
 }
 
+hash_item *assoc_find(uint32_t hash, const hash_key *key) {
+    ItemLockHolder guard(hash);
+    return *_hashitem_before(hash, key);
+}
+
 static void assoc_maintenance_thread(void *arg);
 
 /*
-    grows the hashtable to the next power of 2.
-    assoc->lock is assumed to be held by the caller.
+    start a thread to grow the hashtable to the next power of 2 unless
+    one is already running.
+    no locks may be held by the caller.
 */
-static void assoc_expand() {
-    global_assoc->old_hashtable.swap(global_assoc->primary_hashtable);
-
-    try {
-        global_assoc->primary_hashtable.resize(hashsize(global_assoc->hashpower + 1));
-    } catch (const std::bad_alloc&) {
-        global_assoc->primary_hashtable.swap(global_assoc->old_hashtable);
-        /* Bad news, but we can keep running. */
+static void assoc_start_expand() {
+    bool running = false;
+    if (!global_assoc->maintenance_running.compare_exchange_strong(running,
+                                                                   true)) {
         return;
     }
 
-    int ret = 0;
     cb_thread_t tid;
-
-    global_assoc->hashpower++;
-    global_assoc->expanding = true;
-    global_assoc->expand_bucket = 0;
-
-    /* start a thread to do the expansion */
+    int ret;
     if ((ret = cb_create_named_thread(&tid, assoc_maintenance_thread,
                                       nullptr, 1, "mc:assoc_maint")) != 0)
     {
         LOG_ERROR("Can't create thread for rebalance assoc table: {}",
                   cb_strerror());
-        global_assoc->hashpower--;
-        global_assoc->expanding = false;
-        global_assoc->primary_hashtable.swap(global_assoc->old_hashtable);
-        global_assoc->old_hashtable.resize(0);
-        global_assoc->old_hashtable.shrink_to_fit();
+        global_assoc->maintenance_running = false;
     }
 }
 
 /* Note: this isn't an assoc_update.  The key must not already exist to call this */
 int assoc_insert(uint32_t hash, hash_item *it) {
-    unsigned int oldbucket;
-
     cb_assert(assoc_find(hash, item_get_key(it)) == 0);  /* shouldn't have duplicately named things defined */
 
-    std::lock_guard<std::mutex> guard(global_assoc->mutex);
-    if (global_assoc->expanding &&
-        (oldbucket = (hash & hashmask(global_assoc->hashpower - 1))) >= global_assoc->expand_bucket)
+    unsigned int hashpower;
     {
-        it->h_next = global_assoc->old_hashtable[oldbucket];
-        global_assoc->old_hashtable[oldbucket] = it;
-    } else {
-        it->h_next = global_assoc->primary_hashtable[hash & hashmask(global_assoc->hashpower)];
-        global_assoc->primary_hashtable[hash & hashmask(global_assoc->hashpower)] = it;
+        ItemLockHolder guard(hash);
+        hash_item** bucket = _hashitem_bucket(hash);
+        it->h_next = *bucket;
+        *bucket = it;
+        hashpower = global_assoc->hashpower;
     }
 
-    global_assoc->hash_items++;
-    if (! global_assoc->expanding && global_assoc->hash_items > (hashsize(global_assoc->hashpower) * 3) / 2) {
-        assoc_expand();
+    const auto items = ++global_assoc->hash_items;
+    if (!global_assoc->expanding && items > (hashsize(hashpower) * 3) / 2) {
+        assoc_start_expand();
     }
     return 1;
 }
 
 void assoc_delete(uint32_t hash, const hash_key *key) {
-    std::lock_guard<std::mutex> guard(global_assoc->mutex);
+    ItemLockHolder guard(hash);
     hash_item **before = _hashitem_before(hash, key);
 
     if (*before) {
@@ -235,46 +245,72 @@ void assoc_delete(uint32_t hash, const hash_key *key) {
 
 
 
-#define DEFAULT_HASH_BULK_MOVE 1
-int hash_bulk_move = DEFAULT_HASH_BULK_MOVE;
+/*
+    swap in a table twice the size. readers and writers are only blocked
+    while we allocate the new table; the items are moved over bucket by
+    bucket afterwards while holding just the lock for the bucket.
+*/
+static bool assoc_begin_expand() {
+    folly::SharedMutex::WriteHolder guard(global_assoc->table_lock);
+    if (global_assoc->hash_items <=
+        (hashsize(global_assoc->hashpower) * 3) / 2) {
+        return false;
+    }
 
-static void assoc_maintenance_thread(void *arg) {
-    bool done = false;
-    do {
-        int ii;
-        std::lock_guard<std::mutex> guard(global_assoc->mutex);
+    global_assoc->old_hashtable.swap(global_assoc->primary_hashtable);
+    try {
+        global_assoc->primary_hashtable.resize(
+                hashsize(global_assoc->hashpower + 1));
+    } catch (const std::bad_alloc&) {
+        global_assoc->primary_hashtable.swap(global_assoc->old_hashtable);
+        /* Bad news, but we can keep running. */
+        return false;
+    }
 
-        for (ii = 0; ii < hash_bulk_move && global_assoc->expanding; ++ii) {
-            hash_item *it, *next;
-            int bucket;
+    global_assoc->hashpower++;
+    global_assoc->expand_bucket = 0;
+    global_assoc->expanding = true;
+    return true;
+}
+
+static void assoc_end_expand() {
+    {
+        folly::SharedMutex::WriteHolder guard(global_assoc->table_lock);
+        global_assoc->expanding = false;
+        global_assoc->old_hashtable.resize(0);
+        global_assoc->old_hashtable.shrink_to_fit();
+    }
+    LOG_INFO("Hash table expansion done");
+}
 
-            for (it = global_assoc->old_hashtable[global_assoc->expand_bucket];
-                 NULL != it; it = next) {
+static void assoc_maintenance_thread(void *arg) {
+    if (assoc_begin_expand()) {
+        const auto nbuckets = hashsize(global_assoc->hashpower - 1);
+        for (unsigned int bucket = 0; bucket < nbuckets; ++bucket) {
+            // Consecutive buckets use different locks so we move a single
+            // bucket at a time
+            ItemLockHolder guard(bucket);
+            hash_item *it, *next;
+            for (it = global_assoc->old_hashtable[bucket]; NULL != it;
+                 it = next) {
                 next = it->h_next;
                 const hash_key* key = item_get_key(it);
-                bucket = crc32c(hash_key_get_key(key),
-                                hash_key_get_key_len(key),
-                                0) & hashmask(global_assoc->hashpower);
-                it->h_next = global_assoc->primary_hashtable[bucket];
-                global_assoc->primary_hashtable[bucket] = it;
+                auto newbucket = crc32c(hash_key_get_key(key),
+                                        hash_key_get_key_len(key),
+                                        0) &
+                                 hashmask(global_assoc->hashpower);
+                it->h_next = global_assoc->primary_hashtable[newbucket];
+                global_assoc->primary_hashtable[newbucket] = it;
             }
 
-            global_assoc->old_hashtable[global_assoc->expand_bucket] = NULL;
-            global_assoc->expand_bucket++;
-            if (global_assoc->expand_bucket == hashsize(global_assoc->hashpower - 1)) {
-                global_assoc->expanding = false;
-                global_assoc->old_hashtable.resize(0);
-                global_assoc->old_hashtable.shrink_to_fit();
-                LOG_INFO("Hash table expansion done");
-            }
+            global_assoc->old_hashtable[bucket] = NULL;
+            global_assoc->expand_bucket = bucket + 1;
         }
-        if (!global_assoc->expanding) {
-            done = true;
-        }
-    } while (!done);
+        assoc_end_expand();
+    }
+    global_assoc->maintenance_running = false;
 }
 
 bool assoc_expanding() {
-    std::lock_guard<std::mutex> guard(global_assoc->mutex);
     return global_assoc->expanding;
 }
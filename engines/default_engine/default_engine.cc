@@ -18,6 +18,8 @@
 #include <memcached/durability_spec.h>
 #include <memcached/protocol_binary.h>
 #include <memcached/server_core_iface.h>
+#include <algorithm>
+#include <logger/logger.h>
 #include <platform/cbassert.h>
 
 // The default engine don't really use vbucket uuids, but in order
@@ -78,9 +80,20 @@ void default_engine_constructor(struct default_engine* engine, bucket_id_t id)
     engine->config.factor = 1.25;
     engine->config.chunk_size = 48;
     engine->config.item_size_max= 1024 * 1024;
+    engine->config.slab_automove = false;
+    engine->config.hot_lru_pct = 20;
+    engine->config.warm_lru_pct = 40;
+    engine->config.scrub_slice_us = 250;
+    engine->config.scrub_rate = 0;
     engine->config.xattr_enabled = true;
     engine->config.compression_mode = BucketCompressionMode::Off;
     engine->config.min_compression_ratio = default_min_compression_ratio;
+    engine->config.ext_path = nullptr;
+    engine->config.ext_size = 1024 * 1024 * 1024;
+    engine->config.ext_page_size = 64 * 1024 * 1024;
+    engine->config.ext_item_size = 512;
+    engine->config.ext_item_age = 3600;
+    engine->config.ext_compact_under = 50;
 }
 
 extern "C" ENGINE_ERROR_CODE create_instance(GET_SERVER_API get_server_api,
@@ -132,19 +145,39 @@ ENGINE_ERROR_CODE default_engine::initialize(const char* config_str) {
         return ret;
     }
 
+    if (config.ext_path != nullptr && *config.ext_path != '\0') {
+        try {
+            extstore = std::make_unique<ExtStore>(*this,
+                                                  config.ext_path,
+                                                  config.ext_size,
+                                                  config.ext_page_size,
+                                                  config.ext_compact_under);
+        } catch (const std::exception& e) {
+            LOG_WARNING("Bucket ({}) failed to create the extstore: {}",
+                        bucket_id,
+                        e.what());
+            return ENGINE_FAILED;
+        }
+    }
+
     return ENGINE_SUCCESS;
 }
 
 void default_engine::destroy(const bool force) {
+    slabs.automove.enabled = false;
     engine_manager_delete_engine(this);
 }
 
 void destroy_engine_instance(struct default_engine* engine) {
     if (engine->initialized) {
+        /* Stop the extstore before we release the memory it refers to */
+        engine->extstore.reset();
+
         /* Destory the slabs cache */
         slabs_destroy(engine);
 
         cb_free(engine->config.uuid);
+        cb_free(engine->config.ext_path);
         engine->initialized = false;
     }
 }
@@ -323,9 +356,12 @@ cb::EngineErrorItemPair default_engine::get(
                 cb::unique_item_ptr{nullptr, cb::ItemDeleter{this}});
     }
 
-    item* it =
+    auto* it =
             item_get(this, cookie, key.data(), key.size(), documentStateFilter);
     if (it != nullptr) {
+        if (item_ext_fetch(this, cookie, it)) {
+            return cb::makeEngineErrorItemPair(cb::engine_errc::would_block);
+        }
         return cb::makeEngineErrorItemPair(cb::engine_errc::success, it, this);
     } else {
         return cb::makeEngineErrorItemPair(cb::engine_errc::no_such_key);
@@ -341,15 +377,15 @@ cb::EngineErrorItemPair default_engine::get_if(
         return cb::makeEngineErrorItemPair(cb::engine_errc::not_my_vbucket);
     }
 
-    cb::unique_item_ptr ret(item_get(this,
-                                     cookie,
-                                     key.data(),
-                                     key.size(),
-                                     DocStateFilter::Alive),
-                            cb::ItemDeleter{this});
-    if (!ret) {
+    auto* it = item_get(
+            this, cookie, key.data(), key.size(), DocStateFilter::Alive);
+    if (it == nullptr) {
         return cb::makeEngineErrorItemPair(cb::engine_errc::no_such_key);
     }
+    if (item_ext_fetch(this, cookie, it)) {
+        return cb::makeEngineErrorItemPair(cb::engine_errc::would_block);
+    }
+    cb::unique_item_ptr ret(it, cb::ItemDeleter{this});
 
     item_info info;
     if (!get_item_info(ret.get(), &info)) {
@@ -489,6 +525,10 @@ ENGINE_ERROR_CODE default_engine::get_stats(gsl::not_null<const void*> cookie,
         } else {
             add_stat("uuid", 4, "", 0, cookie);
         }
+    } else if (key == "extstore"_ccb) {
+        if (extstore) {
+            extstore->stats(add_stat, cookie);
+        }
     } else if (key == "scrub"_ccb) {
         char val[128];
         int len;
@@ -507,10 +547,24 @@ ENGINE_ERROR_CODE default_engine::get_stats(gsl::not_null<const void*> cookie,
                 add_stat("scrubber:last_run", 17, val, len, cookie);
             }
 
-            len = sprintf(val, "%" PRIu64, scrubber.visited);
+            const uint64_t visited = scrubber.visited;
+            len = sprintf(val, "%" PRIu64, visited);
             add_stat("scrubber:visited", 16, val, len, cookie);
-            len = sprintf(val, "%" PRIu64, scrubber.cleaned);
+            len = sprintf(val, "%" PRIu64, uint64_t(scrubber.cleaned));
             add_stat("scrubber:cleaned", 16, val, len, cookie);
+            len = sprintf(val, "%" PRIu64, uint64_t(scrubber.slices));
+            add_stat("scrubber:slices", 15, val, len, cookie);
+            len = sprintf(val, "%" PRIu64, scrubber.total);
+            add_stat("scrubber:total", 14, val, len, cookie);
+            // The number of items may change while we run, so the
+            // progress is an estimate
+            uint64_t progress = 100;
+            if (scrubber.running && scrubber.total != 0) {
+                progress = std::min(uint64_t(99),
+                                    visited * 100 / scrubber.total);
+            }
+            len = sprintf(val, "%" PRIu64, progress);
+            add_stat("scrubber:progress", 17, val, len, cookie);
         }
     } else {
         ret = ENGINE_KEY_ENOENT;
@@ -559,9 +613,11 @@ cb::EngineErrorCasPair default_engine::store_if(
             throw cb::engine_error(cb::engine_errc::failed,
                                    "default_store_if: item_get_key failed");
         }
-        cb::unique_item_ptr existing(
-                item_get(this, cookie, *key, DocStateFilter::Alive),
-                cb::ItemDeleter{this});
+        auto* stored = item_get(this, cookie, *key, DocStateFilter::Alive);
+        if (stored != nullptr && item_ext_fetch(this, cookie, stored)) {
+            return {cb::engine_errc::would_block, 0};
+        }
+        cb::unique_item_ptr existing(stored, cb::ItemDeleter{this});
 
         cb::StoreIfStatus status;
         if (existing.get()) {
@@ -613,7 +669,7 @@ static ENGINE_ERROR_CODE initalize_configuration(struct default_engine *se,
    se->config.vb0 = true;
 
    if (cfg_str != NULL) {
-       struct config_item items[13];
+       struct config_item items[24];
        int ii = 0;
 
        memset(&items, 0, sizeof(items));
@@ -676,14 +732,91 @@ static ENGINE_ERROR_CODE initalize_configuration(struct default_engine *se,
        items[ii].value.dt_bool = &se->config.keep_deleted;
        ++ii;
 
+       items[ii].key = "slab_automove";
+       items[ii].datatype = DT_BOOL;
+       items[ii].value.dt_bool = &se->config.slab_automove;
+       ++ii;
+
+       items[ii].key = "hot_lru_pct";
+       items[ii].datatype = DT_SIZE;
+       items[ii].value.dt_size = &se->config.hot_lru_pct;
+       ++ii;
+
+       items[ii].key = "warm_lru_pct";
+       items[ii].datatype = DT_SIZE;
+       items[ii].value.dt_size = &se->config.warm_lru_pct;
+       ++ii;
+
+       items[ii].key = "scrub_slice_us";
+       items[ii].datatype = DT_SIZE;
+       items[ii].value.dt_size = &se->config.scrub_slice_us;
+       ++ii;
+
+       items[ii].key = "scrub_rate";
+       items[ii].datatype = DT_SIZE;
+       items[ii].value.dt_size = &se->config.scrub_rate;
+       ++ii;
+
+       items[ii].key = "ext_path";
+       items[ii].datatype = DT_STRING;
+       items[ii].value.dt_string = &se->config.ext_path;
+       ++ii;
+
+       items[ii].key = "ext_size";
+       items[ii].datatype = DT_SIZE;
+       items[ii].value.dt_size = &se->config.ext_size;
+       ++ii;
+
+       items[ii].key = "ext_page_size";
+       items[ii].datatype = DT_SIZE;
+       items[ii].value.dt_size = &se->config.ext_page_size;
+       ++ii;
+
+       items[ii].key = "ext_item_size";
+       items[ii].datatype = DT_SIZE;
+       items[ii].value.dt_size = &se->config.ext_item_size;
+       ++ii;
+
+       items[ii].key = "ext_item_age";
+       items[ii].datatype = DT_SIZE;
+       items[ii].value.dt_size = &se->config.ext_item_age;
+       ++ii;
+
+       items[ii].key = "ext_compact_under";
+       items[ii].datatype = DT_SIZE;
+       items[ii].value.dt_size = &se->config.ext_compact_under;
+       ++ii;
+
        items[ii].key = NULL;
        ++ii;
-       cb_assert(ii == 13);
+       cb_assert(ii == 24);
        ret = ENGINE_ERROR_CODE(se->server.core->parse_config(cfg_str,
                                                              items,
                                                              stderr));
    }
 
+   if (ret == ENGINE_SUCCESS &&
+       se->config.hot_lru_pct + se->config.warm_lru_pct >= 100) {
+       fprintf(stderr, "hot_lru_pct + warm_lru_pct must be less than 100\n");
+       ret = ENGINE_EINVAL;
+   }
+
+   if (ret == ENGINE_SUCCESS && se->config.ext_path != NULL &&
+       *se->config.ext_path != '\0') {
+       /* The offsets within a page are 32 bit */
+       if (se->config.ext_page_size < ExtStore::bufferSize ||
+           se->config.ext_page_size > UINT32_MAX) {
+           fprintf(stderr, "ext_page_size must be between 1MB and 4GB\n");
+           ret = ENGINE_EINVAL;
+       } else if (se->config.ext_size < 2 * se->config.ext_page_size) {
+           fprintf(stderr, "ext_size must be at least 2 * ext_page_size\n");
+           ret = ENGINE_EINVAL;
+       } else if (se->config.ext_compact_under > 100) {
+           fprintf(stderr, "ext_compact_under must be a percentage\n");
+           ret = ENGINE_EINVAL;
+       }
+   }
+
    if (se->config.vb0) {
        set_vbucket_state(se, Vbid(0), vbucket_state_active);
    }
@@ -940,6 +1073,14 @@ bool default_engine::get_item_info(gsl::not_null<const item*> item,
                       DocKeyEncodesCollectionId::No};
     item_info->value[0].iov_base = item_get_data(it);
     item_info->value[0].iov_len = it->nbytes;
+    if (iflag & ITEM_EXTSTORE) {
+        // Only the metadata is in memory (see get_meta)
+        ext_location loc;
+        memcpy(&loc, item_get_data(it), sizeof(loc));
+        item_info->nbytes = loc.nbytes;
+        item_info->value[0].iov_base = nullptr;
+        item_info->value[0].iov_len = 0;
+    }
     item_info->datatype = it->datatype;
     if (iflag & ITEM_ZOMBIE) {
         item_info->document_state = DocumentState::Deleted;
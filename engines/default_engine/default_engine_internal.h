@@ -9,6 +9,7 @@
 
 #include <stdbool.h>
 #include <atomic>
+#include <memory>
 #include <mutex>
 
 #include <memcached/engine.h>
@@ -27,6 +28,7 @@ struct default_engine;
 #include "items.h"
 #include "assoc.h"
 #include "slabs.h"
+#include "extstore.h"
 
    /* Flags */
 #define ITEM_LINKED (1)
@@ -37,6 +39,15 @@ struct default_engine;
 /** The item is deleted (may only be accessed if explicitly asked for) */
 #define ITEM_ZOMBIE (4)
 
+/** The item has been accessed since the LRU maintainer last looked at it */
+#define ITEM_ACTIVE (8)
+
+/**
+ * The item is a header for a value in the extstore (the data of the item
+ * is the ext_location of the value)
+ */
+#define ITEM_EXTSTORE (16)
+
 struct config {
    size_t verbose;
    rel_time_t oldest_live;
@@ -50,9 +61,24 @@ struct config {
    bool vb0;
    char *uuid;
    bool keep_deleted;
+   bool slab_automove;
+   size_t hot_lru_pct;
+   size_t warm_lru_pct;
+   size_t scrub_slice_us;
+   size_t scrub_rate;
    std::atomic<bool> xattr_enabled;
    std::atomic<BucketCompressionMode> compression_mode;
    std::atomic<float> min_compression_ratio;
+   /** The file to use for the extstore (the extstore is disabled if not set) */
+   char *ext_path;
+   size_t ext_size;
+   size_t ext_page_size;
+   /** Only write the values of at least this many bytes to the extstore */
+   size_t ext_item_size;
+   /** Write the items which haven't been accessed in this many seconds */
+   size_t ext_item_age;
+   /** Compact the pages of the extstore when less than this % is in use */
+   size_t ext_compact_under;
 };
 
 /**
@@ -68,8 +94,12 @@ struct engine_stats {
 
 struct engine_scrubber {
     std::mutex lock;
-    uint64_t visited;
-    uint64_t cleaned;
+    cb::RelaxedAtomic<uint64_t> visited{0};
+    cb::RelaxedAtomic<uint64_t> cleaned{0};
+    /** The number of items in the cache when the scrubber started */
+    uint64_t total;
+    /** The number of times the scrubber grabbed the cache lock */
+    cb::RelaxedAtomic<uint64_t> slices{0};
     time_t started;
     time_t stopped;
     bool running;
@@ -212,6 +242,9 @@ struct default_engine : public EngineIface {
    struct engine_stats stats;
    struct engine_scrubber scrubber;
 
+   /** The second tier of storage (if enabled) */
+   std::unique_ptr<ExtStore> extstore;
+
    char vbucket_infos[NUM_VBUCKETS];
 
    /* a unique bucket index, note this is not cluster wide and dies with the process */
@@ -35,7 +35,8 @@ static std::mutex createLock;
 
 EngineManager::EngineManager()
   : scrubberTask(*this),
-    shuttingdown(false) {}
+    shuttingdown(false),
+    lruMaintainerTask(*this) {}
 
 EngineManager::~EngineManager() {
     shutdown();
@@ -107,6 +108,10 @@ void EngineManager::waitForScrubberToBeIdle(std::unique_lock<std::mutex>& lck) {
  * Join the scrubber and delete any data which wasn't cleaned by clients
  */
 void EngineManager::shutdown() {
+    // The LRU maintainer holds the lock while it runs; stop it before we
+    // grab the lock (we're about to delete the engines anyway)
+    lruMaintainerTask.shutdown();
+
     std::unique_lock<std::mutex> lck(lock);
     if (!shuttingdown) {
         shuttingdown = true;
@@ -147,16 +152,51 @@ void EngineManager::shutdown() {
 void EngineManager::notifyScrubComplete(struct default_engine* engine,
                                         bool destroy) {
     if (destroy) {
+        // Remove the engine from the set first so that the LRU maintainer
+        // won't look at it while we're tearing it down
+        {
+            std::lock_guard<std::mutex> lck(lock);
+            engines.erase(engine);
+        }
         destroy_engine_instance(engine);
+        delete engine;
     }
 
     std::lock_guard<std::mutex> lck(lock);
-    if (destroy) {
-        engines.erase(engine);
-        delete engine;
+    cond.notify_one();
+}
+
+void EngineManager::automoveSlabs() {
+    std::vector<struct default_engine*> candidates;
+    {
+        std::lock_guard<std::mutex> lck(lock);
+        if (shuttingdown) {
+            return;
+        }
+        candidates.assign(engines.begin(), engines.end());
     }
 
-    cond.notify_one();
+    // The engines are only deleted by the scrubber task (which is the
+    // thread calling us) so they can't go away while we're using them
+    for (auto* engine : candidates) {
+        if (engine->slabs.automove.enabled) {
+            item_slabs_automove(engine);
+        }
+    }
+}
+
+bool EngineManager::maintainLru() {
+    // Hold the lock while we run so that the engines can't be deleted
+    std::lock_guard<std::mutex> lck(lock);
+    if (shuttingdown) {
+        return false;
+    }
+
+    int moved = 0;
+    for (auto* engine : engines) {
+        moved += item_lru_maintain(engine);
+    }
+    return moved != 0;
 }
 
 EngineManager& getEngineManager() {
@@ -26,7 +26,9 @@
 #include <condition_variable>
 #include <mutex>
 #include <unordered_set>
+#include <vector>
 
+#include "lru_maintainer_task.h"
 #include "scrubber_task.h"
 
 class EngineManager {
@@ -70,6 +72,20 @@ public:
      */
     void notifyScrubComplete(struct default_engine* engine, bool destroy);
 
+    /**
+     * Run the slab_automove policy on all of the engines which has it
+     * enabled (called from the scrubber task)
+     */
+    void automoveSlabs();
+
+    /**
+     * Run the LRU maintainer on all of the engines (called from the LRU
+     * maintainer task)
+     *
+     * @return true if any items were moved
+     */
+    bool maintainLru();
+
 protected:
     /**
      * Wait for the scrubber task to be idle. You <b>must</b> hold the
@@ -97,6 +113,12 @@ private:
 
     /** Handle of all of the instances created of default engine */
     std::unordered_set<struct default_engine*> engines;
+
+    /**
+     * Handle to the task maintaining the LRU of the engines (declared
+     * last as its thread use the members above)
+     */
+    LruMaintainerTask lruMaintainerTask;
 };
 
 extern "C" {
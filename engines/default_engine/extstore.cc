@@ -0,0 +1,604 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "extstore.h"
+
+#include "default_engine_internal.h"
+
+#include <folly/portability/Fcntl.h>
+#include <folly/portability/Unistd.h>
+#include <logger/logger.h>
+#include <memcached/server_cookie_iface.h>
+#include <platform/strerror.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+/**
+ * The header of a record in the file; it is followed by the key and the
+ * value, and padded to a multiple of 8 bytes.
+ */
+struct RecordHeader {
+    uint64_t cas;
+    uint32_t nbytes;
+    uint16_t nkey;
+    uint16_t pad;
+};
+
+/// The number of full buffers we'll queue up before we refuse new writes
+static const size_t maxPendingBuffers = 16;
+
+/// How long the IO thread sleeps when there is nothing to do
+static const std::chrono::seconds idleSleep{1};
+
+static void ext_io_main(void* arg) {
+    auto* store = reinterpret_cast<ExtStore*>(arg);
+    store->run();
+}
+
+static bool pwrite_fully(int fd, const char* buf, size_t nbytes, off_t offset) {
+    while (nbytes > 0) {
+        auto nw = pwrite(fd, buf, nbytes, offset);
+        if (nw == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        buf += nw;
+        nbytes -= nw;
+        offset += nw;
+    }
+    return true;
+}
+
+static bool pread_fully(int fd, char* buf, size_t nbytes, off_t offset) {
+    while (nbytes > 0) {
+        auto nr = pread(fd, buf, nbytes, offset);
+        if (nr == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if (nr == 0) {
+            // Reading beyond the end of file
+            return false;
+        }
+        buf += nr;
+        nbytes -= nr;
+        offset += nr;
+    }
+    return true;
+}
+
+ExtStore::ExtStore(struct default_engine& engine,
+                   const std::string& path,
+                   size_t size,
+                   size_t pageSize,
+                   size_t compactUnderPct)
+    : engine(engine),
+      path(path),
+      pageSize(pageSize),
+      compactUnderPct(compactUnderPct),
+      pages(size / pageSize) {
+    fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd == -1) {
+        throw std::system_error(errno,
+                                std::system_category(),
+                                "ExtStore: failed to open " + path);
+    }
+
+    // Hand out the pages from the start of the file
+    for (auto ii = uint32_t(pages.size()); ii > 0; --ii) {
+        freePages.push_back(ii - 1);
+    }
+
+    if (cb_create_named_thread(
+                &ioThread, &ext_io_main, this, 0, "mc:ext_io") != 0) {
+        close(fd);
+        throw std::runtime_error("Error creating 'mc:ext_io' thread");
+    }
+}
+
+ExtStore::~ExtStore() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        shuttingdown = true;
+        cvar.notify_one();
+    }
+    cb_join_thread(ioThread);
+
+    // Fail the reads we didn't get to
+    for (const auto& req : reads) {
+        engine.server.cookie->notify_io_complete(req.cookie, ENGINE_TMPFAIL);
+    }
+    close(fd);
+}
+
+size_t ExtStore::getRecordSize(size_t nkey, size_t nbytes) {
+    const size_t size = sizeof(RecordHeader) + nkey + nbytes;
+    return (size + 7) & ~size_t(7);
+}
+
+bool ExtStore::write(const hash_item& it, ext_location& loc) {
+    const hash_key* key = item_get_key(&it);
+    return write(it.cas,
+                 hash_key_get_client_key(key),
+                 hash_key_get_client_key_len(key),
+                 item_get_data(&it),
+                 it.nbytes,
+                 loc);
+}
+
+bool ExtStore::write(uint64_t cas,
+                     const void* key,
+                     size_t nkey,
+                     const void* value,
+                     size_t nbytes,
+                     ext_location& loc) {
+    const size_t size = getRecordSize(nkey, nbytes);
+    std::lock_guard<std::mutex> guard(lock);
+    if (size > bufferSize) {
+        ++counters.writeFailures;
+        return false;
+    }
+
+    if (!active || active->data.size() + size > bufferSize ||
+        active->offset + active->data.size() + size > pageSize) {
+        if (!rotate_UNLOCKED(size)) {
+            ++counters.writeFailures;
+            return false;
+        }
+    }
+
+    auto& data = active->data;
+    const size_t start = data.size();
+    loc.page = active->page;
+    loc.version = active->version;
+    loc.offset = uint32_t(active->offset + start);
+    loc.nbytes = uint32_t(nbytes);
+
+    RecordHeader header = {cas, uint32_t(nbytes), uint16_t(nkey), 0};
+    data.resize(start + size);
+    std::memcpy(data.data() + start, &header, sizeof(header));
+    std::memcpy(data.data() + start + sizeof(header), key, nkey);
+    std::memcpy(data.data() + start + sizeof(header) + nkey, value, nbytes);
+
+    auto& page = pages[loc.page];
+    page.written = loc.offset + size;
+    page.liveBytes += size;
+    ++page.liveItems;
+
+    ++counters.objectsWritten;
+    counters.bytesWritten += size;
+    ++counters.objectsLive;
+    counters.bytesLive += size;
+    return true;
+}
+
+bool ExtStore::rotate_UNLOCKED(size_t size) {
+    const bool samePage =
+            active && active->offset + active->data.size() + size <= pageSize;
+    if (active && pending.size() >= maxPendingBuffers) {
+        // The IO thread can't keep up
+        return false;
+    }
+    if (!samePage && freePages.empty()) {
+        return false;
+    }
+
+    auto next = std::make_unique<Buffer>();
+    if (samePage) {
+        next->page = active->page;
+        next->version = active->version;
+        next->offset = uint32_t(active->offset + active->data.size());
+    } else {
+        next->page = freePages.back();
+        freePages.pop_back();
+        auto& page = pages[next->page];
+        page.state = PageState::Open;
+        page.written = 0;
+        page.liveBytes = 0;
+        page.liveItems = 0;
+        next->version = page.version;
+        next->offset = 0;
+    }
+    next->data.reserve(bufferSize);
+    ++pages[next->page].unflushed;
+
+    if (active) {
+        if (!samePage) {
+            pages[active->page].state = PageState::Full;
+        }
+        pending.push_back(std::move(active));
+        cvar.notify_one();
+    }
+    active = std::move(next);
+    return true;
+}
+
+void ExtStore::freePage_UNLOCKED(uint32_t page) {
+    auto& p = pages[page];
+    if (p.state == PageState::Full && p.liveItems == 0 && p.unflushed == 0) {
+        p.state = PageState::Free;
+        ++p.version;
+        p.written = 0;
+        p.liveBytes = 0;
+        freePages.push_back(page);
+    }
+}
+
+void ExtStore::release(const ext_location& loc, size_t nkey) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (loc.page >= pages.size()) {
+        return;
+    }
+    auto& page = pages[loc.page];
+    if (page.version != loc.version || page.state == PageState::Free) {
+        // The page has been compacted (or freed) since
+        return;
+    }
+
+    const size_t size = getRecordSize(nkey, loc.nbytes);
+    page.liveBytes -= std::min(page.liveBytes, size);
+    if (page.liveItems > 0) {
+        --page.liveItems;
+    }
+    counters.bytesLive -= std::min(counters.bytesLive, uint64_t(size));
+    if (counters.objectsLive > 0) {
+        --counters.objectsLive;
+    }
+    freePage_UNLOCKED(loc.page);
+}
+
+void ExtStore::read(const void* cookie, const hash_item& header) {
+    const hash_key* key = item_get_key(&header);
+    ReadRequest req;
+    req.cookie = cookie;
+    std::memcpy(&req.loc, item_get_data(&header), sizeof(req.loc));
+    req.cas = header.cas;
+    req.key.assign(reinterpret_cast<const char*>(hash_key_get_client_key(key)),
+                   hash_key_get_client_key_len(key));
+
+    std::lock_guard<std::mutex> guard(lock);
+    reads.push_back(std::move(req));
+    cvar.notify_one();
+}
+
+hash_item* ExtStore::pin(const void* cookie, hash_item* it) {
+    std::lock_guard<std::mutex> guard(lock);
+    auto& slot = pinned[cookie];
+    std::swap(slot, it);
+    return it;
+}
+
+hash_item* ExtStore::unpin(const void* cookie) {
+    std::lock_guard<std::mutex> guard(lock);
+    auto iter = pinned.find(cookie);
+    if (iter == pinned.end()) {
+        return nullptr;
+    }
+    auto* it = iter->second;
+    pinned.erase(iter);
+    return it;
+}
+
+void ExtStore::run() {
+    std::unique_lock<std::mutex> lck(lock);
+    while (!shuttingdown) {
+        lck.unlock();
+        bool busy = flush();
+        busy = serveReads() || busy;
+        busy = compact() || busy;
+        lck.lock();
+
+        if (!busy && !shuttingdown && pending.empty() && reads.empty()) {
+            cvar.wait_for(lck, idleSleep);
+        }
+    }
+}
+
+bool ExtStore::flush() {
+    bool flushed = false;
+    while (true) {
+        Buffer* buffer;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (pending.empty()) {
+                break;
+            }
+            // We're the only one removing buffers, so it stays in the
+            // queue (where the reads may find it) while we write it
+            buffer = pending.front().get();
+        }
+
+        const off_t offset = off_t(buffer->page) * off_t(pageSize) +
+                             off_t(buffer->offset);
+        const bool ok = pwrite_fully(
+                fd, buffer->data.data(), buffer->data.size(), offset);
+        if (!ok) {
+            LOG_WARNING("ExtStore: failed to write {} bytes to {}: {}",
+                        buffer->data.size(),
+                        path,
+                        cb_strerror());
+        }
+
+        std::lock_guard<std::mutex> guard(lock);
+        if (!ok) {
+            ++counters.ioErrors;
+        }
+        const auto page = buffer->page;
+        --pages[page].unflushed;
+        pending.pop_front();
+        freePage_UNLOCKED(page);
+        flushed = true;
+    }
+    return flushed;
+}
+
+bool ExtStore::readBuffered_UNLOCKED(const ext_location& loc,
+                                     size_t size,
+                                     std::vector<char>& record) const {
+    auto lookup = [&loc, size, &record](const Buffer& buffer) {
+        if (buffer.page != loc.page || buffer.version != loc.version ||
+            loc.offset < buffer.offset ||
+            loc.offset + size > buffer.offset + buffer.data.size()) {
+            return false;
+        }
+        const auto* start = buffer.data.data() + (loc.offset - buffer.offset);
+        record.assign(start, start + size);
+        return true;
+    };
+
+    if (active && lookup(*active)) {
+        return true;
+    }
+    for (const auto& buffer : pending) {
+        if (lookup(*buffer)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ExtStore::readRecord(const ext_location& loc,
+                          uint64_t cas,
+                          const std::string& key,
+                          std::vector<char>& record) {
+    const size_t size = getRecordSize(key.size(), loc.nbytes);
+    if (loc.page >= pages.size() || size_t(loc.offset) + size > pageSize) {
+        return false;
+    }
+
+    bool buffered;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (pages[loc.page].version != loc.version) {
+            return false;
+        }
+        buffered = readBuffered_UNLOCKED(loc, size, record);
+    }
+
+    if (!buffered) {
+        record.resize(size);
+        const off_t offset =
+                off_t(loc.page) * off_t(pageSize) + off_t(loc.offset);
+        if (!pread_fully(fd, record.data(), size, offset)) {
+            LOG_WARNING("ExtStore: failed to read {} bytes from {}: {}",
+                        size,
+                        path,
+                        cb_strerror());
+            std::lock_guard<std::mutex> guard(lock);
+            ++counters.ioErrors;
+            return false;
+        }
+
+        // The page may have been freed (and reused) while we read it
+        std::lock_guard<std::mutex> guard(lock);
+        if (pages[loc.page].version != loc.version) {
+            return false;
+        }
+    }
+
+    RecordHeader header;
+    std::memcpy(&header, record.data(), sizeof(header));
+    return header.cas == cas && header.nbytes == loc.nbytes &&
+           header.nkey == key.size() &&
+           std::memcmp(record.data() + sizeof(header),
+                       key.data(),
+                       key.size()) == 0;
+}
+
+bool ExtStore::serveReads() {
+    std::deque<ReadRequest> batch;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        batch.swap(reads);
+    }
+    if (batch.empty()) {
+        return false;
+    }
+
+    std::vector<char> record;
+    for (const auto& req : batch) {
+        const void* value = nullptr;
+        if (readRecord(req.loc, req.cas, req.key, record)) {
+            value = record.data() + sizeof(RecordHeader) + req.key.size();
+        }
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (value != nullptr) {
+                ++counters.objectsRead;
+                counters.bytesRead += record.size();
+            } else {
+                ++counters.readMisses;
+            }
+        }
+
+        // If the value is gone the header is dropped (and the client
+        // gets a miss when the operation is retried)
+        const auto status = item_ext_restore(&engine,
+                                             req.cookie,
+                                             req.key.data(),
+                                             req.key.size(),
+                                             req.cas,
+                                             req.loc,
+                                             value);
+        engine.server.cookie->notify_io_complete(req.cookie, status);
+    }
+    return true;
+}
+
+bool ExtStore::compact() {
+    uint32_t victim = 0;
+    uint32_t version;
+    size_t written;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        bool found = false;
+        for (uint32_t ii = 0; ii < pages.size(); ++ii) {
+            const auto& page = pages[ii];
+            if (page.state != PageState::Full || page.unflushed != 0 ||
+                page.written == 0 ||
+                page.liveBytes * 100 >= page.written * compactUnderPct) {
+                continue;
+            }
+            if (!found || page.liveBytes < pages[victim].liveBytes) {
+                victim = ii;
+                found = true;
+            }
+        }
+        if (!found) {
+            return false;
+        }
+        version = pages[victim].version;
+        written = pages[victim].written;
+    }
+
+    std::vector<char> data(written);
+    size_t offset = 0;
+    if (!pread_fully(fd,
+                     data.data(),
+                     written,
+                     off_t(victim) * off_t(pageSize))) {
+        LOG_WARNING("ExtStore: failed to read page {} from {}: {}",
+                    victim,
+                    path,
+                    cb_strerror());
+        std::lock_guard<std::mutex> guard(lock);
+        ++counters.ioErrors;
+        // The values in the page are lost
+        offset = written;
+    }
+
+    // Move the values still in use to the current page. The records are
+    // laid out back to back from the start of the page
+    uint64_t relocated = 0;
+    bool full = false;
+    while (!full && offset < written) {
+        RecordHeader header;
+        if (offset + sizeof(header) > written) {
+            // Garbage at the end of the page (a failed write)
+            break;
+        }
+        std::memcpy(&header, data.data() + offset, sizeof(header));
+        const size_t size = getRecordSize(header.nkey, header.nbytes);
+        if (offset + size > written) {
+            break;
+        }
+
+        const ext_location loc = {
+                victim, version, uint32_t(offset), header.nbytes};
+        const char* key = data.data() + offset + sizeof(header);
+        switch (item_ext_relocate(&engine,
+                                  key,
+                                  header.nkey,
+                                  header.cas,
+                                  loc,
+                                  key + header.nkey)) {
+        case ENGINE_SUCCESS:
+            ++relocated;
+            offset += size;
+            break;
+        case ENGINE_KEY_ENOENT:
+            offset += size;
+            break;
+        default:
+            // No room for the value right now; try again later (the values
+            // we've moved so far have been released from the page)
+            full = true;
+            break;
+        }
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    counters.relocated += relocated;
+    auto& page = pages[victim];
+    if (!full && page.version == version && page.state == PageState::Full) {
+        // Anyone still referring to the page will get a miss
+        counters.objectsLive -=
+                std::min(counters.objectsLive, uint64_t(page.liveItems));
+        counters.bytesLive -=
+                std::min(counters.bytesLive, uint64_t(page.liveBytes));
+        page.liveItems = 0;
+        page.liveBytes = 0;
+        freePage_UNLOCKED(victim);
+    }
+    ++counters.compactions;
+    return !full;
+}
+
+void ExtStore::stats(const AddStatFn& add_stat, const void* cookie) {
+    std::lock_guard<std::mutex> guard(lock);
+    const char* prefix = "extstore";
+
+    add_statistics(cookie, add_stat, prefix, -1, "page_size", "%" PRIu64,
+                   uint64_t(pageSize));
+    add_statistics(cookie, add_stat, prefix, -1, "pages_total", "%" PRIu64,
+                   uint64_t(pages.size()));
+    add_statistics(cookie, add_stat, prefix, -1, "pages_free", "%" PRIu64,
+                   uint64_t(freePages.size()));
+    add_statistics(cookie, add_stat, prefix, -1, "objects_written",
+                   "%" PRIu64, counters.objectsWritten);
+    add_statistics(cookie, add_stat, prefix, -1, "bytes_written", "%" PRIu64,
+                   counters.bytesWritten);
+    add_statistics(cookie, add_stat, prefix, -1, "objects_read", "%" PRIu64,
+                   counters.objectsRead);
+    add_statistics(cookie, add_stat, prefix, -1, "bytes_read", "%" PRIu64,
+                   counters.bytesRead);
+    add_statistics(cookie, add_stat, prefix, -1, "objects_live", "%" PRIu64,
+                   counters.objectsLive);
+    add_statistics(cookie, add_stat, prefix, -1, "bytes_live", "%" PRIu64,
+                   counters.bytesLive);
+    add_statistics(cookie, add_stat, prefix, -1, "read_misses", "%" PRIu64,
+                   counters.readMisses);
+    add_statistics(cookie, add_stat, prefix, -1, "write_failures",
+                   "%" PRIu64, counters.writeFailures);
+    add_statistics(cookie, add_stat, prefix, -1, "io_errors", "%" PRIu64,
+                   counters.ioErrors);
+    add_statistics(cookie, add_stat, prefix, -1, "compactions", "%" PRIu64,
+                   counters.compactions);
+    add_statistics(cookie, add_stat, prefix, -1, "relocated", "%" PRIu64,
+                   counters.relocated);
+    add_statistics(cookie, add_stat, prefix, -1, "io_queue", "%" PRIu64,
+                   uint64_t(pending.size() + reads.size()));
+}
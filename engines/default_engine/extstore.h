@@ -0,0 +1,304 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include "items.h"
+
+#include <memcached/engine_common.h>
+#include <memcached/engine_error.h>
+#include <platform/platform_thread.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct default_engine;
+
+/**
+ * Where the value of an item lives in the extstore. This is the data of
+ * the header item (flagged with ITEM_EXTSTORE) which replaces the item in
+ * the cache once its value has been written out.
+ */
+struct ext_location {
+    /** The page the record is in */
+    uint32_t page;
+    /** The version of the page when the record was written */
+    uint32_t version;
+    /** The offset of the record within the page */
+    uint32_t offset;
+    /** The size of the value */
+    uint32_t nbytes;
+};
+
+/**
+ * The extstore is a second tier of storage for the memcached buckets; a
+ * file (typically on flash) the values of the cold items are written to
+ * so that the memory holding them may be reused, keeping a small header
+ * item in the cache in their place.
+ *
+ * The file is split into pages. The values are appended to a write
+ * buffer which is written to the current page when it is full, and a page
+ * is freed when all of the values in it are gone. A page where most of
+ * the values are gone is compacted; the values still in use are written
+ * to the current page (and their headers updated) before the page is
+ * freed.
+ *
+ * The extstore runs its own IO thread which writes the buffers, serves
+ * the reads of the values (the front end thread gets EWOULDBLOCK and is
+ * notified once the value is back in memory) and compacts the pages.
+ *
+ * Lock ordering: the items lock of the engine must be acquired before the
+ * lock of the extstore. The IO thread doesn't hold the extstore lock when
+ * it calls back into the engine.
+ */
+class ExtStore {
+public:
+    /**
+     * Create the extstore (and the file backing it); throws
+     * std::system_error if the file can't be created.
+     *
+     * @param engine the engine the extstore belongs to
+     * @param path the file to store the values in (it is truncated)
+     * @param size the size of the file
+     * @param pageSize the size of each page in the file
+     * @param compactUnderPct compact a page when less than this percentage
+     *                        of it is in use
+     */
+    ExtStore(struct default_engine& engine,
+             const std::string& path,
+             size_t size,
+             size_t pageSize,
+             size_t compactUnderPct);
+
+    ~ExtStore();
+
+    /**
+     * Write the value of an item to the extstore. The caller must hold the
+     * items lock.
+     *
+     * @param it the item to write
+     * @param[out] loc where the value was written
+     * @return false if there is no room for the value right now
+     */
+    bool write(const hash_item& it, ext_location& loc);
+
+    /**
+     * Write a value to the extstore. The caller must hold the items lock.
+     *
+     * @param cas the cas of the item the value belongs to
+     * @param key the (client) key of the item
+     * @param nkey the number of bytes in the key
+     * @param value the value to write
+     * @param nbytes the number of bytes in the value
+     * @param[out] loc where the value was written
+     * @return false if there is no room for the value right now
+     */
+    bool write(uint64_t cas,
+               const void* key,
+               size_t nkey,
+               const void* value,
+               size_t nbytes,
+               ext_location& loc);
+
+    /**
+     * Release the space used by a value (the header referring to it is
+     * being unlinked). The caller must hold the items lock.
+     *
+     * @param loc where the value is
+     * @param nkey the number of bytes in the (client) key of the item
+     */
+    void release(const ext_location& loc, size_t nkey);
+
+    /**
+     * Schedule a read of the value a header refers to; the IO thread
+     * restores the item and notifies the cookie once it is done. The
+     * caller must hold the items lock.
+     */
+    void read(const void* cookie, const hash_item& header);
+
+    /**
+     * Hold on to the item restored for a cookie until the operation is
+     * retried, so that it can't be written out again before the retry sees
+     * it (which could repeat forever under memory pressure). The caller
+     * must hold the items lock, and must release the item returned (the
+     * one previously pinned for the cookie, if any).
+     */
+    hash_item* pin(const void* cookie, hash_item* it);
+
+    /**
+     * Drop the pin held for the cookie. The caller must hold the items
+     * lock, and must release the item returned (if any).
+     */
+    hash_item* unpin(const void* cookie);
+
+    /**
+     * Add the extstore statistics
+     */
+    void stats(const AddStatFn& add_stat, const void* cookie);
+
+    /**
+     * Task's run loop method. This is not a public function and should only
+     * be called from the constructor.
+     */
+    void run();
+
+    /// Get the size of the record for a key and value in the file
+    static size_t getRecordSize(size_t nkey, size_t nbytes);
+
+    /** The largest record we may write (the size of the write buffer) */
+    static const size_t bufferSize = 1024 * 1024;
+
+private:
+    enum class PageState : uint8_t { Free, Open, Full };
+
+    struct Page {
+        PageState state = PageState::Free;
+        /** Incremented every time the page is freed */
+        uint32_t version = 0;
+        /** The number of bytes appended to the page */
+        size_t written = 0;
+        /** The number of bytes (and values) still in use */
+        size_t liveBytes = 0;
+        size_t liveItems = 0;
+        /** The number of buffers for the page which isn't written yet */
+        size_t unflushed = 0;
+    };
+
+    /** A block of records to be written to a page */
+    struct Buffer {
+        uint32_t page;
+        uint32_t version;
+        uint32_t offset;
+        std::vector<char> data;
+    };
+
+    struct ReadRequest {
+        const void* cookie;
+        ext_location loc;
+        uint64_t cas;
+        std::string key;
+    };
+
+    /// Queue the current buffer and start a new one with room for size
+    bool rotate_UNLOCKED(size_t size);
+
+    /// Free the page (if it isn't in use)
+    void freePage_UNLOCKED(uint32_t page);
+
+    /// Look up a record in the buffers not written yet
+    bool readBuffered_UNLOCKED(const ext_location& loc,
+                               size_t size,
+                               std::vector<char>& record) const;
+
+    /// Write the pending buffers; returns true if it did anything
+    bool flush();
+
+    /// Serve the pending reads; returns true if it did anything
+    bool serveReads();
+
+    /// Compact a page if one needs it; returns true if it did anything
+    bool compact();
+
+    /// Read a record from the file (or the buffers) and check that it is
+    /// the record for the key and cas. Returns false if it isn't
+    bool readRecord(const ext_location& loc,
+                    uint64_t cas,
+                    const std::string& key,
+                    std::vector<char>& record);
+
+    struct default_engine& engine;
+    const std::string path;
+    const size_t pageSize;
+    const size_t compactUnderPct;
+    int fd = -1;
+
+    /** All internal state is protected by this mutex */
+    std::mutex lock;
+    std::condition_variable cvar;
+    bool shuttingdown = false;
+
+    std::vector<Page> pages;
+    std::vector<uint32_t> freePages;
+    /** The buffer being filled (if any) */
+    std::unique_ptr<Buffer> active;
+    /** The buffers waiting to be written, oldest first */
+    std::deque<std::unique_ptr<Buffer>> pending;
+    std::deque<ReadRequest> reads;
+    /** The items restored and not yet seen by the retry, per cookie */
+    std::unordered_map<const void*, hash_item*> pinned;
+
+    struct {
+        uint64_t objectsWritten = 0;
+        uint64_t bytesWritten = 0;
+        uint64_t objectsRead = 0;
+        uint64_t bytesRead = 0;
+        uint64_t objectsLive = 0;
+        uint64_t bytesLive = 0;
+        uint64_t readMisses = 0;
+        uint64_t writeFailures = 0;
+        uint64_t ioErrors = 0;
+        uint64_t compactions = 0;
+        uint64_t relocated = 0;
+    } counters;
+
+    cb_thread_t ioThread;
+};
+
+/**
+ * Restore an item from the value read from the extstore (called from the
+ * extstore IO thread). The header for the key is replaced with the full
+ * item if it still refers to the location.
+ *
+ * @param engine handle to the storage engine
+ * @param cookie the cookie the read was for; the restored item stays
+ *               pinned for it until the operation is retried
+ * @param key the (client) key of the item
+ * @param nkey the number of bytes in the key
+ * @param cas the cas of the item
+ * @param loc where the value was read from
+ * @param value the value, or nullptr if it was lost (the header is removed)
+ * @return ENGINE_SUCCESS, or ENGINE_TMPFAIL if there was no memory for
+ *         the item
+ */
+ENGINE_ERROR_CODE item_ext_restore(struct default_engine* engine,
+                                   const void* cookie,
+                                   const void* key,
+                                   size_t nkey,
+                                   uint64_t cas,
+                                   const ext_location& loc,
+                                   const void* value);
+
+/**
+ * Move a value to a new location in the extstore (called from the extstore
+ * IO thread when compacting a page). Takes the items lock, and calls back
+ * into the extstore to write the value if the header for the key still
+ * refers to the old location.
+ *
+ * @return ENGINE_SUCCESS if the value was moved, ENGINE_KEY_ENOENT if it
+ *         isn't in use anymore and ENGINE_TMPFAIL if there was no room
+ */
+ENGINE_ERROR_CODE item_ext_relocate(struct default_engine* engine,
+                                    const void* key,
+                                    size_t nkey,
+                                    uint64_t cas,
+                                    const ext_location& loc,
+                                    const void* value);
@@ -6,7 +6,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <chrono>
 #include <gsl/gsl>
+#include <thread>
 
 #include "default_engine_internal.h"
 #include "engine_manager.h"
@@ -32,6 +34,9 @@ static hash_item* do_item_get(struct default_engine* engine,
 static int do_item_link(struct default_engine *engine,
                         const void* cookie,
                         hash_item *it);
+static void do_item_relink(struct default_engine *engine,
+                           hash_item *it,
+                           uint8_t lru);
 static void do_item_unlink(struct default_engine *engine, hash_item *it);
 static ENGINE_ERROR_CODE do_safe_item_unlink(struct default_engine *engine,
                                              hash_item *it);
@@ -42,6 +47,9 @@ static int do_item_replace(struct default_engine* engine,
                            hash_item* it,
                            hash_item* new_it);
 static void item_free(struct default_engine *engine, hash_item *it);
+static void item_lru_move(struct default_engine *engine,
+                          hash_item *it,
+                          uint8_t lru);
 
 static bool hash_key_create(hash_key* hkey,
                             const void* key,
@@ -64,6 +72,9 @@ static void hash_key_copy_to_item(hash_item* dst, const hash_key* src);
  */
 static const int search_items = 50;
 
+/* The order we search the segments of the LRU for items to evict */
+static const int lru_search_order[] = {COLD_LRU, WARM_LRU, HOT_LRU};
+
 void item_stats_reset(struct default_engine *engine) {
     std::lock_guard<std::mutex> guard(engine->items.lock);
     memset(engine->items.itemstats, 0, sizeof(engine->items.itemstats));
@@ -120,25 +131,30 @@ hash_item *do_item_alloc(struct default_engine *engine,
     oldest_live = engine->config.oldest_live;
     current_time = engine->server.core->get_current_time();
 
-    for (search = engine->items.tails[id];
-         tries > 0 && search != NULL;
-         tries--, search=search->prev) {
-        if (search->refcount == 0 &&
-            ((search->time < oldest_live) || /* dead by flush */
-             (search->exptime != 0 && search->exptime < current_time)) &&
-            (search->locktime <= current_time)) {
-            it = search;
-            /* I don't want to actually free the object, just steal
-             * the item to avoid to grab the slab mutex twice ;-)
-             */
-            engine->stats.reclaimed++;
-            engine->items.itemstats[id].reclaimed++;
-            it->refcount = 1;
-            slabs_adjust_mem_requested(engine, it->slabs_clsid, ITEM_ntotal(engine, it), ntotal);
-            do_item_unlink(engine, it);
-            /* Initialize the item block: */
-            it->slabs_clsid = 0;
-            it->refcount = 0;
+    for (int lru : lru_search_order) {
+        tries = search_items;
+        for (search = engine->items.tails[id][lru];
+             it == NULL && tries > 0 && search != NULL;
+             tries--, search=search->prev) {
+            if (search->refcount == 0 &&
+                ((search->time < oldest_live) || /* dead by flush */
+                 (search->exptime != 0 && search->exptime < current_time)) &&
+                (search->locktime <= current_time)) {
+                it = search;
+                /* I don't want to actually free the object, just steal
+                 * the item to avoid to grab the slab mutex twice ;-)
+                 */
+                engine->stats.reclaimed++;
+                engine->items.itemstats[id].reclaimed++;
+                it->refcount = 1;
+                slabs_adjust_mem_requested(engine, it->slabs_clsid, ITEM_ntotal(engine, it), ntotal);
+                do_item_unlink(engine, it);
+                /* Initialize the item block: */
+                it->slabs_clsid = 0;
+                it->refcount = 0;
+            }
+        }
+        if (it != NULL) {
             break;
         }
     }
@@ -149,7 +165,6 @@ hash_item *do_item_alloc(struct default_engine *engine,
         ** Could not find an expired item at the tail, and memory allocation
         ** failed. Try to evict some items!
         */
-        tries = search_items;
 
         /* If requested to not push old items out of cache when memory runs out,
          * we're out of luck at this point...
@@ -161,19 +176,31 @@ hash_item *do_item_alloc(struct default_engine *engine,
         }
 
         /*
-         * try to get one off the right LRU
+         * try to get one off the right LRU (starting with the COLD segment)
          * don't necessariuly unlink the tail because it may be locked: refcount>0
          * search up from tail an item with refcount==0 and unlink it; give up after search_items
          * tries
          */
-
-        if (engine->items.tails[id] == 0) {
-            engine->items.itemstats[id].outofmemory++;
-            return NULL;
-        }
-
-        for (search = engine->items.tails[id]; tries > 0 && search != NULL; tries--, search=search->prev) {
-            if (search->refcount == 0 && search->locktime <= current_time) {
+        bool evicted = false;
+        bool empty = true;
+        for (int lru : lru_search_order) {
+            hash_item* prev;
+            tries = search_items;
+            for (search = engine->items.tails[id][lru];
+                 !evicted && tries > 0 && search != NULL;
+                 tries--, search = prev) {
+                empty = false;
+                prev = search->prev;
+                if (search->refcount != 0 || search->locktime > current_time) {
+                    continue;
+                }
+                if (lru == COLD_LRU && (search->iflag & ITEM_ACTIVE) &&
+                    (search->exptime == 0 || search->exptime > current_time)) {
+                    /* It's been accessed; give it another chance */
+                    item_lru_move(engine, search, WARM_LRU);
+                    engine->items.itemstats[id].moves_to_warm++;
+                    continue;
+                }
                 if (search->exptime == 0 || search->exptime > current_time) {
                     engine->items.itemstats[id].evicted++;
                     engine->items.itemstats[id].evicted_time = current_time - search->time;
@@ -186,9 +213,18 @@ hash_item *do_item_alloc(struct default_engine *engine,
                     engine->stats.reclaimed++;
                 }
                 do_item_unlink(engine, search);
+                evicted = true;
+            }
+            if (evicted) {
                 break;
             }
         }
+
+        if (empty) {
+            engine->items.itemstats[id].outofmemory++;
+            return NULL;
+        }
+
         it = static_cast<hash_item*>(slabs_alloc(engine, ntotal, id));
         if (it == 0) {
             engine->items.itemstats[id].outofmemory++;
@@ -199,12 +235,20 @@ hash_item *do_item_alloc(struct default_engine *engine,
              * three hours, so if we find one in the tail which is that old,
              * free it anyway.
              */
-            tries = search_items;
-            for (search = engine->items.tails[id]; tries > 0 && search != NULL; tries--, search=search->prev) {
-                if (search->refcount != 0 && search->time + TAIL_REPAIR_TIME < current_time) {
-                    engine->items.itemstats[id].tailrepairs++;
-                    search->refcount = 0;
-                    do_item_unlink(engine, search);
+            bool repaired = false;
+            for (int lru : lru_search_order) {
+                tries = search_items;
+                for (search = engine->items.tails[id][lru];
+                     !repaired && tries > 0 && search != NULL;
+                     tries--, search=search->prev) {
+                    if (search->refcount != 0 && search->time + TAIL_REPAIR_TIME < current_time) {
+                        engine->items.itemstats[id].tailrepairs++;
+                        search->refcount = 0;
+                        do_item_unlink(engine, search);
+                        repaired = true;
+                    }
+                }
+                if (repaired) {
                     break;
                 }
             }
@@ -218,8 +262,9 @@ hash_item *do_item_alloc(struct default_engine *engine,
     cb_assert(it->slabs_clsid == 0);
 
     it->slabs_clsid = id;
+    it->lru = HOT_LRU;
 
-    cb_assert(it != engine->items.heads[it->slabs_clsid]);
+    cb_assert(it != engine->items.heads[it->slabs_clsid][HOT_LRU]);
 
     it->next = it->prev = it->h_next = 0;
     it->refcount = 1;     /* the caller will have a reference */
@@ -238,8 +283,8 @@ static void item_free(struct default_engine *engine, hash_item *it) {
     size_t ntotal = ITEM_ntotal(engine, it);
     unsigned int clsid;
     cb_assert((it->iflag & ITEM_LINKED) == 0);
-    cb_assert(it != engine->items.heads[it->slabs_clsid]);
-    cb_assert(it != engine->items.tails[it->slabs_clsid]);
+    cb_assert(it != engine->items.heads[it->slabs_clsid][it->lru]);
+    cb_assert(it != engine->items.tails[it->slabs_clsid][it->lru]);
     cb_assert(it->refcount == 0 || engine->scrubber.force_delete);
 
     /* so slab size changer can tell later if item is already free or not */
@@ -253,10 +298,11 @@ static void item_free(struct default_engine *engine, hash_item *it) {
 static void item_link_q(struct default_engine *engine, hash_item *it) { /* item is the new head */
     hash_item **head, **tail;
     cb_assert(it->slabs_clsid < POWER_LARGEST);
+    cb_assert(it->lru < NUM_LRU);
     cb_assert((it->iflag & ITEM_SLABBED) == 0);
 
-    head = &engine->items.heads[it->slabs_clsid];
-    tail = &engine->items.tails[it->slabs_clsid];
+    head = &engine->items.heads[it->slabs_clsid][it->lru];
+    tail = &engine->items.tails[it->slabs_clsid][it->lru];
     cb_assert(it != *head);
     cb_assert((*head && *tail) || (*head == 0 && *tail == 0));
     it->prev = 0;
@@ -264,15 +310,16 @@ static void item_link_q(struct default_engine *engine, hash_item *it) { /* item
     if (it->next) it->next->prev = it;
     *head = it;
     if (*tail == 0) *tail = it;
-    engine->items.sizes[it->slabs_clsid]++;
+    engine->items.sizes[it->slabs_clsid][it->lru]++;
     return;
 }
 
 static void item_unlink_q(struct default_engine *engine, hash_item *it) {
     hash_item **head, **tail;
     cb_assert(it->slabs_clsid < POWER_LARGEST);
-    head = &engine->items.heads[it->slabs_clsid];
-    tail = &engine->items.tails[it->slabs_clsid];
+    cb_assert(it->lru < NUM_LRU);
+    head = &engine->items.heads[it->slabs_clsid][it->lru];
+    tail = &engine->items.tails[it->slabs_clsid][it->lru];
 
     if (*head == it) {
         cb_assert(it->prev == 0);
@@ -287,16 +334,27 @@ static void item_unlink_q(struct default_engine *engine, hash_item *it) {
 
     if (it->next) it->next->prev = it->prev;
     if (it->prev) it->prev->next = it->next;
-    engine->items.sizes[it->slabs_clsid]--;
+    engine->items.sizes[it->slabs_clsid][it->lru]--;
     return;
 }
 
+/* Move a linked item to the head of another segment of its LRU */
+static void item_lru_move(struct default_engine *engine,
+                          hash_item *it,
+                          uint8_t lru) {
+    item_unlink_q(engine, it);
+    it->iflag &= ~ITEM_ACTIVE;
+    it->lru = lru;
+    item_link_q(engine, it);
+}
+
 int do_item_link(struct default_engine *engine,
                  const void* cookie,
                  hash_item *it) {
     const hash_key* key = item_get_key(it);
     cb_assert((it->iflag & (ITEM_LINKED|ITEM_SLABBED)) == 0);
     it->iflag |= ITEM_LINKED;
+    it->lru = HOT_LRU;
     it->time = engine->server.core->get_current_time();
 
     assoc_insert(crc32c(hash_key_get_key(key), hash_key_get_key_len(key), 0),
@@ -332,10 +390,43 @@ int do_item_link(struct default_engine *engine,
     return 1;
 }
 
+/*
+ * Link an item which replaces another item for the same key *without*
+ * changing the document (a value moving between memory and the extstore);
+ * it keeps its CAS and we don't call pre_link.
+ */
+static void do_item_relink(struct default_engine *engine,
+                           hash_item *it,
+                           uint8_t lru) {
+    const hash_key* key = item_get_key(it);
+    cb_assert((it->iflag & (ITEM_LINKED|ITEM_SLABBED)) == 0);
+    it->iflag |= ITEM_LINKED;
+    it->lru = lru;
+
+    assoc_insert(crc32c(hash_key_get_key(key), hash_key_get_key_len(key), 0),
+                 it);
+
+    engine->stats.curr_bytes += ITEM_ntotal(engine, it);
+    engine->stats.curr_items += 1;
+    item_link_q(engine, it);
+}
+
+/* Release the space used in the extstore by the value of a header */
+static void do_item_ext_release(struct default_engine *engine,
+                                const hash_item *it) {
+    if ((it->iflag & ITEM_EXTSTORE) != 0 && engine->extstore) {
+        ext_location loc;
+        std::memcpy(&loc, item_get_data(it), sizeof(loc));
+        engine->extstore->release(
+                loc, hash_key_get_client_key_len(item_get_key(it)));
+    }
+}
+
 void do_item_unlink(struct default_engine *engine, hash_item *it) {
     const hash_key* key = item_get_key(it);
     if ((it->iflag & ITEM_LINKED) != 0) {
         it->iflag &= ~ITEM_LINKED;
+        do_item_ext_release(engine, it);
         engine->stats.curr_bytes -= ITEM_ntotal(engine, it);
         engine->stats.curr_items -= 1;
         assoc_delete(crc32c(hash_key_get_key(key), hash_key_get_key_len(key), 0),
@@ -362,6 +453,7 @@ ENGINE_ERROR_CODE do_safe_item_unlink(struct default_engine* engine,
     if (it->cas == stored->cas) {
         if ((stored->iflag & ITEM_LINKED) != 0) {
             stored->iflag &= ~ITEM_LINKED;
+            do_item_ext_release(engine, stored);
             engine->stats.curr_bytes -= ITEM_ntotal(engine, stored);
             engine->stats.curr_items -= 1;
             assoc_delete(crc32c(hash_key_get_key(key),
@@ -391,14 +483,19 @@ void do_item_release(struct default_engine *engine, hash_item *it) {
 }
 
 void do_item_update(struct default_engine *engine, hash_item *it) {
+    /*
+     * We don't touch the LRU links here; the item is moved to the WARM
+     * segment when the LRU maintainer (or the eviction) finds it at the
+     * tail of its segment with the active flag set.
+     */
     rel_time_t current_time = engine->server.core->get_current_time();
-    if (it->time < current_time - ITEM_UPDATE_INTERVAL) {
+    if ((it->iflag & ITEM_ACTIVE) == 0 ||
+        it->time < current_time - ITEM_UPDATE_INTERVAL) {
         cb_assert((it->iflag & ITEM_SLABBED) == 0);
 
         if ((it->iflag & ITEM_LINKED) != 0) {
-            item_unlink_q(engine, it);
+            it->iflag |= ITEM_ACTIVE;
             it->time = current_time;
-            item_link_q(engine, it);
         }
     }
 }
@@ -419,45 +516,64 @@ static void do_item_stats(struct default_engine* engine,
     int i;
     rel_time_t current_time = engine->server.core->get_current_time();
     for (i = 0; i < POWER_LARGEST; i++) {
-        if (engine->items.tails[i] != NULL) {
-            const char *prefix = "items";
+        const char *prefix = "items";
+        hash_item *oldest = NULL;
+        unsigned int total = 0;
+        for (int lru : lru_search_order) {
+            hash_item **tail = &engine->items.tails[i][lru];
             int search = search_items;
             while (search > 0 &&
-                   engine->items.tails[i] != NULL &&
+                   *tail != NULL &&
                    ((engine->config.oldest_live != 0 && /* Item flushd */
                      engine->config.oldest_live <= current_time &&
-                     engine->items.tails[i]->time <= engine->config.oldest_live) ||
-                    (engine->items.tails[i]->exptime != 0 && /* and not expired */
-                     engine->items.tails[i]->exptime < current_time))) {
+                     (*tail)->time <= engine->config.oldest_live) ||
+                    ((*tail)->exptime != 0 && /* and not expired */
+                     (*tail)->exptime < current_time))) {
                 --search;
-                if (engine->items.tails[i]->refcount == 0) {
-                    do_item_unlink(engine, engine->items.tails[i]);
+                if ((*tail)->refcount == 0) {
+                    do_item_unlink(engine, *tail);
                 } else {
                     break;
                 }
             }
-            if (engine->items.tails[i] == NULL) {
-                /* We removed all of the items in this slab class */
-                continue;
+            if (oldest == NULL) {
+                oldest = *tail;
             }
+            total += engine->items.sizes[i][lru];
+        }
 
-            add_statistics(c, add_stats, prefix, i, "number", "%u",
-                           engine->items.sizes[i]);
-            add_statistics(c, add_stats, prefix, i, "age", "%u",
-                           engine->items.tails[i]->time);
-            add_statistics(c, add_stats, prefix, i, "evicted",
-                           "%u", engine->items.itemstats[i].evicted);
-            add_statistics(c, add_stats, prefix, i, "evicted_nonzero",
-                           "%u", engine->items.itemstats[i].evicted_nonzero);
-            add_statistics(c, add_stats, prefix, i, "evicted_time",
-                           "%u", engine->items.itemstats[i].evicted_time);
-            add_statistics(c, add_stats, prefix, i, "outofmemory",
-                           "%u", engine->items.itemstats[i].outofmemory);
-            add_statistics(c, add_stats, prefix, i, "tailrepairs",
-                           "%u", engine->items.itemstats[i].tailrepairs);;
-            add_statistics(c, add_stats, prefix, i, "reclaimed",
-                           "%u", engine->items.itemstats[i].reclaimed);;
+        if (oldest == NULL) {
+            /* We removed all of the items in this slab class */
+            continue;
         }
+
+        add_statistics(c, add_stats, prefix, i, "number", "%u", total);
+        add_statistics(c, add_stats, prefix, i, "number_hot", "%u",
+                       engine->items.sizes[i][HOT_LRU]);
+        add_statistics(c, add_stats, prefix, i, "number_warm", "%u",
+                       engine->items.sizes[i][WARM_LRU]);
+        add_statistics(c, add_stats, prefix, i, "number_cold", "%u",
+                       engine->items.sizes[i][COLD_LRU]);
+        add_statistics(c, add_stats, prefix, i, "age", "%u",
+                       oldest->time);
+        add_statistics(c, add_stats, prefix, i, "evicted",
+                       "%u", engine->items.itemstats[i].evicted);
+        add_statistics(c, add_stats, prefix, i, "evicted_nonzero",
+                       "%u", engine->items.itemstats[i].evicted_nonzero);
+        add_statistics(c, add_stats, prefix, i, "evicted_time",
+                       "%u", engine->items.itemstats[i].evicted_time);
+        add_statistics(c, add_stats, prefix, i, "outofmemory",
+                       "%u", engine->items.itemstats[i].outofmemory);
+        add_statistics(c, add_stats, prefix, i, "tailrepairs",
+                       "%u", engine->items.itemstats[i].tailrepairs);;
+        add_statistics(c, add_stats, prefix, i, "reclaimed",
+                       "%u", engine->items.itemstats[i].reclaimed);;
+        add_statistics(c, add_stats, prefix, i, "moves_to_cold",
+                       "%u", engine->items.itemstats[i].moves_to_cold);
+        add_statistics(c, add_stats, prefix, i, "moves_to_warm",
+                       "%u", engine->items.itemstats[i].moves_to_warm);
+        add_statistics(c, add_stats, prefix, i, "moves_within_warm",
+                       "%u", engine->items.itemstats[i].moves_within_warm);
     }
 }
 
@@ -476,17 +592,19 @@ static void do_item_stats_sizes(struct default_engine* engine,
 
         /* build the histogram */
         for (i = 0; i < POWER_LARGEST; i++) {
-            hash_item *iter = engine->items.heads[i];
-            while (iter) {
-                size_t ntotal = ITEM_ntotal(engine, iter);
-                size_t bucket = ntotal / 32;
-                if ((ntotal % 32) != 0) {
-                    bucket++;
-                }
-                if (bucket < num_buckets) {
-                    histogram[bucket]++;
+            for (int lru = 0; lru < NUM_LRU; ++lru) {
+                hash_item *iter = engine->items.heads[i][lru];
+                while (iter) {
+                    size_t ntotal = ITEM_ntotal(engine, iter);
+                    size_t bucket = ntotal / 32;
+                    if ((ntotal % 32) != 0) {
+                        bucket++;
+                    }
+                    if (bucket < num_buckets) {
+                        histogram[bucket]++;
+                    }
+                    iter = iter->next;
                 }
-                iter = iter->next;
             }
         }
 
@@ -549,6 +667,29 @@ hash_item* do_item_get(struct default_engine* engine,
     return it;
 }
 
+/*
+ * If the item is a header for a value in the extstore, schedule a read of
+ * the value (the IO thread notifies the cookie once the item is back in
+ * memory) and release our reference to it.
+ */
+static bool do_item_ext_fetch(struct default_engine* engine,
+                              const void* cookie,
+                              hash_item* it) {
+    if (engine->extstore) {
+        /* The operation is being retried; drop the pin from the restore */
+        auto* pinned = engine->extstore->unpin(cookie);
+        if (pinned != nullptr) {
+            do_item_release(engine, pinned);
+        }
+    }
+    if ((it->iflag & ITEM_EXTSTORE) == 0) {
+        return false;
+    }
+    engine->extstore->read(cookie, *it);
+    do_item_release(engine, it);
+    return true;
+}
+
 /*
  * Stores an item in the cache according to the semantics of one of the set
  * commands. In threaded mode, this is protected by the cache lock.
@@ -704,6 +845,16 @@ ENGINE_ERROR_CODE safe_item_unlink(struct default_engine *engine,
 /*
  * Stores an item in the cache (high level, obeys set/add/replace semantics)
  */
+bool item_ext_fetch(struct default_engine* engine,
+                    const void* cookie,
+                    hash_item* it) {
+    if (!engine->extstore) {
+        return false;
+    }
+    std::lock_guard<std::mutex> guard(engine->items.lock);
+    return do_item_ext_fetch(engine, cookie, it);
+}
+
 ENGINE_ERROR_CODE store_item(struct default_engine *engine,
                              hash_item *item, uint64_t *cas,
                              ENGINE_STORE_OPERATION operation,
@@ -735,6 +886,10 @@ ENGINE_ERROR_CODE do_item_get_locked(struct default_engine* engine,
         return ENGINE_KEY_ENOENT;
     }
 
+    if (do_item_ext_fetch(engine, cookie, item)) {
+        return ENGINE_EWOULDBLOCK;
+    }
+
     if (item->locktime != 0 &&
         item->locktime > engine->server.core->get_current_time()) {
         do_item_release(engine, item);
@@ -851,6 +1006,10 @@ static ENGINE_ERROR_CODE do_item_unlock(struct default_engine* engine,
         return ENGINE_KEY_ENOENT;
     }
 
+    if (do_item_ext_fetch(engine, cookie, item)) {
+        return ENGINE_EWOULDBLOCK;
+    }
+
     if (item->cas != cas) {
         // Invalid CAS value
         auto ret = ENGINE_KEY_EEXISTS;
@@ -922,6 +1081,10 @@ ENGINE_ERROR_CODE do_item_get_and_touch(struct default_engine* engine,
         return ENGINE_KEY_ENOENT;
     }
 
+    if (do_item_ext_fetch(engine, cookie, item)) {
+        return ENGINE_EWOULDBLOCK;
+    }
+
     if (item->locktime != 0 &&
         item->locktime > engine->server.core->get_current_time()) {
         do_item_release(engine, item);
@@ -1002,23 +1165,22 @@ void item_flush_expired(struct default_engine *engine) {
     }
 
     for (int ii = 0; ii < POWER_LARGEST; ii++) {
-        hash_item *iter, *next;
-        /*
-         * The LRU is sorted in decreasing time order, and an item's
-         * timestamp is never newer than its last access time, so we
-         * only need to walk back until we hit an item older than the
-         * oldest_live time.
-         * The oldest_live checking will auto-expire the remaining items.
-         */
-        for (iter = engine->items.heads[ii]; iter != NULL; iter = next) {
-            if (iter->time >= engine->config.oldest_live) {
+        for (int lru = 0; lru < NUM_LRU; ++lru) {
+            hash_item *iter, *next;
+            /*
+             * The items move between the segments of the LRU (and an
+             * access updates the time without moving the item) so the
+             * segments aren't sorted by time; we need to look at all of
+             * them.
+             * The oldest_live checking will auto-expire the remaining items.
+             */
+            for (iter = engine->items.heads[ii][lru]; iter != NULL;
+                 iter = next) {
                 next = iter->next;
-                if ((iter->iflag & ITEM_SLABBED) == 0) {
+                if (iter->time >= engine->config.oldest_live &&
+                    (iter->iflag & ITEM_SLABBED) == 0) {
                     do_item_unlink(engine, iter);
                 }
-            } else {
-                /* We've hit the first old item. Continue to the next queue. */
-                break;
             }
         }
     }
@@ -1039,14 +1201,15 @@ void item_stats_sizes(struct default_engine* engine,
 }
 
 static void do_item_link_cursor(struct default_engine *engine,
-                                hash_item *cursor, int ii)
+                                hash_item *cursor, int ii, int lru)
 {
     cursor->slabs_clsid = (uint8_t)ii;
+    cursor->lru = (uint8_t)lru;
     cursor->next = NULL;
-    cursor->prev = engine->items.tails[ii];
-    engine->items.tails[ii]->next = cursor;
-    engine->items.tails[ii] = cursor;
-    engine->items.sizes[ii]++;
+    cursor->prev = engine->items.tails[ii][lru];
+    engine->items.tails[ii][lru]->next = cursor;
+    engine->items.tails[ii][lru] = cursor;
+    engine->items.sizes[ii][lru]++;
 }
 
 typedef ENGINE_ERROR_CODE (*ITERFUNC)(struct default_engine *engine,
@@ -1055,6 +1218,7 @@ typedef ENGINE_ERROR_CODE (*ITERFUNC)(struct default_engine *engine,
 static bool do_item_walk_cursor(struct default_engine *engine,
                                 hash_item *cursor,
                                 int steplength,
+                                std::chrono::steady_clock::time_point deadline,
                                 ITERFUNC itemfunc,
                                 void* itemdata,
                                 ENGINE_ERROR_CODE *error)
@@ -1062,7 +1226,8 @@ static bool do_item_walk_cursor(struct default_engine *engine,
     int ii = 0;
     *error = ENGINE_SUCCESS;
 
-    while (cursor->prev != NULL && ii < steplength) {
+    while (cursor->prev != NULL && ii < steplength &&
+           (ii == 0 || std::chrono::steady_clock::now() < deadline)) {
         /* Move cursor */
         hash_item *ptr = cursor->prev;
         bool done = false;
@@ -1070,7 +1235,7 @@ static bool do_item_walk_cursor(struct default_engine *engine,
         ++ii;
         item_unlink_q(engine, cursor);
 
-        if (ptr == engine->items.heads[cursor->slabs_clsid]) {
+        if (ptr == engine->items.heads[cursor->slabs_clsid][cursor->lru]) {
             done = true;
             cursor->prev = NULL;
         } else {
@@ -1123,17 +1288,44 @@ static ENGINE_ERROR_CODE item_scrub(struct default_engine *engine,
     return ENGINE_SUCCESS;
 }
 
+/*
+ * Scrub the list the cursor is linked into. We release the cache lock
+ * after at most 200 items or scrub_slice_us (whatever comes first) so we
+ * don't block the front end threads, and if scrub_rate is set (and we're
+ * not deleting the bucket) we sleep between the slices to keep the scrub
+ * at the requested number of items per second.
+ */
 static void item_scrub_class(struct default_engine *engine,
                              hash_item *cursor) {
+    const auto slice = std::chrono::microseconds(engine->config.scrub_slice_us);
+    const uint64_t rate =
+            engine->scrubber.force_delete ? 0 : engine->config.scrub_rate;
 
     ENGINE_ERROR_CODE ret;
     bool more;
     do {
-        std::lock_guard<std::mutex> guard(engine->items.lock);
-        more = do_item_walk_cursor(engine, cursor, 200, item_scrub, NULL, &ret);
+        const auto start = std::chrono::steady_clock::now();
+        const uint64_t visited = engine->scrubber.visited;
+        {
+            std::lock_guard<std::mutex> guard(engine->items.lock);
+            more = do_item_walk_cursor(
+                    engine, cursor, 200, start + slice, item_scrub, NULL, &ret);
+        }
+        engine->scrubber.slices++;
         if (ret != ENGINE_SUCCESS) {
             break;
         }
+
+        if (more && rate != 0) {
+            const auto budget = std::chrono::microseconds(
+                    (engine->scrubber.visited - visited) * 1000000 / rate);
+            const auto spent = std::chrono::steady_clock::now() - start;
+            if (budget > spent) {
+                std::this_thread::sleep_for(budget - spent);
+            }
+        } else if (more) {
+            std::this_thread::yield();
+        }
     } while (more);
 }
 
@@ -1144,20 +1336,26 @@ void item_scrubber_main(struct default_engine *engine)
 
     memset(&cursor, 0, sizeof(cursor));
     cursor.refcount = 1;
+    {
+        std::lock_guard<std::mutex> guard(engine->scrubber.lock);
+        engine->scrubber.total = engine->stats.curr_items;
+    }
     for (ii = 0; ii < POWER_LARGEST; ++ii) {
-        bool skip = false;
-        {
-            std::lock_guard<std::mutex> guard(engine->items.lock);
-            if (engine->items.heads[ii] == NULL) {
-                skip = true;
-            } else {
-                /* add the item at the tail */
-                do_item_link_cursor(engine, &cursor, ii);
+        for (int lru = 0; lru < NUM_LRU; ++lru) {
+            bool skip = false;
+            {
+                std::lock_guard<std::mutex> guard(engine->items.lock);
+                if (engine->items.heads[ii][lru] == NULL) {
+                    skip = true;
+                } else {
+                    /* add the item at the tail */
+                    do_item_link_cursor(engine, &cursor, ii, lru);
+                }
             }
-        }
 
-        if (!skip) {
-            item_scrub_class(engine, &cursor);
+            if (!skip) {
+                item_scrub_class(engine, &cursor);
+            }
         }
     }
 
@@ -1166,6 +1364,352 @@ void item_scrubber_main(struct default_engine *engine)
     engine->scrubber.running = false;
 }
 
+/*
+ * Walk (at most search_items * 10 items) from the tail of the given
+ * segment of the LRU and move the items according to their state:
+ *
+ *   HOT:  while it holds more than limit items, move the tail to WARM if
+ *         it was accessed or COLD otherwise
+ *   WARM: while it holds more than limit items, move the tail back to the
+ *         head of WARM if it was accessed or to COLD otherwise
+ *   COLD: move the items which were accessed to WARM
+ *
+ * Expired items found along the way are reclaimed.
+ */
+static int do_item_lru_pull_tail(struct default_engine *engine,
+                                 unsigned int id,
+                                 int lru,
+                                 unsigned int limit,
+                                 rel_time_t current_time) {
+    int moved = 0;
+    int tries = search_items * 10;
+    hash_item *search, *prev;
+    for (search = engine->items.tails[id][lru];
+         tries > 0 && search != NULL;
+         tries--, search = prev) {
+        prev = search->prev;
+        if (lru != COLD_LRU && engine->items.sizes[id][lru] <= limit) {
+            break;
+        }
+        if ((search->iflag & ITEM_LINKED) == 0) {
+            /* A scrubber cursor */
+            continue;
+        }
+
+        if (search->refcount == 0 && search->exptime != 0 &&
+            search->exptime < current_time &&
+            search->locktime <= current_time) {
+            engine->items.itemstats[id].reclaimed++;
+            engine->stats.reclaimed++;
+            do_item_unlink(engine, search);
+            ++moved;
+            continue;
+        }
+
+        const bool active = (search->iflag & ITEM_ACTIVE) != 0;
+        switch (lru) {
+        case HOT_LRU:
+            if (active) {
+                item_lru_move(engine, search, WARM_LRU);
+                engine->items.itemstats[id].moves_to_warm++;
+            } else {
+                item_lru_move(engine, search, COLD_LRU);
+                engine->items.itemstats[id].moves_to_cold++;
+            }
+            ++moved;
+            break;
+        case WARM_LRU:
+            if (active) {
+                item_lru_move(engine, search, WARM_LRU);
+                engine->items.itemstats[id].moves_within_warm++;
+            } else {
+                item_lru_move(engine, search, COLD_LRU);
+                engine->items.itemstats[id].moves_to_cold++;
+            }
+            ++moved;
+            break;
+        case COLD_LRU:
+            if (active) {
+                item_lru_move(engine, search, WARM_LRU);
+                engine->items.itemstats[id].moves_to_warm++;
+                ++moved;
+            }
+            break;
+        }
+    }
+    return moved;
+}
+
+/*
+ * Write the values of the items at the tail of COLD to the extstore, and
+ * replace the items with a header referring to the value. We write the
+ * items which haven't been accessed in ext_item_age seconds, or any of
+ * them if the slab class has started to evict items.
+ */
+static int do_item_ext_write_cold(struct default_engine *engine,
+                                  unsigned int id,
+                                  rel_time_t current_time) {
+    const unsigned int evicted = engine->items.itemstats[id].evicted;
+    const bool pressure = evicted != engine->items.ext_evicted_seen[id];
+    engine->items.ext_evicted_seen[id] = evicted;
+
+    /*
+     * Pin the candidates first; allocating the header may evict items from
+     * the tail of the LRU we're walking
+     */
+    hash_item* candidates[search_items];
+    int count = 0;
+    int tries = search_items;
+    for (hash_item* search = engine->items.tails[id][COLD_LRU];
+         tries > 0 && search != NULL;
+         tries--, search = search->prev) {
+        const uint8_t iflag = search->iflag;
+        if ((iflag & (ITEM_LINKED | ITEM_ZOMBIE | ITEM_ACTIVE |
+                      ITEM_EXTSTORE)) != ITEM_LINKED ||
+            search->refcount != 0 || search->locktime > current_time ||
+            (search->exptime != 0 && search->exptime <= current_time) ||
+            search->nbytes < engine->config.ext_item_size ||
+            ExtStore::getRecordSize(
+                    hash_key_get_client_key_len(item_get_key(search)),
+                    search->nbytes) > ExtStore::bufferSize) {
+            continue;
+        }
+        if (!pressure &&
+            search->time + engine->config.ext_item_age > current_time) {
+            continue;
+        }
+        search->refcount++;
+        candidates[count++] = search;
+    }
+
+    int written = 0;
+    bool full = false;
+    for (int ii = 0; ii < count; ++ii) {
+        hash_item* it = candidates[ii];
+        ext_location loc;
+        if (full || (it->iflag & ITEM_LINKED) == 0) {
+            /* No room in the extstore, or it went away while pinned */
+        } else if (!engine->extstore->write(*it, loc)) {
+            full = true;
+        } else {
+            auto* header = do_item_alloc(engine,
+                                         item_get_key(it),
+                                         it->flags,
+                                         it->exptime,
+                                         sizeof(loc),
+                                         nullptr,
+                                         it->datatype);
+            if (header == nullptr) {
+                engine->extstore->release(
+                        loc, hash_key_get_client_key_len(item_get_key(it)));
+            } else {
+                std::memcpy(item_get_data(header), &loc, sizeof(loc));
+                header->cas = it->cas;
+                header->time = it->time;
+                header->locktime = it->locktime;
+                header->iflag |= ITEM_EXTSTORE;
+                do_item_unlink(engine, it);
+                do_item_relink(engine, header, COLD_LRU);
+                do_item_release(engine, header);
+                ++written;
+            }
+        }
+        do_item_release(engine, it);
+    }
+    return written;
+}
+
+/* Does the item (still) refer to the value at the location? */
+static bool item_ext_refers(const hash_item* it,
+                            uint64_t cas,
+                            const ext_location& loc) {
+    if (it == nullptr || (it->iflag & ITEM_EXTSTORE) == 0 || it->cas != cas) {
+        return false;
+    }
+    ext_location current;
+    std::memcpy(&current, item_get_data(it), sizeof(current));
+    return current.page == loc.page && current.version == loc.version &&
+           current.offset == loc.offset;
+}
+
+ENGINE_ERROR_CODE item_ext_restore(struct default_engine* engine,
+                                   const void* cookie,
+                                   const void* key,
+                                   size_t nkey,
+                                   uint64_t cas,
+                                   const ext_location& loc,
+                                   const void* value) {
+    hash_key hkey;
+    if (!hash_key_create(&hkey, key, nkey, engine, nullptr)) {
+        return ENGINE_TMPFAIL;
+    }
+
+    ENGINE_ERROR_CODE ret = ENGINE_SUCCESS;
+    {
+        std::lock_guard<std::mutex> guard(engine->items.lock);
+        auto* it = assoc_find(
+                crc32c(hash_key_get_key(&hkey), hash_key_get_key_len(&hkey), 0),
+                &hkey);
+        if (!item_ext_refers(it, cas, loc)) {
+            /* It has been replaced (or deleted) since */
+        } else if (value == nullptr) {
+            do_item_unlink(engine, it);
+        } else {
+            /* Pin the header so that the allocation can't evict it */
+            it->refcount++;
+            auto* restored = do_item_alloc(engine,
+                                           &hkey,
+                                           it->flags,
+                                           it->exptime,
+                                           loc.nbytes,
+                                           nullptr,
+                                           it->datatype);
+            if (restored == nullptr) {
+                ret = ENGINE_TMPFAIL;
+            } else {
+                std::memcpy(item_get_data(restored), value, loc.nbytes);
+                restored->cas = it->cas;
+                restored->locktime = it->locktime;
+                do_item_unlink(engine, it);
+                do_item_relink(engine, restored, WARM_LRU);
+                restored->time = engine->server.core->get_current_time();
+                /*
+                 * Keep our reference until the operation is retried so
+                 * that the LRU maintainer can't write it out again first
+                 */
+                auto* previous = engine->extstore->pin(cookie, restored);
+                if (previous != nullptr) {
+                    do_item_release(engine, previous);
+                }
+            }
+            do_item_release(engine, it);
+        }
+    }
+    hash_key_destroy(&hkey);
+    return ret;
+}
+
+ENGINE_ERROR_CODE item_ext_relocate(struct default_engine* engine,
+                                    const void* key,
+                                    size_t nkey,
+                                    uint64_t cas,
+                                    const ext_location& loc,
+                                    const void* value) {
+    hash_key hkey;
+    if (!hash_key_create(&hkey, key, nkey, engine, nullptr)) {
+        return ENGINE_TMPFAIL;
+    }
+
+    ENGINE_ERROR_CODE ret = ENGINE_KEY_ENOENT;
+    {
+        std::lock_guard<std::mutex> guard(engine->items.lock);
+        auto* it = assoc_find(
+                crc32c(hash_key_get_key(&hkey), hash_key_get_key_len(&hkey), 0),
+                &hkey);
+        if (item_ext_refers(it, cas, loc)) {
+            ext_location next;
+            if (engine->extstore->write(cas, key, nkey, value, loc.nbytes,
+                                        next)) {
+                engine->extstore->release(loc, nkey);
+                std::memcpy(item_get_data(it), &next, sizeof(next));
+                ret = ENGINE_SUCCESS;
+            } else {
+                ret = ENGINE_TMPFAIL;
+            }
+        }
+    }
+    hash_key_destroy(&hkey);
+    return ret;
+}
+
+int item_lru_maintain(struct default_engine *engine) {
+    int moved = 0;
+    for (unsigned int id = 0; id < POWER_LARGEST; ++id) {
+        std::lock_guard<std::mutex> guard(engine->items.lock);
+        const unsigned int total = engine->items.sizes[id][HOT_LRU] +
+                                   engine->items.sizes[id][WARM_LRU] +
+                                   engine->items.sizes[id][COLD_LRU];
+        if (total == 0) {
+            continue;
+        }
+
+        const rel_time_t current_time =
+                engine->server.core->get_current_time();
+        moved += do_item_lru_pull_tail(
+                engine,
+                id,
+                HOT_LRU,
+                unsigned(total * engine->config.hot_lru_pct / 100),
+                current_time);
+        moved += do_item_lru_pull_tail(
+                engine,
+                id,
+                WARM_LRU,
+                unsigned(total * engine->config.warm_lru_pct / 100),
+                current_time);
+        moved += do_item_lru_pull_tail(engine, id, COLD_LRU, 0, current_time);
+        if (engine->extstore) {
+            moved += do_item_ext_write_cold(engine, id, current_time);
+        }
+    }
+    return moved;
+}
+
+void item_slabs_automove(struct default_engine *engine) {
+    std::lock_guard<std::mutex> guard(engine->items.lock);
+    unsigned int evicted[MAX_NUMBER_OF_SLAB_CLASSES] = {0};
+    for (int ii = 0; ii < POWER_LARGEST; ++ii) {
+        evicted[ii] = engine->items.itemstats[ii].evicted;
+    }
+
+    unsigned int src;
+    unsigned int dst;
+    struct slab_page page;
+    if (!slabs_automove_decide(engine, evicted, &src, &dst) ||
+        !slabs_automove_page(engine, src, &page)) {
+        return;
+    }
+
+    /*
+     * We can only move the page if all of the items in it may be evicted
+     * (no one holds a reference to them and they're not locked). Check
+     * them all before evicting anything; we'll try another page the next
+     * time around.
+     */
+    const rel_time_t current_time = engine->server.core->get_current_time();
+    for (unsigned int ii = 0; ii < page.perslab; ++ii) {
+        auto* it = reinterpret_cast<hash_item*>(
+                static_cast<char*>(page.ptr) + (size_t)ii * page.size);
+        if ((it->iflag & ITEM_SLABBED) || it->slabs_clsid == 0) {
+            /* free (or never used) */
+            continue;
+        }
+        if ((it->iflag & ITEM_LINKED) == 0 || it->refcount != 0 ||
+            it->locktime > current_time) {
+            return;
+        }
+    }
+
+    unsigned int count = 0;
+    for (unsigned int ii = 0; ii < page.perslab; ++ii) {
+        auto* it = reinterpret_cast<hash_item*>(
+                static_cast<char*>(page.ptr) + (size_t)ii * page.size);
+        if ((it->iflag & ITEM_SLABBED) == 0 && it->slabs_clsid != 0) {
+            do_item_unlink(engine, it);
+            ++count;
+        }
+    }
+
+    if (slabs_reassign_page(engine, &page, src, dst, count)) {
+        LOG_INFO("Bucket ({}) moved a slab page from class {} to {} "
+                 "(evicted {} items)",
+                 engine->bucket_id,
+                 src,
+                 dst,
+                 count);
+    }
+}
+
 bool item_start_scrub(struct default_engine *engine)
 {
     std::lock_guard<std::mutex> guard(engine->scrubber.lock);
@@ -60,7 +60,10 @@ typedef struct _hash_item {
     /** to identify the type of the data */
     uint8_t datatype;
 
-    // There is 3 spare bytes due to alignment
+    /** which segment of the LRU (HOT_LRU, WARM_LRU or COLD_LRU) we're in */
+    uint8_t lru;
+
+    // There is 2 spare bytes due to alignment
 } hash_item;
 
 /*
@@ -138,6 +141,18 @@ static inline size_t hash_key_get_alloc_size(const hash_key* key) {
     return offsetof(hash_key, key_storage) + hash_key_get_key_len(key);
 }
 
+/*
+ * The items in each slab class are kept in a segmented LRU. New items are
+ * linked into the HOT segment, and the LRU maintainer moves them from the
+ * tail of HOT to WARM (if they've been accessed) or COLD. Accessing an item
+ * only sets ITEM_ACTIVE; the item is moved to WARM when it reaches the tail
+ * of COLD, so a get doesn't touch the links. Items are evicted from COLD.
+ */
+#define HOT_LRU 0
+#define WARM_LRU 1
+#define COLD_LRU 2
+#define NUM_LRU 3
+
 typedef struct {
     unsigned int evicted;
     unsigned int evicted_nonzero;
@@ -145,13 +160,18 @@ typedef struct {
     unsigned int outofmemory;
     unsigned int tailrepairs;
     unsigned int reclaimed;
+    unsigned int moves_to_cold;
+    unsigned int moves_to_warm;
+    unsigned int moves_within_warm;
 } itemstats_t;
 
 struct items {
-   hash_item *heads[POWER_LARGEST];
-   hash_item *tails[POWER_LARGEST];
+   hash_item *heads[POWER_LARGEST][NUM_LRU];
+   hash_item *tails[POWER_LARGEST][NUM_LRU];
    itemstats_t itemstats[POWER_LARGEST];
-   unsigned int sizes[POWER_LARGEST];
+   unsigned int sizes[POWER_LARGEST][NUM_LRU];
+   /* the evicted counters when the values were last written to the extstore */
+   unsigned int ext_evicted_seen[POWER_LARGEST];
    /*
     * serialise access to the items data
    */
@@ -257,6 +277,20 @@ ENGINE_ERROR_CODE item_unlock(struct default_engine* engine,
                               const size_t nkey,
                               uint64_t cas);
 
+/**
+ * If the item is a header for a value in the extstore, schedule a read of
+ * the value and release the item. The cookie is notified once the item is
+ * back in memory (and the operation should be retried).
+ *
+ * @param engine handle to the storage engine
+ * @param cookie connection cookie
+ * @param it the item returned by item_get
+ * @return true if the item was a header (and has been released)
+ */
+bool item_ext_fetch(struct default_engine* engine,
+                    const void* cookie,
+                    hash_item* it);
+
 /**
  * Reset the item statistics
  * @param engine handle to the storage engine
@@ -345,6 +379,27 @@ ENGINE_ERROR_CODE store_item(struct default_engine *engine,
  */
 void item_scrubber_main(struct default_engine *engine);
 
+/**
+ * Run the LRU maintainer on the engine; move items from the tail of the
+ * HOT and WARM segments to keep them within their configured size, and
+ * the accessed items at the tail of COLD to WARM. Called periodically
+ * from the LRU maintainer thread.
+ *
+ * @param engine handle to the storage engine
+ * @return the number of items moved (or reclaimed)
+ */
+int item_lru_maintain(struct default_engine *engine);
+
+/**
+ * Run the slab_automove policy; move a page of memory from a slab class
+ * without evictions to the class with the most evictions if the policy
+ * says so (evicting the items in the page). Called periodically from
+ * the scrubber thread.
+ *
+ * @param engine handle to the storage engine
+ */
+void item_slabs_automove(struct default_engine *engine);
+
 /**
  * Start the item scrubber for the engine
  * @param engine handle to the storage engine
@@ -0,0 +1,76 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "lru_maintainer_task.h"
+
+#include "engine_manager.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+/// The shortest and longest time we'll sleep between the runs
+static const std::chrono::microseconds minSleep{1000};
+static const std::chrono::microseconds maxSleep{1000000};
+
+static void lru_maintainer_task_main(void* arg) {
+    auto* task = reinterpret_cast<LruMaintainerTask*>(arg);
+    task->run();
+}
+
+LruMaintainerTask::LruMaintainerTask(EngineManager& manager)
+    : shuttingdown(false), joined(false), engineManager(manager) {
+    std::unique_lock<std::mutex> lck(lock);
+    if (cb_create_named_thread(&maintainerThread,
+                               &lru_maintainer_task_main,
+                               this,
+                               0,
+                               "mc:lru_maint") != 0) {
+        throw std::runtime_error("Error creating 'mc:lru_maint' thread");
+    }
+}
+
+void LruMaintainerTask::shutdown() {
+    {
+        std::lock_guard<std::mutex> lck(lock);
+        if (joined) {
+            return;
+        }
+        shuttingdown = true;
+        joined = true;
+        cvar.notify_one();
+    }
+    cb_join_thread(maintainerThread);
+}
+
+void LruMaintainerTask::run() {
+    auto sleepTime = minSleep;
+    std::unique_lock<std::mutex> lck(lock);
+    while (!shuttingdown) {
+        lck.unlock();
+        const bool moved = engineManager.maintainLru();
+        lck.lock();
+
+        if (moved) {
+            sleepTime = minSleep;
+        } else {
+            sleepTime = std::min(sleepTime * 2, maxSleep);
+        }
+        if (!shuttingdown) {
+            cvar.wait_for(lck, sleepTime);
+        }
+    }
+}
@@ -0,0 +1,71 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <platform/platform_thread.h>
+
+#include <condition_variable>
+#include <mutex>
+
+class EngineManager;
+
+/**
+ * The LRU maintainer task moves the items between the segments of the
+ * LRU of all of the engines (see item_lru_maintain) so that the front end
+ * threads don't need to relink the items as they're being accessed.
+ *
+ * The task runs in a loop; it runs again right away as long as it finds
+ * items to move, and backs off (up to a second) when there is nothing to
+ * do.
+ */
+class LruMaintainerTask {
+public:
+    LruMaintainerTask(EngineManager& manager);
+
+    /**
+     * Stop the task and join the thread running it (it is safe to call
+     * this multiple times)
+     */
+    void shutdown();
+
+    /**
+     * Task's run loop method. This is not a public function and should only
+     * be called from the tasks constructor.
+     */
+    void run();
+
+private:
+    /** Is the task being requested to shut down? */
+    bool shuttingdown;
+
+    /** Has the thread been joined? */
+    bool joined;
+
+    /** The manager owning us */
+    EngineManager& engineManager;
+
+    /** All internal state is protected by this mutex */
+    std::mutex lock;
+
+    /** Used to wake the task when it is asked to shut down */
+    std::condition_variable cvar;
+
+    /**
+     * The identifier to the thread handle
+     */
+    cb_thread_t maintainerThread;
+};
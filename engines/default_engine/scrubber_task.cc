@@ -19,6 +19,11 @@
 #include "default_engine_internal.h"
 #include "engine_manager.h"
 
+#include <chrono>
+
+/// How often we run the slab_automove policy
+static const std::chrono::seconds automoveInterval{10};
+
 static void scrubber_task_main(void* arg) {
     ScrubberTask* task = reinterpret_cast<ScrubberTask*>(arg);
     task->run();
@@ -72,7 +77,14 @@ void ScrubberTask::run() {
             lck.lock();
         } else {
             state = State::Idle;
-            cvar.wait(lck);
+            if (cvar.wait_for(lck, automoveInterval) ==
+                        std::cv_status::timeout &&
+                !shuttingdown && workQueue.empty()) {
+                state = State::Rebalancing;
+                lck.unlock();
+                engineManager.automoveSlabs();
+                lck.lock();
+            }
         }
     }
     state = State::Stopped;
@@ -28,6 +28,7 @@ class EngineManager;
  * The scrubber task is charged with
  *   1. removing items from memory
  *   2. deleting engine structs
+ *   3. periodically running the slab_automove policy on the engines
  *
  * The common use-case is for bucket deletion performing tasks 1 and 2.
  * The start_scrub command only performs 1.
@@ -77,6 +78,8 @@ private:
         Idle,
         /// The scrubber is currently scrubbing a list
         Scrubbing,
+        /// The scrubber is running slab_automove on the engines
+        Rebalancing,
         /// The scrubber task is stopped (returning from main)
         Stopped
     };
@@ -24,6 +24,12 @@
 
 #include "default_engine_internal.h"
 
+/*
+ * The number of windows in a row a class must have had the most evictions
+ * (and the class we take the page from no evictions) before we move a page
+ */
+static const unsigned int automove_windows = 3;
+
 /*
  * Forward Declarations
  */
@@ -130,6 +136,10 @@ ENGINE_ERROR_CODE slabs_init(struct default_engine *engine,
 
     }
 
+#ifndef USE_SYSTEM_MALLOC
+    engine->slabs.automove.enabled = engine->config.slab_automove;
+#endif
+
 #ifndef DONT_PREALLOC_SLABS
     {
         char *pre_alloc = getenv("T_MEMD_SLABS_ALLOC");
@@ -178,7 +188,9 @@ static int grow_slab_list (struct default_engine *engine, const unsigned int id)
 
 static int do_slabs_newslab(struct default_engine *engine, const unsigned int id) {
     slabclass_t *p = &engine->slabs.slabclass[id];
-    int len = p->size * p->perslab;
+    /* All pages must be the same size if we're going to move them around */
+    int len = engine->slabs.automove.enabled ?
+            (int)engine->config.item_size_max : p->size * p->perslab;
     char *ptr;
 
     if ((engine->slabs.mem_limit && engine->slabs.mem_malloced + len > engine->slabs.mem_limit && p->slabs > 0) ||
@@ -366,6 +378,12 @@ static void do_slabs_stats(struct default_engine* engine,
     add_statistics(cookie, add_stats, NULL, -1, "active_slabs", "%d", total);
     add_statistics(cookie, add_stats, NULL, -1, "total_malloced", "%" PRIu64,
                    (uint64_t)engine->slabs.mem_malloced);
+    if (engine->slabs.automove.enabled) {
+        add_statistics(cookie, add_stats, NULL, -1, "slabs_moved",
+                       "%" PRIu64, engine->slabs.automove.pages_moved);
+        add_statistics(cookie, add_stats, NULL, -1, "slab_reassign_evicted",
+                       "%" PRIu64, engine->slabs.automove.items_evicted);
+    }
 }
 
 static void *memory_allocate(struct default_engine *engine, size_t size) {
@@ -428,6 +446,126 @@ void slabs_adjust_mem_requested(struct default_engine *engine, unsigned int id,
     p->requested = p->requested - old + ntotal;
 }
 
+bool slabs_automove_decide(struct default_engine *engine,
+                           const unsigned int *evicted,
+                           unsigned int *src,
+                           unsigned int *dst) {
+    std::lock_guard<std::mutex> guard(engine->slabs.lock);
+    auto& am = engine->slabs.automove;
+    unsigned int highest = 0;
+    unsigned int highest_evicted = 0;
+    unsigned int idle = 0;
+
+    for (unsigned int ii = POWER_SMALLEST; ii <= engine->slabs.power_largest;
+         ++ii) {
+        /* The counters are zeroed by "stats reset" */
+        unsigned int delta = evicted[ii] >= am.evicted[ii] ?
+                evicted[ii] - am.evicted[ii] : evicted[ii];
+        am.evicted[ii] = evicted[ii];
+
+        if (delta == 0 && engine->slabs.slabclass[ii].slabs > 2) {
+            ++am.idle_windows[ii];
+        } else {
+            am.idle_windows[ii] = 0;
+        }
+
+        if (delta > highest_evicted) {
+            highest_evicted = delta;
+            highest = ii;
+        }
+
+        if (idle == 0 && am.idle_windows[ii] >= automove_windows) {
+            idle = ii;
+        }
+    }
+
+    if (highest != 0 && highest == am.winner) {
+        ++am.winner_windows;
+    } else {
+        am.winner = highest;
+        am.winner_windows = (highest != 0) ? 1 : 0;
+    }
+
+    if (am.winner_windows < automove_windows || idle == 0 ||
+        idle == highest ||
+        /* it still got free space at the end of its last page */
+        engine->slabs.slabclass[highest].end_page_ptr != NULL) {
+        return false;
+    }
+
+    /* Give the receiving class time to settle before moving another page */
+    am.winner_windows = 0;
+    am.idle_windows[idle] = 0;
+    *src = idle;
+    *dst = highest;
+    return true;
+}
+
+bool slabs_automove_page(struct default_engine *engine,
+                         unsigned int id,
+                         struct slab_page *page) {
+    std::lock_guard<std::mutex> guard(engine->slabs.lock);
+    slabclass_t *p = &engine->slabs.slabclass[id];
+    if (p->slabs < 2) {
+        return false;
+    }
+
+    /* Rotate so that a single busy item doesn't keep us from moving any */
+    page->ptr = p->slab_list[engine->slabs.automove.next_page++ % p->slabs];
+    page->size = p->size;
+    page->perslab = p->perslab;
+    return true;
+}
+
+bool slabs_reassign_page(struct default_engine *engine,
+                         const struct slab_page *page,
+                         unsigned int src,
+                         unsigned int dst,
+                         unsigned int evicted) {
+    std::lock_guard<std::mutex> guard(engine->slabs.lock);
+    slabclass_t *s = &engine->slabs.slabclass[src];
+    slabclass_t *d = &engine->slabs.slabclass[dst];
+    char *start = static_cast<char*>(page->ptr);
+    char *end = start + (size_t)s->size * s->perslab;
+    unsigned int ii;
+
+    if (d->end_page_ptr != NULL || grow_slab_list(engine, dst) == 0) {
+        return false;
+    }
+
+    for (ii = 0; ii < s->slabs && s->slab_list[ii] != page->ptr; ++ii) {
+    }
+    if (ii == s->slabs) {
+        return false;
+    }
+    s->slab_list[ii] = s->slab_list[--s->slabs];
+
+    /* Drop the chunks in the page from the free list */
+    unsigned int kept = 0;
+    for (ii = 0; ii < s->sl_curr; ++ii) {
+        char *slot = static_cast<char*>(s->slots[ii]);
+        if (slot < start || slot >= end) {
+            s->slots[kept++] = slot;
+        }
+    }
+    s->sl_curr = kept;
+
+    if (s->end_page_ptr >= (void*)start && s->end_page_ptr < (void*)end) {
+        s->end_page_ptr = 0;
+        s->end_page_free = 0;
+    }
+
+    /* and carve it up for the new class */
+    memset(page->ptr, 0, engine->config.item_size_max);
+    d->slab_list[d->slabs++] = page->ptr;
+    d->end_page_ptr = page->ptr;
+    d->end_page_free = d->perslab;
+
+    engine->slabs.automove.pages_moved++;
+    engine->slabs.automove.items_evicted += evicted;
+    return true;
+}
+
 void slabs_destroy(struct default_engine *e)
 {
     /* Release the allocated backing store */
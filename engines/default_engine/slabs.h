@@ -4,6 +4,7 @@
 #include <memcached/engine_common.h>
 #include <memcached/engine_error.h>
 
+#include <atomic>
 #include <mutex>
 
 /* Slab sizing definitions. */
@@ -51,12 +52,41 @@ struct slabs {
       size_t size;
    } allocs;
 
+   /**
+    * State for moving pages between the slab classes (slab_automove).
+    * Protected by the slab lock.
+    */
+   struct {
+      /** Set once the slabs are initialized if slab_automove is enabled */
+      std::atomic_bool enabled{false};
+      /** The number of evictions in each class the last time we looked */
+      unsigned int evicted[MAX_NUMBER_OF_SLAB_CLASSES];
+      /** The number of windows in a row each class had no evictions */
+      unsigned int idle_windows[MAX_NUMBER_OF_SLAB_CLASSES];
+      /** The class with the most evictions in the last window(s) */
+      unsigned int winner;
+      /** The number of windows in a row winner had the most evictions */
+      unsigned int winner_windows;
+      /** Used to rotate the page we try to move out of a class */
+      unsigned int next_page;
+      /** Statistics */
+      uint64_t pages_moved;
+      uint64_t items_evicted;
+   } automove;
+
    /**
     * Access to the slab allocator is protected by this lock
     */
    std::mutex lock;
 };
 
+/** A slab page and the layout of the chunks in it */
+struct slab_page {
+   void *ptr;
+   unsigned int size;
+   unsigned int perslab;
+};
+
 
 
 
@@ -89,6 +119,46 @@ void slabs_free(struct default_engine *engine, void *ptr, size_t size, unsigned
 /** Adjust the stats for memory requested */
 void slabs_adjust_mem_requested(struct default_engine *engine, unsigned int id, size_t old, size_t ntotal);
 
+/**
+ * Decide if we should move a page between two slab classes (for
+ * slab_automove). This should be called periodically with the total number
+ * of evictions in each class; a page is moved to the class with the most
+ * evictions once it has had the most evictions for a number of calls in a
+ * row, from a class which hasn't had any evictions for as many calls.
+ *
+ * @param evicted the number of evictions for each slab class
+ * @param src where to store the id of the class to take a page from
+ * @param dst where to store the id of the class to give the page to
+ * @return true if a page should be moved
+ */
+bool slabs_automove_decide(struct default_engine *engine,
+                           const unsigned int *evicted,
+                           unsigned int *src,
+                           unsigned int *dst);
+
+/**
+ * Get one of the pages of the given slab class to move to another class
+ * (the caller needs to evict all of the items stored in it first)
+ *
+ * @return true if the class has a page we may move
+ */
+bool slabs_automove_page(struct default_engine *engine,
+                         unsigned int id,
+                         struct slab_page *page);
+
+/**
+ * Move a page (which doesn't contain any items) from one slab class to
+ * another.
+ *
+ * @param evicted the number of items evicted to empty the page
+ * @return true if the page was moved
+ */
+bool slabs_reassign_page(struct default_engine *engine,
+                         const struct slab_page *page,
+                         unsigned int src,
+                         unsigned int dst,
+                         unsigned int evicted);
+
 /** Fill buffer with stats */ /*@null@*/
 void slabs_stats(struct default_engine* engine,
                  const AddStatFn& add_stats,
@@ -39,6 +39,7 @@ protected:
         varConfig = "alog_resident_ratio_threshold=100;";
         varConfig += "alog_max_stored_items=" +
                      std::to_string(alog_max_stored_items);
+        varConfig += extraConfig;
         EngineFixture::SetUp(state);
     }
 
@@ -51,6 +52,9 @@ protected:
 
     const size_t alog_max_stored_items = 2048;
 
+    /// Appended to the config by the derived fixtures
+    std::string extraConfig;
+
     BenchmarkMemoryTracker* memoryTracker;
 };
 
@@ -112,3 +116,68 @@ static void AccessScannerArguments(benchmark::internal::Benchmark* b) {
 BENCHMARK_REGISTER_F(AccessLogBenchEngine, MemoryOverhead)
         ->Apply(AccessScannerArguments)
         ->MinTime(0.000001);
+
+class AccessScanCostBenchEngine : public AccessLogBenchEngine {
+protected:
+    void SetUp(const benchmark::State& state) override {
+        // A single shard, so that each scan is a single visitor task
+        extraConfig = ";max_num_shards=1";
+        AccessLogBenchEngine::SetUp(state);
+    }
+};
+
+/*
+ * Measures the cost of each access scan once the access log has been
+ * written, either rewriting it in full every time or only appending the
+ * changes since the last scan (of which there are none here).
+ * Variables:
+ *  - range(0) : Whether to scan incrementally (0: no, 1: yes)
+ *  - range(1) : The number of items to fill the vbucket with
+ */
+BENCHMARK_DEFINE_F(AccessScanCostBenchEngine, ScanCost)
+(benchmark::State& state) {
+    engine->getConfiguration().setAlogIncremental(state.range(0) == 1);
+    engine->getKVBucket()->setVBucketState(Vbid(0), vbucket_state_active);
+    state.SetLabel(state.range(0) == 1 ? "Incremental" : "Full");
+
+    ExTask task = std::make_shared<AccessScanner>(*(engine->getKVBucket()),
+                                                  engine->getConfiguration(),
+                                                  engine->getEpStats(),
+                                                  1000);
+    ExecutorPool::get()->schedule(task);
+
+    // The values don't affect the scan, so keep them small
+    std::string value(10, 'x');
+    std::string keyPrefixPre(20, 'a');
+    for (int i = 0; i < state.range(1); ++i) {
+        auto item = make_item(vbid, keyPrefixPre + std::to_string(i), value);
+        engine->getKVBucket()->set(item, cookie);
+    }
+
+    auto scan = [this, &task]() {
+        executorPool->wake(task->getId());
+        executorPool->runNextTask(AUXIO_TASK_IDX, "Generating access log");
+        executorPool->runNextTask(AUXIO_TASK_IDX,
+                                  "Item Access Scanner on vb:0");
+    };
+
+    // The first scan always writes the whole log
+    scan();
+    while (state.KeepRunning()) {
+        scan();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(1));
+}
+
+static void ScanCostArguments(benchmark::internal::Benchmark* b) {
+    // 100M items needs in the region of 15GB of memory
+    std::array<int, 3> numItems{{1000000, 10000000, 100000000}};
+    for (int j : numItems) {
+        b->Args({0, j});
+        b->Args({1, j});
+    }
+}
+
+BENCHMARK_REGISTER_F(AccessScanCostBenchEngine, ScanCost)
+        ->Apply(ScanCostArguments)
+        ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,98 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Benchmarks comparing the layouts of the BloomFilter.
+ */
+
+#include "bloomfilter.h"
+#include "module_tests/test_helpers.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <vector>
+
+static std::vector<StoredDocKey> makeKeys(const std::string& prefix,
+                                          size_t count) {
+    std::vector<StoredDocKey> keys;
+    keys.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        keys.push_back(makeStoredDocKey(prefix + std::to_string(i)));
+    }
+    return keys;
+}
+
+/**
+ * Lookup of keys which aren't in the filter (i.e. the lookups a full
+ * eviction bucket uses the filter to avoid a disk read for), in a filter
+ * sized for state.range(1) keys. Reports the false positive rate.
+ */
+static void BM_BloomFilterLookupMissing(benchmark::State& state) {
+    const auto layout = BloomFilter::Layout(state.range(0));
+    const size_t numKeys = state.range(1);
+    BloomFilter filter(numKeys, 0.01, BFILTER_ENABLED, layout);
+    for (size_t i = 0; i < numKeys; i++) {
+        filter.addKey(makeStoredDocKey("key_" + std::to_string(i)));
+    }
+    const auto missing = makeKeys("missing_", 100000);
+
+    size_t index = 0;
+    size_t lookups = 0;
+    size_t falsePositives = 0;
+    while (state.KeepRunning()) {
+        if (filter.maybeKeyExists(missing[index])) {
+            falsePositives++;
+        }
+        lookups++;
+        if (++index == missing.size()) {
+            index = 0;
+        }
+    }
+    state.counters["FalsePositivePct"] =
+            100.0 * falsePositives / std::max(size_t(1), lookups);
+    state.counters["FilterBytes"] = filter.getFilterSize() / 8;
+}
+
+static void BM_BloomFilterAddKey(benchmark::State& state) {
+    const auto layout = BloomFilter::Layout(state.range(0));
+    const size_t numKeys = state.range(1);
+    const auto keys = makeKeys("key_", std::min(numKeys, size_t(100000)));
+    BloomFilter filter(numKeys, 0.01, BFILTER_ENABLED, layout);
+
+    size_t index = 0;
+    while (state.KeepRunning()) {
+        filter.addKey(keys[index]);
+        if (++index == keys.size()) {
+            index = 0;
+        }
+    }
+}
+
+static void LayoutAndKeys(benchmark::internal::Benchmark* b) {
+    for (auto layout :
+         {BloomFilter::Layout::Bitwise, BloomFilter::Layout::Blocked}) {
+        // A filter which fits in the CPU caches, and one which doesn't
+        for (int keys : {10000, 10000000}) {
+            b->Args({int(layout), keys});
+        }
+    }
+    b->ArgNames({"layout", "keys"});
+}
+
+BENCHMARK(BM_BloomFilterLookupMissing)->Apply(LayoutAndKeys);
+BENCHMARK(BM_BloomFilterAddKey)->Apply(LayoutAndKeys);
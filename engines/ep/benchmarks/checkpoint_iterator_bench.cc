@@ -21,8 +21,10 @@
 
 #include "atomic.h"
 #include "checkpoint_iterator.h"
+#include "chunked_queue.h"
 
 #include <benchmark/benchmark.h>
+#include <utilities/memory_tracking_allocator.h>
 #include <list>
 
 typedef std::unique_ptr<int> TestItem;
@@ -59,3 +61,91 @@ static void BM_CheckpointIteratorCompare(benchmark::State& state) {
 
 // Register the function as a benchmark
 BENCHMARK(BM_CheckpointIteratorCompare);
+
+/*
+ * Benchmarks comparing the std::list previously used for the Checkpoint
+ * queue to the ChunkedQueue, both using the MemoryTrackingAllocator as the
+ * Checkpoint does.
+ */
+typedef std::list<TestItem, MemoryTrackingAllocator<TestItem>> TrackedList;
+typedef ChunkedQueue<TestItem, MemoryTrackingAllocator<TestItem>>
+        TrackedChunkedQueue;
+
+/// Move the elements before pos to a new container (as done by expel)
+static TrackedList splitFront(TrackedList& c, TrackedList::iterator pos) {
+    TrackedList front(c.get_allocator());
+    front.splice(front.begin(), c, c.begin(), pos);
+    return front;
+}
+
+static TrackedChunkedQueue splitFront(TrackedChunkedQueue& c,
+                                      TrackedChunkedQueue::iterator pos) {
+    return c.splitFront(pos);
+}
+
+/// Queue state.range(0) items
+template <typename Container>
+static void BM_CheckpointQueuePush(benchmark::State& state) {
+    while (state.KeepRunning()) {
+        MemoryTrackingAllocator<TestItem> allocator;
+        Container c(allocator);
+        for (int ii = 0; ii < state.range(0); ++ii) {
+            c.push_back(nullptr);
+        }
+        benchmark::DoNotOptimize(c.size());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+/// Walk a cursor over a queue of state.range(0) items
+template <typename Container>
+static void BM_CheckpointQueueIterate(benchmark::State& state) {
+    MemoryTrackingAllocator<TestItem> allocator;
+    Container c(allocator);
+    for (int ii = 0; ii < state.range(0); ++ii) {
+        c.push_back(std::make_unique<int>(ii));
+    }
+
+    using Iterator = CheckpointIterator<Container>;
+    while (state.KeepRunning()) {
+        int sum = 0;
+        for (Iterator cursor(c, Iterator::Position::begin),
+             end(c, Iterator::Position::end);
+             cursor != end;
+             ++cursor) {
+            sum += **cursor;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+/// Queue state.range(0) items and expel all but the last one
+template <typename Container>
+static void BM_CheckpointQueueExpel(benchmark::State& state) {
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        MemoryTrackingAllocator<TestItem> allocator;
+        Container c(allocator);
+        for (int ii = 0; ii < state.range(0); ++ii) {
+            c.push_back(std::make_unique<int>(ii));
+        }
+        state.ResumeTiming();
+
+        // Freeing the expelled items is included in the time, as the
+        // expel frees them (outside of the queueLock).
+        auto expelled = splitFront(c, std::prev(c.end()));
+        benchmark::DoNotOptimize(expelled.size());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK_TEMPLATE(BM_CheckpointQueuePush, TrackedList)->Range(64, 65536);
+BENCHMARK_TEMPLATE(BM_CheckpointQueuePush, TrackedChunkedQueue)
+        ->Range(64, 65536);
+BENCHMARK_TEMPLATE(BM_CheckpointQueueIterate, TrackedList)->Range(64, 65536);
+BENCHMARK_TEMPLATE(BM_CheckpointQueueIterate, TrackedChunkedQueue)
+        ->Range(64, 65536);
+BENCHMARK_TEMPLATE(BM_CheckpointQueueExpel, TrackedList)->Range(64, 65536);
+BENCHMARK_TEMPLATE(BM_CheckpointQueueExpel, TrackedChunkedQueue)
+        ->Range(64, 65536);
@@ -0,0 +1,338 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Benchmarks of DCP streaming: DcpProducer::step() driving ActiveStreams
+ * from memory and from disk backfills, and a DcpConsumer applying
+ * mutations through a PassiveStream.
+ */
+
+#include "checkpoint_manager.h"
+#include "dcp/consumer.h"
+#include "dcp/producer.h"
+#include "engine_fixture.h"
+#include "ep_bucket.h"
+#include "fakes/fake_executorpool.h"
+#include "item.h"
+#include "vbucket.h"
+
+#include "../tests/mock/mock_dcp.h"
+#include "../tests/module_tests/collections/test_manifest.h"
+#include "../tests/module_tests/test_helpers.h"
+
+#include <programs/engine_testapp/mock_server.h>
+
+#include <folly/portability/GTest.h>
+
+/**
+ * Message producers counting the mutations (and their key and value bytes)
+ * and snapshot markers a producer sends.
+ */
+class CountingDcpMessageProducers : public MockDcpMessageProducers {
+public:
+    explicit CountingDcpMessageProducers(EngineIface* engine)
+        : MockDcpMessageProducers(engine) {
+    }
+
+    ENGINE_ERROR_CODE marker(uint32_t opaque,
+                             Vbid vbucket,
+                             uint64_t start_seqno,
+                             uint64_t end_seqno,
+                             uint32_t flags,
+                             cb::mcbp::DcpStreamId sid) override {
+        ++messages;
+        return MockDcpMessageProducers::marker(
+                opaque, vbucket, start_seqno, end_seqno, flags, sid);
+    }
+
+    ENGINE_ERROR_CODE mutation(uint32_t opaque,
+                               cb::unique_item_ptr itm,
+                               Vbid vbucket,
+                               uint64_t by_seqno,
+                               uint64_t rev_seqno,
+                               uint32_t lock_time,
+                               const void* meta,
+                               uint16_t nmeta,
+                               uint8_t nru,
+                               cb::mcbp::DcpStreamId sid) override {
+        const auto* item = reinterpret_cast<const Item*>(itm.get());
+        ++messages;
+        ++mutations;
+        bytes += item->getKey().size() + item->getNBytes();
+        return MockDcpMessageProducers::mutation(opaque,
+                                                 std::move(itm),
+                                                 vbucket,
+                                                 by_seqno,
+                                                 rev_seqno,
+                                                 lock_time,
+                                                 meta,
+                                                 nmeta,
+                                                 nru,
+                                                 sid);
+    }
+
+    size_t messages = 0;
+    size_t mutations = 0;
+    size_t bytes = 0;
+};
+
+class DcpBench : public EngineFixture {
+protected:
+    void SetUp(const benchmark::State& state) override {
+        // Collection filters are a "v5 feature" which would otherwise need
+        // DCP noop enabled on the producer.
+        varConfig =
+                "max_size=1000000000;dcp_noop_mandatory_for_v5_features=false";
+        EngineFixture::SetUp(state);
+        if (state.thread_index == 0) {
+            engine->getKVBucket()->setVBucketState(vbid,
+                                                   vbucket_state_active);
+            CollectionsManifest cm;
+            cm.add(CollectionEntry::fruit);
+            engine->getKVBucket()->setCollections(std::string{cm});
+            mock_set_collections_support(cookie, true);
+            mock_set_datatype_support(cookie,
+                                      PROTOCOL_BINARY_DATATYPE_JSON |
+                                              PROTOCOL_BINARY_DATATYPE_SNAPPY);
+        }
+    }
+
+    /**
+     * Store count items of a (compressible) 256 byte JSON value; when
+     * twoCollections is true every other item goes to the fruit collection.
+     */
+    void storeItems(Vbid vb, size_t count, bool twoCollections = false) {
+        const std::string value =
+                R"({"data":")" + std::string(244, 'x') + R"("})";
+        for (size_t i = 0; i < count; i++) {
+            const CollectionID cid = (twoCollections && (i % 2))
+                                             ? CollectionEntry::fruit
+                                             : CollectionEntry::defaultC;
+            Item item(makeStoredDocKey("key" + std::to_string(i), cid),
+                      0,
+                      0,
+                      value.data(),
+                      value.size(),
+                      PROTOCOL_BINARY_DATATYPE_JSON);
+            item.setVBucketId(vb);
+            ASSERT_EQ(ENGINE_SUCCESS,
+                      engine->getKVBucket()->set(item, cookie));
+        }
+    }
+
+    /// Flush the vbucket and drop its checkpoints, so streams must backfill.
+    void flushAndRemoveCheckpoints(Vbid vb) {
+        auto& ep = dynamic_cast<EPBucket&>(*engine->getKVBucket());
+        bool moreAvailable;
+        do {
+            std::tie(moreAvailable, std::ignore) = ep.flushVBucket(vb);
+        } while (moreAvailable);
+
+        auto vbucket = engine->getVBucket(vb);
+        auto& ckptMgr = *vbucket->checkpointManager;
+        ckptMgr.createNewCheckpoint();
+        bool newCheckpointCreated;
+        ckptMgr.removeClosedUnrefCheckpoints(*vbucket, newCheckpointCreated);
+    }
+
+    /**
+     * Run the next task of the AUXIO queue (the producer's checkpoint
+     * processor or a backfill); returns false if none was ready to run.
+     */
+    bool runNextAuxioTask() {
+        try {
+            auto& queue = *executorPool->getLpTaskQ()[AUXIO_TASK_IDX];
+            CheckedExecutor executor(executorPool, queue);
+            executor.runCurrentTask();
+            executor.completeCurrentTask();
+        } catch (const std::logic_error&) {
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Stream the vbucket from seqno 0 to a new producer until it has sent
+     * expectedMutations mutations; only the stepping is timed.
+     */
+    void streamAll(benchmark::State& state,
+                   size_t expectedMutations,
+                   boost::optional<cb::const_char_buffer> filter = {},
+                   bool compress = false) {
+        size_t messages = 0;
+        size_t bytes = 0;
+        while (state.KeepRunning()) {
+            state.PauseTiming();
+            auto producer = std::make_shared<DcpProducer>(
+                    *engine,
+                    cookie,
+                    "bench_producer",
+                    cb::mcbp::request::DcpOpenPayload::Producer,
+                    /*startTask*/ true);
+            if (compress) {
+                ASSERT_EQ(ENGINE_SUCCESS,
+                          producer->control(
+                                  0, "force_value_compression", "true"));
+            }
+            uint64_t rollbackSeqno;
+            ASSERT_EQ(ENGINE_SUCCESS,
+                      producer->streamRequest(0,
+                                              1,
+                                              vbid,
+                                              0,
+                                              ~0ull,
+                                              0,
+                                              0,
+                                              0,
+                                              &rollbackSeqno,
+                                              mock_dcp_add_failover_log,
+                                              filter));
+            CountingDcpMessageProducers producers(engine.get());
+            state.ResumeTiming();
+
+            while (producers.mutations < expectedMutations) {
+                const auto ret = producer->step(&producers);
+                if (ret == ENGINE_EWOULDBLOCK) {
+                    if (!runNextAuxioTask()) {
+                        state.SkipWithError("DCP stream stalled");
+                        break;
+                    }
+                } else if (ret != ENGINE_SUCCESS) {
+                    state.SkipWithError("DcpProducer::step failed");
+                    break;
+                }
+            }
+
+            state.PauseTiming();
+            messages += producers.messages;
+            bytes += producers.bytes;
+            producer->closeAllStreams();
+            producer->cancelCheckpointCreatorTask();
+            producer.reset();
+            state.ResumeTiming();
+        }
+
+        state.counters["MessagesPerSec"] =
+                benchmark::Counter(messages, benchmark::Counter::kIsRate);
+        state.SetBytesProcessed(bytes);
+    }
+};
+
+/// Stream items from the checkpoints in memory.
+BENCHMARK_DEFINE_F(DcpBench, ProducerInMemory)(benchmark::State& state) {
+    const auto items = state.range(0);
+    storeItems(vbid, items);
+    streamAll(state, items);
+}
+
+/// Stream items which must be backfilled from disk.
+BENCHMARK_DEFINE_F(DcpBench, ProducerBackfill)(benchmark::State& state) {
+    const auto items = state.range(0);
+    storeItems(vbid, items);
+    flushAndRemoveCheckpoints(vbid);
+    streamAll(state, items);
+}
+
+/// Stream the half of the items in the fruit collection (0x9).
+BENCHMARK_DEFINE_F(DcpBench, ProducerCollectionFiltered)
+(benchmark::State& state) {
+    const auto items = state.range(0);
+    storeItems(vbid, items, true);
+    streamAll(state, items / 2, {{R"({"collections":["9"]})"}});
+}
+
+/// Stream items from memory, snappy compressing every value.
+BENCHMARK_DEFINE_F(DcpBench, ProducerCompressed)(benchmark::State& state) {
+    const auto items = state.range(0);
+    storeItems(vbid, items);
+    streamAll(state, items, {}, true);
+}
+
+/// Apply snapshots of mutations to a replica vbucket through a DcpConsumer.
+BENCHMARK_DEFINE_F(DcpBench, ConsumerApply)(benchmark::State& state) {
+    const size_t items = state.range(0);
+    const Vbid replica(1);
+    engine->getKVBucket()->setVBucketState(replica, vbucket_state_replica);
+    auto consumer =
+            std::make_shared<DcpConsumer>(*engine, cookie, "bench_consumer");
+    ASSERT_EQ(ENGINE_SUCCESS, consumer->addStream(0, replica, 0));
+    const uint32_t opaque = 1;
+
+    const std::string value = R"({"data":")" + std::string(244, 'x') + R"("})";
+    std::vector<StoredDocKey> keys;
+    for (size_t i = 0; i < items; i++) {
+        keys.push_back(makeStoredDocKey("key" + std::to_string(i)));
+    }
+
+    uint64_t seqno = 0;
+    size_t bytes = 0;
+    while (state.KeepRunning()) {
+        consumer->snapshotMarker(opaque,
+                                 replica,
+                                 seqno + 1,
+                                 seqno + items,
+                                 MARKER_FLAG_MEMORY | MARKER_FLAG_CHK);
+        for (const auto& key : keys) {
+            ++seqno;
+            if (consumer->mutation(opaque,
+                                   key,
+                                   {reinterpret_cast<const uint8_t*>(
+                                            value.data()),
+                                    value.size()},
+                                   0,
+                                   PROTOCOL_BINARY_DATATYPE_JSON,
+                                   seqno,
+                                   replica,
+                                   0,
+                                   seqno,
+                                   1,
+                                   0,
+                                   0,
+                                   {},
+                                   0) != ENGINE_SUCCESS) {
+                state.SkipWithError("DcpConsumer::mutation failed");
+                break;
+            }
+            bytes += key.size() + value.size();
+        }
+
+        // Keep the memory used by the replica's checkpoints bounded.
+        state.PauseTiming();
+        flushAndRemoveCheckpoints(replica);
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(state.iterations() * items);
+    state.SetBytesProcessed(bytes);
+    consumer->closeAllStreams();
+}
+
+BENCHMARK_REGISTER_F(DcpBench, ProducerInMemory)
+        ->Arg(100000)
+        ->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(DcpBench, ProducerBackfill)
+        ->Arg(100000)
+        ->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(DcpBench, ProducerCollectionFiltered)
+        ->Arg(100000)
+        ->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(DcpBench, ProducerCompressed)
+        ->Arg(100000)
+        ->Unit(benchmark::kMillisecond);
+BENCHMARK_REGISTER_F(DcpBench, ConsumerApply)
+        ->Arg(100000)
+        ->Unit(benchmark::kMillisecond);
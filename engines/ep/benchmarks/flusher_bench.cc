@@ -0,0 +1,144 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Benchmarks of the flusher's commit path: mutations queued in the
+ * CheckpointManagers of a shard's vbuckets persisted through
+ * EPBucket::flushVBucket.
+ */
+
+#include "engine_fixture.h"
+#include "ep_bucket.h"
+#include "item.h"
+#include "stats.h"
+
+#include <folly/portability/GTest.h>
+
+enum class Backend { Couchstore = 0, RocksDB = 1, Magma = 2 };
+
+static std::string to_string(Backend store) {
+    switch (store) {
+    case Backend::Couchstore:
+        return "couchdb";
+    case Backend::RocksDB:
+        return "rocksdb";
+    case Backend::Magma:
+        return "magma";
+    }
+    throw std::invalid_argument("to_string(Backend): invalid enumeration " +
+                                std::to_string(int(store)));
+}
+
+/**
+ * Arguments: {store, items queued per vbucket per flush, value size,
+ * vbuckets}. All the vbuckets belong to the one shard.
+ */
+class FlusherBench : public EngineFixture {
+protected:
+    void SetUp(const benchmark::State& state) override {
+        store = Backend(state.range(0));
+        varConfig = "backend=" + to_string(store) +
+                    ";max_size=1000000000;max_num_shards=1";
+        EngineFixture::SetUp(state);
+        if (state.thread_index == 0) {
+            for (int vb = 0; vb < state.range(3); ++vb) {
+                engine->getKVBucket()->setVBucketState(Vbid(vb),
+                                                       vbucket_state_active);
+            }
+        }
+    }
+
+    Backend store;
+};
+
+/**
+ * Queue a batch of updates into each vbucket and flush them all. Reports
+ * the time spent per item in each stage of the flush: fetching the items
+ * from the checkpoints, passing them to the KVStore, committing (excluding
+ * the persistence callbacks) and running the persistence callbacks.
+ */
+BENCHMARK_DEFINE_F(FlusherBench, FlushVBuckets)(benchmark::State& state) {
+    const auto batchItems = state.range(1);
+    const std::string value(state.range(2), 'x');
+    const auto vbuckets = state.range(3);
+    auto& ep = dynamic_cast<EPBucket&>(*engine->getKVBucket());
+    auto& stats = engine->getEpStats();
+
+    const size_t fetchStart = stats.flushFetchTime;
+    const size_t setStart = stats.flushSetTime;
+    const size_t commitStart = stats.flushCommitTime;
+    const size_t callbackStart = stats.flushCallbackTime;
+    size_t itemsFlushed = 0;
+
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        for (int vb = 0; vb < vbuckets; ++vb) {
+            for (int i = 0; i < batchItems; ++i) {
+                auto item = make_item(
+                        Vbid(vb), "key" + std::to_string(i), value);
+                ASSERT_EQ(ENGINE_SUCCESS,
+                          engine->getKVBucket()->set(item, cookie));
+            }
+        }
+        state.ResumeTiming();
+
+        for (int vb = 0; vb < vbuckets; ++vb) {
+            bool moreAvailable;
+            do {
+                size_t count;
+                std::tie(moreAvailable, count) = ep.flushVBucket(Vbid(vb));
+                itemsFlushed += count;
+            } while (moreAvailable);
+        }
+    }
+    ASSERT_TRUE(itemsFlushed);
+
+    const double callbackNs = stats.flushCallbackTime - callbackStart;
+    state.counters["FetchNsPerItem"] =
+            (stats.flushFetchTime - fetchStart) / double(itemsFlushed);
+    state.counters["SetNsPerItem"] =
+            (stats.flushSetTime - setStart) / double(itemsFlushed);
+    state.counters["CommitNsPerItem"] =
+            (stats.flushCommitTime - commitStart - callbackNs) /
+            double(itemsFlushed);
+    state.counters["CallbackNsPerItem"] = callbackNs / double(itemsFlushed);
+    state.SetItemsProcessed(itemsFlushed);
+    state.SetLabel(std::string("store:" + to_string(store)).c_str());
+}
+
+static void FlusherArguments(benchmark::internal::Benchmark* b) {
+    std::vector<Backend> stores{Backend::Couchstore};
+#ifdef EP_USE_ROCKSDB
+    stores.push_back(Backend::RocksDB);
+#endif
+#ifdef EP_USE_MAGMA
+    stores.push_back(Backend::Magma);
+#endif
+    for (auto store : stores) {
+        for (int batch : {100, 10000}) {
+            for (int valueSize : {64, 4096}) {
+                for (int vbuckets : {1, 16}) {
+                    b->Args({int(store), batch, valueSize, vbuckets});
+                }
+            }
+        }
+    }
+}
+
+BENCHMARK_REGISTER_F(FlusherBench, FlushVBuckets)
+        ->Apply(FlusherArguments)
+        ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,84 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Benchmarks relating to the FutureQueue class.
+ */
+
+#include "futurequeue.h"
+#include "taskable.h"
+#include "tests/module_tests/test_task.h"
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+
+class BenchTaskable : public Taskable {
+public:
+    const std::string& getName() const override {
+        return name;
+    }
+    task_gid_t getGID() const override {
+        return 0;
+    }
+    bucket_priority_t getWorkloadPriority() const override {
+        return HIGH_BUCKET_PRIORITY;
+    }
+    void setWorkloadPriority(bucket_priority_t prio) override {
+    }
+    WorkLoadPolicy& getWorkLoadPolicy() override {
+        return policy;
+    }
+    void logQTime(TaskId id,
+                  const std::chrono::steady_clock::duration enqTime) override {
+    }
+    void logRunTime(TaskId id,
+                    const std::chrono::steady_clock::duration runTime) override {
+    }
+
+private:
+    std::string name{"BenchTaskable"};
+    WorkLoadPolicy policy{HIGH_BUCKET_PRIORITY, 1};
+};
+
+/*
+ * Snooze and wake random tasks of a FutureQueue holding state.range(0) tasks
+ * (such as the DCP notifiers of many streams).
+ */
+static void BM_FutureQueueSnoozeWake(benchmark::State& state) {
+    BenchTaskable taskable;
+    FutureQueue<> queue;
+    std::vector<ExTask> tasks;
+    for (int64_t ii = 0; ii < state.range(0); ++ii) {
+        tasks.push_back(std::make_shared<TestTask>(
+                taskable, TaskId::PendingOpsNotification));
+        tasks.back()->snooze(1 + ii % 60);
+        queue.push(tasks.back());
+    }
+
+    std::minstd_rand rng;
+    const auto now = std::chrono::steady_clock::now();
+    while (state.KeepRunning()) {
+        auto& task = tasks[rng() % tasks.size()];
+        queue.snooze(task, 1 + rng() % 60);
+        queue.updateWaketime(task, now);
+        queue.snooze(task, 1 + rng() % 60);
+    }
+    state.SetItemsProcessed(state.iterations() * 3);
+}
+
+BENCHMARK(BM_FutureQueueSnoozeWake)->Range(1024, 64 * 1024);
@@ -27,6 +27,9 @@
 #include <folly/portability/GTest.h>
 #include <spdlog/fmt/fmt.h>
 
+#include <cmath>
+#include <random>
+
 // Benchmarks inserting items into a HashTable
 class HashTableBench : public benchmark::Fixture {
 public:
@@ -267,3 +270,135 @@ BENCHMARK_REGISTER_F(HashTableBench, Replace)
 BENCHMARK_REGISTER_F(HashTableBench, Delete)
         ->ThreadPerCpu()
         ->Iterations(HashTableBench::numItems);
+
+/**
+ * Benchmarks front-end-style threads contending on one HashTable with a mix
+ * of finds (80%), sets (15%) and deletes (5%) of Zipfian (exponent 0.99)
+ * distributed keys.
+ * Arguments: {hash table size, number of locks, layout (0 chained,
+ * 1 grouped)}. Reports the per-thread throughput as "OpsPerThread".
+ */
+class HashTableContentionBench : public benchmark::Fixture {
+public:
+    enum class Op : uint8_t { Find, Set, Delete };
+
+    void SetUp(benchmark::State& state) override {
+        if (state.thread_index == 0) {
+            ht = std::make_unique<HashTable>(
+                    stats,
+                    std::make_unique<StoredValueFactory>(stats),
+                    state.range(0),
+                    state.range(1),
+                    state.range(2) ? HashTable::Layout::Grouped
+                                   : HashTable::Layout::Chained);
+            // Start with every key present, as a warmed up bucket would
+            auto items = createItems();
+            for (auto& item : items) {
+                ht->set(item);
+            }
+            createOps();
+        }
+    }
+
+    void TearDown(benchmark::State& state) override {
+        if (state.thread_index == 0) {
+            ht.reset();
+        }
+    }
+
+    /// Items of every key; each thread sets its own copies.
+    static std::vector<Item> createItems() {
+        std::vector<Item> items;
+        items.reserve(numItems);
+        const auto data = std::string(1, 'x');
+        for (size_t i = 0; i < numItems; i++) {
+            fmt::memory_buffer keyBuf;
+            format_to(keyBuf, "key::{}", i);
+            DocKey key(keyBuf.data(), DocKeyEncodesCollectionId::No);
+            items.emplace_back(key, 0, 0, data.data(), data.size());
+        }
+        return items;
+    }
+
+    /**
+     * Pre-generate the sequence of operations and keys so the random number
+     * generation isn't measured; each thread starts at a different offset.
+     */
+    void createOps() {
+        std::vector<double> cdf;
+        cdf.reserve(numItems);
+        double sum = 0;
+        for (size_t i = 0; i < numItems; i++) {
+            sum += 1.0 / std::pow(double(i + 1), 0.99);
+            cdf.push_back(sum);
+        }
+
+        std::mt19937 gen(numItems);
+        std::uniform_real_distribution<double> keyDist(0, sum);
+        std::uniform_int_distribution<int> opDist(0, 99);
+        ops.clear();
+        ops.reserve(numOps);
+        for (size_t i = 0; i < numOps; i++) {
+            const auto it =
+                    std::lower_bound(cdf.begin(), cdf.end(), keyDist(gen));
+            const auto key = std::min(size_t(it - cdf.begin()), numItems - 1);
+            const auto pick = opDist(gen);
+            const auto op =
+                    pick < 80 ? Op::Find : pick < 95 ? Op::Set : Op::Delete;
+            ops.push_back({uint32_t(key), op});
+        }
+    }
+
+    EPStats stats;
+    std::unique_ptr<HashTable> ht;
+    static const size_t numItems = 100000;
+    static const size_t numOps = 1 << 20;
+    std::vector<std::pair<uint32_t, Op>> ops;
+};
+
+BENCHMARK_DEFINE_F(HashTableContentionBench, MixedOps)
+(benchmark::State& state) {
+    auto items = createItems();
+    size_t next = state.thread_index * (numOps / state.threads);
+
+    while (state.KeepRunning()) {
+        const auto& op = ops[next++ % numOps];
+        auto& item = items[op.first];
+        switch (op.second) {
+        case Op::Find:
+            benchmark::DoNotOptimize(ht->findForRead(item.getKey()));
+            break;
+        case Op::Set:
+            benchmark::DoNotOptimize(ht->set(item));
+            break;
+        case Op::Delete: {
+            auto result = ht->findForWrite(item.getKey());
+            if (result.storedValue) {
+                ht->unlocked_del(result.lock, result.storedValue);
+            }
+            break;
+        }
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.counters["OpsPerThread"] =
+            benchmark::Counter(state.iterations(),
+                               benchmark::Counter::kIsRate |
+                                       benchmark::Counter::kAvgThreads);
+}
+
+static void HashTableContentionArgs(benchmark::internal::Benchmark* b) {
+    for (int layout : {0, 1}) {
+        for (int size : {3079, 49157, 196613}) {
+            for (int locks : {1, 47, 193, 1031}) {
+                b->Args({size, locks, layout});
+            }
+        }
+    }
+}
+
+BENCHMARK_REGISTER_F(HashTableContentionBench, MixedOps)
+        ->Apply(HashTableContentionArgs)
+        ->ThreadRange(1, 16)
+        ->UseRealTime();
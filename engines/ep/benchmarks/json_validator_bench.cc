@@ -0,0 +1,66 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Benchmarks comparing the JSON validation of the mutation path
+ * (cb::json::Validator) with JSON_checker.
+ */
+
+#include <JSON_checker.h>
+#include <benchmark/benchmark.h>
+#include <nlohmann/json.hpp>
+#include <utilities/json_validator.h>
+
+/**
+ * Make a document of about the given size, of the kind of objects with
+ * string and numeric fields typically stored
+ */
+static std::string makeDocument(size_t size) {
+    nlohmann::json doc;
+    for (size_t ii = 0; doc.dump().size() < size; ++ii) {
+        const auto id = std::to_string(ii);
+        doc["users"].push_back({{"id", ii},
+                                {"name", "User number " + id},
+                                {"email", "user." + id + "@example.com"},
+                                {"score", ii * 1.5},
+                                {"active", ii % 2 == 0},
+                                {"tags", {"alpha", "beta", "gamma"}}});
+    }
+    return doc.dump();
+}
+
+static void BM_JSONCheckerValidate(benchmark::State& state) {
+    const auto doc = makeDocument(state.range(0));
+    JSON_checker::Validator validator;
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(validator.validate(
+                reinterpret_cast<const uint8_t*>(doc.data()), doc.size()));
+    }
+    state.SetBytesProcessed(state.iterations() * doc.size());
+}
+
+static void BM_JsonValidatorValidate(benchmark::State& state) {
+    const auto doc = makeDocument(state.range(0));
+    cb::json::Validator validator;
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(validator.validate(doc));
+    }
+    state.SetBytesProcessed(state.iterations() * doc.size());
+}
+
+BENCHMARK(BM_JSONCheckerValidate)->Arg(100)->Arg(1024)->Arg(10240);
+BENCHMARK(BM_JsonValidatorValidate)->Arg(100)->Arg(1024)->Arg(10240);
@@ -30,6 +30,8 @@
 #include <folly/portability/GTest.h>
 #include <platform/dirutils.h>
 
+#include <random>
+
 enum Storage {
     COUCHSTORE = 0
 #ifdef EP_USE_ROCKSDB
@@ -187,6 +189,52 @@ BENCHMARK_DEFINE_F(KVStoreBench, Scan)(benchmark::State& state) {
     state.SetItemsProcessed(itemCountTotal);
 }
 
+/*
+ * Benchmark for a write-heavy workload of small documents: each iteration
+ * overwrites a batch of random keys and commits it. Also reports the bytes
+ * the store wrote to disk per byte of documents (its write amplification).
+ */
+BENCHMARK_DEFINE_F(KVStoreBench, SmallDocOverwrite)(benchmark::State& state) {
+    const int batchSize = 1000;
+    const std::string value(32, 'x');
+    std::mt19937 rng(0);
+    MockWriteCallback wc;
+    Collections::VB::Manifest m;
+    Collections::VB::Flush f(m);
+    int64_t seqno = numItems;
+    size_t docBytes = 0;
+    size_t writtenBefore = 0;
+    const bool haveWriteBytes =
+            kvstore->getStat("io_total_write_bytes", writtenBefore);
+
+    while (state.KeepRunning()) {
+        kvstore->begin(std::make_unique<TransactionContext>());
+        for (int i = 0; i < batchSize; i++) {
+            const auto key = "key" + std::to_string(rng() % numItems + 1);
+            Item item(makeStoredDocKey(key),
+                      0 /*flags*/,
+                      0 /*exptime*/,
+                      value.c_str(),
+                      value.size(),
+                      PROTOCOL_BINARY_RAW_BYTES,
+                      0 /*cas*/,
+                      ++seqno /*bySeqno*/,
+                      vbid);
+            kvstore->set(item, wc);
+            docBytes += key.size() + value.size();
+        }
+        ASSERT_TRUE(kvstore->commit(f));
+    }
+
+    size_t writtenAfter = 0;
+    if (haveWriteBytes && docBytes &&
+        kvstore->getStat("io_total_write_bytes", writtenAfter)) {
+        state.counters["WriteAmplification"] =
+                double(writtenAfter - writtenBefore) / docBytes;
+    }
+    state.SetItemsProcessed(state.iterations() * batchSize);
+}
+
 const int NUM_ITEMS = 100000;
 
 BENCHMARK_REGISTER_F(KVStoreBench, Scan)
@@ -195,3 +243,10 @@ BENCHMARK_REGISTER_F(KVStoreBench, Scan)
         ->Args({NUM_ITEMS, ROCKSDB})
 #endif
         ;
+
+BENCHMARK_REGISTER_F(KVStoreBench, SmallDocOverwrite)
+        ->Args({NUM_ITEMS, COUCHSTORE})
+#ifdef EP_USE_ROCKSDB
+        ->Args({NUM_ITEMS, ROCKSDB})
+#endif
+        ;
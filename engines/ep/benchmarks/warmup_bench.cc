@@ -0,0 +1,192 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Benchmarks of warmup: an engine loading a data directory of synthetic
+ * items written by a previous instance of the engine.
+ */
+
+#include "engine_fixture.h"
+#include "ep_bucket.h"
+#include "fakes/fake_executorpool.h"
+#include "item.h"
+#include "warmup.h"
+
+#include <programs/engine_testapp/mock_server.h>
+
+#include <folly/portability/GTest.h>
+
+#include <map>
+
+/**
+ * Arguments: {items, value size, full eviction}. The items are spread
+ * over 16 vbuckets of 4 shards.
+ */
+class WarmupBench : public EngineFixture {
+protected:
+    void SetUp(const benchmark::State& state) override {
+        varConfig = "max_size=4000000000;max_num_shards=4";
+        varConfig += state.range(2) ? ";item_eviction_policy=full_eviction"
+                                    : ";item_eviction_policy=value_only";
+        EngineFixture::SetUp(state);
+        if (state.thread_index == 0) {
+            populate(state.range(0), state.range(1));
+        }
+    }
+
+    /// Store and persist the items the benchmark warms up.
+    void populate(size_t items, size_t valueSize) {
+        for (uint16_t vb = 0; vb < numVBuckets; ++vb) {
+            engine->getKVBucket()->setVBucketState(Vbid(vb),
+                                                   vbucket_state_active);
+        }
+        auto& ep = dynamic_cast<EPBucket&>(*engine->getKVBucket());
+        const std::string value(valueSize, 'x');
+        for (size_t i = 0; i < items; ++i) {
+            const Vbid vb(i % numVBuckets);
+            auto item = make_item(vb, "key" + std::to_string(i), value);
+            ASSERT_EQ(ENGINE_SUCCESS, ep.set(item, cookie));
+            // Flush in batches to bound the memory used by the checkpoints.
+            if ((i + 1) % 100000 == 0 || i + 1 == items) {
+                for (uint16_t flushVb = 0; flushVb < numVBuckets; ++flushVb) {
+                    bool moreAvailable;
+                    do {
+                        std::tie(moreAvailable, std::ignore) =
+                                ep.flushVBucket(Vbid(flushVb));
+                    } while (moreAvailable);
+                }
+            }
+        }
+    }
+
+    /// Destroy the engine and create a new one which warms up on start.
+    void restartEngine() {
+        engine->getEpStats().isShutdown = true;
+        executorPool->cancelAndClearAll();
+        destroy_mock_event_callbacks();
+        engine->getDcpConnMap().manageConnections();
+        engine.reset();
+
+        engine = SynchronousEPEngine::build(
+                "dbname=benchmarks-test;ht_locks=47;warmup=true;" + varConfig);
+        auto& ep = dynamic_cast<EPBucket&>(*engine->getKVBucket());
+        ep.initializeWarmupTask();
+        ep.startWarmupTask();
+    }
+
+    /// Run the warmup tasks (all on the reader queue) until warmup is done.
+    void runWarmup() {
+        auto& readerQueue = *executorPool->getLpTaskQ()[READER_TASK_IDX];
+        while (engine->getKVBucket()->isWarmingUp()) {
+            CheckedExecutor executor(executorPool, readerQueue);
+            executor.runCurrentTask();
+            executor.completeCurrentTask();
+        }
+    }
+
+    /// The ep_warmup_* stats of the engine, without their prefix.
+    std::map<std::string, std::string> getWarmupStats() {
+        std::map<std::string, std::string> stats;
+        engine->getKVBucket()->getWarmup()->addStats(
+                [&stats](const char* key,
+                         const uint16_t klen,
+                         const char* val,
+                         const uint32_t vlen,
+                         gsl::not_null<const void*>) {
+                    const std::string prefix = "ep_warmup_";
+                    std::string name(key, klen);
+                    if (name.compare(0, prefix.size(), prefix) == 0) {
+                        name.erase(0, prefix.size());
+                    }
+                    stats[name] = std::string(val, vlen);
+                },
+                cookie);
+        return stats;
+    }
+
+    static constexpr uint16_t numVBuckets = 16;
+};
+
+/**
+ * Warm up the data directory. Reports the (last iteration's) time spent in
+ * each warmup phase and the average number of threads busy in it, as
+ * Phase_<state>_Ms and Phase_<state>_Threads counters.
+ */
+BENCHMARK_DEFINE_F(WarmupBench, Warmup)(benchmark::State& state) {
+    const size_t items = state.range(0);
+    size_t bytes = 0;
+    std::map<std::string, std::string> stats;
+
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        restartEngine();
+        state.ResumeTiming();
+
+        runWarmup();
+
+        state.PauseTiming();
+        stats = getWarmupStats();
+        bytes += std::stoull(stats.at("bytes"));
+        state.ResumeTiming();
+    }
+
+    const std::string phasePrefix = "phase_";
+    const std::string timeSuffix = "_time";
+    const std::string threadsSuffix = "_threads";
+    for (const auto& stat : stats) {
+        const auto& name = stat.first;
+        if (name.compare(0, phasePrefix.size(), phasePrefix) != 0) {
+            continue;
+        }
+        auto endsWith = [&name](const std::string& suffix) {
+            return name.size() > suffix.size() &&
+                   name.compare(name.size() - suffix.size(),
+                                suffix.size(),
+                                suffix) == 0;
+        };
+        if (endsWith("_task_time")) {
+            continue;
+        }
+        if (endsWith(timeSuffix)) {
+            const auto phase = name.substr(
+                    phasePrefix.size(),
+                    name.size() - phasePrefix.size() - timeSuffix.size());
+            state.counters["Phase_" + phase + "_Ms"] =
+                    std::stod(stat.second) / 1000;
+        } else if (endsWith(threadsSuffix)) {
+            const auto phase = name.substr(
+                    phasePrefix.size(),
+                    name.size() - phasePrefix.size() - threadsSuffix.size());
+            state.counters["Phase_" + phase + "_Threads"] =
+                    std::stod(stat.second);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * items);
+    state.SetBytesProcessed(bytes);
+}
+
+static void WarmupArguments(benchmark::internal::Benchmark* b) {
+    for (int items : {1000000, 4000000}) {
+        for (int fullEviction : {0, 1}) {
+            b->Args({items, 256, fullEviction});
+        }
+    }
+}
+
+BENCHMARK_REGISTER_F(WarmupBench, Warmup)
+        ->Apply(WarmupArguments)
+        ->Unit(benchmark::kMillisecond);
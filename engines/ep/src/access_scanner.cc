@@ -41,7 +41,8 @@ public:
                       uint16_t sh,
                       std::atomic<bool>& sfin,
                       AccessScanner& aS,
-                      uint64_t items_to_scan)
+                      uint64_t items_to_scan,
+                      bool incremental)
         : store(_store),
           stats(_stats),
           startTime(ep_real_time()),
@@ -50,7 +51,8 @@ public:
           stateFinalizer(sfin),
           as(aS),
           items_scanned(0),
-          items_to_scan(items_to_scan) {
+          items_to_scan(items_to_scan),
+          incremental(incremental) {
         setVBucketFilter(VBucketFilter(
                 _store.getVBuckets().getShard(sh)->getVBuckets()));
         name = conf.getAlogPath();
@@ -60,11 +62,18 @@ public:
         prev = name + ".old";
         next = name + ".next";
 
-        log = std::make_unique<MutationLog>(next, conf.getAlogBlockSize());
+        // An incremental scan appends to the current log
+        const auto& logName = incremental ? name : next;
+        log = std::make_unique<MutationLog>(
+                logName,
+                conf.getAlogBlockSize(),
+                MutationLogVersion(conf.getAlogFormatVersion()));
         log->open();
         if (!log->isOpen()) {
-            EP_LOG_WARN("Failed to open access log: '{}'", next);
+            EP_LOG_WARN("Failed to open access log: '{}'", logName);
             log.reset();
+        } else if (incremental) {
+            EP_LOG_INFO("Attempting to update access file '{}'", logName);
         } else {
             EP_LOG_INFO(
                     "Attempting to generate new access file "
@@ -75,16 +84,27 @@ public:
 
     bool visit(const HashTable::HashBucketLock& lh, StoredValue& v) override {
         // Record resident, Committed HashTable items as 'accessed'.
-        if (log && v.isResident() && v.isCommitted()) {
-            if (v.isExpired(startTime) || v.isDeleted()) {
-                EP_LOG_DEBUG("Skipping expired/deleted item: {}",
-                             v.getBySeqno());
-            } else {
-                accessed.push_back(StoredDocKey(v.getKey()));
-                return ++items_scanned < items_to_scan;
-            }
+        if (!log || !v.isCommitted()) {
+            return true;
+        }
+        const bool isAccessed =
+                v.isResident() && !v.isExpired(startTime) && !v.isDeleted();
+        if (incremental && isAccessed == v.isAccessLogged()) {
+            // Unchanged since the last scan
+            return true;
+        }
+        if (!incremental && !isAccessed) {
+            v.setAccessLogged(false);
+            return true;
         }
-        return true;
+
+        v.setAccessLogged(isAccessed);
+        if (isAccessed) {
+            accessed.push_back(StoredDocKey(v.getKey()));
+        } else {
+            evicted.push_back(StoredDocKey(v.getKey()));
+        }
+        return ++items_scanned < items_to_scan;
     }
 
     void update(Vbid vbid) {
@@ -92,8 +112,12 @@ public:
             for (auto it = accessed.begin(); it != accessed.end(); ++it) {
                 log->newItem(vbid, *it);
             }
+            for (const auto& key : evicted) {
+                log->evictedItem(vbid, key);
+            }
         }
         accessed.clear();
+        evicted.clear();
     }
 
     void visitBucket(const VBucketPtr& vb) override {
@@ -115,11 +139,18 @@ public:
     }
 
     void complete() override {
+        auto& logState = as.shardLogs[shardID];
+        // Until a full scan completes again, the accessLogged flags can't
+        // be trusted to match the log
+        const auto prevLogState = logState;
+        logState = AccessScanner::ShardLogState();
 
         if (log == nullptr) {
             updateStateFinalizer(false);
         } else {
             size_t num_items = log->itemsLogged[int(MutationLogType::New)];
+            size_t num_evicted =
+                    log->itemsLogged[int(MutationLogType::Evicted)];
             log->commit1();
             log->commit2();
             log.reset();
@@ -129,6 +160,20 @@ public:
                     std::chrono::duration_cast<std::chrono::microseconds>(
                             std::chrono::steady_clock::now() - taskStart));
 
+            if (incremental) {
+                logState = prevLogState;
+                ++logState.incrementalRuns;
+                logState.deltaItems += num_items + num_evicted;
+                EP_LOG_INFO(
+                        "Access log file '{}' updated with {} new and {} "
+                        "evicted keys",
+                        name,
+                        static_cast<uint64_t>(num_items),
+                        static_cast<uint64_t>(num_evicted));
+                updateStateFinalizer(true);
+                return;
+            }
+
             if (num_items == 0) {
                 EP_LOG_INFO(
                         "The new access log file is empty. "
@@ -183,6 +228,8 @@ public:
                     "{} keys",
                     name,
                     static_cast<uint64_t>(num_items));
+            logState.haveBase = true;
+            logState.baseItems = num_items;
             updateStateFinalizer(true);
         }
     }
@@ -219,6 +266,8 @@ private:
     uint16_t shardID;
 
     std::vector<StoredDocKey> accessed;
+    // Keys no longer resident since the last scan (incremental only)
+    std::vector<StoredDocKey> evicted;
 
     std::unique_ptr<MutationLog> log;
     std::atomic<bool> &stateFinalizer;
@@ -228,6 +277,8 @@ private:
     uint64_t items_scanned;
     // The number of items to scan before we pause
     const uint64_t items_to_scan;
+    // Only log the changes since the last scan, appending them to the log
+    const bool incremental;
 };
 
 AccessScanner::AccessScanner(KVBucket& _store,
@@ -245,7 +296,8 @@ AccessScanner::AccessScanner(KVBucket& _store,
       conf(conf),
       stats(st),
       sleepTime(sleeptime),
-      available(true) {
+      available(true),
+      shardLogs(_store.getVBuckets().getNumShards()) {
     residentRatioThreshold = conf.getAlogResidentRatioThreshold();
     alogPath = conf.getAlogPath();
     maxStoredItems = conf.getAlogMaxStoredItems();
@@ -327,9 +379,11 @@ bool AccessScanner::run() {
                 deleteAlogFile(prev);
                 /* Remove shard access log file */
                 deleteAlogFile(name);
+                shardLogs[i] = ShardLogState();
                 stats.accessScannerSkips++;
             } else {
-                createAndScheduleTask(i);
+                createAndScheduleTask(
+                        i, conf.isAlogIncremental() && canScanIncrementally(i));
             }
         }
     }
@@ -364,16 +418,35 @@ void AccessScanner::deleteAlogFile(const std::string& fileName) {
     }
 }
 
+bool AccessScanner::canScanIncrementally(size_t shard) const {
+    // An incremental scan needs the accessLogged flags set by a full scan,
+    // and then rewrites the log in full every so often, or once the changes
+    // outgrow the keys it started with, so that it doesn't grow forever.
+    const auto& state = shardLogs[shard];
+    return state.haveBase &&
+           state.incrementalRuns < conf.getAlogCompactionInterval() &&
+           state.deltaItems <= state.baseItems &&
+           cb::io::isFile(alogPath + "." + std::to_string(shard));
+}
+
 /**
  * Helper method to create and schedule the VBCAdaptor task for the Access Log
  * generation.
  * @param shard vBucket shard being used to create the ItemAccessVisitor
+ * @param incremental Only log the changes since the last scan
  * @return True on successful creation, False if the task failed
  */
-void AccessScanner::createAndScheduleTask(const size_t shard) {
+void AccessScanner::createAndScheduleTask(const size_t shard,
+                                          bool incremental) {
     try {
-        auto pv = std::make_unique<ItemAccessVisitor>(
-                store, conf, stats, shard, available, *this, maxStoredItems);
+        auto pv = std::make_unique<ItemAccessVisitor>(store,
+                                                      conf,
+                                                      stats,
+                                                      shard,
+                                                      available,
+                                                      *this,
+                                                      maxStoredItems,
+                                                      incremental);
 
         // p99.9 is typically ~200ms
         const auto maxExpectedDuration = 500ms;
@@ -382,6 +455,7 @@ void AccessScanner::createAndScheduleTask(const size_t shard) {
                          TaskId::AccessScannerVisitor,
                          maxExpectedDuration);
     } catch (const std::exception& e) {
+        shardLogs[shard] = ShardLogState();
         EP_LOG_WARN(
                 "Error creating Item Access Scanner task: '{}'. Please verify "
                 "the "
@@ -19,15 +19,18 @@
 #include "globaltask.h"
 
 #include <string>
+#include <vector>
 
 // Forward declaration.
 class Configuration;
 class EPStats;
 class KVBucket;
 class AccessScannerValueChangeListener;
+class ItemAccessVisitor;
 
 class AccessScanner : public GlobalTask {
     friend class AccessScannerValueChangeListener;
+    friend class ItemAccessVisitor;
 public:
     AccessScanner(KVBucket& _store,
                   Configuration& conf,
@@ -43,12 +46,36 @@ public:
     std::atomic<size_t> completedCount;
 
 protected:
-    void createAndScheduleTask(size_t shard);
+    /**
+     * @param incremental Append the changes since the last scan to the
+     *        shard's access log rather than writing a new one
+     */
+    void createAndScheduleTask(size_t shard, bool incremental = false);
 
 private:
     void updateAlogTime(double sleepSecs);
     void deleteAlogFile(const std::string& fileName);
 
+    /// Can the next scan of the shard just append its changes to the log?
+    bool canScanIncrementally(size_t shard) const;
+
+    /**
+     * The state of each shard's access log, for the incremental scans. Only
+     * touched by the shard's ItemAccessVisitor, and by run() once all of
+     * them have completed.
+     */
+    struct ShardLogState {
+        /// Set once a full scan has written the access log, at which point
+        /// the items' accessLogged flags match it
+        bool haveBase = false;
+        /// The number of incremental scans since the full scan
+        size_t incrementalRuns = 0;
+        /// The number of keys written by the full scan
+        size_t baseItems = 0;
+        /// The number of entries appended since the full scan
+        size_t deltaItems = 0;
+    };
+
     KVBucket& store;
     Configuration& conf;
     EPStats& stats;
@@ -57,4 +84,5 @@ private:
     std::atomic<bool> available;
     uint8_t residentRatioThreshold;
     uint64_t maxStoredItems;
+    std::vector<ShardLogState> shardLogs;
 };
@@ -26,8 +26,12 @@
 #include <phosphor/phosphor.h>
 #include <algorithm>
 #include <climits>
+#include <map>
 #include <vector>
 
+/// Only batches of fewer fetches than this are held for the batch delay
+static const size_t MaxHeldBatchSize = 32;
+
 BgFetcher::BgFetcher(KVBucket& s, KVShard& k)
     : BgFetcher(s, k, s.getEPEngine().getEpStats()) {
 }
@@ -69,25 +73,12 @@ void BgFetcher::wakeUpTaskIfSnoozed() {
     }
 }
 
-size_t BgFetcher::doFetch(Vbid vbId, vb_bgfetch_queue_t& itemsToFetch) {
-    TRACE_EVENT2("BgFetcher",
-                 "doFetch",
-                 "vbid",
-                 vbId.get(),
-                 "#itemsToFetch",
-                 itemsToFetch.size());
-    std::chrono::steady_clock::time_point startTime(
-            std::chrono::steady_clock::now());
-    EP_LOG_DEBUG(
-            "BgFetcher is fetching data, {} numDocs:{} "
-            "startTime:{}",
-            vbId,
-            itemsToFetch.size(),
-            std::chrono::duration_cast<std::chrono::milliseconds>(
-                    startTime.time_since_epoch())
-                    .count());
-
-    shard.getROUnderlying()->getMulti(vbId, itemsToFetch);
+size_t BgFetcher::completeFetch(
+        VBucket& vb,
+        vb_bgfetch_queue_t& itemsToFetch,
+        std::chrono::steady_clock::time_point startTime) {
+    const auto vbId = vb.getId();
+    vb.takeAttachedBGFetchItems(itemsToFetch);
 
     std::vector<bgfetched_item_t> fetchedItems;
     for (const auto& fetch : itemsToFetch) {
@@ -129,6 +120,18 @@ bool BgFetcher::run(GlobalTask *task) {
     //
     // By clearing pendingFlag after the snooze() we ensure the wake()
     // must happen after snooze().
+    const auto delay = batchDelay.load();
+    if (!batchHeld && delay.count() > 0 &&
+        stats.numRemainingBgItems < MaxHeldBatchSize) {
+        // Hold the (small) batch for a little while so more fetches can
+        // join it. pendingFetch is still set so notifyBGEvent() doesn't
+        // wake us early.
+        batchHeld = true;
+        task->snooze(std::chrono::duration<double>(delay).count());
+        return true;
+    }
+    batchHeld = false;
+
     task->snooze(INT_MAX);
     pendingFetch.store(false);
 
@@ -139,7 +142,8 @@ bool BgFetcher::run(GlobalTask *task) {
         pendingVbs.clear();
     }
 
-    size_t num_fetched_items = 0;
+    std::vector<std::pair<Vbid, vb_bgfetch_queue_t>> fetches;
+    std::map<Vbid, VBucketPtr> vbs;
 
     for (const auto vbId : bg_vbs) {
         VBucketPtr vb = shard.getBucket(vbId);
@@ -156,11 +160,34 @@ bool BgFetcher::run(GlobalTask *task) {
 
             auto items = vb->getBGFetchItems();
             if (items.size() > 0) {
-                num_fetched_items += doFetch(vbId, items);
+                fetches.emplace_back(vbId, std::move(items));
+                vbs.emplace(vbId, std::move(vb));
             }
         }
     }
 
+    if (fetches.empty()) {
+        return true;
+    }
+
+    TRACE_EVENT1("BgFetcher", "doFetch", "#vbuckets", fetches.size());
+    const auto startTime = std::chrono::steady_clock::now();
+    EP_LOG_DEBUG("BgFetcher is fetching data, numVbuckets:{} startTime:{}",
+                 fetches.size(),
+                 std::chrono::duration_cast<std::chrono::milliseconds>(
+                         startTime.time_since_epoch())
+                         .count());
+
+    // The vBuckets may complete concurrently
+    std::atomic<size_t> num_fetched_items{0};
+    shard.getROUnderlying()->getMultiParallel(
+            fetches,
+            [this, &vbs, &num_fetched_items, startTime](
+                    Vbid vbId, vb_bgfetch_queue_t& items) {
+                num_fetched_items += completeFetch(
+                        *vbs.at(vbId), items, startTime);
+            });
+
     stats.numRemainingBgItems.fetch_sub(num_fetched_items);
 
     return true;
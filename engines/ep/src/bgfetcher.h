@@ -16,6 +16,8 @@
  */
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <list>
 #include <set>
 #include <string>
@@ -69,8 +71,22 @@ public:
         pendingVbs.insert(vbId);
     }
 
+    /**
+     * Set how long a small batch of fetches is held before it is read, to
+     * give more fetches the chance to join it. Zero disables the delay.
+     */
+    void setBatchDelay(std::chrono::microseconds delay) {
+        batchDelay = delay;
+    }
+
 private:
-    size_t doFetch(Vbid vbId, vb_bgfetch_queue_t& items);
+    /**
+     * Complete the fetches of a vBucket once its items have been read.
+     * @return the number of fetches completed
+     */
+    size_t completeFetch(VBucket& vb,
+                         vb_bgfetch_queue_t& items,
+                         std::chrono::steady_clock::time_point startTime);
 
     /// If the BGFetch task is currently snoozed (not scheduled to
     /// run), wake it up. Has no effect the if the task has already
@@ -85,4 +101,9 @@ private:
 
     std::atomic<bool> pendingFetch;
     std::set<Vbid> pendingVbs;
+
+    std::atomic<std::chrono::microseconds> batchDelay{
+            std::chrono::microseconds::zero()};
+    /// Set when the current batch has been held (only used by run())
+    bool batchHeld = false;
 };
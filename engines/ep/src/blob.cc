@@ -19,7 +19,46 @@
 
 #include "objectregistry.h"
 
+#include <algorithm>
 #include <cstring>
+#include <mutex>
+
+/**
+ * The data of a segmented Blob: the Blob the data was appended to, and the
+ * contiguous copy of the whole value (once it's been read), followed by
+ * the appended data itself.
+ */
+struct Blob::Segment {
+    Segment(const Blob& prefix, uint32_t length)
+        : prefix(TaggedPtr<Blob>(const_cast<Blob*>(&prefix))),
+          length(length),
+          count(uint8_t(std::min(prefix.getSegmentCount() + 1, size_t(255)))) {
+    }
+
+    const char* tail() const {
+        return reinterpret_cast<const char*>(this + 1);
+    }
+
+    char* tail() {
+        return reinterpret_cast<char*>(this + 1);
+    }
+
+    /// The value before the data of this segment
+    value_t prefix;
+    /// The whole value, once it's been made contiguous
+    value_t flattened;
+    std::once_flag flattenOnce;
+    std::atomic<bool> isFlattened{false};
+    /// The number of bytes of data in this segment
+    const uint32_t length;
+    /// The number of segments of the value (including this one)
+    const uint8_t count;
+};
+
+size_t Blob::getSegmentAllocationSize(size_t len) {
+    // Room to align the Segment following the Blob header
+    return alignof(Segment) - 1 + sizeof(Segment) + len;
+}
 
 Blob* Blob::New(const char* start, const size_t len) {
     size_t total_len = getAllocationSize(len);
@@ -33,6 +72,23 @@ Blob* Blob::New(const size_t len) {
     return t;
 }
 
+Blob* Blob::NewAppended(const Blob& prefix,
+                        const char* start,
+                        const size_t len) {
+    // Refer to the contiguous copy of the value (if there is one) so that
+    // the segments it was made from can be freed.
+    const Blob* base = &prefix;
+    if (prefix.isSegmented()) {
+        const auto& segment = prefix.getSegment();
+        if (segment.isFlattened.load(std::memory_order_acquire)) {
+            base = segment.flattened.get().get();
+        }
+    }
+    size_t total_len = getAllocationSize(getSegmentAllocationSize(len));
+    Blob* t = new (::operator new(total_len)) Blob(*base, start, len);
+    return t;
+}
+
 Blob* Blob::Copy(const Blob& other) {
     Blob* t = new (::operator new(Blob::getAllocationSize(other.valueSize())))
             Blob(other);
@@ -55,17 +111,86 @@ Blob::Blob(const size_t len) : Blob(nullptr, len) {
 }
 
 Blob::Blob(const Blob& other)
-    : size(other.size.load()),
+    : size(other.size.load() & ~SegmentedFlag),
       // While this is a copy, it is a new allocation therefore reset age.
       age(0) {
-    std::memcpy(data, other.data, other.valueSize());
+    other.copyData(data, 0, other.valueSize());
     ObjectRegistry::onCreateBlob(this);
 }
 
+Blob::Blob(const Blob& prefix, const char* start, const size_t len)
+    : size(static_cast<uint32_t>(prefix.valueSize() + len) | SegmentedFlag),
+      age(0) {
+    auto* segment = new (&getSegment()) Segment(prefix, len);
+    std::memcpy(segment->tail(), start, len);
+    ObjectRegistry::onCreateBlob(this);
+}
+
+Blob::Segment& Blob::getSegment() const {
+    auto address = reinterpret_cast<uintptr_t>(data);
+    address = (address + alignof(Segment) - 1) & ~(alignof(Segment) - 1);
+    return *reinterpret_cast<Segment*>(address);
+}
+
+void Blob::copyData(char* dest, size_t offset, size_t len) const {
+    if (!isSegmented()) {
+        std::memcpy(dest, data + offset, len);
+        return;
+    }
+
+    const auto& segment = getSegment();
+    if (segment.isFlattened.load(std::memory_order_acquire)) {
+        std::memcpy(dest, segment.flattened->data + offset, len);
+        return;
+    }
+
+    const auto prefixSize = segment.prefix->valueSize();
+    if (offset < prefixSize) {
+        const auto n = std::min(len, prefixSize - offset);
+        segment.prefix->copyData(dest, offset, n);
+        dest += n;
+        offset += n;
+        len -= n;
+    }
+    std::memcpy(dest, segment.tail() + (offset - prefixSize), len);
+}
+
+const char* Blob::getFlattenedData() const {
+    auto& segment = getSegment();
+    if (!segment.isFlattened.load(std::memory_order_acquire)) {
+        std::call_once(segment.flattenOnce, [this, &segment]() {
+            value_t flat(Blob::New(valueSize()));
+            copyData(flat->data, 0, valueSize());
+            segment.flattened = flat;
+            segment.isFlattened.store(true, std::memory_order_release);
+        });
+    }
+    return segment.flattened->data;
+}
+
+size_t Blob::getSegmentCount() const {
+    if (!isSegmented()) {
+        return 1;
+    }
+    const auto& segment = getSegment();
+    if (segment.isFlattened.load(std::memory_order_acquire)) {
+        return 1;
+    }
+    return segment.count;
+}
+
+size_t Blob::getSegmentedSize() const {
+    return getSegmentAllocationSize(getSegment().length) + sizeof(Blob) -
+           paddingSize;
+}
+
 const std::string Blob::to_s() const {
-    return std::string(data, valueSize());
+    return std::string(getData(), valueSize());
 }
 
 Blob::~Blob() {
     ObjectRegistry::onDeleteBlob(this);
+    if (isSegmented()) {
+        getSegment().~Segment();
+    }
 }
@@ -22,6 +22,12 @@
 
 /**
  * A blob is a minimal sized storage for data up to 2^32 bytes long.
+ *
+ * A Blob created by appending to another one (NewAppended) is segmented:
+ * it keeps a reference to the Blob it was appended to and only holds the
+ * appended data, so growing a document through appends doesn't copy it
+ * every time. The value of a segmented Blob is made contiguous (into a
+ * separate Blob owned by it) the first time it's read with getData().
  */
 class Blob : public RCValue {
 public:
@@ -48,7 +54,23 @@ public:
     static Blob* New(const size_t len);
 
     /**
-     * Creates an exact copy of the specified Blob.
+     * Create a new (segmented) Blob holding the value of prefix followed by
+     * the given data, without copying the value of prefix. If prefix was
+     * already made contiguous the new Blob refers to the contiguous copy.
+     *
+     * @param prefix the Blob to append to
+     * @param start the beginning of the data to append
+     * @param len the amount of data to append
+     *
+     * @return the new Blob instance
+     */
+    static Blob* NewAppended(const Blob& prefix,
+                             const char* start,
+                             const size_t len);
+
+    /**
+     * Creates an exact copy of the specified Blob (a segmented Blob is
+     * copied into a contiguous one).
      */
     static Blob* Copy(const Blob& other);
 
@@ -56,25 +78,56 @@ public:
 
     /**
      * Get the pointer to the contents of the Value part of this Blob.
+     * For a segmented Blob this makes the value contiguous (once).
      */
     const char* getData() const {
+        if (isSegmented()) {
+            return getFlattenedData();
+        }
         return data;
     }
 
+    /**
+     * Copy part of the value into the given buffer, without making the
+     * value of a segmented Blob contiguous.
+     *
+     * @param dest where to copy the data to
+     * @param offset the offset into the value to copy from
+     * @param len the number of bytes to copy
+     */
+    void copyData(char* dest, size_t offset, size_t len) const;
+
     /**
      * Get the size of this Blob's value.
      */
     size_t valueSize() const {
-        return size & ~(0x80000000);
+        return size & ~(0x80000000 | SegmentedFlag);
     }
 
     /**
-     * Get the size of this Blob instance.
+     * Get the size of this Blob instance. For a segmented Blob this only
+     * covers the data held by this Blob (not the Blobs it refers to).
      */
     size_t getSize() const {
+        if (isSegmented()) {
+            return getSegmentedSize();
+        }
         return valueSize() + sizeof(Blob) - paddingSize;
     }
 
+    /**
+     * Is the value held in more than one segment?
+     */
+    bool isSegmented() const {
+        return (size & SegmentedFlag) != 0;
+    }
+
+    /**
+     * Get the number of segments the value is held in (1 for a contiguous
+     * value, or one which was made contiguous).
+     */
+    size_t getSegmentCount() const;
+
 
     /**
      * Returns how old this Blob is (how many epochs have passed since it was
@@ -140,6 +193,22 @@ private:
     //Ensure Blob size of 12 bytes by padding by 3.
     static constexpr int paddingSize{3};
 
+    // Set in size for a segmented Blob (the maximum value size is 20 MiB,
+    // so the bit isn't needed for the size).
+    static constexpr uint32_t SegmentedFlag{0x40000000};
+
+    // The data following the header of a segmented Blob (see blob.cc)
+    struct Segment;
+
+    Segment& getSegment() const;
+
+    const char* getFlattenedData() const;
+
+    size_t getSegmentedSize() const;
+
+    /// The size of the data area of a segmented Blob holding len bytes
+    static size_t getSegmentAllocationSize(size_t len);
+
 protected:
     /* Constructor.
      * @param start If non-NULL, pointer to array which will be copied into
@@ -153,6 +222,8 @@ protected:
 
     explicit Blob(const Blob& other);
 
+    Blob(const Blob& prefix, const char* start, const size_t len);
+
     static size_t getAllocationSize(size_t len) {
         return sizeof(Blob) + len - sizeof(Blob(0, 0).data);
     }
@@ -21,7 +21,15 @@
 
 #include "murmurhash3.h"
 
+#include <folly/Portability.h>
+
+#include <algorithm>
 #include <cmath>
+#include <cstring>
+
+#if FOLLY_SSE >= 2
+#include <emmintrin.h>
+#endif
 
 #if __x86_64__ || __ppc64__
 #define MURMURHASH_3 MurmurHash3_x64_128
@@ -29,19 +37,43 @@
 #define MURMURHASH_3 MurmurHash3_x86_128
 #endif
 
-BloomFilter::BloomFilter(size_t key_count, double false_positive_prob,
-                         bfilter_status_t new_status) {
+static constexpr size_t BlockBits = 512;
 
+BloomFilter::BloomFilter(size_t key_count,
+                         double false_positive_prob,
+                         bfilter_status_t new_status,
+                         Layout layout)
+    : layout(layout) {
     status = new_status;
     filterSize = estimateFilterSize(key_count, false_positive_prob);
     noOfHashes = estimateNoOfHashes(key_count);
     keyCounter = 0;
-    bitArray.assign(filterSize, false);
+    if (layout == Layout::Blocked) {
+        const auto numBlocks = (filterSize + BlockBits - 1) / BlockBits;
+        blocks.assign(std::max(size_t(1), numBlocks), Block{});
+        filterSize = blocks.size() * BlockBits;
+    } else {
+        bitArray.assign(filterSize, false);
+    }
+}
+
+BloomFilter::BloomFilter(Layout layout, size_t filterSize, size_t noOfHashes)
+    : filterSize(filterSize),
+      noOfHashes(noOfHashes),
+      keyCounter(0),
+      status(BFILTER_ENABLED),
+      layout(layout) {
+    if (layout == Layout::Blocked) {
+        blocks.assign(filterSize / BlockBits, Block{});
+    } else {
+        bitArray.assign(filterSize, false);
+    }
 }
 
 BloomFilter::~BloomFilter() {
     status = BFILTER_DISABLED;
     bitArray.clear();
+    blocks.clear();
 }
 
 size_t BloomFilter::estimateFilterSize(size_t key_count,
@@ -62,6 +94,49 @@ uint64_t BloomFilter::hashDocKey(const DocKey& key, uint32_t iteration) {
     return result;
 }
 
+BloomFilter::Block& BloomFilter::getBlockAndMask(const DocKey& key,
+                                                 Block& mask) {
+    // A single hash; the top half picks the block, and the bottom half and
+    // a remix of the hash the bits within it (by double hashing, so the
+    // bits are distinct as b is odd).
+    const uint64_t hash = hashDocKey(key, 0);
+    auto& block =
+            blocks[(uint64_t(uint32_t(hash >> 32)) * blocks.size()) >> 32];
+    const auto a = uint32_t(hash);
+    const auto b = uint32_t((hash * 0x9e3779b97f4a7c15ULL) >> 32) | 1;
+
+    mask = Block{};
+    for (uint32_t i = 0; i < noOfHashes; i++) {
+        const auto bit = (a + i * b) % BlockBits;
+        mask.words[bit / 64] |= uint64_t(1) << (bit % 64);
+    }
+    return block;
+}
+
+bool BloomFilter::containsMask(const Block& block, const Block& mask) {
+    static_assert(BlockWords == 8,
+                  "BloomFilter::containsMask: expects 8 words per block");
+#if FOLLY_SSE >= 2
+    // Test the whole block with a few SIMD instructions
+    auto missing = _mm_setzero_si128();
+    for (size_t w = 0; w < BlockWords; w += 2) {
+        const auto b = _mm_load_si128(
+                reinterpret_cast<const __m128i*>(&block.words[w]));
+        const auto m = _mm_load_si128(
+                reinterpret_cast<const __m128i*>(&mask.words[w]));
+        missing = _mm_or_si128(missing, _mm_andnot_si128(b, m));
+    }
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(missing, _mm_setzero_si128())) ==
+           0xffff;
+#else
+    uint64_t missing = 0;
+    for (size_t w = 0; w < BlockWords; w++) {
+        missing |= mask.words[w] & ~block.words[w];
+    }
+    return missing == 0;
+#endif
+}
+
 void BloomFilter::setStatus(bfilter_status_t to) {
     switch (status) {
         case BFILTER_DISABLED:
@@ -73,6 +148,7 @@ void BloomFilter::setStatus(bfilter_status_t to) {
             if (to == BFILTER_DISABLED) {
                 status = to;
                 bitArray.clear();
+                blocks.clear();
             } else if (to == BFILTER_COMPACTING) {
                 status = to;
             }
@@ -81,6 +157,7 @@ void BloomFilter::setStatus(bfilter_status_t to) {
             if (to == BFILTER_DISABLED) {
                 status = to;
                 bitArray.clear();
+                blocks.clear();
             } else if (to == BFILTER_ENABLED) {
                 status = to;
             }
@@ -89,6 +166,7 @@ void BloomFilter::setStatus(bfilter_status_t to) {
             if (to == BFILTER_DISABLED) {
                 status = to;
                 bitArray.clear();
+                blocks.clear();
             } else if (to == BFILTER_COMPACTING) {
                 status = to;
             }
@@ -115,7 +193,17 @@ std::string BloomFilter::getStatusString() {
 }
 
 void BloomFilter::addKey(const DocKey& key) {
-    if (status == BFILTER_COMPACTING || status == BFILTER_ENABLED) {
+    if ((status == BFILTER_COMPACTING || status == BFILTER_ENABLED) &&
+        layout == Layout::Blocked) {
+        Block mask;
+        auto& block = getBlockAndMask(key, mask);
+        if (!containsMask(block, mask)) {
+            keyCounter++;
+        }
+        for (size_t w = 0; w < BlockWords; w++) {
+            block.words[w] |= mask.words[w];
+        }
+    } else if (status == BFILTER_COMPACTING || status == BFILTER_ENABLED) {
         bool overlap = true;
         for (uint32_t i = 0; i < noOfHashes; i++) {
             uint64_t result = hashDocKey(key, i);
@@ -131,7 +219,13 @@ void BloomFilter::addKey(const DocKey& key) {
 }
 
 bool BloomFilter::maybeKeyExists(const DocKey& key) {
-    if (status == BFILTER_COMPACTING || status == BFILTER_ENABLED) {
+    if ((status == BFILTER_COMPACTING || status == BFILTER_ENABLED) &&
+        layout == Layout::Blocked) {
+        Block mask;
+        const auto& block = getBlockAndMask(key, mask);
+        // The key does NOT exist if any of its bits are missing.
+        return containsMask(block, mask);
+    } else if (status == BFILTER_COMPACTING || status == BFILTER_ENABLED) {
         for (uint32_t i = 0; i < noOfHashes; i++) {
             uint64_t result = hashDocKey(key, i);
             if (bitArray[result % filterSize] == 0) {
@@ -159,3 +253,105 @@ size_t BloomFilter::getFilterSize() {
         return 0;
     }
 }
+
+bool BloomFilter::merge(const BloomFilter& other) {
+    if (layout != other.layout || filterSize != other.filterSize ||
+        noOfHashes != other.noOfHashes ||
+        bitArray.size() != other.bitArray.size() ||
+        blocks.size() != other.blocks.size()) {
+        return false;
+    }
+
+    for (size_t ii = 0; ii < blocks.size(); ii++) {
+        for (size_t w = 0; w < BlockWords; w++) {
+            blocks[ii].words[w] |= other.blocks[ii].words[w];
+        }
+    }
+    for (size_t ii = 0; ii < bitArray.size(); ii++) {
+        if (other.bitArray[ii]) {
+            bitArray[ii] = true;
+        }
+    }
+    // We can't tell how many of their keys we already had
+    keyCounter = std::max(keyCounter, other.keyCounter);
+    return true;
+}
+
+namespace {
+/// The start of a serialised filter
+struct SerialisedHeader {
+    uint32_t version;
+    uint32_t layout;
+    uint64_t filterSize;
+    uint64_t noOfHashes;
+    uint64_t keyCounter;
+};
+
+const uint32_t SerialisedVersion = 1;
+} // namespace
+
+std::string BloomFilter::serialise() const {
+    const SerialisedHeader header{SerialisedVersion,
+                                  uint32_t(layout),
+                                  filterSize,
+                                  noOfHashes,
+                                  keyCounter};
+    std::string ret(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    if (layout == Layout::Blocked) {
+        ret.append(reinterpret_cast<const char*>(blocks.data()),
+                   blocks.size() * sizeof(Block));
+    } else {
+        // Pack the bits, 8 to a byte
+        std::string bits((bitArray.size() + 7) / 8, '\0');
+        for (size_t ii = 0; ii < bitArray.size(); ii++) {
+            if (bitArray[ii]) {
+                bits[ii / 8] |= char(1 << (ii % 8));
+            }
+        }
+        ret.append(bits);
+    }
+    return ret;
+}
+
+std::unique_ptr<BloomFilter> BloomFilter::deserialise(const char* data,
+                                                      size_t size) {
+    SerialisedHeader header;
+    if (size < sizeof(header)) {
+        return {};
+    }
+    std::memcpy(&header, data, sizeof(header));
+    data += sizeof(header);
+    size -= sizeof(header);
+
+    if (header.version != SerialisedVersion || header.filterSize == 0 ||
+        header.noOfHashes == 0) {
+        return {};
+    }
+
+    std::unique_ptr<BloomFilter> filter;
+    if (header.layout == uint32_t(Layout::Blocked)) {
+        if (header.filterSize % BlockBits != 0 ||
+            size != header.filterSize / 8) {
+            return {};
+        }
+        filter.reset(new BloomFilter(
+                Layout::Blocked, header.filterSize, header.noOfHashes));
+        std::memcpy(filter->blocks.data(), data, size);
+    } else if (header.layout == uint32_t(Layout::Bitwise)) {
+        if (size != (header.filterSize + 7) / 8) {
+            return {};
+        }
+        filter.reset(new BloomFilter(
+                Layout::Bitwise, header.filterSize, header.noOfHashes));
+        for (size_t ii = 0; ii < header.filterSize; ii++) {
+            if (data[ii / 8] & (1 << (ii % 8))) {
+                filter->bitArray[ii] = true;
+            }
+        }
+    } else {
+        return {};
+    }
+    filter->keyCounter = header.keyCounter;
+    return filter;
+}
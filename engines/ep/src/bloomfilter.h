@@ -16,6 +16,7 @@
  */
 #pragma once
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -36,8 +37,23 @@ enum bfilter_status_t {
  */
 class BloomFilter {
 public:
-    BloomFilter(size_t key_count, double false_positive_prob,
-                bfilter_status_t newStatus = BFILTER_DISABLED);
+    /**
+     * How the bits of the filter are laid out.
+     *
+     * Bitwise: each of the hashes of a key picks a bit anywhere in the
+     * filter, so a lookup touches up to noOfHashes cache lines.
+     *
+     * Blocked: one hash of a key picks a cache line sized block of the
+     * filter and all the bits of the key are in that block, so a lookup
+     * touches a single cache line (and tests all the bits at once). For
+     * the same size it has a somewhat higher false positive rate.
+     */
+    enum class Layout { Bitwise, Blocked };
+
+    BloomFilter(size_t key_count,
+                double false_positive_prob,
+                bfilter_status_t newStatus = BFILTER_DISABLED,
+                Layout layout = Layout::Bitwise);
     ~BloomFilter();
 
     void setStatus(bfilter_status_t to);
@@ -50,17 +66,57 @@ public:
     size_t getNumOfKeysInFilter();
     size_t getFilterSize();
 
+    /**
+     * Add the keys of other to this filter. Only valid for filters of the
+     * same layout and size.
+     * @return false if the filters aren't compatible
+     */
+    bool merge(const BloomFilter& other);
+
+    /**
+     * Get the contents of the filter (in the native byte order) for
+     * writing to disk; see deserialise().
+     */
+    std::string serialise() const;
+
+    /**
+     * Create an enabled filter from the output of serialise().
+     * @return nullptr if data isn't a valid filter
+     */
+    static std::unique_ptr<BloomFilter> deserialise(const char* data,
+                                                    size_t size);
+
 protected:
+    /// Create an empty, enabled, filter of the given shape
+    BloomFilter(Layout layout, size_t filterSize, size_t noOfHashes);
+
     size_t estimateFilterSize(size_t key_count, double false_positive_prob);
     size_t estimateNoOfHashes(size_t key_count);
 
     uint64_t hashDocKey(const DocKey& key, uint32_t iteration);
 
+    /// The bits of the filter in the Blocked layout; one cache line
+    static constexpr size_t BlockWords = 8;
+    struct alignas(64) Block {
+        uint64_t words[BlockWords];
+    };
+
+    /**
+     * The block of the key in the Blocked layout, and the mask of the
+     * bits of the key within it.
+     */
+    Block& getBlockAndMask(const DocKey& key, Block& mask);
+
+    /// Are all of the bits of mask set in block?
+    static bool containsMask(const Block& block, const Block& mask);
+
     size_t filterSize;
     size_t noOfHashes;
 
     size_t keyCounter;
 
     bfilter_status_t status;
+    Layout layout;
     std::vector<bool> bitArray;
+    std::vector<Block> blocks;
 };
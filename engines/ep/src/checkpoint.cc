@@ -17,6 +17,7 @@
 
 #include <gsl.h>
 #include <platform/checked_snprintf.h>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -85,6 +86,135 @@ std::ostream& operator<<(std::ostream& os, const CheckpointCursor& c) {
     return os;
 }
 
+CheckpointKeyIndex::CheckpointKeyIndex(const allocator_type& alloc)
+    : alloc(alloc) {
+}
+
+CheckpointKeyIndex::~CheckpointKeyIndex() {
+    if (entries) {
+        std::allocator_traits<allocator_type>::deallocate(
+                alloc, entries, capacity);
+    }
+}
+
+CheckpointKeyIndex::Entry* CheckpointKeyIndex::find(
+        const StoredDocKey& key,
+        const CheckpointQueue& queue,
+        int64_t highestExpelledSeqno) {
+    if (capacity == 0) {
+        return nullptr;
+    }
+
+    const auto hash = key.hash();
+    const auto mask = capacity - 1;
+    for (auto slot = getSlot(hash);; slot = (slot + 1) & mask) {
+        auto& entry = entries[slot];
+        if (!entry.used) {
+            return nullptr;
+        }
+        // The position of an expelled item isn't valid any more
+        if (entry.hash == hash && entry.mutation_id > highestExpelledSeqno) {
+            const auto& item = queue.at(entry.position);
+            if (item && item->getKey() == key) {
+                return &entry;
+            }
+        }
+    }
+}
+
+void CheckpointKeyIndex::insert(const StoredDocKey& key,
+                                CheckpointQueue::Position position,
+                                int64_t mutationId,
+                                int64_t highestExpelledSeqno) {
+    if ((used + 1) * 4 > capacity * 3) {
+        grow(highestExpelledSeqno);
+    }
+
+    const auto hash = key.hash();
+    const auto mask = capacity - 1;
+    auto slot = getSlot(hash);
+    // Take the first unused slot, or the first with an expelled item
+    while (entries[slot].used &&
+           entries[slot].mutation_id > highestExpelledSeqno) {
+        slot = (slot + 1) & mask;
+    }
+
+    auto& entry = entries[slot];
+    if (!entry.used) {
+        entry.used = true;
+        ++used;
+    }
+    entry.position = position;
+    entry.mutation_id = mutationId;
+    entry.hash = hash;
+}
+
+size_t CheckpointKeyIndex::getMemoryUsageFor(size_t n) {
+    if (n == 0) {
+        return 0;
+    }
+    size_t slots = MinCapacity;
+    while (n * 4 > slots * 3) {
+        slots *= 2;
+    }
+    return slots * sizeof(Entry);
+}
+
+size_t CheckpointKeyIndex::getSlot(uint32_t hash) const {
+    // The hash of the key is a 32 bit DJB hash, so use the high bits of a
+    // multiplicative (Fibonacci) hash of it to spread similar keys apart
+    return size_t((uint64_t(hash) * 0x9E3779B97F4A7C15ull) >> (64 - bits));
+}
+
+void CheckpointKeyIndex::grow(int64_t highestExpelledSeqno) {
+    size_t live = 0;
+    for (size_t ii = 0; ii < capacity; ++ii) {
+        if (entries[ii].used &&
+            entries[ii].mutation_id > highestExpelledSeqno) {
+            ++live;
+        }
+    }
+
+    size_t newCapacity = capacity;
+    uint8_t newBits = bits;
+    if (capacity == 0) {
+        newCapacity = MinCapacity;
+        newBits = 4;
+    } else if ((live + 1) * 2 > capacity) {
+        newCapacity = capacity * 2;
+        ++newBits;
+    }
+
+    using Traits = std::allocator_traits<allocator_type>;
+    auto* newEntries = Traits::allocate(alloc, newCapacity);
+    std::uninitialized_fill_n(newEntries, newCapacity, Entry());
+
+    auto* oldEntries = std::exchange(entries, newEntries);
+    const auto oldCapacity = capacity;
+    capacity = newCapacity;
+    bits = newBits;
+    used = 0;
+
+    const auto mask = capacity - 1;
+    for (size_t ii = 0; ii < oldCapacity; ++ii) {
+        const auto& entry = oldEntries[ii];
+        if (!entry.used || entry.mutation_id <= highestExpelledSeqno) {
+            // Drop the entries of the expelled items
+            continue;
+        }
+        auto slot = getSlot(entry.hash);
+        while (entries[slot].used) {
+            slot = (slot + 1) & mask;
+        }
+        entries[slot] = entry;
+        ++used;
+    }
+
+    if (oldEntries) {
+        Traits::deallocate(alloc, oldEntries, oldCapacity);
+    }
+}
+
 Checkpoint::Checkpoint(EPStats& st,
                        uint64_t id,
                        uint64_t snapStart,
@@ -131,24 +261,26 @@ QueueDirtyStatus Checkpoint::queueDirty(const queued_item& qi,
     }
 
     QueueDirtyStatus rv;
+    // The index entry of the existing item for the key (if any)
+    CheckpointKeyIndex::Entry* existing = nullptr;
 
     // Check if the item is a meta item
     if (qi->isCheckPointMetaItem()) {
         rv = QueueDirtyStatus::SuccessNewItem;
         addItemToCheckpoint(qi);
     } else {
-        checkpoint_index::iterator it = keyIndex.find(qi->getKey());
         // Check if this checkpoint already has an item for the same key
         // and the item has not been expelled.
-        if (it != keyIndex.end() &&
-            (it->second.mutation_id > highestExpelledSeqno)) {
-            const auto currPos = it->second.position;
+        existing = keyIndex.find(qi->getKey(), toWrite, highestExpelledSeqno);
+        if (existing) {
+            const ChkptQueueIterator currPos(
+                    toWrite, toWrite.getIterator(existing->position));
             if (!(canDedup(*currPos, qi))) {
                 return QueueDirtyStatus::FailureDuplicateItem;
             }
 
             rv = QueueDirtyStatus::SuccessExistingItem;
-            const int64_t currMutationId{it->second.mutation_id};
+            const int64_t currMutationId{existing->mutation_id};
 
             // Given the key already exists, need to check all cursors in this
             // Checkpoint and see if the existing item for this key is to
@@ -156,27 +288,11 @@ QueueDirtyStatus Checkpoint::queueDirty(const queued_item& qi,
             for (auto& cursor : checkpointManager->connCursors) {
                 if ((*(cursor.second->currentCheckpoint)).get() == this) {
                     queued_item& cursor_item = *(cursor.second->currentPos);
-
-                    auto& index =
-                            cursor_item->isCheckPointMetaItem() ? metaKeyIndex
-                                                                : keyIndex;
-
-                    auto cursor_item_idx = index.find(cursor_item->getKey());
-                    if (cursor_item_idx == index.end()) {
-                        throw std::logic_error(
-                                "Checkpoint::queueDirty: Unable "
-                                "to find key with"
-                                " op:" +
-                                to_string(cursor_item->getOperation()) +
-                                " seqno:" +
-                                std::to_string(cursor_item->getBySeqno()) +
-                                "for cursor:" + cursor.second->name +
-                                " in current checkpoint.");
-                    }
+                    const auto cursorItemMutationId =
+                            getIndexedMutationId(*cursor.second);
 
                     if (cursor.second->name == CheckpointManager::pCursorName) {
-                        int64_t cursor_mutation_id{
-                                cursor_item_idx->second.mutation_id};
+                        int64_t cursor_mutation_id{cursorItemMutationId};
 
                         // If the cursor item is non-meta, then we need to
                         // return persist again if the existing item is
@@ -204,14 +320,16 @@ QueueDirtyStatus Checkpoint::queueDirty(const queued_item& qi,
                 }
             }
 
-            addItemToCheckpoint(qi);
-
             // Reduce the size of the checkpoint by the size of the
             // item being removed.
             queuedItemsMemUsage -= ((*currPos)->size());
-            // Remove the existing item for the same key from the list.
+            // Remove the existing item for the same key from the queue
+            // before adding the new one, so if it was the last item its
+            // slot is reused instead of being left empty.
             toWrite.erase(currPos.getUnderlyingIterator());
 
+            addItemToCheckpoint(qi);
+
             // Reduce the number of items because addItemToCheckpoint
             // increases the number by one.
             --numItems;
@@ -224,27 +342,36 @@ QueueDirtyStatus Checkpoint::queueDirty(const queued_item& qi,
     if (qi->getKey().size() > 0) {
         ChkptQueueIterator last = end();
         // --last is okay as the list is not empty now.
-        index_entry entry = {--last, qi->getBySeqno()};
+        --last;
         // Set the index of the key to the new item that is pushed back into
         // the list.
         if (qi->isCheckPointMetaItem()) {
             // Insert the new entry into the metaKeyIndex
+            index_entry entry = {last, qi->getBySeqno()};
             auto result = metaKeyIndex.emplace(qi->getKey(), entry);
             if (!result.second) {
                 // Did not manage to insert - so update the value directly
                 result.first->second = entry;
             }
         } else {
-            // Insert the new entry into the keyIndex
-            auto result = keyIndex.emplace(qi->getKey(), entry);
-            if (!result.second) {
-                // Did not manage to insert - so update the value directly
-                result.first->second = entry;
+            const auto position =
+                    toWrite.getPosition(last.getUnderlyingIterator());
+            if (existing) {
+                existing->position = position;
+                existing->mutation_id = qi->getBySeqno();
+            } else {
+                keyIndex.insert(qi->getKey(),
+                                position,
+                                qi->getBySeqno(),
+                                highestExpelledSeqno);
             }
         }
 
         if (rv == QueueDirtyStatus::SuccessNewItem) {
-            auto indexKeyUsage = qi->getKey().size() + sizeof(index_entry);
+            auto indexKeyUsage =
+                    qi->isCheckPointMetaItem()
+                            ? qi->getKey().size() + sizeof(index_entry)
+                            : sizeof(CheckpointKeyIndex::Entry);
             /**
              * Calculate as best we can the memory overhead of adding the new
              * item to the queue (toWrite).  This is approximated to the
@@ -261,6 +388,10 @@ QueueDirtyStatus Checkpoint::queueDirty(const queued_item& qi,
         }
     }
 
+    // Publish the new item to the cursors checking for items without the
+    // queueLock.
+    checkpointManager->queueVersion++;
+
     // Notify flusher if in case queued item is a checkpoint meta item or
     // vbpersist state.
     if (qi->getOperation() == queue_op::checkpoint_start ||
@@ -272,6 +403,30 @@ QueueDirtyStatus Checkpoint::queueDirty(const queued_item& qi,
     return rv;
 }
 
+int64_t Checkpoint::getIndexedMutationId(const CheckpointCursor& cursor) {
+    const queued_item& cursor_item = *(cursor.currentPos);
+    if (cursor_item->isCheckPointMetaItem()) {
+        auto it = metaKeyIndex.find(cursor_item->getKey());
+        if (it != metaKeyIndex.end()) {
+            return it->second.mutation_id;
+        }
+    } else {
+        const auto* entry = keyIndex.find(
+                cursor_item->getKey(), toWrite, highestExpelledSeqno);
+        if (entry) {
+            return entry->mutation_id;
+        }
+    }
+
+    throw std::logic_error(
+            "Checkpoint::queueDirty: Unable "
+            "to find key with"
+            " op:" +
+            to_string(cursor_item->getOperation()) +
+            " seqno:" + std::to_string(cursor_item->getBySeqno()) +
+            "for cursor:" + cursor.name + " in current checkpoint.");
+}
+
 bool Checkpoint::canDedup(const queued_item& existing,
                           const queued_item& in) const {
     auto isDurabilityOp = [](const queued_item& qi_) -> bool {
@@ -303,8 +458,6 @@ void Checkpoint::addItemToCheckpoint(const queued_item& qi) {
 
 CheckpointQueue Checkpoint::expelItems(
         CheckpointCursor& expelUpToAndIncluding) {
-    CheckpointQueue expelledItems(toWrite.get_allocator());
-
     ChkptQueueIterator iterator = expelUpToAndIncluding.currentPos;
 
     // Record the seqno of the last item to be expelled.
@@ -324,18 +477,17 @@ CheckpointQueue Checkpoint::expelItems(
      * Move from (and including) the first item in the checkpoint queue upto
      * (but not including) the item pointed to by iterator.  The item pointed
      * to by iterator is now the new dummy item for the checkpoint queue.
+     * The whole chunks of the queue are handed over without copying.
      */
-    expelledItems.splice(expelledItems.begin(),
-                         toWrite,
-                         begin().getUnderlyingIterator(),
-                         iterator.getUnderlyingIterator());
+    auto expelledItems = toWrite.splitFront(iterator.getUnderlyingIterator());
 
     /*
      * Reduce the queuedItems memory usage by the size of the items
-     * being expelled from memory.
+     * being expelled from memory (skipping the null elements left behind
+     * by de-duplication).
      */
-    const auto addSize = [](size_t a, queued_item qi) {
-        return a + qi->size();
+    const auto addSize = [](size_t a, const queued_item& qi) {
+        return qi ? a + qi->size() : a;
     };
     queuedItemsMemUsage -= std::accumulate(
             expelledItems.begin(), expelledItems.end(), 0, addSize);
@@ -351,6 +503,10 @@ std::ostream& operator <<(std::ostream& os, const Checkpoint& c) {
        << c.getSnapshotEndSeqno() << "}"
        << " state:" << to_string(c.getState()) << " items:[" << std::endl;
     for (const auto& e : c.toWrite) {
+        if (!e) {
+            // De-duplicated item
+            continue;
+        }
         os << "\t{" << e->getBySeqno() << "," << to_string(e->getOperation());
         e->isDeleted() ? os << "[d]," : os << ",";
         os << e->getKey() << "," << e->size() << ",";
@@ -19,6 +19,7 @@
 
 #include "checkpoint_iterator.h"
 #include "checkpoint_types.h"
+#include "chunked_queue.h"
 #include "ep_types.h"
 #include "item.h"
 #include "monotonic.h"
@@ -28,6 +29,7 @@
 #include <platform/non_negative_counter.h>
 #include <utilities/memory_tracking_allocator.h>
 
+#include <limits>
 #include <list>
 #include <map>
 #include <set>
@@ -56,10 +58,11 @@ enum checkpoint_state {
 
 const char* to_string(enum checkpoint_state);
 
-// List is used for queueing mutations as vector incurs shift operations for
-// de-duplication.  We template the list on a queued_item and our own
+// A chunked queue is used for queueing mutations as vector incurs shift
+// operations for de-duplication and a list needs an allocation per item
+// (see ChunkedQueue).  We template the queue on a queued_item and our own
 // memory allocator which allows memory usage to be tracked.
-typedef std::list<queued_item, MemoryTrackingAllocator<queued_item>>
+typedef ChunkedQueue<queued_item, MemoryTrackingAllocator<queued_item>>
         CheckpointQueue;
 
 // Iterator for the Checkpoint queue.  The iterator is templated on the
@@ -84,6 +87,97 @@ using checkpoint_index = std::unordered_map<
         std::equal_to<StoredDocKey>,
         MemoryTrackingAllocator<std::pair<const StoredDocKey, index_entry>>>;
 
+/**
+ * The index of the (non meta) keys of an open Checkpoint, used to
+ * de-duplicate the items for the same key.
+ *
+ * A std::unordered_map node holds a copy of the key and a full iterator,
+ * so for checkpoints with many unique keys the checkpoint_index costs more
+ * memory than the items. This is an open addressing (linear probing) table
+ * of fixed size entries holding the hash of the key and the (compact)
+ * position of the item in the queue; a match of the hash is verified
+ * against the key of the queued item.
+ *
+ * Entries are never removed, they're updated to the position of the next
+ * item for the key. The entries of items which have been expelled from the
+ * queue can't be verified (their position is no longer valid), so they're
+ * skipped by find() and reused by insert(); the caller passes the highest
+ * expelled seqno of the checkpoint to tell them apart.
+ */
+class CheckpointKeyIndex {
+public:
+    struct Entry {
+        CheckpointQueue::Position position;
+        int64_t mutation_id = 0;
+        uint32_t hash = 0;
+        bool used = false;
+    };
+
+    using allocator_type = MemoryTrackingAllocator<Entry>;
+
+    explicit CheckpointKeyIndex(const allocator_type& alloc);
+
+    CheckpointKeyIndex(const CheckpointKeyIndex&) = delete;
+    CheckpointKeyIndex& operator=(const CheckpointKeyIndex&) = delete;
+
+    ~CheckpointKeyIndex();
+
+    /**
+     * Find the entry for the key.
+     *
+     * @param queue the queue the positions of the entries refer to
+     * @param highestExpelledSeqno the entries of this seqno and below are
+     *        for expelled items (and are ignored)
+     * @return the entry, or nullptr if the key isn't in the index
+     */
+    Entry* find(const StoredDocKey& key,
+                const CheckpointQueue& queue,
+                int64_t highestExpelledSeqno);
+
+    /**
+     * Insert an entry for a key which isn't in the index (find() returned
+     * nullptr); an existing entry is updated in place instead.
+     */
+    void insert(const StoredDocKey& key,
+                CheckpointQueue::Position position,
+                int64_t mutationId,
+                int64_t highestExpelledSeqno);
+
+    allocator_type get_allocator() const {
+        return alloc;
+    }
+
+    /// The memory allocated by the index
+    size_t getMemoryUsage() const {
+        return capacity * sizeof(Entry);
+    }
+
+    /// The memory allocated by an index which had n keys inserted to it
+    static size_t getMemoryUsageFor(size_t n);
+
+private:
+    /// The capacity of the table when the first key is inserted
+    static const size_t MinCapacity = 16;
+
+    /// The first slot to probe for the hash
+    size_t getSlot(uint32_t hash) const;
+
+    /**
+     * Rehash the live entries to a new table, which is twice as big unless
+     * dropping the entries of the expelled items makes enough room
+     */
+    void grow(int64_t highestExpelledSeqno);
+
+    allocator_type alloc;
+    Entry* entries = nullptr;
+    /// The number of slots (a power of two, or 0 before the first insert)
+    size_t capacity = 0;
+    /// The number of used slots (including the expelled items)
+    size_t used = 0;
+    /// log2(capacity)
+    uint8_t bits = 0;
+};
+
 class Checkpoint;
 class CheckpointManager;
 class CheckpointConfig;
@@ -131,7 +225,8 @@ public:
         : name(other.name),
           currentCheckpoint(other.currentCheckpoint),
           currentPos(other.currentPos),
-          numVisits(other.numVisits.load()) {
+          numVisits(other.numVisits.load()),
+          caughtUpVersion(other.caughtUpVersion.load()) {
     }
 
     CheckpointCursor &operator=(const CheckpointCursor &other) {
@@ -139,6 +234,7 @@ public:
         currentCheckpoint = other.currentCheckpoint;
         currentPos = other.currentPos;
         numVisits = other.numVisits.load();
+        caughtUpVersion = other.caughtUpVersion.load();
         return *this;
     }
 
@@ -169,6 +265,18 @@ private:
     // Number of times a cursor has been moved or processed.
     std::atomic<size_t>              numVisits;
 
+    /// Value of caughtUpVersion when the cursor isn't known to be caught up
+    static constexpr uint64_t NotCaughtUp =
+            std::numeric_limits<uint64_t>::max();
+
+    /**
+     * The CheckpointManager::queueVersion when the cursor last read the
+     * last item in the queue, or NotCaughtUp. While it matches the manager's
+     * queueVersion the cursor has no items left, which lets the readers
+     * check for items without taking the queueLock.
+     */
+    std::atomic<uint64_t> caughtUpVersion{NotCaughtUp};
+
     friend std::ostream& operator<<(std::ostream& os, const CheckpointCursor& c);
 };
 
@@ -503,8 +611,8 @@ public:
      * This is comprised of three components:
      * 1) The size of the Checkpoint object
      * 2) The keyIndex / metaKeyIndex usage
-     * 3) The size of the ref-counted pointer instances (queued_item) in the
-     *    container.
+     * 3) The size of the chunks of the container holding the ref-counted
+     *    pointer instances (queued_item).
      *
      * When it comes to cursor dropping, this is the theoretical guaranteed
      * memory which can be freed, as the checkpoint contains the only
@@ -534,7 +642,27 @@ public:
      */
     CheckpointQueue expelItems(CheckpointCursor& expelUpToAndIncluding);
 
+    /// The memory allocated for the chunks of the queue (toWrite)
+    size_t getQueueMemoryUsage() const {
+        return toWrite.getMemoryUsage();
+    }
+
+    /**
+     * The number of de-duplicated items which left a null element behind
+     * in the queue (which is only reclaimed when the checkpoint is removed
+     * or the elements are expelled).
+     */
+    size_t getNumDeduplicatedElements() const {
+        return toWrite.getNumErased();
+    }
+
 private:
+    /**
+     * Get the seqno the index has for the item the cursor (which must be
+     * in this checkpoint) points to.
+     */
+    int64_t getIndexedMutationId(const CheckpointCursor& cursor);
+
     EPStats                       &stats;
     uint64_t                       checkpointId;
     uint64_t                       snapStartSeqno;
@@ -557,12 +685,13 @@ private:
     // Allocator used for tracking memory used by the CheckpointQueue
     checkpoint_index::allocator_type keyIndexTrackingAllocator;
     CheckpointQueue toWrite;
-    checkpoint_index               keyIndex;
+    CheckpointKeyIndex keyIndex;
     /* Index for meta keys like "dummy_key" */
     checkpoint_index               metaKeyIndex;
 
     // Record the memory overhead of maintaining the keyIndex and metaKeyIndex.
-    // This includes each item's key size and sizeof(index_entry).
+    // This includes sizeof(CheckpointKeyIndex::Entry) for each key in the
+    // keyIndex, and each meta item's key size and sizeof(index_entry).
     cb::NonNegativeCounter<size_t> keyIndexMemUsage;
     // Records the memory consumption of all items in the checkpoint.
     // This includes each item's key, metadata and the blob.
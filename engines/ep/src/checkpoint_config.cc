@@ -45,6 +45,8 @@ public:
             config.allowItemNumBasedNewCheckpoint(value);
         } else if (key.compare("keep_closed_chks") == 0) {
             config.allowKeepClosedCheckpoints(value);
+        } else if (key.compare("chk_shared_cursor_reads") == 0) {
+            config.allowSharedCursorReads(value);
         }
     }
 
@@ -58,6 +60,7 @@ CheckpointConfig::CheckpointConfig()
       maxCheckpoints(DEFAULT_MAX_CHECKPOINTS),
       itemNumBasedNewCheckpoint(true),
       keepClosedCheckpoints(false),
+      sharedCursorReads(false),
       persistenceEnabled(true) { /* empty */
 }
 
@@ -66,12 +69,14 @@ CheckpointConfig::CheckpointConfig(rel_time_t period,
                                    size_t max_ckpts,
                                    bool item_based_new_ckpt,
                                    bool keep_closed_ckpts,
-                                   bool persistence_enabled)
+                                   bool persistence_enabled,
+                                   bool shared_cursor_reads)
     : checkpointPeriod(period),
       checkpointMaxItems(max_items),
       maxCheckpoints(max_ckpts),
       itemNumBasedNewCheckpoint(item_based_new_ckpt),
       keepClosedCheckpoints(keep_closed_ckpts),
+      sharedCursorReads(shared_cursor_reads),
       persistenceEnabled(persistence_enabled) {
 }
 
@@ -82,6 +87,7 @@ CheckpointConfig::CheckpointConfig(EventuallyPersistentEngine& e) {
     maxCheckpoints = config.getMaxCheckpoints();
     itemNumBasedNewCheckpoint = config.isItemNumBasedNewChk();
     keepClosedCheckpoints = config.isKeepClosedChks();
+    sharedCursorReads = config.isChkSharedCursorReads();
     persistenceEnabled = config.getBucketType() == "persistent";
 }
 
@@ -103,6 +109,9 @@ void CheckpointConfig::addConfigChangeListener(
     configuration.addValueChangedListener(
             "keep_closed_chks",
             std::make_unique<ChangeListener>(engine.getCheckpointConfig()));
+    configuration.addValueChangedListener(
+            "chk_shared_cursor_reads",
+            std::make_unique<ChangeListener>(engine.getCheckpointConfig()));
 }
 
 bool CheckpointConfig::validateCheckpointMaxItemsParam(
@@ -34,7 +34,8 @@ public:
                      size_t max_ckpts,
                      bool item_based_new_ckpt,
                      bool keep_closed_ckpts,
-                     bool persistence_enabled);
+                     bool persistence_enabled,
+                     bool shared_cursor_reads = false);
 
     CheckpointConfig(EventuallyPersistentEngine& e);
 
@@ -58,6 +59,10 @@ public:
         return keepClosedCheckpoints;
     }
 
+    bool isSharedCursorReads() const {
+        return sharedCursorReads;
+    }
+
     bool isPersistenceEnabled() const {
         return persistenceEnabled;
     }
@@ -82,6 +87,10 @@ protected:
         keepClosedCheckpoints = value;
     }
 
+    void allowSharedCursorReads(bool value) {
+        sharedCursorReads = value;
+    }
+
     static void addConfigChangeListener(EventuallyPersistentEngine& engine);
 
 private:
@@ -101,6 +110,9 @@ private:
     // current memory usage
     // below the high water mark.
     bool keepClosedCheckpoints;
+    // Flag indicating if the cursors at the same position share one read of
+    // the items after it.
+    bool sharedCursorReads;
 
     // Flag indicating if persistence is enabled.
     bool persistenceEnabled;
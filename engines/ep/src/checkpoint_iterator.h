@@ -73,6 +73,13 @@ public:
         }
     }
 
+    /**
+     * An iterator at the given (non-null) element of the container.
+     */
+    CheckpointIterator(std::reference_wrapper<C> c, typename C::iterator it)
+        : container(c), iter(it) {
+    }
+
     auto operator++() {
         moveForward();
 
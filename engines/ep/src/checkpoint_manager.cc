@@ -20,12 +20,27 @@
 #include "bucket_logger.h"
 #include "checkpoint.h"
 #include "ep_time.h"
+#include "lock_profiler.h"
 #include "pre_link_document_context.h"
 #include "statwriter.h"
 #include "vbucket.h"
 
 #include <gsl.h>
 
+struct CheckpointManager::SharedRead {
+    // Where the read started
+    CheckpointList::iterator startCheckpoint;
+    ChkptQueueIterator startPos;
+    // Where the read left the cursor
+    CheckpointList::iterator endCheckpoint;
+    ChkptQueueIterator endPos;
+    size_t approxLimit;
+    // The queueVersion at the time of the read
+    uint64_t queueVersion;
+    ItemsForCursor result;
+    std::shared_ptr<const std::vector<queued_item>> items;
+};
+
 CheckpointManager::CheckpointManager(EPStats& st,
                                      Vbid vbucket,
                                      CheckpointConfig& config,
@@ -35,12 +50,14 @@ CheckpointManager::CheckpointManager(EPStats& st,
                                      FlusherCallback cb)
     : stats(st),
       checkpointConfig(config),
+      queueLockProfile(
+              st.lockProfiler.get(LockProfiler::Lock::CheckpointQueue)),
       vbucketId(vbucket),
       numItems(0),
       lastBySeqno(lastSeqno),
       pCursorPreCheckpointId(0),
       flusherCB(cb) {
-    LockHolder lh(queueLock);
+    ProfiledLockHolder lh(queueLock, queueLockProfile);
 
     // Note: this is the last moment in the CheckpointManager lifetime
     //     when the checkpointList is empty.
@@ -58,12 +75,14 @@ CheckpointManager::CheckpointManager(EPStats& st,
     }
 }
 
+CheckpointManager::~CheckpointManager() = default;
+
 uint64_t CheckpointManager::getOpenCheckpointId_UNLOCKED(const LockHolder& lh) {
     return getOpenCheckpoint_UNLOCKED(lh).getId();
 }
 
 uint64_t CheckpointManager::getOpenCheckpointId() {
-    LockHolder lh(queueLock);
+    ProfiledLockHolder lh(queueLock, queueLockProfile);
     return getOpenCheckpointId_UNLOCKED(lh);
 }
 
@@ -74,12 +93,12 @@ uint64_t CheckpointManager::getLastClosedCheckpointId_UNLOCKED(
 }
 
 uint64_t CheckpointManager::getLastClosedCheckpointId() {
-    LockHolder lh(queueLock);
+    ProfiledLockHolder lh(queueLock, queueLockProfile);
     return getLastClosedCheckpointId_UNLOCKED(lh);
 }
 
 void CheckpointManager::setOpenCheckpointId(uint64_t id) {
-    LockHolder lh(queueLock);
+    ProfiledLockHolder lh(queueLock, queueLockProfile);
     setOpenCheckpointId_UNLOCKED(lh, id);
 }
 
@@ -225,7 +244,7 @@ void CheckpointManager::addOpenCheckpoint(uint64_t id,
 
 CursorRegResult CheckpointManager::registerCursorBySeqno(
         const std::string& name, uint64_t startBySeqno) {
-    LockHolder lh(queueLock);
+    ProfiledLockHolder lh(queueLock, queueLockProfile);
     return registerCursorBySeqno_UNLOCKED(lh, name, startBySeqno);
 }
 
@@ -312,7 +331,7 @@ CursorRegResult CheckpointManager::registerCursorBySeqno_UNLOCKED(
 }
 
 bool CheckpointManager::removeCursor(const CheckpointCursor* cursor) {
-    LockHolder lh(queueLock);
+    ProfiledLockHolder lh(queueLock, queueLockProfile);
     return removeCursor_UNLOCKED(cursor);
 }
 
@@ -366,7 +385,7 @@ size_t CheckpointManager::removeClosedUnrefCheckpoints(
     // returns).
     CheckpointList unrefCheckpointList;
     {
-        LockHolder lh(queueLock);
+        ProfiledLockHolder lh(queueLock, queueLockProfile);
         uint64_t oldCheckpointId = 0;
         bool canCreateNewCheckpoint = false;
         if (checkpointList.size() < checkpointConfig.getMaxCheckpoints() ||
@@ -433,6 +452,9 @@ size_t CheckpointManager::removeClosedUnrefCheckpoints(
         }
         size_t total_items = numUnrefItems + numMetaItems;
         numItems.fetch_sub(total_items);
+        if (it != checkpointList.begin()) {
+            sharedRead.reset();
+        }
         unrefCheckpointList.splice(unrefCheckpointList.begin(),
                                    checkpointList,
                                    checkpointList.begin(),
@@ -451,8 +473,10 @@ size_t CheckpointManager::removeClosedUnrefCheckpoints(
 CheckpointManager::ExpelResult
 CheckpointManager::expelUnreferencedCheckpointItems() {
     CheckpointQueue expelledItems;
+    // The memory of the chunks of the checkpoint queue released by the expel
+    size_t queueMemoryReleased = 0;
     {
-        LockHolder lh(queueLock);
+        ProfiledLockHolder lh(queueLock, queueLockProfile);
 
         const auto containsCursors = [](std::unique_ptr<Checkpoint>& c) {
             if (c->getNumCursorsInCheckpoint() > 0) {
@@ -562,7 +586,11 @@ CheckpointManager::expelUnreferencedCheckpointItems() {
          * queue thereby ensuring they still have a reference whilst
          * the queuelock is being held.
          */
+        sharedRead.reset();
+        const auto queueMemory = currentCheckpoint->getQueueMemoryUsage();
         expelledItems = currentCheckpoint->expelItems(expelUpToAndIncluding);
+        queueMemoryReleased =
+                queueMemory - currentCheckpoint->getQueueMemoryUsage();
     }
 
     // If called currentCheckpoint->expelItems but did not manage to expel
@@ -578,12 +606,11 @@ CheckpointManager::expelUnreferencedCheckpointItems() {
      * This is comprised of two parts:
      * 1. Memory used by each item to be expelled.  For each item this
      *    is calculated as the sizeof(Item) + key size + value size.
-     * 2. Memory used to hold the items in the checkpoint list.
-     *    The checkpoint list will be shorter by expelledItems.size().
-     *    This saving is equal to the memory allocated by the
-     *    expelledItems list.  Note: On Windows this is not strictly
-     *    true as we allocate space for size + 1.  However as its
-     *    an estimate we do not need to adjust.
+     * 2. Memory used to hold the items in the checkpoint queue.
+     *    The whole chunks of the queue before the expel point are
+     *    freed along with the expelled items (the slots of the items
+     *    expelled from the first remaining chunk are only freed when
+     *    the rest of the chunk is).
      *
      * It is an optimistic estimate as it assumes that each queued_item
      * is not referenced by anyone else (e.g. a DCP stream) and therefore
@@ -594,12 +621,14 @@ CheckpointManager::expelUnreferencedCheckpointItems() {
     // Part 1 of calculating the estimate (see comment above).
     size_t estimateOfAmountOfRecoveredMemory{0};
     for (const auto& ei : expelledItems) {
-        estimateOfAmountOfRecoveredMemory += ei->size();
+        // Skip the null elements left behind by de-duplication
+        if (ei) {
+            estimateOfAmountOfRecoveredMemory += ei->size();
+        }
     }
 
     // Part 2 of calculating the estimate (see comment above).
-    estimateOfAmountOfRecoveredMemory +=
-            *(expelledItems.get_allocator().getBytesAllocated());
+    estimateOfAmountOfRecoveredMemory += queueMemoryReleased;
 
     /*
      * We are now outside of the queueLock when the method exits,
@@ -611,7 +640,7 @@ CheckpointManager::expelUnreferencedCheckpointItems() {
 }
 
 std::vector<Cursor> CheckpointManager::getListOfCursorsToDrop() {
-    LockHolder lh(queueLock);
+    ProfiledLockHolder lh(queueLock, queueLockProfile);
 
     Checkpoint* persistentCheckpoint =
             (persistenceCursor == nullptr)
@@ -655,7 +684,7 @@ std::vector<Cursor> CheckpointManager::getListOfCursorsToDrop() {
 }
 
 bool CheckpointManager::hasClosedCheckpointWhichCanBeRemoved() const {
-    LockHolder lh(queueLock);
+    ProfiledLockHolder lh(queueLock, queueLockProfile);
     // Check oldest checkpoint; if closed and contains no cursors then
     // we can remove it (and possibly additional old-but-not-oldest
     // checkpoints).
@@ -679,7 +708,7 @@ bool CheckpointManager::queueDirty(
         const GenerateBySeqno generateBySeqno,
         const GenerateCas generateCas,
         PreLinkDocumentContext* preLinkDocumentContext) {
-    LockHolder lh(queueLock);
+    ProfiledLockHolder lh(queueLock, queueLockProfile);
 
     bool canCreateNewCheckpoint = false;
     if (checkpointList.size() < checkpointConfig.getMaxCheckpoints() ||
@@ -787,7 +816,7 @@ bool CheckpointManager::queueDirty(
 
 void CheckpointManager::queueSetVBState(VBucket& vb) {
     // Take lock to serialize use of {lastBySeqno} and to queue op.
-    LockHolder lh(queueLock);
+    ProfiledLockHolder lh(queueLock, queueLockProfile);
 
     // Create the setVBState operation, and enqueue it.
     queued_item item = createCheckpointItem(/*id*/0, vbucketId,
@@ -819,15 +848,51 @@ CheckpointManager::ItemsForCursor CheckpointManager::getItemsForCursor(
         CheckpointCursor* cursorPtr,
         std::vector<queued_item>& items,
         size_t approxLimit) {
-    LockHolder lh(queueLock);
     if (!cursorPtr) {
         EP_LOG_WARN("getAllItemsForCursor(): Caller had a null cursor {}",
                     vbucketId);
         return {0, 0};
     }
 
-    auto& cursor = *cursorPtr;
+    if (!checkpointConfig.isSharedCursorReads() ||
+        cursorPtr == persistenceCursor) {
+        ProfiledLockHolder lh(queueLock, queueLockProfile);
+        return getItemsForCursor_UNLOCKED(*cursorPtr, items, approxLimit);
+    }
+
+    std::shared_ptr<const std::vector<queued_item>> read;
+    ItemsForCursor result(0, 0);
+    {
+        ProfiledLockHolder lh(queueLock, queueLockProfile);
+        if (!takeSharedRead_UNLOCKED(*cursorPtr, approxLimit, read, result)) {
+            const auto startCheckpoint = cursorPtr->currentCheckpoint;
+            const auto startPos = cursorPtr->currentPos;
+            auto readItems = std::make_shared<std::vector<queued_item>>();
+            result = getItemsForCursor_UNLOCKED(
+                    *cursorPtr, *readItems, approxLimit);
+            sharedRead = std::make_unique<SharedRead>(
+                    SharedRead{startCheckpoint,
+                               startPos,
+                               cursorPtr->currentCheckpoint,
+                               cursorPtr->currentPos,
+                               approxLimit,
+                               queueVersion.load(),
+                               result,
+                               readItems});
+            read = std::move(readItems);
+        }
+    }
+
+    // Copy the items without blocking the front end threads queueing
+    // mutations
+    items.insert(items.end(), read->begin(), read->end());
+    return result;
+}
 
+CheckpointManager::ItemsForCursor CheckpointManager::getItemsForCursor_UNLOCKED(
+        CheckpointCursor& cursor,
+        std::vector<queued_item>& items,
+        size_t approxLimit) {
     // Fetch whole checkpoints; as long as we don't exceed the approx item
     // limit.
     ItemsForCursor result((*cursor.currentCheckpoint)->getSnapshotStartSeqno(),
@@ -859,6 +924,11 @@ CheckpointManager::ItemsForCursor CheckpointManager::getItemsForCursor(
         result.range.setEnd((*cursor.currentCheckpoint)->getSnapshotEndSeqno());
     }
 
+    if (!result.moreAvailable) {
+        // The cursor has read everything queued so far
+        cursor.caughtUpVersion = queueVersion.load();
+    }
+
     EP_LOG_DEBUG(
             "CheckpointManager::getAllItemsForCursor() "
             "cursor:{} result:{{#items:{} range:{{{}, {}}} "
@@ -874,6 +944,43 @@ CheckpointManager::ItemsForCursor CheckpointManager::getItemsForCursor(
     return result;
 }
 
+bool CheckpointManager::takeSharedRead_UNLOCKED(
+        CheckpointCursor& cursor,
+        size_t approxLimit,
+        std::shared_ptr<const std::vector<queued_item>>& items,
+        ItemsForCursor& result) {
+    if (!sharedRead) {
+        return false;
+    }
+    if (sharedRead->queueVersion != queueVersion) {
+        // Items were queued (or de-duplicated) since the read
+        sharedRead.reset();
+        return false;
+    }
+    if (sharedRead->approxLimit != approxLimit ||
+        sharedRead->startCheckpoint != cursor.currentCheckpoint ||
+        sharedRead->startPos != cursor.currentPos) {
+        return false;
+    }
+
+    if (cursor.currentCheckpoint != sharedRead->endCheckpoint) {
+        (*cursor.currentCheckpoint)->decNumOfCursorsInCheckpoint();
+        cursor.currentCheckpoint = sharedRead->endCheckpoint;
+        (*cursor.currentCheckpoint)->incNumOfCursorsInCheckpoint();
+    }
+    cursor.currentPos = sharedRead->endPos;
+
+    if (!sharedRead->result.moreAvailable) {
+        cursor.caughtUpVersion = queueVersion.load();
+    }
+    cursor.numVisits++;
+    ++numSharedReads;
+
+    items = sharedRead->items;
+    result = sharedRead->result;
+    return true;
+}
+
 bool CheckpointManager::incrCursor(CheckpointCursor &cursor) {
     if (++(cursor.currentPos) != (*(cursor.currentCheckpoint))->end()) {
         return true;
@@ -893,17 +1000,17 @@ void CheckpointManager::notifyFlusher() {
 }
 
 void CheckpointManager::setBySeqno(int64_t seqno) {
-    LockHolder lh(queueLock);
+    ProfiledLockHolder lh(queueLock, queueLockProfile);
     lastBySeqno = seqno;
 }
 
 int64_t CheckpointManager::getHighSeqno() const {
-    LockHolder lh(queueLock);
+    ProfiledLockHolder lh(queueLock, queueLockProfile);
     return lastBySeqno;
 }
 
 int64_t CheckpointManager::nextBySeqno() {
-    LockHolder lh(queueLock);
+    ProfiledLockHolder lh(queueLock, queueLockProfile);
     return ++lastBySeqno;
 }
 
@@ -912,7 +1019,7 @@ void CheckpointManager::dump() const {
 }
 
 void CheckpointManager::clear(VBucket& vb, uint64_t seqno) {
-    LockHolder lh(queueLock);
+    ProfiledLockHolder lh(queueLock, queueLockProfile);
     clear_UNLOCKED(vb.getState(), seqno);
 
     // Reset the disk write queue size stat for the vbucket
@@ -924,6 +1031,7 @@ void CheckpointManager::clear(VBucket& vb, uint64_t seqno) {
 }
 
 void CheckpointManager::clear_UNLOCKED(vbucket_state_t vbState, uint64_t seqno) {
+    sharedRead.reset();
     checkpointList.clear();
     numItems = 0;
     lastBySeqno.reset(seqno);
@@ -935,6 +1043,7 @@ void CheckpointManager::clear_UNLOCKED(vbucket_state_t vbState, uint64_t seqno)
 
 void CheckpointManager::resetCursors(bool resetPersistenceCursor) {
     for (auto& cit : connCursors) {
+        cit.second->caughtUpVersion = CheckpointCursor::NotCaughtUp;
         if (cit.second->name == pCursorName) {
             if (!resetPersistenceCursor) {
                 continue;
@@ -972,7 +1081,7 @@ bool CheckpointManager::moveCursorToNextCheckpoint(CheckpointCursor &cursor) {
 }
 
 size_t CheckpointManager::getNumOpenChkItems() const {
-    LockHolder lh(queueLock);
+    ProfiledLockHolder lh(queueLock, queueLockProfile);
     return getOpenCheckpoint_UNLOCKED(lh).getNumItems();
 }
 
@@ -991,9 +1100,13 @@ uint64_t CheckpointManager::checkOpenCheckpoint_UNLOCKED(const LockHolder& lh,
     // (2) current checkpoint is reached to the max number of items allowed.
     // (3) time elapsed since the creation of the current checkpoint is greater
     //     than the threshold
+    // (4) de-duplication left as many null elements in the queue as the max
+    //     number of items (as they're only freed with the checkpoint)
     if (forceCreation ||
         (checkpointConfig.isItemNumBasedNewCheckpoint() &&
-         openCkpt.getNumItems() >= checkpointConfig.getCheckpointMaxItems()) ||
+         (openCkpt.getNumItems() >= checkpointConfig.getCheckpointMaxItems() ||
+          openCkpt.getNumDeduplicatedElements() >=
+                  checkpointConfig.getCheckpointMaxItems())) ||
         (openCkpt.getNumItems() > 0 && timeBound)) {
         checkpoint_id = openCkpt.getId();
         addNewCheckpoint_UNLOCKED(checkpoint_id + 1);
@@ -1003,7 +1116,11 @@ uint64_t CheckpointManager::checkOpenCheckpoint_UNLOCKED(const LockHolder& lh,
 
 size_t CheckpointManager::getNumItemsForCursor(
         const CheckpointCursor* cursor) const {
-    LockHolder lh(queueLock);
+    if (cursor && cursor->caughtUpVersion == queueVersion) {
+        // Nothing was queued since the cursor read the last item
+        return 0;
+    }
+    ProfiledLockHolder lh(queueLock, queueLockProfile);
     return getNumItemsForCursor_UNLOCKED(cursor);
 }
 
@@ -1031,7 +1148,7 @@ size_t CheckpointManager::getNumItemsForCursor_UNLOCKED(
 }
 
 void CheckpointManager::clear(vbucket_state_t vbState) {
-    LockHolder lh(queueLock);
+    ProfiledLockHolder lh(queueLock, queueLockProfile);
     clear_UNLOCKED(vbState, lastBySeqno);
 }
 
@@ -1047,7 +1164,7 @@ bool CheckpointManager::isLastMutationItemInCheckpoint(
 }
 
 void CheckpointManager::setBackfillPhase(uint64_t start, uint64_t end) {
-    LockHolder lh(queueLock);
+    ProfiledLockHolder lh(queueLock, queueLockProfile);
     setOpenCheckpointId_UNLOCKED(lh, 0);
     auto& openCkpt = getOpenCheckpoint_UNLOCKED(lh);
     openCkpt.setSnapshotStartSeqno(start);
@@ -1056,7 +1173,7 @@ void CheckpointManager::setBackfillPhase(uint64_t start, uint64_t end) {
 
 void CheckpointManager::createSnapshot(uint64_t snapStartSeqno,
                                        uint64_t snapEndSeqno) {
-    LockHolder lh(queueLock);
+    ProfiledLockHolder lh(queueLock, queueLockProfile);
 
     auto& openCkpt = getOpenCheckpoint_UNLOCKED(lh);
     const auto openCkptId = openCkpt.getId();
@@ -1075,7 +1192,7 @@ void CheckpointManager::createSnapshot(uint64_t snapStartSeqno,
 }
 
 void CheckpointManager::resetSnapshotRange() {
-    LockHolder lh(queueLock);
+    ProfiledLockHolder lh(queueLock, queueLockProfile);
 
     auto& openCkpt = getOpenCheckpoint_UNLOCKED(lh);
 
@@ -1090,12 +1207,12 @@ void CheckpointManager::resetSnapshotRange() {
 }
 
 void CheckpointManager::updateCurrentSnapshotEnd(uint64_t snapEnd) {
-    LockHolder lh(queueLock);
+    ProfiledLockHolder lh(queueLock, queueLockProfile);
     getOpenCheckpoint_UNLOCKED(lh).setSnapshotEndSeqno(snapEnd);
 }
 
 snapshot_info_t CheckpointManager::getSnapshotInfo() {
-    LockHolder lh(queueLock);
+    ProfiledLockHolder lh(queueLock, queueLockProfile);
 
     const auto& openCkpt = getOpenCheckpoint_UNLOCKED(lh);
 
@@ -1120,7 +1237,7 @@ snapshot_info_t CheckpointManager::getSnapshotInfo() {
 }
 
 void CheckpointManager::checkAndAddNewCheckpoint() {
-    LockHolder lh(queueLock);
+    ProfiledLockHolder lh(queueLock, queueLockProfile);
     const auto& openCkpt = getOpenCheckpoint_UNLOCKED(lh);
     const auto openCkptId = openCkpt.getId();
 
@@ -1181,7 +1298,7 @@ queued_item CheckpointManager::createCheckpointItem(uint64_t id,
 }
 
 uint64_t CheckpointManager::createNewCheckpoint() {
-    LockHolder lh(queueLock);
+    ProfiledLockHolder lh(queueLock, queueLockProfile);
 
     const auto& openCkpt = getOpenCheckpoint_UNLOCKED(lh);
 
@@ -1194,12 +1311,12 @@ uint64_t CheckpointManager::createNewCheckpoint() {
 }
 
 uint64_t CheckpointManager::getPersistenceCursorPreChkId() {
-    LockHolder lh(queueLock);
+    ProfiledLockHolder lh(queueLock, queueLockProfile);
     return pCursorPreCheckpointId;
 }
 
 void CheckpointManager::itemsPersisted() {
-    LockHolder lh(queueLock);
+    ProfiledLockHolder lh(queueLock, queueLockProfile);
     auto itr = persistenceCursor->currentCheckpoint;
     pCursorPreCheckpointId = ((*itr)->getId() > 0) ? (*itr)->getId() - 1 : 0;
 }
@@ -1221,12 +1338,12 @@ size_t CheckpointManager::getMemoryOverhead_UNLOCKED() const {
 }
 
 size_t CheckpointManager::getMemoryUsage() const {
-    LockHolder lh(queueLock);
+    ProfiledLockHolder lh(queueLock, queueLockProfile);
     return getMemoryUsage_UNLOCKED();
 }
 
 size_t CheckpointManager::getMemoryUsageOfUnrefCheckpoints() const {
-    LockHolder lh(queueLock);
+    ProfiledLockHolder lh(queueLock, queueLockProfile);
 
     size_t memUsage = 0;
     for (const auto& checkpoint : checkpointList) {
@@ -1240,13 +1357,13 @@ size_t CheckpointManager::getMemoryUsageOfUnrefCheckpoints() const {
 }
 
 size_t CheckpointManager::getMemoryOverhead() const {
-    LockHolder lh(queueLock);
+    ProfiledLockHolder lh(queueLock, queueLockProfile);
     return getMemoryOverhead_UNLOCKED();
 }
 
 void CheckpointManager::addStats(const AddStatFn& add_stat,
                                  const void* cookie) {
-    LockHolder lh(queueLock);
+    ProfiledLockHolder lh(queueLock, queueLockProfile);
     char buf[256];
 
     try {
@@ -1292,6 +1409,11 @@ void CheckpointManager::addStats(const AddStatFn& add_stat,
         }
         checked_snprintf(buf, sizeof(buf), "vb_%d:mem_usage", vbucketId.get());
         add_casted_stat(buf, getMemoryUsage_UNLOCKED(), add_stat, cookie);
+        checked_snprintf(buf,
+                         sizeof(buf),
+                         "vb_%d:num_shared_cursor_reads",
+                         vbucketId.get());
+        add_casted_stat(buf, numSharedReads, add_stat, cookie);
 
         for (const auto& cursor : connCursors) {
             checked_snprintf(buf,
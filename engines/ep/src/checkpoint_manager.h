@@ -33,6 +33,7 @@ class Checkpoint;
 class CheckpointConfig;
 class CheckpointCursor;
 class EPStats;
+class LockProfile;
 class PreLinkDocumentContext;
 class VBucket;
 
@@ -76,6 +77,8 @@ public:
                       uint64_t lastSnapEnd,
                       FlusherCallback cb);
 
+    ~CheckpointManager();
+
     uint64_t getOpenCheckpointId();
 
     uint64_t getLastClosedCheckpointId();
@@ -181,6 +184,11 @@ public:
      * Note: It is only valid to fetch complete checkpoints; as such we cannot
      * limit to a precise number of items.
      *
+     * If chk_shared_cursor_reads is enabled, a cursor at the position where
+     * the previous read started (with no items queued since) takes the items
+     * of that read instead of walking the checkpoints again, and the items
+     * are copied into `items` after the queueLock is released.
+     *
      * @param cursor CheckpointCursor to read items from and advance
      * @param[in/out] items container which items will be appended to.
      * @param approxLimit Approximate number of items to add.
@@ -392,6 +400,24 @@ protected:
 
     size_t getNumItemsForCursor_UNLOCKED(const CheckpointCursor* cursor) const;
 
+    ItemsForCursor getItemsForCursor_UNLOCKED(CheckpointCursor& cursor,
+                                              std::vector<queued_item>& items,
+                                              size_t approxLimit);
+
+    /**
+     * Move the cursor past the items of the last shared read, if the read
+     * started at the cursor's position and nothing was queued since.
+     *
+     * @param[out] items the items of the read
+     * @param[out] result the result of the read
+     * @return true if the cursor took the read
+     */
+    bool takeSharedRead_UNLOCKED(
+            CheckpointCursor& cursor,
+            size_t approxLimit,
+            std::shared_ptr<const std::vector<queued_item>>& items,
+            ItemsForCursor& result);
+
     void clear_UNLOCKED(vbucket_state_t vbState, uint64_t seqno);
 
     /*
@@ -459,6 +485,8 @@ protected:
     EPStats                 &stats;
     CheckpointConfig        &checkpointConfig;
     mutable std::mutex       queueLock;
+    // Where acquisitions of the queueLock are profiled (stats.lockProfiler)
+    LockProfile&             queueLockProfile;
     const Vbid vbucketId;
 
     // Total number of items (including meta items) in /all/ checkpoints managed
@@ -467,6 +495,28 @@ protected:
     Monotonic<int64_t>       lastBySeqno;
     uint64_t                 pCursorPreCheckpointId;
 
+    /**
+     * Incremented (with the queueLock held) every time an item is queued
+     * into a checkpoint. A cursor records the version when it reads the last
+     * item (see CheckpointCursor::caughtUpVersion), so while the two match
+     * the cursor has nothing to read and getNumItemsForCursor can return
+     * without the queueLock - which the front end threads need to queue
+     * their mutations.
+     */
+    std::atomic<uint64_t> queueVersion{0};
+
+    /**
+     * The last read of a cursor when chk_shared_cursor_reads is enabled, so
+     * that the other cursors at the same position can take its items (see
+     * takeSharedRead_UNLOCKED). Reset when items are removed from the
+     * checkpoints, as its positions may then no longer be valid.
+     */
+    struct SharedRead;
+    std::unique_ptr<SharedRead> sharedRead;
+
+    /// Number of reads taken from sharedRead
+    size_t numSharedReads = 0;
+
     /**
      * connCursors: stores all known CheckpointCursor objects which are held via
      * shared_ptr. When a client creates a cursor we store the shared_ptr and
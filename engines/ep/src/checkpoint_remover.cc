@@ -20,12 +20,14 @@
 #include "checkpoint_remover.h"
 #include "checkpoint_visitor.h"
 #include "connmap.h"
+#include "executorpool.h"
 #include "dcp/dcpconnmap.h"
 #include "ep_engine.h"
 #include "kv_bucket.h"
 #include "vbucket.h"
 
 #include <phosphor/phosphor.h>
+#include <climits>
 #include <memory>
 
 std::pair<bool, size_t>
@@ -179,3 +181,97 @@ bool ClosedUnrefCheckpointRemoverTask::run(void) {
     snooze(sleepTime);
     return true;
 }
+
+CheckpointRemovalTask::CheckpointRemovalTask(EventuallyPersistentEngine& e,
+                                             EPStats& st)
+    : GlobalTask(&e, TaskId::CheckpointRemovalTask, INT_MAX, false),
+      stats(st),
+      notified(false) {
+}
+
+bool CheckpointRemovalTask::run() {
+    TRACE_EVENT0("ep-engine/task", "CheckpointRemovalTask");
+    if (stats.isShutdown) {
+        return false;
+    }
+
+    // Sleep until we're notified again
+    snooze(INT_MAX);
+    notified.store(false);
+
+    KVBucket* kvBucket = engine->getKVBucket();
+    const bool wasHighMemoryUsage = kvBucket->isMemoryUsageTooHigh();
+    const auto batchSize = engine->getConfiguration().getChkRemoverBatchSize();
+    const auto start = std::chrono::steady_clock::now();
+
+    size_t visited = 0;
+    Vbid vbid;
+    while (visited < batchSize && queuePop(vbid)) {
+        ++visited;
+        VBucketPtr vb = kvBucket->getVBucket(vbid);
+        if (!vb) {
+            continue;
+        }
+
+        bool newCheckpointCreated = false;
+        const auto removed = vb->checkpointManager->removeClosedUnrefCheckpoints(
+                *vb, newCheckpointCreated);
+        if (newCheckpointCreated) {
+            engine->getDcpConnMap().notifyVBConnections(
+                    vbid, vb->checkpointManager->getHighSeqno());
+        }
+        stats.itemsRemovedFromCheckpoints.fetch_add(removed);
+        if (removed > 0) {
+            EP_LOG_DEBUG("Removed {} closed unreferenced checkpoints from {}",
+                         removed,
+                         vbid);
+        }
+    }
+
+    if (visited > 0) {
+        stats.checkpointRemoverHisto.add(
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - start));
+    }
+
+    // Wake up any sleeping backfill tasks if the memory usage is lowered
+    // below the high watermark as a result of checkpoint removal.
+    if (wasHighMemoryUsage && !kvBucket->isMemoryUsageTooHigh()) {
+        engine->getDcpConnMap().notifyBackfillManagerTasks();
+    }
+
+    // Yield if there's more to do (or we were notified while running)
+    bool expected = true;
+    if (notified.compare_exchange_strong(expected, false) ||
+        queueSize() > 0) {
+        wakeUp();
+    }
+    return true;
+}
+
+void CheckpointRemovalTask::schedule(Vbid vbid) {
+    {
+        std::lock_guard<std::mutex> lh(queueLock);
+        if (!queuedVbuckets.insert(vbid).second) {
+            // Already queued (and so the task is already notified)
+            return;
+        }
+        queue.push(vbid);
+    }
+
+    bool expected = false;
+    if (notified.compare_exchange_strong(expected, true)) {
+        ExecutorPool::get()->wake(getId());
+    }
+}
+
+bool CheckpointRemovalTask::queuePop(Vbid& vbid) {
+    std::lock_guard<std::mutex> lh(queueLock);
+    if (queue.empty()) {
+        return false;
+    }
+    vbid = queue.front();
+    queue.pop();
+    queuedVbuckets.erase(vbid);
+    return true;
+}
@@ -18,6 +18,12 @@
 
 #include "globaltask.h"
 
+#include <memcached/vbucket.h>
+
+#include <mutex>
+#include <queue>
+#include <unordered_set>
+
 class EPStats;
 class EventuallyPersistentEngine;
 
@@ -67,3 +73,55 @@ private:
     size_t                     sleepTime;
     std::atomic<bool>          available;
 };
+
+/**
+ * Frees the closed unreferenced checkpoints of the vbuckets it's told
+ * about (when chk_remover_event_driven is enabled), so that the memory is
+ * released as soon as the last cursor leaves a closed checkpoint instead
+ * of at the next run of the ClosedUnrefCheckpointRemoverTask (which keeps
+ * running as a safety net).
+ *
+ * The vbuckets are queued by the front end (and the flusher) paths which
+ * move the cursors; the checkpoints are freed on this task, at most
+ * chk_remover_batch_size vbuckets per run before it yields.
+ */
+class CheckpointRemovalTask : public GlobalTask {
+public:
+    CheckpointRemovalTask(EventuallyPersistentEngine& e, EPStats& st);
+
+    bool run() override;
+
+    std::string getDescription() override {
+        return "Removing unreferenced checkpoints of notified vbuckets";
+    }
+
+    std::chrono::microseconds maxExpectedDuration() override {
+        // Same as the visitor of the periodic task (which visits the
+        // vbuckets the same way), and we visit at most a batch
+        return std::chrono::milliseconds(50);
+    }
+
+    /**
+     * Queue the vbucket for checkpoint removal (if it isn't already
+     * queued) and wake the task
+     */
+    void schedule(Vbid vbid);
+
+    /// Returns the number of vbuckets waiting for checkpoint removal
+    size_t queueSize() const {
+        std::lock_guard<std::mutex> lh(queueLock);
+        return queue.size();
+    }
+
+private:
+    bool queuePop(Vbid& vbid);
+
+    EPStats& stats;
+
+    /// Guards queue && queuedVbuckets
+    mutable std::mutex queueLock;
+    std::queue<Vbid> queue;
+    std::unordered_set<Vbid> queuedVbuckets;
+
+    std::atomic<bool> notified;
+};
@@ -0,0 +1,426 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+/**
+ * A queue which stores its elements in fixed size arrays (chunks) linked
+ * together, used for the Checkpoint queue.
+ *
+ * Compared to a std::list it needs one allocation per ChunkCapacity
+ * elements instead of one per element and iterating over it walks along
+ * an array, and it still provides what the Checkpoint needs from the list:
+ *
+ *  - Iterators (i.e. cursor positions and the keyIndex entries) stay valid
+ *    when elements are added or removed elsewhere in the queue.
+ *  - Elements may be removed from the middle of the queue (de-duplication).
+ *    As we can't shift the elements the erased element is left behind as a
+ *    default constructed (null) T, which the CheckpointIterator skips. The
+ *    one exception is the last element, which is removed so its slot is
+ *    reused by the next push_back.
+ *  - The elements before a position may be moved to a new queue (expel).
+ *    The whole chunks before the position are handed over to the new queue
+ *    without touching the elements.
+ *
+ * T must be a nullable type which is cheap to default construct, such as a
+ * smart pointer. The chunks are allocated through Allocator (rebound to the
+ * chunk type) so they may be accounted for by a MemoryTrackingAllocator.
+ */
+template <typename T,
+          typename Allocator = std::allocator<T>,
+          size_t ChunkCapacity = 32>
+class ChunkedQueue {
+    struct Chunk {
+        Chunk* prev = nullptr;
+        Chunk* next = nullptr;
+        /// The first used slot
+        uint32_t begin = 0;
+        /// One past the last used slot
+        uint32_t end = 0;
+        T slots[ChunkCapacity];
+    };
+
+    using ChunkAllocator = typename std::allocator_traits<
+            Allocator>::template rebind_alloc<Chunk>;
+    using ChunkTraits = std::allocator_traits<ChunkAllocator>;
+
+public:
+    using value_type = T;
+    using allocator_type = Allocator;
+    using size_type = size_t;
+    using difference_type = ptrdiff_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using pointer = T*;
+    using const_pointer = const T*;
+
+    template <bool Const>
+    class Iterator {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = ptrdiff_t;
+        using pointer = std::conditional_t<Const, const T*, T*>;
+        using reference = std::conditional_t<Const, const T&, T&>;
+
+        Iterator() = default;
+
+        /// Allow an iterator to be converted to a const_iterator
+        template <bool C = Const, typename = std::enable_if_t<C>>
+        Iterator(const Iterator<false>& other)
+            : queue(other.queue), chunk(other.chunk), index(other.index) {
+        }
+
+        reference operator*() const {
+            return chunk->slots[index];
+        }
+
+        pointer operator->() const {
+            return &chunk->slots[index];
+        }
+
+        Iterator& operator++() {
+            if (++index == chunk->end) {
+                chunk = chunk->next;
+                index = chunk ? chunk->begin : 0;
+            }
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            auto ret = *this;
+            operator++();
+            return ret;
+        }
+
+        Iterator& operator--() {
+            if (chunk == nullptr) {
+                chunk = queue->tail;
+                index = chunk->end - 1;
+            } else if (index == chunk->begin) {
+                chunk = chunk->prev;
+                index = chunk->end - 1;
+            } else {
+                --index;
+            }
+            return *this;
+        }
+
+        Iterator operator--(int) {
+            auto ret = *this;
+            operator--();
+            return ret;
+        }
+
+        bool operator==(const Iterator& other) const {
+            return chunk == other.chunk && index == other.index;
+        }
+
+        bool operator!=(const Iterator& other) const {
+            return !operator==(other);
+        }
+
+    private:
+        friend class ChunkedQueue;
+        template <bool>
+        friend class Iterator;
+
+        Iterator(const ChunkedQueue* queue, Chunk* chunk, size_t index)
+            : queue(queue), chunk(chunk), index(index) {
+        }
+
+        /// Only used to step back from end()
+        const ChunkedQueue* queue = nullptr;
+        /// The chunk of the element, nullptr for end()
+        Chunk* chunk = nullptr;
+        size_t index = 0;
+    };
+
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    /**
+     * A compact reference to an element (its chunk and slot) for indexes
+     * over the queue, which is half the size of an iterator. Like an
+     * iterator it stays valid until the element is erased or moved to
+     * another queue.
+     */
+    class Position {
+    public:
+        Position() = default;
+
+        bool operator==(const Position& other) const {
+            return chunk == other.chunk && index == other.index;
+        }
+
+    private:
+        friend class ChunkedQueue;
+
+        Position(Chunk* chunk, uint32_t index) : chunk(chunk), index(index) {
+        }
+
+        Chunk* chunk = nullptr;
+        uint32_t index = 0;
+    };
+
+    explicit ChunkedQueue(const Allocator& alloc = Allocator()) : alloc(alloc) {
+    }
+
+    ChunkedQueue(const ChunkedQueue&) = delete;
+    ChunkedQueue& operator=(const ChunkedQueue&) = delete;
+
+    ChunkedQueue(ChunkedQueue&& other) noexcept : alloc(other.alloc) {
+        steal(other);
+    }
+
+    /// Moves the elements and the allocator of other into this queue
+    ChunkedQueue& operator=(ChunkedQueue&& other) noexcept {
+        if (this != &other) {
+            clear();
+            alloc = other.alloc;
+            steal(other);
+        }
+        return *this;
+    }
+
+    ~ChunkedQueue() {
+        clear();
+    }
+
+    allocator_type get_allocator() const {
+        return alloc;
+    }
+
+    iterator begin() {
+        return iterator(this, firstChunk(), head ? head->begin : 0);
+    }
+
+    const_iterator begin() const {
+        return const_iterator(this, firstChunk(), head ? head->begin : 0);
+    }
+
+    iterator end() {
+        return iterator(this, nullptr, 0);
+    }
+
+    const_iterator end() const {
+        return const_iterator(this, nullptr, 0);
+    }
+
+    /// Get the Position of the element at pos (which must not be end())
+    Position getPosition(const_iterator pos) const {
+        return Position(pos.chunk, uint32_t(pos.index));
+    }
+
+    /// Get the element at the given Position
+    const_reference at(Position pos) const {
+        return pos.chunk->slots[pos.index];
+    }
+
+    /// Get an iterator to the element at the given Position
+    iterator getIterator(Position pos) {
+        return iterator(this, pos.chunk, pos.index);
+    }
+
+    /// The number of elements, not including the erased elements
+    size_type size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    /// The number of erased elements still held in the queue
+    size_type getNumErased() const {
+        return erased;
+    }
+
+    /// The memory allocated for the chunks of the queue
+    size_t getMemoryUsage() const {
+        return chunks * sizeof(Chunk);
+    }
+
+    /// The memory allocated by a queue which had n elements pushed to it
+    static constexpr size_t getMemoryUsageFor(size_type n) {
+        return ((n + ChunkCapacity - 1) / ChunkCapacity) * sizeof(Chunk);
+    }
+
+    void push_back(const T& value) {
+        emplace_back(value);
+    }
+
+    void push_back(T&& value) {
+        emplace_back(std::move(value));
+    }
+
+    template <typename... Args>
+    void emplace_back(Args&&... args) {
+        if (tail == nullptr || tail->end == ChunkCapacity) {
+            appendChunk();
+        }
+        tail->slots[tail->end] = T(std::forward<Args>(args)...);
+        ++tail->end;
+        ++count;
+    }
+
+    /**
+     * Erase the element at pos. Iterators to the other elements stay
+     * valid.
+     */
+    void erase(const_iterator pos) {
+        auto* chunk = pos.chunk;
+        chunk->slots[pos.index] = T();
+        --count;
+
+        if (chunk != tail || pos.index + 1 != chunk->end) {
+            // Leave the null element behind
+            ++erased;
+            return;
+        }
+
+        // The last element; give the slot back
+        --chunk->end;
+        if (chunk->begin == chunk->end) {
+            if (chunk == head) {
+                chunk->begin = chunk->end = 0;
+            } else {
+                tail = chunk->prev;
+                tail->next = nullptr;
+                freeChunk(chunk);
+            }
+        }
+    }
+
+    /**
+     * Move the elements before pos (not including any erased elements
+     * still held in whole chunks) to a new queue, which shares our
+     * allocator. Iterators to pos and the elements after it stay valid.
+     */
+    ChunkedQueue splitFront(const_iterator pos) {
+        ChunkedQueue front(alloc);
+
+        // Hand over the whole chunks before pos
+        while (head != nullptr && head != pos.chunk) {
+            auto* chunk = head;
+            head = chunk->next;
+            if (head) {
+                head->prev = nullptr;
+            } else {
+                tail = nullptr;
+            }
+            --chunks;
+
+            size_type live = 0;
+            for (auto ii = chunk->begin; ii < chunk->end; ++ii) {
+                if (chunk->slots[ii]) {
+                    ++live;
+                }
+            }
+            count -= live;
+            erased -= (chunk->end - chunk->begin) - live;
+            front.linkChunk(chunk);
+            front.count += live;
+            front.erased += (chunk->end - chunk->begin) - live;
+        }
+
+        // And move the elements of pos' chunk before it
+        if (head != nullptr) {
+            for (auto ii = head->begin; ii < pos.index; ++ii) {
+                auto& slot = head->slots[ii];
+                if (slot) {
+                    front.push_back(std::move(slot));
+                    slot = T();
+                    --count;
+                } else {
+                    --erased;
+                }
+            }
+            head->begin = uint32_t(pos.index);
+        }
+
+        return front;
+    }
+
+    void clear() {
+        while (head != nullptr) {
+            auto* chunk = head;
+            head = chunk->next;
+            freeChunk(chunk);
+        }
+        tail = nullptr;
+        count = 0;
+        erased = 0;
+    }
+
+private:
+    /// The chunk begin() points to, nullptr if there are no elements
+    Chunk* firstChunk() const {
+        return (head && head->begin != head->end) ? head : nullptr;
+    }
+
+    void appendChunk() {
+        ChunkAllocator chunkAlloc(alloc);
+        auto* chunk = ChunkTraits::allocate(chunkAlloc, 1);
+        ::new (chunk) Chunk();
+        linkChunk(chunk);
+    }
+
+    void linkChunk(Chunk* chunk) {
+        chunk->prev = tail;
+        chunk->next = nullptr;
+        if (tail) {
+            tail->next = chunk;
+        } else {
+            head = chunk;
+        }
+        tail = chunk;
+        ++chunks;
+    }
+
+    void freeChunk(Chunk* chunk) {
+        ChunkAllocator chunkAlloc(alloc);
+        chunk->~Chunk();
+        ChunkTraits::deallocate(chunkAlloc, chunk, 1);
+        --chunks;
+    }
+
+    void steal(ChunkedQueue& other) {
+        head = std::exchange(other.head, nullptr);
+        tail = std::exchange(other.tail, nullptr);
+        chunks = std::exchange(other.chunks, 0);
+        count = std::exchange(other.count, 0);
+        erased = std::exchange(other.erased, 0);
+    }
+
+    Allocator alloc;
+    Chunk* head = nullptr;
+    Chunk* tail = nullptr;
+    /// The number of chunks allocated
+    size_t chunks = 0;
+    /// The number of elements, not including the erased ones
+    size_type count = 0;
+    /// The number of erased elements left in the chunks
+    size_type erased = 0;
+};
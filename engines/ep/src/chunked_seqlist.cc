@@ -0,0 +1,808 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "chunked_seqlist.h"
+#include "bucket_logger.h"
+#include "item.h"
+#include "stats.h"
+
+#include <memcached/vbucket.h>
+
+#include <algorithm>
+#include <mutex>
+
+ChunkedSeqList::ChunkedSeqList(Vbid vbucketId, EPStats& st)
+    : SequenceList(),
+      readRange(0, 0),
+      staleSize(0),
+      staleMetaDataSize(0),
+      highSeqno(0),
+      highestDedupedSeqno(0),
+      highestPurgedDeletedSeqno(0),
+      numStaleItems(0),
+      numDeletedItems(0),
+      vbid(vbucketId),
+      st(st) {
+}
+
+ChunkedSeqList::~ChunkedSeqList() {
+    /* Delete stale items here, other items are deleted by the hash
+       table */
+    std::lock_guard<std::mutex> writeGuard(getListWriteLock());
+    for (auto& chunk : chunks) {
+        for (size_t slot = 0; slot < chunk.second->used; ++slot) {
+            auto* v = chunk.second->slots[slot];
+            if (v && v->isStale(writeGuard)) {
+                st.coreLocal.get()->currentSize.fetch_sub(v->metaDataSize());
+                StoredValue::UniquePtr owned(v);
+            }
+        }
+    }
+    chunks.clear();
+}
+
+void ChunkedSeqList::appendToList(std::lock_guard<std::mutex>& seqLock,
+                                  std::lock_guard<std::mutex>& writeLock,
+                                  OrderedStoredValue& v) {
+    append_UNLOCKED(v);
+}
+
+SequenceList::UpdateStatus ChunkedSeqList::updateListElem(
+        std::lock_guard<std::mutex>& seqLock,
+        std::lock_guard<std::mutex>& writeLock,
+        OrderedStoredValue& v) {
+    /* Lock that needed for consistent read of SeqRange 'readRange' */
+    std::lock_guard<SpinLock> lh(rangeLock);
+
+    if (readRange.fallsInRange(v.getBySeqno()) ||
+        purgeRange.fallsInRange(v.getBySeqno())) {
+        /* Range read is in middle of a point-in-time snapshot (or the purger
+           is iterating over the element), hence we cannot move the element to
+           the end of the list. Return a temp failure */
+        return UpdateStatus::Append;
+    }
+
+    /* Since there is no other reads or writes happenning in this range, we can
+       move the item to the end of the list */
+    auto pos = find_UNLOCKED(v);
+    erase_UNLOCKED(pos);
+    append_UNLOCKED(v);
+
+    return UpdateStatus::Success;
+}
+
+std::tuple<ENGINE_ERROR_CODE, std::vector<UniqueItemPtr>, seqno_t>
+ChunkedSeqList::rangeRead(seqno_t start, seqno_t end) {
+    if ((start > end) || (start <= 0)) {
+        EP_LOG_WARN(
+                "ChunkedSeqList::rangeRead(): ({}) ERANGE: start {} > end {}",
+                vbid,
+                start,
+                end);
+        return std::make_tuple(ENGINE_ERANGE, std::vector<UniqueItemPtr>(), 0);
+    }
+
+    ReadRanges::iterator range;
+    Position pos;
+    {
+        std::lock_guard<std::mutex> listWriteLg(getListWriteLock());
+        std::lock_guard<SpinLock> lh(rangeLock);
+        if (start > highSeqno) {
+            EP_LOG_WARN(
+                    "ChunkedSeqList::rangeRead(): "
+                    "({}) ERANGE: start {} > highSeqno {}",
+                    vbid,
+                    start,
+                    static_cast<seqno_t>(highSeqno));
+            /* If the request is for an invalid range, return before iterating
+               through the list */
+            return std::make_tuple(
+                    ENGINE_ERANGE, std::vector<UniqueItemPtr>(), 0);
+        }
+
+        /* Mark the initial read range; unlike a linked list the read can
+           start at 'start' */
+        end = std::min(end, static_cast<seqno_t>(highSeqno));
+        end = std::max(end, static_cast<seqno_t>(highestDedupedSeqno));
+        range = addReadRange_UNLOCKED(start, end);
+        pos = lowerBound_UNLOCKED(start);
+    }
+
+    /* Read items in the range */
+    std::vector<UniqueItemPtr> items;
+
+    for (bool first = true;; first = false) {
+        OrderedStoredValue* osv;
+        StoredValue* replacement;
+        {
+            std::lock_guard<std::mutex> writeGuard(getListWriteLock());
+            if (!first) {
+                next_UNLOCKED(pos);
+            }
+            if (pos.chunk == chunks.end()) {
+                break;
+            }
+            osv = at(pos);
+            const auto currSeqno = osv->getBySeqno();
+            if (currSeqno > end || currSeqno < 0) {
+                /* We have read all the items in the requested range, or the
+                   osv does not yet have a valid seqno; either way we are
+                   done */
+                break;
+            }
+
+            {
+                std::lock_guard<SpinLock> lh(rangeLock);
+                setReadRangeBegin_UNLOCKED(range, currSeqno);
+            }
+
+            /* Check if this OSV has been made stale and has been superseded
+               by a newer version. If it has, and the replacement is /also/ in
+               the range we are reading, we should skip this item to avoid
+               duplicates */
+            replacement = osv->getReplacementIfStale(writeGuard);
+        }
+
+        if (replacement &&
+            replacement->toOrderedStoredValue()->getBySeqno() <= end) {
+            continue;
+        }
+
+        try {
+            items.push_back(UniqueItemPtr(osv->toItem(vbid)));
+        } catch (const std::bad_alloc&) {
+            EP_LOG_WARN(
+                    "ChunkedSeqList::rangeRead(): "
+                    "({}) ENOMEM while trying to copy "
+                    "item with seqno {} before streaming it",
+                    vbid,
+                    osv->getBySeqno());
+            std::lock_guard<SpinLock> lh(rangeLock);
+            removeReadRange_UNLOCKED(range);
+            return std::make_tuple(
+                    ENGINE_ENOMEM, std::vector<UniqueItemPtr>(), 0);
+        }
+    }
+
+    /* Done with range read, remove the range */
+    {
+        std::lock_guard<SpinLock> lh(rangeLock);
+        removeReadRange_UNLOCKED(range);
+    }
+
+    /* Return all the range read items */
+    return std::make_tuple(ENGINE_SUCCESS, std::move(items), end);
+}
+
+void ChunkedSeqList::updateHighSeqno(std::lock_guard<std::mutex>& listWriteLg,
+                                     const OrderedStoredValue& v) {
+    if (v.getBySeqno() < 1) {
+        throw std::invalid_argument(
+                "ChunkedSeqList::updateHighSeqno(): " + vbid.to_string() +
+                "; Cannot set the highSeqno to a value " +
+                std::to_string(v.getBySeqno()) + " which is < 1");
+    }
+    highSeqno = v.getBySeqno();
+}
+
+void ChunkedSeqList::updateHighestDedupedSeqno(
+        std::lock_guard<std::mutex>& listWriteLg, const OrderedStoredValue& v) {
+    if (v.getBySeqno() < 1) {
+        throw std::invalid_argument(
+                "ChunkedSeqList::updateHighestDedupedSeqno(): " +
+                vbid.to_string() +
+                "; Cannot set the highestDedupedSeqno to "
+                "a value " +
+                std::to_string(v.getBySeqno()) + " which is < 1");
+    }
+    highestDedupedSeqno = v.getBySeqno();
+}
+
+void ChunkedSeqList::markItemStale(std::lock_guard<std::mutex>& listWriteLg,
+                                   StoredValue::UniquePtr ownedSv,
+                                   StoredValue* newSv) {
+    /* Release the StoredValue as the list does not want it to be of owned
+       type */
+    StoredValue* v = ownedSv.release().get();
+
+    /* Update the stats tracking the memory owned by the list */
+    staleSize.fetch_add(v->size());
+    staleMetaDataSize.fetch_add(v->metaDataSize());
+    st.coreLocal.get()->currentSize.fetch_add(v->metaDataSize());
+
+    ++numStaleItems;
+    v->toOrderedStoredValue()->markStale(listWriteLg, newSv);
+}
+
+size_t ChunkedSeqList::purgeTombstones(
+        seqno_t purgeUpToSeqno,
+        Collections::IsDroppedEphemeralCb isDroppedKeyCb,
+        std::function<bool()> shouldPause) {
+    // Purge items marked as stale from the list, with the same strategy as
+    // BasicLinkedList::purgeTombstones(): the 'purgeRange' stops front-end
+    // operations from moving the elements ahead of us, and we pause at the
+    // lowest range read in progress. The writeLock is taken (and released)
+    // for each element, to step to it and to remove it.
+    std::unique_lock<std::mutex> purgeGuard(purgeLock, std::try_to_lock);
+    if (!purgeGuard) {
+        return 0;
+    }
+
+    // Determine the start
+    Position pos;
+    {
+        std::lock_guard<std::mutex> writeGuard(getListWriteLock());
+        pos = pausedPurgeSeqno ? lowerBound_UNLOCKED(pausedPurgeSeqno)
+                               : begin_UNLOCKED();
+        pausedPurgeSeqno = 0;
+        if (pos.chunk == chunks.end() ||
+            at(pos)->getBySeqno() > purgeUpToSeqno) {
+            /* Nothing to purge */
+            return 0;
+        }
+
+        // Update purgeRange
+        std::lock_guard<SpinLock> rangeGuard(rangeLock);
+        const auto startSeqno = at(pos)->getBySeqno();
+        if (isInRangeRead_UNLOCKED(startSeqno)) {
+            // A range read is yet to pass the start; try again later
+            pausedPurgeSeqno = startSeqno;
+            return 0;
+        }
+        purgeRange = SeqRange(startSeqno, purgeUpToSeqno);
+    }
+
+    size_t purgedCount = 0;
+    for (;;) {
+        OrderedStoredValue* osv;
+        seqno_t seqno;
+        bool stale;
+        {
+            std::lock_guard<std::mutex> writeGuard(getListWriteLock());
+            if (pos.chunk == chunks.end()) {
+                break;
+            }
+            osv = at(pos);
+            seqno = osv->getBySeqno();
+            if (seqno > purgeUpToSeqno ||
+                seqno <= 0 /* last item with no valid seqno yet */) {
+                break;
+            }
+
+            {
+                // As we move past the items in the list, increment the begin
+                // of 'purgeRange' to reduce the window of creating stale items
+                // during updates
+                std::lock_guard<SpinLock> rangeGuard(rangeLock);
+                if (isInRangeRead_UNLOCKED(seqno)) {
+                    // Caught up with a range read; resume behind it next time
+                    pausedPurgeSeqno = seqno;
+                    break;
+                }
+                purgeRange.setBegin(seqno);
+            }
+            stale = osv->isStale(writeGuard);
+        }
+
+        bool isDropped = false;
+        if (!stale && isDroppedKeyCb) {
+            isDropped = isDroppedKeyCb(osv->getKey(), seqno);
+        }
+
+        StoredValue::UniquePtr purged;
+        {
+            std::lock_guard<std::mutex> writeGuard(getListWriteLock());
+            auto chunk = pos.chunk;
+            bool chunkFreed = false;
+            // Only stale or dropped items are purged.
+            if (stale || isDropped) {
+                {
+                    // Unless a range read has just started over it
+                    std::lock_guard<SpinLock> rangeGuard(rangeLock);
+                    if (isInRangeRead_UNLOCKED(seqno)) {
+                        pausedPurgeSeqno = seqno;
+                        break;
+                    }
+                }
+                chunkFreed = erase_UNLOCKED(pos);
+                purged.reset(osv);
+            } else {
+                next_UNLOCKED(pos);
+            }
+            // Compact the chunk we have moved past
+            if (!chunkFreed && pos.chunk != chunk) {
+                compact_UNLOCKED(chunk);
+            }
+        }
+
+        if (purged) {
+            if (stale) {
+                /* Update the stats tracking the memory owned by the list */
+                staleSize.fetch_sub(purged->size());
+                staleMetaDataSize.fetch_sub(purged->metaDataSize());
+                --numStaleItems;
+            }
+
+            st.coreLocal.get()->currentSize.fetch_sub(purged->metaDataSize());
+
+            if (purged->isDeleted()) {
+                --numDeletedItems;
+                highestPurgedDeletedSeqno =
+                        std::max(seqno_t(highestPurgedDeletedSeqno), seqno);
+            }
+            purged.reset();
+            ++purgedCount;
+        }
+
+        if (shouldPause()) {
+            pausedPurgeSeqno = seqno + 1;
+            break;
+        }
+    }
+
+    // Complete; reset the purgeRange.
+    {
+        std::lock_guard<SpinLock> lh(rangeLock);
+        purgeRange.reset();
+    }
+    return purgedCount;
+}
+
+void ChunkedSeqList::updateNumDeletedItems(bool oldDeleted, bool newDeleted) {
+    if (oldDeleted && !newDeleted) {
+        --numDeletedItems;
+    } else if (!oldDeleted && newDeleted) {
+        ++numDeletedItems;
+    }
+}
+
+uint64_t ChunkedSeqList::getNumStaleItems() const {
+    return numStaleItems;
+}
+
+size_t ChunkedSeqList::getStaleValueBytes() const {
+    return staleSize;
+}
+
+size_t ChunkedSeqList::getStaleMetadataBytes() const {
+    return staleMetaDataSize;
+}
+
+uint64_t ChunkedSeqList::getNumDeletedItems() const {
+    std::lock_guard<std::mutex> lckGd(getListWriteLock());
+    return numDeletedItems;
+}
+
+uint64_t ChunkedSeqList::getNumItems() const {
+    std::lock_guard<std::mutex> lckGd(getListWriteLock());
+    return numItems;
+}
+
+uint64_t ChunkedSeqList::getHighSeqno() const {
+    std::lock_guard<std::mutex> lckGd(getListWriteLock());
+    return highSeqno;
+}
+
+uint64_t ChunkedSeqList::getHighestDedupedSeqno() const {
+    std::lock_guard<std::mutex> lckGd(getListWriteLock());
+    return highestDedupedSeqno;
+}
+
+seqno_t ChunkedSeqList::getHighestPurgedDeletedSeqno() const {
+    return highestPurgedDeletedSeqno;
+}
+
+uint64_t ChunkedSeqList::getRangeReadBegin() const {
+    std::lock_guard<SpinLock> lh(rangeLock);
+    return readRange.getBegin();
+}
+
+uint64_t ChunkedSeqList::getRangeReadEnd() const {
+    std::lock_guard<SpinLock> lh(rangeLock);
+    return readRange.getEnd();
+}
+
+std::mutex& ChunkedSeqList::getListWriteLock() const {
+    return writeLock;
+}
+
+boost::optional<SequenceList::RangeIterator> ChunkedSeqList::makeRangeIterator(
+        bool isBackfill) {
+    auto pRangeItr = RangeIteratorChunked::create(*this, isBackfill);
+    return pRangeItr ? RangeIterator(std::move(pRangeItr))
+                     : boost::optional<SequenceList::RangeIterator>{};
+}
+
+void ChunkedSeqList::dump() const {
+    std::cerr << *this << std::endl;
+}
+
+std::ostream& operator<<(std::ostream& os, const ChunkedSeqList& list) {
+    os << "ChunkedSeqList[" << &list << "] with numItems:" << list.numItems
+       << " chunks:" << list.chunks.size()
+       << " deletedItems:" << list.numDeletedItems
+       << " staleItems:" << list.getNumStaleItems()
+       << " highPurgeSeqno:" << list.getHighestPurgedDeletedSeqno()
+       << " elements:[" << std::endl;
+    size_t count = 0;
+    for (const auto& chunk : list.chunks) {
+        for (size_t slot = 0; slot < chunk.second->used; ++slot) {
+            if (const auto* val = chunk.second->slots[slot]) {
+                os << "    " << *val << std::endl;
+                ++count;
+            }
+        }
+    }
+    os << "] (count:" << count << ")";
+    return os;
+}
+
+ChunkedSeqList::Position ChunkedSeqList::begin_UNLOCKED() {
+    Position pos{chunks.begin(), 0};
+    skipHoles_UNLOCKED(pos);
+    return pos;
+}
+
+OrderedStoredValue* ChunkedSeqList::back_UNLOCKED() {
+    for (auto chunk = chunks.rbegin(); chunk != chunks.rend(); ++chunk) {
+        for (auto slot = chunk->second->used; slot > 0; --slot) {
+            if (auto* v = chunk->second->slots[slot - 1]) {
+                return v;
+            }
+        }
+    }
+    return nullptr;
+}
+
+void ChunkedSeqList::skipHoles_UNLOCKED(Position& pos) {
+    while (pos.chunk != chunks.end()) {
+        const auto& chunk = *pos.chunk->second;
+        while (pos.slot < chunk.used && chunk.slots[pos.slot] == nullptr) {
+            ++pos.slot;
+        }
+        if (pos.slot < chunk.used) {
+            return;
+        }
+        ++pos.chunk;
+        pos.slot = 0;
+    }
+}
+
+void ChunkedSeqList::next_UNLOCKED(Position& pos) {
+    ++pos.slot;
+    skipHoles_UNLOCKED(pos);
+}
+
+ChunkedSeqList::Position ChunkedSeqList::lowerBound_UNLOCKED(seqno_t seqno) {
+    /* The last chunk which can hold the seqno; the next one only has higher
+       seqnos */
+    auto chunk = chunks.upper_bound(seqno);
+    if (chunk != chunks.begin()) {
+        --chunk;
+    }
+    Position pos{chunk, 0};
+    skipHoles_UNLOCKED(pos);
+    while (pos.chunk != chunks.end() && at(pos)->getBySeqno() < seqno) {
+        next_UNLOCKED(pos);
+    }
+    return pos;
+}
+
+ChunkedSeqList::Position ChunkedSeqList::find_UNLOCKED(
+        const OrderedStoredValue& v) {
+    auto findIn = [&v](Chunks::iterator chunk) -> boost::optional<Position> {
+        const auto& slots = chunk->second->slots;
+        const auto last = slots.begin() + chunk->second->used;
+        const auto slot = std::find(slots.begin(), last, &v);
+        if (slot == last) {
+            return {};
+        }
+        return Position{chunk, size_t(slot - slots.begin())};
+    };
+
+    auto chunk = chunks.upper_bound(v.getBySeqno());
+    if (chunk != chunks.begin()) {
+        if (auto pos = findIn(std::prev(chunk))) {
+            return *pos;
+        }
+    }
+    /* An element is looked up by its seqno before it is updated; one yet to
+       get a (valid) seqno can be anywhere past it */
+    for (; chunk != chunks.end(); ++chunk) {
+        if (auto pos = findIn(chunk)) {
+            return *pos;
+        }
+    }
+    throw std::logic_error("ChunkedSeqList::find_UNLOCKED(): " +
+                           vbid.to_string() + "; element with seqno " +
+                           std::to_string(v.getBySeqno()) +
+                           " is not in the list");
+}
+
+void ChunkedSeqList::append_UNLOCKED(OrderedStoredValue& v) {
+    if (chunks.empty() || chunks.rbegin()->second->used == ChunkSize) {
+        /* The element (and those after it) will get a seqno above highSeqno,
+           while all those before have a seqno up to it */
+        seqno_t lowerBound = highSeqno + 1;
+        if (!chunks.empty()) {
+            lowerBound = std::max(lowerBound, chunks.rbegin()->first + 1);
+        }
+        chunks.emplace_hint(
+                chunks.end(), lowerBound, std::make_unique<Chunk>());
+    }
+    auto& tail = *chunks.rbegin()->second;
+    tail.slots[tail.used++] = &v;
+    ++tail.live;
+    ++numItems;
+}
+
+bool ChunkedSeqList::erase_UNLOCKED(Position& pos) {
+    const auto chunk = pos.chunk;
+    chunk->second->slots[pos.slot] = nullptr;
+    --chunk->second->live;
+    --numItems;
+    next_UNLOCKED(pos);
+
+    /* No range read (nor the purger) can be in a chunk without an element
+       left */
+    if (chunk->second->live == 0 && std::next(chunk) != chunks.end()) {
+        chunks.erase(chunk);
+        return true;
+    }
+    return false;
+}
+
+void ChunkedSeqList::compact_UNLOCKED(Chunks::iterator chunk) {
+    const auto next = std::next(chunk);
+    if (next == chunks.end()) {
+        return;
+    }
+
+    {
+        /* A range read may be at (or move to) any element at or past the
+           lowest begin of the range reads, which mustn't move */
+        std::lock_guard<SpinLock> lh(rangeLock);
+        if (readRange.getBegin() > 0 && readRange.getBegin() < next->first) {
+            return;
+        }
+    }
+
+    auto& c = *chunk->second;
+    if (c.live < c.used) {
+        const auto first = c.slots.begin();
+        c.used = uint32_t(std::remove(first, first + c.used, nullptr) - first);
+    }
+
+    if (chunk != chunks.begin()) {
+        auto& prev = *std::prev(chunk)->second;
+        if (prev.used + c.used <= ChunkSize) {
+            std::copy(c.slots.begin(),
+                      c.slots.begin() + c.used,
+                      prev.slots.begin() + prev.used);
+            prev.used += c.used;
+            prev.live += c.live;
+            chunks.erase(chunk);
+        }
+    }
+}
+
+ChunkedSeqList::ReadRanges::iterator ChunkedSeqList::addReadRange_UNLOCKED(
+        seqno_t begin, seqno_t end) {
+    auto range = readRanges.emplace(readRanges.end(), begin, end);
+    updateReadRange_UNLOCKED();
+    return range;
+}
+
+void ChunkedSeqList::setReadRangeBegin_UNLOCKED(ReadRanges::iterator range,
+                                                seqno_t begin) {
+    const auto prevBegin = range->getBegin();
+    range->setBegin(begin);
+    /* Only the lowest range read moves the begin of readRange */
+    if (prevBegin == readRange.getBegin()) {
+        updateReadRange_UNLOCKED();
+    }
+}
+
+void ChunkedSeqList::removeReadRange_UNLOCKED(ReadRanges::iterator range) {
+    readRanges.erase(range);
+    updateReadRange_UNLOCKED();
+}
+
+void ChunkedSeqList::updateReadRange_UNLOCKED() {
+    if (readRanges.empty()) {
+        readRange.reset();
+        return;
+    }
+    seqno_t begin = readRanges.front().getBegin();
+    seqno_t end = readRanges.front().getEnd();
+    for (const auto& range : readRanges) {
+        begin = std::min(begin, range.getBegin());
+        end = std::max(end, range.getEnd());
+    }
+    readRange = SeqRange(begin, end);
+}
+
+std::unique_ptr<ChunkedSeqList::RangeIteratorChunked>
+ChunkedSeqList::RangeIteratorChunked::create(ChunkedSeqList& list,
+                                             bool isBackfill) {
+    /* Note: cannot use std::make_unique because the constructor of
+       RangeIteratorChunked is private */
+    return std::unique_ptr<ChunkedSeqList::RangeIteratorChunked>(
+            new ChunkedSeqList::RangeIteratorChunked(list, isBackfill));
+}
+
+ChunkedSeqList::RangeIteratorChunked::RangeIteratorChunked(
+        ChunkedSeqList& list, bool isBackfill)
+    : list(list),
+      itrRange(0, 0),
+      numRemaining(0),
+      earlySnapShotEndSeqno(0),
+      isBackfill(isBackfill) {
+    std::lock_guard<std::mutex> listWriteLg(list.getListWriteLock());
+    std::lock_guard<SpinLock> lh(list.rangeLock);
+    if (list.highSeqno < 1 || list.numItems == 0) {
+        /* No need of a read range for the snapshot as there are no items;
+           Also iterator range is at default (0, 0) */
+        return;
+    }
+
+    currPos = list.begin_UNLOCKED();
+    currOsv = at(currPos);
+
+    /* Number of items that can be iterated over */
+    numRemaining = list.numItems;
+
+    /* The minimum seqno in the iterator that must be read to get a consistent
+       read snapshot */
+    earlySnapShotEndSeqno = list.highestDedupedSeqno;
+
+    /* Mark the snapshot range on the list, inclusive of the start and the
+       end */
+    const auto backSeqno = list.back_UNLOCKED()->getBySeqno();
+    readRangeIt =
+            list.addReadRange_UNLOCKED(currOsv->getBySeqno(), backSeqno);
+
+    /* As RangeIteratorLL, the range end is one past the last seqno that can
+       be read */
+    itrRange = SeqRange(currOsv->getBySeqno(), backSeqno + 1);
+
+    auto severity = isBackfill ? spdlog::level::level_enum::info
+                               : spdlog::level::level_enum::debug;
+
+    EP_LOG_FMT(severity,
+               "{} Created range iterator from {} to {}",
+               list.vbid,
+               curr(),
+               end());
+}
+
+ChunkedSeqList::RangeIteratorChunked::~RangeIteratorChunked() {
+    std::lock_guard<SpinLock> lh(list.rangeLock);
+    releaseReadRange();
+}
+
+void ChunkedSeqList::RangeIteratorChunked::releaseReadRange() {
+    if (!readRangeIt) {
+        return;
+    }
+    list.removeReadRange_UNLOCKED(*readRangeIt);
+    readRangeIt.reset();
+    auto severity = isBackfill ? spdlog::level::level_enum::info
+                               : spdlog::level::level_enum::debug;
+    EP_LOG_FMT(severity, "{} Releasing the range iterator", list.vbid);
+}
+
+OrderedStoredValue& ChunkedSeqList::RangeIteratorChunked::operator*() const {
+    if (curr() >= end()) {
+        /* We can't read beyond the range end */
+        throw std::out_of_range(
+                "ChunkedSeqList::RangeIteratorChunked::operator*()"
+                ": Trying to read beyond range end seqno " +
+                std::to_string(end()));
+    }
+    return *currOsv;
+}
+
+ChunkedSeqList::RangeIteratorChunked& ChunkedSeqList::RangeIteratorChunked::
+operator++() {
+    do {
+        incrOperatorHelper();
+        if (curr() == end()) {
+            /* iterator has gone beyond the range, just return */
+            return *this;
+        }
+    } while (itrRangeContainsAnUpdatedVersion());
+    return *this;
+}
+
+void ChunkedSeqList::RangeIteratorChunked::incrOperatorHelper() {
+    if (curr() >= end()) {
+        throw std::out_of_range(
+                "ChunkedSeqList::RangeIteratorChunked::operator++()"
+                ": Trying to move the iterator beyond range end"
+                " seqno " +
+                std::to_string(end()));
+    }
+
+    --numRemaining;
+
+    /* Increment beyond the last element indicates the end of the iteration */
+    if (curr() == back()) {
+        std::lock_guard<SpinLock> lh(list.rangeLock);
+        /* Release the read range here so that a client not deleting the
+           iterator obj doesn't protect its range on the list forever */
+        releaseReadRange();
+        itrRange.setBegin(end());
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> listWriteLg(list.getListWriteLock());
+        list.next_UNLOCKED(currPos);
+        currOsv = at(currPos);
+
+        /* As the iterator moves we reduce the snapshot range being read on the
+           list */
+        std::lock_guard<SpinLock> lh(list.rangeLock);
+        list.setReadRangeBegin_UNLOCKED(*readRangeIt, currOsv->getBySeqno());
+    }
+
+    itrRange.setBegin(currOsv->getBySeqno());
+}
+
+void ChunkedSeqList::RangeIteratorChunked::seek(seqno_t seqno) {
+    if (seqno <= curr() || curr() >= end()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> listWriteLg(list.getListWriteLock());
+        /* Any element ahead of the current position up to the end is within
+           the read range, hence it is not moved nor purged while this
+           iterator exists */
+        auto pos = list.lowerBound_UNLOCKED(seqno);
+        if (pos.chunk == list.chunks.end() || at(pos)->getBySeqno() >= end()) {
+            return;
+        }
+        currPos = pos;
+        currOsv = at(pos);
+        std::lock_guard<SpinLock> lh(list.rangeLock);
+        list.setReadRangeBegin_UNLOCKED(*readRangeIt, currOsv->getBySeqno());
+    }
+    itrRange.setBegin(currOsv->getBySeqno());
+
+    /* The items skipped aren't counted; seqnos are unique, so at most
+       end() - curr() items are left */
+    numRemaining = std::min(numRemaining, uint64_t(end() - curr()));
+
+    /* As operator++, don't stop at an item with a newer version in range */
+    if (itrRangeContainsAnUpdatedVersion()) {
+        ++(*this);
+    }
+}
+
+bool ChunkedSeqList::RangeIteratorChunked::itrRangeContainsAnUpdatedVersion() {
+    /* Check if this OSV has been made stale and has been superseded by a
+       newer version. If it has, and the replacement is /also/ in the range
+       we are reading, we should skip this item to avoid duplicates */
+    StoredValue* replacement;
+    {
+        std::lock_guard<std::mutex> writeGuard(list.getListWriteLock());
+        replacement = currOsv->getReplacementIfStale(writeGuard);
+    }
+    return (replacement != nullptr && replacement->getBySeqno() <= back());
+}
@@ -0,0 +1,396 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/**
+ * This header file contains the class definition of one of the implementation
+ * of the abstract class SequenceList
+ */
+
+#pragma once
+
+#include "atomic.h"
+#include "linked_list.h"
+#include "monotonic.h"
+#include "seqlist.h"
+#include "stored-value.h"
+
+#include <platform/non_negative_counter.h>
+#include <relaxed_atomic.h>
+
+#include <array>
+#include <list>
+#include <map>
+
+/**
+ * This class implements SequenceList as a sequence of fixed size chunks of
+ * pointers to the OrderedStoredValues, in seqno order, instead of linking the
+ * OrderedStoredValues themselves (as BasicLinkedList does). The
+ * OrderedStoredValues are then created without a SeqnoHook (see
+ * OrderedStoredValueFactory), which saves the 16 bytes of the hook for an 8
+ * byte slot per item.
+ *
+ * The chunks are kept in a map by a lower bound of the seqnos in the chunk
+ * (the seqno after the highest seqno at the time the chunk was created), so
+ * an element is found (to move it to the end of the list, as for
+ * BasicLinkedList) by scanning the one chunk which can hold its seqno, and a
+ * range iterator seeks to any seqno directly.
+ *
+ * Elements are appended to the last chunk. An element removed (moved to the
+ * end of the list, or purged) leaves a hole (null slot) in its chunk; a chunk
+ * without any element left is freed (but for the last one), and the purger
+ * compacts the chunks it has passed (moving the elements of a chunk to the
+ * start of it, and into the previous chunk if they fit) if no range read can
+ * be in them.
+ *
+ * Ownership of the OrderedStoredValues is as for BasicLinkedList: the
+ * HashTable owns the non-stale ones and the list the stale ones.
+ *
+ * Ordering/Hierarchy of Locks:
+ * ===========================
+ * As BasicLinkedList: purgeLock ==> writeLock ==> rangeLock. The chunks are
+ * only accessed with the writeLock held; a range read (or range iterator)
+ * takes it for every element it moves to. While a range read is in progress
+ * the elements in its range are not moved nor purged (and their chunks not
+ * compacted), so its position in the list remains valid between the
+ * elements.
+ */
+class ChunkedSeqList : public SequenceList {
+public:
+    /**
+     * The number of elements per chunk; with the number of slots used and the
+     * number of elements left a chunk is 2KB.
+     */
+    static const size_t ChunkSize = 255;
+
+    ChunkedSeqList(Vbid vbucketId, EPStats& st);
+
+    ~ChunkedSeqList();
+
+    void appendToList(std::lock_guard<std::mutex>& seqLock,
+                      std::lock_guard<std::mutex>& writeLock,
+                      OrderedStoredValue& v) override;
+
+    SequenceList::UpdateStatus updateListElem(
+            std::lock_guard<std::mutex>& seqLock,
+            std::lock_guard<std::mutex>& writeLock,
+            OrderedStoredValue& v) override;
+
+    std::tuple<ENGINE_ERROR_CODE, std::vector<UniqueItemPtr>, seqno_t>
+    rangeRead(seqno_t start, seqno_t end) override;
+
+    void updateHighSeqno(std::lock_guard<std::mutex>& listWriteLg,
+                         const OrderedStoredValue& v) override;
+
+    void updateHighestDedupedSeqno(std::lock_guard<std::mutex>& listWriteLg,
+                                   const OrderedStoredValue& v) override;
+
+    void markItemStale(std::lock_guard<std::mutex>& listWriteLg,
+                       StoredValue::UniquePtr ownedSv,
+                       StoredValue* newSv) override;
+
+    size_t purgeTombstones(seqno_t purgeUpToSeqno,
+                           Collections::IsDroppedEphemeralCb isDroppedKeyCb =
+                                   [](const DocKey, int64_t) { return false; },
+                           std::function<bool()> shouldPause =
+                                   []() { return false; }) override;
+
+    void updateNumDeletedItems(bool oldDeleted, bool newDeleted) override;
+
+    uint64_t getNumStaleItems() const override;
+
+    size_t getStaleValueBytes() const override;
+
+    size_t getStaleMetadataBytes() const override;
+
+    uint64_t getNumDeletedItems() const override;
+
+    uint64_t getNumItems() const override;
+
+    uint64_t getHighSeqno() const override;
+
+    uint64_t getHighestDedupedSeqno() const override;
+
+    seqno_t getHighestPurgedDeletedSeqno() const override;
+
+    uint64_t getRangeReadBegin() const override;
+
+    uint64_t getRangeReadEnd() const override;
+
+    std::mutex& getListWriteLock() const override;
+
+    boost::optional<SequenceList::RangeIterator> makeRangeIterator(
+            bool isBackfill) override;
+
+    void dump() const override;
+
+protected:
+    struct Chunk {
+        /* The elements, in seqno order; nullptr for a removed element */
+        std::array<OrderedStoredValue*, ChunkSize> slots;
+
+        /* The number of slots appended to (elements and holes) */
+        uint32_t used = 0;
+
+        /* The number of elements (non-null slots) */
+        uint32_t live = 0;
+    };
+
+    /* The chunks by a lower bound of their seqnos, in seqno order */
+    using Chunks = std::map<seqno_t, std::unique_ptr<Chunk>>;
+
+    /* The position of an element in the list; chunk is chunks.end() past the
+       last element */
+    struct Position {
+        Chunks::iterator chunk;
+        size_t slot;
+    };
+
+    /* Underlying data structure that holds the items in an Ordered Sequence.
+       Guarded by writeLock. */
+    Chunks chunks;
+
+    /* Number of elements in 'chunks'. Guarded by writeLock. */
+    size_t numItems = 0;
+
+    /**
+     * Lock that serializes all the accesses to 'chunks' + the updation of the
+     * corresponding highSeqno or the highestDedupedSeqno atomic
+     */
+    mutable std::mutex writeLock;
+
+    /* As BasicLinkedList::readRange */
+    SeqRange readRange;
+
+    using ReadRanges = std::list<SeqRange>;
+
+    /* As BasicLinkedList::readRanges */
+    ReadRanges readRanges;
+
+    /* Lock that protects readRange, readRanges and purgeRange */
+    mutable SpinLock rangeLock;
+
+    /* As BasicLinkedList::purgeRange */
+    SeqRange purgeRange{0, 0};
+
+    /* Serializes purgeTombstones() runs */
+    std::mutex purgeLock;
+
+    /* Overall memory consumed by (stale) OrderedStoredValues owned by the
+       list */
+    cb::RelaxedAtomic<size_t> staleSize;
+
+    /* Metadata memory consumed by (stale) OrderedStoredValues owned by the
+       list */
+    cb::RelaxedAtomic<size_t> staleMetaDataSize;
+
+private:
+    /// @return the element at the position. Expects writeLock to be held.
+    static OrderedStoredValue* at(const Position& pos) {
+        return pos.chunk->second->slots[pos.slot];
+    }
+
+    /// @return the position of the first element. Expects writeLock.
+    Position begin_UNLOCKED();
+
+    /// @return the last element (nullptr if none). Expects writeLock.
+    OrderedStoredValue* back_UNLOCKED();
+
+    /// Move the position past any holes. Expects writeLock.
+    void skipHoles_UNLOCKED(Position& pos);
+
+    /// Move the position to the next element. Expects writeLock.
+    void next_UNLOCKED(Position& pos);
+
+    /**
+     * @return the position of the first element with seqno >= the given one
+     *         (chunks.end() if none). Expects writeLock.
+     */
+    Position lowerBound_UNLOCKED(seqno_t seqno);
+
+    /**
+     * @return the position of the given element
+     * @throws std::logic_error if the element isn't in the list
+     * Expects writeLock.
+     */
+    Position find_UNLOCKED(const OrderedStoredValue& v);
+
+    /// Append the element to the last chunk. Expects writeLock.
+    void append_UNLOCKED(OrderedStoredValue& v);
+
+    /**
+     * Remove the element at the position, moving the position to the next
+     * element, and free the chunk if it has no element left (and isn't the
+     * last one). Expects writeLock.
+     *
+     * @return true if the chunk was freed
+     */
+    bool erase_UNLOCKED(Position& pos);
+
+    /**
+     * Remove the holes of the chunk, and merge it into the previous chunk if
+     * its elements fit there, unless a range read may be in the chunk (or it
+     * is the last one, which is appended to). Expects writeLock.
+     */
+    void compact_UNLOCKED(Chunks::iterator chunk);
+
+    /**
+     * @return true if a range read in progress may still read the element
+     *         with the given seqno. Expects rangeLock to be held.
+     */
+    bool isInRangeRead_UNLOCKED(seqno_t seqno) const {
+        return readRange.getBegin() > 0 && seqno >= readRange.getBegin();
+    }
+
+    /// As BasicLinkedList. Expects rangeLock to be held.
+    ReadRanges::iterator addReadRange_UNLOCKED(seqno_t begin, seqno_t end);
+
+    /// Expects rangeLock to be held
+    void setReadRangeBegin_UNLOCKED(ReadRanges::iterator range, seqno_t begin);
+
+    /// Expects rangeLock to be held
+    void removeReadRange_UNLOCKED(ReadRanges::iterator range);
+
+    /// Recompute readRange from readRanges. Expects rangeLock to be held.
+    void updateReadRange_UNLOCKED();
+
+    /* As BasicLinkedList::highSeqno */
+    Monotonic<seqno_t> highSeqno;
+
+    /* As BasicLinkedList::highestDedupedSeqno */
+    Monotonic<seqno_t> highestDedupedSeqno;
+
+    /* As BasicLinkedList::highestPurgedDeletedSeqno */
+    Monotonic<seqno_t> highestPurgedDeletedSeqno;
+
+    /* Number of elements in the list that are stale (and owned by the list) */
+    cb::NonNegativeCounter<uint64_t> numStaleItems;
+
+    /* Number of logically deleted items in the list */
+    cb::NonNegativeCounter<uint64_t> numDeletedItems;
+
+    /* Used only to log debug messages */
+    const Vbid vbid;
+
+    /* Ep engine stats handle to track stats */
+    EPStats& st;
+
+    /* Seqno from which the tombstone purging resumes (0 to start from the
+       first element). Guarded by purgeLock. */
+    seqno_t pausedPurgeSeqno = 0;
+
+    friend std::ostream& operator<<(std::ostream& os,
+                                    const ChunkedSeqList& list);
+
+    class RangeIteratorChunked : public SequenceList::RangeIteratorImpl {
+    public:
+        /**
+         * Method to create instances of RangeIteratorChunked. Any number of
+         * them may exist at a time, each protecting its own range of the list.
+         *
+         * @param list ref to the list on which the iterator is created
+         * @param isBackfill indicates if the iterator is for backfill (for
+         *                   debug)
+         *
+         * @return Non-null pointer
+         */
+        static std::unique_ptr<RangeIteratorChunked> create(
+                ChunkedSeqList& list, bool isBackfill);
+
+        ~RangeIteratorChunked();
+
+        OrderedStoredValue& operator*() const override;
+
+        /* Duplicate items are not returned by the iterator. That is, if there
+           multiple copies of an item in the iterator range, then only the
+           latest is returned */
+        RangeIteratorChunked& operator++() override;
+
+        seqno_t curr() const override {
+            return itrRange.getBegin();
+        }
+
+        seqno_t end() const override {
+            return itrRange.getEnd();
+        }
+
+        seqno_t back() const override {
+            return itrRange.getEnd() - 1;
+        }
+
+        uint64_t count() const override {
+            return numRemaining;
+        }
+
+        seqno_t getEarlySnapShotEnd() const override {
+            return earlySnapShotEndSeqno;
+        }
+
+        /* Jumps to the first element with a seqno >= the given one (if in the
+           range of the iterator) */
+        void seek(seqno_t seqno) override;
+
+    private:
+        /* Objects are created with create() */
+        RangeIteratorChunked(ChunkedSeqList& list, bool isBackfill);
+
+        /* Remove the range of this iterator from the list, if not done yet */
+        void releaseReadRange();
+
+        /* Moves the iterator to the next element in the list */
+        void incrOperatorHelper();
+
+        /**
+         * Indicates if there is a newer version of the curr item in the
+         * iterator range
+         *
+         * @return true if there is a newer version of item; else false
+         */
+        bool itrRangeContainsAnUpdatedVersion();
+
+        /* Ref to the list iterated by this iterator */
+        ChunkedSeqList& list;
+
+        /* The position of the current element and the element */
+        Position currPos;
+        OrderedStoredValue* currOsv = nullptr;
+
+        /* The range of this iterator registered on the list (in
+           list.readRanges), none once the iteration is done */
+        boost::optional<ReadRanges::iterator> readRangeIt;
+
+        /* Current range of the iterator (with the end one past the last
+           seqno that can be read, as RangeIteratorLL) */
+        SeqRange itrRange;
+
+        /* Number of items that can be iterated over by this (forward only)
+           iterator at that instance */
+        uint64_t numRemaining;
+
+        /* Indicates the minimum seqno in the iterator that can give a
+           consistent read snapshot */
+        seqno_t earlySnapShotEndSeqno;
+
+        /* Indicates if the range iterator is for DCP backfill
+           (for debug) */
+        bool isBackfill;
+    };
+
+    friend class RangeIteratorChunked;
+};
+
+/// Outputs a textual description of the ChunkedSeqList
+std::ostream& operator<<(std::ostream& os, const ChunkedSeqList& list);
@@ -19,7 +19,11 @@
 #include "collections/collection_persisted_stats.h"
 #include "collections/vbucket_manifest.h"
 #include "ep_bucket.h"
+#include "ep_engine.h"
+#include "ep_vb.h"
+#include "executorpool.h"
 #include "item.h"
+#include "tasks.h"
 
 void Collections::VB::Flush::saveCollectionStats(
         std::function<void(CollectionID, PersistedStats)> cb) const {
@@ -81,10 +85,30 @@ void Collections::VB::Flush::setPersistedHighSeqno(const DocKey& key,
     }
 }
 
-void Collections::VB::Flush::checkAndTriggerPurge(Vbid vbid,
+void Collections::VB::Flush::checkAndTriggerPurge(VBucket& vb,
                                                   KVBucket& bucket) const {
-    if (needsPurge) {
-        triggerPurge(vbid, bucket);
+    if (!needsPurge) {
+        return;
+    }
+
+    // Only persistent vbuckets flush
+    auto& epVb = dynamic_cast<EPVBucket&>(vb);
+    const auto itemsBefore = epVb.getNumTotalItems();
+    epVb.collectionsDropped(droppedItems);
+    ExecutorPool::get()->schedule(std::make_shared<DropCollectionKeysTask>(
+            bucket.getEPEngine(), vb.getId()));
+
+    // Rewriting the whole file to erase a few items isn't worth it, they
+    // are already invisible and are erased by the next compaction anyway
+    uint64_t dropped = 0;
+    for (const auto& entry : droppedItems) {
+        dropped += entry.second;
+    }
+    const auto threshold = bucket.getEPEngine()
+                                   .getConfiguration()
+                                   .getCollectionsDropCompactionThreshold();
+    if (dropped * 100 >= itemsBefore * threshold) {
+        triggerPurge(vb.getId(), bucket);
     }
 }
 
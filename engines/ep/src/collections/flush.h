@@ -23,6 +23,7 @@
 #include <vector>
 
 class KVBucket;
+class VBucket;
 
 namespace Collections {
 namespace VB {
@@ -73,22 +74,39 @@ public:
     void setPersistedHighSeqno(const DocKey& key, uint64_t value, bool deleted);
 
     /**
-     * Check to see if this flush should trigger a collection purge which if
-     * true schedules a task which will iterate the vbucket's documents removing
-     * those of any dropped collections. The actual task currently scheduled is
-     * compaction.
+     * Check to see if this flush persisted the drop of collections, in which
+     * case their items are removed from the vbucket's item count straight
+     * away, and a task is scheduled to remove them from its hash table
+     * (so the flusher doesn't visit it). The items on disk are already
+     * logically
+     * deleted and are erased by the next compaction of the vbucket, which is
+     * only scheduled now if they're at least
+     * collections_drop_compaction_threshold percent of its items.
      */
-    void checkAndTriggerPurge(Vbid vbid, KVBucket& bucket) const;
+    void checkAndTriggerPurge(VBucket& vb, KVBucket& bucket) const;
 
+    /**
+     * Schedule a task which will iterate the vbucket's documents removing
+     * those of any dropped collections. The actual task currently scheduled
+     * is compaction.
+     */
     static void triggerPurge(Vbid vbid, KVBucket& bucket);
 
     void setNeedsPurge() {
         needsPurge = true;
     }
 
+    /// Record the number of items of a collection dropped by this flush
+    void addDroppedItems(CollectionID cid, uint64_t count) {
+        droppedItems.emplace_back(cid, count);
+    }
+
 private:
     bool needsPurge = false;
 
+    /// The number of items of each collection dropped by this flush
+    std::vector<std::pair<CollectionID, uint64_t>> droppedItems;
+
     /**
      * Keep track of only the collections that have had a insert/delete in
      * this run of the flusher so we can flush only those collections whose
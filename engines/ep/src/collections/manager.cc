@@ -251,7 +251,10 @@ public:
 
     void visitBucket(const VBucketPtr& vb) override {
         success = vb->lockCollections().addCollectionStats(
-                          vb->getId(), cookie, add_stat) ||
+                          vb->getId(),
+                          cookie,
+                          add_stat,
+                          vb->ht.getCollectionsMemory()) ||
                   success;
     }
 
@@ -310,7 +313,10 @@ ENGINE_ERROR_CODE Collections::Manager::doCollectionStats(
                 VBucketPtr vb = bucket.getVBucket(vbid);
                 if (vb) {
                     success = vb->lockCollections().addCollectionStats(
-                            vbid, cookie, add_stat);
+                            vbid,
+                            cookie,
+                            add_stat,
+                            vb->ht.getCollectionsMemory());
                 } else {
                     return ENGINE_NOT_MY_VBUCKET;
                 }
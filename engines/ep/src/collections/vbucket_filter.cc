@@ -24,6 +24,8 @@
 #include <json_utilities.h>
 #include <nlohmann/json.hpp>
 #include <platform/checked_snprintf.h>
+
+#include <algorithm>
 #include <memory>
 
 namespace Collections {
@@ -241,6 +243,36 @@ bool Filter::remove(const Item& item) {
     }
 }
 
+boost::optional<CollectionID> Filter::getSingleCollection() const {
+    if (passthrough || scopeID || defaultAllowed || filter.size() != 1) {
+        return {};
+    }
+    return *filter.begin();
+}
+
+boost::optional<uint64_t> Filter::getHighSeqno(
+        const Manifest& manifest) const {
+    if (passthrough || scopeID) {
+        return {};
+    }
+
+    auto rh = manifest.lock();
+    uint64_t highSeqno = 0;
+    if (defaultAllowed) {
+        if (!rh.doesDefaultCollectionExist()) {
+            return {};
+        }
+        highSeqno = rh.getHighSeqno(CollectionID::Default);
+    }
+    for (const auto cid : filter) {
+        if (!rh.exists(cid)) {
+            return {};
+        }
+        highSeqno = std::max(highSeqno, rh.getHighSeqno(cid));
+    }
+    return highSeqno;
+}
+
 bool Filter::empty() const {
     if (scopeID) {
         return scopeIsDropped;
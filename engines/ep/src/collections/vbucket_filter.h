@@ -151,6 +151,22 @@ public:
         return passthrough;
     }
 
+    /**
+     * @return the collection if the filter allows one (non-default)
+     *         collection and nothing else (other than its events). A filter
+     *         of a scope may gain collections, so has no single collection.
+     */
+    boost::optional<CollectionID> getSingleCollection() const;
+
+    /**
+     * @return the highest seqno of the collections the filter allows, as
+     *         tracked by the manifest, or none if that doesn't cover all of
+     *         the items the filter may allow: a passthrough or scope filter
+     *         (which may gain collections), or a collection no longer in the
+     *         manifest (whose drop the stream must find).
+     */
+    boost::optional<uint64_t> getHighSeqno(const Manifest& manifest) const;
+
     bool allowDefaultCollection() const {
         return defaultAllowed;
     }
@@ -45,6 +45,7 @@ Manifest::Manifest(const KVStore::Manifest& data)
         scopes.insert(sid);
     }
 
+    map.reserve(data.collections.size());
     for (const auto& e : data.collections) {
         const auto& meta = e.metaData;
         addNewCollectionEntry({meta.sid, meta.cid}, meta.maxTtl, e.startSeqno);
@@ -715,6 +716,16 @@ uint64_t Manifest::getHighSeqno(CollectionID collection) const {
     return itr->second.getHighSeqno();
 }
 
+int64_t Manifest::getStartSeqno(CollectionID collection) const {
+    auto itr = map.find(collection);
+    if (itr == map.end()) {
+        throwException<std::invalid_argument>(
+                __FUNCTION__,
+                "failed find of collection:" + collection.to_string());
+    }
+    return itr->second.getStartSeqno();
+}
+
 void Manifest::setHighSeqno(CollectionID collection, uint64_t value) const {
     auto itr = map.find(collection);
     if (itr == map.end()) {
@@ -770,9 +781,11 @@ void Manifest::decrementDiskCount(CollectionID collection) const {
     return itr->second.decrementDiskCount();
 }
 
-bool Manifest::addCollectionStats(Vbid vbid,
-                                  const void* cookie,
-                                  const AddStatFn& add_stat) const {
+bool Manifest::addCollectionStats(
+        Vbid vbid,
+        const void* cookie,
+        const AddStatFn& add_stat,
+        const std::unordered_map<CollectionID, size_t>& memUsed) const {
     try {
         const int bsize = 512;
         char buffer[bsize];
@@ -790,8 +803,12 @@ bool Manifest::addCollectionStats(Vbid vbid,
         return false;
     }
     for (const auto& entry : map) {
-        if (!entry.second.addStats(
-                    entry.first.to_string(), vbid, cookie, add_stat)) {
+        const auto mem = memUsed.find(entry.first);
+        if (!entry.second.addStats(entry.first.to_string(),
+                                   vbid,
+                                   cookie,
+                                   add_stat,
+                                   mem == memUsed.end() ? 0 : mem->second)) {
             return false;
         }
     }
@@ -871,8 +888,8 @@ boost::optional<std::vector<CollectionID>> Manifest::getCollectionsForScope(
 }
 
 bool Manifest::operator==(const Manifest& rhs) const {
-    std::lock_guard<cb::ReaderLock> readLock(rwlock.reader());
-    std::lock_guard<cb::ReaderLock> otherReadLock(rhs.rwlock.reader());
+    std::shared_lock<mutex_type> readLock(rwlock);
+    std::shared_lock<mutex_type> otherReadLock(rhs.rwlock);
 
     if (rhs.map.size() != map.size()) {
         return false;
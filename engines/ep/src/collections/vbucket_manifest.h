@@ -23,9 +23,10 @@
 #include "collections/vbucket_manifest_entry.h"
 #include "systemevent.h"
 
+#include <boost/container/flat_map.hpp>
 #include <boost/optional/optional_fwd.hpp>
+#include <folly/SharedMutex.h>
 #include <platform/non_negative_counter.h>
-#include <platform/rwlock.h>
 #include <platform/sized_buffer.h>
 
 #include <functional>
@@ -33,6 +34,7 @@
 #include <list>
 #include <mutex>
 #include <set>
+#include <shared_mutex>
 #include <unordered_map>
 
 class VBucket;
@@ -53,9 +55,9 @@ namespace VB {
  * knows about.
  *
  * Each collection is represented by a Collections::VB::ManifestEntry and all of
- * the collections are stored in an unordered_map. The map is implemented to
- * allow look-up by collection-name without having to allocate a std::string,
- * callers only need a cb::const_char_buffer for look-ups.
+ * the collections are stored in a flat map (an array sorted by collection-ID),
+ * which is searched by every front end operation. The array is only changed
+ * when collections are added or dropped, under the write lock.
  *
  * The Manifest allows for an external manager to drive the lifetime of each
  * collection.
@@ -78,7 +80,20 @@ namespace VB {
  */
 class Manifest {
 public:
-    using container = ::std::unordered_map<CollectionID, ManifestEntry>;
+    /**
+     * A binary search of a contiguous array, rather than hashing and chasing
+     * the node pointers of an unordered_map, finds a collection of a bucket
+     * with many collections in a few cachelines.
+     */
+    using container = boost::container::flat_map<CollectionID, ManifestEntry>;
+
+    /**
+     * The type of the manifest lock. Readers don't write to a shared
+     * cacheline to lock it (unless a writer is waiting), so the read handles
+     * of front end operations on the same vBucket don't contend. Read
+     * priority as a thread may take a read handle while holding another.
+     */
+    using mutex_type = folly::SharedMutexReadPriority;
 
     /**
      * RAII read locking for access to the Manifest.
@@ -95,7 +110,7 @@ public:
          */
         ReadHandle() = default;
 
-        ReadHandle(const Manifest* m, cb::RWLock& lock)
+        ReadHandle(const Manifest* m, mutex_type& lock)
             : readLock(lock), manifest(m) {
         }
 
@@ -180,6 +195,10 @@ public:
             return manifest->getHighSeqno(collection);
         }
 
+        int64_t getStartSeqno(CollectionID collection) const {
+            return manifest->getStartSeqno(collection);
+        }
+
         uint64_t getPersistedHighSeqno(CollectionID collection) const {
             return manifest->getPersistedHighSeqno(collection);
         }
@@ -211,10 +230,13 @@ public:
             manifest->decrementDiskCount(collection);
         }
 
-        bool addCollectionStats(Vbid vbid,
-                                const void* cookie,
-                                const AddStatFn& add_stat) const {
-            return manifest->addCollectionStats(vbid, cookie, add_stat);
+        bool addCollectionStats(
+                Vbid vbid,
+                const void* cookie,
+                const AddStatFn& add_stat,
+                const std::unordered_map<CollectionID, size_t>& memUsed) const {
+            return manifest->addCollectionStats(
+                    vbid, cookie, add_stat, memUsed);
         }
 
         bool addScopeStats(Vbid vbid,
@@ -257,7 +279,7 @@ public:
     protected:
         friend std::ostream& operator<<(std::ostream& os,
                                         const Manifest::ReadHandle& readHandle);
-        std::unique_lock<cb::ReaderLock> readLock;
+        std::shared_lock<mutex_type> readLock;
         const Manifest* manifest;
     };
 
@@ -289,7 +311,7 @@ public:
          *        should not be allowed, whereas a disk backfill is allowed
          */
         CachingReadHandle(const Manifest* m,
-                          cb::RWLock& lock,
+                          mutex_type& lock,
                           DocKey key,
                           bool allowSystem)
             : ReadHandle(m, lock),
@@ -466,7 +488,9 @@ public:
      */
     class StatsReadHandle : private ReadHandle {
     public:
-        StatsReadHandle(const Manifest* m, cb::RWLock& lock, CollectionID cid)
+        StatsReadHandle(const Manifest* m,
+                        mutex_type& lock,
+                        CollectionID cid)
             : ReadHandle(m, lock), itr(m->getManifestIterator(cid)) {
         }
 
@@ -500,7 +524,7 @@ public:
      */
     class WriteHandle {
     public:
-        WriteHandle(Manifest& m, cb::RWLock& lock)
+        WriteHandle(Manifest& m, mutex_type& lock)
             : writeLock(lock), manifest(m) {
         }
 
@@ -641,7 +665,7 @@ public:
         }
 
     private:
-        std::unique_lock<cb::WriterLock> writeLock;
+        std::unique_lock<mutex_type> writeLock;
         Manifest& manifest;
     };
 
@@ -1033,6 +1057,12 @@ protected:
      */
     uint64_t getHighSeqno(CollectionID collection) const;
 
+    /**
+     * @return the seqno of the event which created this collection, no item
+     *         of the collection has a lower seqno
+     */
+    int64_t getStartSeqno(CollectionID collection) const;
+
     /**
      * Set the high seqno of the given collection to the given value. Allowed
      * to be const as the only constness we care about here is the state of
@@ -1108,11 +1138,14 @@ protected:
 
     /**
      * Detailed stats for this VB::Manifest
+     * @param memUsed the memory used by each collection (from the HashTable)
      * @return true if addCollectionStats was successful, false if failed.
      */
-    bool addCollectionStats(Vbid vbid,
-                            const void* cookie,
-                            const AddStatFn& add_stat) const;
+    bool addCollectionStats(
+            Vbid vbid,
+            const void* cookie,
+            const AddStatFn& add_stat,
+            const std::unordered_map<CollectionID, size_t>& memUsed) const;
 
     /**
      * Detailed stats for the scopes in this VB::Manifest
@@ -1230,7 +1263,9 @@ protected:
     }
 
     /**
-     * The current set of collections
+     * The current set of collections. Adding or dropping a collection moves
+     * the entries after it, so iterators and references to entries are only
+     * valid until the map changes.
      */
     container map;
 
@@ -1253,7 +1288,7 @@ protected:
     /**
      * shared lock to allow concurrent readers and safe updates
      */
-    mutable cb::RWLock rwlock;
+    mutable mutex_type rwlock;
 
     friend std::ostream& operator<<(std::ostream& os, const Manifest& manifest);
 
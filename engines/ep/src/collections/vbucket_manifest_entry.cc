@@ -21,6 +21,8 @@
 
 #include <platform/checked_snprintf.h>
 
+#include <algorithm>
+
 Collections::VB::ManifestEntry::ManifestEntry(
         const Collections::VB::ManifestEntry& other) {
     *this = other;
@@ -31,8 +33,8 @@ Collections::VB::ManifestEntry& Collections::VB::ManifestEntry::operator=(
     startSeqno = other.startSeqno;
     scopeID = other.scopeID;
     maxTtl = other.maxTtl;
-    diskCount = other.diskCount;
-    highSeqno.reset(other.highSeqno);
+    setDiskCount(other.getDiskCount());
+    resetHighSeqno(other.getHighSeqno());
     persistedHighSeqno.store(other.persistedHighSeqno,
                              std::memory_order_relaxed);
     return *this;
@@ -41,13 +43,46 @@ Collections::VB::ManifestEntry& Collections::VB::ManifestEntry::operator=(
 bool Collections::VB::ManifestEntry::operator==(
         const ManifestEntry& other) const {
     if (scopeID == other.scopeID && startSeqno == other.startSeqno &&
-        maxTtl == other.maxTtl && highSeqno == other.highSeqno &&
+        maxTtl == other.maxTtl && getHighSeqno() == other.getHighSeqno() &&
         persistedHighSeqno == other.persistedHighSeqno) {
         return true;
     }
     return false;
 }
 
+void Collections::VB::ManifestEntry::setDiskCount(uint64_t value) {
+    for (auto& core : coreLocal) {
+        core->diskCount = 0;
+    }
+    coreLocal.get()->diskCount = value;
+}
+
+uint64_t Collections::VB::ManifestEntry::getDiskCount() const {
+    int64_t count = 0;
+    for (const auto& core : coreLocal) {
+        count += core->diskCount;
+    }
+    // The cores are read one by one, so (as for the EPStats core local
+    // counters) the sum may be briefly negative
+    return std::max(int64_t(0), count);
+}
+
+void Collections::VB::ManifestEntry::resetHighSeqno(uint64_t value) const {
+    for (auto& core : coreLocal) {
+        core->highSeqno.reset(0, std::memory_order_relaxed);
+    }
+    coreLocal.get()->highSeqno.reset(value, std::memory_order_relaxed);
+}
+
+uint64_t Collections::VB::ManifestEntry::getHighSeqno() const {
+    uint64_t seqno = 0;
+    for (const auto& core : coreLocal) {
+        seqno = std::max(seqno,
+                         core->highSeqno.load(std::memory_order_relaxed));
+    }
+    return seqno;
+}
+
 std::string Collections::VB::ManifestEntry::getExceptionString(
         const std::string& thrower, const std::string& error) const {
     std::stringstream ss;
@@ -59,7 +94,8 @@ std::string Collections::VB::ManifestEntry::getExceptionString(
 bool Collections::VB::ManifestEntry::addStats(const std::string& cid,
                                               Vbid vbid,
                                               const void* cookie,
-                                              const AddStatFn& add_stat) const {
+                                              const AddStatFn& add_stat,
+                                              size_t memUsed) const {
     try {
         const int bsize = 512;
         char buffer[bsize];
@@ -93,6 +129,12 @@ bool Collections::VB::ManifestEntry::addStats(const std::string& cid,
                          vbid.get(),
                          cid.c_str());
         add_casted_stat(buffer, getDiskCount(), add_stat, cookie);
+        checked_snprintf(buffer,
+                         bsize,
+                         "vb_%d:collection:%s:entry:mem_used",
+                         vbid.get(),
+                         cid.c_str());
+        add_casted_stat(buffer, memUsed, add_stat, cookie);
 
         if (getMaxTtl()) {
             checked_snprintf(buffer,
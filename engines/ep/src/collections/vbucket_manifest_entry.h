@@ -19,11 +19,14 @@
 
 #include "collections/collections_types.h"
 #include "memcached/engine_common.h"
+#include "monotonic.h"
 #include "stored-value.h"
 #include "systemevent.h"
 
-#include <platform/non_negative_counter.h>
+#include <folly/CachelinePadded.h>
+#include <platform/corestore.h>
 #include <platform/sized_buffer.h>
+#include <relaxed_atomic.h>
 
 #include <memory>
 
@@ -43,8 +46,6 @@ public:
         : startSeqno(-1),
           scopeID(scopeID),
           maxTtl(maxTtl),
-          diskCount(0),
-          highSeqno(0),
           persistedHighSeqno(0) {
         // Setters validates the start valid
         setStartSeqno(startSeqno);
@@ -53,8 +54,8 @@ public:
     /**
      * Explicitly define the copy constructor otherwise it would be
      * implicitly deleted via the deleted copy constructor in std::atomic
-     * (which is used inside highSeqno - AtomicMonotonic). This is required for
-     * using ManifestEntries in an unordered_map.
+     * (which is used inside the counters). This is required for using
+     * ManifestEntries in the VB::Manifest map.
      */
     ManifestEntry(const ManifestEntry& other);
     ManifestEntry& operator=(const ManifestEntry& other);
@@ -86,27 +87,23 @@ public:
 
     /// increment how many items are stored on disk for this collection
     void incrementDiskCount() const {
-        diskCount++;
+        coreLocal.get()->diskCount++;
     }
 
     /// decrement how many items are stored on disk for this collection
     void decrementDiskCount() const {
-        diskCount--;
+        coreLocal.get()->diskCount--;
     }
 
     /// set how many items this collection has stored
-    void setDiskCount(uint64_t value) {
-        diskCount = value;
-    }
+    void setDiskCount(uint64_t value);
 
     /// @return how many items are stored on disk for this collection
-    uint64_t getDiskCount() const {
-        return diskCount;
-    }
+    uint64_t getDiskCount() const;
 
     /// set the highest seqno (persisted or not) for this collection
     void setHighSeqno(uint64_t value) const {
-        highSeqno.store(value, std::memory_order_relaxed);
+        coreLocal.get()->highSeqno.store(value, std::memory_order_relaxed);
     }
 
     /**
@@ -114,14 +111,10 @@ public:
      * Required for warmup where we need to overwrite the value with 0. Would
      * rather reset for warmup than loosen the montonic constraint to weak.
      */
-    void resetHighSeqno(uint64_t value) const {
-        highSeqno.reset(value, std::memory_order_relaxed);
-    }
+    void resetHighSeqno(uint64_t value) const;
 
     /// @return the highest seqno of any item in this collection
-    uint64_t getHighSeqno() const {
-        return highSeqno.load(std::memory_order_relaxed);
-    }
+    uint64_t getHighSeqno() const;
 
     /// set the highest persisted seqno for this collection if the new value
     /// is greater than the previous one
@@ -139,11 +132,16 @@ public:
         return persistedHighSeqno.load(std::memory_order_relaxed);
     }
 
-    /// @return true if successfully added stats, false otherwise
+    /**
+     * @param memUsed the memory consumed by the items of this collection in
+     *        the vBucket's HashTable (which does the accounting)
+     * @return true if successfully added stats, false otherwise
+     */
     bool addStats(const std::string& cid,
                   Vbid vbid,
                   const void* cookie,
-                  const AddStatFn& add_stat) const;
+                  const AddStatFn& add_stat,
+                  size_t memUsed) const;
 
 private:
     /**
@@ -184,30 +182,39 @@ private:
     cb::ExpiryLimit maxTtl;
 
     /**
-     * The count of items in this collection
-     * mutable - the VB:Manifest read/write lock protects this object and
-     *           we can do stats updates as long as the read lock is held.
-     *           The write lock is really for the Manifest map being changed.
+     * The counters updated by the mutations of the collection. Each core
+     * updates its own (cacheline padded) copy, so that front end threads
+     * writing to a hot collection don't contend on the same cacheline; they
+     * are folded together when read.
      */
-    mutable cb::NonNegativeCounter<uint64_t, cb::ThrowExceptionUnderflowPolicy>
-            diskCount;
+    struct CoreLocalCounters {
+        /**
+         * The core's change to the count of items in this collection. This is
+         * signed as an item may be counted on a different core to the one it
+         * is removed on.
+         */
+        cb::RelaxedAtomic<int64_t> diskCount{0};
+
+        /**
+         * The highest seqno of any item (persisted or not) that belongs to
+         * this collection which was set on the core. The collection's high
+         * seqno is the highest of all the cores.
+         *
+         * We should ignore any attempts to set the value to a lower number as
+         * this is a possible result of compare_exchange_weak returning false
+         * inside AtomicMonotonic::operator=() (i.e. another thread has already
+         * written a higher value and so the current write is no longer valid
+         * and any failure can be ignored).
+         */
+        AtomicMonotonic<uint64_t, IgnorePolicy> highSeqno{0};
+    };
 
     /**
-     * The highest seqno of any item (persisted or not) that belongs to this
-     * collection.
-     *
-     * Will be hit by multiple front end threads and thus needs to be atomic.
-     * We should ignore any attempts to set the value to a lower number as
-     * this is a possible result of compare_exchange_weak returning false
-     * inside AtomicMonotonic::operator=() (i.e. another thread has already
-     * written a higher value and so the current write is no longer valid and
-     * any failure can be ignored).
-     *
      * mutable - the VB:Manifest read/write lock protects this object and
      *           we can do stats updates as long as the read lock is held.
      *           The write lock is really for the Manifest map being changed.
      */
-    mutable AtomicMonotonic<uint64_t, IgnorePolicy> highSeqno;
+    mutable CoreStore<folly::CachelinePadded<CoreLocalCounters>> coreLocal;
 
     /**
      * The highest seqno of any item that has been/is currently being persisted.
@@ -0,0 +1,68 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "compaction_throttle.h"
+
+#include "stats.h"
+
+#include <algorithm>
+#include <thread>
+
+CompactionThrottle::CompactionThrottle(EPStats& stats)
+    : stats(stats), lastRefill(std::chrono::steady_clock::now()) {
+}
+
+void CompactionThrottle::setMaxRate(size_t bytesPerSec) {
+    maxRate = bytesPerSec;
+}
+
+void CompactionThrottle::setWriteQueueCap(size_t cap) {
+    writeQueueCap = cap;
+}
+
+size_t CompactionThrottle::getCurrentRate() const {
+    const size_t rate = maxRate;
+    const size_t cap = writeQueueCap;
+    const size_t queued = stats.diskQueueSize;
+    if (rate == 0 || cap == 0 || queued <= cap) {
+        return rate;
+    }
+    const auto lowered = size_t(double(rate) * cap / queued);
+    return std::max({lowered, rate / 16, size_t(1)});
+}
+
+void CompactionThrottle::consume(size_t bytes) {
+    const auto rate = getCurrentRate();
+    if (rate == 0) {
+        return;
+    }
+
+    std::chrono::duration<double> wait;
+    {
+        std::lock_guard<std::mutex> lh(mutex);
+        const auto now = std::chrono::steady_clock::now();
+        const std::chrono::duration<double> elapsed = now - lastRefill;
+        lastRefill = now;
+        tokens = std::min(double(rate), tokens + rate * elapsed.count());
+        tokens -= bytes;
+        if (tokens >= 0) {
+            return;
+        }
+        wait = std::chrono::duration<double>(-tokens / rate);
+    }
+    std::this_thread::sleep_for(wait);
+}
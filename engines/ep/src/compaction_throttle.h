@@ -0,0 +1,66 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+
+class EPStats;
+
+/**
+ * A token bucket limiting the rate (in bytes per second) at which the
+ * compactions of a bucket write their new files. It's shared by all of the
+ * bucket's compactions, so they're limited together however many run at once.
+ *
+ * The rate adapts to the flusher: while more items are waiting to be
+ * persisted than the compaction write queue cap, the rate is lowered in
+ * proportion (down to a sixteenth) so that compaction gives way to the
+ * flusher.
+ */
+class CompactionThrottle {
+public:
+    explicit CompactionThrottle(EPStats& stats);
+
+    /// Set the rate when the flusher keeps up, 0 disables the throttle
+    void setMaxRate(size_t bytesPerSec);
+
+    /// Set the disk write queue size above which the rate is lowered
+    void setWriteQueueCap(size_t cap);
+
+    /// @return the rate (bytes per second) compactions may write now, 0 if
+    ///         unlimited
+    size_t getCurrentRate() const;
+
+    /**
+     * Account for bytes written by a compaction, blocking the calling
+     * compaction once it has written more than the rate allows (with up to
+     * a second's worth of burst).
+     */
+    void consume(size_t bytes);
+
+private:
+    EPStats& stats;
+    std::atomic<size_t> maxRate{0};
+    std::atomic<size_t> writeQueueCap{0};
+
+    std::mutex mutex;
+    /// Bytes which may be written without waiting, negative when in debt
+    double tokens{0};
+    std::chrono::steady_clock::time_point lastRefill;
+};
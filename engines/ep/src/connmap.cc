@@ -166,6 +166,7 @@ void ConnMap::addVBConnByVBId(std::shared_ptr<ConnHandler> conn, Vbid vbid) {
     size_t lock_num = vbid.get() % vbConnLockNum;
     std::lock_guard<std::mutex> lh(vbConnLocks[lock_num]);
     vbConns[vbid.get()].emplace_back(std::move(conn));
+    vbConnsChanged_UNLOCKED(vbid);
 }
 
 void ConnMap::removeVBConnByVBId_UNLOCKED(const void* connCookie, Vbid vbid) {
@@ -176,6 +177,7 @@ void ConnMap::removeVBConnByVBId_UNLOCKED(const void* connCookie, Vbid vbid) {
         if (!connection ||
             (connection && connCookie == connection->getCookie())) {
             vb_conns.erase(itr);
+            vbConnsChanged_UNLOCKED(vbid);
             break;
         }
     }
@@ -121,6 +121,13 @@ protected:
             std::unordered_map<const void*, std::shared_ptr<ConnHandler>>;
     CookieToConnectionMap map_;
 
+    /**
+     * Called (with the vbConnLocks lock of the vbucket held) after the
+     * connections of the vbucket in vbConns changed
+     */
+    virtual void vbConnsChanged_UNLOCKED(Vbid vbid) {
+    }
+
     std::vector<std::mutex> vbConnLocks;
     std::vector<std::list<std::weak_ptr<ConnHandler>>> vbConns;
 
@@ -0,0 +1,84 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "couch-kvstore/couch-file-handle-cache.h"
+
+CouchFileHandleCache::CouchFileHandleCache(size_t maxVBuckets)
+    : generations(maxVBuckets) {
+}
+
+void CouchFileHandleCache::invalidate(Vbid vbid, std::vector<Db*>& toClose) {
+    std::lock_guard<std::mutex> lh(mutex);
+    // Incremented under the mutex, so a put() can't add a handle of the old
+    // generation after the removal below
+    ++generations[vbid.get()];
+    for (auto it = lru.begin(); it != lru.end();) {
+        if (it->vbid == vbid) {
+            toClose.push_back(it->db);
+            it = lru.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+Db* CouchFileHandleCache::take(Vbid vbid,
+                               uint64_t fileRev,
+                               uint64_t& generation) {
+    std::lock_guard<std::mutex> lh(mutex);
+    for (auto it = lru.begin(); it != lru.end(); ++it) {
+        if (it->vbid == vbid && it->fileRev == fileRev &&
+            it->generation == generations[vbid.get()]) {
+            auto* db = it->db;
+            generation = it->generation;
+            lru.erase(it);
+            return db;
+        }
+    }
+    return nullptr;
+}
+
+void CouchFileHandleCache::put(Vbid vbid,
+                               uint64_t fileRev,
+                               uint64_t generation,
+                               Db* db,
+                               size_t capacity,
+                               std::vector<Db*>& toClose) {
+    std::lock_guard<std::mutex> lh(mutex);
+    if (capacity == 0 || generation != generations[vbid.get()]) {
+        toClose.push_back(db);
+        return;
+    }
+    lru.push_front({vbid, fileRev, generation, db});
+    while (lru.size() > capacity) {
+        toClose.push_back(lru.back().db);
+        lru.pop_back();
+    }
+}
+
+void CouchFileHandleCache::clear(std::vector<Db*>& toClose) {
+    std::lock_guard<std::mutex> lh(mutex);
+    for (auto& entry : lru) {
+        toClose.push_back(entry.db);
+    }
+    lru.clear();
+}
+
+size_t CouchFileHandleCache::size() const {
+    std::lock_guard<std::mutex> lh(mutex);
+    return lru.size();
+}
@@ -0,0 +1,101 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <libcouchstore/couch_db.h>
+#include <memcached/vbucket.h>
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <vector>
+
+/**
+ * An LRU cache of the idle read-only Db handles of the vBucket files, so
+ * that the reads of the read-only CouchKVStore (e.g. background fetches)
+ * don't each open the file and read its header.
+ *
+ * A Db only sees the header it read when opened, so each vBucket has a
+ * generation which the read-write CouchKVStore increments (invalidate())
+ * whenever it commits a new header or moves to a new file. A handle is only
+ * reused while the generation is the one read before it was opened.
+ *
+ * Shared by the RW/RO pair. A handle is used by one thread at a time: it's
+ * taken out of the cache while in use. The cache never closes a handle
+ * itself, it returns those which should be closed to the caller.
+ */
+class CouchFileHandleCache {
+public:
+    explicit CouchFileHandleCache(size_t maxVBuckets);
+
+    /// @return the generation of the vBucket's file, to read before opening
+    uint64_t getGeneration(Vbid vbid) const {
+        return generations[vbid.get()];
+    }
+
+    /**
+     * The vBucket's file has a new header (or revision): increment the
+     * generation and remove its idle handles.
+     *
+     * @param [out] toClose the handles which the caller must close
+     */
+    void invalidate(Vbid vbid, std::vector<Db*>& toClose);
+
+    /**
+     * Take an idle handle of the vBucket's file.
+     *
+     * @param fileRev the revision of the file to read
+     * @param [out] generation the generation the handle was opened at
+     * @return the handle, or nullptr if there's no up to date one
+     */
+    Db* take(Vbid vbid, uint64_t fileRev, uint64_t& generation);
+
+    /**
+     * Return a handle once done with it. It's kept if it's still up to date
+     * and the cache has room for it (evicting the least recently used one if
+     * need be).
+     *
+     * @param capacity the maximum number of idle handles
+     * @param [out] toClose the handles which the caller must close
+     */
+    void put(Vbid vbid,
+             uint64_t fileRev,
+             uint64_t generation,
+             Db* db,
+             size_t capacity,
+             std::vector<Db*>& toClose);
+
+    /// Remove all of the idle handles, to be closed by the caller
+    void clear(std::vector<Db*>& toClose);
+
+    size_t size() const;
+
+private:
+    struct Entry {
+        Vbid vbid;
+        uint64_t fileRev;
+        uint64_t generation;
+        Db* db;
+    };
+
+    std::vector<std::atomic<uint64_t>> generations;
+
+    mutable std::mutex mutex;
+    /// The idle handles, the most recently used first
+    std::list<Entry> lru;
+};
@@ -15,10 +15,21 @@
  *   limitations under the License.
  */
 
+#include "bucket_logger.h"
 #include "common.h"
 #include "couch-kvstore/couch-fs-stats.h"
 #include "kvstore.h"
 
+#include <platform/strerror.h>
+
+#include <algorithm>
+#include <cerrno>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 std::unique_ptr<FileOpsInterface> getCouchstoreStatsOps(
     FileStats& stats, FileOpsInterface& base_ops) {
     return std::unique_ptr<FileOpsInterface>(new StatsOps(stats, base_ops));
@@ -26,12 +37,26 @@ std::unique_ptr<FileOpsInterface> getCouchstoreStatsOps(
 
 StatsOps::StatFile::StatFile(FileOpsInterface* _orig_ops,
                              couch_file_handle _orig_handle,
-                             cs_off_t _last_offs)
+                             cs_off_t _last_offs,
+                             FileStats& _stats)
     : orig_ops(_orig_ops),
       orig_handle(_orig_handle),
       last_offs(_last_offs),
+      stats(_stats),
       read_count_since_open(0),
-      write_count_since_open(0) {
+      write_count_since_open(0),
+      defer_syncs(false),
+      syncs_since_defer(0),
+      sync_deferred(false),
+      read_begin(0),
+      read_end(0),
+      write_begin(0),
+      write_end(0),
+      readahead_end(0),
+      writeback_fd(-1),
+      writeback_window(0),
+      writeback_begin(0),
+      writeback_end(0) {
 }
 
 size_t StatsOps::StatFile::getReadCount() {
@@ -46,7 +71,8 @@ couch_file_handle StatsOps::constructor(couchstore_error_info_t *errinfo) {
     FileOpsInterface* orig_ops = &wrapped_ops;
     StatFile* sf = new StatFile(orig_ops,
                                 orig_ops->constructor(errinfo),
-                                0);
+                                0,
+                                stats);
     return reinterpret_cast<couch_file_handle>(sf);
 }
 
@@ -57,7 +83,21 @@ couchstore_error_t StatsOps::open(couchstore_error_info_t* errinfo,
     StatFile* sf = reinterpret_cast<StatFile*>(*h);
     sf->read_count_since_open = 0;
     sf->write_count_since_open = 0;
-    return sf->orig_ops->open(errinfo, &sf->orig_handle, path, flags);
+    sf->readahead_end = 0;
+    const auto errcode =
+            sf->orig_ops->open(errinfo, &sf->orig_handle, path, flags);
+#ifdef __linux__
+    // couchstore doesn't expose its descriptor, so write back through one
+    // of our own (they share the page cache of the file)
+    const auto window = writeBack.load();
+    if (errcode == COUCHSTORE_SUCCESS && window != 0 &&
+        (flags & O_ACCMODE) != O_RDONLY) {
+        sf->writeback_fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        sf->writeback_window = window;
+        sf->writeback_begin = sf->writeback_end = 0;
+    }
+#endif
+    return errcode;
 }
 
 couchstore_error_t StatsOps::close(couchstore_error_info_t* errinfo,
@@ -73,7 +113,19 @@ couchstore_error_t StatsOps::close(couchstore_error_info_t* errinfo,
         stats.writeCountHisto.add(sf->write_count_since_open);
     }
 
-    return sf->orig_ops->close(errinfo, sf->orig_handle);
+    // Don't lose a deferred sync if the file is closed before we got to it
+    const auto syncErr = syncDeferred(errinfo, sf);
+    if (dropBehind) {
+        dropRange(*sf, sf->read_begin, sf->read_end);
+    }
+#ifdef __linux__
+    if (sf->writeback_fd != -1) {
+        ::close(sf->writeback_fd);
+        sf->writeback_fd = -1;
+    }
+#endif
+    const auto closeErr = sf->orig_ops->close(errinfo, sf->orig_handle);
+    return (syncErr != COUCHSTORE_SUCCESS) ? syncErr : closeErr;
 }
 
 couchstore_error_t StatsOps::set_periodic_sync(couch_file_handle h,
@@ -99,6 +151,16 @@ ssize_t StatsOps::pread(couchstore_error_info_t* errinfo,
     if (result > 0) {
         stats.totalBytesRead += result;
         ++sf->read_count_since_open;
+        if (dropBehind) {
+            extendRange(sf->read_begin, sf->read_end, off, result);
+            if (sf->read_end - sf->read_begin >= DropBehindWindow) {
+                dropRange(*sf, sf->read_begin, sf->read_end);
+            }
+        }
+        const auto window = readAhead.load();
+        if (window != 0) {
+            readAheadFrom(*sf, off + result, window);
+        }
     }
     return result;
 }
@@ -116,6 +178,17 @@ ssize_t StatsOps::pwrite(couchstore_error_info_t*errinfo,
     if (result > 0) {
         stats.totalBytesWritten += result;
         ++sf->write_count_since_open;
+        if (dropBehind) {
+            // Dirty pages can't be dropped, so wait for the next sync
+            extendRange(sf->write_begin, sf->write_end, off, result);
+        }
+        if (sf->writeback_fd != -1) {
+            extendRange(sf->writeback_begin, sf->writeback_end, off, result);
+            if (sf->writeback_end - sf->writeback_begin >=
+                sf->writeback_window) {
+                startWriteBack(*sf);
+            }
+        }
     }
     return result;
 }
@@ -129,8 +202,19 @@ cs_off_t StatsOps::goto_eof(couchstore_error_info_t* errinfo,
 couchstore_error_t StatsOps::sync(couchstore_error_info_t* errinfo,
                                   couch_file_handle h) {
     StatFile* sf = reinterpret_cast<StatFile*>(h);
-    HdrMicroSecBlockTimer bt(&stats.syncTimeHisto);
-    return sf->orig_ops->sync(errinfo, sf->orig_handle);
+    if (sf->defer_syncs && sf->syncs_since_defer++ > 0) {
+        sf->sync_deferred = true;
+        return COUCHSTORE_SUCCESS;
+    }
+    couchstore_error_t errcode;
+    {
+        HdrMicroSecBlockTimer bt(&stats.syncTimeHisto);
+        errcode = syncFile(errinfo, *sf);
+    }
+    if (errcode == COUCHSTORE_SUCCESS && dropBehind) {
+        dropRange(*sf, sf->write_begin, sf->write_end);
+    }
+    return errcode;
 }
 
 couchstore_error_t StatsOps::advise(couchstore_error_info_t* errinfo,
@@ -148,6 +232,118 @@ FileOpsInterface::FHStats* StatsOps::get_stats(couch_file_handle h) {
     return sf;
 }
 
+bool StatsOps::deferSyncs(FHStats* file) {
+    auto* sf = dynamic_cast<StatFile*>(file);
+    if (!sf) {
+        return false;
+    }
+    sf->defer_syncs = true;
+    sf->syncs_since_defer = 0;
+    return true;
+}
+
+couchstore_error_t StatsOps::syncDeferred(couchstore_error_info_t* errinfo,
+                                          FHStats* file) {
+    auto* sf = dynamic_cast<StatFile*>(file);
+    if (!sf || !sf->defer_syncs) {
+        return COUCHSTORE_SUCCESS;
+    }
+
+    auto errcode = COUCHSTORE_SUCCESS;
+    if (sf->sync_deferred) {
+        HdrMicroSecBlockTimer bt(&sf->stats.syncTimeHisto);
+        errcode = syncFile(errinfo, *sf);
+        if (errcode != COUCHSTORE_SUCCESS) {
+            // Keep it deferred so it may be retried
+            return errcode;
+        }
+    }
+    sf->defer_syncs = false;
+    sf->sync_deferred = false;
+    return errcode;
+}
+
+couchstore_error_t StatsOps::advise(FHStats* file,
+                                    cs_off_t offset,
+                                    cs_off_t len,
+                                    couchstore_file_advice_t advice) {
+    auto* sf = dynamic_cast<StatFile*>(file);
+    if (!sf) {
+        return COUCHSTORE_SUCCESS;
+    }
+    couchstore_error_info_t errinfo;
+    return sf->orig_ops->advise(
+            &errinfo, sf->orig_handle, offset, len, advice);
+}
+
+void StatsOps::dropRange(StatFile& sf, cs_off_t& begin, cs_off_t& end) {
+    if (end > begin) {
+        couchstore_error_info_t errinfo;
+        sf.orig_ops->advise(&errinfo,
+                            sf.orig_handle,
+                            begin,
+                            end - begin,
+                            COUCHSTORE_FILE_ADVICE_DONTNEED);
+    }
+    begin = end = 0;
+}
+
+void StatsOps::readAheadFrom(StatFile& sf,
+                             cs_off_t offset,
+                             cs_off_t window) {
+    const auto end = sf.readahead_end;
+    if (offset >= end - window && offset < end - window / 2) {
+        return;
+    }
+    couchstore_error_info_t errinfo;
+    sf.orig_ops->advise(&errinfo,
+                        sf.orig_handle,
+                        offset,
+                        window,
+                        COUCHSTORE_FILE_ADVICE_WILLNEED);
+    sf.readahead_end = offset + window;
+}
+
+couchstore_error_t StatsOps::syncFile(couchstore_error_info_t* errinfo,
+                                      StatFile& sf) {
+    // Most of what was written may be being written back already (see
+    // startWriteBack), so the sync only has to wait for the rest of it
+    sf.writeback_begin = sf.writeback_end = 0;
+    return sf.orig_ops->sync(errinfo, sf.orig_handle);
+}
+
+void StatsOps::startWriteBack(StatFile& sf) {
+#ifdef __linux__
+    // Only starts the write-back, without waiting for it; it's just a hint
+    // (the data is made durable by the sync) so give up on it if it fails
+    if (sync_file_range(sf.writeback_fd,
+                        sf.writeback_begin,
+                        sf.writeback_end - sf.writeback_begin,
+                        SYNC_FILE_RANGE_WRITE) == -1) {
+        EP_LOG_WARN(
+                "StatsOps::startWriteBack: sync_file_range failed, disabling "
+                "write-back for the file: {}",
+                cb_strerror());
+        ::close(sf.writeback_fd);
+        sf.writeback_fd = -1;
+    }
+#endif
+    sf.writeback_begin = sf.writeback_end = 0;
+}
+
+void StatsOps::extendRange(cs_off_t& begin,
+                           cs_off_t& end,
+                           cs_off_t offset,
+                           cs_off_t len) {
+    if (end == begin) {
+        begin = offset;
+        end = offset + len;
+    } else {
+        begin = std::min(begin, offset);
+        end = std::max(end, offset + len);
+    }
+}
+
 void StatsOps::destructor(couch_file_handle h) {
     StatFile* sf = reinterpret_cast<StatFile*>(h);
     sf->orig_ops->destructor(sf->orig_handle);
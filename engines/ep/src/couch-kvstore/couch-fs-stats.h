@@ -66,14 +66,86 @@ public:
     FHStats* get_stats(couch_file_handle handle) override;
     void destructor(couch_file_handle handle) override;
 
+    /**
+     * Group commit: defer the syncs of the file after the next one until
+     * syncDeferred() is called (or the file is closed).
+     *
+     * couchstore_commit() syncs the data before writing the header and
+     * then syncs the header, so calling this before the commit defers only
+     * the sync of the header; a crash before it is synced loses the commit
+     * but leaves the previous header (and the data it points to) intact.
+     *
+     * @param file the stats of the file (couchstore_get_db_filestats())
+     * @return false if the file isn't one of ours (nothing is deferred)
+     */
+    static bool deferSyncs(FHStats* file);
+
+    /**
+     * Perform the sync deferred by deferSyncs() (if any) and stop deferring
+     * the syncs of the file.
+     */
+    static couchstore_error_t syncDeferred(couchstore_error_info_t* errinfo,
+                                           FHStats* file);
+
+    /**
+     * Pass advice about a range of the file to the OS (e.g. to start
+     * reading it with COUCHSTORE_FILE_ADVICE_WILLNEED).
+     *
+     * @param file the stats of the file (couchstore_get_db_filestats())
+     */
+    static couchstore_error_t advise(FHStats* file,
+                                     cs_off_t offset,
+                                     cs_off_t len,
+                                     couchstore_file_advice_t advice);
+
+    /// Bytes read from a file between each drop behind of what was read
+    static const cs_off_t DropBehindWindow = 8 * 1024 * 1024;
+
+    /**
+     * Drop behind: tell the OS it may drop the cached pages of the files
+     * (COUCHSTORE_FILE_ADVICE_DONTNEED) once they've been used - what was
+     * read every DropBehindWindow bytes, and what was written once it's
+     * been synced. For the files which are streamed through once (e.g. by
+     * compaction), so they don't evict the pages the readers rely on.
+     */
+    void setDropBehind(bool enabled) {
+        dropBehind = enabled;
+    }
+
+    /**
+     * Read ahead: ask the OS to read the next bytes of the files
+     * (COUCHSTORE_FILE_ADVICE_WILLNEED) once what was read is half way
+     * through what it was last asked for. For the files which are read in
+     * about file order (e.g. by compaction), so the disk keeps reading
+     * while couchstore processes what it has (0 disables it).
+     */
+    void setReadAhead(cs_off_t bytes) {
+        readAhead = bytes;
+    }
+
+    /**
+     * Write-back: start the OS writing back what was written to the files
+     * opened for writing (sync_file_range) every this many bytes, so the
+     * disk writes a batch while the rest of it is being written and the
+     * sync only waits for what's left. Applies to the files opened after
+     * it's set (0 disables it). Linux only.
+     */
+    void setWriteBack(cs_off_t bytes) {
+        writeBack = bytes;
+    }
+
 protected:
     FileStats& stats;
     FileOpsInterface& wrapped_ops;
+    std::atomic<bool> dropBehind{false};
+    std::atomic<cs_off_t> readAhead{0};
+    std::atomic<cs_off_t> writeBack{0};
 
     struct StatFile : public FileOpsInterface::FHStats {
         StatFile(FileOpsInterface* _orig_ops,
                  couch_file_handle _orig_handle,
-                 cs_off_t _last_offs);
+                 cs_off_t _last_offs,
+                 FileStats& _stats);
 
         size_t getReadCount() override;
         size_t getWriteCount() override;
@@ -81,10 +153,55 @@ protected:
         FileOpsInterface* orig_ops;
         couch_file_handle orig_handle;
         cs_off_t last_offs;
+        FileStats& stats;
 
         /// Number of read() calls against this file since it was last opened.
         size_t read_count_since_open;
         /// Number of write() calls against this file since it was last opened.
         size_t write_count_since_open;
+
+        /// Group commit; deferSyncs() was called
+        bool defer_syncs;
+        /// Number of sync() calls since deferSyncs() was called
+        size_t syncs_since_defer;
+        /// A sync() call was deferred
+        bool sync_deferred;
+
+        /// Drop behind; the ranges read and written since they were dropped
+        cs_off_t read_begin;
+        cs_off_t read_end;
+        cs_off_t write_begin;
+        cs_off_t write_end;
+
+        /// Read ahead; the end of what the OS was last asked to read
+        cs_off_t readahead_end;
+
+        /// Write-back; the descriptor of the file it is done through (-1
+        /// if it's disabled), the window and the range written since the
+        /// write-back was last started
+        int writeback_fd;
+        cs_off_t writeback_window;
+        cs_off_t writeback_begin;
+        cs_off_t writeback_end;
     };
+
+    /// Sync the file (and reset the range to write back)
+    static couchstore_error_t syncFile(couchstore_error_info_t* errinfo,
+                                       StatFile& sf);
+
+    /// Start the write-back of the range written, and reset it
+    static void startWriteBack(StatFile& sf);
+
+    /// Ask the OS to read the window following offset, unless it's
+    /// already within the first half of the last one asked for
+    static void readAheadFrom(StatFile& sf, cs_off_t offset, cs_off_t window);
+
+    /// Drop the cached pages of a range, and reset it
+    static void dropRange(StatFile& sf, cs_off_t& begin, cs_off_t& end);
+
+    /// Extend the range [begin, end) to cover [offset, offset + len)
+    static void extendRange(cs_off_t& begin,
+                            cs_off_t& end,
+                            cs_off_t offset,
+                            cs_off_t len);
 };
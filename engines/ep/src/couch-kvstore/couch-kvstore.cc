@@ -22,19 +22,34 @@
 #include "common.h"
 #include "diskdockey.h"
 #include "ep_time.h"
+#include "hash_table_image.h"
 #include "item.h"
 #include "kvstore_config.h"
 #include "vbucket.h"
 #include "vbucket_bgfetch_item.h"
 #include "vbucket_state.h"
 
-#include <JSON_checker.h>
 #include <nlohmann/json.hpp>
 #include <phosphor/phosphor.h>
 #include <platform/compress.h>
 #include <platform/dirutils.h>
+#include <utilities/json_validator.h>
 #include <gsl/gsl>
 
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
 extern "C" {
     static int recordDbDumpC(Db *db, DocInfo *docinfo, void *ctx)
     {
@@ -42,6 +57,13 @@ extern "C" {
     }
 }
 
+extern "C" {
+    static int recordDbDumpByKeyC(Db *db, DocInfo *docinfo, void *ctx)
+    {
+        return CouchKVStore::recordDbDumpByKey(db, docinfo, ctx);
+    }
+}
+
 extern "C" {
     static int getMultiCbC(Db *db, DocInfo *docinfo, void *ctx)
     {
@@ -49,6 +71,112 @@ extern "C" {
     }
 }
 
+/// The most deferred commit syncs we issue at the same time
+static const size_t MaxParallelSyncs = 8;
+
+/// The maximum number of vBuckets getMultiParallel() reads at once
+static const size_t MaxParallelReads = 8;
+
+/**
+ * The threads (shared by all of the CouchKVStores) which getMultiParallel()
+ * and syncPendingCommits() use to issue their IO in parallel, so that the
+ * number of threads is bounded however many callers there are and the
+ * threads aren't created for every call. The threads only run the IO (they
+ * never wait for anything else), and the caller does its share of the work
+ * too, so a call always completes.
+ */
+class ParallelIOPool {
+public:
+    static ParallelIOPool& get() {
+        static ParallelIOPool pool(
+                std::max(MaxParallelSyncs, MaxParallelReads) - 1);
+        return pool;
+    }
+
+    ~ParallelIOPool() {
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            stopping = true;
+        }
+        cond.notify_all();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    /**
+     * Call work(0) to work(parallelism - 1), each on a different thread
+     * (work(0) on the caller's), and wait for all of them to return
+     */
+    void run(size_t parallelism, const std::function<void(size_t)>& work) {
+        if (parallelism <= 1) {
+            work(0);
+            return;
+        }
+        Batch batch{work};
+        batch.remaining = parallelism - 1;
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            for (size_t ii = 1; ii < parallelism; ++ii) {
+                jobs.push_back({&batch, ii});
+            }
+        }
+        cond.notify_all();
+
+        work(0);
+
+        std::unique_lock<std::mutex> lock(batch.mutex);
+        batch.cond.wait(lock, [&batch] { return batch.remaining == 0; });
+    }
+
+private:
+    struct Batch {
+        const std::function<void(size_t)>& work;
+        std::mutex mutex;
+        std::condition_variable cond;
+        size_t remaining = 0;
+    };
+
+    struct Job {
+        Batch* batch;
+        size_t index;
+    };
+
+    explicit ParallelIOPool(size_t nthreads) {
+        for (size_t ii = 0; ii < nthreads; ++ii) {
+            threads.emplace_back([this]() { runJobs(); });
+        }
+    }
+
+    void runJobs() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            cond.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (jobs.empty()) {
+                return;
+            }
+            const auto job = jobs.front();
+            jobs.pop_front();
+            lock.unlock();
+
+            job.batch->work(job.index);
+            {
+                std::lock_guard<std::mutex> guard(job.batch->mutex);
+                if (--job.batch->remaining == 0) {
+                    job.batch->cond.notify_one();
+                }
+            }
+            lock.lock();
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::deque<Job> jobs;
+    bool stopping = false;
+    std::vector<std::thread> threads;
+};
+
 static std::string getStrError(Db *db) {
     const size_t max_msg_len = 256;
     char msg[max_msg_len];
@@ -67,7 +195,7 @@ static std::string getStrError(Db *db) {
  * @return JSON or RAW bytes
  */
 static protocol_binary_datatype_t determine_datatype(sized_buf doc) {
-    if (checkUTF8JSON(reinterpret_cast<uint8_t*>(doc.buf), doc.size)) {
+    if (cb::json::isValid({doc.buf, doc.size})) {
         return PROTOCOL_BINARY_DATATYPE_JSON;
     } else {
         return PROTOCOL_BINARY_RAW_BYTES;
@@ -204,18 +332,127 @@ struct GetMultiCbCtx {
         : cks(c), vbId(v), fetches(f) {
     }
 
+    /**
+     * A document to fetch. couchstore only lends us the DocInfo for the
+     * duration of the callback, so we keep a copy of it (and of its id and
+     * rev_meta).
+     */
+    struct DocToFetch {
+        DocToFetch(const DocInfo& info, vb_bgfetch_item_ctx_t& itemCtx)
+            : docinfo(info),
+              buffer(new char[info.id.size + info.rev_meta.size]),
+              itemCtx(&itemCtx) {
+            std::memcpy(buffer.get(), info.id.buf, info.id.size);
+            std::memcpy(buffer.get() + info.id.size,
+                        info.rev_meta.buf,
+                        info.rev_meta.size);
+            docinfo.id.buf = buffer.get();
+            docinfo.rev_meta.buf = buffer.get() + info.id.size;
+        }
+
+        DocInfo docinfo;
+        std::unique_ptr<char[]> buffer;
+        vb_bgfetch_item_ctx_t* itemCtx;
+    };
+
     CouchKVStore &cks;
     Vbid vbId;
     vb_bgfetch_queue_t &fetches;
+    std::vector<DocToFetch> docs;
 };
 
+/// Bodies closer than this are prefetched with a single request
+static const cs_off_t MaxPrefetchGap = 4096;
+
+/**
+ * Ask the OS to start reading the bodies of the documents (sorted by their
+ * offset) we're about to fetch, merging the bodies next to each other into
+ * one request. The device gets all of the reads at once rather than one at a
+ * time as we fetch the documents.
+ */
+static void prefetchBodies(Db* db,
+                           const std::vector<GetMultiCbCtx::DocToFetch>& docs) {
+    auto* file = couchstore_get_db_filestats(db);
+    cs_off_t start = 0;
+    cs_off_t end = 0;
+    for (const auto& doc : docs) {
+        if (doc.itemCtx->isMetaOnly == GetMetaOnly::Yes ||
+            doc.docinfo.size == 0) {
+            continue;
+        }
+        // The body is stored in a chunk with an 8 byte header, and the file
+        // has a 1 byte marker at the start of every 4KB block.
+        const auto offset = cs_off_t(doc.docinfo.bp);
+        const auto len = cs_off_t(doc.docinfo.size + 8);
+        if (end != 0 && offset <= end + MaxPrefetchGap) {
+            end = std::max(end, offset + len + len / 4096 + 1);
+            continue;
+        }
+        if (end != 0) {
+            StatsOps::advise(
+                    file, start, end - start, COUCHSTORE_FILE_ADVICE_WILLNEED);
+        }
+        start = offset;
+        end = offset + len + len / 4096 + 1;
+    }
+    if (end != 0) {
+        StatsOps::advise(
+                file, start, end - start, COUCHSTORE_FILE_ADVICE_WILLNEED);
+    }
+}
+
+/**
+ * Ask the OS to read the next backfill_readahead_size bytes of the file from
+ * the body at the given offset, once the scan is half way through what it
+ * asked for last. The scan walks the by-seqno tree, and the bodies were
+ * written (appended) in about seqno order, so they're mostly read in file
+ * order; this keeps the disk reading while the scanned items are sent, and
+ * while the scan waits for them to be.
+ */
+static void readAhead(Db* db, ScanContext& sctx, cs_off_t offset) {
+    const auto window = cs_off_t(sctx.config.getBackfillReadaheadSize());
+    if (window == 0) {
+        return;
+    }
+    const auto end = cs_off_t(sctx.readaheadEnd);
+    if (offset >= end - window && offset < end - window / 2) {
+        return;
+    }
+    StatsOps::advise(couchstore_get_db_filestats(db),
+                     offset,
+                     window,
+                     COUCHSTORE_FILE_ADVICE_WILLNEED);
+    sctx.readaheadEnd = uint64_t(offset + window);
+}
+
+/**
+ * With couchstore_drop_behind, tell the OS it may drop the cached pages of
+ * the file which the scan has read, once it's a window past them (as the
+ * bodies are only read in about file order).
+ */
+static void dropBehind(Db* db, ScanContext& sctx, cs_off_t offset) {
+    if (!sctx.config.isCouchstoreDropBehind()) {
+        return;
+    }
+    const auto dropEnd = offset - StatsOps::DropBehindWindow;
+    const auto dropBegin = cs_off_t(sctx.dropBehindEnd);
+    if (dropEnd - dropBegin < StatsOps::DropBehindWindow) {
+        return;
+    }
+    StatsOps::advise(couchstore_get_db_filestats(db),
+                     dropBegin,
+                     dropEnd - dropBegin,
+                     COUCHSTORE_FILE_ADVICE_DONTNEED);
+    sctx.dropBehindEnd = uint64_t(dropEnd);
+}
+
 struct AllKeysCtx {
-    AllKeysCtx(std::shared_ptr<Callback<const DiskDocKey&>> callback,
+    AllKeysCtx(std::shared_ptr<StatusCallback<const DiskDocKey&>> callback,
                uint32_t cnt)
         : cb(callback), count(cnt) {
     }
 
-    std::shared_ptr<Callback<const DiskDocKey&>> cb;
+    std::shared_ptr<StatusCallback<const DiskDocKey&>> cb;
     uint32_t count;
 };
 
@@ -311,18 +548,20 @@ CouchKVStore::CouchKVStore(KVStoreConfig& config)
 CouchKVStore::CouchKVStore(KVStoreConfig& config,
                            FileOpsInterface& ops,
                            bool readOnly,
-                           std::shared_ptr<RevisionMap> dbFileRevMap)
+                           std::shared_ptr<RevisionMap> dbFileRevMap,
+                           std::shared_ptr<CouchFileHandleCache> fileHandleCache)
     : KVStore(config, readOnly),
       dbname(config.getDBName()),
       dbFileRevMap(dbFileRevMap),
+      fileHandleCache(fileHandleCache),
       intransaction(false),
       scanCounter(0),
       logger(config.getLogger()),
       base_ops(ops) {
     createDataDir(dbname);
-    statCollectingFileOps = getCouchstoreStatsOps(st.fsStats, base_ops);
-    statCollectingFileOpsCompaction = getCouchstoreStatsOps(
-        st.fsStatsCompaction, base_ops);
+    statCollectingFileOps = std::make_unique<StatsOps>(st.fsStats, base_ops);
+    statCollectingFileOpsCompaction =
+            std::make_unique<StatsOps>(st.fsStatsCompaction, base_ops);
 
     // init db file map with default revision number, 1
     numDbFiles = configuration.getMaxVBuckets();
@@ -342,7 +581,9 @@ CouchKVStore::CouchKVStore(KVStoreConfig& config, FileOpsInterface& ops)
     : CouchKVStore(config,
                    ops,
                    false /*readonly*/,
-                   std::make_shared<RevisionMap>(config.getMaxVBuckets())) {
+                   std::make_shared<RevisionMap>(config.getMaxVBuckets()),
+                   std::make_shared<CouchFileHandleCache>(
+                           config.getMaxVBuckets())) {
 }
 
 /**
@@ -351,15 +592,18 @@ CouchKVStore::CouchKVStore(KVStoreConfig& config, FileOpsInterface& ops)
 std::unique_ptr<CouchKVStore> CouchKVStore::makeReadOnlyStore() {
     // Not using make_unique due to the private constructor we're calling
     return std::unique_ptr<CouchKVStore>(
-            new CouchKVStore(configuration, dbFileRevMap));
+            new CouchKVStore(configuration, dbFileRevMap, fileHandleCache));
 }
 
-CouchKVStore::CouchKVStore(KVStoreConfig& config,
-                           std::shared_ptr<RevisionMap> dbFileRevMap)
+CouchKVStore::CouchKVStore(
+        KVStoreConfig& config,
+        std::shared_ptr<RevisionMap> dbFileRevMap,
+        std::shared_ptr<CouchFileHandleCache> fileHandleCache)
     : CouchKVStore(config,
                    *couchstore_get_default_file_ops(),
                    true /*readonly*/,
-                   dbFileRevMap) {
+                   dbFileRevMap,
+                   fileHandleCache) {
 }
 
 void CouchKVStore::initialize() {
@@ -407,6 +651,12 @@ void CouchKVStore::initialize() {
 
 CouchKVStore::~CouchKVStore() {
     close();
+    if (isReadOnly()) {
+        // The cached handles use our file ops
+        std::vector<Db*> toClose;
+        fileHandleCache->clear(toClose);
+        closeDatabaseHandles(toClose);
+    }
 }
 
 void CouchKVStore::reset(Vbid vbucketId) {
@@ -457,7 +707,7 @@ void CouchKVStore::set(const Item& itm, SetCallback cb) {
 
 GetValue CouchKVStore::get(const DiskDocKey& key, Vbid vb) {
     DbHolder db(*this);
-    couchstore_error_t errCode = openDB(vb, db, COUCHSTORE_OPEN_FLAG_RDONLY);
+    couchstore_error_t errCode = openCachedDB(vb, db);
     if (errCode != COUCHSTORE_SUCCESS) {
         ++st.numGetFailure;
         logger.warn("CouchKVStore::get: openDB error:{}, {}",
@@ -535,7 +785,7 @@ void CouchKVStore::getMulti(Vbid vb, vb_bgfetch_queue_t& itms) {
     int numItems = itms.size();
 
     DbHolder db(*this);
-    couchstore_error_t errCode = openDB(vb, db, COUCHSTORE_OPEN_FLAG_RDONLY);
+    couchstore_error_t errCode = openCachedDB(vb, db);
     if (errCode != COUCHSTORE_SUCCESS) {
         logger.warn(
                 "CouchKVStore::getMulti: openDB error:{}, "
@@ -549,6 +799,9 @@ void CouchKVStore::getMulti(Vbid vb, vb_bgfetch_queue_t& itms) {
         }
         return;
     }
+    // A cached handle has been read from before
+    auto* fileStats = couchstore_get_db_filestats(db);
+    const size_t readsBefore = fileStats ? fileStats->getReadCount() : 0;
 
     size_t idx = 0;
     std::vector<sized_buf> ids(itms.size());
@@ -561,7 +814,24 @@ void CouchKVStore::getMulti(Vbid vb, vb_bgfetch_queue_t& itms) {
 
     errCode = couchstore_docinfos_by_id(
             db, ids.data(), itms.size(), 0, getMultiCbC, &ctx);
-    if (errCode != COUCHSTORE_SUCCESS) {
+    if (errCode == COUCHSTORE_SUCCESS) {
+        // We've got the DocInfos in key order; read the documents in the
+        // order they are in the file instead, so the reads of documents
+        // next to each other are sequential (and mostly served by
+        // couchstore's read buffer)
+        std::sort(ctx.docs.begin(),
+                  ctx.docs.end(),
+                  [](const GetMultiCbCtx::DocToFetch& a,
+                     const GetMultiCbCtx::DocToFetch& b) {
+                      return a.docinfo.bp < b.docinfo.bp;
+                  });
+        if (ctx.docs.size() > 1) {
+            prefetchBodies(db, ctx.docs);
+        }
+        for (auto& doc : ctx.docs) {
+            fetchDocForBgFetch(db, vb, doc.docinfo, *doc.itemCtx);
+        }
+    } else {
         st.numGetFailure += numItems;
         logger.warn(
                 "CouchKVStore::getMulti: "
@@ -576,9 +846,8 @@ void CouchKVStore::getMulti(Vbid vb, vb_bgfetch_queue_t& itms) {
 
     // If available, record how many reads() we did for this getMulti;
     // and the average reads per document.
-    auto* stats = couchstore_get_db_filestats(db);
-    if (stats != nullptr) {
-        const auto readCount = stats->getReadCount();
+    if (fileStats != nullptr) {
+        const auto readCount = fileStats->getReadCount() - readsBefore;
         st.getMultiFsReadCount += readCount;
         st.getMultiFsReadHisto.add(readCount);
         st.getMultiFsReadPerDocHisto.add(readCount / itms.size());
@@ -687,6 +956,8 @@ void CouchKVStore::delVBucket(Vbid vbucket, uint64_t fileRev) {
     }
 
     unlinkCouchFile(vbucket, fileRev);
+    remove(getBloomFilterFileName(vbucket).c_str());
+    remove(getHashTableImageFileName(vbucket).c_str());
 }
 
 std::vector<vbucket_state *> CouchKVStore::listPersistedVbuckets() {
@@ -764,8 +1035,7 @@ static int edit_docinfo_hook(DocInfo **info, const sized_buf *item) {
         }
 
         protocol_binary_datatype_t datatype = PROTOCOL_BINARY_RAW_BYTES;
-        if (checkUTF8JSON(reinterpret_cast<const uint8_t*>(data.data()),
-                          data.size())) {
+        if (cb::json::isValid(data)) {
             datatype = PROTOCOL_BINARY_DATATYPE_JSON;
         }
 
@@ -865,6 +1135,9 @@ static int notify_expired_item(DocInfo& info,
     return COUCHSTORE_SUCCESS;
 }
 
+/// Compactions are throttled for each (at least) this many bytes written
+static const size_t compactionThrottleBatchBytes = 64 * 1024;
+
 static int time_purge_hook(Db* d, DocInfo* info, sized_buf item, void* ctx_p) {
     compaction_ctx* ctx = static_cast<compaction_ctx*>(ctx_p);
 
@@ -900,6 +1173,8 @@ static int time_purge_hook(Db* d, DocInfo* info, sized_buf item, void* ctx_p) {
                 ctx->droppedKeyCb(diskKey, int64_t(info->db_seq));
                 if (!info->deleted) {
                     ctx->stats.collectionsItemsPurged++;
+                    ++ctx->stats.collectionsItemsPurgedById
+                              [diskKey.getDocKey().getCollectionID()];
                 } else {
                     ctx->stats.collectionsDeletedItemsPurged++;
                 }
@@ -983,9 +1258,80 @@ static int time_purge_hook(Db* d, DocInfo* info, sized_buf item, void* ctx_p) {
         }
     }
 
+    if (ctx->throttleCb) {
+        // The kept document is written to the new file
+        ctx->unthrottledBytes +=
+                info->physical_size + info->id.size + info->rev_meta.size;
+        if (ctx->unthrottledBytes >= compactionThrottleBatchBytes) {
+            ctx->throttleCb(ctx->unthrottledBytes);
+            ctx->unthrottledBytes = 0;
+        }
+    }
+
     return COUCHSTORE_COMPACT_KEEP_ITEM;
 }
 
+/**
+ * The changes_since callback of a compaction which doesn't rewrite the file:
+ * expired items are notified and all keys added to the new bloom filter, as
+ * time_purge_hook does, but nothing is dropped.
+ */
+static int scan_compact_hook(Db* db, DocInfo* info, void* ctx_p) {
+    auto& ctx = *static_cast<compaction_ctx*>(ctx_p);
+
+    if (!info->deleted &&
+        info->rev_meta.size >= MetaData::getMetaDataSize(MetaData::Version::V0)) {
+        auto metadata = MetaDataFactory::createMetaData(info->rev_meta);
+        const uint32_t exptime = metadata->getExptime();
+        const time_t currtime = ep_real_time();
+        if (exptime && exptime < currtime) {
+            metadata->setDeleteSource(DeleteSource::TTL);
+            try {
+                int ret = notify_expired_item(
+                        *info, *metadata, {nullptr, 0}, ctx, currtime);
+                if (ret == COUCHSTORE_COMPACT_NEED_BODY) {
+                    Doc* doc = nullptr;
+                    auto errCode =
+                            couchstore_open_doc_with_docinfo(db, info, &doc, 0);
+                    if (errCode != COUCHSTORE_SUCCESS) {
+                        return errCode;
+                    }
+                    ret = notify_expired_item(
+                            *info, *metadata, doc->data, ctx, currtime);
+                    couchstore_free_document(doc);
+                }
+                if (ret != COUCHSTORE_SUCCESS) {
+                    return ret;
+                }
+            } catch (const std::bad_alloc&) {
+                EP_LOG_WARN("scan_compact_hook: memory allocation failed");
+                return COUCHSTORE_ERROR_ALLOC_FAIL;
+            }
+        }
+    }
+
+    if (ctx.bloomFilterCallback) {
+        bool deleted = info->deleted;
+        auto key = makeDiskDocKey(info->id);
+
+        try {
+            ctx.bloomFilterCallback->callback(
+                    reinterpret_cast<Vbid&>(ctx.compactConfig.db_file_id),
+                    key.getDocKey(),
+                    deleted);
+        } catch (std::runtime_error& re) {
+            EP_LOG_WARN(
+                    "scan_compact_hook: exception occurred when invoking the "
+                    "bloomfilter callback on {}"
+                    " - Details: {}",
+                    ctx.compactConfig.db_file_id,
+                    re.what());
+        }
+    }
+
+    return COUCHSTORE_SUCCESS;
+}
+
 bool CouchKVStore::compactDB(compaction_ctx *hook_ctx) {
     bool result = false;
 
@@ -1030,6 +1376,10 @@ bool CouchKVStore::compactDBInternal(compaction_ctx* hook_ctx,
     DbInfo                        info;
     Vbid vbid = hook_ctx->compactConfig.db_file_id;
     hook_ctx->config = &configuration;
+    statCollectingFileOpsCompaction->setDropBehind(
+            configuration.isCouchstoreDropBehind());
+    statCollectingFileOpsCompaction->setReadAhead(
+            cs_off_t(configuration.getCouchstoreCompactionReadaheadSize()));
 
     TRACE_EVENT1("CouchKVStore", "compactDB", "vbid", vbid.get());
 
@@ -1058,6 +1408,10 @@ bool CouchKVStore::compactDBInternal(compaction_ctx* hook_ctx,
     couchstore_db_info(compactdb, &info);
     hook_ctx->stats.pre = toFileInfo(info);
 
+    if (!needsRewrite(*hook_ctx, info)) {
+        return compactDBWithoutRewrite(compactdb, hook_ctx, start);
+    }
+
     /**
      * This flag disables IO buffering in couchstore which means
      * file operations will trigger syscalls immediately. This has
@@ -1180,6 +1534,53 @@ bool CouchKVStore::compactDBInternal(compaction_ctx* hook_ctx,
     return true;
 }
 
+bool CouchKVStore::needsRewrite(const compaction_ctx& hook_ctx,
+                                const DbInfo& info) const {
+    const auto minFragmentation =
+            configuration.getCouchstoreCompactionMinFragmentation();
+    if (minFragmentation == 0 || hook_ctx.compactConfig.drop_deletes ||
+        !hook_ctx.eraserContext->empty() || info.file_size == 0) {
+        return true;
+    }
+    const auto stale = info.file_size > info.space_used
+                               ? info.file_size - info.space_used
+                               : 0;
+    return stale * 100 >= info.file_size * minFragmentation;
+}
+
+bool CouchKVStore::compactDBWithoutRewrite(
+        DbHolder& db,
+        compaction_ctx* hook_ctx,
+        std::chrono::steady_clock::time_point start) {
+    const auto vbid = hook_ctx->compactConfig.db_file_id;
+    auto errCode = couchstore_changes_since(db.getDb(),
+                                            0,
+                                            COUCHSTORE_NO_OPTIONS,
+                                            scan_compact_hook,
+                                            hook_ctx);
+    if (errCode != COUCHSTORE_SUCCESS) {
+        logger.warn(
+                "CouchKVStore::compactDBWithoutRewrite: "
+                "couchstore_changes_since error:{} [{}], {}",
+                couchstore_strerror(errCode),
+                couchkvstore_strerrno(db, errCode),
+                vbid);
+        return false;
+    }
+
+    // The file (and so its purge seqno) is unchanged
+    hook_ctx->stats.post = hook_ctx->stats.pre;
+    ++st.numCompactionRewritesSkipped;
+    logger.debug(
+            "CouchKVStore::compactDBWithoutRewrite: {} is below the "
+            "fragmentation threshold, scanned it without rewriting",
+            vbid);
+
+    st.compactHisto.add(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start));
+    return true;
+}
+
 vbucket_state* CouchKVStore::getVBucketState(Vbid vbucketId) {
     return cachedVBStates[vbucketId.get()].get();
 }
@@ -1218,8 +1619,16 @@ bool CouchKVStore::setVBucketState(Vbid vbucketId,
             return false;
         }
 
+        // In group commit mode the sync is left for syncPendingCommits()
+        // (as for saveDocs())
+        const bool deferSync =
+                options == VBStatePersist::VBSTATE_PERSIST_WITH_COMMIT &&
+                groupCommit &&
+                StatsOps::deferSyncs(couchstore_get_db_filestats(db));
+
         if (options == VBStatePersist::VBSTATE_PERSIST_WITH_COMMIT) {
             errorCode = couchstore_commit(db);
+            invalidateCachedHandles(vbucketId);
             if (errorCode != COUCHSTORE_SUCCESS) {
                 ++st.numVbSetFailure;
                 logger.warn(
@@ -1245,6 +1654,10 @@ bool CouchKVStore::setVBucketState(Vbid vbucketId,
             cachedSpaceUsed[vbucketId.get()] = info.space_used;
             cachedFileSize[vbucketId.get()] = info.file_size;
         }
+
+        if (deferSync) {
+            pendingSyncs.emplace_back(vbucketId, db.releaseDb());
+        }
     } else {
         throw std::invalid_argument(
                 "CouchKVStore::setVBucketState: invalid vb state "
@@ -1296,7 +1709,8 @@ StorageProperties CouchKVStore::getStorageProperties() {
                          StorageProperties::EfficientVBDeletion::Yes,
                          StorageProperties::PersistedDeletion::Yes,
                          StorageProperties::EfficientGet::Yes,
-                         StorageProperties::ConcurrentWriteCompact::No);
+                         StorageProperties::ConcurrentWriteCompact::No,
+                         StorageProperties::KeyOrderScan::Yes);
     return rv;
 }
 
@@ -1316,6 +1730,78 @@ bool CouchKVStore::commit(Collections::VB::Flush& collectionsFlush) {
     return !intransaction;
 }
 
+bool CouchKVStore::setGroupCommit(bool enabled) {
+    if (isReadOnly()) {
+        throw std::logic_error(
+                "CouchKVStore::setGroupCommit: Not valid on a read-only "
+                "object.");
+    }
+    if (!enabled && !pendingSyncs.empty()) {
+        throw std::logic_error(
+                "CouchKVStore::setGroupCommit: " +
+                std::to_string(pendingSyncs.size()) +
+                " commits haven't been synced");
+    }
+
+    groupCommit = enabled;
+    return true;
+}
+
+void CouchKVStore::getMultiParallel(
+        std::vector<std::pair<Vbid, vb_bgfetch_queue_t>>& fetches,
+        const GetMultiCallback& done) {
+    std::atomic<size_t> next{0};
+    auto fetchNext = [this, &fetches, &done, &next]() {
+        for (size_t ii = next++; ii < fetches.size(); ii = next++) {
+            getMulti(fetches[ii].first, fetches[ii].second);
+            done(fetches[ii].first, fetches[ii].second);
+        }
+    };
+
+    const auto nthreads = std::min(fetches.size(), MaxParallelReads);
+    ParallelIOPool::get().run(nthreads, [&fetchNext](size_t) { fetchNext(); });
+}
+
+bool CouchKVStore::syncPendingCommits() {
+    if (pendingSyncs.empty()) {
+        return true;
+    }
+
+    // The syncs are independent of each other, so issue them in parallel to
+    // let the filesystem and the device batch them (i.e. share the journal
+    // commit and the cache flush)
+    std::vector<couchstore_error_t> results(pendingSyncs.size());
+    std::vector<couchstore_error_info_t> errinfos(pendingSyncs.size());
+    auto syncEvery = [this, &results, &errinfos](size_t first, size_t step) {
+        for (size_t ii = first; ii < pendingSyncs.size(); ii += step) {
+            results[ii] = StatsOps::syncDeferred(
+                    &errinfos[ii],
+                    couchstore_get_db_filestats(pendingSyncs[ii].second));
+        }
+    };
+
+    const auto nthreads = std::min(pendingSyncs.size(), MaxParallelSyncs);
+    ParallelIOPool::get().run(nthreads, [&syncEvery, nthreads](size_t first) {
+        syncEvery(first, nthreads);
+    });
+
+    std::vector<std::pair<Vbid, Db*>> failed;
+    for (size_t ii = 0; ii < pendingSyncs.size(); ++ii) {
+        if (results[ii] == COUCHSTORE_SUCCESS) {
+            closeDatabaseHandle(pendingSyncs[ii].second);
+        } else {
+            logger.warn(
+                    "CouchKVStore::syncPendingCommits: sync error:{} [{}], {}",
+                    couchstore_strerror(results[ii]),
+                    cb_strerror(errinfos[ii].error),
+                    pendingSyncs[ii].first);
+            failed.push_back(pendingSyncs[ii]);
+        }
+    }
+    pendingSyncs.swap(failed);
+    return pendingSyncs.empty();
+}
+
 bool CouchKVStore::getStat(const char* name, size_t& value)  {
     if (strcmp("failure_compaction", name) == 0) {
         value = st.numCompactionFailure.load();
@@ -1426,6 +1912,15 @@ ScanContext* CouchKVStore::initScanContext(
 
     auto collectionsManifest = getDroppedCollections(*db);
 
+    if (valOptions != ValueFilter::KEYS_ONLY &&
+        configuration.getBackfillReadaheadSize() != 0) {
+        // Let the OS use a larger read ahead for the scan's own handle
+        StatsOps::advise(couchstore_get_db_filestats(db),
+                         0,
+                         0,
+                         COUCHSTORE_FILE_ADVICE_SEQUENTIAL);
+    }
+
     {
         LockHolder lh(scanLock);
         scans[scanId] = db.releaseDb();
@@ -1466,7 +1961,8 @@ scan_error_t CouchKVStore::scan(ScanContext* ctx) {
         return scan_failed;
     }
 
-    if (ctx->lastReadSeqno == ctx->maxSeqno) {
+    if (ctx->order == ScanOrder::BySeqno &&
+        ctx->lastReadSeqno == ctx->maxSeqno) {
         return scan_success;
     }
 
@@ -1488,17 +1984,30 @@ scan_error_t CouchKVStore::scan(ScanContext* ctx) {
         db = itr->second;
     }
 
-    uint64_t start = ctx->startSeqno;
-    if (ctx->lastReadSeqno != 0) {
-        start = ctx->lastReadSeqno + 1;
-    }
-
     couchstore_error_t errorCode;
-    errorCode = couchstore_changes_since(db,
-                                         start,
-                                         getDocFilter(ctx->docFilter),
-                                         recordDbDumpC,
-                                         static_cast<void*>(ctx));
+    if (ctx->order == ScanOrder::ByKey) {
+        // Resume from the last key read (recordDbDumpByKey skips it)
+        sized_buf startKey{nullptr, 0};
+        if (ctx->lastReadKey) {
+            startKey = to_sized_buf(*ctx->lastReadKey);
+        }
+        errorCode = couchstore_all_docs(db,
+                                        &startKey,
+                                        getDocFilter(ctx->docFilter),
+                                        recordDbDumpByKeyC,
+                                        static_cast<void*>(ctx));
+    } else {
+        uint64_t start = ctx->startSeqno;
+        if (ctx->lastReadSeqno != 0) {
+            start = ctx->lastReadSeqno + 1;
+        }
+
+        errorCode = couchstore_changes_since(db,
+                                             start,
+                                             getDocFilter(ctx->docFilter),
+                                             recordDbDumpC,
+                                             static_cast<void*>(ctx));
+    }
 
     TRACE_EVENT_END1(
             "CouchKVStore", "scan", "lastReadSeqno", ctx->lastReadSeqno);
@@ -1508,8 +2017,10 @@ scan_error_t CouchKVStore::scan(ScanContext* ctx) {
             return scan_again;
         } else {
             logger.warn(
-                    "CouchKVStore::scan couchstore_changes_since "
+                    "CouchKVStore::scan {} "
                     "error:{} [{}]",
+                    ctx->order == ScanOrder::ByKey ? "couchstore_all_docs"
+                                                   : "couchstore_changes_since",
                     couchstore_strerror(errorCode),
                     couchkvstore_strerrno(db, errorCode));
             return scan_failed;
@@ -1569,6 +2080,11 @@ DbInfo CouchKVStore::getDbInfo(Vbid vbid) {
 
 void CouchKVStore::close() {
     intransaction = false;
+    // Closing the files performs any deferred syncs
+    for (auto& pending : pendingSyncs) {
+        closeDatabaseHandle(pending.second);
+    }
+    pendingSyncs.clear();
 }
 
 uint64_t CouchKVStore::checkNewRevNum(std::string &dbFileName, bool newFile) {
@@ -1616,9 +2132,11 @@ void CouchKVStore::updateDbFileMap(Vbid vbucketId, uint64_t newFileRev) {
     // MB-27963: obtain write access whilst we update the file map openDB also
     // obtains this mutex to ensure the fileRev it obtains doesn't become stale
     // by the time it hits sys_open.
-    std::lock_guard<cb::WriterLock> lg(openDbMutex);
-
-    (*dbFileRevMap)[vbucketId.get()] = newFileRev;
+    {
+        std::lock_guard<cb::WriterLock> lg(openDbMutex);
+        (*dbFileRevMap)[vbucketId.get()] = newFileRev;
+    }
+    invalidateCachedHandles(vbucketId);
 }
 
 couchstore_error_t CouchKVStore::openDB(Vbid vbucketId,
@@ -1693,6 +2211,52 @@ couchstore_error_t CouchKVStore::openSpecificDB(Vbid vbucketId,
     return errorCode;
 }
 
+couchstore_error_t CouchKVStore::openCachedDB(Vbid vbucketId, DbHolder& db) {
+    if (!isReadOnly() || configuration.getCouchstoreFileHandleCacheSize() == 0) {
+        return openDB(vbucketId, db, COUCHSTORE_OPEN_FLAG_RDONLY);
+    }
+
+    const uint64_t fileRev = (*dbFileRevMap)[vbucketId.get()];
+    uint64_t generation = 0;
+    auto* cachedDb = fileHandleCache->take(vbucketId, fileRev, generation);
+    if (cachedDb) {
+        *db.getDbAddress() = cachedDb;
+        db.setFileRev(fileRev);
+        db.setCached(vbucketId, generation);
+        ++st.numFileHandleCacheHits;
+        return COUCHSTORE_SUCCESS;
+    }
+
+    // Read before opening, so that a commit while we open the file (which
+    // we may or may not see) stops the handle being reused
+    generation = fileHandleCache->getGeneration(vbucketId);
+    auto errCode = openDB(vbucketId, db, COUCHSTORE_OPEN_FLAG_RDONLY);
+    if (errCode == COUCHSTORE_SUCCESS) {
+        db.setCached(vbucketId, generation);
+    }
+    return errCode;
+}
+
+void CouchKVStore::releaseCachedDb(Vbid vbucketId,
+                                   uint64_t fileRev,
+                                   uint64_t generation,
+                                   Db* db) {
+    std::vector<Db*> toClose;
+    fileHandleCache->put(vbucketId,
+                         fileRev,
+                         generation,
+                         db,
+                         configuration.getCouchstoreFileHandleCacheSize(),
+                         toClose);
+    closeDatabaseHandles(toClose);
+}
+
+void CouchKVStore::invalidateCachedHandles(Vbid vbucketId) {
+    std::vector<Db*> toClose;
+    fileHandleCache->invalidate(vbucketId, toClose);
+    closeDatabaseHandles(toClose);
+}
+
 void CouchKVStore::populateFileNameMap(std::vector<std::string>& filenames,
                                        std::vector<Vbid>* vbids) {
     std::vector<std::string>::iterator fileItr;
@@ -1885,6 +2449,9 @@ int CouchKVStore::recordDbDump(Db *db, DocInfo *docinfo, void *ctx) {
             openOptions = DECOMPRESS_DOC_BODIES;
         }
 
+        readAhead(db, *sctx, cs_off_t(docinfo->bp));
+        dropBehind(db, *sctx, cs_off_t(docinfo->bp));
+
         auto errCode = couchstore_open_doc_with_docinfo(db, docinfo, &doc,
                                                         openOptions);
 
@@ -1941,6 +2508,31 @@ int CouchKVStore::recordDbDump(Db *db, DocInfo *docinfo, void *ctx) {
     return COUCHSTORE_SUCCESS;
 }
 
+int CouchKVStore::recordDbDumpByKey(Db* db, DocInfo* docinfo, void* ctx) {
+    auto* sctx = static_cast<ScanContext*>(ctx);
+    auto diskKey = makeDiskDocKey(docinfo->id);
+
+    // A resumed scan starts at the last key read
+    if (sctx->lastReadKey && diskKey == *sctx->lastReadKey) {
+        return COUCHSTORE_SUCCESS;
+    }
+
+    // The by-id tree is the latest version of every document; only those
+    // changed since the start of the scan are wanted
+    if (docinfo->db_seq < uint64_t(sctx->startSeqno)) {
+        sctx->lastReadKey = std::move(diskKey);
+        return COUCHSTORE_SUCCESS;
+    }
+
+    const auto lastReadSeqno = sctx->lastReadSeqno;
+    const auto ret = recordDbDump(db, docinfo, ctx);
+    sctx->lastReadSeqno = lastReadSeqno;
+    if (ret == COUCHSTORE_SUCCESS) {
+        sctx->lastReadKey = std::move(diskKey);
+    }
+    return ret;
+}
+
 bool CouchKVStore::commit2couchstore(Collections::VB::Flush& collectionsFlush) {
     bool success = true;
 
@@ -2058,6 +2650,10 @@ couchstore_error_t CouchKVStore::saveDocs(
     couchstore_error_t errCode;
     DbInfo info;
     DbHolder db(*this);
+    // Write back the batch as it's written, so the commit doesn't wait for
+    // all of it
+    statCollectingFileOps->setWriteBack(
+            cs_off_t(configuration.getCouchstoreWritebackSize()));
     errCode = openDB(vbid, db, COUCHSTORE_OPEN_FLAG_CREATE);
     if (errCode != COUCHSTORE_SUCCESS) {
         logger.warn(
@@ -2142,10 +2738,17 @@ couchstore_error_t CouchKVStore::saveDocs(
 
         auto cs_begin = std::chrono::steady_clock::now();
 
+        // In group commit mode the sync of the header is left for
+        // syncPendingCommits(), and we keep the file open until then
+        const bool deferSync =
+                groupCommit &&
+                StatsOps::deferSyncs(couchstore_get_db_filestats(db));
+
         errCode = couchstore_commit(db);
         st.commitHisto.add(
                 std::chrono::duration_cast<std::chrono::microseconds>(
                         std::chrono::steady_clock::now() - cs_begin));
+        invalidateCachedHandles(vbid);
         if (errCode) {
             logger.warn(
                     "CouchKVStore::saveDocs: couchstore_commit error:{} [{}]",
@@ -2181,6 +2784,10 @@ couchstore_error_t CouchKVStore::saveDocs(
                     vbid);
         }
         state->highSeqno = info.last_sequence;
+
+        if (deferSync) {
+            pendingSyncs.emplace_back(vbid, db.releaseDb());
+        }
     }
 
     /* update stat */
@@ -2465,6 +3072,16 @@ void CouchKVStore::deleteCollectionStats(Db& db, CollectionID cid) {
     deleteLocalDoc(db, "|" + cid.to_string() + "|"); // internally logs
 }
 
+Collections::VB::PersistedStats CouchKVStore::getCollectionStats(
+        Db& db, CollectionID cid) {
+    auto lDoc = readLocalDoc(db, "|" + cid.to_string() + "|");
+    if (!lDoc.getLocalDoc()) {
+        return {};
+    }
+    return Collections::VB::PersistedStats(lDoc.getLocalDoc()->json.buf,
+                                           lDoc.getLocalDoc()->json.size);
+}
+
 Collections::VB::PersistedStats CouchKVStore::getCollectionStats(
         const KVFileHandle& kvFileHandle, CollectionID collection) {
     std::string docName = "|" + collection.to_string() + "|";
@@ -2507,7 +3124,6 @@ int CouchKVStore::getMultiCb(Db *db, DocInfo *docinfo, void *ctx) {
 
     GetMultiCbCtx *cbCtx = static_cast<GetMultiCbCtx *>(ctx);
     auto key = makeDiskDocKey(docinfo->id);
-    KVStoreStats& st = cbCtx->cks.getKVStoreStat();
 
     vb_bgfetch_queue_t::iterator qitr = cbCtx->fetches.find(key);
     if (qitr == cbCtx->fetches.end()) {
@@ -2523,16 +3139,24 @@ int CouchKVStore::getMultiCb(Db *db, DocInfo *docinfo, void *ctx) {
         return 0;
     }
 
-    vb_bgfetch_item_ctx_t& bg_itm_ctx = (*qitr).second;
+    // Fetched by getMulti once we've got all of the DocInfos
+    cbCtx->docs.emplace_back(*docinfo, qitr->second);
+    return 0;
+}
+
+void CouchKVStore::fetchDocForBgFetch(Db* db,
+                                      Vbid vbid,
+                                      DocInfo& docinfo,
+                                      vb_bgfetch_item_ctx_t& bg_itm_ctx) {
     GetMetaOnly meta_only = bg_itm_ctx.isMetaOnly;
 
-    couchstore_error_t errCode = cbCtx->cks.fetchDoc(
-            db, docinfo, bg_itm_ctx.value, cbCtx->vbId, meta_only);
+    couchstore_error_t errCode =
+            fetchDoc(db, &docinfo, bg_itm_ctx.value, vbid, meta_only);
     if (errCode != COUCHSTORE_SUCCESS && (meta_only == GetMetaOnly::No)) {
         st.numGetFailure++;
     }
 
-    bg_itm_ctx.value.setStatus(cbCtx->cks.couchErr2EngineErr(errCode));
+    bg_itm_ctx.value.setStatus(couchErr2EngineErr(errCode));
 
     bool return_val_ownership_transferred = false;
     for (auto& fetch : bg_itm_ctx.bgfetched_list) {
@@ -2549,14 +3173,12 @@ int CouchKVStore::getMultiCb(Db *db, DocInfo *docinfo, void *ctx) {
         }
     }
     if (!return_val_ownership_transferred) {
-        cbCtx->cks.logger.warn(
-                "CouchKVStore::getMultiCb called with zero"
+        logger.warn(
+                "CouchKVStore::fetchDocForBgFetch called with zero"
                 "items in bgfetched_list, {}, seqno:{}",
-                cbCtx->vbId,
-                docinfo->rev_seq);
+                vbid,
+                docinfo.rev_seq);
     }
-
-    return 0;
 }
 
 
@@ -2580,6 +3202,12 @@ void CouchKVStore::closeDatabaseHandle(Db *db) {
     st.numClose++;
 }
 
+void CouchKVStore::closeDatabaseHandles(const std::vector<Db*>& dbs) {
+    for (auto* db : dbs) {
+        closeDatabaseHandle(db);
+    }
+}
+
 ENGINE_ERROR_CODE CouchKVStore::couchErr2EngineErr(couchstore_error_t errCode) {
     switch (errCode) {
     case COUCHSTORE_SUCCESS:
@@ -2808,6 +3436,7 @@ RollbackResult CouchKVStore::rollback(Vbid vbid,
 
     //Append the rewinded header to the database file
     errCode = couchstore_commit(newdb);
+    invalidateCachedHandles(vbid);
 
     if (errCode != COUCHSTORE_SUCCESS) {
         return RollbackResult(false, 0, 0, 0);
@@ -2822,6 +3451,10 @@ int populateAllKeys(Db *db, DocInfo *docinfo, void *ctx) {
     AllKeysCtx *allKeysCtx = (AllKeysCtx *)ctx;
     auto key = makeDiskDocKey(docinfo->id);
     (allKeysCtx->cb)->callback(key);
+    if (allKeysCtx->cb->getStatus() != ENGINE_SUCCESS) {
+        // The callback doesn't want any more keys
+        return COUCHSTORE_ERROR_CANCEL;
+    }
     if (--(allKeysCtx->count) <= 0) {
         //Only when count met is less than the actual number of entries
         return COUCHSTORE_ERROR_CANCEL;
@@ -2833,9 +3466,11 @@ ENGINE_ERROR_CODE
 CouchKVStore::getAllKeys(Vbid vbid,
                          const DiskDocKey& start_key,
                          uint32_t count,
-                         std::shared_ptr<Callback<const DiskDocKey&>> cb) {
+                         std::shared_ptr<StatusCallback<const DiskDocKey&>> cb) {
+    // Clients page through the keys with one call after another; keep the
+    // file open between them (if the handle cache is enabled).
     DbHolder db(*this);
-    couchstore_error_t errCode = openDB(vbid, db, COUCHSTORE_OPEN_FLAG_RDONLY);
+    couchstore_error_t errCode = openCachedDB(vbid, db);
     if(errCode == COUCHSTORE_SUCCESS) {
         sized_buf ref = to_sized_buf(start_key);
 
@@ -2866,6 +3501,79 @@ CouchKVStore::getAllKeys(Vbid vbid,
     return ENGINE_FAILED;
 }
 
+struct ScanRangeCtx {
+    CouchKVStore& kvstore;
+    Vbid vbid;
+    const DiskDocKey& endKey;
+    GetMetaOnly metaOnly;
+    std::shared_ptr<StatusCallback<GetValue>> cb;
+    couchstore_error_t fetchError = COUCHSTORE_SUCCESS;
+};
+
+int CouchKVStore::populateRange(Db* db, DocInfo* docinfo, void* ctx) {
+    auto& rangeCtx = *static_cast<ScanRangeCtx*>(ctx);
+    if (!(makeDiskDocKey(docinfo->id) < rangeCtx.endKey)) {
+        return COUCHSTORE_ERROR_CANCEL;
+    }
+
+    GetValue gv;
+    auto errCode = rangeCtx.kvstore.fetchDoc(
+            db, docinfo, gv, rangeCtx.vbid, rangeCtx.metaOnly);
+    if (errCode != COUCHSTORE_SUCCESS) {
+        rangeCtx.fetchError = errCode;
+        return COUCHSTORE_ERROR_CANCEL;
+    }
+    rangeCtx.cb->callback(gv);
+    if (rangeCtx.cb->getStatus() != ENGINE_SUCCESS) {
+        return COUCHSTORE_ERROR_CANCEL;
+    }
+    return COUCHSTORE_SUCCESS;
+}
+
+ENGINE_ERROR_CODE CouchKVStore::scanRange(
+        Vbid vbid,
+        const DiskDocKey& startKey,
+        const DiskDocKey& endKey,
+        ValueFilter valFilter,
+        std::shared_ptr<StatusCallback<GetValue>> cb) {
+    DbHolder db(*this);
+    couchstore_error_t errCode = openCachedDB(vbid, db);
+    if (errCode != COUCHSTORE_SUCCESS) {
+        logger.warn("CouchKVStore::scanRange: openDB error:{}, {}, rev:{}",
+                    couchstore_strerror(errCode),
+                    vbid,
+                    db.getFileRev());
+        return ENGINE_FAILED;
+    }
+
+    sized_buf ref = to_sized_buf(startKey);
+    ScanRangeCtx ctx{*this,
+                     vbid,
+                     endKey,
+                     valFilter == ValueFilter::KEYS_ONLY ? GetMetaOnly::Yes
+                                                         : GetMetaOnly::No,
+                     cb};
+    errCode = couchstore_all_docs(db,
+                                  &ref,
+                                  COUCHSTORE_NO_DELETES,
+                                  populateRange,
+                                  static_cast<void*>(&ctx));
+    if (errCode == COUCHSTORE_ERROR_CANCEL) {
+        errCode = ctx.fetchError;
+    }
+    if (errCode != COUCHSTORE_SUCCESS) {
+        logger.warn(
+                "CouchKVStore::scanRange: couchstore_all_docs "
+                "error:{} [{}] {}, rev:{}",
+                couchstore_strerror(errCode),
+                cb_strerror(),
+                vbid,
+                db.getFileRev());
+        return ENGINE_FAILED;
+    }
+    return ENGINE_SUCCESS;
+}
+
 void CouchKVStore::unlinkCouchFile(Vbid vbucket, uint64_t fRev) {
     if (isReadOnly()) {
         throw std::logic_error("CouchKVStore::unlinkCouchFile: Not valid on a "
@@ -2891,6 +3599,287 @@ void CouchKVStore::unlinkCouchFile(Vbid vbucket, uint64_t fRev) {
     }
 }
 
+/// The start of the file of a bloom filter
+struct BloomFilterFileHeader {
+    uint64_t magic;
+    uint64_t fileRev;
+    uint64_t persistedSeqno;
+};
+
+// "Bloomf01" (in little endian)
+static const uint64_t BloomFilterFileMagic = 0x3130666d6f6f6c42;
+
+std::string CouchKVStore::getBloomFilterFileName(Vbid vbid) const {
+    std::string fname = dbname + "/" + std::to_string(vbid.get()) + ".bloom";
+    cb::io::sanitizePath(fname);
+    return fname;
+}
+
+/**
+ * Write a file through write(), to a new file which is then renamed over
+ * fname, so a crash can't leave a partially written file behind.
+ *
+ * @return true if the file was written
+ */
+static bool writeFileAtomically(const std::string& fname,
+                                const std::function<bool(FILE*)>& write) {
+    const auto next_fname = fname + ".new";
+    FILE* file = fopen(next_fname.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    bool rv = write(file);
+    rv = (fclose(file) == 0) && rv;
+    if (rv && rename(next_fname.c_str(), fname.c_str()) != 0) {
+        rv = false;
+    }
+    if (!rv) {
+        remove(next_fname.c_str());
+    }
+    return rv;
+}
+
+bool CouchKVStore::saveBloomFilter(Vbid vbid,
+                                   uint64_t persistedSeqno,
+                                   const BloomFilter& filter) {
+    uint64_t fileRev;
+    {
+        std::lock_guard<cb::ReaderLock> lg(openDbMutex);
+        fileRev = (*dbFileRevMap)[vbid.get()];
+    }
+    const BloomFilterFileHeader header{
+            BloomFilterFileMagic, fileRev, persistedSeqno};
+    std::string data(reinterpret_cast<const char*>(&header), sizeof(header));
+    data.append(filter.serialise());
+
+    const auto fname = getBloomFilterFileName(vbid);
+    if (!writeFileAtomically(fname, [&data](FILE* file) {
+            return fwrite(data.data(), 1, data.size(), file) == data.size();
+        })) {
+        logger.warn(
+                "CouchKVStore::saveBloomFilter: Failed to write \"{}\": {}",
+                fname,
+                cb_strerror());
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<BloomFilter> CouchKVStore::loadBloomFilter(
+        Vbid vbid, uint64_t persistedSeqno) {
+    const auto fname = getBloomFilterFileName(vbid);
+    if (!cb::io::isFile(fname)) {
+        return {};
+    }
+
+    std::string data;
+    try {
+        data = cb::io::loadFile(fname);
+    } catch (const std::exception& e) {
+        logger.warn("CouchKVStore::loadBloomFilter: Failed to load \"{}\": {}",
+                    fname,
+                    e.what());
+        return {};
+    }
+
+    uint64_t fileRev;
+    {
+        std::lock_guard<cb::ReaderLock> lg(openDbMutex);
+        fileRev = (*dbFileRevMap)[vbid.get()];
+    }
+    BloomFilterFileHeader header;
+    if (data.size() < sizeof(header)) {
+        return {};
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (header.magic != BloomFilterFileMagic || header.fileRev != fileRev ||
+        header.persistedSeqno != persistedSeqno) {
+        // The data has changed since the filter was written
+        return {};
+    }
+    return BloomFilter::deserialise(data.data() + sizeof(header),
+                                    data.size() - sizeof(header));
+}
+
+/// The start of the file of a HashTable image, before the image itself
+struct HashTableImageFileHeader {
+    uint64_t magic;
+    uint64_t fileRev;
+    uint64_t persistedSeqno;
+};
+
+// "HTFile01" (in little endian)
+static const uint64_t HashTableImageFileMagic = 0x3130656c69465448;
+
+std::string CouchKVStore::getHashTableImageFileName(Vbid vbid) const {
+    std::string fname =
+            dbname + "/" + std::to_string(vbid.get()) + ".htimage";
+    cb::io::sanitizePath(fname);
+    return fname;
+}
+
+bool CouchKVStore::saveHashTableImage(Vbid vbid,
+                                      uint64_t persistedSeqno,
+                                      const HashTableImageWriter& image) {
+    uint64_t fileRev;
+    {
+        std::lock_guard<cb::ReaderLock> lg(openDbMutex);
+        fileRev = (*dbFileRevMap)[vbid.get()];
+    }
+    const HashTableImageFileHeader header{
+            HashTableImageFileMagic, fileRev, persistedSeqno};
+
+    const auto fname = getHashTableImageFileName(vbid);
+    if (!writeFileAtomically(fname, [&header, &image](FILE* file) {
+            return fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   image.write(file);
+        })) {
+        logger.warn(
+                "CouchKVStore::saveHashTableImage: Failed to write \"{}\": "
+                "{}",
+                fname,
+                cb_strerror());
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<HashTableImage> CouchKVStore::loadHashTableImage(
+        Vbid vbid, uint64_t persistedSeqno) {
+    const auto fname = getHashTableImageFileName(vbid);
+    if (!cb::io::isFile(fname)) {
+        return {};
+    }
+
+    auto image = HashTableImage::open(fname, sizeof(HashTableImageFileHeader));
+    if (!image) {
+        return {};
+    }
+
+    uint64_t fileRev;
+    {
+        std::lock_guard<cb::ReaderLock> lg(openDbMutex);
+        fileRev = (*dbFileRevMap)[vbid.get()];
+    }
+    HashTableImageFileHeader header;
+    std::memcpy(&header, image->getHeader(), sizeof(header));
+    if (header.magic != HashTableImageFileMagic || header.fileRev != fileRev ||
+        header.persistedSeqno != persistedSeqno) {
+        // The data has changed since the image was written
+        return {};
+    }
+    return image;
+}
+
+/// Create a hard link at target to the file source
+static bool linkFile(const std::string& source, const std::string& target) {
+#ifdef WIN32
+    return CreateHardLink(target.c_str(), source.c_str(), nullptr) != 0;
+#else
+    return link(source.c_str(), target.c_str()) == 0;
+#endif
+}
+
+std::string CouchKVStore::linkVBucketFile(Vbid vbid, const std::string& dir) {
+    // Hold the revision map whilst linking, so compaction can't unlink the
+    // file before it's linked (the link keeps it once it is)
+    std::lock_guard<cb::ReaderLock> lg(openDbMutex);
+    const uint64_t fileRev = (*dbFileRevMap)[vbid.get()];
+    const auto source = getDBFileName(dbname, vbid, fileRev);
+    auto target = dir + "/" + std::to_string(vbid.get()) + ".couch." +
+                  std::to_string(fileRev);
+    cb::io::sanitizePath(target);
+    if (!linkFile(source, target)) {
+        logger.warn(
+                "CouchKVStore::linkVBucketFile: Failed to link \"{}\" to "
+                "\"{}\": {}",
+                source,
+                target,
+                cb_strerror());
+        return {};
+    }
+    return target;
+}
+
+vbucket_state* CouchKVStore::installVBucketFile(Vbid vbid,
+                                                const std::string& path) {
+    if (isReadOnly()) {
+        throw std::logic_error(
+                "CouchKVStore::installVBucketFile: Not valid on a read-only "
+                "object.");
+    }
+
+    // Install the file as the next revision, so nothing still using the
+    // current one (such as a pending delete of it) can affect it
+    const uint64_t oldRev = (*dbFileRevMap)[vbid.get()];
+    const uint64_t newRev = oldRev + 1;
+    const auto fname = getDBFileName(dbname, vbid, newRev);
+    if (rename(path.c_str(), fname.c_str()) != 0) {
+        logger.warn(
+                "CouchKVStore::installVBucketFile: Failed to rename \"{}\" "
+                "to \"{}\": {}",
+                path,
+                fname,
+                cb_strerror());
+        return nullptr;
+    }
+
+    // Put the file back where it was if it isn't a valid data file
+    auto restore = [&path, &fname]() { rename(fname.c_str(), path.c_str()); };
+
+    DbHolder db(*this);
+    auto errCode = openSpecificDB(vbid, newRev, db, COUCHSTORE_OPEN_FLAG_RDONLY);
+    if (errCode != COUCHSTORE_SUCCESS) {
+        restore();
+        return nullptr;
+    }
+
+    DbInfo info;
+    errCode = couchstore_db_info(db, &info);
+    if (errCode != COUCHSTORE_SUCCESS) {
+        logger.warn(
+                "CouchKVStore::installVBucketFile: couchstore_db_info "
+                "error:{}, {}",
+                couchstore_strerror(errCode),
+                vbid);
+        db.close();
+        restore();
+        return nullptr;
+    }
+
+    if (readVBState(db, vbid) != ReadVBStateStatus::Success) {
+        db.close();
+        restore();
+        return nullptr;
+    }
+    db.close();
+
+    cachedDocCount[vbid.get()] = info.doc_count;
+    cachedDeleteCount[vbid.get()] = info.deleted_count;
+    cachedFileSize[vbid.get()] = info.file_size;
+    cachedSpaceUsed[vbid.get()] = info.space_used;
+
+    updateDbFileMap(vbid, newRev);
+    invalidateCachedHandles(vbid);
+    if (cb::io::isFile(getDBFileName(dbname, vbid, oldRev))) {
+        unlinkCouchFile(vbid, oldRev);
+    }
+    // The filter and image of a previous instance of the vBucket don't
+    // match the file installed
+    remove(getBloomFilterFileName(vbid).c_str());
+    remove(getHashTableImageFileName(vbid).c_str());
+
+    logger.info(
+            "CouchKVStore::installVBucketFile: Installed \"{}\" as {}, "
+            "rev:{}, doc_count:{}, high_seqno:{}",
+            path,
+            vbid,
+            newRev,
+            info.doc_count,
+            info.last_sequence);
+    return getVBucketState(vbid);
+}
+
 void CouchKVStore::removeCompactFile(const std::string& dbname, Vbid vbid) {
     std::string dbfile =
             getDBFileName(dbname, vbid, (*dbFileRevMap)[vbid.get()]);
@@ -2950,6 +3939,7 @@ void CouchKVStore::freeFileHandle(KVFileHandle* kvFileHandle) const {
 
 void CouchKVStore::incrementRevision(Vbid vbid) {
     (*dbFileRevMap)[vbid.get()]++;
+    invalidateCachedHandles(vbid);
 }
 
 uint64_t CouchKVStore::prepareToDelete(Vbid vbid) {
@@ -2959,6 +3949,7 @@ uint64_t CouchKVStore::prepareToDelete(Vbid vbid) {
     cachedDeleteCount[vbid.get()] = 0;
     cachedFileSize[vbid.get()] = 0;
     cachedSpaceUsed[vbid.get()] = 0;
+    invalidateCachedHandles(vbid);
     return (*dbFileRevMap)[vbid.get()];
 }
 
@@ -3205,7 +4196,7 @@ couchstore_error_t CouchKVStore::updateCollectionsMeta(
     }
 
     if (!collectionsMeta.droppedCollections.empty()) {
-        err = updateDroppedCollections(db, dropped);
+        err = updateDroppedCollections(db, collectionsFlush, dropped);
         if (err != COUCHSTORE_SUCCESS) {
             return err;
         }
@@ -3339,6 +4330,7 @@ CouchKVStore::updateOpenCollections(Db& db) {
 
 couchstore_error_t CouchKVStore::updateDroppedCollections(
         Db& db,
+        Collections::VB::Flush& collectionsFlush,
         boost::optional<std::vector<Collections::KVStore::DroppedCollection>>
                 dropped) {
     flatbuffers::FlatBufferBuilder builder;
@@ -3352,7 +4344,12 @@ couchstore_error_t CouchKVStore::updateDroppedCollections(
                                                     dropped.collectionId);
         droppedCollections.push_back(newEntry);
 
-        // Delete the 'stats' document for the collection
+        // The items of the collection are no longer part of the vbucket,
+        // even though they stay in the file until the next compaction.
+        // Count them before deleting the 'stats' document for the collection
+        collectionsFlush.addDroppedItems(
+                dropped.collectionId,
+                getCollectionStats(db, dropped.collectionId).itemCount);
         deleteCollectionStats(db, dropped.collectionId);
     }
 
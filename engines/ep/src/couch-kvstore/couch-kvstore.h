@@ -18,6 +18,7 @@
 
 #include "atomicqueue.h"
 #include "configuration.h"
+#include "couch-kvstore/couch-file-handle-cache.h"
 #include "couch-kvstore/couch-fs-stats.h"
 #include "couch-kvstore/couch-kvstore-metadata.h"
 #include "kvstore.h"
@@ -25,6 +26,7 @@
 #include "libcouchstore/couch_db.h"
 #include "monotonic.h"
 
+#include <platform/rwlock.h>
 #include <platform/strerror.h>
 #include <relaxed_atomic.h>
 
@@ -174,6 +176,10 @@ public:
      */
     bool commit(Collections::VB::Flush& collectionsFlush) override;
 
+    bool setGroupCommit(bool enabled) override;
+
+    bool syncPendingCommits() override;
+
     /**
      * Rollback a transaction (unless not currently in one).
      */
@@ -223,6 +229,15 @@ public:
 
     void getMulti(Vbid vb, vb_bgfetch_queue_t& itms) override;
 
+    /**
+     * Each vBucket is a file of its own, so retrieve the vBuckets in
+     * parallel (up to MaxParallelReads at a time) to keep more reads in
+     * flight than a single thread's synchronous reads.
+     */
+    void getMultiParallel(
+            std::vector<std::pair<Vbid, vb_bgfetch_queue_t>>& fetches,
+            const GetMultiCallback& done) override;
+
     void getRange(Vbid vb,
                   const DiskDocKey& startKey,
                   const DiskDocKey& endKey,
@@ -346,6 +361,13 @@ public:
     bool getStat(const char* name, size_t& value) override;
 
     static int recordDbDump(Db *db, DocInfo *docinfo, void *ctx);
+
+    /**
+     * couchstore_all_docs callback of a ScanOrder::ByKey scan(): record the
+     * documents changed since the scan's start seqno, like recordDbDump (but
+     * tracking the last key read instead of the last seqno).
+     */
+    static int recordDbDumpByKey(Db* db, DocInfo* docinfo, void* ctx);
     static int recordDbStat(Db *db, DocInfo *docinfo, void *ctx);
     static int getMultiCb(Db *db, DocInfo *docinfo, void *ctx);
 
@@ -370,11 +392,20 @@ public:
             uint64_t snapEnd,
             uint64_t highSeqno);
 
+    /// couchstore_all_docs callback of scanRange()
+    static int populateRange(Db* db, DocInfo* docinfo, void* ctx);
+
     couchstore_error_t fetchDoc(Db* db,
                                 DocInfo* docinfo,
                                 GetValue& docValue,
                                 Vbid vbId,
                                 GetMetaOnly metaOnly);
+
+    /// Fetch a document for getMulti, and complete the bg fetches of it
+    void fetchDocForBgFetch(Db* db,
+                            Vbid vbid,
+                            DocInfo& docinfo,
+                            vb_bgfetch_item_ctx_t& bg_itm_ctx);
     ENGINE_ERROR_CODE couchErr2EngineErr(couchstore_error_t errCode);
 
     uint64_t getLastPersistedSeqno(Vbid vbid);
@@ -386,7 +417,14 @@ public:
             Vbid vbid,
             const DiskDocKey& start_key,
             uint32_t count,
-            std::shared_ptr<Callback<const DiskDocKey&>> cb) override;
+            std::shared_ptr<StatusCallback<const DiskDocKey&>> cb) override;
+
+    ENGINE_ERROR_CODE scanRange(
+            Vbid vbid,
+            const DiskDocKey& startKey,
+            const DiskDocKey& endKey,
+            ValueFilter valFilter,
+            std::shared_ptr<StatusCallback<GetValue>> cb) override;
 
     ScanContext* initScanContext(
             std::shared_ptr<StatusCallback<GetValue>> cb,
@@ -411,6 +449,44 @@ public:
      */
     void incrementRevision(Vbid vbid) override;
 
+    /**
+     * The filter is written to <vbid>.bloom, stamped with the revision of
+     * the data file (which changes when it is compacted) and the persisted
+     * seqno (which changes when it is written to).
+     */
+    bool saveBloomFilter(Vbid vbid,
+                         uint64_t persistedSeqno,
+                         const BloomFilter& filter) override;
+
+    std::unique_ptr<BloomFilter> loadBloomFilter(
+            Vbid vbid, uint64_t persistedSeqno) override;
+
+    /**
+     * The image is written to <vbid>.htimage, stamped in the same way as
+     * the bloom filter.
+     */
+    bool saveHashTableImage(Vbid vbid,
+                            uint64_t persistedSeqno,
+                            const HashTableImageWriter& image) override;
+
+    std::unique_ptr<HashTableImage> loadHashTableImage(
+            Vbid vbid, uint64_t persistedSeqno) override;
+
+    /**
+     * The link is named as the data file (<vbid>.couch.<rev>). The data
+     * files are append only (a copy is opened at the last header it
+     * holds), and compaction and deletion only unlink the name of the
+     * file, so the link stays valid until it is removed.
+     */
+    std::string linkVBucketFile(Vbid vbid, const std::string& dir) override;
+
+    /**
+     * The file is renamed to the next revision of the data file of the
+     * vBucket, and the current revision (if any) is unlinked.
+     */
+    vbucket_state* installVBucketFile(Vbid vbid,
+                                      const std::string& path) override;
+
     /**
      * Prepare for delete of the vbucket file, this just removes the in-memory
      * stats for the vbucket and returns the current file revision (which is
@@ -477,10 +553,35 @@ protected:
             return fileRev;
         }
 
+        /// The handle was opened by openCachedDB(), return it to the cache
+        /// (rather than closing it) when done with it
+        void setCached(Vbid vb, uint64_t gen) {
+            cached = true;
+            vbid = vb;
+            generation = gen;
+        }
+
+        bool isCached() const {
+            return cached;
+        }
+
+        Vbid getVbid() const {
+            return vbid;
+        }
+
+        uint64_t getGeneration() const {
+            return generation;
+        }
+
         // Allow a non-RAII close, needed for some use-cases
         void close() {
             if (db) {
-                kvstore.closeDatabaseHandle(releaseDb());
+                if (cached) {
+                    cached = false;
+                    kvstore.releaseCachedDb(vbid, fileRev, generation, releaseDb());
+                } else {
+                    kvstore.closeDatabaseHandle(releaseDb());
+                }
             }
         }
 
@@ -490,6 +591,9 @@ protected:
         CouchKVStore& kvstore;
         Db* db;
         uint64_t fileRev;
+        bool cached{false};
+        Vbid vbid{0};
+        uint64_t generation{0};
     };
 
     /**
@@ -582,6 +686,26 @@ protected:
                                       couchstore_open_flags options,
                                       FileOpsInterface* ops = nullptr);
 
+    /**
+     * Open the vbucket file read-only for a short read (e.g. a background
+     * fetch). A read-only store with couchstore_file_handle_cache_size set
+     * reuses an idle handle of the file if it's up to date, and the handle
+     * is returned to the cache when the DbHolder is done with it.
+     */
+    couchstore_error_t openCachedDB(Vbid vbucketId, DbHolder& db);
+
+    /// Return a handle opened by openCachedDB() to the cache
+    void releaseCachedDb(Vbid vbucketId,
+                         uint64_t fileRev,
+                         uint64_t generation,
+                         Db* db);
+
+    /**
+     * The vbucket's file has a new header or revision; the cached handles
+     * opened before it can't be used any more (and are closed).
+     */
+    void invalidateCachedHandles(Vbid vbucketId);
+
     /**
      * save the Documents held in docs to the file associated with vbid/rev
      *
@@ -623,6 +747,10 @@ protected:
      */
     void deleteCollectionStats(Db& db, CollectionID cid);
 
+    /// Read the count for collection cid (zero if there isn't one)
+    Collections::VB::PersistedStats getCollectionStats(Db& db,
+                                                       CollectionID cid);
+
     Collections::VB::PersistedStats getCollectionStats(
             const KVFileHandle& kvFileHandle, CollectionID collection) override;
 
@@ -700,12 +828,15 @@ protected:
      * dropped collections.
      *
      * @param db The database handle to update
+     * @param collectionsFlush receives the number of items of the newly
+     *        dropped collections
      * @param dropped This method will only read the dropped collections from
      *        storage if this optional is not initialised
      * @return error code success or other (non-success is logged)
      */
     couchstore_error_t updateDroppedCollections(
             Db& db,
+            Collections::VB::Flush& collectionsFlush,
             boost::optional<
                     std::vector<Collections::KVStore::DroppedCollection>>
                     dropped);
@@ -738,6 +869,7 @@ protected:
 
     void setDocsCommitted(uint16_t docs);
     void closeDatabaseHandle(Db *db);
+    void closeDatabaseHandles(const std::vector<Db*>& dbs);
 
     /**
      * Unlink selected couch file, which will be removed by the OS,
@@ -753,6 +885,12 @@ protected:
      */
     void removeCompactFile(const std::string& dbname, Vbid vbid);
 
+    /// The name of the file saveBloomFilter() writes the filter to
+    std::string getBloomFilterFileName(Vbid vbid) const;
+
+    /// The name of the file saveHashTableImage() writes the image to
+    std::string getHashTableImageFileName(Vbid vbid) const;
+
     void removeCompactFile(const std::string &filename);
 
     /**
@@ -764,6 +902,25 @@ protected:
     bool compactDBInternal(compaction_ctx* hook_ctx,
                            couchstore_docinfo_hook dhook);
 
+    /**
+     * @return true if the compaction must rewrite the file: it's fragmented
+     *         at least couchstore_compaction_min_fragmentation, or items must
+     *         be dropped regardless of their age (drop_deletes or dropped
+     *         collections).
+     */
+    bool needsRewrite(const compaction_ctx& hook_ctx,
+                      const DbInfo& info) const;
+
+    /**
+     * Compact a file which doesn't need rewriting: only scan the by-seqno
+     * index, notifying expired items and filling the bloom filter. Purgeable
+     * tombstones are left for the next compaction which rewrites the file.
+     * @return true if the scan succeeded
+     */
+    bool compactDBWithoutRewrite(DbHolder& db,
+                                 compaction_ctx* hook_ctx,
+                                 std::chrono::steady_clock::time_point start);
+
     /// Copy relevant DbInfo stats to the common FileStats struct
     static FileInfo toFileInfo(const DbInfo& info);
 
@@ -781,6 +938,12 @@ protected:
      */
     std::shared_ptr<RevisionMap> dbFileRevMap;
 
+    /**
+     * The idle handles of the RO store; the RW store invalidates them when
+     * it commits. Shared by the RW/RO pair, as the RevisionMap.
+     */
+    std::shared_ptr<CouchFileHandleCache> fileHandleCache;
+
     /**
      * An internal rwlock used to keep openDB and compaction in sync
      * Primarily that compaction and scans can be ran concurrently, we must
@@ -793,6 +956,12 @@ protected:
     uint16_t numDbFiles;
     PendingRequestQueue pendingReqsQ;
     bool intransaction;
+
+    /// Group commit; saveDocs() and setVBucketState() defer the sync of
+    /// the commit header
+    bool groupCommit = false;
+    /// The files whose commit hasn't been synced yet (in group commit mode)
+    std::vector<std::pair<Vbid, Db*>> pendingSyncs;
     std::unique_ptr<TransactionContext> transactionCtx;
 
     /**
@@ -801,7 +970,7 @@ protected:
      *
      * Backed by this->st.fsStats
      */
-    std::unique_ptr<FileOpsInterface> statCollectingFileOps;
+    std::unique_ptr<StatsOps> statCollectingFileOps;
 
     /**
      * FileOpsInterface implementation for couchstore which tracks
@@ -809,7 +978,7 @@ protected:
      *
      * Backed by this->st.fsStatsCompaction
      */
-    std::unique_ptr<FileOpsInterface> statCollectingFileOpsCompaction;
+    std::unique_ptr<StatsOps> statCollectingFileOpsCompaction;
 
     /* deleted docs in each file, indexed by vBucket. RelaxedAtomic
        to allow stats access witout lock */
@@ -841,11 +1010,13 @@ private:
      * @param readOnly true if the store can only do read functionality
      * @param dbFileRevMap a revisionMap to use (which should be data owned by
      *        the RW store).
+     * @param fileHandleCache the handle cache to share with the pair store
      */
     CouchKVStore(KVStoreConfig& config,
                  FileOpsInterface& ops,
                  bool readOnly,
-                 std::shared_ptr<RevisionMap> dbFileRevMap);
+                 std::shared_ptr<RevisionMap> dbFileRevMap,
+                 std::shared_ptr<CouchFileHandleCache> fileHandleCache);
 
     /**
      * Construct a read-only store - private as should be called via
@@ -854,9 +1025,11 @@ private:
      * @param config configuration data for the store
      * @param dbFileRevMap The revisionMap to use (which should be intially
      * created owned by the RW store).
+     * @param fileHandleCache The handle cache of the RW store
      */
     CouchKVStore(KVStoreConfig& config,
-                 std::shared_ptr<RevisionMap> dbFileRevMap);
+                 std::shared_ptr<RevisionMap> dbFileRevMap,
+                 std::shared_ptr<CouchFileHandleCache> fileHandleCache);
 
 
     class CouchKVFileHandle : public ::KVFileHandle {
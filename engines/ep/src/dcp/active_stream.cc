@@ -18,6 +18,7 @@
 #include "active_stream_impl.h"
 
 #include "checkpoint_manager.h"
+#include "dcp/dcpconnmap.h"
 #include "dcp/producer.h"
 #include "dcp/response.h"
 #include "ep_time.h"
@@ -62,6 +63,8 @@ ActiveStream::ActiveStream(EventuallyPersistentEngine* e,
       waitForSnapshot(0),
       engine(e),
       producerPtr(p),
+      streamLockProfile(e->getEpStats().lockProfiler.get(
+              LockProfiler::Lock::DcpStream)),
       takeoverSendMaxTime(e->getConfiguration().getDcpTakeoverMaxTime()),
       lastSentSnapEndSeqno(0),
       chkptItemsExtractionInProgress(false),
@@ -79,8 +82,13 @@ ActiveStream::ActiveStream(EventuallyPersistentEngine* e,
                                     : ForceValueCompression::No),
       syncReplication(p->isSyncReplicationEnabled() ? SyncReplication::Yes
                                                     : SyncReplication::No),
+      keyOrderBackfill(p->isKeyOrderBackfillEnabled() &&
+                                       !p->isSyncReplicationEnabled()
+                               ? KeyOrderBackfill::Yes
+                               : KeyOrderBackfill::No),
       filter(std::move(f)),
-      sid(filter.getStreamId()) {
+      sid(filter.getStreamId()),
+      singleCollection(filter.getSingleCollection()) {
     const char* type = "";
     if (flags_ & DCP_ADD_STREAM_FLAG_TAKEOVER) {
         type = "takeover ";
@@ -126,7 +134,7 @@ ActiveStream::ActiveStream(EventuallyPersistentEngine* e,
         /* streamMutex lock needs to be acquired because endStream
          * potentially makes call to pushToReadyQueue.
          */
-        LockHolder lh(streamMutex);
+        ProfiledLockHolder lh(streamMutex, streamLockProfile);
         endStream(END_STREAM_OK);
         itemsReady.store(true);
         // lock is released on leaving the scope
@@ -140,7 +148,7 @@ ActiveStream::~ActiveStream() {
 }
 
 std::unique_ptr<DcpResponse> ActiveStream::next() {
-    std::lock_guard<std::mutex> lh(streamMutex);
+    ProfiledLockHolder lh(streamMutex, streamLockProfile);
     return next(lh);
 }
 
@@ -233,7 +241,7 @@ void ActiveStream::registerCursor(CheckpointManager& chkptmgr,
 
 void ActiveStream::markDiskSnapshot(uint64_t startSeqno, uint64_t endSeqno) {
     {
-        LockHolder lh(streamMutex);
+        ProfiledLockHolder lh(streamMutex, streamLockProfile);
         uint64_t chkCursorSeqno = endSeqno;
 
         if (!isBackfilling()) {
@@ -316,7 +324,8 @@ bool ActiveStream::backfillReceived(std::unique_ptr<Item> itm,
     std::unique_lock<std::mutex> lh(streamMutex);
     if (isBackfilling() && filter.checkAndUpdate(*itm)) {
         queued_item qi(std::move(itm));
-        std::unique_ptr<DcpResponse> resp(makeResponseFromItem(qi));
+        std::unique_ptr<DcpResponse> resp(
+                makeResponseFromItem(qi, /*fromCheckpoint*/ false));
         auto producer = producerPtr.lock();
         if (!producer || !producer->recordBackfillManagerBytesRead(
                                  resp->getApproximateSize(), force)) {
@@ -328,7 +337,11 @@ bool ActiveStream::backfillReceived(std::unique_ptr<Item> itm,
 
         bufferedBackfill.bytes.fetch_add(resp->getApproximateSize());
         bufferedBackfill.items++;
-        lastReadSeqno.store(uint64_t(*resp->getBySeqno()));
+        // Out of order in a key order backfill
+        const auto seqno = uint64_t(*resp->getBySeqno());
+        if (!isKeyOrderBackfill() || seqno > lastReadSeqno) {
+            lastReadSeqno.store(seqno);
+        }
 
         pushToReadyQ(std::move(resp));
 
@@ -347,7 +360,7 @@ bool ActiveStream::backfillReceived(std::unique_ptr<Item> itm,
 
 void ActiveStream::completeBackfill() {
     {
-        LockHolder lh(streamMutex);
+        ProfiledLockHolder lh(streamMutex, streamLockProfile);
         if (isBackfilling()) {
             log(spdlog::level::level_enum::info,
                 "{} Backfill complete, {}"
@@ -374,6 +387,13 @@ void ActiveStream::completeBackfill() {
     notifyStreamReady();
 }
 
+void ActiveStream::resetBackfillScanBuffer() {
+    auto producer = producerPtr.lock();
+    if (producer) {
+        producer->resetBackfillManagerScanBuffer();
+    }
+}
+
 void ActiveStream::snapshotMarkerAckReceived() {
     if (--waitForSnapshot == 0) {
         notifyStreamReady();
@@ -697,7 +717,7 @@ void ActiveStream::addStats(const AddStatFn& add_stat, const void* c) {
 void ActiveStream::addTakeoverStats(const AddStatFn& add_stat,
                                     const void* cookie,
                                     const VBucket& vb) {
-    LockHolder lh(streamMutex);
+    ProfiledLockHolder lh(streamMutex, streamLockProfile);
 
     add_casted_stat("name", name_, add_stat, cookie);
     if (!isActive()) {
@@ -767,8 +787,12 @@ std::unique_ptr<DcpResponse> ActiveStream::nextQueuedItem() {
         }
         if (producer->bufferLogInsert(response->getMessageSize())) {
             auto seqno = response->getBySeqno();
-            if (seqno) {
+            // Out of order in a key order backfill
+            if (seqno && (!isKeyOrderBackfill() ||
+                          uint64_t(*seqno) > lastSentSeqno)) {
                 lastSentSeqno.store(*seqno);
+            }
+            if (seqno) {
 
                 if (isBackfilling()) {
                     backfillItems.sent++;
@@ -802,7 +826,7 @@ bool ActiveStream::nextCheckpointItem() {
 
 void ActiveStream::nextCheckpointItemTask() {
     // MB-29369: Obtain stream mutex here
-    LockHolder lh(streamMutex);
+    ProfiledLockHolder lh(streamMutex, streamLockProfile);
     nextCheckpointItemTask(lh);
 }
 
@@ -836,7 +860,7 @@ std::vector<queued_item> ActiveStream::getOutstandingItems(VBucket& vb) {
                     std::chrono::steady_clock::now() - _begin_));
 
     if (vb.checkpointManager->hasClosedCheckpointWhichCanBeRemoved()) {
-        engine->getKVBucket()->wakeUpCheckpointRemover();
+        engine->getKVBucket()->scheduleCheckpointRemoval(vb.getId());
     }
     return items;
 }
@@ -891,7 +915,7 @@ static bool shouldModifyItem(const queued_item& item,
 }
 
 std::unique_ptr<DcpResponse> ActiveStream::makeResponseFromItem(
-        const queued_item& item) {
+        const queued_item& item, bool fromCheckpoint) {
     // Note: This function is hot - it is called for every item to be
     // sent over the DCP connection.
 
@@ -925,7 +949,8 @@ std::unique_ptr<DcpResponse> ActiveStream::makeResponseFromItem(
             if (isSnappyEnabled()) {
                 if (isForceValueCompressionEnabled()) {
                     if (!mcbp::datatype::is_snappy(finalItem->getDataType())) {
-                        if (!finalItem->compressValue()) {
+                        if (!compressValue(
+                                    *finalItem, item, fromCheckpoint)) {
                             log(spdlog::level::level_enum::warn,
                                 "{} Failed to snappy compress an uncompressed "
                                 "value",
@@ -971,6 +996,27 @@ std::unique_ptr<DcpResponse> ActiveStream::makeResponseFromItem(
     return SystemEventProducerMessage::make(opaque_, item, sid);
 }
 
+bool ActiveStream::compressValue(Item& finalItem,
+                                 const queued_item& item,
+                                 bool fromCheckpoint) {
+    auto& cache = engine->getDcpConnMap().getCompressedValueCache();
+    // Only the checkpoint items sent as queued have values other streams
+    // send too
+    if (!fromCheckpoint || cache.getMaxSize() == 0 ||
+        finalItem.getValue().get() != item->getValue().get().get()) {
+        return finalItem.compressValue();
+    }
+
+    value_t compressed;
+    if (!cache.compress(finalItem.getValue(), compressed)) {
+        return false;
+    }
+    if (compressed.get() != finalItem.getValue().get().get()) {
+        finalItem.setCompressedValue(compressed);
+    }
+    return true;
+}
+
 void ActiveStream::processItems(std::vector<queued_item>& items,
                                 const LockHolder& streamMutex) {
     if (!items.empty()) {
@@ -1116,7 +1162,7 @@ void ActiveStream::snapshot(std::deque<std::unique_ptr<DcpResponse>>& items) {
 
 uint32_t ActiveStream::setDead(end_stream_status_t status) {
     {
-        LockHolder lh(streamMutex);
+        ProfiledLockHolder lh(streamMutex, streamLockProfile);
         endStream(status);
     }
 
@@ -1287,6 +1333,24 @@ void ActiveStream::scheduleBackfill_UNLOCKED(bool reschedule) {
         }
     }
 
+    if (backfillStart <= backfillEnd && tryBackfill) {
+        // Nothing to backfill if none of the collections of the filter
+        // changed since the last seqno read (as with the stream of a quiet
+        // collection reconnecting)
+        const auto collectionsHighSeqno =
+                filter.getHighSeqno(vbucket->getManifest());
+        if (collectionsHighSeqno && *collectionsHighSeqno < backfillStart) {
+            log(spdlog::level::level_enum::info,
+                "{} Skipping backfill from {} to {} as the collections of "
+                "the filter are at seqno {}",
+                logPrefix,
+                backfillStart,
+                backfillEnd,
+                *collectionsHighSeqno);
+            tryBackfill = false;
+        }
+    }
+
     if (backfillStart <= backfillEnd && tryBackfill) {
         log(spdlog::level::level_enum::info,
             "{} Scheduling backfill "
@@ -1390,7 +1454,7 @@ void ActiveStream::scheduleBackfill_UNLOCKED(bool reschedule) {
 }
 
 bool ActiveStream::handleSlowStream() {
-    LockHolder lh(streamMutex);
+    ProfiledLockHolder lh(streamMutex, streamLockProfile);
     log(spdlog::level::level_enum::info,
         "{} Handling slow stream; "
         "state_ : {}, "
@@ -1656,6 +1720,13 @@ bool ActiveStream::removeCheckpointCursor() {
              * cursor to ensure that it is not used.
              */
             cursor.reset();
+            // The stream may have been the last cursor keeping the oldest
+            // checkpoints alive
+            auto* kvBucket = engine->getKVBucket();
+            if (kvBucket->isChkRemoverEventDriven() &&
+                vb->checkpointManager->hasClosedCheckpointWhichCanBeRemoved()) {
+                kvBucket->scheduleCheckpointRemoval(vb_);
+            }
             return true;
         }
     }
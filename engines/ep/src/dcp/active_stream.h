@@ -19,6 +19,7 @@
 
 #include "collections/vbucket_filter.h"
 #include "dcp/stream.h"
+#include "lock_profiler.h"
 #include <spdlog/common.h>
 
 class CheckpointManager;
@@ -96,7 +97,7 @@ public:
     std::unique_ptr<DcpResponse> next() override;
 
     void setActive() override {
-        LockHolder lh(streamMutex);
+        ProfiledLockHolder lh(streamMutex, streamLockProfile);
         if (isPending()) {
             transitionState(StreamState::Backfilling);
         }
@@ -122,6 +123,12 @@ public:
 
     void completeBackfill();
 
+    /**
+     * Start a new backfill scan buffer for the stream's connection (after a
+     * run of a shared backfill the stream joined, see BackfillStreams)
+     */
+    void resetBackfillScanBuffer();
+
     bool isCompressionEnabled();
 
     bool isForceValueCompressionEnabled() const {
@@ -168,6 +175,11 @@ public:
 
     /// @return true if both includeValue and includeXattributes are set to No,
     /// otherwise return false.
+    /// @return the collection, if the stream only streams one collection
+    boost::optional<CollectionID> getSingleCollection() const {
+        return singleCollection;
+    }
+
     bool isKeyOnly() const {
         // IncludeValue::NoWithUnderlyingDatatype doesn't allow key-only,
         // as we need to fetch the datatype also (which is not present in
@@ -211,10 +223,22 @@ protected:
     std::unique_ptr<DcpResponse> nextQueuedItem();
 
     /**
+     * @param fromCheckpoint is the item a checkpoint item (which other
+     *        streams send too), rather than one read by our backfill?
      * @return a DcpResponse to represent the item. This will be either a
      *         MutationResponse or SystemEventProducerMessage.
      */
-    std::unique_ptr<DcpResponse> makeResponseFromItem(const queued_item& item);
+    std::unique_ptr<DcpResponse> makeResponseFromItem(
+            const queued_item& item, bool fromCheckpoint = true);
+
+    /**
+     * Snappy compress the value of a copy of the item to send, taking the
+     * compressed value from the bucket's CompressedValueCache if the item is
+     * a checkpoint item sent with its whole value.
+     */
+    bool compressValue(Item& finalItem,
+                       const queued_item& item,
+                       bool fromCheckpoint);
 
     /* The transitionState function is protected (as opposed to private) for
      * testing purposes.
@@ -244,6 +268,17 @@ protected:
         return syncReplication == SyncReplication::Yes;
     }
 
+    /**
+     * Should disk snapshots be backfilled in key order (if the KVStore can)?
+     * Only streams which negotiated it and don't do synchronous replication
+     * (which relies on the prepares and commits being sent in seqno order);
+     * the items of a snapshot then arrive out of seqno order, and only at
+     * the end of the snapshot has the client got everything up to its end.
+     */
+    bool isKeyOrderBackfill() const {
+        return keyOrderBackfill == KeyOrderBackfill::Yes;
+    }
+
     /* Indicates that a backfill has been scheduled and has not yet completed.
      * Is protected (as opposed to private) for testing purposes.
      */
@@ -380,6 +415,9 @@ private:
     EventuallyPersistentEngine* const engine;
     const std::weak_ptr<DcpProducer> producerPtr;
 
+    // Where acquisitions of the streamMutex are profiled (stats.lockProfiler)
+    LockProfile& streamLockProfile;
+
     struct {
         std::atomic<size_t> bytes;
         std::atomic<size_t> items;
@@ -427,6 +465,9 @@ private:
     /// Does this stream support synchronous replication?
     const SyncReplication syncReplication;
 
+    /// Does this stream backfill in key order?
+    const KeyOrderBackfill keyOrderBackfill;
+
     /**
      * The filter the stream will use to decide which keys should be transmitted
      */
@@ -439,6 +480,13 @@ protected:
      */
     const cb::mcbp::DcpStreamId sid;
 
+    /**
+     * The filter's single collection (if any) when the stream was created.
+     * The filter only shrinks, so this remains its only collection; kept
+     * const so the backfill thread can read it.
+     */
+    const boost::optional<CollectionID> singleCollection;
+
 private:
     /**
      * A prefix to use in all stream log messages
@@ -25,10 +25,14 @@
 #include <climits>
 
 ActiveStreamCheckpointProcessorTask::ActiveStreamCheckpointProcessorTask(
-        EventuallyPersistentEngine& e, std::shared_ptr<DcpProducer> p)
+        EventuallyPersistentEngine& e,
+        std::shared_ptr<DcpProducer> p,
+        size_t index)
     : GlobalTask(
               &e, TaskId::ActiveStreamCheckpointProcessorTask, INT_MAX, false),
-      description("Process checkpoint(s) for DCP producer " + p->getName()),
+      description("Process checkpoint(s) for DCP producer " + p->getName() +
+                  (index ? " (task " + std::to_string(index) + ")" : "")),
+      index(index),
       notified(false),
       iterationsBeforeYield(
               e.getConfiguration().getDcpProducerSnapshotMarkerYieldLimit()),
@@ -106,6 +110,9 @@ void ActiveStreamCheckpointProcessorTask::addStats(const std::string& name,
     }
 
     auto prefix = name + ":ckpt_processor_";
+    if (index) {
+        prefix += std::to_string(index) + "_";
+    }
     add_casted_stat((prefix + "queue_size").c_str(), qCopy.size(), add_stat, c);
     add_casted_stat(
             (prefix + "queue_map_size").c_str(), qMapCopy.size(), add_stat, c);
@@ -32,10 +32,19 @@ class Stream;
 template <class E>
 class StreamContainer;
 
+/**
+ * Processes the checkpoints of the streams of a DCP producer, one vbucket
+ * after another. A producer has dcp_producer_processor_tasks of them, each
+ * processing the streams of its own share of the vbuckets.
+ */
 class ActiveStreamCheckpointProcessorTask : public GlobalTask {
 public:
+    /**
+     * @param index the index of the task among the producer's tasks
+     */
     ActiveStreamCheckpointProcessorTask(EventuallyPersistentEngine& e,
-                                        std::shared_ptr<DcpProducer> p);
+                                        std::shared_ptr<DcpProducer> p,
+                                        size_t index = 0);
 
     std::string getDescription() {
         return description;
@@ -84,6 +93,9 @@ private:
     /// Human-readable description of this task.
     const std::string description;
 
+    /// The index of the task among the producer's tasks
+    const size_t index;
+
     /// Guards queue && queuedVbuckets
     mutable std::mutex workQueueLock;
 
@@ -20,6 +20,7 @@
 #include "dcp/active_stream.h"
 #include "dcp/backfill-manager.h"
 #include "dcp/backfill_disk.h"
+#include "dcp/backfill_governor.h"
 #include "dcp/dcpconnmap.h"
 #include "dcp/producer.h"
 #include "ep_engine.h"
@@ -28,6 +29,8 @@
 
 #include <phosphor/phosphor.h>
 
+#include <algorithm>
+
 static const size_t sleepTime = 1;
 
 class BackfillManagerTask : public GlobalTask {
@@ -119,6 +122,12 @@ void BackfillManager::addStats(DcpProducer& conn,
             "backfill_buffer_next_read_size", buffer.nextReadSize, add_stat, c);
     conn.addStat("backfill_buffer_max_bytes", buffer.maxBytes, add_stat, c);
     conn.addStat("backfill_buffer_full", buffer.full, add_stat, c);
+    conn.addStat("backfill_buffer_node_share",
+                 governorWeight == 0
+                         ? 0
+                         : BackfillGovernor::get().getShare(governorWeight),
+                 add_stat,
+                 c);
     conn.addStat("backfill_num_active", activeBackfills.size(), add_stat, c);
     conn.addStat(
             "backfill_num_snoozing", snoozingBackfills.size(), add_stat, c);
@@ -131,6 +140,10 @@ BackfillManager::~BackfillManager() {
         managerTask.reset();
     }
 
+    // The items in our buffer are no longer counted against the budget
+    BackfillGovernor::get().bytesReleased(buffer.bytesRead);
+    removeFromGovernor();
+
     while (!activeBackfills.empty()) {
         UniqueDCPBackfillPtr backfill = std::move(activeBackfills.front());
         activeBackfills.pop_front();
@@ -160,13 +173,25 @@ void BackfillManager::schedule(VBucket& vb,
     LockHolder lh(lock);
     UniqueDCPBackfillPtr backfill =
             vb.createDCPBackfill(engine, stream, start, end);
-    if (engine.getDcpConnMap().canAddBackfillToActiveQ()) {
+    if (!backfill) {
+        // Joined another connection's backfill
+        return;
+    }
+    const auto priority = getPriority(*stream);
+    backfill->setPriority(priority);
+    if (priority != BackfillPriority::Normal) {
+        // Don't make the takeover and replication streams wait for the
+        // other backfills of the bucket to complete
+        engine.getDcpConnMap().addBackfillToActiveQ();
+        enqueue(activeBackfills, std::move(backfill));
+    } else if (engine.getDcpConnMap().canAddBackfillToActiveQ()) {
         activeBackfills.push_back(std::move(backfill));
     } else {
         EP_LOG_INFO(
                 "Backfill for {} {} is pending", stream->getName(), vb.getId());
         pendingBackfills.push_back(std::move(backfill));
     }
+    addToGovernor();
 
     if (managerTask && !managerTask->isdead()) {
         ExecutorPool::get()->wake(managerTask->getId());
@@ -193,8 +218,10 @@ bool BackfillManager::bytesCheckAndRead(size_t bytes) {
         return false;
     }
 
-    if (buffer.bytesRead == 0 || buffer.bytesRead + bytes <= buffer.maxBytes) {
+    if (buffer.bytesRead == 0 ||
+        buffer.bytesRead + bytes <= getBufferMaxBytes()) {
         buffer.bytesRead += bytes;
+        BackfillGovernor::get().bytesRead(bytes);
     } else {
         scanBuffer.bytesRead -= bytes;
         buffer.full = true;
@@ -215,8 +242,9 @@ void BackfillManager::bytesForceRead(size_t bytes) {
     ++scanBuffer.itemsRead;
     scanBuffer.bytesRead += bytes;
     buffer.bytesRead += bytes;
+    BackfillGovernor::get().bytesRead(bytes);
 
-    if (buffer.bytesRead > buffer.maxBytes) {
+    if (buffer.bytesRead > getBufferMaxBytes()) {
         /* Setting this flag prevents running other backfills and hence prevents
            further increase in the memory usage.
            Note: The current backfill will run to completion and that is desired
@@ -233,12 +261,14 @@ void BackfillManager::bytesSent(size_t bytes) {
                 "buffer.bytesRead (which is" + std::to_string(buffer.bytesRead) + ")");
     }
     buffer.bytesRead -= bytes;
+    BackfillGovernor::get().bytesReleased(bytes);
 
     if (buffer.full) {
-        /* We can have buffer.bytesRead > buffer.maxBytes */
-        size_t unfilledBufferSize = (buffer.maxBytes > buffer.bytesRead)
-                                            ? buffer.maxBytes - buffer.bytesRead
-                                            : buffer.maxBytes;
+        const auto maxBytes = getBufferMaxBytes();
+        /* We can have buffer.bytesRead > maxBytes */
+        size_t unfilledBufferSize = (maxBytes > buffer.bytesRead)
+                                            ? maxBytes - buffer.bytesRead
+                                            : maxBytes;
 
         /* If buffer.bytesRead == 0 we want to fit the next read into the
            backfill buffer irrespective of its size */
@@ -247,7 +277,7 @@ void BackfillManager::bytesSent(size_t bytes) {
 
         /* <= implicitly takes care of the case where
            buffer.bytesRead == (buffer.maxBytes * 3 / 4) == 0 */
-        bool enoughCleared = buffer.bytesRead <= (buffer.maxBytes * 3 / 4);
+        bool enoughCleared = buffer.bytesRead <= (maxBytes * 3 / 4);
         if (canFitNext && enoughCleared) {
             buffer.nextReadSize = 0;
             buffer.full = false;
@@ -258,12 +288,19 @@ void BackfillManager::bytesSent(size_t bytes) {
     }
 }
 
+void BackfillManager::resetScanBuffer() {
+    LockHolder lh(lock);
+    scanBuffer.bytesRead = 0;
+    scanBuffer.itemsRead = 0;
+}
+
 backfill_status_t BackfillManager::backfill() {
     std::unique_lock<std::mutex> lh(lock);
 
     if (activeBackfills.empty() && snoozingBackfills.empty()
         && pendingBackfills.empty()) {
         managerTask.reset();
+        removeFromGovernor();
         return backfill_finished;
     }
 
@@ -318,7 +355,7 @@ backfill_status_t BackfillManager::backfill() {
 
     switch (status) {
         case backfill_success:
-            activeBackfills.push_back(std::move(backfill));
+            enqueue(activeBackfills, std::move(backfill));
             break;
         case backfill_finished:
             lh.unlock();
@@ -362,7 +399,7 @@ void BackfillManager::moveToActiveQueue() {
         // If snoozing task is found to be sleeping for greater than
         // allowed snoozetime, push into active queue
         if (snoozer.first + sleepTime <= ep_current_time()) {
-            activeBackfills.push_back(std::move(snoozer.second));
+            enqueue(activeBackfills, std::move(snoozer.second));
         } else {
             // Push back the popped snoozing backfill
             snoozingBackfills.push_back(std::move(snoozer));
@@ -371,6 +408,52 @@ void BackfillManager::moveToActiveQueue() {
     }
 }
 
+BackfillPriority BackfillManager::getPriority(ActiveStream& stream) const {
+    if (!engine.getConfiguration().isDcpBackfillPrioritization()) {
+        return BackfillPriority::Normal;
+    }
+    if (stream.getFlags() & DCP_ADD_STREAM_FLAG_TAKEOVER) {
+        return BackfillPriority::Takeover;
+    }
+    // ns_server names the replication connections "replication:<from>-><to>"
+    if (stream.getName().find("replication:") == 0) {
+        return BackfillPriority::Replication;
+    }
+    return BackfillPriority::Normal;
+}
+
+void BackfillManager::enqueue(std::list<UniqueDCPBackfillPtr>& queue,
+                              UniqueDCPBackfillPtr backfill) {
+    const auto priority = backfill->getPriority();
+    auto it = std::find_if(
+            queue.begin(), queue.end(), [priority](const auto& queued) {
+                return queued->getPriority() < priority;
+            });
+    queue.insert(it, std::move(backfill));
+}
+
+size_t BackfillManager::getBufferMaxBytes() const {
+    if (governorWeight == 0) {
+        return buffer.maxBytes;
+    }
+    return std::min(buffer.maxBytes,
+                    BackfillGovernor::get().getShare(governorWeight));
+}
+
+void BackfillManager::addToGovernor() {
+    if (governorWeight == 0) {
+        governorWeight = engine.getConfiguration().getDcpBackfillNodeWeight();
+        BackfillGovernor::get().addWeight(governorWeight);
+    }
+}
+
+void BackfillManager::removeFromGovernor() {
+    if (governorWeight != 0) {
+        BackfillGovernor::get().removeWeight(governorWeight);
+        governorWeight = 0;
+    }
+}
+
 void BackfillManager::wakeUpTask() {
     LockHolder lh(lock);
     if (managerTask) {
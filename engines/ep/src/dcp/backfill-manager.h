@@ -40,6 +40,13 @@
  * - dcp_scan_byte_limit
  * - dcp_scan_item_limit
  * - dcp_backfill_byte_limit
+ * - dcp_backfill_node_byte_limit (the budget shared with the other
+ *   connections of all buckets, see BackfillGovernor)
+ *
+ * With dcp_backfill_prioritization the backfills are queued by their
+ * priority class (see BackfillPriority) rather than in the order they
+ * were scheduled, and the backfills of the takeover and replication
+ * streams don't wait for the limit of running backfills of the bucket.
  */
 #pragma once
 
@@ -93,6 +100,13 @@ public:
 
     void bytesSent(size_t bytes);
 
+    /**
+     * Start a new scan buffer, after a run of another connection's backfill
+     * a stream of this connection has joined (our own backfills start a new
+     * one after each run)
+     */
+    void resetScanBuffer();
+
     // Called by the managerTask to acutally perform backfilling & manage
     // backfills between the different queues.
     backfill_status_t backfill();
@@ -111,10 +125,34 @@ protected:
     //! The scan buffer is for the current stream being backfilled
     BackfillScanBuffer scanBuffer;
 
+    /**
+     * Insert a backfill into a queue after all of the backfills of its
+     * priority class or higher (so the backfills of a class are run in
+     * the order they were scheduled)
+     */
+    static void enqueue(std::list<UniqueDCPBackfillPtr>& queue,
+                        UniqueDCPBackfillPtr backfill);
+
 private:
 
     void moveToActiveQueue();
 
+    /// Get the priority class of a backfill for the stream
+    BackfillPriority getPriority(ActiveStream& stream) const;
+
+    /// Get the most bytes the buffer may hold (the limit of the connection,
+    /// or its share of the node-wide budget if that is lower)
+    size_t getBufferMaxBytes() const;
+
+    /// Start (or stop) sharing the node-wide budget, as we get backfills
+    /// (or no longer have any)
+    void addToGovernor();
+    void removeFromGovernor();
+
+    //! The weight we were added to the BackfillGovernor with (0 if we don't
+    //! have any backfills)
+    size_t governorWeight = 0;
+
     std::mutex lock;
     std::list<UniqueDCPBackfillPtr> activeBackfills;
     std::list<std::pair<rel_time_t, UniqueDCPBackfillPtr> > snoozingBackfills;
@@ -30,3 +30,15 @@ bool DCPBackfill::isStreamDead() const {
     auto stream = streamPtr.lock();
     return !stream || !stream->isActive();
 }
+
+std::string to_string(BackfillPriority priority) {
+    switch (priority) {
+    case BackfillPriority::Normal:
+        return "normal";
+    case BackfillPriority::Replication:
+        return "replication";
+    case BackfillPriority::Takeover:
+        return "takeover";
+    }
+    return "unknown";
+}
@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <string>
+
 class ActiveStream;
 class ScanContext;
 
@@ -29,6 +31,22 @@ enum backfill_status_t {
     backfill_snooze
 };
 
+/**
+ * The priority class of a backfill. The backfills of a higher class run
+ * before the ones of a lower class (only used if
+ * dcp_backfill_prioritization is enabled)
+ */
+enum class BackfillPriority {
+    /// Index builds, XDCR, backups etc
+    Normal,
+    /// Streams of the replication connections (replicas catching up)
+    Replication,
+    /// Takeover streams, the vbucket move of a rebalance is waiting for them
+    Takeover
+};
+
+std::string to_string(BackfillPriority priority);
+
 class DCPBackfill {
 public:
     DCPBackfill(std::shared_ptr<ActiveStream> s,
@@ -59,13 +77,21 @@ public:
      *
      * @return true if stream is in dead state; else false
      */
-    bool isStreamDead() const;
+    virtual bool isStreamDead() const;
 
     /**
      * Cancels the backfill
      */
     virtual void cancel() = 0;
 
+    BackfillPriority getPriority() const {
+        return priority;
+    }
+
+    void setPriority(BackfillPriority value) {
+        priority = value;
+    }
+
 protected:
     /**
      * Ptr to the associated Active DCP stream. Backfill can be run for only
@@ -91,6 +117,8 @@ protected:
      * Id of the vbucket on which the backfill is running
      */
     const Vbid vbid;
+
+    BackfillPriority priority = BackfillPriority::Normal;
 };
 
 using UniqueDCPBackfillPtr = std::unique_ptr<DCPBackfill>;
@@ -35,6 +35,127 @@ static std::string backfillStateToString(backfill_state_t state) {
     return "<invalid>:" + std::to_string(state);
 }
 
+/// How the values are read from disk for the stream
+static ValueFilter getValueFilter(ActiveStream& stream) {
+    if (stream.isKeyOnly()) {
+        return ValueFilter::KEYS_ONLY;
+    }
+    if (stream.isCompressionEnabled()) {
+        return ValueFilter::VALUES_COMPRESSED;
+    }
+    return ValueFilter::VALUES_DECOMPRESSED;
+}
+
+BackfillStreams::BackfillStreams(std::shared_ptr<ActiveStream> s,
+                                 uint64_t startSeqno,
+                                 uint64_t endSeqno)
+    : valFilter(getValueFilter(*s)),
+      keyOrder(s->isKeyOrderBackfill()),
+      endSeqno(endSeqno) {
+    entries.push_back({s, startSeqno, 0});
+}
+
+bool BackfillStreams::join(std::shared_ptr<ActiveStream> s,
+                           uint64_t startSeqno,
+                           uint64_t endSeqno) {
+    std::lock_guard<std::mutex> lh(lock);
+    // received() relies on the items being read in seqno order
+    if (!open || startSeqno < entries.front().startSeqno ||
+        getValueFilter(*s) != valFilter || s->isKeyOrderBackfill() ||
+        keyOrder) {
+        return false;
+    }
+    entries.push_back({s, startSeqno, 0});
+    this->endSeqno = std::max(this->endSeqno, endSeqno);
+    return true;
+}
+
+bool BackfillStreams::closeIfPersisted(uint64_t persistedSeqno,
+                                       uint64_t& endSeqno) {
+    std::lock_guard<std::mutex> lh(lock);
+    endSeqno = this->endSeqno;
+    if (persistedSeqno < endSeqno) {
+        return false;
+    }
+    open = false;
+    return true;
+}
+
+void BackfillStreams::close() {
+    std::lock_guard<std::mutex> lh(lock);
+    open = false;
+}
+
+size_t BackfillStreams::getNumJoined() {
+    std::lock_guard<std::mutex> lh(lock);
+    return entries.size() - 1;
+}
+
+void BackfillStreams::forEachJoined(
+        const std::function<void(ActiveStream&, uint64_t)>& func) {
+    std::vector<std::pair<std::shared_ptr<ActiveStream>, uint64_t>> joined;
+    {
+        std::lock_guard<std::mutex> lh(lock);
+        for (auto it = entries.begin() + 1; it != entries.end(); ++it) {
+            auto stream = it->stream.lock();
+            if (stream) {
+                joined.emplace_back(std::move(stream), it->startSeqno);
+            }
+        }
+    }
+    // Not under our lock, as join() is called with a stream's lock held
+    for (auto& entry : joined) {
+        func(*entry.first, entry.second);
+    }
+}
+
+std::shared_ptr<ActiveStream> BackfillStreams::getStream() {
+    std::lock_guard<std::mutex> lh(lock);
+    for (auto& entry : entries) {
+        auto stream = entry.stream.lock();
+        if (stream) {
+            return stream;
+        }
+    }
+    return {};
+}
+
+bool BackfillStreams::isActive() {
+    std::lock_guard<std::mutex> lh(lock);
+    for (auto& entry : entries) {
+        auto stream = entry.stream.lock();
+        if (stream && stream->isActive()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool BackfillStreams::received(const Item& item, backfill_source_t source) {
+    const auto seqno = uint64_t(item.getBySeqno());
+    bool buffered = true;
+    bool joinedFull = false;
+    for (auto& entry : entries) {
+        if (seqno < entry.startSeqno || seqno <= entry.lastSeqno) {
+            continue;
+        }
+        auto stream = entry.stream.lock();
+        if (!stream) {
+            continue;
+        }
+        if (stream->backfillReceived(
+                    std::make_unique<Item>(item), source, /*force*/ false)) {
+            entry.lastSeqno = seqno;
+        } else if (&entry == &entries.front()) {
+            buffered = false;
+        } else {
+            joinedFull = true;
+        }
+    }
+    pausedByJoinedStream = buffered && joinedFull;
+    return buffered && !joinedFull;
+}
+
 CacheCallback::CacheCallback(EventuallyPersistentEngine& e,
                              std::shared_ptr<ActiveStream> s)
     : engine_(e), streamPtr(s) {
@@ -43,6 +164,14 @@ CacheCallback::CacheCallback(EventuallyPersistentEngine& e,
     }
 }
 
+CacheCallback::CacheCallback(EventuallyPersistentEngine& e,
+                             std::shared_ptr<BackfillStreams> s)
+    : engine_(e), streams(std::move(s)) {
+    if (streams == nullptr) {
+        throw std::invalid_argument("CacheCallback(): streams is NULL");
+    }
+}
+
 // Do a get and restrict the collections lock scope to just these checks.
 GetValue CacheCallback::get(VBucket& vb,
                             CacheLookup& lookup,
@@ -63,7 +192,7 @@ GetValue CacheCallback::get(VBucket& vb,
 }
 
 void CacheCallback::callback(CacheLookup& lookup) {
-    auto stream_ = streamPtr.lock();
+    auto stream_ = streams ? streams->getStream() : streamPtr.lock();
     if (!stream_) {
         setStatus(ENGINE_SUCCESS);
         return;
@@ -87,9 +216,13 @@ void CacheCallback::callback(CacheLookup& lookup) {
     auto gv = get(*vb, lookup, *stream_);
     if (gv.getStatus() == ENGINE_SUCCESS) {
         if (gv.item->getBySeqno() == lookup.getBySeqno()) {
-            if (stream_->backfillReceived(std::move(gv.item),
-                                          BACKFILL_FROM_MEMORY,
-                                          /*force */ false)) {
+            const bool buffered =
+                    streams ? streams->received(*gv.item,
+                                                BACKFILL_FROM_MEMORY)
+                            : stream_->backfillReceived(std::move(gv.item),
+                                                        BACKFILL_FROM_MEMORY,
+                                                        /*force */ false);
+            if (buffered) {
                 setStatus(ENGINE_KEY_EEXISTS);
                 return;
             }
@@ -106,8 +239,15 @@ DiskCallback::DiskCallback(std::shared_ptr<ActiveStream> s) : streamPtr(s) {
     }
 }
 
+DiskCallback::DiskCallback(std::shared_ptr<BackfillStreams> s)
+    : streams(std::move(s)) {
+    if (streams == nullptr) {
+        throw std::invalid_argument("DiskCallback(): streams is NULL");
+    }
+}
+
 void DiskCallback::callback(GetValue& val) {
-    auto stream_ = streamPtr.lock();
+    auto stream_ = streams ? streams->getStream() : streamPtr.lock();
     if (!stream_) {
         setStatus(ENGINE_SUCCESS);
         return;
@@ -122,9 +262,12 @@ void DiskCallback::callback(GetValue& val) {
     val.item->setNRUValue(MAX_NRU_VALUE);
     val.item->setFreqCounterValue(0);
 
-    if (!stream_->backfillReceived(std::move(val.item),
-                                   BACKFILL_FROM_DISK,
-                                   /*force*/ false)) {
+    const bool buffered =
+            streams ? streams->received(*val.item, BACKFILL_FROM_DISK)
+                    : stream_->backfillReceived(std::move(val.item),
+                                                BACKFILL_FROM_DISK,
+                                                /*force*/ false);
+    if (!buffered) {
         setStatus(ENGINE_ENOMEM); // Pause the backfill
     } else {
         setStatus(ENGINE_SUCCESS);
@@ -138,7 +281,8 @@ DCPBackfillDisk::DCPBackfillDisk(EventuallyPersistentEngine& e,
     : DCPBackfill(s, startSeqno, endSeqno),
       engine(e),
       scanCtx(nullptr),
-      state(backfill_state_init) {
+      state(backfill_state_init),
+      streams(std::make_shared<BackfillStreams>(s, startSeqno, endSeqno)) {
 }
 
 backfill_status_t DCPBackfillDisk::run() {
@@ -165,6 +309,10 @@ void DCPBackfillDisk::cancel() {
     }
 }
 
+bool DCPBackfillDisk::isStreamDead() const {
+    return !streams->isActive();
+}
+
 backfill_status_t DCPBackfillDisk::create() {
     auto stream = streamPtr.lock();
     if (!stream) {
@@ -173,6 +321,10 @@ backfill_status_t DCPBackfillDisk::create() {
                 "({}) backfill create ended prematurely as the associated "
                 "stream is deleted by the producer conn ",
                 getVBucketId());
+        streams->close();
+        streams->forEachJoined([](ActiveStream& s, uint64_t) {
+            s.setDead(END_STREAM_BACKFILL_FAIL);
+        });
         transitionState(backfill_state_done);
         return backfill_finished;
     }
@@ -181,7 +333,8 @@ backfill_status_t DCPBackfillDisk::create() {
     uint64_t lastPersistedSeqno =
             engine.getKVBucket()->getLastPersistedSeqno(vbid);
 
-    if (lastPersistedSeqno < endSeqno) {
+    // Streams joining the backfill may need it to read further
+    if (!streams->closeIfPersisted(lastPersistedSeqno, endSeqno)) {
         stream->log(spdlog::level::level_enum::info,
                     "({}) Rescheduling backfill"
                     "because backfill up to seqno {}"
@@ -194,19 +347,24 @@ backfill_status_t DCPBackfillDisk::create() {
     }
 
     KVStore* kvstore = engine.getKVBucket()->getROUnderlying(vbid);
-    ValueFilter valFilter = ValueFilter::VALUES_DECOMPRESSED;
-    if (stream->isKeyOnly()) {
-        valFilter = ValueFilter::KEYS_ONLY;
+    const ValueFilter valFilter = getValueFilter(*stream);
+
+    std::shared_ptr<DiskCallback> cb;
+    std::shared_ptr<CacheCallback> cl;
+    const auto joined = streams->getNumJoined();
+    if (joined == 0) {
+        cb = std::make_shared<DiskCallback>(stream);
+        cl = std::make_shared<CacheCallback>(engine, stream);
     } else {
-        if (stream->isCompressionEnabled()) {
-            valFilter = ValueFilter::VALUES_COMPRESSED;
-        }
+        cb = std::make_shared<DiskCallback>(streams);
+        cl = std::make_shared<CacheCallback>(engine, streams);
     }
-
-    auto cb = std::make_shared<DiskCallback>(stream);
-    auto cl = std::make_shared<CacheCallback>(engine, stream);
-    scanCtx = kvstore->initScanContext(
-            cb, cl, vbid, startSeqno, DocumentFilter::ALL_ITEMS, valFilter);
+    scanCtx = kvstore->initScanContext(cb,
+                                       cl,
+                                       vbid,
+                                       getScanStartSeqno(*stream, vbid, joined),
+                                       DocumentFilter::ALL_ITEMS,
+                                       valFilter);
 
     // Check startSeqno against the purge-seqno of the opened datafile.
     // 1) A normal stream request would of checked inside streamRequest, but
@@ -238,32 +396,91 @@ backfill_status_t DCPBackfillDisk::create() {
 
         stream->log(spdlog::level::level_enum::warn, "{}", log.str());
         stream->setDead(status);
+        streams->forEachJoined(
+                [status](ActiveStream& s, uint64_t) { s.setDead(status); });
         transitionState(backfill_state_done);
     } else {
+        if (joined == 0 && stream->isKeyOrderBackfill() &&
+            engine.getKVBucket()->getStorageProperties().hasKeyOrderScan()) {
+            scanCtx->order = ScanOrder::ByKey;
+        }
         stream->incrBackfillRemaining(scanCtx->documentCount);
         stream->markDiskSnapshot(startSeqno, scanCtx->maxSeqno);
+        if (joined != 0) {
+            stream->log(spdlog::level::level_enum::info,
+                        "({}) Backfill from seqno {} shared with {} other "
+                        "streams",
+                        vbid,
+                        startSeqno,
+                        joined);
+            const auto count = scanCtx->documentCount;
+            const auto maxSeqno = uint64_t(scanCtx->maxSeqno);
+            streams->forEachJoined(
+                    [count, maxSeqno](ActiveStream& s, uint64_t start) {
+                        s.incrBackfillRemaining(count);
+                        s.markDiskSnapshot(start, maxSeqno);
+                    });
+        }
         transitionState(backfill_state_scanning);
     }
 
     return backfill_success;
 }
 
-backfill_status_t DCPBackfillDisk::scan() {
-    auto stream = streamPtr.lock();
-    if (!stream) {
-        return complete(true);
+uint64_t DCPBackfillDisk::getScanStartSeqno(const ActiveStream& stream,
+                                            Vbid vbid,
+                                            size_t joined) const {
+    const auto cid = stream.getSingleCollection();
+    if (!cid || joined != 0) {
+        return startSeqno;
+    }
+    auto vb = engine.getVBucket(vbid);
+    if (!vb) {
+        return startSeqno;
     }
 
-    Vbid vbid = stream->getVBucket();
+    int64_t collectionStart;
+    {
+        auto rh = vb->lockCollections();
+        if (!rh.exists(*cid)) {
+            // Dropped, the scan must still find the drop event
+            return startSeqno;
+        }
+        collectionStart = rh.getStartSeqno(*cid);
+    }
+    if (uint64_t(collectionStart) <= startSeqno) {
+        return startSeqno;
+    }
+    stream.log(spdlog::level::level_enum::info,
+               "({}) Backfill of collection:{:x} starting the scan from its "
+               "start seqno {} instead of {}",
+               vbid,
+               *cid,
+               collectionStart,
+               startSeqno);
+    return uint64_t(collectionStart);
+}
 
-    if (!(stream->isActive())) {
+backfill_status_t DCPBackfillDisk::scan() {
+    // Keep scanning while any of the streams sharing the backfill needs it
+    if (!streams->isActive()) {
         return complete(true);
     }
 
     KVStore* kvstore = engine.getKVBucket()->getROUnderlying(vbid);
     scan_error_t error = kvstore->scan(scanCtx);
 
+    // As our BackfillManager does for us after each run
+    streams->forEachJoined(
+            [](ActiveStream& s, uint64_t) { s.resetBackfillScanBuffer(); });
+
     if (error == scan_again) {
+        // Our connection's buffer isn't full (so the BackfillManager would
+        // run us again right away), but a joined stream's is; wait a while
+        // for it to send some of its items
+        if (streams->isPausedByJoinedStream()) {
+            return backfill_snooze;
+        }
         return backfill_success;
     }
 
@@ -278,6 +495,18 @@ backfill_status_t DCPBackfillDisk::complete(bool cancelled) {
     KVStore* kvstore = engine.getKVBucket()->getROUnderlying(getVBucketId());
     kvstore->destroyScanContext(scanCtx);
 
+    // A cancelled backfill didn't send the joined streams everything they
+    // need (and the stream which scheduled it is gone), so end them (the
+    // clients will reconnect)
+    streams->close();
+    streams->forEachJoined([cancelled](ActiveStream& s, uint64_t) {
+        if (cancelled && s.isActive()) {
+            s.setDead(END_STREAM_BACKFILL_FAIL);
+        } else {
+            s.completeBackfill();
+        }
+    });
+
     auto stream = streamPtr.lock();
     if (!stream) {
         EP_LOG_WARN(
@@ -19,10 +19,16 @@
 
 #include "callbacks.h"
 #include "dcp/backfill.h"
+#include "dcp/stream.h"
+#include "kvstore.h"
 
+#include <functional>
+#include <memory>
 #include <mutex>
+#include <vector>
 
 class EventuallyPersistentEngine;
+class Item;
 class ScanContext;
 class VBucket;
 
@@ -34,12 +40,113 @@ enum backfill_state_t {
     backfill_state_done
 };
 
+/**
+ * The streams a disk backfill sends the items it reads to. Normally that's
+ * just the stream which scheduled the backfill, but other streams of the
+ * vbucket which want the same items may join it until it starts scanning
+ * (see EPVBucket::createDCPBackfill), so that one scan serves all of them.
+ *
+ * Each stream applies its own filters to the items it's sent (in
+ * ActiveStream::backfillReceived). The scan is paused when any stream can't
+ * buffer an item, and the item is read again when the scan resumes; the last
+ * seqno each stream was sent is tracked so that no stream gets it twice.
+ *
+ * Once the scan has started the streams are only accessed by the backfill
+ * (under its lock).
+ */
+class BackfillStreams {
+public:
+    BackfillStreams(std::shared_ptr<ActiveStream> s,
+                    uint64_t startSeqno,
+                    uint64_t endSeqno);
+
+    /**
+     * Join the stream to the backfill, if the backfill hasn't started
+     * scanning yet, reads the values the same way and starts at or before
+     * the stream's start seqno (and neither backfills in key order).
+     *
+     * @return true if the stream joined the backfill
+     */
+    bool join(std::shared_ptr<ActiveStream> s,
+              uint64_t startSeqno,
+              uint64_t endSeqno);
+
+    /**
+     * Stop any more streams joining if the vbucket is persisted up to the
+     * highest end seqno of the streams.
+     *
+     * @param persistedSeqno the last persisted seqno of the vbucket
+     * @param [out] endSeqno the highest end seqno of the streams
+     * @return true if no more streams can join
+     */
+    bool closeIfPersisted(uint64_t persistedSeqno, uint64_t& endSeqno);
+
+    /// Stop any more streams joining
+    void close();
+
+    /// @return the number of streams which joined the backfill
+    size_t getNumJoined();
+
+    /**
+     * Call the function for each of the streams (which still exist) which
+     * joined the backfill, with the stream's start seqno.
+     */
+    void forEachJoined(
+            const std::function<void(ActiveStream&, uint64_t)>& func);
+
+    /// @return the first of the streams which still exists, if any
+    std::shared_ptr<ActiveStream> getStream();
+
+    /// @return true if any of the streams is active
+    bool isActive();
+
+    /**
+     * Send a copy of the item to each stream which wants it and hasn't been
+     * sent it yet.
+     *
+     * @return false if any stream couldn't buffer the item (the scan must be
+     *         paused)
+     */
+    bool received(const Item& item, backfill_source_t source);
+
+    /**
+     * @return true if the last item couldn't be buffered by a stream which
+     *         joined the backfill, but was by the stream which scheduled it
+     */
+    bool isPausedByJoinedStream() const {
+        return pausedByJoinedStream;
+    }
+
+private:
+    struct Entry {
+        std::weak_ptr<ActiveStream> stream;
+        uint64_t startSeqno;
+        /// The last seqno the stream was sent (0 = none yet)
+        uint64_t lastSeqno;
+    };
+
+    std::mutex lock;
+    /// The stream which scheduled the backfill first, then those which
+    /// joined it
+    std::vector<Entry> entries;
+    const ValueFilter valFilter;
+    /// Does the stream which scheduled the backfill backfill in key order?
+    const bool keyOrder;
+    uint64_t endSeqno;
+    bool open = true;
+    bool pausedByJoinedStream = false;
+};
+
 /* Callback to get the items that are found to be in the cache */
 class CacheCallback : public StatusCallback<CacheLookup> {
 public:
     CacheCallback(EventuallyPersistentEngine& e,
                   std::shared_ptr<ActiveStream> s);
 
+    /// Send the items to all of the streams of a shared backfill
+    CacheCallback(EventuallyPersistentEngine& e,
+                  std::shared_ptr<BackfillStreams> s);
+
     void callback(CacheLookup& lookup);
 
 private:
@@ -52,6 +159,7 @@ private:
 
     EventuallyPersistentEngine& engine_;
     std::weak_ptr<ActiveStream> streamPtr;
+    std::shared_ptr<BackfillStreams> streams;
 };
 
 /* Callback to get the items that are found to be in the disk */
@@ -59,10 +167,14 @@ class DiskCallback : public StatusCallback<GetValue> {
 public:
     DiskCallback(std::shared_ptr<ActiveStream> s);
 
+    /// Send the items to all of the streams of a shared backfill
+    DiskCallback(std::shared_ptr<BackfillStreams> s);
+
     void callback(GetValue& val);
 
 private:
     std::weak_ptr<ActiveStream> streamPtr;
+    std::shared_ptr<BackfillStreams> streams;
 };
 
 /**
@@ -83,6 +195,14 @@ public:
 
     void cancel() override;
 
+    /// The backfill's stream is dead once all of the streams sharing it are
+    bool isStreamDead() const override;
+
+    /// The streams the backfill sends the items to, which others may join
+    std::shared_ptr<BackfillStreams> getStreams() const {
+        return streams;
+    }
+
 private:
     /**
      * Creates a scan context with the KV Store to read items in the sequential
@@ -90,6 +210,17 @@ private:
      */
     backfill_status_t create();
 
+    /**
+     * @return the seqno to start the scan from. This is the backfill's
+     *         startSeqno, unless the stream (not sharing the backfill) is of
+     *         one collection created after it: no item of the collection can
+     *         have a lower seqno than the collection's creation, so the scan
+     *         skips those seqnos.
+     */
+    uint64_t getScanStartSeqno(const ActiveStream& stream,
+                               Vbid vbid,
+                               size_t joined) const;
+
     /**
      * Scan the disk (by calling KVStore apis) for the items in the backfill
      * snapshot range created in the create scan context. This is an
@@ -123,4 +254,5 @@ private:
     ScanContext* scanCtx;
     backfill_state_t state;
     std::mutex lock;
+    const std::shared_ptr<BackfillStreams> streams;
 };
@@ -0,0 +1,46 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "dcp/backfill_governor.h"
+
+#include <limits>
+
+BackfillGovernor& BackfillGovernor::get() {
+    static BackfillGovernor governor;
+    return governor;
+}
+
+void BackfillGovernor::addWeight(size_t weight) {
+    totalWeight.fetch_add(weight);
+}
+
+void BackfillGovernor::removeWeight(size_t weight) {
+    totalWeight.fetch_sub(weight);
+}
+
+size_t BackfillGovernor::getShare(size_t weight) const {
+    const size_t budget = limit;
+    const size_t total = totalWeight;
+    if (budget == 0) {
+        return std::numeric_limits<size_t>::max();
+    }
+    if (total <= weight) {
+        return budget;
+    }
+    // Scale in floating point, budget * weight may overflow
+    return size_t(double(budget) * weight / total);
+}
@@ -0,0 +1,89 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <relaxed_atomic.h>
+
+#include <cstddef>
+
+/**
+ * The BackfillGovernor shares a byte budget for the items backfilled into
+ * memory between the BackfillManagers (DCP producers) of all of the buckets
+ * in the process, so that the buckets backfilling together (e.g. during a
+ * rebalance) can't use more memory than the budget between them.
+ *
+ * Each BackfillManager with backfills registers with a weight, and may
+ * have up to its weighted share of the budget (the budget * its weight /
+ * the total weight of the registered managers) in its buffer, in addition
+ * to its own dcp_backfill_byte_limit. As with the connection buffer, a
+ * manager with an empty buffer may always read an item so that every
+ * backfill makes progress.
+ *
+ * The budget is set with dcp_backfill_node_byte_limit of any bucket
+ * (0 = disabled, the managers are only limited by their own buffers).
+ */
+class BackfillGovernor {
+public:
+    static BackfillGovernor& get();
+
+    void setLimit(size_t bytes) {
+        limit = bytes;
+    }
+
+    size_t getLimit() const {
+        return limit;
+    }
+
+    /// Add a BackfillManager with backfills to the ones sharing the budget
+    void addWeight(size_t weight);
+
+    /// Remove a BackfillManager added with addWeight()
+    void removeWeight(size_t weight);
+
+    /**
+     * Get the share of the budget of a BackfillManager
+     *
+     * @param weight the weight the manager was added with
+     * @return the bytes the manager may have in its buffer (SIZE_MAX if
+     *         the budget is disabled)
+     */
+    size_t getShare(size_t weight) const;
+
+    /// Account for the bytes read into (or sent from) the buffers
+    void bytesRead(size_t bytes) {
+        used.fetch_add(bytes);
+    }
+
+    void bytesReleased(size_t bytes) {
+        used.fetch_sub(bytes);
+    }
+
+    /// Get the bytes in the buffers of all of the BackfillManagers
+    size_t getBytesRead() const {
+        return used;
+    }
+
+    size_t getTotalWeight() const {
+        return totalWeight;
+    }
+
+protected:
+    cb::RelaxedAtomic<size_t> limit{0};
+    cb::RelaxedAtomic<size_t> totalWeight{0};
+    cb::RelaxedAtomic<size_t> used{0};
+};
@@ -225,7 +225,8 @@ backfill_status_t DCPBackfillMemoryBuffered::create() {
     }
 
     /* Advance the cursor till start, mark snapshot and update backfill
-       remaining count */
+       remaining count. Seek first to skip most of the items before start */
+    rangeItr.seek(startSeqno);
     while (rangeItr.curr() != rangeItr.end()) {
         if (static_cast<uint64_t>((*rangeItr).getBySeqno()) >= startSeqno) {
             /* Incr backfill remaining
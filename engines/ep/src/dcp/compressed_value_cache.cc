@@ -0,0 +1,93 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "compressed_value_cache.h"
+
+#include <platform/compress.h>
+
+CompressedValueCache::CompressedValueCache(size_t maxSize) : maxSize(maxSize) {
+}
+
+bool CompressedValueCache::compress(const value_t& value,
+                                    value_t& compressed) {
+    const Blob* key = value.get().get();
+    const bool enabled = maxSize > 0;
+    if (enabled) {
+        std::lock_guard<std::mutex> lh(mutex);
+        auto it = index.find(key);
+        if (it != index.end()) {
+            compressed = it->second->compressed;
+            ++hits;
+            return true;
+        }
+    }
+
+    // Compress without the lock; if several producers miss the same value
+    // at once, the first to finish caches it
+    cb::compression::Buffer deflated;
+    if (!cb::compression::deflate(cb::compression::Algorithm::Snappy,
+                                  {value->getData(), value->valueSize()},
+                                  deflated)) {
+        return false;
+    }
+    if (deflated.size() > value->valueSize()) {
+        // No point sending a compressed value larger than the original
+        compressed = value;
+    } else {
+        compressed = value_t(Blob::New(deflated.data(), deflated.size()));
+    }
+
+    if (enabled) {
+        ++misses;
+        std::lock_guard<std::mutex> lh(mutex);
+        if (index.count(key) == 0) {
+            entries.push_back({value, compressed});
+            index.emplace(key, std::prev(entries.end()));
+            size += getEntrySize(entries.back());
+            evict_UNLOCKED();
+        }
+    }
+    return true;
+}
+
+void CompressedValueCache::setMaxSize(size_t size) {
+    std::lock_guard<std::mutex> lh(mutex);
+    maxSize = size;
+    evict_UNLOCKED();
+}
+
+size_t CompressedValueCache::getSize() const {
+    std::lock_guard<std::mutex> lh(mutex);
+    return size;
+}
+
+size_t CompressedValueCache::getEntrySize(const Entry& entry) {
+    size_t entrySize = sizeof(Entry) + entry.value->getSize();
+    if (entry.compressed.get() != entry.value.get().get()) {
+        entrySize += entry.compressed->getSize();
+    }
+    return entrySize;
+}
+
+void CompressedValueCache::evict_UNLOCKED() {
+    while (size > maxSize && !entries.empty()) {
+        auto& oldest = entries.front();
+        size -= getEntrySize(oldest);
+        index.erase(oldest.value.get().get());
+        entries.pop_front();
+    }
+}
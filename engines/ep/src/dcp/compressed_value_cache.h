@@ -0,0 +1,92 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include "blob.h"
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+/**
+ * A cache of the Snappy compressed form of the values the DCP producers
+ * compress (force_value_compression), shared by all of a bucket's producers.
+ *
+ * Without it every producer streaming a checkpoint item compresses its value
+ * itself - each replica compresses every uncompressed mutation again.
+ *
+ * Entries are keyed by the value's Blob, which the entry holds a reference to
+ * so its address can't be reused by another value while it is cached. The
+ * cache is bounded by the memory of the entries (the value and its
+ * compressed form); the oldest entries are evicted first.
+ */
+class CompressedValueCache {
+public:
+    /// @param maxSize the memory the entries may use (0 disables the cache)
+    explicit CompressedValueCache(size_t maxSize);
+
+    /**
+     * Get the compressed form of a value, compressing it (and caching the
+     * result) if it isn't cached.
+     *
+     * @param value the uncompressed value
+     * @param[out] compressed the compressed value; `value` itself if
+     *             compression wouldn't make it smaller
+     * @return false if the value couldn't be compressed
+     */
+    bool compress(const value_t& value, value_t& compressed);
+
+    void setMaxSize(size_t size);
+
+    size_t getMaxSize() const {
+        return maxSize;
+    }
+
+    /// @return the memory used by the entries
+    size_t getSize() const;
+
+    size_t getHits() const {
+        return hits;
+    }
+
+    size_t getMisses() const {
+        return misses;
+    }
+
+private:
+    struct Entry {
+        value_t value;
+        value_t compressed;
+    };
+
+    static size_t getEntrySize(const Entry& entry);
+
+    /// Evict the oldest entries until the size is within the maxSize
+    void evict_UNLOCKED();
+
+    mutable std::mutex mutex;
+    // The entries, oldest first
+    std::list<Entry> entries;
+    std::unordered_map<const Blob*, std::list<Entry>::iterator> index;
+    size_t size = 0;
+
+    std::atomic<size_t> maxSize;
+    std::atomic<size_t> hits{0};
+    std::atomic<size_t> misses{0};
+};
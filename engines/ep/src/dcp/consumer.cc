@@ -32,6 +32,8 @@
 #include <memcached/server_cookie_iface.h>
 #include <phosphor/phosphor.h>
 
+#include <algorithm>
+
 const std::string DcpConsumer::noopCtrlMsg = "enable_noop";
 const std::string DcpConsumer::noopIntervalCtrlMsg = "set_noop_interval";
 const std::string DcpConsumer::connBufferCtrlMsg = "connection_buffer_size";
@@ -87,7 +89,9 @@ public:
                 sleepFor = INT_MAX;
                 break;
             case more_to_process:
-                sleepFor = 0.0;
+                // Paced by the replication throttle as it approaches
+                // pausing (up to a second between batches)
+                sleepFor = 1.0 - consumer->getProcessRatio();
                 break;
             case cannot_process:
                 sleepFor = 5.0;
@@ -152,9 +156,14 @@ DcpConsumer::DcpConsumer(EventuallyPersistentEngine& engine,
       lastMessageTime(ep_current_time()),
       engine(engine),
       opaqueCounter(0),
-      processorTaskId(0),
+      processorTaskIds(
+              engine.getConfiguration().getDcpConsumerProcessorTasks()),
+      nextProcessorTask(0),
       processorTaskState(all_processed),
+      vbReady(engine.getConfiguration().getMaxVbuckets()),
       processorNotification(false),
+      vbProcessing(engine.getConfiguration().getMaxVbuckets()),
+      vbProcessPending(engine.getConfiguration().getMaxVbuckets()),
       backoffs(0),
       dcpNoopTxInterval(engine.getConfiguration().getDcpNoopTxInterval()),
       pendingSendStreamEndOnClientStreamClose(true),
@@ -195,7 +204,9 @@ DcpConsumer::~DcpConsumer() {
 void DcpConsumer::cancelTask() {
     bool exp = true;
     if (processorTaskRunning.compare_exchange_strong(exp, false)) {
-        ExecutorPool::get()->cancel(processorTaskId);
+        for (const auto& taskId : processorTaskIds) {
+            ExecutorPool::get()->cancel(taskId);
+        }
     }
 }
 
@@ -286,13 +297,15 @@ ENGINE_ERROR_CODE DcpConsumer::addStream(uint32_t opaque,
         }
     }
 
-    /* We need 'Processor' task only when we have a stream. Hence create it
+    /* We need 'Processor' tasks only when we have a stream. Hence create them
      only once when the first stream is added */
     bool exp = false;
     if (processorTaskRunning.compare_exchange_strong(exp, true)) {
-        ExTask task = std::make_shared<DcpConsumerTask>(
-                &engine, shared_from_this(), 1);
-        processorTaskId = ExecutorPool::get()->schedule(task);
+        for (auto& taskId : processorTaskIds) {
+            ExTask task = std::make_shared<DcpConsumerTask>(
+                    &engine, shared_from_this(), 1);
+            taskId = ExecutorPool::get()->schedule(task);
+        }
     }
 
     stream = makePassiveStream(engine_,
@@ -1139,6 +1152,7 @@ void DcpConsumer::addStats(const AddStatFn& add_stat, const void* c) {
 
     addStat("total_backoffs", backoffs, add_stat, c);
     addStat("processor_task_state", getProcessorTaskStatusStr(), add_stat, c);
+    addStat("processor_ratio", processRatio.load(), add_stat, c);
     flowControl.addStats(add_stat, c);
 
     vbReady.addStats(getName() + ":dcp_buffered_ready_queue_", add_stat, c);
@@ -1175,10 +1189,18 @@ process_items_error_t DcpConsumer::drainStreamsBufferedItems(
                     stream->getVBucket());
             return stop_processing;
 
-        case ReplicationThrottle::Status::Process:
+        case ReplicationThrottle::Status::Process: {
+            // Process smaller batches (and sleep in between, see
+            // DcpConsumerTask) as the throttle approaches pausing
+            const auto ratio =
+                    engine_.getReplicationThrottle().getProcessRatio();
+            processRatio = ratio;
+            const auto batchSize = std::max(
+                    size_t(1),
+                    static_cast<size_t>(processBufferedMessagesBatchSize *
+                                        ratio));
             bytesProcessed = 0;
-            rval = stream->processBufferedMessages(
-                    bytesProcessed, processBufferedMessagesBatchSize);
+            rval = stream->processBufferedMessages(bytesProcessed, batchSize);
             if ((rval == cannot_process) || (rval == stop_processing)) {
                 backoffs++;
             }
@@ -1188,8 +1210,13 @@ process_items_error_t DcpConsumer::drainStreamsBufferedItems(
             immediatelyNotifyIfNecessary();
 
             iterations++;
+            if (ratio < 1.0) {
+                // Yield, to be paced by the task
+                iterations = yieldThreshold + 1;
+            }
             break;
         }
+        }
     } while (bytesProcessed > 0 &&
              rval == all_processed &&
              iterations <= yieldThreshold);
@@ -1212,12 +1239,18 @@ process_items_error_t DcpConsumer::processBufferedItems() {
     while (vbReady.popFront(vbucket)) {
         auto stream = findStream(vbucket);
 
-        if (!stream) {
+        if (!stream || !claimVbucket(vbucket)) {
             continue;
         }
 
+        // Let another task process the next vbucket meanwhile
+        if (processorTaskIds.size() > 1 && !vbReady.empty()) {
+            wakeProcessorTask();
+        }
+
         process_ret = drainStreamsBufferedItems(stream,
                                                 processBufferedMessagesYieldThreshold);
+        releaseVbucket(vbucket);
 
         switch (process_ret) {
         case all_processed:
@@ -1244,7 +1277,34 @@ process_items_error_t DcpConsumer::processBufferedItems() {
 void DcpConsumer::notifyVbucketReady(Vbid vbucket) {
     if (vbReady.pushUnique(vbucket) &&
         notifiedProcessor(true)) {
-        ExecutorPool::get()->wake(processorTaskId);
+        wakeProcessorTask();
+    }
+}
+
+void DcpConsumer::wakeProcessorTask() {
+    const auto next = nextProcessorTask++ % processorTaskIds.size();
+    ExecutorPool::get()->wake(processorTaskIds[next]);
+}
+
+bool DcpConsumer::claimVbucket(Vbid vbucket) {
+    auto& processing = vbProcessing[vbucket.get()];
+    auto& pending = vbProcessPending[vbucket.get()];
+    while (processing.exchange(true)) {
+        pending.store(true);
+        // Still claimed, so the owner will see pending when it releases it.
+        // Otherwise, unless the owner already took pending (and re-queued
+        // the vbucket), try again.
+        if (processing.load() || !pending.exchange(false)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void DcpConsumer::releaseVbucket(Vbid vbucket) {
+    vbProcessing[vbucket.get()].store(false);
+    if (vbProcessPending[vbucket.get()].exchange(false)) {
+        notifyVbucketReady(vbucket);
     }
 }
 
@@ -29,6 +29,7 @@
 
 #include <relaxed_atomic.h>
 
+#include <atomic>
 #include <list>
 #include <map>
 #include <engines/ep/src/collections/collections_types.h>
@@ -293,6 +294,11 @@ public:
         processBufferedMessagesBatchSize = newValue;
     }
 
+    /// @return the replication throttle's ratio when last processing
+    double getProcessRatio() const {
+        return processRatio;
+    }
+
     /**
      * Notifies the front-end synchronously on this thread that this paused
      * connection should be re-considered for work.
@@ -371,6 +377,20 @@ protected:
 
     void notifyVbucketReady(Vbid vbucket);
 
+    /* Wake the next 'Processor' task, round robin */
+    void wakeProcessorTask();
+
+    /**
+     * Claim the vbucket for processing its buffered messages, so that they
+     * are only processed by one 'Processor' task at a time (keeping them in
+     * order). If another task has it, it is left for that task to re-queue
+     * once it releases it and false is returned.
+     */
+    bool claimVbucket(Vbid vbucket);
+
+    /* Release a vbucket claimed by claimVbucket */
+    void releaseVbucket(Vbid vbucket);
+
     /**
      * Drain the stream of bufferedItems
      * The function will stop draining
@@ -503,12 +523,20 @@ protected:
     /* Reference to the ep engine; need to create the 'Processor' task */
     EventuallyPersistentEngine& engine;
     uint64_t opaqueCounter;
-    size_t processorTaskId;
+    /* Ids of the 'Processor' tasks (dcp_consumer_processor_tasks of them)
+       which process the buffered messages of different vbuckets concurrently */
+    std::vector<std::atomic<size_t>> processorTaskIds;
+    std::atomic<size_t> nextProcessorTask;
     std::atomic<enum process_items_error_t> processorTaskState;
 
     DcpReadyQueue vbReady;
     std::atomic<bool> processorNotification;
 
+    /* Per vbucket: whether a 'Processor' task has claimed it, and whether
+       another task found it ready meanwhile */
+    std::vector<std::atomic<bool>> vbProcessing;
+    std::vector<std::atomic<bool>> vbProcessPending;
+
     std::mutex readyMutex;
     std::list<Vbid> ready;
 
@@ -578,7 +606,7 @@ protected:
     } getErrorMapState;
     bool producerIsVersion5orHigher;
 
-    /* Indicates if the 'Processor' task is running */
+    /* Indicates if the 'Processor' tasks are running */
     std::atomic<bool> processorTaskRunning;
 
     FlowControl flowControl;
@@ -597,6 +625,13 @@ protected:
      */
     size_t processBufferedMessagesBatchSize;
 
+    /**
+     * The ReplicationThrottle::getProcessRatio() the buffered items were
+     * last processed under, which sizes the batches of buffered items and
+     * paces the Processor task.
+     */
+    std::atomic<double> processRatio{1.0};
+
     static const std::string noopCtrlMsg;
     static const std::string noopIntervalCtrlMsg;
     static const std::string connBufferCtrlMsg;
@@ -157,3 +157,9 @@ enum class MultipleStreamRequests : bool {
 
 /// Does the stream support synchronous replication?
 enum class SyncReplication : bool { Yes, No };
+
+/**
+ * Does the stream backfill (a disk snapshot) in key order rather than in
+ * seqno order?
+ */
+enum class KeyOrderBackfill : bool { Yes, No };
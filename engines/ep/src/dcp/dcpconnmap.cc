@@ -45,6 +45,9 @@ private:
 
 DcpConnMap::DcpConnMap(EventuallyPersistentEngine &e)
     : ConnMap(e),
+      vbProducers(e.getConfiguration().getMaxVbuckets()),
+      compressedValueCache(
+              e.getConfiguration().getDcpCompressedValueCacheSize()),
       aggrDcpConsumerBufferSize(0) {
     backfills.numActiveSnoozing = 0;
     updateMaxActiveSnoozingBackfills(engine.getEpStats().getMaxDataSize());
@@ -58,6 +61,9 @@ DcpConnMap::DcpConnMap(EventuallyPersistentEngine &e)
     engine.getConfiguration().addValueChangedListener(
             "dcp_consumer_process_buffered_messages_batch_size",
             std::make_unique<DcpConfigChangeListener>(*this));
+    engine.getConfiguration().addValueChangedListener(
+            "dcp_compressed_value_cache_size",
+            std::make_unique<DcpConfigChangeListener>(*this));
 }
 
 DcpConnMap::~DcpConnMap() {
@@ -404,22 +410,39 @@ void DcpConnMap::removeVBConnections(DcpProducer& prod) {
             if (!connection ||
                 (connection && prod.getCookie() == connection->getCookie())) {
                 vb_conns.erase(itr);
+                vbConnsChanged_UNLOCKED(vbid);
                 break;
             }
         }
     }
 }
 
+void DcpConnMap::vbConnsChanged_UNLOCKED(Vbid vbid) {
+    auto producers = std::make_shared<VBProducers>();
+    for (const auto& weakPtr : vbConns[vbid.get()]) {
+        auto producer = std::dynamic_pointer_cast<DcpProducer>(weakPtr.lock());
+        if (producer) {
+            producers->push_back(producer);
+        }
+    }
+
+    std::shared_ptr<const VBProducers> snapshot;
+    if (!producers->empty()) {
+        snapshot = std::move(producers);
+    }
+    std::atomic_store(&vbProducers[vbid.get()], std::move(snapshot));
+}
+
 void DcpConnMap::notifyVBConnections(Vbid vbid, uint64_t bySeqno) {
-    size_t lock_num = vbid.get() % vbConnLockNum;
-    std::lock_guard<std::mutex> lh(vbConnLocks[lock_num]);
+    // Called for every mutation; read the snapshot of the vbucket's producers
+    // rather than walking vbConns under the vbConnLocks
+    const auto producers = std::atomic_load(&vbProducers[vbid.get()]);
+    if (!producers) {
+        return;
+    }
 
-    for (auto& weakPtr : vbConns[vbid.get()]) {
-        auto connection = weakPtr.lock();
-        if (!connection) {
-            continue;
-        }
-        auto* producer = dynamic_cast<DcpProducer*>(connection.get());
+    for (const auto& weakPtr : *producers) {
+        auto producer = weakPtr.lock();
         if (producer) {
             producer->notifySeqnoAvailable(vbid, bySeqno);
         }
@@ -473,6 +496,11 @@ bool DcpConnMap::canAddBackfillToActiveQ()
     return false;
 }
 
+void DcpConnMap::addBackfillToActiveQ() {
+    std::lock_guard<std::mutex> lh(backfills.mutex);
+    ++backfills.numActiveSnoozing;
+}
+
 void DcpConnMap::decrNumActiveSnoozingBackfills()
 {
     {
@@ -507,6 +535,18 @@ void DcpConnMap::addStats(const AddStatFn& add_stat, const void* c) {
     LockHolder lh(connsLock);
     add_casted_stat("ep_dcp_dead_conn_count", deadConnections.size(), add_stat,
                     c);
+    add_casted_stat("ep_dcp_compressed_value_cache_mem_used",
+                    compressedValueCache.getSize(),
+                    add_stat,
+                    c);
+    add_casted_stat("ep_dcp_compressed_value_cache_hits",
+                    compressedValueCache.getHits(),
+                    add_stat,
+                    c);
+    add_casted_stat("ep_dcp_compressed_value_cache_misses",
+                    compressedValueCache.getMisses(),
+                    add_stat,
+                    c);
 }
 
 void DcpConnMap::updateMinCompressionRatioForProducers(float value) {
@@ -526,6 +566,8 @@ void DcpConnMap::DcpConfigChangeListener::sizeValueChanged(const std::string &ke
         myConnMap.consumerYieldConfigChanged(value);
     } else if (key == "dcp_consumer_process_buffered_messages_batch_size") {
         myConnMap.consumerBatchSizeConfigChanged(value);
+    } else if (key == "dcp_compressed_value_cache_size") {
+        myConnMap.compressedValueCache.setMaxSize(value);
     }
 }
 
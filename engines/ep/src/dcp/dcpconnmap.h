@@ -18,6 +18,7 @@
 #pragma once
 
 #include "connmap.h"
+#include "dcp/compressed_value_cache.h"
 
 #include <memcached/engine.h>
 #include <platform/sized_buffer.h>
@@ -117,6 +118,10 @@ public:
 
     bool canAddBackfillToActiveQ();
 
+    /// Count a backfill as active even if we're at the limit (for the
+    /// backfills which must not wait for the others to complete)
+    void addBackfillToActiveQ();
+
     void decrNumActiveSnoozingBackfills();
 
     void updateMaxActiveSnoozingBackfills(size_t maxDataSize);
@@ -147,6 +152,10 @@ public:
 
     float getMinCompressionRatio();
 
+    CompressedValueCache& getCompressedValueCache() {
+        return compressedValueCache;
+    }
+
     std::shared_ptr<ConnHandler> findByName(const std::string& name);
 
     bool isConnections() {
@@ -197,6 +206,9 @@ protected:
 
     bool isPassiveStreamConnected_UNLOCKED(Vbid vbucket);
 
+    /// Rebuild the vbProducers snapshot of the vbucket
+    void vbConnsChanged_UNLOCKED(Vbid vbid) override;
+
     /*
      * Closes all streams associated with each connection in `map`.
      */
@@ -224,6 +236,18 @@ protected:
 
     std::atomic<float> minCompressionRatioForProducer;
 
+    /*
+     * The producers in each vbucket's vbConns, as an immutable snapshot
+     * (null if none) replaced whenever vbConns changes. Accessed with
+     * std::atomic_load / std::atomic_store, so notifyVBConnections doesn't
+     * take the vbConnLocks.
+     */
+    using VBProducers = std::vector<std::weak_ptr<DcpProducer>>;
+    std::vector<std::shared_ptr<const VBProducers>> vbProducers;
+
+    /* The values compressed by the producers, shared between them */
+    CompressedValueCache compressedValueCache;
+
     /* Total memory used by all DCP consumer buffers */
     std::atomic<size_t> aggrDcpConsumerBufferSize;
 
@@ -39,6 +39,14 @@ bool DcpFlowControlManager::isEnabled() const
     return false;
 }
 
+bool DcpFlowControlManager::isAutoTuned() const {
+    return false;
+}
+
+size_t DcpFlowControlManager::tuneBufSize(DcpConsumer* consumerConn, size_t) {
+    return consumerConn->getFlowControlBufSize();
+}
+
 void DcpFlowControlManager::setBufSizeWithinBounds(DcpConsumer *consumerConn,
                                                    size_t &bufSize)
 {
@@ -223,3 +231,89 @@ void DcpFlowControlManagerAggressive::resizeBuffers_UNLOCKED(size_t bufferSize)
         iter.second->setFlowControlBufSize(bufferSize);
     }
 }
+
+DcpFlowControlManagerAuto::DcpFlowControlManagerAuto(
+        EventuallyPersistentEngine& engine)
+    : DcpFlowControlManager(engine) {
+}
+
+DcpFlowControlManagerAuto::~DcpFlowControlManagerAuto() {}
+
+size_t DcpFlowControlManagerAuto::newConsumerConn(DcpConsumer* consumerConn) {
+    if (consumerConn == nullptr) {
+        throw std::invalid_argument(
+                "DcpFlowControlManagerAuto::newConsumerConn: resp is NULL");
+    }
+    /* Start at the minimum, the connection grows it if its link needs more */
+    size_t bufferSize = engine_.getConfiguration().getDcpConnBufferSize();
+
+    std::lock_guard<std::mutex> lh(bufferSizesMutex);
+    bufferSizes[consumerConn->getCookie()] = bufferSize;
+    aggrDcpConsumerBufferSize += bufferSize;
+    EP_LOG_DEBUG("{} Conn flow control buffer is {}",
+                 consumerConn->logHeader(),
+                 bufferSize);
+    return bufferSize;
+}
+
+void DcpFlowControlManagerAuto::handleDisconnect(DcpConsumer* consumerConn) {
+    std::lock_guard<std::mutex> lh(bufferSizesMutex);
+    auto iter = bufferSizes.find(consumerConn->getCookie());
+    if (iter != bufferSizes.end()) {
+        aggrDcpConsumerBufferSize -= iter->second;
+        bufferSizes.erase(iter);
+    }
+}
+
+bool DcpFlowControlManagerAuto::isEnabled() const {
+    return true;
+}
+
+bool DcpFlowControlManagerAuto::isAutoTuned() const {
+    return true;
+}
+
+size_t DcpFlowControlManagerAuto::tuneBufSize(DcpConsumer* consumerConn,
+                                              size_t targetSize) {
+    /* Make sure that the flow control buffer size is within a max and min
+     range */
+    setBufSizeWithinBounds(consumerConn, targetSize);
+
+    std::lock_guard<std::mutex> lh(bufferSizesMutex);
+    auto iter = bufferSizes.find(consumerConn->getCookie());
+    if (iter == bufferSizes.end()) {
+        return consumerConn->getFlowControlBufSize();
+    }
+    const size_t current = iter->second;
+
+    /* Only grow by what the aggr memory threshold leaves; shrinking is
+     always allowed */
+    if (targetSize > current) {
+        Configuration& config = engine_.getConfiguration();
+        const double dcpConnBufferSizeThreshold =
+                static_cast<double>(
+                        config.getDcpConnBufferSizeAggrMemThreshold()) /
+                100;
+        const size_t limit = dcpConnBufferSizeThreshold *
+                             engine_.getEpStats().getMaxDataSize();
+        const size_t others = aggrDcpConsumerBufferSize - current;
+        const size_t available = limit > others ? limit - others : 0;
+        targetSize = std::max(current, std::min(targetSize, available));
+    }
+
+    if (targetSize != current) {
+        aggrDcpConsumerBufferSize += targetSize;
+        aggrDcpConsumerBufferSize -= current;
+        iter->second = targetSize;
+        EP_LOG_DEBUG("{} Conn flow control buffer is tuned from {} to {}",
+                     consumerConn->logHeader(),
+                     current,
+                     targetSize);
+    }
+    return targetSize;
+}
+
+size_t DcpFlowControlManagerAuto::getAggrBufferSize() {
+    std::lock_guard<std::mutex> lh(bufferSizesMutex);
+    return aggrDcpConsumerBufferSize;
+}
@@ -48,6 +48,14 @@ public:
     /* Will indicate if flow control is enabled */
     virtual bool isEnabled(void) const;
 
+    /* Will indicate if the connections should measure their links and
+       request buffer sizes with tuneBufSize() */
+    virtual bool isAutoTuned() const;
+
+    /* To be called when a consumer connection wants its flow control buffer
+       resized to targetSize. Returns the size it may use */
+    virtual size_t tuneBufSize(DcpConsumer* consumerConn, size_t targetSize);
+
 protected:
     void setBufSizeWithinBounds(DcpConsumer *consumerConn, size_t &bufSize);
 
@@ -127,3 +135,39 @@ private:
     /* Fraction of memQuota for all dcp consumer connection buffers */
     std::atomic<double> dcpConnBufferSizeAggrFrac;
 };
+
+/**
+ * In this policy each connection starts with a flow control buffer of the min
+ * value (10 MB), which is then grown or shrunk towards the bandwidth-delay
+ * product of its link, as measured by the connection from its ack latency and
+ * throughput (see FlowControl). The buffers stay within the max (50MB) and min
+ * value, and are only grown while the aggr flow control buffer memory stays
+ * below the same threshold (10% of bucket memory) as the dynamic policy.
+ */
+class DcpFlowControlManagerAuto : public DcpFlowControlManager {
+public:
+    DcpFlowControlManagerAuto(EventuallyPersistentEngine& engine);
+
+    ~DcpFlowControlManagerAuto();
+
+    size_t newConsumerConn(DcpConsumer* consumerConn) override;
+
+    void handleDisconnect(DcpConsumer* consumerConn) override;
+
+    bool isEnabled(void) const override;
+
+    bool isAutoTuned() const override;
+
+    size_t tuneBufSize(DcpConsumer* consumerConn, size_t targetSize) override;
+
+    /* Total memory used by all DCP consumer buffers */
+    size_t getAggrBufferSize();
+
+private:
+    /* Mutex to ensure bufferSizes and aggrDcpConsumerBufferSize are in step */
+    std::mutex bufferSizesMutex;
+    /* Flow control buffer size of each DCP Consumer */
+    std::map<const void*, size_t> bufferSizes;
+    /* Total memory used by all DCP consumer buffers */
+    size_t aggrDcpConsumerBufferSize = 0;
+};
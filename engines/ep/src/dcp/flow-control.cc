@@ -29,10 +29,18 @@ FlowControl::FlowControl(EventuallyPersistentEngine &engine,
     pendingControl(true),
     lastBufferAck(ep_current_time()),
     ackedBytes(0),
-    freedBytes(0)
+    freedBytes(0),
+    autoTune(false),
+    tuneStart(std::chrono::steady_clock::now()),
+    tuneBytes(0),
+    drainedAckTime(0),
+    ackWaitNs(0),
+    ackWaits(0),
+    rttEstimateUs(0)
 {
     enabled = engine.getDcpFlowControlManager().isEnabled();
     if (enabled) {
+        autoTune = engine.getDcpFlowControlManager().isAutoTuned();
         bufferSize =
                     engine.getDcpFlowControlManager().newConsumerConn(consumer);
     }
@@ -62,24 +70,12 @@ ENGINE_ERROR_CODE FlowControl::handleFlowCtl(
         } else if (isBufferSufficientlyDrained_UNLOCKED(ackable_bytes)) {
             lh.unlock();
             /* Send a buffer ack when at least 20% of the buffer is drained */
-            uint64_t opaque = consumerConn->incrOpaqueCounter();
-            ret = producers->buffer_acknowledgement(
-                    opaque, Vbid(0), ackable_bytes);
-            lastBufferAck = ep_current_time();
-            ackedBytes.fetch_add(ackable_bytes);
-            freedBytes.fetch_sub(ackable_bytes);
-            return ret;
+            return sendBufferAck(producers, ackable_bytes);
         } else if (ackable_bytes > 0 &&
                    (ep_current_time() - lastBufferAck) > 5) {
             lh.unlock();
             /* Ack at least every 5 seconds */
-            uint64_t opaque = consumerConn->incrOpaqueCounter();
-            ret = producers->buffer_acknowledgement(
-                    opaque, Vbid(0), ackable_bytes);
-            lastBufferAck = ep_current_time();
-            ackedBytes.fetch_add(ackable_bytes);
-            freedBytes.fetch_sub(ackable_bytes);
-            return ret;
+            return sendBufferAck(producers, ackable_bytes);
         } else {
             lh.unlock();
         }
@@ -87,9 +83,85 @@ ENGINE_ERROR_CODE FlowControl::handleFlowCtl(
     return ENGINE_FAILED;
 }
 
+ENGINE_ERROR_CODE FlowControl::sendBufferAck(
+        struct dcp_message_producers* producers, uint32_t ackable_bytes) {
+    uint64_t opaque = consumerConn->incrOpaqueCounter();
+    ENGINE_ERROR_CODE ret =
+            producers->buffer_acknowledgement(opaque, Vbid(0), ackable_bytes);
+    lastBufferAck = ep_current_time();
+    ackedBytes.fetch_add(ackable_bytes);
+    const auto unacked = freedBytes.fetch_sub(ackable_bytes) - ackable_bytes;
+    if (autoTune) {
+        if (unacked == 0) {
+            /* Everything is processed, so wait for the next bytes */
+            drainedAckTime.store(std::chrono::steady_clock::now()
+                                         .time_since_epoch()
+                                         .count());
+        }
+        autoTuneBufSize(ackable_bytes);
+    }
+    return ret;
+}
+
+void FlowControl::autoTuneBufSize(uint32_t acked_bytes) {
+    using namespace std::chrono;
+    tuneBytes += acked_bytes;
+    const auto now = steady_clock::now();
+    const auto elapsed = duration_cast<microseconds>(now - tuneStart);
+    if (elapsed < TuneInterval) {
+        return;
+    }
+
+    const uint64_t waitUs = ackWaitNs.exchange(0) / 1000;
+    const uint64_t waits = ackWaits.exchange(0);
+    const uint64_t bytes = tuneBytes;
+    tuneStart = now;
+    tuneBytes = 0;
+
+    if (waits > 0) {
+        const uint64_t sampleUs = waitUs / waits;
+        const uint64_t rtt = rttEstimateUs;
+        rttEstimateUs = rtt ? (rtt * 3 + sampleUs) / 4 : sampleUs;
+    }
+    const uint64_t rttUs = rttEstimateUs;
+    if (rttUs == 0) {
+        return;
+    }
+
+    /* bytes per second * rtt == bytes in flight per round trip */
+    const uint64_t bdp = bytes * rttUs / elapsed.count();
+    const uint64_t current = bufferSize;
+    uint64_t target = current;
+    if (bytes >= current && waitUs * 4 >= uint64_t(elapsed.count())) {
+        /* The producer was held up by the buffer */
+        target = std::max(bdp * 2, current + current / 2);
+    } else if (bdp * 4 < current) {
+        target = std::max(bdp * 2, current / 2);
+    }
+    if (target != current) {
+        setFlowControlBufSize(
+                engine_.getDcpFlowControlManager().tuneBufSize(consumerConn,
+                                                               target));
+    }
+}
+
 void FlowControl::incrFreedBytes(uint32_t bytes)
 {
     freedBytes.fetch_add(bytes);
+    if (autoTune && drainedAckTime.load(std::memory_order_relaxed) != 0) {
+        const int64_t ackTime = drainedAckTime.exchange(0);
+        if (ackTime != 0) {
+            const int64_t now = std::chrono::steady_clock::now()
+                                        .time_since_epoch()
+                                        .count();
+            ackWaitNs.fetch_add(std::chrono::duration_cast<
+                                        std::chrono::nanoseconds>(
+                                        std::chrono::steady_clock::duration(
+                                                now - ackTime))
+                                        .count());
+            ackWaits.fetch_add(1);
+        }
+    }
 }
 
 uint32_t FlowControl::getFlowControlBufSize(void)
@@ -119,4 +191,7 @@ void FlowControl::addStats(const AddStatFn& add_stat, const void* c) {
     consumerConn->addStat("total_acked_bytes", ackedBytes, add_stat, c);
     consumerConn->addStat("max_buffer_bytes", bufferSize, add_stat, c);
     consumerConn->addStat("unacked_bytes", freedBytes, add_stat, c);
+    if (autoTune) {
+        consumerConn->addStat("rtt_estimate_us", rttEstimateUs, add_stat, c);
+    }
 }
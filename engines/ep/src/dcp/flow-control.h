@@ -21,6 +21,8 @@
 
 #include <relaxed_atomic.h>
 
+#include <chrono>
+
 class DcpConsumer;
 class EventuallyPersistentEngine;
 
@@ -58,6 +60,27 @@ private:
 
     bool isBufferSufficientlyDrained_UNLOCKED(uint32_t ackable_bytes);
 
+    /* Send a buffer ack of ackable_bytes, and take it into account for the
+       auto tuning */
+    ENGINE_ERROR_CODE sendBufferAck(struct dcp_message_producers* producers,
+                                    uint32_t ackable_bytes);
+
+    /**
+     * Once per TuneInterval, ask the flow control manager to resize the
+     * buffer to twice the bandwidth-delay product of the link.
+     *
+     * The delay is estimated as the time between sending a buffer ack with
+     * everything processed and receiving the next bytes (when the producer
+     * was waiting for the ack that is the round trip). The buffer is grown if
+     * it was filled and the consumer spent at least a quarter of the interval
+     * waiting like that, and shrunk if it is over twice the size needed for
+     * the throughput seen.
+     */
+    void autoTuneBufSize(uint32_t acked_bytes);
+
+    /* How often the buffer size is auto tuned */
+    static constexpr std::chrono::seconds TuneInterval{1};
+
     /* Associated consumer connection handler */
     DcpConsumer* consumerConn;
 
@@ -85,4 +108,23 @@ private:
 
     /* Bytes processed from the flow control buffer */
     std::atomic<uint64_t> freedBytes;
+
+    /* Indicates if the buffer size is auto tuned to the link */
+    bool autoTune;
+
+    /* Start of the current auto tuning interval and the bytes acked in it */
+    std::chrono::steady_clock::time_point tuneStart;
+    uint64_t tuneBytes;
+
+    /* When a buffer ack was sent with nothing left unacked (in ns of the
+       steady clock), 0 once bytes have been processed after it */
+    std::atomic<int64_t> drainedAckTime;
+
+    /* Total time and number of waits from drainedAckTime to the next bytes
+       in the current auto tuning interval */
+    std::atomic<uint64_t> ackWaitNs;
+    std::atomic<uint64_t> ackWaits;
+
+    /* Estimated round trip time to the producer (0 until measured) */
+    cb::RelaxedAtomic<uint64_t> rttEstimateUs;
 };
@@ -30,6 +30,7 @@
 #include <gsl.h>
 
 #include <memory>
+#include <tuple>
 
 const std::string passiveStreamLoggingPrefix =
         "DCP (Consumer): **Deleted conn**";
@@ -263,7 +264,8 @@ ENGINE_ERROR_CODE PassiveStream::messageReceived(
         }
     }
 
-    switch (engine->getReplicationThrottle().getStatus()) {
+    auto& throttle = engine->getReplicationThrottle();
+    switch (throttle.getStatus()) {
     case ReplicationThrottle::Status::Disconnect:
         log(spdlog::level::level_enum::warn,
             "{} Disconnecting the connection as there is "
@@ -271,7 +273,9 @@ ENGINE_ERROR_CODE PassiveStream::messageReceived(
             vb_);
         return ENGINE_DISCONNECT;
     case ReplicationThrottle::Status::Process:
-        if (buffer.empty()) {
+        // While the throttle is pacing, buffer the message so that it's
+        // processed (and acknowledged) at the pace of the DcpConsumerTask
+        if (buffer.empty() && throttle.getProcessRatio() >= 1.0) {
             /* Process the response here itself rather than buffering it */
             ENGINE_ERROR_CODE ret = ENGINE_SUCCESS;
             switch (dcpResponse->getEvent()) {
@@ -352,6 +356,118 @@ ENGINE_ERROR_CODE PassiveStream::messageReceived(
     return ENGINE_TMPFAIL;
 }
 
+bool PassiveStream::processMutationBatch(std::unique_lock<std::mutex>& lh,
+                                         size_t maxCount,
+                                         uint32_t& count,
+                                         uint32_t& bytes,
+                                         ENGINE_ERROR_CODE& ret) {
+    // The run of mutations within the current snapshot; anything else (and
+    // which processMessage would reject) is left for the single path
+    const uint64_t snapStart = cur_snapshot_start.load();
+    const uint64_t snapEnd = cur_snapshot_end.load();
+    size_t runLength = 0;
+    for (const auto& message : buffer.messages) {
+        if (runLength == maxCount || !message ||
+            message->getEvent() != DcpResponse::Event::Mutation) {
+            break;
+        }
+        const uint64_t seqno = *message->getBySeqno();
+        if (seqno < snapStart || seqno > snapEnd) {
+            break;
+        }
+        ++runLength;
+    }
+    if (runLength < 2) {
+        return false;
+    }
+
+    // As processBufferedMessages, keep the (now empty) slots in the buffer
+    // until the messages are processed (MB-31410)
+    std::vector<std::unique_ptr<DcpResponse>> batch;
+    batch.reserve(runLength);
+    for (size_t ii = 0; ii < runLength; ++ii) {
+        batch.push_back(std::move(buffer.messages[ii]));
+    }
+    lh.unlock();
+
+    // MB-31410: Only used for testing
+    if (processBufferedMessages_postFront_Hook) {
+        processBufferedMessages_postFront_Hook();
+    }
+
+    VBucketPtr vb = engine->getVBucket(vb_);
+    auto consumer = consumerPtr.lock();
+    bool batched = true;
+    size_t applied = 0;
+    ret = ENGINE_SUCCESS;
+    if (!vb) {
+        ret = ENGINE_NOT_MY_VBUCKET;
+    } else if (!consumer) {
+        ret = ENGINE_DISCONNECT;
+    } else if (vb->isBackfillPhase()) {
+        // Backfill items are added by addBackfillItem
+        batched = false;
+    } else {
+        std::vector<Item*> items;
+        items.reserve(batch.size());
+        for (auto& response : batch) {
+            auto* mutation = static_cast<MutationConsumerMessage*>(
+                    response.get());
+            // MB-17517: As processMessage
+            if (!Item::isValidCas(mutation->getItem()->getCas())) {
+                log(spdlog::level::level_enum::warn,
+                    "Invalid CAS ({:#x}) received for mutation {{{}, "
+                    "seqno:{}}}. Regenerating new CAS",
+                    mutation->getItem()->getCas(),
+                    vb_,
+                    mutation->getItem()->getBySeqno());
+                mutation->getItem()->setCas();
+            }
+            items.push_back(mutation->getItem().get());
+        }
+
+        std::tie(applied, ret) = engine->getKVBucket()->setWithMetaBatch(
+                vb_,
+                items,
+                consumer->getCookie(),
+                {vbucket_state_active,
+                 vbucket_state_replica,
+                 vbucket_state_pending});
+
+        for (size_t ii = 0; ii < applied; ++ii) {
+            handleSnapshotEnd(vb, *batch[ii]->getBySeqno());
+        }
+        if (ret != ENGINE_SUCCESS) {
+            log(spdlog::level::level_enum::warn,
+                "{} Got error '{}' while trying to process "
+                "mutation with seqno:{}",
+                vb_,
+                cb::to_string(cb::to_engine_errc(ret)),
+                *batch[applied]->getBySeqno());
+        }
+    }
+
+    lh.lock();
+    count = 0;
+    bytes = 0;
+    for (size_t ii = 0; ii < applied; ++ii) {
+        const uint32_t messageBytes = batch[ii]->getMessageSize();
+        buffer.pop_front(lh, messageBytes);
+        ++count;
+        bytes += messageBytes;
+    }
+    // Give the messages not applied back to the buffer (unless it has been
+    // cleared meanwhile)
+    for (size_t ii = applied, slot = 0;
+         ii < batch.size() && slot < buffer.messages.size();
+         ++ii, ++slot) {
+        if (!buffer.messages[slot]) {
+            buffer.messages[slot] = std::move(batch[ii]);
+        }
+    }
+    return batched;
+}
+
 process_items_error_t PassiveStream::processBufferedMessages(
         uint32_t& processed_bytes, size_t batchSize) {
     std::unique_lock<std::mutex> lh(buffer.bufMutex);
@@ -359,6 +475,8 @@ process_items_error_t PassiveStream::processBufferedMessages(
     uint32_t message_bytes = 0;
     uint32_t total_bytes_processed = 0;
     bool failed = false, noMem = false;
+    const bool batchedIngest =
+            engine->getConfiguration().isDcpConsumerBatchedIngest();
 
     while (count < batchSize && !buffer.messages.empty()) {
         ENGINE_ERROR_CODE ret = ENGINE_SUCCESS;
@@ -370,6 +488,30 @@ process_items_error_t PassiveStream::processBufferedMessages(
             return all_processed;
         }
 
+        uint32_t batchCount = 0;
+        uint32_t batchBytes = 0;
+        if (batchedIngest && batchSize - count > 1 &&
+            processMutationBatch(
+                    lh, batchSize - count, batchCount, batchBytes, ret)) {
+            count += batchCount;
+            total_bytes_processed += batchBytes;
+            if (ret == ENGINE_TMPFAIL || ret == ENGINE_ENOMEM) {
+                failed = true;
+                if (ret == ENGINE_ENOMEM) {
+                    noMem = true;
+                }
+                // As below, try again with the rest at the next run
+                if (isActive()) {
+                    break;
+                }
+            }
+            if (ret == ENGINE_SUCCESS || failed || buffer.messages.empty()) {
+                continue;
+            }
+            // Otherwise let the mutation which failed be handled (and
+            // dropped) by processMutation below, as it would be unbatched
+        }
+
         // MB-31410: The front-end thread can process new incoming messages
         // only /after/ all the buffered ones have been processed.
         // So, here we get only a reference. We remove the message from the
@@ -661,6 +803,18 @@ ENGINE_ERROR_CODE PassiveStream::processPrepare(
 void PassiveStream::seqnoAck(int64_t seqno) {
     {
         LockHolder lh(streamMutex);
+        // If the previous ack is still waiting to be sent (it's the last
+        // message queued) then just move it on to seqno rather than queue
+        // another: the seqno acknowledged covers all the earlier ones, and
+        // the active gets to process the prepares it satisfies together.
+        if (!readyQ.empty() &&
+            readyQ.back()->getEvent() ==
+                    DcpResponse::Event::SeqnoAcknowledgement) {
+            // Same message size, so the readyQ memory is unchanged
+            readyQ.back() = std::make_unique<SeqnoAcknowledgement>(
+                    opaque_, vb_, seqno);
+            return;
+        }
         pushToReadyQ(
                 std::make_unique<SeqnoAcknowledgement>(opaque_, vb_, seqno));
     }
@@ -90,7 +90,8 @@ public:
     void addStats(const AddStatFn& add_stat, const void* c) override;
 
     /**
-     * Push a SeqnoAck message over this stream.
+     * Push a SeqnoAck message over this stream (or move the one still queued
+     * on to seqno).
      *
      * @param seqno The payload
      */
@@ -122,6 +123,28 @@ protected:
      */
     ENGINE_ERROR_CODE processMessage(MutationConsumerMessage* message,
                                      MessageType messageType);
+
+    /**
+     * Apply the run of mutations at the front of the buffer (at most
+     * maxCount) with a single KVBucket::setWithMetaBatch call, rather than
+     * through processMutation one by one.
+     *
+     * Must be called with buffer.bufMutex held by lh, which is held again on
+     * return. The mutations applied are removed from the buffer, the others
+     * left at its front.
+     *
+     * @param[out] count the number of mutations applied
+     * @param[out] bytes the size of the mutations applied
+     * @param[out] ret the result of applying the next mutation
+     *             (ENGINE_SUCCESS if all were applied)
+     * @return false if there's no run of mutations which can be batched at
+     *         the front of the buffer (which is then left alone)
+     */
+    bool processMutationBatch(std::unique_lock<std::mutex>& lh,
+                              size_t maxCount,
+                              uint32_t& count,
+                              uint32_t& bytes,
+                              ENGINE_ERROR_CODE& ret);
     /**
      * Deal with incoming mutation sent to the DcpConsumer/PassiveStream by
      * passing to processMessage with MessageType::Mutation
@@ -34,11 +34,14 @@
 #include "failover-table.h"
 #include "item_eviction.h"
 #include "kv_bucket.h"
+#include "lock_profiler.h"
 #include "snappy-c.h"
 #include "statwriter.h"
 
 #include <memcached/server_cookie_iface.h>
 
+#include <algorithm>
+
 const std::chrono::seconds DcpProducer::defaultDcpNoopTxInterval(20);
 
 DcpProducer::BufferLog::State DcpProducer::BufferLog::getState_UNLOCKED() {
@@ -164,11 +167,15 @@ DcpProducer::DcpProducer(EventuallyPersistentEngine& e,
                          bool startTask)
     : ConnHandler(e, cookie, name),
       notifyOnly((flags & cb::mcbp::request::DcpOpenPayload::Notifier) != 0),
+      stepBatchItems(std::max(
+              size_t(1), e.getConfiguration().getDcpProducerStepBatchItems())),
+      stepBatchBytes(e.getConfiguration().getDcpProducerStepBatchBytes()),
       sendStreamEndOnClientStreamClose(false),
       consumerSupportsHifiMfu(false),
       lastSendTime(ep_current_time()),
       log(*this),
       backfillMgr(std::make_shared<BackfillManager>(engine_)),
+      ready(e.getConfiguration().getMaxVbuckets()),
       streams(streamsMapSize),
       itemsSent(0),
       totalBytesSent(0),
@@ -242,6 +249,7 @@ DcpProducer::DcpProducer(EventuallyPersistentEngine& e,
     enableExtMetaData = false;
     forceValueCompression = false;
     enableExpiryOpcode = false;
+    keyOrderBackfill = false;
 
     // Cursor dropping is disabled for replication connections by default,
     // but will be enabled through a control message to support backward
@@ -259,12 +267,12 @@ DcpProducer::~DcpProducer() {
 }
 
 void DcpProducer::cancelCheckpointCreatorTask() {
-    LockHolder guard(checkpointCreator->mutex);
-    if (checkpointCreator->task) {
-        static_cast<ActiveStreamCheckpointProcessorTask*>(
-                checkpointCreator->task.get())
+    ProfiledLockHolder guard(checkpointCreator->mutex,
+                             getCheckpointCreatorLockProfile());
+    for (auto& task : checkpointCreator->tasks) {
+        static_cast<ActiveStreamCheckpointProcessorTask*>(task.get())
                 ->cancelTask();
-        ExecutorPool::get()->cancel(checkpointCreator->task->getId());
+        ExecutorPool::get()->cancel(task->getId());
     }
 }
 
@@ -487,7 +495,7 @@ ENGINE_ERROR_CODE DcpProducer::streamRequest(
            the stream creation fails later on in the func. The goal is to
            create the 'checkpointProcessorTask' before any valid active stream
            is created */
-        if (createChkPtProcessorTsk && !checkpointCreator->task) {
+        if (createChkPtProcessorTsk && checkpointCreator->tasks.empty()) {
             createCheckpointProcessorTask();
             scheduleCheckpointProcessorTask();
         }
@@ -578,7 +586,31 @@ cb::unique_item_ptr DcpProducer::toUniqueItemPtr(
 }
 
 ENGINE_ERROR_CODE DcpProducer::step(struct dcp_message_producers* producers) {
+    const size_t bytesBefore = totalBytesSent;
+    const auto ret = stepMessage(producers);
+
+    // Fill the send buffer with up to stepBatchItems messages (or
+    // stepBatchBytes) per step, rather than the front-end calling back in
+    // (and looking up this producer) for each one.
+    size_t messages = 1;
+    while (ret == ENGINE_SUCCESS && messages < stepBatchItems &&
+           totalBytesSent - bytesBefore < stepBatchBytes) {
+        const auto next = stepMessage(producers);
+        if (next == ENGINE_EWOULDBLOCK || next == ENGINE_E2BIG) {
+            // Nothing more to send for now, or the send buffer is full (the
+            // rejected message is stashed and sent by the next step)
+            break;
+        }
+        if (next != ENGINE_SUCCESS) {
+            return next;
+        }
+        ++messages;
+    }
+    return ret;
+}
 
+ENGINE_ERROR_CODE DcpProducer::stepMessage(
+        struct dcp_message_producers* producers) {
     if (doDisconnect()) {
         return ENGINE_DISCONNECT;
     }
@@ -985,6 +1017,17 @@ ENGINE_ERROR_CODE DcpProducer::control(uint32_t opaque,
             supportsSyncReplication = true;
             return ENGINE_SUCCESS;
         }
+    } else if (keyStr == "backfill_order") {
+        // Clients which don't need the items of a disk snapshot in seqno
+        // order (they only use the whole snapshot) may have it read in key
+        // order, which is mostly sequential IO in a compacted couchstore file
+        if (valueStr == "key") {
+            keyOrderBackfill = true;
+            return ENGINE_SUCCESS;
+        } else if (valueStr == "seqno") {
+            keyOrderBackfill = false;
+            return ENGINE_SUCCESS;
+        }
     } else if (key == "consumer_name") {
         consumerName = valueStr;
         return ENGINE_SUCCESS;
@@ -1174,6 +1217,10 @@ void DcpProducer::recordBackfillManagerBytesSent(size_t bytes) {
     backfillMgr->bytesSent(bytes);
 }
 
+void DcpProducer::resetBackfillManagerScanBuffer() {
+    backfillMgr->resetScanBuffer();
+}
+
 void DcpProducer::scheduleBackfillManager(VBucket& vb,
                                           std::shared_ptr<ActiveStream> s,
                                           uint64_t start,
@@ -1203,6 +1250,10 @@ void DcpProducer::addStats(const AddStatFn& add_stat, const void* c) {
             add_stat,
             c);
     addStat("enable_expiry_opcode", enableExpiryOpcode, add_stat, c);
+    addStat("backfill_order",
+            keyOrderBackfill ? "key" : "seqno",
+            add_stat,
+            c);
     addStat("enable_stream_id",
             multipleStreamRequests == MultipleStreamRequests::Yes,
             add_stat,
@@ -1217,14 +1268,15 @@ void DcpProducer::addStats(const AddStatFn& add_stat, const void* c) {
 
     log.addStats(add_stat, c);
 
-    ExTask pointerCopy;
+    std::vector<ExTask> pointerCopies;
     { // Locking scope
-        LockHolder guard(checkpointCreator->mutex);
-        pointerCopy = checkpointCreator->task;
+        ProfiledLockHolder guard(checkpointCreator->mutex,
+                                 getCheckpointCreatorLockProfile());
+        pointerCopies = checkpointCreator->tasks;
     }
 
-    if (pointerCopy) {
-        static_cast<ActiveStreamCheckpointProcessorTask*>(pointerCopy.get())
+    for (auto& task : pointerCopies) {
+        static_cast<ActiveStreamCheckpointProcessorTask*>(task.get())
                 ->addStats(getName(), add_stat, c);
     }
 
@@ -1613,27 +1665,43 @@ bool DcpProducer::bufferLogInsert(size_t bytes) {
     return log.insert(bytes);
 }
 
+LockProfile& DcpProducer::getCheckpointCreatorLockProfile() {
+    return engine_.getEpStats().lockProfiler.get(
+            LockProfiler::Lock::DcpCheckpointCreator);
+}
+
 void DcpProducer::createCheckpointProcessorTask() {
-    LockHolder guard(checkpointCreator->mutex);
-    checkpointCreator->task =
-            std::make_shared<ActiveStreamCheckpointProcessorTask>(
-                    engine_, shared_from_this());
+    const auto numTasks =
+            engine_.getConfiguration().getDcpProducerProcessorTasks();
+    ProfiledLockHolder guard(checkpointCreator->mutex,
+                             getCheckpointCreatorLockProfile());
+    checkpointCreator->tasks.clear();
+    for (size_t ii = 0; ii < numTasks; ++ii) {
+        checkpointCreator->tasks.push_back(
+                std::make_shared<ActiveStreamCheckpointProcessorTask>(
+                        engine_, shared_from_this(), ii));
+    }
 }
 
 void DcpProducer::scheduleCheckpointProcessorTask() {
-    LockHolder guard(checkpointCreator->mutex);
-    ExecutorPool::get()->schedule(checkpointCreator->task);
+    ProfiledLockHolder guard(checkpointCreator->mutex,
+                             getCheckpointCreatorLockProfile());
+    for (auto& task : checkpointCreator->tasks) {
+        ExecutorPool::get()->schedule(task);
+    }
 }
 
 void DcpProducer::scheduleCheckpointProcessorTask(
         std::shared_ptr<ActiveStream> s) {
-    LockHolder guard(checkpointCreator->mutex);
-    if (!checkpointCreator->task) {
+    ProfiledLockHolder guard(checkpointCreator->mutex,
+                             getCheckpointCreatorLockProfile());
+    auto& tasks = checkpointCreator->tasks;
+    if (tasks.empty()) {
         throw std::logic_error(
                 "DcpProducer::scheduleCheckpointProcessorTask task is null");
     }
     static_cast<ActiveStreamCheckpointProcessorTask*>(
-            checkpointCreator->task.get())
+            tasks[s->getVBucket().get() % tasks.size()].get())
             ->schedule(s);
 }
 
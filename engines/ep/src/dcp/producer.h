@@ -32,6 +32,7 @@
 class BackfillManager;
 class CheckpointCursor;
 class DcpResponse;
+class LockProfile;
 class MutationResponse;
 class VBucket;
 
@@ -161,6 +162,7 @@ public:
     void notifyBackfillManager();
     bool recordBackfillManagerBytesRead(size_t bytes, bool force);
     void recordBackfillManagerBytesSent(size_t bytes);
+    void resetBackfillManagerScanBuffer();
     void scheduleBackfillManager(VBucket& vb,
                                  std::shared_ptr<ActiveStream> s,
                                  uint64_t start,
@@ -192,6 +194,10 @@ public:
         return supportsCursorDropping.load();
     }
 
+    bool isKeyOrderBackfillEnabled() const {
+        return keyOrderBackfill.load();
+    }
+
     /**
      * Notifies the front-end synchronously on this thread that this paused
      * connection should be re-considered for work.
@@ -350,13 +356,21 @@ protected:
     ENGINE_ERROR_CODE maybeSendNoop(struct dcp_message_producers* producers);
 
     /**
-     * Create the ActiveStreamCheckpointProcessorTask and assign to
-     * checkpointCreatorTask
+     * Send the next message (a noop, a retried message rejected as the send
+     * buffer was full, or the next item of a ready stream).
+     * step() calls this for each message of a batch.
+     */
+    ENGINE_ERROR_CODE stepMessage(struct dcp_message_producers* producers);
+
+    /**
+     * Create the (dcp_producer_processor_tasks)
+     * ActiveStreamCheckpointProcessorTasks and assign to
+     * checkpointCreator->tasks
      */
     void createCheckpointProcessorTask();
 
     /**
-     * Schedule the checkpointCreatorTask on the ExecutorPool
+     * Schedule the checkpointCreator->tasks on the ExecutorPool
      */
     void scheduleCheckpointProcessorTask();
 
@@ -509,12 +523,18 @@ protected:
 
     const bool notifyOnly;
 
+    /// The most messages / bytes one step() sends (dcp_producer_step_batch_*)
+    const size_t stepBatchItems;
+    const size_t stepBatchBytes;
+
     cb::RelaxedAtomic<bool> enableExtMetaData;
     cb::RelaxedAtomic<bool> forceValueCompression;
     cb::RelaxedAtomic<bool> supportsCursorDropping;
     cb::RelaxedAtomic<bool> sendStreamEndOnClientStreamClose;
     cb::RelaxedAtomic<bool> consumerSupportsHifiMfu;
     cb::RelaxedAtomic<bool> enableExpiryOpcode;
+    /// Did the client ask for disk snapshots to be backfilled in key order?
+    cb::RelaxedAtomic<bool> keyOrderBackfill;
 
     // SyncReplication: Producer needs to know the Consumer name to identify
     // the source of received SeqnoAck messages.
@@ -562,17 +582,22 @@ protected:
     std::atomic<size_t> totalBytesSent;
     std::atomic<size_t> totalUncompressedDataSize;
 
-    /// Guards access to checkpointCreatorTask, so multiple threads can
-    /// safely access  checkpointCreatorTask shared ptr.
+    /// Guards access to checkpointCreator tasks, so multiple threads can
+    /// safely access the tasks' shared ptrs.
     struct CheckpointCreator {
         mutable std::mutex mutex;
-        ExTask task;
+        /// The stream of a vbucket is processed by the task at index
+        /// (vbid % tasks.size()), so the vbuckets are processed in parallel
+        std::vector<ExTask> tasks;
     };
 
     // MB-30488: padding to keep mutex from sharing cachelines with
     // unrelated data
     folly::CachelinePadded<CheckpointCreator> checkpointCreator;
 
+    /// The profile of the checkpointCreator mutex (stats.lockProfiler)
+    LockProfile& getCheckpointCreatorLockProfile();
+
     static const std::chrono::seconds defaultDcpNoopTxInterval;
 
     // Indicates whether the active streams belonging to the DcpProducer should
@@ -20,9 +20,17 @@
 #include "locks.h"
 #include "statwriter.h"
 
-bool DcpReadyQueue::exists(Vbid vbucket) {
-    LockHolder lh(lock);
-    return (queuedValues.count(vbucket) != 0);
+#include <gsl.h>
+
+DcpReadyQueue::DcpReadyQueue(size_t maxVbuckets) : queued(maxVbuckets) {
+    for (auto& flag : queued) {
+        flag.store(false);
+    }
+}
+
+bool DcpReadyQueue::exists(Vbid vbucket) const {
+    Expects(vbucket.get() < queued.size());
+    return queued[vbucket.get()].load();
 }
 
 bool DcpReadyQueue::popFront(Vbid& frontValue) {
@@ -30,7 +38,7 @@ bool DcpReadyQueue::popFront(Vbid& frontValue) {
     if (!readyQueue.empty()) {
         frontValue = readyQueue.front();
         readyQueue.pop();
-        queuedValues.erase(frontValue);
+        queued[frontValue.get()].store(false);
         return true;
     }
     return false;
@@ -39,21 +47,24 @@ bool DcpReadyQueue::popFront(Vbid& frontValue) {
 void DcpReadyQueue::pop() {
     LockHolder lh(lock);
     if (!readyQueue.empty()) {
-        queuedValues.erase(readyQueue.front());
+        queued[readyQueue.front().get()].store(false);
         readyQueue.pop();
     }
 }
 
 bool DcpReadyQueue::pushUnique(Vbid vbucket) {
-    bool wasEmpty;
-    {
-        LockHolder lh(lock);
-        wasEmpty = queuedValues.empty();
-        const bool inserted = queuedValues.emplace(vbucket).second;
-        if (inserted) {
-            readyQueue.push(vbucket);
-        }
+    Expects(vbucket.get() < queued.size());
+
+    // Already queued (so the queue isn't empty); the popping thread clears
+    // the flag before it processes the vbucket, so it will see whatever the
+    // caller is notifying about.
+    if (queued[vbucket.get()].exchange(true)) {
+        return false;
     }
+
+    LockHolder lh(lock);
+    const bool wasEmpty = readyQueue.empty();
+    readyQueue.push(vbucket);
     return wasEmpty;
 }
 
@@ -72,11 +83,15 @@ void DcpReadyQueue::addStats(const std::string& prefix,
                              const void* c) {
     // Take a copy of the queue data under lock; then format it to stats.
     std::queue<Vbid> qCopy;
-    std::unordered_set<Vbid> qMapCopy;
     {
         LockHolder lh(lock);
         qCopy = readyQueue;
-        qMapCopy = queuedValues;
+    }
+    std::vector<Vbid> qMapCopy;
+    for (size_t vbid = 0; vbid < queued.size(); ++vbid) {
+        if (queued[vbid].load()) {
+            qMapCopy.emplace_back(Vbid(vbid));
+        }
     }
 
     add_casted_stat((prefix + "size").c_str(), qCopy.size(), add_stat, c);
@@ -20,9 +20,10 @@
 #include <memcached/engine_common.h>
 #include <memcached/vbucket.h>
 
+#include <atomic>
 #include <mutex>
 #include <queue>
-#include <unordered_set>
+#include <vector>
 
 /**
  * DcpReadyQueue is a std::queue wrapper for managing a
@@ -33,12 +34,27 @@
  *   DCPProducer threads are accessing this data.
  * - processBufferedItems by the processer task of the consumer
  *
- * Internally a std::queue and std::set track the contents and the std::set
- * enables a fast exists method which is used by front-end threads.
+ * Internally a std::queue tracks the order and a per-vbucket atomic flag
+ * tracks the contents. Front-end threads notify a vbucket on every mutation,
+ * and it's normally already queued; the flag lets exists() and pushUnique()
+ * of a queued vbucket return without taking the lock, so they don't contend
+ * with the thread popping the queue. Only the thread which sets a vbucket's
+ * flag pushes it, so the lock is only taken once per vbucket per pop.
  */
 class DcpReadyQueue {
 public:
-    bool exists(Vbid vbucket);
+    /**
+     * @param maxVbuckets the number of vbuckets (all vbucket ids pushed must
+     *        be less than this)
+     */
+    explicit DcpReadyQueue(size_t maxVbuckets);
+
+    /**
+     * @return true if the vbucket is in (or about to be pushed onto) the
+     *         queue
+     * The vbucket id must be less than maxVbuckets (checked with Expects)
+     */
+    bool exists(Vbid vbucket) const;
 
     /**
      * Return true and set the ref-param 'frontValue' if the queue is not
@@ -56,6 +72,7 @@ public:
      * Push the vbucket only if it's not already in the queue.
      * @return true if the queue was previously empty (i.e. we have
      * transitioned from zero -> one elements in the queue).
+     * The vbucket id must be less than maxVbuckets (checked with Expects)
      */
     bool pushUnique(Vbid vbucket);
 
@@ -77,9 +94,9 @@ private:
     std::queue<Vbid> readyQueue;
 
     /**
-     * maintain a std::unordered_set of values that are in the readyQueue.
-     * find() is performed by front-end threads so we want it to be
-     * efficient so just a set lookup is required.
+     * Set (by pushUnique) when a vbucket is in, or about to be pushed onto,
+     * the readyQueue; cleared under the lock when it is popped. Indexed by
+     * vbucket id.
      */
-    std::unordered_set<Vbid> queuedValues;
+    std::vector<std::atomic<bool>> queued;
 };
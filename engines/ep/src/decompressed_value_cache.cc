@@ -0,0 +1,86 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "decompressed_value_cache.h"
+
+#include <platform/compress.h>
+
+DecompressedValueCache::DecompressedValueCache(size_t maxSize)
+    : maxSize(maxSize) {
+}
+
+bool DecompressedValueCache::decompress(const value_t& value,
+                                        value_t& inflated) {
+    const Blob* key = value.get().get();
+    const bool enabled = maxSize > 0;
+    if (enabled) {
+        std::lock_guard<std::mutex> lh(mutex);
+        auto it = index.find(key);
+        if (it != index.end()) {
+            entries.splice(entries.end(), entries, it->second);
+            inflated = it->second->inflated;
+            ++hits;
+            return true;
+        }
+    }
+
+    // Inflate without the lock; if several readers miss the same value at
+    // once, the first to finish caches it
+    cb::compression::Buffer buffer;
+    if (!cb::compression::inflate(cb::compression::Algorithm::Snappy,
+                                  {value->getData(), value->valueSize()},
+                                  buffer)) {
+        return false;
+    }
+    inflated = value_t(Blob::New(buffer.data(), buffer.size()));
+
+    if (enabled) {
+        ++misses;
+        std::lock_guard<std::mutex> lh(mutex);
+        if (index.count(key) == 0) {
+            entries.push_back({value, inflated});
+            index.emplace(key, std::prev(entries.end()));
+            size += getEntrySize(entries.back());
+            evict_UNLOCKED();
+        }
+    }
+    return true;
+}
+
+void DecompressedValueCache::setMaxSize(size_t size) {
+    std::lock_guard<std::mutex> lh(mutex);
+    maxSize = size;
+    evict_UNLOCKED();
+}
+
+size_t DecompressedValueCache::getSize() const {
+    std::lock_guard<std::mutex> lh(mutex);
+    return size;
+}
+
+size_t DecompressedValueCache::getEntrySize(const Entry& entry) {
+    return sizeof(Entry) + entry.value->getSize() + entry.inflated->getSize();
+}
+
+void DecompressedValueCache::evict_UNLOCKED() {
+    while (size > maxSize && !entries.empty()) {
+        auto& oldest = entries.front();
+        size -= getEntrySize(oldest);
+        index.erase(oldest.value.get().get());
+        entries.pop_front();
+    }
+}
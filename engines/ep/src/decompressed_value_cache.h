@@ -0,0 +1,97 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include "blob.h"
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+/**
+ * A cache of the inflated form of the Snappy compressed values of the hot
+ * documents, for the reads which need the value inflated (clients without
+ * Snappy, and documents with xattrs).
+ *
+ * With compression_mode=active the values are stored compressed, and every
+ * such read of a hot document inflates its value again.
+ *
+ * Entries are keyed by the compressed value's Blob, which the entry holds a
+ * reference to so its address can't be reused by another value while it is
+ * cached. A mutation of the document gives its StoredValue a new Blob (and
+ * CAS), so an entry never outlives the version of the document it was
+ * inflated from; it just stops being hit and ages out. The cache is bounded
+ * by the memory of the entries (the value and its inflated form), which is
+ * allocated by the bucket and so counts against its quota; the least
+ * recently used entries are evicted first.
+ */
+class DecompressedValueCache {
+public:
+    /// @param maxSize the memory the entries may use (0 disables the cache)
+    explicit DecompressedValueCache(size_t maxSize);
+
+    /**
+     * Get the inflated form of a compressed value, inflating it (and caching
+     * the result) if it isn't cached.
+     *
+     * @param value the Snappy compressed value
+     * @param[out] inflated the inflated value
+     * @return false if the value couldn't be inflated
+     */
+    bool decompress(const value_t& value, value_t& inflated);
+
+    void setMaxSize(size_t size);
+
+    size_t getMaxSize() const {
+        return maxSize;
+    }
+
+    /// @return the memory used by the entries
+    size_t getSize() const;
+
+    size_t getHits() const {
+        return hits;
+    }
+
+    size_t getMisses() const {
+        return misses;
+    }
+
+private:
+    struct Entry {
+        value_t value;
+        value_t inflated;
+    };
+
+    static size_t getEntrySize(const Entry& entry);
+
+    /// Evict the least recently used entries until the size is within the
+    /// maxSize
+    void evict_UNLOCKED();
+
+    mutable std::mutex mutex;
+    // The entries, least recently used first
+    std::list<Entry> entries;
+    std::unordered_map<const Blob*, std::list<Entry>::iterator> index;
+    size_t size = 0;
+
+    std::atomic<size_t> maxSize;
+    std::atomic<size_t> hits{0};
+    std::atomic<size_t> misses{0};
+};
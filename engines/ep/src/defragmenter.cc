@@ -74,6 +74,10 @@ bool DefragmenterTask::run(void) {
         const auto deadline = start + getChunkDuration();
         visitor.setDeadline(deadline);
         visitor.setBlobAgeThreshold(getAgeThreshold());
+        visitor.setAllocatorHooks(
+                engine->getConfiguration().isDefragmenterQueryUtilization()
+                        ? alloc_hooks
+                        : nullptr);
         // Only defragment StoredValues of persistent buckets because the
         // HashTable defrag method doesn't yet know how to maintain the
         // ephemeral seqno linked-list
@@ -169,6 +173,7 @@ void DefragmenterTask::updateStats(DefragmentVisitor& visitor) {
     stats.defragStoredValueNumMoved.fetch_add(
             visitor.getStoredValueDefragCount());
     stats.defragNumVisited.fetch_add(visitor.getVisitedCount());
+    stats.defragNumSkipped.fetch_add(visitor.getSkippedCount());
 }
 
 size_t DefragmenterTask::getMaxValueSize(ServerAllocatorIface* alloc_hooks) {
@@ -42,6 +42,10 @@ void DefragmentVisitor::setStoredValueAgeThreshold(uint8_t age) {
     sv_age_threshold = age;
 }
 
+void DefragmentVisitor::setAllocatorHooks(ServerAllocatorIface* hooks) {
+    alloc_hooks = hooks;
+}
+
 bool DefragmentVisitor::visit(const HashTable::HashBucketLock& lh,
                               StoredValue& v) {
     const size_t value_len = v.valuelen();
@@ -50,7 +54,9 @@ bool DefragmentVisitor::visit(const HashTable::HashBucketLock& lh,
     // and no larger than the biggest size class the allocator
     // supports, so it can be successfully reallocated to a run with other
     // objects of the same size.
-    if (value_len > 0 && value_len <= max_size_class) {
+    // (An inline value lives in the StoredValue itself; it's moved along
+    // with it below.)
+    if (value_len > 0 && value_len <= max_size_class && !v.isValueInline()) {
         // If sufficiently old and if it looks like nothing else holds a
         // reference to the blob reallocate, otherwise increment it's age.
         // It may be possible to add a reference to the blob without holding
@@ -58,8 +64,12 @@ bool DefragmentVisitor::visit(const HashTable::HashBucketLock& lh,
         // should be good enough.
         if (v.getValue()->getAge() >= age_threshold &&
             v.getValue().refCount() < 2) {
-            v.reallocate();
-            defrag_count++;
+            if (isWorthMoving(v.getValue().get().get())) {
+                v.reallocate();
+                defrag_count++;
+            } else {
+                skipped_count++;
+            }
         } else {
             v.getValue()->incrementAge();
         }
@@ -67,7 +77,11 @@ bool DefragmentVisitor::visit(const HashTable::HashBucketLock& lh,
 
     if (sv_age_threshold) {
         if (v.getAge() >= sv_age_threshold.get()) {
-            defragmentStoredValue(v);
+            if (isWorthMoving(&v)) {
+                defragmentStoredValue(v);
+            } else {
+                skipped_count++;
+            }
         } else {
             v.incrementAge();
         }
@@ -84,6 +98,7 @@ void DefragmentVisitor::clearStats() {
     defrag_count = 0;
     visited_count = 0;
     sv_defrag_count = 0;
+    skipped_count = 0;
 }
 
 size_t DefragmentVisitor::getDefragCount() const {
@@ -98,6 +113,10 @@ size_t DefragmentVisitor::getStoredValueDefragCount() const {
     return sv_defrag_count;
 }
 
+size_t DefragmentVisitor::getSkippedCount() const {
+    return skipped_count;
+}
+
 void DefragmentVisitor::setCurrentVBucket(VBucket& vb) {
     currentVb = &vb;
 }
@@ -107,3 +126,18 @@ void DefragmentVisitor::defragmentStoredValue(StoredValue& v) const {
         sv_defrag_count++;
     }
 }
+
+bool DefragmentVisitor::isWorthMoving(const void* ptr) const {
+    allocator_utilization util;
+    if (!alloc_hooks || !alloc_hooks->get_allocation_utilization ||
+        !alloc_hooks->get_allocation_utilization(ptr, &util)) {
+        return true;
+    }
+    if (util.current_slab) {
+        return false;
+    }
+    // Is the slab less used than the average: (nregs - nfree) / nregs <
+    // (bin_nregs - bin_nfree) / bin_nregs
+    return (util.nregs - util.nfree) * util.bin_nregs <
+           (util.bin_nregs - util.bin_nfree) * util.nregs;
+}
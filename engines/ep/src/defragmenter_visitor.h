@@ -22,6 +22,8 @@
 #include "vb_visitors.h"
 #include "vbucket.h"
 
+#include <memcached/server_allocator_iface.h>
+
 /**
  * Defragmentation visitor - visit all objects in a VBucket, compress the
  * documents and defragment any which have reached the specified age.
@@ -46,6 +48,18 @@ public:
      */
     void setStoredValueAgeThreshold(uint8_t age);
 
+    /**
+     * Only move the (old enough) Blobs and StoredValues which the allocator
+     * reports are on a slab less used than the average slab of their size
+     * class. Moving the allocations of well used slabs costs CPU but
+     * releases no memory. Allocations the allocator can't report on are
+     * moved as before.
+     *
+     * @param hooks the allocator to query, nullptr to move everything old
+     *        enough
+     */
+    void setAllocatorHooks(ServerAllocatorIface* hooks);
+
     // Implementation of HashTableVisitor interface:
     virtual bool visit(const HashTable::HashBucketLock& lh,
                        StoredValue& v) override;
@@ -62,12 +76,24 @@ public:
     // Returns the number of StoredValues that have been defragmented.
     size_t getStoredValueDefragCount() const;
 
+    // Returns the number of old enough Blobs and StoredValues which were
+    // not moved, as their slab is well used.
+    size_t getSkippedCount() const;
+
     void setCurrentVBucket(VBucket& vb) override;
 
 private:
     /// Request to reallocate the StoredValue
     void defragmentStoredValue(StoredValue& v) const;
 
+    /**
+     * Should the given allocation be moved? True unless the allocator
+     * reports that its slab is at least as used as the average slab of its
+     * size class, or is the slab new allocations are made from (which is
+     * where it would be moved to).
+     */
+    bool isWorthMoving(const void* ptr) const;
+
     /* Configuration parameters */
 
     // Size of the largest size class from the allocator.
@@ -88,10 +114,16 @@ private:
     size_t visited_count;
     // How many stored-values have been defrag'd
     mutable size_t sv_defrag_count{0};
+    // How many blobs and stored-values were not moved as their slab is well
+    // used
+    mutable size_t skipped_count{0};
 
     // The current vbucket that is being processed
     VBucket* currentVb;
 
     // If defined, the age at which StoredValue's are de-fragmented
     boost::optional<uint8_t> sv_age_threshold;
+
+    // If set, the allocator asked which allocations are worth moving
+    ServerAllocatorIface* alloc_hooks{nullptr};
 };
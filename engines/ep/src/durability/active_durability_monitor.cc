@@ -94,9 +94,7 @@ void ActiveDurabilityMonitor::setReplicationTopology(
         toCommit = s->updateHighPreparedSeqno();
     }
 
-    for (const auto& sw : toCommit) {
-        commit(sw);
-    }
+    commit(toCommit);
 }
 
 int64_t ActiveDurabilityMonitor::getHighPreparedSeqno() const {
@@ -121,8 +119,8 @@ bool ActiveDurabilityMonitor::isDurabilityPossible() const {
            (!s->secondChain || s->secondChain->isDurabilityPossible());
 }
 
-void ActiveDurabilityMonitor::addSyncWrite(const void* cookie,
-                                           queued_item item) {
+boost::optional<std::chrono::steady_clock::time_point>
+ActiveDurabilityMonitor::addSyncWrite(const void* cookie, queued_item item) {
     auto durReq = item->getDurabilityReqs();
 
     if (durReq.getLevel() == cb::durability::Level::None) {
@@ -139,7 +137,9 @@ void ActiveDurabilityMonitor::addSyncWrite(const void* cookie,
                 "ActiveDurabilityMonitor::addSyncWrite: Impossible");
     }
 
-    state.wlock()->addSyncWrite(cookie, std::move(item));
+    auto s = state.wlock();
+    s->addSyncWrite(cookie, std::move(item));
+    return s->trackedWrites.back().getExpiryTime();
 }
 
 ENGINE_ERROR_CODE ActiveDurabilityMonitor::seqnoAckReceived(
@@ -175,14 +175,13 @@ ENGINE_ERROR_CODE ActiveDurabilityMonitor::seqnoAckReceived(
     state.wlock()->processSeqnoAck(replica, preparedSeqno, toCommit);
 
     // Commit the verified SyncWrites
-    for (const auto& sw : toCommit) {
-        commit(sw);
-    }
+    commit(toCommit);
 
     return ENGINE_SUCCESS;
 }
 
-void ActiveDurabilityMonitor::processTimeout(
+boost::optional<std::chrono::steady_clock::time_point>
+ActiveDurabilityMonitor::processTimeout(
         std::chrono::steady_clock::time_point asOf) {
     // @todo: Add support for DurabilityMonitor at Replica
     if (vb.getState() != vbucket_state_active) {
@@ -192,11 +191,19 @@ void ActiveDurabilityMonitor::processTimeout(
     }
 
     Container toAbort;
-    state.wlock()->removeExpired(asOf, toAbort);
+    const auto earliestExpiry = state.wlock()->removeExpired(asOf, toAbort);
 
     for (const auto& entry : toAbort) {
         abort(entry);
     }
+    recycle(toAbort);
+
+    return earliestExpiry;
+}
+
+boost::optional<std::chrono::steady_clock::time_point>
+ActiveDurabilityMonitor::getEarliestExpiry() const {
+    return state.rlock()->getEarliestExpiry();
 }
 
 void ActiveDurabilityMonitor::notifyLocalPersistence() {
@@ -205,9 +212,7 @@ void ActiveDurabilityMonitor::notifyLocalPersistence() {
     // at seqnoAckReceived(), details in there).
     Container toCommit = state.wlock()->updateHighPreparedSeqno();
 
-    for (const auto& sw : toCommit) {
-        commit(sw);
-    }
+    commit(toCommit);
 }
 
 void ActiveDurabilityMonitor::addStats(const AddStatFn& addStat,
@@ -540,28 +545,37 @@ ActiveDurabilityMonitor::State::removeSyncWrite(Container::iterator it) {
     return removed;
 }
 
-void ActiveDurabilityMonitor::commit(const SyncWrite& sw) {
-    const auto& key = sw.getKey();
-    auto result = vb.commit(key,
-                            {} /*commitSeqno*/,
-                            vb.lockCollections(key),
-                            sw.getCookie());
-    if (result != ENGINE_SUCCESS) {
-        throw std::logic_error(
-                "ActiveDurabilityMonitor::commit: VBucket::commit failed with "
-                "status:" +
-                std::to_string(result));
+void ActiveDurabilityMonitor::commit(Container& toCommit) {
+    if (toCommit.empty()) {
+        return;
     }
-    {
-        auto s = state.wlock();
-        s->lastCommittedSeqno = sw.getBySeqno();
-        // Note:
-        // - Level Majority locally-satisfied first at Active by-logic
-        // - Level MajorityAndPersistOnMaster and PersistToMajority must always
-        //     include the Active for being globally satisfied
-        const auto hps = s->getNodeWriteSeqno(s->getActive());
-        Ensures(s->lastCommittedSeqno <= hps);
+
+    VBNotifyCtx notifyCtx;
+    for (const auto& sw : toCommit) {
+        const auto& key = sw.getKey();
+        auto result = vb.commit(key,
+                                {} /*commitSeqno*/,
+                                vb.lockCollections(key),
+                                sw.getCookie(),
+                                &notifyCtx);
+        if (result != ENGINE_SUCCESS) {
+            throw std::logic_error(
+                    "ActiveDurabilityMonitor::commit: VBucket::commit failed "
+                    "with status:" +
+                    std::to_string(result));
+        }
     }
+    vb.notifyBatch(notifyCtx);
+
+    auto s = state.wlock();
+    s->lastCommittedSeqno = toCommit.back().getBySeqno();
+    // Note:
+    // - Level Majority locally-satisfied first at Active by-logic
+    // - Level MajorityAndPersistOnMaster and PersistToMajority must always
+    //     include the Active for being globally satisfied
+    const auto hps = s->getNodeWriteSeqno(s->getActive());
+    Ensures(s->lastCommittedSeqno <= hps);
+    s->spareWrites.recycle(toCommit);
 }
 
 void ActiveDurabilityMonitor::abort(const SyncWrite& sw) {
@@ -579,6 +593,12 @@ void ActiveDurabilityMonitor::abort(const SyncWrite& sw) {
     state.wlock()->lastAbortedSeqno = sw.getBySeqno();
 }
 
+void ActiveDurabilityMonitor::recycle(Container& completed) {
+    if (!completed.empty()) {
+        state.wlock()->spareWrites.recycle(completed);
+    }
+}
+
 std::vector<const void*>
 ActiveDurabilityMonitor::getCookiesForInFlightSyncWrites() {
     auto s = state.wlock();
@@ -640,7 +660,9 @@ size_t ActiveDurabilityMonitor::wipeTracked() {
     while (it != s->trackedWrites.end()) {
         // Note: 'it' will be invalidated, so it will need to be reset
         const auto next = std::next(it);
-        removed += s->removeSyncWrite(it).size();
+        auto wiped = s->removeSyncWrite(it);
+        removed += wiped.size();
+        s->spareWrites.recycle(wiped);
         it = next;
     }
     return removed;
@@ -741,16 +763,19 @@ void ActiveDurabilityMonitor::State::addSyncWrite(const void* cookie,
                                                   queued_item item) {
     Expects(firstChain.get());
     const auto seqno = item->getBySeqno();
-    trackedWrites.emplace_back(cookie,
-                               std::move(item),
-                               defaultTimeout,
-                               firstChain.get(),
-                               secondChain.get());
+    spareWrites.emplaceBack(trackedWrites,
+                            cookie,
+                            std::move(item),
+                            defaultTimeout,
+                            firstChain.get(),
+                            secondChain.get());
     lastTrackedSeqno = seqno;
 }
 
-void ActiveDurabilityMonitor::State::removeExpired(
+boost::optional<std::chrono::steady_clock::time_point>
+ActiveDurabilityMonitor::State::removeExpired(
         std::chrono::steady_clock::time_point asOf, Container& expired) {
+    boost::optional<std::chrono::steady_clock::time_point> earliest;
     Container::iterator it = trackedWrites.begin();
     while (it != trackedWrites.end()) {
         if (it->isExpired(asOf)) {
@@ -762,9 +787,26 @@ void ActiveDurabilityMonitor::State::removeExpired(
 
             it = next;
         } else {
+            const auto expiry = it->getExpiryTime();
+            if (expiry && (!earliest || *expiry < *earliest)) {
+                earliest = expiry;
+            }
             ++it;
         }
     }
+    return earliest;
+}
+
+boost::optional<std::chrono::steady_clock::time_point>
+ActiveDurabilityMonitor::State::getEarliestExpiry() const {
+    boost::optional<std::chrono::steady_clock::time_point> earliest;
+    for (const auto& write : trackedWrites) {
+        const auto expiry = write.getExpiryTime();
+        if (expiry && (!earliest || *expiry < *earliest)) {
+            earliest = expiry;
+        }
+    }
+    return earliest;
 }
 
 DurabilityMonitor::Container
@@ -835,7 +877,5 @@ void ActiveDurabilityMonitor::checkForCommit() {
     // @todo: Consider to commit in a dedicated function for minimizing
     //     contention on front-end threads, as this function is supposed to
     //     execute under VBucket-level lock.
-    for (const auto& sw : toCommit) {
-        commit(sw);
-    }
+    commit(toCommit);
 }
@@ -99,9 +99,11 @@ public:
      * @param cookie Optional client cookie which will be notified the SyncWrite
      *        completes.
      * @param item the queued_item
+     * @return the time the SyncWrite expires at (none if it never does)
      * @throw std::logic_error if the replication-chain is not set
      */
-    void addSyncWrite(const void* cookie, queued_item item);
+    boost::optional<std::chrono::steady_clock::time_point> addSyncWrite(
+            const void* cookie, queued_item item);
 
     /**
      * Expected to be called by memcached at receiving a DCP_SEQNO_ACK packet.
@@ -118,9 +120,19 @@ public:
      * Enforce timeout for the expired SyncWrites in the tracked list.
      *
      * @param asOf The time to be compared with tracked-SWs' expiry-time
+     * @return the earliest expiry-time of the SyncWrites still tracked, none
+     *         if none of them expires
      * @throw std::logic_error
      */
-    void processTimeout(std::chrono::steady_clock::time_point asOf);
+    boost::optional<std::chrono::steady_clock::time_point> processTimeout(
+            std::chrono::steady_clock::time_point asOf);
+
+    /**
+     * @return the earliest expiry-time of the tracked SyncWrites, none if
+     *         none of them expires
+     */
+    boost::optional<std::chrono::steady_clock::time_point> getEarliestExpiry()
+            const;
 
     /**
      * Get the cookies for all in-flight SyncWrites
@@ -199,11 +211,14 @@ protected:
     void toOStream(std::ostream& os) const override;
 
     /**
-     * Commit the given SyncWrite.
+     * Commit the given SyncWrites (in seqno order) as one batch: one new
+     * seqno notification for all of them and one update of the state (the
+     * last committed seqno and the recycling of the completed SyncWrites).
+     * Each SyncWrite's client is still notified as its commit is done.
      *
-     * @param sw The SyncWrite to commit
+     * @param toCommit The SyncWrites to commit, emptied on return
      */
-    void commit(const SyncWrite& sw);
+    void commit(Container& toCommit);
 
     /**
      * Abort the given SyncWrite.
@@ -212,6 +227,12 @@ protected:
      */
     void abort(const SyncWrite& sw);
 
+    /**
+     * Keep the Container nodes of the given completed (committed or aborted)
+     * SyncWrites for reuse.
+     */
+    void recycle(Container& completed);
+
     /**
      * Test only (for now; shortly this will be probably needed at rollback).
      * Removes all SyncWrites from the tracked container. Replication chain
@@ -331,9 +352,15 @@ protected:
          *
          * @param asOf The time to be compared with tracked-SWs' expiry-time
          * @param [out] the list of the expired Prepares
+         * @return the earliest expiry-time of the Prepares left, none if none
+         *         of them expires
          */
-        void removeExpired(std::chrono::steady_clock::time_point asOf,
-                           Container& expired);
+        boost::optional<std::chrono::steady_clock::time_point> removeExpired(
+                std::chrono::steady_clock::time_point asOf, Container& expired);
+
+        /// @return the earliest expiry-time of the tracked Prepares
+        boost::optional<std::chrono::steady_clock::time_point>
+        getEarliestExpiry() const;
 
         const std::string& getActive() const;
 
@@ -399,6 +426,9 @@ protected:
         /// The container of pending Prepares.
         Container trackedWrites;
 
+        /// The nodes of completed Prepares, reused for new ones
+        SpareWrites spareWrites;
+
         /**
          * @TODO Soon firstChain will be optional for warmup - update comment
          * Our replication topology. firstChain is a requirement, secondChain is
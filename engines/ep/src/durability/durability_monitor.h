@@ -60,6 +60,7 @@ public:
 
 protected:
     class SyncWrite;
+    class SpareWrites;
     struct ReplicationChain;
     struct Position;
 
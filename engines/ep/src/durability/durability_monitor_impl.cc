@@ -40,21 +40,41 @@ DurabilityMonitor::SyncWrite::SyncWrite(
         queued_item item,
         std::chrono::milliseconds defaultTimeout,
         const ReplicationChain* firstChain,
-        const ReplicationChain* secondChain)
-    : cookie(cookie),
-      item(item),
-      expiryTime(expiryFromDurabiltyReqs(item->getDurabilityReqs(),
-                                         defaultTimeout)) {
+        const ReplicationChain* secondChain) {
+    reset(cookie, std::move(item), defaultTimeout, firstChain, secondChain);
+}
+
+void DurabilityMonitor::SyncWrite::reset(const void* cookie,
+                                         queued_item item,
+                                         std::chrono::milliseconds defaultTimeout,
+                                         const ReplicationChain* firstChain,
+                                         const ReplicationChain* secondChain) {
     // We should always have a first chain if we have a second
     if (secondChain) {
         Expects(firstChain);
     }
 
+    this->cookie = cookie;
+    this->item = std::move(item);
+    expiryTime = expiryFromDurabiltyReqs(this->item->getDurabilityReqs(),
+                                         defaultTimeout);
+
     if (firstChain) {
         resetTopology(*firstChain, secondChain);
+    } else {
+        this->firstChain.reset(nullptr);
+        this->secondChain.reset(nullptr);
     }
 }
 
+void DurabilityMonitor::SyncWrite::release() {
+    cookie = nullptr;
+    item.reset();
+    expiryTime.reset();
+    firstChain.reset(nullptr);
+    secondChain.reset(nullptr);
+}
+
 const StoredDocKey& DurabilityMonitor::SyncWrite::getKey() const {
     return item->getKey();
 }
@@ -167,6 +187,49 @@ void DurabilityMonitor::SyncWrite::resetTopology(
     }
 }
 
+void DurabilityMonitor::SpareWrites::emplaceBack(
+        Container& trackedWrites,
+        const void* cookie,
+        queued_item item,
+        std::chrono::milliseconds defaultTimeout,
+        const ReplicationChain* firstChain,
+        const ReplicationChain* secondChain) {
+    if (spare.empty()) {
+        trackedWrites.emplace_back(cookie,
+                                   std::move(item),
+                                   defaultTimeout,
+                                   firstChain,
+                                   secondChain);
+        return;
+    }
+    spare.front().reset(cookie,
+                        std::move(item),
+                        defaultTimeout,
+                        firstChain,
+                        secondChain);
+    trackedWrites.splice(trackedWrites.end(), spare, spare.begin());
+}
+
+void DurabilityMonitor::SpareWrites::recycle(Container& completed) {
+    recycle(completed, completed.begin(), completed.end());
+}
+
+void DurabilityMonitor::SpareWrites::recycle(Container& trackedWrites,
+                                             Container::iterator first,
+                                             Container::iterator last) {
+    auto keepEnd = first;
+    size_t kept = 0;
+    for (auto it = first; it != last; ++it) {
+        it->release();
+        if (spare.size() + kept < MaxSize) {
+            ++keepEnd;
+            ++kept;
+        }
+    }
+    spare.splice(spare.end(), trackedWrites, first, keepEnd);
+    trackedWrites.erase(keepEnd, last);
+}
+
 std::ostream& operator<<(std::ostream& os,
                          const DurabilityMonitor::SyncWrite& sw) {
     os << "SW @" << &sw << " "
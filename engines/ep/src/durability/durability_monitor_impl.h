@@ -57,6 +57,23 @@ public:
               const ReplicationChain* firstChain,
               const ReplicationChain* secondChain);
 
+    /**
+     * Re-initialise this SyncWrite for another Prepare, as if just
+     * constructed with the given arguments. Used for reusing the Container
+     * node of a completed SyncWrite (see SpareWrites).
+     */
+    void reset(const void* cookie,
+               queued_item item,
+               std::chrono::milliseconds defaultTimeout,
+               const ReplicationChain* firstChain,
+               const ReplicationChain* secondChain);
+
+    /**
+     * Release the Prepare, the cookie and the chains of a completed
+     * SyncWrite, which may then only be reset().
+     */
+    void release();
+
     const StoredDocKey& getKey() const;
 
     int64_t getBySeqno() const;
@@ -86,6 +103,12 @@ public:
      */
     bool isExpired(std::chrono::steady_clock::time_point asOf) const;
 
+    /// @return the time this SyncWrite expires at, none if it never does
+    boost::optional<std::chrono::steady_clock::time_point> getExpiryTime()
+            const {
+        return expiryTime;
+    }
+
     /**
      * Reset the ack-state for this SyncWrite and set it up for the new
      * given topology.
@@ -99,14 +122,15 @@ public:
 private:
     // Client cookie associated with this SyncWrite request, to be notified
     // when the SyncWrite completes.
-    const void* cookie;
+    const void* cookie = nullptr;
 
     // An Item stores all the info that the DurabilityMonitor needs:
     // - seqno
     // - Durability Requirements
     // Note that queued_item is a ref-counted object, so the copy in the
     // CheckpointManager can be safely removed.
-    const queued_item item;
+    // Not const (as the other members set at construction) only for reset().
+    queued_item item;
 
     /**
      * Holds all the information required for a SyncWrite to determine if it
@@ -138,11 +162,57 @@ private:
 
     // Used for enforcing the Durability Requirements Timeout. It is set
     // when this SyncWrite is added for tracking into the DurabilityMonitor.
-    const boost::optional<std::chrono::steady_clock::time_point> expiryTime;
+    boost::optional<std::chrono::steady_clock::time_point> expiryTime;
 
     friend std::ostream& operator<<(std::ostream&, const SyncWrite&);
 };
 
+/**
+ * The Container nodes of completed SyncWrites, kept for tracking new
+ * SyncWrites without allocating: nodes are moved between Containers by
+ * std::list::splice, which neither allocates nor invalidates iterators.
+ * At most MaxSize nodes are kept, so the memory held is bounded by the
+ * SyncWrites recently in-flight at once.
+ *
+ * Not thread safe, it lives in the (locked) state of a DurabilityMonitor.
+ */
+class DurabilityMonitor::SpareWrites {
+public:
+    static const size_t MaxSize = 1024;
+
+    /**
+     * Append a SyncWrite to trackedWrites, in a spare node if there is one.
+     * The arguments are those of the SyncWrite ctor.
+     */
+    void emplaceBack(Container& trackedWrites,
+                     const void* cookie,
+                     queued_item item,
+                     std::chrono::milliseconds defaultTimeout,
+                     const ReplicationChain* firstChain,
+                     const ReplicationChain* secondChain);
+
+    /**
+     * Keep the nodes of the given completed SyncWrites (which are released)
+     * for reuse, up to MaxSize. Leaves completed empty.
+     */
+    void recycle(Container& completed);
+
+    /**
+     * As recycle(Container&), for the SyncWrites [first, last) of
+     * trackedWrites.
+     */
+    void recycle(Container& trackedWrites,
+                 Container::iterator first,
+                 Container::iterator last);
+
+    size_t size() const {
+        return spare.size();
+    }
+
+private:
+    Container spare;
+};
+
 /**
  * Represents a VBucket Replication Chain in the ns_server meaning,
  * i.e. a list of active/replica nodes where the VBucket resides.
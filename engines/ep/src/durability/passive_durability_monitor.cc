@@ -101,11 +101,13 @@ void PassiveDurabilityMonitor::addSyncWrite(queued_item item) {
     // checked just above the requirements have a non-default value,
     // just pass dummy value here.
     std::chrono::milliseconds dummy{};
-    state.wlock()->trackedWrites.emplace_back(nullptr /*cookie*/,
-                                              std::move(item),
-                                              dummy,
-                                              nullptr /*firstChain*/,
-                                              nullptr /*secondChain*/);
+    auto s = state.wlock();
+    s->spareWrites.emplaceBack(s->trackedWrites,
+                               nullptr /*cookie*/,
+                               std::move(item),
+                               dummy,
+                               nullptr /*firstChain*/,
+                               nullptr /*secondChain*/);
 }
 
 size_t PassiveDurabilityMonitor::getNumTracked() const {
@@ -332,10 +334,9 @@ void PassiveDurabilityMonitor::State::checkForAndRemovePrepares() {
         if (it == highPreparedSeqno.it) {
             highPreparedSeqno.it = trackedWrites.end();
         }
-
-        // Note: 'it' will be invalidated, so it will need to be reset
-        const auto next = std::next(it);
-        trackedWrites.erase(it);
-        it = next;
+        ++it;
     }
+
+    // Remove the whole (contiguous) prefix of Prepares in one go
+    spareWrites.recycle(trackedWrites, trackedWrites.begin(), it);
 }
@@ -17,6 +17,7 @@
 #pragma once
 
 #include "durability_monitor.h"
+#include "durability_monitor_impl.h"
 #include "item.h"
 
 #include <folly/Synchronized.h>
@@ -164,6 +165,9 @@ protected:
         /// The container of pending Prepares.
         Container trackedWrites;
 
+        /// The nodes of removed Prepares, reused for new ones
+        SpareWrites spareWrites;
+
         // The seqno of the last Prepare satisfied locally. I.e.:
         //     - the Prepare has been queued into the PDM, if Level Majority
         //         or MajorityAndPersistToMaster
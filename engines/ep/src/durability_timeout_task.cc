@@ -17,6 +17,7 @@
 
 #include "durability_timeout_task.h"
 #include "ep_engine.h"
+#include "executorpool.h"
 #include "kv_bucket.h"
 
 #include <phosphor/phosphor.h>
@@ -27,30 +28,80 @@ DurabilityTimeoutTask::DurabilityTimeoutTask(EventuallyPersistentEngine& engine,
                  TaskId::DurabilityTimeoutTask,
                  0 /*initial sleep-time in seconds*/,
                  false /*completeBeforeShutdown*/),
-      sleepTime(interval) {
+      sleepTime(interval),
+      registered(engine.getConfiguration().getMaxVbuckets()),
+      wakeTime(Clock::now()) {
+    for (auto& deadline : registered) {
+        deadline.store(Clock::duration::max().count());
+    }
 }
 
 bool DurabilityTimeoutTask::run() {
     TRACE_EVENT0("ep-engine/task", "DurabilityTimeoutTask");
 
-    // @todo: A meaningful value will be the P99.99
-    const auto maxExpectedDurationForVisitorTask =
-            std::chrono::milliseconds(100);
-
+    const auto now = Clock::now();
     auto& kvBucket = *engine->getKVBucket();
-    kvBucket.visitAsync(std::make_unique<DurabilityTimeoutVisitor>(),
-                        "DurabilityTimeoutVisitor",
-                        TaskId::DurabilityTimeoutVisitor,
-                        maxExpectedDurationForVisitorTask);
+    for (const auto vbid : popDue(now)) {
+        auto vb = kvBucket.getVBucket(vbid);
+        if (!vb) {
+            continue;
+        }
+        const auto next = vb->processDurabilityTimeout(now);
+        if (next) {
+            addDeadline(vbid, *next);
+        }
+    }
 
-    // Note: Default unit for std::duration is seconds, so the following gives
-    // the seconds-representation (as double) of the given millis (sleepTime)
-    snooze(std::chrono::duration<double>(sleepTime).count());
+    std::lock_guard<std::mutex> lh(mutex);
+    snoozeUntilNextDeadline(Clock::now());
 
     // Schedule again
     return true;
 }
 
-void DurabilityTimeoutVisitor::visitBucket(const VBucketPtr& vb) {
-    vb->processDurabilityTimeout(startTime);
+void DurabilityTimeoutTask::addDeadline(Vbid vbid, Clock::time_point deadline) {
+    auto& registeredDeadline = registered.at(vbid.get());
+    const auto time = deadline.time_since_epoch().count();
+    if (registeredDeadline.load() <= time) {
+        // The VBucket is processed by then already
+        return;
+    }
+
+    std::lock_guard<std::mutex> lh(mutex);
+    if (registeredDeadline.load() <= time) {
+        return;
+    }
+    registeredDeadline.store(time);
+    deadlines.push({deadline, vbid});
+    if (deadline < wakeTime) {
+        wakeTime = deadline;
+        ExecutorPool::get()->wake(getId());
+    }
+}
+
+std::vector<Vbid> DurabilityTimeoutTask::popDue(Clock::time_point asOf) {
+    std::vector<Vbid> due;
+    std::lock_guard<std::mutex> lh(mutex);
+    // Note: SyncWrites expire strictly after their expiry-time
+    while (!deadlines.empty() && deadlines.top().time < asOf) {
+        const auto deadline = deadlines.top();
+        deadlines.pop();
+        auto& registeredDeadline = registered[deadline.vbid.get()];
+        if (registeredDeadline.load() ==
+            deadline.time.time_since_epoch().count()) {
+            registeredDeadline.store(Clock::duration::max().count());
+            due.push_back(deadline.vbid);
+        }
+    }
+    return due;
+}
+
+void DurabilityTimeoutTask::snoozeUntilNextDeadline(Clock::time_point now) {
+    wakeTime = now + sleepTime;
+    if (!deadlines.empty() && deadlines.top().time < wakeTime) {
+        wakeTime = std::max(now, deadlines.top().time);
+    }
+    // Note: Default unit for std::duration is seconds, so the following gives
+    // the seconds-representation (as double) of the time to the next run
+    snooze(std::chrono::duration<double>(wakeTime - now).count());
 }
@@ -17,15 +17,28 @@
 #pragma once
 
 #include "globaltask.h"
-#include "vb_visitors.h"
+
+#include <memcached/vbucket.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <queue>
+#include <vector>
 
 /*
  * Enforces the Durability Timeout for the SyncWrites tracked in this KVBucket.
+ *
+ * Rather than visiting every VBucket periodically, the task keeps a
+ * min-heap of the deadlines VBuckets have SyncWrites timing out at (see
+ * addDeadline()), visits only the VBuckets whose deadline has passed, and
+ * sleeps until the next deadline.
  */
 class DurabilityTimeoutTask : public GlobalTask {
 public:
     /**
      * @param engine The engine that will be visited
+     * @param interval The longest time to sleep for between runs
      */
     DurabilityTimeoutTask(EventuallyPersistentEngine& engine,
                           std::chrono::milliseconds interval);
@@ -37,31 +50,53 @@ public:
     }
 
     std::chrono::microseconds maxExpectedDuration() override {
-        // This tasks just spawns a new VBCBAdaptor, which is the actual tasks
-        // that executes the DurabilityTimeoutVisitor. So, keeping the value
-        // relatively high as there is no too much value in logging this timing.
-        return std::chrono::seconds(1);
+        // Only the VBuckets with SyncWrites timing out are visited, and those
+        // are aborted in the task itself.
+        return std::chrono::milliseconds(100);
     }
 
+    /**
+     * Process the given VBucket no later than the deadline, which is the
+     * expiry-time of one of its SyncWrites. Only the earliest deadline of
+     * each VBucket is kept; the VBucket returns its next one when processed.
+     */
+    void addDeadline(Vbid vbid, std::chrono::steady_clock::time_point deadline);
+
 private:
-    // Note: this is the actual minimum interval between subsequent runs.
-    // The VBCBAdaptor (which is the actual task that executes this Visitor)
-    // has its internal sleep-time which is used for a different purpose,
-    // details in VBCBAdaptor.
-    std::chrono::milliseconds sleepTime;
-};
+    using Clock = std::chrono::steady_clock;
 
-/**
- * DurabilityTimeoutVisitor visits a VBucket for enforcing the Durability
- * Timeout for the SyncWrites tracked by VBucket.
- */
-class DurabilityTimeoutVisitor : public CappedDurationVBucketVisitor {
-public:
-    DurabilityTimeoutVisitor() : startTime(std::chrono::steady_clock::now()) {
-    }
+    struct Deadline {
+        bool operator>(const Deadline& other) const {
+            return time > other.time;
+        }
 
-    void visitBucket(const VBucketPtr& vb) override;
+        Clock::time_point time;
+        Vbid vbid;
+    };
 
-private:
-    const std::chrono::steady_clock::time_point startTime;
+    /// Remove (and return) the VBuckets whose deadline is before asOf
+    std::vector<Vbid> popDue(Clock::time_point asOf);
+
+    /// Snooze until the next deadline (at most sleepTime). Expects mutex held.
+    void snoozeUntilNextDeadline(Clock::time_point now);
+
+    // Note: this is the longest interval between subsequent runs, in case a
+    // deadline is missed (e.g. a SyncWrite tracked before the callback is
+    // set).
+    const std::chrono::milliseconds sleepTime;
+
+    /**
+     * The deadline registered per VBucket (Clock::duration::max() if none),
+     * read without the mutex to skip taking it for the deadlines which aren't
+     * earlier than the registered one (i.e. almost every SyncWrite).
+     */
+    std::vector<std::atomic<Clock::rep>> registered;
+
+    std::mutex mutex;
+    /// Deadlines (by VBucket), earliest first. Entries which don't match the
+    /// registered deadline of their VBucket are stale and skipped.
+    std::priority_queue<Deadline, std::vector<Deadline>, std::greater<Deadline>>
+            deadlines;
+    /// When the task is snoozed until
+    Clock::time_point wakeTime;
 };
@@ -28,6 +28,7 @@
 #include "ep_vb.h"
 #include "failover-table.h"
 #include "flusher.h"
+#include "hash_table_image.h"
 #include "item.h"
 #include "persistence_callback.h"
 #include "replicationthrottle.h"
@@ -39,6 +40,12 @@
 
 #include "dcp/dcpconnmap.h"
 
+#include <platform/timeutils.h>
+
+#include <algorithm>
+#include <climits>
+#include <unordered_map>
+
 /**
  * Callback class used by EpStore, for adding relevant keys
  * to bloomfilter during compaction.
@@ -196,6 +203,18 @@ public:
                                   size_t value) override {
         if (key == "flusher_batch_split_trigger") {
             bucket.setFlusherBatchSplitTrigger(value);
+        } else if (key == "flusher_group_commit_window") {
+            bucket.setFlusherGroupCommitWindow(
+                    std::chrono::milliseconds(value));
+        } else if (key == "flusher_target_commit_time") {
+            bucket.setFlusherBatchTargetCommitTime(
+                    std::chrono::milliseconds(value));
+        } else if (key == "bg_fetch_batch_delay_us") {
+            bucket.setBgFetchBatchDelay(std::chrono::microseconds(value));
+        } else if (key == "compaction_max_concurrent") {
+            bucket.setCompactionMaxConcurrent(value);
+        } else if (key == "compaction_max_write_rate") {
+            bucket.setCompactionMaxWriteRate(value);
         } else if (key == "alog_sleep_time") {
             bucket.setAccessScannerSleeptime(value, false);
         } else if (key == "alog_task_time") {
@@ -215,6 +234,8 @@ public:
             }
         } else if (key == "retain_erroneous_tombstones") {
             bucket.setRetainErroneousTombstones(value);
+        } else if (key == "flusher_vbstate_group_commit") {
+            bucket.setFlusherVBStateGroupCommit(value);
         } else  {
             EP_LOG_WARN("Failed to change value for unknown variable, {}", key);
         }
@@ -225,7 +246,7 @@ private:
 };
 
 EPBucket::EPBucket(EventuallyPersistentEngine& theEngine)
-    : KVBucket(theEngine) {
+    : KVBucket(theEngine), compactionThrottle(stats) {
     auto& config = engine.getConfiguration();
     const std::string& policy = config.getItemEvictionPolicy();
     if (policy.compare("value_only") == 0) {
@@ -243,11 +264,46 @@ EPBucket::EPBucket(EventuallyPersistentEngine& theEngine)
             "flusher_batch_split_trigger",
             std::make_unique<ValueChangedListener>(*this));
 
+    setFlusherBatchTargetCommitTime(std::chrono::milliseconds(
+            config.getFlusherTargetCommitTime()));
+    config.addValueChangedListener(
+            "flusher_target_commit_time",
+            std::make_unique<ValueChangedListener>(*this));
+
+    groupCommits.resize(vbMap.getNumShards());
+    setFlusherGroupCommitWindow(std::chrono::milliseconds(
+            config.getFlusherGroupCommitWindow()));
+    config.addValueChangedListener(
+            "flusher_group_commit_window",
+            std::make_unique<ValueChangedListener>(*this));
+
+    setFlusherVBStateGroupCommit(config.isFlusherVbstateGroupCommit());
+    config.addValueChangedListener(
+            "flusher_vbstate_group_commit",
+            std::make_unique<ValueChangedListener>(*this));
+
+    setBgFetchBatchDelay(
+            std::chrono::microseconds(config.getBgFetchBatchDelayUs()));
+    config.addValueChangedListener(
+            "bg_fetch_batch_delay_us",
+            std::make_unique<ValueChangedListener>(*this));
+
     retainErroneousTombstones = config.isRetainErroneousTombstones();
     config.addValueChangedListener(
            "retain_erroneous_tombstones",
            std::make_unique<ValueChangedListener>(*this));
 
+    setCompactionMaxConcurrent(config.getCompactionMaxConcurrent());
+    config.addValueChangedListener(
+            "compaction_max_concurrent",
+            std::make_unique<ValueChangedListener>(*this));
+
+    compactionThrottle.setWriteQueueCap(compactionWriteQueueCap);
+    setCompactionMaxWriteRate(config.getCompactionMaxWriteRate());
+    config.addValueChangedListener(
+            "compaction_max_write_rate",
+            std::make_unique<ValueChangedListener>(*this));
+
     initializeWarmupTask();
 }
 
@@ -269,6 +325,9 @@ bool EPBucket::initialize() {
     }
     startFlusher();
 
+    ExTask ioThreadTuner = std::make_shared<IOThreadTuner>(*this);
+    ExecutorPool::get()->schedule(ioThreadTuner);
+
     return true;
 }
 
@@ -277,9 +336,54 @@ void EPBucket::deinitialize() {
     stopBgFetcher();
 
     stopWarmup();
+
+    // On a clean shutdown everything has been flushed, so save the bloom
+    // filters and HashTable images for the next warmup
+    if (!stats.forceShutdown) {
+        for (auto vbid : vbMap.getBuckets()) {
+            auto vb = getVBucket(vbid);
+            if (vb) {
+                saveBloomFilter(*vb);
+                saveHashTableImage(*vb);
+            }
+        }
+    }
     KVBucket::deinitialize();
 }
 
+void EPBucket::saveBloomFilter(VBucket& vb) {
+    if (!engine.getConfiguration().isBfilterPersist()) {
+        return;
+    }
+
+    // Read the persisted seqno first; the filter then covers at least the
+    // keys persisted up to it
+    const auto persistedSeqno = vb.getPersistenceSeqno();
+    auto filter = vb.getFilterForPersistence();
+    if (filter) {
+        getRWUnderlying(vb.getId())
+                ->saveBloomFilter(vb.getId(), persistedSeqno, *filter);
+    }
+}
+
+void EPBucket::saveHashTableImage(VBucket& vb) {
+    if (!engine.getConfiguration().isWarmupHashtableImage()) {
+        return;
+    }
+
+    // The image only holds the clean items, which are all persisted by
+    // the seqno read first
+    const auto persistedSeqno = vb.getPersistenceSeqno();
+    HashTableImageWriter image;
+    vb.ht.visit(image);
+    if (getRWUnderlying(vb.getId())
+                ->saveHashTableImage(vb.getId(), persistedSeqno, image)) {
+        EP_LOG_INFO("EPBucket::saveHashTableImage: Saved {} items of {}",
+                    image.getNumItems(),
+                    vb.getId());
+    }
+}
+
 void EPBucket::reset() {
     KVBucket::reset();
 
@@ -338,13 +442,33 @@ std::pair<bool, size_t> EPBucket::flushVBucket(Vbid vbid) {
     if (vb) {
         // Obtain the set of items to flush, up to the maximum allowed for
         // a single flush.
-        auto toFlush = vb->getItemsToPersist(flusherBatchSplitTrigger);
+        PersistedState persisted(vb.getVB());
+        auto& batchSizer = shard->getFlusher()->getBatchSizer();
+        auto toFlush = vb->getItemsToPersist(
+                batchSizer.getBatchSize(flusherBatchSplitTrigger));
+        const auto fetch_end = std::chrono::steady_clock::now();
+        stats.flushFetchTime.fetch_add(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        fetch_end - flush_start)
+                        .count());
         auto& items = toFlush.items;
         auto& range = toFlush.range;
         moreAvailable = toFlush.moreAvailable;
 
         KVStore* rwUnderlying = getRWUnderlying(vb->getId());
 
+        auto& group = groupCommits[shard->getId()];
+        if (group.vbStateOnly &&
+            std::any_of(items.begin(), items.end(), [](const auto& item) {
+                return item->shouldPersist() &&
+                       item->getOperation() != queue_op::set_vbucket_state;
+            })) {
+            // Don't hold the items back behind the state snapshots; the
+            // flusher completes the group once we return (it can't be done
+            // here as it locks the other vBuckets of the group)
+            group.holdingItems = true;
+        }
+
         if (!items.empty()) {
             while (!rwUnderlying->begin(
                     std::make_unique<EPTransactionContext>(stats, *vb))) {
@@ -426,6 +550,10 @@ std::pair<bool, size_t> EPBucket::flushVBucket(Vbid vbid) {
                     vb->doStatsForFlushing(*item, item->size());
                 }
             }
+            stats.flushSetTime.fetch_add(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() - fetch_end)
+                            .count());
 
 
             {
@@ -461,6 +589,12 @@ std::pair<bool, size_t> EPBucket::flushVBucket(Vbid vbid) {
                 auto options = VBStatePersist::VBSTATE_CACHE_UPDATE_ONLY;
                 if ((items_flushed == 0) && mustCheckpointVBState) {
                     options = VBStatePersist::VBSTATE_PERSIST_WITH_COMMIT;
+                    // Many vBuckets change state together during a
+                    // takeover; sync their snapshots together
+                    if (!group.active && flusherVBStateGroupCommit &&
+                        beginGroupCommit(*shard)) {
+                        group.vbStateOnly = true;
+                    }
                 }
 
                 if (rwUnderlying->snapshotVBucket(vb->getId(), vbstate,
@@ -478,7 +612,14 @@ std::pair<bool, size_t> EPBucket::flushVBucket(Vbid vbid) {
              * of items to flush.
              */
             if (items_flushed > 0) {
+                const auto commit_start = std::chrono::steady_clock::now();
                 commit(*rwUnderlying, collectionFlush);
+                batchSizer.commitCompleted(
+                        items.size(),
+                        std::chrono::duration_cast<std::chrono::microseconds>(
+                                std::chrono::steady_clock::now() -
+                                commit_start),
+                        moreAvailable);
 
                 // Now the commit is complete, vBucket file must exist.
                 if (vb->setBucketCreation(false)) {
@@ -487,45 +628,10 @@ std::pair<bool, size_t> EPBucket::flushVBucket(Vbid vbid) {
             }
 
             if (vb->rejectQueue.empty()) {
-                vb->setPersistedSnapshot(range.getStart(), range.getEnd());
-                uint64_t highSeqno = rwUnderlying->getLastPersistedSeqno(vbid);
-                if (highSeqno > 0 && highSeqno != vb->getPersistenceSeqno()) {
-                    vb->setPersistenceSeqno(highSeqno);
-                }
-
-                // Notify the local DM that the Flusher has run. Persistence
-                // could unblock some pending Prepares in the DM.
-                // If it is the case, this call updates the High Prepared Seqno
-                // for this node.
-                // In the case of a Replica node, that could trigger a SeqnoAck
-                // to the Active.
-                //
-                // Note: This is a NOP if the there's no Prepare queued in DM.
-                //     We could notify the DM only if strictly required (i.e.,
-                //     only when the Flusher has persisted up to the snap-end
-                //     mutation of an in-memory snapshot, see HPS comments in
-                //     PassiveDM for details), but that requires further work.
-                //     The main problem is that in general a flush-batch does
-                //     not coincide with in-memory snapshots (ie, we don't
-                //     persist at snapshot boundaries). So, the Flusher could
-                //     split a single in-memory snapshot into multiple
-                //     flush-batches. That may happen at Replica, e.g.:
-                //
-                //     1) received snap-marker [1, 2]
-                //     2) received 1:PRE
-                //     3) flush-batch {1:PRE}
-                //     4) received 2:mutation
-                //     5) flush-batch {2:mutation}
-                //
-                //     In theory we need to notify the DM only at step (5) and
-                //     only if the the snapshot contains at least 1 Prepare
-                //     (which is the case in our example), but the problem is
-                //     that the Flusher doesn't know about 1:PRE at step (5).
-                //
-                //     So, given that here we are executing in a slow bg-thread
-                //     (write+sync to disk), then we can just afford to calling
-                //     back to the DM unconditionally.
-                vb->notifyPersistenceToDurabilityMonitor();
+                persisted.committed = true;
+                persisted.range = range;
+                persisted.highSeqno =
+                        rwUnderlying->getLastPersistedSeqno(vbid);
             }
 
             auto flush_end = std::chrono::steady_clock::now();
@@ -541,26 +647,25 @@ std::pair<bool, size_t> EPBucket::flushVBucket(Vbid vbid) {
             stats.flusher_todo.store(0);
             stats.totalPersistVBState++;
 
-            collectionFlush.checkAndTriggerPurge(vb->getId(), *this);
+            collectionFlush.checkAndTriggerPurge(*vb, *this);
         }
 
         rwUnderlying->pendingTasks();
 
         if (vb->checkpointManager->hasClosedCheckpointWhichCanBeRemoved()) {
-            wakeUpCheckpointRemover();
+            scheduleCheckpointRemoval(vb->getId());
         }
 
         if (vb->rejectQueue.empty()) {
             vb->checkpointManager->itemsPersisted();
-            uint64_t seqno = vb->getPersistenceSeqno();
-            uint64_t chkid =
+            persisted.checkpointId =
                     vb->checkpointManager->getPersistenceCursorPreChkId();
-            vb->notifyHighPriorityRequests(
-                    engine, seqno, HighPriorityVBNotify::Seqno);
-            vb->notifyHighPriorityRequests(
-                    engine, chkid, HighPriorityVBNotify::ChkPersistence);
-            if (chkid > 0 && chkid != vb->getPersistenceCheckpointId()) {
-                vb->setPersistenceCheckpointId(chkid);
+
+            if (group.active) {
+                // Not durable until the group is synced
+                group.pending.push_back(std::move(persisted));
+            } else {
+                publishPersistedState(*vb, persisted);
             }
         } else {
             return {true, items_flushed};
@@ -570,10 +675,128 @@ std::pair<bool, size_t> EPBucket::flushVBucket(Vbid vbid) {
     return {moreAvailable, items_flushed};
 }
 
+void EPBucket::publishPersistedState(VBucket& vb,
+                                     const PersistedState& state) {
+    if (state.committed) {
+        vb.setPersistedSnapshot(state.range.getStart(), state.range.getEnd());
+        if (state.highSeqno > 0 &&
+            state.highSeqno != vb.getPersistenceSeqno()) {
+            vb.setPersistenceSeqno(state.highSeqno);
+        }
+
+        // Notify the local DM that the Flusher has run. Persistence
+        // could unblock some pending Prepares in the DM.
+        // If it is the case, this call updates the High Prepared Seqno
+        // for this node.
+        // In the case of a Replica node, that could trigger a SeqnoAck
+        // to the Active.
+        //
+        // Note: This is a NOP if the there's no Prepare queued in DM.
+        //     We could notify the DM only if strictly required (i.e.,
+        //     only when the Flusher has persisted up to the snap-end
+        //     mutation of an in-memory snapshot, see HPS comments in
+        //     PassiveDM for details), but that requires further work.
+        //     The main problem is that in general a flush-batch does
+        //     not coincide with in-memory snapshots (ie, we don't
+        //     persist at snapshot boundaries). So, the Flusher could
+        //     split a single in-memory snapshot into multiple
+        //     flush-batches. That may happen at Replica, e.g.:
+        //
+        //     1) received snap-marker [1, 2]
+        //     2) received 1:PRE
+        //     3) flush-batch {1:PRE}
+        //     4) received 2:mutation
+        //     5) flush-batch {2:mutation}
+        //
+        //     In theory we need to notify the DM only at step (5) and
+        //     only if the the snapshot contains at least 1 Prepare
+        //     (which is the case in our example), but the problem is
+        //     that the Flusher doesn't know about 1:PRE at step (5).
+        //
+        //     So, given that here we are executing in a slow bg-thread
+        //     (write+sync to disk), then we can just afford to calling
+        //     back to the DM unconditionally.
+        vb.notifyPersistenceToDurabilityMonitor();
+    }
+
+    vb.notifyHighPriorityRequests(
+            engine, vb.getPersistenceSeqno(), HighPriorityVBNotify::Seqno);
+    vb.notifyHighPriorityRequests(engine,
+                                  state.checkpointId,
+                                  HighPriorityVBNotify::ChkPersistence);
+    if (state.checkpointId > 0 &&
+        state.checkpointId != vb.getPersistenceCheckpointId()) {
+        vb.setPersistenceCheckpointId(state.checkpointId);
+    }
+}
+
+bool EPBucket::beginGroupCommit(KVShard& shard) {
+    if (!shard.getRWUnderlying()->setGroupCommit(true)) {
+        return false;
+    }
+    auto& group = groupCommits[shard.getId()];
+    group.active = true;
+    group.vbStateOnly = false;
+    group.holdingItems = false;
+    return true;
+}
+
+void EPBucket::completeGroupCommit(KVShard& shard) {
+    auto& group = groupCommits[shard.getId()];
+    auto* rwUnderlying = shard.getRWUnderlying();
+    while (!rwUnderlying->syncPendingCommits()) {
+        ++stats.commitFailed;
+        EP_LOG_WARN(
+                "EPBucket::completeGroupCommit: syncPendingCommits failed!!! "
+                "Retry in 1 sec...");
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+    rwUnderlying->setGroupCommit(false);
+    group.active = false;
+    group.vbStateOnly = false;
+    group.holdingItems = false;
+
+    for (const auto& state : group.pending) {
+        auto vb = getLockedVBucket(state.vb->getId());
+        // Skip the vBucket if it has been deleted (or recreated) since
+        if (vb.getVB() == state.vb) {
+            publishPersistedState(*vb, state);
+        }
+    }
+    group.pending.clear();
+}
+
+void EPBucket::completeVBStateGroupCommit(KVShard& shard,
+                                          bool onlyIfHoldingItems) {
+    const auto& group = groupCommits[shard.getId()];
+    if (group.vbStateOnly && (!onlyIfHoldingItems || group.holdingItems)) {
+        completeGroupCommit(shard);
+    }
+}
+
+void EPBucket::setFlusherGroupCommitWindow(std::chrono::milliseconds window) {
+    for (const auto& shard : vbMap.shards) {
+        shard->getFlusher()->setGroupCommitWindow(window);
+    }
+}
+
 void EPBucket::setFlusherBatchSplitTrigger(size_t limit) {
     flusherBatchSplitTrigger = limit;
 }
 
+void EPBucket::setFlusherBatchTargetCommitTime(
+        std::chrono::milliseconds target) {
+    for (const auto& shard : vbMap.shards) {
+        shard->getFlusher()->getBatchSizer().setTargetCommitTime(target);
+    }
+}
+
+void EPBucket::setBgFetchBatchDelay(std::chrono::microseconds delay) {
+    for (const auto& shard : vbMap.shards) {
+        shard->getBgFetcher()->setBatchDelay(delay);
+    }
+}
+
 void EPBucket::commit(KVStore& kvstore,
                       Collections::VB::Flush& collectionsFlush) {
     BlockTimer timer(&stats.diskCommitHisto, "disk_commit", stats.timingLog);
@@ -593,6 +816,10 @@ void EPBucket::commit(KVStore& kvstore,
                                .count();
     stats.commit_time.store(commit_time);
     stats.cumulativeCommitTime.fetch_add(commit_time);
+    stats.flushCommitTime.fetch_add(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    commit_end - commit_start)
+                    .count());
 }
 
 void EPBucket::startFlusher() {
@@ -725,6 +952,39 @@ ENGINE_ERROR_CODE EPBucket::scheduleCompaction(Vbid vbid,
     return ENGINE_EWOULDBLOCK;
 }
 
+void EPBucket::setCompactionMaxConcurrent(size_t max) {
+    compactionMaxConcurrent = max;
+    // Let the snoozed compactions run if the limit was raised
+    LockHolder lh(compactionLock);
+    for (const auto& task : compactionTasks) {
+        if (task.second->getState() == TASK_SNOOZED) {
+            ExecutorPool::get()->wake(task.second->getId());
+        }
+    }
+}
+
+void EPBucket::setCompactionMaxWriteRate(size_t bytesPerSec) {
+    compactionThrottle.setMaxRate(bytesPerSec);
+}
+
+void EPBucket::setCompactionWriteQueueCap(size_t to) {
+    KVBucket::setCompactionWriteQueueCap(to);
+    compactionThrottle.setWriteQueueCap(to);
+}
+
+bool EPBucket::tryStartCompaction(GlobalTask& task) {
+    LockHolder lh(compactionLock);
+    const size_t max = compactionMaxConcurrent;
+    if (max != 0 && compactionsRunning >= max) {
+        // Snooze under the lock, so a compaction completing now sees the
+        // task as snoozed (and wakes it)
+        task.snooze(INT_MAX);
+        return false;
+    }
+    ++compactionsRunning;
+    return true;
+}
+
 ENGINE_ERROR_CODE EPBucket::cancelCompaction(Vbid vbid) {
     LockHolder lh(compactionLock);
     for (const auto& task : compactionTasks) {
@@ -733,6 +993,277 @@ ENGINE_ERROR_CODE EPBucket::cancelCompaction(Vbid vbid) {
     return ENGINE_SUCCESS;
 }
 
+ENGINE_ERROR_CODE EPBucket::linkVBucketFile(Vbid vbid,
+                                           const std::string& dir,
+                                           std::string& path) {
+    if (!vbMap.getBucket(vbid)) {
+        return ENGINE_NOT_MY_VBUCKET;
+    }
+
+    // Only couchstore snapshots (and installs) the data files
+    auto* rwUnderlying = getRWUnderlying(vbid);
+    if (rwUnderlying->getConfig().getBackend() != "couchdb") {
+        return ENGINE_ENOTSUP;
+    }
+
+    path = rwUnderlying->linkVBucketFile(vbid, dir);
+    if (path.empty()) {
+        return ENGINE_EINVAL;
+    }
+    EP_LOG_INFO("EPBucket::linkVBucketFile: Snapshot {} as \"{}\"", vbid, path);
+    return ENGINE_SUCCESS;
+}
+
+ENGINE_ERROR_CODE EPBucket::installVBucket(Vbid vbid,
+                                           const std::string& path,
+                                           const void* cookie) {
+    if (vbid.get() >= vbMap.getSize()) {
+        return ENGINE_ERANGE;
+    }
+    if (getRWUnderlying(vbid)->getConfig().getBackend() != "couchdb") {
+        return ENGINE_ENOTSUP;
+    }
+
+    {
+        std::lock_guard<std::mutex> lh(vbsetMutex);
+        if (vbMap.getBucket(vbid) || vbucketsBeingInstalled.count(vbid) != 0) {
+            return ENGINE_KEY_EEXISTS;
+        }
+        vbucketsBeingInstalled.insert(vbid);
+    }
+
+    ExTask task =
+            std::make_shared<VBucketInstallTask>(*this, vbid, path, cookie);
+    ExecutorPool::get()->schedule(task);
+    EP_LOG_INFO("EPBucket::installVBucket: Scheduled the install of {} from "
+                "\"{}\"",
+                vbid,
+                path);
+    return ENGINE_EWOULDBLOCK;
+}
+
+void EPBucket::doInstallVBucket(Vbid vbid,
+                                const std::string& path,
+                                const void* cookie) {
+    const auto start = std::chrono::steady_clock::now();
+    auto* kvstore = getRWUnderlying(vbid);
+    ENGINE_ERROR_CODE err = ENGINE_SUCCESS;
+
+    auto* state = kvstore->installVBucketFile(vbid, path);
+    if (!state) {
+        err = ENGINE_EINVAL;
+    } else if (!state->supportsNamespaces) {
+        // As Warmup::createVBuckets, the data file must have name-spacing
+        // applied to the key space
+        EP_LOG_WARN(
+                "EPBucket::doInstallVBucket: \"{}\" is unusable, name-spacing "
+                "is not enabled",
+                path);
+        err = ENGINE_EINVAL;
+    }
+
+    if (err == ENGINE_SUCCESS) {
+        // The vbucket is warmed up from the file as Warmup does, in replica
+        // state (so replication resumes from what was snapshot)
+        const vbucket_state vbs = *state;
+        const auto maxEntries = engine.getMaxFailoverEntries();
+        std::unique_ptr<FailoverTable> table;
+        if (vbs.failovers.empty()) {
+            table = std::make_unique<FailoverTable>(maxEntries);
+        } else {
+            table = std::make_unique<FailoverTable>(
+                    vbs.failovers, maxEntries, vbs.highSeqno);
+        }
+
+        auto& config = engine.getConfiguration();
+        std::unique_ptr<Collections::VB::Manifest> manifest;
+        if (config.isCollectionsEnabled()) {
+            manifest = std::make_unique<Collections::VB::Manifest>(
+                    kvstore->getCollectionsManifest(vbid));
+        } else {
+            manifest = std::make_unique<Collections::VB::Manifest>();
+        }
+
+        auto vb = makeVBucket(vbid,
+                              vbucket_state_replica,
+                              vbMap.getShardByVbId(vbid),
+                              std::move(table),
+                              std::make_unique<NotifyNewSeqnoCB>(*this),
+                              std::move(manifest),
+                              vbucket_state_replica,
+                              vbs.highSeqno,
+                              vbs.lastSnapStart,
+                              vbs.lastSnapEnd,
+                              vbs.purgeSeqno,
+                              vbs.maxCas,
+                              vbs.hlcCasEpochSeqno,
+                              vbs.mightContainXattrs,
+                              {});
+        vb->setFreqSaturatedCallback(
+                [this]() { this->wakeItemFreqDecayerTask(); });
+        vb->setSyncWriteDeadlineCallback(
+                [this](Vbid vbid,
+                       std::chrono::steady_clock::time_point deadline) {
+                    this->addSyncWriteDeadline(vbid, deadline);
+                });
+        if (config.isBfilterEnabled()) {
+            vb->createFilter(config.getBfilterKeyCount(),
+                             config.getBfilterFpProb());
+        }
+
+        vb->checkpointManager->setOpenCheckpointId(vbs.checkpointId + 1);
+        vb->ht.setMaxDeletedRevSeqno(vbs.maxDeletedSeqno);
+        vb->setPersistenceCheckpointId(vbs.checkpointId);
+        vb->setPersistenceSeqno(vbs.highSeqno);
+
+        {
+            auto wh = vb->getManifest().wlock();
+            auto fileHandle = kvstore->makeFileHandle(vbid);
+            for (auto& collection : wh) {
+                auto stats = kvstore->getCollectionStats(*fileHandle,
+                                                         collection.first);
+                collection.second.setDiskCount(stats.itemCount);
+                collection.second.setPersistedHighSeqno(stats.highSeqno);
+                collection.second.resetHighSeqno(stats.highSeqno);
+            }
+        }
+        vb->setNumTotalItems(kvstore->getItemCount(vbid));
+
+        if (!loadInstalledVBucket(dynamic_cast<EPVBucket&>(*vb), *kvstore)) {
+            err = ENGINE_EINVAL;
+        } else {
+            std::lock_guard<std::mutex> lh(vbsetMutex);
+            vbMap.addBucket(vb);
+            vbucketsBeingInstalled.erase(vbid);
+        }
+    }
+
+    if (err == ENGINE_SUCCESS) {
+        scheduleVBStatePersist(vbid);
+        EP_LOG_INFO(
+                "EPBucket::doInstallVBucket: Installed {} from \"{}\", "
+                "high_seqno:{} in {}",
+                vbid,
+                path,
+                state->highSeqno,
+                cb::time2text(std::chrono::steady_clock::now() - start));
+    } else {
+        if (state) {
+            // Don't leave the file behind as the data of a vbucket which
+            // doesn't exist
+            kvstore->delVBucket(vbid, kvstore->prepareToDelete(vbid));
+        }
+        std::lock_guard<std::mutex> lh(vbsetMutex);
+        vbucketsBeingInstalled.erase(vbid);
+    }
+
+    if (cookie) {
+        if (err != ENGINE_SUCCESS) {
+            engine.storeEngineSpecific(cookie, nullptr);
+        }
+        engine.notifyIOComplete(cookie, err);
+    }
+}
+
+bool EPBucket::loadInstalledVBucket(EPVBucket& vb, KVStore& kvstore) {
+    // As Warmup::loadPreparedSyncWrites, restore the prepares which weren't
+    // committed or aborted
+    struct LoadPrepares : public StatusCallback<GetValue> {
+        void callback(GetValue& val) override {
+            if (val.item->isPending()) {
+                outstandingPrepares.emplace(val.item->getKey(),
+                                            std::move(val.item));
+            } else if (val.item->isCommitted()) {
+                outstandingPrepares.erase(val.item->getKey());
+            }
+        }
+
+        std::unordered_map<StoredDocKey, std::unique_ptr<Item>>
+                outstandingPrepares;
+    };
+
+    const auto valFilter =
+            engine.getCompressionMode() != BucketCompressionMode::Off
+                    ? ValueFilter::VALUES_COMPRESSED
+                    : ValueFilter::VALUES_DECOMPRESSED;
+    auto prepareCB = std::make_shared<LoadPrepares>();
+    auto cacheCB = std::make_shared<NoLookupCallback>();
+    auto* ctx = kvstore.initScanContext(prepareCB,
+                                        cacheCB,
+                                        vb.getId(),
+                                        0,
+                                        DocumentFilter::ALL_ITEMS,
+                                        valFilter);
+    if (!ctx) {
+        return false;
+    }
+    auto result = kvstore.scan(ctx);
+    kvstore.destroyScanContext(ctx);
+    if (result != scan_success) {
+        return false;
+    }
+
+    std::vector<queued_item> prepares;
+    for (auto& prepare : prepareCB->outstandingPrepares) {
+        prepares.emplace_back(std::move(prepare.second));
+    }
+    std::sort(prepares.begin(),
+              prepares.end(),
+              [](const auto& a, const auto& b) {
+                  return a->getBySeqno() < b->getBySeqno();
+              });
+    vb.restoreOutstandingPreparesFromWarmup(std::move(prepares));
+
+    if (getItemEvictionPolicy() == EvictionPolicy::Full) {
+        return true;
+    }
+
+    // With value eviction the HashTable must hold every key, so load the
+    // keys and metadata as Warmup::keyDumpforShard does
+    struct LoadKeys : public StatusCallback<GetValue> {
+        explicit LoadKeys(EPVBucket& vb) : vb(vb) {
+        }
+
+        void callback(GetValue& val) override {
+            auto& item = *val.item;
+            if (item.getKey().getCollectionID() == CollectionID::System ||
+                item.isPending()) {
+                return;
+            }
+            if (item.getCas() == static_cast<uint64_t>(-1)) {
+                item.setCas(0);
+            }
+            if (vb.insertFromWarmup(item, false, true) ==
+                MutationStatus::NoMem) {
+                setStatus(ENGINE_ENOMEM);
+            }
+        }
+
+        EPVBucket& vb;
+    };
+
+    auto keysCB = std::make_shared<LoadKeys>(vb);
+    ctx = kvstore.initScanContext(keysCB,
+                                  cacheCB,
+                                  vb.getId(),
+                                  0,
+                                  DocumentFilter::NO_DELETES,
+                                  ValueFilter::KEYS_ONLY);
+    if (!ctx) {
+        return false;
+    }
+    result = kvstore.scan(ctx);
+    kvstore.destroyScanContext(ctx);
+    if (result != scan_success) {
+        EP_LOG_WARN(
+                "EPBucket::loadInstalledVBucket: Failed to load the keys of "
+                "{}, the quota is too low",
+                vb.getId());
+        return false;
+    }
+    return true;
+}
+
 void EPBucket::flushOneDeleteAll() {
     for (auto vbid : vbMap.getBuckets()) {
         auto vb = getLockedVBucket(vbid);
@@ -836,6 +1367,8 @@ void EPBucket::compactInternal(const CompactionConfig& config,
                                  std::placeholders::_1,
                                  std::placeholders::_2);
 
+    ctx.throttleCb = [this](size_t bytes) { compactionThrottle.consume(bytes); };
+
     KVShard* shard = vbMap.getShardByVbId(config.db_file_id);
     KVStore* store = shard->getRWUnderlying();
     bool result = store->compactDB(&ctx);
@@ -850,12 +1383,13 @@ void EPBucket::compactInternal(const CompactionConfig& config,
     if (vb) {
         if (getEPEngine().getConfiguration().isBfilterEnabled() && result) {
             vb->swapFilter();
+            saveBloomFilter(*vb);
         } else {
             vb->clearFilter();
         }
         vb->setPurgeSeqno(ctx.max_purged_seq);
-        vb->setNumTotalItems(vb->getNumTotalItems() -
-                             ctx.stats.collectionsItemsPurged);
+        dynamic_cast<EPVBucket&>(*vb).collectionItemsErased(
+                ctx.stats.collectionsItemsPurgedById);
     }
 
     EP_LOG_INFO(
@@ -897,6 +1431,8 @@ bool EPBucket::doCompact(const CompactionConfig& config,
         auto vb = getLockedVBucket(vbid, std::try_to_lock);
         if (!vb.owns_lock()) {
             // VB currently locked; try again later.
+            LockHolder lh(compactionLock);
+            --compactionsRunning;
             return true;
         }
 
@@ -925,25 +1461,49 @@ bool EPBucket::doCompact(const CompactionConfig& config,
 }
 
 void EPBucket::updateCompactionTasks(Vbid db_file_id) {
-    LockHolder lh(compactionLock);
-    bool erased = false, woke = false;
-    std::list<CompTaskEntry>::iterator it = compactionTasks.begin();
-    while (it != compactionTasks.end()) {
-        if ((*it).first == db_file_id) {
-            it = compactionTasks.erase(it);
-            erased = true;
-        } else {
-            ExTask& task = (*it).second;
-            if (task->getState() == TASK_SNOOZED) {
-                ExecutorPool::get()->wake(task->getId());
-                woke = true;
+    std::vector<CompTaskEntry> snoozed;
+    {
+        LockHolder lh(compactionLock);
+        --compactionsRunning;
+        auto it = compactionTasks.begin();
+        while (it != compactionTasks.end()) {
+            if ((*it).first == db_file_id) {
+                it = compactionTasks.erase(it);
+            } else {
+                if ((*it).second->getState() == TASK_SNOOZED) {
+                    snoozed.push_back(*it);
+                }
+                ++it;
+            }
+        }
+    }
+    if (snoozed.empty()) {
+        return;
+    }
+
+    // Outside of compactionLock (which front end threads take to schedule
+    // compactions) as this reads the file info. A task which is woken but
+    // then can't start (as another compaction took the free slot) snoozes
+    // again, and is woken when that compaction completes.
+    ExTask next;
+    uint64_t mostFragmented = 0;
+    for (const auto& entry : snoozed) {
+        uint64_t fragmented = 0;
+        try {
+            const auto info =
+                    getRWUnderlying(entry.first)->getDbFileInfo(entry.first);
+            if (info.fileSize > info.spaceUsed) {
+                fragmented = info.fileSize - info.spaceUsed;
             }
-            ++it;
+        } catch (const std::exception&) {
+            // No file (yet); nothing to rank it by
         }
-        if (erased && woke) {
-            break;
+        if (!next || fragmented > mostFragmented) {
+            next = entry.second;
+            mostFragmented = fragmented;
         }
     }
+    ExecutorPool::get()->wake(next->getId());
 }
 
 std::pair<uint64_t, bool> EPBucket::getLastPersistedCheckpointId(Vbid vb) {
@@ -1130,14 +1690,18 @@ public:
         UniqueItemPtr postRbSeqnoItem(std::move(val.item));
         VBucketPtr vb = engine.getVBucket(postRbSeqnoItem->getVBucketId());
 
-        // The get value of the item before the rollback seqno
+        // The get value of the item before the rollback seqno. The value
+        // itself is only needed if it's to be made resident
+        const bool fetchValues =
+                engine.getConfiguration().isRollbackFetchValues();
         GetValue preRbSeqnoGetValue =
                 engine.getKVBucket()
                         ->getROUnderlying(postRbSeqnoItem->getVBucketId())
                         ->getWithHeader(dbHandle,
                                         DiskDocKey{*postRbSeqnoItem},
                                         postRbSeqnoItem->getVBucketId(),
-                                        GetMetaOnly::No);
+                                        fetchValues ? GetMetaOnly::No
+                                                    : GetMetaOnly::Yes);
         if (preRbSeqnoGetValue.getStatus() == ENGINE_SUCCESS) {
             // This is the item in the state it was before the rollback seqno
             // (i.e. the desired state)
@@ -1149,7 +1713,10 @@ public:
             } else {
                 // The item existed before and was not deleted, we need to
                 // revert the items state to the preRollbackSeqno state
-                MutationStatus mtype = vb->setFromInternal(*preRbSeqnoItem);
+                MutationStatus mtype =
+                        fetchValues ? vb->setFromInternal(*preRbSeqnoItem)
+                                    : vb->setNonResidentFromInternal(
+                                              *preRbSeqnoItem);
 
                 if (mtype == MutationStatus::NoMem) {
                     setStatus(ENGINE_ENOMEM);
@@ -1204,6 +1771,17 @@ RollbackResult EPBucket::doRollback(Vbid vbid, uint64_t rollbackSeqno) {
     return rwUnderlying->rollback(vbid, rollbackSeqno, cb);
 }
 
+void EPBucket::addKVStoreTimingStats(const AddStatFn& add_stat,
+                                     const void* cookie) {
+    KVBucket::addKVStoreTimingStats(add_stat, cookie);
+
+    // And how the flushers have sized their batches from the commit times
+    for (const auto& shard : vbMap.shards) {
+        shard->getFlusher()->getBatchSizer().addStats(
+                "rw_" + std::to_string(shard->getId()), add_stat, cookie);
+    }
+}
+
 void EPBucket::rollbackUnpersistedItems(VBucket& vb, int64_t rollbackSeqno) {
     std::vector<queued_item> items;
     vb.checkpointManager->getAllItemsForPersistence(items);
@@ -1227,6 +1805,12 @@ void EPBucket::notifyNewSeqno(const Vbid vbid, const VBNotifyCtx& notifyCtx) {
     if (notifyCtx.notifyFlusher) {
         notifyFlusher(vbid);
     }
+    if (notifyCtx.durablePrepare) {
+        KVShard* shard = vbMap.getShardByVbId(vbid);
+        if (shard) {
+            shard->getFlusher()->notifyDurablePrepare();
+        }
+    }
     if (notifyCtx.notifyReplication) {
         notifyReplication(vbid, notifyCtx.bySeqno);
     }
@@ -1240,6 +1824,10 @@ bool EPBucket::isWarmingUp() {
     return warmupTask && !warmupTask->isComplete();
 }
 
+bool EPBucket::isWarmupTrafficReady() {
+    return warmupTask && warmupTask->isTrafficReady();
+}
+
 bool EPBucket::isWarmupOOMFailure() {
     return warmupTask && warmupTask->hasOOMFailure();
 }
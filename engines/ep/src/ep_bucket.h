@@ -17,8 +17,13 @@
 
 #pragma once
 
+#include "compaction_throttle.h"
 #include "kv_bucket.h"
 
+#include <chrono>
+
+class EPVBucket;
+
 /**
  * Eventually Persistent Bucket
  *
@@ -57,6 +62,57 @@ public:
      */
     void setFlusherBatchSplitTrigger(size_t limit);
 
+    /**
+     * Set the time we'd like a flusher commit to take, which the flushers
+     * size their batches to (up to flusher_batch_split_trigger items).
+     * Zero disables the adaptive sizing.
+     */
+    void setFlusherBatchTargetCommitTime(std::chrono::milliseconds target);
+
+    /**
+     * Set how long the flushers keep committing vBuckets after the first
+     * commit of a group before syncing the whole group together. Zero
+     * disables group commit.
+     */
+    void setFlusherGroupCommitWindow(std::chrono::milliseconds window);
+
+    /**
+     * Set how long the BgFetchers hold a small batch of fetches before
+     * reading it. Zero disables the delay.
+     */
+    void setBgFetchBatchDelay(std::chrono::microseconds delay);
+
+    /**
+     * Start a group of commits for the shard: until completeGroupCommit()
+     * the commits of the shard aren't synced, and the vBuckets aren't told
+     * what they have persisted.
+     *
+     * @return false if the shard's KVStore doesn't support group commit
+     */
+    bool beginGroupCommit(KVShard& shard);
+
+    /**
+     * Sync the group of commits of the shard, and then tell the vBuckets
+     * (and the SyncWrites and clients waiting for the persistence) what
+     * they have persisted. Locks the vBuckets of the group, so the caller
+     * mustn't hold the lock of any vBucket.
+     */
+    void completeGroupCommit(KVShard& shard);
+
+    /**
+     * Complete the group commit of the vBucket state snapshots of the
+     * shard (see flusher_vbstate_group_commit), if one is in progress
+     *
+     * @param onlyIfHoldingItems only complete it if a flush has added
+     *        items to the group (which shouldn't wait for the snapshots)
+     */
+    void completeVBStateGroupCommit(KVShard& shard,
+                                    bool onlyIfHoldingItems = false);
+
+    void setFlusherVBStateGroupCommit(bool enabled) {
+        flusherVBStateGroupCommit = enabled;
+    }
+
     void commit(KVStore& kvstore, Collections::VB::Flush& collectionsFlush);
 
     /// Start the Flusher for all shards in this bucket.
@@ -85,6 +141,43 @@ public:
 
     ENGINE_ERROR_CODE cancelCompaction(Vbid vbid) override;
 
+    ENGINE_ERROR_CODE linkVBucketFile(Vbid vbid,
+                                      const std::string& dir,
+                                      std::string& path) override;
+
+    ENGINE_ERROR_CODE installVBucket(Vbid vbid,
+                                     const std::string& path,
+                                     const void* ck) override;
+
+    /**
+     * Install the data file of a vbucket and warm the vbucket up from it
+     * (called by the task installVBucket() schedules)
+     */
+    void doInstallVBucket(Vbid vbid,
+                          const std::string& path,
+                          const void* cookie);
+
+    /**
+     * Set the most compactions which may run at once, more are snoozed until
+     * one completes. Zero is unlimited.
+     */
+    void setCompactionMaxConcurrent(size_t max);
+
+    /// Set the rate (bytes/sec) compactions write at, zero is unlimited
+    void setCompactionMaxWriteRate(size_t bytesPerSec);
+
+    void setCompactionWriteQueueCap(size_t to) override;
+
+    /**
+     * Called by a compaction task before compacting.
+     *
+     * @param task the compaction task, snoozed if it may not run now
+     * @return true if the compaction may run now, false if the most
+     *         concurrent compactions are running; the task is snoozed until
+     *         one completes
+     */
+    bool tryStartCompaction(GlobalTask& task);
+
     /**
      * Compaction of a database file
      *
@@ -135,6 +228,9 @@ public:
 
     RollbackResult doRollback(Vbid vbid, uint64_t rollbackSeqno) override;
 
+    void addKVStoreTimingStats(const AddStatFn& add_stat,
+                               const void* cookie) override;
+
     void rollbackUnpersistedItems(VBucket& vb, int64_t rollbackSeqno) override;
 
     void notifyNewSeqno(const Vbid vbid, const VBNotifyCtx& notifyCtx) override;
@@ -155,6 +251,8 @@ public:
 
     bool isWarmingUp() override;
 
+    bool isWarmupTrafficReady() override;
+
     bool isWarmupOOMFailure() override;
 
     /**
@@ -193,6 +291,60 @@ protected:
 
     void flushOneDelOrSet(const queued_item& qi, VBucketPtr& vb);
 
+    /**
+     * Load the outstanding prepares (and, with value eviction, the keys)
+     * of a vbucket installed from a data file, before it's added to the
+     * map.
+     *
+     * @return false if the vbucket couldn't be loaded
+     */
+    bool loadInstalledVBucket(EPVBucket& vb, KVStore& kvstore);
+
+    /// What a flush of a vBucket has persisted
+    struct PersistedState {
+        explicit PersistedState(VBucketPtr vb) : vb(std::move(vb)) {
+        }
+
+        VBucketPtr vb;
+        /// True if the flush committed; the range and highSeqno are set
+        bool committed = false;
+        snapshot_range_t range{0, 0};
+        uint64_t highSeqno = 0;
+        uint64_t checkpointId = 0;
+    };
+
+    /**
+     * Write the bloom filter of the vBucket to disk (if enabled by
+     * bfilter_persist), so the next warmup can use it.
+     */
+    void saveBloomFilter(VBucket& vb);
+
+    /**
+     * Write an image of the resident items of the vBucket to disk (if
+     * enabled by warmup_hashtable_image), for the next warmup to load.
+     */
+    void saveHashTableImage(VBucket& vb);
+
+    /**
+     * Tell the vBucket what it has persisted, which notifies the Durability
+     * Monitor and the clients waiting for the seqno (or checkpoint) to be
+     * persisted.
+     */
+    void publishPersistedState(VBucket& vb, const PersistedState& state);
+
+    /// The group commit (if any) in progress for a shard
+    struct GroupCommit {
+        bool active = false;
+        /// The group was started for (and only holds) vBucket state
+        /// snapshots
+        bool vbStateOnly = false;
+        /// Items were flushed into the group of state snapshots; it should
+        /// be completed as soon as the flush returns
+        bool holdingItems = false;
+        /// The states to publish once the group is synced
+        std::vector<PersistedState> pending;
+    };
+
     /**
      * Compaction of a database file
      *
@@ -201,7 +353,8 @@ protected:
     void compactInternal(const CompactionConfig& config, uint64_t purgeSeqno);
 
     /**
-     * Remove completed compaction tasks or wake snoozed tasks
+     * Remove the completed compaction task and wake the snoozed task of the
+     * most fragmented file (which frees the most space).
      *
      * @param db_file_id vbucket id for couchstore
      */
@@ -218,11 +371,29 @@ protected:
      */
     size_t flusherBatchSplitTrigger;
 
+    /**
+     * Group commit state per shard, indexed by the shard id. Only accessed
+     * by the flusher of the shard.
+     */
+    std::vector<GroupCommit> groupCommits;
+
+    /// Should the vBucket state snapshots of a shard be group committed
+    std::atomic_bool flusherVBStateGroupCommit{false};
+
     /**
      * Indicates whether erroneous tombstones need to retained or not during
      * compaction
      */
     cb::RelaxedAtomic<bool> retainErroneousTombstones;
 
+    /// The most compactions which may run at once (0 is unlimited)
+    cb::RelaxedAtomic<size_t> compactionMaxConcurrent{0};
+
+    /// The number of compactions running, guarded by compactionLock
+    size_t compactionsRunning{0};
+
+    /// Limits the rate the compactions write at
+    CompactionThrottle compactionThrottle;
+
     std::unique_ptr<Warmup> warmupTask;
 };
@@ -24,6 +24,7 @@
 #include "collections/manager.h"
 #include "common.h"
 #include "connmap.h"
+#include "dcp/backfill_governor.h"
 #include "dcp/consumer.h"
 #include "dcp/dcpconnmap.h"
 #include "dcp/flow-control-manager.h"
@@ -44,8 +45,8 @@
 #include "vb_count_visitor.h"
 #include "warmup.h"
 
-#include <JSON_checker.h>
 #include <logger/logger.h>
+#include <mcbp/protocol/unsigned_leb128.h>
 #include <memcached/engine.h>
 #include <memcached/protocol_binary.h>
 #include <memcached/server_cookie_iface.h>
@@ -59,19 +60,23 @@
 #include <platform/scope_timer.h>
 #include <tracing/trace_helpers.h>
 #include <utilities/hdrhistogram.h>
+#include <utilities/json_validator.h>
 #include <utilities/logtags.h>
 #include <xattr/utils.h>
 
 #include <fcntl.h>
 #include <stdarg.h>
+#include <algorithm>
 #include <chrono>
 #include <cstdio>
 #include <cstring>
 #include <fstream>
 #include <iostream>
 #include <limits>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <numeric>
 #include <string>
 #include <vector>
 
@@ -375,6 +380,24 @@ cb::EngineErrorCasPair EventuallyPersistentEngine::store_if(
             cookie, item, cas, operation, predicate);
 }
 
+cb::EngineErrorItemPair EventuallyPersistentEngine::update(
+        gsl::not_null<const void*> cookie,
+        const DocKey& key,
+        Vbid vbucket,
+        uint64_t cas,
+        const cb::UpdateFunction& update) {
+    return acquireEngine(this)->updateInner(cookie, key, vbucket, cas, update);
+}
+
+cb::EngineErrorItemPair EventuallyPersistentEngine::append(
+        gsl::not_null<const void*> cookie,
+        const DocKey& key,
+        Vbid vbucket,
+        uint64_t cas,
+        cb::const_char_buffer value) {
+    return acquireEngine(this)->appendInner(cookie, key, vbucket, cas, value);
+}
+
 void EventuallyPersistentEngine::reset_stats(
         gsl::not_null<const void*> cookie) {
     acquireEngine(this)->resetStats();
@@ -392,6 +415,9 @@ cb::mcbp::Status EventuallyPersistentEngine::setReplicationParam(
             getConfiguration().setReplicationThrottleQueueCap(std::stoll(val));
         } else if (key == "replication_throttle_cap_pcnt") {
             getConfiguration().setReplicationThrottleCapPcnt(std::stoull(val));
+        } else if (key == "replication_throttle_pace_pcnt") {
+            getConfiguration().setReplicationThrottlePacePcnt(
+                    std::stoull(val));
         } else {
             msg = "Unknown config param";
             rv = cb::mcbp::Status::KeyEnoent;
@@ -442,6 +468,12 @@ cb::mcbp::Status EventuallyPersistentEngine::setCheckpointParam(
             getConfiguration().setItemNumBasedNewChk(cb_stob(val));
         } else if (key == "keep_closed_chks") {
             getConfiguration().setKeepClosedChks(cb_stob(val));
+        } else if (key == "chk_shared_cursor_reads") {
+            getConfiguration().setChkSharedCursorReads(cb_stob(val));
+        } else if (key == "chk_remover_event_driven") {
+            getConfiguration().setChkRemoverEventDriven(cb_stob(val));
+        } else if (key == "chk_remover_batch_size") {
+            getConfiguration().setChkRemoverBatchSize(std::stoull(val));
         } else if (key == "cursor_dropping_checkpoint_mem_upper_mark") {
             size_t v = std::stoull(val);
             validate(v,
@@ -552,12 +584,16 @@ cb::mcbp::Status EventuallyPersistentEngine::setFlushParam(
             getConfiguration().setPagerSleepTimeMs(std::stoull(val));
         } else if (key == "item_eviction_age_percentage") {
             getConfiguration().setItemEvictionAgePercentage(std::stoull(val));
+        } else if (key == "item_eviction_cost_weight") {
+            getConfiguration().setItemEvictionCostWeight(std::stoull(val));
         } else if (key == "item_eviction_freq_counter_age_threshold") {
             getConfiguration().setItemEvictionFreqCounterAgeThreshold(
                     std::stoull(val));
         } else if (key == "item_freq_decayer_chunk_duration") {
             getConfiguration().setItemFreqDecayerChunkDuration(
                     std::stoull(val));
+        } else if (key == "item_freq_decayer_lazy") {
+            getConfiguration().setItemFreqDecayerLazy(cb_stob(val));
         } else if (key == "item_freq_decayer_percent") {
             getConfiguration().setItemFreqDecayerPercent(std::stoull(val));
             /* End of ItemPager parameters */
@@ -581,6 +617,12 @@ cb::mcbp::Status EventuallyPersistentEngine::setFlushParam(
             size_t value = std::stoull(val);
             getConfiguration().setNumNonioThreads(value);
             ExecutorPool::get()->setNumNonIO(value);
+        } else if (key == "io_thread_autotune") {
+            getConfiguration().setIoThreadAutotune(cb_stob(val));
+        } else if (key == "io_thread_autotune_max_threads") {
+            getConfiguration().setIoThreadAutotuneMaxThreads(std::stoull(val));
+        } else if (key == "io_thread_autotune_min_threads") {
+            getConfiguration().setIoThreadAutotuneMinThreads(std::stoull(val));
         } else if (key == "bfilter_enabled") {
             getConfiguration().setBfilterEnabled(cb_stob(val));
         } else if (key == "bfilter_residency_threshold") {
@@ -602,13 +644,25 @@ cb::mcbp::Status EventuallyPersistentEngine::setFlushParam(
             getConfiguration().setDefragmenterAgeThreshold(std::stoull(val));
         } else if (key == "defragmenter_chunk_duration") {
             getConfiguration().setDefragmenterChunkDuration(std::stoull(val));
+        } else if (key == "defragmenter_query_utilization") {
+            getConfiguration().setDefragmenterQueryUtilization(cb_stob(val));
         } else if (key == "defragmenter_stored_value_age_threshold") {
             getConfiguration().setDefragmenterStoredValueAgeThreshold(
                     std::stoull(val));
         } else if (key == "defragmenter_run") {
             runDefragmenterTask();
+        } else if (key == "task_slow_runtime_threshold") {
+            getConfiguration().setTaskSlowRuntimeThreshold(std::stoull(val));
+        } else if (key == "lock_profiling_enabled") {
+            getConfiguration().setLockProfilingEnabled(cb_stob(val));
+        } else if (key == "executor_cpu_shares") {
+            getConfiguration().setExecutorCpuShares(std::stoull(val));
         } else if (key == "compaction_write_queue_cap") {
             getConfiguration().setCompactionWriteQueueCap(std::stoull(val));
+        } else if (key == "compaction_max_concurrent") {
+            getConfiguration().setCompactionMaxConcurrent(std::stoull(val));
+        } else if (key == "compaction_max_write_rate") {
+            getConfiguration().setCompactionMaxWriteRate(std::stoull(val));
         } else if (key == "chk_expel_enabled") {
             getConfiguration().setChkExpelEnabled(cb_stob(val));
         } else if (key == "dcp_min_compression_ratio") {
@@ -635,10 +689,30 @@ cb::mcbp::Status EventuallyPersistentEngine::setFlushParam(
         } else if (key == "fsync_after_every_n_bytes_written") {
             getConfiguration().setFsyncAfterEveryNBytesWritten(
                     std::stoull(val));
+        } else if (key == "collections_drop_compaction_threshold") {
+            getConfiguration().setCollectionsDropCompactionThreshold(
+                    std::stoull(val));
+        } else if (key == "rollback_fetch_values") {
+            getConfiguration().setRollbackFetchValues(cb_stob(val));
+        } else if (key == "couchstore_compaction_min_fragmentation") {
+            getConfiguration().setCouchstoreCompactionMinFragmentation(
+                    std::stoull(val));
+        } else if (key == "couchstore_compaction_readahead_size") {
+            getConfiguration().setCouchstoreCompactionReadaheadSize(
+                    std::stoull(val));
+        } else if (key == "couchstore_file_handle_cache_size") {
+            getConfiguration().setCouchstoreFileHandleCacheSize(
+                    std::stoull(val));
+        } else if (key == "couchstore_writeback_size") {
+            getConfiguration().setCouchstoreWritebackSize(std::stoull(val));
+        } else if (key == "couchstore_drop_behind") {
+            getConfiguration().setCouchstoreDropBehind(cb_stob(val));
         } else if (key == "xattr_enabled") {
             getConfiguration().setXattrEnabled(cb_stob(val));
         } else if (key == "compression_mode") {
             getConfiguration().setCompressionMode(val);
+        } else if (key == "collection_memory_quotas") {
+            getConfiguration().setCollectionMemoryQuotas(val);
         } else if (key == "min_compression_ratio") {
             float min_comp_ratio;
             if (safe_strtof(val.c_str(), min_comp_ratio)) {
@@ -652,6 +726,18 @@ cb::mcbp::Status EventuallyPersistentEngine::setFlushParam(
             getConfiguration().setMemUsedMergeThresholdPercent(std::stof(val));
         } else if (key == "retain_erroneous_tombstones") {
             getConfiguration().setRetainErroneousTombstones(cb_stob(val));
+        } else if (key == "hot_key_cache_size") {
+            getConfiguration().setHotKeyCacheSize(std::stoull(val));
+        } else if (key == "hot_key_cache_min_freq") {
+            getConfiguration().setHotKeyCacheMinFreq(std::stoull(val));
+        } else if (key == "max_blob_segments") {
+            getConfiguration().setMaxBlobSegments(std::stoull(val));
+        } else if (key == "stat_group_cache_ttl_ms") {
+            getConfiguration().setStatGroupCacheTtlMs(std::stoull(val));
+        } else if (key == "decompressed_value_cache_size") {
+            getConfiguration().setDecompressedValueCacheSize(std::stoull(val));
+        } else if (key == "flusher_vbstate_group_commit") {
+            getConfiguration().setFlusherVbstateGroupCommit(cb_stob(val));
         } else {
             msg = "Unknown config param";
             rv = cb::mcbp::Status::KeyEnoent;
@@ -705,6 +791,17 @@ cb::mcbp::Status EventuallyPersistentEngine::setDcpParam(const std::string& key,
             checkNumeric(val.c_str());
             validate(v, size_t(1), std::numeric_limits<size_t>::max());
             getConfiguration().setDcpIdleTimeout(v);
+        } else if (key == "dcp_backfill_node_byte_limit") {
+            size_t v = size_t(std::stoul(val));
+            checkNumeric(val.c_str());
+            getConfiguration().setDcpBackfillNodeByteLimit(v);
+            BackfillGovernor::get().setLimit(v);
+        } else if (key == "dcp_backfill_node_weight") {
+            size_t v = size_t(std::stoul(val));
+            checkNumeric(val.c_str());
+            getConfiguration().setDcpBackfillNodeWeight(v);
+        } else if (key == "dcp_backfill_prioritization") {
+            getConfiguration().setDcpBackfillPrioritization(cb_stob(val));
         } else {
             msg = "Unknown config param";
             rv = cb::mcbp::Status::KeyEnoent;
@@ -1069,6 +1166,87 @@ static ENGINE_ERROR_CODE compactDB(EventuallyPersistentEngine* e,
                         cookie);
 }
 
+static ENGINE_ERROR_CODE vbucketSnapshot(EventuallyPersistentEngine* e,
+                                         const void* cookie,
+                                         const cb::mcbp::Request& req,
+                                         const AddResponseFn& response) {
+    const auto value = req.getValue();
+    const std::string dir(reinterpret_cast<const char*>(value.data()),
+                          value.size());
+    std::string path;
+    const auto err =
+            e->getKVBucket()->linkVBucketFile(req.getVBucket(), dir, path);
+    if (err != ENGINE_SUCCESS) {
+        if (err == ENGINE_EINVAL) {
+            e->setErrorContext(cookie,
+                               "Failed to link the data file in " + dir);
+        }
+        return err;
+    }
+
+    return sendResponse(response,
+                        nullptr,
+                        0,
+                        nullptr,
+                        0,
+                        path.data(),
+                        path.size(),
+                        PROTOCOL_BINARY_RAW_BYTES,
+                        cb::mcbp::Status::Success,
+                        0,
+                        cookie);
+}
+
+static ENGINE_ERROR_CODE vbucketInstall(EventuallyPersistentEngine* e,
+                                        const void* cookie,
+                                        const cb::mcbp::Request& req,
+                                        const AddResponseFn& response) {
+    const auto vbid = req.getVBucket();
+    ENGINE_ERROR_CODE err;
+    if (e->getEngineSpecific(cookie) == nullptr) {
+        const auto value = req.getValue();
+        const std::string path(reinterpret_cast<const char*>(value.data()),
+                               value.size());
+        // Set before scheduling, the task may complete before we return
+        e->storeEngineSpecific(cookie, e);
+        err = e->getKVBucket()->installVBucket(vbid, path, cookie);
+    } else {
+        // The install task only leaves the engine specific set on success
+        err = ENGINE_SUCCESS;
+    }
+
+    if (err == ENGINE_EWOULDBLOCK) {
+        return err;
+    }
+    e->storeEngineSpecific(cookie, nullptr);
+
+    switch (err) {
+    case ENGINE_SUCCESS:
+        break;
+    case ENGINE_KEY_EEXISTS:
+        e->setErrorContext(cookie, "The vbucket exists");
+        return err;
+    case ENGINE_EINVAL:
+        EP_LOG_WARN("Failed to install the data file of {}", vbid);
+        e->setErrorContext(cookie, "Failed to install the data file");
+        return err;
+    default:
+        return err;
+    }
+
+    return sendResponse(response,
+                        nullptr,
+                        0,
+                        nullptr,
+                        0,
+                        nullptr,
+                        0,
+                        PROTOCOL_BINARY_RAW_BYTES,
+                        cb::mcbp::Status::Success,
+                        0,
+                        cookie);
+}
+
 static ENGINE_ERROR_CODE processUnknownCommand(EventuallyPersistentEngine* h,
                                                const void* cookie,
                                                const cb::mcbp::Request& request,
@@ -1174,10 +1352,24 @@ static ENGINE_ERROR_CODE processUnknownCommand(EventuallyPersistentEngine* h,
         }
         return rv;
     }
+    case cb::mcbp::ClientOpcode::VbucketSnapshot:
+        return vbucketSnapshot(h, cookie, request, response);
+    case cb::mcbp::ClientOpcode::VbucketInstall:
+        return vbucketInstall(h, cookie, request, response);
     case cb::mcbp::ClientOpcode::GetRandomKey:
-        return h->getRandomKey(cookie, response);
+        return h->getRandomKey(cookie, request, response);
     case cb::mcbp::ClientOpcode::GetKeys:
         return h->getAllKeys(cookie, request, response);
+    case cb::mcbp::ClientOpcode::RangeScan:
+        return h->rangeScan(cookie, request, response);
+    case cb::mcbp::ClientOpcode::GetMulti:
+        return h->getMulti(cookie, request, response);
+    case cb::mcbp::ClientOpcode::SetMulti:
+        return h->setMulti(cookie, request, response);
+    case cb::mcbp::ClientOpcode::GetMetaMulti:
+        return h->getMetaMulti(cookie, request, response);
+    case cb::mcbp::ClientOpcode::SetWithMetaMulti:
+        return h->setWithMetaMulti(cookie, request, response);
         // MB-21143: Remove adjusted time/drift API, but return NOT_SUPPORTED
     case cb::mcbp::ClientOpcode::GetAdjustedTime:
     case cb::mcbp::ClientOpcode::SetDriftCounterState: {
@@ -1700,7 +1892,8 @@ ENGINE_ERROR_CODE create_instance(GET_SERVER_API get_server_api,
     BucketLogger::setLoggerAPI(api->log);
 
     MemoryTracker::getInstance(*api->alloc_hooks);
-    ObjectRegistry::initialize(api->alloc_hooks->get_allocation_size);
+    ObjectRegistry::initialize(api->alloc_hooks->get_allocation_size,
+                               api->alloc_hooks->set_thread_arena);
 
     std::atomic<size_t>* inital_tracking = new std::atomic<size_t>();
 
@@ -1822,6 +2015,45 @@ bool EventuallyPersistentEngine::isXattrEnabled() {
     return getKVBucket()->isXattrEnabled();
 }
 
+cb::engine::Pressure EventuallyPersistentEngine::getPressure() {
+    cb::engine::Pressure pressure;
+    if (!kvBucket) {
+        return pressure;
+    }
+
+    const double quota = configuration.getMaxSize();
+    const double memoryLimit = quota * VBucket::getMutationMemoryThreshold();
+    if (memoryLimit > 0) {
+        pressure.memory = stats.getEstimatedTotalMemoryUsed() / memoryLimit;
+    }
+
+    const ssize_t writeQueueCap = stats.replicationThrottleWriteQueueCap;
+    if (writeQueueCap > 0) {
+        pressure.diskQueue =
+                float(stats.diskQueueSize.load()) / float(writeQueueCap);
+    }
+
+    const double checkpointLimit =
+            quota * configuration.getCursorDroppingCheckpointMemUpperMark() /
+            100;
+    if (checkpointLimit > 0) {
+        pressure.checkpointMemory =
+                kvBucket->getVBuckets()
+                        .getVBucketsTotalCheckpointMemoryUsage() /
+                checkpointLimit;
+    }
+
+    // Only this bucket's tasks; the other buckets' backlog isn't a reason to
+    // shed this bucket's mutations
+    const auto workers = ExecutorPool::get()->getNumWorkersStat();
+    if (workers > 0) {
+        pressure.executorBacklog =
+                float(getWorkLoadPolicy().getNumReadyTasks()) / float(workers);
+    }
+
+    return pressure;
+}
+
 EventuallyPersistentEngine::EventuallyPersistentEngine(
         GET_SERVER_API get_server_api)
     : kvBucket(nullptr),
@@ -1954,6 +2186,10 @@ public:
             engine.setMaxItemSize(value);
         } else if (key.compare("max_item_privileged_bytes") == 0) {
             engine.setMaxItemPrivilegedBytes(value);
+        } else if (key == "executor_cpu_shares") {
+            engine.getWorkLoadPolicy().setCpuShares(value);
+        } else if (key == "stat_group_cache_ttl_ms") {
+            engine.setStatGroupCacheTtl(value);
         }
     }
 
@@ -1996,6 +2232,25 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::initialize(const char* config) {
 
     maxFailoverEntries = configuration.getMaxFailoverEntries();
 
+    if (configuration.isDedicatedArena()) {
+        const bool hugePages = configuration.isDedicatedArenaHugePages();
+        if (arena.create(*serverApi->alloc_hooks, hugePages)) {
+            // Switch this thread to the new arena (the others switch to it
+            // by the next time they enter the engine)
+            ObjectRegistry::onSwitchThread(this);
+            EP_LOG_INFO(
+                    "EPEngine::initialize: using allocator arena {} (huge "
+                    "pages:{})",
+                    arena.get(),
+                    hugePages);
+        } else {
+            EP_LOG_WARN(
+                    "EPEngine::initialize: dedicated_arena is set but the "
+                    "allocator doesn't support arenas{}",
+                    hugePages ? " backed by huge pages" : "");
+        }
+    }
+
     // Start updating the variables from the config!
     VBucket::setMutationMemoryThreshold(
             configuration.getMutationMemThreshold());
@@ -2037,6 +2292,11 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::initialize(const char* config) {
             "getl_max_timeout",
             std::make_unique<EpEngineValueChangeListener>(*this));
 
+    setStatGroupCacheTtl(configuration.getStatGroupCacheTtlMs());
+    configuration.addValueChangedListener(
+            "stat_group_cache_ttl_ms",
+            std::make_unique<EpEngineValueChangeListener>(*this));
+
     workload = new WorkLoadPolicy(configuration.getMaxNumWorkers(),
                                   configuration.getMaxNumShards());
     if ((unsigned int)workload->getNumShards() >
@@ -2046,9 +2306,20 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::initialize(const char* config) {
                 "equal or less than max number of vbuckets");
         return ENGINE_FAILED;
     }
+    workload->setCpuShares(configuration.getExecutorCpuShares());
+    configuration.addValueChangedListener(
+            "executor_cpu_shares",
+            std::make_unique<EpEngineValueChangeListener>(*this));
 
     dcpConnMap_ = std::make_unique<DcpConnMap>(*this);
 
+    // The budget is shared by all buckets; don't let a bucket without it
+    // configured disable the budget set by another one
+    if (configuration.getDcpBackfillNodeByteLimit() != 0) {
+        BackfillGovernor::get().setLimit(
+                configuration.getDcpBackfillNodeByteLimit());
+    }
+
     /* Get the flow control policy */
     std::string flowCtlPolicy = configuration.getDcpFlowControlPolicy();
 
@@ -2061,6 +2332,9 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::initialize(const char* config) {
     } else if (!flowCtlPolicy.compare("aggressive")) {
         dcpFlowControlManager_ =
                 std::make_unique<DcpFlowControlManagerAggressive>(*this);
+    } else if (!flowCtlPolicy.compare("auto")) {
+        dcpFlowControlManager_ =
+                std::make_unique<DcpFlowControlManagerAuto>(*this);
     } else {
         /* Flow control is not enabled */
         dcpFlowControlManager_ = std::make_unique<DcpFlowControlManager>(*this);
@@ -2127,7 +2401,7 @@ void EventuallyPersistentEngine::operator delete(void* ptr) {
     // memory state inside the now-destroyed EPStats child object of
     // EventuallyPersistentEngine.  Therefore forcably disassociated
     // the current thread from this engine before deallocating memory.
-    ObjectRegistry::onSwitchThread(nullptr);
+    ObjectRegistry::onDeleteEngine();
     ::operator delete(ptr);
 }
 
@@ -2504,6 +2778,72 @@ cb::EngineErrorCasPair EventuallyPersistentEngine::storeIfInner(
     return {cb::engine_errc(status), item.getCas()};
 }
 
+cb::EngineErrorItemPair EventuallyPersistentEngine::updateInner(
+        const void* cookie,
+        const DocKey& key,
+        Vbid vbucket,
+        uint64_t cas,
+        const cb::UpdateFunction& update) {
+    ScopeTimer2<HdrMicroSecStopwatch, TracerStopwatch> timer(
+            HdrMicroSecStopwatch(stats.storeCmdHisto),
+            TracerStopwatch(cookie, cb::tracing::TraceCode::STORE));
+
+    if (isDegradedMode()) {
+        return cb::makeEngineErrorItemPair(
+                cb::engine_errc::temporary_failure);
+    }
+
+    auto gv = kvBucket->update(key, vbucket, cas, update, cookie);
+    auto status = gv.getStatus();
+    switch (status) {
+    case ENGINE_SUCCESS:
+        ++stats.numOpsStore;
+        // If success - check if we're now in need of some memory freeing
+        kvBucket->checkAndMaybeFreeMemory();
+        return cb::makeEngineErrorItemPair(
+                cb::engine_errc::success, gv.item.release(), this);
+    case ENGINE_ENOMEM:
+        status = memoryCondition();
+        break;
+    default:
+        break;
+    }
+    return cb::makeEngineErrorItemPair(cb::engine_errc(status));
+}
+
+cb::EngineErrorItemPair EventuallyPersistentEngine::appendInner(
+        const void* cookie,
+        const DocKey& key,
+        Vbid vbucket,
+        uint64_t cas,
+        cb::const_char_buffer value) {
+    ScopeTimer2<HdrMicroSecStopwatch, TracerStopwatch> timer(
+            HdrMicroSecStopwatch(stats.storeCmdHisto),
+            TracerStopwatch(cookie, cb::tracing::TraceCode::STORE));
+
+    if (isDegradedMode()) {
+        return cb::makeEngineErrorItemPair(
+                cb::engine_errc::temporary_failure);
+    }
+
+    auto gv = kvBucket->append(key, vbucket, cas, value, cookie);
+    auto status = gv.getStatus();
+    switch (status) {
+    case ENGINE_SUCCESS:
+        ++stats.numOpsStore;
+        // If success - check if we're now in need of some memory freeing
+        kvBucket->checkAndMaybeFreeMemory();
+        return cb::makeEngineErrorItemPair(
+                cb::engine_errc::success, gv.item.release(), this);
+    case ENGINE_ENOMEM:
+        status = memoryCondition();
+        break;
+    default:
+        break;
+    }
+    return cb::makeEngineErrorItemPair(cb::engine_errc(status));
+}
+
 ENGINE_ERROR_CODE EventuallyPersistentEngine::storeInner(
         const void* cookie,
         Item& itm,
@@ -2623,6 +2963,10 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doEngineStats(
                         flusher->stateName(), add_stat, cookie);
         add_casted_stat("ep_flusher_todo",
                         epstats.flusher_todo, add_stat, cookie);
+        add_casted_stat("ep_flusher_durable_prepare_flushes",
+                        epstats.flusherDurablePrepareFlushes,
+                        add_stat,
+                        cookie);
         add_casted_stat("ep_total_persisted",
                         epstats.totalPersisted, add_stat, cookie);
         add_casted_stat("ep_uncommitted_items",
@@ -2638,6 +2982,14 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doEngineStats(
                     epstats.vbucketDeletionFail, add_stat, cookie);
     add_casted_stat("ep_flush_duration_total",
                     epstats.cumulativeFlushTime, add_stat, cookie);
+    add_casted_stat("ep_flush_fetch_time_ns_total",
+                    epstats.flushFetchTime, add_stat, cookie);
+    add_casted_stat("ep_flush_set_time_ns_total",
+                    epstats.flushSetTime, add_stat, cookie);
+    add_casted_stat("ep_flush_commit_time_ns_total",
+                    epstats.flushCommitTime, add_stat, cookie);
+    add_casted_stat("ep_flush_callback_time_ns_total",
+                    epstats.flushCallbackTime, add_stat, cookie);
 
     kvBucket->getAggregatedVBucketStats(cookie, add_stat);
 
@@ -2859,6 +3211,36 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doEngineStats(
                     workload->stringOfWorkLoadPattern(),
                     add_stat, cookie);
 
+    add_casted_stat("ep_hot_key_cache_hits",
+                    kvBucket->getHotKeyCache().getNumHits(),
+                    add_stat,
+                    cookie);
+    add_casted_stat("ep_hot_key_cache_items",
+                    kvBucket->getHotKeyCache().getNumItems(),
+                    add_stat,
+                    cookie);
+    const auto& decompressedValueCache = kvBucket->getDecompressedValueCache();
+    add_casted_stat("ep_decompressed_value_cache_hits",
+                    decompressedValueCache.getHits(),
+                    add_stat,
+                    cookie);
+    add_casted_stat("ep_decompressed_value_cache_mem_used",
+                    decompressedValueCache.getSize(),
+                    add_stat,
+                    cookie);
+    add_casted_stat("ep_decompressed_value_cache_misses",
+                    decompressedValueCache.getMisses(),
+                    add_stat,
+                    cookie);
+    add_casted_stat("ep_stat_group_cache_hits",
+                    statGroupCache.getHits(),
+                    add_stat,
+                    cookie);
+    add_casted_stat("ep_stat_group_cache_misses",
+                    statGroupCache.getMisses(),
+                    add_stat,
+                    cookie);
+
     add_casted_stat("ep_defragmenter_num_visited", epstats.defragNumVisited,
                     add_stat, cookie);
     add_casted_stat("ep_defragmenter_num_moved", epstats.defragNumMoved,
@@ -2867,6 +3249,10 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doEngineStats(
                     epstats.defragStoredValueNumMoved,
                     add_stat,
                     cookie);
+    add_casted_stat("ep_defragmenter_num_skipped",
+                    epstats.defragNumSkipped,
+                    add_stat,
+                    cookie);
 
     add_casted_stat("ep_item_compressor_num_visited",
                     epstats.compressorNumVisited,
@@ -2876,6 +3262,14 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doEngineStats(
                     epstats.compressorNumCompressed,
                     add_stat,
                     cookie);
+    add_casted_stat("ep_item_compressor_num_rejected",
+                    epstats.compressorNumRejected,
+                    add_stat,
+                    cookie);
+    add_casted_stat("ep_item_compressor_bytes_saved",
+                    epstats.compressorBytesSaved,
+                    add_stat,
+                    cookie);
 
     add_casted_stat("ep_cursor_dropping_lower_threshold",
                     epstats.cursorDroppingLThreshold, add_stat, cookie);
@@ -3100,6 +3494,22 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doMemoryStats(
             "ep_storedval_num", stats.getNumStoredVal(), add_stat, cookie);
     add_casted_stat("ep_item_num", stats.getNumItem(), add_stat, cookie);
 
+    allocator_stats arenaStats = {};
+    if (arena.getStats(arenaStats)) {
+        add_casted_stat("ep_arena_allocated",
+                        arenaStats.allocated_size,
+                        add_stat,
+                        cookie);
+        add_casted_stat(
+                "ep_arena_resident", arenaStats.resident_size, add_stat, cookie);
+        add_casted_stat("ep_arena_fragmentation",
+                        arenaStats.fragmentation_size,
+                        add_stat,
+                        cookie);
+        add_casted_stat(
+                "ep_arena_retained", arenaStats.retained_size, add_stat, cookie);
+    }
+
     std::map<std::string, size_t> alloc_stats;
     MemoryTracker::getInstance(*getServerApiFunc()->alloc_hooks)->
         getAllocatorStats(alloc_stats);
@@ -3697,6 +4107,14 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doDcpStats(
                     dcpConnMap_->getNumActiveSnoozingBackfills(), add_stat, cookie);
     add_casted_stat("ep_dcp_max_running_backfills",
                     dcpConnMap_->getMaxActiveSnoozingBackfills(), add_stat, cookie);
+    add_casted_stat("ep_dcp_backfill_node_bytes_read",
+                    BackfillGovernor::get().getBytesRead(),
+                    add_stat,
+                    cookie);
+    add_casted_stat("ep_dcp_backfill_node_total_weight",
+                    BackfillGovernor::get().getTotalWeight(),
+                    add_stat,
+                    cookie);
 
     dcpConnMap_->addStats(add_stat, cookie);
     return ENGINE_SUCCESS;
@@ -3907,6 +4325,72 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doRunTimeStats(
     return ENGINE_SUCCESS;
 }
 
+ENGINE_ERROR_CODE EventuallyPersistentEngine::doTaskProfileStats(
+        const void* cookie, const AddStatFn& add_stat) {
+    char statname[80] = {0};
+    for (TaskId id : GlobalTask::allTaskIds) {
+        const auto idx = static_cast<int>(id);
+        auto& runtimes = stats.taskRuntimeHisto[idx];
+        const auto runs = runtimes.getValueCount();
+        if (runs == 0) {
+            continue;
+        }
+        const auto prefix = getTaskDescrForStats(id);
+        const auto add = [&](const char* name, uint64_t value) {
+            checked_snprintf(
+                    statname, sizeof(statname), "%s:%s", prefix.c_str(), name);
+            add_casted_stat(statname, value, add_stat, cookie);
+        };
+        add("runs", runs);
+        add("total_runtime_us", stats.taskTotalRuntime[idx]);
+        add("runtime_p50_us", runtimes.getValueAtPercentile(50));
+        add("runtime_p99_us", runtimes.getValueAtPercentile(99));
+        add("runtime_max_us", runtimes.getMaxValue());
+        auto& scheduling = stats.schedulingHisto[idx];
+        add("scheduling_p50_us", scheduling.getValueAtPercentile(50));
+        add("scheduling_p99_us", scheduling.getValueAtPercentile(99));
+        add("scheduling_max_us", scheduling.getMaxValue());
+        add("slow_runs", stats.taskSlowRuns[idx]);
+    }
+
+    return ENGINE_SUCCESS;
+}
+
+ENGINE_ERROR_CODE EventuallyPersistentEngine::doTaskTimingsStats(
+        const void* cookie,
+        const AddStatFn& add_stat,
+        const std::string& statKey) {
+    // "task-timings <runtime|scheduling> <task name>"; the histogram is
+    // returned as JSON with an empty key, as mctimings expects.
+    std::istringstream args(statKey.substr(strlen("task-timings ")));
+    std::string which;
+    args >> which;
+    std::string name;
+    std::getline(args >> std::ws, name);
+
+    std::vector<Hdr1sfMicroSecHistogram>* histos;
+    if (which == "runtime") {
+        histos = &stats.taskRuntimeHisto;
+    } else if (which == "scheduling") {
+        histos = &stats.schedulingHisto;
+    } else {
+        return ENGINE_EINVAL;
+    }
+
+    for (TaskId id : GlobalTask::allTaskIds) {
+        if (name == GlobalTask::getTaskName(id)) {
+            const auto json = (*histos)[static_cast<int>(id)].to_string();
+            add_stat(nullptr,
+                     0,
+                     json.data(),
+                     gsl::narrow<uint32_t>(json.size()),
+                     cookie);
+            return ENGINE_SUCCESS;
+        }
+    }
+    return ENGINE_KEY_ENOENT;
+}
+
 ENGINE_ERROR_CODE EventuallyPersistentEngine::doDispatcherStats(
         const void* cookie, const AddStatFn& add_stat) {
     ExecutorPool::get()->doWorkerStat(ObjectRegistry::getCurrentEngine(),
@@ -4129,6 +4613,12 @@ void EventuallyPersistentEngine::addLookupAllKeys(const void *cookie,
     allKeysLookups[cookie] = err;
 }
 
+void EventuallyPersistentEngine::addGetMultiResult(const void* cookie,
+                                                   std::vector<char> value) {
+    LockHolder lh(lookupMutex);
+    getMultiResults[cookie] = std::move(value);
+}
+
 void EventuallyPersistentEngine::runDefragmenterTask(void) {
     kvBucket->runDefragmenterTask();
 }
@@ -4176,7 +4666,15 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::getStats(
 
     ENGINE_ERROR_CODE rv = ENGINE_KEY_ENOENT;
     if (statKey.empty()) {
-        rv = doEngineStats(cookie, add_stat);
+        // The engine and vbucket-details stats visit every vbucket, so
+        // their output may be reused by the requests polling them
+        rv = statGroupCache.addStats(
+                statKey,
+                cookie,
+                add_stat,
+                [this](const void* c, const AddStatFn& add) {
+                    return doEngineStats(c, add);
+                });
     } else if (nkey > 7 && cb_isPrefix(statKey, "dcpagg ")) {
         rv = doConnAggStats(cookie, add_stat, stat_key + 7, nkey - 7);
     } else if (statKey == "dcp") {
@@ -4188,7 +4686,13 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::getStats(
     } else if (statKey == "vbucket") {
         rv = doVBucketStats(cookie, add_stat, stat_key, nkey, false, false);
     } else if (cb_isPrefix(statKey, "vbucket-details")) {
-        rv = doVBucketStats(cookie, add_stat, stat_key, nkey, false, true);
+        rv = statGroupCache.addStats(
+                statKey,
+                cookie,
+                add_stat,
+                [this, stat_key, nkey](const void* c, const AddStatFn& add) {
+                    return doVBucketStats(c, add, stat_key, nkey, false, true);
+                });
     } else if (cb_isPrefix(statKey, "vbucket-seqno")) {
         rv = doSeqnoStats(cookie, add_stat, stat_key, nkey);
     } else if (statKey == "prev-vbucket") {
@@ -4207,6 +4711,16 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::getStats(
         rv = doSchedulerStats(cookie, add_stat);
     } else if (statKey == "runtimes") {
         rv = doRunTimeStats(cookie, add_stat);
+    } else if (statKey == "task-profile") {
+        rv = doTaskProfileStats(cookie, add_stat);
+    } else if (cb_isPrefix(statKey, "task-timings ")) {
+        rv = doTaskTimingsStats(cookie, add_stat, statKey);
+    } else if (statKey == "lock-profile") {
+        stats.lockProfiler.addStats(add_stat, cookie);
+        rv = ENGINE_SUCCESS;
+    } else if (statKey == "lock-profile reset") {
+        stats.lockProfiler.reset();
+        rv = ENGINE_SUCCESS;
     } else if (statKey == "memory") {
         rv = doMemoryStats(cookie, add_stat);
     } else if (statKey == "uuid") {
@@ -4356,6 +4870,7 @@ void EventuallyPersistentEngine::resetStats() {
     if (kvBucket) {
         kvBucket->resetUnderlyingStats();
     }
+    statGroupCache.clear();
 }
 
 ENGINE_ERROR_CODE EventuallyPersistentEngine::observe(
@@ -4788,34 +5303,46 @@ bool EventuallyPersistentEngine::decodeWithMetaOptions(
         CheckConflicts& checkConflicts,
         PermittedVBStates& permittedVBStates,
         DeleteSource& deleteSource) {
-    bool forceFlag = false;
+    uint32_t options = 0;
     if (extras.size() == 28 || extras.size() == 30) {
         const size_t fixed_extras_size = 24;
-        uint32_t options;
         memcpy(&options, extras.data() + fixed_extras_size, sizeof(options));
         options = ntohl(options);
+    }
+    return decodeWithMetaOptions(options,
+                                 generateCas,
+                                 checkConflicts,
+                                 permittedVBStates,
+                                 deleteSource);
+}
 
-        if (options & SKIP_CONFLICT_RESOLUTION_FLAG) {
-            checkConflicts = CheckConflicts::No;
-        }
+bool EventuallyPersistentEngine::decodeWithMetaOptions(
+        uint32_t options,
+        GenerateCas& generateCas,
+        CheckConflicts& checkConflicts,
+        PermittedVBStates& permittedVBStates,
+        DeleteSource& deleteSource) {
+    bool forceFlag = false;
+    if (options & SKIP_CONFLICT_RESOLUTION_FLAG) {
+        checkConflicts = CheckConflicts::No;
+    }
 
-        if (options & FORCE_ACCEPT_WITH_META_OPS) {
-            forceFlag = true;
-        }
+    if (options & FORCE_ACCEPT_WITH_META_OPS) {
+        forceFlag = true;
+    }
 
-        if (options & REGENERATE_CAS) {
-            generateCas = GenerateCas::Yes;
-        }
+    if (options & REGENERATE_CAS) {
+        generateCas = GenerateCas::Yes;
+    }
 
-        if (options & FORCE_WITH_META_OP) {
-            permittedVBStates.set(vbucket_state_replica);
-            permittedVBStates.set(vbucket_state_pending);
-            checkConflicts = CheckConflicts::No;
-        }
+    if (options & FORCE_WITH_META_OP) {
+        permittedVBStates.set(vbucket_state_replica);
+        permittedVBStates.set(vbucket_state_pending);
+        checkConflicts = CheckConflicts::No;
+    }
 
-        if (options & IS_EXPIRATION) {
-            deleteSource = DeleteSource::TTL;
-        }
+    if (options & IS_EXPIRATION) {
+        deleteSource = DeleteSource::TTL;
     }
 
     // Validate options
@@ -4869,8 +5396,7 @@ protocol_binary_datatype_t EventuallyPersistentEngine::checkForDatatypeJson(
             body = cb::xattr::get_body(body);
         }
 
-        if (checkUTF8JSON(reinterpret_cast<const uint8_t*>(body.data()),
-                          body.size())) {
+        if (cb::json::isValid(body)) {
             datatype |= PROTOCOL_BINARY_DATATYPE_JSON;
         }
     }
@@ -5008,35 +5534,17 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::setWithMeta(
     return sendErrorResponse(response, cb::mcbp::Status::Success, cas, cookie);
 }
 
-ENGINE_ERROR_CODE EventuallyPersistentEngine::setWithMeta(
+std::unique_ptr<Item> EventuallyPersistentEngine::makeItemWithMeta(
+        const void* cookie,
         Vbid vbucket,
         DocKey key,
         cb::const_byte_buffer value,
         ItemMetaData itemMeta,
         bool isDeleted,
-        protocol_binary_datatype_t datatype,
-        uint64_t& cas,
-        uint64_t* seqno,
-        const void* cookie,
-        PermittedVBStates permittedVBStates,
-        CheckConflicts checkConflicts,
-        bool allowExisting,
-        GenerateBySeqno genBySeqno,
-        GenerateCas genCas,
-        cb::const_byte_buffer emd) {
-    std::unique_ptr<ExtendedMetaData> extendedMetaData;
-    if (!emd.empty()) {
-        extendedMetaData =
-                std::make_unique<ExtendedMetaData>(emd.data(), emd.size());
-        if (extendedMetaData->getStatus() == ENGINE_EINVAL) {
-            setErrorContext(cookie, "Invalid extended metadata");
-            return ENGINE_EINVAL;
-        }
-    }
-
+        protocol_binary_datatype_t datatype) {
     if (!isDatatypeSupported(cookie, PROTOCOL_BINARY_DATATYPE_SNAPPY) &&
             mcbp::datatype::is_snappy(datatype)) {
-        return ENGINE_EINVAL;
+        return {};
     }
 
     cb::const_char_buffer payload(reinterpret_cast<const char*>(value.data()),
@@ -5048,7 +5556,7 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::setWithMeta(
     if (mcbp::datatype::is_snappy(datatype)) {
         if (!cb::compression::inflate(cb::compression::Algorithm::Snappy,
                                       payload, uncompressedValue)) {
-            return ENGINE_EINVAL;
+            return {};
         }
 
         if (compressionMode == BucketCompressionMode::Off) {
@@ -5074,6 +5582,40 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::setWithMeta(
     if (isDeleted) {
         item->setDeleted();
     }
+    return item;
+}
+
+ENGINE_ERROR_CODE EventuallyPersistentEngine::setWithMeta(
+        Vbid vbucket,
+        DocKey key,
+        cb::const_byte_buffer value,
+        ItemMetaData itemMeta,
+        bool isDeleted,
+        protocol_binary_datatype_t datatype,
+        uint64_t& cas,
+        uint64_t* seqno,
+        const void* cookie,
+        PermittedVBStates permittedVBStates,
+        CheckConflicts checkConflicts,
+        bool allowExisting,
+        GenerateBySeqno genBySeqno,
+        GenerateCas genCas,
+        cb::const_byte_buffer emd) {
+    std::unique_ptr<ExtendedMetaData> extendedMetaData;
+    if (!emd.empty()) {
+        extendedMetaData =
+                std::make_unique<ExtendedMetaData>(emd.data(), emd.size());
+        if (extendedMetaData->getStatus() == ENGINE_EINVAL) {
+            setErrorContext(cookie, "Invalid extended metadata");
+            return ENGINE_EINVAL;
+        }
+    }
+
+    auto item = makeItemWithMeta(
+            cookie, vbucket, key, value, itemMeta, isDeleted, datatype);
+    if (!item) {
+        return ENGINE_EINVAL;
+    }
     auto ret = kvBucket->setWithMeta(*item,
                                      cas,
                                      seqno,
@@ -5237,7 +5779,7 @@ EventuallyPersistentEngine::handleTrafficControlCmd(
         const AddResponseFn& response) {
     switch (request.getClientOpcode()) {
     case cb::mcbp::ClientOpcode::EnableTraffic:
-        if (kvBucket->isWarmingUp()) {
+        if (kvBucket->isWarmingUp() && !kvBucket->isWarmupTrafficReady()) {
             // engine is still warming up, do not turn on data traffic yet
             setErrorContext(cookie, "Persistent engine is still warming up!");
             return ENGINE_TMPFAIL;
@@ -5295,7 +5837,8 @@ EventuallyPersistentEngine::handleTrafficControlCmd(
 }
 
 bool EventuallyPersistentEngine::isDegradedMode() const {
-    return kvBucket->isWarmingUp() || !trafficEnabled.load();
+    return (kvBucket->isWarmingUp() && !kvBucket->isWarmupTrafficReady()) ||
+           !trafficEnabled.load();
 }
 
 ENGINE_ERROR_CODE
@@ -5467,32 +6010,33 @@ EventuallyPersistentEngine::returnMeta(const void* cookie,
  *
  * This initially allocated buffersize is doubled whenever the length
  * of the buffer holding all the keys, crosses the buffersize.
+ *
+ * Only the keys of the start key's collection are returned (the default
+ * collection's if collections aren't supported). A collection's keys are
+ * contiguous on disk, so the scan is ended at the first key of another.
  */
-class AllKeysCallback : public Callback<const DiskDocKey&> {
+class AllKeysCallback : public StatusCallback<const DiskDocKey&> {
 public:
-    AllKeysCallback(bool collectionsSupported)
-        : collectionsSupported(collectionsSupported) {
+    AllKeysCallback(bool collectionsSupported, CollectionID collection)
+        : collectionsSupported(collectionsSupported), collection(collection) {
         buffer.reserve((avgKeySize + sizeof(uint16_t)) * expNumKeys);
     }
 
     void callback(const DiskDocKey& key) {
         auto outKey = key.getDocKey();
-        if (outKey.isPrivate() || key.isPrepared()) {
-            // Skip system-event and durability-prepared keys
+        if (key.isPrepared() || outKey.getCollectionID() != collection) {
+            // Past the collection's keys (durability-prepared keys are in
+            // their own namespace)
+            setStatus(ENGINE_KEY_ENOENT);
             return;
         }
 
         if (!collectionsSupported) {
-            if (outKey.getCollectionID().isDefaultCollection()) {
-                outKey = outKey.makeDocKeyWithoutCollectionID();
-            } else {
-                // Only default collection key can be sent back if
-                // collectionsSupported is false
-                return;
-            }
+            outKey = outKey.makeDocKeyWithoutCollectionID();
         }
 
-        if (buffer.size() + outKey.size() + sizeof(uint16_t) > buffer.size()) {
+        if (buffer.size() + outKey.size() + sizeof(uint16_t) >
+            buffer.capacity()) {
             // Reserve the 2x space for the copy-to buffer.
             buffer.reserve(buffer.size()*2);
         }
@@ -5511,6 +6055,7 @@ public:
 private:
     std::vector<char> buffer;
     bool collectionsSupported{false};
+    CollectionID collection;
     static const int avgKeySize = 32;
     static const int expNumKeys = 1000;
 };
@@ -5568,7 +6113,9 @@ public:
                                0,
                                cookie);
         } else {
-            auto cb = std::make_shared<AllKeysCallback>(collectionsSupported);
+            auto cb = std::make_shared<AllKeysCallback>(
+                    collectionsSupported,
+                    start_key.getDocKey().getCollectionID());
             err = engine->getKVBucket()->getROUnderlying(vbid)->getAllKeys(
                                                     vbid, start_key, count, cb);
             if (err == ENGINE_SUCCESS) {
@@ -5650,146 +6197,1527 @@ EventuallyPersistentEngine::getAllKeys(const void* cookie,
     return ENGINE_EWOULDBLOCK;
 }
 
-CONN_PRIORITY EventuallyPersistentEngine::getDCPPriority(const void* cookie) {
-    NonBucketAllocationGuard guard;
-    auto priority = serverApi->cookie->get_priority(cookie);
-    return priority;
-}
+/**
+ * Callback of the RangeScanTask, which adds the documents of the range to
+ * the response (see RangeScanPayload for the format).
+ *
+ * The disk is behind memory, so a document which is resident is returned
+ * as it is in memory, and one which has been deleted is skipped.
+ */
+class RangeScanCallback : public StatusCallback<GetValue> {
+public:
+    RangeScanCallback(VBucket& vb,
+                      bool keysOnly,
+                      bool collectionsSupported,
+                      uint32_t count)
+        : vb(vb),
+          keysOnly(keysOnly),
+          collectionsSupported(collectionsSupported),
+          count(count) {
+    }
+
+    void callback(GetValue& val) override {
+        std::unique_ptr<Item> doc = std::move(val.item);
+        {
+            auto res = vb.ht.findForRead(
+                    doc->getKey(), TrackReference::No, WantsDeleted::Yes);
+            const auto* v = res.storedValue;
+            if (v) {
+                if (v->isDeleted() || v->isTempItem()) {
+                    return;
+                }
+                if (v->isResident()) {
+                    doc = v->toItem(vb.getId(),
+                                    StoredValue::HideLockedCas::No,
+                                    keysOnly ? StoredValue::IncludeValue::No
+                                             : StoredValue::IncludeValue::Yes);
+                }
+            }
+        }
+        if ((doc->getExptime() != 0 && doc->getExptime() < ep_real_time()) ||
+            vb.lockCollections().isLogicallyDeleted(doc->getKey(),
+                                                    doc->getBySeqno())) {
+            return;
+        }
 
-void EventuallyPersistentEngine::setDCPPriority(const void* cookie,
-                                                CONN_PRIORITY priority) {
-    NonBucketAllocationGuard guard;
-    serverApi->cookie->set_priority(cookie, priority);
-}
+        add(*doc);
+        if (++found == count) {
+            // Done, end the scan
+            setStatus(ENGINE_KEY_EEXISTS);
+        }
+    }
 
-void EventuallyPersistentEngine::notifyIOComplete(const void* cookie,
-                                                  ENGINE_ERROR_CODE status) {
-    if (cookie == NULL) {
-        EP_LOG_WARN("Tried to signal a NULL cookie!");
-    } else {
-        HdrMicroSecBlockTimer bt(&stats.notifyIOHisto);
-        NonBucketAllocationGuard guard;
-        serverApi->cookie->notify_io_complete(cookie, status);
+    cb::const_char_buffer getValue() const {
+        return {buffer.data(), buffer.size()};
     }
-}
 
-ENGINE_ERROR_CODE EventuallyPersistentEngine::getRandomKey(
-        const void* cookie, const AddResponseFn& response) {
-    GetValue gv(kvBucket->getRandomKey());
-    ENGINE_ERROR_CODE ret = gv.getStatus();
+private:
+    void add(Item& doc) {
+        DocKey key = doc.getKey();
+        if (!collectionsSupported) {
+            key = key.makeDocKeyWithoutCollectionID();
+        }
 
-    if (ret == ENGINE_SUCCESS) {
-        Item* it = gv.item.get();
-        uint32_t flags = it->getFlags();
-        ret = sendResponse(response,
-                           static_cast<const void*>(it->getKey().data()),
-                           it->getKey().size(),
-                           (const void*)&flags,
-                           sizeof(uint32_t),
-                           static_cast<const void*>(it->getData()),
-                           it->getNBytes(),
-                           it->getDataType(),
-                           cb::mcbp::Status::Success,
-                           it->getCas(),
-                           cookie);
+        cb::const_char_buffer value;
+        uint8_t datatype = doc.getDataType();
+        if (!keysOnly && doc.decompressValue()) {
+            value = {doc.getData(), doc.getNBytes()};
+            if (mcbp::datatype::is_xattr(datatype)) {
+                value = cb::xattr::get_body(value);
+            }
+        }
+        datatype &= ~(PROTOCOL_BINARY_DATATYPE_SNAPPY |
+                      PROTOCOL_BINARY_DATATYPE_XATTR);
+
+        const uint16_t keylen = htons(uint16_t(key.size()));
+        const uint32_t valuelen = htonl(uint32_t(value.size()));
+        const auto* keylenPtr = reinterpret_cast<const char*>(&keylen);
+        const auto* valuelenPtr = reinterpret_cast<const char*>(&valuelen);
+        buffer.insert(buffer.end(), keylenPtr, keylenPtr + sizeof(keylen));
+        buffer.push_back(char(datatype));
+        buffer.insert(
+                buffer.end(), valuelenPtr, valuelenPtr + sizeof(valuelen));
+        buffer.insert(buffer.end(), key.data(), key.data() + key.size());
+        buffer.insert(buffer.end(), value.data(), value.data() + value.size());
     }
 
-    return ret;
-}
+    VBucket& vb;
+    const bool keysOnly;
+    const bool collectionsSupported;
+    const uint32_t count;
+    uint32_t found = 0;
+    std::vector<char> buffer;
+};
 
-ENGINE_ERROR_CODE EventuallyPersistentEngine::dcpOpen(
-        const void* cookie,
-        uint32_t opaque,
-        uint32_t seqno,
-        uint32_t flags,
-        cb::const_char_buffer stream_name,
-        cb::const_char_buffer value) {
-    (void) opaque;
-    (void) seqno;
-    std::string connName = cb::to_string(stream_name);
+/*
+ * Task that reads the documents of a key range from disk and returns the
+ * response, runs in background.
+ */
+class RangeScanTask : public GlobalTask {
+public:
+    RangeScanTask(EventuallyPersistentEngine* e,
+                  const void* c,
+                  const AddResponseFn& resp,
+                  const DiskDocKey& startKey,
+                  const DiskDocKey& endKey,
+                  Vbid vbucket,
+                  uint32_t count,
+                  bool keysOnly,
+                  bool collectionsSupported)
+        : GlobalTask(e, TaskId::RangeScanTask, 0, false),
+          engine(e),
+          cookie(c),
+          description("Running a range scan on " + vbucket.to_string()),
+          response(resp),
+          startKey(startKey),
+          endKey(endKey),
+          vbid(vbucket),
+          count(count),
+          keysOnly(keysOnly),
+          collectionsSupported(collectionsSupported) {
+    }
 
-    if (getEngineSpecific(cookie) != NULL) {
-        EP_LOG_WARN(
-                "Cannot open DCP connection as another"
-                " connection exists on the same socket");
-        return ENGINE_DISCONNECT;
+    std::string getDescription() {
+        return description;
     }
 
-    ConnHandler *handler = NULL;
-    if (flags & (cb::mcbp::request::DcpOpenPayload::Producer |
-                 cb::mcbp::request::DcpOpenPayload::Notifier)) {
-        handler = dcpConnMap_->newProducer(cookie, connName, flags);
-    } else {
-        // dont accept dcp consumer open requests during warm up
-        if (!kvBucket->isWarmingUp()) {
-            // Check if consumer_name specified in value; if so use in Consumer
-            // object.
-            nlohmann::json jsonValue;
-            std::string consumerName;
-            if (!value.empty()) {
-                jsonValue = nlohmann::json::parse(value);
-                consumerName = jsonValue.at("consumer_name").get<std::string>();
-            }
-            handler = dcpConnMap_->newConsumer(cookie, connName, consumerName);
+    std::chrono::microseconds maxExpectedDuration() {
+        // As FetchAllKeysTask, a function of how many documents are read
+        return std::chrono::milliseconds(100);
+    }
 
-            EP_LOG_INFO(
-                    "EventuallyPersistentEngine::dcpOpen: opening new DCP "
-                    "Consumer handler - stream name:{}, opaque:{}, seqno:{}, "
-                    "flags:0b{} value:{}",
-                    connName,
-                    opaque,
-                    seqno,
-                    std::bitset<sizeof(flags) * 8>(flags).to_string(),
-                    jsonValue.dump());
+    bool run() {
+        TRACE_EVENT0("ep-engine/task", "RangeScanTask");
+        ENGINE_ERROR_CODE err = ENGINE_SUCCESS;
+        auto vb = engine->getVBucket(vbid);
+        if (!vb) {
+            err = ENGINE_NOT_MY_VBUCKET;
+        } else if (vb->isBucketCreation()) {
+            // No documents until the vbucket file has been created
+            err = sendResponse(response,
+                               NULL,
+                               0,
+                               NULL,
+                               0,
+                               NULL,
+                               0,
+                               PROTOCOL_BINARY_RAW_BYTES,
+                               cb::mcbp::Status::Success,
+                               0,
+                               cookie);
         } else {
-            EP_LOG_WARN(
-                    "EventuallyPersistentEngine::dcpOpen: not opening new DCP "
-                    "Consumer handler as EPEngine is still warming up");
-            return ENGINE_TMPFAIL;
+            auto cb = std::make_shared<RangeScanCallback>(
+                    *vb, keysOnly, collectionsSupported, count);
+            err = engine->getKVBucket()->getROUnderlying(vbid)->scanRange(
+                    vbid,
+                    startKey,
+                    endKey,
+                    keysOnly ? ValueFilter::KEYS_ONLY
+                             : ValueFilter::VALUES_DECOMPRESSED,
+                    cb);
+            if (err == ENGINE_SUCCESS) {
+                const auto value = cb->getValue();
+                err = sendResponse(response,
+                                   NULL,
+                                   0,
+                                   NULL,
+                                   0,
+                                   value.data(),
+                                   value.size(),
+                                   PROTOCOL_BINARY_RAW_BYTES,
+                                   cb::mcbp::Status::Success,
+                                   0,
+                                   cookie);
+            }
         }
+        // The result is collected with the all keys lookups (one per cookie)
+        engine->addLookupAllKeys(cookie, err);
+        engine->notifyIOComplete(cookie, err);
+        return false;
     }
 
-    if (handler == nullptr) {
-        EP_LOG_WARN("EPEngine::dcpOpen: failed to create a handler");
-        return ENGINE_DISCONNECT;
+private:
+    EventuallyPersistentEngine* engine;
+    const void* cookie;
+    const std::string description;
+    AddResponseFn response;
+    DiskDocKey startKey;
+    DiskDocKey endKey;
+    Vbid vbid;
+    uint32_t count;
+    bool keysOnly;
+    bool collectionsSupported;
+};
+
+ENGINE_ERROR_CODE
+EventuallyPersistentEngine::rangeScan(const void* cookie,
+                                      const cb::mcbp::Request& request,
+                                      const AddResponseFn& response) {
+    if (!getKVBucket()->isGetAllKeysSupported()) {
+        return ENGINE_ENOTSUP;
     }
 
-    // Success creating dcp object which has stored the cookie, now reserve it.
-    if (reserveCookie(cookie) != ENGINE_SUCCESS) {
-        EP_LOG_WARN(
-                "Cannot create DCP connection because cookie "
-                "cannot be reserved");
-        return ENGINE_DISCONNECT;
+    {
+        LockHolder lh(lookupMutex);
+        auto it = allKeysLookups.find(cookie);
+        if (it != allKeysLookups.end()) {
+            ENGINE_ERROR_CODE err = it->second;
+            allKeysLookups.erase(it);
+            return err;
+        }
     }
 
-    storeEngineSpecific(cookie, handler);
+    VBucketPtr vb = getVBucket(request.getVBucket());
+    if (!vb) {
+        return ENGINE_NOT_MY_VBUCKET;
+    }
 
-    return ENGINE_SUCCESS;
-}
+    folly::SharedMutex::ReadHolder rlh(vb->getStateLock());
+    if (vb->getState() != vbucket_state_active) {
+        return ENGINE_NOT_MY_VBUCKET;
+    }
 
-ENGINE_ERROR_CODE EventuallyPersistentEngine::dcpAddStream(const void* cookie,
-                                                           uint32_t opaque,
-                                                           Vbid vbucket,
-                                                           uint32_t flags) {
-    ENGINE_ERROR_CODE errCode = ENGINE_DISCONNECT;
-    ConnHandler* conn = getConnHandler(cookie);
-    if (conn) {
-        errCode = dcpConnMap_->addPassiveStream(*conn, opaque, vbucket, flags);
+    using cb::mcbp::request::RangeScanPayload;
+    const auto* payload = reinterpret_cast<const RangeScanPayload*>(
+            request.getExtdata().data());
+
+    DocKey startKey = makeDocKey(cookie, request.getKey());
+    {
+        auto cHandle = vb->lockCollections(startKey);
+        if (!cHandle.valid()) {
+            setErrorJsonExtras(cookie,
+                               Collections::getUnknownCollectionErrorContext(
+                                       cHandle.getManifestUid()));
+            return ENGINE_UNKNOWN_COLLECTION;
+        }
     }
-    return errCode;
-}
 
-ConnHandler* EventuallyPersistentEngine::getConnHandler(const void *cookie) {
-    void* specific = getEngineSpecific(cookie);
-    ConnHandler* handler = reinterpret_cast<ConnHandler*>(specific);
-    if (!handler) {
-        EP_LOG_WARN("Invalid streaming connection");
+    DiskDocKey diskStartKey{startKey};
+    DiskDocKey diskEndKey{startKey};
+    auto value = request.getValue();
+    if (value.empty()) {
+        // The end of the collection: a collection's keys all start with
+        // its leb128 encoded ID, the last byte of which is below 0x80.
+        const auto prefix =
+                cb::mcbp::decode_unsigned_leb128<CollectionIDType>(
+                        {diskStartKey.data(), diskStartKey.size()});
+        std::string end(reinterpret_cast<const char*>(diskStartKey.data()),
+                        diskStartKey.size() - prefix.second.size());
+        end.back()++;
+        diskEndKey = DiskDocKey{end.data(), end.size()};
+    } else {
+        try {
+            DocKey endKey = makeDocKey(cookie, value);
+            if (endKey.getCollectionID() != startKey.getCollectionID()) {
+                setErrorContext(cookie,
+                                "The range must not span collections");
+                return ENGINE_EINVAL;
+            }
+            diskEndKey = DiskDocKey{endKey};
+        } catch (const std::invalid_argument&) {
+            setErrorContext(cookie, "Invalid end key");
+            return ENGINE_EINVAL;
+        }
     }
-    return handler;
+
+    ExTask task = std::make_shared<RangeScanTask>(
+            this,
+            cookie,
+            response,
+            diskStartKey,
+            diskEndKey,
+            request.getVBucket(),
+            payload->getCount(),
+            (payload->getFlags() & RangeScanPayload::KeysOnly) != 0,
+            isCollectionsSupported(cookie));
+    ExecutorPool::get()->schedule(task);
+    return ENGINE_EWOULDBLOCK;
 }
 
-void EventuallyPersistentEngine::handleDisconnect(const void *cookie) {
-    dcpConnMap_->disconnect(cookie);
+/**
+ * A key of a GetMulti request and the result of its lookup
+ */
+struct GetMultiEntry {
+    GetMultiEntry(Vbid vbid, StoredDocKey key)
+        : vbid(vbid), key(std::move(key)) {
+    }
+
+    Vbid vbid;
+    StoredDocKey key;
+    cb::mcbp::Status status = cb::mcbp::Status::Success;
+    /// The document, if found
+    std::unique_ptr<Item> item;
+    /// The document must be read from disk
+    bool fetch = false;
+};
+
+/**
+ * Make the value of the GetMulti response, holding one entry per key
+ * requested in the order requested:
+ *
+ *     16 bit status | 16 bit key length | 8 bit datatype | 32 bit flags |
+ *     64 bit cas | 32 bit value length | key | value
+ *
+ * As for RangeScan, values are decompressed and returned without their
+ * extended attributes.
+ */
+static std::vector<char> makeGetMultiValue(
+        const std::vector<GetMultiEntry>& entries, bool collectionsSupported) {
+    std::vector<char> buffer;
+    auto append = [&buffer](const void* data, size_t size) {
+        const auto* ptr = static_cast<const char*>(data);
+        buffer.insert(buffer.end(), ptr, ptr + size);
+    };
+
+    for (const auto& entry : entries) {
+        DocKey key = entry.key;
+        if (!collectionsSupported) {
+            key = key.makeDocKeyWithoutCollectionID();
+        }
+
+        auto status = entry.status;
+        uint8_t datatype = PROTOCOL_BINARY_RAW_BYTES;
+        uint32_t flags = 0;
+        uint64_t cas = 0;
+        cb::const_char_buffer value;
+        if (status == cb::mcbp::Status::Success) {
+            auto& doc = *entry.item;
+            datatype = doc.getDataType();
+            if (!doc.decompressValue()) {
+                status = cb::mcbp::Status::Einternal;
+            } else {
+                value = {doc.getData(), doc.getNBytes()};
+                if (mcbp::datatype::is_xattr(datatype)) {
+                    value = cb::xattr::get_body(value);
+                }
+                // The flags are stored as received (in network byte order)
+                flags = doc.getFlags();
+                cas = htonll(doc.getCas());
+            }
+            datatype &= ~(PROTOCOL_BINARY_DATATYPE_SNAPPY |
+                          PROTOCOL_BINARY_DATATYPE_XATTR);
+        }
+
+        const uint16_t statusNBO = htons(uint16_t(status));
+        const uint16_t keylen = htons(uint16_t(key.size()));
+        const uint32_t valuelen = htonl(uint32_t(value.size()));
+        append(&statusNBO, sizeof(statusNBO));
+        append(&keylen, sizeof(keylen));
+        buffer.push_back(char(datatype));
+        append(&flags, sizeof(flags));
+        append(&cas, sizeof(cas));
+        append(&valuelen, sizeof(valuelen));
+        append(key.data(), key.size());
+        append(value.data(), value.size());
+    }
+
+    return buffer;
+}
+
+/*
+ * Task that reads the GetMulti documents which aren't resident from disk
+ * (with one getMulti per vbucket, issued together) and returns the
+ * response, runs in background.
+ */
+class GetMultiTask : public GlobalTask {
+public:
+    GetMultiTask(EventuallyPersistentEngine* e,
+                 const void* c,
+                 std::vector<GetMultiEntry> entries,
+                 bool collectionsSupported)
+        : GlobalTask(e, TaskId::GetMultiTask, 0, false),
+          engine(e),
+          cookie(c),
+          entries(std::move(entries)),
+          collectionsSupported(collectionsSupported) {
+    }
+
+    std::string getDescription() {
+        return "Fetching the documents of a multi-get";
+    }
+
+    std::chrono::microseconds maxExpectedDuration() {
+        // As the BGFetcher, a function of how many documents are read
+        return std::chrono::milliseconds(100);
+    }
+
+    bool run() {
+        TRACE_EVENT0("ep-engine/task", "GetMultiTask");
+        const auto startTime = std::chrono::steady_clock::now();
+        auto& kvBucket = *engine->getKVBucket();
+
+        // Batch the reads by vbucket, and the vbuckets by their KVStore
+        std::map<Vbid, vb_bgfetch_queue_t> queues;
+        for (const auto& entry : entries) {
+            if (!entry.fetch) {
+                continue;
+            }
+            auto& ctx = queues[entry.vbid][DiskDocKey{entry.key}];
+            if (ctx.bgfetched_list.empty()) {
+                ctx.isMetaOnly = GetMetaOnly::No;
+                ctx.bgfetched_list.emplace_back(
+                        std::make_unique<VBucketBGFetchItem>(nullptr, false));
+                ctx.bgfetched_list.back()->value = &ctx.value;
+            }
+        }
+        std::map<KVStore*, std::vector<std::pair<Vbid, vb_bgfetch_queue_t>>>
+                fetches;
+        for (auto& queue : queues) {
+            fetches[kvBucket.getROUnderlying(queue.first)].emplace_back(
+                    queue.first, std::move(queue.second));
+        }
+
+        for (auto& fetch : fetches) {
+            fetch.first->getMultiParallel(
+                    fetch.second,
+                    [&kvBucket, startTime](Vbid vbid,
+                                           vb_bgfetch_queue_t& items) {
+                        // Make the documents resident, as a GET would
+                        auto vb = kvBucket.getVBucket(vbid);
+                        if (!vb) {
+                            return;
+                        }
+                        for (auto& item : items) {
+                            vb->completeBGFetchForSingleItem(
+                                    item.first,
+                                    *item.second.bgfetched_list.back(),
+                                    startTime);
+                        }
+                    });
+            for (auto& vbFetch : fetch.second) {
+                complete(vbFetch.first, vbFetch.second);
+            }
+        }
+
+        // The response is sent from the front end thread when the command
+        // is retried, where the connection is known to still be there
+        engine->addGetMultiResult(
+                cookie, makeGetMultiValue(entries, collectionsSupported));
+        engine->notifyIOComplete(cookie, ENGINE_SUCCESS);
+        return false;
+    }
+
+private:
+    /**
+     * Set the result of the keys of the vbucket which were read. Memory is
+     * ahead of the disk, so the document in memory is used if there is
+     * one. The vbucket (or the collection) may have gone away, or the
+     * vbucket may no longer be active, while we read; the keys fail as
+     * they would have in the lookup then.
+     */
+    void complete(Vbid vbid, vb_bgfetch_queue_t& items) {
+        auto vb = engine->getVBucket(vbid);
+        folly::SharedMutex::ReadHolder rlh(vb ? &vb->getStateLock() : nullptr);
+        if (!vb || vb->getState() != vbucket_state_active) {
+            for (auto& entry : entries) {
+                if (entry.fetch && entry.vbid == vbid) {
+                    entry.fetch = false;
+                    entry.status = cb::mcbp::Status::NotMyVbucket;
+                }
+            }
+            return;
+        }
+
+        auto cHandle = vb->lockCollections();
+        const auto now = ep_real_time();
+        for (auto& entry : entries) {
+            if (!entry.fetch || entry.vbid != vbid) {
+                continue;
+            }
+            entry.fetch = false;
+            if (!cHandle.exists(entry.key.getCollectionID())) {
+                entry.status = cb::mcbp::Status::UnknownCollection;
+                continue;
+            }
+            auto res = vb->ht.findForRead(
+                    entry.key, TrackReference::No, WantsDeleted::Yes);
+            const auto* v = res.storedValue;
+            if (v && !v->isTempInitialItem() && v->isResident()) {
+                if (v->isDeleted() || v->isTempItem() ||
+                    v->isExpired(now)) {
+                    entry.status = cb::mcbp::Status::KeyEnoent;
+                } else {
+                    entry.item = v->toItem(
+                            vbid,
+                            v->isLocked(ep_current_time())
+                                    ? StoredValue::HideLockedCas::Yes
+                                    : StoredValue::HideLockedCas::No);
+                }
+                continue;
+            }
+
+            auto& fetched = items[DiskDocKey{entry.key}].value;
+            if (fetched.getStatus() == ENGINE_SUCCESS && fetched.item &&
+                !fetched.item->isDeleted() &&
+                (fetched.item->getExptime() == 0 ||
+                 fetched.item->getExptime() >= now)) {
+                entry.item = std::make_unique<Item>(*fetched.item);
+            } else if (fetched.getStatus() == ENGINE_SUCCESS ||
+                       fetched.getStatus() == ENGINE_KEY_ENOENT) {
+                entry.status = cb::mcbp::Status::KeyEnoent;
+            } else {
+                entry.status = cb::mcbp::Status::Etmpfail;
+            }
+        }
+    }
+
+    EventuallyPersistentEngine* engine;
+    const void* cookie;
+    std::vector<GetMultiEntry> entries;
+    const bool collectionsSupported;
+};
+
+ENGINE_ERROR_CODE EventuallyPersistentEngine::getMulti(
+        const void* cookie,
+        const cb::mcbp::Request& request,
+        const AddResponseFn& response) {
+    {
+        std::unique_lock<std::mutex> lh(lookupMutex);
+        auto it = getMultiResults.find(cookie);
+        if (it != getMultiResults.end()) {
+            // Called again once the GetMultiTask read the documents
+            const auto value = std::move(it->second);
+            getMultiResults.erase(it);
+            lh.unlock();
+            return sendResponse(response,
+                                NULL,
+                                0,
+                                NULL,
+                                0,
+                                value.data(),
+                                value.size(),
+                                PROTOCOL_BINARY_RAW_BYTES,
+                                cb::mcbp::Status::Success,
+                                0,
+                                cookie);
+        }
+    }
+
+    // The value is a list of 16 bit vbucket | 16 bit key length | key (the
+    // framing was checked by the validator)
+    std::vector<GetMultiEntry> entries;
+    auto value = request.getValue();
+    try {
+        while (!value.empty()) {
+            uint16_t vbid;
+            uint16_t keylen;
+            std::memcpy(&vbid, value.data(), sizeof(vbid));
+            std::memcpy(&keylen, value.data() + sizeof(vbid), sizeof(keylen));
+            keylen = ntohs(keylen);
+            const auto* key = value.data() + sizeof(vbid) + sizeof(keylen);
+            entries.emplace_back(
+                    Vbid(ntohs(vbid)),
+                    StoredDocKey(makeDocKey(cookie, {key, keylen})));
+            const auto* next = key + keylen;
+            value = {next, value.size() - size_t(next - value.data())};
+        }
+    } catch (const std::invalid_argument&) {
+        setErrorContext(cookie, "Invalid key");
+        return ENGINE_EINVAL;
+    }
+
+    // Look the keys up a vbucket at a time, taking the vbucket's state and
+    // collections locks (and each hash table lock) once for all of its keys
+    std::vector<size_t> order(entries.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(
+            order.begin(), order.end(), [&entries](size_t a, size_t b) {
+                return entries[a].vbid < entries[b].vbid;
+            });
+
+    const auto eviction = kvBucket->getItemEvictionPolicy();
+    const auto now = ep_real_time();
+    bool fetch = false;
+    for (auto it = order.begin(); it != order.end();) {
+        const auto vbid = entries[*it].vbid;
+        const auto end =
+                std::find_if(it, order.end(), [&entries, vbid](size_t i) {
+                    return entries[i].vbid != vbid;
+                });
+
+        VBucketPtr vb = getVBucket(vbid);
+        folly::SharedMutex::ReadHolder rlh(vb ? &vb->getStateLock() : nullptr);
+        if (!vb || vb->getState() != vbucket_state_active) {
+            for (; it != end; ++it) {
+                entries[*it].status = cb::mcbp::Status::NotMyVbucket;
+            }
+            continue;
+        }
+
+        auto cHandle = vb->lockCollections();
+        std::vector<size_t> indexes;
+        std::vector<DocKey> keys;
+        for (; it != end; ++it) {
+            auto& entry = entries[*it];
+            if (!cHandle.exists(entry.key.getCollectionID())) {
+                entry.status = cb::mcbp::Status::UnknownCollection;
+            } else {
+                indexes.push_back(*it);
+                keys.push_back(entry.key);
+            }
+        }
+
+        vb->ht.findManyForRead(
+                keys,
+                TrackReference::Yes,
+                WantsDeleted::No,
+                [&](size_t index, const StoredValue* v) {
+                    auto& entry = entries[indexes[index]];
+                    if (!v) {
+                        // Only full eviction leaves documents on disk alone
+                        if (eviction == EvictionPolicy::Full &&
+                            vb->maybeKeyExistsInFilter(entry.key)) {
+                            entry.fetch = fetch = true;
+                        } else {
+                            entry.status = cb::mcbp::Status::KeyEnoent;
+                        }
+                    } else if (v->isPending()) {
+                        // A SyncWrite is being committed
+                        entry.status =
+                                cb::mcbp::Status::SyncWriteReCommitInProgress;
+                    } else if (v->isTempInitialItem()) {
+                        entry.fetch = fetch = true;
+                    } else if (v->isTempItem() || v->isExpired(now) ||
+                               cHandle.isLogicallyDeleted(entry.key,
+                                                          v->getBySeqno())) {
+                        entry.status = cb::mcbp::Status::KeyEnoent;
+                    } else if (!v->isResident()) {
+                        entry.fetch = fetch = true;
+                    } else {
+                        entry.item = v->toItem(
+                                vbid,
+                                v->isLocked(ep_current_time())
+                                        ? StoredValue::HideLockedCas::Yes
+                                        : StoredValue::HideLockedCas::No);
+                    }
+                });
+    }
+
+    const bool collectionsSupported = isCollectionsSupported(cookie);
+    if (fetch) {
+        ExTask task = std::make_shared<GetMultiTask>(this,
+                                                     cookie,
+                                                     std::move(entries),
+                                                     collectionsSupported);
+        ExecutorPool::get()->schedule(task);
+        return ENGINE_EWOULDBLOCK;
+    }
+
+    const auto result = makeGetMultiValue(entries, collectionsSupported);
+    return sendResponse(response,
+                        NULL,
+                        0,
+                        NULL,
+                        0,
+                        result.data(),
+                        result.size(),
+                        PROTOCOL_BINARY_RAW_BYTES,
+                        cb::mcbp::Status::Success,
+                        0,
+                        cookie);
+}
+
+/**
+ * A document of a SetMulti request and the result of its store
+ */
+struct SetMultiEntry {
+    explicit SetMultiEntry(Vbid vbid) : vbid(vbid) {
+    }
+
+    Vbid vbid;
+    /// The document to store (if it could be allocated)
+    std::unique_ptr<Item> item;
+    ENGINE_ERROR_CODE status = ENGINE_SUCCESS;
+};
+
+ENGINE_ERROR_CODE EventuallyPersistentEngine::setMulti(
+        const void* cookie,
+        const cb::mcbp::Request& request,
+        const AddResponseFn& response) {
+    {
+        std::unique_lock<std::mutex> lh(syncWriteBatchesMutex);
+        auto it = syncWriteBatches.find(cookie);
+        if (it != syncWriteBatches.end()) {
+            // Called again once all of the SyncWrites of the batch succeeded
+            const auto value = std::move(it->second.response);
+            syncWriteBatches.erase(it);
+            --numSyncWriteBatches;
+            lh.unlock();
+            return sendResponse(response,
+                                NULL,
+                                0,
+                                NULL,
+                                0,
+                                value.data(),
+                                value.size(),
+                                PROTOCOL_BINARY_RAW_BYTES,
+                                cb::mcbp::Status::Success,
+                                0,
+                                cookie);
+        }
+    }
+
+    if (isDegradedMode()) {
+        return ENGINE_TMPFAIL;
+    }
+
+    // The value is a list of 16 bit vbucket | 16 bit key length |
+    // 8 bit datatype | 32 bit flags | 32 bit expiration | 32 bit value length |
+    // key | value (the framing was checked by the validator)
+    const auto durability = request.getDurabilityRequirements();
+    std::vector<SetMultiEntry> entries;
+    auto value = request.getValue();
+    try {
+        while (!value.empty()) {
+            uint16_t vbid;
+            uint16_t keylen;
+            uint32_t flags;
+            uint32_t exptime;
+            uint32_t valuelen;
+            const auto* ptr = value.data();
+            std::memcpy(&vbid, ptr, sizeof(vbid));
+            ptr += sizeof(vbid);
+            std::memcpy(&keylen, ptr, sizeof(keylen));
+            ptr += sizeof(keylen);
+            const auto datatype = protocol_binary_datatype_t(*ptr);
+            ptr += sizeof(datatype);
+            // The flags are stored as received (in network byte order)
+            std::memcpy(&flags, ptr, sizeof(flags));
+            ptr += sizeof(flags);
+            std::memcpy(&exptime, ptr, sizeof(exptime));
+            ptr += sizeof(exptime);
+            std::memcpy(&valuelen, ptr, sizeof(valuelen));
+            ptr += sizeof(valuelen);
+            keylen = ntohs(keylen);
+            exptime = ntohl(exptime);
+            valuelen = ntohl(valuelen);
+            const auto* key = ptr;
+            const auto* data = key + keylen;
+            const auto* next = data + valuelen;
+            value = {next, value.size() - size_t(next - value.data())};
+
+            entries.emplace_back(Vbid(ntohs(vbid)));
+            auto& entry = entries.back();
+            const auto docKey = makeDocKey(cookie, {key, keylen});
+            if (valuelen > maxItemSize) {
+                entry.status = ENGINE_E2BIG;
+                continue;
+            }
+            if (!hasMemoryForItemAllocation(sizeof(Item) + sizeof(Blob) +
+                                            keylen + valuelen)) {
+                entry.status = memoryCondition();
+                continue;
+            }
+            const time_t expiretime =
+                    (exptime == 0) ? 0 : ep_abs_time(ep_reltime(exptime));
+            entry.item = std::make_unique<Item>(docKey,
+                                                flags,
+                                                expiretime,
+                                                data,
+                                                valuelen,
+                                                datatype,
+                                                0 /*cas*/,
+                                                -1 /*seq*/,
+                                                entry.vbid);
+            if (durability) {
+                entry.item->setPendingSyncWrite(*durability);
+            }
+        }
+    } catch (const std::invalid_argument& e) {
+        setErrorContext(cookie, e.what());
+        return ENGINE_EINVAL;
+    }
+
+    if (durability) {
+        // Count the SyncWrites of the batch (from now on they may complete)
+        std::lock_guard<std::mutex> lh(syncWriteBatchesMutex);
+        syncWriteBatches[cookie] = {};
+        ++numSyncWriteBatches;
+    }
+
+    // Store the documents a vbucket at a time
+    std::vector<size_t> order(entries.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(
+            order.begin(), order.end(), [&entries](size_t a, size_t b) {
+                return entries[a].vbid < entries[b].vbid;
+            });
+
+    int64_t prepared = 0;
+    for (auto it = order.begin(); it != order.end();) {
+        const auto vbid = entries[*it].vbid;
+        std::vector<size_t> indexes;
+        std::vector<Item*> items;
+        for (; it != order.end() && entries[*it].vbid == vbid; ++it) {
+            if (entries[*it].item) {
+                indexes.push_back(*it);
+                items.push_back(entries[*it].item.get());
+            }
+        }
+
+        const auto results = kvBucket->setMulti(vbid, items, cookie);
+        for (size_t ii = 0; ii < results.size(); ++ii) {
+            auto& entry = entries[indexes[ii]];
+            entry.status = results[ii];
+            if (entry.status == ENGINE_EWOULDBLOCK) {
+                // The SyncWrite was prepared, and notifies the batch
+                ++prepared;
+            } else if (entry.status == ENGINE_ENOMEM) {
+                entry.status = memoryCondition();
+            }
+        }
+    }
+    kvBucket->checkAndMaybeFreeMemory();
+
+    // The value of the response holds one entry per document in the order
+    // given: 16 bit status | 64 bit cas
+    std::vector<char> result;
+    result.reserve(entries.size() * (sizeof(uint16_t) + sizeof(uint64_t)));
+    for (const auto& entry : entries) {
+        auto status = cb::mcbp::Status::Success;
+        uint64_t cas = 0;
+        if (entry.status == ENGINE_SUCCESS ||
+            entry.status == ENGINE_EWOULDBLOCK) {
+            ++stats.numOpsStore;
+            cas = htonll(entry.item->getCas());
+        } else {
+            status = serverApi->cookie->engine_error2mcbp(cookie, entry.status);
+        }
+        const uint16_t statusNBO = htons(uint16_t(status));
+        const auto* ptr = reinterpret_cast<const char*>(&statusNBO);
+        result.insert(result.end(), ptr, ptr + sizeof(statusNBO));
+        ptr = reinterpret_cast<const char*>(&cas);
+        result.insert(result.end(), ptr, ptr + sizeof(cas));
+    }
+
+    if (durability) {
+        std::lock_guard<std::mutex> lh(syncWriteBatchesMutex);
+        auto it = syncWriteBatches.find(cookie);
+        auto& batch = it->second;
+        batch.pending += prepared;
+        batch.setting = false;
+        if (batch.pending != 0) {
+            // Notified by the last SyncWrite of the batch to complete
+            batch.response = std::move(result);
+            return ENGINE_EWOULDBLOCK;
+        }
+
+        // The SyncWrites (if any) all completed already
+        const auto status = batch.status;
+        syncWriteBatches.erase(it);
+        --numSyncWriteBatches;
+        if (status != ENGINE_SUCCESS) {
+            return status;
+        }
+    }
+
+    return sendResponse(response,
+                        NULL,
+                        0,
+                        NULL,
+                        0,
+                        result.data(),
+                        result.size(),
+                        PROTOCOL_BINARY_RAW_BYTES,
+                        cb::mcbp::Status::Success,
+                        0,
+                        cookie);
+}
+
+void EventuallyPersistentEngine::notifySyncWriteComplete(
+        const void* cookie, ENGINE_ERROR_CODE status) {
+    if (numSyncWriteBatches.load() != 0) {
+        std::lock_guard<std::mutex> lh(syncWriteBatchesMutex);
+        auto it = syncWriteBatches.find(cookie);
+        if (it != syncWriteBatches.end()) {
+            auto& batch = it->second;
+            --batch.pending;
+            if (batch.status == ENGINE_SUCCESS) {
+                batch.status = status;
+            }
+            if (batch.setting || batch.pending != 0) {
+                return;
+            }
+            status = batch.status;
+            if (status != ENGINE_SUCCESS) {
+                // The client is sent the failure, setMulti isn't called again
+                syncWriteBatches.erase(it);
+                --numSyncWriteBatches;
+            }
+        }
+    }
+    notifyIOComplete(cookie, status);
+}
+
+/**
+ * Get the meta data of the keys of a multi request (of any vbuckets), a
+ * vbucket at a time. The keys whose meta data must be fetched from disk
+ * have the status ENGINE_EWOULDBLOCK.
+ */
+static std::vector<MetaDataResult> getMetaDataByVBucket(
+        KVBucket& kvBucket,
+        const std::vector<Vbid>& vbids,
+        const std::vector<StoredDocKey>& keys) {
+    std::vector<size_t> order(keys.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&vbids](size_t a, size_t b) {
+        return vbids[a] < vbids[b];
+    });
+
+    std::vector<MetaDataResult> results(keys.size());
+    for (auto it = order.begin(); it != order.end();) {
+        const auto vbid = vbids[*it];
+        std::vector<size_t> indexes;
+        std::vector<DocKey> vbKeys;
+        for (; it != order.end() && vbids[*it] == vbid; ++it) {
+            indexes.push_back(*it);
+            vbKeys.push_back(keys[*it]);
+        }
+
+        auto vbResults = kvBucket.getMetaDataMulti(vbid, vbKeys);
+        for (size_t ii = 0; ii < vbResults.size(); ++ii) {
+            results[indexes[ii]] = vbResults[ii];
+        }
+    }
+    return results;
+}
+
+/*
+ * Task that reads the meta data of the keys of a GetMetaMulti or
+ * SetWithMetaMulti request which isn't in memory from disk (with one
+ * getMulti per vbucket, issued together), and restores it into the hash
+ * tables as a meta data background fetch would. The request is then
+ * executed again, runs in background.
+ */
+class MultiMetaFetchTask : public GlobalTask {
+public:
+    MultiMetaFetchTask(EventuallyPersistentEngine* e,
+                       const void* c,
+                       std::vector<std::pair<Vbid, StoredDocKey>> keys)
+        : GlobalTask(e, TaskId::MultiMetaFetchTask, 0, false),
+          engine(e),
+          cookie(c),
+          keys(std::move(keys)) {
+    }
+
+    std::string getDescription() {
+        return "Fetching the meta data of a multi with-meta request";
+    }
+
+    std::chrono::microseconds maxExpectedDuration() {
+        // As the BGFetcher, a function of how many keys are read
+        return std::chrono::milliseconds(100);
+    }
+
+    bool run() {
+        TRACE_EVENT0("ep-engine/task", "MultiMetaFetchTask");
+        const auto startTime = std::chrono::steady_clock::now();
+        auto& kvBucket = *engine->getKVBucket();
+
+        // Batch the reads by vbucket, and the vbuckets by their KVStore
+        std::map<Vbid, vb_bgfetch_queue_t> queues;
+        for (const auto& key : keys) {
+            auto& ctx = queues[key.first][DiskDocKey{key.second}];
+            if (ctx.bgfetched_list.empty()) {
+                ctx.isMetaOnly = GetMetaOnly::Yes;
+                ctx.bgfetched_list.emplace_back(
+                        std::make_unique<VBucketBGFetchItem>(nullptr, true));
+                ctx.bgfetched_list.back()->value = &ctx.value;
+            }
+        }
+        std::map<KVStore*, std::vector<std::pair<Vbid, vb_bgfetch_queue_t>>>
+                fetches;
+        for (auto& queue : queues) {
+            fetches[kvBucket.getROUnderlying(queue.first)].emplace_back(
+                    queue.first, std::move(queue.second));
+        }
+
+        for (auto& fetch : fetches) {
+            fetch.first->getMultiParallel(
+                    fetch.second,
+                    [&kvBucket, startTime](Vbid vbid,
+                                           vb_bgfetch_queue_t& items) {
+                        // Restore the meta data into the temp items
+                        auto vb = kvBucket.getVBucket(vbid);
+                        if (!vb) {
+                            return;
+                        }
+                        for (auto& item : items) {
+                            vb->completeBGFetchForSingleItem(
+                                    item.first,
+                                    *item.second.bgfetched_list.back(),
+                                    startTime);
+                        }
+                    });
+        }
+
+        // The request finds the meta data in memory when executed again
+        engine->addLookupAllKeys(cookie, ENGINE_SUCCESS);
+        engine->notifyIOComplete(cookie, ENGINE_SUCCESS);
+        return false;
+    }
+
+private:
+    EventuallyPersistentEngine* engine;
+    const void* cookie;
+    std::vector<std::pair<Vbid, StoredDocKey>> keys;
+};
+
+/**
+ * Schedule a MultiMetaFetchTask for the keys of a multi request whose meta
+ * data must be fetched from disk (if any).
+ *
+ * @return true if the task was scheduled (and the request must wait for it)
+ */
+static bool scheduleMultiMetaFetch(EventuallyPersistentEngine* engine,
+                                   const void* cookie,
+                                   const std::vector<Vbid>& vbids,
+                                   const std::vector<StoredDocKey>& keys,
+                                   const std::vector<MetaDataResult>& results) {
+    std::vector<std::pair<Vbid, StoredDocKey>> fetches;
+    for (size_t ii = 0; ii < results.size(); ++ii) {
+        if (results[ii].status == ENGINE_EWOULDBLOCK) {
+            fetches.emplace_back(vbids[ii], keys[ii]);
+        }
+    }
+    if (fetches.empty()) {
+        return false;
+    }
+
+    ExTask task = std::make_shared<MultiMetaFetchTask>(
+            engine, cookie, std::move(fetches));
+    ExecutorPool::get()->schedule(task);
+    return true;
+}
+
+ENGINE_ERROR_CODE EventuallyPersistentEngine::getMetaMulti(
+        const void* cookie,
+        const cb::mcbp::Request& request,
+        const AddResponseFn& response) {
+    // Executed again once the meta data not in memory was fetched
+    bool fetched = false;
+    {
+        LockHolder lh(lookupMutex);
+        auto it = allKeysLookups.find(cookie);
+        if (it != allKeysLookups.end()) {
+            ENGINE_ERROR_CODE err = it->second;
+            allKeysLookups.erase(it);
+            if (err != ENGINE_SUCCESS) {
+                return err;
+            }
+            fetched = true;
+        }
+    }
+
+    if (isDegradedMode()) {
+        return ENGINE_TMPFAIL;
+    }
+
+    // The value is a list of 16 bit vbucket | 16 bit key length | key (the
+    // framing was checked by the validator)
+    std::vector<Vbid> vbids;
+    std::vector<StoredDocKey> keys;
+    auto value = request.getValue();
+    try {
+        while (!value.empty()) {
+            uint16_t vbid;
+            uint16_t keylen;
+            std::memcpy(&vbid, value.data(), sizeof(vbid));
+            std::memcpy(&keylen, value.data() + sizeof(vbid), sizeof(keylen));
+            keylen = ntohs(keylen);
+            const auto* key = value.data() + sizeof(vbid) + sizeof(keylen);
+            vbids.emplace_back(ntohs(vbid));
+            keys.emplace_back(makeDocKey(cookie, {key, keylen}));
+            const auto* next = key + keylen;
+            value = {next, value.size() - size_t(next - value.data())};
+        }
+    } catch (const std::invalid_argument&) {
+        setErrorContext(cookie, "Invalid key");
+        return ENGINE_EINVAL;
+    }
+
+    const auto results = getMetaDataByVBucket(*kvBucket, vbids, keys);
+    if (!fetched && scheduleMultiMetaFetch(this, cookie, vbids, keys, results)) {
+        return ENGINE_EWOULDBLOCK;
+    }
+
+    // The value of the response holds one entry per key in the order
+    // requested: 16 bit status | 32 bit deleted | 32 bit flags |
+    // 32 bit expiration | 64 bit seqno | 8 bit datatype | 64 bit cas
+    std::vector<char> result;
+    result.reserve(results.size() *
+                   (sizeof(uint16_t) + sizeof(GetMetaResponse) +
+                    sizeof(uint64_t)));
+    for (const auto& entry : results) {
+        auto status = cb::mcbp::Status::Success;
+        GetMetaResponse meta;
+        uint64_t cas = 0;
+        if (entry.status == ENGINE_SUCCESS) {
+            meta = GetMetaResponse(
+                    htonl(entry.deleted ? 1 : 0),
+                    // The flags are stored as received (in network order)
+                    entry.metadata.flags,
+                    htonl(uint32_t(entry.metadata.exptime)),
+                    htonll(entry.metadata.revSeqno),
+                    entry.datatype);
+            cas = htonll(entry.metadata.cas);
+        } else {
+            auto err = entry.status;
+            if (err == ENGINE_EWOULDBLOCK) {
+                // The meta data was evicted again since it was fetched
+                err = ENGINE_TMPFAIL;
+            } else if (err == ENGINE_ENOMEM) {
+                err = memoryCondition();
+            }
+            status = serverApi->cookie->engine_error2mcbp(cookie, err);
+        }
+        const uint16_t statusNBO = htons(uint16_t(status));
+        const auto* ptr = reinterpret_cast<const char*>(&statusNBO);
+        result.insert(result.end(), ptr, ptr + sizeof(statusNBO));
+        ptr = reinterpret_cast<const char*>(&meta);
+        result.insert(result.end(), ptr, ptr + sizeof(meta));
+        ptr = reinterpret_cast<const char*>(&cas);
+        result.insert(result.end(), ptr, ptr + sizeof(cas));
+    }
+
+    return sendResponse(response,
+                        NULL,
+                        0,
+                        NULL,
+                        0,
+                        result.data(),
+                        result.size(),
+                        PROTOCOL_BINARY_RAW_BYTES,
+                        cb::mcbp::Status::Success,
+                        0,
+                        cookie);
+}
+
+/**
+ * A document of a SetWithMetaMulti request and the result of its store
+ */
+struct SetWithMetaMultiEntry {
+    explicit SetWithMetaMultiEntry(Vbid vbid) : vbid(vbid) {
+    }
+
+    Vbid vbid;
+    /// The document to store (if it is valid and could be allocated)
+    std::unique_ptr<Item> item;
+    ENGINE_ERROR_CODE status = ENGINE_SUCCESS;
+};
+
+ENGINE_ERROR_CODE EventuallyPersistentEngine::setWithMetaMulti(
+        const void* cookie,
+        const cb::mcbp::Request& request,
+        const AddResponseFn& response) {
+    // Executed again once the meta data not in memory was fetched
+    bool fetched = false;
+    {
+        LockHolder lh(lookupMutex);
+        auto it = allKeysLookups.find(cookie);
+        if (it != allKeysLookups.end()) {
+            ENGINE_ERROR_CODE err = it->second;
+            allKeysLookups.erase(it);
+            if (err != ENGINE_SUCCESS) {
+                return err;
+            }
+            fetched = true;
+        }
+    }
+
+    if (isDegradedMode()) {
+        return ENGINE_TMPFAIL;
+    }
+
+    // The extras optionally hold the options of SetWithMeta
+    uint32_t options = 0;
+    const auto extras = request.getExtdata();
+    if (extras.size() == sizeof(options)) {
+        std::memcpy(&options, extras.data(), sizeof(options));
+        options = ntohl(options);
+    }
+    CheckConflicts checkConflicts = CheckConflicts::Yes;
+    PermittedVBStates permittedVBStates{vbucket_state_active};
+    GenerateCas generateCas = GenerateCas::No;
+    DeleteSource deleteSource = DeleteSource::Explicit;
+    if (!decodeWithMetaOptions(options,
+                               generateCas,
+                               checkConflicts,
+                               permittedVBStates,
+                               deleteSource)) {
+        return ENGINE_EINVAL;
+    }
+
+    // The value is a list of 16 bit vbucket | 16 bit key length |
+    // 8 bit datatype | 8 bit deleted | 32 bit flags | 32 bit expiration |
+    // 64 bit seqno | 64 bit cas | 32 bit value length | key | value (the
+    // framing was checked by the validator)
+    std::vector<SetWithMetaMultiEntry> entries;
+    auto value = request.getValue();
+    try {
+        while (!value.empty()) {
+            uint16_t vbid;
+            uint16_t keylen;
+            uint32_t flags;
+            uint32_t exptime;
+            uint64_t seqno;
+            uint64_t cas;
+            uint32_t valuelen;
+            const auto* ptr = value.data();
+            std::memcpy(&vbid, ptr, sizeof(vbid));
+            ptr += sizeof(vbid);
+            std::memcpy(&keylen, ptr, sizeof(keylen));
+            ptr += sizeof(keylen);
+            const auto datatype = protocol_binary_datatype_t(*ptr);
+            ptr += sizeof(datatype);
+            const bool deleted = *ptr != 0;
+            ptr += sizeof(uint8_t);
+            // The flags are stored as received (in network byte order)
+            std::memcpy(&flags, ptr, sizeof(flags));
+            ptr += sizeof(flags);
+            std::memcpy(&exptime, ptr, sizeof(exptime));
+            ptr += sizeof(exptime);
+            std::memcpy(&seqno, ptr, sizeof(seqno));
+            ptr += sizeof(seqno);
+            std::memcpy(&cas, ptr, sizeof(cas));
+            ptr += sizeof(cas);
+            std::memcpy(&valuelen, ptr, sizeof(valuelen));
+            ptr += sizeof(valuelen);
+            keylen = ntohs(keylen);
+            valuelen = ntohl(valuelen);
+            const auto* key = ptr;
+            const auto* data = key + keylen;
+            const auto* next = data + valuelen;
+            value = {next, value.size() - size_t(next - value.data())};
+
+            entries.emplace_back(Vbid(ntohs(vbid)));
+            auto& entry = entries.back();
+            const auto docKey = makeDocKey(cookie, {key, keylen});
+            if (valuelen > maxItemSize) {
+                entry.status = ENGINE_E2BIG;
+                continue;
+            }
+            if (!hasMemoryForItemAllocation(sizeof(Item) + sizeof(Blob) +
+                                            keylen + valuelen)) {
+                entry.status = memoryCondition();
+                continue;
+            }
+            // For a deletion the expiration is the delete time, as for
+            // DelWithMeta
+            entry.item = makeItemWithMeta(cookie,
+                                          entry.vbid,
+                                          docKey,
+                                          {data, valuelen},
+                                          {ntohll(cas),
+                                           ntohll(seqno),
+                                           flags,
+                                           time_t(ntohl(exptime))},
+                                          deleted,
+                                          datatype);
+            if (!entry.item) {
+                entry.status = ENGINE_EINVAL;
+            } else if (deleted) {
+                entry.item->setDeleted(deleteSource);
+            }
+        }
+    } catch (const std::invalid_argument& e) {
+        setErrorContext(cookie, e.what());
+        return ENGINE_EINVAL;
+    } catch (const std::bad_alloc&) {
+        return ENGINE_ENOMEM;
+    }
+
+    // Conflict resolution needs the meta data of the existing documents:
+    // read whatever isn't in memory with one batch before storing any of
+    // them
+    if (checkConflicts == CheckConflicts::Yes && !fetched) {
+        std::vector<Vbid> vbids;
+        std::vector<StoredDocKey> keys;
+        for (const auto& entry : entries) {
+            if (entry.item) {
+                vbids.push_back(entry.vbid);
+                keys.emplace_back(entry.item->getKey());
+            }
+        }
+        const auto results = getMetaDataByVBucket(*kvBucket, vbids, keys);
+        if (scheduleMultiMetaFetch(this, cookie, vbids, keys, results)) {
+            return ENGINE_EWOULDBLOCK;
+        }
+    }
+
+    // Store the documents a vbucket at a time
+    std::vector<size_t> order(entries.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(
+            order.begin(), order.end(), [&entries](size_t a, size_t b) {
+                return entries[a].vbid < entries[b].vbid;
+            });
+
+    for (auto it = order.begin(); it != order.end();) {
+        const auto vbid = entries[*it].vbid;
+        std::vector<size_t> indexes;
+        std::vector<Item*> items;
+        for (; it != order.end() && entries[*it].vbid == vbid; ++it) {
+            if (entries[*it].item) {
+                indexes.push_back(*it);
+                items.push_back(entries[*it].item.get());
+            }
+        }
+
+        const auto results = kvBucket->setWithMetaMulti(
+                vbid, items, permittedVBStates, checkConflicts, generateCas);
+        for (size_t ii = 0; ii < results.size(); ++ii) {
+            auto& entry = entries[indexes[ii]];
+            entry.status = results[ii];
+            if (entry.status == ENGINE_ENOMEM) {
+                entry.status = memoryCondition();
+            }
+        }
+    }
+
+    // The value of the response holds one entry per document in the order
+    // given: 16 bit status | 64 bit cas
+    std::vector<char> result;
+    result.reserve(entries.size() * (sizeof(uint16_t) + sizeof(uint64_t)));
+    for (const auto& entry : entries) {
+        auto status = cb::mcbp::Status::Success;
+        uint64_t cas = 0;
+        if (entry.status == ENGINE_SUCCESS) {
+            if (entry.item->isDeleted()) {
+                ++stats.numOpsDelMeta;
+            } else {
+                ++stats.numOpsSetMeta;
+            }
+            cas = htonll(entry.item->getCas());
+        } else {
+            status = serverApi->cookie->engine_error2mcbp(cookie, entry.status);
+        }
+        const uint16_t statusNBO = htons(uint16_t(status));
+        const auto* ptr = reinterpret_cast<const char*>(&statusNBO);
+        result.insert(result.end(), ptr, ptr + sizeof(statusNBO));
+        ptr = reinterpret_cast<const char*>(&cas);
+        result.insert(result.end(), ptr, ptr + sizeof(cas));
+    }
+
+    return sendResponse(response,
+                        NULL,
+                        0,
+                        NULL,
+                        0,
+                        result.data(),
+                        result.size(),
+                        PROTOCOL_BINARY_RAW_BYTES,
+                        cb::mcbp::Status::Success,
+                        0,
+                        cookie);
+}
+
+CONN_PRIORITY EventuallyPersistentEngine::getDCPPriority(const void* cookie) {
+    NonBucketAllocationGuard guard;
+    auto priority = serverApi->cookie->get_priority(cookie);
+    return priority;
+}
+
+void EventuallyPersistentEngine::setDCPPriority(const void* cookie,
+                                                CONN_PRIORITY priority) {
+    NonBucketAllocationGuard guard;
+    serverApi->cookie->set_priority(cookie, priority);
+}
+
+void EventuallyPersistentEngine::notifyIOComplete(const void* cookie,
+                                                  ENGINE_ERROR_CODE status) {
+    if (cookie == NULL) {
+        EP_LOG_WARN("Tried to signal a NULL cookie!");
+    } else {
+        HdrMicroSecBlockTimer bt(&stats.notifyIOHisto);
+        NonBucketAllocationGuard guard;
+        serverApi->cookie->notify_io_complete(cookie, status);
+    }
+}
+
+ENGINE_ERROR_CODE EventuallyPersistentEngine::getRandomKey(
+        const void* cookie,
+        const cb::mcbp::Request& request,
+        const AddResponseFn& response) {
+    boost::optional<CollectionID> cid;
+    const auto extras = request.getExtdata();
+    if (extras.size() == sizeof(cb::mcbp::request::GetRandomKeyPayload)) {
+        const auto* payload = reinterpret_cast<
+                const cb::mcbp::request::GetRandomKeyPayload*>(extras.data());
+        cid = payload->getCollectionId();
+    }
+
+    GetValue gv(kvBucket->getRandomKey(cid, cookie));
+    ENGINE_ERROR_CODE ret = gv.getStatus();
+
+    if (ret == ENGINE_SUCCESS) {
+        Item* it = gv.item.get();
+        uint32_t flags = it->getFlags();
+        ret = sendResponse(response,
+                           static_cast<const void*>(it->getKey().data()),
+                           it->getKey().size(),
+                           (const void*)&flags,
+                           sizeof(uint32_t),
+                           static_cast<const void*>(it->getData()),
+                           it->getNBytes(),
+                           it->getDataType(),
+                           cb::mcbp::Status::Success,
+                           it->getCas(),
+                           cookie);
+    }
+
+    return ret;
+}
+
+ENGINE_ERROR_CODE EventuallyPersistentEngine::dcpOpen(
+        const void* cookie,
+        uint32_t opaque,
+        uint32_t seqno,
+        uint32_t flags,
+        cb::const_char_buffer stream_name,
+        cb::const_char_buffer value) {
+    (void) opaque;
+    (void) seqno;
+    std::string connName = cb::to_string(stream_name);
+
+    if (getEngineSpecific(cookie) != NULL) {
+        EP_LOG_WARN(
+                "Cannot open DCP connection as another"
+                " connection exists on the same socket");
+        return ENGINE_DISCONNECT;
+    }
+
+    ConnHandler *handler = NULL;
+    if (flags & (cb::mcbp::request::DcpOpenPayload::Producer |
+                 cb::mcbp::request::DcpOpenPayload::Notifier)) {
+        handler = dcpConnMap_->newProducer(cookie, connName, flags);
+    } else {
+        // dont accept dcp consumer open requests during warm up
+        if (!kvBucket->isWarmingUp()) {
+            // Check if consumer_name specified in value; if so use in Consumer
+            // object.
+            nlohmann::json jsonValue;
+            std::string consumerName;
+            if (!value.empty()) {
+                jsonValue = nlohmann::json::parse(value);
+                consumerName = jsonValue.at("consumer_name").get<std::string>();
+            }
+            handler = dcpConnMap_->newConsumer(cookie, connName, consumerName);
+
+            EP_LOG_INFO(
+                    "EventuallyPersistentEngine::dcpOpen: opening new DCP "
+                    "Consumer handler - stream name:{}, opaque:{}, seqno:{}, "
+                    "flags:0b{} value:{}",
+                    connName,
+                    opaque,
+                    seqno,
+                    std::bitset<sizeof(flags) * 8>(flags).to_string(),
+                    jsonValue.dump());
+        } else {
+            EP_LOG_WARN(
+                    "EventuallyPersistentEngine::dcpOpen: not opening new DCP "
+                    "Consumer handler as EPEngine is still warming up");
+            return ENGINE_TMPFAIL;
+        }
+    }
+
+    if (handler == nullptr) {
+        EP_LOG_WARN("EPEngine::dcpOpen: failed to create a handler");
+        return ENGINE_DISCONNECT;
+    }
+
+    // Success creating dcp object which has stored the cookie, now reserve it.
+    if (reserveCookie(cookie) != ENGINE_SUCCESS) {
+        EP_LOG_WARN(
+                "Cannot create DCP connection because cookie "
+                "cannot be reserved");
+        return ENGINE_DISCONNECT;
+    }
+
+    storeEngineSpecific(cookie, handler);
+
+    return ENGINE_SUCCESS;
+}
+
+ENGINE_ERROR_CODE EventuallyPersistentEngine::dcpAddStream(const void* cookie,
+                                                           uint32_t opaque,
+                                                           Vbid vbucket,
+                                                           uint32_t flags) {
+    ENGINE_ERROR_CODE errCode = ENGINE_DISCONNECT;
+    ConnHandler* conn = getConnHandler(cookie);
+    if (conn) {
+        errCode = dcpConnMap_->addPassiveStream(*conn, opaque, vbucket, flags);
+    }
+    return errCode;
+}
+
+ConnHandler* EventuallyPersistentEngine::getConnHandler(const void *cookie) {
+    void* specific = getEngineSpecific(cookie);
+    ConnHandler* handler = reinterpret_cast<ConnHandler*>(specific);
+    if (!handler) {
+        EP_LOG_WARN("Invalid streaming connection");
+    }
+    return handler;
+}
+
+void EventuallyPersistentEngine::handleDisconnect(const void *cookie) {
+    dcpConnMap_->disconnect(cookie);
+    {
+        // Drop the response of a GetMulti which won't be retried
+        LockHolder lh(lookupMutex);
+        getMultiResults.erase(cookie);
+    }
+    {
+        // Drop the response of a SetMulti batch whose SyncWrites completed
+        // (a batch still waiting for them notifies the cookie when done)
+        std::lock_guard<std::mutex> lh(syncWriteBatchesMutex);
+        auto it = syncWriteBatches.find(cookie);
+        if (it != syncWriteBatches.end() && !it->second.setting &&
+            it->second.pending == 0) {
+            syncWriteBatches.erase(it);
+            --numSyncWriteBatches;
+        }
+    }
     /**
      * Decrement session_cas's counter, if the connection closes
      * before a control command (that returned ENGINE_EWOULDBLOCK
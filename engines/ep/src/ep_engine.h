@@ -19,7 +19,9 @@
 
 #include "configuration.h"
 #include "connhandler.h"
+#include "objectregistry.h"
 #include "permitted_vb_states.h"
+#include "stat_group_cache.h"
 #include "stats.h"
 #include "storeddockey.h"
 #include "taskable.h"
@@ -28,9 +30,11 @@
 #include <memcached/engine.h>
 #include <memcached/server_callback_iface.h>
 
+#include <atomic>
 #include <chrono>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace cb {
 namespace mcbp {
@@ -175,6 +179,18 @@ public:
             const boost::optional<cb::durability::Requirements>& durability,
             DocumentState document_state) override;
 
+    cb::EngineErrorItemPair update(gsl::not_null<const void*> cookie,
+                                   const DocKey& key,
+                                   Vbid vbucket,
+                                   uint64_t cas,
+                                   const cb::UpdateFunction& update) override;
+
+    cb::EngineErrorItemPair append(gsl::not_null<const void*> cookie,
+                                   const DocKey& key,
+                                   Vbid vbucket,
+                                   uint64_t cas,
+                                   cb::const_char_buffer value) override;
+
     // Need to explicilty import EngineIface::flush to avoid warning about
     // DCPIface::flush hiding it.
     using EngineIface::flush;
@@ -227,6 +243,8 @@ public:
         return minCompressionRatio;
     }
 
+    cb::engine::Pressure getPressure() override;
+
     // DcpIface implementation ////////////////////////////////////////////////
 
     ENGINE_ERROR_CODE step(
@@ -490,6 +508,18 @@ public:
                                         ENGINE_STORE_OPERATION operation,
                                         const cb::StoreIfPredicate& predicate);
 
+    cb::EngineErrorItemPair updateInner(const void* cookie,
+                                        const DocKey& key,
+                                        Vbid vbucket,
+                                        uint64_t cas,
+                                        const cb::UpdateFunction& update);
+
+    cb::EngineErrorItemPair appendInner(const void* cookie,
+                                        const DocKey& key,
+                                        Vbid vbucket,
+                                        uint64_t cas,
+                                        cb::const_char_buffer value);
+
     ENGINE_ERROR_CODE dcpOpen(const void* cookie,
                               uint32_t opaque,
                               uint32_t seqno,
@@ -522,12 +552,39 @@ public:
                                  const cb::mcbp::Request& request,
                                  const AddResponseFn& response);
 
+    ENGINE_ERROR_CODE rangeScan(const void* cookie,
+                                const cb::mcbp::Request& request,
+                                const AddResponseFn& response);
+
+    ENGINE_ERROR_CODE getMulti(const void* cookie,
+                               const cb::mcbp::Request& request,
+                               const AddResponseFn& response);
+
+    ENGINE_ERROR_CODE setMulti(const void* cookie,
+                               const cb::mcbp::Request& request,
+                               const AddResponseFn& response);
+
+    ENGINE_ERROR_CODE getMetaMulti(const void* cookie,
+                                   const cb::mcbp::Request& request,
+                                   const AddResponseFn& response);
+
+    ENGINE_ERROR_CODE setWithMetaMulti(const void* cookie,
+                                       const cb::mcbp::Request& request,
+                                       const AddResponseFn& response);
+
     CONN_PRIORITY getDCPPriority(const void* cookie);
 
     void setDCPPriority(const void* cookie, CONN_PRIORITY priority);
 
     void notifyIOComplete(const void* cookie, ENGINE_ERROR_CODE status);
 
+    /**
+     * Notify the client that one of its SyncWrites completed. The client
+     * of a SetMulti batch is only notified once, when the last SyncWrite
+     * of the batch completes.
+     */
+    void notifySyncWriteComplete(const void* cookie, ENGINE_ERROR_CODE status);
+
     ENGINE_ERROR_CODE reserveCookie(const void *cookie);
     ENGINE_ERROR_CODE releaseCookie(const void *cookie);
 
@@ -655,6 +712,10 @@ public:
         return serverApi;
     }
 
+    const BucketArena& getArena() const {
+        return arena;
+    }
+
     Configuration& getConfiguration() {
         return configuration;
     }
@@ -707,6 +768,7 @@ public:
     }
 
     ENGINE_ERROR_CODE getRandomKey(const void* cookie,
+                                   const cb::mcbp::Request& request,
                                    const AddResponseFn& response);
 
     void setCompressionMode(const std::string& compressModeStr);
@@ -719,6 +781,13 @@ public:
 
     void addLookupAllKeys(const void *cookie, ENGINE_ERROR_CODE err);
 
+    /**
+     * Store the value of the response of a GetMulti whose documents were
+     * read from disk; it's sent (from the front end thread) when the
+     * command is retried
+     */
+    void addGetMultiResult(const void* cookie, std::vector<char> value);
+
     /*
      * Explicitly trigger the defragmenter task. Provided to facilitate
      * testing.
@@ -802,6 +871,10 @@ protected:
         maxItemPrivilegedBytes = value;
     }
 
+    void setStatGroupCacheTtl(size_t value) {
+        statGroupCache.setTtl(std::chrono::milliseconds(value));
+    }
+
     void setGetlDefaultTimeout(size_t value) {
         getlDefaultTimeout = value;
     }
@@ -879,6 +952,11 @@ protected:
                                        const AddStatFn& add_stat);
     ENGINE_ERROR_CODE doRunTimeStats(const void* cookie,
                                      const AddStatFn& add_stat);
+    ENGINE_ERROR_CODE doTaskProfileStats(const void* cookie,
+                                         const AddStatFn& add_stat);
+    ENGINE_ERROR_CODE doTaskTimingsStats(const void* cookie,
+                                         const AddStatFn& add_stat,
+                                         const std::string& statKey);
     ENGINE_ERROR_CODE doDispatcherStats(const void* cookie,
                                         const AddStatFn& add_stat);
     ENGINE_ERROR_CODE doTasksStats(const void* cookie,
@@ -956,6 +1034,16 @@ protected:
                                PermittedVBStates& permittedVBStates,
                                DeleteSource& deleteSource);
 
+    /**
+     * Decode and validate the with_meta options (as above), given the
+     * options themselves (decoded from network byte order).
+     */
+    bool decodeWithMetaOptions(uint32_t options,
+                               GenerateCas& generateCas,
+                               CheckConflicts& checkConflicts,
+                               PermittedVBStates& permittedVBStates,
+                               DeleteSource& deleteSource);
+
     /**
      * Private wrapper method for decodeWithMetaOptions called from setWithMeta
      * to abstract out deleteSource, which is unused by setWithMeta.
@@ -1025,6 +1113,28 @@ protected:
             protocol_binary_datatype_t datatype,
             cb::const_char_buffer body);
 
+    /**
+     * Make the item of a with_meta mutation (inflating a Snappy value to
+     * check it, and storing it uncompressed if the bucket's compression
+     * mode is off).
+     *
+     * @param cookie connection's cookie
+     * @param vbucket VB of the item
+     * @param key DocKey initialised with key data
+     * @param value the value of the item
+     * @param itemMeta the item's cas/revseq/flags/expiration
+     * @param isDeleted the item is a deletion
+     * @param datatype datatype of the value
+     * @return the item, or nullptr if the value is invalid
+     */
+    std::unique_ptr<Item> makeItemWithMeta(const void* cookie,
+                                           Vbid vbucket,
+                                           DocKey key,
+                                           cb::const_byte_buffer value,
+                                           ItemMetaData itemMeta,
+                                           bool isDeleted,
+                                           protocol_binary_datatype_t datatype);
+
     /**
      * Process the set_with_meta with the given buffers/values.
      *
@@ -1098,6 +1208,11 @@ protected:
 
     SERVER_HANDLE_V1 *serverApi;
 
+    // The allocator arena dedicated to the engine (if any). Destructed last,
+    // so all of the other members have freed their memory before the arena
+    // is released.
+    BucketArena arena;
+
     // Engine statistics. First concrete member as a number of other members
     // refer to it so needs to be constructed first (and destructed last).
     EPStats stats;
@@ -1114,6 +1229,30 @@ protected:
     std::map<const void*, std::unique_ptr<Item>> lookups;
     std::unordered_map<const void*, ENGINE_ERROR_CODE> allKeysLookups;
     std::mutex lookupMutex;
+    /// The responses of the GetMultis which read from disk (see
+    /// addGetMultiResult), protected by lookupMutex
+    std::unordered_map<const void*, std::vector<char>> getMultiResults;
+
+    /**
+     * A SetMulti batch waiting for its SyncWrites to complete
+     */
+    struct SyncWriteBatch {
+        /// The SyncWrites of the batch which haven't completed (negative if
+        /// SyncWrites complete before the batch is counted)
+        int64_t pending = 0;
+        /// The batch is still being set (so isn't counted yet)
+        bool setting = true;
+        /// The first failure of a SyncWrite of the batch
+        ENGINE_ERROR_CODE status = ENGINE_SUCCESS;
+        /// The value of the response, sent once all SyncWrites succeeded
+        std::vector<char> response;
+    };
+    /// The SetMulti batches with SyncWrites, by the cookie of their client
+    std::unordered_map<const void*, SyncWriteBatch> syncWriteBatches;
+    std::mutex syncWriteBatchesMutex;
+    /// The size of syncWriteBatches, so that the SyncWrites of the other
+    /// commands don't need to take the lock
+    std::atomic<size_t> numSyncWriteBatches{0};
     GET_SERVER_API getServerApiFunc;
 
     std::unique_ptr<DcpFlowControlManager> dcpFlowControlManager_;
@@ -1122,6 +1261,7 @@ protected:
     std::string name;
     size_t maxItemSize;
     size_t maxItemPrivilegedBytes;
+    StatGroupCache statGroupCache;
     size_t getlDefaultTimeout;
     size_t getlMaxTimeout;
     size_t maxFailoverEntries;
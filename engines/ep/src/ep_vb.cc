@@ -33,6 +33,17 @@
 #include "vbucket_bgfetch_item.h"
 #include "vbucketdeletiontask.h"
 #include <folly/lang/Assume.h>
+#include <algorithm>
+
+/// Create the factory for the StoredValues of the HashTable
+static std::unique_ptr<AbstractStoredValueFactory> makeStoredValueFactory(
+        EPStats& st, Configuration& config) {
+    const auto inlineSize = config.getHtInlineValueSize();
+    if (inlineSize != 0) {
+        return std::make_unique<CompactStoredValueFactory>(st, inlineSize);
+    }
+    return std::make_unique<StoredValueFactory>(st);
+}
 
 EPVBucket::EPVBucket(Vbid i,
                      vbucket_state_t newState,
@@ -65,7 +76,7 @@ EPVBucket::EPVBucket(Vbid i,
               lastSnapEnd,
               std::move(table),
               flusherCb,
-              std::make_unique<StoredValueFactory>(st),
+              makeStoredValueFactory(st, config),
               std::move(newSeqnoCb),
               syncWriteCb,
               seqnoAckCb,
@@ -77,7 +88,8 @@ EPVBucket::EPVBucket(Vbid i,
               maxCas,
               hlcEpochSeqno,
               mightContainXattrs,
-              replicationTopology),
+              replicationTopology,
+              kvshard ? kvshard->getHashTableLocks() : nullptr),
       shard(kvshard) {
 }
 
@@ -189,14 +201,17 @@ ENGINE_ERROR_CODE EPVBucket::completeBGFetchForSingleItem(
         ++stats.bg_fetched;
     }
 
+    // A fetch which joined a read already in flight didn't wait for it to
+    // start
+    const auto fetchStart = std::max(startTime, fetched_item.initTime);
     const auto fetchEnd = std::chrono::steady_clock::now();
-    updateBGStats(fetched_item.initTime, startTime, fetchEnd);
+    updateBGStats(fetched_item.initTime, fetchStart, fetchEnd);
 
     // Close the BG_WAIT span; and add a BG_LOAD span
     if (fetched_item.cookie) {
-        TRACE_END(fetched_item.cookie, cb::tracing::TraceCode::BG_WAIT, startTime);
+        TRACE_END(fetched_item.cookie, cb::tracing::TraceCode::BG_WAIT, fetchStart);
         TRACE_BEGIN(
-                  fetched_item.cookie, cb::tracing::TraceCode::BG_LOAD, startTime);
+                  fetched_item.cookie, cb::tracing::TraceCode::BG_LOAD, fetchStart);
         TRACE_END(fetched_item.cookie, cb::tracing::TraceCode::BG_LOAD, fetchEnd);
     }
 
@@ -207,9 +222,28 @@ vb_bgfetch_queue_t EPVBucket::getBGFetchItems() {
     vb_bgfetch_queue_t fetches;
     LockHolder lh(pendingBGFetchesLock);
     fetches.swap(pendingBGFetches);
+    for (const auto& fetch : fetches) {
+        inFlightBGFetches[fetch.first].isMetaOnly = fetch.second.isMetaOnly;
+    }
     return fetches;
 }
 
+void EPVBucket::takeAttachedBGFetchItems(vb_bgfetch_queue_t& fetches) {
+    LockHolder lh(pendingBGFetchesLock);
+    for (auto& fetch : fetches) {
+        auto itr = inFlightBGFetches.find(fetch.first);
+        if (itr == inFlightBGFetches.end()) {
+            continue;
+        }
+        for (auto& attached : itr->second.attached) {
+            attached->value = &fetch.second.value;
+        }
+        fetch.second.bgfetched_list.splice(fetch.second.bgfetched_list.end(),
+                                           itr->second.attached);
+        inFlightBGFetches.erase(itr);
+    }
+}
+
 bool EPVBucket::hasPendingBGFetchItems() {
     LockHolder lh(pendingBGFetchesLock);
     return !pendingBGFetches.empty();
@@ -254,8 +288,10 @@ void EPVBucket::notifyAllPendingConnsFailed(EventuallyPersistentEngine& e) {
         for (auto& bgf : pendingBGFetches) {
             vb_bgfetch_item_ctx_t& bg_itm_ctx = bgf.second;
             for (auto& bgitem : bg_itm_ctx.bgfetched_list) {
-                toNotify[bgitem->cookie] = ENGINE_NOT_MY_VBUCKET;
-                e.storeEngineSpecific(bgitem->cookie, nullptr);
+                if (bgitem->cookie) {
+                    toNotify[bgitem->cookie] = ENGINE_NOT_MY_VBUCKET;
+                    e.storeEngineSpecific(bgitem->cookie, nullptr);
+                }
                 ++num_of_deleted_pending_fetches;
             }
         }
@@ -479,6 +515,15 @@ bool EPVBucket::eligibleToPageOut(const HashTable::HashBucketLock& lh,
     return v.eligibleForEviction(eviction);
 }
 
+size_t EPVBucket::getPageOutGain(const HashTable::HashBucketLock& lh,
+                                 const StoredValue& v) const {
+    if (eviction == EvictionPolicy::Full) {
+        // The whole StoredValue is removed from the HashTable
+        return v.size();
+    }
+    return v.size() - v.metaDataSize();
+}
+
 void EPVBucket::queueBackfillItem(queued_item& qi,
                                   const GenerateBySeqno generateBySeqno) {
     if (GenerateBySeqno::Yes == generateBySeqno) {
@@ -508,6 +553,17 @@ size_t EPVBucket::queueBGFetchItem(const DocKey& key,
     // DiskDocKey with pending unconditionally false.
     DiskDocKey diskKey{key, /*pending*/ false};
     LockHolder lh(pendingBGFetchesLock);
+
+    // If the key is already being read from disk and that read gives us
+    // what this fetch needs, share its result instead of reading it again.
+    auto inFlight = inFlightBGFetches.find(diskKey);
+    if (inFlight != inFlightBGFetches.end() &&
+        (fetch->metaDataOnly ||
+         inFlight->second.isMetaOnly == GetMetaOnly::No)) {
+        inFlight->second.attached.push_back(std::move(fetch));
+        return pendingBGFetches.size();
+    }
+
     vb_bgfetch_item_ctx_t& bgfetch_itm_ctx = pendingBGFetches[diskKey];
 
     if (bgfetch_itm_ctx.bgfetched_list.empty()) {
@@ -734,7 +790,13 @@ MutationStatus EPVBucket::insertFromWarmup(Item& itm,
         return MutationStatus::NoMem;
     }
 
-    return ht.insertFromWarmup(itm, eject, keyMetaDataOnly, eviction);
+    const auto status =
+            ht.insertFromWarmup(itm, eject, keyMetaDataOnly, eviction);
+    if (status == MutationStatus::NotFound && itm.getExptime() != 0 &&
+        !itm.isDeleted() && itm.isCommitted()) {
+        expiryIndex.add(itm.getKey(), itm.getExptime());
+    }
+    return status;
 }
 
 void EPVBucket::restoreOutstandingPreparesFromWarmup(
@@ -764,6 +826,7 @@ void EPVBucket::restoreOutstandingPreparesFromWarmup(
             dynamic_cast<ActiveDurabilityMonitor*>(durabilityMonitor.get())
                     ->setReplicationTopology(topology);
         }
+        notifySyncWriteDeadline(getActiveDM().getEarliestExpiry());
         return;
     }
     case vbucket_state_replica:
@@ -780,6 +843,28 @@ size_t EPVBucket::estimateNewMemoryUsage(EPStats& st, const Item& item) {
            StoredValue::getRequiredStorage(item.getKey());
 }
 
+UniqueDCPBackfillPtr EPVBucket::createDCPBackfill(
+        EventuallyPersistentEngine& e,
+        std::shared_ptr<ActiveStream> stream,
+        uint64_t startSeqno,
+        uint64_t endSeqno) {
+    if (!e.getConfiguration().isDcpSharedBackfill()) {
+        return std::make_unique<DCPBackfillDisk>(
+                e, stream, startSeqno, endSeqno);
+    }
+
+    std::lock_guard<std::mutex> lh(sharedBackfillLock);
+    auto streams = sharedBackfill.lock();
+    if (streams && streams->join(stream, startSeqno, endSeqno)) {
+        // The backfill sends our items
+        return {};
+    }
+    auto backfill = std::make_unique<DCPBackfillDisk>(
+            e, stream, startSeqno, endSeqno);
+    sharedBackfill = backfill->getStreams();
+    return backfill;
+}
+
 size_t EPVBucket::getNumPersistedDeletes() const {
     if (isBucketCreation()) {
         // If creation is true then no disk file exists
@@ -799,6 +884,72 @@ void EPVBucket::dropKey(int64_t bySeqno,
     }
 }
 
+/// Finds the keys of the hash table which belong to dropped collections
+class DroppedCollectionKeysVisitor : public HashTableVisitor {
+public:
+    explicit DroppedCollectionKeysVisitor(const VBucket& vb) : vb(vb) {
+    }
+
+    bool visit(const HashTable::HashBucketLock& lh, StoredValue& v) override {
+        if (!v.isTempItem() && v.isCommitted() &&
+            !v.getKey().getCollectionID().isSystem() &&
+            readHandle.isLogicallyDeleted(v.getKey(), v.getBySeqno())) {
+            dropped.emplace_back(v.getKey(), v.getBySeqno());
+        }
+        return true;
+    }
+
+    void setUpHashBucketVisit() override {
+        readHandle = vb.lockCollections();
+    }
+
+    void tearDownHashBucketVisit() override {
+        readHandle.unlock();
+    }
+
+    std::vector<std::pair<StoredDocKey, int64_t>> dropped;
+
+private:
+    const VBucket& vb;
+    Collections::VB::Manifest::ReadHandle readHandle;
+};
+
+void EPVBucket::collectionsDropped(
+        const std::vector<std::pair<CollectionID, uint64_t>>& dropped) {
+    auto notErased = droppedItemsNotErased.wlock();
+    for (const auto& entry : dropped) {
+        onDiskTotalItems -=
+                std::min(size_t(entry.second), onDiskTotalItems.load());
+        (*notErased)[entry.first] += entry.second;
+    }
+}
+
+void EPVBucket::dropCollectionKeys() {
+    DroppedCollectionKeysVisitor visitor(*this);
+    ht.visit(visitor);
+    for (const auto& key : visitor.dropped) {
+        auto cHandle = lockCollections(key.first);
+        dropKey(key.second, cHandle);
+    }
+}
+
+void EPVBucket::collectionItemsErased(
+        const std::unordered_map<CollectionID, size_t>& erased) {
+    auto notErased = droppedItemsNotErased.wlock();
+    for (const auto& entry : erased) {
+        size_t accounted = 0;
+        auto it = notErased->find(entry.first);
+        if (it != notErased->end()) {
+            accounted = std::min(it->second, entry.second);
+            // Compaction erases all of a dropped collection's items at
+            // once, so whatever is left over was a miscount
+            notErased->erase(it);
+        }
+        onDiskTotalItems -= std::min(entry.second - accounted,
+                                     onDiskTotalItems.load());
+    }
+}
+
 /*
  * Queue the item to the checkpoint and return the seqno the item was
  * allocated.
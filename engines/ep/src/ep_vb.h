@@ -60,6 +60,8 @@ public:
 
     vb_bgfetch_queue_t getBGFetchItems() override;
 
+    void takeAttachedBGFetchItems(vb_bgfetch_queue_t& fetches) override;
+
     bool hasPendingBGFetchItems() override;
 
     HighPriorityVBReqStatus checkAddHighPriorityVBEntry(
@@ -105,6 +107,9 @@ public:
     bool eligibleToPageOut(const HashTable::HashBucketLock& lh,
                            const StoredValue& v) const override;
 
+    size_t getPageOutGain(const HashTable::HashBucketLock& lh,
+                          const StoredValue& v) const override;
+
     bool areDeletedItemsAlwaysResident() const override;
 
     void addStats(bool details,
@@ -115,14 +120,15 @@ public:
         return shard;
     }
 
+    /**
+     * Creates a disk backfill, or (if dcp_shared_backfill is enabled) joins
+     * the stream to the last disk backfill created for the vbucket if it
+     * hasn't started scanning yet and reads the items the stream wants.
+     */
     UniqueDCPBackfillPtr createDCPBackfill(EventuallyPersistentEngine& e,
                                            std::shared_ptr<ActiveStream> stream,
                                            uint64_t startSeqno,
-                                           uint64_t endSeqno) override {
-        /* create a disk backfill object */
-        return std::make_unique<DCPBackfillDisk>(
-                e, stream, startSeqno, endSeqno);
-    }
+                                           uint64_t endSeqno) override;
 
     uint64_t getPersistenceSeqno() const override {
         return persistenceSeqno.load();
@@ -198,6 +204,29 @@ public:
             int64_t bySeqno,
             Collections::VB::Manifest::CachingReadHandle& cHandle) override;
 
+    /**
+     * The drop of collections holding the given number of items was
+     * persisted: remove them from the count of items on disk, without
+     * waiting for compaction to erase them from disk.
+     */
+    void collectionsDropped(
+            const std::vector<std::pair<CollectionID, uint64_t>>& dropped);
+
+    /**
+     * Drop the keys of the dropped collections from the hash table (see
+     * DropCollectionKeysTask).
+     */
+    void dropCollectionKeys();
+
+    /**
+     * Compaction erased the given number of items of each of the dropped
+     * collections from disk; remove the ones collectionsDropped() didn't
+     * already account for (e.g. dropped before a warmup) from the count of
+     * items on disk.
+     */
+    void collectionItemsErased(
+            const std::unordered_map<CollectionID, size_t>& erased);
+
     /**
      * Add a system event Item to the vbucket and return its seqno.
      *
@@ -303,8 +332,27 @@ private:
      */
     cb::NonNegativeCounter<size_t> onDiskTotalItems;
 
+    /**
+     * Items of each dropped collection already removed from onDiskTotalItems
+     * by collectionsDropped() which compaction hasn't erased yet.
+     */
+    folly::Synchronized<std::unordered_map<CollectionID, size_t>>
+            droppedItemsNotErased;
+
+    /**
+     * A key being read by the BgFetcher (returned by getBGFetchItems()),
+     * and the fetches queued after the read started which will be served
+     * from its result.
+     */
+    struct InFlightBGFetch {
+        GetMetaOnly isMetaOnly;
+        std::list<std::unique_ptr<VBucketBGFetchItem>> attached;
+    };
+
     std::mutex pendingBGFetchesLock;
     vb_bgfetch_queue_t pendingBGFetches;
+    /// Protected by pendingBGFetchesLock
+    std::unordered_map<DiskDocKey, InFlightBGFetch> inFlightBGFetches;
 
     /* Pointer to the shard to which this VBucket belongs to */
     KVShard* shard;
@@ -315,5 +363,10 @@ private:
      */
     std::atomic<uint64_t> deferredDeletionFileRevision;
 
+    /// Protects sharedBackfill
+    std::mutex sharedBackfillLock;
+    /// The streams of the last disk backfill created, which others may join
+    std::weak_ptr<BackfillStreams> sharedBackfill;
+
     friend class EPVBucketTest;
 };
@@ -160,9 +160,7 @@ void EphemeralBucket::attemptToFreeMemory() {
 
     // Additionally, wake up the tombstone purger to scan for and remove any
     // tombstones in the HashTable / sequence list.
-    if (tombstonePurgerTask->getState() == TASK_SNOOZED) {
-        ExecutorPool::get()->wake(tombstonePurgerTask->getId());
-    }
+    wakeTombstonePurgerTask();
 }
 
 ENGINE_ERROR_CODE EphemeralBucket::scheduleCompaction(Vbid vbid,
@@ -247,6 +245,12 @@ void EphemeralBucket::disableTombstonePurgerTask() {
     ExecutorPool::get()->cancel(tombstonePurgerTask->getId());
 }
 
+void EphemeralBucket::wakeTombstonePurgerTask() {
+    if (tombstonePurgerTask->getState() == TASK_SNOOZED) {
+        ExecutorPool::get()->wake(tombstonePurgerTask->getId());
+    }
+}
+
 void EphemeralBucket::reconfigureForEphemeral(Configuration& config) {
     // Disable access scanner - we never create it anyway, but set to
     // disabled as to not mislead the user via stats.
@@ -42,6 +42,19 @@ public:
 
     ENGINE_ERROR_CODE cancelCompaction(Vbid vbid) override;
 
+    /// Vbucket files not supported for Ephemeral buckets.
+    ENGINE_ERROR_CODE linkVBucketFile(Vbid vbid,
+                                      const std::string& dir,
+                                      std::string& path) override {
+        return ENGINE_ENOTSUP;
+    }
+
+    ENGINE_ERROR_CODE installVBucket(Vbid vbid,
+                                     const std::string& path,
+                                     const void* ck) override {
+        return ENGINE_ENOTSUP;
+    }
+
     /// Eviction not supported for Ephemeral buckets - without some backing
     /// storage, there is nowhere to evict /to/.
     cb::mcbp::Status evictKey(const DocKey& key,
@@ -117,6 +130,12 @@ public:
      */
     void disableTombstonePurgerTask();
 
+    /**
+     * Wake the Ephemeral Tombstone purger task to run now (if enabled and not
+     * already running).
+     */
+    void wakeTombstonePurgerTask();
+
     virtual bool isGetAllKeysSupported() const override {
         return false;
     }
@@ -18,6 +18,7 @@
 #include "ephemeral_vb.h"
 
 #include "checkpoint_manager.h"
+#include "chunked_seqlist.h"
 #include "configuration.h"
 #include "dcp/backfill_memory.h"
 #include "ep_engine.h"
@@ -26,12 +27,27 @@
 #include "executorpool.h"
 #include "failover-table.h"
 #include "item.h"
+#include "kvshard.h"
 #include "linked_list.h"
 #include "stored_value_factories.h"
 #include "vbucket_bgfetch_item.h"
 #include "vbucketdeletiontask.h"
 #include <folly/lang/Assume.h>
 
+/// @return true if the vbuckets use a ChunkedSeqList (ephemeral_seqlist_type)
+static bool isChunkedSeqList(Configuration& config) {
+    return config.getEphemeralSeqlistType() == "chunked";
+}
+
+static std::unique_ptr<SequenceList> makeSeqList(Vbid vbid,
+                                                 EPStats& st,
+                                                 Configuration& config) {
+    if (isChunkedSeqList(config)) {
+        return std::make_unique<ChunkedSeqList>(vbid, st);
+    }
+    return std::make_unique<BasicLinkedList>(vbid, st);
+}
+
 EphemeralVBucket::EphemeralVBucket(
         Vbid i,
         vbucket_state_t newState,
@@ -62,7 +78,9 @@ EphemeralVBucket::EphemeralVBucket(
               lastSnapEnd,
               std::move(table),
               /*flusherCb*/ nullptr,
-              std::make_unique<OrderedStoredValueFactory>(st),
+              // A ChunkedSeqList doesn't link the OSVs
+              std::make_unique<OrderedStoredValueFactory>(
+                      st, !isChunkedSeqList(config)),
               std::move(newSeqnoCb),
               syncWriteCb,
               seqnoAckCb,
@@ -74,8 +92,9 @@ EphemeralVBucket::EphemeralVBucket(
               maxCas,
               0, // Every item in ephemeral has a HLC cas
               mightContainXattrs,
-              replicationTopology),
-      seqList(std::make_unique<BasicLinkedList>(i, st)),
+              replicationTopology,
+              kvshard ? kvshard->getHashTableLocks() : nullptr),
+      seqList(makeSeqList(i, st, config)),
       backfillType(BackfillType::None) {
     /* Get the flow control policy */
     std::string dcpBackfillType = config.getDcpEphemeralBackfillType();
@@ -156,6 +175,22 @@ bool EphemeralVBucket::eligibleToPageOut(const HashTable::HashBucketLock& lh,
     return true;
 }
 
+size_t EphemeralVBucket::getPageOutGain(const HashTable::HashBucketLock& lh,
+                                        const StoredValue& v) const {
+    // Within a range read the item can't be moved to the end of the
+    // sequence list, so the deletion is a copy of it and the original is
+    // kept (stale) until the range read completes - releasing nothing.
+    const auto seqno = uint64_t(v.getBySeqno());
+    if (seqList->getRangeReadEnd() != 0 &&
+        seqno >= seqList->getRangeReadBegin() &&
+        seqno <= seqList->getRangeReadEnd()) {
+        return 0;
+    }
+    // Only the value is released; the tombstone keeps the metadata until it
+    // is purged (see EphTombstoneHTCleaner).
+    return v.size() - v.metaDataSize();
+}
+
 bool EphemeralVBucket::areDeletedItemsAlwaysResident() const {
     // Ephemeral buckets do keep all deleted items resident in memory.
     // (We have nowhere else to store them, given there is no disk).
@@ -238,6 +273,13 @@ vb_bgfetch_queue_t EphemeralVBucket::getBGFetchItems() {
             getId().to_string());
 }
 
+void EphemeralVBucket::takeAttachedBGFetchItems(vb_bgfetch_queue_t& fetches) {
+    throw std::logic_error(
+            "EphemeralVBucket::takeAttachedBGFetchItems() is not valid. "
+            "Called on " +
+            getId().to_string());
+}
+
 bool EphemeralVBucket::hasPendingBGFetchItems() {
     throw std::logic_error(
             "EphemeralVBucket::hasPendingBGFetchItems() is not valid. "
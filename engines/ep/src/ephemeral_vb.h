@@ -59,6 +59,8 @@ public:
 
     vb_bgfetch_queue_t getBGFetchItems() override;
 
+    void takeAttachedBGFetchItems(vb_bgfetch_queue_t& fetches) override;
+
     bool hasPendingBGFetchItems() override;
 
     HighPriorityVBReqStatus checkAddHighPriorityVBEntry(
@@ -109,6 +111,9 @@ public:
     bool eligibleToPageOut(const HashTable::HashBucketLock& lh,
                            const StoredValue& v) const override;
 
+    size_t getPageOutGain(const HashTable::HashBucketLock& lh,
+                          const StoredValue& v) const override;
+
     bool areDeletedItemsAlwaysResident() const override;
 
     void addStats(bool details,
@@ -35,6 +35,11 @@
 std::mutex ExecutorPool::initGuard;
 std::atomic<ExecutorPool*> ExecutorPool::instance;
 
+constexpr std::chrono::milliseconds ExecutorPool::FairShareSlice;
+constexpr std::chrono::seconds ExecutorPool::FairShareWindow;
+constexpr std::chrono::milliseconds ExecutorPool::MaxFairShareDelay;
+constexpr std::chrono::seconds ExecutorPool::MaxFairShareLag;
+
 static const size_t EP_MIN_NUM_THREADS    = 10;
 static const size_t EP_MIN_READER_THREADS = 4;
 static const size_t EP_MIN_WRITER_THREADS = 4;
@@ -119,6 +124,48 @@ size_t ExecutorPool::getNumReaders(void) {
     return count;
 }
 
+/**
+ * Parse the per task type CPU affinity from the configuration of the
+ * engine creating the pool (the pool is shared by all buckets, so the
+ * first bucket's configuration is used).
+ */
+static void configureThreadAffinity(ExecutorPool& pool, Configuration& config) {
+    const std::vector<std::pair<task_type_t, std::string>> specs = {
+            {READER_TASK_IDX, config.getReaderThreadAffinity()},
+            {WRITER_TASK_IDX, config.getWriterThreadAffinity()},
+            {AUXIO_TASK_IDX, config.getAuxioThreadAffinity()},
+            {NONIO_TASK_IDX, config.getNonioThreadAffinity()}};
+
+    for (const auto& spec : specs) {
+        try {
+            pool.setThreadAffinity(spec.first,
+                                   cb::ThreadAffinity(spec.second));
+        } catch (const std::invalid_argument& e) {
+            EP_LOG_WARN("Ignoring invalid {} thread affinity \"{}\": {}",
+                        to_string(spec.first),
+                        spec.second,
+                        e.what());
+        }
+    }
+}
+
+void ExecutorPool::applyThreadAffinity(const ExecutorThread& thread) {
+    const auto& affinity = threadAffinity[thread.taskType];
+    if (affinity.empty()) {
+        return;
+    }
+
+    const auto error = affinity.applyToCurrentThread();
+    if (error.empty()) {
+        EP_LOG_DEBUG(
+                "{}: pinned to {}", thread.getName(), affinity.to_string());
+    } else {
+        EP_LOG_WARN("{}: failed to set thread affinity: {}",
+                    thread.getName(),
+                    error);
+    }
+}
+
 ExecutorPool *ExecutorPool::get(void) {
     auto* tmp = instance.load();
     if (tmp == nullptr) {
@@ -137,6 +184,7 @@ ExecutorPool *ExecutorPool::get(void) {
                                    config.getNumWriterThreads(),
                                    config.getNumAuxioThreads(),
                                    config.getNumNonioThreads());
+            configureThreadAffinity(*tmp, config);
             instance.store(tmp);
         }
     }
@@ -159,7 +207,7 @@ ExecutorPool::ExecutorPool(size_t maxThreads, size_t nTaskSets,
                   numTaskSets(nTaskSets), totReadyTasks(0),
                   isHiPrioQset(false), isLowPrioQset(false), numBuckets(0),
                   numSleepers(0), curWorkers(nTaskSets), numWorkers(nTaskSets),
-                  numReadyTasks(nTaskSets) {
+                  numReadyTasks(nTaskSets), threadAffinity(nTaskSets) {
     size_t numCPU = Couchbase::get_available_cpu_count();
     size_t numThreads = (size_t)((numCPU * 3)/4);
     numThreads = (numThreads < EP_MIN_NUM_THREADS) ?
@@ -480,6 +528,24 @@ void ExecutorPool::_registerTaskable(Taskable& taskable) {
         numBuckets++;
     }
 
+    {
+        // Start from the least weighted runtime of the others, so the new
+        // taskable isn't owed all the time they've run for.
+        std::lock_guard<std::mutex> lh(runtimeMutex);
+        TaskableRuntime entry;
+        if (!taskableRuntime.empty()) {
+            entry.vruntime =
+                    std::min_element(taskableRuntime.begin(),
+                                     taskableRuntime.end(),
+                                     [](const auto& a, const auto& b) {
+                                         return a.second.vruntime <
+                                                b.second.vruntime;
+                                     })
+                            ->second.vruntime;
+        }
+        taskableRuntime[&taskable] = entry;
+    }
+
     _startWorkers();
 }
 
@@ -488,6 +554,71 @@ void ExecutorPool::registerTaskable(Taskable& taskable) {
     _registerTaskable(taskable);
 }
 
+std::chrono::steady_clock::duration ExecutorPool::accountRuntime(
+        Taskable& taskable, std::chrono::steady_clock::duration runtime) {
+    const auto shares = taskable.getWorkLoadPolicy().getCpuShares();
+    if (shares == 0) {
+        // The taskable doesn't take part in sharing the threads
+        return std::chrono::steady_clock::duration::zero();
+    }
+    const auto now = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lh(runtimeMutex);
+    auto it = taskableRuntime.find(&taskable);
+    if (it == taskableRuntime.end()) {
+        return std::chrono::steady_clock::duration::zero();
+    }
+    auto& mine = it->second;
+
+    // The least weighted runtime of the other taskables sharing the threads
+    // which are running tasks, and if any of them is waiting for a thread
+    bool othersRunning = false;
+    bool othersReady = false;
+    std::chrono::nanoseconds minVruntime{0};
+    for (const auto& other : taskableRuntime) {
+        const auto& policy = other.first->getWorkLoadPolicy();
+        if (other.first == &taskable || policy.getCpuShares() == 0 ||
+            now - other.second.lastRun > FairShareWindow) {
+            continue;
+        }
+        if (!othersRunning || other.second.vruntime < minVruntime) {
+            minVruntime = other.second.vruntime;
+        }
+        othersRunning = true;
+        othersReady |= policy.getNumReadyTasks() != 0;
+    }
+
+    if (othersRunning && now - mine.lastRun > FairShareWindow &&
+        mine.vruntime < minVruntime) {
+        // Idle for a while; don't let the time not used then be used to
+        // starve the others now.
+        mine.vruntime = minVruntime;
+    }
+
+    const auto ns =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(runtime);
+    mine.runtime += ns;
+    mine.vruntime += ns * WorkLoadPolicy::DefaultCpuShares / shares;
+    mine.lastRun = now;
+
+    if (!othersRunning) {
+        return std::chrono::steady_clock::duration::zero();
+    }
+
+    // Bound the lead; while nobody else is waiting for a thread the time
+    // used isn't taken from anyone, so don't hold it against the taskable
+    // once they are.
+    const auto maxLead = othersReady ? MaxFairShareLag : FairShareSlice;
+    mine.vruntime = std::min<std::chrono::nanoseconds>(mine.vruntime,
+                                                       minVruntime + maxLead);
+
+    if (!othersReady || mine.vruntime - minVruntime <= FairShareSlice) {
+        return std::chrono::steady_clock::duration::zero();
+    }
+    return std::min<std::chrono::steady_clock::duration>(
+            mine.vruntime - minVruntime - FairShareSlice, MaxFairShareDelay);
+}
+
 ssize_t ExecutorPool::_adjustWorkers(task_type_t type, size_t desiredNumItems) {
     std::string typeName{to_string(type)};
 
@@ -654,6 +785,11 @@ void ExecutorPool::_unregisterTaskable(Taskable& taskable, bool force) {
 
     _stopTaskGroup(taskable.getGID(), NO_TASK_TYPE, force);
 
+    {
+        std::lock_guard<std::mutex> rlh(runtimeMutex);
+        taskableRuntime.erase(&taskable);
+    }
+
     LockHolder lh(tMutex);
     taskOwners.erase(&taskable);
     if (!(--numBuckets)) {
@@ -877,6 +1013,22 @@ void ExecutorPool::doTasksStat(EventuallyPersistentEngine* engine,
     checked_snprintf(statname, sizeof(statname), "%s:tasks", prefix);
     add_casted_stat(statname, list.dump(), add_stat, cookie);
 
+    nlohmann::json buckets = nlohmann::json::array();
+    {
+        std::lock_guard<std::mutex> lh(runtimeMutex);
+        for (const auto& entry : taskableRuntime) {
+            nlohmann::json obj;
+            obj["bucket"] = entry.first->getName();
+            obj["cpu_shares"] =
+                    entry.first->getWorkLoadPolicy().getCpuShares();
+            obj["total_runtime_ns"] = entry.second.runtime.count();
+            obj["weighted_runtime_ns"] = entry.second.vruntime.count();
+            buckets.push_back(obj);
+        }
+    }
+    checked_snprintf(statname, sizeof(statname), "%s:buckets", prefix);
+    add_casted_stat(statname, buckets.dump(), add_stat, cookie);
+
     checked_snprintf(statname, sizeof(statname), "%s:cur_time", prefix);
     add_casted_stat(statname,
                     to_ns_since_epoch(std::chrono::steady_clock::now()).count(),
@@ -62,6 +62,16 @@
  * ExecutorPool::snooze(size_t taskId, double toSleep)
  *   The pool's snooze method will locate the task matching taskId and adjust
  *   its wakeTime to account for the toSleep value.
+ *
+ * ExecutorPool::accountRuntime(Taskable& taskable, duration runtime)
+ *   Called by the threads after each run of a task. The runtime of each
+ *   taskable is weighted by its CPU shares (WorkLoadPolicy::getCpuShares);
+ *   a taskable which has run more than its share relative to the other
+ *   taskables running tasks gets a delay, which the thread adds to the
+ *   waketime of the task it reschedules. This keeps a bucket with many busy
+ *   tasks (e.g. compaction or backfill) from starving the others. Only
+ *   taskables with non-zero shares take part, and a task is only delayed
+ *   while another of them has tasks ready to run.
  */
 #pragma once
 
@@ -70,7 +80,10 @@
 #include "taskable.h"
 
 #include <memcached/engine.h>
+#include <utilities/thread_affinity.h>
+#include <chrono>
 #include <map>
+#include <mutex>
 #include <set>
 
 // Forward decl
@@ -129,6 +142,31 @@ public:
 
     void registerTaskable(Taskable& taskable);
 
+    /**
+     * Account a run of one of the taskable's tasks.
+     *
+     * @param taskable the owner of the task which ran
+     * @param runtime how long the task ran for
+     * @return how long to delay the task (if rescheduled) as the taskable has
+     *         run more than its share of the threads' time while others
+     *         were waiting for them.
+     */
+    std::chrono::steady_clock::duration accountRuntime(
+            Taskable& taskable, std::chrono::steady_clock::duration runtime);
+
+    /// How far a taskable may run ahead of its share before it is delayed
+    static constexpr std::chrono::milliseconds FairShareSlice{10};
+
+    /// How long a taskable counts as running tasks after its last run
+    static constexpr std::chrono::seconds FairShareWindow{1};
+
+    /// The most a task is delayed by accountRuntime()
+    static constexpr std::chrono::milliseconds MaxFairShareDelay{100};
+
+    /// The most a taskable may run ahead of the others (the lag it ends up
+    /// paying back is bounded)
+    static constexpr std::chrono::seconds MaxFairShareLag{1};
+
     void unregisterTaskable(Taskable& taskable, bool force);
 
     void doWorkerStat(EventuallyPersistentEngine* engine,
@@ -192,6 +230,22 @@ public:
         adjustWorkers(NONIO_TASK_IDX, v);
     }
 
+    /**
+     * Set the CPUs (and preferred NUMA node) the threads of the given type
+     * should run on. Only affects threads started after the call, so it
+     * should be set before the workers are started.
+     */
+    void setThreadAffinity(task_type_t type,
+                           const cb::ThreadAffinity& affinity) {
+        threadAffinity[type] = affinity;
+    }
+
+    /**
+     * Pin the calling executor thread according to the affinity
+     * configured for its type
+     */
+    void applyThreadAffinity(const ExecutorThread& thread);
+
     size_t getNumReadyTasks(void) { return totReadyTasks; }
 
     size_t getNumSleepers(void) { return numSleepers; }
@@ -257,10 +311,22 @@ protected:
     std::vector<std::atomic<uint16_t>> curWorkers; // track # of active workers per TaskSet
     std::vector<std::atomic<uint16_t>> numWorkers; // and limit it to the value set here
     std::vector<std::atomic<size_t>> numReadyTasks; // number of ready tasks per task set
+    std::vector<cb::ThreadAffinity> threadAffinity; // CPU pinning per task set
 
     // Set of all known task owners
     std::set<void *> taskOwners;
 
+    /// The time each registered taskable's tasks have run for
+    struct TaskableRuntime {
+        /// Total runtime
+        std::chrono::nanoseconds runtime{0};
+        /// Runtime weighted by the taskable's CPU shares
+        std::chrono::nanoseconds vruntime{0};
+        std::chrono::steady_clock::time_point lastRun;
+    };
+    std::mutex runtimeMutex; // Protects taskableRuntime
+    std::map<Taskable*, TaskableRuntime> taskableRuntime;
+
     // Singleton creation
     static std::mutex initGuard;
     static std::atomic<ExecutorPool*> instance;
@@ -76,6 +76,8 @@ void ExecutorThread::stop(bool wait) {
 void ExecutorThread::run() {
     EP_LOG_DEBUG("Thread {} running..", getName());
 
+    manager->applyThreadAffinity(*this);
+
     for (uint8_t tick = 1;; tick++) {
         resetCurrentTask();
 
@@ -158,6 +160,8 @@ void ExecutorThread::run() {
             currentTask->getTaskable().logRunTime(currentTask->getTaskId(),
                                                   runtime);
             currentTask->updateRuntime(runtime);
+            const auto fairShareDelay = manager->accountRuntime(
+                    currentTask->getTaskable(), runtime);
 
             // Check if exceeded expected duration; and if so log.
             // Note: This is done before we call onSwitchThread(NULL)
@@ -175,8 +179,11 @@ void ExecutorThread::run() {
                 manager->cancel(currentTask->uid, true);
             } else {
                 // if a task has not set snooze, update its waketime to now
-                // before rescheduling for more accurate timing histograms
-                currentTask->updateWaketimeIfLessThan(getCurTime());
+                // before rescheduling for more accurate timing histograms.
+                // If its bucket has run more than its share of the threads'
+                // time, hold it back to let other buckets' tasks run.
+                currentTask->updateWaketimeIfLessThan(getCurTime() +
+                                                      fairShareDelay);
 
                 // reschedule this task back into the queue it was fetched from
                 const std::chrono::steady_clock::time_point new_waketime =
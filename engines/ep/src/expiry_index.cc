@@ -0,0 +1,53 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "expiry_index.h"
+
+const time_t ExpiryIndex::SlotSeconds;
+
+void ExpiryIndex::add(const DocKey& key, time_t exptime) {
+    if (!enabled) {
+        return;
+    }
+    std::lock_guard<std::mutex> guard(mutex);
+    if (slots[exptime / SlotSeconds].emplace(key).second) {
+        ++numKeys;
+    }
+}
+
+std::vector<StoredDocKey> ExpiryIndex::takeDue(time_t now) {
+    std::vector<StoredDocKey> due;
+    std::lock_guard<std::mutex> guard(mutex);
+    const auto end = slots.upper_bound(now / SlotSeconds);
+    for (auto it = slots.begin(); it != end; ++it) {
+        due.insert(due.end(), it->second.begin(), it->second.end());
+    }
+    slots.erase(slots.begin(), end);
+    numKeys -= due.size();
+    return due;
+}
+
+size_t ExpiryIndex::size() const {
+    std::lock_guard<std::mutex> guard(mutex);
+    return numKeys;
+}
+
+void ExpiryIndex::clear() {
+    std::lock_guard<std::mutex> guard(mutex);
+    slots.clear();
+    numKeys = 0;
+}
@@ -0,0 +1,80 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include "storeddockey.h"
+
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * An index of the keys of a vBucket with an expiry time, so that the
+ * expiry pager can visit just the keys which are due rather than every
+ * item of the vBucket.
+ *
+ * Keys are grouped in (coarse) slots of SlotSeconds by their expiry time,
+ * like a timer wheel. The index isn't updated when a document is deleted
+ * or gets a different expiry time, so the keys taken from it must be
+ * checked against the hash table (and a key may be in several slots).
+ */
+class ExpiryIndex {
+public:
+    /// The width of the slots (in seconds)
+    static const time_t SlotSeconds = 16;
+
+    /// @param enabled if keys should be added to the index at all
+    explicit ExpiryIndex(bool enabled) : enabled(enabled) {
+    }
+
+    bool isEnabled() const {
+        return enabled;
+    }
+
+    /**
+     * Add a key to the index
+     *
+     * @param key the key of the document
+     * @param exptime the (absolute) expiry time of the document
+     */
+    void add(const DocKey& key, time_t exptime);
+
+    /**
+     * Remove and return the keys of the slots which started by the given
+     * time (which includes the keys due by then, and possibly some due a
+     * little later)
+     */
+    std::vector<StoredDocKey> takeDue(time_t now);
+
+    /// @return the number of keys in the index
+    size_t size() const;
+
+    void clear();
+
+private:
+    const bool enabled;
+
+    mutable std::mutex mutex;
+
+    /// The keys by their expiry time divided by SlotSeconds
+    std::map<time_t, std::unordered_set<StoredDocKey>> slots;
+
+    size_t numKeys = 0;
+};
@@ -20,15 +20,21 @@
 #include "bucket_logger.h"
 #include "common.h"
 #include "ep_bucket.h"
+#include "ep_engine.h"
+#include "statwriter.h"
 #include "tasks.h"
 
 #include <platform/timeutils.h>
 
 #include <stdlib.h>
+#include <algorithm>
 #include <chrono>
 #include <sstream>
 #include <thread>
 
+constexpr size_t Flusher::maxConsecutiveDurableFlushes;
+constexpr std::chrono::seconds Flusher::durableFlushBackoff;
+
 Flusher::Flusher(EPBucket* st, KVShard* k)
     : store(st),
       _state(State::Initializing),
@@ -200,6 +206,7 @@ bool Flusher::step(GlobalTask *task) {
     case State::Paused:
     case State::Pausing:
         if (currentState == State::Pausing) {
+            completeGroupCommit();
             transitionState(State::Paused);
         }
         // Indefinitely put task to sleep..
@@ -208,6 +215,7 @@ bool Flusher::step(GlobalTask *task) {
 
     case State::Running:
         flushVB();
+        maybeCompleteGroupCommit();
         if (_state == State::Running) {
             double tosleep = computeMinSleepTime();
             if (tosleep > 0) {
@@ -238,6 +246,7 @@ void Flusher::completeFlush() {
     while(!canSnooze()) {
         flushVB();
     }
+    completeGroupCommit();
 }
 
 double Flusher::computeMinSleepTime() {
@@ -265,7 +274,7 @@ void Flusher::flushVB(void) {
         }
         bool inverse = true;
         if (pendingMutation.compare_exchange_strong(inverse, false)) {
-            for (auto vbid : shard->getVBucketsSortedByState()) {
+            for (auto vbid : getVBucketsInFlushOrder()) {
                 lpVbs.push(vbid);
             }
         }
@@ -284,10 +293,23 @@ void Flusher::flushVB(void) {
         }
     }
 
+    // Interleave the vBuckets with durable prepares pending with the
+    // others, so a steady stream of prepares can't starve them
+    if ((consecutiveDurableFlushes < maxConsecutiveDurableFlushes ||
+         (hpVbs.empty() && lpVbs.empty())) &&
+        flushDurableVB()) {
+        ++consecutiveDurableFlushes;
+        return;
+    }
+    consecutiveDurableFlushes = 0;
+
     if (hpVbs.empty() && lpVbs.empty()) {
         EP_LOG_DEBUG("Flusher::flushVB: Trying to flush but no vbuckets exist");
         return;
-    } else if (!hpVbs.empty()) {
+    }
+
+    maybeBeginGroupCommit();
+    if (!hpVbs.empty()) {
         Vbid vbid = hpVbs.front();
         hpVbs.pop();
         if (store->flushVBucket(vbid).first) {
@@ -306,3 +328,195 @@ void Flusher::flushVB(void) {
         }
     }
 }
+
+bool Flusher::flushDurableVB() {
+    if (std::chrono::steady_clock::now() < durableFlushBackoffUntil) {
+        // Failed to persist a durable prepare recently; leave them to the
+        // normal order for now
+        return false;
+    }
+
+    if (pendingDurablePrepares.exchange(false)) {
+        // Rebuild the queue rather than adding to it, so a vBucket is only
+        // in it once
+        durableVbs = {};
+        for (auto vbid : shard->getVBuckets()) {
+            VBucketPtr vb = store->getVBucket(vbid);
+            if (vb && vb->hasPendingDurablePrepare()) {
+                durableVbs.push(vbid);
+            }
+        }
+    }
+
+    while (!durableVbs.empty()) {
+        Vbid vbid = durableVbs.front();
+        durableVbs.pop();
+        VBucketPtr vb = store->getVBucket(vbid);
+        if (!vb || !vb->hasPendingDurablePrepare()) {
+            // Already flushed by the normal order
+            continue;
+        }
+
+        // The vBucket joins the group of commits in progress (if any), but
+        // the prepares aren't durable until they're synced so don't wait
+        // for the window once all of them are flushed (see below)
+        maybeBeginGroupCommit();
+        store->flushVBucket(vbid);
+        ++store->getEPEngine().getEpStats().flusherDurablePrepareFlushes;
+        if (!vb->rejectQueue.empty()) {
+            // The flush failed; back off rather than retrying it first
+            // over and over
+            EP_LOG_WARN(
+                    "Flusher::flushDurableVB: failed to flush {}, not "
+                    "flushing durable prepares first for {}",
+                    vbid,
+                    cb::time2text(durableFlushBackoff));
+            durableFlushBackoffUntil =
+                    std::chrono::steady_clock::now() + durableFlushBackoff;
+            durableVbs = {};
+        } else if (vb->hasPendingDurablePrepare()) {
+            // Prepares beyond the flushed batch remain, keep flushing it
+            // first
+            durableVbs.push(vbid);
+        }
+        if (durableVbs.empty()) {
+            completeGroupCommit();
+        }
+        return true;
+    }
+    return false;
+}
+
+void Flusher::maybeBeginGroupCommit() {
+    if (!groupCommitActive && groupCommitWindow.load() > 0 &&
+        store->beginGroupCommit(*shard)) {
+        groupCommitActive = true;
+        groupCommitStart = std::chrono::steady_clock::now();
+    }
+}
+
+void Flusher::maybeCompleteGroupCommit() {
+    const bool drained = hpVbs.empty() && lpVbs.empty();
+    if (!groupCommitActive) {
+        // The group (if any) of vBucket state snapshots is complete once
+        // we've gone through the vBuckets, or as soon as a flush has added
+        // items to it
+        store->completeVBStateGroupCommit(
+                *shard, !drained && _state == State::Running);
+        return;
+    }
+    const auto window = std::chrono::milliseconds(groupCommitWindow.load());
+    if (drained || _state != State::Running ||
+        std::chrono::steady_clock::now() - groupCommitStart >= window) {
+        completeGroupCommit();
+    }
+}
+
+void Flusher::completeGroupCommit() {
+    if (groupCommitActive) {
+        store->completeGroupCommit(*shard);
+        groupCommitActive = false;
+    } else {
+        store->completeVBStateGroupCommit(*shard);
+    }
+}
+
+void Flusher::sortInFlushOrder(std::vector<VBucketFlushOrder>& order) {
+    // Keep the active vBuckets before the others, and within a state flush
+    // the vBuckets whose items have been waiting the longest first (and
+    // the smaller backlogs first when the ages are the same) so a vBucket
+    // with a large backlog doesn't hold up the rest of the shard. (A large
+    // backlog is flushed in batches, see flusher_batch_split_trigger, and
+    // goes to the back of the queue after each batch.)
+    std::stable_sort(
+            order.begin(),
+            order.end(),
+            [](const VBucketFlushOrder& a, const VBucketFlushOrder& b) {
+                if (a.state != b.state) {
+                    return a.state < b.state;
+                }
+                if (a.age != b.age) {
+                    return a.age > b.age;
+                }
+                return a.backlog < b.backlog;
+            });
+}
+
+std::vector<Vbid> Flusher::getVBucketsInFlushOrder() {
+    std::vector<VBucketFlushOrder> order;
+    for (auto vbid : shard->getVBucketsSortedByState()) {
+        VBucketPtr vb = store->getVBucket(vbid);
+        if (!vb) {
+            continue;
+        }
+        const size_t backlog = vb->dirtyQueueSize;
+        order.push_back({vbid,
+                         vb->getState(),
+                         backlog ? vb->getQueueAge() / backlog : 0,
+                         backlog});
+    }
+    sortInFlushOrder(order);
+
+    std::vector<Vbid> ret;
+    ret.reserve(order.size());
+    for (const auto& entry : order) {
+        ret.push_back(entry.vbid);
+    }
+    return ret;
+}
+
+size_t FlushBatchSizer::getBatchSize(size_t limit) const {
+    const auto size = batchSize.load(std::memory_order_relaxed);
+    if (targetCommitTime.load(std::memory_order_relaxed) == 0 || size == 0) {
+        return limit;
+    }
+    return std::min(limit, size);
+}
+
+void FlushBatchSizer::commitCompleted(size_t items,
+                                      std::chrono::microseconds duration,
+                                      bool limited) {
+    const auto target = targetCommitTime.load(std::memory_order_relaxed);
+    if (target == 0 || items == 0) {
+        batchSize.store(0, std::memory_order_relaxed);
+        return;
+    }
+
+    // Only the flusher of the shard updates the sizer, so the load/store
+    // pairs don't race with each other.
+    const auto perItem = std::max(1.0, double(duration.count())) / items;
+    auto average = commitTimePerItem.load(std::memory_order_relaxed);
+    average = (average == 0) ? perItem : (3 * average + perItem) / 4;
+    commitTimePerItem.store(average, std::memory_order_relaxed);
+
+    auto size = size_t(target / average);
+    if (!limited) {
+        // A batch which wasn't full tells us nothing about a bigger batch,
+        // don't grow past what we've seen
+        const auto current = batchSize.load(std::memory_order_relaxed);
+        size = std::min(size, std::max(items, current));
+    } else {
+        size = std::min(size, 2 * items);
+    }
+    batchSize.store(std::max(size, MinBatchSize), std::memory_order_relaxed);
+}
+
+void FlushBatchSizer::addStats(const std::string& prefix,
+                               const AddStatFn& add_stat,
+                               const void* c) const {
+    add_prefixed_stat(prefix.c_str(),
+                      "flush_batch_target_us",
+                      targetCommitTime.load(std::memory_order_relaxed),
+                      add_stat,
+                      c);
+    add_prefixed_stat(prefix.c_str(),
+                      "flush_batch_size",
+                      batchSize.load(std::memory_order_relaxed),
+                      add_stat,
+                      c);
+    add_prefixed_stat(prefix.c_str(),
+                      "flush_commit_us_per_item",
+                      commitTimePerItem.load(std::memory_order_relaxed),
+                      add_stat,
+                      c);
+}
@@ -19,12 +19,16 @@
 #include "executorthread.h"
 #include "utility.h"
 
+#include <memcached/engine_common.h>
 #include <memcached/vbucket.h>
 
+#include <atomic>
+#include <chrono>
 #include <list>
 #include <map>
 #include <queue>
 #include <string>
+#include <vector>
 
 #define NO_VBUCKETS_INSTANTIATED 0xFFFF
 #define RETRY_FLUSH_VBUCKET (-1)
@@ -35,6 +39,74 @@ const double DEFAULT_MAX_SLEEP_TIME = 10.0;
 class EPBucket;
 class KVShard;
 
+/**
+ * Picks the number of items the flusher puts in a batch (commit) for the
+ * vBuckets of a shard, so the commits take about a target time.
+ *
+ * Small commits pay the fixed cost of the commit (the fsync) for few items
+ * and large ones delay everything waiting for the persistence of the batch
+ * (e.g. the SyncWrites with level PersistToMajority). The sizer keeps an
+ * estimate of the commit time per item from the recent commits and sizes the
+ * batch to the target time, growing it (at most by doubling) only after a
+ * batch which was limited by the size.
+ *
+ * Disabled (the batch size is flusher_batch_split_trigger) while the target
+ * is zero.
+ */
+class FlushBatchSizer {
+public:
+    /// The smallest batch we'll pick
+    static constexpr size_t MinBatchSize = 100;
+
+    void setTargetCommitTime(std::chrono::microseconds target) {
+        targetCommitTime.store(target.count(), std::memory_order_relaxed);
+    }
+
+    /**
+     * @param limit the largest batch allowed (flusher_batch_split_trigger)
+     * @return the number of items to flush in the next batch
+     */
+    size_t getBatchSize(size_t limit) const;
+
+    /**
+     * Record the time taken to commit a batch.
+     *
+     * @param items the number of items in the batch
+     * @param duration the time taken by the commit
+     * @param limited true if the batch was limited by the batch size (there
+     *                were more items to flush)
+     */
+    void commitCompleted(size_t items,
+                         std::chrono::microseconds duration,
+                         bool limited);
+
+    /// Add the current decisions to the stats (for "kvtimings")
+    void addStats(const std::string& prefix,
+                  const AddStatFn& add_stat,
+                  const void* c) const;
+
+private:
+    /// The target commit time in us, zero if disabled
+    std::atomic<uint64_t> targetCommitTime{0};
+    /// The batch size, zero until we've seen a commit
+    std::atomic<size_t> batchSize{0};
+    /// Moving average of the commit time per item in us
+    std::atomic<double> commitTimePerItem{0};
+};
+
+/**
+ * The state of a vBucket used to pick the order the flusher flushes the
+ * vBuckets of a shard in (see Flusher::sortInFlushOrder)
+ */
+struct VBucketFlushOrder {
+    Vbid vbid;
+    vbucket_state_t state;
+    /// The average age of the dirty items
+    uint64_t age;
+    /// The number of dirty items
+    size_t backlog;
+};
+
 /**
  * Manage persistence of data for an EPBucket.
  */
@@ -63,8 +135,39 @@ public:
             wake();
         }
     }
+    /**
+     * A prepare whose level requires persistence was queued in one of the
+     * shard's vBuckets; the vBuckets with such prepares pending are flushed
+     * before the others (and their commits aren't held up by group commit)
+     */
+    void notifyDurablePrepare() {
+        if (!pendingDurablePrepares.exchange(true)) {
+            wake();
+        }
+    }
+
     void setTaskId(size_t newId) { taskId = newId; }
 
+    FlushBatchSizer& getBatchSizer() {
+        return batchSizer;
+    }
+
+    /**
+     * Set how long after the first commit of a group of commits we keep
+     * committing vBuckets before syncing the group (see
+     * EPBucket::beginGroupCommit). Zero disables group commit.
+     */
+    void setGroupCommitWindow(std::chrono::milliseconds window) {
+        groupCommitWindow.store(window.count());
+    }
+
+    /**
+     * Sort the vBuckets in the order they should be flushed; by state
+     * (active first), then the ones whose dirty items have been waiting the
+     * longest, then the smaller backlogs.
+     */
+    static void sortInFlushOrder(std::vector<VBucketFlushOrder>& order);
+
 private:
     enum class State {
         Initializing,
@@ -83,12 +186,39 @@ private:
     void schedule_UNLOCKED();
     double computeMinSleepTime();
 
+    /// Start a group of commits, if group commit is enabled and supported
+    void maybeBeginGroupCommit();
+
+    /**
+     * Complete the group of commits in progress when the window is over or
+     * we've got no more vBuckets to flush.
+     */
+    void maybeCompleteGroupCommit();
+
+    /// Complete the group of commits in progress (if any)
+    void completeGroupCommit();
+
+    /**
+     * @return the vBuckets of the shard in the order they should be flushed;
+     *         ordered by state and then by how long their dirty items have
+     *         been waiting.
+     */
+    std::vector<Vbid> getVBucketsInFlushOrder();
+
     const char* stateName(State st) const;
 
     bool canSnooze(void) {
-        return lpVbs.empty() && hpVbs.empty() && !pendingMutation.load();
+        return lpVbs.empty() && hpVbs.empty() && durableVbs.empty() &&
+               !pendingMutation.load() && !pendingDurablePrepares.load();
     }
 
+    /**
+     * Flush the next of the vBuckets with a durable prepare pending, and
+     * complete the group of commits once all of them are flushed
+     * @return true if there was one to flush
+     */
+    bool flushDurableVB();
+
     EPBucket* store;
     std::atomic<State> _state;
 
@@ -101,11 +231,29 @@ private:
     std::atomic<bool> forceShutdownReceived;
     std::queue<Vbid> hpVbs;
     std::queue<Vbid> lpVbs;
+    /// The vBuckets with a durable prepare pending, flushed first
+    std::queue<Vbid> durableVbs;
+    std::atomic<bool> pendingDurablePrepares{false};
+    /// The durable flushes since the last flush of the normal queues
+    size_t consecutiveDurableFlushes{0};
+    /// Flush (at most) this many vBuckets from durableVbs in a row
+    static constexpr size_t maxConsecutiveDurableFlushes = 4;
+    /// Don't flush the durable prepares first until then (after a failure)
+    std::chrono::steady_clock::time_point durableFlushBackoffUntil;
+    static constexpr std::chrono::seconds durableFlushBackoff{1};
     bool doHighPriority;
     size_t numHighPriority;
     std::atomic<bool> pendingMutation;
 
     KVShard *shard;
 
+    FlushBatchSizer batchSizer;
+
+    /// The group commit window in ms, zero if disabled
+    std::atomic<uint64_t> groupCommitWindow{0};
+    bool groupCommitActive{false};
+    /// When the group of commits in progress started
+    std::chrono::steady_clock::time_point groupCommitStart;
+
     DISALLOW_COPY_AND_ASSIGN(Flusher);
 };
@@ -28,6 +28,7 @@
 
 #include <algorithm>
 #include <chrono>
+#include <iterator>
 #include <mutex>
 #include <queue>
 
@@ -72,7 +73,7 @@ public:
                         std::chrono::steady_clock::time_point newTime) {
         std::lock_guard<std::mutex> lock(queueMutex);
         task->updateWaketime(newTime);
-        // After modifiying the task's wakeTime, rebuild the heap
+        // After modifiying the task's wakeTime, re-sift it in the heap
         return queue.heapify(task);
     }
 
@@ -84,7 +85,7 @@ public:
     bool snooze(const ExTask& task, const double secs) {
         std::lock_guard<std::mutex> lock(queueMutex);
         task->snooze(secs);
-        // After modifiying the task's wakeTime, rebuild the heap
+        // After modifiying the task's wakeTime, re-sift it in the heap
         return queue.heapify(task);
     }
 
@@ -113,21 +114,20 @@ protected:
          * @returns true if 'task' is in the queue and heapify() did something.
          */
         bool heapify(const ExTask& task) {
-            // if the task exists, rebuild
-            if (exists(task)) {
-                if (this->c.back()->getId() == task->getId()) {
-                    std::push_heap(this->c.begin(),
-                                   this->c.end(),
-                                   this->comp);
-                } else {
-                    std::make_heap(this->c.begin(),
-                                   this->c.end(),
-                                   this->comp);
-                }
-                return true;
-            } else {
+            // A task object has a single id, so compare the pointers rather
+            // than the ids (which would dereference every queued task).
+            auto it = std::find(this->c.begin(), this->c.end(), task);
+            if (it == this->c.end()) {
                 return false;
             }
+            if (std::find(std::next(it), this->c.end(), task) !=
+                this->c.end()) {
+                // Pushed more than once; rebuild to move every copy.
+                std::make_heap(this->c.begin(), this->c.end(), this->comp);
+            } else if (!siftUp(it - this->c.begin())) {
+                siftDown(it - this->c.begin());
+            }
+            return true;
         }
 
         void verifyHeapProperty() {
@@ -154,12 +154,45 @@ protected:
         }
 
     protected:
-        bool exists(const ExTask& task) {
-            return std::find_if(this->c.begin(),
-                                this->c.end(),
-                                [&task](const ExTask& qTask) {
-                                    return task->getId() == qTask->getId();
-                                }) != this->c.end();
+        /*
+         * Move the element at pos towards the top of the heap until its
+         * parent has priority over it.
+         * @returns true if the element moved.
+         */
+        bool siftUp(size_t pos) {
+            const size_t start = pos;
+            while (pos > 0) {
+                const size_t parent = (pos - 1) / 2;
+                if (!this->comp(this->c[parent], this->c[pos])) {
+                    break;
+                }
+                std::swap(this->c[parent], this->c[pos]);
+                pos = parent;
+            }
+            return pos != start;
+        }
+
+        /*
+         * Move the element at pos towards the bottom of the heap until it
+         * has priority over both of its children.
+         */
+        void siftDown(size_t pos) {
+            const size_t size = this->c.size();
+            while (true) {
+                size_t child = 2 * pos + 1;
+                if (child >= size) {
+                    break;
+                }
+                if (child + 1 < size &&
+                    this->comp(this->c[child], this->c[child + 1])) {
+                    ++child;
+                }
+                if (!this->comp(this->c[pos], this->c[child])) {
+                    break;
+                }
+                std::swap(this->c[pos], this->c[child]);
+                pos = child;
+            }
         }
 
     } queue;
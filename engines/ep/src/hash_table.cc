@@ -21,12 +21,20 @@
 #include "stats.h"
 #include "stored_value_factories.h"
 
+#include <folly/Portability.h>
 #include <folly/lang/Assume.h>
+#include <folly/lang/Bits.h>
 #include <phosphor/phosphor.h>
 #include <platform/compress.h>
 
 #include <logtags.h>
+#include <algorithm>
 #include <cstring>
+#include <random>
+
+#if FOLLY_SSE >= 2
+#include <emmintrin.h>
+#endif
 
 static const ssize_t prime_size_table[] = {
     3, 7, 13, 23, 47, 97, 193, 383, 769, 1531, 3079, 6143, 12289, 24571, 49157,
@@ -58,6 +66,152 @@ static const ssize_t prime_size_table[] = {
  */
 static const double freqCounterIncFactor = 0.012;
 
+/**
+ * The average number of items we aim to keep in each bucket of the Grouped
+ * layout when resizing (3/4 of the slots) - the remaining slots keeps the
+ * number of overflowed slots low.
+ */
+static const size_t groupTargetLoad = HashTable::GroupSlots * 3 / 4;
+
+/**
+ * The number of buckets an incremental resize migrates each time it
+ * acquires a lock; keeps the time the lock is held short.
+ */
+static const size_t migrateBatchSize = 64;
+
+/// Iterate over the set bits of a mask; returns the index of the lowest
+/// set bit and clears it
+static size_t popLowestBit(uint32_t& mask) {
+    const size_t ret = folly::findFirstSet(mask) - 1;
+    mask &= mask - 1;
+    return ret;
+}
+
+/// Hint that the memory at the address is about to be read
+static void prefetch(const void* addr) {
+#if defined(__GNUC__)
+    __builtin_prefetch(addr);
+#endif
+}
+
+uint32_t HashTable::Group::match(uint8_t tag) const {
+    static_assert(GroupSlots == 16,
+                  "HashTable::Group::match: expects 16 slots per group");
+#if FOLLY_SSE >= 2
+    const auto group =
+            _mm_load_si128(reinterpret_cast<const __m128i*>(tags.data()));
+    const auto result = _mm_cmpeq_epi8(group, _mm_set1_epi8(char(tag)));
+    return uint32_t(_mm_movemask_epi8(result));
+#else
+    uint32_t ret = 0;
+    for (size_t ii = 0; ii < GroupSlots; ++ii) {
+        ret |= uint32_t(tags[ii] == tag) << ii;
+    }
+    return ret;
+#endif
+}
+
+StoredValue::UniquePtr& HashTable::Group::slotForInsert(uint8_t tag) {
+    auto empty = match(EmptyTag);
+    if (empty) {
+        const auto slot = popLowestBit(empty);
+        tags[slot] = tag;
+        return slots[slot];
+    }
+
+    // All of the slots are in use; share the slot picked by the tag (which
+    // spreads the overflowing tags over all of the slots)
+    const auto slot = tag % GroupSlots;
+    if (tags[slot] != tag) {
+        overflow |= uint32_t(1) << slot;
+    }
+    return slots[slot];
+}
+
+void HashTable::Group::releaseSlotIfEmpty(size_t slot) {
+    if (!slots[slot]) {
+        tags[slot] = EmptyTag;
+        overflow &= ~(uint32_t(1) << slot);
+    }
+}
+
+uint8_t HashTable::tagForHash(uint32_t h) {
+    // The bucket is picked with the low order bits (modulo the size), so
+    // mix all of the bits into the top ones and use 7 of them. The top bit
+    // is always set so that a tag is never EmptyTag.
+    return uint8_t(((h * 0x9e3779b1U) >> 25) | 0x80);
+}
+
+HashTable::Table::Table(Layout layout, size_t size) {
+    if (layout == Layout::Grouped) {
+        groups.resize(size);
+    } else {
+        values.resize(size);
+    }
+}
+
+StoredValue::UniquePtr& HashTable::chainForInsert(Table& t,
+                                                  size_t bucket,
+                                                  const DocKey& key) {
+    if (layout == Layout::Grouped) {
+        return t.groups[bucket].slotForInsert(tagForHash(key.hash()));
+    }
+    return t.values[bucket];
+}
+
+template <typename F>
+void HashTable::forEachChain(Table& t, size_t bucket, F f) {
+    if (layout == Layout::Grouped) {
+        for (auto& slot : t.groups[bucket].slots) {
+            if (slot && !f(slot)) {
+                return;
+            }
+        }
+    } else if (t.values[bucket]) {
+        f(t.values[bucket]);
+    }
+}
+
+template <typename Pred>
+StoredValue::UniquePtr HashTable::tableRemoveFirst(Table& t,
+                                                   size_t bucket,
+                                                   const DocKey& key,
+                                                   Pred p) {
+    if (layout == Layout::Chained) {
+        if (!t.values[bucket]) {
+            return nullptr;
+        }
+        return hashChainRemoveFirst(t.values[bucket], p);
+    }
+
+    auto& group = t.groups[bucket];
+    auto candidates = group.match(tagForHash(key.hash())) | group.overflow;
+    while (candidates) {
+        const auto slot = popLowestBit(candidates);
+        if (!group.slots[slot]) {
+            continue;
+        }
+        auto removed = hashChainRemoveFirst(group.slots[slot], p);
+        if (removed) {
+            group.releaseSlotIfEmpty(slot);
+            return removed;
+        }
+    }
+    return nullptr;
+}
+
+template <typename Pred>
+StoredValue::UniquePtr HashTable::bucketRemoveFirst(size_t bucket,
+                                                    const DocKey& key,
+                                                    Pred p) {
+    auto removed = tableRemoveFirst(table, bucket, key, p);
+    if (!removed && isResizing()) {
+        removed = tableRemoveFirst(
+                oldTable, getOldBucketForHash(key.hash()), key, p);
+    }
+    return removed;
+}
+
 std::string to_string(MutationStatus status) {
     switch (status) {
     case MutationStatus::NotFound:
@@ -101,11 +255,19 @@ HashTable::StoredValueProxy::~StoredValueProxy() {
 HashTable::HashTable(EPStats& st,
                      std::unique_ptr<AbstractStoredValueFactory> svFactory,
                      size_t initialSize,
-                     size_t locks)
+                     size_t locks,
+                     Layout layout,
+                     std::shared_ptr<Locks> shardLocks)
     : initialSize(initialSize),
       size(initialSize),
-      mutexes(locks),
+      layout(layout),
+      table(layout, initialSize),
+      sharedLocks(shardLocks != nullptr),
+      lockArray(shardLocks ? std::move(shardLocks)
+                            : std::make_shared<Locks>(locks)),
+      mutexes(*lockArray),
       stats(st),
+      lockProfile(st.lockProfiler.get(LockProfiler::Lock::HashTable)),
       valFact(std::move(svFactory)),
       visitors(0),
       valueStats(stats),
@@ -113,7 +275,6 @@ HashTable::HashTable(EPStats& st,
       numResizes(0),
       maxDeletedRevSeqno(0),
       probabilisticCounter(freqCounterIncFactor) {
-    values.resize(size);
     activeState = true;
 }
 
@@ -142,7 +303,7 @@ void HashTable::clear(bool deactivate) {
                     "non-active object");
         }
     }
-    MultiLockHolder mlh(mutexes);
+    MultiLockHolder<Mutex> mlh(mutexes);
     clear_UNLOCKED(deactivate);
 }
 
@@ -152,16 +313,30 @@ void HashTable::clear_UNLOCKED(bool deactivate) {
     }
     size_t clearedMemSize = 0;
     size_t clearedValSize = 0;
-    for (int i = 0; i < (int)size; i++) {
-        while (values[i]) {
-            // Take ownership of the StoredValue from the vector, update
+    auto clearChain = [&clearedMemSize, &clearedValSize](auto& chain) {
+        while (chain) {
+            // Take ownership of the StoredValue from the chain, update
             // statistics and release it.
-            auto v = std::move(values[i]);
+            auto v = std::move(chain);
             clearedMemSize += v->size();
             clearedValSize += v->valuelen();
-            values[i] = std::move(v->getNext());
+            chain = std::move(v->getNext());
         }
-    }
+        return true;
+    };
+    auto clearTable = [this, &clearChain](Table& t, size_t tableSize) {
+        for (size_t i = 0; i < tableSize; i++) {
+            forEachChain(t, i, clearChain);
+            if (layout == Layout::Grouped) {
+                t.groups[i].tags = {};
+                t.groups[i].overflow = 0;
+            }
+        }
+    };
+    clearTable(table, size);
+    // A resize may be in progress; the old table is cleared as well and the
+    // resize carries on migrating its (now empty) buckets.
+    clearTable(oldTable, oldSize);
 
     stats.coreLocal.get()->currentSize.fetch_sub(clearedMemSize -
                                                  clearedValSize);
@@ -187,27 +362,38 @@ void HashTable::resize() {
     int i(0);
     size_t new_size(0);
 
-    // Figure out where in the prime table we are.
+    // Figure out where in the prime table we are. A bucket of the Grouped
+    // layout holds many items.
+    if (layout == Layout::Grouped) {
+        ni /= groupTargetLoad;
+    }
     ssize_t target(static_cast<ssize_t>(ni));
     for (i = 0; prime_size_table[i] > 0 && prime_size_table[i] < target; ++i) {
         // Just looking...
     }
 
+    // Round the candidate sizes up to a multiple of the number of locks so
+    // the table may be resized incrementally (the next time).
+    const ssize_t locks = mutexes.size();
+    auto candidate = [locks](int index) -> ssize_t {
+        return ((prime_size_table[index] + locks - 1) / locks) * locks;
+    };
+
     if (prime_size_table[i] == -1) {
         // We're at the end, take the biggest
-        new_size = prime_size_table[i-1];
+        new_size = candidate(i - 1);
     } else if (prime_size_table[i] < static_cast<ssize_t>(initialSize)) {
         // Was going to be smaller than the initial size.
         new_size = initialSize;
     } else if (0 == i) {
-        new_size = prime_size_table[i];
-    }else if (isCurrently(size, prime_size_table[i-1], prime_size_table[i])) {
+        new_size = candidate(i);
+    } else if (isCurrently(size, candidate(i - 1), candidate(i))) {
         // If one of the candidate sizes is the current size, maintain
         // the current size in order to remain stable.
         new_size = size;
     } else {
         // Somewhere in the middle, use the one we're closer to.
-        new_size = nearest(ni, prime_size_table[i-1], prime_size_table[i]);
+        new_size = nearest(ni, candidate(i - 1), candidate(i));
     }
 
     resize(new_size);
@@ -230,10 +416,22 @@ void HashTable::resize(size_t newSize) {
         return;
     }
 
+    // Only one resize may run at a time (an incremental resize runs for a
+    // while without holding the HashTable locks).
+    std::lock_guard<std::mutex> resizeGuard(resizeMutex);
+    if (newSize == size) {
+        return;
+    }
+
     TRACE_EVENT2(
             "HashTable", "resize", "size", size.load(), "newSize", newSize);
 
-    MultiLockHolder mlh(mutexes);
+    if (size % mutexes.size() == 0 && newSize % mutexes.size() == 0) {
+        resizeIncrementally(newSize);
+        return;
+    }
+
+    MultiLockHolder<Mutex> mlh(mutexes);
     if (visitors.load() > 0) {
         // Do not allow a resize while any visitors are actually
         // processing.  The next attempt will have to pick it up.  New
@@ -243,35 +441,117 @@ void HashTable::resize(size_t newSize) {
     }
 
     // Get a place for the new items.
-    table_type newValues(newSize);
+    Table newTable(layout, newSize);
 
     stats.coreLocal.get()->memOverhead.fetch_sub(memorySize());
     ++numResizes;
 
     // Set the new size so all the hashy stuff works.
-    size_t oldSize = size;
+    size_t previousSize = size;
     size.store(newSize);
 
     // Move existing records into the new space.
-    for (size_t i = 0; i < oldSize; i++) {
-        while (values[i]) {
-            // unlink the front element from the hash chain at values[i].
-            auto v = std::move(values[i]);
-            values[i] = std::move(v->getNext());
-
-            // And re-link it into the correct place in newValues.
-            int newBucket = getBucketForHash(v->getKey().hash());
-            v->setNext(std::move(newValues[newBucket]));
-            newValues[newBucket] = std::move(v);
-        }
+    for (size_t i = 0; i < previousSize; i++) {
+        forEachChain(table, i, [this, &newTable](auto& chain) {
+            while (chain) {
+                // unlink the front element from the hash chain.
+                auto v = std::move(chain);
+                chain = std::move(v->getNext());
+
+                // And re-link it into the correct place in the new table.
+                auto& newChain = chainForInsert(
+                        newTable,
+                        getBucketForHash(v->getKey().hash()),
+                        v->getKey());
+                v->setNext(std::move(newChain));
+                newChain = std::move(v);
+            }
+            return true;
+        });
     }
 
-    // Finally assign the new table to values.
-    values = std::move(newValues);
+    // Finally assign the new table.
+    table = std::move(newTable);
 
     stats.coreLocal.get()->memOverhead.fetch_add(memorySize());
 }
 
+void HashTable::resizeIncrementally(size_t newSize) {
+    // Allocate the new table before taking the locks (it is released after
+    // the locks if we don't end up using it)
+    Table newTable(layout, newSize);
+    {
+        MultiLockHolder<Mutex> mlh(mutexes);
+        if (visitors.load() > 0) {
+            // See resize(); visitors don't expect the table to change under
+            // their feet.
+            return;
+        }
+
+        stats.coreLocal.get()->memOverhead.fetch_sub(memorySize());
+        ++numResizes;
+
+        oldTable = std::move(table);
+        table = std::move(newTable);
+        oldSize.store(size);
+        size.store(newSize);
+
+        stats.coreLocal.get()->memOverhead.fetch_add(memorySize());
+    }
+
+    // The front-end threads search both tables until we're done
+    for (size_t lock = 0; lock < mutexes.size(); ++lock) {
+        migrateLock(lock);
+    }
+
+    Table released;
+    {
+        MultiLockHolder<Mutex> mlh(mutexes);
+        stats.coreLocal.get()->memOverhead.fetch_sub(memorySize());
+        std::swap(released, oldTable);
+        oldSize.store(0);
+        stats.coreLocal.get()->memOverhead.fetch_add(memorySize());
+    }
+}
+
+void HashTable::migrateLock(size_t lock) {
+    const size_t numLocks = mutexes.size();
+    size_t bucket = lock;
+    while (true) {
+        LockHolder lh(mutexes[lock]);
+        // The resize may have been completed by someone else
+        const size_t from = oldSize;
+        for (size_t ii = 0; ii < migrateBatchSize && bucket < from;
+             ++ii, bucket += numLocks) {
+            migrateBucket(bucket);
+        }
+        if (bucket >= from) {
+            return;
+        }
+    }
+}
+
+void HashTable::migrateBucket(size_t oldBucket) {
+    forEachChain(oldTable, oldBucket, [this](auto& chain) {
+        while (chain) {
+            auto v = std::move(chain);
+            chain = std::move(v->getNext());
+
+            // Both buckets are guarded by the same lock (see
+            // resizeIncrementally())
+            auto& newChain = chainForInsert(
+                    table, getBucketForHash(v->getKey().hash()), v->getKey());
+            v->setNext(std::move(newChain));
+            newChain = std::move(v);
+        }
+        return true;
+    });
+    if (layout == Layout::Grouped) {
+        oldTable.groups[oldBucket].tags = {};
+        oldTable.groups[oldBucket].overflow = 0;
+    }
+}
+
 HashTable::FindInnerResult HashTable::findInner(const DocKey& key) {
     if (!isActive()) {
         throw std::logic_error(
@@ -279,34 +559,104 @@ HashTable::FindInnerResult HashTable::findInner(const DocKey& key) {
                 "non-active object");
     }
     HashBucketLock hbl = getLockedBucket(key);
+    auto found = unlocked_findInner(key, hbl.getBucketNum());
+    return {std::move(hbl), found.first, found.second};
+}
+
+void HashTable::prefetchBucket(const Table& t, size_t bucket) const {
+    if (layout == Layout::Grouped) {
+        prefetch(&t.groups[bucket]);
+    } else {
+        prefetch(&t.values[bucket]);
+    }
+}
+
+void HashTable::prefetchChains(const Table& t,
+                               size_t bucket,
+                               uint32_t hash) const {
+    if (layout == Layout::Grouped) {
+        const auto& group = t.groups[bucket];
+        auto candidates = group.match(tagForHash(hash)) | group.overflow;
+        while (candidates) {
+            prefetch(group.slots[popLowestBit(candidates)].get().get());
+        }
+    } else {
+        prefetch(t.values[bucket].get().get());
+    }
+}
+
+std::pair<StoredValue*, StoredValue*> HashTable::unlocked_findInner(
+        const DocKey& key, int bucket) {
     // Scan through all elements in the hash bucket chain looking for Committed
     // and Pending items with the same key.
     StoredValue* foundCmt = nullptr;
     StoredValue* foundPend = nullptr;
-    for (StoredValue* v = values[hbl.getBucketNum()].get().get(); v;
-         v = v->getNext().get().get()) {
-        if (v->hasKey(key)) {
-            if (v->isPending()) {
-                Expects(!foundPend);
-                foundPend = v;
-            } else {
-                Expects(!foundCmt);
-                foundCmt = v;
+    auto searchChain = [&key, &foundCmt, &foundPend](StoredValue* v) {
+        for (; v; v = v->getNext().get().get()) {
+            if (v->hasKey(key)) {
+                if (v->isPending()) {
+                    Expects(!foundPend);
+                    foundPend = v;
+                } else {
+                    Expects(!foundCmt);
+                    foundCmt = v;
+                }
             }
         }
+    };
+    auto searchBucket = [this, &key, &searchChain](const Table& t,
+                                                    size_t bucket) {
+        if (layout == Layout::Grouped) {
+            // Only search the slots with our tag (and the ones which may
+            // hold any tag)
+            const auto& group = t.groups[bucket];
+            auto candidates =
+                    group.match(tagForHash(key.hash())) | group.overflow;
+            while (candidates) {
+                const auto slot = popLowestBit(candidates);
+                searchChain(group.slots[slot].get().get());
+            }
+        } else {
+            searchChain(t.values[bucket].get().get());
+        }
+    };
+
+    searchBucket(table, bucket);
+    if (isResizing()) {
+        // The items may not have been migrated to the new table yet (the
+        // lock we hold guards the old bucket as well)
+        searchBucket(oldTable, getOldBucketForHash(key.hash()));
     }
 
-    return {std::move(hbl), foundCmt, foundPend};
+    return {foundCmt, foundPend};
 }
 
-std::unique_ptr<Item> HashTable::getRandomKey(long rnd) {
-    /* Try to locate a partition */
-    size_t start = rnd % size;
-    size_t curr = start;
+std::unique_ptr<Item> HashTable::getRandomKey(
+        long rnd, boost::optional<CollectionID> cid) {
+    std::minstd_rand gen(rnd);
     std::unique_ptr<Item> ret;
 
+    // While resizing the items of an old bucket are reachable from more
+    // than one of the new buckets, so they would be picked more often
+    if (!isResizing() && valueStats.getNumItems() != 0) {
+        const size_t bound = RandomKeyBucketBound *
+                             (layout == Layout::Grouped ? GroupSlots : 1);
+        for (size_t attempt = 0; !ret && attempt < RandomKeyMaxAttempts;
+             ++attempt) {
+            const size_t slot = gen() % size;
+            ret = getRandomKeyFromSlot(slot, cid, bound, gen());
+        }
+        if (ret) {
+            return ret;
+        }
+    }
+
+    /* Walk the table from a random bucket */
+    size_t start = gen() % size;
+    size_t curr = start;
+
     do {
-        ret = getRandomKeyFromSlot(curr++);
+        ret = getRandomKeyFromSlot(curr++, cid);
         if (curr == size) {
             curr = 0;
         }
@@ -315,6 +665,24 @@ std::unique_ptr<Item> HashTable::getRandomKey(long rnd) {
     return ret;
 }
 
+size_t HashTable::visitRandomBucket(HashTableVisitor& visitor, long rnd) {
+    if (!isActive() || valueStats.getNumItems() == 0) {
+        return 0;
+    }
+    size_t start = rnd % size;
+    size_t curr = start;
+    size_t visited = 0;
+
+    do {
+        visited = visitSlot(visitor, curr++);
+        if (curr == size) {
+            curr = 0;
+        }
+    } while (visited == 0 && curr != start);
+
+    return visited;
+}
+
 MutationStatus HashTable::set(Item& val) {
     auto htRes = findForWrite(val.getKey());
     if (htRes.storedValue) {
@@ -326,6 +694,28 @@ MutationStatus HashTable::set(Item& val) {
     }
 }
 
+MutationStatus HashTable::setNonResident(const Item& val) {
+    auto htRes = findForWrite(val.getKey());
+    MutationStatus status = MutationStatus::WasClean;
+    StoredValue* v;
+    if (htRes.storedValue) {
+        auto res = unlocked_updateStoredValue(
+                htRes.lock, *htRes.storedValue, val);
+        status = res.status;
+        v = res.storedValue;
+    } else {
+        v = unlocked_addNewStoredValue(htRes.lock, val);
+    }
+
+    if (v) {
+        const auto preProps = valueStats.prologue(v);
+        v->markNotResident();
+        v->markClean();
+        valueStats.epilogue(preProps, v);
+    }
+    return status;
+}
+
 HashTable::UpdateResult HashTable::unlocked_updateStoredValue(
         const HashBucketLock& hbl, StoredValue& v, const Item& itm) {
     if (!hbl.getHTLock()) {
@@ -362,6 +752,8 @@ HashTable::UpdateResult HashTable::unlocked_updateStoredValue(
 
         const auto preProps = valueStats.prologue(&v);
 
+        // Bring the epoch up to date, the counter of the Item is current
+        decayFreqCounter(v);
         /* setValue() will mark v as undeleted if required */
         v.setValue(itm);
         updateFreqCounter(v);
@@ -390,12 +782,16 @@ StoredValue* HashTable::unlocked_addNewStoredValue(const HashBucketLock& hbl,
     const auto emptyProperties = valueStats.prologue(nullptr);
 
     // Create a new StoredValue and link it into the head of the bucket chain.
-    auto v = (*valFact)(itm, std::move(values[hbl.getBucketNum()]));
+    auto& chain = chainForInsert(table, hbl.getBucketNum(), itm.getKey());
+    auto v = (*valFact)(itm, std::move(chain));
+    // The frequency counter of the Item is current
+    v.get().get()->setFreqDecayEpoch(
+            freqDecayEpoch.load(std::memory_order_relaxed));
 
     valueStats.epilogue(emptyProperties, v.get().get());
 
-    values[hbl.getBucketNum()] = std::move(v);
-    return values[hbl.getBucketNum()].get().get();
+    chain = std::move(v);
+    return chain.get().get();
 }
 
 HashTable::Statistics::StoredValueProperties::StoredValueProperties(
@@ -416,6 +812,7 @@ HashTable::Statistics::StoredValueProperties::StoredValueProperties(
     isTempItem = sv->isTempItem();
     isSystemItem = sv->getKey().getCollectionID().isSystem();
     isPreparedSyncWrite = sv->isPending();
+    cid = sv->getKey().getCollectionID();
 }
 
 HashTable::Statistics::StoredValueProperties HashTable::Statistics::prologue(
@@ -434,6 +831,16 @@ void HashTable::Statistics::epilogue(StoredValueProperties pre,
     if (pre.size != post.size) {
         cacheSize.fetch_add(post.size - pre.size);
         memSize.fetch_add(post.size - pre.size);
+        if (pre.isValid && post.isValid && pre.cid == post.cid) {
+            updateCollectionMemory(post.cid, post.size - pre.size);
+        } else {
+            if (pre.isValid) {
+                updateCollectionMemory(pre.cid, -pre.size);
+            }
+            if (post.isValid) {
+                updateCollectionMemory(post.cid, post.size);
+            }
+        }
     }
     if (pre.metaDataSize != post.metaDataSize) {
         metaDataMemory.fetch_add(post.metaDataSize - pre.metaDataSize);
@@ -500,7 +907,46 @@ void HashTable::Statistics::epilogue(StoredValueProperties pre,
     }
 }
 
+void HashTable::Statistics::updateCollectionMemory(CollectionID cid,
+                                                   int64_t delta) {
+    {
+        auto map = collectionMemory.rlock();
+        auto itr = map->find(cid);
+        if (itr != map->end()) {
+            itr->second.bytes.fetch_add(delta);
+            return;
+        }
+    }
+    auto map = collectionMemory.wlock();
+    (*map)[cid].bytes.fetch_add(delta);
+}
+
+size_t HashTable::Statistics::getCollectionMemory(CollectionID cid) const {
+    auto map = collectionMemory.rlock();
+    auto itr = map->find(cid);
+    if (itr == map->end()) {
+        return 0;
+    }
+    return std::max(int64_t(0), itr->second.bytes.load());
+}
+
+std::unordered_map<CollectionID, size_t>
+HashTable::Statistics::getCollectionsMemory() const {
+    std::unordered_map<CollectionID, size_t> rv;
+    auto map = collectionMemory.rlock();
+    for (const auto& entry : *map) {
+        rv[entry.first] = std::max(int64_t(0), entry.second.bytes.load());
+    }
+    return rv;
+}
+
 void HashTable::Statistics::reset() {
+    {
+        auto map = collectionMemory.wlock();
+        for (auto& entry : *map) {
+            entry.second.bytes.store(0);
+        }
+    }
     datatypeCounts.fill(0);
     numItems.store(0);
     numTempItems.store(0);
@@ -529,15 +975,15 @@ HashTable::unlocked_replaceByCopy(const HashBucketLock& hbl,
     auto releasedSv = unlocked_release(hbl, vToCopy.getKey());
 
     /* Copy the StoredValue and link it into the head of the bucket chain. */
-    auto newSv = valFact->copyStoredValue(
-            vToCopy, std::move(values[hbl.getBucketNum()]));
+    auto& chain = chainForInsert(table, hbl.getBucketNum(), vToCopy.getKey());
+    auto newSv = valFact->copyStoredValue(vToCopy, std::move(chain));
 
     // Adding a new item into the HashTable; update stats.
     const auto emptyProperties = valueStats.prologue(nullptr);
     valueStats.epilogue(emptyProperties, newSv.get().get());
 
-    values[hbl.getBucketNum()] = std::move(newSv);
-    return {values[hbl.getBucketNum()].get().get(), std::move(releasedSv)};
+    chain = std::move(newSv);
+    return {chain.get().get(), std::move(releasedSv)};
 }
 
 HashTable::DeleteResult HashTable::unlocked_softDelete(
@@ -581,26 +1027,125 @@ HashTable::FindROResult HashTable::findForRead(const DocKey& key,
                                                TrackReference trackReference,
                                                WantsDeleted wantsDeleted) {
     auto result = findInner(key);
+    auto* sv = selectForRead(result.committedSV,
+                             result.pendingSV,
+                             trackReference,
+                             wantsDeleted);
+    return {sv, std::move(result.lock)};
+}
+
+void HashTable::findManyForRead(
+        const std::vector<DocKey>& keys,
+        TrackReference trackReference,
+        WantsDeleted wantsDeleted,
+        const std::function<void(size_t, const StoredValue*)>& callback) {
+    if (!isActive()) {
+        throw std::logic_error(
+                "HashTable::findManyForRead: Cannot call on a "
+                "non-active object");
+    }
+
+    // The hash of each key, and the mutex guarding each key's bucket paired
+    // with the key's index
+    std::vector<uint32_t> hashes(keys.size());
+    std::vector<std::pair<size_t, size_t>> order;
+    order.reserve(keys.size());
+    for (size_t ii = 0; ii < keys.size(); ++ii) {
+        hashes[ii] = keys[ii].hash();
+        order.emplace_back(mutexForBucket(getBucketForHash(hashes[ii])), ii);
+    }
+    std::sort(order.begin(), order.end());
+
+    // The keys of a lock are looked up a window at a time, in stages: the
+    // buckets of all of the window's keys are prefetched, then the heads of
+    // their chains, then the chains are searched and the values found
+    // prefetched before the callbacks read them. The cache misses of the
+    // keys of a window so overlap rather than each lookup waiting on its
+    // own in turn.
+    struct Lookup {
+        size_t index;
+        int bucket;
+        std::pair<StoredValue*, StoredValue*> found;
+    };
+    std::array<Lookup, FindManyWindow> window;
+
+    // The keys whose bucket moved to another mutex (the table was resized
+    // before we locked it)
+    std::vector<size_t> moved;
+    auto it = order.begin();
+    while (it != order.end()) {
+        const auto mutex = it->first;
+        const int firstBucket = getBucketForHash(hashes[it->second]);
+        HashBucketLock hbl(
+                firstBucket, mutexes[mutex], lockProfile, LOCK_PROFILER_SITE);
+        while (it != order.end() && it->first == mutex) {
+            size_t count = 0;
+            for (; count < window.size() && it != order.end() &&
+                   it->first == mutex;
+                 ++it) {
+                const int bucket = getBucketForHash(hashes[it->second]);
+                if (mutexForBucket(bucket) != mutex) {
+                    moved.push_back(it->second);
+                    continue;
+                }
+                window[count++] = {it->second, bucket, {}};
+                prefetchBucket(table, bucket);
+            }
+
+            for (size_t ii = 0; ii < count; ++ii) {
+                prefetchChains(table,
+                               window[ii].bucket,
+                               hashes[window[ii].index]);
+            }
+
+            for (size_t ii = 0; ii < count; ++ii) {
+                auto& lookup = window[ii];
+                lookup.found =
+                        unlocked_findInner(keys[lookup.index], lookup.bucket);
+                if (lookup.found.first) {
+                    prefetch(lookup.found.first->peekValueBlob());
+                }
+            }
+
+            for (size_t ii = 0; ii < count; ++ii) {
+                const auto& lookup = window[ii];
+                callback(lookup.index,
+                         selectForRead(lookup.found.first,
+                                       lookup.found.second,
+                                       trackReference,
+                                       wantsDeleted));
+            }
+        }
+    }
+
+    for (const auto index : moved) {
+        auto result = findForRead(keys[index], trackReference, wantsDeleted);
+        callback(index, result.storedValue);
+    }
+}
 
+StoredValue* HashTable::selectForRead(StoredValue* committedSV,
+                                      StoredValue* pendingSV,
+                                      TrackReference trackReference,
+                                      WantsDeleted wantsDeleted) {
     /// Reading normally uses the Committed StoredValue - however if a
     /// pendingSV is found we must check if it's marked as MaybeVisible -
     /// which will block reading.
-    if (result.pendingSV && result.pendingSV->isPreparedMaybeVisible()) {
+    if (pendingSV && pendingSV->isPreparedMaybeVisible()) {
         // Return the pending one as an indication the caller cannot read it.
-        return {result.pendingSV, std::move(result.lock)};
+        return pendingSV;
     }
-    auto* sv = result.committedSV;
+    auto* sv = committedSV;
 
     if (!sv) {
         // No item found - return null.
-        return {nullptr, std::move(result.lock)};
+        return nullptr;
     }
 
-    if (result.committedSV->isDeleted()) {
+    if (sv->isDeleted()) {
         // Deleted items should only be returned if caller asked for them,
         // and we don't update ref-counts for them.
-        return {(wantsDeleted == WantsDeleted::Yes) ? sv : nullptr,
-                std::move(result.lock)};
+        return (wantsDeleted == WantsDeleted::Yes) ? sv : nullptr;
     }
 
     // Found a non-deleted item. Now check if we should update ref-count.
@@ -612,7 +1157,7 @@ HashTable::FindROResult HashTable::findForRead(const DocKey& key,
         sv->referenced();
     }
 
-    return {sv, std::move(result.lock)};
+    return sv;
 }
 
 HashTable::FindResult HashTable::findForWrite(const DocKey& key,
@@ -683,7 +1228,7 @@ StoredValue::UniquePtr HashTable::unlocked_release(
     auto releasePredicate = [&key](const StoredValue* v) {
         return v->hasKey(key);
     };
-    return unlocked_release_inner(hbl, releasePredicate);
+    return unlocked_release_inner(hbl, key, releasePredicate);
 }
 
 StoredValue::UniquePtr HashTable::unlocked_release(
@@ -694,12 +1239,15 @@ StoredValue::UniquePtr HashTable::unlocked_release(
     auto releasePredicate = [&valueToRelease](const StoredValue* v) {
         return v == valueToRelease;
     };
-    return unlocked_release_inner(hbl, releasePredicate);
+    return unlocked_release_inner(
+            hbl, valueToRelease->getKey(), releasePredicate);
 }
 
 template <typename Pred>
 StoredValue::UniquePtr HashTable::unlocked_release_inner(
-        const HashBucketLock& hbl, Pred& releasePredicate) {
+        const HashBucketLock& hbl,
+        const DocKey& key,
+        Pred& releasePredicate) {
     if (!hbl.getHTLock()) {
         throw std::invalid_argument(
                 "HashTable::unlocked_release_base: htLock not held");
@@ -713,8 +1261,8 @@ StoredValue::UniquePtr HashTable::unlocked_release_inner(
 
     // Remove the first (should only be one) StoredValue that matches the given
     // releasePredicate
-    auto released = hashChainRemoveFirst(
-            values[hbl.getBucketNum()], releasePredicate);
+    auto released =
+            bucketRemoveFirst(hbl.getBucketNum(), key, releasePredicate);
 
     if (!released) {
         /* We shouldn't reach here, we must delete the StoredValue in the
@@ -792,18 +1340,28 @@ MutationStatus HashTable::insertFromWarmup(const Item& itm,
 }
 
 bool HashTable::reallocateStoredValue(StoredValue&& sv) {
-    // Search the chain and reallocate
-    for (StoredValue::UniquePtr* curr =
-                 &values[getBucketForHash(sv.getKey().hash())];
-         curr->get().get();
-         curr = &curr->get()->getNext()) {
-        if (&sv == curr->get().get()) {
-            auto newSv = valFact->copyStoredValue(sv, std::move(sv.getNext()));
-            curr->swap(newSv);
-            return true;
+    // Search the chain(s) and reallocate
+    bool found = false;
+    auto reallocate = [this, &sv, &found](auto& chain) {
+        for (StoredValue::UniquePtr* curr = &chain; curr->get().get();
+             curr = &curr->get()->getNext()) {
+            if (&sv == curr->get().get()) {
+                auto newSv =
+                        valFact->copyStoredValue(sv, std::move(sv.getNext()));
+                curr->swap(newSv);
+                found = true;
+                return false;
+            }
         }
+        return true;
+    };
+    forEachChain(table, getBucketForHash(sv.getKey().hash()), reallocate);
+    if (!found && isResizing()) {
+        forEachChain(oldTable,
+                     getOldBucketForHash(sv.getKey().hash()),
+                     reallocate);
     }
-    return false;
+    return found;
 }
 
 void HashTable::dump() const {
@@ -839,14 +1397,21 @@ void HashTable::visitDepth(HashTableDepthVisitor &visitor) {
     lh.unlock();
 
     for (int l = 0; l < static_cast<int>(mutexes.size()); l++) {
+        // A resize which started before we registered as a visitor may
+        // still be migrating; move all of this lock's items to the current
+        // table so we see all of them.
+        if (isResizing()) {
+            migrateLock(l);
+        }
         for (int i = l; i < static_cast<int>(size); i+= mutexes.size()) {
             // (re)acquire mutex on each HashBucket, to minimise any impact
             // on front-end threads.
             LockHolder lh(mutexes[l]);
 
             size_t depth = 0;
-            StoredValue* p = values[i].get().get();
-            if (p) {
+            size_t mem(0);
+            forEachChain(table, i, [this, i, &depth, &mem](auto& chain) {
+                StoredValue* p = chain.get().get();
                 // TODO: Perf: This check seems costly - do we think it's still
                 // worth keeping?
                 auto hashbucket = getBucketForHash(p->getKey().hash());
@@ -857,13 +1422,13 @@ void HashTable::visitDepth(HashTableDepthVisitor &visitor) {
                             ") and bucket it is located in (which is " +
                             std::to_string(i) + ")");
                 }
-            }
-            size_t mem(0);
-            while (p) {
-                depth++;
-                mem += p->size();
-                p = p->getNext().get().get();
-            }
+                while (p) {
+                    depth++;
+                    mem += p->size();
+                    p = p->getNext().get().get();
+                }
+                return true;
+            });
             visitor.visit(i, depth, mem);
             ++visited;
         }
@@ -900,6 +1465,12 @@ HashTable::Position HashTable::pauseResumeVisit(HashTableVisitor& visitor,
     size_t hash_bucket = 0;
 
     for (; isActive() && !paused && lock < mutexes.size(); lock++) {
+        // A resize which started before we registered as a visitor may
+        // still be migrating; move all of this lock's items to the current
+        // table so we visit all of them (once).
+        if (isResizing()) {
+            migrateLock(lock);
+        }
 
         // If the bucket position is *this* lock, then start from the
         // recorded bucket (as long as we haven't resized).
@@ -920,14 +1491,23 @@ HashTable::Position HashTable::pauseResumeVisit(HashTableVisitor& visitor,
             // around the HashBucket visit then we need to release it before
             // tearDownHashBucketVisit() is called.
             {
-                HashBucketLock lh(hash_bucket, mutexes[lock]);
-
-                StoredValue* v = values[hash_bucket].get().get();
-                while (!paused && v) {
-                    StoredValue* tmp = v->getNext().get().get();
-                    paused = !visitor.visit(lh, *v);
-                    v = tmp;
-                }
+                HashBucketLock lh(hash_bucket,
+                                  mutexes[lock],
+                                  lockProfile,
+                                  LOCK_PROFILER_SITE);
+
+                forEachChain(table,
+                             hash_bucket,
+                             [&visitor, &lh, &paused](auto& chain) {
+                                 StoredValue* v = chain.get().get();
+                                 while (!paused && v) {
+                                     StoredValue* tmp =
+                                             v->getNext().get().get();
+                                     paused = !visitor.visit(lh, *v);
+                                     v = tmp;
+                                 }
+                                 return !paused;
+                             });
             }
 
             visitor.tearDownHashBucketVisit();
@@ -978,9 +1558,10 @@ bool HashTable::unlocked_ejectItem(const HashTable::HashBucketLock&,
     case EvictionPolicy::Full: {
         // Remove the item from the hash table.
         int bucket_num = getBucketForHash(vptr->getKey().hash());
-        auto removed = hashChainRemoveFirst(
-                values[bucket_num],
-                [vptr](const StoredValue* v) { return v == vptr; });
+        auto removed = bucketRemoveFirst(
+                bucket_num, vptr->getKey(), [vptr](const StoredValue* v) {
+                    return v == vptr;
+                });
 
         if (removed->isResident()) {
             ++stats.numValueEjects;
@@ -996,17 +1577,81 @@ bool HashTable::unlocked_ejectItem(const HashTable::HashBucketLock&,
     return true;
 }
 
-std::unique_ptr<Item> HashTable::getRandomKeyFromSlot(int slot) {
+std::unique_ptr<Item> HashTable::getRandomKeyFromSlot(
+        int slot,
+        boost::optional<CollectionID> cid,
+        size_t bound,
+        size_t rnd) {
     auto lh = getLockedBucket(slot);
-    for (StoredValue* v = values[slot].get().get(); v;
-            v = v->getNext().get().get()) {
-        if (!v->isTempItem() && !v->isDeleted() && v->isResident() &&
-            v->isCommitted()) {
-            return v->toItem(Vbid(0));
+    auto qualifies = [&cid](const StoredValue& v) {
+        return !v.isTempItem() && !v.isDeleted() && v.isResident() &&
+               v.isCommitted() &&
+               (!cid || v.getKey().getCollectionID() == *cid);
+    };
+
+    size_t skip = 0;
+    if (bound != 0) {
+        size_t count = 0;
+        forEachChain(table, slot, [&count, &qualifies](auto& chain) {
+            for (StoredValue* v = chain.get().get(); v;
+                 v = v->getNext().get().get()) {
+                if (qualifies(*v)) {
+                    ++count;
+                }
+            }
+            return true;
+        });
+        skip = rnd % std::max(bound, count);
+        if (skip >= count) {
+            return {};
         }
     }
 
-    return nullptr;
+    std::unique_ptr<Item> ret;
+    auto findItem = [&ret, &skip, &qualifies](auto& chain) {
+        for (StoredValue* v = chain.get().get(); v;
+             v = v->getNext().get().get()) {
+            if (!qualifies(*v)) {
+                continue;
+            }
+            if (skip == 0) {
+                ret = v->toItem(Vbid(0));
+                return false;
+            }
+            --skip;
+        }
+        return true;
+    };
+    forEachChain(table, slot, findItem);
+    if (!ret && bound == 0 && isResizing()) {
+        // Guarded by the same lock (see resizeIncrementally())
+        forEachChain(oldTable, slot % oldSize, findItem);
+    }
+
+    return ret;
+}
+
+size_t HashTable::visitSlot(HashTableVisitor& visitor, int slot) {
+    auto lh = getLockedBucket(slot);
+    size_t visited = 0;
+    bool stopped = false;
+    auto visitChain = [&lh, &visitor, &visited, &stopped](auto& chain) {
+        for (StoredValue* v = chain.get().get(); v;
+             v = v->getNext().get().get()) {
+            ++visited;
+            if (!visitor.visit(lh, *v)) {
+                stopped = true;
+                return false;
+            }
+        }
+        return true;
+    };
+    forEachChain(table, slot, visitChain);
+    if (!stopped && isResizing()) {
+        // Guarded by the same lock (see resizeIncrementally())
+        forEachChain(oldTable, slot % oldSize, visitChain);
+    }
+    return visited;
 }
 
 bool HashTable::unlocked_restoreValue(
@@ -1059,6 +1704,8 @@ uint8_t HashTable::generateFreqValue(uint8_t counter) {
 }
 
 void HashTable::updateFreqCounter(StoredValue& v) {
+    decayFreqCounter(v);
+
     // Attempt to increment the storedValue frequency counter
     // value.  Because a probabilistic counter is used the new
     // value will either be the same or an increment of the
@@ -1073,6 +1720,43 @@ void HashTable::updateFreqCounter(StoredValue& v) {
     }
 }
 
+bool HashTable::advanceFreqDecayEpoch(uint16_t percentage) {
+    // A StoredValue records the epoch modulo (freqDecayEpochMask + 1), so it
+    // can't tell it missed more than freqDecayEpochMask epochs
+    const auto epoch = freqDecayEpoch.load();
+    if (epoch - freqDecaySweptEpoch.load() >= StoredValue::freqDecayEpochMask) {
+        return false;
+    }
+    freqDecayPercent = percentage;
+    freqDecayEpoch = epoch + 1;
+    return true;
+}
+
+void HashTable::setFreqDecaySwept(uint32_t epoch) {
+    auto swept = freqDecaySweptEpoch.load();
+    while (swept < epoch &&
+           !freqDecaySweptEpoch.compare_exchange_weak(swept, epoch)) {
+    }
+}
+
+void HashTable::decayFreqCounter(StoredValue& v) {
+    const uint8_t epoch = freqDecayEpoch.load(std::memory_order_relaxed) &
+                          StoredValue::freqDecayEpochMask;
+    const uint8_t missed =
+            (epoch - v.getFreqDecayEpoch()) & StoredValue::freqDecayEpochMask;
+    if (missed == 0) {
+        return;
+    }
+
+    const double factor = freqDecayPercent.load() * 0.01;
+    double counter = v.getFreqCounterValue();
+    for (uint8_t ii = 0; ii < missed; ++ii) {
+        counter *= factor;
+    }
+    v.setFreqCounterValue(static_cast<uint8_t>(counter));
+    v.setFreqDecayEpoch(epoch);
+}
+
 std::ostream& operator<<(std::ostream& os, const HashTable& ht) {
     os << "HashTable[" << &ht << "] with"
        << " numItems:" << ht.getNumItems()
@@ -1083,11 +1767,19 @@ std::ostream& operator<<(std::ostream& os, const HashTable& ht) {
        << " numSystemItems:" << ht.getNumSystemItems()
        << " numPreparedSW:" << ht.getNumPreparedSyncWrites()
        << " values: " << std::endl;
-    for (const auto& chain : ht.values) {
-        if (chain) {
-            for (StoredValue* sv = chain.get().get(); sv != nullptr;
-                 sv = sv->getNext().get().get()) {
-                os << "    " << *sv << std::endl;
+    auto dumpChain = [&os](const StoredValue::UniquePtr& chain) {
+        for (StoredValue* sv = chain.get().get(); sv != nullptr;
+             sv = sv->getNext().get().get()) {
+            os << "    " << *sv << std::endl;
+        }
+    };
+    for (const auto* t : {&ht.table, &ht.oldTable}) {
+        for (const auto& chain : t->values) {
+            dumpChain(chain);
+        }
+        for (const auto& group : t->groups) {
+            for (const auto& chain : group.slots) {
+                dumpChain(chain);
             }
         }
     }
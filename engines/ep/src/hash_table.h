@@ -17,15 +17,24 @@
 
 #pragma once
 
+#include "lock_profiler.h"
 #include "probabilistic_counter.h"
 #include "stored-value.h"
 #include "storeddockey.h"
 
+#include <boost/optional/optional.hpp>
+#include <folly/SharedMutex.h>
+#include <folly/Synchronized.h>
+#include <folly/lang/Align.h>
 #include <platform/non_negative_counter.h>
 #include <utilities/hdrhistogram.h>
 
 #include <array>
+#include <atomic>
 #include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 class AbstractStoredValueFactory;
 class HashTableVisitor;
@@ -140,6 +149,14 @@ enum class DeletionDurability : uint8_t {};
  * bucket; then chaining is used (StoredValue::chain_next_or_replacement) to
  * handle any collisions.
  *
+ * Alternatively the table may use the Grouped layout (see Layout), where
+ * each bucket is a group of slots. Every slot holds the head of a chain and
+ * a 1-byte tag computed from the hash of its key, and a lookup compares its
+ * tag against all of the tags of the group at once (with SIMD where
+ * available), so only the StoredValues with a matching tag are accessed.
+ * The buckets (groups) are locked, visited and resized in exactly the same
+ * way as the buckets of the Chained layout.
+ *
  * The HashTable can be resized if it grows too full - this is done by
  * acquiring all the ht_locks, and then allocating a new vector of buckets and
  * re-hashing all elements into the new table. While resizing is occuring all
@@ -167,6 +184,48 @@ public:
     using DatatypeCombo = std::array<cb::NonNegativeCounter<size_t>,
                                      mcbp::datatype::highest + 1>;
 
+    /**
+     * How the StoredValues are laid out in the buckets of the table.
+     */
+    enum class Layout : uint8_t {
+        /// Each bucket is a single chain of StoredValues
+        Chained,
+        /**
+         * Each bucket is a group of GroupSlots chains, each tagged with a
+         * byte of the hash of its key so that a lookup only needs to access
+         * the StoredValues which are likely to match. Each bucket holds
+         * up to GroupSlots times more items than a Chained bucket.
+         */
+        Grouped
+    };
+
+    /// The number of slots in each bucket of the Grouped layout
+    static constexpr size_t GroupSlots = 16;
+
+    /**
+     * getRandomKey samples a random bucket and then a random position in
+     * [0, RandomKeyBucketBound) of it (times GroupSlots in the Grouped
+     * layout), retrying when the position is beyond the items in the
+     * bucket. Every item is then equally likely to be picked, unless its
+     * bucket holds more items than the bound (they are picked slightly
+     * less often).
+     */
+    static constexpr size_t RandomKeyBucketBound = 4;
+
+    /**
+     * The number of buckets getRandomKey samples before it falls back to
+     * walking the table from a random bucket (e.g. as the table is very
+     * sparse).
+     */
+    static constexpr size_t RandomKeyMaxAttempts = 256;
+
+    /**
+     * The number of keys findManyForRead looks up together; enough for
+     * their cache misses to overlap, few enough that what was prefetched
+     * for the first key is still in cache when it is read.
+     */
+    static constexpr size_t FindManyWindow = 8;
+
     /**
      * Represents a position within the hashtable.
      *
@@ -247,6 +306,7 @@ public:
             bool isTempItem = false;
             bool isSystemItem = false;
             bool isPreparedSyncWrite = false;
+            CollectionID cid;
         };
 
         /**
@@ -334,7 +394,16 @@ public:
             return uncompressedMemSize;
         }
 
+        /// @return the memory consumed by the items of the given collection
+        size_t getCollectionMemory(CollectionID cid) const;
+
+        /// @return the memory consumed by the items of each collection
+        std::unordered_map<CollectionID, size_t> getCollectionsMemory() const;
+
     private:
+        /// Adjust the memory consumed by the items of the given collection
+        void updateCollectionMemory(CollectionID cid, int64_t delta);
+
         /// Count of alive & deleted, in-memory non-resident and resident items.
         /// Excludes temporary and prepared items.
         cb::NonNegativeCounter<size_t> numItems;
@@ -376,6 +445,19 @@ public:
         /// Memory consumed if the items were uncompressed.
         std::atomic<size_t> uncompressedMemSize = {};
 
+        /**
+         * Memory consumed by the items of each collection (as memSize).
+         * Entries are only added (under the write lock) the first time a
+         * collection is seen; the counters themselves are updated under the
+         * read lock.
+         */
+        struct CollectionMemory {
+            mutable std::atomic<int64_t> bytes{0};
+        };
+        folly::Synchronized<std::unordered_map<CollectionID, CollectionMemory>,
+                            folly::SharedMutex>
+                collectionMemory;
+
         EPStats& epStats;
     };
 
@@ -394,12 +476,37 @@ public:
             : bucketNum(bucketNum), htLock(mutex) {
         }
 
+        /**
+         * Lock the bucket, recording the acquisition (and the time the lock
+         * is held for, unless it is released early through getHTLock()) in
+         * the given profile.
+         */
+        HashBucketLock(int bucketNum,
+                       std::mutex& mutex,
+                       LockProfile& profile,
+                       const char* site)
+            : bucketNum(bucketNum),
+              profile(&profile),
+              acquired(profile.lock(mutex, site)),
+              htLock(mutex, std::adopt_lock) {
+        }
+
         HashBucketLock(HashBucketLock&& other)
-            : bucketNum(other.bucketNum), htLock(std::move(other.htLock)) {
+            : bucketNum(other.bucketNum),
+              profile(other.profile),
+              acquired(other.acquired),
+              htLock(std::move(other.htLock)) {
+            other.profile = nullptr;
         }
 
         HashBucketLock(const HashBucketLock& other) = delete;
 
+        ~HashBucketLock() {
+            if (profile && htLock.owns_lock()) {
+                profile->recordHeld(acquired);
+            }
+        }
+
         int getBucketNum() const {
             return bucketNum;
         }
@@ -414,9 +521,25 @@ public:
 
     private:
         int bucketNum;
+        LockProfile* profile = nullptr;
+        std::chrono::steady_clock::time_point acquired;
         std::unique_lock<std::mutex> htLock;
     };
 
+    /**
+     * One of the locks protecting the buckets. Each lock gets a cache line
+     * of its own; std::mutex is 40 bytes so otherwise neighbouring locks
+     * share a line, and front end threads reading keys under different
+     * locks would still contend on it.
+     */
+    struct alignas(folly::cacheline_align_v) Mutex : public std::mutex {};
+
+    /**
+     * The locks protecting the buckets. They may be shared by the HashTables
+     * of a KVShard (see ht_shared_locks).
+     */
+    using Locks = std::vector<Mutex>;
+
     /**
      * Create a HashTable.
      *
@@ -424,18 +547,39 @@ public:
      * @param svFactory Factory to use for constructing stored values
      * @param initialSize the number of hash table buckets to initially create.
      * @param locks the number of locks in the hash table
+     * @param layout how the buckets are laid out
+     * @param shardLocks if non-null, the locks to use (shared with other
+     *        HashTables) instead of creating `locks` new ones. Operations
+     *        locking every bucket (clear, resize) then also block the other
+     *        HashTables sharing them.
      */
     HashTable(EPStats& st,
               std::unique_ptr<AbstractStoredValueFactory> svFactory,
               size_t initialSize,
-              size_t locks);
+              size_t locks,
+              Layout layout = Layout::Chained,
+              std::shared_ptr<Locks> shardLocks = {});
 
     ~HashTable();
 
     size_t memorySize() {
-        return sizeof(HashTable)
-            + (size * sizeof(StoredValue*))
-            + (mutexes.size() * sizeof(std::mutex));
+        return sizeof(HashTable) +
+               ((size + oldSize) * (layout == Layout::Grouped
+                                            ? sizeof(Group)
+                                            : sizeof(StoredValue*))) +
+               (sharedLocks ? 0 : mutexes.size() * sizeof(Mutex));
+    }
+
+    Layout getLayout() const {
+        return layout;
+    }
+
+    /**
+     * Is an incremental resize migrating the StoredValues to a new table?
+     * (Only set while resize() is running.)
+     */
+    bool isResizing() const {
+        return oldSize != 0;
     }
 
     /**
@@ -510,6 +654,41 @@ public:
         return frequencyCounterSaturated;
     }
 
+    /**
+     * Advance the frequency decay epoch of the HashTable, decaying the
+     * frequency counter of every StoredValue lazily: rather than visiting
+     * each StoredValue, its counter is decayed by the epochs it missed when
+     * it's next referenced or visited by the item pager (see
+     * decayFreqCounter()).
+     *
+     * A StoredValue only records the low bits of the epoch, so the epoch is
+     * only advanced if every StoredValue is known to have been decayed
+     * recently enough (see setFreqDecaySwept()).
+     *
+     * @param percentage the percent a frequency counter is decayed to per
+     *        epoch
+     * @return true if the epoch was advanced, false if the HashTable must be
+     *         visited (decaying every StoredValue) first
+     */
+    bool advanceFreqDecayEpoch(uint16_t percentage);
+
+    uint32_t getFreqDecayEpoch() const {
+        return freqDecayEpoch;
+    }
+
+    /**
+     * Record that every StoredValue has been decayed to (at least) the given
+     * epoch, by a complete visit of the HashTable calling decayFreqCounter()
+     * for every StoredValue, which started at that epoch.
+     */
+    void setFreqDecaySwept(uint32_t epoch);
+
+    /**
+     * Apply the frequency decay the StoredValue missed since it was last
+     * decayed (see advanceFreqDecayEpoch()). Requires the HashBucketLock.
+     */
+    void decayFreqCounter(StoredValue& v);
+
     /**
      * Remove in case of a temporary item
      *
@@ -552,6 +731,16 @@ public:
         return valueStats.getUncompressedMemSize();
     }
 
+    /// @return the memory consumed by the items of the given collection
+    size_t getCollectionMemory(CollectionID cid) const {
+        return valueStats.getCollectionMemory(cid);
+    }
+
+    /// @return the memory consumed by the items of each collection
+    std::unordered_map<CollectionID, size_t> getCollectionsMemory() const {
+        return valueStats.getCollectionsMemory();
+    }
+
     /**
      * Clear the hash table.
      *
@@ -576,12 +765,19 @@ public:
     }
 
     /**
-     * Automatically resize to fit the current data.
+     * Automatically resize to fit the current data. The size picked is a
+     * multiple of the number of locks so that the table may be resized
+     * incrementally.
      */
     void resize();
 
     /**
      * Resize to the specified size.
+     *
+     * If both the current and the new size are a multiple of the number of
+     * locks, the StoredValues are migrated incrementally and the front-end
+     * operations can carry on during the resize. Otherwise all of the
+     * locks are held while the table is rehashed.
      */
     void resize(size_t to);
 
@@ -623,6 +819,29 @@ public:
             TrackReference trackReference = TrackReference::Yes,
             WantsDeleted wantsDeleted = WantsDeleted::No);
 
+    /**
+     * Find the items with the specified keys for read-only access (as
+     * findForRead), taking each hash bucket mutex once for all of the keys
+     * it guards rather than once per key.
+     *
+     * The keys are looked up FindManyWindow at a time, prefetching the
+     * buckets, StoredValues and values of all of them before each is read,
+     * so that a batch waits for its cache misses together rather than one
+     * key after the other.
+     *
+     * @param keys The keys of the items to find
+     * @param trackReference as findForRead
+     * @param wantsDeleted as findForRead
+     * @param callback called with the index of each key (in keys) and its
+     *        StoredValue (NULL if not found), with the key's hash bucket
+     *        locked
+     */
+    void findManyForRead(
+            const std::vector<DocKey>& keys,
+            TrackReference trackReference,
+            WantsDeleted wantsDeleted,
+            const std::function<void(size_t, const StoredValue*)>& callback);
+
     /**
      * Result of the findFor...() methods which return a non-const result.
      */
@@ -836,12 +1055,26 @@ public:
     FindResult findOnlyPrepared(const DocKey& key);
 
     /**
-     * Find a resident item
+     * Find a random resident item, each (committed, alive) item being
+     * equally likely (see RandomKeyBucketBound).
      *
      * @param rnd a randomization input
+     * @param cid only consider the items of this collection (if set)
      * @return an item -- NULL if not fount
      */
-    std::unique_ptr<Item> getRandomKey(long rnd);
+    std::unique_ptr<Item> getRandomKey(
+            long rnd, boost::optional<CollectionID> cid = boost::none);
+
+    /**
+     * Visit the items of a random hash bucket, under its lock: the bucket
+     * rnd % size, or if it's empty the next one which isn't. Used to sample
+     * the items (e.g. for sampled eviction); the visitor must not remove
+     * them.
+     *
+     * @param rnd a randomization input
+     * @return the number of items visited (zero if the table is empty)
+     */
+    size_t visitRandomBucket(HashTableVisitor& visitor, long rnd);
 
     /**
      * Set an Item into the this hashtable
@@ -852,6 +1085,17 @@ public:
      */
     MutationStatus set(Item& val);
 
+    /**
+     * Set an Item's metadata into this hashtable, leaving the value
+     * non-resident (to be fetched from disk when needed). The Item must
+     * be a copy of what is on disk, so the StoredValue is clean.
+     *
+     * @param val the Item to store (its value, if any, is discarded)
+     *
+     * @return a result indicating the status of the store
+     */
+    MutationStatus setNonResident(const Item& val);
+
     /**
      * Store the given compressed buffer as a value in the
      * given StoredValue
@@ -980,14 +1224,16 @@ public:
      * the given key.
      *
      * @param s the key
+     * @param site the caller, as reported by the lock profiler
      * @return HashBucektLock which contains a lock and the hash bucket number
      */
-    inline HashBucketLock getLockedBucket(const DocKey& key) {
+    inline HashBucketLock getLockedBucket(
+            const DocKey& key, const char* site = LOCK_PROFILER_SITE) {
         if (!isActive()) {
             throw std::logic_error("HashTable::getLockedBucket: Cannot call on a "
                     "non-active object");
         }
-        return getLockedBucketForHash(key.hash());
+        return getLockedBucketForHash(key.hash(), site);
     }
 
     /**
@@ -1180,6 +1426,126 @@ private:
     // The container for actually holding the StoredValues.
     using table_type = std::vector<StoredValue::UniquePtr>;
 
+    /**
+     * A bucket of the Grouped layout. The tags are kept together at the
+     * start of the group so that they may be compared with a single SIMD
+     * instruction.
+     */
+    struct alignas(16) Group {
+        /// The tag of an unused slot (tagForHash never returns it)
+        static constexpr uint8_t EmptyTag = 0;
+
+        /// Get a bit mask of the slots with the given tag
+        uint32_t match(uint8_t tag) const;
+
+        /**
+         * Get the slot a StoredValue with the given tag should be added to.
+         * If all of the slots are in use we add it to a slot used by other
+         * tags and mark that slot as overflowed.
+         */
+        StoredValue::UniquePtr& slotForInsert(uint8_t tag);
+
+        /// Mark the slot as unused if its chain is empty
+        void releaseSlotIfEmpty(size_t slot);
+
+        /// The tag of the keys in each slot, EmptyTag if unused
+        std::array<uint8_t, GroupSlots> tags{};
+        /// Bit N is set if the chain in slot N may hold other tags than
+        /// tags[N] (and must always be searched)
+        uint32_t overflow{0};
+        std::array<StoredValue::UniquePtr, GroupSlots> slots;
+    };
+    using group_table_type = std::vector<Group>;
+
+    /// The buckets of a table (only the container of our layout is used)
+    struct Table {
+        Table() = default;
+        Table(Layout layout, size_t size);
+
+        // The buckets of the Chained layout
+        table_type values;
+        // The buckets of the Grouped layout
+        group_table_type groups;
+    };
+
+    /// Get the tag of the given hash in the Grouped layout
+    static uint8_t tagForHash(uint32_t h);
+
+    /**
+     * Get the chain in the table a new StoredValue with the given key
+     * should be linked in to the head of.
+     */
+    StoredValue::UniquePtr& chainForInsert(Table& t,
+                                           size_t bucket,
+                                           const DocKey& key);
+
+    /**
+     * Call the function for the head of every chain in the bucket of the
+     * table (a Chained bucket has a single chain, a Grouped bucket one per
+     * slot) until it returns false.
+     */
+    template <typename F>
+    void forEachChain(Table& t, size_t bucket, F f);
+
+    /**
+     * Unlink the first StoredValue in the bucket of the table which
+     * matches the predicate.
+     *
+     * @param t the table to search
+     * @param bucket the bucket to search
+     * @param key the key of the StoredValue to remove (used to skip the
+     *            slots of a Grouped bucket which can't hold it)
+     * @param p the predicate, see hashChainRemoveFirst
+     * @return The removed element, or NULL if no matching element was found.
+     */
+    template <typename Pred>
+    StoredValue::UniquePtr tableRemoveFirst(Table& t,
+                                            size_t bucket,
+                                            const DocKey& key,
+                                            Pred p);
+
+    /**
+     * Unlink the first StoredValue with the given key which matches the
+     * predicate; searching the table being migrated from as well during an
+     * incremental resize.
+     *
+     * @param bucket the bucket of the key (in the current table)
+     */
+    template <typename Pred>
+    StoredValue::UniquePtr bucketRemoveFirst(size_t bucket,
+                                             const DocKey& key,
+                                             Pred p);
+
+    /**
+     * Resize the table without blocking the front-end threads for more
+     * than a few buckets at a time. All of the locks are only held while
+     * the new table is put in place and while the old one is removed; in
+     * between the StoredValues are migrated a few buckets at a time and
+     * the lookups search both tables.
+     *
+     * This requires both the old and the new size to be a multiple of the
+     * number of locks, which makes the lock of a key independent of the
+     * size (bucket % locks == hash % locks), so a single lock protects the
+     * key in both tables.
+     */
+    void resizeIncrementally(size_t newSize);
+
+    /**
+     * Move the StoredValues in the buckets of the table being migrated from
+     * guarded by the given lock to the current table. The lock is acquired
+     * (and released) for every few buckets.
+     */
+    void migrateLock(size_t lock);
+
+    /// Move the StoredValues in the old bucket to the current table; the
+    /// lock of the bucket must be held
+    void migrateBucket(size_t oldBucket);
+
+    /// Get the bucket of the hash in the table being migrated from
+    size_t getOldBucketForHash(int h) const {
+        return abs(h % static_cast<int>(oldSize));
+    }
+
     friend class StoredValue;
     friend std::ostream& operator<<(std::ostream& os, const HashTable& ht);
 
@@ -1190,10 +1556,13 @@ private:
      * Get a lock holder holding a lock for the given bucket
      *
      * @param bucket the bucket number to lock
+     * @param site the caller, as reported by the lock profiler
      * @return HashBucektLock which contains a lock and the hash bucket number
      */
-    inline HashBucketLock getLockedBucket(int bucket) {
-        return HashBucketLock(bucket, mutexes[mutexForBucket(bucket)]);
+    inline HashBucketLock getLockedBucket(int bucket,
+                                          const char* site = LOCK_PROFILER_SITE) {
+        return HashBucketLock(
+                bucket, mutexes[mutexForBucket(bucket)], lockProfile, site);
     }
 
     /**
@@ -1201,9 +1570,11 @@ private:
      * hash.
      *
      * @param h the input hash
+     * @param site the caller, as reported by the lock profiler
      * @return HashBucketLock which contains a lock and the hash bucket number
      */
-    inline HashBucketLock getLockedBucketForHash(int h) {
+    inline HashBucketLock getLockedBucketForHash(
+            int h, const char* site = LOCK_PROFILER_SITE) {
         while (true) {
             if (!isActive()) {
                 throw std::logic_error(
@@ -1211,7 +1582,8 @@ private:
                         "Cannot call on a non-active object");
             }
             int bucket = getBucketForHash(h);
-            HashBucketLock rv(bucket, mutexes[mutexForBucket(bucket)]);
+            HashBucketLock rv(
+                    bucket, mutexes[mutexForBucket(bucket)], lockProfile, site);
             if (bucket == getBucketForHash(h)) {
                 return rv;
             }
@@ -1257,15 +1629,56 @@ private:
      */
     FindInnerResult findInner(const DocKey& key);
 
+    /**
+     * Find the committed/pending item(s) with the given key in the given
+     * bucket (as findInner), which the caller has locked.
+     *
+     * @return the Committed and the Pending StoredValue (NULL if not found)
+     */
+    std::pair<StoredValue*, StoredValue*> unlocked_findInner(const DocKey& key,
+                                                             int bucket);
+
+    /// Prefetch the given bucket of the table (see findManyForRead)
+    void prefetchBucket(const Table& t, size_t bucket) const;
+
+    /**
+     * Prefetch the heads of the chains of the bucket of the table which may
+     * hold the key with the given hash (see findManyForRead)
+     */
+    void prefetchChains(const Table& t, size_t bucket, uint32_t hash) const;
+
+    /**
+     * Select the StoredValue a read uses of the Committed and Pending ones
+     * found for a key (see findForRead).
+     */
+    StoredValue* selectForRead(StoredValue* committedSV,
+                               StoredValue* pendingSV,
+                               TrackReference trackReference,
+                               WantsDeleted wantsDeleted);
+
     // The initial (and minimum) size of the HashTable.
     const size_t initialSize;
 
     // The size of the hash table (number of buckets) - i.e. number of elements
-    // in `values`
+    // in `table`
     std::atomic<size_t> size;
-    table_type values;
-    std::vector<std::mutex> mutexes;
+    const Layout layout;
+    Table table;
+    // During an incremental resize; the table (of oldSize buckets) which
+    // the StoredValues are being migrated from. oldSize is 0 otherwise.
+    // Both are only changed while holding all of the locks.
+    Table oldTable;
+    std::atomic<size_t> oldSize{0};
+    // Serializes the resizes
+    std::mutex resizeMutex;
+    // Are the locks shared with other HashTables? (Their memory is then
+    // accounted by whoever owns them, not by memorySize().)
+    const bool sharedLocks;
+    std::shared_ptr<Locks> lockArray;
+    Locks& mutexes;
     EPStats&             stats;
+    // Where acquisitions of the bucket locks are profiled (stats.lockProfiler)
+    LockProfile& lockProfile;
     std::unique_ptr<AbstractStoredValueFactory> valFact;
     std::atomic<size_t>       visitors;
 
@@ -1292,6 +1705,13 @@ private:
     // responsible for waking the ItemFreqDecayer task.
     std::function<void()> frequencyCounterSaturated{[]() {}};
 
+    // The lazy frequency decay epoch, the epoch every StoredValue is known to
+    // have been decayed to, and the percent the counters are decayed to per
+    // epoch (see advanceFreqDecayEpoch()).
+    std::atomic<uint32_t> freqDecayEpoch{0};
+    std::atomic<uint32_t> freqDecaySweptEpoch{0};
+    std::atomic<uint16_t> freqDecayPercent{100};
+
     int getBucketForHash(int h) {
         return abs(h % static_cast<int>(size));
     }
@@ -1304,7 +1724,24 @@ private:
         return bucket_num % mutexes.size();
     }
 
-    std::unique_ptr<Item> getRandomKeyFromSlot(int slot);
+    /**
+     * Get an item from the bucket which getRandomKey may return
+     *
+     * @param slot the bucket
+     * @param cid only consider the items of this collection (if set)
+     * @param bound if zero get the first item (also looking at the old
+     *        table when resizing). Otherwise of the n items in the bucket
+     *        get the (rnd % max(bound, n))th, if there is one.
+     * @param rnd a randomization input (used with bound)
+     * @return the item, or NULL if there is none
+     */
+    std::unique_ptr<Item> getRandomKeyFromSlot(
+            int slot,
+            boost::optional<CollectionID> cid,
+            size_t bound = 0,
+            size_t rnd = 0);
+
+    size_t visitSlot(HashTableVisitor& visitor, int slot);
 
     /**
      * Releases an item(StoredValue) in the hash table, but does not delete it.
@@ -1316,6 +1753,7 @@ private:
      * Assumes that the hash bucket lock is already held.
      *
      * @param hbl HashBucketLock that must be held
+     * @param key the key of the value to be deleted
      * @param releasePredicate A predicate that returns true for the value to be
      *                         deleted.
      *                         The signature of the predicate function should be
@@ -1326,6 +1764,7 @@ private:
      */
     template <typename Pred>
     StoredValue::UniquePtr unlocked_release_inner(const HashBucketLock& hbl,
+                                                  const DocKey& key,
                                                   Pred& releasePredicate);
 
     /** Searches for the first element in the specified hashChain which matches
@@ -0,0 +1,239 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "hash_table_image.h"
+
+#include "bucket_logger.h"
+
+#include <platform/dirutils.h>
+
+#include <cerrno>
+#include <cstring>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+struct ImageHeader {
+    uint64_t magic;
+    uint64_t numItems;
+    uint64_t keysSize;
+    uint64_t valuesSize;
+};
+
+// "HTImg001" (in little endian)
+const uint64_t ImageMagic = 0x313030676d495448;
+
+/// The size of the fixed size columns of each item
+const size_t ColumnBytesPerItem = 3 * sizeof(uint64_t) +
+                                  3 * sizeof(uint32_t) + sizeof(uint16_t) +
+                                  2 * sizeof(uint8_t);
+
+template <typename T>
+bool writeColumn(FILE* file, const std::vector<T>& column) {
+    return fwrite(column.data(), sizeof(T), column.size(), file) ==
+           column.size();
+}
+
+template <typename T>
+T readColumn(const char* column, size_t index) {
+    T ret;
+    std::memcpy(&ret, column + index * sizeof(T), sizeof(T));
+    return ret;
+}
+
+} // namespace
+
+bool HashTableImageWriter::visit(const HashTable::HashBucketLock& lh,
+                                 StoredValue& v) {
+    // Only the items which are on disk as they are in memory; the rest is
+    // loaded from disk by the other warmup phases
+    if (v.isTempItem() || v.isDeleted() || !v.isResident() || v.isDirty() ||
+        !v.isCommitted()) {
+        return true;
+    }
+
+    const auto& key = v.getKey();
+    const auto& value = v.getValue();
+    cas.push_back(v.getCas());
+    bySeqno.push_back(v.getBySeqno());
+    revSeqno.push_back(v.getRevSeqno());
+    valueLen.push_back(value ? uint32_t(value->valueSize()) : 0);
+    exptime.push_back(uint32_t(v.getExptime()));
+    flags.push_back(v.getFlags());
+    keyLen.push_back(uint16_t(key.size()));
+    datatype.push_back(v.getDatatype());
+    freqCount.push_back(v.getFreqCounterValue());
+    keys.append(reinterpret_cast<const char*>(key.data()), key.size());
+    values.push_back(value);
+    return true;
+}
+
+bool HashTableImageWriter::write(FILE* file) const {
+    ImageHeader header{ImageMagic, getNumItems(), keys.size(), 0};
+    for (auto len : valueLen) {
+        header.valuesSize += len;
+    }
+
+    bool rv = fwrite(&header, sizeof(header), 1, file) == 1;
+    rv = rv && writeColumn(file, cas) && writeColumn(file, bySeqno) &&
+         writeColumn(file, revSeqno) && writeColumn(file, valueLen) &&
+         writeColumn(file, exptime) && writeColumn(file, flags) &&
+         writeColumn(file, keyLen) && writeColumn(file, datatype) &&
+         writeColumn(file, freqCount);
+    rv = rv && fwrite(keys.data(), 1, keys.size(), file) == keys.size();
+    for (size_t ii = 0; rv && ii < values.size(); ++ii) {
+        if (valueLen[ii] != 0) {
+            rv = fwrite(values[ii]->getData(), 1, valueLen[ii], file) ==
+                 valueLen[ii];
+        }
+    }
+    return rv;
+}
+
+std::unique_ptr<HashTableImage> HashTableImage::open(const std::string& fname,
+                                                     size_t headerSize) {
+    std::unique_ptr<HashTableImage> image(new HashTableImage());
+#ifdef WIN32
+    try {
+        image->contents = cb::io::loadFile(fname);
+    } catch (const std::exception& e) {
+        EP_LOG_WARN("HashTableImage::open: Failed to load \"{}\": {}",
+                    fname,
+                    e.what());
+        return {};
+    }
+    image->data = image->contents.data();
+    image->size = image->contents.size();
+#else
+    const int fd = ::open(fname.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return {};
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return {};
+    }
+    void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        EP_LOG_WARN("HashTableImage::open: mmap of \"{}\" failed: {}",
+                    fname,
+                    strerror(errno));
+        return {};
+    }
+    // All of the image is about to be read; start reading it in
+    (void)madvise(addr, st.st_size, MADV_WILLNEED);
+    image->data = static_cast<const char*>(addr);
+    image->size = size_t(st.st_size);
+#endif
+
+    if (!image->parse(headerSize)) {
+        EP_LOG_WARN("HashTableImage::open: \"{}\" is not a valid image",
+                    fname);
+        return {};
+    }
+    return image;
+}
+
+HashTableImage::~HashTableImage() {
+#ifndef WIN32
+    if (data) {
+        munmap(const_cast<char*>(data), size);
+    }
+#endif
+}
+
+bool HashTableImage::parse(size_t headerSize) {
+    ImageHeader header;
+    if (size < headerSize + sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, data + headerSize, sizeof(header));
+    const size_t remaining = size - headerSize - sizeof(header);
+    if (header.magic != ImageMagic ||
+        header.numItems > remaining / ColumnBytesPerItem ||
+        header.keysSize > remaining || header.valuesSize > remaining ||
+        header.numItems * ColumnBytesPerItem + header.keysSize +
+                        header.valuesSize !=
+                remaining) {
+        return false;
+    }
+
+    numItems = header.numItems;
+    columns = data + headerSize + sizeof(header);
+    keys = columns + numItems * ColumnBytesPerItem;
+    values = keys + header.keysSize;
+
+    // The key and value lengths must add up to the sizes of their columns
+    const char* valueLenCol = columns + 3 * numItems * sizeof(uint64_t);
+    const char* keyLenCol = valueLenCol + 3 * numItems * sizeof(uint32_t);
+    uint64_t keysSize = 0;
+    uint64_t valuesSize = 0;
+    for (size_t ii = 0; ii < numItems; ++ii) {
+        keysSize += readColumn<uint16_t>(keyLenCol, ii);
+        valuesSize += readColumn<uint32_t>(valueLenCol, ii);
+    }
+    return keysSize == header.keysSize && valuesSize == header.valuesSize;
+}
+
+void HashTableImage::forEachItem(
+        Vbid vbid,
+        const std::function<bool(std::unique_ptr<Item>)>& callback) const {
+    const char* casCol = columns;
+    const char* bySeqnoCol = casCol + numItems * sizeof(uint64_t);
+    const char* revSeqnoCol = bySeqnoCol + numItems * sizeof(int64_t);
+    const char* valueLenCol = revSeqnoCol + numItems * sizeof(uint64_t);
+    const char* exptimeCol = valueLenCol + numItems * sizeof(uint32_t);
+    const char* flagsCol = exptimeCol + numItems * sizeof(uint32_t);
+    const char* keyLenCol = flagsCol + numItems * sizeof(uint32_t);
+    const char* datatypeCol = keyLenCol + numItems * sizeof(uint16_t);
+    const char* freqCountCol = datatypeCol + numItems * sizeof(uint8_t);
+
+    const char* key = keys;
+    const char* value = values;
+    for (size_t ii = 0; ii < numItems; ++ii) {
+        const auto keyLen = readColumn<uint16_t>(keyLenCol, ii);
+        const auto valueLen = readColumn<uint32_t>(valueLenCol, ii);
+        auto item = std::make_unique<Item>(
+                DocKey(reinterpret_cast<const uint8_t*>(key),
+                       keyLen,
+                       DocKeyEncodesCollectionId::Yes),
+                readColumn<uint32_t>(flagsCol, ii),
+                time_t(readColumn<uint32_t>(exptimeCol, ii)),
+                value,
+                valueLen,
+                readColumn<uint8_t>(datatypeCol, ii),
+                readColumn<uint64_t>(casCol, ii),
+                readColumn<int64_t>(bySeqnoCol, ii),
+                vbid,
+                readColumn<uint64_t>(revSeqnoCol, ii),
+                INITIAL_NRU_VALUE,
+                readColumn<uint8_t>(freqCountCol, ii));
+        key += keyLen;
+        value += valueLen;
+        if (!callback(std::move(item))) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,136 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include "hash_table.h"
+#include "item.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+ * A HashTable image holds the resident, committed items of a vBucket's
+ * HashTable. It is written at a clean shutdown so the next warmup can load
+ * the items straight into the HashTable rather than reading and decoding
+ * them from the vBucket's couchstore file.
+ *
+ * The items are stored by column, after a Header:
+ *
+ *     cas, bySeqno, revSeqno         numItems x uint64_t each
+ *     valueLen, exptime, flags       numItems x uint32_t each
+ *     keyLen                         numItems x uint16_t
+ *     datatype, freqCount            numItems x uint8_t each
+ *     keys                           all of the keys, one after the other
+ *     values                         all of the values, one after the other
+ *
+ * The image only holds the items; the KVStore writing it decides how to
+ * tell if it is still valid for the vBucket's data.
+ */
+
+/**
+ * Collects the items of a HashTable for an image. Visit the HashTable
+ * with the writer, then write() the image out. The values are held by
+ * reference, not copied.
+ */
+class HashTableImageWriter : public HashTableVisitor {
+public:
+    bool visit(const HashTable::HashBucketLock& lh, StoredValue& v) override;
+
+    size_t getNumItems() const {
+        return cas.size();
+    }
+
+    /**
+     * Write the image to the given file.
+     *
+     * @return true if all of it was written
+     */
+    bool write(FILE* file) const;
+
+private:
+    std::vector<uint64_t> cas;
+    std::vector<int64_t> bySeqno;
+    std::vector<uint64_t> revSeqno;
+    std::vector<uint32_t> valueLen;
+    std::vector<uint32_t> exptime;
+    std::vector<uint32_t> flags;
+    std::vector<uint16_t> keyLen;
+    std::vector<uint8_t> datatype;
+    std::vector<uint8_t> freqCount;
+    std::string keys;
+    std::vector<value_t> values;
+};
+
+/**
+ * A HashTable image file, memory mapped for reading.
+ */
+class HashTableImage {
+public:
+    /**
+     * Open the image file, made up of a header of headerSize bytes used by
+     * the caller followed by a HashTable image.
+     *
+     * @return the image, or nullptr if it doesn't exist or isn't valid
+     */
+    static std::unique_ptr<HashTableImage> open(const std::string& fname,
+                                                size_t headerSize);
+
+    ~HashTableImage();
+
+    HashTableImage(const HashTableImage&) = delete;
+    HashTableImage& operator=(const HashTableImage&) = delete;
+
+    /// The header of the file before the image
+    const char* getHeader() const {
+        return data;
+    }
+
+    size_t getNumItems() const {
+        return numItems;
+    }
+
+    /**
+     * Create an Item for each item of the image in turn, and pass it to
+     * the callback until it returns false.
+     */
+    void forEachItem(
+            Vbid vbid,
+            const std::function<bool(std::unique_ptr<Item>)>& callback) const;
+
+private:
+    HashTableImage() = default;
+
+    /// Check the image is valid and locate its columns
+    bool parse(size_t headerSize);
+
+    const char* data = nullptr;
+    size_t size = 0;
+#ifdef WIN32
+    /// The file contents, as it isn't mapped
+    std::string contents;
+#endif
+
+    size_t numItems = 0;
+    const char* columns = nullptr;
+    const char* keys = nullptr;
+    const char* values = nullptr;
+};
@@ -0,0 +1,129 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "hot_key_cache.h"
+
+#include "ep_time.h"
+#include "item.h"
+
+#include <algorithm>
+
+HotKeyCache::HotKeyCache(size_t shards) {
+    for (size_t ii = 0; ii < std::max(shards, size_t(1)); ++ii) {
+        this->shards.emplace_back(std::make_unique<Shard>());
+    }
+}
+
+HotKeyCache::~HotKeyCache() = default;
+
+void HotKeyCache::setCapacity(size_t entries) {
+    capacity = entries;
+    for (auto& shard : shards) {
+        std::lock_guard<std::mutex> guard(shard->mutex);
+        shard->entries.clear();
+        shard->entries.resize(entries);
+    }
+}
+
+std::unique_ptr<Item> HotKeyCache::get(const DocKey& key,
+                                       Vbid vbid,
+                                       uint64_t generation) {
+    auto& shard = getShard();
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    if (shard.entries.empty()) {
+        return {};
+    }
+    auto& entry = getEntry(shard, key, vbid);
+    if (!entry.item || entry.vbid != vbid) {
+        return {};
+    }
+    const auto& cachedKey = entry.item->getKey();
+    if (cachedKey.size() != key.size() ||
+        !std::equal(key.data(), key.data() + key.size(), cachedKey.data())) {
+        return {};
+    }
+    const auto exptime = entry.item->getExptime();
+    if (entry.generation != generation ||
+        (exptime != 0 && exptime <= ep_real_time())) {
+        // The document changed (or expired) since it was copied
+        entry.item.reset();
+        return {};
+    }
+    ++shard.hits;
+    // The copy shares the value of the entry, which only this shard's
+    // threads reference
+    return std::make_unique<Item>(*entry.item);
+}
+
+void HotKeyCache::put(const Item& item, uint64_t generation) {
+    auto& shard = getShard();
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    if (shard.entries.empty() || !item.getValue()) {
+        return;
+    }
+    auto& entry = getEntry(shard, item.getKey(), item.getVBucketId());
+    entry.vbid = item.getVBucketId();
+    entry.generation = generation;
+    entry.item = std::make_unique<Item>(item);
+    // Take our own copy of the value rather than another reference to
+    // the one in the HashTable
+    entry.item->replaceValue(Blob::Copy(*item.getValue()));
+}
+
+void HotKeyCache::clear() {
+    for (auto& shard : shards) {
+        std::lock_guard<std::mutex> guard(shard->mutex);
+        for (auto& entry : shard->entries) {
+            entry.item.reset();
+        }
+    }
+}
+
+size_t HotKeyCache::getNumHits() const {
+    size_t hits = 0;
+    for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> guard(shard->mutex);
+        hits += shard->hits;
+    }
+    return hits;
+}
+
+size_t HotKeyCache::getNumItems() const {
+    size_t items = 0;
+    for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> guard(shard->mutex);
+        for (const auto& entry : shard->entries) {
+            if (entry.item) {
+                ++items;
+            }
+        }
+    }
+    return items;
+}
+
+HotKeyCache::Shard& HotKeyCache::getShard() {
+    static std::atomic<size_t> nextIndex{0};
+    static thread_local const size_t index = nextIndex++;
+    return *shards[index % shards.size()];
+}
+
+HotKeyCache::Entry& HotKeyCache::getEntry(Shard& shard,
+                                          const DocKey& key,
+                                          Vbid vbid) {
+    const size_t hash = key.hash() ^ (size_t(vbid.get()) << 16);
+    return shard.entries[hash % shard.entries.size()];
+}
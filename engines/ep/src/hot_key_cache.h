@@ -0,0 +1,107 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <memcached/dockey.h>
+#include <memcached/vbucket.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class Item;
+
+/**
+ * A cache of copies of the documents most read (the "hot" keys), kept per
+ * front-end thread so that reads of the same key from many threads don't
+ * all contend on the key's hash bucket lock and on the reference count of
+ * its value.
+ *
+ * Each thread has its own shard (threads share shards if there are more
+ * threads than shards), holding a fixed number of entries, indexed by the
+ * hash of the key. An entry is tagged with the generation of its vbucket
+ * (see VBucket::getHotKeyGeneration()) read before the document was
+ * copied, and is only returned while the vbucket is still at that
+ * generation - i.e. no document of the vbucket was changed since.
+ */
+class HotKeyCache {
+public:
+    /// @param shards the number of shards (one per front-end thread)
+    explicit HotKeyCache(size_t shards);
+
+    ~HotKeyCache();
+
+    /// Set the number of entries of each shard (0 disables the cache)
+    void setCapacity(size_t entries);
+
+    size_t getCapacity() const {
+        return capacity;
+    }
+
+    /**
+     * Look up a document in the calling thread's shard
+     *
+     * @param key the key of the document
+     * @param vbid the vbucket of the document
+     * @param generation the current generation of the vbucket
+     * @return a copy of the document, or nullptr if it isn't cached (or
+     *         the copy cached is stale)
+     */
+    std::unique_ptr<Item> get(const DocKey& key,
+                              Vbid vbid,
+                              uint64_t generation);
+
+    /**
+     * Copy a document just read into the calling thread's shard
+     *
+     * @param item the document
+     * @param generation the generation of the vbucket read before the
+     *        document
+     */
+    void put(const Item& item, uint64_t generation);
+
+    /// Remove the documents of all vbuckets
+    void clear();
+
+    /// The number of reads served from the cache
+    size_t getNumHits() const;
+
+    /// The number of documents cached
+    size_t getNumItems() const;
+
+private:
+    struct Entry {
+        Vbid vbid;
+        uint64_t generation = 0;
+        std::unique_ptr<Item> item;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::vector<Entry> entries;
+        size_t hits = 0;
+    };
+
+    Shard& getShard();
+
+    Entry& getEntry(Shard& shard, const DocKey& key, Vbid vbid);
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::atomic<size_t> capacity{0};
+};
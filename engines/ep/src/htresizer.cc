@@ -48,11 +48,13 @@ bool HashtableResizerTask::run(void) {
     TRACE_EVENT0("ep-engine/task", "HashtableResizerTask");
     auto pv = std::make_unique<ResizingVisitor>();
 
-    // [per-VBucket Task] While a Hashtable is resizing no user
-    // requests can be performed (the resizing process needs to
-    // acquire all HT locks). As such we are sensitive to the duration
-    // of this task - we want to log anything which has a
-    // non-negligible impact on frontend operations.
+    // [per-VBucket Task] The Hashtable is normally resized incrementally,
+    // only holding all of the HT locks briefly at the start and the end.
+    // However a table whose size isn't a multiple of the number of locks
+    // is rehashed while holding all of them and no user requests can be
+    // performed. As such we are sensitive to the duration of this task - we
+    // want to log anything which has a non-negligible impact on frontend
+    // operations.
     const auto maxExpectedDurationForVisitorTask =
             std::chrono::milliseconds(100);
 
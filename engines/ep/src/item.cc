@@ -31,14 +31,14 @@ std::atomic<uint64_t> Item::casCounter(1);
 Item::Item(const DocKey& k,
            const uint32_t fl,
            const time_t exp,
-           const value_t& val,
+           value_t val,
            protocol_binary_datatype_t dtype,
            uint64_t theCas,
            int64_t i,
            Vbid vbid,
            uint64_t sno)
     : metaData(theCas, sno, fl, exp),
-      value(TaggedPtr<Blob>(val.get().get(), initialFreqCount)),
+      value(std::move(val)),
       key(k),
       bySeqno(i),
       queuedTime(ep_current_time()),
@@ -52,6 +52,8 @@ Item::Item(const DocKey& k,
     if (bySeqno == 0) {
         throw std::invalid_argument("Item(): bySeqno must be non-zero");
     }
+    // The value may carry the frequency counter of its previous owner
+    setFreqCounterValue(initialFreqCount);
 
     ObjectRegistry::onCreateItem(this);
 }
@@ -221,9 +223,10 @@ std::ostream& operator<<(std::ostream& os, const ItemMetaData& md) {
 }
 
 bool operator==(const Blob& lhs, const Blob& rhs) {
-    return (lhs.size == rhs.size) &&
+    return (lhs.valueSize() == rhs.valueSize()) &&
+           ((lhs.size & 0x80000000) == (rhs.size & 0x80000000)) &&
            (lhs.age == rhs.age) &&
-           (memcmp(lhs.data, rhs.data, lhs.size) == 0);
+           (memcmp(lhs.getData(), rhs.getData(), lhs.valueSize()) == 0);
 }
 
 std::ostream& operator<<(std::ostream& os, const Blob& b) {
@@ -232,15 +235,16 @@ std::ostream& operator<<(std::ostream& os, const Blob& b) {
        << " age:" << int(b.age)
        << " data: <" << std::hex;
     // Print at most 40 bytes of the body.
-    auto bytes_to_print = std::min(uint32_t(40), b.size.load());
+    auto bytes_to_print = std::min(size_t(40), b.valueSize());
+    const char* data = b.getData();
     for (size_t ii = 0; ii < bytes_to_print; ii++) {
         if (ii != 0) {
             os << ' ';
         }
-        if (isprint(b.data[ii])) {
-            os << b.data[ii];
+        if (isprint(data[ii])) {
+            os << data[ii];
         } else {
-            os << std::setfill('0') << std::setw(2) << int(uint8_t(b.data[ii]));
+            os << std::setfill('0') << std::setw(2) << int(uint8_t(data[ii]));
         }
     }
     os << std::dec << '>';
@@ -389,6 +393,7 @@ void Item::pruneValueAndOrXattrs(IncludeValue includeVal,
     }
 
     const auto originalDatatype = getDataType();
+    cb::compression::Buffer xattrs;
 
     if (includeXattrs == IncludeXattrs::No &&
         ((includeVal == IncludeValue::No) ||
@@ -396,6 +401,15 @@ void Item::pruneValueAndOrXattrs(IncludeValue includeVal,
         // Don't want the xattributes or value, so just send the key
         setData(nullptr, 0);
         setDataType(PROTOCOL_BINARY_RAW_BYTES);
+    } else if (includeXattrs == IncludeXattrs::Yes &&
+               includeVal != IncludeValue::Yes &&
+               mcbp::datatype::is_xattr(originalDatatype) &&
+               mcbp::datatype::is_snappy(originalDatatype) &&
+               cb::xattr::inflate_xattrs({getData(), getNBytes()}, xattrs)) {
+        // Want just the xattributes of a compressed value; only the front
+        // of it was inflated (not the body we're about to drop)
+        setData(xattrs.data(), xattrs.size());
+        setDataType(PROTOCOL_BINARY_DATATYPE_XATTR);
     } else {
         // Call decompress before working on the value (a no-op for non-snappy)
         decompressValue();
@@ -76,12 +76,14 @@ public:
 
     /* Constructor (existing value_t).
      * Used when a value already exists, and the Item should refer to that
-     * value.
+     * value. The value is taken by value so that callers passing a temporary
+     * (e.g. StoredValue::getValue()) hand over their reference rather than
+     * the Item taking another one.
      */
     Item(const DocKey& k,
          const uint32_t fl,
          const time_t exp,
-         const value_t& val,
+         value_t val,
          protocol_binary_datatype_t dtype = PROTOCOL_BINARY_RAW_BYTES,
          uint64_t theCas = 0,
          int64_t i = -1,
@@ -155,9 +157,33 @@ public:
     /* Snappy compress value and update datatype */
     bool compressValue();
 
+    /**
+     * Replace the (uncompressed) value with its Snappy compressed form,
+     * which may be shared with other Items, and update datatype
+     */
+    void setCompressedValue(const value_t& compressed) {
+        // Maintain the frequency count for the Item.
+        auto freqCount = getFreqCounterValue();
+        value = compressed;
+        setFreqCounterValue(freqCount);
+        setDataType(getDataType() | PROTOCOL_BINARY_DATATYPE_SNAPPY);
+    }
+
     /* Snappy uncompress value and update datatype */
     bool decompressValue();
 
+    /**
+     * Replace the (Snappy compressed) value with its inflated form, which
+     * may be shared with other Items, and update datatype
+     */
+    void setDecompressedValue(const value_t& inflated) {
+        // Maintain the frequency count for the Item.
+        auto freqCount = getFreqCounterValue();
+        value = inflated;
+        setFreqCounterValue(freqCount);
+        setDataType(getDataType() & ~PROTOCOL_BINARY_DATATYPE_SNAPPY);
+    }
+
     const char *getData() const {
         return value ? value->getData() : NULL;
     }
@@ -562,10 +588,10 @@ std::ostream& operator<<(std::ostream& os, const Item& item);
 // bit-fields to reduce the size?
 // If you've reduced Item size, thanks! Please update the assert with the new
 // size.
-// Note the assert is written as we see std::string (member of the StoredDocKey)
-// differing. This totals 104 or 112 (string being 24 or 32).
+// Note the assert is written in terms of the folly::fbstring member of the
+// StoredDocKey (24 bytes). This totals 104.
 #ifndef CB_MEMORY_INEFFICIENT_TAGGED_PTR
-static_assert(sizeof(Item) == sizeof(std::string) + 80,
+static_assert(sizeof(Item) == sizeof(folly::fbstring) + 80,
               "sizeof Item may have an effect on run-time memory consumption, "
               "please avoid increasing it");
 #endif
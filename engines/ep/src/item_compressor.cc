@@ -25,9 +25,13 @@
 #include <phosphor/phosphor.h>
 
 ItemCompressorTask::ItemCompressorTask(EventuallyPersistentEngine* e,
-                                       EPStats& stats_)
+                                       EPStats& stats_,
+                                       size_t partition,
+                                       size_t partitions)
     : GlobalTask(e, TaskId::ItemCompressorTask, 0, false),
       stats(stats_),
+      partition(partition),
+      partitions(partitions),
       epstore_position(engine->getKVBucket()->startPosition()) {
 }
 
@@ -40,12 +44,16 @@ bool ItemCompressorTask::run(void) {
         if (!prAdapter) {
             prAdapter = std::make_unique<PauseResumeVBAdapter>(
                     std::make_unique<ItemCompressorVisitor>());
+            prAdapter->setVBucketPartition(partition, partitions);
             epstore_position = engine->getKVBucket()->startPosition();
         }
 
         // Print start status.
         std::stringstream ss;
         ss << getDescription() << " for bucket '" << engine->getName() << "'";
+        if (partitions > 1) {
+            ss << " (partition " << partition << " of " << partitions << ")";
+        }
         if (epstore_position == engine->getKVBucket()->startPosition()) {
             ss << " starting. ";
         } else {
@@ -73,6 +81,8 @@ bool ItemCompressorTask::run(void) {
         // Update stats
         stats.compressorNumCompressed.fetch_add(visitor.getCompressedCount());
         stats.compressorNumVisited.fetch_add(visitor.getVisitedCount());
+        stats.compressorNumRejected.fetch_add(visitor.getRejectedCount());
+        stats.compressorBytesSaved.fetch_add(visitor.getBytesSaved());
 
         // Check if the visitor completed a full pass.
         bool completed =
@@ -28,7 +28,15 @@ class PauseResumeVBAdapter;
  */
 class ItemCompressorTask : public GlobalTask {
 public:
-    ItemCompressorTask(EventuallyPersistentEngine* e, EPStats& stats_);
+    /**
+     * @param partition which of the partitions of the vBuckets (see
+     *        PauseResumeVBAdapter::setVBucketPartition) this task compresses
+     * @param partitions the number of partitions (item_compressor_tasks)
+     */
+    ItemCompressorTask(EventuallyPersistentEngine* e,
+                       EPStats& stats_,
+                       size_t partition = 0,
+                       size_t partitions = 1);
 
     bool run();
 
@@ -53,6 +61,11 @@ private:
     /// Reference to EP stats, used to check on mem_used.
     EPStats& stats;
 
+    /// The partition of the vBuckets compressed by this task, and the number
+    /// of partitions.
+    const size_t partition;
+    const size_t partitions;
+
     // Opaque marker indicating how far through the epStore we have visited.
     KVBucketIface::Position epstore_position;
 
@@ -50,13 +50,16 @@ bool ItemCompressorVisitor::visit(const HashTable::HashBucketLock& lh,
             // Compress the document only if the compression ratio is greater
             // than or equal to the current minium compression ratio
             if (comp_ratio >= currentMinCompressionRatio) {
+                const size_t saved = v.valuelen() - deflated.size();
                 currentVb->ht.storeCompressedBuffer(deflated, v);
 
                 // If the value was compressed, increment the count of number
                 // of compressed documents
                 compressed_count++;
+                bytes_saved += saved;
             } else {
                 v.setUncompressible();
+                rejected_count++;
             }
         }
     }
@@ -71,6 +74,8 @@ bool ItemCompressorVisitor::visit(const HashTable::HashBucketLock& lh,
 void ItemCompressorVisitor::clearStats() {
     compressed_count = 0;
     visited_count = 0;
+    rejected_count = 0;
+    bytes_saved = 0;
 }
 
 size_t ItemCompressorVisitor::getCompressedCount() const {
@@ -81,6 +86,14 @@ size_t ItemCompressorVisitor::getVisitedCount() const {
     return visited_count;
 }
 
+size_t ItemCompressorVisitor::getRejectedCount() const {
+    return rejected_count;
+}
+
+size_t ItemCompressorVisitor::getBytesSaved() const {
+    return bytes_saved;
+}
+
 void ItemCompressorVisitor::setCompressionMode(
         const BucketCompressionMode compressionMode) {
     compressMode = compressionMode;
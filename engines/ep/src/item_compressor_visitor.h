@@ -54,6 +54,13 @@ public:
     // Returns the number of documents that have been visited.
     size_t getVisitedCount() const;
 
+    // Returns the number of documents which were not compressed as their
+    // compression ratio is below the minimum.
+    size_t getRejectedCount() const;
+
+    // Returns how many bytes smaller the compressed documents are.
+    size_t getBytesSaved() const;
+
     void setCurrentVBucket(VBucket& vb) override;
 
 private:
@@ -67,6 +74,10 @@ private:
     size_t compressed_count;
     // How many documents have been visited.
     size_t visited_count;
+    // How many documents didn't compress well enough to be compressed.
+    size_t rejected_count{0};
+    // How many bytes smaller the compressed documents are.
+    size_t bytes_saved{0};
 
     // Current compression mode of the bucket
     BucketCompressionMode compressMode;
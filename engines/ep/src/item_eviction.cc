@@ -17,9 +17,13 @@
 
 #include "item_eviction.h"
 #include "item.h"
+#include "stats.h"
 
 #include <gsl/gsl>
 
+#include <algorithm>
+#include <cmath>
+
 ItemEviction::ItemEviction() {
 }
 
@@ -75,3 +79,33 @@ void ItemEviction::copyFreqHistogram(HdrHistogram& hist) {
         hist.addValueAndCount(result->first, result->second);
     }
 }
+
+uint8_t ItemEviction::getEvictionScore(uint8_t freq,
+                                       size_t bytesFreed,
+                                       size_t refetchBytes,
+                                       size_t refBytes,
+                                       double bgFetchLatency,
+                                       size_t weight) {
+    if (weight == 0 || bytesFreed == 0 || refBytes == 0) {
+        return freq;
+    }
+
+    // The cost (in us) of refetching a value, per byte freed by evicting it
+    auto costPerByte = [bgFetchLatency](double freed, double read) {
+        return (bgFetchLatency + read / refetchBytesPerMicro) / freed;
+    };
+    const double score =
+            freq + weight * std::log2(costPerByte(bytesFreed, refetchBytes) /
+                                      costPerByte(refBytes, refBytes));
+    return gsl::narrow_cast<uint8_t>(std::min(
+            std::max(score, 0.0),
+            double(std::numeric_limits<uint8_t>::max())));
+}
+
+double ItemEviction::getBgFetchLatency(const EPStats& stats) {
+    const auto numBgOps = stats.bgNumOperations.load();
+    if (numBgOps == 0) {
+        return 0;
+    }
+    return double(stats.bgWait.load() + stats.bgLoad.load()) / numBgOps;
+}
@@ -23,6 +23,8 @@
 #include <limits>
 #include <utility>
 
+class EPStats;
+
 /**
  * A container for data structures that are used in the algorithm for
  * selecting which documents to evict from the hash table.
@@ -51,6 +53,10 @@
  * iterating over the hash table and evict all those values that have a
  * frequency count at or below the threshold.
  *
+ * With cost-aware eviction (item_eviction_cost_weight) the thresholds are
+ * applied to an eviction score rather than to the frequency count itself;
+ * the score also accounts for how many bytes evicting the value frees, and
+ * what it would cost to fetch it back (see getEvictionScore()).
  */
 class ItemEviction {
 
@@ -97,6 +103,40 @@ public:
     // Map from the 8-bit probabilistic counter (256 states) to NRU (4 states).
     static uint8_t convertFreqCountToNRUValue(uint8_t statCounter);
 
+    /**
+     * Get the cost-aware eviction score of a value: its frequency count
+     * adjusted by the cost of refetching it per byte its eviction frees, so
+     * that of two values referenced as often the one freeing the most memory
+     * per refetch is evicted first.
+     *
+     * The refetch cost is modelled as the mean bgfetch latency plus the time
+     * to read (and inflate) the uncompressed bytes of the value, so the
+     * smaller a value the more of its cost per byte is the latency, and a
+     * compressed value (freeing fewer bytes than it reads back) costs more
+     * per byte. As the frequency count is logarithmic in the number of
+     * references, the score adds weight * log2 of the cost per byte of the
+     * value relative to that of a value of refBytes.
+     *
+     * @param freq the frequency count of the value
+     * @param bytesFreed the bytes evicting the value frees
+     * @param refetchBytes the (uncompressed) bytes refetching the value reads
+     * @param refBytes the bytes of the reference value (e.g. the mean of the
+     *        vBucket), which keeps its frequency count as its score
+     * @param bgFetchLatency the mean bgfetch latency (us)
+     * @param weight the change in score for each doubling of the cost per
+     *        byte (0 disables cost-aware eviction)
+     * @return the score, in the range of the frequency count
+     */
+    static uint8_t getEvictionScore(uint8_t freq,
+                                    size_t bytesFreed,
+                                    size_t refetchBytes,
+                                    size_t refBytes,
+                                    double bgFetchLatency,
+                                    size_t weight);
+
+    // The mean latency (in us) of the bgfetches, waiting and loading.
+    static double getBgFetchLatency(const EPStats& stats);
+
     // The initial frequency count that items should be set to when first
     // added to the hash table.  It is not 0, as we want to ensure that we
     // do not immediately evict items that we have just added.
@@ -109,6 +149,10 @@ public:
 
     static const uint64_t casBitsNotTime = 16;
 
+    // The (rough) rate in bytes per us at which a bgfetch reads and inflates
+    // a value, for the refetch cost of getEvictionScore().
+    static const size_t refetchBytesPerMicro = 1000;
+
 private:
 
     //  The minimum value that can be added to the age histogram
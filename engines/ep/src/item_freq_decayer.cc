@@ -21,6 +21,7 @@
 #include "item_freq_decayer_visitor.h"
 #include "kv_bucket.h"
 #include "stored-value.h"
+#include "vbucket.h"
 
 #include <phosphor/phosphor.h>
 
@@ -49,8 +50,16 @@ bool ItemFreqDecayerTask::run(void) {
     // then resume from where we last were, otherwise create a new visitor
     // starting from the beginning.
     if (!prAdapter) {
+        lazy = engine->getConfiguration().isItemFreqDecayerLazy();
+        if (lazy && advanceFreqDecayEpochs()) {
+            // Every hash table was decayed by advancing its epoch, there
+            // are no documents to visit.
+            completed = true;
+            notified.store(false);
+            return !engine->getEpStats().isShutdown;
+        }
         prAdapter = std::make_unique<PauseResumeVBAdapter>(
-                std::make_unique<ItemFreqDecayerVisitor>(percentage));
+                std::make_unique<ItemFreqDecayerVisitor>(percentage, lazy));
         epstore_position = engine->getKVBucket()->startPosition();
         completed = false;
     }
@@ -98,6 +107,9 @@ bool ItemFreqDecayerTask::run(void) {
 
     // Delete(reset) visitor and allow to be notified if it finished.
     if (completed) {
+        if (lazy) {
+            completeLazyPass();
+        }
         prAdapter.reset();
         notified.store(false);
     } else {
@@ -147,3 +159,34 @@ std::chrono::milliseconds ItemFreqDecayerTask::getChunkDuration() const {
 ItemFreqDecayerVisitor& ItemFreqDecayerTask::getItemFreqDecayerVisitor() {
     return dynamic_cast<ItemFreqDecayerVisitor&>(prAdapter->getHTVisitor());
 }
+
+bool ItemFreqDecayerTask::advanceFreqDecayEpochs() {
+    auto& bucket = *engine->getKVBucket();
+    pendingEpochs.clear();
+    for (auto vbid : bucket.getVBuckets().getBuckets()) {
+        auto vb = bucket.getVBucket(vbid);
+        if (vb && !vb->ht.advanceFreqDecayEpoch(percentage)) {
+            pendingEpochs.push_back(vbid);
+        }
+    }
+    return pendingEpochs.empty();
+}
+
+void ItemFreqDecayerTask::completeLazyPass() {
+    // Nothing but this task advances the epochs, so every document visited
+    // by the pass has been decayed to the current epoch of its hash table.
+    auto& bucket = *engine->getKVBucket();
+    for (auto vbid : bucket.getVBuckets().getBuckets()) {
+        auto vb = bucket.getVBucket(vbid);
+        if (vb) {
+            vb->ht.setFreqDecaySwept(vb->ht.getFreqDecayEpoch());
+        }
+    }
+    for (auto vbid : pendingEpochs) {
+        auto vb = bucket.getVBucket(vbid);
+        if (vb) {
+            vb->ht.advanceFreqDecayEpoch(percentage);
+        }
+    }
+    pendingEpochs.clear();
+}
@@ -20,6 +20,8 @@
 #include "globaltask.h"
 #include "kv_bucket_iface.h"
 
+#include <vector>
+
 class ItemFreqDecayerVisitor;
 class PauseResumeVBAdapter;
 
@@ -27,6 +29,11 @@ class PauseResumeVBAdapter;
  * The task is responsible for running a visitor that iterates over all
  * documents in a given hash table, decaying the frequency count of each
  * document by a given percentage.
+ *
+ * With item_freq_decayer_lazy the task instead advances the frequency decay
+ * epoch of each hash table (see HashTable::advanceFreqDecayEpoch()), and only
+ * visits the documents when a hash table's epoch can't be advanced as it
+ * hasn't been visited (e.g. by the item pager) for too many epochs.
  */
 class ItemFreqDecayerTask : public GlobalTask {
 public:
@@ -59,6 +66,17 @@ private:
     // Returns the underlying AgeVisitor instance.
     ItemFreqDecayerVisitor& getItemFreqDecayerVisitor();
 
+    /**
+     * Advance the decay epoch of every hash table, recording those which
+     * can't be advanced in pendingEpochs.
+     * @return true if every epoch was advanced
+     */
+    bool advanceFreqDecayEpochs();
+
+    // Mark the hash tables as visited by the (lazy) pass which just
+    // completed, advancing the epochs which couldn't be advanced before it.
+    void completeLazyPass();
+
     // Opaque marker indicating how far through the epStore we have visited.
     KVBucketIface::Position epstore_position;
 
@@ -69,6 +87,13 @@ private:
     // aging is performed, whilst 100 means that the values are reset.
     uint16_t percentage;
 
+    // Is the current pass lazy (only catching up with the decay epochs)?
+    bool lazy = false;
+
+    // The vBuckets whose decay epoch couldn't be advanced before the
+    // current (lazy) pass.
+    std::vector<Vbid> pendingEpochs;
+
     /**
      * Visitor adapter which supports pausing & resuming (records how far
      * though a VBucket is has got). unique_ptr as we re-create it for each
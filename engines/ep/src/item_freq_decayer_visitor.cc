@@ -16,11 +16,13 @@
  */
 
 #include "item_freq_decayer_visitor.h"
+#include "vbucket.h"
 
 // AgeVisitor implementation ///////////////////////////////////////////
 
-ItemFreqDecayerVisitor::ItemFreqDecayerVisitor(uint16_t percentage_)
-    : percentage(percentage_), visitedCount(0) {
+ItemFreqDecayerVisitor::ItemFreqDecayerVisitor(uint16_t percentage_,
+                                               bool lazy_)
+    : percentage(percentage_), lazy(lazy_), visitedCount(0) {
 }
 
 void ItemFreqDecayerVisitor::setDeadline(
@@ -30,8 +32,14 @@ void ItemFreqDecayerVisitor::setDeadline(
 
 bool ItemFreqDecayerVisitor::visit(const HashTable::HashBucketLock& lh,
                                    StoredValue& v) {
-    // age the value's frequency counter by the given percentage
-    v.setFreqCounterValue(v.getFreqCounterValue() * (percentage * 0.01));
+    // apply any decay the value missed while lazy decay was enabled
+    if (ht) {
+        ht->decayFreqCounter(v);
+    }
+    if (!lazy) {
+        // age the value's frequency counter by the given percentage
+        v.setFreqCounterValue(v.getFreqCounterValue() * (percentage * 0.01));
+    }
     visitedCount++;
 
     // See if we have done enough work for this chunk. If so
@@ -39,6 +47,10 @@ bool ItemFreqDecayerVisitor::visit(const HashTable::HashBucketLock& lh,
     return progressTracker.shouldContinueVisiting(visitedCount);
 }
 
+void ItemFreqDecayerVisitor::setCurrentVBucket(VBucket& vb) {
+    ht = &vb.ht;
+}
+
 void ItemFreqDecayerVisitor::clearStats() {
     visitedCount = 0;
 }
@@ -24,10 +24,13 @@
 /**
  * Visit all documents in a hash table and reduce the frequency count of each
  * document by a given percentage.
+ *
+ * In lazy mode the frequency count of each document is only caught up with
+ * the decay epoch of the hash table (see HashTable::decayFreqCounter()).
  */
 class ItemFreqDecayerVisitor : public VBucketAwareHTVisitor {
 public:
-    ItemFreqDecayerVisitor(uint16_t percentage_);
+    ItemFreqDecayerVisitor(uint16_t percentage_, bool lazy_ = false);
 
     ~ItemFreqDecayerVisitor() = default;
 
@@ -39,6 +42,8 @@ public:
     // constructed.
     bool visit(const HashTable::HashBucketLock& lh, StoredValue& v) override;
 
+    void setCurrentVBucket(VBucket& vb) override;
+
     // Resets any held stats to zero.
     void clearStats();
 
@@ -53,8 +58,14 @@ private:
     // 100 would reset the counter to zero.
     const uint16_t percentage;
 
+    // Only catch up with the decay epoch of the hash table.
+    const bool lazy;
+
     /* Runtime state */
 
+    // The hash table being visited.
+    HashTable* ht = nullptr;
+
     // Estimates how far we have got, and when we should pause.
     ProgressTracker progressTracker;
 
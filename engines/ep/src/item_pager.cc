@@ -22,6 +22,7 @@
 #include "connmap.h"
 #include "dcp/dcpconnmap.h"
 #include "ep_engine.h"
+#include "ephemeral_bucket.h"
 #include "ep_time.h"
 #include "executorpool.h"
 #include "item.h"
@@ -29,6 +30,7 @@
 #include "kv_bucket.h"
 #include "kv_bucket_iface.h"
 #include "paging_visitor.h"
+#include "sampled_evictor.h"
 
 #include <platform/platform_time.h>
 
@@ -37,6 +39,7 @@
 #include <iostream>
 #include <limits>
 #include <list>
+#include <sstream>
 #include <string>
 #include <utility>
 
@@ -62,6 +65,8 @@ ItemPager::ItemPager(EventuallyPersistentEngine& e, EPStats& st)
                     : ACTIVE_AND_PENDING_ONLY;
 }
 
+ItemPager::~ItemPager() = default;
+
 bool ItemPager::run(void) {
     TRACE_EVENT0("ep-engine/task", "ItemPager");
 
@@ -86,8 +91,11 @@ bool ItemPager::run(void) {
         doEvict = false;
     }
 
+    auto overQuota = getCollectionsOverQuota(
+            *kvBucket, engine.getConfiguration().getCollectionMemoryQuotas());
+
     bool inverse = true;
-    if (((current > upper) || doEvict || wasNotified) &&
+    if (((current > upper) || doEvict || wasNotified || !overQuota.empty()) &&
         (*available).compare_exchange_strong(inverse, false)) {
         if (kvBucket->getItemEvictionPolicy() == EvictionPolicy::Value) {
             doEvict = true;
@@ -95,6 +103,14 @@ bool ItemPager::run(void) {
 
         ++stats.pagerRuns;
 
+        // Quotas are enforced by the PagingVisitor
+        if (engine.getConfiguration().isPagerSampledEviction() &&
+            overQuota.empty()) {
+            runSampledEviction();
+            *available = true;
+            return true;
+        }
+
         double toKill = (current - static_cast<double>(lower)) / current;
 
         EP_LOG_DEBUG("Using {} bytes of memory, paging out {} of items.",
@@ -144,6 +160,8 @@ bool ItemPager::run(void) {
                 isEphemeral,
                 cfg.getItemEvictionAgePercentage(),
                 cfg.getItemEvictionFreqCounterAgeThreshold());
+        pv->setCollectionsOverQuota(std::move(overQuota));
+        pv->setEvictionCostWeight(cfg.getItemEvictionCostWeight());
 
         // p99.99 is ~200ms
         const auto maxExpectedDurationForVisitorTask =
@@ -158,6 +176,112 @@ bool ItemPager::run(void) {
     return true;
 }
 
+void ItemPager::runSampledEviction() {
+    KVBucket* kvBucket = engine.getKVBucket();
+    Configuration& cfg = engine.getConfiguration();
+    if (!sampledEvictor) {
+        sampledEvictor = std::make_unique<SampledEvictor>(*kvBucket, stats);
+    }
+    sampledEvictor->setEvictionCostWeight(cfg.getItemEvictionCostWeight());
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto deadline = start + maxExpectedDuration();
+    const size_t samples = cfg.getPagerSampledEvictionSamples();
+    const bool wasHighMemoryUsage = kvBucket->isMemoryUsageTooHigh();
+
+    size_t evicted = 0;
+    // As for the hifi_mfu algorithm, nothing is evicted from the replica
+    // vbuckets of an ephemeral bucket.
+    if (cfg.getBucketType() == "persistent") {
+        evicted += sampledEvictor->evict(
+                kvBucket->getVBucketsInState(vbucket_state_replica),
+                samples,
+                deadline);
+    }
+    auto vbids = kvBucket->getVBucketsInState(vbucket_state_active);
+    const auto pending = kvBucket->getVBucketsInState(vbucket_state_pending);
+    vbids.insert(vbids.end(), pending.begin(), pending.end());
+    evicted += sampledEvictor->evict(vbids, samples, deadline);
+
+    // An Ephemeral bucket's auto-deleted items leave tombstones (and stale
+    // items) behind. If nothing is left to delete, they are what holds the
+    // memory; have the tombstone purger run now rather than at its next
+    // interval.
+    if (evicted == 0 &&
+        stats.getEstimatedTotalMemoryUsed() > stats.mem_low_wat) {
+        auto* ephemeral = dynamic_cast<EphemeralBucket*>(kvBucket);
+        if (ephemeral) {
+            ephemeral->wakeTombstonePurgerTask();
+        }
+    }
+
+    stats.itemPagerHisto.add(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start));
+    EP_LOG_DEBUG("Sampled eviction paged out {} values", evicted);
+
+    // Wake up any sleeping backfill tasks if the memory usage is lowered
+    // below the high watermark.
+    if (wasHighMemoryUsage && !kvBucket->isMemoryUsageTooHigh()) {
+        engine.getDcpConnMap().notifyBackfillManagerTasks();
+    }
+
+    // Out of time but still making progress, so carry on straight away
+    if (evicted > 0 &&
+        stats.getEstimatedTotalMemoryUsed() > stats.mem_low_wat) {
+        snooze(0);
+    }
+}
+
+std::unordered_map<CollectionID, size_t> ItemPager::getCollectionsOverQuota(
+        KVBucket& bucket, const std::string& quotas) {
+    std::unordered_map<CollectionID, size_t> overQuota;
+    if (quotas.empty()) {
+        return overQuota;
+    }
+
+    std::unordered_map<CollectionID, size_t> quota;
+    std::istringstream input(quotas);
+    std::string entry;
+    while (std::getline(input, entry, ',')) {
+        const auto colon = entry.find(':');
+        try {
+            if (colon == std::string::npos) {
+                throw std::invalid_argument("missing ':'");
+            }
+            const CollectionID cid(
+                    std::stoul(entry.substr(0, colon), nullptr, 16));
+            quota[cid] = std::stoull(entry.substr(colon + 1));
+        } catch (const std::exception& e) {
+            EP_LOG_WARN(
+                    "ItemPager::getCollectionsOverQuota: ignoring invalid "
+                    "collection_memory_quotas entry '{}': {}",
+                    entry,
+                    e.what());
+        }
+    }
+    if (quota.empty()) {
+        return overQuota;
+    }
+
+    std::unordered_map<CollectionID, size_t> used;
+    for (auto vbid : bucket.getVBuckets().getBuckets()) {
+        auto vb = bucket.getVBucket(vbid);
+        if (!vb) {
+            continue;
+        }
+        for (const auto& q : quota) {
+            used[q.first] += vb->ht.getCollectionMemory(q.first);
+        }
+    }
+    for (const auto& q : quota) {
+        if (used[q.first] > q.second) {
+            overQuota[q.first] = used[q.first] - q.second;
+        }
+    }
+    return overQuota;
+}
+
 void ItemPager::scheduleNow() {
     bool expected = false;
     if (notified.compare_exchange_strong(expected, true)) {
@@ -234,6 +358,12 @@ bool ExpiredItemPager::run(void) {
                 cfg.getItemEvictionAgePercentage(),
                 cfg.getItemEvictionFreqCounterAgeThreshold());
 
+        // Only visit every item every fullScanInterval runs (which also
+        // cleans up the temporary items). In between only the keys due
+        // per the expiry index of each vBucket are visited.
+        const auto fullScanInterval = cfg.getExpPagerFullScanInterval();
+        pv->setExpiryIndexOnly(runs++ % fullScanInterval != 0);
+
         // p99.99 is ~50ms (same as ItemPager).
         const auto maxExpectedDurationForVisitorTask =
                 std::chrono::milliseconds(50);
@@ -18,13 +18,20 @@
 
 #include "globaltask.h"
 
+#include <memcached/dockey.h>
 #include <memcached/types.h> // for ssize_t
 
+#include <memory>
+#include <string>
+#include <unordered_map>
+
 typedef std::pair<int64_t, int64_t> row_range_t;
 
 // Forward declaration.
 class EPStats;
+class KVBucket;
 class EventuallyPersistentEngine;
+class SampledEvictor;
 
 /**
  * The item pager phase
@@ -48,6 +55,8 @@ public:
      */
     ItemPager(EventuallyPersistentEngine& e, EPStats& st);
 
+    ~ItemPager();
+
     bool run(void);
 
     item_pager_phase getPhase() const {
@@ -73,11 +82,33 @@ public:
      */
     void scheduleNow();
 
+    /**
+     * Work out which collections use more memory (summed over all vBuckets)
+     * than their quota.
+     *
+     * @param bucket the bucket to check
+     * @param quotas the collection_memory_quotas configuration: a comma
+     *        separated list of <collection id (hex)>:<bytes>
+     * @return the number of bytes each collection is over its quota
+     */
+    static std::unordered_map<CollectionID, size_t> getCollectionsOverQuota(
+            KVBucket& bucket, const std::string& quotas);
+
 private:
+    /**
+     * Evict by sampling (pager_sampled_eviction) rather than scheduling a
+     * PagingVisitor: from the replica vBuckets first, then the active and
+     * pending ones, until the low watermark is reached.
+     */
+    void runSampledEviction();
+
     EventuallyPersistentEngine& engine;
     EPStats& stats;
     std::shared_ptr<std::atomic<bool>> available;
 
+    /// Created on the first sampled eviction; holds its candidates
+    std::unique_ptr<SampledEvictor> sampledEvictor;
+
     // Current pager phase. Atomic as may be accessed by multiple PagingVisitor
     // objects running on different threads.
     std::atomic<item_pager_phase> phase;
@@ -134,4 +165,7 @@ private:
     EPStats                        &stats;
     double                          sleepTime;
     std::shared_ptr<std::atomic<bool>>   available;
+
+    /// The number of visitors started (to know when to do a full scan)
+    size_t runs = 0;
 };
@@ -28,6 +28,8 @@
 
 #include <memcached/server_document_iface.h>
 #include <phosphor/phosphor.h>
+#include <platform/sysinfo.h>
+#include <platform/timeutils.h>
 #include <utilities/logtags.h>
 
 #include "access_scanner.h"
@@ -97,6 +99,8 @@ public:
             stats.warmupMemUsedCap.store(static_cast<double>(value) / 100.0);
         } else if (key.compare("warmup_min_items_threshold") == 0) {
             stats.warmupNumReadCap.store(static_cast<double>(value) / 100.0);
+        } else if (key == "task_slow_runtime_threshold") {
+            stats.taskSlowRuntimeThreshold.store(value);
         } else {
             EP_LOG_WARN(
                     "StatsValueChangeListener(size_t) failed to change value "
@@ -106,6 +110,17 @@ public:
         }
     }
 
+    void booleanValueChanged(const std::string& key, bool value) override {
+        if (key == "lock_profiling_enabled") {
+            stats.lockProfiler.setEnabled(value);
+        } else {
+            EP_LOG_WARN(
+                    "StatsValueChangeListener(bool) failed to change value "
+                    "for unknown variable, {}",
+                    key);
+        }
+    }
+
     void floatValueChanged(const std::string& key, float value) override {
         if (key.compare("mem_used_merge_threshold_percent") == 0) {
             stats.setMemUsedMergeThresholdPercent(value);
@@ -147,8 +162,18 @@ public:
             store.setCompactionExpMemThreshold(value);
         } else if (key.compare("replication_throttle_cap_pcnt") == 0) {
             store.getEPEngine().getReplicationThrottle().setCapPercent(value);
+        } else if (key.compare("replication_throttle_pace_pcnt") == 0) {
+            store.getEPEngine().getReplicationThrottle().setPacePercent(value);
         } else if (key.compare("max_ttl") == 0) {
             store.setMaxTtl(value);
+        } else if (key.compare("hot_key_cache_size") == 0) {
+            store.getHotKeyCache().setCapacity(value);
+        } else if (key.compare("hot_key_cache_min_freq") == 0) {
+            store.setHotKeyCacheMinFreq(value);
+        } else if (key.compare("max_blob_segments") == 0) {
+            store.setMaxBlobSegments(value);
+        } else if (key.compare("decompressed_value_cache_size") == 0) {
+            store.getDecompressedValueCache().setMaxSize(value);
         } else {
             EP_LOG_WARN("Failed to change value for unknown variable, {}", key);
         }
@@ -173,6 +198,8 @@ public:
             }
         } else if (key.compare("xattr_enabled") == 0) {
             store.setXattrEnabled(value);
+        } else if (key.compare("chk_remover_event_driven") == 0) {
+            store.setChkRemoverEventDriven(value);
         }
     }
 
@@ -267,7 +294,6 @@ KVBucket::KVBucket(EventuallyPersistentEngine& theEngine)
       stats(engine.getEpStats()),
       vbMap(theEngine.getConfiguration(), *this),
       defragmenterTask(NULL),
-      itemCompressorTask(nullptr),
       itemFreqDecayerTask(nullptr),
       vb_mutexes(engine.getConfiguration().getMaxVbuckets()),
       diskDeleteAll(false),
@@ -276,7 +302,10 @@ KVBucket::KVBucket(EventuallyPersistentEngine& theEngine)
       lastTransTimePerItem(0),
       collectionsManager(std::make_unique<Collections::Manager>()),
       xattrEnabled(true),
-      maxTtl(engine.getConfiguration().getMaxTtl()) {
+      maxTtl(engine.getConfiguration().getMaxTtl()),
+      hotKeyCache(Couchbase::get_available_cpu_count()),
+      decompressedValueCache(
+              engine.getConfiguration().getDecompressedValueCacheSize()) {
     cachedResidentRatio.activeRatio.store(0);
     cachedResidentRatio.replicaRatio.store(0);
 
@@ -291,12 +320,26 @@ KVBucket::KVBucket(EventuallyPersistentEngine& theEngine)
     const size_t size = GlobalTask::allTaskIds.size();
     stats.schedulingHisto.resize(size);
     stats.taskRuntimeHisto.resize(size);
+    stats.taskTotalRuntime.resize(size);
+    stats.taskSlowRuns.resize(size);
 
     for (size_t i = 0; i < GlobalTask::allTaskIds.size(); i++) {
         stats.schedulingHisto[i].reset();
         stats.taskRuntimeHisto[i].reset();
+        stats.taskTotalRuntime[i].store(0);
+        stats.taskSlowRuns[i].store(0);
     }
 
+    stats.taskSlowRuntimeThreshold.store(config.getTaskSlowRuntimeThreshold());
+    config.addValueChangedListener(
+            "task_slow_runtime_threshold",
+            std::make_unique<StatsValueChangeListener>(stats, *this));
+
+    stats.lockProfiler.setEnabled(config.isLockProfilingEnabled());
+    config.addValueChangedListener(
+            "lock_profiling_enabled",
+            std::make_unique<StatsValueChangeListener>(stats, *this));
+
     ExecutorPool::get()->registerTaskable(ObjectRegistry::getCurrentEngine()->getTaskable());
 
     // Reset memory overhead when bucket is created.
@@ -349,6 +392,9 @@ KVBucket::KVBucket(EventuallyPersistentEngine& theEngine)
     config.addValueChangedListener(
             "replication_throttle_cap_pcnt",
             std::make_unique<EPStoreValueChangeListener>(*this));
+    config.addValueChangedListener(
+            "replication_throttle_pace_pcnt",
+            std::make_unique<EPStoreValueChangeListener>(*this));
 
     stats.warmupMemUsedCap.store(static_cast<double>
                                (config.getWarmupMinMemoryThreshold()) / 100.0);
@@ -400,9 +446,30 @@ KVBucket::KVBucket(EventuallyPersistentEngine& theEngine)
             "xattr_enabled",
             std::make_unique<EPStoreValueChangeListener>(*this));
 
+    chkRemoverEventDriven = config.isChkRemoverEventDriven();
+    config.addValueChangedListener(
+            "chk_remover_event_driven",
+            std::make_unique<EPStoreValueChangeListener>(*this));
+
     config.addValueChangedListener(
             "max_ttl", std::make_unique<EPStoreValueChangeListener>(*this));
 
+    hotKeyCache.setCapacity(config.getHotKeyCacheSize());
+    config.addValueChangedListener(
+            "hot_key_cache_size",
+            std::make_unique<EPStoreValueChangeListener>(*this));
+    hotKeyCacheMinFreq = config.getHotKeyCacheMinFreq();
+    config.addValueChangedListener(
+            "hot_key_cache_min_freq",
+            std::make_unique<EPStoreValueChangeListener>(*this));
+    maxBlobSegments = config.getMaxBlobSegments();
+    config.addValueChangedListener(
+            "max_blob_segments",
+            std::make_unique<EPStoreValueChangeListener>(*this));
+    config.addValueChangedListener(
+            "decompressed_value_cache_size",
+            std::make_unique<EPStoreValueChangeListener>(*this));
+
     xattrEnabled = config.isXattrEnabled();
 
     // Always create the item pager; but initially disable, leaving scheduling
@@ -427,6 +494,8 @@ bool KVBucket::initialize() {
     chkTask = std::make_shared<ClosedUnrefCheckpointRemoverTask>(
             &engine, stats, checkpointRemoverInterval);
     ExecutorPool::get()->schedule(chkTask);
+    chkRemovalTask = std::make_shared<CheckpointRemovalTask>(engine, stats);
+    ExecutorPool::get()->schedule(chkRemovalTask);
 
     durabilityTimeoutTask = std::make_shared<DurabilityTimeoutTask>(
             engine,
@@ -481,8 +550,8 @@ KVBucket::~KVBucket() {
     EP_LOG_INFO("Deleting vb_mutexes");
     EP_LOG_INFO("Deleting defragmenterTask");
     defragmenterTask.reset();
-    EP_LOG_INFO("Deleting itemCompressorTask");
-    itemCompressorTask.reset();
+    EP_LOG_INFO("Deleting itemCompressorTasks");
+    itemCompressorTasks.clear();
     EP_LOG_INFO("Deleting itemFreqDecayerTask");
     itemFreqDecayerTask.reset();
     EP_LOG_INFO("Deleted KvBucket.");
@@ -623,6 +692,16 @@ void KVBucket::logRunTime(TaskId taskType,
                           const std::chrono::steady_clock::duration runTime) {
     auto ms = std::chrono::duration_cast<std::chrono::microseconds>(runTime);
     stats.taskRuntimeHisto[static_cast<int>(taskType)].add(ms);
+    stats.taskTotalRuntime[static_cast<int>(taskType)] += ms.count();
+
+    const auto threshold = stats.taskSlowRuntimeThreshold.load();
+    if (threshold && runTime > std::chrono::milliseconds(threshold)) {
+        ++stats.taskSlowRuns[static_cast<int>(taskType)];
+        EP_LOG_WARN("Slow runtime for task {}: {} (threshold {}ms)",
+                    GlobalTask::getTaskName(taskType),
+                    cb::time2text(runTime),
+                    threshold);
+    }
 }
 
 ENGINE_ERROR_CODE KVBucket::set(Item& itm,
@@ -672,6 +751,61 @@ ENGINE_ERROR_CODE KVBucket::set(Item& itm,
     }
 }
 
+std::vector<ENGINE_ERROR_CODE> KVBucket::setMulti(
+        Vbid vbid, const std::vector<Item*>& items, const void* cookie) {
+    auto fail = [&items](ENGINE_ERROR_CODE status) {
+        return std::vector<ENGINE_ERROR_CODE>(items.size(), status);
+    };
+
+    VBucketPtr vb = getVBucket(vbid);
+    if (!vb) {
+        stats.numNotMyVBuckets += items.size();
+        return fail(ENGINE_NOT_MY_VBUCKET);
+    }
+
+    folly::SharedMutex::ReadHolder rlh(vb->getStateLock());
+    if (vb->getState() == vbucket_state_dead ||
+        vb->getState() == vbucket_state_replica) {
+        stats.numNotMyVBuckets += items.size();
+        return fail(ENGINE_NOT_MY_VBUCKET);
+    } else if (vb->getState() == vbucket_state_pending ||
+               vb->isTakeoverBackedUp()) {
+        // Unlike a single set the batch doesn't wait for the vbucket to
+        // become active, the client retries it
+        return fail(ENGINE_TMPFAIL);
+    }
+
+    if (items.empty()) {
+        return {};
+    }
+    auto ret = vb->checkDurabilityRequirements(*items.front());
+    if (ret != ENGINE_SUCCESS) {
+        return fail(ret);
+    }
+
+    std::vector<ENGINE_ERROR_CODE> results(items.size());
+    for (size_t ii = 0; ii < items.size(); ++ii) {
+        auto& itm = *items[ii];
+        // Only lock the collections for one item at a time, a writer may
+        // be waiting for the lock
+        auto cHandle = vb->lockCollections(itm.getKey());
+        if (!cHandle.valid()) {
+            results[ii] = ENGINE_UNKNOWN_COLLECTION;
+            continue;
+        }
+        cHandle.processExpiryTime(itm, getMaxTtl());
+        results[ii] = vb->setWithoutCommit(itm, cookie, engine, {}, cHandle);
+    }
+
+    // As set(), commit the SyncWrites which are already satisfied (if the
+    // vbucket has no replicas), but once for the batch
+    if (items.front()->isPending()) {
+        vb->getActiveDM().checkForCommit();
+    }
+
+    return results;
+}
+
 ENGINE_ERROR_CODE KVBucket::add(Item &itm, const void *cookie)
 {
     VBucketPtr vb = getVBucket(itm.getVBucketId());
@@ -758,6 +892,89 @@ ENGINE_ERROR_CODE KVBucket::replace(Item& itm,
     }
 }
 
+GetValue KVBucket::update(const DocKey& key,
+                          Vbid vbucket,
+                          uint64_t cas,
+                          const cb::UpdateFunction& update,
+                          const void* cookie) {
+    VBucketPtr vb = getVBucket(vbucket);
+    if (!vb) {
+        ++stats.numNotMyVBuckets;
+        return GetValue(nullptr, ENGINE_NOT_MY_VBUCKET);
+    }
+
+    // Obtain read-lock on VB state to ensure VB state changes are interlocked
+    // with this update
+    folly::SharedMutex::ReadHolder rlh(vb->getStateLock());
+    if (vb->getState() == vbucket_state_dead ||
+        vb->getState() == vbucket_state_replica) {
+        ++stats.numNotMyVBuckets;
+        return GetValue(nullptr, ENGINE_NOT_MY_VBUCKET);
+    } else if (vb->getState() == vbucket_state_pending) {
+        if (vb->addPendingOp(cookie)) {
+            return GetValue(nullptr, ENGINE_EWOULDBLOCK);
+        }
+    } else if (vb->isTakeoverBackedUp()) {
+        EP_LOG_DEBUG(
+                "({}) Returned TMPFAIL to an update op"
+                ", because takeover is lagging",
+                vb->getId());
+        return GetValue(nullptr, ENGINE_TMPFAIL);
+    }
+
+    auto cHandle = vb->lockCollections(key);
+    if (!cHandle.valid()) {
+        engine.setErrorJsonExtras(
+                cookie,
+                Collections::getUnknownCollectionErrorContext(
+                        cHandle.getManifestUid()));
+        return GetValue(nullptr, ENGINE_UNKNOWN_COLLECTION);
+    }
+    return vb->update(cas, update, getMaxTtl(), cookie, engine, cHandle);
+}
+
+GetValue KVBucket::append(const DocKey& key,
+                          Vbid vbucket,
+                          uint64_t cas,
+                          cb::const_char_buffer value,
+                          const void* cookie) {
+    VBucketPtr vb = getVBucket(vbucket);
+    if (!vb) {
+        ++stats.numNotMyVBuckets;
+        return GetValue(nullptr, ENGINE_NOT_MY_VBUCKET);
+    }
+
+    // Obtain read-lock on VB state to ensure VB state changes are interlocked
+    // with this append
+    folly::SharedMutex::ReadHolder rlh(vb->getStateLock());
+    if (vb->getState() == vbucket_state_dead ||
+        vb->getState() == vbucket_state_replica) {
+        ++stats.numNotMyVBuckets;
+        return GetValue(nullptr, ENGINE_NOT_MY_VBUCKET);
+    } else if (vb->getState() == vbucket_state_pending) {
+        if (vb->addPendingOp(cookie)) {
+            return GetValue(nullptr, ENGINE_EWOULDBLOCK);
+        }
+    } else if (vb->isTakeoverBackedUp()) {
+        EP_LOG_DEBUG(
+                "({}) Returned TMPFAIL to an append op"
+                ", because takeover is lagging",
+                vb->getId());
+        return GetValue(nullptr, ENGINE_TMPFAIL);
+    }
+
+    auto cHandle = vb->lockCollections(key);
+    if (!cHandle.valid()) {
+        engine.setErrorJsonExtras(
+                cookie,
+                Collections::getUnknownCollectionErrorContext(
+                        cHandle.getManifestUid()));
+        return GetValue(nullptr, ENGINE_UNKNOWN_COLLECTION);
+    }
+    return vb->append(
+            cas, value, maxBlobSegments, getMaxTtl(), cookie, engine, cHandle);
+}
+
 ENGINE_ERROR_CODE KVBucket::addBackfillItem(Item& itm,
                                             ExtendedMetaData* emd) {
     VBucketPtr vb = getVBucket(itm.getVBucketId());
@@ -909,6 +1126,11 @@ ENGINE_ERROR_CODE KVBucket::setVBucketState_UNLOCKED(
         }
         scheduleVBStatePersist(vbid);
     } else if (vbid.get() < vbMap.getSize()) {
+        if (vbucketsBeingInstalled.count(vbid) != 0) {
+            // The vbucket is created once its data file is installed
+            return ENGINE_TMPFAIL;
+        }
+
         auto ft =
                 std::make_unique<FailoverTable>(engine.getMaxFailoverEntries());
         KVShard* shard = vbMap.getShardByVbId(vbid);
@@ -923,6 +1145,11 @@ ENGINE_ERROR_CODE KVBucket::setVBucketState_UNLOCKED(
 
         newvb->setFreqSaturatedCallback(
                 [this] { this->wakeItemFreqDecayerTask(); });
+        newvb->setSyncWriteDeadlineCallback(
+                [this](Vbid vbid,
+                       std::chrono::steady_clock::time_point deadline) {
+                    this->addSyncWriteDeadline(vbid, deadline);
+                });
 
         Configuration& config = engine.getConfiguration();
         if (config.isBfilterEnabled()) {
@@ -1365,7 +1592,11 @@ void KVBucket::completeBGFetchMulti(
             auto* fetched_item = item.second;
             ENGINE_ERROR_CODE status = vb->completeBGFetchForSingleItem(
                     key, *fetched_item, startTime);
-            engine.notifyIOComplete(fetched_item->cookie, status);
+            // A fetch queued for a batch (such as setWithMetaMulti) may not
+            // have a client waiting for it
+            if (fetched_item->cookie) {
+                engine.notifyIOComplete(fetched_item->cookie, status);
+            }
         }
         EP_LOG_DEBUG(
                 "EP Store completes {} of batched background fetch "
@@ -1377,8 +1608,10 @@ void KVBucket::completeBGFetchMulti(
                         .count());
     } else {
         for (const auto& item : fetchedItems) {
-            engine.notifyIOComplete(item.second->cookie,
-                                    ENGINE_NOT_MY_VBUCKET);
+            if (item.second->cookie) {
+                engine.notifyIOComplete(item.second->cookie,
+                                        ENGINE_NOT_MY_VBUCKET);
+            }
         }
         EP_LOG_WARN(
                 "EP Store completes {} of batched background fetch for "
@@ -1443,37 +1676,124 @@ GetValue KVBucket::getInternal(const DocKey& key,
             return GetValue(NULL, ENGINE_UNKNOWN_COLLECTION);
         }
 
-        return vb->getInternal(cookie,
-                               engine,
-                               options,
-                               diskDeleteAll,
-                               VBucket::GetKeyOnly::No,
-                               cHandle);
+        // Only the documents of an active vbucket (with their CAS, and
+        // not deleted) are copied into the hot key cache
+        const bool hotKeyCacheable =
+                hotKeyCache.getCapacity() != 0 && honorStates &&
+                allowedState == vbucket_state_active &&
+                vb->getState() == vbucket_state_active &&
+                (options & HIDE_LOCKED_CAS) &&
+                !(options & (GET_DELETED_VALUE | ALLOW_META_ONLY));
+        uint64_t generation = 0;
+        if (hotKeyCacheable) {
+            generation = vb->getHotKeyGeneration();
+            auto item = hotKeyCache.get(key, vbucket, generation);
+            if (item && !cHandle.isLogicallyDeleted(item->getBySeqno())) {
+                if (options & TRACK_STATISTICS) {
+                    vb->opsGet++;
+                }
+                GetValue gv(std::move(item));
+                inflateForReader(cookie, gv);
+                return gv;
+            }
+        }
+
+        auto gv = vb->getInternal(cookie,
+                                  engine,
+                                  options,
+                                  diskDeleteAll,
+                                  VBucket::GetKeyOnly::No,
+                                  cHandle);
+        // The generation was read before the document, so the copy is
+        // dropped if the document changed in between
+        if (hotKeyCacheable && gv.getStatus() == ENGINE_SUCCESS &&
+            gv.item->getCas() != uint64_t(-1) &&
+            gv.item->getFreqCounterValue() >= hotKeyCacheMinFreq) {
+            hotKeyCache.put(*gv.item, generation);
+        }
+        inflateForReader(cookie, gv);
+        return gv;
     }
 }
 
-GetValue KVBucket::getRandomKey() {
-    size_t max = vbMap.getSize();
+void KVBucket::inflateForReader(const void* cookie, GetValue& gv) {
+    if (decompressedValueCache.getMaxSize() == 0 || !cookie ||
+        gv.getStatus() != ENGINE_SUCCESS || gv.isPartial() ||
+        !gv.item->getValue()) {
+        return;
+    }
+    // The front end inflates the value itself for a client without Snappy,
+    // and for a document with xattrs (to split them from the body); give
+    // it the cached inflated value instead
+    const auto datatype = gv.item->getDataType();
+    if (!mcbp::datatype::is_snappy(datatype) ||
+        (!mcbp::datatype::is_xattr(datatype) &&
+         engine.isDatatypeSupported(cookie,
+                                    PROTOCOL_BINARY_DATATYPE_SNAPPY))) {
+        return;
+    }
+    value_t inflated;
+    if (decompressedValueCache.decompress(gv.item->getValue(), inflated)) {
+        gv.item->setDecompressedValue(inflated);
+    }
+}
 
-    const Vbid::id_type start = labs(getRandom()) % max;
-    Vbid::id_type curr = start;
-    std::unique_ptr<Item> itm;
+GetValue KVBucket::getRandomKey(boost::optional<CollectionID> cid,
+                                const void* cookie) {
+    // Weigh the active vbuckets by their items, so that an item of a
+    // small vbucket is no more likely to be picked than one of a big one
+    std::vector<std::pair<VBucketPtr, uint64_t>> candidates;
+    uint64_t total = 0;
+    boost::optional<Collections::ManifestUid> unknownCollection;
+    for (const auto vbid : vbMap.getBucketsInState(vbucket_state_active)) {
+        VBucketPtr vb = getVBucket(vbid);
+        if (!vb || vb->getState() != vbucket_state_active) {
+            continue;
+        }
+        uint64_t items = vb->ht.getNumItems();
+        if (cid) {
+            auto handle = vb->lockCollections();
+            if (!handle.exists(*cid)) {
+                unknownCollection = handle.getManifestUid();
+                continue;
+            }
+            items = handle.getItemCount(*cid);
+        }
+        total += items;
+        candidates.emplace_back(std::move(vb), items);
+    }
 
-    while (itm == NULL) {
-        VBucketPtr vb = getVBucket(Vbid(curr++));
-        if (vb && vb->getState() == vbucket_state_active &&
-                (itm = vb->ht.getRandomKey(getRandom()))) {
-            GetValue rv(std::move(itm), ENGINE_SUCCESS);
-            return rv;
+    if (candidates.empty()) {
+        if (unknownCollection) {
+            engine.setErrorJsonExtras(
+                    cookie,
+                    Collections::getUnknownCollectionErrorContext(
+                            *unknownCollection));
+            return GetValue(NULL, ENGINE_UNKNOWN_COLLECTION);
         }
+        return GetValue(NULL, ENGINE_KEY_ENOENT);
+    }
 
-        if (curr == max) {
-            curr = 0;
+    size_t start = 0;
+    if (total == 0) {
+        // No counts to go by (e.g. collection counts aren't maintained by
+        // ephemeral buckets)
+        start = labs(getRandom()) % candidates.size();
+    } else {
+        uint64_t pick = uint64_t(labs(getRandom())) % total;
+        while (pick >= candidates[start].second) {
+            pick -= candidates[start].second;
+            ++start;
         }
-        if (curr == start) {
-            break;
+    }
+
+    // Search the other vbuckets if the one picked has no qualifying item
+    for (size_t ii = 0; ii < candidates.size(); ++ii) {
+        auto& vb = candidates[(start + ii) % candidates.size()].first;
+        auto itm = vb->ht.getRandomKey(getRandom(), cid);
+        if (itm) {
+            return GetValue(std::move(itm), ENGINE_SUCCESS);
         }
-        // Search next vbucket
     }
 
     return GetValue(NULL, ENGINE_KEY_ENOENT);
@@ -1515,6 +1835,45 @@ ENGINE_ERROR_CODE KVBucket::getMetaData(const DocKey& key,
     }
 }
 
+std::vector<MetaDataResult> KVBucket::getMetaDataMulti(
+        Vbid vbid, const std::vector<DocKey>& keys) {
+    std::vector<MetaDataResult> results(keys.size());
+    auto fail = [&results](ENGINE_ERROR_CODE status) {
+        for (auto& result : results) {
+            result.status = status;
+        }
+        return results;
+    };
+
+    VBucketPtr vb = getVBucket(vbid);
+    if (!vb) {
+        stats.numNotMyVBuckets += keys.size();
+        return fail(ENGINE_NOT_MY_VBUCKET);
+    }
+
+    folly::SharedMutex::ReadHolder rlh(vb->getStateLock());
+    if (vb->getState() == vbucket_state_dead ||
+        vb->getState() == vbucket_state_replica) {
+        stats.numNotMyVBuckets += keys.size();
+        return fail(ENGINE_NOT_MY_VBUCKET);
+    }
+
+    for (size_t ii = 0; ii < keys.size(); ++ii) {
+        auto& result = results[ii];
+        // Only lock the collections for one key at a time, a writer may be
+        // waiting for the lock
+        auto cHandle = vb->lockCollections(keys[ii]);
+        if (!cHandle.valid()) {
+            result.status = ENGINE_UNKNOWN_COLLECTION;
+            continue;
+        }
+        result.status = vb->getMetaDataWithoutBgFetch(
+                cHandle, result.metadata, result.deleted, result.datatype);
+    }
+
+    return results;
+}
+
 ENGINE_ERROR_CODE KVBucket::setWithMeta(Item& itm,
                                         uint64_t cas,
                                         uint64_t* seqno,
@@ -1585,6 +1944,157 @@ ENGINE_ERROR_CODE KVBucket::setWithMeta(Item& itm,
     return rv;
 }
 
+std::pair<size_t, ENGINE_ERROR_CODE> KVBucket::setWithMetaBatch(
+        Vbid vbid,
+        const std::vector<Item*>& items,
+        const void* cookie,
+        PermittedVBStates permittedVBStates) {
+    VBucketPtr vb = getVBucket(vbid);
+    if (!vb) {
+        ++stats.numNotMyVBuckets;
+        return {0, ENGINE_NOT_MY_VBUCKET};
+    }
+
+    size_t done = 0;
+    ENGINE_ERROR_CODE rv = ENGINE_SUCCESS;
+    VBNotifyCtx notifyCtx;
+    {
+        folly::SharedMutex::ReadHolder rlh(vb->getStateLock());
+        if (!permittedVBStates.test(vb->getState())) {
+            if (vb->getState() == vbucket_state_pending) {
+                if (vb->addPendingOp(cookie)) {
+                    return {0, ENGINE_EWOULDBLOCK};
+                }
+            } else {
+                ++stats.numNotMyVBuckets;
+                return {0, ENGINE_NOT_MY_VBUCKET};
+            }
+        } else if (vb->isTakeoverBackedUp()) {
+            EP_LOG_DEBUG(
+                    "({}) Returned TMPFAIL to a setWithMetaBatch op"
+                    ", becuase takeover is lagging",
+                    vb->getId());
+            return {0, ENGINE_TMPFAIL};
+        }
+
+        for (auto* itm : items) {
+            if (!Item::isValidCas(itm->getCas())) {
+                rv = ENGINE_KEY_EEXISTS;
+                break;
+            }
+            auto cHandle = vb->lockCollections(itm->getKey());
+            if (!cHandle.valid()) {
+                engine.setErrorJsonExtras(
+                        cookie,
+                        Collections::getUnknownCollectionErrorContext(
+                                cHandle.getManifestUid()));
+                rv = ENGINE_UNKNOWN_COLLECTION;
+                break;
+            }
+            cHandle.processExpiryTime(*itm, getMaxTtl());
+            rv = vb->setWithMeta(*itm,
+                                 0,
+                                 nullptr,
+                                 cookie,
+                                 engine,
+                                 CheckConflicts::No,
+                                 true,
+                                 GenerateBySeqno::No,
+                                 GenerateCas::No,
+                                 cHandle,
+                                 &notifyCtx);
+            if (rv != ENGINE_SUCCESS) {
+                break;
+            }
+            ++done;
+        }
+    }
+
+    if (done > 0) {
+        vb->notifyBatch(notifyCtx);
+        checkAndMaybeFreeMemory();
+    }
+    return {done, rv};
+}
+
+std::vector<ENGINE_ERROR_CODE> KVBucket::setWithMetaMulti(
+        Vbid vbid,
+        const std::vector<Item*>& items,
+        PermittedVBStates permittedVBStates,
+        CheckConflicts checkConflicts,
+        GenerateCas genCas) {
+    auto fail = [&items](ENGINE_ERROR_CODE status) {
+        return std::vector<ENGINE_ERROR_CODE>(items.size(), status);
+    };
+
+    VBucketPtr vb = getVBucket(vbid);
+    if (!vb) {
+        stats.numNotMyVBuckets += items.size();
+        return fail(ENGINE_NOT_MY_VBUCKET);
+    }
+
+    std::vector<ENGINE_ERROR_CODE> results(items.size());
+    bool stored = false;
+    VBNotifyCtx notifyCtx;
+    {
+        folly::SharedMutex::ReadHolder rlh(vb->getStateLock());
+        if (!permittedVBStates.test(vb->getState())) {
+            if (vb->getState() == vbucket_state_pending) {
+                // Unlike a single setWithMeta the batch doesn't wait for the
+                // vbucket to become active, the client retries it
+                return fail(ENGINE_TMPFAIL);
+            }
+            stats.numNotMyVBuckets += items.size();
+            return fail(ENGINE_NOT_MY_VBUCKET);
+        } else if (vb->isTakeoverBackedUp()) {
+            EP_LOG_DEBUG(
+                    "({}) Returned TMPFAIL to a setWithMetaMulti op"
+                    ", becuase takeover is lagging",
+                    vb->getId());
+            return fail(ENGINE_TMPFAIL);
+        }
+
+        for (size_t ii = 0; ii < items.size(); ++ii) {
+            auto& itm = *items[ii];
+            if (!Item::isValidCas(itm.getCas())) {
+                results[ii] = ENGINE_KEY_EEXISTS;
+                continue;
+            }
+            auto cHandle = vb->lockCollections(itm.getKey());
+            if (!cHandle.valid()) {
+                results[ii] = ENGINE_UNKNOWN_COLLECTION;
+                continue;
+            }
+            cHandle.processExpiryTime(itm, getMaxTtl());
+            // No cookie: a background fetch the set needs (the meta data
+            // was evicted again) doesn't notify anyone, the client retries
+            auto rv = vb->setWithMeta(itm,
+                                      0,
+                                      nullptr,
+                                      nullptr,
+                                      engine,
+                                      checkConflicts,
+                                      true,
+                                      GenerateBySeqno::Yes,
+                                      genCas,
+                                      cHandle,
+                                      &notifyCtx);
+            if (rv == ENGINE_EWOULDBLOCK) {
+                rv = ENGINE_TMPFAIL;
+            } else if (rv == ENGINE_SUCCESS) {
+                stored = true;
+            }
+            results[ii] = rv;
+        }
+    }
+
+    if (stored) {
+        vb->notifyBatch(notifyCtx);
+        checkAndMaybeFreeMemory();
+    }
+    return results;
+}
+
 GetValue KVBucket::getAndUpdateTtl(const DocKey& key,
                                    Vbid vbucket,
                                    const void* cookie,
@@ -1682,6 +2192,7 @@ ENGINE_ERROR_CODE KVBucket::unlockKey(const DocKey& key,
         if (v->isLocked(currentTime)) {
             if (v->getCas() == cas) {
                 v->unlock();
+                vb->bumpHotKeyGeneration();
                 return ENGINE_SUCCESS;
             }
             return ENGINE_LOCKED_TMPFAIL;
@@ -1881,12 +2392,14 @@ void KVBucket::reset() {
         auto vb = getLockedVBucket(vbid);
         if (vb) {
             vb->ht.clear();
+            vb->bumpHotKeyGeneration();
             vb->checkpointManager->clear(vb->getState());
             vb->resetStats();
             vb->setPersistedSnapshot(0, 0);
             EP_LOG_INFO("KVBucket::reset(): Successfully flushed {}", vbid);
         }
     }
+    hotKeyCache.clear();
     EP_LOG_INFO("KVBucket::reset(): Successfully flushed bucket");
 }
 
@@ -1906,6 +2419,10 @@ bool KVBucket::isWarmingUp() {
     return false;
 }
 
+bool KVBucket::isWarmupTrafficReady() {
+    return false;
+}
+
 bool KVBucket::isWarmupOOMFailure() {
     return false;
 }
@@ -2018,6 +2535,14 @@ void KVBucket::wakeItemFreqDecayerTask() {
     t.wakeup();
 }
 
+void KVBucket::addSyncWriteDeadline(
+        Vbid vbid, std::chrono::steady_clock::time_point deadline) {
+    if (durabilityTimeoutTask) {
+        auto& t = dynamic_cast<DurabilityTimeoutTask&>(*durabilityTimeoutTask);
+        t.addDeadline(vbid, deadline);
+    }
+}
+
 void KVBucket::enableAccessScannerTask() {
     LockHolder lh(accessScanner.mutex);
     if (!accessScanner.enabled) {
@@ -2099,8 +2624,12 @@ void KVBucket::resetAccessScannerStartTime() {
 }
 
 void KVBucket::enableItemCompressor() {
-    itemCompressorTask = std::make_shared<ItemCompressorTask>(&engine, stats);
-    ExecutorPool::get()->schedule(itemCompressorTask);
+    const size_t tasks = engine.getConfiguration().getItemCompressorTasks();
+    for (size_t ii = 0; ii < tasks; ++ii) {
+        itemCompressorTasks.push_back(
+                std::make_shared<ItemCompressorTask>(&engine, stats, ii, tasks));
+        ExecutorPool::get()->schedule(itemCompressorTasks.back());
+    }
 }
 
 void KVBucket::setAllBloomFilters(bool to) {
@@ -2215,6 +2744,8 @@ void KVBucket::resetUnderlyingStats(void)
     for (size_t i = 0; i < GlobalTask::allTaskIds.size(); i++) {
         stats.schedulingHisto[i].reset();
         stats.taskRuntimeHisto[i].reset();
+        stats.taskTotalRuntime[i].store(0);
+        stats.taskSlowRuns[i].store(0);
     }
 }
 
@@ -2340,6 +2871,14 @@ void KVBucket::attemptToFreeMemory() {
     static_cast<ItemPager*>(itemPagerTask.get())->scheduleNow();
 }
 
+void KVBucket::scheduleCheckpointRemoval(Vbid vbid) {
+    if (chkRemoverEventDriven && chkRemovalTask) {
+        chkRemovalTask->schedule(vbid);
+    } else {
+        wakeUpCheckpointRemover();
+    }
+}
+
 void KVBucket::runDefragmenterTask() {
     defragmenterTask->run();
 }
@@ -2493,7 +3032,7 @@ uint16_t KVBucket::getNumOfVBucketsInState(vbucket_state_t state) const {
 SyncWriteCompleteCallback KVBucket::makeSyncWriteCompleteCB() {
     auto& engine = this->engine;
     return [&engine](const void* cookie, ENGINE_ERROR_CODE status) {
-        engine.notifyIOComplete(cookie, status);
+        engine.notifySyncWriteComplete(cookie, status);
     };
 }
 
@@ -14,8 +14,10 @@
 
 #pragma once
 
+#include "decompressed_value_cache.h"
 #include "ep_types.h"
 #include "executorpool.h"
+#include "hot_key_cache.h"
 #include "kv_bucket_iface.h"
 #include "mutation_log.h"
 #include "stored-value.h"
@@ -27,7 +29,9 @@
 
 #include <cstdlib>
 #include <deque>
+#include <set>
 
+class CheckpointRemovalTask;
 class ReplicationThrottle;
 class VBucketCountVisitor;
 namespace Collections {
@@ -114,12 +118,28 @@ public:
                           const void* cookie,
                           cb::StoreIfPredicate predicate = {}) override;
 
+    std::vector<ENGINE_ERROR_CODE> setMulti(Vbid vbid,
+                                            const std::vector<Item*>& items,
+                                            const void* cookie) override;
+
     ENGINE_ERROR_CODE add(Item &item, const void *cookie) override;
 
     ENGINE_ERROR_CODE replace(Item& item,
                               const void* cookie,
                               cb::StoreIfPredicate predicate = {}) override;
 
+    GetValue update(const DocKey& key,
+                    Vbid vbucket,
+                    uint64_t cas,
+                    const cb::UpdateFunction& update,
+                    const void* cookie) override;
+
+    GetValue append(const DocKey& key,
+                    Vbid vbucket,
+                    uint64_t cas,
+                    cb::const_char_buffer value,
+                    const void* cookie) override;
+
     ENGINE_ERROR_CODE addBackfillItem(Item& item,
                                       ExtendedMetaData* emd) override;
 
@@ -131,7 +151,8 @@ public:
                            options);
     }
 
-    GetValue getRandomKey() override;
+    GetValue getRandomKey(boost::optional<CollectionID> cid,
+                          const void* cookie) override;
 
     GetValue getReplica(const DocKey& key,
                         Vbid vbucket,
@@ -148,6 +169,9 @@ public:
                                   uint32_t& deleted,
                                   uint8_t& datatype) override;
 
+    std::vector<MetaDataResult> getMetaDataMulti(
+            Vbid vbid, const std::vector<DocKey>& keys) override;
+
     ENGINE_ERROR_CODE setWithMeta(
             Item& item,
             uint64_t cas,
@@ -160,6 +184,19 @@ public:
             GenerateCas genCas = GenerateCas::No,
             ExtendedMetaData* emd = NULL) override;
 
+    std::pair<size_t, ENGINE_ERROR_CODE> setWithMetaBatch(
+            Vbid vbid,
+            const std::vector<Item*>& items,
+            const void* cookie,
+            PermittedVBStates permittedVBStates) override;
+
+    std::vector<ENGINE_ERROR_CODE> setWithMetaMulti(
+            Vbid vbid,
+            const std::vector<Item*>& items,
+            PermittedVBStates permittedVBStates,
+            CheckConflicts checkConflicts,
+            GenerateCas genCas) override;
+
     GetValue getAndUpdateTtl(const DocKey& key,
                              Vbid vbucket,
                              const void* cookie,
@@ -474,6 +511,13 @@ public:
     /// Wake up the ItemFreqDecayer Task, scheduling it for immediate run.
     void wakeItemFreqDecayerTask();
 
+    /**
+     * Have the DurabilityTimeoutTask process the vBucket by the deadline
+     * (the expiry-time of one of its SyncWrites).
+     */
+    void addSyncWriteDeadline(Vbid vbid,
+                              std::chrono::steady_clock::time_point deadline);
+
     void enableAccessScannerTask() override;
     void disableAccessScannerTask() override;
     void setAccessScannerSleeptime(size_t val, bool useStartTime) override;
@@ -546,6 +590,22 @@ public:
         }
     }
 
+    /**
+     * Called when the vbucket has closed checkpoints which can be removed
+     * (the last cursor left them). Queues the vbucket for the checkpoint
+     * removal task when chk_remover_event_driven is enabled, otherwise
+     * wakes the periodic checkpoint remover.
+     */
+    void scheduleCheckpointRemoval(Vbid vbid);
+
+    bool isChkRemoverEventDriven() const {
+        return chkRemoverEventDriven;
+    }
+
+    void setChkRemoverEventDriven(bool value) {
+        chkRemoverEventDriven = value;
+    }
+
     void runDefragmenterTask() override;
 
     void runItemFreqDecayerTask() override;
@@ -578,6 +638,8 @@ public:
 
     bool isWarmingUp() override;
 
+    bool isWarmupTrafficReady() override;
+
     bool isWarmupOOMFailure() override;
 
     /**
@@ -662,6 +724,24 @@ public:
     /// set the buckets maxTtl
     void setMaxTtl(size_t max);
 
+    HotKeyCache& getHotKeyCache() {
+        return hotKeyCache;
+    }
+
+    /// set the frequency counter value from which a document read is hot
+    void setHotKeyCacheMinFreq(size_t value) {
+        hotKeyCacheMinFreq = value;
+    }
+
+    /// set the maximum number of segments of a value appended to in place
+    void setMaxBlobSegments(size_t value) {
+        maxBlobSegments = value;
+    }
+
+    DecompressedValueCache& getDecompressedValueCache() {
+        return decompressedValueCache;
+    }
+
 protected:
 
     GetValue getInternal(const DocKey& key,
@@ -670,6 +750,13 @@ protected:
                          vbucket_state_t allowedState,
                          get_options_t options) override;
 
+    /**
+     * Replace the Snappy compressed value of a document read by one which
+     * the front end would have to inflate with the inflated value from the
+     * decompressedValueCache.
+     */
+    void inflateForReader(const void* cookie, GetValue& gv);
+
     bool resetVBucket_UNLOCKED(LockedVBucketPtr& vb,
                                std::unique_lock<std::mutex>& vbset);
 
@@ -725,9 +812,13 @@ protected:
     VBucketMap                      vbMap;
     ExTask itemPagerTask;
     ExTask                          chkTask;
+    /// Frees the checkpoints of the vbuckets from scheduleCheckpointRemoval
+    std::shared_ptr<CheckpointRemovalTask> chkRemovalTask;
+    cb::RelaxedAtomic<bool> chkRemoverEventDriven;
     float                           bfilterResidencyThreshold;
     ExTask                          defragmenterTask;
-    ExTask itemCompressorTask;
+    /// One per partition of the vBuckets (item_compressor_tasks)
+    std::vector<ExTask> itemCompressorTasks;
     // The itemFreqDecayerTask is used to decay the frequency count of items
     // stored in the hash table.  This is required to ensure that all the
     // frequency counts do not become saturated.
@@ -753,6 +844,9 @@ protected:
     } deleteAllTaskCtx;
 
     std::mutex vbsetMutex;
+    /// The vbuckets being installed from a data file (which can't be
+    /// created meanwhile), guarded by vbsetMutex
+    std::set<Vbid> vbucketsBeingInstalled;
     double backfillMemoryThreshold;
     struct ExpiryPagerDelta {
         ExpiryPagerDelta() : sleeptime(0), task(0), enabled(true) {}
@@ -799,6 +893,17 @@ protected:
 
     std::atomic<size_t> maxTtl;
 
+    /// Copies of the documents most read, per front-end thread
+    HotKeyCache hotKeyCache;
+    cb::RelaxedAtomic<size_t> hotKeyCacheMinFreq;
+
+    /// The maximum number of segments of a value appended to without being
+    /// copied (0 = append always copies the value)
+    cb::RelaxedAtomic<size_t> maxBlobSegments;
+
+    /// The inflated values of the compressed documents read most recently
+    DecompressedValueCache decompressedValueCache;
+
     /**
      * Allows us to override the random function.  This is used for testing
      * purposes where we want a constant number as opposed to a random one.
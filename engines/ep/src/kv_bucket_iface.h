@@ -46,6 +46,17 @@ class Manager;
 
 using bgfetched_item_t = std::pair<DiskDocKey, const VBucketBGFetchItem*>;
 
+/**
+ * The metadata of one of the keys of a getMetaDataMulti batch, as
+ * getMetaData returns it
+ */
+struct MetaDataResult {
+    ENGINE_ERROR_CODE status = ENGINE_SUCCESS;
+    ItemMetaData metadata;
+    uint32_t deleted = 0;
+    uint8_t datatype = PROTOCOL_BINARY_RAW_BYTES;
+};
+
 /**
  * This is the abstract base class that manages the bucket behavior in
  * ep-engine.
@@ -105,6 +116,22 @@ public:
                                   const void* cookie,
                                   cb::StoreIfPredicate predicate = {}) = 0;
 
+    /**
+     * Set a batch of items of a vbucket in the store, as set() would each
+     * of them. The vbucket's state lock is taken and the durability
+     * requirements are checked once for the batch, and the SyncWrites of
+     * the batch already satisfied are committed together once all of the
+     * items are added.
+     *
+     * @param vbid the vbucket of the items
+     * @param items the items to set, with a CAS of zero and all with the
+     *        same durability requirements (if any)
+     * @param cookie the cookie representing the client to store the items
+     * @return the result of the store of each item
+     */
+    virtual std::vector<ENGINE_ERROR_CODE> setMulti(
+            Vbid vbid, const std::vector<Item*>& items, const void* cookie) = 0;
+
     /**
      * Add an item in the store.
      * @param item the item to add
@@ -126,6 +153,44 @@ public:
                                       const void* cookie,
                                       cb::StoreIfPredicate predicate = {}) = 0;
 
+    /**
+     * Update a document in place: the function is called with the current
+     * document (or nullptr if there is none) under the hash bucket lock and
+     * the document it returns is stored in its place, so no other mutation
+     * of the key can happen in between.
+     *
+     * @param key the key of the document to update
+     * @param vbucket the vbucket of the document
+     * @param cas the CAS the current document must have (0 for any)
+     * @param update the function returning the updated document
+     * @param cookie the cookie representing the client to store the item
+     * @return the result of the operation and the document stored
+     */
+    virtual GetValue update(const DocKey& key,
+                            Vbid vbucket,
+                            uint64_t cas,
+                            const cb::UpdateFunction& update,
+                            const void* cookie) = 0;
+
+    /**
+     * Append data to the value of an existing document, without copying
+     * the current value (see VBucket::append).
+     *
+     * @param key the key of the document to append to
+     * @param vbucket the vbucket of the document
+     * @param cas the CAS the current document must have (0 for any)
+     * @param value the data to append
+     * @param cookie the cookie representing the client to store the item
+     * @return the result of the operation and the document stored (without
+     *         its value). ENGINE_ENOTSUP if the value can't be appended to
+     *         without copying it.
+     */
+    virtual GetValue append(const DocKey& key,
+                            Vbid vbucket,
+                            uint64_t cas,
+                            cb::const_char_buffer value,
+                            const void* cookie) = 0;
+
     /**
      * Add a DCP backfill item into its corresponding vbucket
      * @param item the item to be added
@@ -150,11 +215,15 @@ public:
                          get_options_t options) = 0;
 
     /**
-     * Retrieve a value randomly from the store.
+     * Retrieve a value randomly from the store, each resident item of the
+     * active vbuckets being (about) equally likely.
      *
+     * @param cid only consider the items of this collection (if set)
+     * @param cookie the connection's cookie (for the error context)
      * @return a GetValue representing the value retrieved
      */
-    virtual GetValue getRandomKey() = 0;
+    virtual GetValue getRandomKey(boost::optional<CollectionID> cid,
+                                  const void* cookie) = 0;
 
     /**
      * Retrieve a value from a vbucket in replica state.
@@ -191,6 +260,21 @@ public:
                                           uint32_t& deleted,
                                           uint8_t& datatype) = 0;
 
+    /**
+     * Retrieve the meta data for a batch of keys of a vbucket, as
+     * getMetaData would each of them, taking the vbucket's state lock once
+     * for the batch. No background fetch is scheduled for the keys whose
+     * meta data isn't in memory: their status is ENGINE_EWOULDBLOCK, and
+     * the caller reads their meta data from disk together (completing each
+     * with VBucket::completeBGFetchForSingleItem).
+     *
+     * @param vbid the vbucket of the keys
+     * @param keys the keys to get the meta data for
+     * @return the result for each key
+     */
+    virtual std::vector<MetaDataResult> getMetaDataMulti(
+            Vbid vbid, const std::vector<DocKey>& keys) = 0;
+
     /**
      * Set an item in the store.
      * @param item the item to set
@@ -218,6 +302,53 @@ public:
             GenerateCas genCas = GenerateCas::No,
             ExtendedMetaData* emd = NULL) = 0;
 
+    /**
+     * Set a run of replicated items (with their seqnos and CAS) in a
+     * vbucket, as setWithMeta without conflict resolution would one by one.
+     * The vbucket state lock is taken and the new seqnos notified (to the
+     * flusher and DCP) once for the run rather than per item.
+     *
+     * @param vbid the vbucket all the items belong to
+     * @param items the items to set, in seqno order
+     * @param cookie the cookie representing the client storing the items
+     * @param permittedVBStates set of VB states that the target VB can be in
+     *
+     * @return the number of items set (from the front) and the result of
+     *         setting the next one (ENGINE_SUCCESS if all were set)
+     */
+    virtual std::pair<size_t, ENGINE_ERROR_CODE> setWithMetaBatch(
+            Vbid vbid,
+            const std::vector<Item*>& items,
+            const void* cookie,
+            PermittedVBStates permittedVBStates) = 0;
+
+    /**
+     * Set a batch of items of a vbucket with their meta data, as
+     * setWithMeta would each of them (overwriting existing keys, resolving
+     * the conflicts if checkConflicts). Unlike setWithMetaBatch a failure
+     * doesn't stop the batch, each item gets its own result. The vbucket's
+     * state lock is taken and the new seqnos notified once for the batch.
+     *
+     * The items don't wait for anything: a vbucket which is pending (or
+     * whose takeover is backed up) fails them with ENGINE_TMPFAIL, and so
+     * does an item whose meta data must be fetched from disk (the caller
+     * should fetch the meta data of the batch first, see
+     * getMetaDataMulti).
+     *
+     * @param vbid the vbucket of the items
+     * @param items the items to set (with their CAS set)
+     * @param permittedVBStates set of VB states that the target VB can be in
+     * @param checkConflicts set to Yes if conflict resolution must be done
+     * @param genCas generate a new CAS? (yes/no)
+     * @return the result of the set of each item
+     */
+    virtual std::vector<ENGINE_ERROR_CODE> setWithMetaMulti(
+            Vbid vbid,
+            const std::vector<Item*>& items,
+            PermittedVBStates permittedVBStates,
+            CheckConflicts checkConflicts,
+            GenerateCas genCas) = 0;
+
     /**
      * Retrieve a value, but update its TTL first
      *
@@ -439,6 +570,30 @@ public:
      */
     virtual ENGINE_ERROR_CODE cancelCompaction(Vbid vbid) = 0;
 
+    /**
+     * Snapshot the data file of a vbucket (as a hard link) so it may be
+     * copied to another node, and installed there with installVBucket().
+     *
+     * @param vbid The vbucket to snapshot
+     * @param dir The directory to create the link in
+     * @param path Set to the path of the link created
+     */
+    virtual ENGINE_ERROR_CODE linkVBucketFile(Vbid vbid,
+                                              const std::string& dir,
+                                              std::string& path) = 0;
+
+    /**
+     * Install a data file snapshot by linkVBucketFile() as a replica
+     * vbucket, which is warmed up from it in the background.
+     *
+     * @param vbid The vbucket to install, which must not exist
+     * @param path The path of the file
+     * @param ck cookie used to notify connection of operation completion
+     */
+    virtual ENGINE_ERROR_CODE installVBucket(Vbid vbid,
+                                             const std::string& path,
+                                             const void* ck) = 0;
+
     /**
      * Get the database file id for the compaction request
      *
@@ -642,6 +797,13 @@ public:
 
     virtual bool isWarmingUp() = 0;
 
+    /**
+     * @return true if warmup isn't complete but data traffic may already be
+     *         served (warmup_early_traffic); warmup is loading the items in
+     *         the background.
+     */
+    virtual bool isWarmupTrafficReady() = 0;
+
     /**
      * Checks the memory consumption.
      * To be used by backfill tasks (DCP).
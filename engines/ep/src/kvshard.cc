@@ -60,6 +60,10 @@ KVShard::KVShard(uint16_t id, Configuration& config)
                 "Invalid backend type '" +
                 backend + "'");
     }
+
+    if (config.isHtSharedLocks()) {
+        htLocks = std::make_shared<HashTable::Locks>(config.getHtLocks());
+    }
 }
 
 void KVShard::enablePersistence(EPBucket& ep) {
@@ -103,6 +103,14 @@ public:
     std::vector<Vbid> getVBucketsSortedByState();
     std::vector<Vbid> getVBuckets();
 
+    /**
+     * @return the locks shared by the HashTables of this shard's vbuckets,
+     *         or null if each HashTable has its own (ht_shared_locks=false)
+     */
+    std::shared_ptr<HashTable::Locks> getHashTableLocks() const {
+        return htLocks;
+    }
+
 private:
     // Holds the store configuration for the current shard.
     // We need to use a unique_ptr in place of the concrete class because
@@ -202,6 +210,9 @@ private:
     std::unique_ptr<Flusher> flusher;
     std::unique_ptr<BgFetcher> bgFetcher;
 
+    // The HashTable locks of the shard's vbuckets (see ht_shared_locks)
+    std::shared_ptr<HashTable::Locks> htLocks;
+
 public:
     std::atomic<size_t> highPriorityCount;
 
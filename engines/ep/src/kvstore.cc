@@ -280,6 +280,11 @@ void KVStore::addStats(const AddStatFn& add_stat,
     addStat(prefix, "open",           st.numOpen,         add_stat, c);
     addStat(prefix, "close",          st.numClose,        add_stat, c);
     addStat(prefix, "numLoadedVb",    st.numLoadedVb,     add_stat, c);
+    addStat(prefix,
+            "file_handle_cache_hits",
+            st.numFileHandleCacheHits,
+            add_stat,
+            c);
 
     // failure stats
     addStat(prefix, "failure_compaction", st.numCompactionFailure, add_stat, c);
@@ -290,6 +295,11 @@ void KVStore::addStats(const AddStatFn& add_stat,
         addStat(prefix, "failure_set",   st.numSetFailure,   add_stat, c);
         addStat(prefix, "failure_del",   st.numDelFailure,   add_stat, c);
         addStat(prefix, "failure_vbset", st.numVbSetFailure, add_stat, c);
+        addStat(prefix,
+                "compaction_rewrites_skipped",
+                st.numCompactionRewritesSkipped,
+                add_stat,
+                c);
         addStat(prefix, "lastCommDocs",  st.docsCommitted,   add_stat, c);
     }
 
@@ -21,6 +21,7 @@
 #include "collections/eraser_context.h"
 #include "collections/kvstore.h"
 
+#include <boost/optional.hpp>
 #include <memcached/engine_common.h>
 #include <utilities/hdrhistogram.h>
 
@@ -29,6 +30,7 @@
 #include <chrono>
 #include <cstring>
 #include <deque>
+#include <functional>
 #include <list>
 #include <map>
 #include <string>
@@ -36,6 +38,9 @@
 #include <vector>
 
 /* Forward declarations */
+class BloomFilter;
+class HashTableImage;
+class HashTableImageWriter;
 class BucketLogger;
 class DiskDocKey;
 class Item;
@@ -99,6 +104,8 @@ struct FileInfo {
 
 struct CompactionStats {
     size_t collectionsItemsPurged = 0;
+    /// collectionsItemsPurged, by the collection the items belonged to
+    std::unordered_map<CollectionID, size_t> collectionsItemsPurgedById;
     size_t collectionsDeletedItemsPurged = 0;
     uint64_t tombstonesPurged = 0;
     FileInfo pre;
@@ -129,6 +136,13 @@ struct compaction_ctx {
     /// pointer as context cannot be constructed until deeper inside storage
     std::unique_ptr<Collections::VB::EraserContext> eraserContext;
     Collections::KVStore::DroppedCb droppedKeyCb;
+    /**
+     * Called with the bytes of the documents the compaction has kept (in
+     * batches), may block to limit the rate the compaction writes at
+     */
+    std::function<void(size_t)> throttleCb;
+    /// The bytes of the documents kept since throttleCb was last called
+    size_t unthrottledBytes{0};
 };
 
 struct kvstats_ctx {
@@ -187,6 +201,14 @@ enum class ValueFilter {
     VALUES_DECOMPRESSED
 };
 
+/// The order in which a scan visits the documents
+enum class ScanOrder {
+    /// By seqno (the order of the mutations)
+    BySeqno,
+    /// By key, only visiting the latest version of each document
+    ByKey
+};
+
 enum class VBStatePersist {
     VBSTATE_CACHE_UPDATE_ONLY,       //Update only cached state in-memory
     VBSTATE_PERSIST_WITHOUT_COMMIT,  //Persist without committing to disk
@@ -225,6 +247,20 @@ public:
     BucketLogger* logger;
     const KVStoreConfig& config;
     Collections::VB::ScanContext collectionsContext;
+
+    /// The file offset the KVStore has asked the OS to read ahead up to
+    uint64_t readaheadEnd{0};
+    /// The file offset the KVStore has let the OS drop the pages up to
+    uint64_t dropBehindEnd{0};
+
+    /**
+     * The order scan() visits the documents in; may be set to ByKey (before
+     * the first scan()) if the KVStore's StorageProperties
+     * hasKeyOrderScan(). A ByKey scan doesn't update lastReadSeqno.
+     */
+    ScanOrder order{ScanOrder::BySeqno};
+    /// The key of the last document a ByKey scan read
+    boost::optional<DiskDocKey> lastReadKey;
 };
 
 struct FileStats {
@@ -279,6 +315,8 @@ public:
           numClose(0),
           numLoadedVb(0),
           numCompactionFailure(0),
+          numCompactionRewritesSkipped(0),
+          numFileHandleCacheHits(0),
           numGetFailure(0),
           numSetFailure(0),
           numDelFailure(0),
@@ -299,6 +337,8 @@ public:
         numClose = 0;
         numLoadedVb = 0;
         numCompactionFailure = 0;
+        numCompactionRewritesSkipped = 0;
+        numFileHandleCacheHits = 0;
         numGetFailure = 0;
         numSetFailure = 0;
         numDelFailure = 0;
@@ -329,6 +369,10 @@ public:
     cb::RelaxedAtomic<size_t> numClose;
     // the number of vbuckets loaded
     cb::RelaxedAtomic<size_t> numLoadedVb;
+    // the number of compactions which scanned the file without rewriting it
+    cb::RelaxedAtomic<size_t> numCompactionRewritesSkipped;
+    // the number of reads which reused a cached file handle
+    cb::RelaxedAtomic<size_t> numFileHandleCacheHits;
 
     //stats tracking failures
     cb::RelaxedAtomic<size_t> numCompactionFailure;
@@ -449,11 +493,17 @@ public:
         No
     };
 
+    enum class KeyOrderScan {
+        Yes,
+        No
+    };
+
     StorageProperties(EfficientVBDump evb, EfficientVBDeletion evd, PersistedDeletion pd,
-                      EfficientGet eget, ConcurrentWriteCompact cwc)
+                      EfficientGet eget, ConcurrentWriteCompact cwc,
+                      KeyOrderScan kos)
         : efficientVBDump(evb), efficientVBDeletion(evd),
           persistedDeletions(pd), efficientGet(eget),
-          concWriteCompact(cwc) {}
+          concWriteCompact(cwc), keyOrderScan(kos) {}
 
     /* True if we can efficiently dump a single vbucket */
     bool hasEfficientVBDump() const {
@@ -481,12 +531,18 @@ public:
         return (concWriteCompact == ConcurrentWriteCompact::Yes);
     }
 
+    /* True if a ScanContext may scan the documents in key order */
+    bool hasKeyOrderScan() const {
+        return (keyOrderScan == KeyOrderScan::Yes);
+    }
+
 private:
     EfficientVBDump efficientVBDump;
     EfficientVBDeletion efficientVBDeletion;
     PersistedDeletion persistedDeletions;
     EfficientGet efficientGet;
     ConcurrentWriteCompact concWriteCompact;
+    KeyOrderScan keyOrderScan;
 };
 
 /**
@@ -608,6 +664,28 @@ public:
      */
     virtual bool commit(Collections::VB::Flush& collectionsFlush) = 0;
 
+    /**
+     * Enable or disable group commit. In group commit mode commit() may
+     * leave the final sync of the commit to syncPendingCommits(), so the
+     * syncs of the commits of a number of vBuckets are done together. The
+     * changes of such a commit aren't durable until syncPendingCommits()
+     * succeeds.
+     *
+     * @return false if the KVStore doesn't support group commit
+     */
+    virtual bool setGroupCommit(bool enabled) {
+        return false;
+    }
+
+    /**
+     * Sync the commits whose sync was left by commit() in group commit mode.
+     *
+     * @return false if any of the syncs failed (and should be retried)
+     */
+    virtual bool syncPendingCommits() {
+        return true;
+    }
+
     /**
      * Rollback the current transaction.
      */
@@ -647,6 +725,32 @@ public:
         throw std::runtime_error("Backend does not support getMulti()");
     }
 
+    /**
+     * Callback for getMultiParallel(), called with the items of a vBucket
+     * once their documents have been retrieved.
+     */
+    using GetMultiCallback = std::function<void(Vbid, vb_bgfetch_queue_t&)>;
+
+    /**
+     * Retrieve the documents of several vBuckets, calling done for each
+     * vBucket as soon as its documents have been retrieved. The callbacks
+     * may be made from other threads and concurrently with each other;
+     * returns once all of them have completed.
+     *
+     * The default retrieves the vBuckets in turn with getMulti().
+     *
+     * @param fetches the vbucket ids and the items to retrieve from them
+     * @param done callback for each vBucket
+     */
+    virtual void getMultiParallel(
+            std::vector<std::pair<Vbid, vb_bgfetch_queue_t>>& fetches,
+            const GetMultiCallback& done) {
+        for (auto& fetch : fetches) {
+            getMulti(fetch.first, fetch.second);
+            done(fetch.first, fetch.second);
+        }
+    }
+
     /**
      * Callback for getRange().
      * @param value The fetched value. Note r-value receiver can modify (e.g.
@@ -827,11 +931,33 @@ public:
         return st;
     }
 
+    /**
+     * Call back with (at most count of) the keys of the vBucket's documents,
+     * in key order starting at start_key. The callback may set a non-success
+     * status to end the scan early, e.g. once it's past the keys it wants.
+     */
     virtual ENGINE_ERROR_CODE getAllKeys(
             Vbid vbid,
             const DiskDocKey& start_key,
             uint32_t count,
-            std::shared_ptr<Callback<const DiskDocKey&>> cb) = 0;
+            std::shared_ptr<StatusCallback<const DiskDocKey&>> cb) = 0;
+
+    /**
+     * Call back with the (non-deleted) documents of the vBucket with keys in
+     * [startKey, endKey), in key order. Values are decompressed; KEYS_ONLY
+     * doesn't read them. The callback may set a non-success status to end
+     * the scan early.
+     *
+     * Only implemented by CouchKVStore; other backends return ENOTSUP.
+     */
+    virtual ENGINE_ERROR_CODE scanRange(
+            Vbid vbid,
+            const DiskDocKey& startKey,
+            const DiskDocKey& endKey,
+            ValueFilter valFilter,
+            std::shared_ptr<StatusCallback<GetValue>> cb) {
+        return ENGINE_ENOTSUP;
+    }
 
     /**
      * Create a KVStore Scan Context with the given options. On success,
@@ -910,6 +1036,93 @@ public:
      */
     virtual uint64_t prepareToDelete(Vbid vbid) = 0;
 
+    /**
+     * Write the bloom filter of the vBucket to disk, next to its data, so
+     * a warmup can load it instead of starting without a filter. The
+     * filter is only valid for the current data of the vBucket, so it is
+     * stamped with the persisted seqno it covers (and whatever else the
+     * store needs to tell the data has changed).
+     *
+     * @return true if the filter was written
+     */
+    virtual bool saveBloomFilter(Vbid vbid,
+                                 uint64_t persistedSeqno,
+                                 const BloomFilter& filter) {
+        return false;
+    }
+
+    /**
+     * Read the bloom filter written by saveBloomFilter(), if it is still
+     * valid for the data of the vBucket.
+     *
+     * @param persistedSeqno the seqno the vBucket is persisted up to
+     * @return the filter, or nullptr if there is no valid filter
+     */
+    virtual std::unique_ptr<BloomFilter> loadBloomFilter(
+            Vbid vbid, uint64_t persistedSeqno) {
+        return {};
+    }
+
+    /**
+     * Write an image of the HashTable of the vBucket to disk, next to its
+     * data, so a warmup can load the items from it instead of reading
+     * them from the data file. As with saveBloomFilter() the image is only
+     * valid for the current data of the vBucket.
+     *
+     * @return true if the image was written
+     */
+    virtual bool saveHashTableImage(Vbid vbid,
+                                    uint64_t persistedSeqno,
+                                    const HashTableImageWriter& image) {
+        return false;
+    }
+
+    /**
+     * Open the HashTable image written by saveHashTableImage(), if it is
+     * still valid for the data of the vBucket.
+     *
+     * @param persistedSeqno the seqno the vBucket is persisted up to
+     * @return the image, or nullptr if there is no valid image
+     */
+    virtual std::unique_ptr<HashTableImage> loadHashTableImage(
+            Vbid vbid, uint64_t persistedSeqno) {
+        return {};
+    }
+
+    /**
+     * Snapshot the data file of the vBucket, as a hard link in the given
+     * directory, so it may be copied to another node and installed there
+     * with installVBucketFile(). A copy of the link must be a consistent
+     * image of the vBucket (as of the last commit it holds) however the
+     * vBucket is written to, compacted or deleted meanwhile.
+     *
+     * @param dir the directory to create the link in (on the same file
+     *            system as the data files)
+     * @return the path of the link, or an empty string if the store
+     *         doesn't support snapshots (or the link couldn't be created)
+     */
+    virtual std::string linkVBucketFile(Vbid vbid, const std::string& dir) {
+        return {};
+    }
+
+    /**
+     * Install a data file snapshot by linkVBucketFile() (on this or another
+     * node) as the data file of the vBucket, which must not exist in
+     * memory. The file is moved into the data directory, replacing any
+     * file of the vBucket, and the persisted state of the vBucket is read
+     * from it.
+     *
+     * @param path the path of the file (on the same file system as the
+     *             data files)
+     * @return the state of the vBucket read from the file, or nullptr if
+     *         the store doesn't support installing files (or the file
+     *         couldn't be installed, in which case it's left at path)
+     */
+    virtual vbucket_state* installVBucketFile(Vbid vbid,
+                                              const std::string& path) {
+        return nullptr;
+    }
+
     /**
      * Set a system event into the KVStore.
      * Collection system events will be used to maintain extra meta-data before
@@ -30,6 +30,22 @@ public:
     void sizeValueChanged(const std::string& key, size_t value) override {
         if (key == "fsync_after_every_n_bytes_written") {
             config.setPeriodicSyncBytes(value);
+        } else if (key == "backfill_readahead_size") {
+            config.setBackfillReadaheadSize(value);
+        } else if (key == "couchstore_compaction_min_fragmentation") {
+            config.setCouchstoreCompactionMinFragmentation(value);
+        } else if (key == "couchstore_compaction_readahead_size") {
+            config.setCouchstoreCompactionReadaheadSize(value);
+        } else if (key == "couchstore_file_handle_cache_size") {
+            config.setCouchstoreFileHandleCacheSize(value);
+        } else if (key == "couchstore_writeback_size") {
+            config.setCouchstoreWritebackSize(value);
+        }
+    }
+
+    void booleanValueChanged(const std::string& key, bool value) override {
+        if (key == "couchstore_drop_behind") {
+            config.setCouchstoreDropBehind(value);
         }
     }
 
@@ -47,6 +63,33 @@ KVStoreConfig::KVStoreConfig(Configuration& config, uint16_t shardid)
     config.addValueChangedListener(
             "fsync_after_every_n_bytes_written",
             std::make_unique<ConfigChangeListener>(*this));
+    setBackfillReadaheadSize(config.getBackfillReadaheadSize());
+    config.addValueChangedListener(
+            "backfill_readahead_size",
+            std::make_unique<ConfigChangeListener>(*this));
+    setCouchstoreCompactionMinFragmentation(
+            config.getCouchstoreCompactionMinFragmentation());
+    config.addValueChangedListener(
+            "couchstore_compaction_min_fragmentation",
+            std::make_unique<ConfigChangeListener>(*this));
+    setCouchstoreCompactionReadaheadSize(
+            config.getCouchstoreCompactionReadaheadSize());
+    config.addValueChangedListener(
+            "couchstore_compaction_readahead_size",
+            std::make_unique<ConfigChangeListener>(*this));
+    setCouchstoreFileHandleCacheSize(
+            config.getCouchstoreFileHandleCacheSize());
+    config.addValueChangedListener(
+            "couchstore_file_handle_cache_size",
+            std::make_unique<ConfigChangeListener>(*this));
+    setCouchstoreWritebackSize(config.getCouchstoreWritebackSize());
+    config.addValueChangedListener(
+            "couchstore_writeback_size",
+            std::make_unique<ConfigChangeListener>(*this));
+    setCouchstoreDropBehind(config.isCouchstoreDropBehind());
+    config.addValueChangedListener(
+            "couchstore_drop_behind",
+            std::make_unique<ConfigChangeListener>(*this));
 }
 
 KVStoreConfig::KVStoreConfig(uint16_t _maxVBuckets,
@@ -60,7 +103,13 @@ KVStoreConfig::KVStoreConfig(uint16_t _maxVBuckets,
       backend(_backend),
       shardId(_shardId),
       logger(globalBucketLogger.get()),
-      buffered(true) {
+      buffered(true),
+      backfillReadaheadSize(0),
+      couchstoreCompactionMinFragmentation(0),
+      couchstoreCompactionReadaheadSize(0),
+      couchstoreDropBehind(false),
+      couchstoreFileHandleCacheSize(0),
+      couchstoreWritebackSize(0) {
 }
 
 KVStoreConfig::~KVStoreConfig() = default;
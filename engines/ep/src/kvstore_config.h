@@ -98,6 +98,92 @@ public:
         periodicSyncBytes = bytes;
     }
 
+    /**
+     * The number of bytes of document bodies a scan asks the OS to read
+     * ahead of the current position (0 = no read ahead).
+     *
+     * Only recognised by CouchKVStore
+     */
+    uint64_t getBackfillReadaheadSize() const {
+        return backfillReadaheadSize;
+    }
+
+    void setBackfillReadaheadSize(uint64_t bytes) {
+        backfillReadaheadSize = bytes;
+    }
+
+    /**
+     * The fragmentation (stale percentage of the file) below which a
+     * compaction only scans the file for expired items rather than
+     * rewriting it (0 = always rewrite).
+     *
+     * Only recognised by CouchKVStore
+     */
+    size_t getCouchstoreCompactionMinFragmentation() const {
+        return couchstoreCompactionMinFragmentation;
+    }
+
+    void setCouchstoreCompactionMinFragmentation(size_t percent) {
+        couchstoreCompactionMinFragmentation = percent;
+    }
+
+    /**
+     * The number of bytes a compaction asks the OS to read ahead of what it
+     * reads from the file it compacts (0 = no read ahead).
+     *
+     * Only recognised by CouchKVStore
+     */
+    uint64_t getCouchstoreCompactionReadaheadSize() const {
+        return couchstoreCompactionReadaheadSize;
+    }
+
+    void setCouchstoreCompactionReadaheadSize(uint64_t bytes) {
+        couchstoreCompactionReadaheadSize = bytes;
+    }
+
+    /**
+     * Whether compactions and scans tell the OS it may drop the cached
+     * pages of what they've read and written, once they're done with them.
+     *
+     * Only recognised by CouchKVStore
+     */
+    bool isCouchstoreDropBehind() const {
+        return couchstoreDropBehind;
+    }
+
+    void setCouchstoreDropBehind(bool enabled) {
+        couchstoreDropBehind = enabled;
+    }
+
+    /**
+     * The number of idle file handles the read-only store keeps open for
+     * the background fetches of the vBuckets (0 = open the file for each).
+     *
+     * Only recognised by CouchKVStore
+     */
+    size_t getCouchstoreFileHandleCacheSize() const {
+        return couchstoreFileHandleCacheSize;
+    }
+
+    void setCouchstoreFileHandleCacheSize(size_t handles) {
+        couchstoreFileHandleCacheSize = handles;
+    }
+
+    /**
+     * The number of bytes the flusher writes to a file between each time
+     * it starts the write-back of what it wrote (0 = the commit writes it
+     * all back).
+     *
+     * Only recognised by CouchKVStore
+     */
+    uint64_t getCouchstoreWritebackSize() const {
+        return couchstoreWritebackSize;
+    }
+
+    void setCouchstoreWritebackSize(uint64_t bytes) {
+        couchstoreWritebackSize = bytes;
+    }
+
 private:
     class ConfigChangeListener;
 
@@ -114,4 +200,22 @@ private:
      * N bytes written.
      */
     uint64_t periodicSyncBytes;
+
+    /// See getBackfillReadaheadSize()
+    uint64_t backfillReadaheadSize;
+
+    /// See getCouchstoreCompactionMinFragmentation()
+    size_t couchstoreCompactionMinFragmentation;
+
+    /// See getCouchstoreCompactionReadaheadSize()
+    uint64_t couchstoreCompactionReadaheadSize;
+
+    /// See isCouchstoreDropBehind()
+    bool couchstoreDropBehind;
+
+    /// See getCouchstoreFileHandleCacheSize()
+    size_t couchstoreFileHandleCacheSize;
+
+    /// See getCouchstoreWritebackSize()
+    uint64_t couchstoreWritebackSize;
 };
@@ -49,17 +49,24 @@ BasicLinkedList::~BasicLinkedList() {
             [this](OrderedStoredValue* v) {
                 this->st.coreLocal.get()->currentSize.fetch_sub(
                         v->metaDataSize());
-                delete v;
+                StoredValue::UniquePtr owned(v);
             });
 
     /* Erase all the list elements (does not destroy elements, just removes
        them from the list) */
     seqList.clear();
+    seqnoIndex.clear();
 }
 
 void BasicLinkedList::appendToList(std::lock_guard<std::mutex>& seqLock,
                                    std::lock_guard<std::mutex>& writeLock,
                                    OrderedStoredValue& v) {
+    if (!v.hasSeqnoHook()) {
+        throw std::logic_error(
+                "BasicLinkedList::appendToList(): " + vbid.to_string() +
+                "; OrderedStoredValue has no SeqnoHook (not created by an "
+                "OrderedStoredValueFactory with seqnoHook)");
+    }
     seqList.push_back(v);
 }
 
@@ -70,15 +77,19 @@ SequenceList::UpdateStatus BasicLinkedList::updateListElem(
     /* Lock that needed for consistent read of SeqRange 'readRange' */
     std::lock_guard<SpinLock> lh(rangeLock);
 
-    if (readRange.fallsInRange(v.getBySeqno())) {
-        /* Range read is in middle of a point-in-time snapshot, hence we cannot
-           move the element to the end of the list. Return a temp failure */
+    if (readRange.fallsInRange(v.getBySeqno()) ||
+        purgeRange.fallsInRange(v.getBySeqno())) {
+        /* Range read is in middle of a point-in-time snapshot (or the purger
+           is iterating over the element), hence we cannot move the element to
+           the end of the list. Return a temp failure */
         return UpdateStatus::Append;
     }
 
     /* Since there is no other reads or writes happenning in this range, we can
        move the item to the end of the list */
     auto it = seqList.iterator_to(v);
+    /* The element gets a new seqno at the end of the list */
+    removeFromSeqnoIndex(v);
     /* If the list is being updated at 'pausedPurgePoint', then we must save
        the new 'pausedPurgePoint' */
     if (pausedPurgePoint == it) {
@@ -102,9 +113,7 @@ BasicLinkedList::rangeRead(seqno_t start, seqno_t end) {
         return std::make_tuple(ENGINE_ERANGE, std::vector<UniqueItemPtr>(), 0);
     }
 
-    /* Allows only 1 rangeRead for now */
-    std::lock_guard<std::mutex> lckGd(rangeReadLock);
-
+    ReadRanges::iterator range;
     {
         std::lock_guard<std::mutex> listWriteLg(getListWriteLock());
         std::lock_guard<SpinLock> lh(rangeLock);
@@ -124,7 +133,7 @@ BasicLinkedList::rangeRead(seqno_t start, seqno_t end) {
         /* Mark the initial read range */
         end = std::min(end, static_cast<seqno_t>(highSeqno));
         end = std::max(end, static_cast<seqno_t>(highestDedupedSeqno));
-        readRange = SeqRange(1, end);
+        range = addReadRange_UNLOCKED(1, end);
     }
 
     /* Read items in the range */
@@ -141,9 +150,7 @@ BasicLinkedList::rangeRead(seqno_t start, seqno_t end) {
 
         {
             std::lock_guard<SpinLock> lh(rangeLock);
-            readRange.setBegin(currSeqno); /* [EPHE TODO]: should we
-                                                     update the min every time ?
-                                                   */
+            setReadRangeBegin_UNLOCKED(range, currSeqno);
         }
 
         if (currSeqno < start) {
@@ -178,15 +185,17 @@ BasicLinkedList::rangeRead(seqno_t start, seqno_t end) {
                     "item with seqno {}before streaming it",
                     vbid,
                     currSeqno);
+            std::lock_guard<SpinLock> lh(rangeLock);
+            removeReadRange_UNLOCKED(range);
             return std::make_tuple(
                     ENGINE_ENOMEM, std::vector<UniqueItemPtr>(), 0);
         }
     }
 
-    /* Done with range read, reset the range */
+    /* Done with range read, remove the range */
     {
         std::lock_guard<SpinLock> lh(rangeLock);
-        readRange.reset();
+        removeReadRange_UNLOCKED(range);
     }
 
     /* Return all the range read items */
@@ -202,6 +211,12 @@ void BasicLinkedList::updateHighSeqno(std::lock_guard<std::mutex>& listWriteLg,
                 std::to_string(v.getBySeqno()) + " which is < 1");
     }
     highSeqno = v.getBySeqno();
+
+    /* Index every SeqnoIndexInterval'th seqno, for range iterators to seek */
+    if (v.getBySeqno() % SeqnoIndexInterval == 0 && !seqList.empty() &&
+        &seqList.back() == &v) {
+        seqnoIndex[v.getBySeqno()] = &seqList.back();
+    }
 }
 void BasicLinkedList::updateHighestDedupedSeqno(
         std::lock_guard<std::mutex>& listWriteLg, const OrderedStoredValue& v) {
@@ -238,15 +253,21 @@ size_t BasicLinkedList::purgeTombstones(
         std::function<bool()> shouldPause) {
     // Purge items marked as stale from the seqList.
     //
-    // Strategy - we try to ensure that this function does not block
-    // frontend-writes (adding new OrderedStoredValues (OSVs) to the seqList).
-    // To achieve this (safely),
-    // we (try to) acquire the rangeReadLock and setup a 'read' range for the
-    // whole of the seqList. This prevents any other readers from iterating
-    // the list (and accessing stale items) while we purge on it; but permits
-    // front-end operations to continue as they:
-    //   a) Only read/modify non-stale items (we only change stale items) and
-    //   b) Do not change the list membership of anything within the read-range.
+    // Strategy - we try to ensure that this function blocks neither
+    // frontend-writes (adding new OrderedStoredValues (OSVs) to the seqList)
+    // nor range reads (backfills). To achieve this (safely):
+    // - We setup a 'purge' range over the part of the seqList we iterate,
+    //   which (like a range read's readRange) stops front-end operations from
+    //   moving the items in it to the end of the list. Front-end operations
+    //   can otherwise continue as they only read/modify non-stale items (we
+    //   only change stale items).
+    // - Range reads can start and run concurrently. A range read only moves
+    //   forward from its begin, so the items before it are never accessed by
+    //   it again; we only remove those, and pause the purge (resuming from
+    //   there on the next run) when we reach the begin of readRange, which is
+    //   the lowest begin of all the range reads in progress. The check and
+    //   the removal are done under the writeLock, which a range read also
+    //   takes to start.
     // However, we do need to be careful about what members of OSVs we access
     // here - the only OSVs we can safely access are ones marked stale as they
     // are no longer in the HashTable (and hence subject to HashTable locks).
@@ -256,13 +277,9 @@ size_t BasicLinkedList::purgeTombstones(
     // release the lock between each element so front-end operations can
     // have the opportunity to acquire it.
     //
-    // Attempt to acquire the readRangeLock, to block anyone else concurrently
-    // reading from the list while we remove elements from it.
-    std::unique_lock<std::mutex> rrGuard(rangeReadLock, std::try_to_lock);
-    if (!rrGuard) {
-        // If we cannot acquire the lock then another thread is
-        // running a range read. Given these are typically long-running,
-        // return without blocking.
+    // Attempt to acquire the purgeLock, only one purge runs at a time.
+    std::unique_lock<std::mutex> purgeGuard(purgeLock, std::try_to_lock);
+    if (!purgeGuard) {
         return 0;
     }
 
@@ -288,9 +305,14 @@ size_t BasicLinkedList::purgeTombstones(
             return 0;
         }
 
-        // Update readRange
+        // Update purgeRange
         std::lock_guard<SpinLock> rangeGuard(rangeLock);
-        readRange = SeqRange(startIt->getBySeqno(), purgeUpToSeqno);
+        if (isInRangeRead_UNLOCKED(startIt->getBySeqno())) {
+            // A range read is yet to pass the start; try again later
+            pausedPurgePoint = startIt;
+            return 0;
+        }
+        purgeRange = SeqRange(startIt->getBySeqno(), purgeUpToSeqno);
     }
 
     // Iterate across all but the last item in the seqList, looking
@@ -305,10 +327,15 @@ size_t BasicLinkedList::purgeTombstones(
 
         {
             // As we move past the items in the list, increment the begin of
-            // 'readRange' to reduce the window of creating stale items during
+            // 'purgeRange' to reduce the window of creating stale items during
             // updates
             std::lock_guard<SpinLock> rangeGuard(rangeLock);
-            readRange.setBegin(it->getBySeqno());
+            if (isInRangeRead_UNLOCKED(it->getBySeqno())) {
+                // Caught up with a range read; resume behind it next time
+                pausedPurgePoint = it;
+                break;
+            }
+            purgeRange.setBegin(it->getBySeqno());
         }
 
         {
@@ -323,8 +350,14 @@ size_t BasicLinkedList::purgeTombstones(
 
         // Only stale or dropped items are purged.
         if (stale || isDropped) {
-            // Checks pass, remove from list and delete.
-            it = purgeListElem(it, stale);
+            // Checks pass, remove from list and delete (unless a range read
+            // has just started over it)
+            auto next = purgeListElem(it, stale);
+            if (!next) {
+                pausedPurgePoint = it;
+                break;
+            }
+            it = *next;
             ++purgedCount;
         } else {
             ++it;
@@ -336,10 +369,10 @@ size_t BasicLinkedList::purgeTombstones(
         }
     }
 
-    // Complete; reset the readRange.
+    // Complete; reset the purgeRange.
     {
         std::lock_guard<SpinLock> lh(rangeLock);
-        readRange.reset();
+        purgeRange.reset();
     }
     return purgedCount;
 }
@@ -401,6 +434,42 @@ std::mutex& BasicLinkedList::getListWriteLock() const {
     return writeLock;
 }
 
+BasicLinkedList::ReadRanges::iterator BasicLinkedList::addReadRange_UNLOCKED(
+        seqno_t begin, seqno_t end) {
+    auto range = readRanges.emplace(readRanges.end(), begin, end);
+    updateReadRange_UNLOCKED();
+    return range;
+}
+
+void BasicLinkedList::setReadRangeBegin_UNLOCKED(ReadRanges::iterator range,
+                                                 seqno_t begin) {
+    const auto prevBegin = range->getBegin();
+    range->setBegin(begin);
+    /* Only the lowest range read moves the begin of readRange */
+    if (prevBegin == readRange.getBegin()) {
+        updateReadRange_UNLOCKED();
+    }
+}
+
+void BasicLinkedList::removeReadRange_UNLOCKED(ReadRanges::iterator range) {
+    readRanges.erase(range);
+    updateReadRange_UNLOCKED();
+}
+
+void BasicLinkedList::updateReadRange_UNLOCKED() {
+    if (readRanges.empty()) {
+        readRange.reset();
+        return;
+    }
+    seqno_t begin = readRanges.front().getBegin();
+    seqno_t end = readRanges.front().getEnd();
+    for (const auto& range : readRanges) {
+        begin = std::min(begin, range.getBegin());
+        end = std::max(end, range.getEnd());
+    }
+    readRange = SeqRange(begin, end);
+}
+
 boost::optional<SequenceList::RangeIterator> BasicLinkedList::makeRangeIterator(
         bool isBackfill) {
     auto pRangeItr = RangeIteratorLL::create(*this, isBackfill);
@@ -427,13 +496,22 @@ std::ostream& operator <<(std::ostream& os, const BasicLinkedList& ll) {
     return os;
 }
 
-OrderedLL::iterator BasicLinkedList::purgeListElem(OrderedLL::iterator it,
-                                                   bool isStale) {
-    StoredValue::UniquePtr purged(&*it);
+boost::optional<OrderedLL::iterator> BasicLinkedList::purgeListElem(
+        OrderedLL::iterator it, bool isStale) {
+    OrderedStoredValue* osv;
     {
         std::lock_guard<std::mutex> lckGd(getListWriteLock());
+        {
+            std::lock_guard<SpinLock> rangeGuard(rangeLock);
+            if (isInRangeRead_UNLOCKED(it->getBySeqno())) {
+                return {};
+            }
+        }
+        osv = &*it;
+        removeFromSeqnoIndex(*it);
         it = seqList.erase(it);
     }
+    StoredValue::UniquePtr purged(osv);
 
     if (isStale) {
         /* Update the stats tracking the memory owned by the list */
@@ -455,35 +533,36 @@ OrderedLL::iterator BasicLinkedList::purgeListElem(OrderedLL::iterator it,
     return it;
 }
 
+void BasicLinkedList::removeFromSeqnoIndex(const OrderedStoredValue& v) {
+    if (v.getBySeqno() % SeqnoIndexInterval != 0) {
+        return;
+    }
+    auto indexed = seqnoIndex.find(v.getBySeqno());
+    if (indexed != seqnoIndex.end() && indexed->second == &v) {
+        seqnoIndex.erase(indexed);
+    }
+}
+
 std::unique_ptr<BasicLinkedList::RangeIteratorLL>
 BasicLinkedList::RangeIteratorLL::create(BasicLinkedList& ll, bool isBackfill) {
     /* Note: cannot use std::make_unique because the constructor of
        RangeIteratorLL is private */
-    std::unique_ptr<BasicLinkedList::RangeIteratorLL> pRangeItr(
+    return std::unique_ptr<BasicLinkedList::RangeIteratorLL>(
             new BasicLinkedList::RangeIteratorLL(ll, isBackfill));
-    return pRangeItr->tryLater() ? nullptr : std::move(pRangeItr);
 }
 
 BasicLinkedList::RangeIteratorLL::RangeIteratorLL(BasicLinkedList& ll,
                                                   bool isBackfill)
     : list(ll),
-      /* Try to get range read lock, do not block */
-      readLockHolder(list.rangeReadLock, std::try_to_lock),
       itrRange(0, 0),
       numRemaining(0),
       earlySnapShotEndSeqno(0),
       isBackfill(isBackfill) {
-    if (!readLockHolder) {
-        /* no blocking */
-        return;
-    }
-
     std::lock_guard<std::mutex> listWriteLg(list.getListWriteLock());
     std::lock_guard<SpinLock> lh(list.rangeLock);
     if (list.highSeqno < 1) {
-        /* No need of holding a lock for the snapshot as there are no items;
+        /* No need of a read range for the snapshot as there are no items;
            Also iterator range is at default (0, 0) */
-        readLockHolder.unlock();
         return;
     }
 
@@ -498,9 +577,10 @@ BasicLinkedList::RangeIteratorLL::RangeIteratorLL(BasicLinkedList& ll,
     earlySnapShotEndSeqno = list.highestDedupedSeqno;
 
     /* Mark the snapshot range on linked list. The range that can be read by the
-       iterator is inclusive of the start and the end. */
-    list.readRange =
-            SeqRange(currIt->getBySeqno(), list.seqList.back().getBySeqno());
+       iterator is inclusive of the start and the end. Other range reads may
+       be in progress; the list protects the union of all their ranges. */
+    readRangeIt = list.addReadRange_UNLOCKED(currIt->getBySeqno(),
+                                             list.seqList.back().getBySeqno());
 
     /* Keep the range in the iterator obj. We store the range end seqno as one
        higher than the end seqno that can be read by this iterator.
@@ -525,16 +605,19 @@ BasicLinkedList::RangeIteratorLL::RangeIteratorLL(BasicLinkedList& ll,
 
 BasicLinkedList::RangeIteratorLL::~RangeIteratorLL() {
     std::lock_guard<SpinLock> lh(list.rangeLock);
-    if (readLockHolder.owns_lock()) {
-        /* we must reset the list readRange only if the list iterator still owns
-           the read lock on the list */
-        list.readRange.reset();
-        auto severity = isBackfill ? spdlog::level::level_enum::info
-                                   : spdlog::level::level_enum::debug;
-        EP_LOG_FMT(severity, "{} Releasing the range iterator", list.vbid);
+    releaseReadRange();
+}
+
+void BasicLinkedList::RangeIteratorLL::releaseReadRange() {
+    if (!readRangeIt) {
+        return;
     }
-    /* As readLockHolder goes out of scope here, it will automatically release
-       the snapshot read lock on the linked list */
+    /* The list protects what the remaining range reads (if any) need */
+    list.removeReadRange_UNLOCKED(*readRangeIt);
+    readRangeIt.reset();
+    auto severity = isBackfill ? spdlog::level::level_enum::info
+                               : spdlog::level::level_enum::debug;
+    EP_LOG_FMT(severity, "{} Releasing the range iterator", list.vbid);
 }
 
 OrderedStoredValue& BasicLinkedList::RangeIteratorLL::operator*() const {
@@ -575,14 +658,10 @@ void BasicLinkedList::RangeIteratorLL::incrOperatorHelper() {
        the last element indicates the end of the iteration */
     if (curr() == itrRange.getEnd() - 1) {
         std::lock_guard<SpinLock> lh(list.rangeLock);
-        /* We reset the range and release the readRange lock here so that any
-           iterator client that does not delete the iterator obj will not end up
-           holding the list readRange lock forever */
-        list.readRange.reset();
-        auto severity = isBackfill ? spdlog::level::level_enum::info
-                                   : spdlog::level::level_enum::debug;
-        EP_LOG_FMT(severity, "{} Releasing the range iterator", list.vbid);
-        readLockHolder.unlock();
+        /* We release the read range here so that any iterator client that does
+           not delete the iterator obj will not end up protecting its range on
+           the list forever */
+        releaseReadRange();
 
         /* Update the begin to end() so the client can see that the iteration
            has ended */
@@ -596,13 +675,48 @@ void BasicLinkedList::RangeIteratorLL::incrOperatorHelper() {
            linked list. This helps reduce the stale items in the list during
            heavy update load from the front end */
         std::lock_guard<SpinLock> lh(list.rangeLock);
-        list.readRange.setBegin(currIt->getBySeqno());
+        list.setReadRangeBegin_UNLOCKED(*readRangeIt, currIt->getBySeqno());
     }
 
     /* Also update the current range stored in the iterator obj */
     itrRange.setBegin(currIt->getBySeqno());
 }
 
+void BasicLinkedList::RangeIteratorLL::seek(seqno_t seqno) {
+    if (seqno <= curr() || curr() >= end()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> listWriteLg(list.getListWriteLock());
+        /* The last indexed element at or before seqno. Any such element ahead
+           of the current position is within the read range, hence it is not
+           moved nor purged while this iterator exists */
+        auto indexed = list.seqnoIndex.upper_bound(seqno);
+        if (indexed == list.seqnoIndex.begin()) {
+            return;
+        }
+        --indexed;
+        if (indexed->first <= curr() || indexed->first >= end()) {
+            return;
+        }
+
+        currIt = list.seqList.iterator_to(*indexed->second);
+        std::lock_guard<SpinLock> lh(list.rangeLock);
+        list.setReadRangeBegin_UNLOCKED(*readRangeIt, indexed->first);
+    }
+    itrRange.setBegin(currIt->getBySeqno());
+
+    /* The items skipped aren't counted; seqnos are unique, so at most
+       end() - curr() items are left */
+    numRemaining = std::min(numRemaining, uint64_t(end() - curr()));
+
+    /* As operator++, don't stop at an item with a newer version in range */
+    if (itrRangeContainsAnUpdatedVersion()) {
+        ++(*this);
+    }
+}
+
 bool BasicLinkedList::RangeIteratorLL::itrRangeContainsAnUpdatedVersion() {
     /* Check if this OSV has been made stale and has been superseded by a
        newer version. If it has, and the replacement is /also/ in the range
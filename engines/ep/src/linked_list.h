@@ -31,14 +31,40 @@
 #include <platform/non_negative_counter.h>
 #include <relaxed_atomic.h>
 
-/* This option will configure "list" to use the member hook */
-using MemberHookOption =
-        boost::intrusive::member_hook<OrderedStoredValue,
-                                      boost::intrusive::list_member_hook<>,
-                                      &OrderedStoredValue::seqno_hook>;
+#include <list>
+#include <map>
 
-/* This list will use the member hook */
-using OrderedLL = boost::intrusive::list<OrderedStoredValue, MemberHookOption>;
+/**
+ * Maps between an OrderedStoredValue and its SeqnoHook, which is held in
+ * front of the object (see OrderedStoredValue::SeqnoHook).
+ */
+struct SeqnoHookFunctor {
+    using hook_type = OrderedStoredValue::SeqnoHook;
+    using hook_ptr = hook_type*;
+    using const_hook_ptr = const hook_type*;
+    using value_type = OrderedStoredValue;
+    using pointer = value_type*;
+    using const_pointer = const value_type*;
+
+    static hook_ptr to_hook_ptr(value_type& value) {
+        return &value.getSeqnoHook();
+    }
+    static const_hook_ptr to_hook_ptr(const value_type& value) {
+        return &value.getSeqnoHook();
+    }
+    static pointer to_value_ptr(hook_ptr hook) {
+        return &OrderedStoredValue::fromSeqnoHook(*hook);
+    }
+    static const_pointer to_value_ptr(const_hook_ptr hook) {
+        return &OrderedStoredValue::fromSeqnoHook(*hook);
+    }
+};
+
+/* This option will configure "list" to use the SeqnoHook */
+using SeqnoHookOption = boost::intrusive::function_hook<SeqnoHookFunctor>;
+
+/* This list will use the SeqnoHook */
+using OrderedLL = boost::intrusive::list<OrderedStoredValue, SeqnoHookOption>;
 
 /**
  * Class that represents a range of sequence numbers.
@@ -110,8 +136,9 @@ private:
  * This class implements SequenceList as a basic doubly linked list.
  * Uses boost intrusive list for doubly linked list implementation.
  *
- * Intrusive hook is to be added to OrderedStoredValue for it to be used in the
- * BasicLinkedList. Once in the BasicLinkedList, OrderedStoredValue is now
+ * Intrusive hook (OrderedStoredValue::SeqnoHook) is to be allocated with the
+ * OrderedStoredValue for it to be used in the BasicLinkedList (see
+ * OrderedStoredValueFactory). Once in the BasicLinkedList, OrderedStoredValue is now
  * shared between HashTable and BasicLinkedList.
  *
  * BasicLinkedList sees only the hook for next and prev; HashTable
@@ -132,20 +159,30 @@ private:
  * Ordering/Hierarchy of Locks:
  * ===========================
  * BasicLinkedList has 3 locks namely:
- * (i) writeLock (ii) rangeLock (iii) rangeReadLock
+ * (i) writeLock (ii) rangeLock (iii) purgeLock
  * Description of each lock can be found below in the class declaration, here
  * we describe in what order the locks should be grabbed
  *
- * rangeReadLock ==> writeLock ==> rangeLock is the valid lock hierarchy.
+ * purgeLock ==> writeLock ==> rangeLock is the valid lock hierarchy.
  *
  * Preferred/Expected Lock Duration:
  * ================================
  * 'writeLock' and 'rangeLock' are held for short durations, typically for
  * single list element writes and reads.
- * 'rangeReadLock' is held for longer duration on the list (for entire range).
+ * 'purgeLock' is held for longer duration on the list (for a purge run).
+ *
+ * Range reads don't take a lock for their duration; any number of them may
+ * be in progress, each registering its own range in 'readRanges'.
  */
 class BasicLinkedList : public SequenceList {
 public:
+    /**
+     * Every element whose seqno is a multiple of this is indexed by seqno (see
+     * seqnoIndex), so that a range iterator can seek to a seqno walking at
+     * most about this many elements (instead of the whole list).
+     */
+    static const seqno_t SeqnoIndexInterval = 1024;
+
     BasicLinkedList(Vbid vbucketId, EPStats& st);
 
     ~BasicLinkedList();
@@ -222,30 +259,51 @@ protected:
      * Used to mark of the range where point-in-time snapshot is happening.
      * To get a valid point-in-time snapshot and for correct list iteration we
      * must not de-duplicate an item in the list in this range.
+     *
+     * This is the smallest range covering all the range reads in progress
+     * (readRanges), kept up to date by updateReadRange_UNLOCKED().
      */
     SeqRange readRange;
 
+    using ReadRanges = std::list<SeqRange>;
+
+    /**
+     * The range of each range read in progress. Each range read moves the
+     * begin of its own range forward as it reads.
+     */
+    ReadRanges readRanges;
+
     /**
-     * Lock that protects readRange.
+     * Lock that protects readRange and readRanges.
      * We use spinlock here since the lock is held only for very small time
      * periods.
      */
     mutable SpinLock rangeLock;
 
     /**
-     * Lock that serializes range reads on the 'seqList' - i.e. serializes
-     * the addition / removal of range reads from the set in-flight.
-     * We need to serialize range reads because, range reads set a list level
-     * range in which items are read. If we have multiple range reads then we
-     * must handle the races in the updation of the range to have most inclusive
-     * range.
-     * For now we use this lock to allow only one range read at a time.
+     * Index of the elements whose seqno is a multiple of SeqnoIndexInterval,
+     * by seqno. An entry is added when such an element is appended (with
+     * updateHighSeqno) and removed when the element is moved or purged, so
+     * each entry is of an element still at that seqno and position in the
+     * list.
      *
-     * It is also additionally used in purgeTombstones() to prevent the
-     * creation of any new rangeReads while purge is in-progress - see
-     * detailed comments there.
+     * Guarded by writeLock.
+     */
+    std::map<seqno_t, OrderedStoredValue*> seqnoIndex;
+
+    /**
+     * The range of the list purgeTombstones() is iterating over, in which (as
+     * in readRange) items must not be moved to the end of the list.
+     *
+     * Guarded by rangeLock.
      */
-    std::mutex rangeReadLock;
+    SeqRange purgeRange{0, 0};
+
+    /**
+     * Serializes purgeTombstones() runs. Range reads may start and run while
+     * the list is purged (see purgeTombstones()).
+     */
+    std::mutex purgeLock;
 
     /* Overall memory consumed by (stale) OrderedStoredValues owned by the
        list */
@@ -256,7 +314,43 @@ protected:
     cb::RelaxedAtomic<size_t> staleMetaDataSize;
 
 private:
-    OrderedLL::iterator purgeListElem(OrderedLL::iterator it, bool isStale);
+    /**
+     * Remove the element from the list and delete it, unless a range read
+     * covers it.
+     *
+     * @return the iterator to the next element, or none if the element is
+     *         in the range of a range read (and so wasn't purged)
+     */
+    boost::optional<OrderedLL::iterator> purgeListElem(OrderedLL::iterator it,
+                                                       bool isStale);
+
+    /**
+     * @return true if a range read in progress may still read the element
+     *         with the given seqno. Expects rangeLock to be held.
+     */
+    bool isInRangeRead_UNLOCKED(seqno_t seqno) const {
+        return readRange.getBegin() > 0 && seqno >= readRange.getBegin();
+    }
+
+    /**
+     * Register a range read of [begin, end]. Expects rangeLock to be held.
+     *
+     * @return the range, for the range read to move its begin forward (with
+     *         setReadRangeBegin_UNLOCKED) and to remove it when done.
+     */
+    ReadRanges::iterator addReadRange_UNLOCKED(seqno_t begin, seqno_t end);
+
+    /// Expects rangeLock to be held
+    void setReadRangeBegin_UNLOCKED(ReadRanges::iterator range, seqno_t begin);
+
+    /// Expects rangeLock to be held
+    void removeReadRange_UNLOCKED(ReadRanges::iterator range);
+
+    /// Recompute readRange from readRanges. Expects rangeLock to be held.
+    void updateReadRange_UNLOCKED();
+
+    /// Remove the element from seqnoIndex (if indexed). Expects writeLock.
+    void removeFromSeqnoIndex(const OrderedStoredValue& v);
 
     /**
      * We need to keep track of the highest seqno separately because there is a
@@ -316,17 +410,15 @@ private:
     class RangeIteratorLL : public SequenceList::RangeIteratorImpl {
     public:
         /**
-         * Method to create instances of RangeIteratorLL. We only
-         * allow one RangeIteratorLL object to exist at any one time,
-         * hence creation can fail and that's why object creation is via a
-         * public method and not constructor.
+         * Method to create instances of RangeIteratorLL. Any number of
+         * RangeIteratorLL objects may exist at a time, each protecting its
+         * own range of the list.
          *
          * @param ll ref to the linkedlist on which the iterator is created
          * @param isBackfill indicates if the iterator is for backfill (for
          *                   debug)
          *
-         * @return Non-null pointer on success, or null if a RangeIteratorLL
-         *         already exists.
+         * @return Non-null pointer
          */
         static std::unique_ptr<RangeIteratorLL> create(BasicLinkedList& ll,
                                                        bool isBackfill);
@@ -360,22 +452,16 @@ private:
             return earlySnapShotEndSeqno;
         }
 
+        /* Jumps to the last indexed element (see seqnoIndex) at or before
+           seqno, if that is ahead of the current position */
+        void seek(seqno_t seqno) override;
+
     private:
-        /* We have a private constructor because we want to create the iterator
-           optionally, that is, only when it is possible to get a read lock */
+        /* Objects are created with create() */
         RangeIteratorLL(BasicLinkedList& ll, bool isBackfill);
 
-        /**
-         * Indicates if the client should try creating the iterator at a later
-         * point.
-         *
-         * @return true: iterator should be created later again
-         *         false: iterator created successfully
-         */
-        bool tryLater() const {
-            /* could not lock and the list has items */
-            return (!readLockHolder && (list.getHighSeqno() > 0));
-        }
+        /* Remove the range of this iterator from the list, if not done yet */
+        void releaseReadRange();
 
         /**
          * Helps to increment the iterator. Moves the iterator to the next
@@ -399,8 +485,9 @@ private:
         /* The current list element pointed by the iterator */
         OrderedLL::iterator currIt;
 
-        /* Lock holder which allows having only one iterator at a time */
-        std::unique_lock<std::mutex> readLockHolder;
+        /* The range of this iterator registered on the list (in
+           list.readRanges), none once the iteration is done */
+        boost::optional<ReadRanges::iterator> readRangeIt;
 
         /* Current range of the iterator */
         SeqRange itrRange;
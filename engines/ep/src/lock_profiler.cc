@@ -0,0 +1,139 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "lock_profiler.h"
+#include "statwriter.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <vector>
+
+LockProfile::LockProfile(const char* name, const std::atomic<bool>& enabled)
+    : name(name), enabled(enabled) {
+}
+
+void LockProfile::recordWait(std::chrono::steady_clock::duration wait,
+                             const char* site) {
+    ++contended;
+    waitHisto.add(std::chrono::duration_cast<std::chrono::microseconds>(wait));
+    auto* entry = getSite(site);
+    if (entry) {
+        ++entry->contended;
+        entry->waitNs +=
+                std::chrono::duration_cast<std::chrono::nanoseconds>(wait)
+                        .count();
+    }
+}
+
+LockProfile::Site* LockProfile::getSite(const char* site) {
+    for (auto& entry : sites) {
+        auto* current = entry.name.load(std::memory_order_acquire);
+        if (current == nullptr) {
+            // Claim the free entry; if another thread beat us to it, it may
+            // have claimed it for this same site.
+            if (entry.name.compare_exchange_strong(current, site)) {
+                return &entry;
+            }
+        }
+        // The same function may be named by different string literals in
+        // different translation units, so fall back to comparing the names.
+        if (current == site || std::strcmp(current, site) == 0) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+void LockProfile::addStats(const AddStatFn& add_stat,
+                           const void* cookie) const {
+    const std::string prefix = std::string(name) + ":";
+    add_casted_stat((prefix + "acquisitions").c_str(),
+                    acquisitions.load(),
+                    add_stat,
+                    cookie);
+    add_casted_stat(
+            (prefix + "contended").c_str(), contended.load(), add_stat, cookie);
+    add_casted_stat((prefix + "wait").c_str(), waitHisto, add_stat, cookie);
+    add_casted_stat((prefix + "held").c_str(), heldHisto, add_stat, cookie);
+
+    // {wait ns, contended, site} of the call sites which waited longest.
+    std::vector<std::tuple<uint64_t, uint64_t, const char*>> top;
+    for (const auto& entry : sites) {
+        const auto* site = entry.name.load(std::memory_order_acquire);
+        if (site == nullptr) {
+            break;
+        }
+        if (entry.contended.load() > 0) {
+            top.emplace_back(entry.waitNs.load(), entry.contended.load(), site);
+        }
+    }
+    std::sort(top.begin(), top.end(), [](const auto& a, const auto& b) {
+        return std::get<0>(a) > std::get<0>(b);
+    });
+    if (top.size() > ReportedSites) {
+        top.resize(ReportedSites);
+    }
+    for (const auto& site : top) {
+        const auto sitePrefix = prefix + "site:" + std::get<2>(site) + ":";
+        add_casted_stat((sitePrefix + "contended").c_str(),
+                        std::get<1>(site),
+                        add_stat,
+                        cookie);
+        add_casted_stat((sitePrefix + "wait_us").c_str(),
+                        std::get<0>(site) / 1000,
+                        add_stat,
+                        cookie);
+    }
+}
+
+void LockProfile::reset() {
+    acquisitions.store(0);
+    contended.store(0);
+    waitHisto.reset();
+    heldHisto.reset();
+    // The site names are string literals and stay claimed, only their counts
+    // are cleared (racing lookups may still be using the entries).
+    for (auto& entry : sites) {
+        entry.contended.store(0);
+        entry.waitNs.store(0);
+    }
+}
+
+LockProfiler::LockProfiler()
+    : profiles{{{"hash_table", enabled},
+                {"checkpoint_queue", enabled},
+                {"dcp_stream", enabled},
+                {"dcp_checkpoint_creator", enabled}}} {
+    static_assert(size_t(Lock::NumLocks) == 4,
+                  "LockProfiler: a name is needed for each Lock");
+}
+
+void LockProfiler::addStats(const AddStatFn& add_stat,
+                            const void* cookie) const {
+    add_casted_stat("enabled", isEnabled(), add_stat, cookie);
+    for (const auto& profile : profiles) {
+        profile.addStats(add_stat, cookie);
+    }
+}
+
+void LockProfiler::reset() {
+    for (auto& profile : profiles) {
+        profile.reset();
+    }
+}
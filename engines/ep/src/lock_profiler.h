@@ -0,0 +1,212 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include "hdrhistogram.h"
+#include "locks.h"
+
+#include <memcached/engine_common.h>
+#include <relaxed_atomic.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+/**
+ * LOCK_PROFILER_SITE names the function acquiring a profiled lock. Used as
+ * a default argument it evaluates to the name of the calling function.
+ */
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_FUNCTION)
+#define LOCK_PROFILER_SITE __builtin_FUNCTION()
+#endif
+#elif defined(__GNUC__)
+#define LOCK_PROFILER_SITE __builtin_FUNCTION()
+#endif
+#ifndef LOCK_PROFILER_SITE
+#define LOCK_PROFILER_SITE "unknown"
+#endif
+
+/**
+ * Contention statistics of one class of lock (e.g. all of the HashTable
+ * bucket locks of a bucket): how often the locks are acquired and how often
+ * that has to wait, histograms of the wait and hold times, and the call
+ * sites which waited for longest.
+ *
+ * Nothing is recorded unless the owning LockProfiler is enabled; when it is
+ * an uncontended acquisition costs a try_lock and two clock reads (for the
+ * hold time).
+ */
+class LockProfile {
+public:
+    LockProfile(const char* name, const std::atomic<bool>& enabled);
+
+    bool isEnabled() const {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Acquire the mutex, recording the acquisition (and if the mutex was
+     * already locked, the wait and the call site).
+     *
+     * @return the time the lock was acquired if profiling is enabled,
+     *         otherwise a default constructed time_point
+     */
+    template <typename Mutex>
+    std::chrono::steady_clock::time_point lock(Mutex& mutex, const char* site) {
+        if (!isEnabled()) {
+            mutex.lock();
+            return {};
+        }
+        ++acquisitions;
+        if (mutex.try_lock()) {
+            return std::chrono::steady_clock::now();
+        }
+        const auto start = std::chrono::steady_clock::now();
+        mutex.lock();
+        const auto acquired = std::chrono::steady_clock::now();
+        recordWait(acquired - start, site);
+        return acquired;
+    }
+
+    /**
+     * Record the time a lock acquired by lock() was held for.
+     *
+     * @param acquired the time returned by lock()
+     */
+    void recordHeld(std::chrono::steady_clock::time_point acquired) {
+        if (acquired != std::chrono::steady_clock::time_point{}) {
+            heldHisto.add(std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - acquired));
+        }
+    }
+
+    void addStats(const AddStatFn& add_stat, const void* cookie) const;
+
+    void reset();
+
+    /// The number of distinct call sites tracked per lock class
+    static constexpr size_t MaxSites = 64;
+
+    /// The number of (most contended) call sites reported by addStats
+    static constexpr size_t ReportedSites = 10;
+
+private:
+    struct Site {
+        std::atomic<const char*> name{nullptr};
+        cb::RelaxedAtomic<uint64_t> contended{0};
+        cb::RelaxedAtomic<uint64_t> waitNs{0};
+    };
+
+    void recordWait(std::chrono::steady_clock::duration wait,
+                    const char* site);
+
+    /// Find (or add) the entry of the call site; nullptr if the table is full
+    Site* getSite(const char* site);
+
+    const char* const name;
+    const std::atomic<bool>& enabled;
+
+    cb::RelaxedAtomic<uint64_t> acquisitions{0};
+    cb::RelaxedAtomic<uint64_t> contended{0};
+    Hdr1sfMicroSecHistogram waitHisto;
+    Hdr1sfMicroSecHistogram heldHisto;
+    std::array<Site, MaxSites> sites;
+};
+
+/**
+ * The opt-in lock contention profiler of a bucket (lock_profiling_enabled),
+ * holding a LockProfile for each class of lock it covers. The statistics
+ * are exposed through the "lock-profile" stat group.
+ */
+class LockProfiler {
+public:
+    /// The classes of lock which are profiled
+    enum class Lock {
+        HashTable,
+        CheckpointQueue,
+        DcpStream,
+        DcpCheckpointCreator,
+        NumLocks
+    };
+
+    LockProfiler();
+
+    void setEnabled(bool value) {
+        enabled.store(value, std::memory_order_relaxed);
+    }
+
+    bool isEnabled() const {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    LockProfile& get(Lock lock) {
+        return profiles[size_t(lock)];
+    }
+
+    void addStats(const AddStatFn& add_stat, const void* cookie) const;
+
+    void reset();
+
+private:
+    std::atomic<bool> enabled{false};
+    std::array<LockProfile, size_t(Lock::NumLocks)> profiles;
+};
+
+/**
+ * A LockHolder (std::lock_guard<std::mutex>) which records the acquisition
+ * and hold time of the mutex in a LockProfile. It converts to a LockHolder
+ * reference, so may be passed to the functions which take one as proof the
+ * lock is held.
+ *
+ *   LockHolder lh(mutex);
+ *
+ * becomes:
+ *
+ *   ProfiledLockHolder lh(mutex, stats.lockProfiler.get(Lock::...));
+ */
+class ProfiledLockHolder {
+public:
+    ProfiledLockHolder(std::mutex& mutex,
+                       LockProfile& profile,
+                       const char* site = LOCK_PROFILER_SITE)
+        : profile(profile),
+          acquired(profile.lock(mutex, site)),
+          holder(mutex, std::adopt_lock) {
+    }
+
+    ~ProfiledLockHolder() {
+        profile.recordHeld(acquired);
+    }
+
+    operator LockHolder&() {
+        return holder;
+    }
+
+    operator const LockHolder&() const {
+        return holder;
+    }
+
+private:
+    LockProfile& profile;
+    const std::chrono::steady_clock::time_point acquired;
+    LockHolder holder;
+
+    DISALLOW_COPY_AND_ASSIGN(ProfiledLockHolder);
+};
@@ -666,7 +666,8 @@ StorageProperties MagmaKVStore::getStorageProperties() {
                          StorageProperties::EfficientVBDeletion::Yes,
                          StorageProperties::PersistedDeletion::No,
                          StorageProperties::EfficientGet::Yes,
-                         StorageProperties::ConcurrentWriteCompact::Yes);
+                         StorageProperties::ConcurrentWriteCompact::Yes,
+                         StorageProperties::KeyOrderScan::No);
     return rv;
 }
 
@@ -1072,6 +1073,11 @@ scan_error_t MagmaKVStore::scan(ScanContext* ctx) {
     }
     (void)startSeqno;
 
+    // TODO MAGMA: when the seqno iterator is wired up here, a KEYS_ONLY scan
+    // must build its items from the key and metadata slices alone
+    // (makeItem(..., GetMetaOnly::Yes)), so that values separated out of the
+    // index (see magma_value_separation_size) aren't read.
+
     return scan_success;
 }
 
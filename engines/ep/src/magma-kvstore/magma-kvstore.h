@@ -184,8 +184,9 @@ public:
             Vbid vbid,
             const DiskDocKey& start_key,
             uint32_t count,
-            std::shared_ptr<Callback<const DiskDocKey&>> cb) override {
-        // TODO 2018-10-9 need to implement
+            std::shared_ptr<StatusCallback<const DiskDocKey&>> cb) override {
+        // TODO 2018-10-9 need to implement. Only the keys are needed, so
+        // (as a KEYS_ONLY scan) this shouldn't read any separated values.
         return ENGINE_SUCCESS;
     }
 
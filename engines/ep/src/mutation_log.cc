@@ -16,10 +16,13 @@
  */
 
 #include <fcntl.h>
+#include <gsl/gsl>
+#include <platform/compress.h>
 #include <platform/dirutils.h>
 #include <platform/strerror.h>
 #include <sys/stat.h>
 #include <algorithm>
+#include <limits>
 #include <string>
 #include <system_error>
 #include <utility>
@@ -32,6 +35,10 @@ extern "C" {
 #include "kv_bucket.h"
 #include "mutation_log.h"
 
+#ifndef WIN32
+#include <sys/mman.h>
+#endif
+
 #ifdef WIN32
 ssize_t pread(file_handle_t fd, void *buf, size_t nbyte, uint64_t offset)
 {
@@ -251,8 +258,12 @@ static bool writeFully(file_handle_t fd, const uint8_t *buf, size_t nbytes) {
     return true;
 }
 
-MutationLog::MutationLog(const std::string& path, const size_t bs)
-    : logPath(path),
+MutationLog::MutationLog(const std::string& path,
+                         const size_t bs,
+                         MutationLogVersion version)
+    : headerBlock(version),
+      writeVersion(version),
+      logPath(path),
       blockSize(bs),
       blockPos(HEADER_RESERVED),
       file(INVALID_FILE_VALUE),
@@ -262,6 +273,12 @@ MutationLog::MutationLog(const std::string& path, const size_t bs)
       blockBuffer(new uint8_t[bs]()),
       syncConfig(DEFAULT_SYNC_CONF),
       readOnly(false) {
+    if (version != MutationLogVersion::V3 &&
+        version != MutationLogVersion::V4) {
+        throw std::invalid_argument(
+                "MutationLog::MutationLog: cannot write version " +
+                std::to_string(int(version)));
+    }
     for (int ii = 0; ii < int(MutationLogType::NumberOfTypes); ++ii) {
         itemsLogged[ii].store(0);
     }
@@ -298,6 +315,14 @@ void MutationLog::newItem(Vbid vbucket, const StoredDocKey& key) {
     }
 }
 
+void MutationLog::evictedItem(Vbid vbucket, const StoredDocKey& key) {
+    if (isEnabled()) {
+        MutationLogEntry* mle = MutationLogEntry::newEntry(
+                entryBuffer.get(), MutationLogType::Evicted, vbucket, key);
+        writeEntry(mle);
+    }
+}
+
 void MutationLog::sync() {
     if (!isOpen()) {
         throw std::logic_error("MutationLog::sync: Not valid on a closed log");
@@ -354,6 +379,7 @@ bool MutationLog::writeInitialBlock() {
         throw std::logic_error("MutationLog::writeInitialBlock: Not valid on "
                                "a closed log");
     }
+    headerBlock = LogHeaderBlock(writeVersion);
     headerBlock.set(blockSize);
 
     if (!writeFully(file, (uint8_t*)&headerBlock, sizeof(headerBlock))) {
@@ -402,6 +428,7 @@ void MutationLog::readInitialBlock() {
     case MutationLogVersion::V1:
     case MutationLogVersion::V2:
     case MutationLogVersion::V3:
+    case MutationLogVersion::V4:
         break;
     default: {
         std::stringstream ss;
@@ -450,6 +477,17 @@ bool MutationLog::prepareWrites() {
             throw std::logic_error("MutationLog::prepareWrites: Not valid on "
                                    "a closed log");
         }
+        if (headerBlock.version() == MutationLogVersion::V4) {
+            // Append after the last valid block, dropping any partially
+            // written one
+            const auto end = loadBlockIndex();
+            if (SeekFile(file, getLogFile(), end, false) < 0) {
+                return false;
+            }
+            logSize = static_cast<size_t>(end);
+            return true;
+        }
+
         int64_t seek_result = SeekFile(file, getLogFile(), 0, true);
         if (seek_result < 0) {
             return false;
@@ -591,10 +629,126 @@ void MutationLog::close() {
         updateInitialBlock();
     }
 
+#ifndef WIN32
+    if (mapping) {
+        munmap(mapping, mappingSize);
+        mapping = nullptr;
+        mappingSize = 0;
+    }
+#endif
+
     doClose(file);
     file = INVALID_FILE_VALUE;
 }
 
+uint64_t MutationLog::loadBlockIndex() {
+    blockIndex.clear();
+    const uint64_t headerSize =
+            std::max(static_cast<uint64_t>(MIN_LOG_HEADER_SIZE),
+                     uint64_t(headerBlock.blockSize()) *
+                             headerBlock.blockCount());
+    uint64_t size;
+    try {
+        size = getFileSize(file);
+    } catch (std::system_error& e) {
+        throw ReadException(e.what());
+    }
+
+    // Only the headers are read here; the checksums of the blocks are
+    // verified as the blocks are read
+    uint64_t offset = headerSize;
+    while (offset + sizeof(LogBlockHeaderV4) <= size) {
+        LogBlockHeaderV4 header;
+        if (readFrom(reinterpret_cast<uint8_t*>(&header),
+                     sizeof(header),
+                     offset) != ssize_t(sizeof(header))) {
+            break;
+        }
+        const uint64_t next =
+                offset + sizeof(header) + header.compressedLen();
+        if (!header.isValid() || header.entries() == 0 ||
+            header.uncompressedLen() > headerBlock.blockSize() ||
+            next > size) {
+            break;
+        }
+        blockIndex.push_back({offset, header.firstVb(), header.lastVb()});
+        offset = next;
+    }
+
+    if (offset < size) {
+        EP_LOG_WARN(
+                "WARNING: ignoring {} bytes after the last valid block of "
+                "'{}'",
+                size - offset,
+                getLogFile());
+    }
+    return std::max(offset, headerSize);
+}
+
+ssize_t MutationLog::readFrom(uint8_t* dest,
+                              size_t len,
+                              uint64_t offset) const {
+    // Anything written after the log was mapped is read with pread
+    if (mapping && offset + len <= mappingSize) {
+        std::copy_n(mapping + offset, len, dest);
+        return len;
+    }
+    return pread(file, dest, len, offset);
+}
+
+size_t MutationLog::getNumBlocks() const {
+    if (!isEnabled() || !isOpen()) {
+        return 0;
+    }
+    if (headerBlock.version() == MutationLogVersion::V4) {
+        return blockIndex.size();
+    }
+    const size_t bs = headerBlock.blockSize();
+    const size_t headerSize = bs * headerBlock.blockCount();
+    const size_t size = mapping ? mappingSize : size_t(getFileSize(file));
+    return size > headerSize ? (size - headerSize) / bs : 0;
+}
+
+bool MutationLog::mapForReading() {
+#ifdef WIN32
+    return false;
+#else
+    if (!isEnabled() || !isOpen()) {
+        return false;
+    }
+    if (mapping) {
+        return true;
+    }
+
+    int64_t size;
+    try {
+        size = getFileSize(file);
+    } catch (std::system_error& e) {
+        EP_LOG_WARN("MutationLog::mapForReading: '{}': {}",
+                    getLogFile(),
+                    e.what());
+        return false;
+    }
+    if (size <= 0) {
+        return false;
+    }
+
+    void* addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, file, 0);
+    if (addr == MAP_FAILED) {
+        EP_LOG_WARN("MutationLog::mapForReading: mmap of '{}' failed: {}",
+                    getLogFile(),
+                    strerror(errno));
+        return false;
+    }
+    // The whole log is about to be read; start reading it in
+    (void)madvise(addr, size, MADV_WILLNEED);
+
+    mapping = static_cast<uint8_t*>(addr);
+    mappingSize = size_t(size);
+    return true;
+#endif
+}
+
 bool MutationLog::reset() {
     if (!isEnabled()) {
         return false;
@@ -662,6 +816,10 @@ bool MutationLog::flush() {
         needWriteAccess();
         HdrMicroSecBlockTimer timer(&flushTimeHisto);
 
+        if (headerBlock.version() == MutationLogVersion::V4) {
+            return flushV4();
+        }
+
         if (blockPos < blockSize) {
             size_t padding(blockSize - blockPos);
             memset(blockBuffer.get() + blockPos, 0x00, padding);
@@ -689,6 +847,98 @@ bool MutationLog::flush() {
     return true;
 }
 
+bool MutationLog::flushV4() {
+    // The entries of the block are after the reserved bytes
+    const size_t uncompressedLen = blockPos - HEADER_RESERVED;
+    cb::compression::Buffer deflated;
+    if (!cb::compression::deflate(
+                cb::compression::Algorithm::Snappy,
+                {reinterpret_cast<const char*>(blockBuffer.get() +
+                                               HEADER_RESERVED),
+                 uncompressedLen},
+                deflated)) {
+        disabled = true;
+        EP_LOG_WARN("Disabling access log due to compression failures");
+        return false;
+    }
+
+    LogBlockHeaderV4 header(gsl::narrow<uint32_t>(deflated.size()),
+                            gsl::narrow<uint32_t>(uncompressedLen),
+                            entries,
+                            blockFirstVb,
+                            blockLastVb);
+    std::vector<uint8_t> record(sizeof(header) + deflated.size());
+    std::copy_n(reinterpret_cast<const uint8_t*>(&header),
+                sizeof(header),
+                record.data());
+    std::copy_n(deflated.data(),
+                deflated.size(),
+                record.data() + sizeof(header));
+    header.setCrc(crc32buf(record.data() + sizeof(uint32_t),
+                           record.size() - sizeof(uint32_t)));
+    std::copy_n(reinterpret_cast<const uint8_t*>(&header),
+                sizeof(uint32_t),
+                record.data());
+
+    if (!writeFully(file, record.data(), record.size())) {
+        /* write to the mutation log failed. Disable the log */
+        disabled = true;
+        EP_LOG_WARN("Disabling access log due to write failures");
+        return false;
+    }
+
+    blockIndex.push_back({logSize, blockFirstVb, blockLastVb});
+    logSize.fetch_add(record.size());
+    blockPos = HEADER_RESERVED;
+    entries = 0;
+    blockPrevKey.clear();
+    blockFirstVb = std::numeric_limits<uint16_t>::max();
+    blockLastVb = 0;
+    return true;
+}
+
+void MutationLog::writeEntryV4(const MutationLogEntry& mle) {
+    const auto& key = mle.key();
+    // The length of the prefix shared with the previous key of the block
+    auto sharedLen = [this, &key]() {
+        const auto len = std::min(blockPrevKey.size(), key.size());
+        return size_t(std::mismatch(key.data(),
+                                    key.data() + len,
+                                    blockPrevKey.begin())
+                              .first -
+                      key.data());
+    };
+
+    size_t shared = sharedLen();
+    if (blockPos + LOG_ENTRY_V4_HEADER_SIZE + key.size() - shared >
+                blockSize ||
+        entries == std::numeric_limits<uint16_t>::max()) {
+        flush();
+        shared = 0;
+    }
+
+    auto* ptr = blockBuffer.get() + blockPos;
+    const uint16_t vbid = mle.vbucket().get();
+    ptr[0] = uint8_t(mle.type());
+    ptr[1] = uint8_t(vbid >> 8);
+    ptr[2] = uint8_t(vbid & 0xff);
+    ptr[3] = uint8_t(shared);
+    ptr[4] = uint8_t(key.size() - shared);
+    std::copy(key.data() + shared,
+              key.data() + key.size(),
+              ptr + LOG_ENTRY_V4_HEADER_SIZE);
+    blockPos += LOG_ENTRY_V4_HEADER_SIZE + key.size() - shared;
+    ++entries;
+
+    blockPrevKey.assign(key.data(), key.data() + key.size());
+    // The commits don't belong to a vbucket
+    if (mle.type() == MutationLogType::New ||
+        mle.type() == MutationLogType::Evicted) {
+        blockFirstVb = std::min(blockFirstVb, vbid);
+        blockLastVb = std::max(blockLastVb, vbid);
+    }
+}
+
 void MutationLog::writeEntry(MutationLogEntry *mle) {
     if (mle->len() >= blockSize) {
         throw std::invalid_argument("MutationLog::writeEntry: argument mle "
@@ -706,6 +956,12 @@ void MutationLog::writeEntry(MutationLogEntry *mle) {
     }
     needWriteAccess();
 
+    if (headerBlock.version() == MutationLogVersion::V4) {
+        writeEntryV4(*mle);
+        ++itemsLogged[int(mle->type())];
+        return;
+    }
+
     size_t len(mle->len());
     if (blockPos + len > blockSize) {
         flush();
@@ -728,18 +984,38 @@ MutationLog::iterator::iterator(const MutationLog* l, bool e)
       buf(log->header().blockSize()),
       p(buf.begin()),
       offset(l->header().blockSize() * l->header().blockCount()),
+      endOffset(std::numeric_limits<off_t>::max()),
       items(0),
       isEnd(e) {
 }
 
+void MutationLog::iterator::setBlockRange(size_t firstBlock,
+                                          size_t lastBlock) {
+    if (log->header().version() == MutationLogVersion::V4) {
+        block = firstBlock;
+        endBlock = lastBlock;
+        return;
+    }
+    const off_t headerSize =
+            log->header().blockSize() * log->header().blockCount();
+    offset = headerSize + off_t(firstBlock) * log->header().blockSize();
+    endOffset = headerSize + off_t(lastBlock) * log->header().blockSize();
+}
+
 MutationLog::iterator::iterator(const MutationLog::iterator& mit)
     : log(mit.log),
       entryBuf(mit.entryBuf),
       buf(mit.buf),
       p(buf.begin() + (mit.p - mit.buf.begin())),
       offset(mit.offset),
+      endOffset(mit.endOffset),
       items(mit.items),
-      isEnd(mit.isEnd) {
+      isEnd(mit.isEnd),
+      block(mit.block),
+      endBlock(mit.endBlock),
+      vbuckets(mit.vbuckets),
+      compressed(mit.compressed),
+      prevKey(mit.prevKey) {
 }
 
 MutationLog::iterator& MutationLog::iterator::operator=(const MutationLog::iterator& other)
@@ -749,8 +1025,14 @@ MutationLog::iterator& MutationLog::iterator::operator=(const MutationLog::itera
     buf = other.buf;
     p = buf.begin() + (other.p - other.buf.begin());
     offset = other.offset;
+    endOffset = other.endOffset;
     items = other.items;
     isEnd = other.isEnd;
+    block = other.block;
+    endBlock = other.endBlock;
+    vbuckets = other.vbuckets;
+    compressed = other.compressed;
+    prevKey = other.prevKey;
 
     return *this;
 }
@@ -779,11 +1061,41 @@ void MutationLog::iterator::prepItem() {
                 MutationLogEntryV3::newEntry(p, bufferBytesRemaining())->len();
         break;
     }
+    case MutationLogVersion::V4:
+        prepItemV4();
+        return;
     }
 
     std::copy_n(p, copyLen, entryBuf.begin());
 }
 
+void MutationLog::iterator::prepItemV4() {
+    const size_t remaining = bufferBytesRemaining();
+    if (remaining < LOG_ENTRY_V4_HEADER_SIZE) {
+        throw ReadException("MutationLog::iterator::prepItemV4: truncated "
+                            "entry");
+    }
+    const auto type = MutationLogType(p[0]);
+    const Vbid vbid(uint16_t(p[1] << 8 | p[2]));
+    const size_t shared = p[3];
+    const size_t suffix = p[4];
+    if (type >= MutationLogType::NumberOfTypes || shared > prevKey.size() ||
+        LOG_ENTRY_V4_HEADER_SIZE + suffix > remaining ||
+        shared + suffix == 0) {
+        throw ReadException("MutationLog::iterator::prepItemV4: invalid "
+                            "entry");
+    }
+
+    prevKey.resize(shared);
+    const auto keyStart = p + LOG_ENTRY_V4_HEADER_SIZE;
+    prevKey.insert(prevKey.end(), keyStart, keyStart + suffix);
+    MutationLogEntryV3::newEntry(
+            entryBuf.data(),
+            type,
+            vbid,
+            {prevKey.data(), prevKey.size(), DocKeyEncodesCollectionId::Yes});
+}
+
 size_t MutationLog::iterator::getCurrentEntryLen() const {
     switch (log->headerBlock.version()) {
     case MutationLogVersion::V1: {
@@ -798,6 +1110,9 @@ size_t MutationLog::iterator::getCurrentEntryLen() const {
         return MutationLogEntryV3::newEntry(entryBuf.begin(), entryBuf.size())
                 ->len();
     }
+    case MutationLogVersion::V4:
+        // The length of the encoded entry (in the block)
+        return LOG_ENTRY_V4_HEADER_SIZE + p[4];
     }
     throw std::logic_error(
             "MutationLog::iterator::getCurrentEntryLen unknown version " +
@@ -856,16 +1171,12 @@ MutationLog::MutationLogEntryHolder MutationLog::iterator::upgradeEntry()
         mleV2 = MutationLogEntryV2::newEntry(entryBuf.begin(), entryBuf.size());
         break;
     }
-    /* If V4 exists then add a case for V3, for example:
-    case MutationLogVersion::V3: {
-        mleV3 = MutationLogEntryV3::newEntry(entryBuf.begin(), entryBuf.size());
-        break;
-    }
-    */
-    case MutationLogVersion::Current: {
+    // V4 logs store V3 entries (in compressed blocks)
+    case MutationLogVersion::V3:
+    case MutationLogVersion::V4: {
         throw std::invalid_argument(
                 "MutationLog::iterator::upgradeEntry cannot"
-                " upgrade if version == current");
+                " upgrade if the entries are current");
     }
     }
 
@@ -907,21 +1218,11 @@ MutationLog::MutationLogEntryHolder MutationLog::iterator::upgradeEntry()
         (void)new (allocated.get()) MutationLogEntryV3(*mleV2);
         // If adding more cases, we should assign the above "new" pointer to a
         // mleV3 and allow the next case to read it.
-
-        // fall through
+        break;
     }
-        /* If V4 exists then add a case (which is hit by V3 falling through)
-        case MutationLogVersion::V4: {
-            // Upgrade V3 to V4
-            // Alloc a buffer using the length read from V3 as input to V4::len
-            allocated = std::make_unique<uint8_t[]>(
-                    MutationLogEntryV4::len(mleV3->getKeylen()));
-
-            // Now in-place construct into the new buffer and assign to mleV4
-            mleV4 = new (allocated.get()) MutationLogEntryV3(*mleV3);
-            // fall through
-        }
-        */
+    case MutationLogVersion::V4:
+        // V4 didn't change the layout of the entries
+        break;
     }
 
     // transfer ownership to the MutationLogEntryHolder and mark that it's
@@ -931,7 +1232,7 @@ MutationLog::MutationLogEntryHolder MutationLog::iterator::upgradeEntry()
 
 MutationLog::MutationLogEntryHolder MutationLog::iterator::operator*() {
     // If the file version is down-level return an upgraded entry
-    if (log->headerBlock.version() != MutationLogVersion::Current) {
+    if (log->headerBlock.version() < MutationLogVersion::V3) {
         return upgradeEntry();
     } else {
         return {entryBuf.data(), false /*not allocated*/};
@@ -948,7 +1249,17 @@ void MutationLog::iterator::nextBlock() {
                 "log is enabled and not open");
     }
 
-    ssize_t bytesread = pread(log->fd(), buf.data(), buf.size(), offset);
+    if (log->header().version() == MutationLogVersion::V4) {
+        nextBlockV4();
+        return;
+    }
+
+    if (offset >= endOffset) {
+        isEnd = true;
+        return;
+    }
+
+    ssize_t bytesread = log->readFrom(buf.data(), buf.size(), offset);
     if (bytesread < 1) {
         isEnd = true;
         return;
@@ -986,6 +1297,58 @@ void MutationLog::iterator::nextBlock() {
     prepItem();
 }
 
+void MutationLog::iterator::nextBlockV4() {
+    const auto& index = log->blockIndex;
+    const BlockInfo* info = nullptr;
+    while (block < std::min(endBlock, index.size())) {
+        const auto& candidate = index[block++];
+        if (vbuckets == nullptr || candidate.hasAnyOf(*vbuckets)) {
+            info = &candidate;
+            break;
+        }
+    }
+    if (info == nullptr) {
+        isEnd = true;
+        return;
+    }
+
+    LogBlockHeaderV4 header;
+    if (log->readFrom(reinterpret_cast<uint8_t*>(&header),
+                      sizeof(header),
+                      info->offset) != ssize_t(sizeof(header))) {
+        throw ShortReadException();
+    }
+    compressed.resize(sizeof(header) + header.compressedLen());
+    if (log->readFrom(compressed.data(), compressed.size(), info->offset) !=
+        ssize_t(compressed.size())) {
+        throw ShortReadException();
+    }
+    if (crc32buf(compressed.data() + sizeof(uint32_t),
+                 compressed.size() - sizeof(uint32_t)) != header.crc()) {
+        throw CRCReadException();
+    }
+
+    cb::compression::Buffer inflated;
+    if (!cb::compression::inflate(
+                cb::compression::Algorithm::Snappy,
+                {reinterpret_cast<const char*>(compressed.data() +
+                                               sizeof(header)),
+                 header.compressedLen()},
+                inflated) ||
+        inflated.size() != header.uncompressedLen()) {
+        throw ReadException("MutationLog::iterator::nextBlockV4: failed to "
+                            "inflate the block at offset " +
+                            std::to_string(info->offset));
+    }
+    buf.assign(inflated.data(), inflated.data() + inflated.size());
+    offset = info->offset + compressed.size();
+
+    items = header.entries();
+    p = buf.begin();
+    prevKey.clear();
+    prepItem();
+}
+
 void MutationLog::resetCounts(size_t *items) {
     for (int i(0); i < int(MutationLogType::NumberOfTypes); ++i) {
         itemsLogged[i] = items[i];
@@ -1009,6 +1372,12 @@ bool MutationLogHarvester::load() {
                 loading[le->vbucket()].emplace(le->key());
             }
             break;
+        case MutationLogType::Evicted:
+            if (vbid_set.find(le->vbucket()) != vbid_set.end()) {
+                loading[le->vbucket()].erase(StoredDocKey(le->key()));
+                committed[le->vbucket()].erase(StoredDocKey(le->key()));
+            }
+            break;
         case MutationLogType::Commit2:
             clean = true;
 
@@ -1053,6 +1422,14 @@ MutationLog::iterator MutationLogHarvester::loadBatch(
             }
             break;
 
+        case MutationLogType::Evicted:
+            // Only undoes a New entry of the same batch; an evicted key
+            // loaded by an earlier batch is no more than a wasted load.
+            if (vbid_set.find(le->vbucket()) != vbid_set.end()) {
+                committed[le->vbucket()].erase(StoredDocKey(le->key()));
+            }
+            break;
+
         case MutationLogType::Commit1:
         case MutationLogType::Commit2:
         case MutationLogType::NumberOfTypes: {
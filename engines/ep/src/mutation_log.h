@@ -47,6 +47,7 @@
 #include <array>
 #include <atomic>
 #include <cstring>
+#include <limits>
 #include <memory>
 #include <set>
 #include <string>
@@ -73,10 +74,19 @@ const int MUTATION_LOG_COMPACTOR_FREQ(3600);
 const size_t MIN_LOG_HEADER_SIZE(4096);
 const size_t HEADER_RESERVED(4);
 
-enum class MutationLogVersion { V1 = 1, V2 = 2, V3 = 3, Current = V3 };
+/**
+ * The format of a MutationLog file. V1 to V3 store fixed size blocks of
+ * (uncompressed) entries; V4 stores variable length compressed blocks of
+ * prefix compressed entries (see LogBlockHeaderV4), which are read back as
+ * V3 entries.
+ */
+enum class MutationLogVersion { V1 = 1, V2 = 2, V3 = 3, V4 = 4, Current = V4 };
 
 const size_t LOG_ENTRY_BUF_SIZE(512);
 
+/// The size of the fixed part of an entry of a V4 block
+const size_t LOG_ENTRY_V4_HEADER_SIZE(5);
+
 const uint8_t SYNC_COMMIT_1(1);
 const uint8_t SYNC_COMMIT_2(2);
 const uint8_t SYNC_FULL(SYNC_COMMIT_1 | SYNC_COMMIT_2);
@@ -143,6 +153,87 @@ private:
     uint32_t _rdwr;
 };
 
+/**
+ * The header of a block of a V4 MutationLog.
+ *
+ * A V4 block holds up to blockSize bytes of entries, Snappy compressed on
+ * disk and preceded by this header. Each entry is stored as
+ *
+ *     type (1 byte), vbucket (2 bytes), the length of the prefix the key
+ *     shares with the previous key of the block (1 byte), the length of
+ *     the rest of the key (1 byte), the rest of the key
+ *
+ * The first key of a block is stored in full, so each block may be decoded
+ * on its own. The header records the range of vbuckets of the block's New
+ * and Evicted entries, which the block index built when the log is opened
+ * uses to skip the blocks of the vbuckets which aren't being loaded.
+ */
+class LogBlockHeaderV4 {
+public:
+    static const uint16_t MagicMarker = 0x4c34;
+
+    LogBlockHeaderV4() = default;
+
+    LogBlockHeaderV4(uint32_t compressedLen,
+                     uint32_t uncompressedLen,
+                     uint16_t entries,
+                     uint16_t firstVb,
+                     uint16_t lastVb)
+        : _compressedLen(htonl(compressedLen)),
+          _uncompressedLen(htonl(uncompressedLen)),
+          _entries(htons(entries)),
+          _firstVb(htons(firstVb)),
+          _lastVb(htons(lastVb)),
+          _magic(htons(MagicMarker)) {
+    }
+
+    /// The checksum covers everything after it (and the compressed data)
+    uint32_t crc() const {
+        return ntohl(_crc);
+    }
+
+    void setCrc(uint32_t crc) {
+        _crc = htonl(crc);
+    }
+
+    uint32_t compressedLen() const {
+        return ntohl(_compressedLen);
+    }
+
+    uint32_t uncompressedLen() const {
+        return ntohl(_uncompressedLen);
+    }
+
+    uint16_t entries() const {
+        return ntohs(_entries);
+    }
+
+    /// The lowest vbucket of the block (greater than lastVb() if none)
+    uint16_t firstVb() const {
+        return ntohs(_firstVb);
+    }
+
+    uint16_t lastVb() const {
+        return ntohs(_lastVb);
+    }
+
+    bool isValid() const {
+        return ntohs(_magic) == MagicMarker;
+    }
+
+private:
+    uint32_t _crc{0};
+    uint32_t _compressedLen{0};
+    uint32_t _uncompressedLen{0};
+    uint16_t _entries{0};
+    uint16_t _firstVb{0};
+    uint16_t _lastVb{0};
+    uint16_t _magic{0};
+};
+
+static_assert(sizeof(LogBlockHeaderV4) == 20,
+              "LogBlockHeaderV4 must not be padded");
+
 /**
  * Mutation log compactor config that is used to control the scheduling of
  * the log compactor
@@ -206,12 +297,23 @@ private:
  */
 class MutationLog {
 public:
-    MutationLog(const std::string& path, const size_t bs = MIN_LOG_HEADER_SIZE);
+    /**
+     * @param path the log file
+     * @param bs the block size (for V4, the uncompressed size of a block)
+     * @param version the format (V3 or V4) of the log if it is created; an
+     *        existing log is appended to in its own format
+     */
+    MutationLog(const std::string& path,
+                const size_t bs = MIN_LOG_HEADER_SIZE,
+                MutationLogVersion version = MutationLogVersion::V3);
 
     ~MutationLog();
 
     void newItem(Vbid vbucket, const StoredDocKey& key);
 
+    /// Record that the key is no longer resident, undoing an earlier newItem
+    void evictedItem(Vbid vbucket, const StoredDocKey& key);
+
     void commit1();
 
     void commit2();
@@ -396,11 +498,18 @@ public:
 
         iterator(const MutationLog* l, bool e=false);
 
+        /// Limit the iterator to the blocks [firstBlock, lastBlock)
+        void setBlockRange(size_t firstBlock, size_t lastBlock);
+
         /// @returns the length of the entry the iterator is currently at
         size_t getCurrentEntryLen() const;
         void nextBlock();
+        /// Read the next block of a V4 log (from the block index)
+        void nextBlockV4();
         size_t bufferBytesRemaining();
         void prepItem();
+        /// Decode the V4 entry at p into entryBuf (as a V3 entry)
+        void prepItemV4();
 
         /**
          * Upgrades the entry the iterator is currently at and returns it
@@ -413,8 +522,19 @@ public:
         std::vector<uint8_t> buf;
         std::vector<uint8_t>::const_iterator p;
         off_t              offset;
+        /// The offset the iterator stops at
+        off_t              endOffset;
         uint16_t           items;
         bool               isEnd;
+        /// V4: the next block (from the block index) and the block to stop at
+        size_t             block{0};
+        size_t             endBlock{std::numeric_limits<size_t>::max()};
+        /// V4: only read the blocks of these vbuckets (if not null)
+        const std::set<Vbid>* vbuckets{nullptr};
+        /// V4: the compressed block being read
+        std::vector<uint8_t> compressed;
+        /// V4: the key of the previous entry of the block
+        std::vector<uint8_t> prevKey;
     };
 
     /**
@@ -433,6 +553,45 @@ public:
         return iterator(this, true);
     }
 
+    /**
+     * An iterator over the entries of the blocks [firstBlock, lastBlock) of
+     * the log, counting from the first block after the header. It reaches
+     * end() after the last block of the range, so the log may be split into
+     * ranges read by different threads.
+     */
+    iterator begin(size_t firstBlock, size_t lastBlock) {
+        return begin(firstBlock, lastBlock, nullptr);
+    }
+
+    /**
+     * An iterator over the entries of the blocks [firstBlock, lastBlock),
+     * which skips the blocks without entries for the given vbuckets if the
+     * log has a block index (V4). The set must outlive the iterator.
+     */
+    iterator begin(size_t firstBlock,
+                   size_t lastBlock,
+                   const std::set<Vbid>* vbuckets) {
+        iterator it(this);
+        it.setBlockRange(firstBlock, lastBlock);
+        it.vbuckets = vbuckets;
+        it.nextBlock();
+        return it;
+    }
+
+    /// The number of (entry) blocks after the header of the open log
+    size_t getNumBlocks() const;
+
+    /**
+     * Memory map the open log for reading, so the iterators copy the
+     * blocks out of the mapping instead of reading each block with a
+     * pread, and ask the OS to start reading in the whole file. Blocks
+     * written after the call are still read with pread. The mapping is
+     * released when the log is closed.
+     *
+     * @return true if the log is mapped (not supported on Windows)
+     */
+    bool mapForReading();
+
     //! Items logged by type.
     std::atomic<size_t> itemsLogged[int(MutationLogType::NumberOfTypes)];
     //! Flush time histogram.
@@ -449,6 +608,10 @@ private:
         }
     }
     void writeEntry(MutationLogEntry *mle);
+    /// Append the entry to the (uncompressed) V4 block being built
+    void writeEntryV4(const MutationLogEntry& mle);
+    /// Compress and write out the V4 block being built
+    bool flushV4();
 
     bool writeInitialBlock();
     void readInitialBlock();
@@ -456,9 +619,39 @@ private:
 
     bool prepareWrites();
 
+    /**
+     * Build the block index of a V4 log from the headers of its blocks.
+     *
+     * @return the offset of the end of the last valid block (where any
+     *         new blocks are written)
+     */
+    uint64_t loadBlockIndex();
+
+    /**
+     * Read from the log (out of the mapping if the range is mapped)
+     *
+     * @return the number of bytes read, or -1 on error
+     */
+    ssize_t readFrom(uint8_t* dest, size_t len, uint64_t offset) const;
+
     file_handle_t fd() const { return file; }
 
+    /// An entry of the block index of a V4 log
+    struct BlockInfo {
+        /// Do the block's vbuckets include any of the given vbuckets
+        bool hasAnyOf(const std::set<Vbid>& vbs) const {
+            auto it = vbs.lower_bound(Vbid(firstVb));
+            return it != vbs.end() && it->get() <= lastVb;
+        }
+
+        uint64_t offset;
+        uint16_t firstVb;
+        uint16_t lastVb;
+    };
+
     LogHeaderBlock     headerBlock;
+    /// The format of the log if it is created
+    const MutationLogVersion writeVersion;
     const std::string  logPath;
     size_t             blockSize;
     size_t             blockPos;
@@ -469,6 +662,16 @@ private:
     std::unique_ptr<uint8_t[]> blockBuffer;
     uint8_t            syncConfig;
     bool               readOnly;
+    /// The mapping created by mapForReading, or nullptr
+    uint8_t*           mapping{nullptr};
+    size_t             mappingSize{0};
+    /// The blocks of a V4 log
+    std::vector<BlockInfo> blockIndex;
+    /// V4: the key of the previous entry of the block being built
+    std::vector<uint8_t> blockPrevKey;
+    /// V4: the range of vbuckets of the block being built
+    uint16_t           blockFirstVb{std::numeric_limits<uint16_t>::max()};
+    uint16_t           blockLastVb{0};
 
     friend std::ostream& operator<<(std::ostream& os, const MutationLog& mlog);
 
@@ -30,6 +30,9 @@ std::string to_string(MutationLogType t) {
     case MutationLogType::Commit2:
         return "commit2";
         break;
+    case MutationLogType::Evicted:
+        return "evicted";
+        break;
     case MutationLogType::NumberOfTypes: {
         // fall through
     }
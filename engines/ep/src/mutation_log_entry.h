@@ -29,6 +29,8 @@ enum class MutationLogType : uint8_t {
     /* removed: ML_DEL_ALL = 2 */
     Commit1 = 3,
     Commit2 = 4,
+    /* The key is no longer resident (incremental access logs only) */
+    Evicted = 5,
     NumberOfTypes
 };
 
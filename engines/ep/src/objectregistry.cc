@@ -22,6 +22,10 @@
 #include "stored-value.h"
 #include "threadlocal.h"
 
+#include <memcached/server_allocator_iface.h>
+
+#include <cstdlib>
+
 #if 1
 static ThreadLocal<EventuallyPersistentEngine*> *th;
 static ThreadLocal<std::atomic<size_t>*> *initial_track;
@@ -33,6 +37,53 @@ extern "C" {
 }
 
 static get_allocation_size getAllocSize = defaultGetAllocSize;
+static set_thread_arena setThreadArena = nullptr;
+
+/// The arena this thread was last switched to
+static thread_local unsigned threadArena = BucketArena::DefaultArena;
+
+/// Make the thread allocate from the arena (when it isn't already)
+static void switchArena(unsigned arena) {
+    if (arena != threadArena && setThreadArena != nullptr) {
+        setThreadArena(arena);
+        threadArena = arena;
+    }
+}
+
+static unsigned getArena(EventuallyPersistentEngine* engine) {
+    return engine ? engine->getArena().get() : BucketArena::DefaultArena;
+}
+
+/**
+ * The memory allocated less the memory freed by this thread (through the
+ * memory tracking hooks) which has yet to be added to the EPStats of its
+ * current engine. It is flushed whenever the thread switches engine, so it
+ * always belongs to th->get().
+ */
+static thread_local int64_t threadMemoryDelta = 0;
+
+static void flushMemoryDelta(EventuallyPersistentEngine* engine) {
+    const auto delta = threadMemoryDelta;
+    threadMemoryDelta = 0;
+    if (engine == nullptr || delta == 0) {
+        return;
+    }
+    auto& stats = engine->getEpStats();
+    if (delta > 0) {
+        stats.memAllocated(size_t(delta));
+    } else {
+        stats.memDeallocated(size_t(-delta));
+    }
+}
+
+/// Add mem (which may be negative) to the thread's pending allocations
+static void addMemoryDelta(EventuallyPersistentEngine* engine, int64_t mem) {
+    threadMemoryDelta += mem;
+    if (std::abs(threadMemoryDelta) >
+        engine->getEpStats().getThreadMemoryDeltaLimit()) {
+        flushMemoryDelta(engine);
+    }
+}
 
 
 
@@ -68,12 +119,15 @@ static bool verifyEngine(EventuallyPersistentEngine *engine)
    return true;
 }
 
-void ObjectRegistry::initialize(get_allocation_size func) {
+void ObjectRegistry::initialize(get_allocation_size func,
+                                set_thread_arena arenaFunc) {
     getAllocSize = func;
+    setThreadArena = arenaFunc;
 }
 
 void ObjectRegistry::reset() {
     getAllocSize = defaultGetAllocSize;
+    setThreadArena = nullptr;
 }
 
 void ObjectRegistry::onCreateBlob(const Blob *blob)
@@ -118,7 +172,7 @@ void ObjectRegistry::onCreateStoredValue(const StoredValue *sv)
    if (verifyEngine(engine)) {
        auto& coreLocalStats = engine->getEpStats().coreLocal.get();
 
-       size_t size = getAllocSize(sv);
+       size_t size = getAllocSize(sv->getAllocation());
        if (size == 0) {
            size = sv->getObjectSize();
        }
@@ -133,7 +187,7 @@ void ObjectRegistry::onDeleteStoredValue(const StoredValue *sv)
    if (verifyEngine(engine)) {
        auto& coreLocalStats = engine->getEpStats().coreLocal.get();
 
-       size_t size = getAllocSize(sv);
+       size_t size = getAllocSize(sv->getAllocation());
        if (size == 0) {
            size = sv->getObjectSize();
        }
@@ -178,10 +232,20 @@ EventuallyPersistentEngine *ObjectRegistry::onSwitchThread(
         old_engine = th->get();
     }
 
+    if (threadMemoryDelta != 0 && th->get() != engine) {
+        flushMemoryDelta(th->get());
+    }
     th->set(engine);
+    switchArena(getArena(engine));
     return old_engine;
 }
 
+void ObjectRegistry::onDeleteEngine() {
+    threadMemoryDelta = 0;
+    th->set(nullptr);
+    switchArena(BucketArena::DefaultArena);
+}
+
 void ObjectRegistry::setStats(std::atomic<size_t>* init_track) {
     initial_track->set(init_track);
 }
@@ -194,8 +258,7 @@ bool ObjectRegistry::memoryAllocated(size_t mem) {
     if (!engine) {
         return false;
     }
-    EPStats &stats = engine->getEpStats();
-    stats.memAllocated(mem);
+    addMemoryDelta(engine, int64_t(mem));
     return true;
 }
 
@@ -207,18 +270,52 @@ bool ObjectRegistry::memoryDeallocated(size_t mem) {
     if (!engine) {
         return false;
     }
-    EPStats &stats = engine->getEpStats();
-    stats.memDeallocated(mem);
+    addMemoryDelta(engine, -int64_t(mem));
     return true;
 }
 
+void ObjectRegistry::flushThreadMemoryDelta() {
+    if (threadMemoryDelta != 0) {
+        flushMemoryDelta(th->get());
+    }
+}
+
 NonBucketAllocationGuard::NonBucketAllocationGuard() {
     engine = th->get();
+    if (threadMemoryDelta != 0) {
+        flushMemoryDelta(engine);
+    }
     th->set(nullptr);
+    switchArena(BucketArena::DefaultArena);
 }
 
 NonBucketAllocationGuard::~NonBucketAllocationGuard() {
     th->set(engine);
+    switchArena(getArena(engine));
+}
+
+BucketArena::~BucketArena() {
+    if (hooks != nullptr) {
+        // The engine owning the arena is being destructed (this is its last
+        // member); stop allocating from (and accounting to) it before handing
+        // back the arena.
+        ObjectRegistry::onDeleteEngine();
+        hooks->release_arena(arena);
+    }
+}
+
+bool BucketArena::create(ServerAllocatorIface& allocHooks, bool hugePages) {
+    if (allocHooks.create_arena == nullptr ||
+        !allocHooks.create_arena(&arena, hugePages)) {
+        return false;
+    }
+    hooks = &allocHooks;
+    return true;
+}
+
+bool BucketArena::getStats(allocator_stats& stats) const {
+    return hooks != nullptr && hooks->get_arena_stats != nullptr &&
+           hooks->get_arena_stats(arena, &stats);
 }
 
 #endif
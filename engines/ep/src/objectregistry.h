@@ -23,16 +23,25 @@ class EventuallyPersistentEngine;
 class Blob;
 class Item;
 class StoredValue;
+struct allocator_stats;
+struct ServerAllocatorIface;
 
 extern "C" {
     typedef size_t (*get_allocation_size)(const void *ptr);
+    typedef void (*set_thread_arena)(unsigned arena);
 }
 
 class StoredValue;
 
 class ObjectRegistry {
 public:
-    static void initialize(get_allocation_size func);
+    /**
+     * @param func returns the size the allocator reserved for an allocation
+     * @param arenaFunc sets the allocator arena of the calling thread (used
+     *        to switch the threads to the BucketArena of their engine)
+     */
+    static void initialize(get_allocation_size func,
+                           set_thread_arena arenaFunc = nullptr);
 
     /**
      * Resets the ObjectRegistry back to initial state (before initialize()
@@ -55,9 +64,27 @@ public:
     static EventuallyPersistentEngine *onSwitchThread(EventuallyPersistentEngine *engine,
                                                       bool want_old_thread_local = false);
 
+    /**
+     * Disassociate the current thread from its engine as the engine has been
+     * destructed, dropping (rather than adding to the engine's stats) the
+     * memory the thread allocated which is still pending.
+     */
+    static void onDeleteEngine();
+
     static void setStats(std::atomic<size_t>* init_track);
+
+    /**
+     * Account memory allocated by the current thread to its engine. The
+     * allocations are accumulated per thread, and only added to the engine's
+     * (core local) stats once EPStats::getThreadMemoryDeltaLimit is exceeded
+     * or the thread switches to another engine, so that allocation-heavy
+     * paths don't update a shared counter for every allocation.
+     */
     static bool memoryAllocated(size_t mem);
     static bool memoryDeallocated(size_t mem);
+
+    /// Add the current thread's pending allocations to its engine's stats
+    static void flushThreadMemoryDelta();
 };
 
 /**
@@ -71,3 +98,47 @@ public:
 private:
     EventuallyPersistentEngine* engine = nullptr;
 };
+
+/**
+ * The allocator arena dedicated to the memory of an engine (see the
+ * dedicated_arena configuration parameter), so that its usage and
+ * fragmentation can be read from the allocator and are isolated from the
+ * other buckets. ObjectRegistry::onSwitchThread makes each thread allocate
+ * from the arena of the engine it switches to. Engines without one use the
+ * DefaultArena.
+ */
+class BucketArena {
+public:
+    /// The arena shared by everything else
+    static const unsigned DefaultArena = 0;
+
+    BucketArena() = default;
+    BucketArena(const BucketArena&) = delete;
+
+    /// Release the arena back to the allocator (which purges it)
+    ~BucketArena();
+
+    /**
+     * Create the arena
+     *
+     * @param hugePages back the arena with (transparent) huge pages, to
+     *        reduce the TLB misses of accessing a large hash table
+     * @return false if the allocator doesn't support arenas (or huge pages)
+     */
+    bool create(ServerAllocatorIface& hooks, bool hugePages);
+
+    unsigned get() const {
+        return arena;
+    }
+
+    /**
+     * Get the allocator's stats of the arena
+     *
+     * @return false if the engine has no arena of its own
+     */
+    bool getStats(allocator_stats& stats) const;
+
+private:
+    ServerAllocatorIface* hooks = nullptr;
+    unsigned arena = DefaultArena;
+};
@@ -28,6 +28,7 @@
 #include "kv_bucket.h"
 #include "kv_bucket_iface.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 #include <iostream>
@@ -76,6 +77,14 @@ PagingVisitor::PagingVisitor(KVBucket& s,
 }
 
 bool PagingVisitor::visit(const HashTable::HashBucketLock& lh, StoredValue& v) {
+    // Apply any frequency decay the item missed before its counter is used
+    currentBucket->ht.decayFreqCounter(v);
+
+    if (quotaPass) {
+        visitOverQuota(lh, v);
+        return true;
+    }
+
     // Delete expired items for an active vbucket.
     bool isExpired = (currentBucket->getState() == vbucket_state_active) &&
                      v.isExpired(startTime) && !v.isDeleted();
@@ -116,9 +125,12 @@ bool PagingVisitor::visit(const HashTable::HashBucketLock& lh, StoredValue& v) {
     uint64_t age = (maxCas > v.getCas()) ? (maxCas - v.getCas()) : 0;
     age = age >> ItemEviction::casBitsNotTime;
 
-    if ((storedValueFreqCounter <= freqCounterThreshold) &&
-        ((storedValueFreqCounter < freqCounterAgeThreshold) ||
-         (age >= ageThreshold))) {
+    // The thresholds apply to the eviction score (the frequency counter,
+    // unless eviction is cost-aware)
+    auto score = getEvictionScore(lh, v, storedValueFreqCounter);
+
+    if ((score <= freqCounterThreshold) &&
+        ((score < freqCounterAgeThreshold) || (age >= ageThreshold))) {
         /*
          * If the storedValue is eligible for eviction then add its
          * frequency counter value to the histogram, otherwise add the
@@ -132,14 +144,14 @@ bool PagingVisitor::visit(const HashTable::HashBucketLock& lh, StoredValue& v) {
          */
         if (!doEviction(lh, &v)) {
             evicted = false;
-            storedValueFreqCounter = std::numeric_limits<uint8_t>::max();
+            score = std::numeric_limits<uint8_t>::max();
         }
     } else {
         evicted = false;
         // If the storedValue is NOT eligible for eviction then
         // we want to add the maximum value (255).
         if (!currentBucket->eligibleToPageOut(lh, v)) {
-            storedValueFreqCounter = std::numeric_limits<uint8_t>::max();
+            score = std::numeric_limits<uint8_t>::max();
         } else {
             /*
              * MB-29333 - For items that we have visited and did not
@@ -154,7 +166,7 @@ bool PagingVisitor::visit(const HashTable::HashBucketLock& lh, StoredValue& v) {
             }
         }
     }
-    itemEviction.addFreqAndAgeToHistograms(storedValueFreqCounter, age);
+    itemEviction.addFreqAndAgeToHistograms(score, age);
 
     if (evicted) {
         /**
@@ -189,13 +201,41 @@ void PagingVisitor::visitBucket(const VBucketPtr& vb) {
     update();
     removeClosedUnrefCheckpoints(*vb);
 
+    // Collections over their memory quota are evicted from whatever the
+    // phase (so from vBuckets outside of the filter too), and even if the
+    // bucket as a whole is below the low watermark.
+    if (pager_phase) {
+        bool overQuota = false;
+        for (const auto& entry : collectionsOverQuota) {
+            if (entry.second > 0 && vb->ht.getCollectionMemory(entry.first)) {
+                overQuota = true;
+                break;
+            }
+        }
+        if (overQuota) {
+            currentBucket = vb;
+            quotaPass = true;
+            visitHashTable(*vb);
+            quotaPass = false;
+            update();
+        }
+    }
+
     // fast path for expiry item pager
     if (percent <= 0 || !pager_phase) {
         if (vBucketFilter(vb->getId())) {
             currentBucket = vb;
-            // EvictionPolicy is not required when running expiry item
-            // pager
-            vb->ht.visit(*this);
+            // Always drain the expiry index (even if we're about to visit
+            // every item) so that it doesn't grow stale keys without bound
+            if (vb->expiryIndex.isEnabled()) {
+                visitExpiryIndex(*vb);
+                update();
+            }
+            if (!expiryIndexOnly) {
+                // EvictionPolicy is not required when running expiry item
+                // pager
+                visitHashTable(*vb);
+            }
         }
         return;
     }
@@ -230,7 +270,7 @@ void PagingVisitor::visitBucket(const VBucketPtr& vb) {
                                         : ItemEviction::learningPopulation;
             itemEviction.setUpdateInterval(interval);
 
-            vb->ht.visit(*this);
+            visitHashTable(*vb);
             /**
              * Note: We are not taking a reader lock on the vbucket state.
              * Therefore it is possible that the stats could be slightly
@@ -281,6 +321,24 @@ void PagingVisitor::update() {
     expired.clear();
 }
 
+void PagingVisitor::visitExpiryIndex(VBucket& vb) {
+    for (const auto& key : vb.expiryIndex.takeDue(startTime)) {
+        auto res = vb.ht.findForWrite(key, WantsDeleted::No);
+        auto* v = res.storedValue;
+        if (v == nullptr || !v->isCommitted()) {
+            // Deleted (or evicted under full eviction, leaving it for
+            // compaction to expire)
+            continue;
+        }
+        if (v->getExptime() >= startTime) {
+            // Not due yet; its slot was taken because it had started
+            vb.expiryIndex.add(key, v->getExptime());
+            continue;
+        }
+        visit(res.lock, *v);
+    }
+}
+
 bool PagingVisitor::pauseVisitor() {
     size_t queueSize = stats.diskQueueSize.load();
     return canPause && queueSize >= MAX_PERSISTENCE_QUEUE_SIZE;
@@ -340,6 +398,31 @@ void PagingVisitor::removeClosedUnrefCheckpoints(VBucket& vb) {
     }
 }
 
+void PagingVisitor::visitHashTable(VBucket& vb) {
+    meanItemBytes = vb.ht.getItemMemory() /
+                    std::max(size_t(1), vb.ht.getNumInMemoryItems());
+    const auto epoch = vb.ht.getFreqDecayEpoch();
+    vb.ht.visit(*this);
+    vb.ht.setFreqDecaySwept(epoch);
+}
+
+uint8_t PagingVisitor::getEvictionScore(const HashTable::HashBucketLock& lh,
+                                        const StoredValue& v,
+                                        uint8_t freq) const {
+    if (evictionCostWeight == 0) {
+        return freq;
+    }
+    const auto freed = currentBucket->getPageOutGain(lh, v);
+    // A compressed value is inflated when it's read back
+    const auto refetched = freed + (v.uncompressedSize() - v.size());
+    return ItemEviction::getEvictionScore(freq,
+                                          freed,
+                                          refetched,
+                                          meanItemBytes,
+                                          bgFetchLatency,
+                                          evictionCostWeight);
+}
+
 void PagingVisitor::adjustPercent(double prob, vbucket_state_t state) {
     if (state == vbucket_state_replica || state == vbucket_state_dead) {
         // replica items should have higher eviction probability
@@ -373,6 +456,35 @@ bool PagingVisitor::doEviction(const HashTable::HashBucketLock& lh,
     return false;
 }
 
+void PagingVisitor::visitOverQuota(const HashTable::HashBucketLock& lh,
+                                   StoredValue& v) {
+    auto itr = collectionsOverQuota.find(v.getKey().getCollectionID());
+    if (itr == collectionsOverQuota.end() || itr->second == 0 ||
+        !currentBucket->eligibleToPageOut(lh, v)) {
+        return;
+    }
+
+    // Full eviction (of a persistent bucket) removes the whole StoredValue,
+    // otherwise just the value is freed.
+    const size_t reclaimed =
+            (store.getItemEvictionPolicy() == ::EvictionPolicy::Full &&
+             !isEphemeral)
+                    ? v.size()
+                    : v.valuelen();
+    const auto freq = v.getFreqCounterValue();
+    const bool isActiveOrPending =
+            (currentBucket->getState() == vbucket_state_active) ||
+            (currentBucket->getState() == vbucket_state_pending);
+    if (doEviction(lh, &v)) {
+        itr->second -= std::min(itr->second, reclaimed);
+        auto& frequencyValuesEvictedHisto =
+                isActiveOrPending
+                        ? stats.activeOrPendingFrequencyValuesEvictedHisto
+                        : stats.replicaFrequencyValuesEvictedHisto;
+        frequencyValuesEvictedHisto.addValue(freq);
+    }
+}
+
 void PagingVisitor::setUpHashBucketVisit() {
     // Grab a locked ReadHandle
     readHandle = currentBucket->lockCollections();
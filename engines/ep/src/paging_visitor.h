@@ -25,6 +25,7 @@
 
 #include <atomic>
 #include <list>
+#include <unordered_map>
 
 class EPStats;
 class EventuallyPersistentEngine;
@@ -96,6 +97,39 @@ public:
      */
     void tearDownHashBucketVisit() override;
 
+    /**
+     * Set how many bytes each collection is over its memory quota
+     * (collection_memory_quotas) across the bucket. Before the normal
+     * eviction of each vBucket, values of these collections are evicted
+     * until that many bytes have been reclaimed.
+     */
+    void setCollectionsOverQuota(
+            std::unordered_map<CollectionID, size_t> overQuota) {
+        collectionsOverQuota = std::move(overQuota);
+    }
+
+    /**
+     * Only visit the keys due per the expiry index of each vBucket (rather
+     * than every item of the hash table) when paging expired items
+     */
+    void setExpiryIndexOnly(bool value) {
+        expiryIndexOnly = value;
+    }
+
+    /**
+     * Apply the eviction thresholds to the cost-aware eviction score of each
+     * item rather than to its frequency counter (see
+     * ItemEviction::getEvictionScore()), using the bgfetch latency observed
+     * so far.
+     *
+     * @param weight the change in score for each doubling of the cost per
+     *        byte freed (0 disables cost-aware eviction)
+     */
+    void setEvictionCostWeight(size_t weight) {
+        evictionCostWeight = weight;
+        bgFetchLatency = ItemEviction::getBgFetchLatency(stats);
+    }
+
     /**
      * Get the number of items ejected during the visit.
      */
@@ -133,6 +167,27 @@ private:
 
     bool doEviction(const HashTable::HashBucketLock& lh, StoredValue* v);
 
+    /// Evict values of the collections which are over their memory quota
+    void visitOverQuota(const HashTable::HashBucketLock& lh, StoredValue& v);
+
+    /**
+     * Visit the keys due per the expiry index of the vBucket, putting the
+     * keys not due yet (but taken from the index) back
+     */
+    void visitExpiryIndex(VBucket& vb);
+
+    /**
+     * Visit every item of the HashTable of the vBucket. As each item visited
+     * has its frequency counter decayed, this also catches up the lazy
+     * frequency decay of the HashTable (see HashTable::decayFreqCounter()).
+     */
+    void visitHashTable(VBucket& vb);
+
+    /// Get the eviction score of the item (see setEvictionCostWeight())
+    uint8_t getEvictionScore(const HashTable::HashBucketLock& lh,
+                             const StoredValue& v,
+                             uint8_t freq) const;
+
     std::list<Item> expired;
 
     KVBucket& store;
@@ -169,4 +224,21 @@ private:
     // The VB::Manifest read handle that we use to lock around HashBucket
     // visits. Will contain a nullptr if we aren't currently locking anything.
     Collections::VB::Manifest::ReadHandle readHandle;
+
+    /// Bytes still to be reclaimed from each collection over its quota
+    std::unordered_map<CollectionID, size_t> collectionsOverQuota;
+
+    /// True whilst visiting a vBucket for the collections over quota
+    bool quotaPass = false;
+
+    /// See setExpiryIndexOnly()
+    bool expiryIndexOnly = false;
+
+    /// See setEvictionCostWeight()
+    size_t evictionCostWeight = 0;
+    double bgFetchLatency = 0;
+
+    /// The mean bytes of the items of the vBucket being visited, the
+    /// reference of the eviction scores
+    size_t meanItemBytes = 0;
 };
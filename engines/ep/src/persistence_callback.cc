@@ -21,6 +21,29 @@
 #include "item.h"
 #include "stats.h"
 
+#include <chrono>
+
+namespace {
+/// Adds the run time of a persistence callback to EPStats::flushCallbackTime.
+class CallbackTimer {
+public:
+    explicit CallbackTimer(EPStats& stats)
+        : stats(stats), start(std::chrono::steady_clock::now()) {
+    }
+
+    ~CallbackTimer() {
+        stats.flushCallbackTime.fetch_add(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start)
+                        .count());
+    }
+
+private:
+    EPStats& stats;
+    const std::chrono::steady_clock::time_point start;
+};
+} // namespace
+
 PersistenceCallback::PersistenceCallback(const queued_item& qi, uint64_t c)
     : queuedItem(qi), cas(c) {
 }
@@ -33,6 +56,7 @@ void PersistenceCallback::operator()(
         KVStore::MutationSetResultState mutationResult) {
     auto& epCtx = dynamic_cast<EPTransactionContext&>(txCtx);
     auto& vbucket = epCtx.vbucket;
+    CallbackTimer timer(epCtx.stats);
 
     switch (mutationResult) {
     case KVStore::MutationSetResultState::Insert:
@@ -116,6 +140,7 @@ void PersistenceCallback::operator()(TransactionContext& txCtx,
                                      KVStore::MutationStatus deleteStatus) {
     auto& epCtx = dynamic_cast<EPTransactionContext&>(txCtx);
     auto& vbucket = epCtx.vbucket;
+    CallbackTimer timer(epCtx.stats);
 
     switch (deleteStatus) {
     case KVStore::MutationStatus::Success:
@@ -18,10 +18,13 @@
 #include "configuration.h"
 #include "replicationthrottle.h"
 
+#include <algorithm>
+
 ReplicationThrottle::ReplicationThrottle(const Configuration& config,
                                          EPStats& s)
     : queueCap(config.getReplicationThrottleQueueCap()),
       capPercent(config.getReplicationThrottleCapPcnt()),
+      pacePercent(config.getReplicationThrottlePacePcnt()),
       stats(s) {
 }
 
@@ -46,6 +49,39 @@ ReplicationThrottle::Status ReplicationThrottle::getStatus() const {
                                                               : Status::Pause;
 }
 
+double ReplicationThrottle::getPressure() const {
+    double pressure = 0;
+    const ssize_t writeQueueCap = stats.replicationThrottleWriteQueueCap;
+    if (writeQueueCap > 0) {
+        pressure = static_cast<double>(stats.diskQueueSize.load()) /
+                   writeQueueCap;
+    } else if (writeQueueCap == 0) {
+        pressure = 1;
+    }
+
+    const double memoryLimit = static_cast<double>(stats.getMaxDataSize()) *
+                               stats.replicationThrottleThreshold;
+    if (memoryLimit > 0) {
+        pressure = std::max(
+                pressure,
+                static_cast<double>(stats.getEstimatedTotalMemoryUsed()) /
+                        memoryLimit);
+    }
+    return pressure;
+}
+
+double ReplicationThrottle::getProcessRatio() const {
+    const double pace = static_cast<double>(pacePercent) / 100.0;
+    if (pace >= 1.0) {
+        return 1.0;
+    }
+    const double pressure = getPressure();
+    if (pressure <= pace) {
+        return 1.0;
+    }
+    return std::max(0.0, (1.0 - pressure) / (1.0 - pace));
+}
+
 void ReplicationThrottle::adjustWriteQueueCap(size_t totalItems) {
     if (queueCap == -1) {
         stats.replicationThrottleWriteQueueCap.store(-1);
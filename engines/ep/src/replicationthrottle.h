@@ -40,6 +40,24 @@ public:
      */
     virtual ReplicationThrottle::Status getStatus() const;
 
+    /**
+     * How much of the buffered replication input should be processed now:
+     * 1 while the disk write queue and the memory used are below
+     * replication_throttle_pace_pcnt percent of the limits at which
+     * getStatus() pauses, then falling linearly towards 0 as they approach
+     * the limits.
+     *
+     * Pacing the consumers by it slows the producers down gradually
+     * (through DCP flow control, as the buffered input is acknowledged
+     * more slowly) instead of stopping them dead at the limits. As the
+     * write queue only grows while replicas ingest faster than the
+     * flushers drain it, this settles ingest at the rate the flushers
+     * drain.
+     *
+     * @return a ratio in [0, 1]
+     */
+    virtual double getProcessRatio() const;
+
     /**
      * Returns if we should disconnect replication connection upon hitting
      * ENOMEM during replication
@@ -53,6 +71,9 @@ public:
 
     void setCapPercent(size_t perc) { capPercent = perc; }
     void setQueueCap(ssize_t cap) { queueCap = cap; }
+    void setPacePercent(size_t perc) {
+        pacePercent = perc;
+    }
 
     void adjustWriteQueueCap(size_t totalItems);
 
@@ -60,8 +81,12 @@ private:
     bool persistenceQueueSmallEnough() const;
     bool hasSomeMemory() const;
 
+    /// @return how close (1 being at it) we are to the limits which pause
+    double getPressure() const;
+
     cb::RelaxedAtomic<ssize_t> queueCap;
     cb::RelaxedAtomic<size_t> capPercent;
+    cb::RelaxedAtomic<size_t> pacePercent;
     EPStats &stats;
 };
 
@@ -707,16 +707,30 @@ GetValue RocksDBKVStore::getWithHeader(void* dbHandle,
 }
 
 void RocksDBKVStore::getMulti(Vbid vb, vb_bgfetch_queue_t& itms) {
-    // TODO RDB: RocksDB supports a multi get which we should use here.
+    if (itms.empty()) {
+        return;
+    }
+
+    // Look all of the keys up in one MultiGet, so RocksDB can share the
+    // work (e.g. the memtable / SST file lookups) between them
+    const auto vbh = getVBHandle(vb);
+    std::vector<rocksdb::Slice> keySlices;
+    keySlices.reserve(itms.size());
+    for (const auto& it : itms) {
+        keySlices.push_back(getKeySlice(it.first));
+    }
+    std::vector<rocksdb::ColumnFamilyHandle*> cfhs(itms.size(),
+                                                   vbh->defaultCFH.get());
+    std::vector<std::string> values;
+    const auto statuses =
+            rdb->MultiGet(rocksdb::ReadOptions(), cfhs, keySlices, &values);
+
+    size_t idx = 0;
     for (auto& it : itms) {
         auto& key = it.first;
-        rocksdb::Slice keySlice = getKeySlice(key);
-        rocksdb::PinnableSlice value;
-        const auto vbh = getVBHandle(vb);
-        rocksdb::Status s = rdb->Get(rocksdb::ReadOptions(),
-                                     vbh->defaultCFH.get(),
-                                     keySlice,
-                                     &value);
+        const auto& s = statuses[idx];
+        const rocksdb::Slice value(values[idx]);
+        ++idx;
         if (s.ok()) {
             it.second.value =
                     makeGetValue(vb, key, value, it.second.isMetaOnly);
@@ -919,6 +933,35 @@ bool RocksDBKVStore::getStat(const char* name_, size_t& value) {
                                      value);
     }
 
+    // MultiGet calls (one per getMulti) and the keys they looked up
+    else if (name == "rocksdb.number.multiget.get") {
+        return getStatFromStatistics(rocksdb::Tickers::NUMBER_MULTIGET_CALLS,
+                                     value);
+    } else if (name == "rocksdb.number.multiget.keys.read") {
+        return getStatFromStatistics(
+                rocksdb::Tickers::NUMBER_MULTIGET_KEYS_READ, value);
+    }
+
+    // Bytes written to disk, as the couchstore stats of the same names
+    // (for comparing write amplification)
+    else if (name == "io_total_write_bytes") {
+        size_t wal = 0;
+        size_t flush = 0;
+        size_t compact = 0;
+        if (!getStatFromStatistics(rocksdb::Tickers::WAL_FILE_BYTES, wal) ||
+            !getStatFromStatistics(rocksdb::Tickers::FLUSH_WRITE_BYTES,
+                                   flush) ||
+            !getStatFromStatistics(rocksdb::Tickers::COMPACT_WRITE_BYTES,
+                                   compact)) {
+            return false;
+        }
+        value = wal + flush + compact;
+        return true;
+    } else if (name == "io_compaction_write_bytes") {
+        return getStatFromStatistics(rocksdb::Tickers::COMPACT_WRITE_BYTES,
+                                     value);
+    }
+
     // Disk Usage per Column Family
     else if (name == "default_kTotalSstFilesSize") {
         return getStatFromProperties(
@@ -952,7 +995,8 @@ StorageProperties RocksDBKVStore::getStorageProperties(void) {
                          // does not yet use the underlying multi get
                          // of RocksDB
                          StorageProperties::EfficientGet::Yes,
-                         StorageProperties::ConcurrentWriteCompact::Yes);
+                         StorageProperties::ConcurrentWriteCompact::Yes,
+                         StorageProperties::KeyOrderScan::No);
     return rv;
 }
 
@@ -1155,6 +1199,66 @@ rocksdb::Status RocksDBKVStore::saveVBStateToBatch(const VBHandle& vbh,
     return batch.Put(vbh.seqnoCFH.get(), keySlice, json.dump());
 }
 
+bool RocksDBKVStore::compactDB(compaction_ctx* ctx) {
+    if (!configuration.isExpiryCompactionFilter() || !ctx->expiryCallback) {
+        return true;
+    }
+
+    const auto vbid = ctx->compactConfig.db_file_id;
+    const auto vbh = getVBHandle(vbid);
+    rocksdb::ReadOptions options;
+    options.fill_cache = false;
+    std::unique_ptr<rocksdb::Iterator> it(
+            rdb->NewIterator(options, vbh->defaultCFH.get()));
+    if (!it) {
+        throw std::logic_error(
+                "RocksDBKVStore::compactDB: rocksdb::Iterator to Default "
+                "Column Family is nullptr");
+    }
+
+    auto currtime = ep_real_time();
+    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+        const auto value = it->value();
+        if (value.size() < sizeof(rockskv::MetaData)) {
+            continue;
+        }
+        rockskv::MetaData meta;
+        std::memcpy(&meta, value.data(), sizeof(meta));
+        // Tombstones are kept (for getMeta and DCP), and a prepared
+        // SyncWrite's expiry only applies once it's committed
+        if (meta.deleted ||
+            meta.getOperation() ==
+                    rockskv::MetaData::Operation::PreparedSyncWrite ||
+            meta.getOperation() == rockskv::MetaData::Operation::Abort ||
+            meta.exptime == 0 || time_t(meta.exptime) >= currtime) {
+            continue;
+        }
+
+        // Pass on the entire (uncompressed) document, as couchstore does,
+        // so that pre-expiry can keep the system xattrs
+        auto key = DiskDocKey{it->key().data(), it->key().size()};
+        auto item = makeItem(vbid, key, value, GetMetaOnly::No);
+        if (mcbp::datatype::is_snappy(item->getDataType()) &&
+            !item->decompressValue()) {
+            logger.warn(
+                    "RocksDBKVStore::compactDB: failed to inflate document "
+                    "with seqno {} in {}",
+                    meta.bySeqno,
+                    vbid);
+            continue;
+        }
+        ctx->expiryCallback->callback(*item, currtime);
+    }
+
+    if (!it->status().ok()) {
+        logger.warn("RocksDBKVStore::compactDB: iterating {} failed: {}",
+                    vbid,
+                    it->status().getState());
+        return false;
+    }
+    return true;
+}
+
 rocksdb::ColumnFamilyOptions RocksDBKVStore::getBaselineDefaultCFOptions() {
     rocksdb::ColumnFamilyOptions cfOptions;
     // Note: While we *mostly* use only point-lookup, still need to support
@@ -224,16 +224,17 @@ public:
         return 1024;
     }
 
-    bool compactDB(compaction_ctx*) override {
-        // Explicit compaction is not needed.
-        // Compaction is continuously occurring in separate threads
-        // under RocksDB's control
-        return true;
-    }
+    /**
+     * Explicit compaction is not needed, compaction is continuously
+     * occurring in separate threads under RocksDB's control. With
+     * rocksdb_expiry_compaction_filter the vBucket's expired documents are
+     * passed to the context's expiry callback (as couchstore's compaction
+     * does), so that their deletions are queued (and sent over DCP).
+     */
+    bool compactDB(compaction_ctx* ctx) override;
 
-    Vbid getDBFileId(const cb::mcbp::Request&) override {
-        // Not needed if there is no explicit compaction
-        return Vbid(0);
+    Vbid getDBFileId(const cb::mcbp::Request& req) override {
+        return req.getVBucket();
     }
 
     vbucket_state* getVBucketState(Vbid vbucketId) override {
@@ -277,7 +278,7 @@ public:
             Vbid vbid,
             const DiskDocKey& start_key,
             uint32_t count,
-            std::shared_ptr<Callback<const DiskDocKey&>> cb) override {
+            std::shared_ptr<StatusCallback<const DiskDocKey&>> cb) override {
         // TODO vmx 2016-10-29: implement
         return ENGINE_SUCCESS;
     }
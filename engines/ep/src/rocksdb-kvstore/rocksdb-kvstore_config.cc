@@ -45,6 +45,7 @@ RocksDBKVStoreConfig::RocksDBKVStoreConfig(Configuration& config,
     writeRateLimit = config.getRocksdbWriteRateLimit();
     ucMaxSizeAmplificationPercent =
             config.getRocksdbUcMaxSizeAmplificationPercent();
+    expiryCompactionFilter = config.isRocksdbExpiryCompactionFilter();
 }
 
 std::shared_ptr<rocksdb::RateLimiter>
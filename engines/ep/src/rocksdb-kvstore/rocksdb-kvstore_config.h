@@ -102,6 +102,11 @@ public:
         return ucMaxSizeAmplificationPercent;
     }
 
+    // Return whether compaction expires the documents whose time has passed
+    bool isExpiryCompactionFilter() const {
+        return expiryCompactionFilter;
+    }
+
     // Creates a RateLimiter object, which is shared across all the RocksDB
     // instances in the environment to control the IO rate of Flush and
     // Compaction tasks.
@@ -165,4 +170,7 @@ private:
     // Essentially we can use this parameter to relax/narrow the size
     // amplification constraint under Universal Compaction.
     size_t ucMaxSizeAmplificationPercent = 200;
+
+    // Discard the expired documents from the 'default' CF on compaction
+    bool expiryCompactionFilter = false;
 };
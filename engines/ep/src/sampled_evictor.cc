@@ -0,0 +1,179 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "sampled_evictor.h"
+
+#include "hash_table.h"
+#include "item_eviction.h"
+#include "kv_bucket.h"
+#include "stats.h"
+#include "vbucket.h"
+
+#include <algorithm>
+
+/**
+ * Collects the items of the sampled hash buckets which may be evicted.
+ */
+class SampledEvictor::Sampler : public HashTableVisitor {
+public:
+    Sampler(VBucket& vb,
+            std::vector<Candidate>& candidates,
+            size_t costWeight,
+            double bgFetchLatency)
+        : vb(vb),
+          candidates(candidates),
+          costWeight(costWeight),
+          bgFetchLatency(bgFetchLatency),
+          meanItemBytes(vb.ht.getItemMemory() /
+                        std::max(size_t(1), vb.ht.getNumInMemoryItems())) {
+    }
+
+    bool visit(const HashTable::HashBucketLock& lh, StoredValue& v) override {
+        if (!v.isCommitted() || !vb.eligibleToPageOut(lh, v)) {
+            return true;
+        }
+        // E.g. an Ephemeral item with no value, which would only become a
+        // tombstone of the same size.
+        const auto freed = vb.getPageOutGain(lh, v);
+        if (freed == 0) {
+            return true;
+        }
+        vb.ht.decayFreqCounter(v);
+        const auto freq = v.getFreqCounterValue();
+        // A compressed value is inflated when it's read back
+        const auto score = ItemEviction::getEvictionScore(
+                freq,
+                freed,
+                freed + (v.uncompressedSize() - v.size()),
+                meanItemBytes,
+                bgFetchLatency,
+                costWeight);
+        candidates.push_back({score,
+                              freq,
+                              v.getCas(),
+                              vb.getId(),
+                              StoredDocKey(v.getKey())});
+        // As the PagingVisitor (MB-29333): decay the counter, so that the
+        // item is evicted if it's sampled again without being referenced.
+        if (freq > 0) {
+            v.setFreqCounterValue(freq - 1);
+        }
+        return true;
+    }
+
+private:
+    VBucket& vb;
+    std::vector<Candidate>& candidates;
+    const size_t costWeight;
+    const double bgFetchLatency;
+    /// The reference of the eviction scores
+    const size_t meanItemBytes;
+};
+
+SampledEvictor::SampledEvictor(KVBucket& store, EPStats& stats)
+    : store(store), stats(stats) {
+    pool.reserve(PoolSize + 1);
+}
+
+size_t SampledEvictor::evict(const std::vector<Vbid>& vbids,
+                             size_t samples,
+                             std::chrono::steady_clock::time_point deadline) {
+    if (vbids.empty()) {
+        return 0;
+    }
+
+    size_t evicted = 0;
+    std::vector<Candidate> sampled;
+    const auto bgFetchLatency = ItemEviction::getBgFetchLatency(stats);
+    while (stats.getEstimatedTotalMemoryUsed() > stats.mem_low_wat &&
+           std::chrono::steady_clock::now() < deadline) {
+        for (size_t ii = 0; ii < samples; ++ii) {
+            auto vb = store.getVBucket(vbids[rng() % vbids.size()]);
+            if (vb) {
+                Sampler sampler(
+                        *vb, sampled, evictionCostWeight, bgFetchLatency);
+                vb->ht.visitRandomBucket(sampler, long(rng()));
+            }
+        }
+        for (auto& candidate : sampled) {
+            addToPool(std::move(candidate));
+        }
+        sampled.clear();
+
+        if (pool.empty()) {
+            // Nothing (left) to evict from these vBuckets
+            break;
+        }
+        auto best = std::move(pool.front());
+        pool.erase(pool.begin());
+        if (evictCandidate(best)) {
+            ++evicted;
+        }
+    }
+    return evicted;
+}
+
+void SampledEvictor::addToPool(Candidate candidate) {
+    if (pool.size() == PoolSize && !(candidate < pool.back())) {
+        return;
+    }
+    // The same item may be sampled again
+    for (const auto& c : pool) {
+        if (c.vbid == candidate.vbid && c.key == candidate.key) {
+            return;
+        }
+    }
+    pool.insert(std::upper_bound(pool.begin(), pool.end(), candidate),
+                std::move(candidate));
+    if (pool.size() > PoolSize) {
+        pool.pop_back();
+    }
+}
+
+bool SampledEvictor::evictCandidate(const Candidate& candidate) {
+    auto vb = store.getVBucket(candidate.vbid);
+    if (!vb) {
+        return false;
+    }
+
+    // Same lock order as the PagingVisitor: collections then hash bucket
+    auto readHandle = vb->lockCollections();
+    auto res = vb->ht.findForWrite(candidate.key, WantsDeleted::No);
+    StoredValue* v = res.storedValue;
+    // Changed since it was sampled? Then it's just been referenced.
+    if (!v || v->getCas() != candidate.cas || !v->isCommitted() ||
+        !vb->eligibleToPageOut(res.lock, *v) ||
+        vb->getPageOutGain(res.lock, *v) == 0) {
+        return false;
+    }
+
+    if (!vb->pageOut(readHandle, res.lock, v)) {
+        return false;
+    }
+    if (store.getItemEvictionPolicy() == EvictionPolicy::Full) {
+        vb->addToFilter(candidate.key);
+    }
+
+    // See PagingVisitor::visit() about not locking the vBucket state
+    auto& frequencyValuesEvictedHisto =
+            ((vb->getState() == vbucket_state_active) ||
+             (vb->getState() == vbucket_state_pending))
+                    ? stats.activeOrPendingFrequencyValuesEvictedHisto
+                    : stats.replicaFrequencyValuesEvictedHisto;
+    frequencyValuesEvictedHisto.addValue(candidate.freq);
+    return true;
+}
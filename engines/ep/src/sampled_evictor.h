@@ -0,0 +1,117 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include "storeddockey.h"
+
+#include <memcached/vbucket.h>
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+class EPStats;
+class KVBucket;
+
+/**
+ * Evicts values by sampling rather than by visiting whole vBuckets (as the
+ * PagingVisitor does), so that memory usage drops as soon as the ItemPager
+ * runs.
+ *
+ * Each round the items of a number of random hash buckets (of random
+ * vBuckets) are sampled, and the evictable ones added to a small pool of
+ * candidates ordered by their frequency counter (the oldest first amongst
+ * equal counters). The best candidate is then evicted, and rounds repeat
+ * until memory usage is at the low watermark. The pool is kept between
+ * calls; each candidate is checked again (by CAS) before it is evicted.
+ *
+ * Like the PagingVisitor, the frequency counter of each sampled item which
+ * is eligible for eviction is decayed by one, so that items which aren't
+ * referenced again are eventually evicted.
+ *
+ * With cost-aware eviction the candidates are ordered by their eviction
+ * score (see ItemEviction::getEvictionScore()) rather than by their
+ * frequency counter.
+ *
+ * Items whose eviction wouldn't release any memory (VBucket::getPageOutGain)
+ * are skipped; for an Ephemeral bucket (auto_delete) that is an item without
+ * a value, or one a range read (backfill) holds in the sequence list.
+ */
+class SampledEvictor {
+public:
+    /// The number of candidates held in the pool
+    static const size_t PoolSize = 16;
+
+    SampledEvictor(KVBucket& store, EPStats& stats);
+
+    /**
+     * Evict values from the given vBuckets until memory usage is at the low
+     * watermark, there is nothing left to evict, or the deadline passes.
+     *
+     * @param vbids the vBuckets to evict from
+     * @param samples the number of hash buckets to sample each round
+     * @param deadline when to give up
+     * @return the number of values evicted
+     */
+    size_t evict(const std::vector<Vbid>& vbids,
+                 size_t samples,
+                 std::chrono::steady_clock::time_point deadline);
+
+    /**
+     * Set the weight of the cost of refetching a value per byte freed in
+     * the order of the candidates (0 orders them by frequency counter).
+     */
+    void setEvictionCostWeight(size_t weight) {
+        evictionCostWeight = weight;
+    }
+
+    /// Forget the candidates (e.g. when the vBuckets to evict from change)
+    void clear() {
+        pool.clear();
+    }
+
+private:
+    struct Candidate {
+        bool operator<(const Candidate& other) const {
+            return score < other.score ||
+                   (score == other.score && cas < other.cas);
+        }
+
+        uint8_t score;
+        uint8_t freq;
+        uint64_t cas;
+        Vbid vbid;
+        StoredDocKey key;
+    };
+
+    class Sampler;
+
+    /// Add the candidate to the pool if it's better than the worst of it
+    void addToPool(Candidate candidate);
+
+    /// Evict the candidate if it is still evictable
+    bool evictCandidate(const Candidate& candidate);
+
+    KVBucket& store;
+    EPStats& stats;
+    /// The candidates, best first
+    std::vector<Candidate> pool;
+    /// See setEvictionCostWeight()
+    size_t evictionCostWeight = 0;
+    std::minstd_rand rng{std::random_device()()};
+};
@@ -51,3 +51,7 @@ uint64_t SequenceList::RangeIterator::count() const {
 seqno_t SequenceList::RangeIterator::getEarlySnapShotEnd() const {
     return rangeIterImpl->getEarlySnapShotEnd();
 }
+
+void SequenceList::RangeIterator::seek(seqno_t seqno) {
+    rangeIterImpl->seek(seqno);
+}
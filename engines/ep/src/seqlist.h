@@ -123,6 +123,13 @@ protected:
          * get a consistent read snapshot
          */
         virtual seqno_t getEarlySnapShotEnd() const = 0;
+
+        /**
+         * Move the iterator forward, close to (but not past) the first item
+         * with seqno >= the given seqno, skipping the items before it faster
+         * than incrementing through them where the list allows.
+         */
+        virtual void seek(seqno_t seqno) = 0;
     };
 
 public:
@@ -156,8 +163,8 @@ public:
      * Note: (a) Do not hold the iterator for long, as it will result in stale
      *           items in list and hence increased memory usage.
      *       (b) Make sure to delete the iterator after using it.
-     *       (c) For now, we allow on one RangeIterator. Try to create more
-     *           iterators will result in the create call(s) being blocked.
+     *       (c) Multiple RangeIterators may exist at a time; the list keeps
+     *           the union of their ranges point-in-time consistent.
      */
     class RangeIterator {
     public:
@@ -218,6 +225,13 @@ public:
          */
         seqno_t getEarlySnapShotEnd() const;
 
+        /**
+         * Move the iterator forward, close to (but not past) the first item
+         * with seqno >= the given seqno. Clients still increment the iterator
+         * up to the seqno they want.
+         */
+        void seek(seqno_t seqno);
+
     private:
         /* Pointer to the abstract class of range iterator implementation */
         std::unique_ptr<RangeIteratorImpl> rangeIterImpl;
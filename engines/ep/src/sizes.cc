@@ -87,6 +87,8 @@ int main(int, char **) {
     const size_t size = GlobalTask::allTaskIds.size();
     stats.schedulingHisto.resize(size);
     stats.taskRuntimeHisto.resize(size);
+    stats.taskTotalRuntime.resize(size);
+    stats.taskSlowRuns.resize(size);
     display("EPStats", stats.getMemFootPrint());
     display("FileStats", FileStats().getMemFootPrint());
     display("KVStoreStats", KVStoreStats().getMemFootPrint());
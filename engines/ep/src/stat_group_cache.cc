@@ -0,0 +1,90 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "stat_group_cache.h"
+
+ENGINE_ERROR_CODE StatGroupCache::addStats(const std::string& group,
+                                           const void* cookie,
+                                           const AddStatFn& add_stat,
+                                           const Generator& generate) {
+    const auto timeToLive = getTtl();
+    if (timeToLive.count() == 0) {
+        return generate(cookie, add_stat);
+    }
+
+    auto entry = getEntry(group);
+    std::lock_guard<std::mutex> guard(entry->mutex);
+    const auto now = std::chrono::steady_clock::now();
+    if (entry->valid && now - entry->generated < timeToLive) {
+        ++hits;
+    } else {
+        ++misses;
+        entry->valid = false;
+        entry->stats.clear();
+        auto record = [&entry](const char* key,
+                               const uint16_t klen,
+                               const char* val,
+                               const uint32_t vlen,
+                               gsl::not_null<const void*>) {
+            entry->stats.emplace_back(std::string(key, klen),
+                                      std::string(val, vlen));
+        };
+        const auto status = generate(cookie, record);
+        if (status != ENGINE_SUCCESS) {
+            entry->stats.clear();
+            erase(group, entry);
+            return status;
+        }
+        entry->valid = true;
+        entry->generated = now;
+    }
+
+    for (const auto& stat : entry->stats) {
+        add_stat(stat.first.data(),
+                 uint16_t(stat.first.size()),
+                 stat.second.data(),
+                 uint32_t(stat.second.size()),
+                 cookie);
+    }
+    return ENGINE_SUCCESS;
+}
+
+void StatGroupCache::clear() {
+    std::lock_guard<std::mutex> guard(mutex);
+    entries.clear();
+}
+
+std::shared_ptr<StatGroupCache::Entry> StatGroupCache::getEntry(
+        const std::string& group) {
+    std::lock_guard<std::mutex> guard(mutex);
+    auto& entry = entries[group];
+    if (!entry) {
+        entry = std::make_shared<Entry>();
+    }
+    return entry;
+}
+
+void StatGroupCache::erase(const std::string& group,
+                           const std::shared_ptr<Entry>& entry) {
+    // Don't keep the entries of the requests which failed (e.g. for a
+    // vbucket which doesn't exist), unless it was replaced meanwhile
+    std::lock_guard<std::mutex> guard(mutex);
+    auto it = entries.find(group);
+    if (it != entries.end() && it->second == entry) {
+        entries.erase(it);
+    }
+}
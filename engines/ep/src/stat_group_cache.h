@@ -0,0 +1,105 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <memcached/engine_common.h>
+#include <memcached/engine_error.h>
+#include <relaxed_atomic.h>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * A cache of the output of the stat groups which visit every vbucket (the
+ * engine stats and vbucket-details), for monitoring systems which poll them
+ * frequently (and often concurrently).
+ *
+ * The output of a group is recorded the first time it's requested and
+ * replayed to the requests within the following TTL. The requests which
+ * come in while the output is generated wait for it rather than walking
+ * the vbuckets themselves, so there is at most one walk per group per TTL
+ * however many clients poll it.
+ */
+class StatGroupCache {
+public:
+    using Generator = std::function<ENGINE_ERROR_CODE(const void* cookie,
+                                                      const AddStatFn& add)>;
+
+    /// Set how long the output of a group is reused (0 disables the cache)
+    void setTtl(std::chrono::milliseconds value) {
+        ttl = value.count();
+    }
+
+    std::chrono::milliseconds getTtl() const {
+        return std::chrono::milliseconds(ttl.load());
+    }
+
+    /**
+     * Add the stats of a group, from the cache if they were generated
+     * within the TTL.
+     *
+     * @param group the stat key of the group (including its arguments)
+     * @param cookie the cookie of the request
+     * @param add_stat the function to add the stats with
+     * @param generate the function generating the stats of the group
+     * @return the status of generating the stats (the output of a request
+     *         which fails isn't cached)
+     */
+    ENGINE_ERROR_CODE addStats(const std::string& group,
+                               const void* cookie,
+                               const AddStatFn& add_stat,
+                               const Generator& generate);
+
+    /// Drop the output of all groups (e.g. when the stats are reset)
+    void clear();
+
+    uint64_t getHits() const {
+        return hits;
+    }
+
+    uint64_t getMisses() const {
+        return misses;
+    }
+
+private:
+    struct Entry {
+        /// Held while the output is generated and replayed
+        std::mutex mutex;
+        bool valid = false;
+        std::chrono::steady_clock::time_point generated;
+        std::vector<std::pair<std::string, std::string>> stats;
+    };
+
+    std::shared_ptr<Entry> getEntry(const std::string& group);
+
+    void erase(const std::string& group, const std::shared_ptr<Entry>& entry);
+
+    cb::RelaxedAtomic<uint64_t> ttl{0};
+
+    std::mutex mutex;
+    std::unordered_map<std::string, std::shared_ptr<Entry>> entries;
+
+    cb::RelaxedAtomic<uint64_t> hits{0};
+    cb::RelaxedAtomic<uint64_t> misses{0};
+};
@@ -24,9 +24,12 @@
 #define DEFAULT_MAX_DATA_SIZE (std::numeric_limits<size_t>::max())
 #endif
 
+const int64_t EPStats::MaxThreadMemoryDelta;
+
 EPStats::EPStats()
     : warmedUpKeys(0),
       warmedUpValues(0),
+      warmedUpBytes(0),
       warmDups(0),
       warmOOM(0),
       warmupMemUsedCap(0),
@@ -36,8 +39,13 @@ EPStats::EPStats()
       vbBackfillQueueSize(0),
       flusher_todo(0),
       flusherCommits(0),
+      flusherDurablePrepareFlushes(0),
       cumulativeFlushTime(0),
       cumulativeCommitTime(0),
+      flushFetchTime(0),
+      flushSetTime(0),
+      flushCommitTime(0),
+      flushCallbackTime(0),
       tooYoung(0),
       tooOld(0),
       totalPersisted(0),
@@ -117,15 +125,19 @@ EPStats::EPStats()
       defragNumVisited(0),
       defragNumMoved(0),
       defragStoredValueNumMoved(0),
+      defragNumSkipped(0),
       compressorNumVisited(0),
       compressorNumCompressed(0),
+      compressorNumRejected(0),
+      compressorBytesSaved(0),
       dirtyAgeHisto(),
       diskCommitHisto(),
       timingLog(NULL),
       maxDataSize(DEFAULT_MAX_DATA_SIZE),
       // A "sensible" default, will change when setMaxDataSize is called
       memUsedMergeThreshold(102400),
-      memUsedMergeThresholdPercent(0.5) {
+      memUsedMergeThresholdPercent(0.5),
+      threadMemoryDeltaLimit(MaxThreadMemoryDelta) {
 }
 
 EPStats::~EPStats() {
@@ -150,6 +162,8 @@ void EPStats::calculateMemUsedMergeThreshold() {
     memUsedMergeThreshold =
             maxDataSize * (memUsedMergeThresholdPercent / 100.0);
     memUsedMergeThreshold = memUsedMergeThreshold / coreLocal.size();
+    threadMemoryDeltaLimit =
+            std::min(memUsedMergeThreshold.load(), MaxThreadMemoryDelta);
 }
 
 void EPStats::memAllocated(size_t sz) {
@@ -199,6 +213,7 @@ void EPStats::maybeUpdateEstimatedTotalMemUsed(
 
 size_t EPStats::getPreciseTotalMemoryUsed() {
     if (memoryTrackerEnabled.load()) {
+        ObjectRegistry::flushThreadMemoryDelta();
         for (auto& core : coreLocal) {
             estimatedTotalMemory->fetch_add(
                     core.get()->totalMemory.exchange(0));
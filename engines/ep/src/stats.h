@@ -18,6 +18,7 @@
 #pragma once
 
 #include "hdrhistogram.h"
+#include "lock_profiler.h"
 #include "objectregistry.h"
 
 #include <folly/CachelinePadded.h>
@@ -71,12 +72,21 @@ public:
         return memUsedMergeThreshold.load();
     }
 
+    /// @return the value of threadMemoryDeltaLimit
+    int64_t getThreadMemoryDeltaLimit() const {
+        return threadMemoryDeltaLimit.load();
+    }
+
     /**
      * @return a estimated memory used. This is an estimate because memory is
      * tracked in a CoreStore container and the estimate value is only updated
      * when certain core thresholds are exceeded. Thus this function returns a
      * value which may lag behind what getPreciseTotalMemoryUsed function
      * returns.
+     *
+     * The lag is bounded: each core holds less than memUsedMergeThreshold
+     * and each thread running in the engine less than
+     * threadMemoryDeltaLimit (see ObjectRegistry::memoryAllocated).
      */
     size_t getEstimatedTotalMemoryUsed() const {
         int64_t rv = 0;
@@ -91,8 +101,10 @@ public:
 
     /**
      * @return a "precise" memory used value. Calling this method triggers a
-     * merge of all core local counters into the estimate, which means setting
-     * each core local counter to zero (hence non const).
+     * merge of all core local counters (and the calling thread's pending
+     * allocations) into the estimate, which means setting each core local
+     * counter to zero (hence non const). The allocations pending on other
+     * threads are not included.
      *
      * This is described as 'precise' because in the case of the total becoming
      * negative (which can occur if a core deallocs an amount that the summation
@@ -134,6 +146,8 @@ public:
     Counter warmedUpKeys;
     //! Number of key-values warmed up during data loading.
     Counter warmedUpValues;
+    //! Bytes of keys and values warmed up.
+    Counter warmedUpBytes;
     //! Number of warmup failures due to duplicates
     Counter warmDups;
     //! Number of OOM failures at warmup time.
@@ -156,10 +170,21 @@ public:
     Counter flusher_todo;
     //! Number of transaction commits.
     Counter flusherCommits;
+    //! Number of vBucket flushes done first for pending durable prepares.
+    Counter flusherDurablePrepareFlushes;
     //! Total time spent flushing.
     Counter cumulativeFlushTime;
     //! Total time spent committing.
     Counter cumulativeCommitTime;
+    //! Total time (ns) flushers spent fetching items from checkpoints.
+    Counter flushFetchTime;
+    //! Total time (ns) flushers spent passing items to the KVStore.
+    Counter flushSetTime;
+    //! Total time (ns) spent in KVStore commits (including the persistence
+    //! callbacks they invoke).
+    Counter flushCommitTime;
+    //! Total time (ns) spent in persistence callbacks.
+    Counter flushCallbackTime;
     //! Objects that were rejected from persistence for being too fresh.
     Counter tooYoung;
     //! Objects that were forced into persistence for being too old.
@@ -387,8 +412,18 @@ public:
      */
     Counter defragStoredValueNumMoved;
 
+    /**
+     * Number of old enough items and StoredValues the defragmenter task
+     * didn't move, as the allocator reported their slab as well used.
+     */
+    Counter defragNumSkipped;
+
     Counter compressorNumVisited;
     Counter compressorNumCompressed;
+    //! Number of items not compressed, their ratio being too low
+    Counter compressorNumRejected;
+    //! How many bytes smaller the items compressed by the compressor are
+    Counter compressorBytesSaved;
 
     //! Histogram of queue processing dirty age.
     Hdr1sfMicroSecHistogram dirtyAgeHisto;
@@ -489,10 +524,24 @@ public:
     // ! Histograms of various task run times, one per Task.
     std::vector<Hdr1sfMicroSecHistogram> taskRuntimeHisto;
 
+    //! Total run time (in us) of each Task.
+    std::vector<Counter> taskTotalRuntime;
+
+    //! Number of runs of each Task longer than taskSlowRuntimeThreshold.
+    std::vector<Counter> taskSlowRuns;
+
+    //! Run time (in ms) above which a task run is logged and counted as
+    //! slow (0 disables).
+    std::atomic<size_t> taskSlowRuntimeThreshold{0};
+
     //! Checkpoint Cursor histograms
     Hdr1sfMicroSecHistogram persistenceCursorGetItemsHisto;
     Hdr1sfMicroSecHistogram dcpCursorsGetItemsHisto;
 
+    //! Contention profile of the HashTable, checkpoint and DCP locks
+    //! (recorded when lock_profiling_enabled is set).
+    LockProfiler lockProfiler;
+
     //! Reset all stats to reasonable values.
     void reset() {
         tooYoung.store(0);
@@ -532,9 +581,12 @@ public:
         accessScannerSkips.store(0),
         defragNumVisited.store(0),
         defragNumMoved.store(0);
+        defragNumSkipped.store(0);
 
         compressorNumVisited.store(0);
         compressorNumCompressed.store(0);
+        compressorNumRejected.store(0);
+        compressorBytesSaved.store(0);
 
         pendingOpsHisto.reset();
         bgWaitHisto.reset();
@@ -650,6 +702,16 @@ protected:
 
     /// percentage used in calculating the memUsedMergeThreshold
     float memUsedMergeThresholdPercent;
+
+    /**
+     * The memory a thread may allocate (or free) through the memory
+     * tracking hooks before it adds it to its core local counter; the
+     * smaller of MaxThreadMemoryDelta and memUsedMergeThreshold.
+     */
+    cb::RelaxedAtomic<int64_t> threadMemoryDeltaLimit;
+
+    /// The upper bound of threadMemoryDeltaLimit
+    static const int64_t MaxThreadMemoryDelta = 8192;
 };
 
 /**
@@ -25,6 +25,8 @@
 #include <platform/cb_malloc.h>
 #include <platform/compress.h>
 
+#include <cstring>
+
 const int64_t StoredValue::state_pending_seqno = -2;
 const int64_t StoredValue::state_deleted_key = -3;
 const int64_t StoredValue::state_non_existent_key = -4;
@@ -33,7 +35,9 @@ const int64_t StoredValue::state_temp_init = -5;
 StoredValue::StoredValue(const Item& itm,
                          UniquePtr n,
                          EPStats& stats,
-                         bool isOrdered)
+                         bool isOrdered,
+                         uint8_t inlineCapacity,
+                         bool seqnoHooked)
     : value(itm.getValue()),
       chain_next_or_replacement(std::move(n)),
       cas(itm.getCas()),
@@ -44,7 +48,12 @@ StoredValue::StoredValue(const Item& itm,
       revSeqno(itm.getRevSeqno()),
       datatype(itm.getDataType()),
       deletionSource(0),
-      committed(static_cast<uint8_t>(CommittedState::CommittedViaMutation)) {
+      committed(static_cast<uint8_t>(CommittedState::CommittedViaMutation)),
+      inlineValue(0),
+      accessLogged(0),
+      seqnoHooked(seqnoHooked),
+      freqDecayEpoch(0),
+      inlineCapacity(inlineCapacity) {
     // Initialise bit fields
     setDeletedPriv(itm.isDeleted());
     setNewCacheItem(true);
@@ -69,6 +78,7 @@ StoredValue::StoredValue(const Item& itm,
     if (isTempItem()) {
         resetValue();
     }
+    moveValueInline();
 
     if (itm.isDeleted()) {
         setDeletionSource(itm.deletionSource());
@@ -81,7 +91,11 @@ StoredValue::~StoredValue() {
     ObjectRegistry::onDeleteStoredValue(this);
 }
 
-StoredValue::StoredValue(const StoredValue& other, UniquePtr n, EPStats& stats)
+StoredValue::StoredValue(const StoredValue& other,
+                         UniquePtr n,
+                         EPStats& stats,
+                         uint8_t inlineCapacity,
+                         bool seqnoHooked)
     : value(other.value), // Implicitly also copies the frequency counter
       chain_next_or_replacement(std::move(n)),
       cas(other.cas),
@@ -90,7 +104,12 @@ StoredValue::StoredValue(const StoredValue& other, UniquePtr n, EPStats& stats)
       exptime(other.exptime),
       flags(other.flags),
       revSeqno(other.revSeqno),
-      datatype(other.datatype) {
+      datatype(other.datatype),
+      inlineValue(0),
+      accessLogged(other.accessLogged),
+      seqnoHooked(seqnoHooked),
+      freqDecayEpoch(other.freqDecayEpoch),
+      inlineCapacity(inlineCapacity) {
     setDirty(other.isDirty());
     setDeletedPriv(other.isDeleted());
     setNewCacheItem(other.isNewCacheItem());
@@ -105,6 +124,14 @@ StoredValue::StoredValue(const StoredValue& other, UniquePtr n, EPStats& stats)
     StoredDocKey sKey(other.getKey());
     new (key()) SerialisedDocKey(sKey);
 
+    if (other.isValueInline()) {
+        // Take a copy of the value, which we'll hold inline if we've got
+        // the space for it
+        replaceValue(other.getValue());
+    } else {
+        moveValueInline();
+    }
+
     if (isDeleted()) {
         setDeletionSource(other.getDeletionSource());
     }
@@ -168,6 +195,7 @@ void StoredValue::restoreValue(const Item& itm) {
     auto age = getAge();
 
     value = itm.getValue();
+    moveValueInline();
 
     setFreqCounterValue(freq);
     setCommitted(itm.getCommitted());
@@ -197,13 +225,16 @@ void StoredValue::restoreMeta(const Item& itm) {
 }
 
 size_t StoredValue::uncompressedValuelen() const {
-    if (!value) {
+    if (!value && !isValueInline()) {
         return 0;
     }
     if (mcbp::datatype::is_snappy(datatype)) {
         return cb::compression::get_uncompressed_length(
                 cb::compression::Algorithm::Snappy,
-                {value->getData(), value->valueSize()});
+                isValueInline() ? cb::const_char_buffer{inlineData(),
+                                                        inlineCapacity}
+                                : cb::const_char_buffer{value->getData(),
+                                                        value->valueSize()});
     }
     return valuelen();
 }
@@ -262,14 +293,41 @@ std::unique_ptr<Item> StoredValue::toItemAbort(Vbid vbid) const {
 }
 
 void StoredValue::reallocate() {
+    if (isValueInline()) {
+        // Nothing to do; the value lives in the StoredValue itself
+        return;
+    }
     // Allocate a new Blob for this stored value; copy the existing Blob to
     // the new one and free the old.
     replaceValue(std::unique_ptr<Blob>{Blob::Copy(*value)});
 }
 
+void StoredValue::moveValueInline() {
+    if (inlineCapacity == 0 || !value ||
+        value->valueSize() != inlineCapacity) {
+        return;
+    }
+    // Maintain the tag
+    auto tag = getValueTag();
+    std::memcpy(inlineData(), value->getData(), inlineCapacity);
+    value.reset();
+    setValueTag(tag);
+    inlineValue = true;
+}
+
 void StoredValue::Deleter::operator()(StoredValue* val) {
     if (val->isOrdered()) {
-        delete static_cast<OrderedStoredValue*>(val);
+        auto* osv = static_cast<OrderedStoredValue*>(val);
+        if (osv->hasSeqnoHook()) {
+            // The allocation starts with the SeqnoHook (see
+            // OrderedStoredValueFactory)
+            auto* hook = &osv->getSeqnoHook();
+            osv->~OrderedStoredValue();
+            hook->~SeqnoHook();
+            ::operator delete(hook);
+        } else {
+            delete osv;
+        }
     } else {
         delete val;
     }
@@ -309,7 +367,7 @@ bool StoredValue::operator!=(const StoredValue& other) const {
 }
 
 bool StoredValue::deleteImpl(DeleteSource delSource) {
-    if (isDeleted() && !getValue()) {
+    if (isDeleted() && !value && !isValueInline()) {
         // SV is already marked as deleted and has no value - no further
         // deletion possible.
         return false;
@@ -333,7 +391,7 @@ std::unique_ptr<Item> StoredValue::toItemBase(Vbid vbid,
             getKey(),
             getFlags(),
             getExptime(),
-            includeValue == IncludeValue::Yes ? value : value_t{},
+            includeValue == IncludeValue::Yes ? getValue() : value_t{},
             datatype,
             hideLockedCas == HideLockedCas::Yes ? static_cast<uint64_t>(-1)
                                                 : getCas(),
@@ -382,12 +440,17 @@ void StoredValue::setValueImpl(const Item& itm) {
         setResident(false);
     } else {
         setResident(true);
-        replaceValue(itm.getValue().get());
+        // Share the Item's Blob (taking a single reference to it)
+        replaceValue(itm.getValue());
     }
     setCommitted(itm.getCommitted());
 }
 
 bool StoredValue::compressValue() {
+    if (isValueInline()) {
+        // Too small to be worth compressing
+        return true;
+    }
     if (!mcbp::datatype::is_snappy(datatype)) {
         // Attempt compression only if datatype indicates
         // that the value is not compressed already
@@ -436,9 +499,12 @@ boost::optional<item_info> StoredValue::getItemInfo(uint64_t vbuuid) const {
     info.datatype = datatype;
     info.document_state =
             isDeleted() ? DocumentState::Deleted : DocumentState::Alive;
-    if (getValue()) {
-        info.value[0].iov_base = const_cast<char*>(getValue()->getData());
-        info.value[0].iov_len = getValue()->valueSize();
+    if (isValueInline()) {
+        info.value[0].iov_base = const_cast<char*>(inlineData());
+        info.value[0].iov_len = inlineCapacity;
+    } else if (value) {
+        info.value[0].iov_base = const_cast<char*>(value->getData());
+        info.value[0].iov_len = value->valueSize();
     }
     info.key = getKey();
     return info;
@@ -527,15 +593,17 @@ std::ostream& operator<<(std::ostream& os, const StoredValue& sv) {
     os << " fc:" << uint32_t(sv.getFreqCounterValue());
 
     os << " vallen:" << sv.valuelen();
-    if (sv.getValue().get()) {
-        os << " val age:" << uint32_t(sv.getValue()->getAge()) << " :\"";
-        const char* data = sv.getValue()->getData();
+    const auto value = sv.getValue();
+    if (value.get()) {
+        os << " val age:" << uint32_t(value->getAge())
+           << (sv.isValueInline() ? " inline" : "") << " :\"";
+        const char* data = value->getData();
         // print up to first 40 bytes of value.
-        const size_t limit = std::min(size_t(40), sv.getValue()->valueSize());
+        const size_t limit = std::min(size_t(40), value->valueSize());
         for (size_t ii = 0; ii < limit; ii++) {
             os << data[ii];
         }
-        if (limit < sv.getValue()->valueSize()) {
+        if (limit < value->valueSize()) {
             os << " <cut>";
         }
         os << "\"";
@@ -548,7 +616,10 @@ bool OrderedStoredValue::operator==(const OrderedStoredValue& other) const {
 }
 
 size_t OrderedStoredValue::getRequiredStorage(const DocKey& key) {
-    return sizeof(OrderedStoredValue) + SerialisedDocKey::getObjectSize(key);
+    // Assumes the OSV is linked in a BasicLinkedList (the default); one in a
+    // ChunkedSeqList needs sizeof(SeqnoHook) less.
+    return sizeof(SeqnoHook) + sizeof(OrderedStoredValue) +
+           SerialisedDocKey::getObjectSize(key);
 }
 
 /**
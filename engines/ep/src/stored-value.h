@@ -80,7 +80,20 @@ class OrderedStoredValue;
  *               + - - - - - - - - - +
  *  variable {   | key[]             |
  *   length  {   | ...               |
- *               +-------------------+
+ *               + - - - - - - - - - +
+ *           {   | inline value[]    | (only if created by
+ *               +-------------------+  CompactStoredValueFactory)
+ *
+ * Inline values
+ * =============
+ *
+ * For small values the separate Blob (its header, plus the allocator
+ * rounding up another allocation) can cost more than the data itself.
+ * CompactStoredValueFactory reserves space for the value after the key
+ * (inlineCapacity bytes) and copies small values there instead, leaving
+ * the value pointer null. The space is fixed when the StoredValue is
+ * allocated; a new value of a different size is kept in a Blob as normal
+ * until the StoredValue is next reallocated.
  *
  * OrderedStoredValue
  * ==================
@@ -233,7 +246,9 @@ public:
      *                  value exists but has zero length
      */
     bool isCompressible() {
-        if (mcbp::datatype::is_snappy(datatype) || !valuelen()) {
+        if (mcbp::datatype::is_snappy(datatype) || !valuelen() ||
+            isValueInline()) {
+            // (Inline values are too small to be worth compressing.)
             return false;
         }
         return value->isCompressible();
@@ -277,6 +292,12 @@ public:
 
     /**
      * Get this item's key.
+     *
+     * The key (including the collection prefix) is stored in full right
+     * after the object, and the callers rely on getting a reference to it
+     * (to hash it, compare it and copy it). Storing the keys prefix
+     * compressed would need those to be split into separate operations
+     * first.
      */
     const SerialisedDocKey& getKey() const {
         return *const_cast<const SerialisedDocKey*>(
@@ -284,12 +305,39 @@ public:
     }
 
     /**
-     * Get this item's value.
+     * Get this item's value. If the value is held inline (see
+     * CompactStoredValueFactory) a new Blob holding a copy of it is
+     * returned.
      */
-    const value_t &getValue() const {
+    value_t getValue() const {
+        if (isValueInline()) {
+            return value_t(Blob::New(inlineData(), inlineCapacity));
+        }
         return value;
     }
 
+    /**
+     * Get the Blob holding this item's value without taking a reference to
+     * it (e.g. to prefetch it); NULL if there is none or the value is held
+     * inline.
+     */
+    const Blob* peekValueBlob() const {
+        return isValueInline() ? nullptr : value.get().get();
+    }
+
+    /**
+     * Is the value held in the bytes following the key rather than in a
+     * separately allocated Blob?
+     */
+    bool isValueInline() const {
+        return inlineValue;
+    }
+
+    /// @return the number of bytes reserved after the key for the value
+    size_t getInlineCapacity() const {
+        return inlineCapacity;
+    }
+
     /**
      * Get the expiration time of this item.
      *
@@ -497,6 +545,9 @@ public:
      }
 
     size_t valuelen() const {
+        if (isValueInline()) {
+            return inlineCapacity;
+        }
         if (!value) {
             return 0;
         }
@@ -515,7 +566,8 @@ public:
      * @return the amount of memory used by this item.
      */
     size_t size() const {
-        return getObjectSize() + valuelen();
+        // The inline value is already counted by getObjectSize()
+        return getObjectSize() + (isValueInline() ? 0 : valuelen());
     }
 
     /**
@@ -526,7 +578,8 @@ public:
      * For uncompressed items this is the same as size().
      */
     size_t uncompressedSize() const {
-        return getObjectSize() + uncompressedValuelen();
+        return getObjectSize() + uncompressedValuelen() -
+               (isValueInline() ? inlineCapacity : 0);
     }
 
     size_t metaDataSize() const {
@@ -572,6 +625,9 @@ public:
     void resetValue() {
         auto age = getAge();
         value.reset();
+        // The space for an inline value is only returned when the
+        // StoredValue is reallocated
+        inlineValue = false;
         setAge(age);
     }
 
@@ -584,6 +640,8 @@ public:
         // Maintain the tag
         auto tag = getValueTag();
         value.reset(data.release());
+        inlineValue = false;
+        moveValueInline();
         setValueTag(tag);
     }
 
@@ -595,6 +653,8 @@ public:
         // Maintain the tag
         auto tag = getValueTag();
         this->value = value;
+        inlineValue = false;
+        moveValueInline();
         setValueTag(tag);
     }
 
@@ -637,6 +697,35 @@ public:
         bits.set(newCacheItemIndex, newitem);
     }
 
+    /**
+     * Was this key recorded in the access log by the last access scan?
+     * Used by the incremental AccessScanner to log only the changes.
+     * Only accessed under the HashBucketLock.
+     */
+    bool isAccessLogged() const {
+        return accessLogged;
+    }
+
+    void setAccessLogged(bool logged) {
+        accessLogged = logged;
+    }
+
+    /**
+     * The (low bits of the) frequency decay epoch of the HashTable the
+     * frequency counter was last decayed to (see
+     * HashTable::decayFreqCounter()). Only accessed under the HashBucketLock.
+     */
+    uint8_t getFreqDecayEpoch() const {
+        return freqDecayEpoch;
+    }
+
+    void setFreqDecayEpoch(uint8_t epoch) {
+        freqDecayEpoch = epoch & freqDecayEpochMask;
+    }
+
+    /// The mask of the epoch bits held by a StoredValue
+    static constexpr uint8_t freqDecayEpochMask = 0x3;
+
     /**
      * Generate a new Item out of this StoredValue.
      *
@@ -750,10 +839,18 @@ public:
 
     /**
      * Return the size in byte of this object; both the fixed fields and the
-     * variable-length key. Doesn't include value size (allocated externally).
+     * variable-length key (and the space reserved for an inline value, or
+     * the SeqnoHook held in front of an OrderedStoredValue).
+     * Doesn't include the size of a value Blob (allocated externally).
      */
     inline size_t getObjectSize() const;
 
+    /**
+     * @return the start of the allocation holding this object (which is
+     *         this object, unless it is preceded by a SeqnoHook)
+     */
+    inline const void* getAllocation() const;
+
     /**
      * Reallocates the dynamic members of StoredValue. Used as part of
      * defragmentation.
@@ -839,11 +936,17 @@ protected:
      *           which the new item is being inserted).
      * @param stats EPStats to update for this new StoredValue
      * @param isOrdered Are we constructing an OrderedStoredValue?
+     * @param inlineCapacity The number of bytes allocated after the key for
+     *        holding the value inline (see CompactStoredValueFactory)
+     * @param seqnoHooked Is the object preceded by a SeqnoHook (see
+     *        OrderedStoredValueFactory)?
      */
     StoredValue(const Item& itm,
                 UniquePtr n,
                 EPStats& stats,
-                bool isOrdered);
+                bool isOrdered,
+                uint8_t inlineCapacity = 0,
+                bool seqnoHooked = false);
 
     // Destructor. protected, as needs to be carefully deleted (via
     // StoredValue::Destructor) depending on the value of isOrdered flag.
@@ -859,10 +962,16 @@ protected:
      *           ownership of. (Typically the top of the hash bucket into
      *           which the new item is being inserted).
      * @param stats EPStats to update for this new StoredValue
+     * @param inlineCapacity The number of bytes allocated after the key for
+     *        holding the value inline (see CompactStoredValueFactory)
+     * @param seqnoHooked Is the object preceded by a SeqnoHook (see
+     *        OrderedStoredValueFactory)?
      */
     StoredValue(const StoredValue& other,
                 UniquePtr n,
-                EPStats& stats);
+                EPStats& stats,
+                uint8_t inlineCapacity = 0,
+                bool seqnoHooked = false);
 
     /* Do not allow assignment */
     StoredValue& operator=(const StoredValue& other) = delete;
@@ -872,6 +981,24 @@ protected:
      */
     inline SerialisedDocKey* key();
 
+    /// @return the address of the inline value (directly after the key)
+    const char* inlineData() const {
+        return reinterpret_cast<const char*>(&getKey()) +
+               getKey().getObjectSize();
+    }
+
+    char* inlineData() {
+        return const_cast<char*>(
+                static_cast<const StoredValue*>(this)->inlineData());
+    }
+
+    /**
+     * If the value Blob is exactly inlineCapacity bytes copy it into the
+     * space after the key and drop the Blob (the space can't grow, so
+     * larger or smaller values stay in their Blob).
+     */
+    void moveValueInline();
+
     /**
      * Logically mark this SV as deleted.
      * Implementation for StoredValue instances (dispatched to by del() based
@@ -942,6 +1069,7 @@ protected:
     }
 
     friend class StoredValueFactory;
+    friend class CompactStoredValueFactory;
 
     /**
      * Granting friendship to StoredValueProtected test fixture to access
@@ -1033,6 +1161,23 @@ protected:
     uint8_t deletionSource : 1;
     /// 2-bit value which encodes the CommittedState of the StoredValue
     uint8_t committed : 2;
+    /// Set if the value is held in the inlineCapacity bytes following the
+    /// key, in which case the value Blob is null.
+    uint8_t inlineValue : 1;
+    /// Set if the key was recorded by the last access scan (see
+    /// isAccessLogged()).
+    uint8_t accessLogged : 1;
+    /// Set if the (Ordered)StoredValue is preceded in its allocation by the
+    /// SeqnoHook linking it in a BasicLinkedList. Fixed for the lifetime of
+    /// the object.
+    uint8_t seqnoHooked : 1;
+    /// 2-bit frequency decay epoch (see getFreqDecayEpoch()).
+    uint8_t freqDecayEpoch : 2;
+
+    /// The number of bytes allocated after the key to hold the value inline
+    /// (0 if none). Fixed for the lifetime of the object, and fits in what
+    /// would otherwise be padding at the end of the object.
+    uint8_t inlineCapacity;
 
     friend std::ostream& operator<<(std::ostream& os, const StoredValue& sv);
 };
@@ -1046,6 +1191,17 @@ std::ostream& operator<<(std::ostream& os, const StoredValue& sv);
  */
 class OrderedStoredValue : public StoredValue {
 public:
+    /**
+     * Intrusive linked-list hook for sequence number ordering (see
+     * BasicLinkedList). Guarded by the SequenceList's writeLock.
+     *
+     * Not a member: when the OSV is linked by a BasicLinkedList the hook is
+     * held immediately before the object in the same allocation (see
+     * OrderedStoredValueFactory), so a SequenceList which doesn't link its
+     * elements (ChunkedSeqList) doesn't pay for it.
+     */
+    using SeqnoHook = boost::intrusive::list_member_hook<>;
+
     /* Do not allow assignment */
     OrderedStoredValue& operator=(const OrderedStoredValue& other) = delete;
     OrderedStoredValue& operator=(OrderedStoredValue&& other) = delete;
@@ -1094,6 +1250,30 @@ public:
         return chain_next_or_replacement.get().get();
     }
 
+    /// @return true if the OSV has a SeqnoHook (can be linked in a
+    ///         BasicLinkedList)
+    bool hasSeqnoHook() const {
+        return seqnoHooked;
+    }
+
+    /// @return the SeqnoHook of the OSV. Only valid if hasSeqnoHook().
+    SeqnoHook& getSeqnoHook() {
+        return *(reinterpret_cast<SeqnoHook*>(this) - 1);
+    }
+
+    const SeqnoHook& getSeqnoHook() const {
+        return *(reinterpret_cast<const SeqnoHook*>(this) - 1);
+    }
+
+    /// @return the OSV the given SeqnoHook belongs to
+    static OrderedStoredValue& fromSeqnoHook(SeqnoHook& hook) {
+        return *reinterpret_cast<OrderedStoredValue*>(&hook + 1);
+    }
+
+    static const OrderedStoredValue& fromSeqnoHook(const SeqnoHook& hook) {
+        return *reinterpret_cast<const OrderedStoredValue*>(&hook + 1);
+    }
+
     /**
      * Return the time the item was deleted. Only valid for deleted items.
      */
@@ -1108,7 +1288,7 @@ public:
     bool operator==(const OrderedStoredValue& other) const;
 
     /// Return how many bytes are need to store item with given key as an
-    /// OrderedStoredValue
+    /// OrderedStoredValue (with a SeqnoHook)
     static size_t getRequiredStorage(const DocKey& key);
 
     /**
@@ -1150,8 +1330,14 @@ private:
     // OrderedStoredValueFactory.
     OrderedStoredValue(const Item& itm,
                        UniquePtr n,
-                       EPStats& stats)
-        : StoredValue(itm, std::move(n), stats, /*isOrdered*/ true) {
+                       EPStats& stats,
+                       bool seqnoHooked)
+        : StoredValue(itm,
+                      std::move(n),
+                      stats,
+                      /*isOrdered*/ true,
+                      /*inlineCapacity*/ 0,
+                      seqnoHooked) {
     }
 
     // Copy Constructor. Private, as needs to be carefully created via
@@ -1162,16 +1348,15 @@ private:
     // data structure.
     OrderedStoredValue(const StoredValue& other,
                        UniquePtr n,
-                       EPStats& stats)
-        : StoredValue(other, std::move(n), stats) {
+                       EPStats& stats,
+                       bool seqnoHooked)
+        : StoredValue(other,
+                      std::move(n),
+                      stats,
+                      /*inlineCapacity*/ 0,
+                      seqnoHooked) {
     }
 
-public:
-    // Intrusive linked-list for sequence number ordering.
-    // Guarded by the SequenceList's writeLock.
-    // Logically private to the object, however Boost requires it to be public.
-    boost::intrusive::list_member_hook<> seqno_hook;
-
     // Grant friendship so our factory can call our (private) constructor.
     friend class OrderedStoredValueFactory;
 
@@ -1193,7 +1378,15 @@ size_t StoredValue::getObjectSize() const {
     // Size of fixed part of OrderedStoredValue or StoredValue, plus size of
     // (variable) key.
     if (isOrdered()) {
-        return sizeof(OrderedStoredValue) + getKey().getObjectSize();
+        return sizeof(OrderedStoredValue) + getKey().getObjectSize() +
+               (seqnoHooked ? sizeof(OrderedStoredValue::SeqnoHook) : 0);
+    }
+    return sizeof(*this) + getKey().getObjectSize() + inlineCapacity;
+}
+
+const void* StoredValue::getAllocation() const {
+    if (seqnoHooked) {
+        return &static_cast<const OrderedStoredValue*>(this)->getSeqnoHook();
     }
-    return sizeof(*this) + getKey().getObjectSize();
+    return this;
 }
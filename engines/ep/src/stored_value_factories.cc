@@ -19,6 +19,9 @@
 
 #include "item.h"
 
+#include <algorithm>
+#include <limits>
+
 StoredValue::UniquePtr StoredValueFactory::operator()(
         const Item& itm, StoredValue::UniquePtr next) {
     // Allocate a buffer to store the StoredValue and any trailing bytes
@@ -40,21 +43,74 @@ StoredValue::UniquePtr StoredValueFactory::copyStoredValue(
                     StoredValue(other, std::move(next), *stats));
 }
 
+CompactStoredValueFactory::CompactStoredValueFactory(EPStats& s,
+                                                     size_t maxInlineSize)
+    : stats(&s),
+      maxInlineSize(std::min(
+              maxInlineSize,
+              size_t(std::numeric_limits<uint8_t>::max()))) {
+}
+
+StoredValue::UniquePtr CompactStoredValueFactory::operator()(
+        const Item& itm, StoredValue::UniquePtr next) {
+    // Allocate a buffer to store the StoredValue, the key and (if it's
+    // small enough) the value
+    const auto inlineSize =
+            getInlineSize(itm.getNBytes());
+    return StoredValue::UniquePtr(
+            new (::operator new(
+                    StoredValue::getRequiredStorage(itm.getKey()) +
+                    inlineSize)) StoredValue(itm,
+                                             std::move(next),
+                                             *stats,
+                                             /*isOrdered*/ false,
+                                             inlineSize));
+}
+
+StoredValue::UniquePtr CompactStoredValueFactory::copyStoredValue(
+        const StoredValue& other, StoredValue::UniquePtr next) {
+    const auto inlineSize = getInlineSize(other.valuelen());
+    return StoredValue::UniquePtr(
+            new (::operator new(other.getObjectSize() -
+                                other.getInlineCapacity() + inlineSize))
+                    StoredValue(other, std::move(next), *stats, inlineSize));
+}
+
+uint8_t CompactStoredValueFactory::getInlineSize(size_t valueSize) const {
+    return valueSize <= maxInlineSize ? uint8_t(valueSize) : 0;
+}
+
+template <class... Args>
+StoredValue::UniquePtr OrderedStoredValueFactory::create(size_t size,
+                                                         Args&&... args) {
+    if (!seqnoHook) {
+        auto* buffer = ::operator new(size);
+        return StoredValue::UniquePtr(new (buffer) OrderedStoredValue(
+                std::forward<Args>(args)..., *stats, false));
+    }
+    // The SeqnoHook goes first, immediately followed by the OSV (and its
+    // key)
+    using SeqnoHook = OrderedStoredValue::SeqnoHook;
+    auto* hook = new (::operator new(sizeof(SeqnoHook) + size)) SeqnoHook();
+    return StoredValue::UniquePtr(new (hook + 1) OrderedStoredValue(
+            std::forward<Args>(args)..., *stats, true));
+}
+
 StoredValue::UniquePtr OrderedStoredValueFactory::operator()(
         const Item& itm, StoredValue::UniquePtr next) {
     // Allocate a buffer to store the OrderStoredValue and any trailing
     // bytes required for the key.
-    return StoredValue::UniquePtr(
-            new (::operator new(
-                    OrderedStoredValue::getRequiredStorage(itm.getKey())))
-                    OrderedStoredValue(itm, std::move(next), *stats));
+    return create(sizeof(OrderedStoredValue) +
+                          SerialisedDocKey::getObjectSize(itm.getKey()),
+                  itm,
+                  std::move(next));
 }
 
 StoredValue::UniquePtr OrderedStoredValueFactory::copyStoredValue(
         const StoredValue& other, StoredValue::UniquePtr next) {
     // Allocate a buffer to store the copy ofOrderStoredValue and any
     // trailing bytes required for the key.
-    return StoredValue::UniquePtr(
-            new (::operator new(other.getObjectSize()))
-                    OrderedStoredValue(other, std::move(next), *stats));
+    return create(sizeof(OrderedStoredValue) + other.getKey().getObjectSize(),
+                  other,
+                  std::move(next));
 }
@@ -79,6 +79,45 @@ private:
     EPStats* stats;
 };
 
+/**
+ * Creator of StoredValue instances which hold small values inline - in the
+ * same allocation as the StoredValue and its key - rather than in a
+ * separate Blob. Saves the Blob header and the rounding up of a second
+ * allocation per item, which for small values is more than the data.
+ */
+class CompactStoredValueFactory : public AbstractStoredValueFactory {
+public:
+    using value_type = StoredValue;
+
+    /**
+     * @param maxInlineSize Values of up to this many bytes are held inline
+     *        (capped at 255)
+     */
+    CompactStoredValueFactory(EPStats& s, size_t maxInlineSize);
+
+    /**
+     * Create a concrete StoredValue object, holding the item's value inline
+     * if it is small enough.
+     */
+    StoredValue::UniquePtr operator()(const Item& itm,
+                                      StoredValue::UniquePtr next) override;
+
+    /**
+     * Create a copy of the given StoredValue; the space reserved for the
+     * value inline is sized for its current value (so the space of a value
+     * which has since been evicted or replaced is given back).
+     */
+    StoredValue::UniquePtr copyStoredValue(
+            const StoredValue& other, StoredValue::UniquePtr next) override;
+
+private:
+    /// @return the space to reserve inline for a value of the given size
+    uint8_t getInlineSize(size_t valueSize) const;
+
+    EPStats* stats;
+    const size_t maxInlineSize;
+};
+
 /**
  * Creator of OrderedStoredValue instances.
  */
@@ -86,7 +125,13 @@ class OrderedStoredValueFactory : public AbstractStoredValueFactory {
 public:
     using value_type = OrderedStoredValue;
 
-    OrderedStoredValueFactory(EPStats& s) : stats(&s) {
+    /**
+     * @param seqnoHook Allocate the OrderedStoredValues with a SeqnoHook (as
+     *        needed to link them in a BasicLinkedList). A ChunkedSeqList
+     *        doesn't need one.
+     */
+    OrderedStoredValueFactory(EPStats& s, bool seqnoHook = true)
+        : stats(&s), seqnoHook(seqnoHook) {
     }
 
     /**
@@ -102,5 +147,11 @@ public:
             const StoredValue& other, StoredValue::UniquePtr next) override;
 
 private:
+    /// Construct an OSV from the given arguments in a buffer of the given
+    /// size, plus the SeqnoHook if seqnoHook.
+    template <class... Args>
+    StoredValue::UniquePtr create(size_t size, Args&&... args);
+
     EPStats* stats;
+    const bool seqnoHook;
 };
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <folly/FBString.h>
 #include <memcached/dockey.h>
 #include <gsl/gsl>
 #include <limits>
@@ -110,11 +111,17 @@ public:
     }
 
     operator DocKey() const {
-        return {keydata, DocKeyEncodesCollectionId::Yes};
+        return {data(), size(), DocKeyEncodesCollectionId::Yes};
     }
 
 protected:
-    std::string keydata;
+    /**
+     * fbstring rather than std::string as it holds up to 23 bytes inline
+     * (std::string 15 with libstdc++), so the typical key plus its
+     * collection prefix doesn't need an allocation of its own. Every Item
+     * holds a StoredDocKey, including those made for each GET hit.
+     */
+    folly::fbstring keydata;
 };
 
 std::ostream& operator<<(std::ostream& os, const StoredDocKey& key);
@@ -22,7 +22,10 @@
 #include <cmath>
 
 TaskQueue::TaskQueue(ExecutorPool *m, task_type_t t, const char *nm) :
-    name(nm), queueType(t), manager(m), sleepers(0)
+    name(nm), queueType(t), manager(m), sleepers(0),
+    nextRunnable(std::chrono::steady_clock::time_point::max()
+                         .time_since_epoch()
+                         .count())
 {
     // EMPTY
 }
@@ -54,9 +57,22 @@ ExTask TaskQueue::_popReadyTask(void) {
     ExTask t = readyQueue.top();
     readyQueue.pop();
     manager->lessWork(queueType);
+    t->getTaskable().getWorkLoadPolicy().removeReadyTask();
     return t;
 }
 
+void TaskQueue::_updateNextRunnable_UNLOCKED() {
+    std::chrono::steady_clock::time_point next;
+    if (!readyQueue.empty() || !pendingQueue.empty()) {
+        next = std::chrono::steady_clock::time_point::min();
+    } else if (!futureQueue.empty()) {
+        next = futureQueue.top()->getWaketime();
+    } else {
+        next = std::chrono::steady_clock::time_point::max();
+    }
+    nextRunnable.store(next.time_since_epoch().count());
+}
+
 void TaskQueue::doWake(size_t &numToWake) {
     LockHolder lh(mutex);
     _doWake_UNLOCKED(numToWake);
@@ -153,11 +169,22 @@ bool TaskQueue::_fetchNextTaskInner(ExecutorThread& t,
         numToWake = numToWake ? numToWake - 1 : 0; // 1 fewer task ready
     }
 
+    _updateNextRunnable_UNLOCKED();
     _doWake_UNLOCKED(numToWake);
     return ret;
 }
 
 bool TaskQueue::fetchNextTask(ExecutorThread& thread) {
+    const std::chrono::steady_clock::time_point next{
+            std::chrono::steady_clock::duration(nextRunnable.load())};
+    if (next > thread.getCurTime()) {
+        // Nothing can be run yet; record the earliest waketime as
+        // _fetchNextTaskInner() would.
+        if (thread.taskType == queueType && next < thread.getWaketime()) {
+            thread.setWaketime(next);
+        }
+        return false;
+    }
     NonBucketAllocationGuard guard;
     return _fetchNextTask(thread);
 }
@@ -179,6 +206,7 @@ size_t TaskQueue::_moveReadyTasks(
         if (tid->getWaketime() <= tv) {
             futureQueue.pop();
             readyQueue.push(tid);
+            tid->getTaskable().getWorkLoadPolicy().addReadyTask();
             numReady++;
         } else {
             break;
@@ -195,6 +223,7 @@ void TaskQueue::_checkPendingQueue(void) {
     if (!pendingQueue.empty()) {
         ExTask runnableTask = pendingQueue.front();
         readyQueue.push(runnableTask);
+        runnableTask->getTaskable().getWorkLoadPolicy().addReadyTask();
         manager->addWork(1, queueType);
         pendingQueue.pop_front();
     }
@@ -204,6 +233,7 @@ std::chrono::steady_clock::time_point TaskQueue::_reschedule(ExTask& task) {
     LockHolder lh(mutex);
 
     futureQueue.push(task);
+    _updateNextRunnable_UNLOCKED();
     return futureQueue.top()->getWaketime();
 }
 
@@ -225,6 +255,7 @@ void TaskQueue::_schedule(ExTask &task) {
         task->setState(TASK_RUNNING, TASK_DEAD);
 
         futureQueue.push(task);
+        _updateNextRunnable_UNLOCKED();
 
         EP_LOG_DEBUG("{}: Schedule a task \"{}\" id {}",
                      name,
@@ -283,6 +314,7 @@ void TaskQueue::_wake(ExTask &task) {
             futureQueue.push(tid);
             notReady.pop();
         }
+        _updateNextRunnable_UNLOCKED();
 
         _doWake_UNLOCKED(readyCount);
         sleepQ = manager->getSleepQ(queueType);
@@ -292,6 +324,12 @@ void TaskQueue::_wake(ExTask &task) {
     }
 }
 
+void TaskQueue::snooze(ExTask& task, const double secs) {
+    LockHolder lh(mutex);
+    futureQueue.snooze(task, secs);
+    _updateNextRunnable_UNLOCKED();
+}
+
 void TaskQueue::wake(ExTask &task) {
     NonBucketAllocationGuard guard;
     _wake(task);
@@ -19,6 +19,7 @@
 #include "syncobject.h"
 #include "task_type.h"
 
+#include <atomic>
 #include <chrono>
 #include <list>
 #include <queue>
@@ -43,6 +44,8 @@ public:
     /**
      * Fetch the next task to be run from the task queues, updating
      * thread::currentTask with the next task to run (if one found).
+     * Doesn't lock the queue if none of its tasks can be run yet (see
+     * nextRunnable).
      * @returns true if there is a task to run, otherwise false.
      */
     bool fetchNextTask(ExecutorThread& thread);
@@ -68,9 +71,7 @@ public:
 
     size_t getPendingQueueSize();
 
-    void snooze(ExTask& task, const double secs) {
-        futureQueue.snooze(task, secs);
-    }
+    void snooze(ExTask& task, const double secs);
 
 private:
     void _schedule(ExTask &task);
@@ -85,6 +86,7 @@ private:
     void _doWake_UNLOCKED(size_t &numToWake);
     size_t _moveReadyTasks(const std::chrono::steady_clock::time_point tv);
     ExTask _popReadyTask(void);
+    void _updateNextRunnable_UNLOCKED();
 
     SyncObject mutex;
     const std::string name;
@@ -100,4 +102,15 @@ private:
     FutureQueue<> futureQueue;
 
     std::list<ExTask> pendingQueue;
+
+    /**
+     * The earliest time (as steady_clock ticks) at which a task of this
+     * queue may be run; min() if one can be run now, max() if the queue is
+     * empty. Updated (under mutex) whenever the queues change and read
+     * without it by fetchNextTask(), so that the threads polling this queue
+     * don't all contend on mutex while none of its tasks is due. It may be
+     * earlier, but never later, than the earliest waketime once the mutex
+     * is released.
+     */
+    std::atomic<std::chrono::steady_clock::rep> nextRunnable;
 };
@@ -17,10 +17,13 @@
 #include "bgfetcher.h"
 #include "ep_bucket.h"
 #include "ep_engine.h"
+#include "ep_vb.h"
+#include "executorpool.h"
 #include "flusher.h"
 #include "tasks.h"
 #include "warmup.h"
 
+#include <algorithm>
 #include <climits>
 #include <type_traits>
 
@@ -63,9 +66,51 @@ bool CompactTask::run() {
      */
     compactionConfig.retain_erroneous_tombstones =
                              bucket.isRetainErroneousTombstones();
+
+    if (!bucket.tryStartCompaction(*this)) {
+        // The most concurrent compactions are running, we're woken when one
+        // of them completes
+        return true;
+    }
     return bucket.doCompact(compactionConfig, purgeSeqno, cookie);
 }
 
+VBucketInstallTask::VBucketInstallTask(EPBucket& bucket,
+                                       Vbid vbid,
+                                       std::string path,
+                                       const void* ck)
+    : GlobalTask(&bucket.getEPEngine(), TaskId::VBucketInstallTask, 0, false),
+      bucket(bucket),
+      vbid(vbid),
+      path(std::move(path)),
+      cookie(ck) {
+    desc = "Install " + vbid.to_string() + " from " + this->path;
+}
+
+bool VBucketInstallTask::run() {
+    TRACE_EVENT1("ep-engine/task", "VBucketInstallTask", "vbid", vbid.get());
+    bucket.doInstallVBucket(vbid, path, cookie);
+    return false;
+}
+
+DropCollectionKeysTask::DropCollectionKeysTask(EventuallyPersistentEngine& e,
+                                               Vbid vbid)
+    : GlobalTask(&e, TaskId::DropCollectionKeysTask, 0, false), vbid(vbid) {
+    desc = "Dropping the keys of dropped collections from " +
+           vbid.to_string();
+}
+
+bool DropCollectionKeysTask::run() {
+    TRACE_EVENT1(
+            "ep-engine/task", "DropCollectionKeysTask", "vbid", vbid.get());
+    auto vb = engine->getKVBucket()->getVBucket(vbid);
+    if (vb) {
+        // Only persistent vbuckets flush the drop of a collection
+        dynamic_cast<EPVBucket&>(*vb).dropCollectionKeys();
+    }
+    return false;
+}
+
 bool StatSnap::run() {
     TRACE_EVENT0("ep-engine/task", "StatSnap");
     engine->getKVBucket()->snapshotStats();
@@ -102,6 +147,122 @@ bool VKeyStatBGFetchTask::run() {
 }
 
 
+constexpr std::chrono::seconds IOThreadTuner::Interval;
+constexpr double IOThreadTuner::SaturatedLatencyRatio;
+constexpr double IOThreadTuner::BaselineDrift;
+constexpr int IOThreadTuner::IdleIntervalsBeforeShrink;
+
+IOThreadTuner::IOThreadTuner(EPBucket& bucket)
+    : GlobalTask(&bucket.getEPEngine(),
+                 TaskId::IOThreadTuner,
+                 std::chrono::duration<double>(Interval).count(),
+                 false),
+      bucket(bucket) {
+}
+
+bool IOThreadTuner::run() {
+    TRACE_EVENT0("ep-engine/task", "IOThreadTuner");
+    if (engine->getEpStats().isShutdown) {
+        return false;
+    }
+
+    // The totals of the data files of all of the shards; the cumulative
+    // time of the IOs is the mean times the count of each histogram
+    uint64_t reads = 0;
+    uint64_t writes = 0;
+    double readTime = 0;
+    double writeTime = 0;
+    for (size_t ii = 0; ii < bucket.getVBuckets().getNumShards(); ++ii) {
+        const auto& ro = bucket.getROUnderlyingByShard(ii)
+                                 ->getKVStoreStat()
+                                 .fsStats;
+        reads += ro.readTimeHisto.getValueCount();
+        readTime += ro.readTimeHisto.getMean() *
+                    ro.readTimeHisto.getValueCount();
+
+        const auto& rw = bucket.getRWUnderlyingByShard(ii)
+                                 ->getKVStoreStat()
+                                 .fsStats;
+        writes += rw.writeTimeHisto.getValueCount();
+        writeTime += rw.writeTimeHisto.getMean() *
+                             rw.writeTimeHisto.getValueCount() +
+                     rw.syncTimeHisto.getMean() *
+                             rw.syncTimeHisto.getValueCount();
+    }
+
+    // Keep the controllers up to date while disabled so they don't see a
+    // burst of IOs when enabled
+    const auto& stats = engine->getEpStats();
+    const int readerChange =
+            readers.update(stats.numRemainingBgJobs, reads, readTime);
+    const int writerChange =
+            writers.update(stats.diskQueueSize, writes, writeTime);
+    if (engine->getConfiguration().isIoThreadAutotune()) {
+        adjust(READER_TASK_IDX, readerChange);
+        adjust(WRITER_TASK_IDX, writerChange);
+    }
+
+    snooze(std::chrono::duration<double>(Interval).count());
+    return true;
+}
+
+void IOThreadTuner::adjust(task_type_t type, int change) {
+    if (change == 0) {
+        return;
+    }
+    auto& config = engine->getConfiguration();
+    const auto min = config.getIoThreadAutotuneMinThreads();
+    const auto max =
+            std::max(min, config.getIoThreadAutotuneMaxThreads());
+
+    auto* pool = ExecutorPool::get();
+    const size_t current = type == READER_TASK_IDX ? pool->getMaxReaders()
+                                                   : pool->getMaxWriters();
+    size_t next = current;
+    if (change > 0) {
+        ++next;
+    } else if (next > 0) {
+        --next;
+    }
+    next = std::min(max, std::max(min, next));
+    if (next != current) {
+        pool->adjustWorkers(type, next);
+    }
+}
+
+int IOThreadTuner::Controller::update(size_t backlog,
+                                      uint64_t ops,
+                                      double latency) {
+    if (ops < prevOps) {
+        // The histograms were reset
+        prevOps = 0;
+        prevLatency = 0;
+    }
+    const auto intervalOps = ops - prevOps;
+    const auto intervalLatency = latency - prevLatency;
+    prevOps = ops;
+    prevLatency = latency;
+
+    if (backlog == 0) {
+        return ++idleIntervals >= IdleIntervalsBeforeShrink ? -1 : 0;
+    }
+    idleIntervals = 0;
+
+    if (intervalOps == 0) {
+        // Work is queued but no IO completed; nothing says the device is
+        // saturated
+        return 1;
+    }
+
+    const auto average = intervalLatency / intervalOps;
+    if (baseline == 0 || average < baseline) {
+        baseline = average;
+        return 1;
+    }
+    baseline = std::min(average, baseline * BaselineDrift);
+    return average > baseline * SaturatedLatencyRatio ? -1 : 1;
+}
+
 WorkLoadMonitor::WorkLoadMonitor(EventuallyPersistentEngine *e,
                                  bool completeBeforeShutdown) :
     GlobalTask(e, TaskId::WorkLoadMonitor, WORKLOAD_MONITOR_FREQ,
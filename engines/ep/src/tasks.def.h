@@ -30,6 +30,9 @@
 // Read IO tasks
 TASK(MultiBGFetcherTask, READER_TASK_IDX, 0)
 TASK(FetchAllKeysTask, READER_TASK_IDX, 0)
+TASK(RangeScanTask, READER_TASK_IDX, 0)
+TASK(GetMultiTask, READER_TASK_IDX, 0)
+TASK(MultiMetaFetchTask, READER_TASK_IDX, 0)
 TASK(Warmup, READER_TASK_IDX, 0)
 TASK(WarmupInitialize, READER_TASK_IDX, 0)
 TASK(WarmupCreateVBuckets, READER_TASK_IDX, 0)
@@ -37,9 +40,10 @@ TASK(WarmupEstimateDatabaseItemCount, READER_TASK_IDX, 0)
 TASK(WarmupLoadPreparedSyncWrites, READER_TASK_IDX, 0)
 TASK(WarmupKeyDump, READER_TASK_IDX, 0)
 TASK(WarmupCheckforAccessLog, READER_TASK_IDX, 0)
-TASK(WarmupLoadAccessLog, READER_TASK_IDX, 0)
-TASK(WarmupLoadingKVPairs, READER_TASK_IDX, 0)
-TASK(WarmupLoadingData, READER_TASK_IDX, 0)
+TASK(WarmupLoadAccessLog, READER_TASK_IDX, 1)
+TASK(WarmupLoadingHashTableImage, READER_TASK_IDX, 1)
+TASK(WarmupLoadingKVPairs, READER_TASK_IDX, 1)
+TASK(WarmupLoadingData, READER_TASK_IDX, 1)
 TASK(WarmupLoadingCollectionCounts, READER_TASK_IDX, 0)
 TASK(WarmupCompletion, READER_TASK_IDX, 0)
 TASK(VKeyStatBGFetchTask, READER_TASK_IDX, 3)
@@ -56,6 +60,7 @@ TASK(BackfillManagerTask, AUXIO_TASK_IDX, 8)
 // Read/Write IO tasks
 TASK(RollbackTask, WRITER_TASK_IDX, 1)
 TASK(CompactVBucketTask, WRITER_TASK_IDX, 2)
+TASK(VBucketInstallTask, WRITER_TASK_IDX, 2)
 TASK(FlusherTask, WRITER_TASK_IDX, 5)
 TASK(StatSnap, WRITER_TASK_IDX, 9)
 
@@ -69,10 +74,11 @@ TASK(ItemPagerVisitor, NONIO_TASK_IDX, 1)
 TASK(ExpiredItemPagerVisitor, NONIO_TASK_IDX, 1)
 TASK(DcpConsumerTask, NONIO_TASK_IDX, 2)
 TASK(DurabilityTimeoutTask, NONIO_TASK_IDX, 1)
-TASK(DurabilityTimeoutVisitor, NONIO_TASK_IDX, 1)
 TASK(ConnNotifierCallback, NONIO_TASK_IDX, 5)
 TASK(ClosedUnrefCheckpointRemoverTask, NONIO_TASK_IDX, 6)
 TASK(ClosedUnrefCheckpointRemoverVisitorTask, NONIO_TASK_IDX, 6)
+TASK(CheckpointRemovalTask, NONIO_TASK_IDX, 6)
+TASK(DropCollectionKeysTask, NONIO_TASK_IDX, 6)
 TASK(VBucketMemoryDeletionTask, NONIO_TASK_IDX, 6)
 TASK(StatCheckpointTask, NONIO_TASK_IDX, 7)
 TASK(DefragmenterTask, NONIO_TASK_IDX, 7)
@@ -82,5 +88,6 @@ TASK(EphTombstoneStaleItemDeleter, NONIO_TASK_IDX, 7)
 TASK(ItemFreqDecayerTask, NONIO_TASK_IDX, 7)
 TASK(ConnManager, NONIO_TASK_IDX, 8)
 TASK(WorkLoadMonitor, NONIO_TASK_IDX, 10)
+TASK(IOThreadTuner, NONIO_TASK_IDX, 10)
 TASK(HashtableResizerTask, NONIO_TASK_IDX, 211)
 TASK(HashtableResizerVisitorTask, NONIO_TASK_IDX, 7)
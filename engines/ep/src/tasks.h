@@ -95,6 +95,63 @@ private:
     std::string desc;
 };
 
+/**
+ * A task to install a data file (copied from another node) as a replica
+ * vbucket, and warm the vbucket up from it.
+ */
+class VBucketInstallTask : public GlobalTask {
+public:
+    VBucketInstallTask(EPBucket& bucket,
+                       Vbid vbid,
+                       std::string path,
+                       const void* ck);
+
+    bool run();
+
+    std::string getDescription() {
+        return desc;
+    }
+
+    std::chrono::microseconds maxExpectedDuration() {
+        // The vbucket is warmed up from the file, which takes as long as
+        // reading it does
+        return std::chrono::seconds(30);
+    }
+
+private:
+    EPBucket& bucket;
+    const Vbid vbid;
+    const std::string path;
+    const void* cookie;
+    std::string desc;
+};
+
+/**
+ * A task to drop the keys of the collections dropped from a vbucket from its
+ * hash table, once the flusher persisted the drop (see
+ * EPVBucket::dropCollectionKeys). Done as a task so the flusher doesn't have
+ * to visit the hash table.
+ */
+class DropCollectionKeysTask : public GlobalTask {
+public:
+    DropCollectionKeysTask(EventuallyPersistentEngine& e, Vbid vbid);
+
+    bool run();
+
+    std::string getDescription() {
+        return desc;
+    }
+
+    std::chrono::microseconds maxExpectedDuration() {
+        // Visits the whole hash table of the vbucket
+        return std::chrono::seconds(1);
+    }
+
+private:
+    const Vbid vbid;
+    std::string desc;
+};
+
 /**
  * A task that periodically takes a snapshot of the stats and persists them to
  * disk.
@@ -202,6 +259,82 @@ private:
     const std::string description;
 };
 
+/**
+ * A task adjusting the number of reader and writer threads of the
+ * ExecutorPool while io_thread_autotune is enabled. Every second it looks
+ * at the work queued for each type of thread (the bgfetches for the
+ * readers, the items to flush for the writers) and at the average latency
+ * of the reads (writes and syncs) of the bucket's data files since the
+ * last run, and adds or removes a thread:
+ *
+ * - if the latency is well above the lowest seen the device is taken as
+ *   saturated, so a thread is removed;
+ * - otherwise a thread is added while work is queued;
+ * - and removed once nothing has been queued for a while.
+ *
+ * The pool is shared by all of the buckets, so the counts it picks apply
+ * to (and are driven by) the bucket it is enabled for.
+ */
+class IOThreadTuner : public GlobalTask {
+public:
+    explicit IOThreadTuner(EPBucket& bucket);
+
+    bool run();
+
+    std::chrono::microseconds maxExpectedDuration() {
+        // Only reads a few stats of each shard
+        return std::chrono::milliseconds(1);
+    }
+
+    std::string getDescription() {
+        return "Adjusting the number of IO threads";
+    }
+
+    /// How often the thread counts are adjusted
+    static constexpr std::chrono::seconds Interval{1};
+
+    /// Above this multiple of the lowest latency seen the device is taken
+    /// as saturated
+    static constexpr double SaturatedLatencyRatio = 2.0;
+
+    /**
+     * How much the lowest latency seen rises each interval (so it follows
+     * a device which gets slower, e.g. as the data outgrows its cache)
+     */
+    static constexpr double BaselineDrift = 1.01;
+
+    /// The number of intervals without queued work before a thread is
+    /// removed
+    static constexpr int IdleIntervalsBeforeShrink = 10;
+
+    /// Decides how to change the number of threads of one type
+    class Controller {
+    public:
+        /**
+         * @param backlog the work queued for the threads
+         * @param ops the number of IOs done (in total)
+         * @param latency the time the IOs took (in total, any unit)
+         * @return the number of threads to add (1), or remove (-1), or 0
+         */
+        int update(size_t backlog, uint64_t ops, double latency);
+
+    private:
+        uint64_t prevOps = 0;
+        double prevLatency = 0;
+        /// The lowest average latency seen (drifting upwards)
+        double baseline = 0;
+        int idleIntervals = 0;
+    };
+
+private:
+    /// Apply the change the controller picked to the threads of the type
+    void adjust(task_type_t type, int change);
+
+    EPBucket& bucket;
+    Controller readers;
+    Controller writers;
+};
+
 /**
  * A task that monitors if a bucket is read-heavy, write-heavy, or mixed.
  */
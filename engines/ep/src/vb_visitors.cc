@@ -19,6 +19,9 @@
 
 #include "vbucket.h"
 
+#include <stdexcept>
+#include <string>
+
 VBucketVisitor::VBucketVisitor() = default;
 
 VBucketVisitor::VBucketVisitor(const VBucketFilter& filter)
@@ -41,7 +44,25 @@ PauseResumeVBAdapter::PauseResumeVBAdapter(
     : htVisitor(std::move(htVisitor)) {
 }
 
+void PauseResumeVBAdapter::setVBucketPartition(size_t partition,
+                                               size_t partitions) {
+    if (partitions == 0 || partition >= partitions) {
+        throw std::invalid_argument(
+                "PauseResumeVBAdapter::setVBucketPartition: invalid "
+                "partition " +
+                std::to_string(partition) + " of " +
+                std::to_string(partitions));
+    }
+    this->partition = partition;
+    this->partitions = partitions;
+}
+
 bool PauseResumeVBAdapter::visit(VBucket& vb) {
+    if (vb.getId().get() % partitions != partition) {
+        // Another partition's vBucket
+        return true;
+    }
+
     // Check if this vbucket_id matches the position we should resume
     // from. If so then call the visitor using our stored HashTable::Position.
     HashTable::Position ht_start;
@@ -174,6 +174,13 @@ public:
      */
     bool visit(VBucket& vb) override;
 
+    /**
+     * Only visit the vBuckets of the given partition (those with
+     * vbid % partitions == partition), so that several tasks can each visit
+     * a share of the vBuckets in parallel.
+     */
+    void setVBucketPartition(size_t partition, size_t partitions);
+
     /// Returns the current hashtable position.
     HashTable::Position getHashtablePosition() const {
         return hashtable_position;
@@ -193,4 +200,8 @@ private:
 
     // When pausing / resuming, hashtable position to use.
     HashTable::Position hashtable_position;
+
+    // The partition of the vBuckets to visit, and the number of partitions
+    size_t partition = 0;
+    size_t partitions = 1;
 };
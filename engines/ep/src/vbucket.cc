@@ -44,11 +44,15 @@
 #include <memcached/protocol_binary.h>
 #include <memcached/server_document_iface.h>
 #include <platform/compress.h>
+#include <utilities/json_validator.h>
 #include <xattr/blob.h>
 #include <xattr/utils.h>
 
 #include <gsl.h>
 #include <logtags.h>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
 #include <functional>
 #include <list>
 #include <set>
@@ -65,6 +69,65 @@ const auto MAX_CHK_FLUSH_TIMEOUT = std::chrono::seconds(30);
 cb::AtomicDuration VBucket::chkFlushTimeout(MIN_CHK_FLUSH_TIMEOUT);
 double VBucket::mutationMemThreshold = 0.9;
 
+namespace {
+bool isJsonWhitespace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/**
+ * Work out if the value will be JSON once the suffix is appended to it,
+ * looking at no more than a few bytes of the (possibly segmented) value.
+ *
+ * @return the JSON-ness of the result, or none if it can't be told without
+ *         validating the whole value
+ */
+boost::optional<bool> isJsonAfterAppend(const Blob& value,
+                                        protocol_binary_datatype_t datatype,
+                                        cb::const_char_buffer suffix) {
+    size_t bodyOffset = 0;
+    if (mcbp::datatype::is_xattr(datatype)) {
+        uint32_t xattrLen;
+        if (value.valueSize() < sizeof(xattrLen)) {
+            return {};
+        }
+        value.copyData(reinterpret_cast<char*>(&xattrLen), 0, sizeof(xattrLen));
+        bodyOffset = size_t(ntohl(xattrLen)) + sizeof(xattrLen);
+        if (bodyOffset > value.valueSize()) {
+            return {};
+        }
+    }
+    const size_t bodySize = value.valueSize() - bodyOffset;
+
+    if (mcbp::datatype::is_json(datatype)) {
+        if (bodySize != 0) {
+            // A number may carry on with the data appended
+            char last;
+            value.copyData(&last, value.valueSize() - 1, 1);
+            if (std::isdigit(static_cast<unsigned char>(last))) {
+                return {};
+            }
+        }
+        return std::all_of(suffix.begin(), suffix.end(), isJsonWhitespace);
+    }
+
+    if (bodySize == 0) {
+        return cb::json::isValid(suffix);
+    }
+
+    // The value isn't JSON; unless it's a prefix of a JSON value it won't
+    // become JSON whatever is appended.
+    char head[16];
+    const auto n = std::min(bodySize, sizeof(head));
+    value.copyData(head, bodyOffset, n);
+    const auto* first = std::find_if_not(head, head + n, isJsonWhitespace);
+    if (first != head + n &&
+        std::strchr("{[\"-0123456789tfn", *first) == nullptr) {
+        return false;
+    }
+    return {};
+}
+} // namespace
+
 VBucketFilter VBucketFilter::filter_diff(const VBucketFilter &other) const {
     std::vector<Vbid> tmp(acceptable.size() + other.size());
     std::vector<Vbid>::iterator end;
@@ -173,8 +236,16 @@ VBucket::VBucket(Vbid i,
                  uint64_t maxCas,
                  int64_t hlcEpochSeqno,
                  bool mightContainXattrs,
-                 const nlohmann::json& replTopology)
-    : ht(st, std::move(valFact), config.getHtSize(), config.getHtLocks()),
+                 const nlohmann::json& replTopology,
+                 std::shared_ptr<HashTable::Locks> htLocks)
+    : ht(st,
+         std::move(valFact),
+         config.getHtSize(),
+         config.getHtLocks(),
+         config.getHtLayout() == "grouped" ? HashTable::Layout::Grouped
+                                           : HashTable::Layout::Chained,
+         std::move(htLocks)),
+      expiryIndex(config.getExpPagerFullScanInterval() > 1),
       checkpointManager(std::make_unique<CheckpointManager>(st,
                                                             i,
                                                             chkConfig,
@@ -208,6 +279,9 @@ VBucket::VBucket(Vbid i,
       persisted_snapshot_start(lastSnapStart),
       persisted_snapshot_end(lastSnapEnd),
       receivingInitialDiskSnapshot(false),
+      bFilterLayout(config.getBfilterLayout() == "blocked"
+                            ? BloomFilter::Layout::Blocked
+                            : BloomFilter::Layout::Bitwise),
       rollbackItemCount(0),
       hlc(maxCas,
           hlcEpochSeqno,
@@ -223,6 +297,12 @@ VBucket::VBucket(Vbid i,
       seqnoAckCb(seqnoAckCb),
       manifest(std::move(manifest)),
       mayContainXattrs(mightContainXattrs) {
+    // Start each VBucket's hot key generations apart, so that a copy of a
+    // document of a deleted VBucket isn't taken as current for the one
+    // which replaces it
+    static std::atomic<uint64_t> nextHotKeyGeneration{0};
+    hotKeyGeneration = nextHotKeyGeneration.fetch_add(uint64_t(1) << 32);
+
     if (config.getConflictResolutionType().compare("lww") == 0) {
         conflictResolver.reset(new LastWriteWinsResolution());
     } else {
@@ -535,6 +615,8 @@ void VBucket::setState_UNLOCKED(
                 meta.is_null() ? ""s : (" meta:"s + meta.dump()));
 
     state = to;
+    // A replica may be rolled back without queueing the documents changed
+    bumpHotKeyGeneration();
 
     setupSyncReplication(meta.is_null() ? nlohmann::json{}
                                         : meta.at("topology"));
@@ -598,6 +680,7 @@ void VBucket::setupSyncReplication(const nlohmann::json& topology) {
             // SyncWrites.
             durabilityMonitor = std::make_unique<ActiveDurabilityMonitor>(
                     std::move(*currentPassiveDM));
+            notifySyncWriteDeadline(getActiveDM().getEarliestExpiry());
         } else if (!durabilityMonitor) {
             // Change to Active from no previous DurabilityMonitor - create
             // one.
@@ -648,14 +731,22 @@ PassiveDurabilityMonitor& VBucket::getPassiveDM() {
     return dynamic_cast<PassiveDurabilityMonitor&>(*durabilityMonitor);
 }
 
-void VBucket::processDurabilityTimeout(
+boost::optional<std::chrono::steady_clock::time_point>
+VBucket::processDurabilityTimeout(
         const std::chrono::steady_clock::time_point asOf) {
     folly::SharedMutex::ReadHolder lh(stateLock);
     // @todo-durability: Add support for DurabilityMonitor at Replica
     if (getState() != vbucket_state_active) {
-        return;
+        return {};
+    }
+    return getActiveDM().processTimeout(asOf);
+}
+
+void VBucket::notifySyncWriteDeadline(
+        boost::optional<std::chrono::steady_clock::time_point> deadline) {
+    if (deadline && syncWriteDeadlineCb) {
+        syncWriteDeadlineCb(id, *deadline);
     }
-    getActiveDM().processTimeout(asOf);
 }
 
 void VBucket::doStatsForQueueing(const Item& qi, size_t itemBytes)
@@ -775,7 +866,8 @@ ENGINE_ERROR_CODE VBucket::commit(
         const DocKey& key,
         boost::optional<int64_t> commitSeqno,
         const Collections::VB::Manifest::CachingReadHandle& cHandle,
-        const void* cookie) {
+        const void* cookie,
+        VBNotifyCtx* batchNotifyCtx) {
     auto res = ht.findForCommit(key);
     if (!res.pending) {
         // If we are committing we /should/ always find the pending item.
@@ -800,7 +892,7 @@ ENGINE_ERROR_CODE VBucket::commit(
 
     auto notify = commitStoredValue(res, queueItmCtx, commitSeqno);
 
-    notifyNewSeqno(notify);
+    notifyNewSeqnoOrMerge(notify, batchNotifyCtx);
     doCollectionsStats(cHandle, notify);
 
     // Cookie representing the client connection, provided only at Active
@@ -939,8 +1031,8 @@ void VBucket::createFilter(size_t key_count, double probability) {
     //      - Rebalance
     LockHolder lh(bfMutex);
     if (bFilter == nullptr && tempFilter == nullptr) {
-        bFilter = std::make_unique<BloomFilter>(key_count, probability,
-                                        BFILTER_ENABLED);
+        bFilter = std::make_unique<BloomFilter>(
+                key_count, probability, BFILTER_ENABLED, bFilterLayout);
     } else {
         EP_LOG_WARN("({}) Bloom filter / Temp filter already exist!", id);
     }
@@ -951,8 +1043,8 @@ void VBucket::initTempFilter(size_t key_count, double probability) {
     // if the main filter is found to exist, set its state to
     // COMPACTING as well.
     LockHolder lh(bfMutex);
-    tempFilter = std::make_unique<BloomFilter>(key_count, probability,
-                                     BFILTER_COMPACTING);
+    tempFilter = std::make_unique<BloomFilter>(
+            key_count, probability, BFILTER_COMPACTING, bFilterLayout);
     if (bFilter) {
         bFilter->setStatus(BFILTER_COMPACTING);
     }
@@ -1029,6 +1121,57 @@ void VBucket::swapFilter() {
     }
 }
 
+/// Adds the keys of the HashTable to a bloom filter
+class FilterKeysVisitor : public HashTableVisitor {
+public:
+    explicit FilterKeysVisitor(BloomFilter& filter) : filter(filter) {
+    }
+
+    bool visit(const HashTable::HashBucketLock& lh, StoredValue& v) override {
+        if (!v.isTempItem()) {
+            filter.addKey(v.getKey());
+        }
+        return true;
+    }
+
+private:
+    BloomFilter& filter;
+};
+
+std::unique_ptr<BloomFilter> VBucket::getFilterForPersistence() {
+    std::unique_ptr<BloomFilter> copy;
+    {
+        LockHolder lh(bfMutex);
+        if (!bFilter || bFilter->getStatus() != BFILTER_ENABLED) {
+            return {};
+        }
+        copy = std::make_unique<BloomFilter>(*bFilter);
+    }
+
+    if (eviction == EvictionPolicy::Full) {
+        // After a warmup the keys which are resident now may not be, so
+        // the filter needs them too. The keys evicted (or deleted) while
+        // we're visiting are added to the filter, which we merge in again
+        // once we're done.
+        FilterKeysVisitor visitor(*copy);
+        ht.visit(visitor);
+
+        LockHolder lh(bfMutex);
+        if (!bFilter || !copy->merge(*bFilter)) {
+            // The filter has been replaced in the meantime
+            return {};
+        }
+    }
+    return copy;
+}
+
+void VBucket::setFilter(std::unique_ptr<BloomFilter> filter) {
+    LockHolder lh(bfMutex);
+    if (bFilter == nullptr && tempFilter == nullptr) {
+        bFilter = std::move(filter);
+    }
+}
+
 void VBucket::clearFilter() {
     LockHolder lh(bfMutex);
     bFilter.reset();
@@ -1084,6 +1227,9 @@ VBNotifyCtx VBucket::queueItem(queued_item& item, const VBQueueItemCtx& ctx) {
         durLock.lock();
     }
 
+    // The document queued has changed
+    bumpHotKeyGeneration();
+
     VBNotifyCtx notifyCtx;
     if (ctx.isBackfillItem) {
         queueBackfillItem(item, ctx.genBySeqno);
@@ -1110,13 +1256,23 @@ VBNotifyCtx VBucket::queueItem(queued_item& item, const VBQueueItemCtx& ctx) {
     }
     notifyCtx.bySeqno = item->getBySeqno();
 
+    if (item->isPending()) {
+        const auto level = item->getDurabilityReqs().getLevel();
+        if (level == cb::durability::Level::MajorityAndPersistOnMaster ||
+            level == cb::durability::Level::PersistToMajority) {
+            durablePrepareSeqno.store(item->getBySeqno());
+            notifyCtx.durablePrepare = true;
+        }
+    }
+
     // Process Durability items (notify the DurabilityMonitor of
     // Prepare/Commit/Abort)
     switch (state) {
     case vbucket_state_active:
         if (item->isPending()) {
             Expects(ctx.durability.is_initialized());
-            getActiveDM().addSyncWrite(ctx.durability->cookie, item);
+            notifySyncWriteDeadline(getActiveDM().addSyncWrite(
+                    ctx.durability->cookie, item));
         }
         break;
     case vbucket_state_replica:
@@ -1170,6 +1326,10 @@ VBNotifyCtx VBucket::queueDirty(const HashTable::HashBucketLock& hbl,
         setMightContainXattrs();
     }
 
+    if (v.getExptime() != 0 && !v.isDeleted() && v.isCommitted()) {
+        expiryIndex.add(v.getKey(), v.getExptime());
+    }
+
     // Enqueue the item for persistence and replication
     VBNotifyCtx notifyCtx = queueItem(qi, ctx);
 
@@ -1338,6 +1498,13 @@ MutationStatus VBucket::setFromInternal(Item& itm) {
     return ht.set(itm);
 }
 
+MutationStatus VBucket::setNonResidentFromInternal(const Item& itm) {
+    if (!hasMemoryForStoredValue(stats, itm, UseActiveVBMemThreshold::Yes)) {
+        return MutationStatus::NoMem;
+    }
+    return ht.setNonResident(itm);
+}
+
 cb::StoreIfStatus VBucket::callPredicate(cb::StoreIfPredicate predicate,
                                          StoredValue* v) {
     cb::StoreIfStatus storeIfStatus = cb::StoreIfStatus::Continue;
@@ -1374,6 +1541,27 @@ ENGINE_ERROR_CODE VBucket::set(
         return ret;
     }
 
+    ret = setWithoutCommit(itm, cookie, engine, predicate, cHandle);
+
+    // Commit if possible. This allows us to do "durable" sets in the case where
+    // we have no replicas (i.e. every set should be completed immediately).
+    // We can't do this when we add the SyncWrite because the general use case
+    // is to commit on replica ack. This requires doing a find against the
+    // HashTable (requires locking the HashBucket) which would result in a
+    // deadlock if we did it inside the addSyncWrite call. To keep things
+    // simple, just commit after doing the set.
+    getActiveDM().checkForCommit();
+
+    return ret;
+}
+
+ENGINE_ERROR_CODE VBucket::setWithoutCommit(
+        Item& itm,
+        const void* cookie,
+        EventuallyPersistentEngine& engine,
+        cb::StoreIfPredicate predicate,
+        const Collections::VB::Manifest::CachingReadHandle& cHandle) {
+    ENGINE_ERROR_CODE ret = ENGINE_SUCCESS;
     bool cas_op = (itm.getCas() != 0);
 
     { // HashBucketLock scope
@@ -1476,15 +1664,6 @@ ENGINE_ERROR_CODE VBucket::set(
         }
     }
 
-    // Commit if possible. This allows us to do "durable" sets in the case where
-    // we have no replicas (i.e. every set should be completed immediately).
-    // We can't do this when we add the SyncWrite because the general use case
-    // is to commit on replica ack. This requires doing a find against the
-    // HashTable (requires locking the HashBucket) which would result in a
-    // deadlock if we did it inside the addSyncWrite call. To keep things
-    // simple, just commit after doing the set.
-    getActiveDM().checkForCommit();
-
     return ret;
 }
 
@@ -1696,7 +1875,8 @@ ENGINE_ERROR_CODE VBucket::setWithMeta(
         bool allowExisting,
         GenerateBySeqno genBySeqno,
         GenerateCas genCas,
-        const Collections::VB::Manifest::CachingReadHandle& cHandle) {
+        const Collections::VB::Manifest::CachingReadHandle& cHandle,
+        VBNotifyCtx* batchNotifyCtx) {
     auto htRes = ht.findForWrite(itm.getKey());
     auto* v = htRes.storedValue;
     auto& hbl = htRes.lock;
@@ -1801,7 +1981,7 @@ ENGINE_ERROR_CODE VBucket::setWithMeta(
         // we unlock ht lock here because we want to avoid potential lock
         // inversions arising from notifyNewSeqno() call
         hbl.getHTLock().unlock();
-        notifyNewSeqno(*notifyCtx);
+        notifyNewSeqnoOrMerge(*notifyCtx, batchNotifyCtx);
         doCollectionsStats(cHandle, *notifyCtx);
     } break;
     case MutationStatus::NotFound:
@@ -2471,7 +2651,15 @@ GetValue VBucket::getInternal(
                                      v->isLocked(ep_current_time())
                              ? StoredValue::HideLockedCas::Yes
                              : StoredValue::HideLockedCas::No);
+            // A value appended to in place is made contiguous once (and the
+            // segments freed), rather than by every read
+            const auto* blob = v->peekValueBlob();
+            if (blob && blob->isSegmented()) {
+                v->reallocate();
+            }
             item = v->toItem(getId(), hideLockedCas);
+            // Tell the caller how hot the document is
+            item->setFreqCounterValue(v->getFreqCounterValue());
         }
 
         if (options & TRACK_STATISTICS) {
@@ -2514,6 +2702,19 @@ ENGINE_ERROR_CODE VBucket::getMetaData(
         ItemMetaData& metadata,
         uint32_t& deleted,
         uint8_t& datatype) {
+    auto ret = getMetaDataWithoutBgFetch(cHandle, metadata, deleted, datatype);
+    if (ret == ENGINE_EWOULDBLOCK) {
+        // Need bg meta fetch.
+        bgFetch(cHandle.getKey(), cookie, engine, true);
+    }
+    return ret;
+}
+
+ENGINE_ERROR_CODE VBucket::getMetaDataWithoutBgFetch(
+        const Collections::VB::Manifest::CachingReadHandle& cHandle,
+        ItemMetaData& metadata,
+        uint32_t& deleted,
+        uint8_t& datatype) {
     deleted = 0;
     auto htRes = ht.findForWrite(cHandle.getKey());
     auto* v = htRes.storedValue;
@@ -2522,8 +2723,7 @@ ENGINE_ERROR_CODE VBucket::getMetaData(
     if (v) {
         stats.numOpsGetMeta++;
         if (v->isTempInitialItem()) {
-            // Need bg meta fetch.
-            bgFetch(cHandle.getKey(), cookie, engine, true);
+            // The metadata is being fetched
             return ENGINE_EWOULDBLOCK;
         } else if (v->isTempNonExistentItem()) {
             metadata.cas = v->getCas();
@@ -2552,15 +2752,20 @@ ENGINE_ERROR_CODE VBucket::getMetaData(
         // The key wasn't found. However, this may be because it was previously
         // deleted or evicted with the full eviction strategy.
         // So, add a temporary item corresponding to the key to the hash table
-        // and schedule a background fetch for its metadata from the persistent
-        // store. The item's state will be updated after the fetch completes.
+        // for a background fetch of its metadata from the persistent store.
+        // The item's state will be updated after the fetch completes.
         //
-        // Schedule this bgFetch only if the key is predicted to be may-be
-        // existent on disk by the bloomfilter.
+        // Only fetch if the key is predicted to be may-be existent on disk by
+        // the bloomfilter.
 
         if (maybeKeyExistsInFilter(cHandle.getKey())) {
-            return addTempItemAndBGFetch(
-                    hbl, cHandle.getKey(), cookie, engine, true);
+            switch (addTempStoredValue(hbl, cHandle.getKey()).status) {
+            case TempAddStatus::NoMem:
+                return ENGINE_ENOMEM;
+            case TempAddStatus::BgFetch:
+                return ENGINE_EWOULDBLOCK;
+            }
+            folly::assume_unreachable();
         } else {
             stats.numOpsGetMeta++;
             return ENGINE_KEY_ENOENT;
@@ -2650,6 +2855,7 @@ GetValue VBucket::getLocked(
 
         // acquire lock and increment cas value
         v->lock(currentTime + lockTimeout);
+        bumpHotKeyGeneration();
 
         auto it = v->toItem(getId());
         it->setCas(nextHLCCas());
@@ -2681,6 +2887,243 @@ GetValue VBucket::getLocked(
     folly::assume_unreachable();
 }
 
+GetValue VBucket::update(
+        uint64_t cas,
+        const cb::UpdateFunction& update,
+        std::chrono::seconds maxTtl,
+        const void* cookie,
+        EventuallyPersistentEngine& engine,
+        const Collections::VB::Manifest::CachingReadHandle& cHandle) {
+    auto res = fetchValueForWrite(cHandle, QueueExpired::Yes);
+    auto* v = res.storedValue;
+    switch (res.status) {
+    case FetchForWriteResult::Status::OkFound:
+        if (!isLogicallyNonExistent(*v, cHandle) && !v->isResident()) {
+            // The value must be read before it's updated
+            bgFetch(cHandle.getKey(), cookie, engine);
+            return GetValue(nullptr, ENGINE_EWOULDBLOCK, -1, true);
+        }
+        break;
+    case FetchForWriteResult::Status::OkVacant:
+        if (eviction == EvictionPolicy::Full &&
+            maybeKeyExistsInFilter(cHandle.getKey())) {
+            ENGINE_ERROR_CODE ec = addTempItemAndBGFetch(
+                    res.lock, cHandle.getKey(), cookie, engine, false);
+            return GetValue(nullptr, ec, -1, true);
+        }
+        break;
+    case FetchForWriteResult::Status::ESyncWriteInProgress:
+        return GetValue(nullptr, ENGINE_SYNC_WRITE_IN_PROGRESS);
+    }
+
+    // Give the current document (if any) to the update function
+    const bool exists = v && !isLogicallyNonExistent(*v, cHandle);
+    std::unique_ptr<Item> old;
+    item_info info;
+    if (exists) {
+        if (cas != 0 && cas != v->getCas()) {
+            return GetValue(nullptr, ENGINE_KEY_EEXISTS);
+        }
+        if (v->isLocked(ep_current_time()) && cas != v->getCas()) {
+            return GetValue(nullptr, ENGINE_LOCKED);
+        }
+        old = v->toItem(getId());
+        if (!old->decompressValue()) {
+            return GetValue(nullptr, ENGINE_ENOMEM);
+        }
+        info = old->toItemInfo(failovers->getLatestUUID(),
+                               getHLCEpochSeqno());
+    } else if (cas != 0) {
+        return GetValue(nullptr, ENGINE_KEY_ENOENT);
+    }
+
+    cb::UpdatedDocument document;
+    const auto status = update(exists ? &info : nullptr, document);
+    if (status != cb::engine_errc::success) {
+        return GetValue(nullptr, ENGINE_ERROR_CODE(status));
+    }
+    if (document.value.size() > engine.getMaxItemSize()) {
+        return GetValue(nullptr, ENGINE_E2BIG);
+    }
+
+    // A document updated keeps its flags and expiry time
+    time_t exptime = old ? old->getExptime() : 0;
+    if (!old && document.exptime != 0) {
+        exptime = ep_abs_time(ep_reltime(document.exptime));
+    }
+    auto itm = std::make_unique<Item>(cHandle.getKey(),
+                                      old ? old->getFlags() : document.flags,
+                                      exptime,
+                                      document.value.data(),
+                                      document.value.size(),
+                                      document.datatype,
+                                      0 /*cas*/,
+                                      -1 /*seq*/,
+                                      getId());
+    cHandle.processExpiryTime(*itm, maxTtl);
+
+    PreLinkDocumentContext preLinkDocumentContext(engine, cookie, itm.get());
+    VBQueueItemCtx queueItmCtx;
+    queueItmCtx.preLinkDocumentContext = &preLinkDocumentContext;
+    MutationStatus mutationStatus;
+    boost::optional<VBNotifyCtx> notifyCtx;
+    std::tie(mutationStatus, notifyCtx) =
+            processSet(res.lock,
+                       v,
+                       *itm,
+                       cas,
+                       /*allowExisting*/ true,
+                       /*hasMetaData*/ false,
+                       queueItmCtx,
+                       cb::StoreIfStatus::Continue);
+    switch (mutationStatus) {
+    case MutationStatus::NoMem:
+        return GetValue(nullptr, ENGINE_ENOMEM);
+    case MutationStatus::InvalidCas:
+        return GetValue(nullptr, ENGINE_KEY_EEXISTS);
+    case MutationStatus::IsLocked:
+        return GetValue(nullptr, ENGINE_LOCKED);
+    case MutationStatus::NotFound:
+        return GetValue(nullptr, ENGINE_KEY_ENOENT);
+    case MutationStatus::WasDirty:
+    case MutationStatus::WasClean:
+        notifyNewSeqno(*notifyCtx);
+        doCollectionsStats(cHandle, *notifyCtx);
+        itm->setBySeqno(v->getBySeqno());
+        itm->setCas(v->getCas());
+        return GetValue(std::move(itm));
+    case MutationStatus::NeedBgFetch:
+        // The document is always resident (or known not to exist) here
+        throw std::logic_error(
+                "VBucket::update: unexpected NeedBgFetch for a resident "
+                "document");
+    case MutationStatus::IsPendingSyncWrite:
+        return GetValue(nullptr, ENGINE_SYNC_WRITE_IN_PROGRESS);
+    }
+    folly::assume_unreachable();
+}
+
+GetValue VBucket::append(
+        uint64_t cas,
+        cb::const_char_buffer value,
+        size_t maxSegments,
+        std::chrono::seconds maxTtl,
+        const void* cookie,
+        EventuallyPersistentEngine& engine,
+        const Collections::VB::Manifest::CachingReadHandle& cHandle) {
+    if (maxSegments == 0) {
+        return GetValue(nullptr, ENGINE_ENOTSUP);
+    }
+
+    auto res = fetchValueForWrite(cHandle, QueueExpired::Yes);
+    auto* v = res.storedValue;
+    switch (res.status) {
+    case FetchForWriteResult::Status::OkFound:
+        if (!isLogicallyNonExistent(*v, cHandle) && !v->isResident()) {
+            // The value must be read before it's appended to
+            bgFetch(cHandle.getKey(), cookie, engine);
+            return GetValue(nullptr, ENGINE_EWOULDBLOCK, -1, true);
+        }
+        break;
+    case FetchForWriteResult::Status::OkVacant:
+        if (eviction == EvictionPolicy::Full &&
+            maybeKeyExistsInFilter(cHandle.getKey())) {
+            ENGINE_ERROR_CODE ec = addTempItemAndBGFetch(
+                    res.lock, cHandle.getKey(), cookie, engine, false);
+            return GetValue(nullptr, ec, -1, true);
+        }
+        break;
+    case FetchForWriteResult::Status::ESyncWriteInProgress:
+        return GetValue(nullptr, ENGINE_SYNC_WRITE_IN_PROGRESS);
+    }
+
+    if (!v || isLogicallyNonExistent(*v, cHandle)) {
+        return GetValue(nullptr, ENGINE_KEY_ENOENT);
+    }
+    if (cas != 0 && cas != v->getCas()) {
+        return GetValue(nullptr, ENGINE_KEY_EEXISTS);
+    }
+    if (v->isLocked(ep_current_time()) && cas != v->getCas()) {
+        return GetValue(nullptr, ENGINE_LOCKED);
+    }
+
+    const auto datatype = v->getDatatype();
+    const auto old = v->getValue();
+    if (!old || mcbp::datatype::is_snappy(datatype) ||
+        old->getSegmentCount() >= maxSegments) {
+        return GetValue(nullptr, ENGINE_ENOTSUP);
+    }
+    const auto json = isJsonAfterAppend(*old, datatype, value);
+    if (!json) {
+        return GetValue(nullptr, ENGINE_ENOTSUP);
+    }
+    if (old->valueSize() + value.size() > engine.getMaxItemSize()) {
+        return GetValue(nullptr, ENGINE_E2BIG);
+    }
+
+    protocol_binary_datatype_t newDatatype =
+            datatype & ~PROTOCOL_BINARY_DATATYPE_JSON;
+    if (*json) {
+        newDatatype |= PROTOCOL_BINARY_DATATYPE_JSON;
+    }
+    Item itm(cHandle.getKey(),
+             v->getFlags(),
+             v->getExptime(),
+             value_t(Blob::NewAppended(*old, value.data(), value.size())),
+             newDatatype,
+             0 /*cas*/,
+             -1 /*seq*/,
+             getId());
+    cHandle.processExpiryTime(itm, maxTtl);
+
+    VBQueueItemCtx queueItmCtx;
+    MutationStatus mutationStatus;
+    boost::optional<VBNotifyCtx> notifyCtx;
+    std::tie(mutationStatus, notifyCtx) =
+            processSet(res.lock,
+                       v,
+                       itm,
+                       cas,
+                       /*allowExisting*/ true,
+                       /*hasMetaData*/ false,
+                       queueItmCtx,
+                       cb::StoreIfStatus::Continue);
+    switch (mutationStatus) {
+    case MutationStatus::NoMem:
+        return GetValue(nullptr, ENGINE_ENOMEM);
+    case MutationStatus::InvalidCas:
+        return GetValue(nullptr, ENGINE_KEY_EEXISTS);
+    case MutationStatus::IsLocked:
+        return GetValue(nullptr, ENGINE_LOCKED);
+    case MutationStatus::NotFound:
+        return GetValue(nullptr, ENGINE_KEY_ENOENT);
+    case MutationStatus::WasDirty:
+    case MutationStatus::WasClean: {
+        notifyNewSeqno(*notifyCtx);
+        doCollectionsStats(cHandle, *notifyCtx);
+        // Return the document without its value so that the caller doesn't
+        // make the new value contiguous
+        auto ret = std::make_unique<Item>(cHandle.getKey(),
+                                          itm.getFlags(),
+                                          itm.getExptime(),
+                                          value_t{},
+                                          newDatatype,
+                                          v->getCas(),
+                                          v->getBySeqno(),
+                                          getId());
+        return GetValue(std::move(ret));
+    }
+    case MutationStatus::NeedBgFetch:
+        // The document is always resident here
+        throw std::logic_error(
+                "VBucket::append: unexpected NeedBgFetch for a resident "
+                "document");
+    case MutationStatus::IsPendingSyncWrite:
+        return GetValue(nullptr, ENGINE_SYNC_WRITE_IN_PROGRESS);
+    }
+    folly::assume_unreachable();
+}
+
 void VBucket::deletedOnDiskCbk(const Item& queuedItem, bool deleted) {
     auto handle = manifest->lock(queuedItem.getKey());
     auto res = fetchValidValue(
@@ -2818,6 +3261,7 @@ void VBucket::_addStats(bool details,
                 c);
         addStat("ht_cache_size", ht.getCacheSize(), add_stat, c);
         addStat("ht_size", ht.getSize(), add_stat, c);
+        addStat("expiry_index_keys", expiryIndex.size(), add_stat, c);
         addStat("num_ejects", ht.getNumEjects(), add_stat, c);
         addStat("ops_create", opsCreate.load(), add_stat, c);
 	addStat("ops_delete", opsDelete.load(), add_stat, c);
@@ -3259,6 +3703,20 @@ void VBucket::notifyNewSeqno(
     }
 }
 
+void VBucket::notifyNewSeqnoOrMerge(const VBNotifyCtx& notifyCtx,
+                                    VBNotifyCtx* batchNotifyCtx) {
+    if (!batchNotifyCtx) {
+        notifyNewSeqno(notifyCtx);
+        return;
+    }
+    batchNotifyCtx->bySeqno =
+            std::max(batchNotifyCtx->bySeqno, notifyCtx.bySeqno);
+    batchNotifyCtx->notifyReplication |= notifyCtx.notifyReplication;
+    batchNotifyCtx->notifyFlusher |= notifyCtx.notifyFlusher;
+    batchNotifyCtx->durablePrepare |= notifyCtx.durablePrepare;
+    batchNotifyCtx->itemCountDifference += notifyCtx.itemCountDifference;
+}
+
 void VBucket::doCollectionsStats(
         const Collections::VB::Manifest::CachingReadHandle& cHandle,
         const VBNotifyCtx& notifyCtx) {
@@ -3414,9 +3872,9 @@ std::unique_ptr<Item> VBucket::pruneXattrDocument(
     // Need to take a copy of the value, prune it, and add it back
 
     // Create work-space document
-    std::vector<char> workspace(
-            v.getValue()->getData(),
-            v.getValue()->getData() + v.getValue()->valueSize());
+    const auto value = v.getValue();
+    std::vector<char> workspace(value->getData(),
+                                value->getData() + value->valueSize());
 
     // Now attach to the XATTRs in the document
     cb::xattr::Blob xattr({workspace.data(), workspace.size()},
@@ -3493,6 +3951,15 @@ void VBucket::setFreqSaturatedCallback(std::function<void()> callbackFunction) {
     ht.setFreqSaturatedCallback(callbackFunction);
 }
 
+void VBucket::setSyncWriteDeadlineCallback(
+        SyncWriteDeadlineCallback callbackFunction) {
+    folly::SharedMutex::WriteHolder wlh(stateLock);
+    syncWriteDeadlineCb = std::move(callbackFunction);
+    if (getState() == vbucket_state_active && durabilityMonitor) {
+        notifySyncWriteDeadline(getActiveDM().getEarliestExpiry());
+    }
+}
+
 ENGINE_ERROR_CODE VBucket::checkDurabilityRequirements(const Item& item) {
     if (item.isPending()) {
         if (!isValidDurabilityLevel(item.getDurabilityReqs().getLevel())) {
@@ -21,6 +21,7 @@
 #include "checkpoint_config.h"
 #include "collections/vbucket_manifest.h"
 #include "dcp/dcp-types.h"
+#include "expiry_index.h"
 #include "hash_table.h"
 #include "hlc.h"
 #include "item_pager.h"
@@ -67,6 +68,8 @@ struct VBNotifyCtx {
     int64_t bySeqno = 0;
     bool notifyReplication = false;
     bool notifyFlusher = false;
+    // A prepare whose level requires persistence was queued
+    bool durablePrepare = false;
 
     // The number that should be added to the item count due to the performed
     // operation (+1 for new, -1 for delete, 0 for update of existing doc)
@@ -179,6 +182,14 @@ using SeqnoAckCallback = std::function<void(Vbid vbid, int64_t seqno)>;
 /// Instance of SeqnoAckCallback which does nothing.
 const SeqnoAckCallback NoopSeqnoAckCb = [](Vbid vbid, int64_t seqno) {};
 
+/**
+ * Callback function invoked at Active with the time a SyncWrite tracked by
+ * the VBucket may time out at, for the DurabilityTimeoutTask to process the
+ * VBucket then.
+ */
+using SyncWriteDeadlineCallback = std::function<void(
+        Vbid vbid, std::chrono::steady_clock::time_point deadline)>;
+
 class EventuallyPersistentEngine;
 class FailoverTable;
 class KVShard;
@@ -218,7 +229,8 @@ public:
             uint64_t maxCas = 0,
             int64_t hlcEpochSeqno = HlcCasSeqnoUninitialised,
             bool mightContainXattrs = false,
-            const nlohmann::json& replTopology = {});
+            const nlohmann::json& replTopology = {},
+            std::shared_ptr<HashTable::Locks> htLocks = {});
 
     virtual ~VBucket();
 
@@ -230,6 +242,21 @@ public:
      */
     int64_t getHighSeqno() const;
 
+    /**
+     * Get the vBucket's hot key generation, which changes whenever a
+     * document of the vBucket is changed (or locked / unlocked), so that a
+     * copy of a document made at a generation is still current as long as
+     * the vBucket is at that generation (see HotKeyCache).
+     */
+    uint64_t getHotKeyGeneration() const {
+        return hotKeyGeneration;
+    }
+
+    /// Invalidate all the copies made of the vBucket's documents
+    void bumpHotKeyGeneration() {
+        hotKeyGeneration++;
+    }
+
     /**
      * Get the vBucket's high_prepared_seqno. This is the sequence number of
      * the highest prepared SyncWrite which has locally met its durability
@@ -416,6 +443,18 @@ public:
         persistenceSeqno.store(seqno);
     }
 
+    /**
+     * @return true if a prepare whose level requires persistence
+     *         (MajorityAndPersistOnMaster / PersistToMajority) has been
+     *         queued but not persisted yet
+     */
+    bool hasPendingDurablePrepare() const {
+        const auto seqno = durablePrepareSeqno.load();
+        // A prepare above the high seqno was rolled back
+        return seqno > getPersistenceSeqno() &&
+               seqno <= uint64_t(getHighSeqno());
+    }
+
     Vbid getId() const {
         return id;
     }
@@ -458,9 +497,11 @@ public:
      * Enforce timeout for the expired SyncWrites in this VBucket.
      *
      * @param asOf The time to be compared with tracked-SWs' expiry-time
+     * @return the earliest expiry-time of the SyncWrites still tracked, none
+     *         if none of them expires (or the VBucket isn't active)
      */
-    void processDurabilityTimeout(
-            const std::chrono::steady_clock::time_point asOf);
+    boost::optional<std::chrono::steady_clock::time_point>
+    processDurabilityTimeout(const std::chrono::steady_clock::time_point asOf);
 
     /**
      * This method performs operations on the stored value prior
@@ -577,6 +618,14 @@ public:
      */
     virtual vb_bgfetch_queue_t getBGFetchItems() = 0;
 
+    /**
+     * Called once the items returned by getBGFetchItems() have been read:
+     * moves the fetches of the same keys queued while they were being read
+     * (which can use the same result) into fetches, so they are completed
+     * along with them.
+     */
+    virtual void takeAttachedBGFetchItems(vb_bgfetch_queue_t& fetches) = 0;
+
     virtual bool hasPendingBGFetchItems() = 0;
 
     static const char* toString(vbucket_state_t s);
@@ -660,6 +709,22 @@ public:
     size_t getFilterSize();
     size_t getNumOfKeysInFilter();
 
+    /**
+     * Get a copy of the bloom filter to write to disk, which covers all of
+     * the keys the vBucket needs it to after a warmup (i.e. under full
+     * eviction it also has the keys currently resident). Must be called
+     * after reading the persisted seqno the copy will be valid for.
+     *
+     * @return nullptr if there is no enabled filter
+     */
+    std::unique_ptr<BloomFilter> getFilterForPersistence();
+
+    /**
+     * Use the given filter (read from disk) as the bloom filter, if the
+     * vBucket doesn't have one yet.
+     */
+    void setFilter(std::unique_ptr<BloomFilter> filter);
+
     uint64_t nextHLCCas() {
         return hlc.nextHLC();
     }
@@ -867,6 +932,9 @@ public:
 
     HashTable ht;
 
+    /// The keys with an expiry time, for the expiry pager
+    ExpiryIndex expiryIndex;
+
     /// Manager of this vBucket's checkpoints. unique_ptr for pimpl.
     std::unique_ptr<CheckpointManager> checkpointManager;
 
@@ -1025,6 +1093,18 @@ public:
      */
     MutationStatus setFromInternal(Item& itm);
 
+    /**
+     * As setFromInternal, but only for the metadata of the item: the value
+     * is left on disk and will be fetched when needed. Used by rollback
+     * (of a persistent vbucket) to avoid reading the value of every item it
+     * reverts.
+     *
+     * @param itm Item (metadata) to be added or updated
+     *
+     * @return Result indicating the status of the operation
+     */
+    MutationStatus setNonResidentFromInternal(const Item& itm);
+
     /**
      * Set (add new or update) an item in the vbucket.
      *
@@ -1045,6 +1125,30 @@ public:
             cb::StoreIfPredicate predicate,
             const Collections::VB::Manifest::CachingReadHandle& cHandle);
 
+    /**
+     * As set(), except that the item's durability requirements aren't
+     * checked (see checkDurabilityRequirements()) and a SyncWrite already
+     * satisfied isn't committed. For setting a batch of items with the
+     * same requirements, after which the caller commits all of the
+     * satisfied SyncWrites at once with getActiveDM().checkForCommit().
+     */
+    ENGINE_ERROR_CODE setWithoutCommit(
+            Item& itm,
+            const void* cookie,
+            EventuallyPersistentEngine& engine,
+            cb::StoreIfPredicate predicate,
+            const Collections::VB::Manifest::CachingReadHandle& cHandle);
+
+    /**
+     * Check if the durability requirements of the given item can be satisfied
+     * by this vBucket.
+     *
+     * @param item The durable write
+     * @return ENGINE_SUCCESS if durability is possible, appropriate error code
+     *         to return if not
+     */
+    ENGINE_ERROR_CODE checkDurabilityRequirements(const Item& item);
+
     /**
      * Replace (overwrite existing) an item in the vbucket.
      *
@@ -1094,6 +1198,9 @@ public:
      * @param genBySeqno whether or not to generate sequence number
      * @param genCas
      * @param cHandle Collections readhandle (caching mode) for this key
+     * @param batchNotifyCtx if non-null, the new seqno notification is merged
+     *        into it (instead of made), for the caller to make one
+     *        notification for a batch of sets with notifyBatch()
      *
      * @return the result of the store operation
      */
@@ -1107,7 +1214,16 @@ public:
             bool allowExisting,
             GenerateBySeqno genBySeqno,
             GenerateCas genCas,
-            const Collections::VB::Manifest::CachingReadHandle& cHandle);
+            const Collections::VB::Manifest::CachingReadHandle& cHandle,
+            VBNotifyCtx* batchNotifyCtx = nullptr);
+
+    /**
+     * Make the new seqno notification held back by setWithMeta or commit
+     * calls given batchNotifyCtx.
+     */
+    void notifyBatch(const VBNotifyCtx& batchNotifyCtx) {
+        notifyNewSeqno(batchNotifyCtx);
+    }
 
     /**
      * Delete an item in the vbucket
@@ -1231,6 +1347,19 @@ public:
     virtual bool eligibleToPageOut(const HashTable::HashBucketLock& lh,
                                    const StoredValue& v) const = 0;
 
+    /**
+     * Estimate the memory paging out a StoredValue (which is eligible to be
+     * paged out) would release.
+     *
+     * @param lh Bucket lock associated with the StoredValue.
+     * @param v Reference to the StoredValue to be ejected.
+     *
+     * @return the number of bytes released; 0 if paging out the StoredValue
+     *         would not release any memory.
+     */
+    virtual size_t getPageOutGain(const HashTable::HashBucketLock& lh,
+                                  const StoredValue& v) const = 0;
+
     /**
      * Add an item in the store
      *
@@ -1330,6 +1459,28 @@ public:
             uint32_t& deleted,
             uint8_t& datatype);
 
+    /**
+     * Retrieve the meta data for given key as getMetaData does, but without
+     * scheduling a background fetch when it isn't in memory. The caller may
+     * then fetch the metadata of a batch of keys together, completing each
+     * with completeBGFetchForSingleItem.
+     *
+     * @param cHandle Collections readhandle (caching mode) for this key
+     * @param[out] metadata meta information returned to the caller
+     * @param[out] deleted specifies the caller whether or not the key is
+     *                     deleted
+     * @param[out] datatype specifies the datatype of the item
+     *
+     * @return the result of the operation, ENGINE_EWOULDBLOCK if the
+     *         metadata must be fetched from disk (a temp initial item for
+     *         the key is in the hash table)
+     */
+    ENGINE_ERROR_CODE getMetaDataWithoutBgFetch(
+            const Collections::VB::Manifest::CachingReadHandle& cHandle,
+            ItemMetaData& metadata,
+            uint32_t& deleted,
+            uint8_t& datatype);
+
     /**
      * Looks up the key stats for the given {vbucket, key}.
      *
@@ -1369,6 +1520,58 @@ public:
             EventuallyPersistentEngine& engine,
             const Collections::VB::Manifest::CachingReadHandle& cHandle);
 
+    /**
+     * Update a document in place: compute its new value from the current
+     * one with the update function and store it, all under the hash bucket
+     * lock (so no other mutation of the document can come in between).
+     *
+     * @param cas only update the document if it has this CAS (if non-zero)
+     * @param update the function computing the new value of the document
+     * @param maxTtl the bucket's maximum TTL
+     * @param cookie The client's cookie
+     * @param engine Reference to ep engine
+     * @param cHandle Collections readhandle (caching mode) for this key
+     *
+     * @return the result of the operation (contains the document stored on
+     *         success)
+     */
+    GetValue update(
+            uint64_t cas,
+            const cb::UpdateFunction& update,
+            std::chrono::seconds maxTtl,
+            const void* cookie,
+            EventuallyPersistentEngine& engine,
+            const Collections::VB::Manifest::CachingReadHandle& cHandle);
+
+    /**
+     * Append data to the value of an existing document without copying
+     * its current value: the new value is a segmented Blob referring to
+     * the current one (see Blob::NewAppended). The flags, expiry time and
+     * datatype of the document are kept (the JSON bit is updated).
+     *
+     * @param cas only update the document if it has this CAS (if non-zero)
+     * @param value the data to append
+     * @param maxSegments the maximum number of segments of the new value
+     * @param maxTtl the bucket's maximum TTL
+     * @param cookie The client's cookie
+     * @param engine Reference to ep engine
+     * @param cHandle Collections readhandle (caching mode) for this key
+     *
+     * @return the result of the operation (contains the document stored,
+     *         without its value, on success). ENGINE_ENOTSUP if the value
+     *         must be copied to append to it (it's compressed, already has
+     *         maxSegments segments or its datatype can't be told cheaply),
+     *         so the caller should update it instead.
+     */
+    GetValue append(
+            uint64_t cas,
+            cb::const_char_buffer value,
+            size_t maxSegments,
+            std::chrono::seconds maxTtl,
+            const void* cookie,
+            EventuallyPersistentEngine& engine,
+            const Collections::VB::Manifest::CachingReadHandle& cHandle);
+
     /**
      * Perform a commit against the given pending Sync Write.
      *
@@ -1378,12 +1581,15 @@ public:
      *                    by the CheckpointManager.
      * @param cookie (Optional) The cookie representing the client connection,
      *     must be provided if the operation needs to be notified to a client
+     * @param batchNotifyCtx if non-null, the new seqno notification is merged
+     *        into it (as setWithMeta) for a batch of commits
      */
     ENGINE_ERROR_CODE commit(
             const DocKey& key,
             boost::optional<int64_t> commitSeqno,
             const Collections::VB::Manifest::CachingReadHandle& cHandle,
-            const void* cookie = nullptr);
+            const void* cookie = nullptr,
+            VBNotifyCtx* batchNotifyCtx = nullptr);
 
     /**
      * Perform an abort against the given pending Sync Write.
@@ -1458,7 +1664,9 @@ public:
      * @param endSeqno requested end sequence number of the backfill
      *
      * @return pointer to the backfill object created. Caller to own this
-     *         object and hence must handle deletion.
+     *         object and hence must handle deletion. nullptr if the stream
+     *         joined a backfill already created for another stream (which
+     *         will send the stream its items).
      */
     virtual std::unique_ptr<DCPBackfill> createDCPBackfill(
             EventuallyPersistentEngine& e,
@@ -1501,6 +1709,17 @@ public:
      */
     void setFreqSaturatedCallback(std::function<void()> callbackFunction);
 
+    /**
+     * Sets the callback function to invoke with the expiry-time of each
+     * SyncWrite tracked at Active (see SyncWriteDeadlineCallback). The
+     * earliest expiry-time of the SyncWrites already tracked is passed
+     * straight away.
+     *
+     * @param callbackFunction - the function to callback.
+     */
+    void setSyncWriteDeadlineCallback(
+            SyncWriteDeadlineCallback callbackFunction);
+
     /**
      * Returns the number of deletes in the memory
      *
@@ -1563,6 +1782,11 @@ public:
      */
     static void setMutationMemoryThreshold(size_t memThreshold);
 
+    /// @return the memory threshold (as a ratio of the bucket quota)
+    static double getMutationMemoryThreshold() {
+        return mutationMemThreshold;
+    }
+
     /**
      * Check if this StoredValue has become logically non-existent.
      * By logically non-existent, the item has been deleted
@@ -1831,6 +2055,20 @@ protected:
      */
     void notifyNewSeqno(const VBNotifyCtx& notifyCtx);
 
+    /**
+     * Make the notification, or merge it into batchNotifyCtx if non-null (to
+     * be made with notifyBatch() at the end of the batch).
+     */
+    void notifyNewSeqnoOrMerge(const VBNotifyCtx& notifyCtx,
+                               VBNotifyCtx* batchNotifyCtx);
+
+    /**
+     * Pass the deadline (if any) to the SyncWriteDeadlineCallback (if set).
+     * Expects the stateLock to be held.
+     */
+    void notifySyncWriteDeadline(
+            boost::optional<std::chrono::steady_clock::time_point> deadline);
+
     /**
      * Perform the post-queue collections stat counting using the caching read
      * handle.
@@ -1928,6 +2166,10 @@ protected:
     /* last seqno that is persisted on the disk */
     std::atomic<uint64_t> persistenceSeqno;
 
+    /// The seqno of the latest prepare queued whose level requires
+    /// persistence, see hasPendingDurablePrepare()
+    std::atomic<uint64_t> durablePrepareSeqno{0};
+
     /* holds all high priority async requests to the vbucket */
     std::list<HighPriorityVBEntry> hpVBReqs;
 
@@ -2219,16 +2461,6 @@ private:
      */
     virtual bool isValidDurabilityLevel(cb::durability::Level level) = 0;
 
-    /**
-     * Check if the durability requirements of the given item can be satisfied
-     * by this vBucket.
-     *
-     * @param item The durable write
-     * @return ENGINE_SUCCESS if durability is possible, appropriate error code
-     *         to return if not
-     */
-    ENGINE_ERROR_CODE checkDurabilityRequirements(const Item& item);
-
     /**
      * Base function for queueing an item for persistence and replication.
      *
@@ -2275,6 +2507,7 @@ private:
     std::atomic<bool> receivingInitialDiskSnapshot;
 
     std::mutex bfMutex;
+    const BloomFilter::Layout bFilterLayout;
     std::unique_ptr<BloomFilter> bFilter;
     std::unique_ptr<BloomFilter> tempFilter;    // Used during compaction.
 
@@ -2311,6 +2544,9 @@ private:
      */
     SeqnoAckCallback seqnoAckCb;
 
+    /// Guarded by the stateLock, see setSyncWriteDeadlineCallback()
+    SyncWriteDeadlineCallback syncWriteDeadlineCb;
+
     /// The VBucket collection state
     std::unique_ptr<Collections::VB::Manifest> manifest;
 
@@ -2321,6 +2557,9 @@ private:
      */
     std::atomic<bool> mayContainXattrs;
 
+    // See getHotKeyGeneration()
+    std::atomic<uint64_t> hotKeyGeneration{0};
+
     // Durable writes are enqueued also into the DurabilityMonitor.
     // The seqno-order of items tracked by the DM must be the same as in the
     // Backfill/CheckpointManager Queues (seqno is strictly monotonic).
@@ -27,6 +27,7 @@
 #include "ep_engine.h"
 #include "ep_vb.h"
 #include "failover-table.h"
+#include "hash_table_image.h"
 #include "item.h"
 #include "mutation_log.h"
 #include "statwriter.h"
@@ -34,11 +35,13 @@
 #include "vbucket_bgfetch_item.h"
 #include "vbucket_state.h"
 
+#include <nlohmann/json.hpp>
 #include <phosphor/phosphor.h>
 #include <platform/dirutils.h>
 #include <platform/timeutils.h>
 #include <utilities/logtags.h>
 
+#include <algorithm>
 #include <array>
 #include <limits>
 #include <memory>
@@ -152,6 +155,7 @@ public:
 
     bool run() override {
         TRACE_EVENT0("ep-engine/task", "WarmupInitialize");
+        Warmup::TaskTimer timer(*_warmup);
         _warmup->initialize();
         _warmup->removeFromTaskSet(uid);
         return false;
@@ -183,6 +187,7 @@ public:
 
     bool run() override {
         TRACE_EVENT0("ep-engine/task", "WarmupCreateVBuckets");
+        Warmup::TaskTimer timer(*_warmup);
         _warmup->createVBuckets(_shardId);
         _warmup->removeFromTaskSet(uid);
         return false;
@@ -220,6 +225,7 @@ public:
 
     bool run() override {
         TRACE_EVENT0("ep-engine/task", "WarpupEstimateDatabaseItemCount");
+        Warmup::TaskTimer timer(*_warmup);
         _warmup->estimateDatabaseItemCount(_shardId);
         _warmup->removeFromTaskSet(uid);
         return false;
@@ -263,6 +269,7 @@ public:
                      "WarmupLoadPreparedSyncWrites",
                      "shard",
                      shardId);
+        Warmup::TaskTimer timer(warmup);
         warmup.loadPreparedSyncWrites(shardId);
         warmup.removeFromTaskSet(uid);
         return false;
@@ -276,11 +283,13 @@ private:
 
 class WarmupKeyDump : public GlobalTask {
 public:
-    WarmupKeyDump(EPBucket& st, uint16_t sh, Warmup* w)
+    WarmupKeyDump(EPBucket& st, uint16_t sh, size_t taskIndex, Warmup* w)
         : GlobalTask(&st.getEPEngine(), TaskId::WarmupKeyDump, 0, false),
           _shardId(sh),
+          _taskIndex(taskIndex),
           _warmup(w),
-          _description("Warmup - key dump: shard " + std::to_string(_shardId)) {
+          _description("Warmup - key dump: shard " + std::to_string(_shardId) +
+                       " task " + std::to_string(_taskIndex)) {
         _warmup->addToTaskSet(uid);
     }
 
@@ -298,13 +307,15 @@ public:
 
     bool run() override {
         TRACE_EVENT1("ep-engine/task", "WarmupKeyDump", "shard", _shardId);
-        _warmup->keyDumpforShard(_shardId);
+        Warmup::TaskTimer timer(*_warmup);
+        _warmup->keyDumpforShard(_shardId, _taskIndex);
         _warmup->removeFromTaskSet(uid);
         return false;
     }
 
 private:
     uint16_t _shardId;
+    size_t _taskIndex;
     Warmup* _warmup;
     const std::string _description;
 };
@@ -331,6 +342,7 @@ public:
 
     bool run() override {
         TRACE_EVENT0("ep-engine/task", "WarmupCheckForAccessLog");
+        Warmup::TaskTimer timer(*_warmup);
         _warmup->checkForAccessLog();
         _warmup->removeFromTaskSet(uid);
         return false;
@@ -342,12 +354,14 @@ private:
 
 class WarmupLoadAccessLog : public GlobalTask {
 public:
-    WarmupLoadAccessLog(EPBucket& st, uint16_t sh, Warmup* w)
+    WarmupLoadAccessLog(EPBucket& st, uint16_t sh, size_t taskIndex, Warmup* w)
         : GlobalTask(&st.getEPEngine(), TaskId::WarmupLoadAccessLog, 0, false),
           _shardId(sh),
+          _taskIndex(taskIndex),
           _warmup(w),
           _description("Warmup - loading access log: shard " +
-                       std::to_string(_shardId)) {
+                       std::to_string(_shardId) + " task " +
+                       std::to_string(_taskIndex)) {
         _warmup->addToTaskSet(uid);
     }
 
@@ -365,25 +379,75 @@ public:
 
     bool run() override {
         TRACE_EVENT0("ep-engine/task", "WarmupLoadAccessLog");
-        _warmup->loadingAccessLog(_shardId);
+        Warmup::TaskTimer timer(*_warmup);
+        _warmup->loadingAccessLog(_shardId, _taskIndex);
+        _warmup->removeFromTaskSet(uid);
+        return false;
+    }
+
+private:
+    uint16_t _shardId;
+    size_t _taskIndex;
+    Warmup* _warmup;
+    const std::string _description;
+};
+
+class WarmupLoadingHashTableImage : public GlobalTask {
+public:
+    WarmupLoadingHashTableImage(EPBucket& st,
+                                uint16_t sh,
+                                size_t taskIndex,
+                                Warmup* w)
+        : GlobalTask(&st.getEPEngine(),
+                     TaskId::WarmupLoadingHashTableImage,
+                     0,
+                     false),
+          _shardId(sh),
+          _taskIndex(taskIndex),
+          _warmup(w),
+          _description("Warmup - loading HashTable images: shard " +
+                       std::to_string(_shardId) + " task " +
+                       std::to_string(_taskIndex)) {
+        _warmup->addToTaskSet(uid);
+    }
+
+    std::string getDescription() override {
+        return _description;
+    }
+
+    std::chrono::microseconds maxExpectedDuration() override {
+        // Runtime is a function of the size of the images; can be many
+        // minutes in large datasets.
+        // Given this large variation; set max duration to a "way out" value
+        // which we don't expect to see.
+        return std::chrono::hours(1);
+    }
+
+    bool run() override {
+        TRACE_EVENT0("ep-engine/task", "WarmupLoadingHashTableImage");
+        Warmup::TaskTimer timer(*_warmup);
+        _warmup->loadHashTableImageForShard(_shardId, _taskIndex);
         _warmup->removeFromTaskSet(uid);
         return false;
     }
 
 private:
     uint16_t _shardId;
+    size_t _taskIndex;
     Warmup* _warmup;
     const std::string _description;
 };
 
 class WarmupLoadingKVPairs : public GlobalTask {
 public:
-    WarmupLoadingKVPairs(EPBucket& st, uint16_t sh, Warmup* w)
+    WarmupLoadingKVPairs(EPBucket& st, uint16_t sh, size_t taskIndex, Warmup* w)
         : GlobalTask(&st.getEPEngine(), TaskId::WarmupLoadingKVPairs, 0, false),
           _shardId(sh),
+          _taskIndex(taskIndex),
           _warmup(w),
           _description("Warmup - loading KV Pairs: shard " +
-                       std::to_string(_shardId)) {
+                       std::to_string(_shardId) + " task " +
+                       std::to_string(_taskIndex)) {
         _warmup->addToTaskSet(uid);
     }
 
@@ -402,25 +466,29 @@ public:
 
     bool run() override {
         TRACE_EVENT0("ep-engine/task", "WarmupLoadingKVPairs");
-        _warmup->loadKVPairsforShard(_shardId);
+        Warmup::TaskTimer timer(*_warmup);
+        _warmup->loadKVPairsforShard(_shardId, _taskIndex);
         _warmup->removeFromTaskSet(uid);
         return false;
     }
 
 private:
     uint16_t _shardId;
+    size_t _taskIndex;
     Warmup* _warmup;
     const std::string _description;
 };
 
 class WarmupLoadingData : public GlobalTask {
 public:
-    WarmupLoadingData(EPBucket& st, uint16_t sh, Warmup* w)
+    WarmupLoadingData(EPBucket& st, uint16_t sh, size_t taskIndex, Warmup* w)
         : GlobalTask(&st.getEPEngine(), TaskId::WarmupLoadingData, 0, false),
           _shardId(sh),
+          _taskIndex(taskIndex),
           _warmup(w),
           _description("Warmup - loading data: shard " +
-                       std::to_string(_shardId)) {
+                       std::to_string(_shardId) + " task " +
+                       std::to_string(_taskIndex)) {
         _warmup->addToTaskSet(uid);
     }
 
@@ -439,13 +507,15 @@ public:
 
     bool run() override {
         TRACE_EVENT0("ep-engine/task", "WarmupLoadingData");
-        _warmup->loadDataforShard(_shardId);
+        Warmup::TaskTimer timer(*_warmup);
+        _warmup->loadDataforShard(_shardId, _taskIndex);
         _warmup->removeFromTaskSet(uid);
         return false;
     }
 
 private:
     uint16_t _shardId;
+    size_t _taskIndex;
     Warmup* _warmup;
     const std::string _description;
 };
@@ -475,6 +545,7 @@ public:
 
     bool run() override {
         TRACE_EVENT0("ep-engine/task", "WarmupLoadingCollectionCounts");
+        Warmup::TaskTimer timer(warmup);
         warmup.loadCollectionStatsForShard(shardId);
         warmup.removeFromTaskSet(uid);
         return false;
@@ -504,6 +575,7 @@ public:
 
     bool run() override {
         TRACE_EVENT0("ep-engine/task", "WarmupCompletion");
+        Warmup::TaskTimer timer(*_warmup);
         _warmup->done();
         _warmup->removeFromTaskSet(uid);
         return false;
@@ -595,6 +667,8 @@ const char* WarmupState::getStateDescription(State st) const {
         return "loading keys";
     case State::CheckForAccessLog:
         return "determine access log availability";
+    case State::LoadingHashTableImage:
+        return "loading hashtable images";
     case State::LoadingAccessLog:
         return "loading access log";
     case State::LoadingKVPairs:
@@ -638,6 +712,10 @@ bool WarmupState::legalTransition(State to) const {
     case State::KeyDump:
         return (to == State::LoadingKVPairs || to == State::CheckForAccessLog);
     case State::CheckForAccessLog:
+        return (to == State::LoadingAccessLog || to == State::LoadingData ||
+                to == State::LoadingKVPairs || to == State::Done ||
+                to == State::LoadingHashTableImage);
+    case State::LoadingHashTableImage:
         return (to == State::LoadingAccessLog || to == State::LoadingData ||
                 to == State::LoadingKVPairs || to == State::Done);
     case State::LoadingAccessLog:
@@ -693,6 +771,12 @@ void LoadStorageKVPairCallback::callback(GetValue &val) {
             setStatus(ENGINE_NOT_MY_VBUCKET);
             return;
         }
+        if (epstore.getWarmup()->isModifiedSinceWarmup(*vb)) {
+            // Front-end traffic got here first; skip the vBucket's (possibly
+            // stale) items and carry on with the others.
+            ++stats.warmDups;
+            return;
+        }
         bool succeeded(false);
         int retry = 2;
         do {
@@ -766,6 +850,7 @@ void LoadStorageKVPairCallback::callback(GetValue &val) {
             break;
         case WarmupState::State::LoadingData:
         case WarmupState::State::LoadingAccessLog:
+        case WarmupState::State::LoadingHashTableImage:
             if (epstore.getItemEvictionPolicy() == EvictionPolicy::Full) {
                 ++stats.warmedUpKeys;
             }
@@ -775,6 +860,7 @@ void LoadStorageKVPairCallback::callback(GetValue &val) {
             ++stats.warmedUpKeys;
             ++stats.warmedUpValues;
         }
+        stats.warmedUpBytes += i->getKey().size() + i->getNBytes();
     } else {
         stopLoading = true;
     }
@@ -880,7 +966,9 @@ Warmup::Warmup(EPBucket& st, Configuration& config_)
     : store(st),
       config(config_),
       shardVbStates(store.vbMap.getNumShards()),
-      shardVbIds(store.vbMap.getNumShards()) {
+      tasksPerShard(config.getWarmupTasksPerShard()),
+      shardVbIds(store.vbMap.getNumShards()),
+      accessLogs(store.vbMap.getNumShards()) {
 }
 
 Warmup::~Warmup() = default;
@@ -904,6 +992,16 @@ size_t Warmup::getEstimatedItemCount() const {
     return estimatedItemCount.load();
 }
 
+bool Warmup::isModifiedSinceWarmup(const VBucket& vb) const {
+    if (!trafficReady) {
+        return false;
+    }
+    const auto& vbStates =
+            shardVbStates[vb.getId().get() % store.vbMap.getNumShards()];
+    const auto it = vbStates.find(vb.getId());
+    return it == vbStates.end() || vb.getHighSeqno() > it->second.highSeqno;
+}
+
 void Warmup::start() {
     step();
 }
@@ -934,6 +1032,7 @@ void Warmup::initialize()
     {
         std::lock_guard<std::mutex> lock(warmupStart.mutex);
         warmupStart.time = std::chrono::steady_clock::now();
+        warmupStart.phase = warmupStart.time;
     }
 
     std::map<std::string, std::string> session_stats;
@@ -1029,9 +1128,21 @@ void Warmup::createVBuckets(uint16_t shardId) {
                         entry.vb_uuid,
                         entry.by_seqno);
             }
+            // Use the bloom filter saved with the data (if it's still
+            // valid) rather than starting without one
+            if (config.isBfilterEnabled() && config.isBfilterPersist()) {
+                vb->setFilter(store.getROUnderlyingByShard(shardId)
+                                      ->loadBloomFilter(vbid, vbs.highSeqno));
+            }
+
             EPBucket* bucket = &this->store;
             vb->setFreqSaturatedCallback(
                     [bucket]() { bucket->wakeItemFreqDecayerTask(); });
+            vb->setSyncWriteDeadlineCallback(
+                    [bucket](Vbid vbid,
+                             std::chrono::steady_clock::time_point deadline) {
+                        bucket->addSyncWriteDeadline(vbid, deadline);
+                    });
 
             store.vbMap.addBucket(vb);
         }
@@ -1234,20 +1345,36 @@ void Warmup::scheduleKeyDump()
 {
     threadtask_count = 0;
     for (size_t i = 0; i < store.vbMap.shards.size(); i++) {
-        ExTask task = std::make_shared<WarmupKeyDump>(store, i, this);
-        ExecutorPool::get()->schedule(task);
+        for (size_t t = 0; t < tasksPerShard; t++) {
+            ExTask task = std::make_shared<WarmupKeyDump>(store, i, t, this);
+            ExecutorPool::get()->schedule(task);
+        }
+    }
+
+}
+
+std::vector<Vbid> Warmup::getVbIdsForTask(uint16_t shardId,
+                                          size_t taskIndex) const {
+    std::vector<Vbid> ret;
+    const auto& vbids = shardVbIds[shardId];
+    for (size_t ii = taskIndex; ii < vbids.size(); ii += tasksPerShard) {
+        ret.push_back(vbids[ii]);
     }
+    return ret;
+}
 
+size_t Warmup::getNumLoadingTasks() const {
+    return store.vbMap.getNumShards() * tasksPerShard;
 }
 
-void Warmup::keyDumpforShard(uint16_t shardId)
+void Warmup::keyDumpforShard(uint16_t shardId, size_t taskIndex)
 {
     KVStore* kvstore = store.getROUnderlyingByShard(shardId);
     auto cb = std::make_shared<LoadStorageKVPairCallback>(
             store, false, state.getState());
     auto cl = std::make_shared<NoLookupCallback>();
 
-    for (const auto vbid : shardVbIds[shardId]) {
+    for (const auto vbid : getVbIdsForTask(shardId, taskIndex)) {
         ScanContext* ctx = kvstore->initScanContext(cb, cl, vbid, 0,
                                                     DocumentFilter::NO_DELETES,
                                                     ValueFilter::KEYS_ONLY);
@@ -1261,7 +1388,7 @@ void Warmup::keyDumpforShard(uint16_t shardId)
         }
     }
 
-    if (++threadtask_count == store.vbMap.getNumShards()) {
+    if (++threadtask_count == getNumLoadingTasks()) {
         transition(WarmupState::State::CheckForAccessLog);
     }
 }
@@ -1281,10 +1408,28 @@ void Warmup::checkForAccessLog()
     EP_LOG_INFO("metadata loaded in {}",
                 cb::time2text(std::chrono::nanoseconds(metadata.load())));
 
+    // With full eviction the HashTable needn't hold every key, so the
+    // vBuckets can be served now; what isn't loaded yet is bgfetched.
+    if (config.isWarmupEarlyTraffic() &&
+        store.getItemEvictionPolicy() == EvictionPolicy::Full) {
+        trafficReady = true;
+        EP_LOG_INFO(
+                "Warmup: data traffic may be enabled, loading the items in "
+                "the background");
+    }
+
     if (store.maybeEnableTraffic()) {
         transition(WarmupState::State::Done);
     }
 
+    if (config.isWarmupHashtableImage()) {
+        transition(WarmupState::State::LoadingHashTableImage);
+    } else {
+        transitionToAccessLogOrData();
+    }
+}
+
+void Warmup::transitionToAccessLogOrData() {
     size_t accesslogs = 0;
     for (size_t i = 0; i < store.vbMap.shards.size(); i++) {
         std::string curr = store.accessLog[i].getLogFile();
@@ -1306,26 +1451,137 @@ void Warmup::checkForAccessLog()
 
 }
 
+void Warmup::scheduleLoadingHashTableImage() {
+    threadtask_count = 0;
+    for (size_t i = 0; i < store.vbMap.shards.size(); i++) {
+        for (size_t t = 0; t < tasksPerShard; t++) {
+            ExTask task = std::make_shared<WarmupLoadingHashTableImage>(
+                    store, i, t, this);
+            ExecutorPool::get()->schedule(task);
+        }
+    }
+}
+
+void Warmup::loadHashTableImageForShard(uint16_t shardId, size_t taskIndex) {
+    KVStore* kvstore = store.getROUnderlyingByShard(shardId);
+    LoadStorageKVPairCallback cb(store, true, state.getState());
+
+    for (const auto vbid : getVbIdsForTask(shardId, taskIndex)) {
+        auto vb = store.getVBucket(vbid);
+        if (!vb) {
+            continue;
+        }
+        auto image = kvstore->loadHashTableImage(vbid,
+                                                 vb->getPersistenceSeqno());
+        if (!image) {
+            continue;
+        }
+
+        bool stop = false;
+        size_t loaded = 0;
+        image->forEachItem(
+                vbid, [&cb, &stop, &loaded](std::unique_ptr<Item> item) {
+                    GetValue gv(std::move(item));
+                    cb.callback(gv);
+                    if (cb.getStatus() != ENGINE_SUCCESS) {
+                        // Enough has been loaded (or no more can be)
+                        stop = true;
+                        return false;
+                    }
+                    ++loaded;
+                    return true;
+                });
+        hashTableImageItems += loaded;
+        EP_LOG_DEBUG(
+                "Warmup loaded {} of {} items of the HashTable image of {}",
+                loaded,
+                image->getNumItems(),
+                vbid);
+        if (stop) {
+            break;
+        }
+    }
+
+    if (++threadtask_count == getNumLoadingTasks()) {
+        EP_LOG_INFO("{} items loaded from the HashTable images",
+                    hashTableImageItems.load());
+        if (store.maybeEnableTraffic()) {
+            transition(WarmupState::State::Done);
+        } else if (hashTableImageItems == 0) {
+            // There were no (valid) images; carry on as if we hadn't
+            // looked for them
+            transitionToAccessLogOrData();
+        } else if (store.getItemEvictionPolicy() == EvictionPolicy::Value) {
+            transition(WarmupState::State::LoadingData);
+        } else {
+            transition(WarmupState::State::LoadingKVPairs);
+        }
+    }
+}
+
 void Warmup::scheduleLoadingAccessLog()
 {
     threadtask_count = 0;
     for (size_t i = 0; i < store.vbMap.shards.size(); i++) {
-        ExTask task = std::make_shared<WarmupLoadAccessLog>(store, i, this);
-        ExecutorPool::get()->schedule(task);
+        for (size_t t = 0; t < tasksPerShard; t++) {
+            ExTask task =
+                    std::make_shared<WarmupLoadAccessLog>(store, i, t, this);
+            ExecutorPool::get()->schedule(task);
+        }
+    }
+}
+
+MutationLog* Warmup::getAccessLogForLoading(uint16_t shardId, bool old) {
+    auto& logs = accessLogs[shardId];
+    std::lock_guard<std::mutex> lh(logs.mutex);
+    if (!old) {
+        if (!logs.currentOpened) {
+            logs.currentOpened = true;
+            auto& log = store.accessLog[shardId];
+            if (log.exists()) {
+                try {
+                    log.open();
+                    log.mapForReading();
+                    logs.currentValid = true;
+                } catch (MutationLog::ReadException& e) {
+                    corruptAccessLog = true;
+                    EP_LOG_WARN("Error reading warmup access log:  {}",
+                                e.what());
+                }
+            }
+        }
+        return logs.currentValid ? &store.accessLog[shardId] : nullptr;
+    }
+
+    if (!logs.oldOpened) {
+        logs.oldOpened = true;
+        std::string nm = store.accessLog[shardId].getLogFile();
+        nm.append(".old");
+        auto log = std::make_unique<MutationLog>(nm);
+        if (log->exists()) {
+            try {
+                log->open();
+                log->mapForReading();
+                logs.old = std::move(log);
+            } catch (MutationLog::ReadException& e) {
+                corruptAccessLog = true;
+                EP_LOG_WARN("Error reading old access log:  {}", e.what());
+            }
+        }
     }
+    return logs.old.get();
 }
 
-void Warmup::loadingAccessLog(uint16_t shardId)
+void Warmup::loadingAccessLog(uint16_t shardId, size_t taskIndex)
 {
     LoadStorageKVPairCallback load_cb(store, true, state.getState());
     bool success = false;
     auto stTime = std::chrono::steady_clock::now();
-    if (store.accessLog[shardId].exists()) {
+    auto* log = getAccessLogForLoading(shardId, false);
+    if (log) {
         try {
-            store.accessLog[shardId].open();
-            if (doWarmup(store.accessLog[shardId],
-                         shardVbStates[shardId],
-                         load_cb) != (size_t)-1) {
+            if (doWarmup(*log, taskIndex, shardVbStates[shardId], load_cb) !=
+                (size_t)-1) {
                 success = true;
             }
         } catch (MutationLog::ReadException &e) {
@@ -1336,14 +1592,13 @@ void Warmup::loadingAccessLog(uint16_t shardId)
 
     if (!success) {
         // Do we have the previous file?
-        std::string nm = store.accessLog[shardId].getLogFile();
-        nm.append(".old");
-        MutationLog old(nm);
-        if (old.exists()) {
+        auto* old = getAccessLogForLoading(shardId, true);
+        if (old) {
             try {
-                old.open();
-                if (doWarmup(old, shardVbStates[shardId], load_cb) !=
-                    (size_t)-1) {
+                if (doWarmup(*old,
+                             taskIndex,
+                             shardVbStates[shardId],
+                             load_cb) != (size_t)-1) {
                     success = true;
                 }
             } catch (MutationLog::ReadException &e) {
@@ -1363,7 +1618,13 @@ void Warmup::loadingAccessLog(uint16_t shardId)
         setEstimatedWarmupCount(estimatedCount);
     }
 
-    if (++threadtask_count == store.vbMap.getNumShards()) {
+    if (++threadtask_count == getNumLoadingTasks()) {
+        // All of the tasks are done with the old logs
+        for (auto& logs : accessLogs) {
+            std::lock_guard<std::mutex> lh(logs.mutex);
+            logs.old.reset();
+        }
+
         if (!store.maybeEnableTraffic()) {
             transition(WarmupState::State::LoadingData);
         } else {
@@ -1374,12 +1635,15 @@ void Warmup::loadingAccessLog(uint16_t shardId)
 }
 
 size_t Warmup::doWarmup(MutationLog& lf,
+                        size_t taskIndex,
                         const std::map<Vbid, vbucket_state>& vbmap,
                         StatusCallback<GetValue>& cb) {
     MutationLogHarvester harvester(lf, &store.getEPEngine());
+    std::set<Vbid> vbuckets;
     std::map<Vbid, vbucket_state>::const_iterator it;
     for (it = vbmap.begin(); it != vbmap.end(); ++it) {
         harvester.setVBucket(it->first);
+        vbuckets.insert(it->first);
     }
 
     // To constrain the number of elements from the access log we have to keep
@@ -1389,7 +1653,16 @@ size_t Warmup::doWarmup(MutationLog& lf,
     std::chrono::nanoseconds log_apply_duration{};
     WarmupCookie cookie(&store, cb);
 
-    auto alog_iter = lf.begin();
+    // Each of the shard's tasks reads its own range of the log's blocks
+    // (skipping the blocks of the other vbuckets if the log has a block
+    // index)
+    const size_t numBlocks = lf.getNumBlocks();
+    const size_t blocksPerTask =
+            (numBlocks + tasksPerShard - 1) / tasksPerShard;
+    const size_t firstBlock = std::min(numBlocks, taskIndex * blocksPerTask);
+    const size_t lastBlock = std::min(numBlocks, firstBlock + blocksPerTask);
+
+    auto alog_iter = lf.begin(firstBlock, lastBlock, &vbuckets);
     do {
         // Load a chunk of the access log file
         auto start = std::chrono::steady_clock::now();
@@ -1427,8 +1700,11 @@ void Warmup::scheduleLoadingKVPairs()
 
     threadtask_count = 0;
     for (size_t i = 0; i < store.vbMap.shards.size(); i++) {
-        ExTask task = std::make_shared<WarmupLoadingKVPairs>(store, i, this);
-        ExecutorPool::get()->schedule(task);
+        for (size_t t = 0; t < tasksPerShard; t++) {
+            ExTask task =
+                    std::make_shared<WarmupLoadingKVPairs>(store, i, t, this);
+            ExecutorPool::get()->schedule(task);
+        }
     }
 
 }
@@ -1443,7 +1719,7 @@ ValueFilter getValueFilterForCompressionMode(
     return ValueFilter::VALUES_DECOMPRESSED;
 }
 
-void Warmup::loadKVPairsforShard(uint16_t shardId)
+void Warmup::loadKVPairsforShard(uint16_t shardId, size_t taskIndex)
 {
     bool maybe_enable_traffic = false;
     scan_error_t errorCode = scan_success;
@@ -1461,7 +1737,7 @@ void Warmup::loadKVPairsforShard(uint16_t shardId)
     ValueFilter valFilter = getValueFilterForCompressionMode(
                                     store.getEPEngine().getCompressionMode());
 
-    for (const auto vbid : shardVbIds[shardId]) {
+    for (const auto vbid : getVbIdsForTask(shardId, taskIndex)) {
         ScanContext* ctx = kvstore->initScanContext(cb, cl, vbid, 0,
                                                     DocumentFilter::NO_DELETES,
                                                     valFilter);
@@ -1474,7 +1750,7 @@ void Warmup::loadKVPairsforShard(uint16_t shardId)
             }
         }
     }
-    if (++threadtask_count == store.vbMap.getNumShards()) {
+    if (++threadtask_count == getNumLoadingTasks()) {
         transition(WarmupState::State::Done);
     }
 }
@@ -1486,8 +1762,11 @@ void Warmup::scheduleLoadingData()
 
     threadtask_count = 0;
     for (size_t i = 0; i < store.vbMap.shards.size(); i++) {
-        ExTask task = std::make_shared<WarmupLoadingData>(store, i, this);
-        ExecutorPool::get()->schedule(task);
+        for (size_t t = 0; t < tasksPerShard; t++) {
+            ExTask task =
+                    std::make_shared<WarmupLoadingData>(store, i, t, this);
+            ExecutorPool::get()->schedule(task);
+        }
     }
 }
 
@@ -1500,7 +1779,7 @@ void Warmup::scheduleLoadingCollectionCounts() {
     }
 }
 
-void Warmup::loadDataforShard(uint16_t shardId)
+void Warmup::loadDataforShard(uint16_t shardId, size_t taskIndex)
 {
     scan_error_t errorCode = scan_success;
 
@@ -1513,7 +1792,7 @@ void Warmup::loadDataforShard(uint16_t shardId)
     ValueFilter valFilter = getValueFilterForCompressionMode(
                                           store.getEPEngine().getCompressionMode());
 
-    for (const auto vbid : shardVbIds[shardId]) {
+    for (const auto vbid : getVbIdsForTask(shardId, taskIndex)) {
         ScanContext* ctx = kvstore->initScanContext(cb, cl, vbid, 0,
                                                     DocumentFilter::NO_DELETES,
                                                     valFilter);
@@ -1527,7 +1806,7 @@ void Warmup::loadDataforShard(uint16_t shardId)
         }
     }
 
-    if (++threadtask_count == store.vbMap.getNumShards()) {
+    if (++threadtask_count == getNumLoadingTasks()) {
         transition(WarmupState::State::Done);
     }
 }
@@ -1575,6 +1854,10 @@ void Warmup::done()
         store.warmupCompleted();
         logWarmupStats(store);
     }
+    // Warmup may already have been marked complete by the loading callbacks
+    // enabling traffic, in which case this completes the phase breakdown.
+    endPhase();
+    logPhaseStats();
 }
 
 void Warmup::step() {
@@ -1600,6 +1883,9 @@ void Warmup::step() {
     case WarmupState::State::LoadingAccessLog:
         scheduleLoadingAccessLog();
         return;
+    case WarmupState::State::LoadingHashTableImage:
+        scheduleLoadingHashTableImage();
+        return;
     case WarmupState::State::LoadingKVPairs:
         scheduleLoadingKVPairs();
         return;
@@ -1620,11 +1906,78 @@ void Warmup::step() {
 void Warmup::transition(WarmupState::State to, bool force) {
     auto old = state.getState();
     if (old != WarmupState::State::Done) {
+        endPhase();
         state.transition(to, force);
         step();
     }
 }
 
+void Warmup::endPhase() {
+    std::lock_guard<std::mutex> lock(warmupStart.mutex);
+    const auto now = std::chrono::steady_clock::now();
+    auto& time = phaseTime[size_t(state.getState())];
+    time.store(time.load() + (now - warmupStart.phase));
+    warmupStart.phase = now;
+}
+
+/// The name a state's phase_<name>_* stats and log fields are reported under.
+static const char* getPhaseStatName(WarmupState::State st) {
+    switch (st) {
+    case WarmupState::State::Initialize:
+        return "initialize";
+    case WarmupState::State::CreateVBuckets:
+        return "create_vbuckets";
+    case WarmupState::State::EstimateDatabaseItemCount:
+        return "estimate_item_count";
+    case WarmupState::State::LoadPreparedSyncWrites:
+        return "load_prepared_sync_writes";
+    case WarmupState::State::KeyDump:
+        return "key_dump";
+    case WarmupState::State::LoadingAccessLog:
+        return "loading_access_log";
+    case WarmupState::State::CheckForAccessLog:
+        return "check_for_access_log";
+    case WarmupState::State::LoadingHashTableImage:
+        return "loading_hashtable_image";
+    case WarmupState::State::LoadingKVPairs:
+        return "loading_kv_pairs";
+    case WarmupState::State::LoadingData:
+        return "loading_data";
+    case WarmupState::State::LoadingCollectionCounts:
+        return "loading_collection_counts";
+    case WarmupState::State::Done:
+        return "done";
+    }
+    throw std::invalid_argument("getPhaseStatName: invalid state " +
+                                std::to_string(int(st)));
+}
+
+void Warmup::logPhaseStats() const {
+    using namespace std::chrono;
+
+    const EPStats& stats = store.getEPEngine().getEpStats();
+    const auto seconds = duration<double>(warmup.load()).count();
+    nlohmann::json json;
+    json["time_us"] = duration_cast<microseconds>(warmup.load()).count();
+    json["keys"] = stats.warmedUpKeys.load();
+    json["values"] = stats.warmedUpValues.load();
+    json["bytes"] = stats.warmedUpBytes.load();
+    json["items_per_sec"] = stats.warmedUpValues / seconds;
+    json["bytes_per_sec"] = stats.warmedUpBytes / seconds;
+    for (size_t ii = 0; ii < WarmupState::NumStates; ++ii) {
+        const auto time = phaseTime[ii].load();
+        if (time == time.zero()) {
+            continue;
+        }
+        const auto taskTime = nanoseconds(phaseTaskTime[ii].load());
+        json["phases"][getPhaseStatName(WarmupState::State(ii))] = {
+                {"time_us", duration_cast<microseconds>(time).count()},
+                {"task_time_us", duration_cast<microseconds>(taskTime).count()},
+                {"threads", duration<double>(taskTime) / time}};
+    }
+    EP_LOG_INFO("Warmup phase breakdown: {}", json.dump());
+}
+
 template <typename T>
 void addStat(const char* nm,
              const T& val,
@@ -1693,6 +2046,36 @@ void Warmup::addStats(const AddStatFn& add_stat, const void* c) const {
         addStat("estimated_key_count", itemCount, add_stat, c);
     }
 
+    addStat("bytes", stats.warmedUpBytes, add_stat, c);
+    if (w_time > w_time.zero()) {
+        const auto seconds = duration<double>(w_time).count();
+        addStat("items_per_sec", stats.warmedUpValues / seconds, add_stat, c);
+        addStat("bytes_per_sec", stats.warmedUpBytes / seconds, add_stat, c);
+    }
+
+    for (size_t ii = 0; ii < WarmupState::NumStates; ++ii) {
+        const auto time = phaseTime[ii].load();
+        if (time == time.zero()) {
+            continue;
+        }
+        const auto taskTime = nanoseconds(phaseTaskTime[ii].load());
+        const std::string prefix =
+                std::string("phase_") +
+                getPhaseStatName(WarmupState::State(ii)) + "_";
+        addStat((prefix + "time").c_str(),
+                duration_cast<microseconds>(time).count(),
+                add_stat,
+                c);
+        addStat((prefix + "task_time").c_str(),
+                duration_cast<microseconds>(taskTime).count(),
+                add_stat,
+                c);
+        addStat((prefix + "threads").c_str(),
+                duration<double>(taskTime) / time,
+                add_stat,
+                c);
+    }
+
     if (corruptAccessLog) {
         addStat("access_log", "corrupt", add_stat, c);
     }
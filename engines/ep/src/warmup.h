@@ -22,11 +22,13 @@
 #include <memcached/engine_common.h>
 #include <platform/atomic_duration.h>
 
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <deque>
 #include <iosfwd>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <unordered_set>
@@ -38,6 +40,7 @@ class EPBucket;
 class GetValue;
 class MutationLog;
 class VBucketMap;
+class VBucket;
 class Vbid;
 
 struct vbucket_state;
@@ -65,12 +68,16 @@ public:
         KeyDump,
         LoadingAccessLog,
         CheckForAccessLog,
+        LoadingHashTableImage,
         LoadingKVPairs,
         LoadingData,
         LoadingCollectionCounts,
         Done
     };
 
+    /// The number of states in State.
+    static constexpr size_t NumStates = size_t(State::Done) + 1;
+
     // Assignment disallowed; use transition() to modify current state.
     WarmupState& operator=(const WarmupState&) = delete;
     WarmupState& operator=(WarmupState&&) = delete;
@@ -161,6 +168,12 @@ private:
  *                           |
  *                           V
  *                        [Done]
+ *
+ * If warmup_hashtable_image is set, CheckForAccessLog moves on to
+ * [LoadingHashTableImage] instead, which loads the HashTable images saved at
+ * the last clean shutdown. From there warmup moves to [Done] if traffic can
+ * be enabled, or else carries on as above from "Access Log Found?" if no
+ * image could be loaded, or from "No - Eviction mode?" if one was.
  */
 class Warmup {
 public:
@@ -185,7 +198,16 @@ public:
                      std::chrono::steady_clock::duration(1));
     }
 
+    /**
+     * Load the keys of the given access log, and their values, for the
+     * vBuckets in vbmap. The log's blocks are split between the
+     * tasksPerShard tasks loading the shard; this loads the range of the
+     * given task.
+     *
+     * @return the number of items loaded
+     */
     size_t doWarmup(MutationLog& lf,
+                    size_t taskIndex,
                     const std::map<Vbid, vbucket_state>& vbmap,
                     StatusCallback<GetValue>& cb);
 
@@ -193,6 +215,24 @@ public:
         return warmupComplete.load();
     }
 
+    /**
+     * @return true if data traffic may be served before warmup is complete
+     *         (warmup_early_traffic). Set once the vBuckets are created and
+     *         their prepared SyncWrites loaded; items not loaded yet are
+     *         fetched from disk on demand.
+     */
+    bool isTrafficReady() const {
+        return trafficReady.load();
+    }
+
+    /**
+     * Whether the given vBucket was modified since warmup read its state.
+     * Once traffic is served early warmup must not load the items of such a
+     * vBucket; the items it reads from disk may be older than ones written
+     * since and then evicted or deleted from the HashTable.
+     */
+    bool isModifiedSinceWarmup(const VBucket& vb) const;
+
     bool setComplete() {
         bool inverse = false;
         return warmupComplete.compare_exchange_strong(inverse, true);
@@ -278,9 +318,10 @@ private:
 
     /**
      * [Value-eviction only]
-     * Loads all keys into memory for each vBucket in the given shard.
+     * Loads all keys into memory for each vBucket in the given shard which
+     * is handled by the given task (see getVbIdsForTask).
      */
-    void keyDumpforShard(uint16_t shardId);
+    void keyDumpforShard(uint16_t shardId, size_t taskIndex);
 
     /**
      * Checks for the existance of an access log file for each shard:
@@ -291,26 +332,60 @@ private:
     void checkForAccessLog();
 
     /**
-     * Loads the access log for the given shardId:
+     * Loads the given task's range of the access log for the given shardId:
      * - Reads a batch of keys from the access log
      * - For each key read, attempt to fetch key+value from the underlying
      *   KVStore.
      * - If key exists (wasn't subsequently deleted), insert into the
      *   HashTable.
      */
-    void loadingAccessLog(uint16_t shardId);
+    void loadingAccessLog(uint16_t shardId, size_t taskIndex);
+
+    /**
+     * The current (old == false) or previous (".old") access log of the
+     * shard, opened and memory mapped by the first of the shard's tasks to
+     * ask for it.
+     *
+     * @return the log, or nullptr if it doesn't exist or couldn't be opened
+     */
+    MutationLog* getAccessLogForLoading(uint16_t shardId, bool old);
+
+    /**
+     * Loads the items of the valid HashTable images of the vBuckets of the
+     * given shard which are handled by the given task.
+     */
+    void loadHashTableImageForShard(uint16_t shardId, size_t taskIndex);
+
+    /**
+     * Moves on to loading the access logs if every shard has one, else to
+     * loading the data (by eviction mode).
+     */
+    void transitionToAccessLogOrData();
 
     /**
      * [Full-eviction only]
      * Loads both keys and values into memory for each vBucket in the given
-     * shard.
+     * shard which is handled by the given task.
      */
-    void loadKVPairsforShard(uint16_t shardId);
+    void loadKVPairsforShard(uint16_t shardId, size_t taskIndex);
 
     /**
-     * Loads values into memory for each vBucket in the given shard.
+     * Loads values into memory for each vBucket in the given shard which is
+     * handled by the given task.
      */
-    void loadDataforShard(uint16_t shardId);
+    void loadDataforShard(uint16_t shardId, size_t taskIndex);
+
+    /**
+     * The vBuckets of the shard which the given task of the KeyDump,
+     * LoadingKVPairs and LoadingData phases loads. Each shard is split over
+     * tasksPerShard tasks, which take every tasksPerShard'th vBucket so
+     * they're given a similar amount of work.
+     */
+    std::vector<Vbid> getVbIdsForTask(uint16_t shardId, size_t taskIndex) const;
+
+    /// The number of tasks the KeyDump, LoadingKVPairs and LoadingData
+    /// phases are split over
+    size_t getNumLoadingTasks() const;
 
     /* Terminal state of warmup. Updates statistics and marks warmup as
      * completed
@@ -329,6 +404,7 @@ private:
     void scheduleKeyDump();
     void scheduleCheckForAccessLog();
     void scheduleLoadingAccessLog();
+    void scheduleLoadingHashTableImage();
     void scheduleLoadingKVPairs();
     void scheduleLoadingData();
     void scheduleCompletion();
@@ -336,6 +412,38 @@ private:
 
     void transition(WarmupState::State to, bool force = false);
 
+    /// Record the time spent in the current state, and start timing the next.
+    void endPhase();
+
+    /// Log the time, throughput and thread utilization of each state.
+    void logPhaseStats() const;
+
+    /**
+     * Adds the time a warmup task runs for to the task time of the state it
+     * started running in. Created on the stack at the top of each warmup
+     * task's run().
+     */
+    class TaskTimer {
+    public:
+        explicit TaskTimer(Warmup& warmup)
+            : warmup(warmup),
+              phase(warmup.getWarmupState()),
+              start(std::chrono::steady_clock::now()) {
+        }
+
+        ~TaskTimer() {
+            warmup.phaseTaskTime[size_t(phase)] +=
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+        }
+
+    private:
+        Warmup& warmup;
+        const WarmupState::State phase;
+        const std::chrono::steady_clock::time_point start;
+    };
+
     WarmupState state;
 
     EPBucket& store;
@@ -348,27 +456,54 @@ private:
     // Stores the time when the warmup process has started.
     // Lock the mutex when reading from or writing to the time member,
     // in order to synchronise access from multiple threads.
+    // The phase member holds the time the current state was entered.
     struct {
         std::mutex mutex;
         std::chrono::steady_clock::time_point time;
+        std::chrono::steady_clock::time_point phase;
     } warmupStart;
 
     // Time it took to load metadata and complete warmup, stored atomically.
     cb::AtomicDuration metadata;
     cb::AtomicDuration warmup;
 
+    /// Wall clock time spent in each state, indexed by WarmupState::State.
+    std::array<cb::AtomicDuration, WarmupState::NumStates> phaseTime;
+    /// Time (ns) the warmup tasks ran for in each state, summed over all the
+    /// tasks of the state; divided by phaseTime this gives the average
+    /// number of threads busy in that state.
+    std::array<std::atomic<int64_t>, WarmupState::NumStates> phaseTaskTime{};
+
     std::vector<std::map<Vbid, vbucket_state>> shardVbStates;
     std::atomic<size_t> threadtask_count{0};
 
+    /// The number of reader tasks each shard is loaded by
+    /// (warmup_tasks_per_shard)
+    const size_t tasksPerShard;
+
     /// vector of vectors of VBucket IDs (one vector per shard). Each vector
     /// contains all vBucket IDs which are present for the given shard.
     std::vector<std::vector<Vbid>> shardVbIds;
 
+    /// The access logs being loaded by the tasks of a shard
+    struct ShardAccessLogs {
+        std::mutex mutex;
+        bool currentOpened{false};
+        /// Whether EPBucket::accessLog was opened successfully
+        bool currentValid{false};
+        bool oldOpened{false};
+        std::unique_ptr<MutationLog> old;
+    };
+    std::vector<ShardAccessLogs> accessLogs;
+
     cb::AtomicDuration estimateTime;
     std::atomic<size_t> estimatedItemCount{std::numeric_limits<size_t>::max()};
     bool cleanShutdown{true};
-    bool corruptAccessLog{false};
+    std::atomic<bool> corruptAccessLog{false};
+    /// The number of items loaded from the HashTable images
+    std::atomic<size_t> hashTableImageItems{0};
     std::atomic<bool> warmupComplete{false};
+    std::atomic<bool> trafficReady{false};
     std::atomic<bool> warmupOOMFailure{false};
     std::atomic<size_t> estimatedWarmupCount{
             std::numeric_limits<size_t>::max()};
@@ -391,6 +526,7 @@ private:
     friend class WarmupKeyDump;
     friend class WarmupCheckforAccessLog;
     friend class WarmupLoadAccessLog;
+    friend class WarmupLoadingHashTableImage;
     friend class WarmupLoadingKVPairs;
     friend class WarmupLoadingData;
     friend class WarmupLoadingCollectionCounts;
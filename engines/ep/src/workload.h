@@ -74,9 +74,44 @@ public:
         workloadPattern.store(pattern);
     }
 
+    /**
+     * The bucket's share of the executor threads' time relative to other
+     * buckets (the ExecutorPool delays the tasks of a busy bucket which has
+     * run more than its share). 0 (the default) opts the bucket out.
+     */
+    size_t getCpuShares() const {
+        return cpuShares.load();
+    }
+
+    void setCpuShares(size_t shares) {
+        cpuShares.store(shares);
+    }
+
+    /// The shares the runtime of all buckets is weighted against
+    static const size_t DefaultCpuShares = 100;
+
+    /**
+     * The number of the bucket's tasks in the executor's ready queues
+     * (maintained by the TaskQueues, like ExecutorPool::getNumReadyTasks()
+     * for all buckets).
+     */
+    size_t getNumReadyTasks() const {
+        return numReadyTasks.load();
+    }
+
+    void addReadyTask() {
+        ++numReadyTasks;
+    }
+
+    void removeReadyTask() {
+        --numReadyTasks;
+    }
+
 private:
 
     int maxNumWorkers;
     int maxNumShards;
     std::atomic<workload_pattern_t> workloadPattern;
+    std::atomic<size_t> cpuShares{0};
+    std::atomic<size_t> numReadyTasks{0};
 };
@@ -25,6 +25,9 @@
  *
  *     make test ARGS="--verbose"
  *
+ * The results may instead be written to one file per test (for tracking
+ * over time) in XML or JSON with the engine_testapp -f option.
+ *
  * Note this is designed as a relatively quick micro-benchmark suite; tests
  * are tuned to complete in <2 seconds to maintain the quick turnaround.
 **/
@@ -36,11 +39,13 @@
 
 #include <memcached/engine.h>
 #include <memcached/engine_testapp.h>
+#include <nlohmann/json.hpp>
 #include <platform/cbassert.h>
 #include <platform/platform_time.h>
 
 #include <algorithm>
 #include <atomic>
+#include <cmath>
 #include <condition_variable>
 #include <fstream>
 #include <iterator>
@@ -103,6 +108,9 @@ struct Stats {
     double pct5;
     double pct95;
     double pct99;
+    double pct999;
+    double min;
+    double max;
     std::vector<T>* values;
 };
 
@@ -274,6 +282,51 @@ void renderToXML(const std::string& name, const std::string& description,
     file << "</testsuites>\n";
 }
 
+// Render the specified value stats as JSON (one document per test), so the
+// results (in µs) can be tracked over time by the tooling.
+template <typename T>
+void renderToJSON(const std::string& name,
+                  const std::string& description,
+                  const std::vector<Stats<T>>& value_stats,
+                  const std::string& unit) {
+    std::string test_name = testHarness->output_file_prefix;
+    test_name += name;
+    std::ofstream file(test_name + ".json");
+
+    time_t now;
+    time(&now);
+    char timebuf[256];
+    strftime(timebuf, sizeof timebuf, "%FT%T%z", gmtime(&now));
+
+    std::string testsuite = "ep-perfsuite";
+    if (!testHarness->bucket_type.empty()) {
+        testsuite += "-" + testHarness->bucket_type;
+    }
+
+    nlohmann::json results = nlohmann::json::array();
+    for (const auto& stats : value_stats) {
+        results.push_back({{"name", stats.name},
+                           {"samples", stats.values->size()},
+                           {"mean", stats.mean / 1e3},
+                           {"stddev", stats.stddev / 1e3},
+                           {"min", stats.min / 1e3},
+                           {"max", stats.max / 1e3},
+                           {"median", stats.median / 1e3},
+                           {"pct5", stats.pct5 / 1e3},
+                           {"pct95", stats.pct95 / 1e3},
+                           {"pct99", stats.pct99 / 1e3},
+                           {"pct999", stats.pct999 / 1e3}});
+    }
+
+    nlohmann::json json = {{"timestamp", timebuf},
+                           {"testsuite", testsuite},
+                           {"name", name},
+                           {"description", description},
+                           {"unit", unit},
+                           {"results", results}};
+    file << json.dump(2) << std::endl;
+}
+
 // Given a vector of values (each a vector<T>) calculate metrics on them
 // and print in the format specified by {testHarness->output_format}.
 template<typename T>
@@ -299,6 +352,9 @@ void output_result(const std::string& name,
         stats.pct5 = vec[(vec.size() * 5) / 100];
         stats.pct95 = vec[(vec.size() * 95) / 100];
         stats.pct99 = vec[(vec.size() * 99) / 100];
+        stats.pct999 = vec[(vec.size() * 999) / 1000];
+        stats.min = vec.front();
+        stats.max = vec.back();
 
         const double sum = std::accumulate(vec.begin(), vec.end(), 0.0);
         stats.mean = sum / vec.size();
@@ -320,6 +376,10 @@ void output_result(const std::string& name,
     case OutputFormat::XML:
         renderToXML(new_name, description, value_stats, unit);
         break;
+
+    case OutputFormat::JSON:
+        renderToJSON(new_name, description, value_stats, unit);
+        break;
     }
 }
 /* Add a sentinel document (one with a the key SENTINEL_KEY).
@@ -1309,6 +1369,268 @@ static enum test_result perf_multi_thread_latency(engine_test_t* test) {
                                                      10000/* documents */);
 }
 
+/// How the keys of a workload are picked for each operation
+enum class KeyDistribution {
+    // Every key in turn (wrapping around)
+    Sequential,
+    // Every key is equally likely
+    Uniform,
+    // A small set of hot keys gets most of the operations
+    Zipfian
+};
+
+/// How the size of the documents written by a workload are picked
+enum class DocSizeDistribution {
+    // Every document is min_doc_size bytes
+    Fixed,
+    // Uniformly distributed in [min_doc_size, max_doc_size]
+    Uniform,
+    // Mostly small documents with a long tail up to max_doc_size
+    Pareto
+};
+
+struct WorkloadSpec {
+    std::string name;
+    int n_threads;
+    // Number of documents in the working set (loaded before the run)
+    size_t num_keys;
+    size_t ops_per_thread;
+    // Percentage of the operations which are gets (the rest are sets)
+    int read_ratio;
+    KeyDistribution keys;
+    DocSizeDistribution sizes;
+    size_t min_doc_size;
+    size_t max_doc_size;
+};
+
+/*
+ * Generates zipfian distributed indexes in [0, n) (index 0 being the most
+ * popular), by a binary search in the precomputed CDF. The CDF is read only
+ * so a single instance may be shared by all of the threads.
+ */
+class ZipfianDistribution {
+public:
+    ZipfianDistribution(size_t n, double theta = 0.99) : cdf(n) {
+        double sum = 0;
+        for (size_t i = 0; i < n; ++i) {
+            sum += 1.0 / std::pow(double(i + 1), theta);
+            cdf[i] = sum;
+        }
+        for (auto& c : cdf) {
+            c /= sum;
+        }
+    }
+
+    template <class Generator>
+    size_t operator()(Generator& g) const {
+        std::uniform_real_distribution<double> uniform(0, 1);
+        const auto it = std::lower_bound(cdf.begin(), cdf.end(), uniform(g));
+        return std::min(size_t(std::distance(cdf.begin(), it)),
+                        cdf.size() - 1);
+    }
+
+private:
+    std::vector<double> cdf;
+};
+
+template <class Generator>
+static size_t pick_doc_size(const WorkloadSpec& spec, Generator& g) {
+    switch (spec.sizes) {
+    case DocSizeDistribution::Fixed:
+        return spec.min_doc_size;
+    case DocSizeDistribution::Uniform: {
+        std::uniform_int_distribution<size_t> dist(spec.min_doc_size,
+                                                   spec.max_doc_size);
+        return dist(g);
+    }
+    case DocSizeDistribution::Pareto: {
+        // Pareto with shape 1.5 and scale min_doc_size, capped at max.
+        std::uniform_real_distribution<double> uniform(0, 1);
+        const double size =
+                spec.min_doc_size / std::pow(1.0 - uniform(g), 1.0 / 1.5);
+        return std::min(size_t(size), spec.max_doc_size);
+    }
+    }
+    throw std::invalid_argument("pick_doc_size: unknown distribution");
+}
+
+/*
+ * Drive a mix of gets and sets against the bucket from spec.n_threads
+ * client threads (each with its own cookie) at the same time, picking the
+ * keys and the document sizes from the distributions in the spec. Every
+ * thread uses its own seed so that runs are repeatable.
+ */
+static enum test_result perf_workload(EngineIface* h,
+                                      const WorkloadSpec& spec) {
+    // Only timing front-end performance, not considering persistence.
+    stop_persistence(h);
+
+    std::vector<std::string> keys;
+    keys.reserve(spec.num_keys);
+    for (size_t i = 0; i < spec.num_keys; ++i) {
+        keys.push_back("key" + std::to_string(i));
+    }
+    // All of the values are a prefix of the same buffer
+    const std::string data(spec.max_doc_size, 'x');
+
+    // Load the working set so that all of the gets hit.
+    {
+        std::mt19937 gen(0);
+        for (const auto& key : keys) {
+            checkeq(cb::engine_errc::success,
+                    storeCasVb11(h,
+                                 nullptr,
+                                 OPERATION_SET,
+                                 key.c_str(),
+                                 data.data(),
+                                 pick_doc_size(spec, gen),
+                                 0,
+                                 0,
+                                 Vbid(0))
+                            .first,
+                    "Failed to load a value");
+        }
+    }
+
+    const ZipfianDistribution zipfian(spec.num_keys);
+    std::vector<std::vector<hrtime_t>> get_timings(spec.n_threads);
+    std::vector<std::vector<hrtime_t>> set_timings(spec.n_threads);
+    ThreadGate start(spec.n_threads);
+
+    auto client = [&](int id) {
+        const void* cookie = testHarness->create_cookie();
+        std::mt19937 gen(id + 1);
+        std::uniform_int_distribution<size_t> uniform(0, spec.num_keys - 1);
+        std::uniform_int_distribution<int> percent(0, 99);
+        size_t next = id * (spec.num_keys / spec.n_threads);
+
+        get_timings[id].reserve(spec.ops_per_thread);
+        set_timings[id].reserve(spec.ops_per_thread);
+
+        start.threadUp();
+        for (size_t op = 0; op < spec.ops_per_thread; ++op) {
+            size_t index = 0;
+            switch (spec.keys) {
+            case KeyDistribution::Sequential:
+                index = next++ % spec.num_keys;
+                break;
+            case KeyDistribution::Uniform:
+                index = uniform(gen);
+                break;
+            case KeyDistribution::Zipfian:
+                index = zipfian(gen);
+                break;
+            }
+            const auto& key = keys[index];
+
+            if (percent(gen) < spec.read_ratio) {
+                const auto begin = std::chrono::steady_clock::now();
+                auto ret = get(h, cookie, key, Vbid(0));
+                checkeq(cb::engine_errc::success,
+                        ret.first,
+                        "Failed to get a value");
+                const auto end = std::chrono::steady_clock::now();
+                get_timings[id].push_back((end - begin).count());
+            } else {
+                const auto size = pick_doc_size(spec, gen);
+                const auto begin = std::chrono::steady_clock::now();
+                checkeq(cb::engine_errc::success,
+                        storeCasVb11(h,
+                                     cookie,
+                                     OPERATION_SET,
+                                     key.c_str(),
+                                     data.data(),
+                                     size,
+                                     0,
+                                     0,
+                                     Vbid(0))
+                                .first,
+                        "Failed to set a value");
+                const auto end = std::chrono::steady_clock::now();
+                set_timings[id].push_back((end - begin).count());
+            }
+        }
+        testHarness->destroy_cookie(cookie);
+    };
+
+    const auto begin = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int ii = 0; ii < spec.n_threads; ++ii) {
+        threads.emplace_back(client, ii);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    const auto duration = std::chrono::steady_clock::now() - begin;
+
+    add_sentinel_doc(h, Vbid(0));
+
+    // For the results, bring all the thread timings into a single array
+    std::vector<hrtime_t> all_gets, all_sets;
+    for (int ii = 0; ii < spec.n_threads; ++ii) {
+        all_gets.insert(all_gets.end(),
+                        get_timings[ii].begin(),
+                        get_timings[ii].end());
+        all_sets.insert(all_sets.end(),
+                        set_timings[ii].begin(),
+                        set_timings[ii].end());
+    }
+
+    const auto total_ops = spec.ops_per_thread * spec.n_threads;
+    const auto seconds =
+            std::chrono::duration_cast<std::chrono::duration<double>>(
+                    duration)
+                    .count();
+    std::string description("Workload [" + spec.name + "] - " +
+                            std::to_string(spec.n_threads) + " threads, " +
+                            std::to_string(total_ops) + " ops, " +
+                            std::to_string(size_t(total_ops / seconds)) +
+                            " ops/s (µs)");
+
+    std::vector<std::pair<std::string, std::vector<hrtime_t>*>> all_timings;
+    if (!all_gets.empty()) {
+        all_timings.push_back(std::make_pair("Get", &all_gets));
+    }
+    if (!all_sets.empty()) {
+        all_timings.push_back(std::make_pair("Set", &all_sets));
+    }
+    output_result(spec.name, description, all_timings, "µs");
+    return SUCCESS;
+}
+
+/* 4 clients doing 90% reads of fixed size documents over a uniformly
+ * accessed working set.
+ */
+static enum test_result perf_workload_4_threads_uniform(EngineIface* h) {
+    return perf_workload(h,
+                         {"4_threads_uniform_read_heavy",
+                          4, /* threads */
+                          10000, /* keys */
+                          ITERATIONS / 4, /* ops per thread */
+                          90, /* read % */
+                          KeyDistribution::Uniform,
+                          DocSizeDistribution::Fixed,
+                          256,
+                          256});
+}
+
+/* 8 clients doing a 50/50 read/write mix of variable size documents on a
+ * zipfian (hot keys) working set, so that the clients contend on the same
+ * hash buckets.
+ */
+static enum test_result perf_workload_8_threads_zipfian(EngineIface* h) {
+    return perf_workload(h,
+                         {"8_threads_zipfian_mixed",
+                          8, /* threads */
+                          10000, /* keys */
+                          ITERATIONS / 8, /* ops per thread */
+                          50, /* read % */
+                          KeyDistribution::Zipfian,
+                          DocSizeDistribution::Pareto,
+                          64,
+                          16384});
+}
+
 static enum test_result perf_latency_dcp_impact(EngineIface* h) {
     // Spin up a DCP replication background thread, then start the normal
     // latency test.
@@ -1610,6 +1932,21 @@ BaseTestCase testsuite_testcases[] = {
                    "backend=couchdb;ht_size=393209",
                    prepare, cleanup),
 
+        TestCase("Multi thread uniform workload",
+                 perf_workload_4_threads_uniform,
+                 test_setup,
+                 teardown,
+                 "backend=couchdb;ht_size=393209",
+                 prepare,
+                 cleanup),
+        TestCase("Multi thread zipfian workload",
+                 perf_workload_8_threads_zipfian,
+                 test_setup,
+                 teardown,
+                 "backend=couchdb;ht_size=393209",
+                 prepare,
+                 cleanup),
+
         TestCase("DCP impact on front-end latency", perf_latency_dcp_impact,
                  test_setup, teardown,
                  "backend=couchdb;ht_size=393209",
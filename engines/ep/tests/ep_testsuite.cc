@@ -3431,7 +3431,10 @@ static enum test_result test_warmup_stats(EngineIface* h) {
                                   "ep_warmup_key_count",
                                   "ep_warmup_dups",
                                   "ep_warmup_oom",
-                                  "ep_warmup_time"};
+                                  "ep_warmup_time",
+                                  "ep_warmup_bytes",
+                                  "ep_warmup_phase_initialize_time",
+                                  "ep_warmup_phase_create_vbuckets_time"};
     for (const auto* key : warmup_keys) {
         check(warmup_stats.find(key) != warmup_stats.end(),
               (std::string("Found no ") + key).c_str());
@@ -6702,7 +6705,10 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "chk_items",
               "estimate"}},
             {"dcp",
-             {"ep_dcp_count",
+             {"ep_dcp_compressed_value_cache_hits",
+              "ep_dcp_compressed_value_cache_mem_used",
+              "ep_dcp_compressed_value_cache_misses",
+              "ep_dcp_count",
               "ep_dcp_dead_conn_count",
               "ep_dcp_items_remaining",
               "ep_dcp_items_sent",
@@ -6735,6 +6741,7 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "vb_0:drift_ahead_threshold_exceeded",
               "vb_0:drift_behind_threshold",
               "vb_0:drift_behind_threshold_exceeded",
+              "vb_0:expiry_index_keys",
               "vb_0:high_seqno",
               "vb_0:high_prepared_seqno",
               "vb_0:ht_cache_size",
@@ -6798,6 +6805,7 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "vb_0:num_checkpoints",
               "vb_0:num_conn_cursors",
               "vb_0:num_open_checkpoint_items",
+              "vb_0:num_shared_cursor_reads",
               "vb_0:open_checkpoint_id",
               "vb_0:state"}},
             {"checkpoint 0",
@@ -6807,6 +6815,7 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "vb_0:num_checkpoints",
               "vb_0:num_conn_cursors",
               "vb_0:num_open_checkpoint_items",
+              "vb_0:num_shared_cursor_reads",
               "vb_0:open_checkpoint_id",
               "vb_0:state"}},
             {"uuid", {"uuid"}},
@@ -6814,27 +6823,42 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
             {"info", {"info"}},
             {"allocator", {"detailed"}},
             {"config",
-             {"ep_backend",
+             {"ep_auxio_thread_affinity",
+              "ep_backend",
               "ep_backfill_mem_threshold",
+              "ep_backfill_readahead_size",
               "ep_bfilter_enabled",
               "ep_bfilter_fp_prob",
               "ep_bfilter_key_count",
+              "ep_bfilter_layout",
               "ep_bfilter_residency_threshold",
               "ep_bucket_type",
               "ep_cache_size",
               "ep_chk_expel_enabled",
               "ep_chk_max_items",
               "ep_chk_period",
+              "ep_chk_remover_batch_size",
+              "ep_chk_remover_event_driven",
               "ep_chk_remover_stime",
+              "ep_chk_shared_cursor_reads",
+              "ep_collection_memory_quotas",
+              "ep_collections_drop_compaction_threshold",
               "ep_collections_enabled",
               "ep_collections_max_size",
               "ep_compaction_exp_mem_threshold",
+              "ep_compaction_max_concurrent",
+              "ep_compaction_max_write_rate",
               "ep_compaction_write_queue_cap",
               "ep_compression_mode",
               "ep_config_file",
               "ep_conflict_resolution_type",
               "ep_connection_manager_interval",
               "ep_couch_bucket",
+              "ep_couchstore_compaction_min_fragmentation",
+              "ep_couchstore_compaction_readahead_size",
+              "ep_couchstore_drop_behind",
+              "ep_couchstore_file_handle_cache_size",
+              "ep_couchstore_writeback_size",
               "ep_cursor_dropping_lower_mark",
               "ep_cursor_dropping_upper_mark",
               "ep_cursor_dropping_checkpoint_mem_upper_mark",
@@ -6842,11 +6866,17 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_data_traffic_enabled",
               "ep_dbname",
               "ep_dcp_backfill_byte_limit",
+              "ep_dcp_backfill_node_byte_limit",
+              "ep_dcp_backfill_node_weight",
+              "ep_dcp_backfill_prioritization",
+              "ep_dcp_compressed_value_cache_size",
               "ep_dcp_conn_buffer_size",
               "ep_dcp_conn_buffer_size_aggr_mem_threshold",
               "ep_dcp_conn_buffer_size_aggressive_perc",
               "ep_dcp_conn_buffer_size_max",
               "ep_dcp_conn_buffer_size_perc",
+              "ep_dcp_consumer_batched_ingest",
+              "ep_dcp_consumer_processor_tasks",
               "ep_dcp_enable_noop",
               "ep_dcp_ephemeral_backfill_type",
               "ep_dcp_flow_control_policy",
@@ -6855,41 +6885,63 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_dcp_idle_timeout",
               "ep_dcp_noop_mandatory_for_v5_features",
               "ep_dcp_noop_tx_interval",
+              "ep_dcp_producer_processor_tasks",
               "ep_dcp_producer_snapshot_marker_yield_limit",
               "ep_dcp_consumer_process_buffered_messages_yield_limit",
               "ep_dcp_consumer_process_buffered_messages_batch_size",
+              "ep_dcp_producer_step_batch_bytes",
+              "ep_dcp_producer_step_batch_items",
               "ep_dcp_scan_byte_limit",
               "ep_dcp_scan_item_limit",
+              "ep_dcp_shared_backfill",
               "ep_dcp_takeover_max_time",
+              "ep_decompressed_value_cache_size",
+              "ep_dedicated_arena",
+              "ep_dedicated_arena_huge_pages",
               "ep_defragmenter_age_threshold",
               "ep_defragmenter_chunk_duration",
               "ep_defragmenter_enabled",
               "ep_defragmenter_interval",
+              "ep_defragmenter_query_utilization",
               "ep_defragmenter_stored_value_age_threshold",
               "ep_disk_backfill_queue",
               "ep_durability_timeout_task_interval",
+              "ep_executor_cpu_shares",
               "ep_exp_pager_enabled",
+              "ep_exp_pager_full_scan_interval",
               "ep_exp_pager_initial_run_time",
               "ep_exp_pager_stime",
               "ep_failpartialwarmup",
               "ep_flusher_batch_split_trigger",
+              "ep_flusher_group_commit_window",
+              "ep_flusher_target_commit_time",
+              "ep_flusher_vbstate_group_commit",
               "ep_fsync_after_every_n_bytes_written",
               "ep_getl_default_timeout",
               "ep_getl_max_timeout",
               "ep_hlc_drift_ahead_threshold_us",
               "ep_hlc_drift_behind_threshold_us",
+              "ep_hot_key_cache_min_freq",
+              "ep_hot_key_cache_size",
+              "ep_ht_inline_value_size",
+              "ep_ht_layout",
               "ep_ht_locks",
               "ep_ht_resize_interval",
+              "ep_ht_shared_locks",
               "ep_ht_size",
               "ep_initfile",
               "ep_item_compressor_chunk_duration",
               "ep_item_compressor_interval",
+              "ep_item_compressor_tasks",
               "ep_item_eviction_age_percentage",
+              "ep_item_eviction_cost_weight",
               "ep_item_eviction_freq_counter_age_threshold",
               "ep_item_freq_decayer_chunk_duration",
+              "ep_item_freq_decayer_lazy",
               "ep_item_freq_decayer_percent",
               "ep_item_num_based_new_chk",
               "ep_keep_closed_chks",
+              "ep_lock_profiling_enabled",
               "ep_magma_commit_point_every_batch",
               "ep_magma_commit_point_interval",
               "ep_magma_delete_frag_ratio",
@@ -6906,6 +6958,7 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_magma_value_separation_size",
               "ep_magma_wal_buffer_size",
               "ep_magma_wal_num_buffers",
+              "ep_max_blob_segments",
               "ep_max_checkpoints",
               "ep_max_failover_entries",
               "ep_max_item_privileged_bytes",
@@ -6921,17 +6974,23 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_mem_used_merge_threshold_percent",
               "ep_min_compression_ratio",
               "ep_mutation_mem_threshold",
+              "ep_nonio_thread_affinity",
               "ep_num_auxio_threads",
               "ep_num_nonio_threads",
               "ep_num_reader_threads",
               "ep_num_writer_threads",
               "ep_pager_active_vb_pcnt",
+              "ep_pager_sampled_eviction",
+              "ep_pager_sampled_eviction_samples",
               "ep_pager_sleep_time_ms",
               "ep_postInitfile",
+              "ep_reader_thread_affinity",
               "ep_replication_throttle_cap_pcnt",
+              "ep_replication_throttle_pace_pcnt",
               "ep_replication_throttle_queue_cap",
               "ep_replication_throttle_threshold",
               "ep_retain_erroneous_tombstones",
+              "ep_rocksdb_expiry_compaction_filter",
               "ep_rocksdb_options",
               "ep_rocksdb_cf_options",
               "ep_rocksdb_bbt_options",
@@ -6945,7 +7004,10 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_rocksdb_seqno_cf_optimize_compaction",
               "ep_rocksdb_write_rate_limit",
               "ep_rocksdb_uc_max_size_amplification_percent",
+              "ep_rollback_fetch_values",
               "ep_scopes_max_size",
+              "ep_stat_group_cache_ttl_ms",
+              "ep_task_slow_runtime_threshold",
               "ep_time_synchronization",
               "ep_uuid",
               "ep_vb0",
@@ -6954,6 +7016,8 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_warmup_batch_size",
               "ep_warmup_min_items_threshold",
               "ep_warmup_min_memory_threshold",
+              "ep_warmup_tasks_per_shard",
+              "ep_writer_thread_affinity",
               "ep_xattr_enabled"}},
             {"workload",
              {"ep_workload:num_readers",
@@ -7005,11 +7069,14 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_active_datatype_xattr",
               "ep_active_hlc_drift",
               "ep_active_hlc_drift_count",
+              "ep_auxio_thread_affinity",
               "ep_backend",
               "ep_backfill_mem_threshold",
+              "ep_backfill_readahead_size",
               "ep_bfilter_enabled",
               "ep_bfilter_fp_prob",
               "ep_bfilter_key_count",
+              "ep_bfilter_layout",
               "ep_bfilter_residency_threshold",
               "ep_bg_fetch_avg_read_amplification",
               "ep_bg_fetched",
@@ -7025,17 +7092,29 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_chk_max_items",
               "ep_chk_period",
               "ep_chk_persistence_remains",
+              "ep_chk_remover_batch_size",
+              "ep_chk_remover_event_driven",
               "ep_chk_remover_stime",
+              "ep_chk_shared_cursor_reads",
               "ep_clock_cas_drift_threshold_exceeded",
+              "ep_collection_memory_quotas",
+              "ep_collections_drop_compaction_threshold",
               "ep_collections_enabled",
               "ep_collections_max_size",
               "ep_compaction_exp_mem_threshold",
+              "ep_compaction_max_concurrent",
+              "ep_compaction_max_write_rate",
               "ep_compaction_write_queue_cap",
               "ep_compression_mode",
               "ep_config_file",
               "ep_conflict_resolution_type",
               "ep_connection_manager_interval",
               "ep_couch_bucket",
+              "ep_couchstore_compaction_min_fragmentation",
+              "ep_couchstore_compaction_readahead_size",
+              "ep_couchstore_drop_behind",
+              "ep_couchstore_file_handle_cache_size",
+              "ep_couchstore_writeback_size",
               "ep_cursor_dropping_lower_mark",
               "ep_cursor_dropping_lower_threshold",
               "ep_cursor_dropping_upper_mark",
@@ -7049,13 +7128,19 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_data_traffic_enabled",
               "ep_dbname",
               "ep_dcp_backfill_byte_limit",
+              "ep_dcp_backfill_node_byte_limit",
+              "ep_dcp_backfill_node_weight",
+              "ep_dcp_backfill_prioritization",
+              "ep_dcp_compressed_value_cache_size",
               "ep_dcp_conn_buffer_size",
               "ep_dcp_conn_buffer_size_aggr_mem_threshold",
               "ep_dcp_conn_buffer_size_aggressive_perc",
               "ep_dcp_conn_buffer_size_max",
               "ep_dcp_conn_buffer_size_perc",
+              "ep_dcp_consumer_batched_ingest",
               "ep_dcp_consumer_process_buffered_messages_batch_size",
               "ep_dcp_consumer_process_buffered_messages_yield_limit",
+              "ep_dcp_consumer_processor_tasks",
               "ep_dcp_enable_noop",
               "ep_dcp_ephemeral_backfill_type",
               "ep_dcp_flow_control_policy",
@@ -7064,16 +7149,28 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_dcp_min_compression_ratio",
               "ep_dcp_noop_mandatory_for_v5_features",
               "ep_dcp_noop_tx_interval",
+              "ep_dcp_producer_processor_tasks",
               "ep_dcp_producer_snapshot_marker_yield_limit",
+              "ep_dcp_producer_step_batch_bytes",
+              "ep_dcp_producer_step_batch_items",
               "ep_dcp_scan_byte_limit",
               "ep_dcp_scan_item_limit",
+              "ep_dcp_shared_backfill",
               "ep_dcp_takeover_max_time",
+              "ep_decompressed_value_cache_hits",
+              "ep_decompressed_value_cache_mem_used",
+              "ep_decompressed_value_cache_misses",
+              "ep_decompressed_value_cache_size",
+              "ep_dedicated_arena",
+              "ep_dedicated_arena_huge_pages",
               "ep_defragmenter_age_threshold",
               "ep_defragmenter_chunk_duration",
               "ep_defragmenter_enabled",
               "ep_defragmenter_interval",
               "ep_defragmenter_num_moved",
+              "ep_defragmenter_num_skipped",
               "ep_defragmenter_num_visited",
+              "ep_defragmenter_query_utilization",
               "ep_defragmenter_stored_value_age_threshold",
               "ep_defragmenter_sv_num_moved",
               "ep_degraded_mode",
@@ -7084,7 +7181,9 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_diskqueue_pending",
               "ep_disk_backfill_queue",
               "ep_durability_timeout_task_interval",
+              "ep_executor_cpu_shares",
               "ep_exp_pager_enabled",
+              "ep_exp_pager_full_scan_interval",
               "ep_exp_pager_initial_run_time",
               "ep_exp_pager_stime",
               "ep_expired_access",
@@ -7093,15 +7192,29 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_expiry_pager_task_time",
               "ep_failpartialwarmup",
               "ep_flush_all",
+              "ep_flush_callback_time_ns_total",
+              "ep_flush_commit_time_ns_total",
               "ep_flush_duration_total",
+              "ep_flush_fetch_time_ns_total",
+              "ep_flush_set_time_ns_total",
               "ep_flusher_batch_split_trigger",
+              "ep_flusher_group_commit_window",
+              "ep_flusher_target_commit_time",
+              "ep_flusher_vbstate_group_commit",
               "ep_fsync_after_every_n_bytes_written",
               "ep_getl_default_timeout",
               "ep_getl_max_timeout",
               "ep_hlc_drift_ahead_threshold_us",
               "ep_hlc_drift_behind_threshold_us",
+              "ep_hot_key_cache_hits",
+              "ep_hot_key_cache_items",
+              "ep_hot_key_cache_min_freq",
+              "ep_hot_key_cache_size",
+              "ep_ht_inline_value_size",
+              "ep_ht_layout",
               "ep_ht_locks",
               "ep_ht_resize_interval",
+              "ep_ht_shared_locks",
               "ep_ht_size",
               "ep_initfile",
               "ep_io_bg_fetch_read_count",
@@ -7109,13 +7222,18 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_io_compaction_write_bytes",
               "ep_io_total_read_bytes",
               "ep_io_total_write_bytes",
+              "ep_item_compressor_bytes_saved",
               "ep_item_compressor_chunk_duration",
               "ep_item_compressor_interval",
               "ep_item_compressor_num_compressed",
+              "ep_item_compressor_num_rejected",
               "ep_item_compressor_num_visited",
+              "ep_item_compressor_tasks",
               "ep_item_eviction_age_percentage",
+              "ep_item_eviction_cost_weight",
               "ep_item_eviction_freq_counter_age_threshold",
               "ep_item_freq_decayer_chunk_duration",
+              "ep_item_freq_decayer_lazy",
               "ep_item_freq_decayer_percent",
               "ep_item_num",
               "ep_item_num_based_new_chk",
@@ -7123,6 +7241,8 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_items_rm_from_checkpoints",
               "ep_keep_closed_chks",
               "ep_kv_size",
+              "ep_lock_profiling_enabled",
+              "ep_max_blob_segments",
               "ep_max_checkpoints",
               "ep_max_failover_entries",
               "ep_max_item_privileged_bytes",
@@ -7146,6 +7266,7 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_meta_data_memory",
               "ep_min_compression_ratio",
               "ep_mutation_mem_threshold",
+              "ep_nonio_thread_affinity",
               "ep_num_access_scanner_runs",
               "ep_num_access_scanner_skips",
               "ep_num_auxio_threads",
@@ -7187,6 +7308,8 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_oom_errors",
               "ep_overhead",
               "ep_pager_active_vb_pcnt",
+              "ep_pager_sampled_eviction",
+              "ep_pager_sampled_eviction_samples",
               "ep_pager_sleep_time_ms",
               "ep_pending_compactions",
               "ep_pending_ops",
@@ -7196,6 +7319,7 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_persist_vbstate_total",
               "ep_postInitfile",
               "ep_queue_size",
+              "ep_reader_thread_affinity",
               "ep_replica_ahead_exceptions",
               "ep_replica_behind_exceptions",
               "ep_replica_datatype_json",
@@ -7209,9 +7333,11 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_replica_hlc_drift",
               "ep_replica_hlc_drift_count",
               "ep_replication_throttle_cap_pcnt",
+              "ep_replication_throttle_pace_pcnt",
               "ep_replication_throttle_queue_cap",
               "ep_replication_throttle_threshold",
               "ep_retain_erroneous_tombstones",
+              "ep_rocksdb_expiry_compaction_filter",
               "ep_rocksdb_options",
               "ep_rocksdb_cf_options",
               "ep_rocksdb_bbt_options",
@@ -7226,13 +7352,18 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_rocksdb_write_rate_limit",
               "ep_rocksdb_uc_max_size_amplification_percent",
               "ep_rollback_count",
+              "ep_rollback_fetch_values",
               "ep_scopes_max_size",
               "ep_startup_time",
+              "ep_stat_group_cache_hits",
+              "ep_stat_group_cache_misses",
+              "ep_stat_group_cache_ttl_ms",
               "ep_storage_age",
               "ep_storage_age_highwat",
               "ep_storedval_num",
               "ep_storedval_overhead",
               "ep_storedval_size",
+              "ep_task_slow_runtime_threshold",
               "ep_time_synchronization",
               "ep_tmp_oom_errors",
               "ep_total_cache_size",
@@ -7252,7 +7383,9 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
               "ep_warmup_batch_size",
               "ep_warmup_min_items_threshold",
               "ep_warmup_min_memory_threshold",
+              "ep_warmup_tasks_per_shard",
               "ep_workload_pattern",
+              "ep_writer_thread_affinity",
               "ep_xattr_enabled",
               "mem_used",
               "mem_used_estimate",
@@ -7369,8 +7502,10 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
                          std::initializer_list<std::string>{"ep_db_data_size",
                                                             "ep_db_file_size"});
         eng_stats.insert(eng_stats.end(),
-                         std::initializer_list<std::string>{"ep_flusher_state",
-                                                            "ep_flusher_todo"});
+                         std::initializer_list<std::string>{
+                                 "ep_flusher_durable_prepare_flushes",
+                                 "ep_flusher_state",
+                                 "ep_flusher_todo"});
         eng_stats.insert(eng_stats.end(),
                          {"ep_commit_num",
                           "ep_commit_time",
@@ -7387,12 +7522,22 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
         eng_stats.insert(eng_stats.end(),
                          {"ep_access_scanner_enabled",
                           "ep_alog_block_size",
+                          "ep_alog_compaction_interval",
+                          "ep_alog_format_version",
+                          "ep_alog_incremental",
                           "ep_alog_max_stored_items",
                           "ep_alog_path",
                           "ep_alog_resident_ratio_threshold",
                           "ep_alog_sleep_time",
                           "ep_alog_task_time",
-                          "ep_item_eviction_policy"});
+                          "ep_bfilter_persist",
+                          "ep_bg_fetch_batch_delay_us",
+                          "ep_io_thread_autotune",
+                          "ep_io_thread_autotune_max_threads",
+                          "ep_io_thread_autotune_min_threads",
+                          "ep_item_eviction_policy",
+                          "ep_warmup_early_traffic",
+                          "ep_warmup_hashtable_image"});
 
         // 'diskinfo and 'diskinfo detail' keys should be present now.
         statsKeys["diskinfo"] = {"ep_db_data_size", "ep_db_file_size"};
@@ -7420,12 +7565,22 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
         config_stats.insert(config_stats.end(),
                             {"ep_access_scanner_enabled",
                              "ep_alog_block_size",
+                             "ep_alog_compaction_interval",
+                             "ep_alog_format_version",
+                             "ep_alog_incremental",
                              "ep_alog_max_stored_items",
                              "ep_alog_path",
                              "ep_alog_resident_ratio_threshold",
                              "ep_alog_sleep_time",
                              "ep_alog_task_time",
-                             "ep_item_eviction_policy"});
+                             "ep_bfilter_persist",
+                             "ep_bg_fetch_batch_delay_us",
+                             "ep_io_thread_autotune",
+                             "ep_io_thread_autotune_max_threads",
+                             "ep_io_thread_autotune_min_threads",
+                             "ep_item_eviction_policy",
+                             "ep_warmup_early_traffic",
+                             "ep_warmup_hashtable_image"});
     }
 
     if (isEphemeralBucket(h)) {
@@ -7436,6 +7591,7 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
                           "ep_ephemeral_metadata_purge_age",
                           "ep_ephemeral_metadata_purge_interval",
                           "ep_ephemeral_metadata_purge_stale_chunk_duration",
+                          "ep_ephemeral_seqlist_type",
 
                           "vb_active_auto_delete_count",
                           "vb_active_ht_tombstone_purged_count",
@@ -7490,7 +7646,8 @@ static enum test_result test_mb19687_fixed(EngineIface* h) {
                  "ep_ephemeral_metadata_mark_stale_chunk_duration",
                  "ep_ephemeral_metadata_purge_age",
                  "ep_ephemeral_metadata_purge_interval",
-                 "ep_ephemeral_metadata_purge_stale_chunk_duration"});
+                 "ep_ephemeral_metadata_purge_stale_chunk_duration",
+                 "ep_ephemeral_seqlist_type"});
     }
 
     // In addition to the exact stat keys above, we also use regex patterns
@@ -7620,12 +7777,23 @@ static enum test_result test_mb19687_variable(EngineIface* h) {
                      "mem_used_estimate",
                      "mem_used_merge_threshold"
              }},
+            {"lock-profile",
+             {"enabled",
+              "checkpoint_queue:acquisitions",
+              "checkpoint_queue:contended",
+              "dcp_checkpoint_creator:acquisitions",
+              "dcp_checkpoint_creator:contended",
+              "dcp_stream:acquisitions",
+              "dcp_stream:contended",
+              "hash_table:acquisitions",
+              "hash_table:contended"}},
 
             // These stat groups return histograms so we can't guess the
             // key names...
             {"timings", {}},
             {"scheduler", {}},
             {"runtimes", {}},
+            {"task-profile", {}},
             {"kvtimings", {}},
     };
 
@@ -7637,6 +7805,7 @@ static enum test_result test_mb19687_variable(EngineIface* h) {
                                         "ep_warmup_value_count",
                                         "ep_warmup_dups",
                                         "ep_warmup_oom",
+                                        "ep_warmup_bytes",
                                         "ep_warmup_min_memory_threshold",
                                         "ep_warmup_min_item_threshold",
                                         "ep_warmup_estimated_key_count",
@@ -45,11 +45,6 @@ public:
         return allSeqnos;
     }
 
-    /// Expose the rangeReadLock for testing.
-    std::mutex& getRangeReadLock() {
-        return rangeReadLock;
-    }
-
     /* Register fake read range for testing */
     void registerFakeReadRange(seqno_t start, seqno_t end) {
         std::lock_guard<SpinLock> lh(rangeLock);
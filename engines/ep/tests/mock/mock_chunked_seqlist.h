@@ -0,0 +1,63 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Mock of the ChunkedSeqList class. Wraps the real ChunkedSeqList class
+ * and provides access to its elements and chunks.
+ */
+#pragma once
+
+#include "chunked_seqlist.h"
+
+#include <mutex>
+#include <vector>
+
+class MockChunkedSeqList : public ChunkedSeqList {
+public:
+    MockChunkedSeqList(EPStats& st) : ChunkedSeqList(Vbid(0), st) {
+    }
+
+    std::vector<seqno_t> getAllSeqnoForVerification() const {
+        std::vector<seqno_t> allSeqnos;
+        std::lock_guard<std::mutex> lckGd(writeLock);
+
+        for (const auto& chunk : chunks) {
+            for (size_t slot = 0; slot < chunk.second->used; ++slot) {
+                if (const auto* val = chunk.second->slots[slot]) {
+                    allSeqnos.push_back(val->getBySeqno());
+                }
+            }
+        }
+        return allSeqnos;
+    }
+
+    size_t getNumChunks() const {
+        std::lock_guard<std::mutex> lckGd(writeLock);
+        return chunks.size();
+    }
+
+    /* Register fake read range for testing */
+    void registerFakeReadRange(seqno_t start, seqno_t end) {
+        std::lock_guard<SpinLock> lh(rangeLock);
+        readRange = SeqRange(start, end);
+    }
+
+    void resetReadRange() {
+        std::lock_guard<SpinLock> lh(rangeLock);
+        readRange.reset();
+    }
+};
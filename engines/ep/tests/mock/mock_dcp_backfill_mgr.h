@@ -40,4 +40,9 @@ public:
     BackfillScanBuffer& public_getBackfillScanBuffer() {
         return scanBuffer;
     }
+
+    static void public_enqueue(std::list<UniqueDCPBackfillPtr>& queue,
+                               UniqueDCPBackfillPtr backfill) {
+        enqueue(queue, std::move(backfill));
+    }
 };
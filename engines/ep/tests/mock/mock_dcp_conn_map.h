@@ -19,6 +19,7 @@
 #include "conn_notifier.h"
 #include "connhandler.h"
 #include "dcp/dcpconnmap.h"
+#include "dcp/producer.h"
 
 /*
  * Mock of the DcpConnMap class.  Wraps the real DcpConnMap, but exposes
@@ -63,6 +64,18 @@ public:
                        }) != list.end();
     }
 
+    /// return if the named producer is in the vbid's vbProducers snapshot
+    bool isProducerNotified(Vbid vbid, const std::string& name) const {
+        const auto producers = std::atomic_load(&vbProducers[vbid.get()]);
+        return producers &&
+               std::find_if(producers->begin(),
+                            producers->end(),
+                            [&name](const std::weak_ptr<DcpProducer>& c) {
+                                auto p = c.lock();
+                                return p && p->getName() == name;
+                            }) != producers->end();
+    }
+
 protected:
     /**
      * @param engine The engine
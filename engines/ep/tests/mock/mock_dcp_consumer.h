@@ -59,6 +59,18 @@ public:
         notifyVbucketReady(vbid);
     }
 
+    bool public_claimVbucket(Vbid vbid) {
+        return claimVbucket(vbid);
+    }
+
+    void public_releaseVbucket(Vbid vbid) {
+        releaseVbucket(vbid);
+    }
+
+    bool isVbucketReady(Vbid vbid) const {
+        return vbReady.exists(vbid);
+    }
+
     uint32_t getNumBackoffs() const {
         return backoffs.load();
     }
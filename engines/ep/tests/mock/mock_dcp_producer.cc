@@ -103,10 +103,10 @@ std::shared_ptr<Stream> MockDcpProducer::findStream(Vbid vbid) {
 }
 
 ActiveStreamCheckpointProcessorTask&
-MockDcpProducer::getCheckpointSnapshotTask() const {
+MockDcpProducer::getCheckpointSnapshotTask(size_t index) const {
     LockHolder guard(checkpointCreator->mutex);
     return *static_cast<ActiveStreamCheckpointProcessorTask*>(
-            checkpointCreator->task.get());
+            checkpointCreator->tasks.at(index).get());
 }
 
 std::pair<std::shared_ptr<Stream>, bool> MockDcpProducer::findStream(
@@ -85,21 +85,24 @@ public:
     }
 
     /**
-     * Create the ActiveStreamCheckpointProcessorTask and assign to
-     * checkpointCreator->task
+     * Create the ActiveStreamCheckpointProcessorTasks and assign to
+     * checkpointCreator->tasks
      */
     void createCheckpointProcessorTask() {
         DcpProducer::createCheckpointProcessorTask();
     }
 
     /**
-     * Schedule the checkpointCreator->task on the ExecutorPool
+     * Schedule the checkpointCreator->tasks on the ExecutorPool
      */
     void scheduleCheckpointProcessorTask() {
         DcpProducer::scheduleCheckpointProcessorTask();
     }
 
-    ActiveStreamCheckpointProcessorTask& getCheckpointSnapshotTask() const;
+    /// @param index the index of the task among the producer's
+    ///        dcp_producer_processor_tasks
+    ActiveStreamCheckpointProcessorTask& getCheckpointSnapshotTask(
+            size_t index = 0) const;
 
     /**
      * Finds the stream for a given vbucket
@@ -82,4 +82,10 @@ public:
     bool public_enableTraffic(bool enable) {
         return enableTraffic(enable);
     }
+
+    /// Create the engine's BucketArena (as initialize does for
+    /// dedicated_arena=true)
+    bool public_createArena(bool hugePages = false) {
+        return arena.create(*serverApi->alloc_hooks, hugePages);
+    }
 };
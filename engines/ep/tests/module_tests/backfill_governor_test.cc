@@ -0,0 +1,69 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Unit tests for the BackfillGovernor
+ */
+
+#include "dcp/backfill_governor.h"
+
+#include <folly/portability/GTest.h>
+
+#include <limits>
+
+TEST(BackfillGovernorTest, DisabledByDefault) {
+    BackfillGovernor governor;
+    governor.addWeight(1);
+    EXPECT_EQ(std::numeric_limits<size_t>::max(), governor.getShare(1));
+}
+
+TEST(BackfillGovernorTest, WeightedShares) {
+    BackfillGovernor governor;
+    governor.setLimit(1000);
+
+    governor.addWeight(1);
+    EXPECT_EQ(1000, governor.getShare(1));
+
+    governor.addWeight(3);
+    EXPECT_EQ(250, governor.getShare(1));
+    EXPECT_EQ(750, governor.getShare(3));
+
+    // The shares of the remaining managers grow as the others finish
+    governor.removeWeight(3);
+    EXPECT_EQ(1000, governor.getShare(1));
+    governor.removeWeight(1);
+    EXPECT_EQ(0, governor.getTotalWeight());
+}
+
+TEST(BackfillGovernorTest, LargeBudget) {
+    BackfillGovernor governor;
+    governor.setLimit(std::numeric_limits<size_t>::max() / 2);
+    governor.addWeight(50);
+    governor.addWeight(50);
+    EXPECT_NEAR(double(std::numeric_limits<size_t>::max() / 4),
+                double(governor.getShare(50)),
+                double(std::numeric_limits<size_t>::max() / 1000));
+}
+
+TEST(BackfillGovernorTest, BytesRead) {
+    BackfillGovernor governor;
+    governor.bytesRead(100);
+    governor.bytesRead(50);
+    EXPECT_EQ(150, governor.getBytesRead());
+    governor.bytesReleased(150);
+    EXPECT_EQ(0, governor.getBytesRead());
+}
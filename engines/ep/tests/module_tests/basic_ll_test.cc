@@ -516,6 +516,42 @@ TEST_F(BasicLinkedListTest, RangeIterator) {
     EXPECT_EQ(expectedSeqno, actualSeqno);
 }
 
+TEST_F(BasicLinkedListTest, RangeIteratorSeek) {
+    const seqno_t interval = BasicLinkedList::SeqnoIndexInterval;
+    const int numItems = 3 * interval + 10;
+    addNewItemsToList(1, std::string("key"), numItems);
+
+    auto itr = getRangeIterator();
+
+    /* Before the first indexed seqno there is nothing to jump to */
+    itr.seek(interval - 1);
+    EXPECT_EQ(1, itr.curr());
+
+    /* Jumps to the last indexed element at or before the seqno */
+    const seqno_t start = 2 * interval + 100;
+    itr.seek(start);
+    EXPECT_EQ(2 * interval, itr.curr());
+    EXPECT_EQ(numItems - 2 * interval + 1, itr.count());
+
+    /* Never moves back */
+    itr.seek(interval + 1);
+    EXPECT_EQ(2 * interval, itr.curr());
+
+    while (itr.curr() < start) {
+        ++itr;
+    }
+    std::vector<seqno_t> actualSeqno;
+    while (itr.curr() != itr.end()) {
+        actualSeqno.push_back((*itr).getBySeqno());
+        ++itr;
+    }
+    std::vector<seqno_t> expectedSeqno;
+    for (seqno_t i = start; i <= numItems; ++i) {
+        expectedSeqno.push_back(i);
+    }
+    EXPECT_EQ(expectedSeqno, actualSeqno);
+}
+
 TEST_F(BasicLinkedListTest, RangeIteratorNoItems) {
     auto itr = getRangeIterator();
     /* Since there are no items in the list to iterate over, we expect itr start
@@ -683,7 +719,7 @@ TEST_F(BasicLinkedListTest, RangeIteratorUpdateItemDuringRead) {
 }
 
 /* Creates 2 range iterators such that iterator2 is created after iterator1
-   has read all items, and has hence released the rangeReadLock, but before
+   has read all items, and has hence released its read range, but before
    iterator1 is deleted */
 TEST_F(BasicLinkedListTest, MultipleRangeIterator_MB24474) {
     const int numItems = 3;
@@ -721,6 +757,78 @@ TEST_F(BasicLinkedListTest, MultipleRangeIterator_MB24474) {
     EXPECT_EQ(expectedSeqno, actualSeqno);
 }
 
+TEST_F(BasicLinkedListTest, ConcurrentRangeIterators) {
+    const int numItems = 3;
+    const std::string keyPrefix("key");
+
+    /* Add 3 items */
+    std::vector<seqno_t> expectedSeqno =
+            addNewItemsToList(1, keyPrefix, numItems);
+
+    {
+        auto itr1 = getRangeIterator();
+        auto itr2 = getRangeIterator();
+
+        /* Both iterators read all the items, interleaved */
+        std::vector<seqno_t> actualSeqno1;
+        std::vector<seqno_t> actualSeqno2;
+        while (itr1.curr() != itr1.end() || itr2.curr() != itr2.end()) {
+            if (itr1.curr() != itr1.end()) {
+                actualSeqno1.push_back((*itr1).getBySeqno());
+                ++itr1;
+            }
+            if (itr2.curr() != itr2.end()) {
+                actualSeqno2.push_back((*itr2).getBySeqno());
+                ++itr2;
+            }
+        }
+        EXPECT_EQ(expectedSeqno, actualSeqno1);
+        EXPECT_EQ(expectedSeqno, actualSeqno2);
+    }
+
+    /* Iterator created now, should be able to read all items */
+    auto itr = getRangeIterator();
+    std::vector<seqno_t> actualSeqno;
+
+    /* Read all the items with the iterator */
+    while (itr.curr() != itr.end()) {
+        actualSeqno.push_back((*itr).getBySeqno());
+        ++itr;
+    }
+    EXPECT_EQ(expectedSeqno, actualSeqno);
+}
+
+/* The list protects the union of the ranges of concurrent iterators; the
+   range of an iterator which is ahead doesn't unprotect items another
+   iterator is yet to read */
+TEST_F(BasicLinkedListTest, ConcurrentRangeIteratorsProtectLowestRange) {
+    const int numItems = 3;
+    const std::string keyPrefix("key");
+
+    /* Add 3 items */
+    addNewItemsToList(1, keyPrefix, numItems);
+
+    auto itr1 = getRangeIterator();
+    auto itr2 = getRangeIterator();
+
+    /* Move itr2 past the first item */
+    ++itr2;
+    EXPECT_EQ(2, itr2.curr());
+
+    /* Update key1; itr1 is yet to read it, so it must be appended */
+    EXPECT_EQ(1, basicLL->getRangeReadBegin());
+    updateItemDuringRangeRead(numItems, keyPrefix + std::to_string(1));
+    EXPECT_EQ(1, basicLL->getNumStaleItems());
+
+    /* itr1 reads all the items */
+    std::vector<seqno_t> actualSeqno;
+    while (itr1.curr() != itr1.end()) {
+        actualSeqno.push_back((*itr1).getBySeqno());
+        ++itr1;
+    }
+    EXPECT_EQ(std::vector<seqno_t>({1, 2, 3}), actualSeqno);
+}
+
 TEST_F(BasicLinkedListTest, NonBlockingRangeIterators) {
     const int numItems = 3;
     const std::string keyPrefix("key");
@@ -731,12 +839,13 @@ TEST_F(BasicLinkedListTest, NonBlockingRangeIterators) {
 
     {
         auto itr1 = getRangeIterator();
+        /* Creating an iterator doesn't wait for the one in progress */
         auto itr2 = basicLL->makeRangeIterator(true /*isBackfill*/);
-        /* itr1 is already using the list, we cannot have another iterator */
-        EXPECT_FALSE(itr2);
+        EXPECT_TRUE(itr2);
 
-        /* itr1 goes out of scope and releases the read lock on the list */
+        /* itr1 and itr2 go out of scope and release their ranges */
     }
+    EXPECT_EQ(0, basicLL->getRangeReadBegin());
 
     /* Iterator created now, should be able to read all items */
     auto itr = getRangeIterator();
@@ -799,6 +908,42 @@ TEST_F(BasicLinkedListTest, PurgeTillLast) {
     EXPECT_EQ(expectedSeqno, basicLL->getAllSeqnoForVerification());
 }
 
+/* Purging runs alongside a range read: only the stale items the iterator has
+   passed are purged, the rest once the iterator is done */
+TEST_F(BasicLinkedListTest, PurgeDuringRangeRead) {
+    addStaleItem("stale1", 1);
+    addNewItemsToList(2, "key", 2);
+    addStaleItem("stale4", 4);
+    addNewItemsToList(5, "key", 1);
+    ASSERT_EQ(2, basicLL->getNumStaleItems());
+
+    {
+        auto itr = getRangeIterator();
+        ++itr;
+        ++itr;
+        ASSERT_EQ(3, itr.curr());
+
+        /* s:1 is behind the iterator, s:4 ahead of it */
+        EXPECT_EQ(1, basicLL->purgeTombstones(4));
+        EXPECT_EQ(1, basicLL->getNumStaleItems());
+
+        /* The iterator still reads all the items ahead */
+        std::vector<seqno_t> actualSeqno;
+        while (itr.curr() != itr.end()) {
+            actualSeqno.push_back((*itr).getBySeqno());
+            ++itr;
+        }
+        std::vector<seqno_t> expectedSeqno = {3, 4, 5};
+        EXPECT_EQ(expectedSeqno, actualSeqno);
+    }
+
+    /* Resumes from where it stopped */
+    EXPECT_EQ(1, basicLL->purgeTombstones(4));
+    EXPECT_EQ(0, basicLL->getNumStaleItems());
+    std::vector<seqno_t> expectedSeqno = {2, 3, 5};
+    EXPECT_EQ(expectedSeqno, basicLL->getAllSeqnoForVerification());
+}
+
 /* 'EphemeralVBucket' (class that has the list) never calls the purge of the
    only element, but the list must support generic purge (that is purge until
    any element). */
@@ -90,3 +90,85 @@ INSTANTIATE_TEST_CASE_P(
         BloomFilterDocKeyTest,
         ::testing::Combine(::testing::ValuesIn(allDocNamespaces),
                            ::testing::ValuesIn(allDocNamespaces)), );
+
+class BloomFilterLayoutTest
+    : public ::testing::TestWithParam<BloomFilter::Layout> {};
+
+// Every key added is found, and the false positive rate is roughly what we
+// asked for
+TEST_P(BloomFilterLayoutTest, FalsePositiveRate) {
+    const size_t keys = 10000;
+    BloomFilter filter(keys, 0.01, BFILTER_ENABLED, GetParam());
+    for (size_t i = 0; i < keys; i++) {
+        filter.addKey(makeStoredDocKey("key_" + std::to_string(i)));
+    }
+    EXPECT_LE(keys * 0.99, filter.getNumOfKeysInFilter());
+    EXPECT_GE(keys, filter.getNumOfKeysInFilter());
+
+    size_t falsePositives = 0;
+    for (size_t i = 0; i < keys; i++) {
+        EXPECT_TRUE(filter.maybeKeyExists(
+                makeStoredDocKey("key_" + std::to_string(i))));
+        if (filter.maybeKeyExists(
+                    makeStoredDocKey("missing_" + std::to_string(i)))) {
+            falsePositives++;
+        }
+    }
+    EXPECT_GT(keys * 0.03, falsePositives);
+}
+
+TEST_P(BloomFilterLayoutTest, Disabled) {
+    BloomFilter filter(100, 0.01, BFILTER_ENABLED, GetParam());
+    filter.addKey(makeStoredDocKey("key"));
+    filter.setStatus(BFILTER_DISABLED);
+    EXPECT_EQ(0, filter.getNumOfKeysInFilter());
+    EXPECT_EQ(0, filter.getFilterSize());
+    EXPECT_TRUE(filter.maybeKeyExists(makeStoredDocKey("missing")));
+}
+
+TEST_P(BloomFilterLayoutTest, Serialise) {
+    BloomFilter filter(1000, 0.01, BFILTER_ENABLED, GetParam());
+    for (size_t i = 0; i < 100; i++) {
+        filter.addKey(makeStoredDocKey("key_" + std::to_string(i)));
+    }
+
+    const auto data = filter.serialise();
+    auto copy = BloomFilter::deserialise(data.data(), data.size());
+    ASSERT_TRUE(copy);
+    EXPECT_EQ(BFILTER_ENABLED, copy->getStatus());
+    EXPECT_EQ(filter.getFilterSize(), copy->getFilterSize());
+    EXPECT_EQ(filter.getNumOfKeysInFilter(), copy->getNumOfKeysInFilter());
+    for (size_t i = 0; i < 1000; i++) {
+        const auto key = makeStoredDocKey("key_" + std::to_string(i));
+        EXPECT_EQ(filter.maybeKeyExists(key), copy->maybeKeyExists(key));
+    }
+
+    // Truncated data isn't a filter
+    EXPECT_FALSE(BloomFilter::deserialise(data.data(), data.size() - 1));
+    EXPECT_FALSE(BloomFilter::deserialise(data.data(), 4));
+}
+
+TEST_P(BloomFilterLayoutTest, Merge) {
+    BloomFilter filter(1000, 0.01, BFILTER_ENABLED, GetParam());
+    BloomFilter other(1000, 0.01, BFILTER_ENABLED, GetParam());
+    filter.addKey(makeStoredDocKey("key1"));
+    other.addKey(makeStoredDocKey("key2"));
+
+    ASSERT_TRUE(filter.merge(other));
+    EXPECT_TRUE(filter.maybeKeyExists(makeStoredDocKey("key1")));
+    EXPECT_TRUE(filter.maybeKeyExists(makeStoredDocKey("key2")));
+
+    BloomFilter bigger(100000, 0.01, BFILTER_ENABLED, GetParam());
+    EXPECT_FALSE(filter.merge(bigger));
+}
+
+INSTANTIATE_TEST_CASE_P(Layouts,
+                        BloomFilterLayoutTest,
+                        ::testing::Values(BloomFilter::Layout::Bitwise,
+                                          BloomFilter::Layout::Blocked),
+                        [](const ::testing::TestParamInfo<BloomFilter::Layout>&
+                                   info) {
+                            return info.param == BloomFilter::Layout::Blocked
+                                           ? "Blocked"
+                                           : "Bitwise";
+                        });
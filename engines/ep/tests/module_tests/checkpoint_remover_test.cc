@@ -102,19 +102,11 @@ TEST_F(CheckpointRemoverEPTest, CheckpointManagerMemoryUsage) {
     // We should have one checkpoint which is for the state change
     ASSERT_EQ(1, checkpointManager->getNumCheckpoints());
 
-    // The queue (toWrite) is implemented as std:list, therefore
-    // when we add an item it results in the creation of 3 pointers -
-    // forward ptr, backward ptr and ptr to object.
-    const size_t perElementOverhead = 3 * sizeof(uintptr_t);
-
     // Allocator used for tracking memory used by the CheckpointQueue
     checkpoint_index::allocator_type memoryTrackingAllocator;
     // Emulate the Checkpoint metaKeyIndex so we can determine the number
     // of bytes that should be allocated during its use.
     checkpoint_index metaKeyIndex(memoryTrackingAllocator);
-    // Emulate the Checkpoint keyIndex so we can determine the number
-    // of bytes that should be allocated during its use.
-    checkpoint_index keyIndex(memoryTrackingAllocator);
     ChkptQueueIterator iterator =
             CheckpointManagerTestIntrospector::public_getCheckpointList(
                     *checkpointManager)
@@ -124,25 +116,23 @@ TEST_F(CheckpointRemoverEPTest, CheckpointManagerMemoryUsage) {
 
     // Check that the expected memory usage of the checkpoints is correct
     size_t expected_size = 0;
+    // The number of elements in the queue of the (single) checkpoint
+    size_t numElements = 0;
     for (auto& checkpoint :
          CheckpointManagerTestIntrospector::public_getCheckpointList(
                  *checkpointManager)) {
         // Add the overhead of the Checkpoint object
         expected_size += sizeof(Checkpoint);
-#ifdef WIN32
-        // On windows for an empty list we still allocate space for
-        // containing one element.
-        expected_size += perElementOverhead;
-#endif
 
         for (auto itr = checkpoint->begin(); itr != checkpoint->end(); ++itr) {
             // Add the size of the item
             expected_size += (*itr)->size();
-            // Add the size of adding to the queue
-            expected_size += perElementOverhead;
             // Add to the emulated metaKeyIndex
             metaKeyIndex.emplace((*itr)->getKey(), entry);
+            ++numElements;
         }
+        // Add the chunks of the queue (toWrite) holding the items
+        expected_size += CheckpointQueue::getMemoryUsageFor(numElements);
     }
 
     const auto metaKeyIndexSize =
@@ -156,16 +146,14 @@ TEST_F(CheckpointRemoverEPTest, CheckpointManagerMemoryUsage) {
     size_t new_expected_size = expected_size;
     // Add the size of the item
     new_expected_size += item.size();
-    // Add the size of adding to the queue
-    new_expected_size += perElementOverhead;
-    // Add to the keyIndex
-    keyIndex.emplace(item.getKey(), entry);
-
-    // As the metaKeyIndex and keyIndex share the same allocator, retrieving
-    // the bytes allocated for the keyIndex, will also include the bytes
-    // allocated for the metaKeyIndex.
-    size_t keyIndexSize = *(keyIndex.get_allocator().getBytesAllocated());
-    ASSERT_EQ(new_expected_size + keyIndexSize,
+    // Add the size of adding to the queue (which only allocates memory if
+    // it needs a new chunk)
+    new_expected_size += CheckpointQueue::getMemoryUsageFor(numElements + 1) -
+                         CheckpointQueue::getMemoryUsageFor(numElements);
+    // Add the keyIndex, which allocates its table for the first key
+    new_expected_size += CheckpointKeyIndex::getMemoryUsageFor(1);
+
+    ASSERT_EQ(new_expected_size + metaKeyIndexSize,
               checkpointManager->getMemoryUsage());
 }
 
@@ -242,20 +230,24 @@ TEST_F(CheckpointRemoverEPTest, CursorDropMemoryFreed) {
 
     createDcpStream(*producer);
 
-    // The queue (toWrite) is implemented as std:list, therefore
-    // when we add an item it results in the creation of 3 pointers -
-    // forward ptr, backward ptr and ptr to object.
-    const size_t perElementOverhead = 3 * sizeof(uintptr_t);
+    // The number of elements in the queue (toWrite) of the checkpoint, used
+    // to determine the memory allocated for the chunks of the queue.
+    const auto& checkpoint =
+            *CheckpointManagerTestIntrospector::public_getCheckpointList(
+                     *checkpointManager)
+                     .front();
+    const size_t initialElements =
+            std::distance(checkpoint.begin(), checkpoint.end());
 
     // Allocator used for tracking memory used by the CheckpointQueue
     checkpoint_index::allocator_type memoryTrackingAllocator;
-    // Emulate the Checkpoint keyIndex so we can determine the number
+    // Emulate the Checkpoint metaKeyIndex so we can determine the number
     // of bytes that should be allocated during its use.
-    checkpoint_index keyIndex(memoryTrackingAllocator);
-    // Grab the initial size of the keyIndex because on Windows an empty
+    checkpoint_index metaKeyIndex(memoryTrackingAllocator);
+    // Grab the initial size of the metaKeyIndex because on Windows an empty
     // std::unordered_map allocated 200 bytes.
-    const auto initialKeyIndexSize =
-            *(keyIndex.get_allocator().getBytesAllocated());
+    const auto initialMetaKeyIndexSize =
+            *(metaKeyIndex.get_allocator().getBytesAllocated());
     ChkptQueueIterator iterator =
             CheckpointManagerTestIntrospector::public_getCheckpointList(
                     *checkpointManager)
@@ -268,11 +260,10 @@ TEST_F(CheckpointRemoverEPTest, CursorDropMemoryFreed) {
         std::string doc_key = "key_" + std::to_string(i);
         Item item = store_item(vbid, makeStoredDocKey(doc_key), "value");
         expectedFreedMemoryFromItems += item.size();
-        // Add the size of adding to the queue
-        expectedFreedMemoryFromItems += perElementOverhead;
-        // Add to the emulated keyIndex
-        keyIndex.emplace(item.getKey(), entry);
     }
+    // Add the keyIndex holding the keys
+    expectedFreedMemoryFromItems +=
+            CheckpointKeyIndex::getMemoryUsageFor(getMaxCheckpointItems(*vb));
 
     ASSERT_EQ(1, checkpointManager->getNumCheckpoints());
     ASSERT_EQ(getMaxCheckpointItems(*vb) + 2, checkpointManager->getNumItems());
@@ -298,13 +289,18 @@ TEST_F(CheckpointRemoverEPTest, CursorDropMemoryFreed) {
 
     // Add the size of the checkpoint end
     expectedFreedMemoryFromItems += chkptEnd->size();
-    // Add the size of adding to the queue
-    expectedFreedMemoryFromItems += perElementOverhead;
-    // Add to the emulated keyIndex
-    keyIndex.emplace(key, entry);
+    // Add the size of adding the items and the checkpoint end to the queue
+    expectedFreedMemoryFromItems +=
+            CheckpointQueue::getMemoryUsageFor(
+                    initialElements + getMaxCheckpointItems(*vb) + 1) -
+            CheckpointQueue::getMemoryUsageFor(initialElements);
+    // Add to the emulated metaKeyIndex
+    metaKeyIndex.emplace(key, entry);
 
-    const auto keyIndexSize = *(keyIndex.get_allocator().getBytesAllocated());
-    expectedFreedMemoryFromItems += (keyIndexSize - initialKeyIndexSize);
+    const auto metaKeyIndexSize =
+            *(metaKeyIndex.get_allocator().getBytesAllocated());
+    expectedFreedMemoryFromItems +=
+            (metaKeyIndexSize - initialMetaKeyIndexSize);
 
     // Manually handle the slow stream, this is the same logic as the checkpoint
     // remover task uses, just without the overhead of setting up the task
@@ -377,4 +373,32 @@ TEST_F(CheckpointRemoverEPTest, cursorDroppingTriggerTest) {
             task->isReductionInCheckpointMemoryNeeded();
     EXPECT_TRUE(shouldTriggerCursorDropping);
     EXPECT_LT(0, amountOfMemoryToClear);
-}
\ No newline at end of file
+}
+
+/**
+ * With chk_remover_event_driven the closed unreferenced checkpoints are
+ * freed by the CheckpointRemovalTask as soon as the persistence cursor (the
+ * only cursor) leaves them, without waiting for the periodic remover.
+ */
+TEST_F(CheckpointRemoverEPTest, EventDrivenCheckpointRemoval) {
+    engine->getConfiguration().setChkRemoverEventDriven(true);
+    setVBucketStateAndRunPersistTask(vbid, vbucket_state_active);
+    auto vb = store->getVBuckets().getBucket(vbid);
+    auto* checkpointManager =
+            static_cast<MockCheckpointManager*>(vb->checkpointManager.get());
+
+    store_item(vbid, makeStoredDocKey("key"), "value");
+    checkpointManager->createNewCheckpoint();
+    ASSERT_EQ(2, checkpointManager->getNumCheckpoints());
+
+    // Flushing moves the persistence cursor out of the closed checkpoint,
+    // which should queue the vbucket for removal (but not free anything on
+    // the flusher)
+    flush_vbucket_to_disk(vbid, 1);
+    EXPECT_EQ(2, checkpointManager->getNumCheckpoints());
+
+    auto& lpNonioQ = *task_executor->getLpTaskQ()[NONIO_TASK_IDX];
+    runNextTask(lpNonioQ,
+                "Removing unreferenced checkpoints of notified vbuckets");
+    EXPECT_EQ(1, checkpointManager->getNumCheckpoints());
+}
@@ -1351,6 +1351,86 @@ TYPED_TEST(CheckpointTest, takeAndResetCursors) {
               manager2->getNumItemsForCursor(dcpCursor2.cursor.lock().get()));
 }
 
+// Test that getNumItemsForCursor notices the items queued after a cursor
+// read all of the items (when it may skip taking the queueLock).
+TYPED_TEST(CheckpointTest, NumItemsForCaughtUpCursor) {
+    auto dcpCursor = this->manager->registerCursorBySeqno("name", 0);
+    auto* cursor = dcpCursor.cursor.lock().get();
+    ASSERT_TRUE(this->queueNewItem("key0"));
+    EXPECT_EQ(1, this->manager->getNumItemsForCursor(cursor));
+
+    std::vector<queued_item> items;
+    this->manager->getAllItemsForCursor(cursor, items);
+    EXPECT_EQ(0, this->manager->getNumItemsForCursor(cursor));
+
+    // A new item and a de-duplicated one
+    ASSERT_TRUE(this->queueNewItem("key1"));
+    EXPECT_EQ(1, this->manager->getNumItemsForCursor(cursor));
+    items.clear();
+    this->manager->getAllItemsForCursor(cursor, items);
+    EXPECT_EQ(0, this->manager->getNumItemsForCursor(cursor));
+    this->queueNewItem("key0");
+    EXPECT_EQ(1, this->manager->getNumItemsForCursor(cursor));
+}
+
+// Test that cursors at the same position share one read of the items, and
+// read for themselves once they diverge.
+TYPED_TEST(CheckpointTest, SharedCursorReads) {
+    this->checkpoint_config = CheckpointConfig(DEFAULT_CHECKPOINT_PERIOD,
+                                               DEFAULT_CHECKPOINT_ITEMS,
+                                               DEFAULT_MAX_CHECKPOINTS,
+                                               /*itemBased*/ true,
+                                               /*keepClosed*/ false,
+                                               /*persistenceEnabled*/ true,
+                                               /*sharedCursorReads*/ true);
+    this->createManager();
+
+    auto* cursor1 = this->manager->registerCursorBySeqno("dcp1", 0)
+                            .cursor.lock()
+                            .get();
+    auto* cursor2 = this->manager->registerCursorBySeqno("dcp2", 0)
+                            .cursor.lock()
+                            .get();
+    auto* cursor3 = this->manager->registerCursorBySeqno("dcp3", 0)
+                            .cursor.lock()
+                            .get();
+    for (int ii = 0; ii < 10; ++ii) {
+        ASSERT_TRUE(this->queueNewItem("key" + std::to_string(ii)));
+    }
+
+    std::vector<queued_item> items1;
+    const auto range1 = this->manager->getAllItemsForCursor(cursor1, items1);
+    // checkpoint_start + the mutations
+    EXPECT_EQ(11, items1.size());
+
+    // The second cursor takes the same items, and is then caught up
+    std::vector<queued_item> items2;
+    const auto range2 = this->manager->getAllItemsForCursor(cursor2, items2);
+    ASSERT_EQ(items1.size(), items2.size());
+    for (size_t ii = 0; ii < items1.size(); ++ii) {
+        EXPECT_EQ(items1[ii].get(), items2[ii].get());
+    }
+    EXPECT_EQ(range1.getStart(), range2.getStart());
+    EXPECT_EQ(range1.getEnd(), range2.getEnd());
+    EXPECT_EQ(0, this->manager->getNumItemsForCursor(cursor2));
+    items2.clear();
+    this->manager->getAllItemsForCursor(cursor2, items2);
+    EXPECT_TRUE(items2.empty());
+
+    // The third cursor falls behind; after new items it reads from its own
+    // position
+    ASSERT_TRUE(this->queueNewItem("key10"));
+    std::vector<queued_item> items3;
+    this->manager->getAllItemsForCursor(cursor3, items3);
+    EXPECT_EQ(12, items3.size());
+    items1.clear();
+    this->manager->getAllItemsForCursor(cursor1, items1);
+    ASSERT_EQ(1, items1.size());
+    EXPECT_EQ(items3.back().get(), items1.front().get());
+    EXPECT_EQ(0, this->manager->getNumItemsForCursor(cursor1));
+    EXPECT_EQ(0, this->manager->getNumItemsForCursor(cursor3));
+}
+
 // Test that if we add 2 cursors with the same name the first one is removed.
 TYPED_TEST(CheckpointTest, DuplicateCheckpointCursor) {
     auto* ckptMgr = this->manager.get();
@@ -1464,22 +1544,6 @@ TYPED_TEST(CheckpointTest, checkpointMemoryTest) {
     // Get the intial size of the checkpoint.
     auto initialSize = this->manager->getMemoryUsage();
 
-    // Allocator used for tracking memory used by the CheckpointQueue
-    checkpoint_index::allocator_type memoryTrackingAllocator;
-    // Emulate the Checkpoint keyIndex so we can determine the number
-    // of bytes that should be allocated during its use.
-    checkpoint_index keyIndex(memoryTrackingAllocator);
-    // Grab the initial size of the keyIndex because on Windows an empty
-    // std::unordered_map allocated 200 bytes.
-    const auto initialKeyIndexSize =
-            *(keyIndex.get_allocator().getBytesAllocated());
-    ChkptQueueIterator iterator =
-            CheckpointManagerTestIntrospector::public_getCheckpointList(
-                    *(this->manager))
-                    .front()
-                    ->begin();
-    index_entry entry{iterator, 0};
-
     // Create a queued_item with a 'small' value
     std::string value("value");
     queued_item qiSmall(new Item(makeStoredDocKey("key"),
@@ -1499,23 +1563,17 @@ TYPED_TEST(CheckpointTest, checkpointMemoryTest) {
                               GenerateCas::Yes,
                               /*preLinkDocCtx*/ nullptr);
 
-    // The queue (toWrite) is implemented as std:list, therefore
-    // when we add an item it results in the creation of 3 pointers -
-    // forward ptr, backward ptr and ptr to object.
-    const size_t perElementOverhead = 3 * sizeof(uintptr_t);
+    // The queue (toWrite) allocates its memory in chunks, and the chunk
+    // holding the dummy item and checkpoint start has space for the item so
+    // adding it to the queue doesn't allocate any memory.
 
     // Check that checkpoint size is the initial size plus the addition of
     // qiSmall.
     auto expectedSize = initialSize;
     // Add the size of the item
     expectedSize += qiSmall->size();
-    // Add the size of adding to the queue
-    expectedSize += perElementOverhead;
-    // Add to the emulated keyIndex
-    keyIndex.emplace(qiSmall->getKey(), entry);
-
-    auto keyIndexSize = *(keyIndex.get_allocator().getBytesAllocated());
-    expectedSize += (keyIndexSize - initialKeyIndexSize);
+    // Add the keyIndex, which allocates its table for the first key
+    expectedSize += CheckpointKeyIndex::getMemoryUsageFor(1);
 
     EXPECT_EQ(expectedSize, this->manager->getMemoryUsage());
 
@@ -1543,13 +1601,8 @@ TYPED_TEST(CheckpointTest, checkpointMemoryTest) {
     expectedSize = initialSize;
     // Add the size of the item
     expectedSize += qiBig->size();
-    // Add the size of adding to the queue
-    expectedSize += perElementOverhead;
-    // Add to the keyIndex
-    keyIndex.emplace(qiBig->getKey(), entry);
-
-    keyIndexSize = *(keyIndex.get_allocator().getBytesAllocated());
-    expectedSize += (keyIndexSize - initialKeyIndexSize);
+    // The keyIndex still has the one key
+    expectedSize += CheckpointKeyIndex::getMemoryUsageFor(1);
 
     EXPECT_EQ(expectedSize, this->manager->getMemoryUsage());
 
@@ -1583,29 +1636,46 @@ TYPED_TEST(CheckpointTest, checkpointMemoryTest) {
     EXPECT_EQ(initialSize, this->manager->getMemoryUsage());
 }
 
+// Test that the keyIndex still finds every key (for de-duplication) after
+// its table has grown many times, and that its memory is accounted for.
+TYPED_TEST(CheckpointTest, KeyIndexManyKeys) {
+    this->checkpoint_config = CheckpointConfig(DEFAULT_CHECKPOINT_PERIOD,
+                                               MAX_CHECKPOINT_ITEMS,
+                                               /*numCheckpoints*/ 2,
+                                               /*itemBased*/ false,
+                                               /*keepClosed*/ false,
+                                               /*persistenceEnabled*/ true);
+    this->createManager();
+    const auto& checkpoint =
+            *CheckpointManagerTestIntrospector::public_getCheckpointList(
+                     *this->manager)
+                     .front();
+    const auto initialOverhead = this->manager->getMemoryOverhead();
+    const auto initialQueueMemory = checkpoint.getQueueMemoryUsage();
+
+    const int numKeys = 10000;
+    for (int ii = 0; ii < numKeys; ++ii) {
+        EXPECT_TRUE(this->queueNewItem("key" + std::to_string(ii)));
+    }
+    // All of them should be de-duplicated
+    for (int ii = 0; ii < numKeys; ++ii) {
+        EXPECT_FALSE(this->queueNewItem("key" + std::to_string(ii)));
+    }
+    EXPECT_EQ(1, this->manager->getNumCheckpoints());
+    EXPECT_EQ(numKeys, this->manager->getNumOpenChkItems());
+
+    // The overhead grew by the keyIndex and the chunks of the queue
+    EXPECT_EQ(CheckpointKeyIndex::getMemoryUsageFor(numKeys) +
+                      checkpoint.getQueueMemoryUsage() - initialQueueMemory,
+              this->manager->getMemoryOverhead() - initialOverhead);
+}
+
 // Test the tracking of memory overhead by adding a single element to the
 // CheckpointQueue.
 TYPED_TEST(CheckpointTest, checkpointTrackingMemoryOverheadTest) {
     // Get the intial size of the checkpoint overhead.
     const auto initialOverhead = this->manager->getMemoryOverhead();
 
-    // Allocator used for tracking memory used by the CheckpointQueue
-    checkpoint_index::allocator_type memoryTrackingAllocator;
-    // Emulate the Checkpoint keyIndex so we can determine the number
-    // of bytes that should be allocated during its use.
-    checkpoint_index keyIndex(memoryTrackingAllocator);
-    // Grab the initial size of the keyIndex because on Windows an empty
-    // std::unordered_map allocated 200 bytes.
-    const auto initialKeyIndexSize =
-            *(keyIndex.get_allocator().getBytesAllocated());
-
-    ChkptQueueIterator iterator =
-            CheckpointManagerTestIntrospector::public_getCheckpointList(
-                    *(this->manager))
-                    .front()
-                    ->begin();
-    index_entry entry{iterator, 0};
-
     // Create a queued_item
     std::string value("value");
     queued_item qiSmall(new Item(makeStoredDocKey("key"),
@@ -1627,13 +1697,10 @@ TYPED_TEST(CheckpointTest, checkpointTrackingMemoryOverheadTest) {
 
     // Re-measure the checkpoint overhead
     const auto updatedOverhead = this->manager->getMemoryOverhead();
-    // Three pointers - forward, backward and pointer to item
-    const auto perElementListOverhead = sizeof(uintptr_t) * 3;
-    // Add entry into keyIndex
-    keyIndex.emplace(qiSmall->getKey(), entry);
 
-    const auto keyIndexSize = *(keyIndex.get_allocator().getBytesAllocated());
-    EXPECT_EQ(perElementListOverhead + (keyIndexSize - initialKeyIndexSize),
+    // The item fits in the first chunk of the queue (toWrite) so only the
+    // keyIndex grows (it allocates its table for the first key)
+    EXPECT_EQ(CheckpointKeyIndex::getMemoryUsageFor(1),
               updatedOverhead - initialOverhead);
 
     bool isLastMutationItem;
@@ -2050,20 +2117,11 @@ TYPED_TEST(CheckpointTest, expelCheckpointItemsMemoryRecoveredTest) {
     // Get the memory usage after expelling
     auto checkpointMemoryUsageAfterExpel = this->manager->getMemoryUsage();
 
-    size_t extra = 0;
-    // A list is comprised of 3 pointers (forward, backwards and
-    // pointer to the element).
-    const size_t perElementOverhead = extra + (3 * sizeof(uintptr_t));
-#if WIN32
-    // On windows for an empty list we still allocate space for
-    // containing one element.
-    extra = perElementOverhead;
-#endif
-
     const size_t reductionInCheckpointMemoryUsage =
             checkpointMemoryUsageBeforeExpel - checkpointMemoryUsageAfterExpel;
-    const size_t checkpointListSaving =
-            (perElementOverhead * expelResult.expelCount);
+    // All of the items are in the first chunk of the queue, which is still
+    // used by the remaining items so no queue memory is freed.
+    const size_t checkpointListSaving = 0;
     const auto& checkpointStartItem =
             this->manager->public_createCheckpointItem(
                     0, Vbid(0), queue_op::checkpoint_start);
@@ -2073,8 +2131,7 @@ TYPED_TEST(CheckpointTest, expelCheckpointItemsMemoryRecoveredTest) {
             checkpointListSaving + queuedItemSaving;
 
     EXPECT_EQ(3, expelResult.expelCount);
-    EXPECT_EQ(expectedMemoryRecovered,
-              expelResult.estimateOfFreeMemory - extra);
+    EXPECT_EQ(expectedMemoryRecovered, expelResult.estimateOfFreeMemory);
     EXPECT_EQ(expectedMemoryRecovered, reductionInCheckpointMemoryUsage);
     EXPECT_EQ(3, this->global_stats.itemsExpelledFromCheckpoints);
 }
@@ -0,0 +1,181 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Unit tests for the ChunkedQueue
+ */
+
+#include "checkpoint_iterator.h"
+#include "chunked_queue.h"
+
+#include <folly/portability/GTest.h>
+#include <utilities/memory_tracking_allocator.h>
+
+#include <iterator>
+#include <memory>
+#include <vector>
+
+using TestItem = std::unique_ptr<int>;
+// Use a small chunk so the tests cover crossing between the chunks
+using TestQueue =
+        ChunkedQueue<TestItem, MemoryTrackingAllocator<TestItem>, 4>;
+using TestQueueIterator = CheckpointIterator<TestQueue>;
+
+class ChunkedQueueTest : public ::testing::Test {
+protected:
+    void push(int count) {
+        for (int ii = 0; ii < count; ++ii) {
+            queue.push_back(std::make_unique<int>(next++));
+        }
+    }
+
+    /// The non-null values in the queue, in order
+    std::vector<int> values(const TestQueue& q) {
+        std::vector<int> ret;
+        for (const auto& e : q) {
+            if (e) {
+                ret.push_back(*e);
+            }
+        }
+        return ret;
+    }
+
+    size_t bytesAllocated() {
+        return *queue.get_allocator().getBytesAllocated();
+    }
+
+    MemoryTrackingAllocator<TestItem> allocator;
+    TestQueue queue{allocator};
+    int next = 0;
+};
+
+TEST_F(ChunkedQueueTest, Empty) {
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(0, queue.size());
+    EXPECT_EQ(queue.begin(), queue.end());
+    EXPECT_EQ(0, bytesAllocated());
+}
+
+TEST_F(ChunkedQueueTest, PushBack) {
+    push(10);
+    EXPECT_EQ(10, queue.size());
+    EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}),
+              values(queue));
+
+    // 3 chunks of 4 elements, allocated through our allocator
+    EXPECT_EQ(TestQueue::getMemoryUsageFor(10), queue.getMemoryUsage());
+    EXPECT_EQ(TestQueue::getMemoryUsageFor(12), queue.getMemoryUsage());
+    EXPECT_LT(TestQueue::getMemoryUsageFor(8), queue.getMemoryUsage());
+    EXPECT_EQ(queue.getMemoryUsage(), bytesAllocated());
+
+    // Iterate backwards from the end
+    auto it = queue.end();
+    for (int ii = 9; ii >= 0; --ii) {
+        --it;
+        EXPECT_EQ(ii, **it);
+    }
+    EXPECT_EQ(queue.begin(), it);
+
+    queue.clear();
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(0, bytesAllocated());
+}
+
+// Iterators to the other elements must stay valid when erasing an element,
+// which is left behind as a null element skipped by the CheckpointIterator.
+TEST_F(ChunkedQueueTest, EraseMiddle) {
+    push(6);
+    auto pos3 = std::next(queue.begin(), 3);
+    auto pos5 = std::next(queue.begin(), 5);
+
+    queue.erase(std::next(queue.begin(), 4));
+    EXPECT_EQ(5, queue.size());
+    EXPECT_EQ(1, queue.getNumErased());
+    EXPECT_EQ(3, **pos3);
+    EXPECT_EQ(5, **pos5);
+
+    TestQueueIterator cursor(queue, TestQueueIterator::Position::begin);
+    std::vector<int> seen;
+    for (; cursor != TestQueueIterator(queue, TestQueueIterator::Position::end);
+         ++cursor) {
+        seen.push_back(**cursor);
+    }
+    EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 5}), seen);
+}
+
+// Erasing the last element gives the slot back to the next push_back.
+TEST_F(ChunkedQueueTest, EraseLast) {
+    push(5);
+    const auto memory = queue.getMemoryUsage();
+
+    queue.erase(std::prev(queue.end()));
+    EXPECT_EQ(4, queue.size());
+    EXPECT_EQ(0, queue.getNumErased());
+    // The now empty chunk is freed
+    EXPECT_GT(memory, queue.getMemoryUsage());
+
+    auto pos3 = std::prev(queue.end());
+    push(1);
+    EXPECT_EQ(5, **std::next(pos3));
+    EXPECT_EQ(memory, queue.getMemoryUsage());
+    EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 5}), values(queue));
+}
+
+TEST_F(ChunkedQueueTest, SplitFront) {
+    push(10);
+    queue.erase(std::next(queue.begin(), 1));
+    // The erased element is still in the queue
+    auto pos = std::next(queue.begin(), 6);
+    ASSERT_EQ(6, **pos);
+
+    auto front = queue.splitFront(pos);
+
+    // The first chunk is handed over, and the element before pos in its
+    // chunk moved.
+    EXPECT_EQ((std::vector<int>{0, 2, 3, 4, 5}), values(front));
+    EXPECT_EQ(5, front.size());
+    EXPECT_EQ(1, front.getNumErased());
+    EXPECT_EQ(2 * TestQueue::getMemoryUsageFor(1), front.getMemoryUsage());
+
+    EXPECT_EQ((std::vector<int>{6, 7, 8, 9}), values(queue));
+    EXPECT_EQ(4, queue.size());
+    EXPECT_EQ(0, queue.getNumErased());
+    EXPECT_EQ(pos, queue.begin());
+    EXPECT_EQ(2 * TestQueue::getMemoryUsageFor(1), queue.getMemoryUsage());
+
+    // Both queues share the allocator
+    EXPECT_EQ(queue.getMemoryUsage() + front.getMemoryUsage(),
+              bytesAllocated());
+    front.clear();
+    EXPECT_EQ(queue.getMemoryUsage(), bytesAllocated());
+
+    // The queue can still be added to and iterated
+    push(3);
+    EXPECT_EQ((std::vector<int>{6, 7, 8, 9, 10, 11, 12}), values(queue));
+}
+
+TEST_F(ChunkedQueueTest, MoveAssign) {
+    push(5);
+    TestQueue other;
+    other = std::move(queue);
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(queue.begin(), queue.end());
+    EXPECT_EQ(5, other.size());
+    EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4}), values(other));
+    // The allocator moves with the elements
+    EXPECT_EQ(other.getMemoryUsage(), bytesAllocated());
+}
@@ -0,0 +1,398 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "../mock/mock_chunked_seqlist.h"
+#include "chunked_seqlist.h"
+#include "hash_table.h"
+#include "item.h"
+#include "stats.h"
+#include "stored_value_factories.h"
+#include "tests/module_tests/test_helpers.h"
+
+#include <folly/portability/GTest.h>
+
+#include <vector>
+
+static EPStats global_stats;
+
+class ChunkedSeqListTest : public ::testing::Test {
+public:
+    ChunkedSeqListTest() : ht(global_stats, makeFactory(), 2, 1) {
+    }
+
+    static std::unique_ptr<AbstractStoredValueFactory> makeFactory() {
+        return std::make_unique<OrderedStoredValueFactory>(
+                global_stats, /*seqnoHook*/ false);
+    }
+
+protected:
+    void SetUp() override {
+        seqList = std::make_unique<MockChunkedSeqList>(global_stats);
+    }
+
+    void TearDown() override {
+        /* Like in a vbucket we want the list to be erased before HashTable is
+           is destroyed. */
+        seqList.reset();
+    }
+
+    /**
+     * Adds 'numItems' number of new items to the list, from startSeqno.
+     * Items to have key as keyPrefixXX, XX being the seqno.
+     *
+     * Returns the vector of seqnos added.
+     */
+    std::vector<seqno_t> addNewItemsToList(seqno_t startSeqno,
+                                           const std::string& keyPrefix,
+                                           const int numItems) {
+        const seqno_t last = startSeqno + numItems;
+        const std::string val("data");
+        std::vector<seqno_t> expectedSeqno;
+
+        /* Get a fake sequence lock */
+        std::mutex fakeSeqLock;
+        std::lock_guard<std::mutex> lg(fakeSeqLock);
+
+        for (seqno_t i = startSeqno; i < last; ++i) {
+            StoredDocKey key = makeStoredDocKey(keyPrefix + std::to_string(i));
+            Item item(key,
+                      0,
+                      0,
+                      val.data(),
+                      val.length(),
+                      PROTOCOL_BINARY_RAW_BYTES,
+                      /*theCas*/ 0,
+                      /*bySeqno*/ i);
+            EXPECT_EQ(MutationStatus::WasClean, ht.set(item));
+
+            auto* sv = ht.findForWrite(key).storedValue->toOrderedStoredValue();
+
+            std::lock_guard<std::mutex> listWriteLg(
+                    seqList->getListWriteLock());
+            seqList->appendToList(lg, listWriteLg, *sv);
+            seqList->updateHighSeqno(listWriteLg, *sv);
+            expectedSeqno.push_back(i);
+        }
+        return expectedSeqno;
+    }
+
+    void addStaleItem(const std::string& key, seqno_t seqno) {
+        addNewItemsToList(seqno, key, 1);
+
+        StoredDocKey sKey = makeStoredDocKey(key + std::to_string(seqno));
+        std::lock_guard<std::mutex> listWriteLg(seqList->getListWriteLock());
+        auto hbl = ht.getLockedBucket(sKey);
+        auto ownedSV = ht.unlocked_release(hbl, sKey);
+        seqList->markItemStale(listWriteLg, std::move(ownedSV), nullptr);
+    }
+
+    /**
+     * Updates an existing item with key == key and assigns it a seqno of
+     * highSeqno + 1. To be called when there is no range read.
+     */
+    void updateItem(seqno_t highSeqno, const std::string& key) {
+        /* Get a fake sequence lock */
+        std::mutex fakeSeqLock;
+        std::lock_guard<std::mutex> lg(fakeSeqLock);
+
+        auto* sv = ht.findForWrite(makeStoredDocKey(key)).storedValue;
+        ASSERT_TRUE(sv);
+        auto* osv = sv->toOrderedStoredValue();
+
+        std::lock_guard<std::mutex> listWriteLg(seqList->getListWriteLock());
+        EXPECT_EQ(SequenceList::UpdateStatus::Success,
+                  seqList->updateListElem(lg, listWriteLg, *osv));
+        osv->setBySeqno(highSeqno + 1);
+        seqList->updateHighSeqno(listWriteLg, *osv);
+    }
+
+    /**
+     * Creates an optional 'RangeIterator'. Expected to create the optional
+     * one always.
+     */
+    SequenceList::RangeIterator getRangeIterator() {
+        auto itrOptional = seqList->makeRangeIterator(true /*isBackfill*/);
+        EXPECT_TRUE(itrOptional);
+        return std::move(*itrOptional);
+    }
+
+    /// Read all the seqnos of the iterator
+    static std::vector<seqno_t> readAll(SequenceList::RangeIterator& itr) {
+        std::vector<seqno_t> actualSeqno;
+        while (itr.curr() != itr.end()) {
+            actualSeqno.push_back((*itr).getBySeqno());
+            ++itr;
+        }
+        return actualSeqno;
+    }
+
+    const int chunkSize = ChunkedSeqList::ChunkSize;
+
+    /* We need a HashTable because StoredValue is created only in the HashTable
+       and then put onto the sequence list */
+    HashTable ht;
+    std::unique_ptr<MockChunkedSeqList> seqList;
+};
+
+TEST_F(ChunkedSeqListTest, SetItems) {
+    const int numItems = 2 * chunkSize + 10;
+
+    std::vector<seqno_t> expectedSeqno =
+            addNewItemsToList(1, std::string("key"), numItems);
+
+    EXPECT_EQ(expectedSeqno, seqList->getAllSeqnoForVerification());
+    EXPECT_EQ(numItems, seqList->getNumItems());
+    EXPECT_EQ(3, seqList->getNumChunks());
+    EXPECT_EQ(numItems, seqList->getHighSeqno());
+}
+
+TEST_F(ChunkedSeqListTest, UpdateMovesToEnd) {
+    const int numItems = chunkSize + 10;
+    addNewItemsToList(1, std::string("key"), numItems);
+
+    /* Update items of the first and the last chunk */
+    updateItem(numItems, "key1");
+    updateItem(numItems + 1, "key" + std::to_string(numItems));
+
+    std::vector<seqno_t> expectedSeqno;
+    for (seqno_t i = 2; i < numItems; ++i) {
+        expectedSeqno.push_back(i);
+    }
+    expectedSeqno.push_back(numItems + 1);
+    expectedSeqno.push_back(numItems + 2);
+    EXPECT_EQ(expectedSeqno, seqList->getAllSeqnoForVerification());
+    EXPECT_EQ(numItems, seqList->getNumItems());
+}
+
+TEST_F(ChunkedSeqListTest, UpdateDuringRangeRead) {
+    const int numItems = 3;
+    addNewItemsToList(1, "key", numItems);
+
+    seqList->registerFakeReadRange(1, numItems);
+
+    std::mutex fakeSeqLock;
+    std::lock_guard<std::mutex> lg(fakeSeqLock);
+    auto* osv = ht.findForWrite(makeStoredDocKey("key2"))
+                        .storedValue->toOrderedStoredValue();
+    std::lock_guard<std::mutex> listWriteLg(seqList->getListWriteLock());
+    EXPECT_EQ(SequenceList::UpdateStatus::Append,
+              seqList->updateListElem(lg, listWriteLg, *osv));
+}
+
+TEST_F(ChunkedSeqListTest, RangeRead) {
+    const int numItems = 2 * chunkSize + 10;
+    addNewItemsToList(1, std::string("key"), numItems);
+
+    /* Read from the middle of a chunk into the next one */
+    const seqno_t start = chunkSize - 5, end = chunkSize + 5;
+    ENGINE_ERROR_CODE status = ENGINE_EINVAL;
+    std::vector<UniqueItemPtr> items;
+    seqno_t endSeqno;
+    std::tie(status, items, endSeqno) = seqList->rangeRead(start, end);
+    EXPECT_EQ(ENGINE_SUCCESS, status);
+    EXPECT_EQ(end, endSeqno);
+
+    std::vector<seqno_t> actualSeqno;
+    for (auto& item : items) {
+        actualSeqno.push_back(item->getBySeqno());
+    }
+    std::vector<seqno_t> expectedSeqno;
+    for (seqno_t i = start; i <= end; ++i) {
+        expectedSeqno.push_back(i);
+    }
+    EXPECT_EQ(expectedSeqno, actualSeqno);
+    EXPECT_EQ(0, seqList->getRangeReadBegin());
+
+    /* Beyond the highSeqno */
+    std::tie(status, items, endSeqno) =
+            seqList->rangeRead(numItems + 1, numItems + 10);
+    EXPECT_EQ(ENGINE_ERANGE, status);
+}
+
+TEST_F(ChunkedSeqListTest, RangeIterator) {
+    const int numItems = chunkSize + 10;
+    std::vector<seqno_t> expectedSeqno =
+            addNewItemsToList(1, std::string("key"), numItems);
+
+    auto itr = getRangeIterator();
+    EXPECT_EQ(numItems, itr.count());
+    EXPECT_EQ(expectedSeqno, readAll(itr));
+}
+
+TEST_F(ChunkedSeqListTest, RangeIteratorNoItems) {
+    auto itr = getRangeIterator();
+    EXPECT_EQ(itr.curr(), itr.end());
+}
+
+TEST_F(ChunkedSeqListTest, RangeIteratorSeek) {
+    const int numItems = 3 * chunkSize + 10;
+    addNewItemsToList(1, std::string("key"), numItems);
+
+    auto itr = getRangeIterator();
+
+    /* Jumps to the seqno itself */
+    const seqno_t start = 2 * chunkSize + 100;
+    itr.seek(start);
+    EXPECT_EQ(start, itr.curr());
+    EXPECT_EQ(numItems - start + 1, itr.count());
+
+    /* Never moves back */
+    itr.seek(chunkSize);
+    EXPECT_EQ(start, itr.curr());
+
+    /* Nor beyond the end */
+    itr.seek(numItems + 1);
+    EXPECT_EQ(start, itr.curr());
+
+    std::vector<seqno_t> expectedSeqno;
+    for (seqno_t i = start; i <= numItems; ++i) {
+        expectedSeqno.push_back(i);
+    }
+    EXPECT_EQ(expectedSeqno, readAll(itr));
+}
+
+/* An item updated (moved) during the iteration, beyond its range, isn't
+   read twice */
+TEST_F(ChunkedSeqListTest, RangeIteratorUpdateBeyondRange) {
+    addNewItemsToList(1, "key", 3);
+    auto itr = getRangeIterator();
+    addNewItemsToList(4, "key", 1);
+
+    /* key4 is beyond the range of the iterator */
+    updateItem(4, "key4");
+
+    std::vector<seqno_t> expectedSeqno = {1, 2, 3};
+    EXPECT_EQ(expectedSeqno, readAll(itr));
+}
+
+TEST_F(ChunkedSeqListTest, PurgeFreesChunks) {
+    /* A chunk of stale items followed by live ones */
+    for (seqno_t i = 1; i <= chunkSize; ++i) {
+        addStaleItem("stale", i);
+    }
+    addNewItemsToList(chunkSize + 1, "key", 10);
+    ASSERT_EQ(2, seqList->getNumChunks());
+    ASSERT_EQ(chunkSize, seqList->getNumStaleItems());
+
+    EXPECT_EQ(chunkSize, seqList->purgeTombstones(chunkSize + 9));
+    EXPECT_EQ(0, seqList->getNumStaleItems());
+    EXPECT_EQ(0, seqList->getStaleValueBytes());
+    EXPECT_EQ(0, seqList->getStaleMetadataBytes());
+    EXPECT_EQ(10, seqList->getNumItems());
+    EXPECT_EQ(1, seqList->getNumChunks());
+
+    /* Should be able to add elements to the list after the purger has run */
+    addNewItemsToList(chunkSize + 11, "key", 1);
+    EXPECT_EQ(11, seqList->getNumItems());
+}
+
+TEST_F(ChunkedSeqListTest, PurgeCompactsChunks) {
+    /* Two chunks with every odd seqno stale, and one more live item */
+    const int numItems = 2 * chunkSize;
+    std::vector<seqno_t> expectedSeqno;
+    for (seqno_t i = 1; i <= numItems; ++i) {
+        if (i % 2) {
+            addStaleItem("stale", i);
+        } else {
+            addNewItemsToList(i, "key", 1);
+            expectedSeqno.push_back(i);
+        }
+    }
+    addNewItemsToList(numItems + 1, "key", 1);
+    expectedSeqno.push_back(numItems + 1);
+    ASSERT_EQ(3, seqList->getNumChunks());
+
+    EXPECT_EQ(chunkSize, seqList->purgeTombstones(numItems));
+
+    /* The live items of the first two chunks fit in one */
+    EXPECT_EQ(expectedSeqno, seqList->getAllSeqnoForVerification());
+    EXPECT_EQ(2, seqList->getNumChunks());
+
+    /* The compacted list is still read (and seeked) by seqno */
+    auto itr = getRangeIterator();
+    itr.seek(numItems - 1);
+    EXPECT_EQ(numItems, itr.curr());
+    std::vector<seqno_t> tail = {numItems, numItems + 1};
+    EXPECT_EQ(tail, readAll(itr));
+}
+
+/* Purging runs alongside a range read: only the stale items the iterator has
+   passed are purged (and the chunk it is in isn't compacted), the rest once
+   the iterator is done */
+TEST_F(ChunkedSeqListTest, PurgeDuringRangeRead) {
+    addStaleItem("stale", 1);
+    addNewItemsToList(2, "key", 2);
+    addStaleItem("stale", 4);
+    addNewItemsToList(5, "key", 1);
+    ASSERT_EQ(2, seqList->getNumStaleItems());
+
+    {
+        auto itr = getRangeIterator();
+        ++itr;
+        ++itr;
+        ASSERT_EQ(3, itr.curr());
+
+        /* s:1 is behind the iterator, s:4 ahead of it */
+        EXPECT_EQ(1, seqList->purgeTombstones(4));
+        EXPECT_EQ(1, seqList->getNumStaleItems());
+
+        std::vector<seqno_t> expectedSeqno = {3, 4, 5};
+        EXPECT_EQ(expectedSeqno, readAll(itr));
+    }
+
+    /* Resumes from where it stopped */
+    EXPECT_EQ(1, seqList->purgeTombstones(4));
+    EXPECT_EQ(0, seqList->getNumStaleItems());
+    std::vector<seqno_t> expectedSeqno = {2, 3, 5};
+    EXPECT_EQ(expectedSeqno, seqList->getAllSeqnoForVerification());
+}
+
+TEST_F(ChunkedSeqListTest, PurgePauseResume) {
+    addNewItemsToList(1, "key", 2);
+    addStaleItem("stale", 3);
+    addNewItemsToList(4, "key", 2);
+    addStaleItem("stale", 6);
+
+    /* Pause after every element */
+    int purged = 0, numPaused = -1;
+    while (purged != 2) {
+        purged += seqList->purgeTombstones(6, {}, []() { return true; });
+        ++numPaused;
+    }
+    EXPECT_EQ(0, seqList->getNumStaleItems());
+    EXPECT_GE(numPaused, 1);
+
+    addNewItemsToList(7, "key", 1);
+    std::vector<seqno_t> expectedSeqno = {1, 2, 4, 5, 7};
+    EXPECT_EQ(expectedSeqno, seqList->getAllSeqnoForVerification());
+}
+
+/* The OSVs of a ChunkedSeqList have no SeqnoHook, they can't be linked in a
+   BasicLinkedList */
+TEST_F(ChunkedSeqListTest, NoSeqnoHook) {
+    addNewItemsToList(1, "key", 1);
+    auto* osv = ht.findForWrite(makeStoredDocKey("key1"))
+                        .storedValue->toOrderedStoredValue();
+    EXPECT_FALSE(osv->hasSeqnoHook());
+
+    BasicLinkedList linkedList(Vbid(0), global_stats);
+    std::mutex fakeSeqLock;
+    std::lock_guard<std::mutex> lg(fakeSeqLock);
+    std::lock_guard<std::mutex> listWriteLg(linkedList.getListWriteLock());
+    EXPECT_THROW(linkedList.appendToList(lg, listWriteLg, *osv),
+                 std::logic_error);
+}
@@ -1222,6 +1222,39 @@ TEST_F(CollectionsFilteredDcpTest, filtering) {
     testDcpCreateDelete({CollectionEntry::dairy}, {}, 2, false);
 }
 
+// The backfill of a stream of one collection starts the scan from the
+// collection's creation; check everything of the collection is still sent
+TEST_F(CollectionsFilteredDcpTest, filtering_backfill_from_collection_start) {
+    VBucketPtr vb = store->getVBucket(vbid);
+
+    // Items of the default collection before dairy exists
+    for (int ii = 0; ii < 3; ii++) {
+        store_item(vbid,
+                   StoredDocKey{"key" + std::to_string(ii),
+                                CollectionEntry::defaultC},
+                   "value");
+    }
+
+    CollectionsManifest cm;
+    store->setCollections({cm.add(CollectionEntry::dairy)});
+
+    store_item(vbid, StoredDocKey{"dairy:one", CollectionEntry::dairy}, "v");
+    store_item(vbid, StoredDocKey{"key3", CollectionEntry::defaultC}, "v");
+    store_item(vbid, StoredDocKey{"dairy:two", CollectionEntry::dairy}, "v");
+
+    flush_vbucket_to_disk(vbid, 7);
+    vb.reset();
+
+    resetEngineAndWarmup();
+
+    createDcpObjects({{R"({"collections":["c"]})"}});
+
+    // Streamed from disk
+    // 1x create - create of dairy
+    // 2x mutations in the dairy collection
+    testDcpCreateDelete({CollectionEntry::dairy}, {}, 2, false);
+}
+
 TEST_F(CollectionsFilteredDcpTest, filtering_scope) {
     VBucketPtr vb = store->getVBucket(vbid);
 
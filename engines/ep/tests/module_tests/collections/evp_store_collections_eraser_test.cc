@@ -488,6 +488,56 @@ TEST_P(CollectionsEraserTest, erase_after_warmup) {
     EXPECT_FALSE(vb->lockCollections().exists(CollectionEntry::dairy));
 }
 
+// Test that the drop of a collection holding fewer items than
+// collections_drop_compaction_threshold doesn't schedule a compaction, but
+// still removes its items from the item count straight away
+TEST_P(CollectionsEraserTest, drop_below_compaction_threshold) {
+    if (!persistent()) {
+        return;
+    }
+    engine->getConfiguration().setCollectionsDropCompactionThreshold(50);
+
+    CollectionsManifest cm(CollectionEntry::dairy);
+    vb->updateFromManifest({cm.add(CollectionEntry::fruit)});
+    flush_vbucket_to_disk(vbid, 2 /* 2 x system */);
+
+    store_item(
+            vbid, StoredDocKey{"dairy:milk", CollectionEntry::dairy}, "nice");
+    store_item(
+            vbid, StoredDocKey{"fruit:apple", CollectionEntry::fruit}, "nice");
+    store_item(vbid,
+               StoredDocKey{"fruit:apricot", CollectionEntry::fruit},
+               "lovely");
+    store_item(
+            vbid, StoredDocKey{"fruit:banana", CollectionEntry::fruit}, "ok");
+    flush_vbucket_to_disk(vbid, 4);
+    EXPECT_EQ(4, vb->getNumItems());
+
+    auto& lpWriterQ = *task_executor->getLpTaskQ()[WRITER_TASK_IDX];
+    const auto writerTasks = lpWriterQ.getFutureQueueSize();
+
+    vb->updateFromManifest({cm.remove(CollectionEntry::dairy)});
+    flush_vbucket_to_disk(vbid, 1 /* 1 x system */);
+
+    // 1 of 4 items is below the threshold - no compaction, but the items
+    // have gone from the count (and the hash table)
+    EXPECT_EQ(writerTasks, lpWriterQ.getFutureQueueSize());
+    EXPECT_EQ(3, vb->getNumItems());
+    EXPECT_FALSE(vb->getShard()
+                         ->getRWUnderlying()
+                         ->getDroppedCollections(vbid)
+                         .empty());
+
+    // The next compaction erases the collection without counting its items
+    // again
+    runCompaction();
+    EXPECT_EQ(3, vb->getNumItems());
+    EXPECT_TRUE(vb->getShard()
+                        ->getRWUnderlying()
+                        ->getDroppedCollections(vbid)
+                        .empty());
+}
+
 // Test cases which run for persistent and ephemeral buckets
 INSTANTIATE_TEST_CASE_P(CollectionsEraserTests,
                         CollectionsEraserTest,
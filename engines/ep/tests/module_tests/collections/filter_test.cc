@@ -575,6 +575,85 @@ TEST_F(CollectionsVBFilterTest, legacy_filter) {
 /**
  * Create a passthrough filter and check it allows anything
  */
+// A filter of one (non-default) collection reports it, so a backfill can
+// skip the seqnos before the collection was created
+TEST_F(CollectionsVBFilterTest, single_collection) {
+    cm.add(CollectionEntry::meat).add(CollectionEntry::fruit);
+    Collections::Manifest m(cm);
+    vbm.wlock().update(vb, m);
+
+    {
+        std::string jsonFilter = R"({"collections":["8"]})";
+        boost::optional<cb::const_char_buffer> json(jsonFilter);
+        Collections::VB::Filter vbf(json, vbm);
+        ASSERT_TRUE(vbf.getSingleCollection());
+        EXPECT_EQ(CollectionEntry::meat.getId(), *vbf.getSingleCollection());
+    }
+    {
+        std::string jsonFilter = R"({"collections":["8", "9"]})";
+        boost::optional<cb::const_char_buffer> json(jsonFilter);
+        Collections::VB::Filter vbf(json, vbm);
+        EXPECT_FALSE(vbf.getSingleCollection());
+    }
+    {
+        std::string jsonFilter = R"({"collections":["0"]})";
+        boost::optional<cb::const_char_buffer> json(jsonFilter);
+        Collections::VB::Filter vbf(json, vbm);
+        EXPECT_FALSE(vbf.getSingleCollection());
+    }
+    {
+        boost::optional<cb::const_char_buffer> json;
+        Collections::VB::Filter vbf(json, vbm);
+        EXPECT_FALSE(vbf.getSingleCollection());
+    }
+}
+
+// The high seqno of a filter is that of its collections, unless it may allow
+// items which aren't counted in those
+TEST_F(CollectionsVBFilterTest, high_seqno) {
+    cm.add(CollectionEntry::meat).add(CollectionEntry::fruit);
+    Collections::Manifest m(cm);
+    vbm.wlock().update(vb, m);
+    vbm.lock().setHighSeqno(CollectionEntry::meat.getId(), 100);
+    vbm.lock().setHighSeqno(CollectionEntry::fruit.getId(), 200);
+    {
+        std::string jsonFilter = R"({"collections":["8"]})";
+        boost::optional<cb::const_char_buffer> json(jsonFilter);
+        Collections::VB::Filter vbf(json, vbm);
+        ASSERT_TRUE(vbf.getHighSeqno(vbm));
+        EXPECT_EQ(100, *vbf.getHighSeqno(vbm));
+    }
+    {
+        std::string jsonFilter = R"({"collections":["8", "9"]})";
+        boost::optional<cb::const_char_buffer> json(jsonFilter);
+        Collections::VB::Filter vbf(json, vbm);
+        ASSERT_TRUE(vbf.getHighSeqno(vbm));
+        EXPECT_EQ(200, *vbf.getHighSeqno(vbm));
+    }
+    {
+        // A scope may gain collections
+        std::string jsonFilter = R"({"scope":"0"})";
+        boost::optional<cb::const_char_buffer> json(jsonFilter);
+        Collections::VB::Filter vbf(json, vbm);
+        EXPECT_FALSE(vbf.getHighSeqno(vbm));
+    }
+    {
+        boost::optional<cb::const_char_buffer> json;
+        Collections::VB::Filter vbf(json, vbm);
+        EXPECT_FALSE(vbf.getHighSeqno(vbm));
+    }
+    {
+        // The drop of a collection must still be found
+        std::string jsonFilter = R"({"collections":["8"]})";
+        boost::optional<cb::const_char_buffer> json(jsonFilter);
+        Collections::VB::Filter vbf(json, vbm);
+        cm.remove(CollectionEntry::meat);
+        Collections::Manifest dropped(cm);
+        vbm.wlock().update(vb, dropped);
+        EXPECT_FALSE(vbf.getHighSeqno(vbm));
+    }
+}
+
 TEST_F(CollectionsVBFilterTest, passthrough) {
     cm.add(CollectionEntry::meat);
     Collections::Manifest m(cm);
@@ -80,3 +80,31 @@ TEST(ManifestEntry, construct_assign) {
     EXPECT_EQ(101, entry1.getHighSeqno());
     EXPECT_EQ(99, entry1.getPersistedHighSeqno());
 }
+
+// The core local counters are folded together when read and copied
+TEST(ManifestEntry, counters) {
+    Collections::VB::ManifestEntry entry1(ScopeEntry::defaultS, {}, 2);
+    entry1.setDiskCount(10);
+    entry1.incrementDiskCount();
+    entry1.incrementDiskCount();
+    entry1.decrementDiskCount();
+    EXPECT_EQ(11, entry1.getDiskCount());
+
+    entry1.setHighSeqno(101);
+    entry1.setHighSeqno(99); // ignored, not monotonic
+    EXPECT_EQ(101, entry1.getHighSeqno());
+
+    Collections::VB::ManifestEntry entry2(entry1);
+    EXPECT_EQ(11, entry2.getDiskCount());
+    EXPECT_EQ(101, entry2.getHighSeqno());
+
+    // Reset can lower the high seqno, set replaces the count
+    entry2.resetHighSeqno(0);
+    EXPECT_EQ(0, entry2.getHighSeqno());
+    entry2.setDiskCount(3);
+    EXPECT_EQ(3, entry2.getDiskCount());
+
+    // entry1 is unchanged
+    EXPECT_EQ(11, entry1.getDiskCount());
+    EXPECT_EQ(101, entry1.getHighSeqno());
+}
@@ -0,0 +1,69 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Unit tests for the CompactionThrottle
+ */
+
+#include "compaction_throttle.h"
+#include "stats.h"
+
+#include <folly/portability/GTest.h>
+
+#include <chrono>
+
+class CompactionThrottleTest : public ::testing::Test {
+protected:
+    EPStats stats;
+    CompactionThrottle throttle{stats};
+};
+
+TEST_F(CompactionThrottleTest, UnlimitedByDefault) {
+    EXPECT_EQ(0, throttle.getCurrentRate());
+    const auto start = std::chrono::steady_clock::now();
+    throttle.consume(1024 * 1024 * 1024);
+    EXPECT_LT(std::chrono::steady_clock::now() - start,
+              std::chrono::milliseconds(100));
+}
+
+// The rate is lowered in proportion to how far the disk write queue is above
+// the cap, but no lower than a sixteenth of the maximum.
+TEST_F(CompactionThrottleTest, RateFollowsWriteQueue) {
+    throttle.setMaxRate(16000);
+    throttle.setWriteQueueCap(100);
+    EXPECT_EQ(16000, throttle.getCurrentRate());
+
+    stats.diskQueueSize = 100;
+    EXPECT_EQ(16000, throttle.getCurrentRate());
+    stats.diskQueueSize = 200;
+    EXPECT_EQ(8000, throttle.getCurrentRate());
+    stats.diskQueueSize = 100000;
+    EXPECT_EQ(1000, throttle.getCurrentRate());
+
+    throttle.setMaxRate(0);
+    EXPECT_EQ(0, throttle.getCurrentRate());
+}
+
+// Writing beyond the burst (the starting bucket is empty) blocks for as
+// long as the debt takes to pay off at the rate.
+TEST_F(CompactionThrottleTest, ConsumeBlocksWhenInDebt) {
+    throttle.setMaxRate(1000);
+    const auto start = std::chrono::steady_clock::now();
+    throttle.consume(100);
+    EXPECT_GE(std::chrono::steady_clock::now() - start,
+              std::chrono::milliseconds(90));
+}
@@ -0,0 +1,93 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Unit tests for the CompressedValueCache
+ */
+
+#include "dcp/compressed_value_cache.h"
+
+#include <folly/portability/GTest.h>
+#include <platform/compress.h>
+
+static value_t makeValue(const std::string& data) {
+    return value_t(Blob::New(data.data(), data.size()));
+}
+
+static std::string inflate(const value_t& value) {
+    cb::compression::Buffer inflated;
+    EXPECT_TRUE(cb::compression::inflate(cb::compression::Algorithm::Snappy,
+                                         {value->getData(), value->valueSize()},
+                                         inflated));
+    return {inflated.data(), inflated.size()};
+}
+
+TEST(CompressedValueCacheTest, CompressOnce) {
+    CompressedValueCache cache(1024 * 1024);
+    const std::string data(1000, 'a');
+    const auto value = makeValue(data);
+
+    value_t compressed1;
+    ASSERT_TRUE(cache.compress(value, compressed1));
+    EXPECT_LT(compressed1->valueSize(), data.size());
+    EXPECT_EQ(data, inflate(compressed1));
+    EXPECT_EQ(0, cache.getHits());
+    EXPECT_EQ(1, cache.getMisses());
+
+    // The second compression takes the same compressed value
+    value_t compressed2;
+    ASSERT_TRUE(cache.compress(value, compressed2));
+    EXPECT_EQ(compressed1.get().get(), compressed2.get().get());
+    EXPECT_EQ(1, cache.getHits());
+    EXPECT_EQ(1, cache.getMisses());
+}
+
+TEST(CompressedValueCacheTest, Incompressible) {
+    CompressedValueCache cache(1024 * 1024);
+    const auto value = makeValue("a");
+
+    // A value compression doesn't shrink is used as it is
+    value_t compressed;
+    ASSERT_TRUE(cache.compress(value, compressed));
+    EXPECT_EQ(value.get().get(), compressed.get().get());
+}
+
+TEST(CompressedValueCacheTest, Bounded) {
+    CompressedValueCache cache(0);
+    const auto value1 = makeValue(std::string(1000, 'a'));
+    const auto value2 = makeValue(std::string(1000, 'b'));
+
+    // Disabled - nothing is cached
+    value_t compressed;
+    ASSERT_TRUE(cache.compress(value1, compressed));
+    EXPECT_EQ(0, cache.getSize());
+    EXPECT_EQ(0, cache.getMisses());
+
+    // Room for one entry; the oldest is evicted
+    cache.setMaxSize(1500);
+    ASSERT_TRUE(cache.compress(value1, compressed));
+    const auto size = cache.getSize();
+    EXPECT_GT(size, 1000);
+    EXPECT_LE(size, 1500);
+    ASSERT_TRUE(cache.compress(value2, compressed));
+    ASSERT_TRUE(cache.compress(value1, compressed));
+    EXPECT_EQ(0, cache.getHits());
+    EXPECT_EQ(3, cache.getMisses());
+
+    cache.setMaxSize(0);
+    EXPECT_EQ(0, cache.getSize());
+}
@@ -265,6 +265,34 @@ TEST_P(DurabilityPassiveStreamTest, SeqnoAckAtSnapshotEndReceived) {
     EXPECT_EQ(swSeqno, seqnoAck->getPreparedSeqno());
 }
 
+/**
+ * A SeqnoAck which hasn't been sent yet is moved on to the newer seqno rather
+ * than another one being queued behind it.
+ */
+TEST_P(DurabilityPassiveStreamTest, SeqnoAckCoalescedWhileQueued) {
+    const auto& readyQ = stream->public_readyQ();
+    ASSERT_EQ(0, readyQ.size());
+
+    stream->seqnoAck(1);
+    stream->seqnoAck(2);
+    stream->seqnoAck(3);
+
+    ASSERT_EQ(1, readyQ.size());
+    ASSERT_EQ(DcpResponse::Event::SeqnoAcknowledgement,
+              readyQ.front()->getEvent());
+    EXPECT_EQ(3,
+              static_cast<const SeqnoAcknowledgement&>(*readyQ.front())
+                      .getPreparedSeqno());
+
+    // Once sent, the next ack is queued as a new message
+    ASSERT_TRUE(stream->public_popFromReadyQ());
+    stream->seqnoAck(4);
+    ASSERT_EQ(1, readyQ.size());
+    EXPECT_EQ(4,
+              static_cast<const SeqnoAcknowledgement&>(*readyQ.front())
+                      .getPreparedSeqno());
+}
+
 TEST_P(DurabilityPassiveStreamPersistentTest, SeqnoAckAtPersistedSeqno) {
     // The consumer receives mutations {s:1, s:2, s:3} in the snapshot:[1, 4],
     // with only s:2 durable with Level:PersistToMajority.
@@ -0,0 +1,145 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Unit tests for the DcpReadyQueue
+ */
+
+#include "dcp/ready-queue.h"
+
+#include <folly/portability/GTest.h>
+
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+
+class DcpReadyQueueTest : public ::testing::Test {
+protected:
+    static const size_t NumVbuckets = 8;
+    DcpReadyQueue queue{NumVbuckets};
+};
+
+const size_t DcpReadyQueueTest::NumVbuckets;
+
+TEST_F(DcpReadyQueueTest, PushUniqueRejectsDuplicates) {
+    EXPECT_TRUE(queue.empty());
+    EXPECT_FALSE(queue.exists(Vbid(1)));
+
+    // Only the push onto the empty queue returns true
+    EXPECT_TRUE(queue.pushUnique(Vbid(1)));
+    EXPECT_FALSE(queue.pushUnique(Vbid(1)));
+    EXPECT_FALSE(queue.pushUnique(Vbid(2)));
+    EXPECT_FALSE(queue.pushUnique(Vbid(2)));
+    EXPECT_TRUE(queue.exists(Vbid(1)));
+    EXPECT_TRUE(queue.exists(Vbid(2)));
+    EXPECT_FALSE(queue.exists(Vbid(3)));
+    EXPECT_EQ(2, queue.size());
+
+    Vbid vbid;
+    ASSERT_TRUE(queue.popFront(vbid));
+    EXPECT_EQ(Vbid(1), vbid);
+    EXPECT_FALSE(queue.exists(Vbid(1)));
+
+    // Once popped it may be pushed again
+    EXPECT_FALSE(queue.pushUnique(Vbid(1)));
+    queue.pop();
+    EXPECT_FALSE(queue.exists(Vbid(2)));
+    ASSERT_TRUE(queue.popFront(vbid));
+    EXPECT_EQ(Vbid(1), vbid);
+    EXPECT_FALSE(queue.popFront(vbid));
+    EXPECT_TRUE(queue.empty());
+}
+
+/*
+ * Front end threads notify the vbuckets while a DCP thread pops them. No
+ * vbucket may be in the queue more than once, and every notification must
+ * be seen by a pop which happens after it (or the vbucket would sit there
+ * with data nobody sends).
+ */
+TEST_F(DcpReadyQueueTest, ConcurrentPushAndPop) {
+    const size_t numThreads = 4;
+    const size_t iterations = 100000;
+
+    // The number of notifications of each vbucket, and how many of them the
+    // consumer had seen when it last popped the vbucket
+    std::vector<std::atomic<uint64_t>> notified(NumVbuckets);
+    std::vector<uint64_t> seen(NumVbuckets);
+    for (size_t vb = 0; vb < NumVbuckets; ++vb) {
+        notified[vb] = 0;
+        seen[vb] = 0;
+    }
+
+    std::atomic<bool> done{false};
+    // Set if the queue ever holds more entries than there are vbuckets
+    std::atomic<bool> tooLarge{false};
+    std::thread consumer([&]() {
+        for (;;) {
+            // Read done before we look at the queue so the final drain
+            // happens after all of the pushes
+            const bool last = done.load();
+            Vbid vbid;
+            while (queue.popFront(vbid)) {
+                seen[vbid.get()] = notified[vbid.get()].load();
+                if (queue.size() > NumVbuckets) {
+                    tooLarge = true;
+                }
+            }
+            if (last) {
+                return;
+            }
+            std::this_thread::yield();
+        }
+    });
+
+    std::vector<std::thread> producers;
+    for (size_t tt = 0; tt < numThreads; ++tt) {
+        producers.emplace_back([&, tt]() {
+            for (size_t ii = 0; ii < iterations; ++ii) {
+                const auto vb = (ii * (tt + 1)) % NumVbuckets;
+                notified[vb]++;
+                queue.pushUnique(Vbid(vb));
+            }
+        });
+    }
+    for (auto& t : producers) {
+        t.join();
+    }
+    done = true;
+    consumer.join();
+
+    EXPECT_FALSE(tooLarge);
+    EXPECT_TRUE(queue.empty());
+    for (size_t vb = 0; vb < NumVbuckets; ++vb) {
+        EXPECT_EQ(notified[vb].load(), seen[vb]) << "vb:" << vb;
+        EXPECT_FALSE(queue.exists(Vbid(vb)));
+    }
+
+    // And the flags are all consistent with the (now empty) queue
+    for (int pass = 0; pass < 3; ++pass) {
+        for (size_t vb = 0; vb < NumVbuckets; ++vb) {
+            queue.pushUnique(Vbid(vb));
+        }
+    }
+    EXPECT_EQ(NumVbuckets, queue.size());
+    std::set<Vbid> popped;
+    Vbid vbid;
+    while (queue.popFront(vbid)) {
+        EXPECT_TRUE(popped.insert(vbid).second) << vbid;
+    }
+    EXPECT_EQ(NumVbuckets, popped.size());
+}
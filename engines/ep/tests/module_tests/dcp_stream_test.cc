@@ -33,6 +33,7 @@
 #include "thread_gate.h"
 
 #include "../mock/mock_dcp.h"
+#include "../mock/mock_dcp_backfill_mgr.h"
 #include "../mock/mock_dcp_consumer.h"
 #include "../mock/mock_dcp_producer.h"
 #include "../mock/mock_stream.h"
@@ -248,6 +249,34 @@ TEST_P(StreamTest, test_verifyProducerStats) {
     destroy_dcp_stream();
 }
 
+/*
+ * Test that a producer configured to batch sends several messages per step
+ */
+TEST_P(StreamTest, test_producerStepBatch) {
+    engine->getConfiguration().setDcpProducerStepBatchItems(10);
+    VBucketPtr vb = engine->getKVBucket()->getVBucket(vbid);
+    setup_dcp_stream(0, IncludeValue::No, IncludeXattrs::No);
+    store_item(vbid, "key1", "value1");
+    store_item(vbid, "key2", "value2");
+    store_item(vbid, "key3", "value3");
+
+    MockDcpMessageProducers producers(engine);
+
+    EXPECT_EQ(ENGINE_SUCCESS, doStreamRequest(*producer).status);
+
+    prepareCheckpointItemsForStep(producers, *producer, *vb);
+
+    /* The snapshot marker and all the mutations are sent by one step */
+    EXPECT_EQ(ENGINE_SUCCESS, producer->step(&producers));
+    EXPECT_EQ(3, producer->getItemsSent());
+    EXPECT_EQ(cb::mcbp::ClientOpcode::DcpMutation, producers.last_op);
+    EXPECT_EQ(3, producers.last_byseqno);
+
+    EXPECT_EQ(ENGINE_EWOULDBLOCK, producer->step(&producers));
+
+    destroy_dcp_stream();
+}
+
 /*
  * Test that when have a producer with IncludeValue set to Yes and IncludeXattrs
  * set to No an active stream created via a streamRequest returns false for
@@ -736,6 +765,63 @@ TEST_P(StreamTest, BackfillOnly) {
     destroy_dcp_stream();
 }
 
+/* Streams of two connections backfilling the same vbucket share one scan */
+TEST_P(StreamTest, SharedDiskBackfill) {
+    if (bucketType == "ephemeral") {
+        /* Ephemeral buckets don't do disk backfill */
+        return;
+    }
+    engine->getConfiguration().setDcpSharedBackfill(true);
+
+    const size_t numItems = 3;
+    addItemsAndRemoveCheckpoint(numItems);
+    setup_dcp_stream();
+
+    auto producer2 = std::make_shared<MockDcpProducer>(
+            *engine, cookie, "test_producer2", /*flags*/ 0);
+    auto stream2 = std::make_shared<MockActiveStream>(engine,
+                                                      producer2,
+                                                      /*flags*/ 0,
+                                                      /*opaque*/ 0,
+                                                      *vb0,
+                                                      /*st_seqno*/ 0,
+                                                      /*en_seqno*/ ~0,
+                                                      /*vb_uuid*/ 0xabcd,
+                                                      /*snap_start_seqno*/ 0,
+                                                      /*snap_end_seqno*/ ~0);
+    stream2->setActive();
+
+    // Both backfills are scheduled before the backfill task runs, so the
+    // second stream joins the first's
+    stream->transitionStateToBackfilling();
+    stream2->transitionStateToBackfilling();
+    EXPECT_EQ(1, engine->getDcpConnMap().getNumActiveSnoozingBackfills());
+
+    ExecutorPool::get()->setNumAuxIO(1);
+
+    // Each stream gets a SnapshotMarker and all of the items
+    std::chrono::microseconds uSleepTime(128);
+    while (stream->public_readyQSize() < numItems + 1 ||
+           stream2->public_readyQSize() < numItems + 1) {
+        uSleepTime = decayingSleep(uSleepTime);
+    }
+    for (auto* s : {stream.get(), stream2.get()}) {
+        auto front = s->public_nextQueuedItem();
+        EXPECT_EQ(DcpResponse::Event::SnapshotMarker, front->getEvent());
+        for (size_t seqno = 1; seqno <= numItems; ++seqno) {
+            auto item = s->public_nextQueuedItem();
+            EXPECT_EQ(DcpResponse::Event::Mutation, item->getEvent());
+            EXPECT_EQ(seqno, *item->getBySeqno());
+        }
+        EXPECT_EQ(numItems, s->getNumBackfillItems());
+    }
+
+    stream2.reset();
+    producer2->cancelCheckpointCreatorTask();
+    producer2.reset();
+    destroy_dcp_stream();
+}
+
 /* Negative test case that checks whether the stream gracefully goes to
    'dead' state upon disk backfill failure */
 TEST_P(StreamTest, DiskBackfillFail) {
@@ -823,6 +909,52 @@ TEST_P(StreamTest, BackfillSmallBuffer) {
     destroy_dcp_stream();
 }
 
+/// A backfill which doesn't do anything (to check how backfills are queued)
+class NoopBackfill : public DCPBackfill {
+public:
+    NoopBackfill(std::shared_ptr<ActiveStream> s, BackfillPriority priority)
+        : DCPBackfill(s, 0, 0) {
+        setPriority(priority);
+    }
+
+    backfill_status_t run() override {
+        return backfill_finished;
+    }
+
+    void cancel() override {
+    }
+};
+
+/* The backfills are queued by their priority class, and in the order they
+   were scheduled within a class */
+TEST_P(StreamTest, BackfillPriorityOrder) {
+    setup_dcp_stream();
+
+    std::list<UniqueDCPBackfillPtr> queue;
+    std::vector<DCPBackfill*> expected(5);
+    auto schedule = [this, &queue](BackfillPriority priority) {
+        auto backfill = std::make_unique<NoopBackfill>(stream, priority);
+        auto* ret = backfill.get();
+        MockDcpBackfillManager::public_enqueue(queue, std::move(backfill));
+        return ret;
+    };
+    expected[3] = schedule(BackfillPriority::Normal);
+    expected[0] = schedule(BackfillPriority::Takeover);
+    expected[2] = schedule(BackfillPriority::Replication);
+    expected[4] = schedule(BackfillPriority::Normal);
+    expected[1] = schedule(BackfillPriority::Takeover);
+
+    ASSERT_EQ(expected.size(), queue.size());
+    auto it = queue.begin();
+    for (auto* backfill : expected) {
+        EXPECT_EQ(backfill, it->get());
+        ++it;
+    }
+
+    queue.clear();
+    destroy_dcp_stream();
+}
+
 /* Checks that DCP backfill in Ephemeral buckets does not have duplicates in
  a snaphsot */
 TEST_P(StreamTest, EphemeralBackfillSnapshotHasNoDuplicates) {
@@ -35,6 +35,7 @@
 #include "dcp/active_stream_checkpoint_processor_task.h"
 #include "dcp/dcp-types.h"
 #include "dcp/dcpconnmap.h"
+#include "dcp/flow-control-manager.h"
 #include "dcp/producer.h"
 #include "dcp/response.h"
 #include "dcp/stream.h"
@@ -1075,6 +1076,7 @@ TEST_P(ConnectionTest, test_producer_stream_end_on_client_close_stream) {
             static_cast<MockDcpConnMap&>(engine->getDcpConnMap());
     mockConnMap.addConn(cookie, producer);
     EXPECT_TRUE(mockConnMap.doesConnHandlerExist(vbid, "test_producer"));
+    EXPECT_TRUE(mockConnMap.isProducerNotified(vbid, "test_producer"));
 
     /* Close stream */
     EXPECT_EQ(ENGINE_SUCCESS, producer->closeStream(0, vbid));
@@ -1096,9 +1098,11 @@ TEST_P(ConnectionTest, test_producer_stream_end_on_client_close_stream) {
     // adding the connhandler into the connmap vbConns vector, causing the
     // stream to never get notified.
     EXPECT_TRUE(mockConnMap.doesConnHandlerExist(vbid, "test_producer"));
+    EXPECT_TRUE(mockConnMap.isProducerNotified(vbid, "test_producer"));
 
     mockConnMap.disconnect(cookie);
     EXPECT_FALSE(mockConnMap.doesConnHandlerExist(vbid, "test_producer"));
+    EXPECT_FALSE(mockConnMap.isProducerNotified(vbid, "test_producer"));
     mockConnMap.manageConnections();
 }
 
@@ -1668,6 +1672,77 @@ TEST_P(ConnectionTest, test_mb21784) {
     destroy_mock_cookie(cookie);
 }
 
+/*
+ * The buffered messages of a vbucket are only processed by one 'Processor'
+ * task at a time; a task finding it claimed leaves it to the owner, which
+ * re-queues it when done.
+ */
+TEST_P(ConnectionTest, ConsumerClaimVbucketForProcessing) {
+    const void* cookie = create_mock_cookie();
+    auto consumer =
+            std::make_shared<MockDcpConsumer>(*engine, cookie, "test_consumer");
+
+    EXPECT_TRUE(consumer->public_claimVbucket(vbid));
+    EXPECT_FALSE(consumer->public_claimVbucket(vbid));
+    // Other vbuckets can be processed meanwhile
+    EXPECT_TRUE(consumer->public_claimVbucket(Vbid(1)));
+    consumer->public_releaseVbucket(Vbid(1));
+    EXPECT_FALSE(consumer->isVbucketReady(Vbid(1)));
+
+    EXPECT_FALSE(consumer->isVbucketReady(vbid));
+    consumer->public_releaseVbucket(vbid);
+    EXPECT_TRUE(consumer->isVbucketReady(vbid));
+    EXPECT_TRUE(consumer->public_claimVbucket(vbid));
+    consumer->public_releaseVbucket(vbid);
+
+    destroy_mock_cookie(cookie);
+}
+
+/*
+ * The auto flow control policy starts connections at the min buffer size and
+ * only grows them while the aggr buffer memory is within its threshold.
+ */
+TEST_P(ConnectionTest, FlowControlManagerAutoTuneBufSize) {
+    const size_t MB = 1024 * 1024;
+    auto& stats = engine->getEpStats();
+    const size_t quota = stats.getMaxDataSize();
+    // dcp_conn_buffer_size_aggr_mem_threshold is 10% of this, 30MB
+    stats.setMaxDataSize(300 * MB);
+
+    DcpFlowControlManagerAuto manager(*engine);
+    EXPECT_TRUE(manager.isEnabled());
+    EXPECT_TRUE(manager.isAutoTuned());
+
+    const void* cookie1 = create_mock_cookie();
+    const void* cookie2 = create_mock_cookie();
+    auto consumer1 = std::make_shared<MockDcpConsumer>(
+            *engine, cookie1, "test_consumer1");
+    auto consumer2 = std::make_shared<MockDcpConsumer>(
+            *engine, cookie2, "test_consumer2");
+
+    EXPECT_EQ(10 * MB, manager.newConsumerConn(consumer1.get()));
+    // Grown only up to the aggr threshold
+    EXPECT_EQ(30 * MB, manager.tuneBufSize(consumer1.get(), 40 * MB));
+
+    // A new connection always gets the min, but can't grow over the threshold
+    EXPECT_EQ(10 * MB, manager.newConsumerConn(consumer2.get()));
+    EXPECT_EQ(10 * MB, manager.tuneBufSize(consumer2.get(), 40 * MB));
+    EXPECT_EQ(40 * MB, manager.getAggrBufferSize());
+
+    // Shrunk no lower than the min, which lets the other connection grow
+    EXPECT_EQ(10 * MB, manager.tuneBufSize(consumer1.get(), 1 * MB));
+    EXPECT_EQ(20 * MB, manager.tuneBufSize(consumer2.get(), 40 * MB));
+    EXPECT_EQ(30 * MB, manager.getAggrBufferSize());
+
+    manager.handleDisconnect(consumer1.get());
+    manager.handleDisconnect(consumer2.get());
+    EXPECT_EQ(0, manager.getAggrBufferSize());
+
+    destroy_mock_cookie(cookie1);
+    destroy_mock_cookie(cookie2);
+    stats.setMaxDataSize(quota);
+}
+
 class DcpConnMapTest : public ::testing::Test {
 protected:
     void SetUp() override {
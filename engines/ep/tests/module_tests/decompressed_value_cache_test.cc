@@ -0,0 +1,98 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+ * Unit tests for the DecompressedValueCache
+ */
+
+#include "decompressed_value_cache.h"
+
+#include <folly/portability/GTest.h>
+#include <platform/compress.h>
+
+static value_t makeCompressedValue(const std::string& data) {
+    cb::compression::Buffer deflated;
+    EXPECT_TRUE(cb::compression::deflate(cb::compression::Algorithm::Snappy,
+                                         {data.data(), data.size()},
+                                         deflated));
+    return value_t(Blob::New(deflated.data(), deflated.size()));
+}
+
+static std::string toString(const value_t& value) {
+    return {value->getData(), value->valueSize()};
+}
+
+TEST(DecompressedValueCacheTest, DecompressOnce) {
+    DecompressedValueCache cache(1024 * 1024);
+    const std::string data(1000, 'a');
+    const auto value = makeCompressedValue(data);
+
+    value_t inflated1;
+    ASSERT_TRUE(cache.decompress(value, inflated1));
+    EXPECT_EQ(data, toString(inflated1));
+    EXPECT_EQ(0, cache.getHits());
+    EXPECT_EQ(1, cache.getMisses());
+
+    // The second read takes the same inflated value
+    value_t inflated2;
+    ASSERT_TRUE(cache.decompress(value, inflated2));
+    EXPECT_EQ(inflated1.get().get(), inflated2.get().get());
+    EXPECT_EQ(1, cache.getHits());
+    EXPECT_EQ(1, cache.getMisses());
+}
+
+TEST(DecompressedValueCacheTest, Invalid) {
+    DecompressedValueCache cache(1024 * 1024);
+    const std::string garbage("not snappy");
+    const value_t value(Blob::New(garbage.data(), garbage.size()));
+
+    value_t inflated;
+    EXPECT_FALSE(cache.decompress(value, inflated));
+    EXPECT_EQ(0, cache.getSize());
+}
+
+TEST(DecompressedValueCacheTest, EvictLeastRecentlyUsed) {
+    DecompressedValueCache cache(0);
+    const auto value1 = makeCompressedValue(std::string(1000, 'a'));
+    const auto value2 = makeCompressedValue(std::string(1000, 'b'));
+    const auto value3 = makeCompressedValue(std::string(1000, 'c'));
+
+    // Disabled - nothing is cached
+    value_t inflated;
+    ASSERT_TRUE(cache.decompress(value1, inflated));
+    EXPECT_EQ(0, cache.getSize());
+    EXPECT_EQ(0, cache.getMisses());
+
+    // Room for two entries
+    cache.setMaxSize(2500);
+    ASSERT_TRUE(cache.decompress(value1, inflated));
+    ASSERT_TRUE(cache.decompress(value2, inflated));
+    EXPECT_EQ(2, cache.getMisses());
+
+    // Reading value1 again makes value2 the least recently used, which is
+    // evicted for value3
+    ASSERT_TRUE(cache.decompress(value1, inflated));
+    ASSERT_TRUE(cache.decompress(value3, inflated));
+    EXPECT_EQ(1, cache.getHits());
+    EXPECT_EQ(3, cache.getMisses());
+    ASSERT_TRUE(cache.decompress(value1, inflated));
+    EXPECT_EQ(2, cache.getHits());
+    ASSERT_TRUE(cache.decompress(value2, inflated));
+    EXPECT_EQ(4, cache.getMisses());
+
+    cache.setMaxSize(0);
+    EXPECT_EQ(0, cache.getSize());
+}
@@ -390,6 +390,54 @@ TEST_P(DefragmenterTest, DISABLED_MaxDefragValueSize) {
                       get_mock_server_api()->alloc_hooks));
 }
 
+static bool reportWellUsedSlab(const void*, allocator_utilization* util) {
+    *util = {/*nfree*/ 1, /*nregs*/ 8, /*bin_nfree*/ 8, /*bin_nregs*/ 16, false};
+    return true;
+}
+
+static bool reportSparselyUsedSlab(const void*, allocator_utilization* util) {
+    *util = {/*nfree*/ 7, /*nregs*/ 8, /*bin_nfree*/ 8, /*bin_nregs*/ 16, false};
+    return true;
+}
+
+// Check that only the StoredValues the allocator reports are on a sparsely used
+// slab are moved when the allocator is queried.
+TEST_P(DefragmenterTest, QueryUtilization) {
+    // Blobs are also referenced by the CheckpointManager, so aren't moved
+    if (!isModeStoredValue()) {
+        return;
+    }
+    const size_t num_docs = 100;
+    setDocs(64, num_docs);
+
+    ServerAllocatorIface hooks = *get_mock_server_api()->alloc_hooks;
+    auto visit = [this, &hooks](bool (*query)(const void*,
+                                              allocator_utilization*)) {
+        hooks.get_allocation_utilization = query;
+        auto defragVisitor = std::make_unique<DefragmentVisitor>(
+                DefragmenterTask::getMaxValueSize(&hooks));
+        defragVisitor->setDeadline(std::chrono::steady_clock::now() +
+                                   std::chrono::hours(5));
+        defragVisitor->setStoredValueAgeThreshold(0);
+        defragVisitor->setAllocatorHooks(&hooks);
+        PauseResumeVBAdapter prAdapter(std::move(defragVisitor));
+        prAdapter.visit(*vbucket);
+        auto& visitor =
+                dynamic_cast<DefragmentVisitor&>(prAdapter.getHTVisitor());
+        EXPECT_EQ(num_docs, visitor.getVisitedCount());
+        return std::make_pair(visitor.getStoredValueDefragCount(),
+                              visitor.getSkippedCount());
+    };
+
+    auto counts = visit(reportWellUsedSlab);
+    EXPECT_EQ(0, counts.first);
+    EXPECT_EQ(num_docs, counts.second);
+
+    counts = visit(reportSparselyUsedSlab);
+    EXPECT_EQ(num_docs, counts.first);
+    EXPECT_EQ(0, counts.second);
+}
+
 INSTANTIATE_TEST_CASE_P(
         FullAndValueEviction,
         DefragmenterTest,
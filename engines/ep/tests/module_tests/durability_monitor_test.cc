@@ -1064,6 +1064,39 @@ TEST_P(ActiveDurabilityMonitorTest, NeverExpireIfTimeoutNotSet) {
     EXPECT_EQ(1, monitor->getNumTracked());
 }
 
+/**
+ * processTimeout returns the earliest expiry-time of the SyncWrites left, for
+ * the DurabilityTimeoutTask to process the VBucket again then.
+ */
+TEST_P(ActiveDurabilityMonitorTest, ProcessTimeoutReturnsNextExpiry) {
+    auto& adm = getActiveDM();
+    ASSERT_NO_THROW(adm.setReplicationTopology(
+            nlohmann::json::array({{active, replica1}})));
+
+    using namespace cb::durability;
+    const auto start = std::chrono::steady_clock::now();
+    addSyncWrite(1 /*seqno*/, {Level::Majority, 1 /*timeout*/});
+    addSyncWrite(2 /*seqno*/, {Level::Majority, 60000 /*timeout*/});
+    addSyncWrite(3 /*seqno*/, {Level::Majority, Timeout::Infinity()});
+    ASSERT_EQ(3, monitor->getNumTracked());
+
+    auto earliest = adm.getEarliestExpiry();
+    ASSERT_TRUE(earliest);
+    EXPECT_LT(*earliest, start + std::chrono::seconds(1));
+
+    // s:1 expires, the next expiry is s:2's
+    auto next = adm.processTimeout(start + std::chrono::seconds(1));
+    EXPECT_EQ(2, monitor->getNumTracked());
+    ASSERT_TRUE(next);
+    EXPECT_GE(*next, start + std::chrono::seconds(60));
+    EXPECT_EQ(next, adm.getEarliestExpiry());
+
+    // s:2 expires, s:3 never does
+    next = adm.processTimeout(start + std::chrono::seconds(120));
+    EXPECT_EQ(1, monitor->getNumTracked());
+    EXPECT_FALSE(next);
+}
+
 TEST_P(ActiveDurabilityMonitorTest, ProcessTimeout) {
     auto& adm = getActiveDM();
     ASSERT_NO_THROW(adm.setReplicationTopology(
@@ -366,6 +366,30 @@ TEST_F(EphemeralVBucketTest, UpdateDuringBackfill) {
               mockEpheVB->public_getNumListItems());
 }
 
+/* Auto-deleting an item releases its value, unless a range read holds the
+   item in the sequence list (the deletion is then a copy of it) */
+TEST_F(EphemeralVBucketTest, PageOutGain) {
+    const int numItems = 3;
+
+    auto keys = generateKeys(numItems);
+    setMany(keys, MutationStatus::WasClean);
+
+    auto gain = [this](const StoredDocKey& key) {
+        auto res = vbucket->ht.findForWrite(key);
+        EXPECT_TRUE(res.storedValue);
+        return vbucket->getPageOutGain(res.lock, *res.storedValue);
+    };
+    for (const auto& key : keys) {
+        EXPECT_EQ(key.size(), gain(key));
+    }
+
+    /* Set up a mock backfill of the second item */
+    mockEpheVB->registerFakeReadRange(2, 2);
+    EXPECT_EQ(keys[0].size(), gain(keys[0]));
+    EXPECT_EQ(0, gain(keys[1]));
+    EXPECT_EQ(keys[2].size(), gain(keys[2]));
+}
+
 TEST_F(EphemeralVBucketTest, GetAndUpdateTtl) {
     const int numItems = 2;
 
@@ -653,8 +677,6 @@ TEST_F(EphTombstoneTest, ImmediatePurgeOfAliveStale) {
     // be added for that key.
     auto& seqList = mockEpheVB->getLL()->getSeqList();
     {
-        std::lock_guard<std::mutex> rrGuard(
-                mockEpheVB->getLL()->getRangeReadLock());
         mockEpheVB->registerFakeReadRange(1, 2);
         ASSERT_EQ(MutationStatus::WasClean, setOne(keys.at(1)));
 
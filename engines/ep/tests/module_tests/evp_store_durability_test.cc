@@ -488,6 +488,32 @@ TEST_P(DurabilityEPBucketTest, ActiveLocalNotifyPersistedSeqno) {
     }
 }
 
+// A prepare whose level requires persistence is pending (for the flusher to
+// flush its vBucket first) until it is persisted; a Majority prepare isn't
+TEST_P(DurabilityEPBucketTest, PendingDurablePrepare) {
+    setVBucketStateAndRunPersistTask(
+            vbid,
+            vbucket_state_active,
+            {{"topology", nlohmann::json::array({{"active", "replica"}})}});
+    const auto& vb = store->getVBucket(vbid);
+
+    auto item = makePendingItem(
+            makeStoredDocKey("majority"),
+            "value",
+            {cb::durability::Level::Majority, {}});
+    ASSERT_EQ(ENGINE_EWOULDBLOCK, store->set(*item, cookie));
+    EXPECT_FALSE(vb->hasPendingDurablePrepare());
+
+    item = makePendingItem(makeStoredDocKey("persist"),
+                           "value",
+                           {cb::durability::Level::PersistToMajority, {}});
+    ASSERT_EQ(ENGINE_EWOULDBLOCK, store->set(*item, cookie));
+    EXPECT_TRUE(vb->hasPendingDurablePrepare());
+
+    flushVBucketToDiskIfPersistent(vbid, 2);
+    EXPECT_FALSE(vb->hasPendingDurablePrepare());
+}
+
 TEST_P(DurabilityEPBucketTest, SetDurabilityImpossible) {
     setVBucketStateAndRunPersistTask(
             vbid,
@@ -484,6 +484,34 @@ TEST_P(RollbackTest, RollbackAfterMutationNoFlush) {
     rollback_after_mutation_test(/*flush_before_rollback*/false);
 }
 
+// Test that with rollback_fetch_values=false rollback only restores the
+// metadata of a reverted item, its value being fetched when next needed
+TEST_P(RollbackTest, RollbackAfterMutationMetaOnly) {
+    engine->getConfiguration().setRollbackFetchValues(false);
+
+    StoredDocKey a = makeStoredDocKey("a");
+    auto item_v1 = store_item(vbid, a, "old");
+    ASSERT_EQ(std::make_pair(false, size_t(1)),
+              getEPBucket().flushVBucket(vbid));
+    store_item(vbid, a, "new");
+    ASSERT_EQ(std::make_pair(false, size_t(1)),
+              getEPBucket().flushVBucket(vbid));
+
+    store->setVBucketState(vbid, vbStateAtRollback);
+    ASSERT_EQ(TaskStatus::Complete,
+              store->rollback(vbid, item_v1.getBySeqno()));
+    ASSERT_EQ(item_v1.getBySeqno(), store->getVBucket(vbid)->getHighSeqno());
+
+    // The value of 'old' is only on disk
+    EXPECT_EQ(ENGINE_EWOULDBLOCK,
+              store->get(a, vbid, nullptr, QUEUE_BG_FETCH).getStatus());
+    runBGFetcherTask();
+    auto result = store->get(a, vbid, nullptr, {});
+    ASSERT_EQ(ENGINE_SUCCESS, result.getStatus());
+    EXPECT_EQ(item_v1, *result.item)
+            << "Fetched item after rollback should match item_v1";
+}
+
 TEST_P(RollbackTest, RollbackAfterDeletion) {
     rollback_after_deletion_test(/*flush_before_rollback*/ true,
                                  /*expire_item*/ false);
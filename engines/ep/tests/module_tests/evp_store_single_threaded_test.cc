@@ -761,6 +761,55 @@ TEST_F(SingleThreadedEPBucketTest,
     producer->cancelCheckpointCreatorTask();
 }
 
+// With dcp_producer_processor_tasks > 1 the streams of different vbuckets are
+// processed by different ActiveStreamCheckpointProcessorTasks
+TEST_F(SingleThreadedEPBucketTest, MultipleCkptProcessorTasks) {
+    engine->getConfiguration().setDcpProducerProcessorTasks(2);
+    auto producer = createDcpProducer(cookie, IncludeDeleteTime::Yes);
+    producer->scheduleCheckpointProcessorTask();
+
+    auto& lpAuxioQ = *task_executor->getLpTaskQ()[AUXIO_TASK_IDX];
+    EXPECT_EQ(2, lpAuxioQ.getFutureQueueSize());
+
+    std::vector<std::shared_ptr<MockActiveStream>> streams;
+    for (size_t id = 0; id < 3; id++) {
+        Vbid vbid = Vbid(id);
+        setVBucketStateAndRunPersistTask(vbid, vbucket_state_active);
+        auto vb = store->getVBucket(vbid);
+        auto stream = producer->mockActiveStreamRequest(/*flags*/ 0,
+                                                        /*opaque*/ 0,
+                                                        *vb,
+                                                        /*st_seqno*/ 0,
+                                                        /*en_seqno*/ ~0,
+                                                        /*vb_uuid*/ 0xabcd,
+                                                        /*snap_start_seqno*/ 0,
+                                                        /*snap_end_seqno*/ ~0);
+        EXPECT_FALSE(stream->next());
+        EXPECT_TRUE(stream->isInMemory());
+
+        EXPECT_TRUE(queueNewItem(*vb, "key1"));
+        EXPECT_FALSE(stream->next());
+        streams.push_back(stream);
+    }
+
+    // vb:0 and vb:2 are queued on the first task, vb:1 on the second
+    EXPECT_EQ(2, producer->getCheckpointSnapshotTask(0).queueSize());
+    EXPECT_EQ(1, producer->getCheckpointSnapshotTask(1).queueSize());
+
+    producer->getCheckpointSnapshotTask(0).run();
+    producer->getCheckpointSnapshotTask(1).run();
+    for (auto& stream : streams) {
+        auto result = stream->next();
+        ASSERT_TRUE(result);
+        EXPECT_EQ(DcpResponse::Event::SnapshotMarker, result->getEvent());
+        result = stream->next();
+        ASSERT_TRUE(result);
+        EXPECT_EQ(DcpResponse::Event::Mutation, result->getEvent());
+    }
+
+    producer->cancelCheckpointCreatorTask();
+}
+
 // Test is demonstrating that if a checkpoint processor scheduled by a stream
 // that is subsequently closed/re-created, if that checkpoint processor runs
 // whilst the new stream is backfilling, it can't interfere with the new stream.
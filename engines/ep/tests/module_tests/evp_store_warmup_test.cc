@@ -213,6 +213,106 @@ TEST_F(WarmupTest, MB_27162) {
     EXPECT_EQ(3, itemMeta.revSeqno);
 }
 
+// Check that all the keys and values are loaded when each shard's vBuckets
+// are split over more tasks than there are vBuckets in the shard.
+TEST_F(WarmupTest, MultipleTasksPerShard) {
+    const int numVbs = 4;
+    const int numKeys = 10;
+    for (int vb = 0; vb < numVbs; ++vb) {
+        setVBucketStateAndRunPersistTask(Vbid(vb), vbucket_state_active);
+        for (int ii = 0; ii < numKeys; ++ii) {
+            store_item(Vbid(vb), makeStoredDocKey("key" + std::to_string(ii)),
+                       "value");
+        }
+        flush_vbucket_to_disk(Vbid(vb), numKeys);
+    }
+
+    resetEngineAndWarmup("warmup_tasks_per_shard=" +
+                         std::to_string(numVbs + 1));
+
+    for (int vb = 0; vb < numVbs; ++vb) {
+        auto vbucket = store->getVBucket(Vbid(vb));
+        ASSERT_TRUE(vbucket);
+        EXPECT_EQ(numKeys, vbucket->getNumItems());
+        for (int ii = 0; ii < numKeys; ++ii) {
+            auto gv = store->get(makeStoredDocKey("key" + std::to_string(ii)),
+                                 Vbid(vb),
+                                 cookie,
+                                 QUEUE_BG_FETCH);
+            EXPECT_EQ(ENGINE_SUCCESS, gv.getStatus());
+        }
+    }
+}
+
+// The HashTable image saved at a clean shutdown is loaded at warmup.
+TEST_F(WarmupTest, HashTableImage) {
+    engine->getConfiguration().setWarmupHashtableImage(true);
+    setVBucketStateAndRunPersistTask(vbid, vbucket_state_active);
+    const int numKeys = 10;
+    for (int ii = 0; ii < numKeys; ++ii) {
+        store_item(vbid, makeStoredDocKey("key" + std::to_string(ii)),
+                   "value");
+    }
+    flush_vbucket_to_disk(vbid, numKeys);
+
+    resetEngineAndWarmup("warmup_hashtable_image=true");
+
+    auto vb = store->getVBucket(vbid);
+    ASSERT_TRUE(vb);
+    EXPECT_EQ(numKeys, vb->getNumItems());
+    for (int ii = 0; ii < numKeys; ++ii) {
+        auto gv = store->get(makeStoredDocKey("key" + std::to_string(ii)),
+                             vbid,
+                             cookie,
+                             NONE);
+        ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+        EXPECT_EQ("value", gv.item->getValue()->to_s());
+    }
+}
+
+// With warmup_early_traffic data traffic is accepted once the metadata is
+// loaded; warmup carries on loading the items, except those of vBuckets
+// written to in the meantime.
+TEST_F(WarmupTest, EarlyTraffic) {
+    setVBucketStateAndRunPersistTask(vbid, vbucket_state_active);
+    store_item(vbid, makeStoredDocKey("key1"), "value");
+    store_item(vbid, makeStoredDocKey("key2"), "value");
+    flush_vbucket_to_disk(vbid, 2);
+
+    resetEngineAndEnableWarmup(
+            "item_eviction_policy=full_eviction;warmup_early_traffic=true");
+    auto& readerQueue = *task_executor->getLpTaskQ()[READER_TASK_IDX];
+    while (!store->isWarmupTrafficReady()) {
+        ASSERT_TRUE(store->isWarmingUp());
+        runNextTask(readerQueue);
+    }
+    EXPECT_TRUE(store->isWarmingUp());
+    EXPECT_FALSE(engine->isDegradedMode());
+
+    store_item(vbid, makeStoredDocKey("key1"), "new");
+    flush_vbucket_to_disk(vbid, 1);
+
+    while (store->isWarmingUp()) {
+        runNextTask(readerQueue);
+    }
+
+    // key2 wasn't loaded as the vBucket had changed, but is still readable
+    auto vb = store->getVBucket(vbid);
+    ASSERT_TRUE(vb);
+    EXPECT_FALSE(vb->ht.findForRead(makeStoredDocKey("key2")).storedValue);
+    auto gv = store->get(
+            makeStoredDocKey("key2"), vbid, cookie, QUEUE_BG_FETCH);
+    ASSERT_EQ(ENGINE_EWOULDBLOCK, gv.getStatus());
+    runBGFetcherTask();
+    gv = store->get(makeStoredDocKey("key2"), vbid, cookie, QUEUE_BG_FETCH);
+    ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    EXPECT_EQ("value", gv.item->getValue()->to_s());
+
+    gv = store->get(makeStoredDocKey("key1"), vbid, cookie, NONE);
+    ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    EXPECT_EQ("new", gv.item->getValue()->to_s());
+}
+
 TEST_F(WarmupTest, MB_25197) {
     setVBucketStateAndRunPersistTask(vbid, vbucket_state_active);
 
@@ -64,6 +64,52 @@ TEST_P(EPVBucketTest, GetBGFetchItemsPerformance) {
     auto items = this->vbucket->getBGFetchItems();
 }
 
+// Fetches queued while a read of the key is in flight are served from that
+// read if it gives them what they need, otherwise they wait for the next one.
+TEST_P(EPVBucketTest, BGFetchAttachesToInFlightFetch) {
+    auto mockEPBucket =
+            engine->public_makeMockBucket(engine->getConfiguration());
+    KVShard kvShard(0, engine->getConfiguration());
+    BgFetcher bgFetcher(*mockEPBucket.get(), kvShard);
+
+    auto queueFetch = [this, &bgFetcher](const StoredDocKey& key,
+                                         bool isMeta) {
+        return this->public_queueBGFetchItem(
+                key,
+                std::make_unique<VBucketBGFetchItem>(nullptr, isMeta),
+                &bgFetcher);
+    };
+
+    const auto value = makeStoredDocKey("value");
+    const auto meta = makeStoredDocKey("meta");
+    queueFetch(value, false);
+    queueFetch(meta, true);
+    auto items = this->vbucket->getBGFetchItems();
+    ASSERT_EQ(2, items.size());
+
+    // Both can use the in flight value fetch; only the meta fetch can use
+    // the in flight meta fetch
+    EXPECT_EQ(0, queueFetch(value, true));
+    EXPECT_EQ(0, queueFetch(value, false));
+    EXPECT_EQ(0, queueFetch(meta, true));
+    EXPECT_FALSE(this->vbucket->hasPendingBGFetchItems());
+    EXPECT_EQ(1, queueFetch(meta, false));
+
+    this->vbucket->takeAttachedBGFetchItems(items);
+    auto& valueCtx = items.at(DiskDocKey{value});
+    EXPECT_EQ(3, valueCtx.bgfetched_list.size());
+    for (const auto& fetch : valueCtx.bgfetched_list) {
+        EXPECT_EQ(&valueCtx.value, fetch->value);
+    }
+    EXPECT_EQ(2, items.at(DiskDocKey{meta}).bgfetched_list.size());
+
+    // The reads are no longer in flight
+    EXPECT_EQ(2, queueFetch(value, true));
+    auto next = this->vbucket->getBGFetchItems();
+    EXPECT_EQ(2, next.size());
+    EXPECT_EQ(1, next.at(DiskDocKey{meta}).bgfetched_list.size());
+}
+
 // Test statistics after softDelete.
 // Persistent VBucket only as Ephemeral cannot totally clear the VBucket; it
 // must keep at least the last deleted seqno for correct tombstone handling
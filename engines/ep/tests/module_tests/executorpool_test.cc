@@ -21,6 +21,7 @@
 
 #include "executorpool_test.h"
 #include "lambda_task.h"
+#include "tasks.h"
 
 MockTaskable::MockTaskable() : policy(HIGH_BUCKET_PRIORITY, 1) {
 }
@@ -275,3 +276,131 @@ TEST_F(SingleThreadedExecutorPoolTest, ignore_duplicate_schedule) {
 
     pool->cancel(taskId, true);
 }
+
+/* Check fetchNextTask() finds a task as soon as it can be run, and records
+ * when the next one can be run otherwise (without locking the queue).
+ */
+TEST_F(SingleThreadedExecutorPoolTest, fetch_next_task) {
+    ExTask task = std::make_shared<LambdaTask>(
+            taskable, TaskId::ItemPager, 10, true, [&] { return false; });
+    size_t taskId = pool->schedule(task);
+
+    std::map<size_t, TaskQpair> taskLocator =
+            dynamic_cast<SingleThreadedExecutorPool*>(ExecutorPool::get())
+                    ->getTaskLocator();
+    TaskQueue* queue = taskLocator.find(taskId)->second.second;
+
+    ExecutorThread thread(pool, queue->getQueueType(), "fetch_test");
+    thread.updateCurrentTime();
+    EXPECT_FALSE(queue->fetchNextTask(thread));
+    EXPECT_EQ(task->getWaketime(), thread.getWaketime())
+            << "Thread should wake when the task can be run";
+    EXPECT_EQ(1, queue->getFutureQueueSize());
+
+    // Snoozing the task must be seen too
+    pool->snooze(taskId, 20);
+    thread.setWaketime(std::chrono::steady_clock::time_point::max());
+    EXPECT_FALSE(queue->fetchNextTask(thread));
+    EXPECT_EQ(task->getWaketime(), thread.getWaketime());
+
+    pool->wake(taskId);
+    thread.updateCurrentTime();
+    EXPECT_TRUE(queue->fetchNextTask(thread));
+    EXPECT_EQ("Lambda Task", thread.getTaskName());
+    EXPECT_EQ(0, queue->getFutureQueueSize());
+    EXPECT_EQ(0, queue->getReadyQueueSize());
+
+    // Nothing left to run
+    thread.resetCurrentTask();
+    EXPECT_FALSE(queue->fetchNextTask(thread));
+
+    pool->cancel(taskId, true);
+}
+
+/* Check a taskable which has run more than its share of the threads' time,
+ * relative to the others running tasks, has its tasks delayed while the
+ * others have tasks waiting to run.
+ */
+TEST_F(SingleThreadedExecutorPoolTest, fair_share) {
+    using namespace std::chrono;
+    const auto zero = steady_clock::duration::zero();
+    MockTaskable other;
+    pool->registerTaskable(other);
+
+    // Nothing is delayed unless the taskables have shares
+    EXPECT_EQ(zero, pool->accountRuntime(other, milliseconds(1)));
+    EXPECT_EQ(zero, pool->accountRuntime(taskable, seconds(1)));
+    taskable.getWorkLoadPolicy().setCpuShares(WorkLoadPolicy::DefaultCpuShares);
+    other.getWorkLoadPolicy().setCpuShares(WorkLoadPolicy::DefaultCpuShares);
+
+    // Nothing else is running
+    EXPECT_EQ(zero, pool->accountRuntime(taskable, milliseconds(1)));
+    // other starts level with taskable
+    EXPECT_EQ(zero, pool->accountRuntime(other, milliseconds(1)));
+
+    // Not delayed while other has nothing to run, and the time used then
+    // isn't held against taskable later
+    EXPECT_EQ(zero, pool->accountRuntime(taskable, milliseconds(50)));
+    other.getWorkLoadPolicy().addReadyTask();
+    EXPECT_EQ(zero, pool->accountRuntime(taskable, zero));
+
+    // taskable is now 60ms ahead of other, so delayed by 50ms (the first
+    // 10ms are allowed)
+    EXPECT_EQ(milliseconds(60) - ExecutorPool::FairShareSlice,
+              pool->accountRuntime(taskable, milliseconds(50)));
+
+    // With 10 times the shares other's 100ms only count as 10ms
+    other.getWorkLoadPolicy().setCpuShares(
+            WorkLoadPolicy::DefaultCpuShares * 10);
+    EXPECT_EQ(zero, pool->accountRuntime(other, milliseconds(100)));
+    EXPECT_EQ(milliseconds(50) - ExecutorPool::FairShareSlice,
+              pool->accountRuntime(taskable, zero));
+
+    // The delay is capped
+    EXPECT_EQ(ExecutorPool::MaxFairShareDelay,
+              pool->accountRuntime(taskable, seconds(10)));
+
+    // ... and the lead is bounded
+    other.getWorkLoadPolicy().removeReadyTask();
+    EXPECT_EQ(zero, pool->accountRuntime(taskable, zero));
+    other.getWorkLoadPolicy().addReadyTask();
+    EXPECT_EQ(zero, pool->accountRuntime(taskable, zero));
+
+    other.getWorkLoadPolicy().removeReadyTask();
+    pool->unregisterTaskable(other, false);
+}
+
+/*
+ * Check the IOThreadTuner controller grows the threads while the latency of
+ * the IOs stays flat, and shrinks them once it climbs (the device is
+ * saturated) or there's nothing to do.
+ */
+TEST(IOThreadTunerTest, Controller) {
+    IOThreadTuner::Controller controller;
+    uint64_t ops = 0;
+    double latency = 0;
+
+    // Queued work with no IO completed yet
+    EXPECT_EQ(1, controller.update(10, ops, latency));
+
+    // A steady 1ms per IO
+    for (int ii = 0; ii < 5; ++ii) {
+        ops += 100;
+        latency += 100;
+        EXPECT_EQ(1, controller.update(10, ops, latency));
+    }
+
+    // The latency triples
+    ops += 100;
+    latency += 300;
+    EXPECT_EQ(-1, controller.update(10, ops, latency));
+
+    // The histograms are reset
+    EXPECT_EQ(1, controller.update(10, 100, 100));
+
+    // Idle; only shrink after a while
+    for (int ii = 1; ii < IOThreadTuner::IdleIntervalsBeforeShrink; ++ii) {
+        EXPECT_EQ(0, controller.update(0, 100, 100));
+    }
+    EXPECT_EQ(-1, controller.update(0, 100, 100));
+}
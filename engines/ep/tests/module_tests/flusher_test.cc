@@ -0,0 +1,133 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Unit tests for the FlushBatchSizer and the flush order of the vBuckets
+ */
+
+#include "flusher.h"
+
+#include <folly/portability/GTest.h>
+
+using namespace std::chrono_literals;
+
+class FlushBatchSizerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        sizer.setTargetCommitTime(100ms);
+    }
+
+    const size_t limit = 1000000;
+    FlushBatchSizer sizer;
+};
+
+TEST_F(FlushBatchSizerTest, DisabledUsesTheLimit) {
+    FlushBatchSizer disabled;
+    EXPECT_EQ(limit, disabled.getBatchSize(limit));
+    disabled.commitCompleted(1000, 1s, true);
+    EXPECT_EQ(limit, disabled.getBatchSize(limit));
+}
+
+TEST_F(FlushBatchSizerTest, NoCommitYetUsesTheLimit) {
+    EXPECT_EQ(limit, sizer.getBatchSize(limit));
+}
+
+// A slow commit shrinks the batch to what we'd commit in the target time
+TEST_F(FlushBatchSizerTest, ShrinksAfterSlowCommit) {
+    // 10ms per item, so 10 items in 100ms (but not below the minimum)
+    sizer.commitCompleted(100000, 1000s, true);
+    EXPECT_EQ(FlushBatchSizer::MinBatchSize, sizer.getBatchSize(limit));
+
+    // 0.1ms per item; 1000 items in 100ms
+    FlushBatchSizer other;
+    other.setTargetCommitTime(100ms);
+    other.commitCompleted(10000, 1s, true);
+    EXPECT_EQ(1000, other.getBatchSize(limit));
+    // And never above the limit
+    EXPECT_EQ(500, other.getBatchSize(500));
+}
+
+// A fast commit grows the batch, but at most by doubling it and only if the
+// batch was full
+TEST_F(FlushBatchSizerTest, GrowsAfterFastFullCommit) {
+    sizer.commitCompleted(1000, 1ms, false);
+    EXPECT_EQ(1000, sizer.getBatchSize(limit));
+
+    sizer.commitCompleted(1000, 1ms, true);
+    EXPECT_EQ(2000, sizer.getBatchSize(limit));
+    sizer.commitCompleted(2000, 2ms, true);
+    EXPECT_EQ(4000, sizer.getBatchSize(limit));
+
+    // A smaller batch which wasn't full doesn't shrink it
+    sizer.commitCompleted(10, 10us, false);
+    EXPECT_EQ(4000, sizer.getBatchSize(limit));
+}
+
+TEST_F(FlushBatchSizerTest, DisablingResets) {
+    sizer.commitCompleted(10000, 1s, true);
+    ASSERT_EQ(1000, sizer.getBatchSize(limit));
+
+    sizer.setTargetCommitTime(0ms);
+    EXPECT_EQ(limit, sizer.getBatchSize(limit));
+    sizer.commitCompleted(10000, 1s, true);
+    EXPECT_EQ(limit, sizer.getBatchSize(limit));
+}
+
+class FlushOrderTest : public ::testing::Test {
+protected:
+    std::vector<Vbid> sort() {
+        Flusher::sortInFlushOrder(order);
+        std::vector<Vbid> ret;
+        for (const auto& entry : order) {
+            ret.push_back(entry.vbid);
+        }
+        return ret;
+    }
+
+    std::vector<VBucketFlushOrder> order;
+};
+
+// The vBucket whose items have been waiting the longest goes first, even if
+// its backlog is smaller
+TEST_F(FlushOrderTest, OldestItemsFirst) {
+    order = {{Vbid(0), vbucket_state_active, 1, 10000},
+             {Vbid(1), vbucket_state_active, 30, 10},
+             {Vbid(2), vbucket_state_active, 20, 100}};
+    EXPECT_EQ(std::vector<Vbid>({Vbid(1), Vbid(2), Vbid(0)}), sort());
+}
+
+// The active vBuckets are still flushed before the others, however old the
+// items of the others are
+TEST_F(FlushOrderTest, ActiveFirst) {
+    order = {{Vbid(0), vbucket_state_replica, 100, 10},
+             {Vbid(1), vbucket_state_pending, 200, 10},
+             {Vbid(2), vbucket_state_active, 1, 10},
+             {Vbid(3), vbucket_state_replica, 300, 10}};
+    EXPECT_EQ(std::vector<Vbid>({Vbid(2), Vbid(3), Vbid(0), Vbid(1)}),
+              sort());
+}
+
+// The smaller backlog goes first when the ages are the same, and the order
+// is kept for vBuckets which are equal (e.g. the idle ones)
+TEST_F(FlushOrderTest, SmallerBacklogBreaksTies) {
+    order = {{Vbid(0), vbucket_state_active, 0, 0},
+             {Vbid(1), vbucket_state_active, 5, 1000},
+             {Vbid(2), vbucket_state_active, 5, 10},
+             {Vbid(3), vbucket_state_active, 0, 0}};
+    EXPECT_EQ(std::vector<Vbid>({Vbid(2), Vbid(1), Vbid(0), Vbid(3)}),
+              sort());
+}
@@ -21,6 +21,8 @@
 #include "tests/module_tests/executorpool_test.h"
 #include "tests/module_tests/test_task.h"
 
+#include <random>
+
 class FutureQueueTest : public ::testing::TestWithParam<std::string> {
 public:
     FutureQueue<> queue;
@@ -155,6 +157,39 @@ TEST_F(FutureQueueTest, snooze) {
     EXPECT_EQ(top, static_cast<TestTask*>(lastTask.get())->order);
 }
 
+/*
+ * Move random tasks earlier and later and check the queue stays ordered.
+ */
+TEST_F(FutureQueueTest, updateRandomTasks) {
+    const int n = 100;
+    std::vector<ExTask> tasks;
+    for (int i = 0; i < n; i++) {
+        tasks.push_back(std::make_shared<TestTask>(
+                taskable, TaskId::PendingOpsNotification, i));
+        tasks.back()->updateWaketime(
+                std::chrono::steady_clock::time_point(std::chrono::seconds(i)));
+        queue.push(tasks.back());
+    }
+
+    std::minstd_rand rng;
+    for (int i = 0; i < 1000; i++) {
+        const auto newtime = std::chrono::seconds(rng() % (n * 2));
+        EXPECT_TRUE(queue.updateWaketime(
+                tasks[rng() % n],
+                std::chrono::steady_clock::time_point(newtime)));
+        queue.assertInvariants();
+    }
+
+    ExTask lastTask;
+    while (!queue.empty()) {
+        if (lastTask) {
+            EXPECT_LE(lastTask->getWaketime(), queue.top()->getWaketime());
+        }
+        lastTask = queue.top();
+        queue.pop();
+    }
+}
+
 /*
  * snooze/wake a task not in the queue, the queue is also empty.
  */
@@ -31,7 +31,9 @@
 #include <signal.h>
 #include <algorithm>
 #include <limits>
+#include <map>
 #include <string>
+#include <thread>
 
 EPStats global_stats;
 
@@ -146,6 +148,41 @@ TEST_F(HashTableTest, Size) {
     EXPECT_EQ(1, count(h));
 }
 
+// Check the memory used by each collection is tracked as items of the
+// collection are added, replaced and removed.
+TEST_F(HashTableTest, CollectionMemory) {
+    HashTable h(global_stats,
+                makeFactory(),
+                defaultHtSize,
+                /*locks*/ 1);
+    const CollectionID fruit = 9;
+    const auto defaultKey = makeStoredDocKey("key");
+    const auto fruitKey = makeStoredDocKey("apple", fruit);
+    store(h, defaultKey);
+    store(h, fruitKey);
+
+    auto sizeOf = [&h](const StoredDocKey& key) {
+        return h.findForRead(key).storedValue->size();
+    };
+    EXPECT_EQ(sizeOf(defaultKey), h.getCollectionMemory(CollectionID::Default));
+    EXPECT_EQ(sizeOf(fruitKey), h.getCollectionMemory(fruit));
+    EXPECT_EQ(h.getItemMemory(),
+              h.getCollectionMemory(CollectionID::Default) +
+                      h.getCollectionMemory(fruit));
+
+    // A bigger value for the fruit key
+    std::string value(100, 'x');
+    Item bigger(fruitKey, 0, 0, value.data(), value.size());
+    EXPECT_EQ(MutationStatus::WasClean, h.set(bigger));
+    EXPECT_EQ(sizeOf(fruitKey), h.getCollectionMemory(fruit));
+    EXPECT_EQ(2, h.getCollectionsMemory().size());
+
+    EXPECT_TRUE(del(h, fruitKey));
+    EXPECT_EQ(0, h.getCollectionMemory(fruit));
+    EXPECT_EQ(sizeOf(defaultKey), h.getCollectionMemory(CollectionID::Default));
+    EXPECT_EQ(0, h.getCollectionMemory(10));
+}
+
 TEST_F(HashTableTest, SizeTwo) {
     HashTable h(global_stats,
                 makeFactory(),
@@ -223,6 +260,29 @@ TEST_F(HashTableTest, Find) {
     testFind(h);
 }
 
+// HashTables sharing one set of locks each still hold their own items, and
+// don't account the memory of the locks they don't own
+TEST_F(HashTableTest, SharedLocks) {
+    auto locks = std::make_shared<HashTable::Locks>(3);
+    HashTable own(global_stats, makeFactory(), 5, 3);
+    HashTable h1(
+            global_stats, makeFactory(), 5, 3, HashTable::Layout::Chained, locks);
+    HashTable h2(
+            global_stats, makeFactory(), 5, 3, HashTable::Layout::Chained, locks);
+    EXPECT_EQ(3, h1.getNumLocks());
+    EXPECT_EQ(3, h2.getNumLocks());
+    EXPECT_EQ(own.memorySize() - 3 * sizeof(HashTable::Mutex),
+              h1.memorySize());
+
+    testFind(h1);
+    EXPECT_EQ(0, count(h2));
+    h2.resize(17);
+    testFind(h2);
+    h1.clear();
+    EXPECT_EQ(0, count(h1));
+    verifyFound(h2, generateKeys(1000));
+}
+
 TEST_F(HashTableTest, Resize) {
     HashTable h(global_stats, makeFactory(), 5, 3);
 
@@ -247,6 +307,106 @@ TEST_F(HashTableTest, Resize) {
     verifyFound(h, keys);
 }
 
+// A single group can't hold all of the keys in its own slots; check that the
+// keys sharing a slot may still be found and deleted.
+TEST_F(HashTableTest, GroupedLayoutOverflow) {
+    HashTable h(global_stats,
+                makeFactory(),
+                1,
+                1,
+                HashTable::Layout::Grouped);
+    ASSERT_EQ(HashTable::Layout::Grouped, h.getLayout());
+
+    auto keys = generateKeys(10 * HashTable::GroupSlots);
+    storeMany(h, keys);
+    verifyFound(h, keys);
+    EXPECT_EQ(keys.size(), size_t(count(h)));
+
+    std::vector<StoredDocKey> remaining;
+    std::vector<StoredDocKey> deleted;
+    for (size_t ii = 0; ii < keys.size(); ++ii) {
+        if (ii % 2) {
+            remaining.push_back(keys[ii]);
+        } else {
+            EXPECT_TRUE(del(h, keys[ii]));
+            EXPECT_FALSE(h.findForRead(keys[ii]).storedValue);
+            deleted.push_back(keys[ii]);
+        }
+    }
+    verifyFound(h, remaining);
+    EXPECT_EQ(remaining.size(), size_t(count(h)));
+
+    // The freed slots must be reusable
+    storeMany(h, deleted);
+    verifyFound(h, keys);
+    EXPECT_EQ(keys.size(), size_t(count(h)));
+}
+
+TEST_F(HashTableTest, GroupedLayoutResize) {
+    HashTable h(global_stats,
+                makeFactory(),
+                5,
+                3,
+                HashTable::Layout::Grouped);
+
+    auto keys = generateKeys(1000);
+    storeMany(h, keys);
+    verifyFound(h, keys);
+
+    // Each group holds many items, so should need a lot fewer buckets (97
+    // rounded up to a multiple of the number of locks)
+    h.resize();
+    EXPECT_EQ(99, h.getSize());
+    verifyFound(h, keys);
+    EXPECT_EQ(keys.size(), size_t(count(h)));
+
+    h.resize(3);
+    EXPECT_EQ(3, h.getSize());
+    verifyFound(h, keys);
+    EXPECT_EQ(keys.size(), size_t(count(h)));
+}
+
+// The Committed and Pending items of a key must both be found even if they
+// end up in different slots of the group.
+TEST_F(HashTableTest, GroupedLayoutCommittedAndPending) {
+    HashTable ht(global_stats,
+                 makeFactory(true),
+                 1,
+                 1,
+                 HashTable::Layout::Grouped);
+    auto keys = generateKeys(HashTable::GroupSlots - 1);
+    storeMany(ht, keys);
+
+    auto key = makeStoredDocKey("key");
+    store(ht, key);
+    {
+        // Add the prepare once the group is full
+        auto prepared = makePendingItem(key, "prepared");
+        auto htRes = ht.findForWrite(key);
+        ASSERT_TRUE(htRes.storedValue);
+        ASSERT_FALSE(htRes.storedValue->isPending());
+        ht.unlocked_addNewStoredValue(htRes.lock, *prepared);
+    }
+
+    {
+        auto result = ht.findForCommit(key);
+        ASSERT_TRUE(result.pending);
+        EXPECT_TRUE(result.pending->isPending());
+        ASSERT_TRUE(result.committed);
+        EXPECT_TRUE(result.committed->isCommitted());
+    }
+    ASSERT_TRUE(ht.findOnlyPrepared(key).storedValue);
+    ASSERT_TRUE(ht.findOnlyCommitted(key).storedValue);
+
+    {
+        auto htRes = ht.findOnlyPrepared(key);
+        ht.unlocked_del(htRes.lock, htRes.storedValue);
+    }
+    EXPECT_FALSE(ht.findOnlyPrepared(key).storedValue);
+    EXPECT_TRUE(ht.findOnlyCommitted(key).storedValue);
+    verifyFound(ht, keys);
+}
+
 class AccessGenerator : public Generator<bool> {
 public:
 
@@ -302,10 +462,65 @@ TEST_F(HashTableTest, AutoResize) {
     verifyFound(h, keys);
 
     h.resize();
-    EXPECT_EQ(769, h.getSize());
+    // 769 rounded up to a multiple of the number of locks
+    EXPECT_EQ(771, h.getSize());
     verifyFound(h, keys);
 }
 
+// When the sizes are a multiple of the number of locks the items are
+// migrated to the new table incrementally
+TEST_F(HashTableTest, IncrementalResize) {
+    HashTable h(global_stats, makeFactory(), 6, 3);
+
+    auto keys = generateKeys(1000);
+    storeMany(h, keys);
+
+    h.resize(3000);
+    EXPECT_EQ(3000, h.getSize());
+    EXPECT_FALSE(h.isResizing());
+    verifyFound(h, keys);
+    EXPECT_EQ(keys.size(), size_t(count(h)));
+
+    h.resize(297);
+    EXPECT_EQ(297, h.getSize());
+    EXPECT_FALSE(h.isResizing());
+    verifyFound(h, keys);
+    EXPECT_EQ(keys.size(), size_t(count(h)));
+}
+
+// Access and visit the table while it is resized back and forth
+// incrementally by another thread
+TEST_F(HashTableTest, ConcurrentAccessIncrementalResize) {
+    HashTable h(global_stats, makeFactory(), 6, 3);
+
+    auto keys = generateKeys(2000);
+    storeMany(h, keys);
+
+    std::atomic<bool> stop{false};
+    std::thread resizer([&h, &stop]() {
+        size_t newSize = 999;
+        while (!stop) {
+            h.resize(newSize);
+            newSize = (newSize == 999) ? 3000 : 999;
+        }
+    });
+
+    for (int ii = 0; ii < 10; ++ii) {
+        verifyFound(h, keys);
+        EXPECT_EQ(keys.size(), size_t(count(h)));
+        for (const auto& key : keys) {
+            EXPECT_TRUE(del(h, key));
+        }
+        EXPECT_EQ(0, count(h));
+        storeMany(h, keys);
+    }
+
+    stop = true;
+    resizer.join();
+    verifyFound(h, keys);
+    EXPECT_EQ(keys.size(), size_t(count(h)));
+}
+
 TEST_F(HashTableTest, DepthCounting) {
     HashTable h(global_stats, makeFactory(), 5, 1);
     const int nkeys = 5000;
@@ -319,6 +534,105 @@ TEST_F(HashTableTest, DepthCounting) {
     EXPECT_GT(depthCounter.max, 1000);
 }
 
+// Test that getRandomKey picks each item about equally often, including
+// those which aren't first in their bucket or follow empty buckets.
+TEST_F(HashTableTest, RandomKeyUniform) {
+    HashTable h(global_stats, makeFactory(), 64, 1);
+    const int nkeys = 64;
+    auto keys = generateKeys(nkeys);
+    storeMany(h, keys);
+
+    const int samplesPerKey = 200;
+    std::map<std::string, int> picked;
+    for (long ii = 0; ii < nkeys * samplesPerKey; ++ii) {
+        auto item = h.getRandomKey(ii);
+        ASSERT_TRUE(item);
+        picked[StoredDocKey(item->getKey()).to_string()]++;
+    }
+
+    ASSERT_EQ(size_t(nkeys), picked.size());
+    for (const auto& entry : picked) {
+        EXPECT_GT(entry.second, samplesPerKey / 2) << entry.first;
+        EXPECT_LT(entry.second, samplesPerKey * 3 / 2) << entry.first;
+    }
+}
+
+// Test that getRandomKey only returns items of the collection asked for
+TEST_F(HashTableTest, RandomKeyCollection) {
+    HashTable h(global_stats, makeFactory(), 64, 1);
+    const CollectionID fruit = 8;
+    for (int ii = 0; ii < 64; ++ii) {
+        store(h, makeStoredDocKey("key" + std::to_string(ii)));
+    }
+    for (int ii = 0; ii < 4; ++ii) {
+        store(h, makeStoredDocKey("fruit" + std::to_string(ii), fruit));
+    }
+
+    for (long ii = 0; ii < 100; ++ii) {
+        auto item = h.getRandomKey(ii, fruit);
+        ASSERT_TRUE(item);
+        EXPECT_EQ(fruit, item->getKey().getCollectionID());
+    }
+    EXPECT_FALSE(h.getRandomKey(0, CollectionID(9)));
+}
+
+// Test that findManyForRead finds each of the keys (and only those stored)
+TEST_F(HashTableTest, FindManyForRead) {
+    HashTable h(global_stats, makeFactory(), 5, 3);
+    auto stored = generateKeys(100);
+    storeMany(h, stored);
+
+    // Every other key requested isn't stored
+    auto requested = generateKeys(200, 50);
+    std::vector<DocKey> keys(requested.begin(), requested.end());
+    std::vector<int> found(keys.size(), -1);
+    h.findManyForRead(keys,
+                      TrackReference::No,
+                      WantsDeleted::No,
+                      [&found, &keys](size_t index, const StoredValue* v) {
+                          ASSERT_EQ(-1, found[index]) << "called twice";
+                          found[index] = v ? 1 : 0;
+                          if (v) {
+                              EXPECT_TRUE(v->hasKey(keys[index]));
+                          }
+                      });
+
+    for (size_t ii = 0; ii < keys.size(); ++ii) {
+        EXPECT_EQ(ii < 50 ? 1 : 0, found[ii]) << ii;
+    }
+}
+
+// As FindManyForRead, with the Grouped layout and more keys per lock than
+// are looked up together
+TEST_F(HashTableTest, FindManyForReadGrouped) {
+    HashTable h(global_stats,
+                makeFactory(),
+                5,
+                1,
+                HashTable::Layout::Grouped);
+    auto stored = generateKeys(100);
+    storeMany(h, stored);
+
+    auto requested = generateKeys(200, 50);
+    ASSERT_GT(requested.size(), HashTable::FindManyWindow);
+    std::vector<DocKey> keys(requested.begin(), requested.end());
+    std::vector<int> found(keys.size(), -1);
+    h.findManyForRead(keys,
+                      TrackReference::No,
+                      WantsDeleted::No,
+                      [&found, &keys](size_t index, const StoredValue* v) {
+                          ASSERT_EQ(-1, found[index]) << "called twice";
+                          found[index] = v ? 1 : 0;
+                          if (v) {
+                              EXPECT_TRUE(v->hasKey(keys[index]));
+                          }
+                      });
+
+    for (size_t ii = 0; ii < keys.size(); ++ii) {
+        EXPECT_EQ(ii < 50 ? 1 : 0, found[ii]) << ii;
+    }
+}
+
 TEST_F(HashTableTest, PoisonKey) {
     HashTable h(global_stats, makeFactory(), 5, 1);
 
@@ -1126,6 +1440,53 @@ TEST_F(HashTableTest, ItemFreqDecayerVisitorTest) {
        }
 }
 
+// Test that the frequency counters are decayed lazily, by the epochs each
+// document missed when it's decayed, and that the epoch can't get further
+// ahead of the documents than they can record.
+TEST_F(HashTableTest, LazyFreqDecay) {
+    HashTable ht(global_stats, makeFactory(true), 128, 1);
+    auto key = makeStoredDocKey("key");
+    store(ht, key);
+    ht.findForWrite(key).storedValue->setFreqCounterValue(200);
+
+    // Nothing is decayed until the document is
+    EXPECT_TRUE(ht.advanceFreqDecayEpoch(50));
+    EXPECT_TRUE(ht.advanceFreqDecayEpoch(50));
+    EXPECT_EQ(200, ht.findForWrite(key).storedValue->getFreqCounterValue());
+    {
+        auto item = ht.findForWrite(key);
+        ht.decayFreqCounter(*item.storedValue);
+        EXPECT_EQ(50, item.storedValue->getFreqCounterValue());
+        // Only decayed once per epoch
+        ht.decayFreqCounter(*item.storedValue);
+        EXPECT_EQ(50, item.storedValue->getFreqCounterValue());
+    }
+
+    // A new document's counter is current
+    auto newKey = makeStoredDocKey("newKey");
+    store(ht, newKey);
+    {
+        auto item = ht.findForWrite(newKey);
+        const auto freq = item.storedValue->getFreqCounterValue();
+        ht.decayFreqCounter(*item.storedValue);
+        EXPECT_EQ(freq, item.storedValue->getFreqCounterValue());
+    }
+
+    // Nothing has been swept since epoch 0, so the epoch can only get 3
+    // ahead of it
+    EXPECT_TRUE(ht.advanceFreqDecayEpoch(50));
+    EXPECT_FALSE(ht.advanceFreqDecayEpoch(50));
+    EXPECT_EQ(3, ht.getFreqDecayEpoch());
+
+    ht.setFreqDecaySwept(ht.getFreqDecayEpoch());
+    EXPECT_TRUE(ht.advanceFreqDecayEpoch(50));
+    {
+        auto item = ht.findForWrite(key);
+        ht.decayFreqCounter(*item.storedValue);
+        EXPECT_EQ(12, item.storedValue->getFreqCounterValue());
+    }
+}
+
 // Test the reallocateStoredValue method.
 // Check it can reallocate and also ignores bogus input
 TEST_F(HashTableTest, reallocateStoredValue) {
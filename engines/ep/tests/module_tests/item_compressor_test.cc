@@ -93,6 +93,10 @@ TEST_P(ItemCompressorTest, testCompressionInActiveMode) {
     EXPECT_EQ(new_datatype_count + 1,
               vbucket->ht.getDatatypeCounts()[new_datatype]);
     EXPECT_EQ(itemCount, vbucket->ht.getNumItems());
+    EXPECT_EQ(1, visitor.getCompressedCount());
+    EXPECT_EQ(1, visitor.getRejectedCount());
+    EXPECT_EQ(item1.getNBytes() - compressible_item->getNBytes(),
+              visitor.getBytesSaved());
 }
 
 // Test that an item will be left as uncompressed if the
@@ -127,6 +131,39 @@ TEST_P(ItemCompressorTest, testStoreUncompressedInActiveMode) {
 
     EXPECT_EQ(uncompressed_str, v->getValue()->to_s());
     EXPECT_EQ(PROTOCOL_BINARY_DATATYPE_JSON, v->getDatatype());
+    EXPECT_EQ(0, visitor.getCompressedCount());
+    EXPECT_EQ(1, visitor.getRejectedCount());
+    EXPECT_EQ(0, visitor.getBytesSaved());
+}
+
+// Test that an adapter restricted to a partition of the vBuckets only visits
+// the vBuckets of that partition.
+TEST_P(ItemCompressorTest, testVBucketPartition) {
+    auto key = makeStoredDocKey("key");
+    auto item = make_item(vbucket->getId(),
+                          key,
+                          std::string(1024, 'a'),
+                          0,
+                          PROTOCOL_BINARY_DATATYPE_JSON);
+    ASSERT_EQ(MutationStatus::WasClean, public_processSet(item, 0));
+
+    const size_t partitions = 2;
+    const size_t ownPartition = vbucket->getId().get() % partitions;
+    for (size_t partition = 0; partition < partitions; ++partition) {
+        PauseResumeVBAdapter prAdapter(
+                std::make_unique<ItemCompressorVisitor>());
+        prAdapter.setVBucketPartition(partition, partitions);
+        auto& visitor =
+                dynamic_cast<ItemCompressorVisitor&>(prAdapter.getHTVisitor());
+        visitor.setCompressionMode(BucketCompressionMode::Active);
+        visitor.setMinCompressionRatio(config.getMinCompressionRatio());
+        EXPECT_TRUE(prAdapter.visit(*vbucket));
+        EXPECT_EQ(partition == ownPartition ? 1 : 0,
+                  visitor.getVisitedCount());
+    }
+
+    PauseResumeVBAdapter prAdapter(std::make_unique<ItemCompressorVisitor>());
+    EXPECT_THROW(prAdapter.setVBucketPartition(2, 2), std::invalid_argument);
 }
 
 INSTANTIATE_TEST_CASE_P(
@@ -53,3 +53,47 @@ TEST(ItemEvictionClassTest, freqThreshold) {
     EXPECT_EQ(255, result100.first);
     EXPECT_EQ(510, result100.second);
 }
+
+// Test the cost-aware eviction score: of values with the same frequency
+// count, those freeing the most memory per refetch should score lowest.
+TEST(ItemEvictionClassTest, evictionScore) {
+    const uint8_t freq = 100;
+    const size_t ref = 1000;
+    const double latency = 100;
+    const size_t weight = 8;
+
+    // Disabled, or a value like the reference
+    EXPECT_EQ(freq, ItemEviction::getEvictionScore(
+                            freq, 1000000, 1000000, ref, latency, 0));
+    EXPECT_EQ(freq, ItemEviction::getEvictionScore(
+                            freq, ref, ref, ref, latency, weight));
+    // Without any bgfetch latency, the cost per byte of an uncompressed
+    // value doesn't depend on its size
+    EXPECT_EQ(freq, ItemEviction::getEvictionScore(
+                            freq, 1000000, 1000000, ref, 0, weight));
+
+    const auto large = ItemEviction::getEvictionScore(
+            freq, 1000000, 1000000, ref, latency, weight);
+    const auto small =
+            ItemEviction::getEvictionScore(freq, 50, 50, ref, latency, weight);
+    EXPECT_LT(large, freq);
+    EXPECT_GT(small, freq);
+
+    // A compressed value frees fewer bytes than it reads back
+    EXPECT_GT(ItemEviction::getEvictionScore(
+                      freq, 1000000, 2000000, ref, latency, weight),
+              large);
+
+    // The score stays in the range of the frequency count
+    EXPECT_EQ(0,
+              ItemEviction::getEvictionScore(
+                      0, 1000000, 1000000, ref, latency, weight));
+    EXPECT_EQ(std::numeric_limits<uint8_t>::max(),
+              ItemEviction::getEvictionScore(
+                      std::numeric_limits<uint8_t>::max(),
+                      50,
+                      50,
+                      ref,
+                      latency,
+                      weight));
+}
@@ -29,6 +29,7 @@
 #include "item_eviction.h"
 #include "memory_tracker.h"
 #include "test_helpers.h"
+#include "tests/module_tests/collections/test_manifest.h"
 #include "tests/mock/mock_synchronous_ep_engine.h"
 
 #include <folly/portability/GTest.h>
@@ -297,6 +298,83 @@ TEST_P(STItemPagerTest, HighWaterMarkTriggersPager) {
     runHighMemoryPager();
 }
 
+// Test that sampled eviction brings memory usage down to the low watermark
+// from the ItemPager task itself, without a PagingVisitor.
+TEST_P(STItemPagerTest, SampledEviction) {
+    if (std::get<1>(GetParam()) == "fail_new_data") {
+        return;
+    }
+    engine->getConfiguration().setPagerSampledEviction(true);
+    size_t count = populateUntilTmpFail(vbid);
+    ASSERT_GE(count, 50) << "Too few documents stored";
+
+    auto& stats = engine->getEpStats();
+    auto& lpNonioQ = *task_executor->getLpTaskQ()[NONIO_TASK_IDX];
+    // Each run is time limited, so may need a few
+    for (int ii = 0; ii < 10 && stats.getEstimatedTotalMemoryUsed() >
+                                        stats.mem_low_wat.load();
+         ++ii) {
+        runNextTask(lpNonioQ, "Paging out items.");
+    }
+    EXPECT_EQ(initialNonIoTasks, lpNonioQ.getFutureQueueSize());
+    flushDirectlyIfPersistent(vbid);
+
+    EXPECT_LT(stats.getEstimatedTotalMemoryUsed(), stats.mem_low_wat.load());
+    auto vb = engine->getVBucket(vbid);
+    const auto numResidentItems =
+            vb->getNumItems() - vb->getNumNonResidentItems();
+    EXPECT_LT(numResidentItems, count);
+}
+
+// Test that the ItemPager evicts from a collection over its memory quota,
+// even though the bucket is below the watermarks.
+TEST_P(STItemPagerTest, CollectionMemoryQuota) {
+    if (std::get<1>(GetParam()) == "fail_new_data") {
+        return;
+    }
+    CollectionsManifest cm(CollectionEntry::fruit);
+    ASSERT_EQ(cb::engine_errc::success, store->setCollections({cm}).code());
+
+    const std::string value(512, 'x');
+    for (int ii = 0; ii < 20; ii++) {
+        for (auto cid : {CollectionID(CollectionID::Default),
+                         CollectionEntry::fruit.getId()}) {
+            auto item = make_item(
+                    vbid, makeStoredDocKey("key_" + std::to_string(ii), cid),
+                    value);
+            item.setFreqCounterValue(0);
+            ASSERT_EQ(ENGINE_SUCCESS, storeItem(item));
+        }
+    }
+    flushDirectlyIfPersistent(vbid);
+
+    auto vb = engine->getVBucket(vbid);
+    const auto defaultMem = vb->ht.getCollectionMemory(CollectionID::Default);
+    const auto fruitMem =
+            vb->ht.getCollectionMemory(CollectionEntry::fruit.getId());
+    ASSERT_GT(fruitMem, 0);
+    const auto quota = fruitMem / 2;
+    engine->getConfiguration().setCollectionMemoryQuotas(
+            CollectionEntry::fruit.getId().to_string() + ":" +
+            std::to_string(quota));
+    auto overQuota = ItemPager::getCollectionsOverQuota(
+            *store, engine->getConfiguration().getCollectionMemoryQuotas());
+    ASSERT_EQ(1, overQuota.size());
+    EXPECT_EQ(fruitMem - quota, overQuota[CollectionEntry::fruit.getId()]);
+
+    auto& lpNonioQ = *task_executor->getLpTaskQ()[NONIO_TASK_IDX];
+    runNextTask(lpNonioQ, "Paging out items.");
+    runNextTask(lpNonioQ, "Item pager on vb:0");
+
+    EXPECT_LE(vb->ht.getCollectionMemory(CollectionEntry::fruit.getId()),
+              quota);
+    EXPECT_EQ(defaultMem, vb->ht.getCollectionMemory(CollectionID::Default));
+    EXPECT_TRUE(ItemPager::getCollectionsOverQuota(
+                        *store,
+                        engine->getConfiguration().getCollectionMemoryQuotas())
+                        .empty());
+}
+
 // Tests that for the hifi_mfu eviction algorithm we visit replica vbuckets
 // first.
 TEST_P(STItemPagerTest, ReplicaItemsVisitedFirst) {
@@ -848,6 +926,41 @@ TEST_P(STExpiryPagerTest, ExpiredItemsDeleted) {
     expiredItemsDeleted();
 }
 
+// Test that the runs of the expiry pager which only visit the keys due
+// per the expiry index (rather than every item) expire the items.
+TEST_P(STExpiryPagerTest, ExpiryIndex) {
+    auto vb = store->getVBucket(vbid);
+    ASSERT_TRUE(vb->expiryIndex.isEnabled());
+
+    for (size_t ii = 0; ii < 3; ii++) {
+        auto key = makeStoredDocKey("key_" + std::to_string(ii));
+        const uint32_t expiry =
+                ii > 0 ? ep_abs_time(ep_current_time() + ii * 100) : 0;
+        auto item = make_item(vbid, key, "value", expiry);
+        ASSERT_EQ(ENGINE_SUCCESS, storeItem(item));
+    }
+    flushDirectlyIfPersistent(vbid, std::make_pair(false, 3));
+
+    // Only the keys with a TTL are indexed
+    EXPECT_EQ(2, vb->expiryIndex.size());
+
+    // The first run visits every item (and drains the index of the keys
+    // which are due)
+    TimeTraveller bill(101);
+    wakeUpExpiryPager();
+    flushDirectlyIfPersistent(vbid, std::make_pair(false, 1));
+    EXPECT_EQ(2, vb->getNumItems());
+    EXPECT_EQ(1, vb->expiryIndex.size());
+
+    // The next one only visits the keys due per the index
+    TimeTraveller ted(100);
+    wakeUpExpiryPager();
+    flushDirectlyIfPersistent(vbid, std::make_pair(false, 1));
+    EXPECT_EQ(1, vb->getNumItems())
+            << "key_2 should have been expired via the expiry index";
+    EXPECT_EQ(0, vb->expiryIndex.size());
+}
+
 // Test that when an expired system-xattr document is fetched with getMeta
 // it can be successfully expired again
 TEST_P(STExpiryPagerTest, MB_25650) {
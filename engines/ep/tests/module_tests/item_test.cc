@@ -137,6 +137,67 @@ TEST_F(ItemTest, checkNRUandFreqCounterValueSetCorrectly) {
     EXPECT_EQ(128, item->getFreqCounterValue());
 }
 
+// Test that an Item made from an existing value shares its Blob, and takes
+// over the reference of a temporary rather than adding its own.
+TEST_F(ItemTest, sharesExistingValue) {
+    std::string valueData = R"(value)";
+    value_t value(Blob::New(valueData.data(), valueData.size()));
+    ASSERT_EQ(1, value.refCount());
+
+    Item shared(makeStoredDocKey("key"), 0, 0, value);
+    EXPECT_EQ(value.get().get(), shared.getValue().get().get());
+    EXPECT_EQ(2, value.refCount());
+    EXPECT_EQ(int(Item::initialFreqCount), int(shared.getFreqCounterValue()));
+
+    Item moved(makeStoredDocKey("key"), 0, 0, value_t(value));
+    EXPECT_EQ(3, value.refCount());
+    EXPECT_EQ(int(Item::initialFreqCount), int(moved.getFreqCounterValue()));
+}
+
+// Test that appending to a Blob keeps the data of the Blob appended to in
+// place, and that the value can be read (and copied) in full.
+TEST_F(ItemTest, appendedBlob) {
+    value_t first(Blob::New("abc", 3));
+    value_t second(Blob::NewAppended(*first, "de", 2));
+    value_t third(Blob::NewAppended(*second, "fgh", 3));
+    EXPECT_FALSE(first->isSegmented());
+    EXPECT_EQ(1, first->getSegmentCount());
+    ASSERT_TRUE(third->isSegmented());
+    EXPECT_EQ(3, third->getSegmentCount());
+    EXPECT_EQ(8, third->valueSize());
+    // Each segment only holds (and accounts for) its own data
+    const std::string large(1000, 'x');
+    value_t big(Blob::New(large.data(), large.size()));
+    value_t bigAppended(Blob::NewAppended(*big, "de", 2));
+    EXPECT_EQ(second->getSize(), bigAppended->getSize());
+    // The Blobs appended to are kept alive by the new one
+    EXPECT_EQ(2, second.refCount());
+
+    // Part of the value may be read without making it contiguous
+    char buffer[4];
+    third->copyData(buffer, 2, sizeof(buffer));
+    EXPECT_EQ("cdef", std::string(buffer, sizeof(buffer)));
+    EXPECT_EQ(3, third->getSegmentCount());
+
+    // A copy is contiguous
+    value_t copy(Blob::Copy(*third));
+    EXPECT_FALSE(copy->isSegmented());
+    EXPECT_EQ("abcdefgh", copy->to_s());
+    EXPECT_EQ(*copy, *third);
+
+    // Reading the whole value makes it contiguous (once)
+    const char* data = third->getData();
+    EXPECT_EQ("abcdefgh", std::string(data, third->valueSize()));
+    EXPECT_EQ(data, third->getData());
+    EXPECT_EQ(1, third->getSegmentCount());
+
+    // Appending to a value made contiguous doesn't refer to its segments
+    value_t fourth(Blob::NewAppended(*third, "i", 1));
+    EXPECT_EQ(2, fourth->getSegmentCount());
+    EXPECT_EQ(1, third.refCount());
+    EXPECT_EQ("abcdefghi", fourth->to_s());
+}
+
 TEST_F(ItemTest, retainInfoUponItemCopy) {
     // Setup the item using non-default parameters
     std::string valueData = R"(oranges)";
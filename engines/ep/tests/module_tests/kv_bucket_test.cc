@@ -724,6 +724,123 @@ TEST_P(KVBucketParamTest, SetWithMeta_Forced) {
                                  /*allowExisting*/ false));
 }
 
+// Test a batch of replicated setWithMeta's; the batch stops at the first
+// item which can't be set.
+TEST_P(KVBucketParamTest, SetWithMetaBatch) {
+    store->setVBucketState(vbid, vbucket_state_replica);
+
+    std::vector<Item> items;
+    for (int ii = 1; ii <= 3; ++ii) {
+        items.push_back(make_item(
+                vbid, makeStoredDocKey("key" + std::to_string(ii)), "value"));
+        items.back().setCas();
+        items.back().setBySeqno(ii);
+    }
+    std::vector<Item*> batch;
+    for (auto& item : items) {
+        batch.push_back(&item);
+    }
+
+    auto result = store->setWithMetaBatch(
+            vbid, batch, cookie, {vbucket_state_replica});
+    EXPECT_EQ(3, result.first);
+    EXPECT_EQ(ENGINE_SUCCESS, result.second);
+    EXPECT_EQ(3, store->getVBucket(vbid)->getHighSeqno());
+
+    // An invalid CAS stops the batch
+    auto item = make_item(vbid, makeStoredDocKey("key4"), "value");
+    item.setBySeqno(5);
+    Item* next = &items.front();
+    next->setBySeqno(4);
+    result = store->setWithMetaBatch(
+            vbid, {next, &item}, cookie, {vbucket_state_replica});
+    EXPECT_EQ(1, result.first);
+    EXPECT_EQ(ENGINE_KEY_EEXISTS, result.second);
+    EXPECT_EQ(4, store->getVBucket(vbid)->getHighSeqno());
+
+    // Not for a vbucket in the wrong state
+    result = store->setWithMetaBatch(
+            vbid, batch, cookie, {vbucket_state_active});
+    EXPECT_EQ(0, result.first);
+    EXPECT_EQ(ENGINE_NOT_MY_VBUCKET, result.second);
+}
+
+// Test a batch of setWithMeta's with conflict resolution; unlike
+// setWithMetaBatch each item gets its own result.
+TEST_P(KVBucketParamTest, SetWithMetaMulti) {
+    auto existing = make_item(vbid, makeStoredDocKey("key2"), "value");
+    ASSERT_EQ(ENGINE_SUCCESS, store->set(existing, cookie));
+
+    auto item1 = make_item(vbid, makeStoredDocKey("key1"), "value1");
+    item1.setCas();
+    // Loses the conflict resolution (same revSeqno and CAS)
+    auto item2 = existing;
+    auto item3 = make_item(vbid, makeStoredDocKey("key3", CollectionID(9)), "");
+    item3.setCas();
+    std::vector<Item*> items{&item1, &item2, &item3};
+
+    auto results = store->setWithMetaMulti(vbid,
+                                           items,
+                                           {vbucket_state_active},
+                                           CheckConflicts::Yes,
+                                           GenerateCas::No);
+    ASSERT_EQ(3, results.size());
+    EXPECT_EQ(ENGINE_SUCCESS, results[0]);
+    EXPECT_EQ(ENGINE_KEY_EEXISTS, results[1]);
+    // The collection doesn't exist
+    EXPECT_EQ(ENGINE_UNKNOWN_COLLECTION, results[2]);
+
+    auto gv = store->get(item1.getKey(), vbid, cookie, {});
+    ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    EXPECT_EQ(item1.getCas(), gv.item->getCas());
+
+    // Nothing is stored in a replica
+    store->setVBucketState(vbid, vbucket_state_replica);
+    results = store->setWithMetaMulti(vbid,
+                                      items,
+                                      {vbucket_state_active},
+                                      CheckConflicts::Yes,
+                                      GenerateCas::No);
+    EXPECT_EQ(std::vector<ENGINE_ERROR_CODE>(3, ENGINE_NOT_MY_VBUCKET),
+              results);
+}
+
+// Test getting the meta data of a batch of keys; the keys whose meta data
+// isn't in memory are left for the caller to fetch.
+TEST_P(KVBucketParamTest, GetMetaDataMulti) {
+    auto key1 = makeStoredDocKey("key1");
+    auto item = store_item(vbid, key1, "value");
+    flushVBucketToDiskIfPersistent(vbid, 1);
+
+    std::vector<DocKey> keys{key1,
+                             makeStoredDocKey("missing"),
+                             makeStoredDocKey("key3", CollectionID(9))};
+    auto results = store->getMetaDataMulti(vbid, keys);
+    ASSERT_EQ(3, results.size());
+    ASSERT_EQ(ENGINE_SUCCESS, results[0].status);
+    EXPECT_EQ(item.getCas(), results[0].metadata.cas);
+    EXPECT_EQ(0, results[0].deleted);
+    EXPECT_EQ(ENGINE_KEY_ENOENT, results[1].status);
+    // The collection doesn't exist
+    EXPECT_EQ(ENGINE_UNKNOWN_COLLECTION, results[2].status);
+
+    if (GetParam() == "item_eviction_policy=full_eviction") {
+        // An evicted key waits for its meta data, but no fetch is scheduled
+        // for it (only a temp item is added, for the caller's fetch)
+        evict_key(vbid, key1);
+        results = store->getMetaDataMulti(vbid, {key1});
+        ASSERT_EQ(1, results.size());
+        EXPECT_EQ(ENGINE_EWOULDBLOCK, results[0].status);
+        EXPECT_EQ(1, store->getVBucket(vbid)->getNumTempItems());
+    }
+
+    store->setVBucketState(vbid, vbucket_state_replica);
+    results = store->getMetaDataMulti(vbid, keys);
+    for (const auto& result : results) {
+        EXPECT_EQ(ENGINE_NOT_MY_VBUCKET, result.status);
+    }
+}
+
 // MB and test was raised because a few commits back this was broken but no
 // existing test covered the case. I.e. run this test  against 0810540 and it
 // fails, but now fixed
@@ -1338,17 +1455,223 @@ TEST_P(KVBucketParamTest, MB31495_GetRandomKey) {
     setRandomFunction(returnZero);
 
     // Try with am empty hash table
-    auto gv = store->getRandomKey();
+    auto gv = store->getRandomKey(boost::none, cookie);
     EXPECT_EQ(ENGINE_KEY_ENOENT, gv.getStatus());
 
     Item item = store_item(
             vbid, {"key", DocKeyEncodesCollectionId::No}, "value", 0);
 
     // Try with a non-empty hash table
-    gv = store->getRandomKey();
+    gv = store->getRandomKey(boost::none, cookie);
     EXPECT_EQ(ENGINE_SUCCESS, gv.getStatus());
 }
 
+// Check that getRandomKey may be restricted to a collection
+TEST_P(KVBucketParamTest, GetRandomKeyCollection) {
+    store_item(vbid, {"key", DocKeyEncodesCollectionId::No}, "value", 0);
+
+    auto gv = store->getRandomKey(CollectionID(CollectionID::Default), cookie);
+    ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    EXPECT_EQ(CollectionID::Default, gv.item->getKey().getCollectionID());
+
+    // The collection doesn't exist
+    gv = store->getRandomKey(CollectionID(9), cookie);
+    EXPECT_EQ(ENGINE_UNKNOWN_COLLECTION, gv.getStatus());
+}
+
+TEST_P(KVBucketParamTest, SetMulti) {
+    auto item1 = make_item(vbid, makeStoredDocKey("key1"), "value1");
+    auto item2 = make_item(vbid, makeStoredDocKey("key2", CollectionID(9)), "");
+    auto item3 = make_item(vbid, makeStoredDocKey("key3"), "value3");
+    std::vector<Item*> items{&item1, &item2, &item3};
+
+    auto results = store->setMulti(vbid, items, cookie);
+    ASSERT_EQ(3, results.size());
+    EXPECT_EQ(ENGINE_SUCCESS, results[0]);
+    // The collection doesn't exist
+    EXPECT_EQ(ENGINE_UNKNOWN_COLLECTION, results[1]);
+    EXPECT_EQ(ENGINE_SUCCESS, results[2]);
+    EXPECT_NE(0, item1.getCas());
+    EXPECT_LT(item1.getBySeqno(), item3.getBySeqno());
+
+    auto gv = store->get(item3.getKey(), vbid, cookie, {});
+    ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    EXPECT_EQ(item3.getCas(), gv.item->getCas());
+
+    // No document of the batch is stored in a replica
+    store->setVBucketState(vbid, vbucket_state_replica);
+    results = store->setMulti(vbid, items, cookie);
+    EXPECT_EQ(std::vector<ENGINE_ERROR_CODE>(3, ENGINE_NOT_MY_VBUCKET),
+              results);
+}
+
+TEST_P(KVBucketParamTest, UpdateInPlace) {
+    auto key = makeStoredDocKey("counter");
+    auto append = [](const item_info* existing, cb::UpdatedDocument& doc) {
+        if (existing == nullptr) {
+            doc.value = "1";
+            doc.flags = 0xcafe;
+        } else {
+            const auto* value =
+                    static_cast<const char*>(existing->value[0].iov_base);
+            doc.value.assign(value, existing->value[0].iov_len);
+            doc.value.append("1");
+        }
+        return cb::engine_errc::success;
+    };
+
+    // The document doesn't exist; the function creates it
+    auto gv = store->update(key, vbid, 0, append, cookie);
+    ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    EXPECT_EQ("1", gv.item->getValue()->to_s());
+    EXPECT_EQ(0xcafe, gv.item->getFlags());
+    const auto cas = gv.item->getCas();
+    EXPECT_NE(0, cas);
+
+    // An update with the wrong CAS fails
+    gv = store->update(key, vbid, cas + 1, append, cookie);
+    EXPECT_EQ(ENGINE_KEY_EEXISTS, gv.getStatus());
+
+    // The function is given the current document, which keeps its flags
+    gv = store->update(key, vbid, cas, append, cookie);
+    ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    EXPECT_EQ(0xcafe, gv.item->getFlags());
+    EXPECT_NE(cas, gv.item->getCas());
+
+    gv = store->get(key, vbid, cookie, {});
+    ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    EXPECT_EQ("11", gv.item->getValue()->to_s());
+
+    // The function's error is returned and nothing is stored
+    auto fail = [](const item_info*, cb::UpdatedDocument&) {
+        return cb::engine_errc::no_such_key;
+    };
+    EXPECT_EQ(ENGINE_KEY_ENOENT,
+              store->update(makeStoredDocKey("missing"), vbid, 0, fail, cookie)
+                      .getStatus());
+    EXPECT_EQ(ENGINE_KEY_ENOENT,
+              store->get(makeStoredDocKey("missing"), vbid, cookie, {})
+                      .getStatus());
+}
+
+TEST_P(KVBucketParamTest, Append) {
+    auto key = makeStoredDocKey("log");
+    auto append = [this, &key](const std::string& value, uint64_t cas = 0) {
+        return store->append(key, vbid, cas, value, cookie);
+    };
+
+    // Appending in place is disabled by default
+    store_item(vbid, key, "a", 0, {cb::engine_errc::success},
+               PROTOCOL_BINARY_RAW_BYTES);
+    EXPECT_EQ(ENGINE_ENOTSUP, append("b").getStatus());
+
+    engine->getConfiguration().setMaxBlobSegments(3);
+    EXPECT_EQ(ENGINE_KEY_ENOENT,
+              store->append(makeStoredDocKey("missing"),
+                            vbid,
+                            0,
+                            std::string("b"),
+                            cookie)
+                      .getStatus());
+
+    // The document returned has no value, but the CAS it was stored with
+    auto gv = append("b");
+    ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    EXPECT_FALSE(gv.item->getValue());
+    const auto cas = gv.item->getCas();
+    EXPECT_EQ(ENGINE_KEY_EEXISTS, append("c", cas + 1).getStatus());
+    ASSERT_EQ(ENGINE_SUCCESS, append("c", cas).getStatus());
+
+    // The value has as many segments as allowed, so the caller must copy it
+    EXPECT_EQ(ENGINE_ENOTSUP, append("d").getStatus());
+
+    // A read gets the whole value, and makes it contiguous
+    gv = store->get(key, vbid, cookie, {});
+    ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    EXPECT_EQ("abc", gv.item->getValue()->to_s());
+    EXPECT_EQ(PROTOCOL_BINARY_RAW_BYTES, gv.item->getDataType());
+    EXPECT_FALSE(gv.item->getValue()->isSegmented());
+    ASSERT_EQ(ENGINE_SUCCESS, append("d").getStatus());
+    gv = store->get(key, vbid, cookie, {});
+    ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    EXPECT_EQ("abcd", gv.item->getValue()->to_s());
+
+    // Appending whitespace to JSON keeps it JSON, anything else doesn't
+    store_item(vbid, key, R"({"a":1})");
+    ASSERT_EQ(ENGINE_SUCCESS, append(" \n").getStatus());
+    gv = store->get(key, vbid, cookie, {});
+    ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    EXPECT_EQ(PROTOCOL_BINARY_DATATYPE_JSON, gv.item->getDataType());
+    ASSERT_EQ(ENGINE_SUCCESS, append(",").getStatus());
+    gv = store->get(key, vbid, cookie, {});
+    ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    EXPECT_EQ(R"({"a":1} )"
+              "\n,",
+              gv.item->getValue()->to_s());
+    EXPECT_EQ(PROTOCOL_BINARY_RAW_BYTES, gv.item->getDataType());
+
+    // ... unless it's a number, which the data may carry on
+    store_item(vbid, key, "12");
+    EXPECT_EQ(ENGINE_ENOTSUP, append("3").getStatus());
+
+    // An empty value becomes JSON if the data appended is
+    store_item(vbid, key, "", 0, {cb::engine_errc::success},
+               PROTOCOL_BINARY_RAW_BYTES);
+    ASSERT_EQ(ENGINE_SUCCESS, append("[1]").getStatus());
+    gv = store->get(key, vbid, cookie, {});
+    ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    EXPECT_EQ("[1]", gv.item->getValue()->to_s());
+    EXPECT_EQ(PROTOCOL_BINARY_DATATYPE_JSON, gv.item->getDataType());
+
+    // A value which may become JSON must be validated in full
+    store_item(vbid, key, "[1", 0, {cb::engine_errc::success},
+               PROTOCOL_BINARY_RAW_BYTES);
+    EXPECT_EQ(ENGINE_ENOTSUP, append("]").getStatus());
+}
+
+TEST_P(KVBucketParamTest, HotKeyCache) {
+    engine->getConfiguration().setHotKeyCacheMinFreq(0);
+    engine->getConfiguration().setHotKeyCacheSize(16);
+    auto& cache = store->getHotKeyCache();
+    const auto options = static_cast<get_options_t>(
+            QUEUE_BG_FETCH | HONOR_STATES | TRACK_REFERENCE | HIDE_LOCKED_CAS);
+    auto key = makeStoredDocKey("hot");
+    store_item(vbid, key, "value1");
+
+    // The first read copies the document, the second one is served from
+    // the copy
+    auto gv = store->get(key, vbid, cookie, options);
+    ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    EXPECT_EQ(1, cache.getNumItems());
+    EXPECT_EQ(0, cache.getNumHits());
+    const auto cas = gv.item->getCas();
+    gv = store->get(key, vbid, cookie, options);
+    ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    EXPECT_EQ(1, cache.getNumHits());
+    EXPECT_EQ("value1", gv.item->getValue()->to_s());
+    EXPECT_EQ(cas, gv.item->getCas());
+
+    // A change of the document invalidates the copy
+    store_item(vbid, key, "value2");
+    gv = store->get(key, vbid, cookie, options);
+    ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    EXPECT_EQ(1, cache.getNumHits());
+    EXPECT_EQ("value2", gv.item->getValue()->to_s());
+
+    // ... as does locking it (which changes its CAS)
+    ASSERT_EQ(ENGINE_SUCCESS,
+              store->getLocked(key, vbid, ep_current_time(), 10, cookie)
+                      .getStatus());
+    gv = store->get(key, vbid, cookie, options);
+    ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    EXPECT_EQ(uint64_t(-1), gv.item->getCas());
+    EXPECT_EQ(1, cache.getNumHits());
+
+    // Disabling the cache drops the copies
+    engine->getConfiguration().setHotKeyCacheSize(0);
+    EXPECT_EQ(0, cache.getNumItems());
+}
+
 // MB-33702: Test that SetVBucket state creates a new failover table entry when
 // transitioning from non-active to active.
 TEST_P(KVBucketParamTest, FailoverEntryAddedNonActiveToActive) {
@@ -44,6 +44,9 @@
 #include <folly/portability/GMock.h>
 #include <folly/portability/GTest.h>
 #include <kvstore.h>
+#include <mcbp/protocol/request.h>
+#include <algorithm>
+#include <mutex>
 #include <thread>
 #include <unordered_map>
 #include <vector>
@@ -343,6 +346,126 @@ TEST_F(CouchKVStoreTest, CompactStatsTest) {
     EXPECT_GE(io_compaction_write_bytes, io_write_bytes);
 }
 
+// A compaction of a file below couchstore_compaction_min_fragmentation only
+// scans it: expired items are still notified, but nothing is written.
+TEST_F(CouchKVStoreTest, CompactBelowMinFragmentationDoesntRewrite) {
+    KVStoreConfig config(1, 4, data_dir, "couchdb", 0);
+    config.setCouchstoreCompactionMinFragmentation(100);
+    auto kvstore = setup_kv_store(config);
+
+    kvstore->begin(std::make_unique<TransactionContext>());
+    WriteCallback wc;
+    Item live(makeStoredDocKey("live"), 0, 0, "value", 5);
+    kvstore->set(live, wc);
+    Item expired(makeStoredDocKey("expired"), 0, 1 /*exptime*/, "value", 5);
+    kvstore->set(expired, wc);
+    EXPECT_TRUE(kvstore->commit(flush));
+
+    class CountingExpiryCallback : public Callback<Item&, time_t&> {
+    public:
+        void callback(Item& item, time_t&) override {
+            EXPECT_EQ(makeStoredDocKey("expired"), item.getKey());
+            ++expired;
+        }
+        int expired = 0;
+    };
+    auto expiry = std::make_shared<CountingExpiryCallback>();
+
+    CompactionConfig compactionConfig;
+    compactionConfig.db_file_id = Vbid(0);
+    compaction_ctx cctx(compactionConfig, 0);
+    cctx.expiryCallback = expiry;
+    EXPECT_TRUE(kvstore->compactDB(&cctx));
+    EXPECT_EQ(1, expiry->expired);
+
+    std::map<std::string, std::string> stats;
+    kvstore->addStats(add_stat_callback, &stats, "");
+    EXPECT_EQ("1", stats["rw_0:compaction_rewrites_skipped"]);
+    EXPECT_EQ("0", stats["rw_0:io_compaction_write_bytes"]);
+
+    // With the threshold disabled the file is rewritten again
+    config.setCouchstoreCompactionMinFragmentation(0);
+    EXPECT_TRUE(kvstore->compactDB(&cctx));
+    stats.clear();
+    kvstore->addStats(add_stat_callback, &stats, "");
+    EXPECT_EQ("1", stats["rw_0:compaction_rewrites_skipped"]);
+    EXPECT_NE("0", stats["rw_0:io_compaction_write_bytes"]);
+}
+
+// A saved bloom filter is only loaded while the data file (revision) and
+// the persisted seqno are the ones it was saved for.
+TEST_F(CouchKVStoreTest, SaveAndLoadBloomFilter) {
+    KVStoreConfig config(1024, 4, data_dir, "couchdb", 0);
+    auto kvstore = setup_kv_store(config);
+
+    BloomFilter filter(1000, 0.01, BFILTER_ENABLED);
+    const auto key = makeStoredDocKey("key");
+    filter.addKey(key);
+
+    EXPECT_FALSE(kvstore->loadBloomFilter(Vbid(0), 10));
+    ASSERT_TRUE(kvstore->saveBloomFilter(Vbid(0), 10, filter));
+
+    auto loaded = kvstore->loadBloomFilter(Vbid(0), 10);
+    ASSERT_TRUE(loaded);
+    EXPECT_EQ(BFILTER_ENABLED, loaded->getStatus());
+    EXPECT_TRUE(loaded->maybeKeyExists(key));
+    EXPECT_EQ(filter.getFilterSize(), loaded->getFilterSize());
+    EXPECT_EQ(1, loaded->getNumOfKeysInFilter());
+
+    // Written to since
+    EXPECT_FALSE(kvstore->loadBloomFilter(Vbid(0), 11));
+    // Or compacted (a new revision)
+    kvstore->incrementRevision(Vbid(0));
+    EXPECT_FALSE(kvstore->loadBloomFilter(Vbid(0), 10));
+}
+
+// A vBucket's data file snapshot (as a link) may be installed as another
+// vBucket, which then has the data of the snapshot.
+TEST_F(CouchKVStoreTest, LinkAndInstallVBucketFile) {
+    KVStoreConfig config(1024, 4, data_dir, "couchdb", 0);
+    auto kvstore = setup_kv_store(config);
+
+    kvstore->begin(std::make_unique<TransactionContext>());
+    WriteCallback wc;
+    for (const auto* key : {"key1", "key2"}) {
+        Item item(makeStoredDocKey(key), 0, 0, "value", 5);
+        kvstore->set(item, wc);
+    }
+    ASSERT_TRUE(kvstore->commit(flush));
+
+    const auto dir = data_dir + "/snapshot";
+    cb::io::mkdirp(dir);
+    const auto path = kvstore->linkVBucketFile(Vbid(0), dir);
+    ASSERT_FALSE(path.empty());
+    EXPECT_TRUE(cb::io::isFile(path));
+    // The directory must exist
+    EXPECT_TRUE(kvstore->linkVBucketFile(Vbid(0), data_dir + "/missing")
+                        .empty());
+
+    auto* state = kvstore->installVBucketFile(Vbid(1), path);
+    ASSERT_NE(nullptr, state);
+    EXPECT_EQ(2, state->highSeqno);
+    EXPECT_FALSE(cb::io::isFile(path));
+    EXPECT_EQ(2, kvstore->getItemCount(Vbid(1)));
+
+    auto gv = kvstore->get(DiskDocKey{makeStoredDocKey("key1")}, Vbid(1));
+    EXPECT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    // The snapshot vBucket still has its data
+    gv = kvstore->get(DiskDocKey{makeStoredDocKey("key2")}, Vbid(0));
+    EXPECT_EQ(ENGINE_SUCCESS, gv.getStatus());
+
+    // A file which isn't a data file is left where it is
+    const auto invalid = dir + "/invalid";
+    {
+        FILE* file = fopen(invalid.c_str(), "wb");
+        ASSERT_NE(nullptr, file);
+        fputs("not a couchstore file", file);
+        fclose(file);
+    }
+    EXPECT_EQ(nullptr, kvstore->installVBucketFile(Vbid(2), invalid));
+    EXPECT_TRUE(cb::io::isFile(invalid));
+}
+
 // Regression test for MB-17517 - ensure that if a couchstore file has a max
 // CAS of -1, it is detected and reset to zero when file is loaded.
 TEST_F(CouchKVStoreTest, MB_17517MaxCasOfMinus1) {
@@ -380,6 +503,208 @@ TEST_F(CouchKVStoreTest, MB_18580_ENOENT) {
     EXPECT_THROW(kvstore.ro->getDbFileInfo(Vbid(0)), std::system_error);
 }
 
+// The read-only store reuses its file handles for reads until the read-write
+// store commits.
+TEST_F(CouchKVStoreTest, FileHandleCache) {
+    KVStoreConfig config(1024, 4, data_dir, "couchdb", 0);
+    config.setCouchstoreFileHandleCacheSize(4);
+    auto kvstore = KVStoreFactory::create(config);
+    initialize_kv_store(kvstore.rw.get());
+
+    auto setValue = [&kvstore, this](const std::string& value) {
+        kvstore.rw->begin(std::make_unique<TransactionContext>());
+        Item item(makeStoredDocKey("key"), 0, 0, value.data(), value.size());
+        WriteCallback wc;
+        kvstore.rw->set(item, wc);
+        ASSERT_TRUE(kvstore.rw->commit(flush));
+    };
+    auto getValue = [&kvstore]() {
+        auto gv = kvstore.ro->get(DiskDocKey{makeStoredDocKey("key")}, Vbid(0));
+        EXPECT_EQ(ENGINE_SUCCESS, gv.getStatus());
+        return gv.item ? std::string(gv.item->getData(), gv.item->getNBytes())
+                       : std::string();
+    };
+    auto& roStats = kvstore.ro->getKVStoreStat();
+
+    setValue("value1");
+    EXPECT_EQ("value1", getValue());
+    EXPECT_EQ(0, roStats.numFileHandleCacheHits);
+    const auto opens = roStats.numOpen.load();
+    EXPECT_EQ("value1", getValue());
+    EXPECT_EQ(1, roStats.numFileHandleCacheHits);
+    EXPECT_EQ(opens, roStats.numOpen);
+
+    // The commit invalidates the cached handle, the new value is read
+    setValue("value2");
+    EXPECT_EQ("value2", getValue());
+    EXPECT_EQ(1, roStats.numFileHandleCacheHits);
+    EXPECT_EQ(opens + 1, roStats.numOpen);
+
+    // Disabled, each read opens the file
+    config.setCouchstoreFileHandleCacheSize(0);
+    EXPECT_EQ("value2", getValue());
+    EXPECT_EQ("value2", getValue());
+    EXPECT_EQ(1, roStats.numFileHandleCacheHits);
+    EXPECT_EQ(opens + 3, roStats.numOpen);
+}
+
+// A getAllKeys callback can end the scan by setting a non-success status
+TEST_F(CouchKVStoreTest, GetAllKeysEndedByCallback) {
+    KVStoreConfig config(1024, 4, data_dir, "couchdb", 0);
+    auto kvstore = setup_kv_store(config);
+
+    kvstore->begin(std::make_unique<TransactionContext>());
+    WriteCallback wc;
+    for (int i = 0; i < 5; i++) {
+        Item item(makeStoredDocKey("key" + std::to_string(i)), 0, 0, "v", 1);
+        kvstore->set(item, wc);
+    }
+    ASSERT_TRUE(kvstore->commit(flush));
+
+    std::vector<std::string> keys;
+    std::shared_ptr<CustomCallback<const DiskDocKey&>> cb;
+    cb = std::make_shared<CustomCallback<const DiskDocKey&>>(
+            [&keys, &cb](const DiskDocKey& key) {
+                if (key == makeDiskDocKey("key3")) {
+                    cb->setStatus(ENGINE_KEY_ENOENT);
+                    return;
+                }
+                keys.push_back(key.to_string());
+            });
+    EXPECT_EQ(ENGINE_SUCCESS,
+              kvstore->getAllKeys(Vbid(0), makeDiskDocKey("key1"), 10, cb));
+    EXPECT_EQ((std::vector<std::string>{
+                      DiskDocKey{makeStoredDocKey("key1")}.to_string(),
+                      DiskDocKey{makeStoredDocKey("key2")}.to_string()}),
+              keys);
+}
+
+TEST_F(CouchKVStoreTest, ScanRange) {
+    KVStoreConfig config(1024, 4, data_dir, "couchdb", 0);
+    auto kvstore = setup_kv_store(config);
+
+    kvstore->begin(std::make_unique<TransactionContext>());
+    WriteCallback wc;
+    DeleteCallback dc;
+    for (int i = 0; i < 5; i++) {
+        auto value = "value" + std::to_string(i);
+        Item item(makeStoredDocKey("key" + std::to_string(i)),
+                  0,
+                  0,
+                  value.data(),
+                  value.size());
+        kvstore->set(item, wc);
+    }
+    ASSERT_TRUE(kvstore->commit(flush));
+    kvstore->begin(std::make_unique<TransactionContext>());
+    Item deleted(makeStoredDocKey("key2"), 0, 0, "", 0);
+    deleted.setDeleted();
+    kvstore->del(deleted, dc);
+    ASSERT_TRUE(kvstore->commit(flush));
+
+    std::vector<std::string> docs;
+    auto cb = std::make_shared<CustomCallback<GetValue>>(
+            [&docs](GetValue gv) {
+                ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+                docs.push_back(
+                        gv.item->getKey().to_string() + "=" +
+                        std::string(gv.item->getData(), gv.item->getNBytes()));
+            });
+
+    // [key1, key4) without the deleted key2
+    EXPECT_EQ(ENGINE_SUCCESS,
+              kvstore->scanRange(Vbid(0),
+                                 makeDiskDocKey("key1"),
+                                 makeDiskDocKey("key4"),
+                                 ValueFilter::VALUES_DECOMPRESSED,
+                                 cb));
+    EXPECT_EQ((std::vector<std::string>{
+                      makeStoredDocKey("key1").to_string() + "=value1",
+                      makeStoredDocKey("key3").to_string() + "=value3"}),
+              docs);
+
+    // Keys only, to the end of the vBucket
+    std::vector<StoredDocKey> keys;
+    auto keysCb = std::make_shared<CustomCallback<GetValue>>(
+            [&keys](GetValue gv) { keys.push_back(gv.item->getKey()); });
+    EXPECT_EQ(ENGINE_SUCCESS,
+              kvstore->scanRange(Vbid(0),
+                                 makeDiskDocKey("key3"),
+                                 makeDiskDocKey("key9"),
+                                 ValueFilter::KEYS_ONLY,
+                                 keysCb));
+    EXPECT_EQ((std::vector<StoredDocKey>{makeStoredDocKey("key3"),
+                                         makeStoredDocKey("key4")}),
+              keys);
+}
+
+// A ByKey scan visits the latest version of the documents changed since its
+// start seqno in key order, and resumes after the last key read when paused.
+TEST_F(CouchKVStoreTest, ScanByKey) {
+    KVStoreConfig config(1024, 4, data_dir, "couchdb", 0);
+    auto kvstore = setup_kv_store(config);
+
+    kvstore->begin(std::make_unique<TransactionContext>());
+    WriteCallback wc;
+    // key4 is seqno 1 ... key0 seqno 5
+    for (int i = 4; i >= 0; i--) {
+        Item item(makeStoredDocKey("key" + std::to_string(i)),
+                  0,
+                  0,
+                  "value",
+                  5,
+                  PROTOCOL_BINARY_RAW_BYTES,
+                  0,
+                  5 - i);
+        kvstore->set(item, wc);
+    }
+    Item update(makeStoredDocKey("key1"),
+                0,
+                0,
+                "value",
+                5,
+                PROTOCOL_BINARY_RAW_BYTES,
+                0,
+                6);
+    kvstore->set(update, wc);
+    ASSERT_TRUE(kvstore->commit(flush));
+
+    std::vector<std::pair<std::string, int64_t>> docs;
+    bool pause = true;
+    std::shared_ptr<CustomCallback<GetValue>> cb;
+    cb = std::make_shared<CustomCallback<GetValue>>(
+            [&docs, &pause, &cb](GetValue gv) {
+                if (docs.size() == 1 && pause) {
+                    pause = false;
+                    cb->setStatus(ENGINE_ENOMEM);
+                    return;
+                }
+                cb->setStatus(ENGINE_SUCCESS);
+                docs.emplace_back(gv.item->getKey().to_string(),
+                                  gv.item->getBySeqno());
+            });
+    auto cl = std::make_shared<KVStoreTestCacheCallback>(3, 6, Vbid(0));
+    auto* scanCtx = kvstore->initScanContext(cb,
+                                             cl,
+                                             Vbid(0),
+                                             3,
+                                             DocumentFilter::ALL_ITEMS,
+                                             ValueFilter::VALUES_DECOMPRESSED);
+    ASSERT_NE(nullptr, scanCtx);
+    ASSERT_TRUE(kvstore->getStorageProperties().hasKeyOrderScan());
+    scanCtx->order = ScanOrder::ByKey;
+
+    EXPECT_EQ(scan_again, kvstore->scan(scanCtx));
+    EXPECT_EQ(scan_success, kvstore->scan(scanCtx));
+    kvstore->destroyScanContext(scanCtx);
+
+    EXPECT_EQ((std::vector<std::pair<std::string, int64_t>>{
+                      {makeStoredDocKey("key0").to_string(), 5},
+                      {makeStoredDocKey("key1").to_string(), 6},
+                      {makeStoredDocKey("key2").to_string(), 3}}),
+              docs);
+}
+
 class CollectionsOfflineUpgadeCallback : public StatusCallback<CacheLookup> {
 public:
     CollectionsOfflineUpgadeCallback(CollectionID cid) : expectedCid(cid) {
@@ -849,6 +1174,29 @@ TEST_F(CouchKVStoreErrorInjectionTest, getMulti_open_doc_with_docinfo) {
     EXPECT_EQ(ENGINE_TMPFAIL, itms[DiskDocKey{items.at(0)}].value.getStatus());
 }
 
+/**
+ * getMulti asks the OS to read ahead the bodies of the documents it's about
+ * to fetch (in the order they're in the file).
+ */
+TEST_F(CouchKVStoreErrorInjectionTest, getMulti_prefetch) {
+    populate_items(10);
+    vb_bgfetch_queue_t itms(make_bgfetch_queue());
+    {
+        /* Establish FileOps expectation */
+        EXPECT_CALL(ops, advise(_, _, _, _, _)).Times(AnyNumber());
+        EXPECT_CALL(ops, advise(_, _, _, _, COUCHSTORE_FILE_ADVICE_WILLNEED))
+                .Times(AtLeast(1));
+        kvstore->getMulti(Vbid(0), itms);
+    }
+    for (const auto& item : items) {
+        const auto& value = itms[DiskDocKey{item}].value;
+        EXPECT_EQ(ENGINE_SUCCESS, value.getStatus());
+        ASSERT_TRUE(value.item);
+        EXPECT_EQ(item.getKey(), value.item->getKey());
+        EXPECT_EQ(item.getNBytes(), value.item->getNBytes());
+    }
+}
+
 /**
  * Injects error during CouchKVStore::compactDB/couchstore_compact_db_ex
  */
@@ -880,6 +1228,140 @@ TEST_F(CouchKVStoreErrorInjectionTest, compactDB_compact_db_ex) {
     }
 }
 
+/**
+ * With couchstore_drop_behind compaction tells the OS it may drop the pages
+ * it has written (once synced) and read.
+ */
+TEST_F(CouchKVStoreErrorInjectionTest, compactDB_drop_behind) {
+    populate_items(1);
+    config.setCouchstoreDropBehind(true);
+
+    CompactionConfig compactionConfig;
+    compactionConfig.db_file_id = Vbid(0);
+    compaction_ctx cctx(compactionConfig, 0);
+    cctx.curr_time = 0;
+
+    {
+        /* Establish FileOps expectation */
+        EXPECT_CALL(ops, advise(_, _, _, _, _)).Times(AnyNumber());
+        EXPECT_CALL(ops, advise(_, _, _, _, COUCHSTORE_FILE_ADVICE_DONTNEED))
+                .Times(AtLeast(2));
+        EXPECT_TRUE(kvstore->compactDB(&cctx));
+    }
+}
+
+/**
+ * With couchstore_compaction_readahead_size compaction asks the OS to read
+ * ahead of what it reads from the file being compacted.
+ */
+TEST_F(CouchKVStoreErrorInjectionTest, compactDB_readahead) {
+    populate_items(1);
+    config.setCouchstoreCompactionReadaheadSize(1024 * 1024);
+
+    CompactionConfig compactionConfig;
+    compactionConfig.db_file_id = Vbid(0);
+    compaction_ctx cctx(compactionConfig, 0);
+    cctx.curr_time = 0;
+
+    {
+        /* Establish FileOps expectation */
+        EXPECT_CALL(ops, advise(_, _, _, _, _)).Times(AnyNumber());
+        EXPECT_CALL(ops,
+                    advise(_,
+                           _,
+                           _,
+                           1024 * 1024,
+                           COUCHSTORE_FILE_ADVICE_WILLNEED))
+                .Times(AtLeast(1));
+        EXPECT_TRUE(kvstore->compactDB(&cctx));
+    }
+}
+
+#ifdef __linux__
+/**
+ * Write-back is only a hint; with it enabled the files the flusher writes
+ * are still synced with the sync of the FileOps.
+ */
+TEST_F(CouchKVStoreErrorInjectionTest, commit_writeback) {
+    generate_items(1);
+    WriteCallback set_callback;
+    config.setCouchstoreWritebackSize(1);
+
+    kvstore->begin(std::make_unique<TransactionContext>());
+    kvstore->set(items.front(), set_callback);
+    {
+        EXPECT_CALL(ops, sync(_, _)).Times(AtLeast(1));
+        EXPECT_TRUE(kvstore->commit(flush));
+    }
+    config.setCouchstoreWritebackSize(0);
+}
+#endif
+
+/**
+ * In group commit mode the sync of the commit header is left for
+ * syncPendingCommits(), which retries it if it fails.
+ */
+TEST_F(CouchKVStoreErrorInjectionTest, group_commit_deferred_sync) {
+    generate_items(1);
+    WriteCallback set_callback;
+    ASSERT_TRUE(kvstore->setGroupCommit(true));
+
+    kvstore->begin(std::make_unique<TransactionContext>());
+    kvstore->set(items.front(), set_callback);
+    {
+        // The data is still synced before the header is written
+        EXPECT_CALL(ops, sync(_, _)).Times(AtLeast(1));
+        EXPECT_TRUE(kvstore->commit(flush));
+    }
+    {
+        /* Establish Logger expectation */
+        EXPECT_CALL(logger, mlog(_, _)).Times(AnyNumber());
+        EXPECT_CALL(logger,
+                    mlog(Ge(spdlog::level::level_enum::warn),
+                         VCE(COUCHSTORE_ERROR_WRITE)))
+                .Times(1)
+                .RetiresOnSaturation();
+
+        /* Establish FileOps expectation */
+        EXPECT_CALL(ops, sync(_, _)).Times(1).RetiresOnSaturation();
+        EXPECT_CALL(ops, sync(_, _))
+                .WillOnce(Return(COUCHSTORE_ERROR_WRITE))
+                .RetiresOnSaturation();
+
+        EXPECT_FALSE(kvstore->syncPendingCommits());
+        EXPECT_TRUE(kvstore->syncPendingCommits());
+    }
+    {
+        // Nothing left to sync
+        EXPECT_CALL(ops, sync(_, _)).Times(0);
+        EXPECT_TRUE(kvstore->syncPendingCommits());
+    }
+    kvstore->setGroupCommit(false);
+}
+
+TEST_F(CouchKVStoreErrorInjectionTest, group_commit_deferred_vbstate_sync) {
+    ASSERT_TRUE(kvstore->setGroupCommit(true));
+
+    vbucket_state state;
+    state.state = vbucket_state_replica;
+    {
+        EXPECT_CALL(ops, sync(_, _)).Times(AnyNumber());
+        EXPECT_TRUE(kvstore->snapshotVBucket(
+                Vbid(0), state, VBStatePersist::VBSTATE_PERSIST_WITH_COMMIT));
+    }
+    {
+        // The header of the snapshot is synced with the group
+        EXPECT_CALL(ops, sync(_, _)).Times(1);
+        EXPECT_TRUE(kvstore->syncPendingCommits());
+    }
+    {
+        // Nothing left to sync
+        EXPECT_CALL(ops, sync(_, _)).Times(0);
+        EXPECT_TRUE(kvstore->syncPendingCommits());
+    }
+    kvstore->setGroupCommit(false);
+}
+
 /**
  * Injects error during CouchKVStore::reset/couchstore_commit
  */
@@ -999,6 +1481,84 @@ TEST_F(CouchKVStoreErrorInjectionTest, recordDbDump_open_doc_with_docinfo) {
     kvstore->destroyScanContext(scan_context);
 }
 
+/**
+ * With backfill_readahead_size a scan asks the OS to read the file
+ * sequentially, and to read ahead of the bodies it reads.
+ */
+TEST_F(CouchKVStoreErrorInjectionTest, scan_readahead) {
+    populate_items(10);
+    config.setBackfillReadaheadSize(1024 * 1024);
+    auto cb(std::make_shared<CustomCallback<GetValue>>());
+    auto cl(std::make_shared<CustomCallback<CacheLookup>>());
+
+    ScanContext* scan_context;
+    {
+        /* Establish FileOps expectation */
+        EXPECT_CALL(ops, advise(_, _, _, _, _)).Times(AnyNumber());
+        EXPECT_CALL(ops,
+                    advise(_, _, _, _, COUCHSTORE_FILE_ADVICE_SEQUENTIAL))
+                .Times(1);
+        scan_context =
+                kvstore->initScanContext(cb,
+                                         cl,
+                                         Vbid(0),
+                                         0,
+                                         DocumentFilter::ALL_ITEMS,
+                                         ValueFilter::VALUES_DECOMPRESSED);
+        ASSERT_NE(nullptr, scan_context);
+    }
+    {
+        /* Establish FileOps expectation */
+        EXPECT_CALL(ops, advise(_, _, _, _, _)).Times(AnyNumber());
+        EXPECT_CALL(ops,
+                    advise(_,
+                           _,
+                           _,
+                           1024 * 1024,
+                           COUCHSTORE_FILE_ADVICE_WILLNEED))
+                .Times(AtLeast(1));
+        EXPECT_EQ(scan_success, kvstore->scan(scan_context));
+    }
+
+    kvstore->destroyScanContext(scan_context);
+    config.setBackfillReadaheadSize(0);
+}
+
+/**
+ * A scan which only reads the keys doesn't ask for any read ahead.
+ */
+TEST_F(CouchKVStoreErrorInjectionTest, scan_readahead_keys_only) {
+    populate_items(10);
+    config.setBackfillReadaheadSize(1024 * 1024);
+    auto cb(std::make_shared<CustomCallback<GetValue>>());
+    auto cl(std::make_shared<CustomCallback<CacheLookup>>());
+    {
+        /* Establish FileOps expectation */
+        EXPECT_CALL(ops, advise(_, _, _, _, _)).Times(AnyNumber());
+        EXPECT_CALL(ops,
+                    advise(_, _, _, _, COUCHSTORE_FILE_ADVICE_SEQUENTIAL))
+                .Times(0);
+        EXPECT_CALL(ops,
+                    advise(_,
+                           _,
+                           _,
+                           1024 * 1024,
+                           COUCHSTORE_FILE_ADVICE_WILLNEED))
+                .Times(0);
+        auto* scan_context =
+                kvstore->initScanContext(cb,
+                                         cl,
+                                         Vbid(0),
+                                         0,
+                                         DocumentFilter::ALL_ITEMS,
+                                         ValueFilter::KEYS_ONLY);
+        ASSERT_NE(nullptr, scan_context);
+        EXPECT_EQ(scan_success, kvstore->scan(scan_context));
+        kvstore->destroyScanContext(scan_context);
+    }
+    config.setBackfillReadaheadSize(0);
+}
+
 /**
  * Injects error during CouchKVStore::rollback/couchstore_changes_count/1
  */
@@ -2240,6 +2800,60 @@ TEST_P(KVStoreParamTest, TestDataStoredInTheRightVBucket) {
     checkGetValue(gv, ENGINE_KEY_ENOENT);
 }
 
+// getMultiParallel retrieves the items of each vBucket and calls back once
+// per vBucket.
+TEST_P(KVStoreParamTest, GetMultiParallel) {
+    WriteCallback wc;
+    std::string value = "value";
+    std::vector<Vbid> vbids = {Vbid(0), Vbid(1), Vbid(2), Vbid(3)};
+    uint64_t seqno = 1000;
+
+    if (kvstoreConfig->getBackend() == "rocksdb") {
+        kvstore.reset();
+    }
+    kvstore = setup_kv_store(*kvstoreConfig, vbids);
+
+    std::vector<std::pair<Vbid, vb_bgfetch_queue_t>> fetches;
+    for (auto vbid : vbids) {
+        kvstore->begin(std::make_unique<TransactionContext>());
+        Item item(makeStoredDocKey("key-" + std::to_string(vbid.get())),
+                  0 /*flags*/,
+                  0 /*exptime*/,
+                  value.c_str(),
+                  value.size(),
+                  PROTOCOL_BINARY_RAW_BYTES,
+                  0 /*cas*/,
+                  seqno++ /*bySeqno*/,
+                  vbid);
+        kvstore->set(item, wc);
+        kvstore->commit(flush);
+
+        vb_bgfetch_queue_t itms;
+        itms[DiskDocKey{item}].isMetaOnly = GetMetaOnly::No;
+        // And a key which is in another vBucket
+        itms[makeDiskDocKey("key-" + std::to_string(vbid.get() + 1))]
+                .isMetaOnly = GetMetaOnly::No;
+        fetches.emplace_back(vbid, std::move(itms));
+    }
+
+    std::mutex mutex;
+    std::vector<Vbid> done;
+    kvstore->getMultiParallel(
+            fetches, [&mutex, &done](Vbid vbid, vb_bgfetch_queue_t& itms) {
+                std::lock_guard<std::mutex> lh(mutex);
+                done.push_back(vbid);
+                auto& found = itms.at(makeDiskDocKey(
+                        "key-" + std::to_string(vbid.get())));
+                checkGetValue(found.value);
+                auto& notFound = itms.at(makeDiskDocKey(
+                        "key-" + std::to_string(vbid.get() + 1)));
+                checkGetValue(notFound.value, ENGINE_KEY_ENOENT);
+            });
+
+    std::sort(done.begin(), done.end());
+    EXPECT_EQ(vbids, done);
+}
+
 // Verify thread-safeness for 'delVBucket' concurrent operations.
 // Expect ThreadSanitizer to pick this.
 TEST_P(KVStoreParamTest, DelVBucketConcurrentOperationsTest) {
@@ -2595,6 +3209,137 @@ TEST_F(RocksDBKVStoreTest, StatisticsOptionWrongValueTest) {
     // Re-open with the new configuration
     kvstore = setup_kv_store(*kvstoreConfig);
 }
+
+// getMulti looks all of the keys of the fetch queue up with one MultiGet
+TEST_F(RocksDBKVStoreTest, GetMultiUsesOneMultiGet) {
+    Configuration config;
+    config.setDbname(data_dir);
+    config.setBackend("rocksdb");
+    // Note: we need to switch-on DB Statistics
+    config.setRocksdbStatsLevel("kAll");
+    kvstoreConfig =
+            std::make_unique<RocksDBKVStoreConfig>(config, 0 /*shardId*/);
+    kvstore.reset();
+    kvstore = setup_kv_store(*kvstoreConfig);
+
+    WriteCallback wc;
+    kvstore->begin(std::make_unique<TransactionContext>());
+    const std::string value = "value";
+    const std::vector<std::string> keys = {"key-0", "key-1", "key-2"};
+    uint64_t seqno = 1;
+    for (const auto& key : keys) {
+        Item item(makeStoredDocKey(key),
+                  0 /*flags*/,
+                  0 /*exptime*/,
+                  value.c_str(),
+                  value.size(),
+                  PROTOCOL_BINARY_RAW_BYTES,
+                  0 /*cas*/,
+                  seqno++ /*bySeqno*/,
+                  Vbid(0));
+        kvstore->set(item, wc);
+    }
+    EXPECT_TRUE(kvstore->commit(flush));
+
+    vb_bgfetch_queue_t itms;
+    for (const auto& key : keys) {
+        itms[makeDiskDocKey(key)].isMetaOnly = GetMetaOnly::No;
+    }
+    itms[makeDiskDocKey("missing")].isMetaOnly = GetMetaOnly::No;
+
+    size_t calls;
+    size_t keysRead;
+    ASSERT_TRUE(kvstore->getStat("rocksdb.number.multiget.get", calls));
+    ASSERT_TRUE(
+            kvstore->getStat("rocksdb.number.multiget.keys.read", keysRead));
+
+    kvstore->getMulti(Vbid(0), itms);
+    for (const auto& key : keys) {
+        checkGetValue(itms.at(makeDiskDocKey(key)).value);
+    }
+    checkGetValue(itms.at(makeDiskDocKey("missing")).value, ENGINE_KEY_ENOENT);
+
+    size_t count;
+    ASSERT_TRUE(kvstore->getStat("rocksdb.number.multiget.get", count));
+    EXPECT_EQ(calls + 1, count);
+    // The missing key is looked up (and isn't found) in the same call
+    ASSERT_TRUE(kvstore->getStat("rocksdb.number.multiget.keys.read", count));
+    EXPECT_EQ(keysRead + itms.size(), count);
+}
+
+// With rocksdb_expiry_compaction_filter, compacting a vBucket passes its
+// expired documents to the expiry callback (so the deletions are queued)
+TEST_F(RocksDBKVStoreTest, CompactionExpiresDocuments) {
+    Configuration config;
+    config.setDbname(data_dir);
+    config.setBackend("rocksdb");
+    config.setRocksdbExpiryCompactionFilter(true);
+    kvstoreConfig =
+            std::make_unique<RocksDBKVStoreConfig>(config, 0 /*shardId*/);
+    kvstore.reset();
+    kvstore = setup_kv_store(*kvstoreConfig, {Vbid(0), Vbid(1)});
+
+    const std::string value = "value";
+    uint64_t seqno = 1;
+    auto makeTestItem = [&value, &seqno](Vbid vbid,
+                                         const std::string& key,
+                                         uint32_t exptime) {
+        return Item(makeStoredDocKey(key),
+                    0 /*flags*/,
+                    exptime,
+                    value.c_str(),
+                    value.size(),
+                    PROTOCOL_BINARY_RAW_BYTES,
+                    0 /*cas*/,
+                    seqno++ /*bySeqno*/,
+                    vbid);
+    };
+
+    WriteCallback wc;
+    DeleteCallback dc;
+    kvstore->begin(std::make_unique<TransactionContext>());
+    kvstore->set(makeTestItem(Vbid(0), "live", 0), wc);
+    kvstore->set(makeTestItem(Vbid(0), "expired", 1), wc);
+    auto tombstone = makeTestItem(Vbid(0), "tombstone", 1);
+    tombstone.setDeleted();
+    kvstore->del(tombstone, dc);
+    EXPECT_TRUE(kvstore->commit(flush));
+    kvstore->begin(std::make_unique<TransactionContext>());
+    kvstore->set(makeTestItem(Vbid(1), "expired-vb1", 1), wc);
+    EXPECT_TRUE(kvstore->commit(flush));
+
+    class CollectingExpiryCallback : public Callback<Item&, time_t&> {
+    public:
+        void callback(Item& item, time_t&) override {
+            EXPECT_EQ(std::string("value"),
+                      std::string(item.getData(), item.getNBytes()));
+            expired.emplace_back(item.getVBucketId(), item.getKey());
+        }
+        std::vector<std::pair<Vbid, StoredDocKey>> expired;
+    };
+    auto expiry = std::make_shared<CollectingExpiryCallback>();
+
+    // CompactDb compacts the vBucket of the request
+    cb::mcbp::Request req = {};
+    req.setVBucket(Vbid(1));
+    EXPECT_EQ(Vbid(1), kvstore->getDBFileId(req));
+
+    CompactionConfig compactionConfig;
+    compactionConfig.db_file_id = Vbid(0);
+    compaction_ctx cctx(compactionConfig, 0);
+    cctx.expiryCallback = expiry;
+    EXPECT_TRUE(kvstore->compactDB(&cctx));
+    ASSERT_EQ(1, expiry->expired.size());
+    EXPECT_EQ(Vbid(0), expiry->expired[0].first);
+    EXPECT_EQ(makeStoredDocKey("expired"), expiry->expired[0].second);
+
+    expiry->expired.clear();
+    cctx.compactConfig.db_file_id = Vbid(1);
+    EXPECT_TRUE(kvstore->compactDB(&cctx));
+    ASSERT_EQ(1, expiry->expired.size());
+    EXPECT_EQ(Vbid(1), expiry->expired[0].first);
+    EXPECT_EQ(makeStoredDocKey("expired-vb1"), expiry->expired[0].second);
+}
 #endif
 
 #ifdef EP_USE_MAGMA
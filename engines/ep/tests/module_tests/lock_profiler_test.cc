@@ -0,0 +1,103 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "lock_profiler.h"
+
+#include <folly/portability/GTest.h>
+
+#include <map>
+#include <thread>
+
+class LockProfilerTest : public ::testing::Test {
+protected:
+    std::map<std::string, std::string> getStats() {
+        std::map<std::string, std::string> stats;
+        profiler.addStats(
+                [&stats](const char* key,
+                         const uint16_t klen,
+                         const char* val,
+                         const uint32_t vlen,
+                         gsl::not_null<const void*>) {
+                    stats[std::string(key, klen)] = std::string(val, vlen);
+                },
+                this);
+        return stats;
+    }
+
+    LockProfile& profile() {
+        return profiler.get(LockProfiler::Lock::HashTable);
+    }
+
+    LockProfiler profiler;
+    std::mutex mutex;
+};
+
+// Nothing is recorded while profiling is disabled.
+TEST_F(LockProfilerTest, Disabled) {
+    { ProfiledLockHolder lh(mutex, profile()); }
+    auto stats = getStats();
+    EXPECT_EQ("false", stats.at("enabled"));
+    EXPECT_EQ("0", stats.at("hash_table:acquisitions"));
+    EXPECT_EQ(0, stats.count("hash_table:held_mean"));
+}
+
+// An uncontended acquisition is counted and its hold time recorded, but
+// not as a wait.
+TEST_F(LockProfilerTest, Uncontended) {
+    profiler.setEnabled(true);
+    { ProfiledLockHolder lh(mutex, profile()); }
+    auto stats = getStats();
+    EXPECT_EQ("1", stats.at("hash_table:acquisitions"));
+    EXPECT_EQ("0", stats.at("hash_table:contended"));
+    EXPECT_EQ(1, stats.count("hash_table:held_mean"));
+    EXPECT_EQ(0, stats.count("hash_table:wait_mean"));
+}
+
+// A contended acquisition records the wait against the calling function.
+TEST_F(LockProfilerTest, Contended) {
+    profiler.setEnabled(true);
+    std::unique_lock<std::mutex> holder(mutex);
+    std::thread waiter([this]() {
+        ProfiledLockHolder lh(mutex, profile(), "waiter");
+    });
+    // Wait for the waiter to be blocked on the mutex (try_lock failed and
+    // it counted the acquisition) before releasing it.
+    while (getStats().at("hash_table:acquisitions") != "1") {
+        std::this_thread::yield();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    holder.unlock();
+    waiter.join();
+
+    auto stats = getStats();
+    EXPECT_EQ("1", stats.at("hash_table:contended"));
+    EXPECT_EQ(1, stats.count("hash_table:wait_mean"));
+    EXPECT_EQ("1", stats.at("hash_table:site:waiter:contended"));
+    EXPECT_EQ(1, stats.count("hash_table:site:waiter:wait_us"));
+
+    profiler.reset();
+    stats = getStats();
+    EXPECT_EQ("0", stats.at("hash_table:contended"));
+    EXPECT_EQ(0, stats.count("hash_table:site:waiter:contended"));
+}
+
+// The ProfiledLockHolder can be passed where a LockHolder is expected.
+TEST_F(LockProfilerTest, ConvertsToLockHolder) {
+    auto takesLockHolder = [](const LockHolder&) { return true; };
+    ProfiledLockHolder lh(mutex, profile());
+    EXPECT_TRUE(takesLockHolder(lh));
+}
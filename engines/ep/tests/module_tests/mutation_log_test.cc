@@ -74,6 +74,12 @@ protected:
         }
     }
 
+    static off_t getFileSize(const std::string& filename) {
+        struct stat st;
+        EXPECT_EQ(0, stat(filename.c_str(), &st));
+        return st.st_size;
+    }
+
     // Storage for temporary log filename
     std::string tmp_log_filename;
 };
@@ -482,6 +488,261 @@ TEST_F(MutationLogTest, BatchLoad) {
     }
 }
 
+// Test that the evicted entries appended by an incremental access scan
+// remove the keys logged before them, both when loading the whole log and
+// a batch.
+TEST_F(MutationLogTest, EvictedItems) {
+    {
+        MutationLog ml(tmp_log_filename.c_str());
+        ml.open();
+        ml.newItem(Vbid(0), makeStoredDocKey("key1"));
+        ml.newItem(Vbid(0), makeStoredDocKey("key2"));
+        ml.commit1();
+        ml.commit2();
+    }
+
+    {
+        // Reopening appends to the log
+        MutationLog ml(tmp_log_filename.c_str());
+        ml.open();
+        ml.evictedItem(Vbid(0), makeStoredDocKey("key1"));
+        ml.newItem(Vbid(0), makeStoredDocKey("key3"));
+        ml.commit1();
+        ml.commit2();
+        EXPECT_EQ(1, ml.itemsLogged[int(MutationLogType::Evicted)]);
+    }
+
+    {
+        MutationLog ml(tmp_log_filename.c_str());
+        ml.open();
+        MutationLogHarvester h(ml);
+        h.setVBucket(Vbid(0));
+        EXPECT_TRUE(h.load());
+        EXPECT_EQ(3, h.getItemsSeen()[int(MutationLogType::New)]);
+        EXPECT_EQ(1, h.getItemsSeen()[int(MutationLogType::Evicted)]);
+
+        std::set<StoredDocKey> maps[1];
+        h.apply(&maps, loaderFun);
+        EXPECT_EQ(2, maps[0].size());
+        EXPECT_EQ(maps[0].end(), maps[0].find(makeStoredDocKey("key1")));
+    }
+
+    {
+        MutationLog ml(tmp_log_filename.c_str());
+        ml.open();
+        MutationLogHarvester h(ml);
+        h.setVBucket(Vbid(0));
+        EXPECT_EQ(ml.end(), h.loadBatch(ml.begin(), 0));
+
+        std::set<StoredDocKey> maps[1];
+        h.apply(&maps, loaderFun);
+        EXPECT_EQ(2, maps[0].size());
+        EXPECT_EQ(maps[0].end(), maps[0].find(makeStoredDocKey("key1")));
+    }
+}
+
+// Test that the log may be read as separate block ranges, with and without
+// memory mapping it.
+TEST_F(MutationLogTest, BlockRanges) {
+    const size_t numItems = 1000;
+    {
+        MutationLog ml(tmp_log_filename.c_str());
+        ml.open();
+        for (size_t ii = 0; ii < numItems; ii++) {
+            ml.newItem(Vbid(0), makeStoredDocKey("key" + std::to_string(ii)));
+        }
+        ml.commit1();
+        ml.commit2();
+    }
+
+    for (const bool mapped : {false, true}) {
+        MutationLog ml(tmp_log_filename.c_str());
+        ml.open(true);
+        if (mapped) {
+            ASSERT_TRUE(ml.mapForReading());
+        }
+        const auto numBlocks = ml.getNumBlocks();
+        ASSERT_GT(numBlocks, 3);
+
+        std::set<StoredDocKey> keys;
+        size_t entries = 0;
+        const size_t blocksPerRange = numBlocks / 3 + 1;
+        for (size_t first = 0; first < numBlocks; first += blocksPerRange) {
+            const auto last = std::min(numBlocks, first + blocksPerRange);
+            for (auto it = ml.begin(first, last); it != ml.end(); ++it) {
+                ++entries;
+                if ((*it)->type() == MutationLogType::New) {
+                    keys.emplace((*it)->key());
+                }
+            }
+        }
+        EXPECT_EQ(numItems + 2, entries);
+        EXPECT_EQ(numItems, keys.size());
+
+        // An empty range is at the end
+        EXPECT_EQ(ml.end(), ml.begin(numBlocks, numBlocks));
+    }
+}
+
+// Test that a V4 log is read back like a V3 one, is appended to in its own
+// format and is smaller than the V3 log of the same keys.
+TEST_F(MutationLogTest, V4Logging) {
+    const size_t numItems = 1000;
+    const auto v3Filename = tmp_log_filename + ".v3";
+    for (const auto version : {MutationLogVersion::V3, MutationLogVersion::V4}) {
+        MutationLog ml(version == MutationLogVersion::V4 ? tmp_log_filename
+                                                         : v3Filename,
+                       MIN_LOG_HEADER_SIZE,
+                       version);
+        ml.open();
+        for (size_t ii = 0; ii < numItems; ii++) {
+            ml.newItem(Vbid(ii % 4),
+                       makeStoredDocKey("user::profile::" + std::to_string(ii)));
+        }
+        ml.evictedItem(Vbid(1), makeStoredDocKey("user::profile::1"));
+        ml.commit1();
+        ml.commit2();
+    }
+    EXPECT_LT(getFileSize(tmp_log_filename) * 2, getFileSize(v3Filename));
+    cb::io::rmrf(v3Filename);
+
+    // Appending to the log (when asked for V3) keeps it V4
+    {
+        MutationLog ml(tmp_log_filename.c_str());
+        ml.open();
+        EXPECT_EQ(MutationLogVersion::V4, ml.header().version());
+        ml.newItem(Vbid(2), makeStoredDocKey("key"));
+        ml.commit1();
+        ml.commit2();
+    }
+
+    MutationLog ml(tmp_log_filename.c_str());
+    ml.open(true);
+    EXPECT_EQ(MutationLogVersion::V4, ml.header().version());
+    MutationLogHarvester h(ml);
+    for (uint16_t vb = 0; vb < 4; ++vb) {
+        h.setVBucket(Vbid(vb));
+    }
+    EXPECT_TRUE(h.load());
+    EXPECT_EQ(numItems + 1, h.getItemsSeen()[int(MutationLogType::New)]);
+    EXPECT_EQ(1, h.getItemsSeen()[int(MutationLogType::Evicted)]);
+    EXPECT_EQ(2, h.getItemsSeen()[int(MutationLogType::Commit2)]);
+
+    std::set<StoredDocKey> maps[4];
+    h.apply(&maps, loaderFun);
+    EXPECT_EQ(numItems / 4, maps[0].size());
+    EXPECT_EQ(numItems / 4 - 1, maps[1].size());
+    EXPECT_EQ(numItems / 4 + 1, maps[2].size());
+    EXPECT_NE(maps[0].end(), maps[0].find(makeStoredDocKey("user::profile::0")));
+    EXPECT_EQ(maps[1].end(), maps[1].find(makeStoredDocKey("user::profile::1")));
+    EXPECT_NE(maps[2].end(), maps[2].find(makeStoredDocKey("key")));
+}
+
+// Test that the blocks of a V4 log may be read as separate ranges, and that
+// the blocks of the other vbuckets are skipped.
+TEST_F(MutationLogTest, V4BlockRanges) {
+    const size_t numItems = 1000;
+    {
+        // Small blocks, so each vbucket has a few of them
+        MutationLog ml(tmp_log_filename, 1024, MutationLogVersion::V4);
+        ml.open();
+        for (uint16_t vb = 0; vb < 2; ++vb) {
+            for (size_t ii = 0; ii < numItems; ii++) {
+                ml.newItem(Vbid(vb),
+                           makeStoredDocKey("key" + std::to_string(ii)));
+            }
+            ml.commit1();
+            ml.commit2();
+        }
+    }
+
+    for (const bool mapped : {false, true}) {
+        MutationLog ml(tmp_log_filename.c_str());
+        ml.open(true);
+        if (mapped) {
+            ASSERT_TRUE(ml.mapForReading());
+        }
+        const auto numBlocks = ml.getNumBlocks();
+        ASSERT_GT(numBlocks, 3);
+
+        const std::set<Vbid> vbuckets{Vbid(1)};
+        std::set<StoredDocKey> keys;
+        size_t entries = 0;
+        const size_t blocksPerRange = numBlocks / 3 + 1;
+        for (size_t first = 0; first < numBlocks; first += blocksPerRange) {
+            const auto last = std::min(numBlocks, first + blocksPerRange);
+            for (auto it = ml.begin(first, last); it != ml.end(); ++it) {
+                ++entries;
+            }
+            for (auto it = ml.begin(first, last, &vbuckets); it != ml.end();
+                 ++it) {
+                if ((*it)->type() == MutationLogType::New) {
+                    EXPECT_EQ(Vbid(1), (*it)->vbucket());
+                    keys.emplace((*it)->key());
+                }
+            }
+        }
+        EXPECT_EQ(2 * (numItems + 2), entries);
+        EXPECT_EQ(numItems, keys.size());
+
+        // An empty range is at the end
+        EXPECT_EQ(ml.end(), ml.begin(numBlocks, numBlocks));
+    }
+}
+
+// Test that a corrupted V4 block fails its CRC check, and that a partially
+// written block is dropped (and written over by the next block).
+TEST_F(MutationLogTest, V4Corruption) {
+    {
+        MutationLog ml(
+                tmp_log_filename, MIN_LOG_HEADER_SIZE, MutationLogVersion::V4);
+        ml.open();
+        ml.newItem(Vbid(2), makeStoredDocKey("key1"));
+        ml.commit1();
+        ml.commit2();
+    }
+    const auto size = getFileSize(tmp_log_filename);
+
+    // A partially written block
+    EXPECT_EQ(0, truncate(tmp_log_filename.c_str(), size - 1));
+    {
+        MutationLog ml(tmp_log_filename.c_str());
+        ml.open();
+        EXPECT_EQ(0, ml.getNumBlocks());
+        ml.newItem(Vbid(3), makeStoredDocKey("key2"));
+        ml.commit1();
+        ml.commit2();
+    }
+    {
+        MutationLog ml(tmp_log_filename.c_str());
+        ml.open();
+        ASSERT_EQ(1, ml.getNumBlocks());
+        MutationLogHarvester h(ml);
+        h.setVBucket(Vbid(3));
+        EXPECT_TRUE(h.load());
+        EXPECT_EQ(1, h.getItemsSeen()[int(MutationLogType::New)]);
+    }
+
+    // Break the compressed data of the block
+    int file = open(tmp_log_filename.c_str(),
+                    O_RDWR,
+                    FilePerms::Read | FilePerms::Write);
+    const off_t offset = MIN_LOG_HEADER_SIZE + sizeof(LogBlockHeaderV4);
+    EXPECT_EQ(offset, lseek(file, offset, SEEK_SET));
+    uint8_t b;
+    EXPECT_EQ(1, read(file, &b, sizeof(b)));
+    EXPECT_EQ(offset, lseek(file, offset, SEEK_SET));
+    b = ~b;
+    EXPECT_EQ(1, write(file, &b, sizeof(b)));
+    close(file);
+
+    MutationLog ml(tmp_log_filename.c_str());
+    ml.open();
+    MutationLogHarvester h(ml);
+    h.setVBucket(Vbid(3));
+    EXPECT_THROW(h.load(), MutationLog::CRCReadException);
+}
+
 // @todo
 //   Test Read Only log
 //   Test close / open / close / open
@@ -32,6 +32,8 @@
 #include <programs/engine_testapp/mock_server.h>
 #include <spdlog/async.h>
 
+#include <vector>
+
 class ObjectRegistryTest : virtual public ::testing::Test {
 protected:
     void SetUp() override {
@@ -74,6 +76,106 @@ TEST_F(ObjectRegistryTest, MemOverhead) {
     EXPECT_EQ(baseline, engine->getEpStats().getMemOverhead());
 }
 
+// Check that the memory accounted through ObjectRegistry::memoryAllocated is
+// held by the thread until its limit is exceeded, it switches engine or it
+// reads the precise memory used.
+TEST_F(ObjectRegistryTest, MemoryDeltaBatchedPerThread) {
+    auto& stats = engine->getEpStats();
+    stats.memoryTrackerEnabled.store(true);
+    ObjectRegistry::onSwitchThread(engine.get());
+
+    // The memory added to the core local counters and the estimate (i.e.
+    // excluding the allocations pending on the thread)
+    auto getTrackedMemory = [&stats]() {
+        int64_t total = stats.estimatedTotalMemory->load();
+        for (const auto& core : stats.coreLocal) {
+            total += core->totalMemory.load();
+        }
+        return total;
+    };
+
+    const auto limit = stats.getThreadMemoryDeltaLimit();
+    ASSERT_GT(limit, 0);
+    stats.getPreciseTotalMemoryUsed();
+    const auto tracked = getTrackedMemory();
+
+    ObjectRegistry::memoryAllocated(1);
+    EXPECT_EQ(tracked, getTrackedMemory());
+    stats.getPreciseTotalMemoryUsed();
+    EXPECT_EQ(tracked + 1, getTrackedMemory());
+
+    // Exceeding the limit adds the allocations to the stats
+    ObjectRegistry::memoryAllocated(limit + 1);
+    EXPECT_EQ(tracked + limit + 2, getTrackedMemory());
+
+    // As does switching to another engine
+    ObjectRegistry::memoryDeallocated(2);
+    EXPECT_EQ(tracked + limit + 2, getTrackedMemory());
+    ObjectRegistry::onSwitchThread(nullptr);
+    EXPECT_EQ(tracked + limit, getTrackedMemory());
+}
+
+#if defined(HAVE_JEMALLOC)
+// Check that the memory a thread allocates while switched to an engine with a
+// BucketArena comes from (and is reported by) that arena.
+TEST_F(ObjectRegistryTest, BucketArena) {
+    auto& hooks = *get_mock_server_api()->alloc_hooks;
+    ObjectRegistry::initialize(hooks.get_allocation_size,
+                               hooks.set_thread_arena);
+    ASSERT_TRUE(engine->public_createArena());
+    ObjectRegistry::onSwitchThread(engine.get());
+
+    allocator_stats stats = {};
+    ASSERT_TRUE(engine->getArena().getStats(stats));
+    const auto before = stats.allocated_size;
+
+    // Large enough not to be served from the thread cache
+    const size_t size = 4 * 1024 * 1024;
+    std::unique_ptr<char[]> block(new char[size]);
+    ASSERT_TRUE(engine->getArena().getStats(stats));
+    EXPECT_LE(before + size, stats.allocated_size);
+
+    // The allocations made outside of the engine use the default arena
+    {
+        NonBucketAllocationGuard guard;
+        std::unique_ptr<char[]> other(new char[size]);
+        ASSERT_TRUE(engine->getArena().getStats(stats));
+        EXPECT_GT(before + 2 * size, stats.allocated_size);
+    }
+
+    block.reset();
+    ObjectRegistry::onSwitchThread(nullptr);
+    ObjectRegistry::reset();
+}
+
+#if defined(__linux__)
+// Check that an arena backed by huge pages can be allocated from.
+TEST_F(ObjectRegistryTest, BucketArenaHugePages) {
+    auto& hooks = *get_mock_server_api()->alloc_hooks;
+    ObjectRegistry::initialize(hooks.get_allocation_size,
+                               hooks.set_thread_arena);
+    ASSERT_TRUE(engine->public_createArena(/*hugePages*/ true));
+    ObjectRegistry::onSwitchThread(engine.get());
+
+    allocator_stats stats = {};
+    ASSERT_TRUE(engine->getArena().getStats(stats));
+    const auto before = stats.allocated_size;
+
+    // Many small allocations, as the StoredValues of a hash table
+    std::vector<std::unique_ptr<char[]>> blocks;
+    for (int ii = 0; ii < 10000; ++ii) {
+        blocks.emplace_back(new char[64]);
+    }
+    ASSERT_TRUE(engine->getArena().getStats(stats));
+    EXPECT_LT(before, stats.allocated_size);
+
+    blocks.clear();
+    ObjectRegistry::onSwitchThread(nullptr);
+    ObjectRegistry::reset();
+}
+#endif
+#endif
+
 /**
  * Test fixture for ObjectRegistry + BucketLogger tests.
  *
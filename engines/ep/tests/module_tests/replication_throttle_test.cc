@@ -0,0 +1,65 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Unit tests for the ReplicationThrottle
+ */
+
+#include "configuration.h"
+#include "replicationthrottle.h"
+#include "stats.h"
+
+#include <folly/portability/GTest.h>
+
+class ReplicationThrottleTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        // Enough memory for it to play no part
+        stats.setMaxDataSize(1024 * 1024 * 1024);
+        stats.replicationThrottleThreshold = 0.99;
+        stats.replicationThrottleWriteQueueCap = 1000;
+    }
+
+    Configuration config;
+    EPStats stats;
+    ReplicationThrottle throttle{config, stats};
+};
+
+TEST_F(ReplicationThrottleTest, NoPacingByDefault) {
+    stats.diskQueueSize = 999;
+    EXPECT_EQ(ReplicationThrottle::Status::Process, throttle.getStatus());
+    EXPECT_EQ(1.0, throttle.getProcessRatio());
+}
+
+// Above the pace percentage of the write queue cap the ratio falls linearly,
+// reaching 0 at the cap (where the throttle pauses).
+TEST_F(ReplicationThrottleTest, ProcessRatioFollowsWriteQueue) {
+    throttle.setPacePercent(50);
+
+    stats.diskQueueSize = 500;
+    EXPECT_EQ(1.0, throttle.getProcessRatio());
+    stats.diskQueueSize = 750;
+    EXPECT_DOUBLE_EQ(0.5, throttle.getProcessRatio());
+    stats.diskQueueSize = 1000;
+    EXPECT_EQ(0.0, throttle.getProcessRatio());
+    stats.diskQueueSize = 2000;
+    EXPECT_EQ(0.0, throttle.getProcessRatio());
+
+    // Without a cap only the memory used counts
+    stats.replicationThrottleWriteQueueCap = -1;
+    EXPECT_EQ(1.0, throttle.getProcessRatio());
+}
@@ -0,0 +1,104 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+/*
+ * Unit tests for the StatGroupCache
+ */
+
+#include "stat_group_cache.h"
+
+#include <folly/portability/GTest.h>
+
+#include <map>
+#include <thread>
+
+class StatGroupCacheTest : public ::testing::Test {
+protected:
+    ENGINE_ERROR_CODE addStats(const std::string& group) {
+        stats.clear();
+        return cache.addStats(group, this, addStat, generate);
+    }
+
+    StatGroupCache cache;
+    int generated = 0;
+    ENGINE_ERROR_CODE status = ENGINE_SUCCESS;
+    std::map<std::string, std::string> stats;
+
+    const AddStatFn addStat = [this](const char* key,
+                                     const uint16_t klen,
+                                     const char* val,
+                                     const uint32_t vlen,
+                                     gsl::not_null<const void*> cookie) {
+        EXPECT_EQ(this, cookie.get());
+        stats[std::string(key, klen)] = std::string(val, vlen);
+    };
+
+    const StatGroupCache::Generator generate = [this](const void* cookie,
+                                                      const AddStatFn& add) {
+        ++generated;
+        const auto value = std::to_string(generated);
+        add("generated", 9, value.data(), uint32_t(value.size()), cookie);
+        return status;
+    };
+};
+
+TEST_F(StatGroupCacheTest, Disabled) {
+    ASSERT_EQ(ENGINE_SUCCESS, addStats(""));
+    ASSERT_EQ(ENGINE_SUCCESS, addStats(""));
+    EXPECT_EQ(2, generated);
+    EXPECT_EQ("2", stats["generated"]);
+    EXPECT_EQ(0, cache.getHits());
+    EXPECT_EQ(0, cache.getMisses());
+}
+
+TEST_F(StatGroupCacheTest, ReusedWithinTtl) {
+    cache.setTtl(std::chrono::hours(1));
+    ASSERT_EQ(ENGINE_SUCCESS, addStats(""));
+    ASSERT_EQ(ENGINE_SUCCESS, addStats(""));
+    EXPECT_EQ(1, generated);
+    EXPECT_EQ("1", stats["generated"]);
+    EXPECT_EQ(1, cache.getHits());
+    EXPECT_EQ(1, cache.getMisses());
+
+    // Each group (with its arguments) has its own output
+    ASSERT_EQ(ENGINE_SUCCESS, addStats("vbucket-details 0"));
+    EXPECT_EQ(2, generated);
+    EXPECT_EQ("2", stats["generated"]);
+
+    // Clearing the cache drops the output of all groups
+    cache.clear();
+    ASSERT_EQ(ENGINE_SUCCESS, addStats(""));
+    EXPECT_EQ(3, generated);
+}
+
+TEST_F(StatGroupCacheTest, Expires) {
+    cache.setTtl(std::chrono::milliseconds(1));
+    ASSERT_EQ(ENGINE_SUCCESS, addStats(""));
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    ASSERT_EQ(ENGINE_SUCCESS, addStats(""));
+    EXPECT_EQ(2, generated);
+    EXPECT_EQ(2, cache.getMisses());
+}
+
+TEST_F(StatGroupCacheTest, FailureNotCached) {
+    cache.setTtl(std::chrono::hours(1));
+    status = ENGINE_NOT_MY_VBUCKET;
+    EXPECT_EQ(ENGINE_NOT_MY_VBUCKET, addStats("vbucket-details 1"));
+    status = ENGINE_SUCCESS;
+    ASSERT_EQ(ENGINE_SUCCESS, addStats("vbucket-details 1"));
+    EXPECT_EQ(2, generated);
+    EXPECT_EQ("2", stats["generated"]);
+}
@@ -60,7 +60,13 @@ public:
     }
 
     /// Returns the number of bytes in the Fixed part of StoredValue
+    /// (including the SeqnoHook of an OrderedStoredValue)
     static size_t getFixedSize() {
+        if (std::is_same<typename Factory::value_type,
+                         OrderedStoredValue>::value) {
+            return sizeof(OrderedStoredValue) +
+                   sizeof(OrderedStoredValue::SeqnoHook);
+        }
         return sizeof(typename Factory::value_type);
     }
 
@@ -436,6 +442,103 @@ TYPED_TEST(ValueTest, MB_32568) {
     EXPECT_EQ(DeleteSource::TTL, this->sv->getDeletionSource());
 }
 
+/**
+ * Test fixture for StoredValues created by CompactStoredValueFactory.
+ */
+class CompactStoredValueTest : public ::testing::Test {
+public:
+    CompactStoredValueTest()
+        : factory(stats, 8),
+          item(make_item(Vbid(0), makeStoredDocKey("key"), "value")) {
+    }
+
+    std::string getValue(const StoredValue& v) {
+        const auto value = v.getValue();
+        return {value->getData(), value->valueSize()};
+    }
+
+    EPStats stats;
+    CompactStoredValueFactory factory;
+    Item item;
+};
+
+TEST_F(CompactStoredValueTest, SmallValueInline) {
+    auto sv = factory(item, {});
+    ASSERT_TRUE(sv->isValueInline());
+    EXPECT_EQ(5, sv->getInlineCapacity());
+    EXPECT_EQ(StoredValue::getRequiredStorage(item.getKey()) + 5,
+              sv->getObjectSize());
+    // The value isn't counted twice
+    EXPECT_EQ(sv->getObjectSize(), sv->size());
+    EXPECT_EQ(5, sv->valuelen());
+    EXPECT_EQ("value", getValue(*sv));
+    EXPECT_FALSE(sv->isCompressible());
+
+    auto itm = sv->toItem(Vbid(0));
+    EXPECT_EQ("value", std::string(itm->getData(), itm->getNBytes()));
+}
+
+TEST_F(CompactStoredValueTest, LargeValueNotInline) {
+    auto sv = factory(make_item(Vbid(0),
+                                makeStoredDocKey("key"),
+                                std::string(9, 'v')),
+                      {});
+    EXPECT_FALSE(sv->isValueInline());
+    EXPECT_EQ(0, sv->getInlineCapacity());
+    EXPECT_EQ(StoredValue::getRequiredStorage(item.getKey()),
+              sv->getObjectSize());
+    EXPECT_EQ(sv->getObjectSize() + 9, sv->size());
+}
+
+// A new value of the same size reuses the inline space, any other size is
+// held in a Blob until the StoredValue is reallocated.
+TEST_F(CompactStoredValueTest, SetValue) {
+    auto sv = factory(item, {});
+    sv->setFreqCounterValue(100);
+
+    sv->setValue(make_item(Vbid(0), makeStoredDocKey("key"), "VALUE"));
+    EXPECT_TRUE(sv->isValueInline());
+    EXPECT_EQ("VALUE", getValue(*sv));
+    EXPECT_EQ(100, sv->getFreqCounterValue());
+
+    sv->setValue(make_item(Vbid(0), makeStoredDocKey("key"), "val"));
+    EXPECT_FALSE(sv->isValueInline());
+    EXPECT_EQ("val", getValue(*sv));
+    EXPECT_EQ(3, sv->valuelen());
+    EXPECT_EQ(sv->getObjectSize() + 3, sv->size());
+    EXPECT_EQ(100, sv->getFreqCounterValue());
+
+    auto copy = factory.copyStoredValue(*sv, {});
+    EXPECT_TRUE(copy->isValueInline());
+    EXPECT_EQ(3, copy->getInlineCapacity());
+    EXPECT_EQ("val", getValue(*copy));
+    EXPECT_EQ(100, copy->getFreqCounterValue());
+    EXPECT_EQ(*sv, *copy);
+}
+
+TEST_F(CompactStoredValueTest, EjectAndRestore) {
+    auto sv = factory(item, {});
+    sv->markClean();
+    sv->ejectValue();
+    EXPECT_FALSE(sv->isResident());
+    EXPECT_FALSE(sv->isValueInline());
+    EXPECT_EQ(0, sv->valuelen());
+    // The space is still allocated
+    EXPECT_EQ(StoredValue::getRequiredStorage(item.getKey()) + 5,
+              sv->size());
+
+    sv->restoreValue(item);
+    EXPECT_TRUE(sv->isValueInline());
+    EXPECT_EQ("value", getValue(*sv));
+
+    // Reallocating a non-resident StoredValue gives back the space
+    sv->ejectValue();
+    auto copy = factory.copyStoredValue(*sv, {});
+    EXPECT_EQ(0, copy->getInlineCapacity());
+    EXPECT_EQ(StoredValue::getRequiredStorage(item.getKey()),
+              copy->size());
+}
+
 /**
  * Test fixture for OrderedStoredValue-only tests.
  */
@@ -443,20 +546,39 @@ class OrderedStoredValueTest : public ValueTest<OrderedStoredValueFactory> {};
 
 TEST_F(OrderedStoredValueTest, expectedSize) {
 #ifdef CB_MEMORY_INEFFICIENT_TAGGED_PTR
-    const long expected_size = 80;
+    const long expected_size = 64;
 #else
-    const long expected_size = 72;
+    const long expected_size = 56;
 #endif
 
     EXPECT_EQ(expected_size, sizeof(OrderedStoredValue))
             << "Unexpected change in OrderedStoredValue fixed size";
 
+    // Plus the SeqnoHook
     auto key = makeStoredDocKey("k");
-    EXPECT_EQ(expected_size + 3, OrderedStoredValue::getRequiredStorage(key))
+    EXPECT_EQ(expected_size + 16 + 3,
+              OrderedStoredValue::getRequiredStorage(key))
             << "Unexpected change in OrderedStoredValue storage size for key: "
             << key;
 }
 
+// Check the size of an OSV created without a SeqnoHook (as held by a
+// ChunkedSeqList).
+TEST_F(OrderedStoredValueTest, withoutSeqnoHook) {
+    OrderedStoredValueFactory unhookedFactory(stats, /*seqnoHook*/ false);
+    auto unhooked = unhookedFactory(item, {});
+    EXPECT_FALSE(unhooked->toOrderedStoredValue()->hasSeqnoHook());
+    EXPECT_TRUE(sv->toOrderedStoredValue()->hasSeqnoHook());
+    EXPECT_EQ(sv->getObjectSize() - sizeof(OrderedStoredValue::SeqnoHook),
+              unhooked->getObjectSize());
+    EXPECT_EQ(*sv->toOrderedStoredValue(), *unhooked->toOrderedStoredValue());
+
+    // A copy is allocated as the factory creating it does
+    auto copy = factory.copyStoredValue(*unhooked, {});
+    EXPECT_TRUE(copy->toOrderedStoredValue()->hasSeqnoHook());
+    EXPECT_EQ(sv->getObjectSize(), copy->getObjectSize());
+}
+
 // Check that when we copy a OSV, the freqCounter is also copied. (Cannot copy
 // StoredValues, hence no version for them).
 TEST_F(OrderedStoredValueTest, copyStoreValue) {
@@ -88,6 +88,16 @@ TEST(StoredDocKey, no_encoded_collectionId) {
     EXPECT_EQ(0, key3.getCollectionID());
 }
 
+// Test that a short key (with its collection prefix) is held inside the
+// StoredDocKey, rather than in an allocation of its own.
+TEST_P(StoredDocKeyTest, ShortKeyHeldInline) {
+    StoredDocKey key(std::string(18, 'k'), GetParam());
+    ASSERT_GE(23, key.size());
+    const auto* begin = reinterpret_cast<const uint8_t*>(&key);
+    EXPECT_GE(key.data(), begin);
+    EXPECT_LT(key.data(), begin + sizeof(key));
+}
+
 TEST_P(StoredDocKeyTest, copy_constructor) {
     StoredDocKey key1("key1", GetParam());
     StoredDocKey key2(key1);
@@ -65,8 +65,10 @@
 
 #include <atomic>
 #include <chrono>
+#include <cmath>
 #include <condition_variable>
 #include <cstring>
+#include <functional>
 #include <gsl/gsl>
 #include <iostream>
 #include <map>
@@ -74,10 +76,12 @@
 #include <mutex>
 #include <queue>
 #include <random>
+#include <set>
 #include <sstream>
 #include <string>
 #include <thread>
 #include <utility>
+#include <vector>
 
 #include <logger/logger.h>
 #include <memcached/dcp.h>
@@ -124,6 +128,23 @@ protected:
     EWB_Engine& engine;
 };
 
+/**
+ * The DelayedNotificationThread notifies the cookies delayed by the
+ * Latency mode once their delay is over.
+ */
+class DelayedNotificationThread : public Couchbase::Thread {
+public:
+    DelayedNotificationThread(EWB_Engine& engine_)
+        : Thread("ewb:timer"), engine(engine_) {
+    }
+
+protected:
+    void run() override;
+
+protected:
+    EWB_Engine& engine;
+};
+
 /**
  * The BlockMonitorThread represents the thread that is
  * monitoring the "lock" file. Once the file is no longer
@@ -263,14 +284,15 @@ public:
             return false;
         }
 
-        if (iter->second.first != cookie) {
+        auto& mode = iter->second.second;
+        if (iter->second.first != cookie && !mode->is_connection_wide()) {
             // The cookie is different so it represents a different command
             connection_map.erase(iter);
             return false;
         }
 
-        const bool inject = iter->second.second->should_inject_error(cmd, err);
-        const bool add_to_pending_io_ops = iter->second.second->add_to_pending_io_ops();
+        const bool inject = mode->should_inject_error(cmd, cookie, err);
+        const bool add_to_pending_io_ops = mode->add_to_pending_io_ops();
 
         if (inject) {
             LOG_DEBUG("EWB_Engine: injecting error:{} for cmd:{}",
@@ -281,7 +303,12 @@ public:
                 // The server expects that if EWOULDBLOCK is returned then the
                 // server should be notified in the future when the operation is
                 // ready - so add this op to the pending IO queue.
-                schedule_notification(iter->second.first);
+                const auto delay = mode->get_notification_delay();
+                if (delay.count() > 0) {
+                    schedule_delayed_notification(cookie, delay);
+                } else {
+                    schedule_notification(cookie);
+                }
             }
         }
 
@@ -594,6 +621,33 @@ public:
                     new_mode = std::make_shared<CASMismatch>(value);
                     break;
 
+                case EWBEngineMode::Latency:
+                    try {
+                        new_mode = std::make_shared<InjectLatency>(
+                                value, parseLatencyDistribution(key));
+                    } catch (const std::logic_error& e) {
+                        LOG_WARNING(
+                                "EWB_Engine::unknown_command(): Invalid "
+                                "latency distribution '{}': {}",
+                                key,
+                                e.what());
+                    }
+                    break;
+
+                case EWBEngineMode::Pressure:
+                    injected_pressure = value;
+                    response(nullptr,
+                             0,
+                             nullptr,
+                             0,
+                             nullptr,
+                             0,
+                             PROTOCOL_BINARY_RAW_BYTES,
+                             cb::mcbp::Status::Success,
+                             0,
+                             cookie);
+                    return ENGINE_SUCCESS;
+
                 case EWBEngineMode::IncrementClusterMapRevno:
                     clustermap_revno++;
                     response(nullptr,
@@ -738,6 +792,13 @@ public:
         return real_engine->getFeatures();
     }
 
+    cb::engine::Pressure getPressure() override {
+        auto pressure = real_engine->getPressure();
+        pressure.memory =
+                std::max(pressure.memory, injected_pressure.load() / 100.0f);
+        return pressure;
+    }
+
     bool isXattrEnabled() override {
         return real_engine->isXattrEnabled();
     }
@@ -953,6 +1014,9 @@ public:
 
     std::atomic_int clustermap_revno;
 
+    // The memory pressure (in percent) set with EWBEngineMode::Pressure
+    std::atomic<uint32_t> injected_pressure{0};
+
     /**
      * The method responsible for pushing all of the notify_io_complete
      * to the frontend. It is run by notify_io_thread and not intended to
@@ -961,6 +1025,13 @@ public:
     void process_notifications();
     std::unique_ptr<Couchbase::Thread> notify_io_thread;
 
+    /**
+     * The method responsible for notifying the cookies delayed by the
+     * Latency mode. It is run by delayed_notify_thread.
+     */
+    void process_delayed_notifications();
+    std::unique_ptr<Couchbase::Thread> delayed_notify_thread;
+
 protected:
     /**
      * Handle the control message for block monitor file
@@ -1025,8 +1096,36 @@ private:
     std::condition_variable condvar;
     std::queue<const void*> pending_io_ops;
 
+    // The cookies delayed by the Latency mode, ordered by the time they
+    // should be notified (shared with the delayed notification thread)
+    using DelayedNotification =
+            std::pair<std::chrono::steady_clock::time_point, const void*>;
+    std::mutex delayed_mutex;
+    std::condition_variable delayed_condvar;
+    std::priority_queue<DelayedNotification,
+                        std::vector<DelayedNotification>,
+                        std::greater<DelayedNotification>>
+            delayed_io_ops;
+
     std::atomic<bool> stop_notification_thread;
 
+    /// Samples the delay (in microseconds) of the Latency mode
+    using LatencyDistribution = std::function<double(std::mt19937&)>;
+
+    /**
+     * Parse the latency distribution of the Latency mode, where all of
+     * the times are in microseconds:
+     *
+     *     fixed:<delay>
+     *     uniform:<min>:<max>
+     *     exponential:<mean>
+     *     lognormal:<median>:<sigma>
+     *
+     * @throws std::invalid_argument if the specification is invalid
+     */
+    static LatencyDistribution parseLatencyDistribution(
+            const std::string& spec);
+
     // Base class for all fault injection modes.
     struct FaultInjectMode {
         virtual ~FaultInjectMode() = default;
@@ -1037,7 +1136,33 @@ private:
         virtual bool add_to_pending_io_ops() {
             return true;
         }
-        virtual bool should_inject_error(Cmd cmd, ENGINE_ERROR_CODE& err) = 0;
+        /**
+         * Should the error be injected for the command?
+         *
+         * @param cmd the engine function called
+         * @param cookie the cookie calling it
+         * @param[out] err the error to inject
+         */
+        virtual bool should_inject_error(Cmd cmd,
+                                         const void* cookie,
+                                         ENGINE_ERROR_CODE& err) = 0;
+
+        /**
+         * Does the mode apply to all of the commands of the connection
+         * (rather than just to the cookie which configured it, ending when
+         * the connection uses a different cookie)?
+         */
+        virtual bool is_connection_wide() const {
+            return false;
+        }
+
+        /**
+         * The time to wait before notifying the cookie after injecting
+         * EWOULDBLOCK (zero notifies it straight away)
+         */
+        virtual std::chrono::microseconds get_notification_delay() {
+            return std::chrono::microseconds::zero();
+        }
 
         virtual std::string to_string() const = 0;
 
@@ -1053,7 +1178,9 @@ private:
           : FaultInjectMode(injected_error_),
             prev_cmd(Cmd::NONE) {}
 
-        bool should_inject_error(Cmd cmd, ENGINE_ERROR_CODE& err) {
+        bool should_inject_error(Cmd cmd,
+                                 const void* cookie,
+                                 ENGINE_ERROR_CODE& err) {
             // Block unless the previous command from this cookie
             // was the same - i.e. all of a connections' commands
             // will EWOULDBLOCK the first time they are called.
@@ -1080,7 +1207,9 @@ private:
           : FaultInjectMode(injected_error_),
             count(count_) {}
 
-        bool should_inject_error(Cmd cmd, ENGINE_ERROR_CODE& err) {
+        bool should_inject_error(Cmd cmd,
+                                 const void* cookie,
+                                 ENGINE_ERROR_CODE& err) {
             if (count > 0) {
                 --count;
                 err = injected_error;
@@ -1107,7 +1236,9 @@ private:
           : FaultInjectMode(injected_error_),
             percentage_to_err(percentage_) {}
 
-        bool should_inject_error(Cmd cmd, ENGINE_ERROR_CODE& err) {
+        bool should_inject_error(Cmd cmd,
+                                 const void* cookie,
+                                 ENGINE_ERROR_CODE& err) {
             std::random_device rd;
             std::mt19937 gen(rd());
             std::uniform_int_distribution<uint32_t> dis(1, 100);
@@ -1137,7 +1268,9 @@ private:
               sequence(sequence_),
               pos(0) {}
 
-        bool should_inject_error(Cmd cmd, ENGINE_ERROR_CODE& err) {
+        bool should_inject_error(Cmd cmd,
+                                 const void* cookie,
+                                 ENGINE_ERROR_CODE& err) {
             bool inject = false;
             if (pos < 32) {
                 inject = (sequence & (1 << pos)) != 0;
@@ -1169,7 +1302,9 @@ private:
                 issued_return_error(false) {}
 
             bool add_to_pending_io_ops() {return false;}
-            bool should_inject_error(Cmd cmd, ENGINE_ERROR_CODE& err) {
+            bool should_inject_error(Cmd cmd,
+                                     const void* cookie,
+                                     ENGINE_ERROR_CODE& err) {
                 if (!issued_return_error) {
                     issued_return_error = true;
                     err = injected_error;
@@ -1197,7 +1332,9 @@ private:
           : FaultInjectMode(ENGINE_KEY_EEXISTS),
             count(count_) {}
 
-        bool should_inject_error(Cmd cmd, ENGINE_ERROR_CODE& err) {
+        bool should_inject_error(Cmd cmd,
+                                 const void* cookie,
+                                 ENGINE_ERROR_CODE& err) {
             if (cmd == Cmd::CAS && (count > 0)) {
                 --count;
                 err = injected_error;
@@ -1216,6 +1353,61 @@ private:
         uint32_t count;
     };
 
+    class InjectLatency : public FaultInjectMode {
+    public:
+        InjectLatency(uint32_t percentage_, LatencyDistribution distribution_)
+            : FaultInjectMode(ENGINE_EWOULDBLOCK),
+              percentage(percentage_ == 0 ? 100 : percentage_),
+              distribution(std::move(distribution_)),
+              gen(std::random_device()()) {
+        }
+
+        bool is_connection_wide() const override {
+            return true;
+        }
+
+        bool should_inject_error(Cmd cmd,
+                                 const void* cookie,
+                                 ENGINE_ERROR_CODE& err) override {
+            // Neither allocating an item nor reading its info would wait
+            // for the disk (and delaying them would delay a store twice)
+            if (cmd == Cmd::ALLOCATE || cmd == Cmd::GET_INFO) {
+                return false;
+            }
+            // The call retried once the cookie is notified goes through
+            if (delayed.erase(cookie) != 0) {
+                return false;
+            }
+            std::uniform_int_distribution<uint32_t> dis(1, 100);
+            if (dis(gen) > percentage) {
+                return false;
+            }
+            delayed.insert(cookie);
+            err = injected_error;
+            return true;
+        }
+
+        std::chrono::microseconds get_notification_delay() override {
+            // Never zero, which would notify the cookie straight away
+            const auto delay = std::max(1.0, distribution(gen));
+            return std::chrono::microseconds(uint64_t(delay));
+        }
+
+        std::string to_string() const override {
+            return std::string("InjectLatency") +
+                   " percentage=" + std::to_string(percentage) +
+                   " delayed=" + std::to_string(delayed.size());
+        }
+
+    private:
+        // Percentage of the calls to delay
+        const uint32_t percentage;
+        const LatencyDistribution distribution;
+        std::mt19937 gen;
+        // The cookies waiting for their delayed notification
+        std::set<const void*> delayed;
+    };
+
     // Map of connections (aka cookies) to their current mode.
     std::map<uint64_t, std::pair<const void*, std::shared_ptr<FaultInjectMode> > > connection_map;
     // Mutex for above map.
@@ -1304,6 +1496,20 @@ private:
         return false;
     }
 
+    void schedule_delayed_notification(const void* cookie,
+                                       std::chrono::microseconds delay) {
+        {
+            std::lock_guard<std::mutex> guard(delayed_mutex);
+            delayed_io_ops.emplace(std::chrono::steady_clock::now() + delay,
+                                   cookie);
+        }
+        LOG_DEBUG("EWB_Engine: connection {} should be resumed in {}us",
+                  (void*)cookie,
+                  delay.count());
+
+        delayed_condvar.notify_one();
+    }
+
     void schedule_notification(const void* cookie) {
         {
             std::lock_guard<std::mutex> guard(mutex);
@@ -1324,7 +1530,8 @@ private:
 
 EWB_Engine::EWB_Engine(GET_SERVER_API gsa_)
   : gsa(gsa_),
-    notify_io_thread(new NotificationThread(*this))
+    notify_io_thread(new NotificationThread(*this)),
+    delayed_notify_thread(new DelayedNotificationThread(*this))
 {
     init_wrapped_api(gsa);
 
@@ -1332,12 +1539,20 @@ EWB_Engine::EWB_Engine(GET_SERVER_API gsa_)
 
     stop_notification_thread.store(false);
     notify_io_thread->start();
+    delayed_notify_thread->start();
 }
 
 EWB_Engine::~EWB_Engine() {
     stop_notification_thread = true;
     condvar.notify_all();
+    {
+        // Don't let the timer miss the wakeup between checking the flag
+        // and waiting
+        std::lock_guard<std::mutex> guard(delayed_mutex);
+    }
+    delayed_condvar.notify_all();
     notify_io_thread->waitForState(Couchbase::ThreadState::Zombie);
+    delayed_notify_thread->waitForState(Couchbase::ThreadState::Zombie);
 }
 
 ENGINE_ERROR_CODE EWB_Engine::step(
@@ -1858,6 +2073,80 @@ void NotificationThread::run() {
     engine.process_notifications();
 }
 
+void EWB_Engine::process_delayed_notifications() {
+    SERVER_HANDLE_V1* server = gsa();
+    std::unique_lock<std::mutex> lk(delayed_mutex);
+    while (!stop_notification_thread) {
+        if (delayed_io_ops.empty()) {
+            delayed_condvar.wait(lk, [this] {
+                return !delayed_io_ops.empty() || stop_notification_thread;
+            });
+            continue;
+        }
+
+        const auto next = delayed_io_ops.top();
+        if (std::chrono::steady_clock::now() < next.first) {
+            // Woken early by a new (possibly earlier) notification
+            delayed_condvar.wait_until(lk, next.first);
+            continue;
+        }
+
+        delayed_io_ops.pop();
+        lk.unlock();
+        LOG_DEBUG("EWB_Engine: notify delayed {}", next.second);
+        server->cookie->notify_io_complete(next.second, ENGINE_SUCCESS);
+        lk.lock();
+    }
+}
+
+void DelayedNotificationThread::run() {
+    setRunning();
+    engine.process_delayed_notifications();
+}
+
+EWB_Engine::LatencyDistribution EWB_Engine::parseLatencyDistribution(
+        const std::string& spec) {
+    std::vector<std::string> args;
+    std::stringstream ss(spec);
+    std::string arg;
+    while (std::getline(ss, arg, ':')) {
+        args.push_back(arg);
+    }
+    if (args.empty()) {
+        throw std::invalid_argument("no distribution");
+    }
+
+    std::vector<double> values;
+    for (size_t ii = 1; ii < args.size(); ++ii) {
+        size_t pos = 0;
+        values.push_back(std::stod(args[ii], &pos));
+        if (pos != args[ii].size() || values.back() < 0) {
+            throw std::invalid_argument("invalid value '" + args[ii] + "'");
+        }
+    }
+
+    const auto& name = args.front();
+    if (name == "fixed" && values.size() == 1) {
+        const auto delay = values[0];
+        return [delay](std::mt19937&) { return delay; };
+    }
+    if (name == "uniform" && values.size() == 2 && values[0] <= values[1]) {
+        std::uniform_real_distribution<double> dist(values[0], values[1]);
+        return [dist](std::mt19937& gen) mutable { return dist(gen); };
+    }
+    if (name == "exponential" && values.size() == 1 && values[0] > 0) {
+        std::exponential_distribution<double> dist(1.0 / values[0]);
+        return [dist](std::mt19937& gen) mutable { return dist(gen); };
+    }
+    if (name == "lognormal" && values.size() == 2 && values[0] > 0) {
+        // The median of a log-normal distribution is exp(m)
+        std::lognormal_distribution<double> dist(std::log(values[0]),
+                                                 values[1]);
+        return [dist](std::mt19937& gen) mutable { return dist(gen); };
+    }
+    throw std::invalid_argument("unknown distribution '" + spec + "'");
+}
+
 ENGINE_ERROR_CODE EWB_Engine::handleBlockMonitorFile(
         const void* cookie,
         uint32_t id,
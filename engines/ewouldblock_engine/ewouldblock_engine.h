@@ -87,4 +87,22 @@ enum class EWBEngineMode : uint32_t {
     // This allows us to verify that all of the registered logger instances are
     // set to the correct level.
     CheckLogLevels = 11,
+
+    // Delay the calls into the engine to model a slow disk: return
+    // EWOULDBLOCK and notify the connection from a timer thread after a
+    // delay drawn from the distribution specified in the key, letting the
+    // call through when it is retried. The mode applies to all of the
+    // commands of the connection (until it is reconfigured), delaying
+    // {value} percent of the calls (all of them if {value} is 0), and
+    // {inject_error} is ignored. The distributions (in microseconds) are
+    //     fixed:<delay>
+    //     uniform:<min>:<max>
+    //     exponential:<mean>
+    //     lognormal:<median>:<sigma>
+    Latency = 12,
+
+    // Report {value} percent of memory pressure from getPressure() (the
+    // highest of it and the real engine's), until set back to 0. Used to
+    // test the admission control. {inject_error} and the key are ignored.
+    Pressure = 13,
 };
@@ -140,6 +140,7 @@ enum class ClientOpcode : uint8_t {
     DcpSeqnoAcknowledged = 0x61,
     DcpCommit = 0x62,
     DcpAbort = 0x63,
+    DcpStreamReqMulti = 0x64,
     /* End DCP */
 
     StopPersistence = 0x80,
@@ -298,6 +299,44 @@ enum class ClientOpcode : uint8_t {
     /* Subdoc additions for Spock: */
     SubdocGetCount = 0xd2,
 
+    /**
+     * Command to read the documents of a key range
+     */
+    RangeScan = 0xd3,
+
+    /**
+     * Command to get several documents (of any vbuckets) at once
+     */
+    GetMulti = 0xd4,
+
+    /**
+     * Command to store several documents (of any vbuckets) at once
+     */
+    SetMulti = 0xd5,
+
+    /**
+     * Command to get the metadata of several documents (of any vbuckets)
+     * at once
+     */
+    GetMetaMulti = 0xd6,
+
+    /**
+     * Command to store several documents with their metadata (of any
+     * vbuckets) at once, as SetWithMeta does each of them
+     */
+    SetWithMetaMulti = 0xd7,
+
+    /**
+     * Command to snapshot the data file of a vbucket (as a hard link in a
+     * given directory) so it may be copied to another node
+     */
+    VbucketSnapshot = 0xd8,
+
+    /**
+     * Command to install a (copied) data file as a replica vbucket
+     */
+    VbucketInstall = 0xd9,
+
     /* Scrub the data */
     Scrub = 0xf0,
     /* Refresh the ISASL data */
@@ -409,11 +448,26 @@ enum class ServerOpcode {
      *     [ "joe", "smith", "perry" ]
      */
     ActiveExternalUsers = 0x03,
+    /**
+     * The stats of a stats group the client subscribed to (with
+     * "stats subscribe <interval> [group]"), sent every interval. The key
+     * is the group and the value a JSON document with the stats which
+     * changed since the previous push (see BinaryProtocol.md).
+     */
+    StatsPush = 0x04,
 };
 
 bool is_valid_opcode(ClientOpcode opcode);
 bool is_valid_opcode(ServerOpcode opcode);
 
+/**
+ * Check to see if the server supports reordering of the specified opcode
+ * (when the client allows it)
+ *
+ * @throws std::runtime_error for unknown opcodes
+ */
+bool is_reorder_supported(ClientOpcode opcode);
+
 } // namespace mcbp
 } // namespace cb
 
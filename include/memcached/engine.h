@@ -3,6 +3,7 @@
 #define MEMCACHED_ENGINE_H
 
 #include <sys/types.h>
+#include <algorithm>
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
@@ -128,6 +129,32 @@ struct EngineErrorCasPair {
     engine_errc status;
     uint64_t cas;
 };
+
+/**
+ * The document an UpdateFunction wants stored
+ */
+struct UpdatedDocument {
+    /// The value (with any extended attributes first)
+    std::string value;
+    protocol_binary_datatype_t datatype = PROTOCOL_BINARY_RAW_BYTES;
+    /// The flags (in network byte order) and expiry time of a document
+    /// created; a document updated keeps its own
+    uint32_t flags = 0;
+    rel_time_t exptime = 0;
+};
+
+/**
+ * Compute the new value of a document updated in place (see
+ * EngineIface::update). The function is given the item_info of the
+ * document (with its value decompressed), or nullptr if there is no such
+ * document, and returns success for the document it filled in to be
+ * stored. Any other status fails the update with that status.
+ *
+ * It's called with the engine's lock for the document held, so it must
+ * not call back into the engine.
+ */
+using UpdateFunction =
+        std::function<engine_errc(const item_info*, UpdatedDocument&)>;
 } // namespace cb
 
 /**
@@ -156,6 +183,28 @@ enum class Feature : uint16_t {
 };
 
 typedef std::unordered_set<Feature> FeatureSet;
+
+/**
+ * How close the engine is to the limits where it can't keep up with
+ * (or starts to reject) more work. Each signal is the ratio of the
+ * current usage to the limit (0 = idle, 1 = at the limit)
+ */
+struct Pressure {
+    /// Memory used relative to where mutations are rejected with TMPFAIL
+    float memory = 0;
+    /// Items waiting to be persisted relative to the write queue cap
+    float diskQueue = 0;
+    /// Checkpoint memory relative to where cursors are dropped
+    float checkpointMemory = 0;
+    /// Tasks waiting to run relative to the number of worker threads
+    float executorBacklog = 0;
+
+    /// @return the highest of the signals
+    float getMax() const {
+        return std::max(std::max(memory, diskQueue),
+                        std::max(checkpointMemory, executorBacklog));
+    }
+};
 } // namespace engine
 } // namespace cb
 
@@ -470,6 +519,54 @@ struct MEMCACHED_PUBLIC_CLASS EngineIface {
         return {cb::engine_errc::not_supported, 0};
     }
 
+    /**
+     * Read, modify and store a document in one go: the engine holds its
+     * lock for the document while it calls the function to compute the
+     * new value and stores it, so that no other mutation can come in
+     * between (and the caller has no CAS mismatch to retry).
+     *
+     * Optional interface; not supported by all engines. The caller may
+     * then get and store (with CAS) the document itself.
+     *
+     * @param cookie The cookie provided by the frontend
+     * @param key the key of the document
+     * @param vbucket the virtual bucket id
+     * @param cas only update the document if it has this CAS (if non-zero)
+     * @param update the function computing the new value of the document
+     *
+     * @return the error code and the document as stored
+     */
+    virtual cb::EngineErrorItemPair update(gsl::not_null<const void*> cookie,
+                                           const DocKey& key,
+                                           Vbid vbucket,
+                                           uint64_t cas,
+                                           const cb::UpdateFunction& update);
+
+    /**
+     * Append data to an existing document without copying its current
+     * value (the engine may keep the value in segments which are only made
+     * contiguous when the document is read). The datatype, flags and
+     * expiry time of the document are kept.
+     *
+     * Optional interface; not supported by all engines, and an engine may
+     * return not_supported for a given document (for instance if its
+     * value is compressed). The caller should then use update() or get
+     * and store the document itself.
+     *
+     * @param cookie The cookie provided by the frontend
+     * @param key the key of the document
+     * @param vbucket the virtual bucket id
+     * @param cas only update the document if it has this CAS (if non-zero)
+     * @param value the data to append
+     *
+     * @return the error code and the document as stored (without its value)
+     */
+    virtual cb::EngineErrorItemPair append(gsl::not_null<const void*> cookie,
+                                           const DocKey& key,
+                                           Vbid vbucket,
+                                           uint64_t cas,
+                                           cb::const_char_buffer value);
+
     /**
      * Flush the cache.
      *
@@ -605,6 +702,15 @@ struct MEMCACHED_PUBLIC_CLASS EngineIface {
     virtual float getMinCompressionRatio() {
         return default_min_compression_ratio;
     }
+
+    /**
+     * Get the current pressure of the bucket. The front end calls it
+     * periodically (not for every command) to decide if it should shed
+     * load, but it should still be cheap.
+     */
+    virtual cb::engine::Pressure getPressure() {
+        return {};
+    }
 };
 
 namespace cb {
@@ -653,6 +759,24 @@ inline EngineErrorItemPair makeEngineErrorItemPair(cb::engine_errc err,
 }
 }
 
+inline cb::EngineErrorItemPair EngineIface::update(
+        gsl::not_null<const void*> cookie,
+        const DocKey& key,
+        Vbid vbucket,
+        uint64_t cas,
+        const cb::UpdateFunction& update) {
+    return cb::makeEngineErrorItemPair(cb::engine_errc::not_supported);
+}
+
+inline cb::EngineErrorItemPair EngineIface::append(
+        gsl::not_null<const void*> cookie,
+        const DocKey& key,
+        Vbid vbucket,
+        uint64_t cas,
+        cb::const_char_buffer value) {
+    return cb::makeEngineErrorItemPair(cb::engine_errc::not_supported);
+}
+
 /**
  * @}
  */
@@ -705,6 +705,41 @@ protected:
     uint32_t opaque = 0;
 };
 static_assert(sizeof(DcpAddStreamPayload) == 4, "Unexpected struct size");
+
+/**
+ * The header of the result of one stream request of a DcpStreamReqMulti.
+ * The value of the response holds one per requested vbucket (in the order
+ * requested), each followed by `length` bytes of the value a DcpStreamReq
+ * would have responded with (the failover log on success, the rollback
+ * seqno on rollback).
+ */
+class DcpStreamReqMultiResult {
+public:
+    Vbid getVBucket() const {
+        return Vbid(ntohs(vbucket));
+    }
+    void setVBucket(Vbid vbucket) {
+        DcpStreamReqMultiResult::vbucket = htons(vbucket.get());
+    }
+    cb::mcbp::Status getStatus() const {
+        return cb::mcbp::Status(ntohs(status));
+    }
+    void setStatus(cb::mcbp::Status status) {
+        DcpStreamReqMultiResult::status = htons(uint16_t(status));
+    }
+    uint32_t getLength() const {
+        return ntohl(length);
+    }
+    void setLength(uint32_t length) {
+        DcpStreamReqMultiResult::length = htonl(length);
+    }
+
+protected:
+    uint16_t vbucket = 0;
+    uint16_t status = 0;
+    uint32_t length = 0;
+};
+static_assert(sizeof(DcpStreamReqMultiResult) == 8, "Unexpected struct size");
 } // namespace response
 
 namespace request {
@@ -807,6 +842,33 @@ protected:
 };
 static_assert(sizeof(DcpStreamReqPayload) == 48, "Unexpected struct size");
 
+/**
+ * An entry of the value of a DcpStreamReqMulti: the stream request of one
+ * vbucket. The value is an array of them.
+ */
+class DcpStreamReqMultiEntry : public DcpStreamReqPayload {
+public:
+    uint32_t getOpaque() const {
+        return ntohl(opaque);
+    }
+    void setOpaque(uint32_t opaque) {
+        DcpStreamReqMultiEntry::opaque = htonl(opaque);
+    }
+    Vbid getVBucket() const {
+        return Vbid(ntohs(vbucket));
+    }
+    void setVBucket(Vbid vbucket) {
+        DcpStreamReqMultiEntry::vbucket = htons(vbucket.get());
+    }
+
+protected:
+    /// The opaque of the stream (the opaque of the request isn't used)
+    uint32_t opaque = 0;
+    uint16_t vbucket = 0;
+    uint16_t reserved2 = 0;
+};
+static_assert(sizeof(DcpStreamReqMultiEntry) == 56, "Unexpected struct size");
+
 class DcpStreamEndPayload {
 public:
     uint32_t getFlags() const {
@@ -1715,8 +1777,69 @@ protected:
     Vbid db_file_id = Vbid{0};
     uint32_t align_pad3 = 0;
 };
+
+/**
+ * Message format for CMD_RANGE_SCAN
+ *
+ * Request:
+ *
+ * Key:   The first key of the range (inclusive)
+ * Value: The key the range ends at (exclusive). If empty the range ends
+ *        with the start key's collection.
+ * Body:
+ * - count: The most documents to return
+ * - flags: KeysOnly to return just the keys
+ *
+ * Response:
+ *
+ * The value contains the documents of the range in key order, each as
+ * a 16 bit key length, an 8 bit datatype, a 32 bit value length, the key
+ * and then the value. Fewer than count documents means the scan is
+ * complete; otherwise it may be resumed from the key after the last one.
+ */
+class RangeScanPayload {
+public:
+    /// Return the keys (with empty values)
+    static const uint32_t KeysOnly = 0x1;
+
+    uint32_t getCount() const {
+        return ntohl(count);
+    }
+    void setCount(uint32_t count) {
+        RangeScanPayload::count = htonl(count);
+    }
+    uint32_t getFlags() const {
+        return ntohl(flags);
+    }
+    void setFlags(uint32_t flags) {
+        RangeScanPayload::flags = htonl(flags);
+    }
+
+protected:
+    uint32_t count = 0;
+    uint32_t flags = 0;
+};
+
+/**
+ * Definition of the optional extras of the GetRandomKey command, which
+ * restrict the sample to the documents of one collection.
+ */
+class GetRandomKeyPayload {
+public:
+    CollectionIDType getCollectionId() const {
+        return ntohl(collection);
+    }
+    void setCollectionId(CollectionIDType collection) {
+        GetRandomKeyPayload::collection = htonl(collection);
+    }
+
+protected:
+    CollectionIDType collection = 0;
+};
 #pragma pack()
 static_assert(sizeof(CompactDbPayload) == 24, "Unexpected struct size");
+static_assert(sizeof(RangeScanPayload) == 8, "Unexpected struct size");
+static_assert(sizeof(GetRandomKeyPayload) == 4, "Unexpected struct size");
 } // namespace request
 } // namespace mcbp
 } // namespace cb
@@ -47,6 +47,24 @@ typedef struct allocator_stats {
 
 } allocator_stats;
 
+typedef struct allocator_utilization {
+    /* Free regions of the slab holding the allocation */
+    size_t nfree;
+
+    /* Regions of the slab holding the allocation */
+    size_t nregs;
+
+    /* Free regions of all the slabs of the allocation's size class */
+    size_t bin_nfree;
+
+    /* Regions of all the slabs of the allocation's size class */
+    size_t bin_nregs;
+
+    /* Whether the slab is the one new allocations of the size class are
+       currently made from */
+    bool current_slab;
+} allocator_utilization;
+
 /**
  * Engine allocator hooks for memory tracking.
  */
@@ -128,6 +146,46 @@ struct ServerAllocatorIface {
      * @return whether the call was successful
      */
     bool (*get_allocator_property)(const char* name, size_t* value);
+
+    /**
+     * Gets how used the slab holding the given allocation is.
+     * @param ptr the allocation
+     * @param util destination for the utilization of its slab
+     * @return whether the call was successful (it fails if the allocator
+     *         can't be queried, or the allocation isn't held in a slab)
+     */
+    bool (*get_allocation_utilization)(const void* ptr,
+                                       allocator_utilization* util);
+
+    /**
+     * Creates an arena (a separate heap, with its own stats) for the memory
+     * of a bucket. Arena 0 is the default arena all threads allocate from.
+     * @param arena destination for the index of the new arena
+     * @param huge_pages whether the memory of the arena should be backed by
+     *        (transparent) huge pages
+     * @return whether the call was successful (it fails if the allocator
+     *         doesn't support arenas, or huge pages when requested)
+     */
+    bool (*create_arena)(unsigned* arena, bool huge_pages);
+
+    /**
+     * Releases an arena made by create_arena, once the memory of the
+     * bucket using it has been freed. Its free memory is returned to the OS
+     * and the arena is reused by the next create_arena.
+     */
+    void (*release_arena)(unsigned arena);
+
+    /**
+     * Sets the arena the calling thread allocates from.
+     */
+    void (*set_thread_arena)(unsigned arena);
+
+    /**
+     * Obtains the statistics of just the given arena (the ext_stats are
+     * not filled in).
+     * @return whether the call was successful
+     */
+    bool (*get_arena_stats)(unsigned arena, allocator_stats* stats);
 };
 
 #ifdef __cplusplus
@@ -83,7 +83,18 @@ public:
     /**
      * Create a (deep) copy of the Blob (allocate a new backing store)
      */
-    Blob(const Blob& other);
+    Blob(const Blob& other) : Blob(other, other.size()) {
+    }
+
+    /**
+     * Create a (deep) copy of the Blob with room for it to grow to the
+     * given size without reallocating
+     *
+     * @param other the Blob to copy
+     * @param capacity the size of the new backing store (at least
+     *                 other.size())
+     */
+    Blob(const Blob& other, size_t capacity);
 
     /**
      * Replace the contents of the Blob with the given buffer.
@@ -115,12 +126,24 @@ public:
     /**
      * Set (add or replace) the given key with the specified value.
      *
+     * An existing key keeps its place in the blob: its value is replaced
+     * in place, only moving the pairs after it if the size of the value
+     * changes.
+     *
      * @param key The key to set
      * @param value The new value for the key
      */
     void set(const cb::const_char_buffer& key,
              const cb::const_char_buffer& value);
 
+    /**
+     * Make room for the blob to grow to the given size without
+     * reallocating (a no-op if there already is)
+     *
+     * @param size the number of bytes to reserve
+     */
+    void reserve(size_t size);
+
     void prune_user_keys();
 
     /**
@@ -218,6 +241,23 @@ public:
     }
 
 protected:
+    /**
+     * Locate the kv-pair of the given key
+     *
+     * @param key The key to look up
+     * @return the offset of the kv-pair (its length word), or 0 if the key
+     *         isn't in the blob
+     */
+    size_t find(const cb::const_char_buffer& key) const;
+
+    /**
+     * Move the end of the blob: the bytes from offset onwards are moved to
+     * newOffset (growing the buffer if needed)
+     *
+     * @param offset The start of the bytes to move
+     * @param newOffset Where to move them to
+     */
+    void move_tail(size_t offset, size_t newOffset);
 
     /**
      * Expand the buffer and write the kv-pair at the end of the buffer
@@ -16,6 +16,7 @@
  */
 #pragma once
 
+#include <platform/compress.h>
 #include <platform/sized_buffer.h>
 #include <xattr/visibility.h>
 
@@ -62,6 +63,20 @@ uint32_t get_body_offset(const cb::const_char_buffer& payload);
 XATTR_PUBLIC_API
 cb::const_char_buffer get_body(const cb::const_char_buffer& payload);
 
+/**
+ * Inflate the xattrs of a Snappy compressed document. Only the front of
+ * the document (up to the end of the xattrs) is inflated, so the cost
+ * doesn't depend on the size of the body.
+ *
+ * @param payload the (compressed) document blob as it is stored in the
+ *                engine
+ * @param output where to store the xattrs (a document with an empty body)
+ * @return true if success, false if the payload isn't valid
+ */
+XATTR_PUBLIC_API
+bool inflate_xattrs(const cb::const_char_buffer& payload,
+                    cb::compression::Buffer& output);
+
 /**
  * Check to see if the provided attribute represents a system
  * attribute or not.
@@ -0,0 +1,279 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "async_sink.h"
+
+#include <platform/sysinfo.h>
+#include <spdlog/details/fmt_helper.h>
+#include <spdlog/details/log_msg.h>
+#include <spdlog/details/os.h>
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+namespace cb {
+namespace logger {
+
+/// The maximum number of queues we'll spread the threads over
+static constexpr size_t MaxQueues = 16;
+
+/// We don't want a slot to hold on to the memory for a huge message
+static constexpr size_t MaxRetainedPayload = 4096;
+
+static size_t nextPowerOfTwo(size_t value) {
+    size_t ret = 1;
+    while (ret < value) {
+        ret <<= 1;
+    }
+    return ret;
+}
+
+AsyncSink::Queue::Queue(size_t size)
+    : slots(std::make_unique<Slot[]>(nextPowerOfTwo(size))),
+      mask(nextPowerOfTwo(size) - 1) {
+    for (size_t ii = 0; ii <= mask; ++ii) {
+        slots[ii].sequence.store(ii, std::memory_order_relaxed);
+    }
+}
+
+bool AsyncSink::Queue::tryPush(const spdlog::details::log_msg& msg) {
+    auto pos = head.load(std::memory_order_relaxed);
+    for (;;) {
+        auto& slot = slots[pos & mask];
+        const auto seq = slot.sequence.load(std::memory_order_acquire);
+        const auto diff = intptr_t(seq) - intptr_t(pos);
+        if (diff == 0) {
+            // The slot is free, try to claim it
+            if (head.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed)) {
+                slot.level = msg.level;
+                slot.time = msg.time;
+                slot.thread_id = msg.thread_id;
+                slot.payload.assign(msg.raw.data(), msg.raw.size());
+                slot.sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            // The consumer hasn't released the slot yet; we're full
+            return false;
+        } else {
+            // Someone else claimed the slot
+            pos = head.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool AsyncSink::Queue::tryPop(spdlog::sinks::sink& sink,
+                              const std::string* name) {
+    const auto pos = tail.load(std::memory_order_relaxed);
+    auto& slot = slots[pos & mask];
+    if (slot.sequence.load(std::memory_order_acquire) != pos + 1) {
+        return false;
+    }
+
+    spdlog::details::log_msg msg;
+    msg.logger_name = name;
+    msg.level = slot.level;
+    msg.time = slot.time;
+    msg.thread_id = slot.thread_id;
+    spdlog::details::fmt_helper::append_str(slot.payload, msg.raw);
+    if (slot.payload.capacity() > MaxRetainedPayload) {
+        std::string().swap(slot.payload);
+    }
+
+    // Release the slot before passing the message on
+    slot.sequence.store(pos + mask + 1, std::memory_order_release);
+    tail.store(pos + 1, std::memory_order_relaxed);
+
+    if (sink.should_log(msg.level)) {
+        sink.log(msg);
+    }
+    return true;
+}
+
+bool AsyncSink::Queue::empty() const {
+    return head.load() == tail.load();
+}
+
+AsyncSink::AsyncSink(std::shared_ptr<spdlog::sinks::sink> sink,
+                     size_t queueSize,
+                     OverflowPolicy policy)
+    : sink(std::move(sink)), policy(policy) {
+    const auto nqueues = std::max(
+            size_t(1), std::min(cb::get_available_cpu_count(), MaxQueues));
+    for (size_t ii = 0; ii < nqueues; ++ii) {
+        queues.emplace_back(std::make_unique<Queue>(
+                std::max(size_t(64), queueSize / nqueues)));
+    }
+
+    if (cb_create_named_thread(&writer,
+                               [](void* arg) {
+                                   static_cast<AsyncSink*>(arg)->run();
+                               },
+                               this,
+                               0,
+                               "mc:logger") != 0) {
+        throw std::runtime_error("AsyncSink: failed to create writer thread");
+    }
+    running = true;
+}
+
+AsyncSink::~AsyncSink() {
+    shutdown();
+}
+
+AsyncSink::Queue& AsyncSink::getQueue() {
+    static std::atomic<size_t> nextIndex{0};
+    static thread_local const size_t index = nextIndex++;
+    return *queues[index % queues.size()];
+}
+
+void AsyncSink::log(const spdlog::details::log_msg& msg) {
+    if (stopping) {
+        dropped++;
+        return;
+    }
+
+    auto& queue = getQueue();
+    if (!queue.tryPush(msg)) {
+        const bool wait = policy == OverflowPolicy::Block ||
+                          msg.level >= spdlog::level::err ||
+                          (policy == OverflowPolicy::Sample &&
+                           (overflows++ % SampleRate) == 0);
+        if (!wait) {
+            dropped++;
+            return;
+        }
+
+        do {
+            wakeWriter();
+            std::this_thread::yield();
+            if (stopping) {
+                dropped++;
+                return;
+            }
+        } while (!queue.tryPush(msg));
+    }
+    wakeWriter();
+}
+
+void AsyncSink::wakeWriter() {
+    // Pairs with the writer setting writerWaiting before checking the
+    // queues; either we see the flag or the writer sees our message
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (writerWaiting) {
+        std::lock_guard<std::mutex> guard(mutex);
+        cond.notify_one();
+    }
+}
+
+void AsyncSink::flush() {
+    flushRequests++;
+    wakeWriter();
+}
+
+void AsyncSink::set_pattern(const std::string& pattern) {
+    sink->set_pattern(pattern);
+}
+
+void AsyncSink::set_formatter(std::unique_ptr<spdlog::formatter> formatter) {
+    sink->set_formatter(std::move(formatter));
+}
+
+void AsyncSink::shutdown() {
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (!running) {
+            return;
+        }
+        running = false;
+        stopping = true;
+        cond.notify_one();
+    }
+    cb_join_thread(writer);
+}
+
+bool AsyncSink::drain() {
+    bool ret = false;
+    for (auto& queue : queues) {
+        while (queue->tryPop(*sink, &name)) {
+            ret = true;
+        }
+    }
+    return ret;
+}
+
+void AsyncSink::reportDropped() {
+    const auto total = dropped.load();
+    if (total == reportedDropped) {
+        return;
+    }
+
+    spdlog::details::log_msg msg;
+    msg.logger_name = &name;
+    msg.level = spdlog::level::warn;
+    msg.time = spdlog::details::os::now();
+    msg.thread_id = spdlog::details::os::thread_id();
+    spdlog::details::fmt_helper::append_str(
+            "Logger: dropped " + std::to_string(total - reportedDropped) +
+                    " messages as the log queue was full",
+            msg.raw);
+    reportedDropped = total;
+    sink->log(msg);
+}
+
+void AsyncSink::run() {
+    for (;;) {
+        const bool found = drain();
+        reportDropped();
+
+        const auto requests = flushRequests.load();
+        if (requests != flushesDone) {
+            sink->flush();
+            flushesDone = requests;
+        }
+
+        if (found) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        if (stopping) {
+            break;
+        }
+        writerWaiting = true;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (std::all_of(queues.begin(),
+                        queues.end(),
+                        [](const auto& q) { return q->empty(); }) &&
+            flushRequests.load() == flushesDone) {
+            // The timeout is only a safety net; the producers wake us
+            cond.wait_for(lock, std::chrono::milliseconds(100));
+        }
+        writerWaiting = false;
+    }
+
+    // We've been told to stop; write whatever is left
+    drain();
+    reportDropped();
+    sink->flush();
+}
+
+} // namespace logger
+} // namespace cb
@@ -0,0 +1,164 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include "logger_config.h"
+
+#include <platform/platform_thread.h>
+#include <spdlog/sinks/sink.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace cb {
+namespace logger {
+
+/**
+ * A sink which hands the log messages over to a dedicated thread which
+ * passes them on to the real sink (which formats them and writes them to
+ * the file and console).
+ *
+ * Unlike spdlog's async logger (which use a single queue protected by a
+ * mutex) the messages are added to one of a number of bounded lock-free
+ * queues picked by the logging thread, so a burst of log messages from
+ * many threads doesn't make them serialize on a lock. What happens when
+ * a queue is full is controlled by the OverflowPolicy.
+ */
+class AsyncSink : public spdlog::sinks::sink {
+public:
+    /**
+     * @param sink the sink to pass the messages on to
+     * @param queueSize the total number of messages to buffer
+     * @param policy what to do when the queue is full
+     */
+    AsyncSink(std::shared_ptr<spdlog::sinks::sink> sink,
+              size_t queueSize,
+              OverflowPolicy policy);
+
+    ~AsyncSink() override;
+
+    void log(const spdlog::details::log_msg& msg) override;
+
+    /// Ask the writer thread to flush the sink once it has written all
+    /// of the queued messages. Doesn't wait for the flush to happen.
+    void flush() override;
+
+    void set_pattern(const std::string& pattern) override;
+    void set_formatter(std::unique_ptr<spdlog::formatter> formatter) override;
+
+    /**
+     * Write all of the queued messages, flush the sink and stop the
+     * writer thread. Messages logged after this are dropped.
+     */
+    void shutdown();
+
+    /// The number of messages dropped as the queue was full
+    uint64_t getDroppedMessages() const {
+        return dropped.load(std::memory_order_relaxed);
+    }
+
+    /// For the Sample policy; the fraction of the messages to keep
+    static constexpr uint64_t SampleRate = 100;
+
+protected:
+    /**
+     * A bounded multi-producer queue of log messages (the algorithm is
+     * Dmitry Vyukov's bounded MPMC queue). The messages are copied into
+     * the preallocated slots (reusing the memory of the slot's string)
+     * so we don't allocate memory for every message.
+     */
+    class Queue {
+    public:
+        explicit Queue(size_t size);
+
+        /// Try to add the message (returns false if the queue is full)
+        bool tryPush(const spdlog::details::log_msg& msg);
+
+        /**
+         * Pop the oldest message and pass it to the provided sink (only
+         * one thread may call this at a time)
+         *
+         * @return false if the queue was empty
+         */
+        bool tryPop(spdlog::sinks::sink& sink, const std::string* name);
+
+        bool empty() const;
+
+    protected:
+        struct Slot {
+            std::atomic<size_t> sequence{0};
+            spdlog::level::level_enum level;
+            spdlog::log_clock::time_point time;
+            size_t thread_id;
+            std::string payload;
+        };
+
+        std::unique_ptr<Slot[]> slots;
+        const size_t mask;
+        alignas(64) std::atomic<size_t> head{0};
+        alignas(64) std::atomic<size_t> tail{0};
+    };
+
+    /// Get the queue the calling thread should use
+    Queue& getQueue();
+
+    /// Wake up the writer thread if it is waiting for messages
+    void wakeWriter();
+
+    /// The main loop of the writer thread
+    void run();
+
+    /// Move the queued messages to the sink, returns true if any was found
+    bool drain();
+
+    /// Log a warning about the messages dropped since the last time
+    void reportDropped();
+
+    const std::shared_ptr<spdlog::sinks::sink> sink;
+    const OverflowPolicy policy;
+    /// The name put in the messages we pass on (we don't track the
+    /// logger the message came from)
+    const std::string name{"async_sink"};
+
+    std::vector<std::unique_ptr<Queue>> queues;
+
+    std::atomic<uint64_t> dropped{0};
+    /// The number of dropped messages we've already reported
+    uint64_t reportedDropped{0};
+    /// For the Sample policy; the number of times the queue was full
+    std::atomic<uint64_t> overflows{0};
+
+    /// Incremented every time someone calls flush()
+    std::atomic<uint64_t> flushRequests{0};
+    /// The last flush request the writer handled
+    uint64_t flushesDone{0};
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::atomic_bool writerWaiting{false};
+    std::atomic_bool stopping{false};
+    bool running{false};
+    cb_thread_t writer = {};
+};
+
+} // namespace logger
+} // namespace cb
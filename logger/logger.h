@@ -155,6 +155,13 @@ void flush();
 LOGGER_PUBLIC_API
 void shutdown();
 
+/**
+ * @return the number of log messages dropped as the logging queue was full
+ *         (see Config::overflow_policy)
+ */
+LOGGER_PUBLIC_API
+uint64_t getDroppedMessageCount();
+
 /**
  * @return whether or not the logger has been initialized
  */
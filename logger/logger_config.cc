@@ -19,12 +19,45 @@
 
 #include <nlohmann/json.hpp>
 
+#include <stdexcept>
+
 namespace cb {
 namespace logger {
 
+std::string to_string(OverflowPolicy policy) {
+    switch (policy) {
+    case OverflowPolicy::Block:
+        return "block";
+    case OverflowPolicy::Drop:
+        return "drop";
+    case OverflowPolicy::Sample:
+        return "sample";
+    }
+    throw std::invalid_argument(
+            "cb::logger::to_string(OverflowPolicy): Invalid policy " +
+            std::to_string(int(policy)));
+}
+
+OverflowPolicy to_overflow_policy(const std::string& policy) {
+    if (policy == "block") {
+        return OverflowPolicy::Block;
+    }
+    if (policy == "drop") {
+        return OverflowPolicy::Drop;
+    }
+    if (policy == "sample") {
+        return OverflowPolicy::Sample;
+    }
+    throw std::invalid_argument(
+            "cb::logger::to_overflow_policy: Unknown policy \"" + policy +
+            "\"");
+}
+
 Config::Config(const nlohmann::json& json) {
     filename = json.value("filename", filename);
     buffersize = json.value("buffersize", buffersize);
+    overflow_policy = to_overflow_policy(
+            json.value("overflow_policy", to_string(overflow_policy)));
     cyclesize = json.value("cyclesize", cyclesize);
     unit_test = json.value("unit_test", unit_test);
     console = json.value("console", console);
@@ -33,6 +66,7 @@ Config::Config(const nlohmann::json& json) {
 bool Config::operator==(const Config& other) const {
     return (this->filename == other.filename) &&
            (this->buffersize == other.buffersize) &&
+           (this->overflow_policy == other.overflow_policy) &&
            (this->cyclesize == other.cyclesize) &&
            (this->unit_test == other.unit_test) &&
            (this->console == other.console);
@@ -26,6 +26,27 @@
 namespace cb {
 namespace logger {
 
+/**
+ * What to do with a log message when the queue to the thread writing
+ * the log messages is full. Messages at error level and above are
+ * never dropped.
+ */
+enum class OverflowPolicy {
+    /// Wait for the writer to make space for the message
+    Block,
+    /// Drop the message
+    Drop,
+    /// Wait for space for every 100th message, and drop the rest
+    Sample
+};
+
+LOGGER_PUBLIC_API
+std::string to_string(OverflowPolicy policy);
+
+/// @throws std::invalid_argument for unknown policies
+LOGGER_PUBLIC_API
+OverflowPolicy to_overflow_policy(const std::string& policy);
+
 struct LOGGER_PUBLIC_API Config {
     Config() = default;
     explicit Config(const nlohmann::json& json);
@@ -38,6 +59,8 @@ struct LOGGER_PUBLIC_API Config {
     std::string filename;
     /// 8192 item size for the logging queue. This is equivalent to 2 MB
     size_t buffersize = 8192;
+    /// What to do when the logging queue is full
+    OverflowPolicy overflow_policy = OverflowPolicy::Block;
     /// 100 MB per cycled file
     size_t cyclesize = 100 * 1024 * 1024;
     /// if running in a unit test or not
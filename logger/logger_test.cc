@@ -247,3 +247,54 @@ TEST_F(SpdloggerTest, ShutdownRace) {
     EXPECT_EQ(1, countInFile(files.front(), "CRITICAL and this one"));
     EXPECT_EQ(1, countInFile(files.front(), "CRITICAL " + str));
 }
+
+/**
+ * Test that the async logger drops messages when the queue is full with
+ * the drop policy (and keeps track of how many), but never drops errors.
+ */
+TEST_F(SpdloggerTest, AsyncDropPolicy) {
+    cb::logger::shutdown();
+    RemoveFiles();
+    config.unit_test = false;
+    config.buffersize = 64;
+    config.overflow_policy = cb::logger::OverflowPolicy::Drop;
+    setUpLogger();
+
+    const int count = 2000;
+    for (int ii = 0; ii < count; ++ii) {
+        LOG_INFO("info message {}", ii);
+        LOG_CRITICAL("critical message {}", ii);
+    }
+
+    // All of the messages have either been queued or dropped at this point
+    const auto dropped = cb::logger::getDroppedMessageCount();
+    cb::logger::shutdown();
+
+    const auto content = getLogContents();
+    auto countIn = [&content](const std::string& msg) {
+        size_t ret = 0;
+        for (auto pos = content.find(msg); pos != std::string::npos;
+             pos = content.find(msg, pos + msg.size())) {
+            ++ret;
+        }
+        return ret;
+    };
+    EXPECT_EQ(count, countIn("CRITICAL critical message"));
+    EXPECT_EQ(count, countIn("INFO info message") + dropped);
+    if (dropped != 0) {
+        EXPECT_EQ(1, countIn("messages as the log queue was full"));
+    }
+}
+
+TEST(OverflowPolicyTest, ToString) {
+    using cb::logger::OverflowPolicy;
+    for (const auto policy : {OverflowPolicy::Block,
+                              OverflowPolicy::Drop,
+                              OverflowPolicy::Sample}) {
+        EXPECT_EQ(policy,
+                  cb::logger::to_overflow_policy(
+                          cb::logger::to_string(policy)));
+    }
+    EXPECT_THROW(cb::logger::to_overflow_policy("wait"),
+                 std::invalid_argument);
+}
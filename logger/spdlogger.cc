@@ -14,14 +14,13 @@
  *   See the License for the specific language governing permissions and
  *   limitations under the License.
  */
+#include "async_sink.h"
 #include "custom_rotating_file_sink.h"
 
 #include "logger.h"
 #include "logger_config.h"
 
 #include <memcached/engine.h>
-#include <spdlog/async.h>
-#include <spdlog/async_logger.h>
 #include <spdlog/sinks/ansicolor_sink.h>
 #include <spdlog/sinks/dist_sink.h>
 #include <spdlog/sinks/null_sink.h>
@@ -50,6 +49,12 @@ static const std::string log_pattern{"%^%Y-%m-%dT%T.%f%z %l %v%$"};
  */
 static std::shared_ptr<spdlog::logger> file_logger;
 
+/**
+ * The sink passing the messages from file_logger to the thread writing them
+ * (not used in unit test mode).
+ */
+static std::shared_ptr<cb::logger::AsyncSink> async_sink;
+
 LOGGER_PUBLIC_API
 void cb::logger::flush() {
     if (file_logger) {
@@ -64,18 +69,24 @@ void cb::logger::shutdown() {
     flush();
 
     /**
-     * This will drop all spdlog instances from the registry, and destruct the
-     * thread pool which will post terminate message(s) (one per thread) to the
-     * thread pool message queue. The calling thread will then block until all
-     * thread pool workers have joined. This ensures that any messages queued
-     * before shutdown is called will be flushed to disk. Any messages that are
-     * queued after the final terminate message will not be logged.
+     * Write all of the messages queued before shutdown was called to disk
+     * and stop the thread writing them. Any messages logged after this
+     * will be dropped.
      *
-     * If the logger is running in unit test mode (synchronous) then this is a
-     * no-op.
+     * If the logger is running in unit test mode (synchronous) then there
+     * is no async sink.
+     */
+    if (async_sink) {
+        async_sink->shutdown();
+    }
+
+    /**
+     * This will drop all spdlog instances from the registry (and stop the
+     * periodic flusher).
      */
     spdlog::details::registry::instance().shutdown();
     file_logger.reset();
+    async_sink.reset();
 }
 
 LOGGER_PUBLIC_API
@@ -154,17 +165,15 @@ boost::optional<std::string> cb::logger::initialize(
         if (logger_settings.unit_test) {
             file_logger = std::make_shared<spdlog::logger>(logger_name, sink);
         } else {
-            // Create the default thread pool for async logging
-            spdlog::init_thread_pool(buffersz, 1);
-
-            // Get the thread pool so that we can actually construct the
-            // object with already created sinks...
-            auto tp = spdlog::thread_pool();
-            file_logger = std::make_shared<spdlog::async_logger>(
-                    logger_name,
-                    sink,
-                    tp,
-                    spdlog::async_overflow_policy::block);
+            // The logging threads add the messages to the async sink which
+            // passes them on to the dist_sink in its own thread
+            if (async_sink) {
+                async_sink->shutdown();
+            }
+            async_sink = std::make_shared<cb::logger::AsyncSink>(
+                    sink, buffersz, logger_settings.overflow_policy);
+            file_logger =
+                    std::make_shared<spdlog::logger>(logger_name, async_sink);
         }
 
         file_logger->set_pattern(log_pattern);
@@ -186,10 +195,19 @@ spdlog::logger* cb::logger::get() {
     return file_logger.get();
 }
 
+LOGGER_PUBLIC_API
+uint64_t cb::logger::getDroppedMessageCount() {
+    return async_sink ? async_sink->getDroppedMessages() : 0;
+}
+
 LOGGER_PUBLIC_API
 void cb::logger::reset() {
     spdlog::drop(logger_name);
     file_logger.reset();
+    if (async_sink) {
+        async_sink->shutdown();
+        async_sink.reset();
+    }
 }
 
 void cb::logger::createBlackholeLogger() {
@@ -974,6 +974,8 @@ static void usage() {
     printf("-v                           verbose output\n");
     printf("-X                           Use stderr logger instead of /dev/zero\n");
     printf("-n                           Regex specifying name(s) of test(s) to run\n");
+    printf("-f <format>                  Output format of the test results\n");
+    printf("                             (text, xml or json).\n");
 }
 
 static int report_test(const char* name,
@@ -1409,7 +1411,7 @@ int main(int argc, char **argv) {
                        "C:" /* Test case id */
                        "s" /* spinlock the program */
                        "X" /* Use stderr logger */
-                       "f:" /* output format. Valid values are: 'text' and 'xml' */
+                       "f:" /* output format. Valid values are: 'text', 'xml' and 'json' */
                        )) != -1) {
         switch (c) {
         case 'a':
@@ -1436,9 +1438,11 @@ int main(int argc, char **argv) {
                 harness.output_format = OutputFormat::Text;
             } else if (std::string(optarg) == "xml") {
                 harness.output_format = OutputFormat::XML;
+            } else if (std::string(optarg) == "json") {
+                harness.output_format = OutputFormat::JSON;
             } else {
                 fprintf(stderr, "Invalid option for output format '%s'. Valid "
-                    "options are 'text' and 'xml'.\n", optarg);
+                    "options are 'text', 'xml' and 'json'.\n", optarg);
                 return 1;
             }
             break;
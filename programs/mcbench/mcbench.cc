@@ -0,0 +1,746 @@
+/* -*- Mode: C; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * mcbench is a load generator measuring the end-to-end latency of a
+ * running memcached. Each thread drives one connection with a mix of
+ * get, set, durable set and subdoc lookup requests, keeping up to the
+ * requested pipeline depth of requests in flight.
+ *
+ * When a target rate is given the requests follow a fixed schedule
+ * (open loop) and the latency of a request is measured from the time it
+ * was scheduled to be sent rather than the time it actually was sent.
+ * A stalled server thus shows up in the latency of every request which
+ * should have been sent while it was stalled, and not only in the one
+ * request the client was waiting for (coordinated omission).
+ */
+
+#include <getopt.h>
+#include <memcached/durability_spec.h>
+#include <nlohmann/json.hpp>
+#include <programs/getpass.h>
+#include <programs/hostname_utils.h>
+#include <protocol/connection/client_connection.h>
+#include <protocol/connection/client_mcbp_commands.h>
+#include <protocol/connection/frameinfo.h>
+#include <utilities/hdrhistogram.h>
+#include <utilities/terminate_handler.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <thread>
+
+using namespace std::chrono;
+
+enum class Op { Get, Set, DurableSet, Subdoc };
+static constexpr size_t NumOps = 4;
+
+static const char* to_string(Op op) {
+    switch (op) {
+    case Op::Get:
+        return "get";
+    case Op::Set:
+        return "set";
+    case Op::DurableSet:
+        return "durable_set";
+    case Op::Subdoc:
+        return "subdoc_get";
+    }
+    return "unknown";
+}
+
+struct Config {
+    std::string port{"11210"};
+    std::string host{"localhost"};
+    std::string user;
+    std::string password;
+    std::string bucket;
+    std::string ssl_cert;
+    std::string ssl_key;
+    sa_family_t family = AF_UNSPEC;
+    bool secure = false;
+
+    size_t threads = 1;
+    /// Requests per second over all threads (0 == as fast as possible)
+    uint64_t rate = 0;
+    seconds duration{10};
+    size_t pipeline = 1;
+    size_t keys = 10000;
+    /// Zipf exponent of the key popularity (0 == uniform)
+    double zipf = 0;
+    size_t minValueSize = 256;
+    size_t maxValueSize = 256;
+    /// Relative weights of get, set and subdoc requests
+    unsigned getWeight = 90;
+    unsigned setWeight = 10;
+    unsigned subdocWeight = 0;
+    /// Percentage of the sets which carry durability requirements
+    unsigned durablePercent = 0;
+    cb::durability::Level level = cb::durability::Level::Majority;
+    Vbid vbucket{0};
+    bool populate = false;
+    std::string keyPrefix{"mcbench-"};
+    std::string jsonFile;
+};
+
+/// The latencies and failures of each kind of request of a thread
+struct Results {
+    std::array<Hdr2sfMicroSecHistogram, NumOps> latency;
+    std::array<uint64_t, NumOps> errors{};
+
+    Results& operator+=(const Results& other) {
+        for (size_t ii = 0; ii < NumOps; ++ii) {
+            latency[ii] += other.latency[ii];
+            errors[ii] += other.errors[ii];
+        }
+        return *this;
+    }
+};
+
+/**
+ * Picks the keys of the requests, either uniformly or following a zipf
+ * distribution where key 0 is the most popular one.
+ */
+class KeyChooser {
+public:
+    KeyChooser(size_t keys, double zipf) : keys(keys) {
+        if (zipf > 0) {
+            cdf.reserve(keys);
+            double sum = 0;
+            for (size_t ii = 0; ii < keys; ++ii) {
+                sum += 1.0 / std::pow(double(ii + 1), zipf);
+                cdf.push_back(sum);
+            }
+            for (auto& p : cdf) {
+                p /= sum;
+            }
+        }
+    }
+
+    template <class Generator>
+    size_t next(Generator& gen) const {
+        if (cdf.empty()) {
+            std::uniform_int_distribution<size_t> dist(0, keys - 1);
+            return dist(gen);
+        }
+        std::uniform_real_distribution<double> dist(0, 1);
+        auto it = std::lower_bound(cdf.begin(), cdf.end(), dist(gen));
+        return std::min(size_t(it - cdf.begin()), cdf.size() - 1);
+    }
+
+private:
+    const size_t keys;
+    std::vector<double> cdf;
+};
+
+static std::unique_ptr<MemcachedConnection> connect(const Config& config) {
+    in_port_t in_port;
+    sa_family_t fam;
+    std::string host;
+    std::tie(host, in_port, fam) =
+            cb::inet::parse_hostname(config.host, config.port);
+    auto family = config.family;
+    if (family == AF_UNSPEC) { // The user may have used -4 or -6
+        family = fam;
+    }
+
+    auto connection = std::make_unique<MemcachedConnection>(
+            host, in_port, family, config.secure);
+    connection->setSslCertFile(config.ssl_cert);
+    connection->setSslKeyFile(config.ssl_key);
+    connection->connect();
+
+    // MEMCACHED_VERSION contains the git sha
+    connection->hello("mcbench", MEMCACHED_VERSION, "load generator");
+    connection->setXerrorSupport(true);
+    connection->setDatatypeJson(true);
+    if (config.durablePercent > 0) {
+        connection->setFeature(cb::mcbp::Feature::AltRequestSupport, true);
+        connection->setFeature(cb::mcbp::Feature::SyncReplication, true);
+    }
+
+    if (!config.user.empty()) {
+        connection->authenticate(config.user,
+                                 config.password,
+                                 connection->getSaslMechanisms());
+    }
+    if (!config.bucket.empty()) {
+        connection->selectBucket(config.bucket);
+    }
+    return connection;
+}
+
+/**
+ * Builds the JSON documents stored by the sets; {"pad":"xxx..."} padded
+ * to the requested size (subdoc lookups read the "pad" path).
+ */
+static std::string makeValue(size_t size) {
+    const std::string head = R"({"pad":")";
+    const std::string tail = R"("})";
+    const auto overhead = head.size() + tail.size();
+    return head + std::string(size > overhead ? size - overhead : 0, 'x') +
+           tail;
+}
+
+class Worker {
+public:
+    Worker(const Config& config,
+           const KeyChooser& keys,
+           std::unique_ptr<MemcachedConnection> connection,
+           uint64_t seed)
+        : config(config),
+          keys(keys),
+          connection(std::move(connection)),
+          gen(seed) {
+    }
+
+    void run(steady_clock::time_point start) {
+        const auto end = start + config.duration;
+        // Each thread sends its share of the requested rate
+        const nanoseconds interval(
+                config.rate ? int64_t(1e9 * config.threads / config.rate)
+                            : 0);
+        auto nextIntended = start;
+
+        struct Outstanding {
+            Op op;
+            steady_clock::time_point intended;
+        };
+        std::deque<Outstanding> inflight;
+        BinprotResponse response;
+
+        std::this_thread::sleep_until(start);
+        while (true) {
+            const auto now = steady_clock::now();
+            // An open loop run sends every request scheduled before the
+            // end, even when it falls behind the schedule
+            const bool due = interval.count() == 0
+                                     ? now < end
+                                     : nextIntended < end &&
+                                               now >= nextIntended;
+            if (due && inflight.size() < config.pipeline) {
+                const auto op = chooseOp();
+                send(op);
+                inflight.push_back(
+                        {op, interval.count() == 0 ? now : nextIntended});
+                nextIntended += interval;
+                continue;
+            }
+
+            if (!inflight.empty()) {
+                connection->recvResponse(response);
+                const auto done = steady_clock::now();
+                const auto& front = inflight.front();
+                const auto idx = size_t(front.op);
+                results.latency[idx].add(
+                        duration_cast<microseconds>(done - front.intended));
+                if (!response.isSuccess()) {
+                    ++results.errors[idx];
+                }
+                inflight.pop_front();
+                continue;
+            }
+
+            if (interval.count() == 0 || nextIntended >= end) {
+                break;
+            }
+            std::this_thread::sleep_until(nextIntended);
+        }
+    }
+
+    const Results& getResults() const {
+        return results;
+    }
+
+private:
+    Op chooseOp() {
+        const auto total =
+                config.getWeight + config.setWeight + config.subdocWeight;
+        std::uniform_int_distribution<unsigned> dist(0, total - 1);
+        const auto pick = dist(gen);
+        if (pick < config.getWeight) {
+            return Op::Get;
+        }
+        if (pick < config.getWeight + config.setWeight) {
+            std::uniform_int_distribution<unsigned> percent(0, 99);
+            return percent(gen) < config.durablePercent ? Op::DurableSet
+                                                        : Op::Set;
+        }
+        return Op::Subdoc;
+    }
+
+    void send(Op op) {
+        const auto key = config.keyPrefix + std::to_string(keys.next(gen));
+        switch (op) {
+        case Op::Get: {
+            BinprotGetCommand cmd;
+            cmd.setKey(key);
+            cmd.setVBucket(config.vbucket);
+            connection->sendCommand(cmd);
+            return;
+        }
+        case Op::Set:
+        case Op::DurableSet: {
+            std::uniform_int_distribution<size_t> size(config.minValueSize,
+                                                       config.maxValueSize);
+            BinprotMutationCommand cmd;
+            cmd.setMutationType(MutationType::Set);
+            cmd.setDatatype(cb::mcbp::Datatype::JSON);
+            cmd.setValue(makeValue(size(gen)));
+            cmd.setKey(key);
+            cmd.setVBucket(config.vbucket);
+            if (op == Op::DurableSet) {
+                cmd.addFrameInfo(DurabilityFrameInfo(config.level));
+            }
+            connection->sendCommand(cmd);
+            return;
+        }
+        case Op::Subdoc: {
+            BinprotSubdocCommand cmd(
+                    cb::mcbp::ClientOpcode::SubdocGet, key, "pad");
+            cmd.setVBucket(config.vbucket);
+            connection->sendCommand(cmd);
+            return;
+        }
+        }
+    }
+
+    const Config& config;
+    const KeyChooser& keys;
+    std::unique_ptr<MemcachedConnection> connection;
+    std::mt19937_64 gen;
+    Results results;
+};
+
+/// Store every key once (pipelined) so that gets and lookups hit
+static void populate(const Config& config, MemcachedConnection& connection) {
+    const auto value = makeValue(config.maxValueSize);
+    BinprotResponse response;
+    size_t inflight = 0;
+    uint64_t failed = 0;
+    for (size_t ii = 0; ii < config.keys; ++ii) {
+        BinprotMutationCommand cmd;
+        cmd.setMutationType(MutationType::Set);
+        cmd.setDatatype(cb::mcbp::Datatype::JSON);
+        cmd.setValue(value);
+        cmd.setKey(config.keyPrefix + std::to_string(ii));
+        cmd.setVBucket(config.vbucket);
+        connection.sendCommand(cmd);
+        if (++inflight == config.pipeline) {
+            for (; inflight > 0; --inflight) {
+                connection.recvResponse(response);
+                failed += response.isSuccess() ? 0 : 1;
+            }
+        }
+    }
+    for (; inflight > 0; --inflight) {
+        connection.recvResponse(response);
+        failed += response.isSuccess() ? 0 : 1;
+    }
+    if (failed) {
+        std::cerr << "mcbench: " << failed << " of " << config.keys
+                  << " sets failed while populating" << std::endl;
+    }
+}
+
+static const std::array<std::pair<const char*, double>, 5> percentiles = {
+        {{"p50", 50.0},
+         {"p90", 90.0},
+         {"p99", 99.0},
+         {"p99.9", 99.9},
+         {"p99.99", 99.99}}};
+
+static void printResults(const Results& results, duration<double> elapsed) {
+    uint64_t total = 0;
+    std::cout << std::left << std::setw(12) << "op" << std::right
+              << std::setw(10) << "count" << std::setw(8) << "errors";
+    for (const auto& p : percentiles) {
+        std::cout << std::setw(10) << p.first;
+    }
+    std::cout << std::setw(10) << "max" << std::endl;
+
+    for (size_t ii = 0; ii < NumOps; ++ii) {
+        const auto& hist = results.latency[ii];
+        if (hist.getValueCount() == 0) {
+            continue;
+        }
+        total += hist.getValueCount();
+        std::cout << std::left << std::setw(12) << to_string(Op(ii))
+                  << std::right << std::setw(10) << hist.getValueCount()
+                  << std::setw(8) << results.errors[ii];
+        for (const auto& p : percentiles) {
+            std::cout << std::setw(10) << hist.getValueAtPercentile(p.second);
+        }
+        std::cout << std::setw(10) << hist.getMaxValue() << std::endl;
+    }
+    std::cout << "(latencies in us)" << std::endl
+              << total << " ops in " << elapsed.count() << " s: "
+              << uint64_t(total / elapsed.count()) << " ops/s" << std::endl;
+}
+
+/**
+ * Write the percentiles in the format of Google Benchmark's JSON output
+ * so that scripts/benchmark2xml.py can convert them for CBNT; each
+ * percentile of each request type is reported as a test case.
+ */
+static void writeJson(const Results& results, const std::string& file) {
+    char date[64];
+    const auto now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", std::gmtime(&now));
+
+    nlohmann::json json;
+    json["context"]["date"] = date;
+    json["benchmarks"] = nlohmann::json::array();
+    for (size_t ii = 0; ii < NumOps; ++ii) {
+        const auto& hist = results.latency[ii];
+        if (hist.getValueCount() == 0) {
+            continue;
+        }
+        for (const auto& p : percentiles) {
+            const auto value = hist.getValueAtPercentile(p.second);
+            json["benchmarks"].push_back(
+                    {{"name",
+                      std::string("mcbench/") + to_string(Op(ii)) + "/" +
+                              p.first},
+                     {"iterations", hist.getValueCount()},
+                     {"real_time", value},
+                     {"cpu_time", value},
+                     {"time_unit", "us"},
+                     {"errors", results.errors[ii]}});
+        }
+    }
+
+    std::ofstream out(file);
+    out << json.dump(2) << std::endl;
+    if (!out) {
+        throw std::runtime_error("mcbench: failed to write " + file);
+    }
+}
+
+/// Parse "get=90,set=10,subdoc=0" into the weights of the request types
+static void parseMix(Config& config, const std::string& mix) {
+    config.getWeight = config.setWeight = config.subdocWeight = 0;
+    std::istringstream is(mix);
+    std::string entry;
+    while (std::getline(is, entry, ',')) {
+        const auto eq = entry.find('=');
+        if (eq == std::string::npos) {
+            throw std::invalid_argument("mcbench: invalid mix entry: " +
+                                        entry);
+        }
+        const auto name = entry.substr(0, eq);
+        const auto weight = unsigned(std::stoul(entry.substr(eq + 1)));
+        if (name == "get") {
+            config.getWeight = weight;
+        } else if (name == "set") {
+            config.setWeight = weight;
+        } else if (name == "subdoc") {
+            config.subdocWeight = weight;
+        } else {
+            throw std::invalid_argument("mcbench: unknown request type: " +
+                                        name);
+        }
+    }
+    if (config.getWeight + config.setWeight + config.subdocWeight == 0) {
+        throw std::invalid_argument("mcbench: the mix has no requests");
+    }
+}
+
+static cb::durability::Level parseLevel(const std::string& level) {
+    if (level == "majority") {
+        return cb::durability::Level::Majority;
+    }
+    if (level == "majorityAndPersistOnMaster") {
+        return cb::durability::Level::MajorityAndPersistOnMaster;
+    }
+    if (level == "persistToMajority") {
+        return cb::durability::Level::PersistToMajority;
+    }
+    throw std::invalid_argument("mcbench: unknown durability level: " +
+                                level);
+}
+
+/// Parse "min[:max]" into the range of the value sizes
+static void parseValueSize(Config& config, const std::string& size) {
+    const auto colon = size.find(':');
+    config.minValueSize = std::stoul(size.substr(0, colon));
+    config.maxValueSize = colon == std::string::npos
+                                  ? config.minValueSize
+                                  : std::stoul(size.substr(colon + 1));
+    if (config.minValueSize > config.maxValueSize) {
+        throw std::invalid_argument("mcbench: invalid value size range: " +
+                                    size);
+    }
+}
+
+static void usage() {
+    std::cerr << R"(Usage: mcbench [options]
+
+Options:
+
+  -h or --host hostname[:port]   The host (with an optional port) to connect to
+                                 (for IPv6 use: [address]:port if you'd like to
+                                 specify port)
+  -p or --port port              The port number to connect to
+  -b or --bucket bucketname      The name of the bucket to operate on
+  -u or --user username          The name of the user to authenticate as
+  -P or --password password      The passord to use for authentication
+                                 (use '-' to read from standard input)
+  -s or --ssl                    Connect to the server over SSL
+  -C or --ssl-cert filename      Read the SSL certificate from the specified file
+  -K or --ssl-key filename       Read the SSL private key from the specified file
+  -4 or --ipv4                   Connect over IPv4
+  -6 or --ipv6                   Connect over IPv6
+  -t or --threads num            Number of threads (one connection each) [1]
+  -r or --rate ops/s             Requests per second over all threads, sent
+                                 on a fixed schedule with latencies corrected
+                                 for coordinated omission
+                                 (0 sends as fast as possible) [0]
+  -d or --duration seconds       Time to run the workload for [10]
+  -D or --pipeline num           Requests each connection keeps in flight [1]
+  -k or --keys num               Number of distinct keys [10000]
+  -z or --zipf exponent          Zipf exponent of the key popularity
+                                 (0 is uniform) [0]
+  -v or --value-size min[:max]   Size (range) of the stored JSON documents
+                                 [256]
+  -m or --mix spec               Weights of the requests, for example
+                                 get=70,set=25,subdoc=5 [get=90,set=10]
+  --durable percent              Percentage of the sets sent with durability
+                                 requirements [0]
+  --durability-level level       majority, majorityAndPersistOnMaster or
+                                 persistToMajority [majority]
+  --vbucket vbid                 The vbucket all requests are sent to [0]
+  --populate                     Store every key before running the workload
+  --key-prefix prefix            The prefix of the keys [mcbench-]
+  --json filename                Also write the percentiles to the file in the
+                                 format of Google Benchmark's JSON output
+  --help                         This help text
+)";
+
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char** argv) {
+    // Make sure that we dump callstacks on the console
+    install_backtrace_terminate_handler();
+
+    int cmd;
+    Config config;
+
+    /* Initialize the socket subsystem */
+    cb_initialize_sockets();
+
+    enum Long {
+        Durable = 256,
+        DurabilityLevel,
+        Vbucket,
+        Populate,
+        KeyPrefix,
+        Json,
+    };
+
+    struct option long_options[] = {
+            {"ipv4", no_argument, nullptr, '4'},
+            {"ipv6", no_argument, nullptr, '6'},
+            {"host", required_argument, nullptr, 'h'},
+            {"port", required_argument, nullptr, 'p'},
+            {"bucket", required_argument, nullptr, 'b'},
+            {"password", required_argument, nullptr, 'P'},
+            {"user", required_argument, nullptr, 'u'},
+            {"ssl", no_argument, nullptr, 's'},
+            {"ssl-cert", required_argument, nullptr, 'C'},
+            {"ssl-key", required_argument, nullptr, 'K'},
+            {"threads", required_argument, nullptr, 't'},
+            {"rate", required_argument, nullptr, 'r'},
+            {"duration", required_argument, nullptr, 'd'},
+            {"pipeline", required_argument, nullptr, 'D'},
+            {"keys", required_argument, nullptr, 'k'},
+            {"zipf", required_argument, nullptr, 'z'},
+            {"value-size", required_argument, nullptr, 'v'},
+            {"mix", required_argument, nullptr, 'm'},
+            {"durable", required_argument, nullptr, Durable},
+            {"durability-level", required_argument, nullptr, DurabilityLevel},
+            {"vbucket", required_argument, nullptr, Vbucket},
+            {"populate", no_argument, nullptr, Populate},
+            {"key-prefix", required_argument, nullptr, KeyPrefix},
+            {"json", required_argument, nullptr, Json},
+            {"help", no_argument, nullptr, 0},
+            {nullptr, 0, nullptr, 0}};
+
+    try {
+        while ((cmd = getopt_long(argc,
+                                  argv,
+                                  "46h:p:u:b:P:sC:K:t:r:d:D:k:z:v:m:",
+                                  long_options,
+                                  nullptr)) != EOF) {
+            switch (cmd) {
+            case '6':
+                config.family = AF_INET6;
+                break;
+            case '4':
+                config.family = AF_INET;
+                break;
+            case 'h':
+                config.host.assign(optarg);
+                break;
+            case 'p':
+                config.port.assign(optarg);
+                break;
+            case 'b':
+                config.bucket.assign(optarg);
+                break;
+            case 'u':
+                config.user.assign(optarg);
+                break;
+            case 'P':
+                config.password.assign(optarg);
+                break;
+            case 's':
+                config.secure = true;
+                break;
+            case 'C':
+                config.ssl_cert.assign(optarg);
+                break;
+            case 'K':
+                config.ssl_key.assign(optarg);
+                break;
+            case 't':
+                config.threads = std::stoul(optarg);
+                break;
+            case 'r':
+                config.rate = std::stoull(optarg);
+                break;
+            case 'd':
+                config.duration = seconds(std::stoul(optarg));
+                break;
+            case 'D':
+                config.pipeline = std::stoul(optarg);
+                break;
+            case 'k':
+                config.keys = std::stoul(optarg);
+                break;
+            case 'z':
+                config.zipf = std::stod(optarg);
+                break;
+            case 'v':
+                parseValueSize(config, optarg);
+                break;
+            case 'm':
+                parseMix(config, optarg);
+                break;
+            case Durable:
+                config.durablePercent =
+                        std::min(100u, unsigned(std::stoul(optarg)));
+                break;
+            case DurabilityLevel:
+                config.level = parseLevel(optarg);
+                break;
+            case Vbucket:
+                config.vbucket = Vbid(uint16_t(std::stoul(optarg)));
+                break;
+            case Populate:
+                config.populate = true;
+                break;
+            case KeyPrefix:
+                config.keyPrefix.assign(optarg);
+                break;
+            case Json:
+                config.jsonFile.assign(optarg);
+                break;
+            default:
+                usage();
+                return EXIT_FAILURE;
+            }
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        usage();
+    }
+
+    if (config.threads == 0 || config.pipeline == 0 || config.keys == 0) {
+        std::cerr << "mcbench: threads, pipeline and keys must be non-zero"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (config.password == "-") {
+        config.password.assign(getpass());
+    } else if (config.password.empty()) {
+        const char* env_password = std::getenv("CB_PASSWORD");
+        if (env_password) {
+            config.password = env_password;
+        }
+    }
+
+    try {
+        const KeyChooser keys(config.keys, config.zipf);
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::random_device rd;
+        for (size_t ii = 0; ii < config.threads; ++ii) {
+            auto connection = connect(config);
+            if (ii == 0 && config.populate) {
+                populate(config, *connection);
+            }
+            workers.emplace_back(std::make_unique<Worker>(
+                    config, keys, std::move(connection), rd()));
+        }
+
+        // Give the threads a moment to start so they all begin together
+        const auto start = steady_clock::now() + milliseconds(100);
+        std::vector<std::thread> threads;
+        for (auto& worker : workers) {
+            threads.emplace_back([&worker, start]() {
+                try {
+                    worker->run(start);
+                } catch (const std::exception& ex) {
+                    std::cerr << "mcbench: worker failed: " << ex.what()
+                              << std::endl;
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        const duration<double> elapsed = steady_clock::now() - start;
+
+        Results results;
+        for (const auto& worker : workers) {
+            results += worker->getResults();
+        }
+        printResults(results, elapsed);
+        if (!config.jsonFile.empty()) {
+            writeJson(results, config.jsonFile);
+        }
+    } catch (const ConnectionError& ex) {
+        std::cerr << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    } catch (const std::runtime_error& ex) {
+        std::cerr << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -314,6 +314,59 @@ static void request_stat_timings(MemcachedConnection& connection,
     }
 }
 
+/**
+ * Print the per-opcode costs ("stats opcode_costs"): the average time the
+ * front end threads spent executing each command, the average time it spent
+ * blocked waiting for the engine and the average bytes allocated for it.
+ */
+static void request_opcode_costs(MemcachedConnection& connection,
+                                 const std::string& bucket,
+                                 bool json_output) {
+    const std::string key = bucket == "/all/" ? "opcode_costs aggregate"
+                                              : "opcode_costs";
+    std::map<std::string, std::string> map;
+    try {
+        map = connection.statsMap(key);
+    } catch (const ConnectionError& ex) {
+        if (ex.isAccessDenied()) {
+            std::cerr << "Not authorized to access opcode costs" << std::endl;
+        } else {
+            std::cerr << "Fatal error: " << ex.what() << std::endl;
+        }
+        exit(EXIT_FAILURE);
+    }
+
+    nlohmann::json costs = nlohmann::json::object();
+    for (const auto& entry : map) {
+        costs[entry.first] = nlohmann::json::parse(entry.second);
+    }
+
+    if (json_output) {
+        std::cout << costs.dump(JSON_DUMP_INDENT_SIZE) << std::endl;
+        return;
+    }
+
+    printf("%-28s %14s %14s %14s %14s\n",
+           "Opcode",
+           "Operations",
+           "Exec us/op",
+           "Blocked us/op",
+           "Alloc B/op");
+    for (auto it = costs.begin(); it != costs.end(); ++it) {
+        const auto count = it.value()["count"].get<uint64_t>();
+        if (count == 0) {
+            continue;
+        }
+        const double ops = double(count);
+        printf("%-28s %14" PRIu64 " %14.2f %14.2f %14.0f\n",
+               it.key().c_str(),
+               count,
+               it.value()["execution_ns"].get<uint64_t>() / ops / 1000,
+               it.value()["blocked_ns"].get<uint64_t>() / ops / 1000,
+               it.value()["allocated_bytes"].get<uint64_t>() / ops);
+    }
+}
+
 void usage() {
     std::cerr << "Usage mctimings [options] [opcode / statname]\n"
               << R"(Options:
@@ -330,6 +383,9 @@ void usage() {
   -v or --verbose                Use verbose output
   -S                             Read password from standard input
   -j or --json[=pretty]          Print JSON instead of histograms
+  -c or --costs                  Print the average execution time, blocked
+                                 time and bytes allocated per operation for
+                                 each opcode instead of the timings
   --help                         This help text
 
 )" << std::endl
@@ -338,6 +394,12 @@ void usage() {
               << "Example:" << std::endl
               << "    mctimings --user operator --bucket /all/ --password - "
                  "--verbose GET SET"
+              << std::endl
+              << "    mctimings --user operator --bucket default --password - "
+                 "--verbose \"task-timings runtime Flusher\""
+              << std::endl
+              << "    mctimings --user operator --bucket default --password - "
+                 "--verbose \"vbucket_timings 12\""
               << std::endl;
 }
 
@@ -355,6 +417,7 @@ int main(int argc, char** argv) {
     bool verbose = false;
     bool secure = false;
     bool json = false;
+    bool costs = false;
 
     /* Initialize the socket subsystem */
     cb_initialize_sockets();
@@ -370,11 +433,12 @@ int main(int argc, char** argv) {
             {"ssl", no_argument, nullptr, 's'},
             {"verbose", no_argument, nullptr, 'v'},
             {"json", optional_argument, nullptr, 'j'},
+            {"costs", no_argument, nullptr, 'c'},
             {"help", no_argument, nullptr, 0},
             {nullptr, 0, nullptr, 0}};
 
     while ((cmd = getopt_long(
-                    argc, argv, "46h:p:u:b:P:sSvj", long_options, nullptr)) !=
+                    argc, argv, "46h:p:u:b:P:sSvjc", long_options, nullptr)) !=
            EOF) {
         switch (cmd) {
         case '6':
@@ -413,6 +477,9 @@ int main(int argc, char** argv) {
                 verbose = true;
             }
             break;
+        case 'c':
+            costs = true;
+            break;
         default:
             usage();
             return cmd == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
@@ -455,7 +522,9 @@ int main(int argc, char** argv) {
             connection.selectBucket(bucket);
         }
 
-        if (optind == argc) {
+        if (costs) {
+            request_opcode_costs(connection, bucket, json);
+        } else if (optind == argc) {
             for (int ii = 0; ii < 256; ++ii) {
                 request_cmd_timings(connection,
                                     bucket,
@@ -0,0 +1,129 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "client_pipeline.h"
+
+#include <mcbp/protocol/request.h>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+MemcachedPipeline::MemcachedPipeline(MemcachedConnection& connection,
+                                     size_t maxOutstanding)
+    : connection(connection), maxOutstanding(maxOutstanding) {
+    if (maxOutstanding == 0) {
+        throw std::invalid_argument(
+                "MemcachedPipeline: maxOutstanding must be greater than 0");
+    }
+}
+
+uint32_t MemcachedPipeline::enqueue(const BinprotCommand& command,
+                                    Callback callback) {
+    if (callbacks.size() >= maxOutstanding) {
+        // Make room for the request by reading the responses
+        flush();
+        while (callbacks.size() >= maxOutstanding) {
+            receive();
+        }
+    }
+
+    // encode() doesn't append to the buffer, so we need to copy it over
+    std::vector<uint8_t> encoded;
+    command.encode(encoded);
+    const auto opaque = next++;
+    reinterpret_cast<cb::mcbp::Request*>(encoded.data())->setOpaque(opaque);
+    if (!callbacks.emplace(opaque, std::move(callback)).second) {
+        throw std::runtime_error(
+                "MemcachedPipeline::enqueue: opaque " +
+                std::to_string(opaque) + " is already in use");
+    }
+    sendBuffer.insert(sendBuffer.end(), encoded.begin(), encoded.end());
+    ++queued;
+    return opaque;
+}
+
+std::future<BinprotResponse> MemcachedPipeline::enqueue(
+        const BinprotCommand& command) {
+    auto promise = std::make_shared<std::promise<BinprotResponse>>();
+    auto future = promise->get_future();
+    enqueue(command, [promise](BinprotResponse&& response) {
+        promise->set_value(std::move(response));
+    });
+    return future;
+}
+
+void MemcachedPipeline::flush() {
+    if (queued == 0) {
+        return;
+    }
+
+    Frame frame;
+    frame.payload.swap(sendBuffer);
+    queued = 0;
+    connection.sendFrame(frame);
+
+    // Keep the buffer around for the next batch
+    frame.reset();
+    sendBuffer.swap(frame.payload);
+}
+
+size_t MemcachedPipeline::poll() {
+    flush();
+    if (callbacks.empty()) {
+        return 0;
+    }
+
+    while (!receive()) {
+        // Not a response for one of our requests
+    }
+    return 1;
+}
+
+void MemcachedPipeline::drain() {
+    flush();
+    while (!callbacks.empty()) {
+        receive();
+    }
+}
+
+bool MemcachedPipeline::receive() {
+    Frame frame;
+    connection.recvFrame(frame);
+    if (frame.getMagic() == cb::mcbp::Magic::ServerRequest) {
+        if (serverRequestHandler) {
+            serverRequestHandler(std::move(frame));
+        }
+        return false;
+    }
+
+    const auto opaque = frame.getResponse()->getOpaque();
+    auto iter = callbacks.find(opaque);
+    if (iter == callbacks.end()) {
+        throw std::runtime_error(
+                "MemcachedPipeline::receive: Received response for unknown "
+                "opaque " +
+                std::to_string(opaque));
+    }
+    auto callback = std::move(iter->second);
+    callbacks.erase(iter);
+
+    BinprotResponse response;
+    response.assign(std::move(frame.payload));
+    if (callback) {
+        callback(std::move(response));
+    }
+    return true;
+}
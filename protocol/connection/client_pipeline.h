@@ -0,0 +1,145 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include "client_connection.h"
+#include "client_mcbp_commands.h"
+
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * The MemcachedPipeline allows for having many requests outstanding on
+ * a MemcachedConnection (which only offers a synchronous send a request
+ * and wait for the response model).
+ *
+ * The commands are encoded (with a unique opaque) into a send buffer when
+ * they are queued, and all of the queued commands are sent in a single
+ * write by flush(). The responses are read by poll() and drain() and
+ * matched with their request by the opaque (so that they may arrive in
+ * any order if the connection use unordered execution), before the
+ * callback for the request is called (or its future is set).
+ *
+ * The pipeline doesn't use any threads; the responses are only read
+ * while the caller is in poll() or drain() (so one should never wait
+ * for a future before calling drain()). To avoid the client and server
+ * both blocking on writing when the client sends more than the socket
+ * buffers can hold, no more than maxOutstanding requests are sent
+ * before the responses are read.
+ *
+ *     MemcachedPipeline pipeline(connection);
+ *     BinprotGetCommand cmd;
+ *     for (const auto& key : keys) {
+ *         cmd.setKey(key);
+ *         pipeline.enqueue(cmd, [](BinprotResponse&& rsp) { ... });
+ *     }
+ *     pipeline.drain();
+ */
+class MemcachedPipeline {
+public:
+    using Callback = std::function<void(BinprotResponse&&)>;
+
+    /**
+     * Create a new pipeline
+     *
+     * @param connection the connection to send the commands on (must
+     *                   outlive the pipeline, and must not be used for
+     *                   anything else while there are requests outstanding)
+     * @param maxOutstanding the maximum number of requests sent without
+     *                       reading their responses
+     */
+    explicit MemcachedPipeline(MemcachedConnection& connection,
+                               size_t maxOutstanding = 512);
+
+    MemcachedPipeline(const MemcachedPipeline&) = delete;
+
+    /**
+     * Queue a command to be sent with the next flush(). The pipeline is
+     * flushed (and responses read) if there would be more than
+     * maxOutstanding requests outstanding.
+     *
+     * @param command the command to send (it is encoded, so it may be
+     *                released when the method returns)
+     * @param callback the callback to call with the response
+     * @return the opaque used for the request
+     */
+    uint32_t enqueue(const BinprotCommand& command, Callback callback);
+
+    /**
+     * Queue a command to be sent with the next flush()
+     *
+     * @return a future for the response (it isn't ready until the
+     *         response is read by poll() or drain())
+     */
+    std::future<BinprotResponse> enqueue(const BinprotCommand& command);
+
+    /// Send all of the queued commands (in a single write)
+    void flush();
+
+    /**
+     * Flush the queued commands and wait for at least one response if
+     * any requests are outstanding
+     *
+     * @return the number of responses processed
+     */
+    size_t poll();
+
+    /// Flush the queued commands and wait for all of the responses
+    void drain();
+
+    /// Get the number of requests queued or sent without a response
+    size_t getOutstanding() const {
+        return callbacks.size();
+    }
+
+    /**
+     * Set the callback to call for requests sent from the server (with
+     * duplex enabled). By default they are ignored.
+     */
+    void setServerRequestHandler(std::function<void(Frame&&)> handler) {
+        serverRequestHandler = std::move(handler);
+    }
+
+protected:
+    /**
+     * Read a single frame from the server and dispatch it
+     *
+     * @return true if it was a response to one of our requests
+     * @throws std::runtime_error if it is a response to an unknown request
+     */
+    bool receive();
+
+    MemcachedConnection& connection;
+    const size_t maxOutstanding;
+
+    /// The next opaque to use
+    uint32_t next = 0;
+
+    /// The number of queued requests not sent yet
+    size_t queued = 0;
+
+    /// The encoded commands not sent yet
+    std::vector<uint8_t> sendBuffer;
+
+    /// The callbacks for the outstanding requests, keyed by the opaque
+    std::unordered_map<uint32_t, Callback> callbacks;
+
+    std::function<void(Frame&&)> serverRequestHandler;
+};
@@ -113,6 +113,7 @@ bool is_valid_opcode(ClientOpcode opcode) {
     case ClientOpcode::DcpSeqnoAcknowledged:
     case ClientOpcode::DcpCommit:
     case ClientOpcode::DcpAbort:
+    case ClientOpcode::DcpStreamReqMulti:
     case ClientOpcode::StopPersistence:
     case ClientOpcode::StartPersistence:
     case ClientOpcode::SetParam:
@@ -173,6 +174,13 @@ bool is_valid_opcode(ClientOpcode opcode) {
     case ClientOpcode::SubdocMultiLookup:
     case ClientOpcode::SubdocMultiMutation:
     case ClientOpcode::SubdocGetCount:
+    case ClientOpcode::RangeScan:
+    case ClientOpcode::GetMulti:
+    case ClientOpcode::SetMulti:
+    case ClientOpcode::GetMetaMulti:
+    case ClientOpcode::SetWithMetaMulti:
+    case ClientOpcode::VbucketSnapshot:
+    case ClientOpcode::VbucketInstall:
     case ClientOpcode::Scrub:
     case ClientOpcode::IsaslRefresh:
     case ClientOpcode::SslCertsRefresh:
@@ -198,6 +206,7 @@ bool is_valid_opcode(ServerOpcode opcode) {
     case ServerOpcode::ClustermapChangeNotification:
     case ServerOpcode::Authenticate:
     case ServerOpcode::ActiveExternalUsers:
+    case ServerOpcode::StatsPush:
         return true;
     }
     return false;
@@ -382,6 +391,8 @@ std::string to_string(cb::mcbp::ClientOpcode opcode) {
         return "DCP_COMMIT";
     case ClientOpcode::DcpAbort:
         return "DCP_ABORT";
+    case ClientOpcode::DcpStreamReqMulti:
+        return "DCP_STREAM_REQ_MULTI";
     case ClientOpcode::StopPersistence:
         return "STOP_PERSISTENCE";
     case ClientOpcode::StartPersistence:
@@ -502,6 +513,20 @@ std::string to_string(cb::mcbp::ClientOpcode opcode) {
         return "SUBDOC_MULTI_MUTATION";
     case ClientOpcode::SubdocGetCount:
         return "SUBDOC_GET_COUNT";
+    case ClientOpcode::RangeScan:
+        return "RANGE_SCAN";
+    case ClientOpcode::GetMulti:
+        return "GET_MULTI";
+    case ClientOpcode::SetMulti:
+        return "SET_MULTI";
+    case ClientOpcode::GetMetaMulti:
+        return "GET_META_MULTI";
+    case ClientOpcode::SetWithMetaMulti:
+        return "SET_WITH_META_MULTI";
+    case ClientOpcode::VbucketSnapshot:
+        return "VBUCKET_SNAPSHOT";
+    case ClientOpcode::VbucketInstall:
+        return "VBUCKET_INSTALL";
     case ClientOpcode::Scrub:
         return "SCRUB";
     case ClientOpcode::IsaslRefresh:
@@ -546,6 +571,8 @@ std::string to_string(cb::mcbp::ServerOpcode opcode) {
         return "Authenticate";
     case ServerOpcode::ActiveExternalUsers:
         return "ActiveExternalUsers";
+    case ServerOpcode::StatsPush:
+        return "StatsPush";
     }
     throw std::invalid_argument(
             "to_string(cb::mcbp::ServerOpcode): Invalid opcode: " +
@@ -112,6 +112,7 @@ const std::map<cb::mcbp::ClientOpcode, std::string> client_blueprint = {
          {ClientOpcode::DcpSeqnoAcknowledged, "DCP_SEQNO_ACKNOWLEDGED"},
          {ClientOpcode::DcpCommit, "DCP_COMMIT"},
          {ClientOpcode::DcpAbort, "DCP_ABORT"},
+         {ClientOpcode::DcpStreamReqMulti, "DCP_STREAM_REQ_MULTI"},
          {ClientOpcode::StopPersistence, "STOP_PERSISTENCE"},
          {ClientOpcode::StartPersistence, "START_PERSISTENCE"},
          {ClientOpcode::SetParam, "SET_PARAM"},
@@ -172,6 +173,13 @@ const std::map<cb::mcbp::ClientOpcode, std::string> client_blueprint = {
          {ClientOpcode::SubdocMultiLookup, "SUBDOC_MULTI_LOOKUP"},
          {ClientOpcode::SubdocMultiMutation, "SUBDOC_MULTI_MUTATION"},
          {ClientOpcode::SubdocGetCount, "SUBDOC_GET_COUNT"},
+         {ClientOpcode::RangeScan, "RANGE_SCAN"},
+         {ClientOpcode::GetMulti, "GET_MULTI"},
+         {ClientOpcode::SetMulti, "SET_MULTI"},
+         {ClientOpcode::GetMetaMulti, "GET_META_MULTI"},
+         {ClientOpcode::SetWithMetaMulti, "SET_WITH_META_MULTI"},
+         {ClientOpcode::VbucketSnapshot, "VBUCKET_SNAPSHOT"},
+         {ClientOpcode::VbucketInstall, "VBUCKET_INSTALL"},
          {ClientOpcode::Scrub, "SCRUB"},
          {ClientOpcode::IsaslRefresh, "ISASL_REFRESH"},
          {ClientOpcode::SslCertsRefresh, "SSL_CERTS_REFRESH"},
@@ -237,7 +245,8 @@ const std::map<cb::mcbp::ServerOpcode, std::string> server_blueprint = {
         {{ServerOpcode::ClustermapChangeNotification,
           "ClustermapChangeNotification"},
          {ServerOpcode::Authenticate, "Authenticate"},
-         {ServerOpcode::ActiveExternalUsers, "ActiveExternalUsers"}}};
+         {ServerOpcode::ActiveExternalUsers, "ActiveExternalUsers"},
+         {ServerOpcode::StatsPush, "StatsPush"}}};
 
 TEST(ServerOpcode, to_string) {
     for (int ii = 0; ii < 0x100; ++ii) {
@@ -25,12 +25,7 @@
 namespace cb {
 namespace mcbp {
 
-/**
- * Check to see if the specified opcode supports reordering
- *
- * @return true if the server supports reordering of that command
- */
-static bool reorderSupported(ClientOpcode opcode) {
+bool is_reorder_supported(ClientOpcode opcode) {
     switch (opcode) {
     case ClientOpcode::Get:
         return true;
@@ -119,6 +114,7 @@ static bool reorderSupported(ClientOpcode opcode) {
     case ClientOpcode::DcpSeqnoAcknowledged:
     case ClientOpcode::DcpCommit:
     case ClientOpcode::DcpAbort:
+    case ClientOpcode::DcpStreamReqMulti:
     case ClientOpcode::StopPersistence:
     case ClientOpcode::StartPersistence:
     case ClientOpcode::SetParam:
@@ -179,6 +175,13 @@ static bool reorderSupported(ClientOpcode opcode) {
     case ClientOpcode::SubdocMultiLookup:
     case ClientOpcode::SubdocMultiMutation:
     case ClientOpcode::SubdocGetCount:
+    case ClientOpcode::RangeScan:
+    case ClientOpcode::GetMulti:
+    case ClientOpcode::SetMulti:
+    case ClientOpcode::GetMetaMulti:
+    case ClientOpcode::SetWithMetaMulti:
+    case ClientOpcode::VbucketSnapshot:
+    case ClientOpcode::VbucketInstall:
     case ClientOpcode::Scrub:
     case ClientOpcode::IsaslRefresh:
     case ClientOpcode::SslCertsRefresh:
@@ -195,7 +198,7 @@ static bool reorderSupported(ClientOpcode opcode) {
     case ClientOpcode::Invalid:
         return false;
     }
-    throw std::runtime_error("reorderSupported(): Unknown opcode: " +
+    throw std::runtime_error("is_reorder_supported(): Unknown opcode: " +
                              std::to_string(int(opcode)));
 }
 
@@ -343,6 +346,7 @@ bool Request::isQuiet() const {
         case ClientOpcode::DcpSeqnoAcknowledged:
         case ClientOpcode::DcpCommit:
         case ClientOpcode::DcpAbort:
+        case ClientOpcode::DcpStreamReqMulti:
         case ClientOpcode::StopPersistence:
         case ClientOpcode::StartPersistence:
         case ClientOpcode::SetParam:
@@ -399,6 +403,13 @@ bool Request::isQuiet() const {
         case ClientOpcode::SubdocMultiLookup:
         case ClientOpcode::SubdocMultiMutation:
         case ClientOpcode::SubdocGetCount:
+        case ClientOpcode::RangeScan:
+        case ClientOpcode::GetMulti:
+        case ClientOpcode::SetMulti:
+        case ClientOpcode::GetMetaMulti:
+        case ClientOpcode::SetWithMetaMulti:
+        case ClientOpcode::VbucketSnapshot:
+        case ClientOpcode::VbucketInstall:
         case ClientOpcode::Scrub:
         case ClientOpcode::IsaslRefresh:
         case ClientOpcode::SslCertsRefresh:
@@ -448,6 +459,8 @@ bool Request::isQuiet() const {
             return false;
         case ServerOpcode::ActiveExternalUsers:
             return false;
+        case ServerOpcode::StatsPush:
+            return false;
         }
     }
 
@@ -479,8 +492,8 @@ Request::getDurabilityRequirements() const {
 }
 
 bool Request::mayReorder(const Request& other) const {
-    if (!reorderSupported(getClientOpcode()) ||
-        !reorderSupported(other.getClientOpcode())) {
+    if (!is_reorder_supported(getClientOpcode()) ||
+        !is_reorder_supported(other.getClientOpcode())) {
         return false;
     }
 
@@ -248,6 +248,79 @@ TEST_F(SettingsTest, Threads) {
     }
 }
 
+TEST_F(SettingsTest, SaslThreads) {
+    nonNumericValuesShouldFail("sasl_threads");
+
+    nlohmann::json json;
+    json["sasl_threads"] = 4;
+    try {
+        Settings settings(json);
+        EXPECT_EQ(4, settings.getNumSaslThreads());
+        EXPECT_TRUE(settings.has.sasl_threads);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+
+    Settings settings;
+    EXPECT_EQ(0, settings.getNumSaslThreads());
+    EXPECT_FALSE(settings.has.sasl_threads);
+}
+
+TEST_F(SettingsTest, ActiveThreads) {
+    nonNumericValuesShouldFail("active_threads");
+
+    nlohmann::json json;
+    json["active_threads"] = 4;
+    try {
+        Settings settings(json);
+        EXPECT_EQ(4, settings.getNumActiveWorkerThreads());
+        EXPECT_TRUE(settings.has.active_threads);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+
+    Settings settings;
+    EXPECT_EQ(0, settings.getNumActiveWorkerThreads());
+    EXPECT_FALSE(settings.has.active_threads);
+}
+
+TEST_F(SettingsTest, ConnectionDispatchPolicy) {
+    nonStringValuesShouldFail("connection_dispatch_policy");
+
+    {
+        // The connections are handed out round robin unless least_loaded
+        // is requested
+        Settings settings;
+        EXPECT_EQ(ConnectionDispatchPolicy::RoundRobin,
+                  settings.getConnectionDispatchPolicy());
+        EXPECT_FALSE(settings.has.connection_dispatch_policy);
+    }
+
+    nlohmann::json json;
+    json["connection_dispatch_policy"] = "round_robin";
+    try {
+        Settings settings(json);
+        EXPECT_EQ(ConnectionDispatchPolicy::RoundRobin,
+                  settings.getConnectionDispatchPolicy());
+        EXPECT_TRUE(settings.has.connection_dispatch_policy);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+
+    json["connection_dispatch_policy"] = "least_loaded";
+    try {
+        Settings settings(json);
+        EXPECT_EQ(ConnectionDispatchPolicy::LeastLoaded,
+                  settings.getConnectionDispatchPolicy());
+        EXPECT_TRUE(settings.has.connection_dispatch_policy);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+
+    json["connection_dispatch_policy"] = "foo";
+    expectFail<std::invalid_argument>(json);
+}
+
 TEST_F(SettingsTest, Interfaces) {
     nonArrayValuesShouldFail("interfaces");
 
@@ -471,6 +544,7 @@ TEST_F(SettingsTest, ParseLoggerSettings) {
     obj["buffersize"] = 1024;
     obj["cyclesize"] = 10485760;
     obj["unit_test"] = true;
+    obj["overflow_policy"] = "sample";
 
     nlohmann::json root;
     root["logger"] = obj;
@@ -483,6 +557,10 @@ TEST_F(SettingsTest, ParseLoggerSettings) {
     EXPECT_EQ(1024, config.buffersize);
     EXPECT_EQ(10485760, config.cyclesize);
     EXPECT_EQ(true, config.unit_test);
+    EXPECT_EQ(cb::logger::OverflowPolicy::Sample, config.overflow_policy);
+
+    root["logger"]["overflow_policy"] = "wait";
+    expectFail<std::invalid_argument>(root);
 }
 
 TEST_F(SettingsTest, StdinListener) {
@@ -508,6 +586,135 @@ TEST_F(SettingsTest, StdinListener) {
     }
 }
 
+TEST_F(SettingsTest, ReusePortListeners) {
+    nonBooleanValuesShouldFail("reuseport_listeners");
+
+    nlohmann::json obj;
+    obj["reuseport_listeners"] = true;
+    try {
+        Settings settings(obj);
+        EXPECT_TRUE(settings.isReusePortListenersEnabled());
+        EXPECT_TRUE(settings.has.reuseport_listeners);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+
+    obj["reuseport_listeners"] = false;
+    try {
+        Settings settings(obj);
+        EXPECT_FALSE(settings.isReusePortListenersEnabled());
+        EXPECT_TRUE(settings.has.reuseport_listeners);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+}
+
+TEST_F(SettingsTest, EventLoopChangelist) {
+    nonBooleanValuesShouldFail("event_loop_changelist");
+
+    nlohmann::json obj;
+    obj["event_loop_changelist"] = true;
+    try {
+        Settings settings(obj);
+        EXPECT_TRUE(settings.isEventLoopChangelistEnabled());
+        EXPECT_TRUE(settings.has.event_loop_changelist);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+
+    obj["event_loop_changelist"] = false;
+    try {
+        Settings settings(obj);
+        EXPECT_FALSE(settings.isEventLoopChangelistEnabled());
+        EXPECT_TRUE(settings.has.event_loop_changelist);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+}
+
+TEST_F(SettingsTest, FrontEndThreadAffinity) {
+    nonStringValuesShouldFail("front_end_thread_affinity");
+
+    nlohmann::json obj;
+    obj["front_end_thread_affinity"] = "0-3,8";
+    try {
+        Settings settings(obj);
+        EXPECT_EQ("0-3,8", settings.getFrontEndThreadAffinity());
+        EXPECT_TRUE(settings.has.front_end_thread_affinity);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+
+    // An empty string disables pinning
+    obj["front_end_thread_affinity"] = "";
+    try {
+        Settings settings(obj);
+        EXPECT_EQ("", settings.getFrontEndThreadAffinity());
+        EXPECT_TRUE(settings.has.front_end_thread_affinity);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+
+    obj["front_end_thread_affinity"] = "3-1";
+    EXPECT_THROW(Settings settings(obj), std::invalid_argument);
+}
+
+TEST_F(SettingsTest, TopkeysSampleRate) {
+    nonNumericValuesShouldFail("topkeys_sample_rate");
+
+    nlohmann::json obj;
+    obj["topkeys_sample_rate"] = 100;
+    try {
+        Settings settings(obj);
+        EXPECT_EQ(100, settings.getTopkeysSampleRate());
+        EXPECT_TRUE(settings.has.topkeys_sample_rate);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+
+    obj["topkeys_sample_rate"] = 0;
+    EXPECT_THROW(Settings settings(obj), std::invalid_argument);
+}
+
+TEST_F(SettingsTest, QosSchedulingEnabled) {
+    nonBooleanValuesShouldFail("qos_scheduling_enabled");
+
+    nlohmann::json obj;
+    obj["qos_scheduling_enabled"] = true;
+    try {
+        Settings settings(obj);
+        EXPECT_TRUE(settings.isQosSchedulingEnabled());
+        EXPECT_TRUE(settings.has.qos_scheduling_enabled);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+}
+
+TEST_F(SettingsTest, QosWeights) {
+    nonNumericValuesShouldFail("qos_weight_kv");
+    nonNumericValuesShouldFail("qos_weight_bulk");
+    nonNumericValuesShouldFail("qos_weight_admin");
+
+    nlohmann::json obj;
+    obj["qos_weight_kv"] = 10;
+    obj["qos_weight_bulk"] = 5;
+    obj["qos_weight_admin"] = 3;
+    try {
+        Settings settings(obj);
+        EXPECT_EQ(10, settings.getQosWeight(ConnectionClass::Kv));
+        EXPECT_EQ(5, settings.getQosWeight(ConnectionClass::Bulk));
+        EXPECT_EQ(3, settings.getQosWeight(ConnectionClass::Admin));
+        EXPECT_TRUE(settings.has.qos_weight_kv);
+        EXPECT_TRUE(settings.has.qos_weight_bulk);
+        EXPECT_TRUE(settings.has.qos_weight_admin);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+
+    obj["qos_weight_bulk"] = 0;
+    EXPECT_THROW(Settings settings(obj), std::invalid_argument);
+}
+
 TEST_F(SettingsTest, TopkeysEnabled) {
     nonBooleanValuesShouldFail("topkeys_enabled");
 
@@ -769,6 +976,24 @@ TEST_F(SettingsTest, SslCipherOrder) {
     }
 }
 
+TEST_F(SettingsTest, SslKtls) {
+    nonBooleanValuesShouldFail("ssl_ktls");
+
+    nlohmann::json obj;
+    Settings settings(obj);
+    EXPECT_FALSE(settings.has.ssl_ktls);
+    EXPECT_FALSE(settings.isSslKtlsEnabled());
+
+    obj["ssl_ktls"] = true;
+    try {
+        Settings settings(obj);
+        EXPECT_TRUE(settings.isSslKtlsEnabled());
+        EXPECT_TRUE(settings.has.ssl_ktls);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+}
+
 TEST_F(SettingsTest, SslMinimumProtocol) {
     nonStringValuesShouldFail("ssl_minimum_protocol");
 
@@ -802,6 +1027,63 @@ TEST_F(SettingsTest, SslMinimumProtocol) {
     expectFail<std::invalid_argument>(obj);
 }
 
+TEST_F(SettingsTest, SslSessionCacheSize) {
+    nonNumericValuesShouldFail("ssl_session_cache_size");
+
+    nlohmann::json obj;
+    Settings settings(obj);
+    EXPECT_FALSE(settings.has.ssl_session_cache_size);
+    EXPECT_EQ(0, settings.getSslSessionCacheSize());
+
+    obj["ssl_session_cache_size"] = 1024;
+    try {
+        Settings settings(obj);
+        EXPECT_EQ(1024, settings.getSslSessionCacheSize());
+        EXPECT_TRUE(settings.has.ssl_session_cache_size);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+}
+
+TEST_F(SettingsTest, SslSessionTickets) {
+    nonBooleanValuesShouldFail("ssl_session_tickets");
+
+    nlohmann::json obj;
+    Settings settings(obj);
+    EXPECT_FALSE(settings.has.ssl_session_tickets);
+    EXPECT_FALSE(settings.isSslSessionTicketsEnabled());
+
+    obj["ssl_session_tickets"] = true;
+    try {
+        Settings settings(obj);
+        EXPECT_TRUE(settings.isSslSessionTicketsEnabled());
+        EXPECT_TRUE(settings.has.ssl_session_tickets);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+}
+
+TEST_F(SettingsTest, SslSessionTimeout) {
+    nonNumericValuesShouldFail("ssl_session_timeout");
+
+    nlohmann::json obj;
+    Settings settings(obj);
+    EXPECT_FALSE(settings.has.ssl_session_timeout);
+    EXPECT_EQ(300, settings.getSslSessionTimeout());
+
+    obj["ssl_session_timeout"] = 3600;
+    try {
+        Settings settings(obj);
+        EXPECT_EQ(3600, settings.getSslSessionTimeout());
+        EXPECT_TRUE(settings.has.ssl_session_timeout);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+
+    obj["ssl_session_timeout"] = 0;
+    EXPECT_THROW(Settings settings(obj), nlohmann::json::exception);
+}
+
 TEST_F(SettingsTest, Breakpad) {
     nonObjectValuesShouldFail("breakpad");
 
@@ -845,6 +1127,52 @@ TEST_F(SettingsTest, max_packet_size) {
     }
 }
 
+TEST_F(SettingsTest, ResponseCoalescing) {
+    nonNumericValuesShouldFail("response_coalescing_bytes");
+    nonNumericValuesShouldFail("response_coalescing_iovecs");
+
+    nlohmann::json obj;
+    obj["response_coalescing_bytes"] = 16384;
+    obj["response_coalescing_iovecs"] = 128;
+    try {
+        Settings settings(obj);
+        EXPECT_EQ(16384, settings.getResponseCoalescingBytes());
+        EXPECT_TRUE(settings.has.response_coalescing_bytes);
+        EXPECT_EQ(128, settings.getResponseCoalescingIovecs());
+        EXPECT_TRUE(settings.has.response_coalescing_iovecs);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+}
+
+TEST_F(SettingsTest, SubdocLookupCacheSize) {
+    nonNumericValuesShouldFail("subdoc_lookup_cache_size");
+
+    nlohmann::json obj;
+    obj["subdoc_lookup_cache_size"] = 256;
+    try {
+        Settings settings(obj);
+        EXPECT_EQ(256, settings.getSubdocLookupCacheSize());
+        EXPECT_TRUE(settings.has.subdoc_lookup_cache_size);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+}
+
+TEST_F(SettingsTest, ZeroCopySendThreshold) {
+    nonNumericValuesShouldFail("zerocopy_send_threshold");
+
+    nlohmann::json obj;
+    obj["zerocopy_send_threshold"] = 65536;
+    try {
+        Settings settings(obj);
+        EXPECT_EQ(65536, settings.getZeroCopySendThreshold());
+        EXPECT_TRUE(settings.has.zerocopy_send_threshold);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+}
+
 TEST_F(SettingsTest, max_connections) {
     nonNumericValuesShouldFail("max_connections");
 
@@ -961,6 +1289,88 @@ TEST_F(SettingsTest, TracingEnabled) {
     }
 }
 
+TEST_F(SettingsTest, KeyspaceTimings) {
+    nonBooleanValuesShouldFail("keyspace_timings");
+
+    nlohmann::json obj;
+    obj["keyspace_timings"] = true;
+    try {
+        Settings settings(obj);
+        EXPECT_TRUE(settings.isKeyspaceTimingsEnabled());
+        EXPECT_TRUE(settings.has.keyspace_timings);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+
+    obj["keyspace_timings"] = false;
+    try {
+        Settings settings(obj);
+        EXPECT_FALSE(settings.isKeyspaceTimingsEnabled());
+        EXPECT_TRUE(settings.has.keyspace_timings);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+}
+
+TEST_F(SettingsTest, AdmissionControlThreshold) {
+    nonNumericValuesShouldFail("admission_control_threshold");
+
+    nlohmann::json obj;
+    Settings settings(obj);
+    EXPECT_FALSE(settings.has.admission_control_threshold);
+    EXPECT_EQ(0, settings.getAdmissionControlThreshold());
+
+    obj["admission_control_threshold"] = 90;
+    try {
+        Settings settings(obj);
+        EXPECT_EQ(90, settings.getAdmissionControlThreshold());
+        EXPECT_TRUE(settings.has.admission_control_threshold);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+}
+
+TEST_F(SettingsTest, SlowOpPercentile) {
+    nonNumericValuesShouldFail("slow_op_percentile");
+
+    nlohmann::json obj;
+    Settings settings(obj);
+    EXPECT_FALSE(settings.has.slow_op_percentile);
+    EXPECT_EQ(0, settings.getSlowOpPercentile());
+
+    obj["slow_op_percentile"] = 99.9;
+    try {
+        Settings settings(obj);
+        EXPECT_EQ(99.9, settings.getSlowOpPercentile());
+        EXPECT_TRUE(settings.has.slow_op_percentile);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+
+    obj["slow_op_percentile"] = 100;
+    expectFail<std::invalid_argument>(obj);
+    obj["slow_op_percentile"] = -1;
+    expectFail<std::invalid_argument>(obj);
+}
+
+TEST_F(SettingsTest, SlowOpCaptureSize) {
+    nonNumericValuesShouldFail("slow_op_capture_size");
+
+    nlohmann::json obj;
+    Settings settings(obj);
+    EXPECT_FALSE(settings.has.slow_op_capture_size);
+    EXPECT_EQ(0, settings.getSlowOpCaptureSize());
+
+    obj["slow_op_capture_size"] = 100;
+    try {
+        Settings settings(obj);
+        EXPECT_EQ(100, settings.getSlowOpCaptureSize());
+        EXPECT_TRUE(settings.has.slow_op_capture_size);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+}
+
 TEST_F(SettingsTest, ExternalAuthService) {
     nonBooleanValuesShouldFail("external_auth_service");
 
@@ -984,6 +1394,43 @@ TEST_F(SettingsTest, ExternalAuthService) {
     }
 }
 
+TEST_F(SettingsTest, ExternalAuthCacheTtl) {
+    for (const auto& name : std::vector<std::string>{
+                 "external_auth_cache_ttl",
+                 "external_auth_negative_cache_ttl"}) {
+        const auto getter = [&name](const Settings& settings) {
+            return name == "external_auth_cache_ttl"
+                           ? settings.getExternalAuthCacheTtl()
+                           : settings.getExternalAuthNegativeCacheTtl();
+        };
+
+        nlohmann::json obj;
+        {
+            Settings settings(obj);
+            EXPECT_EQ(std::chrono::microseconds{0}, getter(settings));
+        }
+
+        obj[name] = 30;
+        try {
+            Settings settings(obj);
+            EXPECT_EQ(std::chrono::seconds(30), getter(settings));
+        } catch (const std::exception& exception) {
+            FAIL() << exception.what();
+        }
+
+        obj[name] = "100 ms";
+        try {
+            Settings settings(obj);
+            EXPECT_EQ(std::chrono::milliseconds(100), getter(settings));
+        } catch (const std::exception& exception) {
+            FAIL() << exception.what();
+        }
+
+        obj[name] = true;
+        EXPECT_THROW(Settings settings(obj), nlohmann::json::exception);
+    }
+}
+
 TEST_F(SettingsTest, ScramshaFallbackSalt) {
     nonStringValuesShouldFail("scramsha_fallback_salt");
     nlohmann::json obj;
@@ -1076,6 +1523,48 @@ TEST(SettingsUpdateTest, ThreadsIsNotDynamic) {
                  std::invalid_argument);
 }
 
+TEST(SettingsUpdateTest, ReusePortListenersIsNotDynamic) {
+    Settings updated;
+    Settings settings;
+    // setting it to the same value should work
+    settings.setReusePortListenersEnabled(true);
+    updated.setReusePortListenersEnabled(true);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+
+    // Changing it should fail
+    updated.setReusePortListenersEnabled(false);
+    EXPECT_THROW(settings.updateSettings(updated, false),
+                 std::invalid_argument);
+}
+
+TEST(SettingsUpdateTest, EventLoopChangelistIsNotDynamic) {
+    Settings updated;
+    Settings settings;
+    // setting it to the same value should work
+    settings.setEventLoopChangelistEnabled(true);
+    updated.setEventLoopChangelistEnabled(true);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+
+    // Changing it should fail
+    updated.setEventLoopChangelistEnabled(false);
+    EXPECT_THROW(settings.updateSettings(updated, false),
+                 std::invalid_argument);
+}
+
+TEST(SettingsUpdateTest, FrontEndThreadAffinityIsNotDynamic) {
+    Settings updated;
+    Settings settings;
+    // setting it to the same value should work
+    settings.setFrontEndThreadAffinity("0-3");
+    updated.setFrontEndThreadAffinity("0-3");
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+
+    // Changing it should fail
+    updated.setFrontEndThreadAffinity("4-7");
+    EXPECT_THROW(settings.updateSettings(updated, false),
+                 std::invalid_argument);
+}
+
 TEST(SettingsUpdateTest, InterfaceIdenticalArraysShouldWork) {
     Settings updated;
     Settings settings;
@@ -1353,6 +1842,22 @@ TEST(SettingsUpdateTest, SslCipherOrderIsDynamic) {
     EXPECT_EQ(false, settings.isSslCipherOrder());
 }
 
+TEST(SettingsUpdateTest, SslKtlsIsDynamic) {
+    Settings updated;
+    Settings settings;
+    // setting it to the same value should work
+    auto old = settings.isSslKtlsEnabled();
+    updated.setSslKtlsEnabled(old);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+
+    // changing it should work
+    updated.setSslKtlsEnabled(!old);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+    EXPECT_EQ(old, settings.isSslKtlsEnabled());
+    EXPECT_NO_THROW(settings.updateSettings(updated));
+    EXPECT_EQ(!old, settings.isSslKtlsEnabled());
+}
+
 TEST(SettingsUpdateTest, SslMinimumProtocolIsDynamic) {
     Settings updated;
     Settings settings;
@@ -1370,6 +1875,50 @@ TEST(SettingsUpdateTest, SslMinimumProtocolIsDynamic) {
     EXPECT_EQ("tlsv1", settings.getSslMinimumProtocol());
 }
 
+TEST(SettingsUpdateTest, SslSessionCacheSizeIsDynamic) {
+    Settings settings;
+    Settings updated;
+    updated.setSslSessionCacheSize(settings.getSslSessionCacheSize());
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+
+    // changing it should work
+    updated.setSslSessionCacheSize(1024);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+    EXPECT_NE(1024, settings.getSslSessionCacheSize());
+    EXPECT_NO_THROW(settings.updateSettings(updated));
+    EXPECT_EQ(1024, settings.getSslSessionCacheSize());
+}
+
+TEST(SettingsUpdateTest, SslSessionTicketsIsDynamic) {
+    Settings updated;
+    Settings settings;
+    // setting it to the same value should work
+    auto old = settings.isSslSessionTicketsEnabled();
+    updated.setSslSessionTicketsEnabled(old);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+
+    // changing it should work
+    updated.setSslSessionTicketsEnabled(!old);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+    EXPECT_EQ(old, settings.isSslSessionTicketsEnabled());
+    EXPECT_NO_THROW(settings.updateSettings(updated));
+    EXPECT_EQ(!old, settings.isSslSessionTicketsEnabled());
+}
+
+TEST(SettingsUpdateTest, SslSessionTimeoutIsDynamic) {
+    Settings settings;
+    Settings updated;
+    updated.setSslSessionTimeout(settings.getSslSessionTimeout());
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+
+    // changing it should work
+    updated.setSslSessionTimeout(3600);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+    EXPECT_NE(3600, settings.getSslSessionTimeout());
+    EXPECT_NO_THROW(settings.updateSettings(updated));
+    EXPECT_EQ(3600, settings.getSslSessionTimeout());
+}
+
 TEST(SettingsUpdateTest, MaxPacketSizeIsDynamic) {
     Settings settings;
     Settings updated;
@@ -1387,6 +1936,87 @@ TEST(SettingsUpdateTest, MaxPacketSizeIsDynamic) {
               settings.getMaxPacketSize());
 }
 
+TEST(SettingsUpdateTest, ResponseCoalescingIsDynamic) {
+    Settings settings;
+    Settings updated;
+    updated.setResponseCoalescingBytes(settings.getResponseCoalescingBytes());
+    updated.setResponseCoalescingIovecs(
+            settings.getResponseCoalescingIovecs());
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+
+    // changing it should work
+    updated.setResponseCoalescingBytes(32768);
+    updated.setResponseCoalescingIovecs(256);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+    EXPECT_NE(32768, settings.getResponseCoalescingBytes());
+    EXPECT_NO_THROW(settings.updateSettings(updated));
+    EXPECT_EQ(32768, settings.getResponseCoalescingBytes());
+    EXPECT_EQ(256, settings.getResponseCoalescingIovecs());
+}
+
+TEST(SettingsUpdateTest, QosSchedulingIsDynamic) {
+    Settings settings;
+    Settings updated;
+    updated.setQosSchedulingEnabled(!settings.isQosSchedulingEnabled());
+    updated.setQosWeight(100, ConnectionClass::Kv);
+    updated.setQosWeight(10, ConnectionClass::Bulk);
+    updated.setQosWeight(5, ConnectionClass::Admin);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+    EXPECT_NE(100, settings.getQosWeight(ConnectionClass::Kv));
+
+    EXPECT_NO_THROW(settings.updateSettings(updated));
+    EXPECT_EQ(updated.isQosSchedulingEnabled(),
+              settings.isQosSchedulingEnabled());
+    EXPECT_EQ(100, settings.getQosWeight(ConnectionClass::Kv));
+    EXPECT_EQ(10, settings.getQosWeight(ConnectionClass::Bulk));
+    EXPECT_EQ(5, settings.getQosWeight(ConnectionClass::Admin));
+}
+
+TEST(SettingsUpdateTest, TopkeysSampleRateIsDynamic) {
+    Settings settings;
+    Settings updated;
+    updated.setTopkeysSampleRate(settings.getTopkeysSampleRate());
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+
+    // changing it should work
+    updated.setTopkeysSampleRate(10);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+    EXPECT_NE(10, settings.getTopkeysSampleRate());
+    EXPECT_NO_THROW(settings.updateSettings(updated));
+    EXPECT_EQ(10, settings.getTopkeysSampleRate());
+}
+
+TEST(SettingsUpdateTest, SubdocLookupCacheSizeIsDynamic) {
+    Settings settings;
+    Settings updated;
+    updated.setSubdocLookupCacheSize(settings.getSubdocLookupCacheSize());
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+
+    // changing it should work
+    updated.setSubdocLookupCacheSize(128);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+    EXPECT_NE(128, settings.getSubdocLookupCacheSize());
+    EXPECT_NO_THROW(settings.updateSettings(updated));
+    EXPECT_EQ(128, settings.getSubdocLookupCacheSize());
+}
+
+TEST(SettingsUpdateTest, ZeroCopySendThresholdIsDynamic) {
+    Settings settings;
+    Settings updated;
+    // setting it to the same value should work
+    auto old = settings.getZeroCopySendThreshold();
+    updated.setZeroCopySendThreshold(old);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+
+    // changing it should work
+    updated.setZeroCopySendThreshold(old + 65536);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+    EXPECT_EQ(old, settings.getZeroCopySendThreshold());
+    EXPECT_NO_THROW(settings.updateSettings(updated));
+    EXPECT_EQ(updated.getZeroCopySendThreshold(),
+              settings.getZeroCopySendThreshold());
+}
+
 TEST(SettingsUpdateTest, SaslMechanismsIsDynamic) {
     Settings settings;
     Settings updated;
@@ -1432,6 +2062,38 @@ TEST(SettingsUpdateTest, DedupeNmvbMapsIsDynamic) {
     EXPECT_FALSE(settings.isDedupeNmvbMaps());
 }
 
+TEST(SettingsUpdateTest, ActiveThreadsIsDynamic) {
+    Settings settings;
+    Settings updated;
+    settings.setNumActiveWorkerThreads(4);
+    updated.setNumActiveWorkerThreads(4);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+
+    updated.setNumActiveWorkerThreads(2);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+    EXPECT_EQ(4, settings.getNumActiveWorkerThreads());
+    EXPECT_NO_THROW(settings.updateSettings(updated, true));
+    EXPECT_EQ(2, settings.getNumActiveWorkerThreads());
+}
+
+TEST(SettingsUpdateTest, ConnectionDispatchPolicyIsDynamic) {
+    Settings settings;
+    Settings updated;
+    // setting it to the same value should work
+    settings.setConnectionDispatchPolicy(ConnectionDispatchPolicy::RoundRobin);
+    updated.setConnectionDispatchPolicy(ConnectionDispatchPolicy::RoundRobin);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+
+    // Changing it should also work
+    updated.setConnectionDispatchPolicy(ConnectionDispatchPolicy::LeastLoaded);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+    EXPECT_EQ(ConnectionDispatchPolicy::RoundRobin,
+              settings.getConnectionDispatchPolicy());
+    EXPECT_NO_THROW(settings.updateSettings(updated, true));
+    EXPECT_EQ(ConnectionDispatchPolicy::LeastLoaded,
+              settings.getConnectionDispatchPolicy());
+}
+
 TEST(SettingsUpdateTest, OpcodeAttributesOverrideIsDynamic) {
     Settings settings;
     Settings updated;
@@ -1518,3 +2180,37 @@ int main(int argc, char** argv) {
 
     return ret;
 }
+
+TEST(SettingsUpdateTest, AdmissionControlThresholdIsDynamic) {
+    Settings settings;
+    Settings updated;
+    updated.setAdmissionControlThreshold(
+            settings.getAdmissionControlThreshold());
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+
+    // changing it should work
+    updated.setAdmissionControlThreshold(90);
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+    EXPECT_NE(90, settings.getAdmissionControlThreshold());
+    EXPECT_NO_THROW(settings.updateSettings(updated));
+    EXPECT_EQ(90, settings.getAdmissionControlThreshold());
+}
+
+TEST(SettingsUpdateTest, ExternalAuthCacheTtlIsDynamic) {
+    Settings settings;
+    Settings updated;
+    updated.setExternalAuthCacheTtl(settings.getExternalAuthCacheTtl());
+    updated.setExternalAuthNegativeCacheTtl(
+            settings.getExternalAuthNegativeCacheTtl());
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+
+    // changing it should work
+    updated.setExternalAuthCacheTtl(std::chrono::seconds(30));
+    updated.setExternalAuthNegativeCacheTtl(std::chrono::seconds(5));
+    EXPECT_NO_THROW(settings.updateSettings(updated, false));
+    EXPECT_NE(std::chrono::seconds(30), settings.getExternalAuthCacheTtl());
+    EXPECT_NO_THROW(settings.updateSettings(updated));
+    EXPECT_EQ(std::chrono::seconds(30), settings.getExternalAuthCacheTtl());
+    EXPECT_EQ(std::chrono::seconds(5),
+              settings.getExternalAuthNegativeCacheTtl());
+}
@@ -0,0 +1,133 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <daemon/connection_scheduler.h>
+#include <daemon/settings.h>
+#include <event.h>
+#include <folly/portability/GTest.h>
+
+#include <array>
+
+/**
+ * The scheduler never dereferences the connections, so we can use the
+ * address of some dummy storage to represent them.
+ */
+class ConnectionSchedulerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        settings.setQosWeight(8, ConnectionClass::Kv);
+        settings.setQosWeight(2, ConnectionClass::Bulk);
+        settings.setQosWeight(1, ConnectionClass::Admin);
+    }
+
+    Connection& conn(size_t idx) {
+        return *reinterpret_cast<Connection*>(&storage[idx]);
+    }
+
+    std::array<uint64_t, 8> storage{};
+    ConnectionScheduler scheduler;
+};
+
+TEST_F(ConnectionSchedulerTest, FifoWithinClass) {
+    scheduler.schedule(conn(0), ConnectionClass::Kv, EV_READ);
+    scheduler.schedule(conn(1), ConnectionClass::Kv, EV_READ);
+    scheduler.schedule(conn(2), ConnectionClass::Kv, EV_READ);
+    EXPECT_EQ(3, scheduler.size());
+
+    EXPECT_EQ(&conn(0), scheduler.next().connection);
+    EXPECT_EQ(&conn(1), scheduler.next().connection);
+    EXPECT_EQ(&conn(2), scheduler.next().connection);
+    EXPECT_TRUE(scheduler.empty());
+    EXPECT_THROW(scheduler.next(), std::logic_error);
+}
+
+TEST_F(ConnectionSchedulerTest, MergeFlags) {
+    scheduler.schedule(conn(0), ConnectionClass::Kv, EV_READ);
+    scheduler.schedule(conn(0), ConnectionClass::Kv, EV_WRITE);
+    EXPECT_EQ(1, scheduler.size());
+
+    const auto entry = scheduler.next();
+    EXPECT_EQ(&conn(0), entry.connection);
+    EXPECT_EQ(EV_READ | EV_WRITE, entry.which);
+    EXPECT_EQ(ConnectionClass::Kv, entry.cls);
+}
+
+TEST_F(ConnectionSchedulerTest, Remove) {
+    scheduler.schedule(conn(0), ConnectionClass::Kv, EV_READ);
+    scheduler.schedule(conn(1), ConnectionClass::Admin, EV_READ);
+    scheduler.remove(conn(0));
+    // Removing a connection which isn't queued is fine
+    scheduler.remove(conn(2));
+    EXPECT_EQ(1, scheduler.size());
+    EXPECT_EQ(&conn(1), scheduler.next().connection);
+}
+
+TEST_F(ConnectionSchedulerTest, ExpensiveClassIsServedLast) {
+    // A slow admin command runs
+    scheduler.schedule(conn(0), ConnectionClass::Admin, EV_READ);
+    auto entry = scheduler.next();
+    scheduler.charge(entry.cls, std::chrono::milliseconds(10));
+
+    // When it is ready again the KV connections queued behind it
+    // should be served first
+    scheduler.schedule(conn(0), ConnectionClass::Admin, EV_READ);
+    scheduler.schedule(conn(1), ConnectionClass::Kv, EV_READ);
+    scheduler.schedule(conn(2), ConnectionClass::Kv, EV_READ);
+    for (int ii = 1; ii < 3; ++ii) {
+        entry = scheduler.next();
+        EXPECT_EQ(&conn(ii), entry.connection);
+        scheduler.charge(entry.cls, std::chrono::microseconds(10));
+    }
+    EXPECT_EQ(&conn(0), scheduler.next().connection);
+}
+
+TEST_F(ConnectionSchedulerTest, WeightedShare) {
+    // Keep both a KV and a bulk connection busy, with every run costing
+    // the same. KV should be served 4 times as often (8 vs 2)
+    std::array<int, 2> served{};
+    scheduler.schedule(conn(0), ConnectionClass::Kv, EV_READ);
+    scheduler.schedule(conn(1), ConnectionClass::Bulk, EV_READ);
+    for (int ii = 0; ii < 1000; ++ii) {
+        const auto entry = scheduler.next();
+        scheduler.charge(entry.cls, std::chrono::microseconds(100));
+        served[entry.cls == ConnectionClass::Kv ? 0 : 1]++;
+        scheduler.schedule(*entry.connection, entry.cls, EV_READ);
+    }
+    EXPECT_EQ(800, served[0]);
+    EXPECT_EQ(200, served[1]);
+}
+
+TEST_F(ConnectionSchedulerTest, IdleClassDoesNotBankCredit) {
+    // Run KV for a long time while bulk is idle
+    for (int ii = 0; ii < 100; ++ii) {
+        scheduler.schedule(conn(0), ConnectionClass::Kv, EV_READ);
+        const auto entry = scheduler.next();
+        scheduler.charge(entry.cls, std::chrono::milliseconds(1));
+    }
+
+    // Bulk becomes ready; it should get its fair share from now on and
+    // not run exclusively until it caught up with the time used by KV
+    std::array<int, 2> served{};
+    scheduler.schedule(conn(0), ConnectionClass::Kv, EV_READ);
+    scheduler.schedule(conn(1), ConnectionClass::Bulk, EV_READ);
+    for (int ii = 0; ii < 100; ++ii) {
+        const auto entry = scheduler.next();
+        scheduler.charge(entry.cls, std::chrono::microseconds(100));
+        served[entry.cls == ConnectionClass::Kv ? 0 : 1]++;
+        scheduler.schedule(*entry.connection, entry.cls, EV_READ);
+    }
+    EXPECT_LT(70, served[0]);
+}
@@ -0,0 +1,157 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <daemon/keyspace_timings.h>
+#include <folly/portability/GTest.h>
+#include <nlohmann/json.hpp>
+
+#include <map>
+
+using namespace std::chrono;
+
+TEST(LatencySketchTest, Empty) {
+    cb::LatencySketch sketch;
+    EXPECT_EQ(0, sketch.getCount());
+    EXPECT_EQ(microseconds(0), sketch.getPercentile(50));
+
+    const auto json = sketch.to_json();
+    EXPECT_EQ(0, json["total"].get<uint64_t>());
+    EXPECT_TRUE(json["data"].empty());
+}
+
+// The percentiles are estimated within the relative accuracy
+TEST(LatencySketchTest, Percentiles) {
+    cb::LatencySketch sketch;
+    for (int ii = 1; ii <= 10000; ++ii) {
+        sketch.add(microseconds(ii));
+    }
+    EXPECT_EQ(10000, sketch.getCount());
+    for (double percentile : {1.0, 50.0, 90.0, 99.0, 99.9}) {
+        const auto expected = 100 * percentile;
+        const auto actual = double(sketch.getPercentile(percentile).count());
+        EXPECT_NEAR(expected,
+                    actual,
+                    expected * cb::LatencySketch::RelativeAccuracy + 1)
+                << "percentile:" << percentile;
+    }
+}
+
+// Values beyond the range of the sketch are counted in the last bucket
+TEST(LatencySketchTest, Overflow) {
+    cb::LatencySketch sketch;
+    sketch.add(hours(1));
+    EXPECT_EQ(1, sketch.getCount());
+    EXPECT_LT(seconds(60), sketch.getPercentile(100));
+}
+
+// The JSON has the format of HdrHistogram::to_json used by mctimings
+TEST(LatencySketchTest, Json) {
+    cb::LatencySketch sketch;
+    sketch.add(microseconds(10));
+    sketch.add(microseconds(10));
+    sketch.add(milliseconds(10));
+
+    const auto json = sketch.to_json();
+    EXPECT_EQ(3, json["total"].get<uint64_t>());
+    EXPECT_EQ(0, json["bucketsLow"].get<uint64_t>());
+    const auto& data = json["data"];
+    ASSERT_EQ(2, data.size());
+    EXPECT_LE(10, data[0][0].get<uint64_t>());
+    EXPECT_EQ(2, data[0][1].get<uint64_t>());
+    EXPECT_NEAR(66.7, data[0][2].get<double>(), 0.1);
+    EXPECT_LE(10000, data[1][0].get<uint64_t>());
+    EXPECT_EQ(1, data[1][1].get<uint64_t>());
+    EXPECT_EQ(100.0, data[1][2].get<double>());
+}
+
+TEST(KeyspaceTimingsTest, Collect) {
+    cb::KeyspaceTimings timings;
+    timings.collect(Vbid(1), CollectionID(8), microseconds(10));
+    timings.collect(Vbid(1), CollectionID::Default, microseconds(10));
+    timings.collect(Vbid(2), CollectionID(8), microseconds(10));
+
+    ASSERT_NE(nullptr, timings.getVBucket(Vbid(1)));
+    EXPECT_EQ(2, timings.getVBucket(Vbid(1))->getCount());
+    EXPECT_EQ(1, timings.getVBucket(Vbid(2))->getCount());
+    EXPECT_EQ(nullptr, timings.getVBucket(Vbid(3)));
+
+    ASSERT_NE(nullptr, timings.getCollection(CollectionID(8)));
+    EXPECT_EQ(2, timings.getCollection(CollectionID(8))->getCount());
+    EXPECT_EQ(1, timings.getCollection(CollectionID::Default)->getCount());
+    EXPECT_EQ(nullptr, timings.getCollection(CollectionID(9)));
+
+    std::map<uint16_t, uint64_t> vbuckets;
+    timings.forEachVBucket([&vbuckets](Vbid vbid, const auto& sketch) {
+        vbuckets[vbid.get()] = sketch.getCount();
+    });
+    EXPECT_EQ((std::map<uint16_t, uint64_t>{{1, 2}, {2, 1}}), vbuckets);
+
+    std::map<uint32_t, uint64_t> collections;
+    timings.forEachCollection([&collections](CollectionID cid,
+                                             const auto& sketch) {
+        collections[uint32_t(cid)] = sketch.getCount();
+    });
+    EXPECT_EQ((std::map<uint32_t, uint64_t>{{0, 1}, {8, 2}}), collections);
+}
+
+// Memory is bounded: vbuckets beyond MaxVBuckets and collections beyond
+// the first MaxCollections aren't tracked
+TEST(KeyspaceTimingsTest, Bounded) {
+    cb::KeyspaceTimings timings;
+    timings.collect(Vbid(cb::KeyspaceTimings::MaxVBuckets),
+                    CollectionID::Default,
+                    microseconds(10));
+    EXPECT_EQ(nullptr,
+              timings.getVBucket(Vbid(cb::KeyspaceTimings::MaxVBuckets)));
+
+    const CollectionIDType first = 8;
+    for (CollectionIDType ii = 0; ii <= cb::KeyspaceTimings::MaxCollections;
+         ++ii) {
+        timings.collect(Vbid(0), CollectionID(first + ii), microseconds(10));
+    }
+    EXPECT_NE(nullptr, timings.getCollection(CollectionID(first)));
+    EXPECT_EQ(nullptr,
+              timings.getCollection(CollectionID(
+                      first + cb::KeyspaceTimings::MaxCollections)));
+}
+
+TEST(KeyspaceTimingsTest, ResetAndClear) {
+    cb::KeyspaceTimings timings;
+    timings.collect(Vbid(1), CollectionID(8), microseconds(10));
+
+    // reset keeps the sketches (which may be in use) but zeroes them
+    timings.reset();
+    ASSERT_NE(nullptr, timings.getVBucket(Vbid(1)));
+    EXPECT_EQ(0, timings.getVBucket(Vbid(1))->getCount());
+    ASSERT_NE(nullptr, timings.getCollection(CollectionID(8)));
+    EXPECT_EQ(0, timings.getCollection(CollectionID(8))->getCount());
+
+    timings.clear();
+    EXPECT_EQ(nullptr, timings.getVBucket(Vbid(1)));
+    EXPECT_EQ(nullptr, timings.getCollection(CollectionID(8)));
+}
+
+TEST(KeyspaceTimingsTest, DocumentOpcodes) {
+    using cb::mcbp::ClientOpcode;
+    EXPECT_TRUE(cb::KeyspaceTimings::isDocumentOpcode(ClientOpcode::Get));
+    EXPECT_TRUE(cb::KeyspaceTimings::isDocumentOpcode(ClientOpcode::Set));
+    EXPECT_TRUE(cb::KeyspaceTimings::isDocumentOpcode(
+            ClientOpcode::SubdocMultiLookup));
+    EXPECT_FALSE(cb::KeyspaceTimings::isDocumentOpcode(ClientOpcode::Stat));
+    EXPECT_FALSE(cb::KeyspaceTimings::isDocumentOpcode(ClientOpcode::Noop));
+    EXPECT_FALSE(
+            cb::KeyspaceTimings::isDocumentOpcode(ClientOpcode::DcpMutation));
+}
@@ -26,6 +26,7 @@ class McTimeTest : public ::testing::Test {
 public:
     static void SetUpTestCase() {
         executorPool = std::make_unique<ExecutorPool>(0);
+        saslExecutorPool = std::make_unique<ExecutorPool>(0);
         mc_time_init_epoch();
     }
 
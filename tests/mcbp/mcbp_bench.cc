@@ -18,6 +18,7 @@
 #include "mock_connection.h"
 #include <benchmark/benchmark.h>
 #include <daemon/cookie.h>
+#include <daemon/mcbp_opcode_descriptor.h>
 #include <daemon/mcbp_validators.h>
 #include <mcbp/protocol/header.h>
 #include <memcached/protocol_binary.h>
@@ -98,7 +99,138 @@ BENCHMARK_DEFINE_F(McbpValidatorBench, AddBench)(benchmark::State& state) {
     }
 }
 
+/// Get with a collection aware key (leb128 prefixed collection id)
+BENCHMARK_DEFINE_F(McbpValidatorBench, CollectionsGetBench)
+(benchmark::State& state) {
+    connection.setCollectionsSupported(true);
+    request.message.header.request.setExtlen(0);
+    request.message.header.request.setKeylen(10);
+    request.message.header.request.setBodylen(10);
+    // collection 8 followed by the logical key
+    blob[sizeof(request.bytes)] = 0x08;
+    memset(blob + sizeof(request.bytes) + 1, 'a', 9);
+
+    void* packet = static_cast<void*>(&request);
+    const auto& req = *reinterpret_cast<const cb::mcbp::Header*>(packet);
+    const size_t size = sizeof(req) + req.getBodylen();
+    cb::const_byte_buffer buffer{static_cast<uint8_t*>(packet), size};
+    Cookie cookie(connection);
+
+    while (state.KeepRunning()) {
+        cookie.reset();
+        cookie.setPacket(Cookie::PacketContent::Full, buffer);
+        validator.validate(cb::mcbp::ClientOpcode::Get, cookie);
+    }
+    connection.setCollectionsSupported(false);
+}
+
+/// Set carrying a durability requirement in the flexible framing extras
+BENCHMARK_DEFINE_F(McbpValidatorBench, DurableSetBench)
+(benchmark::State& state) {
+    // Setting the framing extras switches to the alternative encoding
+    request.message.header.request.setFramingExtraslen(2);
+    request.message.header.request.setExtlen(8);
+    request.message.header.request.setKeylen(10);
+    request.message.header.request.setBodylen(20);
+    // DurabilityRequirement (id 1) of 1 byte: Majority
+    blob[sizeof(request.bytes)] = 0x11;
+    blob[sizeof(request.bytes) + 1] = 0x01;
+
+    void* packet = static_cast<void*>(&request);
+    const auto& req = *reinterpret_cast<const cb::mcbp::Header*>(packet);
+    const size_t size = sizeof(req) + req.getBodylen();
+    cb::const_byte_buffer buffer{static_cast<uint8_t*>(packet), size};
+    Cookie cookie(connection);
+
+    while (state.KeepRunning()) {
+        cookie.reset();
+        cookie.setPacket(Cookie::PacketContent::Full, buffer);
+        validator.validate(cb::mcbp::ClientOpcode::Set, cookie);
+    }
+}
+
+/// Get validated through an opcode descriptor (as done by the front end)
+BENCHMARK_DEFINE_F(McbpValidatorBench, DescriptorGetBench)
+(benchmark::State& state) {
+    request.message.header.request.setExtlen(0);
+    request.message.header.request.setKeylen(10);
+    request.message.header.request.setBodylen(10);
+
+    void* packet = static_cast<void*>(&request);
+    const auto& req = *reinterpret_cast<const cb::mcbp::Header*>(packet);
+    const size_t size = sizeof(req) + req.getBodylen();
+    cb::const_byte_buffer buffer{static_cast<uint8_t*>(packet), size};
+    Cookie cookie(connection);
+
+    std::array<McbpOpcodeDescriptor, 0x100> descriptors;
+    auto& get = descriptors[uint8_t(cb::mcbp::ClientOpcode::Get)];
+    get.valid = true;
+    get.validator = validator.getValidator(cb::mcbp::ClientOpcode::Get);
+
+    while (state.KeepRunning()) {
+        cookie.reset();
+        cookie.setPacket(Cookie::PacketContent::Full, buffer);
+        const auto opcode = req.getRequest().getClientOpcode();
+        const auto& descriptor = descriptors[uint8_t(opcode)];
+        if (descriptor.valid) {
+            descriptor.validate(cookie);
+        }
+    }
+}
+
+/**
+ * The cost of validating a request for each of the opcodes with a
+ * validator (the packet is a minimal one, so this mostly measures the
+ * dispatch and the common header checks for the opcode)
+ */
+BENCHMARK_DEFINE_F(McbpValidatorBench, PerOpcodeBench)
+(benchmark::State& state) {
+    const auto opcode = cb::mcbp::ClientOpcode(state.range(0));
+    state.SetLabel(to_string(opcode));
+    request.message.header.request.setOpcode(opcode);
+    request.message.header.request.setExtlen(0);
+    request.message.header.request.setKeylen(10);
+    request.message.header.request.setBodylen(10);
+
+    void* packet = static_cast<void*>(&request);
+    const auto& req = *reinterpret_cast<const cb::mcbp::Header*>(packet);
+    const size_t size = sizeof(req) + req.getBodylen();
+    cb::const_byte_buffer buffer{static_cast<uint8_t*>(packet), size};
+    Cookie cookie(connection);
+
+    while (state.KeepRunning()) {
+        cookie.reset();
+        cookie.setPacket(Cookie::PacketContent::Full, buffer);
+        validator.validate(opcode, cookie);
+    }
+}
+
+static void PerOpcodeArguments(benchmark::internal::Benchmark* b) {
+    for (const auto opcode : {cb::mcbp::ClientOpcode::Get,
+                              cb::mcbp::ClientOpcode::Getk,
+                              cb::mcbp::ClientOpcode::Set,
+                              cb::mcbp::ClientOpcode::Add,
+                              cb::mcbp::ClientOpcode::Replace,
+                              cb::mcbp::ClientOpcode::Delete,
+                              cb::mcbp::ClientOpcode::Increment,
+                              cb::mcbp::ClientOpcode::Append,
+                              cb::mcbp::ClientOpcode::Touch,
+                              cb::mcbp::ClientOpcode::Gat,
+                              cb::mcbp::ClientOpcode::GetMeta,
+                              cb::mcbp::ClientOpcode::GetLocked,
+                              cb::mcbp::ClientOpcode::SubdocGet,
+                              cb::mcbp::ClientOpcode::SubdocMultiLookup,
+                              cb::mcbp::ClientOpcode::Noop}) {
+        b->Arg(int(opcode));
+    }
+}
+
 BENCHMARK_REGISTER_F(McbpValidatorBench, GetBench);
 BENCHMARK_REGISTER_F(McbpValidatorBench, SetBench);
 BENCHMARK_REGISTER_F(McbpValidatorBench, AddBench);
+BENCHMARK_REGISTER_F(McbpValidatorBench, CollectionsGetBench);
+BENCHMARK_REGISTER_F(McbpValidatorBench, DurableSetBench);
+BENCHMARK_REGISTER_F(McbpValidatorBench, DescriptorGetBench);
+BENCHMARK_REGISTER_F(McbpValidatorBench, PerOpcodeBench)
+        ->Apply(PerOpcodeArguments);
 BENCHMARK_MAIN()
@@ -2011,6 +2011,55 @@ TEST_P(DcpStreamReqValidatorTest, MessageValue) {
     }
 }
 
+class DcpStreamReqMultiValidatorTest
+    : public ::testing::WithParamInterface<bool>,
+      public ValidatorTest {
+public:
+    DcpStreamReqMultiValidatorTest() : ValidatorTest(GetParam()) {
+    }
+    void SetUp() override {
+        ValidatorTest::SetUp();
+        request.message.header.request.setBodylen(2 * 56);
+    }
+
+protected:
+    cb::mcbp::Status validate() {
+        return ValidatorTest::validate(
+                cb::mcbp::ClientOpcode::DcpStreamReqMulti,
+                static_cast<void*>(&request));
+    }
+};
+
+TEST_P(DcpStreamReqMultiValidatorTest, CorrectMessage) {
+    EXPECT_EQ(cb::mcbp::Status::NotSupported, validate());
+}
+
+TEST_P(DcpStreamReqMultiValidatorTest, InvalidExtlen) {
+    request.message.header.request.setExtlen(48);
+    request.message.header.request.setBodylen(48 + 56);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(DcpStreamReqMultiValidatorTest, InvalidKeylen) {
+    request.message.header.request.setKeylen(4);
+    request.message.header.request.setBodylen(4 + 56);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(DcpStreamReqMultiValidatorTest, InvalidDatatype) {
+    request.message.header.request.setDatatype(cb::mcbp::Datatype::JSON);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(DcpStreamReqMultiValidatorTest, InvalidBody) {
+    // No entries
+    request.message.header.request.setBodylen(0);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+    // A partial entry
+    request.message.header.request.setBodylen(56 + 20);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
 class DcpStreamEndValidatorTest : public ::testing::WithParamInterface<bool>,
                                   public ValidatorTest {
 public:
@@ -2196,6 +2245,15 @@ TEST_P(DcpMutationValidatorTest, InvalidKey2) {
     }
 }
 
+TEST_P(DcpMutationValidatorTest, InvalidNmeta) {
+    cb::mcbp::RequestBuilder builder({blob, sizeof(blob)}, true);
+    cb::mcbp::request::DcpMutationPayload extras;
+    extras.setBySeqno(1);
+    extras.setNmeta(10);
+    builder.setExtras(extras.getBuffer());
+    EXPECT_EQ("nmeta exceeds the value length", validate_error_context());
+}
+
 /**
  * Test class for DcpDeletion validation - the bool parameter toggles
  * collections on/off (as that subtly changes the encoding of a deletion)
@@ -4130,6 +4188,12 @@ TEST_P(GetRandomKeyValidatorTest, InvalidExtlen) {
     EXPECT_EQ(cb::mcbp::Status::Einval, validate());
 }
 
+TEST_P(GetRandomKeyValidatorTest, CollectionExtras) {
+    req.setExtlen(sizeof(cb::mcbp::request::GetRandomKeyPayload));
+    req.setBodylen(sizeof(cb::mcbp::request::GetRandomKeyPayload));
+    EXPECT_EQ(cb::mcbp::Status::Success, validate());
+}
+
 TEST_P(GetRandomKeyValidatorTest, InvalidDatatype) {
     req.setDatatype(cb::mcbp::Datatype::JSON);
     EXPECT_EQ(cb::mcbp::Status::Einval, validate());
@@ -4358,6 +4422,10 @@ INSTANTIATE_TEST_CASE_P(CollectionsOnOff,
                         DcpStreamReqValidatorTest,
                         ::testing::Bool(),
                         ::testing::PrintToStringParamName());
+INSTANTIATE_TEST_CASE_P(CollectionsOnOff,
+                        DcpStreamReqMultiValidatorTest,
+                        ::testing::Bool(),
+                        ::testing::PrintToStringParamName());
 INSTANTIATE_TEST_CASE_P(CollectionsOnOff,
                         DcpStreamEndValidatorTest,
                         ::testing::Bool(),
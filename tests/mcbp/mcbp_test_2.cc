@@ -460,6 +460,351 @@ TEST_P(GetKeysValidatorTest, InvalidBodylen) {
     EXPECT_EQ(cb::mcbp::Status::Einval, validate());
 }
 
+class RangeScanValidatorTest : public ::testing::WithParamInterface<bool>,
+                               public ValidatorTest {
+public:
+    RangeScanValidatorTest()
+        : ValidatorTest(GetParam()), req(request.message.header.request) {
+    }
+
+    void SetUp() override {
+        ValidatorTest::SetUp();
+        req.setExtlen(sizeof(cb::mcbp::request::RangeScanPayload));
+        req.setKeylen(2);
+        req.setBodylen(req.getExtlen() + req.getKeylen());
+        getPayload().setCount(10);
+    }
+
+protected:
+    cb::mcbp::request::RangeScanPayload& getPayload() {
+        return *reinterpret_cast<cb::mcbp::request::RangeScanPayload*>(
+                blob + sizeof(cb::mcbp::Request));
+    }
+
+    cb::mcbp::Request& req;
+    cb::mcbp::Status validate() {
+        return ValidatorTest::validate(cb::mcbp::ClientOpcode::RangeScan,
+                                       static_cast<void*>(&request));
+    }
+};
+
+TEST_P(RangeScanValidatorTest, CorrectMessage) {
+    EXPECT_EQ(cb::mcbp::Status::Success, validate());
+
+    // The end key is optional
+    req.setBodylen(req.getExtlen() + req.getKeylen() + 2);
+    EXPECT_EQ(cb::mcbp::Status::Success, validate());
+
+    getPayload().setFlags(cb::mcbp::request::RangeScanPayload::KeysOnly);
+    EXPECT_EQ(cb::mcbp::Status::Success, validate());
+}
+
+TEST_P(RangeScanValidatorTest, InvalidExtlen) {
+    req.setExtlen(4);
+    req.setBodylen(req.getExtlen() + req.getKeylen());
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(RangeScanValidatorTest, InvalidKey) {
+    // The key must be present
+    req.setKeylen(0);
+    req.setBodylen(req.getExtlen());
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(RangeScanValidatorTest, InvalidCount) {
+    getPayload().setCount(0);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(RangeScanValidatorTest, InvalidFlags) {
+    getPayload().setFlags(0x2);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+class GetMultiValidatorTest : public ::testing::WithParamInterface<bool>,
+                              public ValidatorTest {
+public:
+    GetMultiValidatorTest()
+        : ValidatorTest(GetParam()), req(request.message.header.request) {
+    }
+
+    void SetUp() override {
+        ValidatorTest::SetUp();
+        addKey(0, "key1");
+        addKey(1, "key2");
+    }
+
+protected:
+    /// Append an entry for the key to the value
+    void addKey(uint16_t vbid, const std::string& key, size_t keylen = 0) {
+        auto* ptr = blob + sizeof(cb::mcbp::Request) + req.getBodylen();
+        const uint16_t vbidNBO = htons(vbid);
+        const uint16_t keylenNBO = htons(keylen ? keylen : key.size());
+        std::copy_n(reinterpret_cast<const uint8_t*>(&vbidNBO), 2, ptr);
+        std::copy_n(reinterpret_cast<const uint8_t*>(&keylenNBO), 2, ptr + 2);
+        std::copy(key.begin(), key.end(), ptr + 4);
+        req.setBodylen(req.getBodylen() + 4 + key.size());
+    }
+
+    cb::mcbp::Request& req;
+    cb::mcbp::Status validate() {
+        return ValidatorTest::validate(cb::mcbp::ClientOpcode::GetMulti,
+                                       static_cast<void*>(&request));
+    }
+};
+
+TEST_P(GetMultiValidatorTest, CorrectMessage) {
+    EXPECT_EQ(cb::mcbp::Status::Success, validate());
+}
+
+TEST_P(GetMultiValidatorTest, InvalidValue) {
+    // The value must hold at least one key
+    req.setBodylen(0);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(GetMultiValidatorTest, InvalidKey) {
+    req.setKeylen(2);
+    req.setBodylen(req.getBodylen() + 2);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(GetMultiValidatorTest, TruncatedEntry) {
+    // An entry whose key length runs past the end of the value
+    addKey(2, "key3", 10);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+
+    // An entry without its key length
+    req.setBodylen(req.getBodylen() - 7);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(GetMultiValidatorTest, InvalidKeyLength) {
+    addKey(2, "");
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(GetMultiValidatorTest, GetMetaMulti) {
+    // GetMetaMulti requests have the same value as GetMulti ones
+    EXPECT_EQ(cb::mcbp::Status::Success,
+              ValidatorTest::validate(cb::mcbp::ClientOpcode::GetMetaMulti,
+                                      static_cast<void*>(&request)));
+    addKey(2, "key3", 10);
+    EXPECT_EQ(cb::mcbp::Status::Einval,
+              ValidatorTest::validate(cb::mcbp::ClientOpcode::GetMetaMulti,
+                                      static_cast<void*>(&request)));
+}
+
+class SetMultiValidatorTest : public ::testing::WithParamInterface<bool>,
+                              public ValidatorTest {
+public:
+    SetMultiValidatorTest()
+        : ValidatorTest(GetParam()), req(request.message.header.request) {
+    }
+
+    void SetUp() override {
+        ValidatorTest::SetUp();
+        addDocument(0, "key1", "value1");
+        addDocument(1, "key2", "value2");
+    }
+
+protected:
+    /// Append an entry for the document to the value
+    void addDocument(uint16_t vbid,
+                     const std::string& key,
+                     const std::string& value,
+                     uint8_t datatype = PROTOCOL_BINARY_RAW_BYTES,
+                     size_t valuelen = 0) {
+        auto* ptr = blob + sizeof(cb::mcbp::Request) + req.getBodylen();
+        const uint16_t vbidNBO = htons(vbid);
+        const uint16_t keylenNBO = htons(key.size());
+        const uint32_t flags = 0xcafef00d;
+        const uint32_t exptime = 0;
+        const uint32_t valuelenNBO = htonl(valuelen ? valuelen : value.size());
+        std::copy_n(reinterpret_cast<const uint8_t*>(&vbidNBO), 2, ptr);
+        std::copy_n(reinterpret_cast<const uint8_t*>(&keylenNBO), 2, ptr + 2);
+        ptr[4] = datatype;
+        std::copy_n(reinterpret_cast<const uint8_t*>(&flags), 4, ptr + 5);
+        std::copy_n(reinterpret_cast<const uint8_t*>(&exptime), 4, ptr + 9);
+        std::copy_n(
+                reinterpret_cast<const uint8_t*>(&valuelenNBO), 4, ptr + 13);
+        std::copy(key.begin(), key.end(), ptr + 17);
+        std::copy(value.begin(), value.end(), ptr + 17 + key.size());
+        req.setBodylen(req.getBodylen() + 17 + key.size() + value.size());
+    }
+
+    cb::mcbp::Request& req;
+    cb::mcbp::Status validate() {
+        return ValidatorTest::validate(cb::mcbp::ClientOpcode::SetMulti,
+                                       static_cast<void*>(&request));
+    }
+};
+
+TEST_P(SetMultiValidatorTest, CorrectMessage) {
+    EXPECT_EQ(cb::mcbp::Status::Success, validate());
+}
+
+TEST_P(SetMultiValidatorTest, EmptyDocument) {
+    addDocument(2, "key3", "");
+    EXPECT_EQ(cb::mcbp::Status::Success, validate());
+}
+
+TEST_P(SetMultiValidatorTest, InvalidValue) {
+    // The value must hold at least one document
+    req.setBodylen(0);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(SetMultiValidatorTest, InvalidKey) {
+    req.setKeylen(2);
+    req.setBodylen(req.getBodylen() + 2);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(SetMultiValidatorTest, InvalidCas) {
+    req.setCas(0xff);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(SetMultiValidatorTest, TruncatedEntry) {
+    // An entry whose value length runs past the end of the value
+    addDocument(2, "key3", "value3", PROTOCOL_BINARY_RAW_BYTES, 10);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+
+    // An entry without its value length
+    req.setBodylen(req.getBodylen() - 12);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(SetMultiValidatorTest, InvalidKeyLength) {
+    addDocument(2, "", "value3");
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(SetMultiValidatorTest, InvalidDatatype) {
+    // Compressed documents and extended attributes aren't supported
+    addDocument(2, "key3", "value3", PROTOCOL_BINARY_DATATYPE_SNAPPY);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+class SetWithMetaMultiValidatorTest
+    : public ::testing::WithParamInterface<bool>,
+      public ValidatorTest {
+public:
+    SetWithMetaMultiValidatorTest()
+        : ValidatorTest(GetParam()), req(request.message.header.request) {
+    }
+
+    void SetUp() override {
+        ValidatorTest::SetUp();
+        addDocument(0, "key1", "value1");
+        addDocument(1, "key2", "value2");
+    }
+
+protected:
+    /// Append an entry for the document to the value
+    void addDocument(uint16_t vbid,
+                     const std::string& key,
+                     const std::string& value,
+                     uint8_t datatype = PROTOCOL_BINARY_RAW_BYTES,
+                     uint8_t deleted = 0,
+                     size_t valuelen = 0) {
+        auto* ptr = blob + sizeof(cb::mcbp::Request) + req.getBodylen();
+        const uint16_t vbidNBO = htons(vbid);
+        const uint16_t keylenNBO = htons(key.size());
+        const uint32_t flags = 0xcafef00d;
+        const uint32_t exptime = 0;
+        const uint64_t seqno = htonll(1);
+        const uint64_t cas = htonll(0xdeadbeef);
+        const uint32_t valuelenNBO = htonl(valuelen ? valuelen : value.size());
+        std::copy_n(reinterpret_cast<const uint8_t*>(&vbidNBO), 2, ptr);
+        std::copy_n(reinterpret_cast<const uint8_t*>(&keylenNBO), 2, ptr + 2);
+        ptr[4] = datatype;
+        ptr[5] = deleted;
+        std::copy_n(reinterpret_cast<const uint8_t*>(&flags), 4, ptr + 6);
+        std::copy_n(reinterpret_cast<const uint8_t*>(&exptime), 4, ptr + 10);
+        std::copy_n(reinterpret_cast<const uint8_t*>(&seqno), 8, ptr + 14);
+        std::copy_n(reinterpret_cast<const uint8_t*>(&cas), 8, ptr + 22);
+        std::copy_n(
+                reinterpret_cast<const uint8_t*>(&valuelenNBO), 4, ptr + 30);
+        std::copy(key.begin(), key.end(), ptr + 34);
+        std::copy(value.begin(), value.end(), ptr + 34 + key.size());
+        req.setBodylen(req.getBodylen() + 34 + key.size() + value.size());
+    }
+
+    cb::mcbp::Request& req;
+    cb::mcbp::Status validate() {
+        return ValidatorTest::validate(
+                cb::mcbp::ClientOpcode::SetWithMetaMulti,
+                static_cast<void*>(&request));
+    }
+};
+
+TEST_P(SetWithMetaMultiValidatorTest, CorrectMessage) {
+    EXPECT_EQ(cb::mcbp::Status::Success, validate());
+}
+
+TEST_P(SetWithMetaMultiValidatorTest, Deletion) {
+    addDocument(2, "key3", "", PROTOCOL_BINARY_RAW_BYTES, 1);
+    EXPECT_EQ(cb::mcbp::Status::Success, validate());
+}
+
+TEST_P(SetWithMetaMultiValidatorTest, Options) {
+    // The extras may hold the options, ahead of the documents
+    req.setBodylen(0);
+    req.setExtlen(4);
+    req.setBodylen(4);
+    addDocument(0, "key1", "value1");
+    EXPECT_EQ(cb::mcbp::Status::Success, validate());
+
+    // But nothing else
+    req.setExtlen(2);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(SetWithMetaMultiValidatorTest, InvalidValue) {
+    // The value must hold at least one document
+    req.setBodylen(0);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(SetWithMetaMultiValidatorTest, InvalidKey) {
+    req.setKeylen(2);
+    req.setBodylen(req.getBodylen() + 2);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(SetWithMetaMultiValidatorTest, InvalidCas) {
+    req.setCas(0xff);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(SetWithMetaMultiValidatorTest, TruncatedEntry) {
+    // An entry whose value length runs past the end of the value
+    addDocument(2, "key3", "value3", PROTOCOL_BINARY_RAW_BYTES, 0, 10);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+
+    // An entry without its value length
+    req.setBodylen(req.getBodylen() - 12);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(SetWithMetaMultiValidatorTest, InvalidKeyLength) {
+    addDocument(2, "", "value3");
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(SetWithMetaMultiValidatorTest, InvalidDatatype) {
+    addDocument(2, "key3", "value3", 0xff);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(SetWithMetaMultiValidatorTest, InvalidDeleted) {
+    addDocument(2, "key3", "", PROTOCOL_BINARY_RAW_BYTES, 2);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
 class SetParamValidatorTest : public ::testing::WithParamInterface<bool>,
                               public ValidatorTest {
 public:
@@ -967,6 +1312,69 @@ TEST_P(CompactDbValidatorTest, InvalidBodylen) {
     EXPECT_EQ(cb::mcbp::Status::Einval, validate());
 }
 
+/// VbucketSnapshot and VbucketInstall requests only have a path as value
+class VbucketFileValidatorTest
+    : public ::testing::WithParamInterface<
+              std::tuple<cb::mcbp::ClientOpcode, bool>>,
+      public ValidatorTest {
+public:
+    VbucketFileValidatorTest()
+        : ValidatorTest(std::get<1>(GetParam())),
+          req(request.message.header.request) {
+    }
+
+    void SetUp() override {
+        ValidatorTest::SetUp();
+        req.setBodylen(10);
+    }
+
+protected:
+    cb::mcbp::Request& req;
+    cb::mcbp::Status validate() {
+        return ValidatorTest::validate(std::get<0>(GetParam()),
+                                       static_cast<void*>(&request));
+    }
+};
+
+TEST_P(VbucketFileValidatorTest, CorrectMessage) {
+    EXPECT_EQ(cb::mcbp::Status::Success, validate());
+}
+
+TEST_P(VbucketFileValidatorTest, InvalidExtlen) {
+    req.setExtlen(2);
+    req.setBodylen(req.getBodylen() + 2);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(VbucketFileValidatorTest, InvalidKey) {
+    req.setKeylen(2);
+    req.setBodylen(req.getBodylen() + 2);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(VbucketFileValidatorTest, MissingValue) {
+    req.setBodylen(0);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(VbucketFileValidatorTest, InvalidDatatype) {
+    req.setDatatype(cb::mcbp::Datatype::JSON);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+TEST_P(VbucketFileValidatorTest, InvalidCas) {
+    req.setCas(0xff);
+    EXPECT_EQ(cb::mcbp::Status::Einval, validate());
+}
+
+INSTANTIATE_TEST_CASE_P(
+        VbucketFileOpcodes,
+        VbucketFileValidatorTest,
+        ::testing::Combine(
+                ::testing::Values(cb::mcbp::ClientOpcode::VbucketSnapshot,
+                                  cb::mcbp::ClientOpcode::VbucketInstall),
+                ::testing::Bool()), );
+
 INSTANTIATE_TEST_CASE_P(CollectionsOnOff,
                         DropPrivilegeValidatorTest,
                         ::testing::Bool(),
@@ -1002,6 +1410,26 @@ INSTANTIATE_TEST_CASE_P(CollectionsOnOff,
                         ::testing::Bool(),
                         ::testing::PrintToStringParamName());
 
+INSTANTIATE_TEST_CASE_P(CollectionsOnOff,
+                        RangeScanValidatorTest,
+                        ::testing::Bool(),
+                        ::testing::PrintToStringParamName());
+
+INSTANTIATE_TEST_CASE_P(CollectionsOnOff,
+                        GetMultiValidatorTest,
+                        ::testing::Bool(),
+                        ::testing::PrintToStringParamName());
+
+INSTANTIATE_TEST_CASE_P(CollectionsOnOff,
+                        SetMultiValidatorTest,
+                        ::testing::Bool(),
+                        ::testing::PrintToStringParamName());
+
+INSTANTIATE_TEST_CASE_P(CollectionsOnOff,
+                        SetWithMetaMultiValidatorTest,
+                        ::testing::Bool(),
+                        ::testing::PrintToStringParamName());
+
 INSTANTIATE_TEST_CASE_P(CollectionsOnOff,
                         SetParamValidatorTest,
                         ::testing::Bool(),
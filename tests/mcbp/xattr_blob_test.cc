@@ -100,17 +100,14 @@ TEST(XattrBlob, TestPruneUser) {
     blob.set("user", "{\"author\":\"bubba\"}");
     blob.set("meta", "{\"content-type\":\"text\"}");
 
-    // And I know that when I change something that won't fit in the
-    // current place it'll be moved to the end. Let's modify one of
-    // the keys..
+    // Grow one of the keys (which moves the user xattrs after it)..
     blob.set("_rbac", "{\"auth\":\"needed\"}");
     // and then set it back so that the size should be the same..
     blob.set("_rbac", "{\"foo\":\"bar\"}");
     validate(blob.finalize());
     EXPECT_LT(systemsize, blob.finalize().len);
 
-    // Now prune off the user keys (we should have a system xattr first and
-    // and last)
+    // Now prune off the user keys (we should have the system xattrs first)
     blob.prune_user_keys();
     validate(blob.finalize());
 
@@ -233,3 +230,97 @@ TEST(XattrBlob, iterator_insert) {
         }
     }
 }
+
+/**
+ * Verify that changing the size of a value replaces it where it is,
+ * leaving the other kv-pairs in the same order
+ */
+TEST(XattrBlob, SetKeepsOrder) {
+    cb::xattr::Blob blob;
+    std::vector<std::string> keys = {"_sync", "_mou", "user"};
+    for (auto& k : keys) {
+        blob.set(k, k + ".value");
+    }
+
+    blob.set("_sync", "{\"a much longer value\":\"than it used to be\"}");
+    blob.set("_mou", "1");
+    validate(blob.finalize());
+
+    auto kItr = keys.begin();
+    for (auto kv : blob) {
+        EXPECT_EQ(*kItr, to_string(kv.first));
+        kItr++;
+    }
+    EXPECT_EQ(keys.end(), kItr);
+
+    EXPECT_EQ("{\"a much longer value\":\"than it used to be\"}",
+              to_string(blob.get("_sync")));
+    EXPECT_EQ("1", to_string(blob.get("_mou")));
+    EXPECT_EQ("user.value", to_string(blob.get("user")));
+}
+
+/**
+ * Verify that a copy made with room to grow (or a reserved blob) doesn't
+ * reallocate as it grows
+ */
+TEST(XattrBlob, Reserve) {
+    cb::xattr::Blob blob;
+    blob.set("_sync", "{\"cas\":\"0xdeadbeefcafefeed\"}");
+
+    cb::xattr::Blob copy(blob, 1024);
+    const auto* data = copy.data();
+    copy.set("_sync", R"({"cas":"0xdeadbeefcafefeed","rev":"1-abcdef"})");
+    copy.set("_mou", R"({"cas":"0xdeadbeefcafefeed"})");
+    copy.set("user", R"({"author":"bubba"})");
+    EXPECT_EQ(data, copy.data());
+    validate(copy.finalize());
+
+    // The original is untouched
+    EXPECT_EQ("{\"cas\":\"0xdeadbeefcafefeed\"}", to_string(blob.get("_sync")));
+    EXPECT_TRUE(blob.get("_mou").empty());
+
+    blob.reserve(1024);
+    data = blob.data();
+    for (int ii = 0; ii < 10; ++ii) {
+        blob.set("key" + std::to_string(ii), std::to_string(ii));
+    }
+    EXPECT_EQ(data, blob.data());
+    validate(blob.finalize());
+    EXPECT_EQ("{\"cas\":\"0xdeadbeefcafefeed\"}", to_string(blob.get("_sync")));
+    EXPECT_EQ("9", to_string(blob.get("key9")));
+}
+
+/**
+ * Verify that the xattrs of a compressed document may be read (only
+ * inflating the xattrs)
+ */
+TEST(XattrBlob, InflateXattrs) {
+    cb::xattr::Blob blob;
+    blob.set("_sync", R"({"cas":"0xdeadbeefcafefeed"})");
+    blob.set("meta", R"({"content-type":"text"})");
+    const auto xattrs = blob.finalize();
+
+    std::string document(xattrs.data(), xattrs.size());
+    for (int ii = 0; ii < 10000; ++ii) {
+        document.append(R"({"counter":)" + std::to_string(ii) + "}");
+    }
+
+    cb::compression::Buffer deflated;
+    ASSERT_TRUE(cb::compression::deflate(
+            cb::compression::Algorithm::Snappy, document, deflated));
+    const cb::const_char_buffer compressed = deflated;
+
+    cb::compression::Buffer inflated;
+    ASSERT_TRUE(cb::xattr::inflate_xattrs(compressed, inflated));
+    EXPECT_EQ(std::string(xattrs.data(), xattrs.size()),
+              std::string(inflated.data(), inflated.size()));
+
+    const cb::xattr::Blob copy({const_cast<char*>(compressed.data()),
+                                compressed.size()},
+                               true);
+    EXPECT_EQ(R"({"cas":"0xdeadbeefcafefeed"})", to_string(copy.get("_sync")));
+    EXPECT_EQ(R"({"content-type":"text"})", to_string(copy.get("meta")));
+
+    // A truncated document can't be inflated
+    EXPECT_FALSE(cb::xattr::inflate_xattrs({compressed.data(), 4}, inflated));
+}
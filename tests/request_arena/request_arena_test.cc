@@ -0,0 +1,93 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <daemon/protocol/mcbp/command_context.h>
+#include <daemon/request_arena.h>
+#include <folly/portability/GTest.h>
+#include <cstdint>
+#include <memory>
+
+TEST(RequestArenaTest, AllocateAndReset) {
+    cb::RequestArena arena;
+    auto* a = arena.allocate(10);
+    auto* b = arena.allocate(1);
+    ASSERT_NE(nullptr, a);
+    ASSERT_NE(nullptr, b);
+    EXPECT_NE(a, b);
+    EXPECT_TRUE(arena.owns(a));
+    EXPECT_TRUE(arena.owns(b));
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(b) % alignof(std::max_align_t));
+    EXPECT_EQ(2u, arena.getLiveAllocations());
+
+    // Rewinding isn't allowed while there are live allocations
+    arena.deallocate(a);
+    arena.reset();
+    EXPECT_NE(0u, arena.getBytesUsed());
+
+    arena.deallocate(b);
+    arena.reset();
+    EXPECT_EQ(0u, arena.getBytesUsed());
+    EXPECT_EQ(a, arena.allocate(10));
+}
+
+TEST(RequestArenaTest, AllocationTooBig) {
+    cb::RequestArena arena;
+    EXPECT_EQ(nullptr, arena.allocate(cb::RequestArena::BlockSize + 1));
+    EXPECT_NE(nullptr, arena.allocate(cb::RequestArena::BlockSize));
+    EXPECT_EQ(nullptr, arena.allocate(1));
+}
+
+class TestContext : public CommandContext {
+public:
+    explicit TestContext(bool& destroyed) : destroyed(destroyed) {
+    }
+    ~TestContext() override {
+        destroyed = true;
+    }
+    bool& destroyed;
+    char payload[128];
+};
+
+TEST(RequestArenaTest, CommandContextInArena) {
+    cb::RequestArena arena;
+    bool destroyed = false;
+    std::unique_ptr<CommandContext> context(new (arena)
+                                                    TestContext(destroyed));
+    EXPECT_TRUE(arena.owns(context.get()));
+    EXPECT_EQ(1u, arena.getLiveAllocations());
+    context.reset();
+    EXPECT_TRUE(destroyed);
+    EXPECT_EQ(0u, arena.getLiveAllocations());
+}
+
+TEST(RequestArenaTest, CommandContextFallbackToHeap) {
+    cb::RequestArena arena;
+    ASSERT_NE(nullptr, arena.allocate(cb::RequestArena::BlockSize));
+
+    bool destroyed = false;
+    std::unique_ptr<CommandContext> context(new (arena)
+                                                    TestContext(destroyed));
+    EXPECT_FALSE(arena.owns(context.get()));
+    EXPECT_EQ(1u, arena.getLiveAllocations());
+    context.reset();
+    EXPECT_TRUE(destroyed);
+
+    // Plain new should work as well
+    destroyed = false;
+    context.reset(new TestContext(destroyed));
+    context.reset();
+    EXPECT_TRUE(destroyed);
+}
@@ -0,0 +1,145 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <daemon/request_log.h>
+#include <folly/portability/GTest.h>
+#include <nlohmann/json.hpp>
+
+#include <thread>
+
+using namespace std::chrono;
+
+static cb::RequestRecord makeRecord(steady_clock::time_point end,
+                                    microseconds duration) {
+    cb::RequestRecord record;
+    record.end = end;
+    record.duration = duration;
+    record.blocked = duration / 2;
+    record.connectionId = 10;
+    record.opaque = 0xdeadbeef;
+    record.bodylen = 100;
+    record.bucket = 2;
+    record.opcode = cb::mcbp::ClientOpcode::Get;
+    record.blockedCount = 1;
+    return record;
+}
+
+TEST(RequestLogTest, RecordAndRead) {
+    cb::RequestLog log;
+    const auto now = steady_clock::now();
+    log.record(makeRecord(now, microseconds(42)));
+
+    std::vector<cb::RequestRecord> records;
+    log.getRecords(now - seconds(1), records);
+    ASSERT_EQ(1, records.size());
+    const auto& record = records.front();
+    EXPECT_EQ(now, record.end);
+    EXPECT_EQ(microseconds(42), record.duration);
+    EXPECT_EQ(microseconds(21), record.blocked);
+    EXPECT_EQ(10, record.connectionId);
+    EXPECT_EQ(0xdeadbeef, record.opaque);
+    EXPECT_EQ(100, record.bodylen);
+    EXPECT_EQ(2, record.bucket);
+    EXPECT_EQ(cb::mcbp::ClientOpcode::Get, record.opcode);
+    EXPECT_EQ(1, record.blockedCount);
+
+    const auto json = record.toJSON(now);
+    EXPECT_EQ("GET", json["opcode"].get<std::string>());
+    EXPECT_EQ(42, json["duration_us"].get<int>());
+
+    // Records older than requested are skipped
+    records.clear();
+    log.getRecords(now + seconds(1), records);
+    EXPECT_TRUE(records.empty());
+}
+
+TEST(RequestLogTest, Wraps) {
+    cb::RequestLog log;
+    const auto now = steady_clock::now();
+    for (size_t ii = 0; ii < cb::RequestLog::Size * 2; ++ii) {
+        log.record(makeRecord(now, microseconds(ii)));
+    }
+
+    std::vector<cb::RequestRecord> records;
+    log.getRecords(now, records);
+    ASSERT_EQ(cb::RequestLog::Size, records.size());
+    // We should only have the newest records
+    EXPECT_EQ(microseconds(cb::RequestLog::Size), records.front().duration);
+    EXPECT_EQ(microseconds(cb::RequestLog::Size * 2 - 1),
+              records.back().duration);
+}
+
+TEST(RequestLogTest, Saturates) {
+    cb::RequestLog log;
+    const auto now = steady_clock::now();
+    log.record(makeRecord(now, hours(2)));
+
+    std::vector<cb::RequestRecord> records;
+    log.getRecords(now, records);
+    ASSERT_EQ(1, records.size());
+    EXPECT_EQ(microseconds(std::numeric_limits<uint32_t>::max()),
+              records.front().duration);
+}
+
+TEST(RequestLogTest, SlowestRequests) {
+    std::vector<std::unique_ptr<cb::RequestLog>> logs;
+    logs.emplace_back(std::make_unique<cb::RequestLog>());
+    logs.emplace_back(std::make_unique<cb::RequestLog>());
+
+    const auto now = steady_clock::now();
+    logs[0]->record(makeRecord(now, microseconds(10)));
+    logs[0]->record(makeRecord(now, microseconds(500)));
+    logs[1]->record(makeRecord(now, microseconds(300)));
+    logs[1]->record(makeRecord(now, microseconds(20)));
+    // Outside of the window
+    logs[1]->record(makeRecord(now - minutes(10), microseconds(1000)));
+
+    auto slowest = cb::getSlowestRequests(logs, 2, minutes(1));
+    ASSERT_EQ(2, slowest.size());
+    EXPECT_EQ(microseconds(500), slowest[0].duration);
+    EXPECT_EQ(microseconds(300), slowest[1].duration);
+
+    slowest = cb::getSlowestRequests(logs, 10, minutes(1));
+    EXPECT_EQ(4, slowest.size());
+}
+
+TEST(RequestLogTest, ConcurrentReader) {
+    // The reader should never see a torn record while the writer is
+    // overwriting the slots
+    cb::RequestLog log;
+    const auto now = steady_clock::now();
+    std::atomic_bool done{false};
+    std::thread writer([&log, &done, now]() {
+        for (uint32_t ii = 0; ii < 200000; ++ii) {
+            auto record = makeRecord(now, microseconds(ii));
+            record.connectionId = ii;
+            record.bodylen = ii;
+            log.record(record);
+        }
+        done = true;
+    });
+
+    std::vector<cb::RequestRecord> records;
+    while (!done) {
+        records.clear();
+        log.getRecords(now, records);
+        for (const auto& record : records) {
+            ASSERT_EQ(record.connectionId, record.bodylen);
+            ASSERT_EQ(record.connectionId, uint32_t(record.duration.count()));
+        }
+    }
+    writer.join();
+}
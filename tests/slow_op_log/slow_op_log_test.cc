@@ -0,0 +1,156 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <daemon/slow_op_log.h>
+#include <daemon/timings.h>
+#include <folly/portability/GTest.h>
+#include <nlohmann/json.hpp>
+
+using namespace std::chrono;
+
+static cb::SlowOpRecord makeRecord(uint32_t opaque) {
+    cb::SlowOpRecord record;
+    record.timestamp = system_clock::now();
+    record.duration = milliseconds(10);
+    record.threshold = milliseconds(5);
+    record.adaptive = true;
+    record.opcode = cb::mcbp::ClientOpcode::Get;
+    record.start = steady_clock::now();
+    record.spans.emplace_back(cb::tracing::TraceCode::REQUEST,
+                              record.start,
+                              cb::tracing::Span::Duration(10000));
+    record.spans.emplace_back(cb::tracing::TraceCode::GET,
+                              record.start + microseconds(100),
+                              cb::tracing::Span::Duration(9000));
+    record.execution = milliseconds(1);
+    record.blocked = milliseconds(9);
+    record.blockedCount = 1;
+    record.allocated = 512;
+    record.connectionId = 10;
+    record.opaque = opaque;
+    record.peer = "127.0.0.1:12345";
+    record.user = "<ud>user</ud>";
+    record.bucket = "default";
+    record.key = "<ud>key</ud>";
+    return record;
+}
+
+TEST(SlowOpLogTest, DisabledByDefault) {
+    cb::SlowOpLog log;
+    EXPECT_FALSE(log.isEnabled());
+    log.record(makeRecord(1));
+    EXPECT_TRUE(log.getRecords(10).empty());
+    EXPECT_EQ(0, log.getNumRecorded());
+}
+
+TEST(SlowOpLogTest, KeepsTheMostRecent) {
+    cb::SlowOpLog log;
+    log.setCapacity(3);
+    for (uint32_t ii = 0; ii < 5; ++ii) {
+        log.record(makeRecord(ii));
+    }
+    EXPECT_EQ(5, log.getNumRecorded());
+
+    const auto records = log.getRecords(10);
+    ASSERT_EQ(3, records.size());
+    EXPECT_EQ(4, records[0].opaque);
+    EXPECT_EQ(3, records[1].opaque);
+    EXPECT_EQ(2, records[2].opaque);
+
+    ASSERT_EQ(1, log.getRecords(1).size());
+    EXPECT_EQ(4, log.getRecords(1).front().opaque);
+
+    // Shrinking the log drops the oldest records
+    log.setCapacity(1);
+    ASSERT_EQ(1, log.getRecords(10).size());
+    EXPECT_EQ(4, log.getRecords(10).front().opaque);
+
+    log.clear();
+    EXPECT_TRUE(log.getRecords(10).empty());
+}
+
+TEST(SlowOpLogTest, ToJSON) {
+    const auto json = makeRecord(0xdeadbeef).toJSON();
+    EXPECT_EQ("GET", json["opcode"].get<std::string>());
+    EXPECT_EQ(10000, json["duration_us"].get<int64_t>());
+    EXPECT_EQ(5000, json["threshold_us"].get<int64_t>());
+    EXPECT_TRUE(json["adaptive"].get<bool>());
+    EXPECT_EQ(1000, json["execution_us"].get<int64_t>());
+    EXPECT_EQ(9000, json["blocked_us"].get<int64_t>());
+    EXPECT_EQ(1, json["blocked_count"].get<int>());
+    EXPECT_EQ(512, json["allocated"].get<uint64_t>());
+    EXPECT_EQ(10, json["connection_id"].get<uint32_t>());
+    EXPECT_EQ("0xdeadbeef", json["opaque"].get<std::string>());
+    EXPECT_EQ("127.0.0.1:12345", json["peer"].get<std::string>());
+    EXPECT_EQ("default", json["bucket"].get<std::string>());
+    EXPECT_EQ("<ud>key</ud>", json["key"].get<std::string>());
+
+    const auto& spans = json["spans"];
+    ASSERT_EQ(2, spans.size());
+    EXPECT_EQ(0, spans[0]["start_us"].get<int64_t>());
+    EXPECT_EQ(10000, spans[0]["duration_us"].get<int64_t>());
+    EXPECT_EQ(100, spans[1]["start_us"].get<int64_t>());
+    EXPECT_EQ(9000, spans[1]["duration_us"].get<int64_t>());
+}
+
+TEST(AdaptiveSlowOpThresholdsTest, DerivedFromThePercentile) {
+    Timings timings;
+    cb::AdaptiveSlowOpThresholds thresholds;
+    EXPECT_EQ(nanoseconds(0), thresholds.get(cb::mcbp::ClientOpcode::Get));
+
+    // Not enough samples
+    for (int ii = 0; ii < 10; ++ii) {
+        timings.collect(cb::mcbp::ClientOpcode::Get, milliseconds(1), 0);
+    }
+    thresholds.update(timings, 99, microseconds(100));
+    EXPECT_EQ(nanoseconds(0), thresholds.get(cb::mcbp::ClientOpcode::Get));
+
+    for (uint64_t ii = 0; ii < cb::AdaptiveSlowOpThresholds::MinSamples;
+         ++ii) {
+        timings.collect(cb::mcbp::ClientOpcode::Get, milliseconds(1), 0);
+    }
+    thresholds.update(timings, 99, microseconds(100));
+    const auto threshold = thresholds.get(cb::mcbp::ClientOpcode::Get);
+    EXPECT_LE(microseconds(950), threshold);
+    EXPECT_GE(microseconds(1050), threshold);
+    EXPECT_EQ(nanoseconds(0), thresholds.get(cb::mcbp::ClientOpcode::Set));
+
+    // The threshold is never below the minimum
+    thresholds.update(timings, 99, milliseconds(5));
+    EXPECT_EQ(milliseconds(5), thresholds.get(cb::mcbp::ClientOpcode::Get));
+
+    // A percentile of 0 disables the thresholds
+    thresholds.update(timings, 0, microseconds(100));
+    EXPECT_EQ(nanoseconds(0), thresholds.get(cb::mcbp::ClientOpcode::Get));
+}
+
+// The front end threads record into their own shards, and the thresholds
+// must be derived from all of them
+TEST(AdaptiveSlowOpThresholdsTest, MergesAllThreads) {
+    Timings timings;
+    timings.setNumThreads(4);
+    cb::AdaptiveSlowOpThresholds thresholds;
+
+    // No single thread has enough samples on its own
+    for (uint64_t ii = 0; ii < cb::AdaptiveSlowOpThresholds::MinSamples;
+         ++ii) {
+        timings.collect(cb::mcbp::ClientOpcode::Get, milliseconds(1), ii % 4);
+    }
+    thresholds.update(timings, 99, microseconds(100));
+    const auto threshold = thresholds.get(cb::mcbp::ClientOpcode::Get);
+    EXPECT_LE(microseconds(950), threshold);
+    EXPECT_GE(microseconds(1050), threshold);
+}
@@ -0,0 +1,168 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <daemon/settings.h>
+#include <daemon/ssl_context.h>
+#include <folly/portability/GTest.h>
+#include <openssl/ssl.h>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+
+/// Expose the kTLS state so we can check it
+class KtlsSslContext : public SslContext {
+public:
+    bool isKtlsRequested() const {
+        return ktls.requested;
+    }
+
+    bool hasKtlsSecret() const {
+        return !ktls.secret.empty();
+    }
+};
+
+class SslContextTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        settings.setSslKtlsEnabled(true);
+        settings.setBioDrainBufferSize(8192);
+
+        ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+        for (auto fd : fds) {
+            ASSERT_EQ(0, fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK));
+        }
+
+        const std::string dir = SOURCE_ROOT "/tests/cert/";
+        ASSERT_TRUE(server.enable(dir + "testapp.cert", dir + "testapp.pem"));
+
+        clientCtx = SSL_CTX_new(TLS_client_method());
+        ASSERT_NE(nullptr, clientCtx);
+        SSL_CTX_set_min_proto_version(clientCtx, TLS1_3_VERSION);
+        client = SSL_new(clientCtx);
+        ASSERT_NE(nullptr, client);
+        SSL_set_fd(client, fds[1]);
+    }
+
+    void TearDown() override {
+        SSL_free(client);
+        SSL_CTX_free(clientCtx);
+        server.disable();
+        close(fds[0]);
+        close(fds[1]);
+        settings.setSslKtlsEnabled(false);
+        settings.setBioDrainBufferSize(0);
+    }
+
+    /**
+     * Run the handshake until the server side is done, but leave the
+     * server's last flight of handshake data in its BIO (the state the
+     * connection is in if it writes a response before the send pipe
+     * is drained)
+     */
+    void handshakeWithPendingOutput() {
+        for (int ii = 0; ii < 100; ++ii) {
+            auto ret = SSL_connect(client);
+            if (ret != 1) {
+                ASSERT_EQ(SSL_ERROR_WANT_READ, SSL_get_error(client, ret));
+            }
+
+            server.drainBioRecvPipe(fds[0]);
+            ret = server.accept();
+            if (ret == 1) {
+                server.setConnected();
+                ASSERT_TRUE(server.morePendingOutput());
+                return;
+            }
+            ASSERT_EQ(SSL_ERROR_WANT_READ, server.getError(ret));
+            server.drainBioSendPipe(fds[0]);
+        }
+        FAIL() << "Handshake did not complete";
+    }
+
+    /// Send everything the server has buffered to the client
+    void flushServer() {
+        while (server.morePendingOutput()) {
+            server.drainBioSendPipe(fds[0]);
+            ASSERT_FALSE(server.hasError());
+        }
+    }
+
+    KtlsSslContext server;
+    SSL_CTX* clientCtx = nullptr;
+    SSL* client = nullptr;
+    int fds[2] = {-1, -1};
+};
+
+/**
+ * A response written by OpenSSL while the handshake data is still pending
+ * moves its write sequence past 0, so the send path must not be handed
+ * over to the kernel (which would reuse record sequence 0 and the nonce)
+ * when the handshake data is drained later.
+ */
+TEST_F(SslContextTest, WriteWhileHandshakePendingKeepsSendPathInOpenSSL) {
+    if (!server.isKtlsRequested()) {
+        // Built without kTLS support
+        return;
+    }
+
+    handshakeWithPendingOutput();
+    ASSERT_TRUE(server.isConnected());
+    ASSERT_TRUE(server.hasKtlsSecret());
+
+    const std::string data = "response written before the handshake drained";
+    ASSERT_EQ(int(data.size()), server.write(data.data(), int(data.size())));
+    EXPECT_FALSE(server.isKtlsRequested());
+    EXPECT_FALSE(server.hasKtlsSecret());
+
+    flushServer();
+    server.tryEnableKtlsTx(fds[0]);
+    EXPECT_FALSE(server.isKtlsTxEnabled());
+
+    // And the client still gets the data (OpenSSL kept encrypting it)
+    ASSERT_EQ(1, SSL_connect(client));
+    std::string received(data.size(), '\0');
+    ASSERT_EQ(int(data.size()),
+              SSL_read(client, &received[0], int(received.size())));
+    EXPECT_EQ(data, received);
+}
+
+/**
+ * Without any records written after the handshake we wait for the
+ * handshake data to be drained before trying (once) to enable kTLS.
+ */
+TEST_F(SslContextTest, TryEnableWaitsForHandshakeToDrain) {
+    if (!server.isKtlsRequested()) {
+        // Built without kTLS support
+        return;
+    }
+
+    handshakeWithPendingOutput();
+
+    server.tryEnableKtlsTx(fds[0]);
+    EXPECT_TRUE(server.isKtlsRequested());
+    EXPECT_TRUE(server.hasKtlsSecret());
+
+    flushServer();
+    server.tryEnableKtlsTx(fds[0]);
+    // We only try once, and the secret is gone whatever the outcome (the
+    // kernel doesn't support kTLS on AF_UNIX so it is never enabled here)
+    EXPECT_FALSE(server.isKtlsRequested());
+    EXPECT_FALSE(server.hasKtlsSecret());
+    EXPECT_FALSE(server.isKtlsTxEnabled());
+}
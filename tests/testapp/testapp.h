@@ -479,6 +479,15 @@ stats_response_t request_stats();
  */
 uint64_t extract_single_stat(const stats_response_t& stats, const char* name);
 
+/**
+ * Get the id (socket) of the connection, as used by "stats connections <id>"
+ * (sends a HELLO with a unique agent name on the connection to find it)
+ */
+intptr_t getConnectionId(MemcachedConnection& conn);
+
+/// Get the "stats connections" entry for the connection with the given id
+nlohmann::json getConnectionStats(MemcachedConnection& conn, intptr_t id);
+
 ssize_t socket_recv(SOCKET s, char* buf, size_t len);
 ssize_t socket_send(SOCKET s, const char* buf, size_t len);
 void adjust_memcached_clock(
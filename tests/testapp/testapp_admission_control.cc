@@ -0,0 +1,84 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "testapp.h"
+#include "testapp_client_test.h"
+
+#include <chrono>
+#include <thread>
+
+/**
+ * Tests for the admission control (mutations are rejected with TMPFAIL
+ * while the bucket is close to its limits). The pressure is injected with
+ * the ewouldblock engine.
+ */
+class AdmissionControlTest : public TestappClientTest {
+protected:
+    void SetUp() override {
+        TestappClientTest::SetUp();
+        memcached_cfg["admission_control_threshold"] = 80;
+        reconfigure();
+    }
+
+    void TearDown() override {
+        setPressure(0);
+        memcached_cfg["admission_control_threshold"] = 0;
+        reconfigure();
+        TestappClientTest::TearDown();
+    }
+
+    /// Set the pressure (in percent) and wait for it to be sampled
+    void setPressure(uint32_t percent) {
+        getConnection().configureEwouldBlockEngine(
+                EWBEngineMode::Pressure, ENGINE_SUCCESS, percent);
+        // Sampled at most every AdmissionControl::SampleInterval (100ms)
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+
+    BinprotResponse store() {
+        BinprotMutationCommand cmd;
+        cmd.setMutationType(MutationType::Set);
+        cmd.setKey(name);
+        cmd.setValue("value");
+        return getConnection().execute(cmd);
+    }
+};
+
+INSTANTIATE_TEST_CASE_P(TransportProtocols,
+                        AdmissionControlTest,
+                        ::testing::Values(TransportProtocols::McbpPlain),
+                        ::testing::PrintToStringParamName());
+
+TEST_P(AdmissionControlTest, RejectMutationsUnderPressure) {
+    auto rsp = store();
+    ASSERT_TRUE(rsp.isSuccess()) << to_string(rsp.getStatus());
+
+    setPressure(90);
+    rsp = store();
+    EXPECT_EQ(cb::mcbp::Status::Etmpfail, rsp.getStatus());
+
+    // Reads are still served
+    BinprotGetCommand get;
+    get.setKey(name);
+    rsp = getConnection().execute(get);
+    EXPECT_TRUE(rsp.isSuccess()) << to_string(rsp.getStatus());
+
+    // ... and mutations are admitted again once the pressure drops
+    setPressure(50);
+    rsp = store();
+    EXPECT_TRUE(rsp.isSuccess()) << to_string(rsp.getStatus());
+}
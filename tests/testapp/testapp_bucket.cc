@@ -146,6 +146,51 @@ TEST_P(BucketTest, TestDeleteNonexistingBucket) {
     }
 }
 
+// A deleted bucket gives up its name once the delete returns, so it may be
+// created again straight away
+TEST_P(BucketTest, TestRecreateDeletedBucket) {
+    auto& conn = getAdminConnection();
+    for (int ii = 0; ii < 5; ++ii) {
+        conn.createBucket("recreate", "", BucketType::Memcached);
+        conn.deleteBucket("recreate");
+    }
+    for (const auto& bucket : conn.listBuckets()) {
+        EXPECT_NE("recreate", bucket);
+    }
+}
+
+// More buckets than may initialize / shut down at the same time are
+// created and deleted in parallel; they all have to complete
+TEST_P(BucketTest, TestCreateAndDeleteBucketsInParallel) {
+    auto& conn = getAdminConnection();
+    const int nbuckets = 8;
+    std::mutex mutex;
+    std::vector<std::string> errors;
+    std::vector<std::thread> threads;
+    for (int ii = 0; ii < nbuckets; ++ii) {
+        threads.emplace_back([&conn, &mutex, &errors, ii]() {
+            const auto name = "parallel-" + std::to_string(ii);
+            try {
+                auto c = conn.clone();
+                c->authenticate("@admin", "password", "PLAIN");
+                c->createBucket(name, "", BucketType::Memcached);
+                c->deleteBucket(name);
+            } catch (const std::exception& e) {
+                std::lock_guard<std::mutex> guard(mutex);
+                errors.push_back(name + ": " + e.what());
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_TRUE(errors.empty()) << errors.front();
+
+    for (const auto& bucket : conn.listBuckets()) {
+        EXPECT_EQ(std::string::npos, bucket.find("parallel-")) << bucket;
+    }
+}
+
 // Regression test for MB-19756 - if a bucket delete is attempted while there
 // is connection in the conn_read_packet_body state, then delete will hang.
 TEST_P(BucketTest, MB19756TestDeleteWhileClientConnected) {
@@ -425,8 +470,7 @@ int64_t getTotalSent(const nlohmann::json& payload) {
     }
 }
 
-static nlohmann::json getConnectionStats(MemcachedConnection& conn,
-                                         intptr_t id) {
+nlohmann::json getConnectionStats(MemcachedConnection& conn, intptr_t id) {
     const auto stats = conn.stats("connections " + std::to_string(id));
     if (stats.empty()) {
         throw std::runtime_error("getConnectionStats(): nothing returned");
@@ -548,6 +592,83 @@ TEST_P(BucketTest, MB29639TestDeleteWhileSendDataAndFullWriteBuffer) {
     client.join();
 }
 
+/**
+ * Verify that a value sent with MSG_ZEROCOPY isn't released (and its
+ * memory reused) before the kernel reports that it's done sending from it.
+ *
+ * The reader requests a value above zerocopy_send_threshold without
+ * reading the response, while the value is replaced under it. The reader
+ * must still receive the original value, and once the completions are
+ * reaped the connection must no longer pin any items.
+ */
+TEST_P(BucketTest, ZeroCopySendReleasesItemAfterCompletion) {
+    if (GetParam() == TransportProtocols::McbpSsl) {
+        // Only plain connections send with MSG_ZEROCOPY
+        return;
+    }
+
+    memcached_cfg["zerocopy_send_threshold"] = 64 * 1024;
+    reconfigure();
+
+    auto& conn = getAdminConnection();
+    conn.createBucket("zerocopy",
+                      "cache_size=67108864;item_size_max=2097152",
+                      BucketType::Memcached);
+    conn.selectBucket("zerocopy");
+
+    auto reader = conn.clone();
+    reader->authenticate("@admin", "password", "PLAIN");
+    reader->selectBucket("zerocopy");
+    const auto id = getConnectionId(*reader);
+
+    Document document;
+    document.info.id = name;
+    document.info.cas = mcbp::cas::Wildcard;
+    document.info.datatype = cb::mcbp::Datatype::Raw;
+    document.value.assign(1024 * 1024, 'a');
+    conn.mutate(document, Vbid(0), MutationType::Set);
+
+    BinprotGetCommand cmd;
+    cmd.setKey(name);
+    reader->sendCommand(cmd);
+
+    // Replace the value (and reuse the memory of the old one) while the
+    // response may still be in flight
+    Document replacement = document;
+    replacement.value.assign(document.value.size(), 'b');
+    for (int ii = 0; ii < 10; ++ii) {
+        conn.remove(name, Vbid(0));
+        conn.mutate(replacement, Vbid(0), MutationType::Set);
+    }
+
+    BinprotGetResponse rsp;
+    reader->recvResponse(rsp);
+    ASSERT_TRUE(rsp.isSuccess());
+    EXPECT_EQ(document.value, rsp.getDataString());
+
+    auto json = getConnectionStats(conn, id);
+    if (json["zerocopy"]["socket"].get<std::string>() == "enabled") {
+        EXPECT_LT(0, json["zerocopy"]["sent"].get<uint32_t>());
+        const auto timeout =
+                std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (json["zerocopy"]["pinned"].get<size_t>() != 0 &&
+               std::chrono::steady_clock::now() < timeout) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            json = getConnectionStats(conn, id);
+        }
+        EXPECT_EQ(json["zerocopy"]["sent"], json["zerocopy"]["completed"]);
+        EXPECT_EQ(0, json["zerocopy"]["pinned"].get<size_t>());
+    } else {
+        // SO_ZEROCOPY isn't supported by the kernel; the value is copied
+        EXPECT_EQ(0, json["zerocopy"]["sent"].get<uint32_t>());
+    }
+
+    reader.reset();
+    conn.deleteBucket("zerocopy");
+    memcached_cfg.erase("zerocopy_send_threshold");
+    reconfigure();
+}
+
 TEST_P(BucketTest, TestListBucket) {
     auto& conn = getAdminConnection();
     auto buckets = conn.listBuckets();
@@ -16,6 +16,7 @@
  */
 
 #include "testapp_xattr.h"
+#include <platform/compress.h>
 #include <cctype>
 #include <limits>
 #include <thread>
@@ -125,6 +126,41 @@ TEST_P(ClusterConfigTest, GetClusterConfig) {
                                    {value.data(), value.size()}));
 }
 
+/**
+ * Verify that a client which negotiated Snappy gets the configuration
+ * compressed (and the others get it as plain JSON)
+ */
+TEST_P(ClusterConfigTest, GetClusterConfigSnappy) {
+    std::string config{R"({"rev":100,"nodes":[)"};
+    for (int ii = 0; ii < 100; ++ii) {
+        config += R"({"hostname":"node)" + std::to_string(ii) +
+                  R"(.example.com:8091","ports":{"direct":11210}},)";
+    }
+    config.back() = ']';
+    config.push_back('}');
+    ASSERT_TRUE(setClusterConfig(token, config).isSuccess());
+
+    BinprotGenericCommand cmd{cb::mcbp::ClientOpcode::GetClusterConfig, "", ""};
+    auto& conn = getConnection();
+    conn.setFeature(cb::mcbp::Feature::SNAPPY, true);
+    auto response = conn.execute(cmd);
+    ASSERT_TRUE(response.isSuccess());
+    ASSERT_TRUE(mcbp::datatype::is_snappy(response.getDatatype()));
+    const auto data = response.getData();
+    cb::compression::Buffer inflated;
+    ASSERT_TRUE(cb::compression::inflate(
+            cb::compression::Algorithm::Snappy,
+            {reinterpret_cast<const char*>(data.data()), data.size()},
+            inflated));
+    EXPECT_EQ(config, std::string(inflated.data(), inflated.size()));
+
+    conn.setFeature(cb::mcbp::Feature::SNAPPY, false);
+    response = conn.execute(cmd);
+    ASSERT_TRUE(response.isSuccess());
+    EXPECT_FALSE(mcbp::datatype::is_snappy(response.getDatatype()));
+    EXPECT_EQ(config, response.getDataString());
+}
+
 TEST_P(ClusterConfigTest, test_MB_17506_no_dedupe) {
     test_MB_17506(false);
 }
@@ -23,9 +23,14 @@
 #include "testapp.h"
 #include "testapp_client_test.h"
 
+#include <platform/socket.h>
 #include <xattr/blob.h>
 #include <xattr/utils.h>
 
+#include <chrono>
+#include <cstring>
+#include <thread>
+
 class DcpTest : public TestappClientTest {
 
 };
@@ -128,3 +133,133 @@ TEST_P(DcpTest, UnorderedExecutionNotSupported) {
     EXPECT_FALSE(rsp.isSuccess());
     EXPECT_EQ(cb::mcbp::Status::NotSupported, rsp.getStatus());
 }
+
+/**
+ * Verify that DcpStreamReqMulti passes each entry to the engine in turn and
+ * returns all of their results (in the order requested) in one response
+ */
+TEST_P(DcpTest, StreamReqMulti) {
+    auto& conn = getConnection();
+
+    conn.sendCommand(BinprotDcpOpenCommand{
+            "ewb_internal:1", 0, cb::mcbp::request::DcpOpenPayload::Producer});
+
+    BinprotResponse rsp;
+    conn.recvResponse(rsp);
+    ASSERT_TRUE(rsp.isSuccess());
+
+    // The internal stream rolls back a request starting at seqno 1 (to 0),
+    // and accepts any other
+    using cb::mcbp::request::DcpStreamReqMultiEntry;
+    std::vector<DcpStreamReqMultiEntry> entries(2);
+    entries[0].setStartSeqno(1);
+    entries[0].setEndSeqno(~uint64_t(0));
+    entries[0].setOpaque(0xdeadbeef);
+    entries[0].setVBucket(Vbid(0));
+    entries[1].setEndSeqno(~uint64_t(0));
+    entries[1].setOpaque(0xcafef00d);
+    entries[1].setVBucket(Vbid(1));
+
+    BinprotGenericCommand cmd{cb::mcbp::ClientOpcode::DcpStreamReqMulti};
+    cmd.setValue({reinterpret_cast<const char*>(entries.data()),
+                  entries.size() * sizeof(DcpStreamReqMultiEntry)});
+    conn.sendCommand(cmd);
+    conn.recvResponse(rsp);
+    ASSERT_EQ(cb::mcbp::Status::Success, rsp.getStatus());
+
+    using cb::mcbp::response::DcpStreamReqMultiResult;
+    auto data = rsp.getDataString();
+    ASSERT_EQ(2 * sizeof(DcpStreamReqMultiResult) + sizeof(uint64_t),
+              data.size());
+
+    const auto* result =
+            reinterpret_cast<const DcpStreamReqMultiResult*>(data.data());
+    EXPECT_EQ(Vbid(0), result->getVBucket());
+    EXPECT_EQ(cb::mcbp::Status::Rollback, result->getStatus());
+    ASSERT_EQ(sizeof(uint64_t), result->getLength());
+    uint64_t rollbackSeqno;
+    std::memcpy(&rollbackSeqno,
+                data.data() + sizeof(DcpStreamReqMultiResult),
+                sizeof(rollbackSeqno));
+    EXPECT_EQ(0, ntohll(rollbackSeqno));
+
+    result = reinterpret_cast<const DcpStreamReqMultiResult*>(
+            data.data() + sizeof(DcpStreamReqMultiResult) +
+            sizeof(uint64_t));
+    EXPECT_EQ(Vbid(1), result->getVBucket());
+    EXPECT_EQ(cb::mcbp::Status::Success, result->getStatus());
+    EXPECT_EQ(0, result->getLength());
+}
+
+/**
+ * The values of DCP mutations above zerocopy_send_threshold are sent from
+ * the item with MSG_ZEROCOPY (the item of the internal stream has ~1100
+ * bytes of xattrs and body), and the items are released once the kernel
+ * reports the sends as completed.
+ */
+TEST_P(DcpTest, ZeroCopySendOfMutationValues) {
+    if (GetParam() == TransportProtocols::McbpSsl) {
+        // Only plain connections send with MSG_ZEROCOPY
+        return;
+    }
+
+    memcached_cfg["zerocopy_send_threshold"] = 512;
+    reconfigure();
+
+    auto& conn = getConnection();
+    conn.authenticate("@admin", "password", "PLAIN");
+    conn.selectBucket("default");
+    const auto id = getConnectionId(conn);
+
+    conn.sendCommand(BinprotDcpOpenCommand{
+            "ewb_internal:10", 0, cb::mcbp::request::DcpOpenPayload::Producer});
+
+    BinprotResponse rsp;
+    conn.recvResponse(rsp);
+    ASSERT_TRUE(rsp.isSuccess());
+
+    conn.sendCommand(BinprotDcpStreamRequestCommand{});
+    conn.recvResponse(rsp);
+    ASSERT_TRUE(rsp.isSuccess());
+
+    const std::string body(1000, 'x');
+    Frame frame;
+    for (int ii = 0; ii < 10; ++ii) {
+        conn.recvFrame(frame);
+        const auto* request = frame.getRequest();
+        ASSERT_EQ(cb::mcbp::ClientOpcode::DcpMutation,
+                  request->getClientOpcode());
+        const auto value = request->getValue();
+        ASSERT_LT(body.size(), value.size());
+        EXPECT_EQ(body,
+                  std::string(reinterpret_cast<const char*>(value.data()) +
+                                      value.size() - body.size(),
+                              body.size()));
+    }
+
+    auto& admin = getAdminConnection();
+    auto json = getConnectionStats(admin, id);
+    const auto socket = json["zerocopy"]["socket"].get<std::string>();
+#if defined(__linux__) && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+    // The DCP values were considered for zero-copy sends
+    EXPECT_NE("unknown", socket);
+#endif
+    if (socket == "enabled") {
+        EXPECT_LE(10, json["zerocopy"]["sent"].get<uint32_t>());
+        const auto timeout =
+                std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (json["zerocopy"]["pinned"].get<size_t>() != 0 &&
+               std::chrono::steady_clock::now() < timeout) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            json = getConnectionStats(admin, id);
+        }
+        EXPECT_EQ(json["zerocopy"]["sent"], json["zerocopy"]["completed"]);
+        EXPECT_EQ(0, json["zerocopy"]["pinned"].get<size_t>());
+    } else {
+        // SO_ZEROCOPY isn't supported by the kernel; the values are copied
+        EXPECT_EQ(0, json["zerocopy"]["sent"].get<uint32_t>());
+    }
+
+    memcached_cfg.erase("zerocopy_send_threshold");
+    reconfigure();
+}
@@ -75,6 +75,8 @@ protected:
         provider.reset();
         memcached_cfg["external_auth_service"] = false;
         memcached_cfg["active_external_users_push_interval"] = "30 m";
+        memcached_cfg["external_auth_cache_ttl"] = 0;
+        memcached_cfg["external_auth_negative_cache_ttl"] = 0;
         reconfigure();
         TestappTest::TearDown();
     }
@@ -251,6 +253,57 @@ TEST_P(ExternalAuthTest, TestExternalAuthNoRbacUser) {
     }
 }
 
+TEST_P(ExternalAuthTest, TestExternalAuthResultCache) {
+    memcached_cfg["external_auth_cache_ttl"] = "1 m";
+    memcached_cfg["external_auth_negative_cache_ttl"] = "1 m";
+    reconfigure();
+
+    auto authenticate = [this](const std::string& challenge,
+                               bool askProvider) {
+        auto conn = getConnection().clone();
+        BinprotSaslAuthCommand saslAuthCommand;
+        saslAuthCommand.setChallenge(challenge);
+        saslAuthCommand.setMechanism("PLAIN");
+        conn->sendCommand(saslAuthCommand);
+        if (askProvider) {
+            stepAuthProvider();
+        }
+        BinprotResponse response;
+        conn->recvResponse(response);
+        return response;
+    };
+
+    const std::string success{"\0osbourne\0password", 18};
+    const std::string failure{"\0osbourne\0bubba", 15};
+    const auto before = getAdminConnection().stats("external_auth");
+
+    // The first attempts go to the provider, the following are served
+    // from the cache (the provider would never respond)
+    EXPECT_TRUE(authenticate(success, true).isSuccess());
+    EXPECT_EQ(cb::mcbp::Status::AuthError,
+              authenticate(failure, true).getStatus());
+    for (int ii = 0; ii < 10; ++ii) {
+        EXPECT_TRUE(authenticate(success, false).isSuccess());
+        EXPECT_EQ(cb::mcbp::Status::AuthError,
+                  authenticate(failure, false).getStatus());
+    }
+
+    // A different password for the user isn't in the cache
+    EXPECT_EQ(cb::mcbp::Status::AuthError,
+              authenticate({"\0osbourne\0foo", 13}, true).getStatus());
+
+    auto stats = getAdminConnection().stats("external_auth");
+    for (const auto& counter :
+         {std::make_pair("requests", 3),
+          std::make_pair("cache_hits", 10),
+          std::make_pair("negative_cache_hits", 10)}) {
+        EXPECT_EQ(counter.second,
+                  stats[counter.first].get<int>() -
+                          before[counter.first].get<int>())
+                << counter.first;
+    }
+}
+
 TEST_P(ExternalAuthTest, TestExternalAuthServiceDying) {
     auto& conn = getConnection();
 
@@ -20,6 +20,8 @@
 
 #include <nlohmann/json.hpp>
 
+#include <cstring>
+
 // Test fixture for new MCBP miscellaneous commands
 class MiscTest : public TestappClientTest {};
 
@@ -126,3 +128,106 @@ TEST_P(MiscTest, GetRbacDatabase) {
     ASSERT_FALSE(response.isSuccess());
     ASSERT_EQ(cb::mcbp::Status::Eaccess, response.getStatus());
 }
+
+/**
+ * A front-end thread is only woken once for all of the notifications queued
+ * up for it since it last served them. Block many connections in the
+ * engine and resume all of them at once, and verify that every one of them
+ * gets served.
+ */
+TEST_P(MiscTest, NotifyManyBlockedConnections) {
+    const uint32_t nconns = 32;
+    auto& conn = getConnection();
+    conn.store("NotifyManyBlockedConnections", Vbid(0), "value");
+
+    std::vector<std::unique_ptr<MemcachedConnection>> blocked;
+    for (uint32_t ii = 0; ii < nconns; ++ii) {
+        auto c = conn.clone();
+        c->authenticate("@admin", "password", "PLAIN");
+        c->selectBucket(bucketName);
+        c->configureEwouldBlockEngine(
+                EWBEngineMode::Suspend, ENGINE_EWOULDBLOCK, ii);
+        c->sendCommand(BinprotGenericCommand{cb::mcbp::ClientOpcode::Get,
+                                             "NotifyManyBlockedConnections"});
+        blocked.emplace_back(std::move(c));
+    }
+
+    for (uint32_t ii = 0; ii < nconns; ++ii) {
+        conn.configureEwouldBlockEngine(
+                EWBEngineMode::Resume, ENGINE_SUCCESS, ii);
+    }
+
+    for (auto& c : blocked) {
+        BinprotResponse rsp;
+        c->recvResponse(rsp);
+        EXPECT_EQ(cb::mcbp::Status::Success, rsp.getStatus());
+        EXPECT_EQ("value", rsp.getDataString());
+    }
+
+    conn.remove("NotifyManyBlockedConnections", Vbid(0));
+}
+
+/**
+ * Verify that GetMulti returns one entry per key in the order requested,
+ * both for resident documents and for those it has to read from disk
+ */
+TEST_P(MiscTest, GetMulti) {
+    TESTAPP_SKIP_IF_UNSUPPORTED(cb::mcbp::ClientOpcode::GetMulti);
+    auto& conn = getConnection();
+    conn.store("GetMulti_resident", Vbid(0), "resident");
+    storeAndPersistItem(Vbid(0), "GetMulti_evicted");
+    conn.evict("GetMulti_evicted", Vbid(0));
+
+    // 16 bit vbucket | 16 bit key length | key
+    const std::vector<std::pair<Vbid, std::string>> keys = {
+            {Vbid(0), "GetMulti_evicted"},
+            {Vbid(0), "GetMulti_missing"},
+            {Vbid(1), "GetMulti_resident"},
+            {Vbid(0), "GetMulti_resident"}};
+    std::string value;
+    for (const auto& key : keys) {
+        const uint16_t vbid = htons(key.first.get());
+        const uint16_t keylen = htons(uint16_t(key.second.size()));
+        value.append(reinterpret_cast<const char*>(&vbid), sizeof(vbid));
+        value.append(reinterpret_cast<const char*>(&keylen), sizeof(keylen));
+        value.append(key.second);
+    }
+
+    BinprotGenericCommand cmd{cb::mcbp::ClientOpcode::GetMulti};
+    cmd.setValue(value);
+    const auto rsp = conn.execute(cmd);
+    ASSERT_EQ(cb::mcbp::Status::Success, rsp.getStatus());
+
+    // 16 bit status | 16 bit key length | 8 bit datatype | 32 bit flags |
+    // 64 bit cas | 32 bit value length | key | value
+    const std::vector<std::pair<cb::mcbp::Status, std::string>> expected = {
+            {cb::mcbp::Status::Success, "persist me"},
+            {cb::mcbp::Status::KeyEnoent, ""},
+            {cb::mcbp::Status::NotMyVbucket, ""},
+            {cb::mcbp::Status::Success, "resident"}};
+    const auto data = rsp.getDataString();
+    size_t offset = 0;
+    for (size_t ii = 0; ii < expected.size(); ++ii) {
+        const size_t header = 2 + 2 + 1 + 4 + 8 + 4;
+        ASSERT_LE(offset + header, data.size());
+        uint16_t status;
+        uint16_t keylen;
+        uint32_t valuelen;
+        std::memcpy(&status, data.data() + offset, sizeof(status));
+        std::memcpy(&keylen, data.data() + offset + 2, sizeof(keylen));
+        std::memcpy(&valuelen, data.data() + offset + 17, sizeof(valuelen));
+        keylen = ntohs(keylen);
+        valuelen = ntohl(valuelen);
+        offset += header;
+        ASSERT_LE(offset + keylen + valuelen, data.size());
+
+        EXPECT_EQ(expected[ii].first, cb::mcbp::Status(ntohs(status)));
+        EXPECT_EQ(keys[ii].second, data.substr(offset, keylen));
+        EXPECT_EQ(expected[ii].second, data.substr(offset + keylen, valuelen));
+        offset += keylen + valuelen;
+    }
+    EXPECT_EQ(data.size(), offset);
+
+    conn.remove("GetMulti_resident", Vbid(0));
+    conn.remove("GetMulti_evicted", Vbid(0));
+}
@@ -0,0 +1,233 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "testapp.h"
+#include "testapp_client_test.h"
+
+#include <protocol/connection/client_pipeline.h>
+#include <chrono>
+#include <future>
+#include <vector>
+
+class PipelineTest : public TestappClientTest {
+protected:
+    void storeDocuments(MemcachedPipeline& pipeline) {
+        BinprotMutationCommand cmd;
+        cmd.setMutationType(MutationType::Set);
+        for (int ii = 0; ii < numDocuments; ++ii) {
+            cmd.setKey(name + std::to_string(ii));
+            cmd.setValue(std::to_string(ii));
+            pipeline.enqueue(cmd, [](BinprotResponse&& response) {
+                EXPECT_TRUE(response.isSuccess())
+                        << to_string(response.getStatus());
+            });
+        }
+    }
+
+    const int numDocuments = 1000;
+};
+
+INSTANTIATE_TEST_CASE_P(TransportProtocols,
+                        PipelineTest,
+                        ::testing::Values(TransportProtocols::McbpPlain,
+                                          TransportProtocols::McbpSsl),
+                        ::testing::PrintToStringParamName());
+
+TEST_P(PipelineTest, Callbacks) {
+    auto& conn = getConnection();
+    // Use a window smaller than the number of requests so that we need
+    // to read responses while queueing
+    MemcachedPipeline pipeline(conn, 64);
+    storeDocuments(pipeline);
+    pipeline.drain();
+    EXPECT_EQ(0, pipeline.getOutstanding());
+
+    int found = 0;
+    BinprotGetCommand cmd;
+    for (int ii = 0; ii < numDocuments; ++ii) {
+        cmd.setKey(name + std::to_string(ii));
+        pipeline.enqueue(cmd, [ii, &found](BinprotResponse&& response) {
+            ASSERT_TRUE(response.isSuccess())
+                    << to_string(response.getStatus());
+            EXPECT_EQ(std::to_string(ii), response.getDataString());
+            ++found;
+        });
+    }
+    pipeline.drain();
+    EXPECT_EQ(numDocuments, found);
+}
+
+TEST_P(PipelineTest, Futures) {
+    auto& conn = getConnection();
+    MemcachedPipeline pipeline(conn);
+    storeDocuments(pipeline);
+
+    std::vector<std::future<BinprotResponse>> futures;
+    BinprotGetCommand cmd;
+    for (int ii = 0; ii < numDocuments; ++ii) {
+        cmd.setKey(name + std::to_string(ii));
+        futures.emplace_back(pipeline.enqueue(cmd));
+    }
+    // One which doesn't exist
+    cmd.setKey(name + "_missing");
+    futures.emplace_back(pipeline.enqueue(cmd));
+    pipeline.drain();
+
+    for (int ii = 0; ii < numDocuments; ++ii) {
+        auto response = futures[ii].get();
+        ASSERT_TRUE(response.isSuccess())
+                << to_string(response.getStatus());
+        EXPECT_EQ(std::to_string(ii), response.getDataString());
+    }
+    EXPECT_EQ(cb::mcbp::Status::KeyEnoent, futures.back().get().getStatus());
+}
+
+TEST_P(PipelineTest, UnorderedExecution) {
+    auto& conn = getConnection();
+    conn.setUnorderedExecutionMode(ExecutionMode::Unordered);
+    MemcachedPipeline pipeline(conn);
+    storeDocuments(pipeline);
+
+    std::vector<std::future<BinprotResponse>> futures;
+    BinprotGetCommand cmd;
+    for (int ii = 0; ii < numDocuments; ++ii) {
+        cmd.setKey(name + std::to_string(ii));
+        futures.emplace_back(pipeline.enqueue(cmd));
+    }
+    pipeline.drain();
+
+    for (int ii = 0; ii < numDocuments; ++ii) {
+        auto response = futures[ii].get();
+        ASSERT_TRUE(response.isSuccess())
+                << to_string(response.getStatus());
+        EXPECT_EQ(std::to_string(ii), response.getDataString());
+    }
+    conn.setUnorderedExecutionMode(ExecutionMode::Ordered);
+}
+
+// Test that the commands delayed by the ewouldblock engine's latency mode
+// complete once the timer notifies them.
+TEST_P(PipelineTest, InjectedLatency) {
+    auto& conn = getConnection();
+    MemcachedPipeline pipeline(conn, 16);
+    storeDocuments(pipeline);
+    pipeline.drain();
+
+    EXPECT_THROW(conn.configureEwouldBlockEngine(
+                         EWBEngineMode::Latency, ENGINE_EWOULDBLOCK, 0, "slow"),
+                 ConnectionError);
+    conn.configureEwouldBlockEngine(
+            EWBEngineMode::Latency, ENGINE_EWOULDBLOCK, 0, "fixed:1000");
+
+    const int numGets = 50;
+    int found = 0;
+    const auto start = std::chrono::steady_clock::now();
+    BinprotGetCommand cmd;
+    for (int ii = 0; ii < numGets; ++ii) {
+        cmd.setKey(name + std::to_string(ii));
+        pipeline.enqueue(cmd, [ii, &found](BinprotResponse&& response) {
+            ASSERT_TRUE(response.isSuccess())
+                    << to_string(response.getStatus());
+            EXPECT_EQ(std::to_string(ii), response.getDataString());
+            ++found;
+        });
+    }
+    pipeline.drain();
+    EXPECT_EQ(numGets, found);
+    // The gets are executed one after the other, each waiting for its delay
+    EXPECT_LE(std::chrono::milliseconds(numGets),
+              std::chrono::steady_clock::now() - start);
+
+    conn.disableEwouldBlockEngine();
+}
+
+/// Test fixture for running with response coalescing enabled
+class CoalescingTest : public PipelineTest {
+protected:
+    void SetUp() override {
+        PipelineTest::SetUp();
+        memcached_cfg["response_coalescing_bytes"] = 65536;
+        reconfigure();
+    }
+
+    void TearDown() override {
+        memcached_cfg["response_coalescing_bytes"] = 0;
+        reconfigure();
+        PipelineTest::TearDown();
+    }
+
+    /// Append the encoded command to the frame (to send them all at once)
+    static void append(Frame& frame, const BinprotCommand& cmd) {
+        std::vector<uint8_t> buf;
+        cmd.encode(buf);
+        frame.payload.insert(frame.payload.end(), buf.begin(), buf.end());
+    }
+};
+
+INSTANTIATE_TEST_CASE_P(TransportProtocols,
+                        CoalescingTest,
+                        ::testing::Values(TransportProtocols::McbpPlain,
+                                          TransportProtocols::McbpSsl),
+                        ::testing::PrintToStringParamName());
+
+// The response for the get is queued when we see the getq, but the getq
+// misses (and don't send a response). The queued response must be sent
+// before we wait for more input as the client won't send anything more
+// until it gets the response.
+TEST_P(CoalescingTest, QuietMissFollowedByIdle) {
+    auto& conn = getConnection();
+    conn.store(name, Vbid(0), "value");
+
+    Frame frame;
+    BinprotGetCommand cmd;
+    cmd.setKey(name);
+    append(frame, cmd);
+    cmd.setKey(name + "_missing");
+    cmd.setOp(cb::mcbp::ClientOpcode::Getq);
+    append(frame, cmd);
+    conn.sendFrame(frame);
+
+    BinprotResponse rsp;
+    conn.recvResponse(rsp);
+    ASSERT_TRUE(rsp.isSuccess()) << to_string(rsp.getStatus());
+    EXPECT_EQ("value", rsp.getDataString());
+}
+
+// Queue up more responses than we keep in the IO vector between commands
+// (see IOV_LIST_HIGHWAT) and verify that all of them arrive intact
+TEST_P(CoalescingTest, ManyResponses) {
+    auto& conn = getConnection();
+    MemcachedPipeline pipeline(conn, 64);
+    storeDocuments(pipeline);
+    pipeline.drain();
+
+    const int numGets = 200;
+    Frame frame;
+    BinprotGetCommand cmd;
+    for (int ii = 0; ii < numGets; ++ii) {
+        cmd.setKey(name + std::to_string(ii));
+        append(frame, cmd);
+    }
+    conn.sendFrame(frame);
+
+    for (int ii = 0; ii < numGets; ++ii) {
+        BinprotResponse rsp;
+        conn.recvResponse(rsp);
+        ASSERT_TRUE(rsp.isSuccess()) << to_string(rsp.getStatus());
+        EXPECT_EQ(std::to_string(ii), rsp.getDataString());
+    }
+}
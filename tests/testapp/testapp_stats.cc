@@ -526,3 +526,165 @@ INSTANTIATE_TEST_CASE_P(TransportProtocols,
                         ::testing::Values(TransportProtocols::McbpPlain,
                                           TransportProtocols::McbpSsl),
                         ::testing::PrintToStringParamName());
+
+TEST_P(StatsTest, TestJsonStats) {
+    MemcachedConnection& conn = getConnection();
+
+    auto getJsonStats = [&conn](const std::string& subcommand) {
+        std::string payload;
+        conn.stats(
+                [&payload](const std::string& key, const std::string& value) {
+                    EXPECT_EQ("json", key);
+                    payload.append(value);
+                },
+                subcommand);
+        return nlohmann::json::parse(payload);
+    };
+
+    auto full = getJsonStats("json");
+    EXPECT_FALSE(full["delta"].get<bool>());
+    ASSERT_TRUE(full["stats"].is_object());
+    EXPECT_NE(full["stats"].end(), full["stats"].find("uptime"));
+    EXPECT_TRUE(full["stats"]["curr_connections"].is_number());
+    const auto token = full["token"].get<uint64_t>();
+
+    // A delta should only contain a subset of the stats
+    auto delta = getJsonStats("json token=" + std::to_string(token));
+    EXPECT_TRUE(delta["delta"].get<bool>());
+    EXPECT_NE(token, delta["token"].get<uint64_t>());
+    EXPECT_LT(delta["stats"].size(), full["stats"].size());
+    EXPECT_TRUE(delta["removed"].is_array());
+
+    // An unknown token results in a full set of stats
+    auto unknown = getJsonStats("json token=1");
+    EXPECT_FALSE(unknown["delta"].get<bool>());
+
+    try {
+        conn.stats("json token=foo");
+        FAIL() << "Did not detect an invalid token";
+    } catch (ConnectionError& error) {
+        EXPECT_TRUE(error.isInvalidArguments());
+    }
+}
+
+TEST_P(StatsTest, TestStatsSubscribe) {
+    MemcachedConnection& conn = getConnection();
+    conn.authenticate("@admin", "password", "PLAIN");
+    conn.selectBucket("default");
+
+    try {
+        conn.stats("subscribe 1");
+        FAIL() << "Subscribing requires duplex";
+    } catch (ConnectionError& error) {
+        EXPECT_TRUE(error.isNotSupported());
+    }
+
+    conn.setDuplexSupport(true);
+    try {
+        conn.stats("subscribe 0");
+        FAIL() << "Did not detect invalid interval";
+    } catch (ConnectionError& error) {
+        EXPECT_TRUE(error.isInvalidArguments());
+    }
+
+    auto stats = conn.stats("subscribe 1");
+    ASSERT_NE(stats.end(), stats.find("subscribe"));
+    const auto& full = stats["subscribe"];
+    EXPECT_FALSE(full["delta"].get<bool>());
+    EXPECT_TRUE(full["stats"]["curr_items"].is_number());
+
+    // Store a document from another connection, so that the push can't
+    // arrive while this one waits for a response
+    auto second = conn.clone();
+    second->authenticate("@admin", "password", "PLAIN");
+    second->selectBucket("default");
+    second->store("TestStatsSubscribe", Vbid(0), "value");
+
+    // The server pushes the stats which changed
+    Frame frame;
+    conn.recvFrame(frame);
+    ASSERT_EQ(cb::mcbp::Magic::ServerRequest, frame.getMagic());
+    const auto* request = frame.getRequest();
+    EXPECT_EQ(cb::mcbp::ServerOpcode::StatsPush, request->getServerOpcode());
+    EXPECT_TRUE(request->getKey().empty());
+    const auto value = request->getValue();
+    const auto push = nlohmann::json::parse(std::string{
+            reinterpret_cast<const char*>(value.data()), value.size()});
+    EXPECT_TRUE(push["delta"].get<bool>());
+    EXPECT_LT(push["stats"].size(), full["stats"].size());
+    EXPECT_EQ(1, push["stats"]["curr_items"].get<uint64_t>());
+
+    conn.reconnect();
+}
+
+TEST_P(StatsTest, TestSlowRequests) {
+    MemcachedConnection& conn = getConnection();
+
+    try {
+        conn.stats("slow_requests");
+        FAIL() << "slow_requests is a privileged operation";
+    } catch (ConnectionError& error) {
+        EXPECT_TRUE(error.isAccessDenied());
+    }
+
+    conn.authenticate("@admin", "password", "PLAIN");
+    // Run a few commands so that there is something in the log
+    for (int ii = 0; ii < 5; ++ii) {
+        conn.stats("aggregate");
+    }
+
+    auto stats = conn.stats("slow_requests 3 60");
+    ASSERT_TRUE(stats["slow_requests"].is_array());
+    const auto& array = stats["slow_requests"];
+    ASSERT_FALSE(array.empty());
+    EXPECT_GE(3, array.size());
+    for (size_t ii = 1; ii < array.size(); ++ii) {
+        EXPECT_GE(array[ii - 1]["duration_us"].get<uint64_t>(),
+                  array[ii]["duration_us"].get<uint64_t>());
+    }
+    EXPECT_NE(array[0].end(), array[0].find("opcode"));
+    EXPECT_NE(array[0].end(), array[0].find("blocked_us"));
+
+    try {
+        conn.stats("slow_requests foo");
+        FAIL() << "Did not detect invalid count";
+    } catch (ConnectionError& error) {
+        EXPECT_TRUE(error.isInvalidArguments());
+    }
+}
+
+TEST_P(StatsTest, TestOpcodeCosts) {
+    MemcachedConnection& conn = getConnection();
+
+    try {
+        conn.stats("opcode_costs");
+        FAIL() << "opcode_costs is a privileged operation";
+    } catch (ConnectionError& error) {
+        EXPECT_TRUE(error.isAccessDenied());
+    }
+
+    conn.authenticate("@admin", "password", "PLAIN");
+    conn.selectBucket("default");
+    for (int ii = 0; ii < 5; ++ii) {
+        conn.store("TestOpcodeCosts", Vbid(0), "value");
+    }
+
+    auto stats = conn.stats("opcode_costs");
+    ASSERT_NE(stats.end(), stats.find("SET"));
+    const auto& set = stats["SET"];
+    EXPECT_EQ(5, set["count"].get<uint64_t>());
+    EXPECT_LT(0, set["execution_ns"].get<uint64_t>());
+    EXPECT_NE(set.end(), set.find("blocked_ns"));
+    EXPECT_NE(set.end(), set.find("allocated_bytes"));
+
+    stats = conn.stats("opcode_costs aggregate");
+    ASSERT_NE(stats.end(), stats.find("SET"));
+    EXPECT_LE(5, stats["SET"]["count"].get<uint64_t>());
+
+    try {
+        conn.stats("opcode_costs foo");
+        FAIL() << "Did not detect invalid argument";
+    } catch (ConnectionError& error) {
+        EXPECT_TRUE(error.isInvalidArguments());
+    }
+}
@@ -679,3 +679,33 @@ TEST_P(SubdocTestappTest, MB_30278_SubdocBacktickMultiMutation) {
 
     delete_object("dict");
 }
+
+// The new document of a multi-mutation is gathered straight into the new
+// item from the results of the last operation, which point into the result
+// of the earlier ones. Check the stored document for a large input.
+TEST_P(SubdocTestappTest, SubdocMultiMutation_LargeDocument) {
+    const std::string big(64 * 1024, 'x');
+    store_document("dict", R"({"array":[1],"big":")" + big + R"(","old":0})");
+
+    SubdocMultiMutationCmd mutation;
+    mutation.key = "dict";
+    mutation.specs.push_back({cb::mcbp::ClientOpcode::SubdocDictUpsert,
+                              SUBDOC_FLAG_NONE,
+                              "key",
+                              "\"value\""});
+    mutation.specs.push_back({cb::mcbp::ClientOpcode::SubdocArrayPushLast,
+                              SUBDOC_FLAG_NONE,
+                              "array",
+                              "2"});
+    mutation.specs.push_back({cb::mcbp::ClientOpcode::SubdocDelete,
+                              SUBDOC_FLAG_NONE,
+                              "old",
+                              ""});
+    expect_subdoc_cmd(mutation, cb::mcbp::Status::Success, {});
+
+    validate_json_document(
+            "dict",
+            R"({"array":[1,2],"big":")" + big + R"(","key":"value"})");
+
+    delete_object("dict");
+}
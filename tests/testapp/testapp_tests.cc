@@ -28,6 +28,7 @@
 #include <folly/portability/GTest.h>
 #include <algorithm>
 #include <atomic>
+#include <sstream>
 #include <string>
 #include <thread>
 #include <vector>
@@ -452,6 +453,45 @@ TEST_P(McdTestappTest, IOCTL_Tracing) {
     EXPECT_TRUE(json["traceEvents"].is_array());
 }
 
+#ifdef __linux__
+TEST_P(McdTestappTest, IOCTL_SamplingProfiler) {
+    auto& conn = getAdminConnection();
+    conn.authenticate("@admin", "password", "PLAIN");
+
+    conn.ioctl_set("profiler.start", "1000");
+    auto status = nlohmann::json::parse(conn.ioctl_get("profiler.status"));
+    EXPECT_TRUE(status["running"].get<bool>());
+    EXPECT_EQ(1000, status["frequency"].get<int>());
+
+    // Keep the server busy for a while so it is sampled
+    const auto end = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (std::chrono::steady_clock::now() < end) {
+        conn.stats("");
+    }
+
+    conn.ioctl_set("profiler.stop", {});
+    status = nlohmann::json::parse(conn.ioctl_get("profiler.status"));
+    EXPECT_FALSE(status["running"].get<bool>());
+    EXPECT_LT(0, status["samples"].get<int>());
+
+    // Every line is a folded stack rooted at a thread name, and a count
+    const auto dump = conn.ioctl_get("profiler.dump");
+    EXPECT_FALSE(dump.empty());
+    std::istringstream lines(dump);
+    std::string line;
+    while (std::getline(lines, line)) {
+        EXPECT_NE(std::string::npos, line.find(';')) << line;
+        const auto count = line.substr(line.rfind(' ') + 1);
+        EXPECT_LT(0, std::stoi(count)) << line;
+    }
+
+    // Invalid arguments are rejected
+    EXPECT_THROW(conn.ioctl_get("profiler.dump?seconds=foo"),
+                 ConnectionError);
+    EXPECT_THROW(conn.ioctl_set("profiler.start", "0"), ConnectionError);
+}
+#endif
+
 TEST_P(McdTestappTest, Config_Validate_Empty) {
     sasl_auth("@admin", "password");
     BinprotGenericCommand cmd(ClientOpcode::ConfigValidate);
@@ -1535,3 +1535,97 @@ TEST_P(XattrTest, MB_28524_TestReplaceWithXattrUncompressed) {
 TEST_P(XattrTest, MB_28524_TestReplaceWithXattrCompressed) {
     doReplaceWithXattrTest(true);
 }
+
+/**
+ * A body mutation gathers the new document straight into the new item from
+ * the unchanged xattrs, the input document and the results of the
+ * operations. Check the stored document for a large body, where the last
+ * operation works on the result of an earlier one.
+ */
+TEST_P(XattrTest, MultiPathBodyMutationKeepsXattrs) {
+    const std::string big(64 * 1024, 'x');
+    setBodyAndXattr(R"({"counter":1,"big":")" + big + R"("})",
+                    {{sysXattr, xattrVal}});
+
+    BinprotSubdocMultiMutationCommand cmd;
+    cmd.setKey(name);
+    cmd.addMutation(cb::mcbp::ClientOpcode::SubdocDictUpsert,
+                    SUBDOC_FLAG_NONE,
+                    "added",
+                    R"("value")");
+    cmd.addMutation(cb::mcbp::ClientOpcode::SubdocCounter,
+                    SUBDOC_FLAG_NONE,
+                    "counter",
+                    "41");
+
+    auto& conn = getConnection();
+    conn.sendCommand(cmd);
+    BinprotSubdocMultiMutationResponse resp;
+    conn.recvResponse(resp);
+    ASSERT_EQ(cb::mcbp::Status::Success, resp.getStatus());
+
+    BinprotSubdocMultiLookupCommand lookup;
+    lookup.setKey(name);
+    lookup.addGet(sysXattr, SUBDOC_FLAG_XATTR_PATH);
+    lookup.addLookup("", cb::mcbp::ClientOpcode::Get, SUBDOC_FLAG_NONE);
+    conn.sendCommand(lookup);
+    BinprotSubdocMultiLookupResponse multiResp;
+    conn.recvResponse(multiResp);
+    ASSERT_EQ(cb::mcbp::Status::Success, multiResp.getStatus());
+    EXPECT_EQ(xattrVal, multiResp.getResults()[0].value);
+
+    nlohmann::json expected;
+    expected["counter"] = 42;
+    expected["big"] = big;
+    expected["added"] = "value";
+    EXPECT_EQ(expected,
+              nlohmann::json::parse(multiResp.getResults()[1].value));
+}
+
+/**
+ * As above, but the xattrs are modified by the same command (so the xattr
+ * segment of the new document comes from the rebuilt input document).
+ */
+TEST_P(XattrTest, MultiPathXattrAndBodyMutation) {
+    const std::string big(64 * 1024, 'x');
+    setBodyAndXattr(R"({"counter":1,"big":")" + big + R"("})",
+                    {{sysXattr, xattrVal}});
+
+    BinprotSubdocMultiMutationCommand cmd;
+    cmd.setKey(name);
+    cmd.addMutation(cb::mcbp::ClientOpcode::SubdocDictUpsert,
+                    SUBDOC_FLAG_XATTR_PATH,
+                    sysXattr + ".added",
+                    "true");
+    cmd.addMutation(cb::mcbp::ClientOpcode::SubdocDictUpsert,
+                    SUBDOC_FLAG_NONE,
+                    "added",
+                    R"("value")");
+    cmd.addMutation(cb::mcbp::ClientOpcode::SubdocCounter,
+                    SUBDOC_FLAG_NONE,
+                    "counter",
+                    "41");
+
+    auto& conn = getConnection();
+    conn.sendCommand(cmd);
+    BinprotSubdocMultiMutationResponse resp;
+    conn.recvResponse(resp);
+    ASSERT_EQ(cb::mcbp::Status::Success, resp.getStatus());
+
+    BinprotSubdocMultiLookupCommand lookup;
+    lookup.setKey(name);
+    lookup.addGet(sysXattr, SUBDOC_FLAG_XATTR_PATH);
+    lookup.addLookup("", cb::mcbp::ClientOpcode::Get, SUBDOC_FLAG_NONE);
+    conn.sendCommand(lookup);
+    BinprotSubdocMultiLookupResponse multiResp;
+    conn.recvResponse(multiResp);
+    ASSERT_EQ(cb::mcbp::Status::Success, multiResp.getStatus());
+    EXPECT_EQ(R"({"eg":99,"added":true})", multiResp.getResults()[0].value);
+
+    nlohmann::json expected;
+    expected["counter"] = 42;
+    expected["big"] = big;
+    expected["added"] = "value";
+    EXPECT_EQ(expected,
+              nlohmann::json::parse(multiResp.getResults()[1].value));
+}
@@ -0,0 +1,89 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <daemon/thread_load.h>
+#include <folly/portability/GTest.h>
+
+#include <array>
+
+class LeastLoadedSelectorTest : public ::testing::Test {
+protected:
+    size_t select(size_t first) {
+        return selector.select(
+                loads.size(),
+                first,
+                [this](size_t tid) { return loads[tid]; },
+                now);
+    }
+
+    /// Move the clock past the sample interval
+    void tick() {
+        now += LeastLoadedSelector::SampleInterval;
+    }
+
+    std::array<ThreadLoad, 4> loads{};
+    LeastLoadedSelector selector{4};
+    std::chrono::steady_clock::time_point now =
+            std::chrono::steady_clock::now();
+};
+
+/// Threads with the same load get the connections round robin
+TEST_F(LeastLoadedSelectorTest, EqualLoadIsRoundRobin) {
+    for (size_t ii = 0; ii < 8; ++ii) {
+        EXPECT_EQ(ii % loads.size(), select(ii));
+    }
+}
+
+/// The idle thread gets the connection, wherever the search starts
+TEST_F(LeastLoadedSelectorTest, IdleThreadIsPicked) {
+    for (auto& load : loads) {
+        load.connections = 10;
+    }
+    loads[2].connections = 0;
+    for (size_t ii = 0; ii < loads.size(); ++ii) {
+        EXPECT_EQ(2, select(ii));
+    }
+}
+
+/// A thread with fewer connections but busy all of the time looks more
+/// loaded than an idle thread with a few more connections
+TEST_F(LeastLoadedSelectorTest, BusyThreadIsAvoided) {
+    for (auto& load : loads) {
+        load.connections = 2;
+    }
+    loads[0].connections = 1;
+    select(0);
+    EXPECT_EQ(0, select(0));
+
+    // Thread 0 was busy for the whole of the last sample interval (and
+    // its smoothed utilization rises to 0.5)
+    tick();
+    loads[0].cpu_time += std::chrono::nanoseconds(
+                                 LeastLoadedSelector::SampleInterval)
+                                 .count();
+    EXPECT_EQ(1, select(0));
+}
+
+/// Data queued for transmission counts towards the load
+TEST_F(LeastLoadedSelectorTest, QueuedDataCounts) {
+    loads[0].send_queue_size =
+            size_t(LeastLoadedSelector::SendQueueBytesPerConnection) * 2;
+    EXPECT_EQ(1, select(0));
+    loads[1].connections = 3;
+    loads[2].connections = 3;
+    loads[3].connections = 3;
+    EXPECT_EQ(0, select(0));
+}
@@ -0,0 +1,119 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <daemon/timings.h>
+#include <folly/portability/GTest.h>
+
+#include <thread>
+#include <vector>
+
+using namespace std::chrono;
+
+class TimingsTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        timings.setNumThreads(NumThreads);
+    }
+
+    static const size_t NumThreads = 4;
+    Timings timings;
+};
+
+const size_t TimingsTest::NumThreads;
+
+TEST_F(TimingsTest, NoHistogramUntilCollected) {
+    EXPECT_FALSE(timings.get_timing_histogram(
+            uint8_t(cb::mcbp::ClientOpcode::Get)));
+    EXPECT_EQ("{}", timings.generate(cb::mcbp::ClientOpcode::Get));
+}
+
+TEST_F(TimingsTest, HistogramMergedFromAllThreads) {
+    // Thread n records n + 1 values of (n + 1) ms
+    for (size_t thread = 0; thread < NumThreads; ++thread) {
+        for (size_t ii = 0; ii <= thread; ++ii) {
+            timings.collect(cb::mcbp::ClientOpcode::Get,
+                            milliseconds(thread + 1),
+                            thread);
+        }
+    }
+
+    auto histogram = timings.get_timing_histogram(
+            uint8_t(cb::mcbp::ClientOpcode::Get));
+    ASSERT_TRUE(histogram);
+    EXPECT_EQ(1 + 2 + 3 + 4, histogram->getValueCount());
+    // The largest value was only recorded by the last thread (the
+    // histogram only keeps 1 significant figure)
+    EXPECT_LE(3800, histogram->getMaxValue());
+    EXPECT_GE(4200, histogram->getMaxValue());
+
+    // Other opcodes are unaffected
+    EXPECT_FALSE(timings.get_timing_histogram(
+            uint8_t(cb::mcbp::ClientOpcode::Set)));
+
+    // The aggregated counters sum all of the shards
+    EXPECT_EQ(10, timings.get_aggregated_retrival_stats());
+    EXPECT_EQ(0, timings.get_aggregated_mutation_stats());
+
+    timings.reset();
+    histogram = timings.get_timing_histogram(
+            uint8_t(cb::mcbp::ClientOpcode::Get));
+    ASSERT_TRUE(histogram);
+    EXPECT_EQ(0, histogram->getValueCount());
+}
+
+TEST_F(TimingsTest, SampleSumsAllThreads) {
+    for (size_t thread = 0; thread < NumThreads; ++thread) {
+        timings.collect(cb::mcbp::ClientOpcode::Set, milliseconds(1), thread);
+        timings.collect(cb::mcbp::ClientOpcode::Get, milliseconds(2), thread);
+    }
+    timings.sample(seconds(1));
+
+    const auto mutations = timings.get_interval_mutation_latency();
+    EXPECT_EQ(NumThreads, mutations.count);
+    EXPECT_EQ(nanoseconds(milliseconds(NumThreads)).count(),
+              mutations.duration_ns);
+    const auto lookups = timings.get_interval_lookup_latency();
+    EXPECT_EQ(NumThreads, lookups.count);
+    EXPECT_EQ(nanoseconds(milliseconds(2 * NumThreads)).count(),
+              lookups.duration_ns);
+
+    // The interval counters are reset by the sample
+    timings.sample(seconds(1));
+    EXPECT_EQ(NumThreads, timings.get_interval_mutation_latency().count);
+}
+
+// Each thread only touches its own shard, so none of the updates are lost
+TEST_F(TimingsTest, ConcurrentCollect) {
+    const size_t iterations = 10000;
+    std::vector<std::thread> threads;
+    for (size_t thread = 0; thread < NumThreads; ++thread) {
+        threads.emplace_back([this, thread]() {
+            for (size_t ii = 0; ii < iterations; ++ii) {
+                timings.collect(cb::mcbp::ClientOpcode::Get,
+                                microseconds(100),
+                                thread);
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    auto histogram = timings.get_timing_histogram(
+            uint8_t(cb::mcbp::ClientOpcode::Get));
+    ASSERT_TRUE(histogram);
+    EXPECT_EQ(NumThreads * iterations, histogram->getValueCount());
+}
@@ -18,6 +18,7 @@
 #include "daemon/settings.h"
 #include "daemon/topkeys.h"
 #include <folly/portability/GTest.h>
+#include <nlohmann/json.hpp>
 #include <memory>
 
 class TopKeysTest : public ::testing::Test {
@@ -58,3 +59,38 @@ TEST_F(TopKeysTest, Basic) {
     topkeys->stats(&count, 0, dump_key);
     EXPECT_EQ(80, count);
 }
+
+TEST_F(TopKeysTest, Sampled) {
+    settings.setTopkeysSampleRate(10);
+
+    // A handful of hot keys mixed with a lot of keys only accessed once
+    std::vector<std::string> hot;
+    for (int ii = 0; ii < 5; ii++) {
+        hot.emplace_back("topkey_hot_" + std::to_string(ii));
+    }
+    for (int jj = 0; jj < 20000; jj++) {
+        for (auto& key : hot) {
+            topkeys->updateKey(key.c_str(), key.size(), jj);
+        }
+        const auto cold = "topkey_cold_" + std::to_string(jj);
+        topkeys->updateKey(cold.c_str(), cold.size(), jj);
+    }
+
+    nlohmann::json json;
+    topkeys->json_stats(json, 0);
+    const auto& array = json["topkeys"];
+    ASSERT_LE(array.size(), 80);
+    ASSERT_GE(array.size(), hot.size());
+
+    // The hot keys should be reported first, with an estimated access count
+    // in the right ballpark
+    for (size_t ii = 0; ii < hot.size(); ++ii) {
+        const auto key = array[ii]["key"].get<std::string>();
+        EXPECT_EQ(0, key.find("topkey_hot_")) << key;
+        const auto count = array[ii]["access_count"].get<int>();
+        EXPECT_GT(count, 15000) << key;
+        EXPECT_LT(count, 25000) << key;
+    }
+
+    settings.setTopkeysSampleRate(1);
+}
@@ -51,6 +51,42 @@ TEST_F(TracingTest, Basic) {
     EXPECT_GE(tracer.getTotalMicros().count(), 10000);
 }
 
+TEST_F(TracingTest, EndByTraceCode) {
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(0, tracer.begin(cb::tracing::TraceCode::REQUEST, start));
+    EXPECT_EQ(1, tracer.begin(cb::tracing::TraceCode::GET, start));
+    EXPECT_EQ(2, tracer.begin(cb::tracing::TraceCode::GET, start));
+
+    // Ending by TraceCode ends the first span begun with it
+    EXPECT_TRUE(tracer.end(cb::tracing::TraceCode::GET,
+                           start + std::chrono::microseconds(10)));
+    const auto durations = tracer.getDurations();
+    ASSERT_EQ(3, durations.size());
+    EXPECT_EQ(std::chrono::microseconds(10), durations[1].duration);
+    EXPECT_EQ(cb::tracing::Span::Duration::max(), durations[2].duration);
+
+    tracer.clear();
+    EXPECT_EQ(0, tracer.getDurations().size());
+    EXPECT_FALSE(tracer.end(cb::tracing::TraceCode::GET));
+}
+
+TEST_F(TracingTest, SpansBeyondTheCapacityAreDropped) {
+    for (size_t ii = 0; ii < cb::tracing::Tracer::MaxSpans; ++ii) {
+        EXPECT_EQ(ii, tracer.begin(cb::tracing::TraceCode::GET));
+    }
+    EXPECT_EQ(0, tracer.getNumDroppedSpans());
+
+    const auto spanId = tracer.begin(cb::tracing::TraceCode::STORE);
+    EXPECT_EQ(cb::tracing::Tracer::invalidSpanId(), spanId);
+    EXPECT_FALSE(tracer.end(spanId));
+    EXPECT_FALSE(tracer.end(cb::tracing::TraceCode::STORE));
+    EXPECT_EQ(cb::tracing::Tracer::MaxSpans, tracer.getDurations().size());
+    EXPECT_EQ(1, tracer.getNumDroppedSpans());
+
+    tracer.clear();
+    EXPECT_EQ(0, tracer.getNumDroppedSpans());
+}
+
 TEST_F(TracingTest, ErrorRate) {
     uint64_t micros_list[] = {5,
                               11,
@@ -15,6 +15,7 @@
  *   limitations under the License.
  */
 #include "basic_engine_testsuite.h"
+#include <mcbp/protocol/request.h>
 #include <memcached/durability_spec.h>
 #include <platform/cb_malloc.h>
 #include <platform/cbassert.h>
@@ -22,7 +23,12 @@
 #include <string.h>
 #include <unistd.h>
 
+#include <chrono>
+#include <cstdio>
 #include <iostream>
+#include <map>
+#include <string>
+#include <thread>
 #include <vector>
 #include <sstream>
 
@@ -548,6 +554,569 @@ static enum test_result test_datatype(EngineIface* h) {
     return SUCCESS;
 }
 
+/*
+ * Store and read back keys from several threads at once, enough of them
+ * for the hash table to be expanded while they do
+ */
+static enum test_result hash_table_concurrency_test(EngineIface* h) {
+    const int n_threads = 4;
+    const int n_keys = 40000;
+    std::vector<std::thread> threads;
+    for (int tt = 0; tt < n_threads; ++tt) {
+        threads.emplace_back([h, tt]() {
+            const auto* cookie = test_harness->create_cookie();
+            uint64_t cas = 0;
+            for (int ii = 0; ii < n_keys; ++ii) {
+                uint8_t key[64];
+                DocKey docKey(key,
+                              snprintf(reinterpret_cast<char*>(key),
+                                       sizeof(key),
+                                       "concurrency_key_%d_%08d",
+                                       tt,
+                                       ii),
+                              DocKeyEncodesCollectionId::No);
+                auto ret = h->allocate(cookie,
+                                       docKey,
+                                       1,
+                                       0,
+                                       0,
+                                       PROTOCOL_BINARY_RAW_BYTES,
+                                       Vbid(0));
+                cb_assert(ret.first == cb::engine_errc::success);
+                cb_assert(h->store(cookie,
+                                   ret.second.get(),
+                                   cas,
+                                   OPERATION_SET,
+                                   {},
+                                   DocumentState::Alive) == ENGINE_SUCCESS);
+                ret = h->get(cookie, docKey, Vbid(0), DocStateFilter::Alive);
+                cb_assert(ret.first == cb::engine_errc::success);
+            }
+            test_harness->destroy_cookie(cookie);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    /* Nothing got lost while the table was being expanded */
+    const auto* cookie = test_harness->create_cookie();
+    for (int tt = 0; tt < n_threads; ++tt) {
+        for (int ii = 0; ii < n_keys; ++ii) {
+            uint8_t key[64];
+            DocKey docKey(key,
+                          snprintf(reinterpret_cast<char*>(key),
+                                   sizeof(key),
+                                   "concurrency_key_%d_%08d",
+                                   tt,
+                                   ii),
+                          DocKeyEncodesCollectionId::No);
+            auto ret = h->get(cookie, docKey, Vbid(0), DocStateFilter::Alive);
+            cb_assert(ret.first == cb::engine_errc::success);
+        }
+    }
+    assert_equal(uint64_t(n_threads * n_keys),
+                 get_stat(h, cookie, {}, "curr_items"));
+    test_harness->destroy_cookie(cookie);
+    return SUCCESS;
+}
+
+static void store_sized_item(EngineIface* h,
+                             const void* cookie,
+                             const char* prefix,
+                             int index,
+                             size_t nbytes) {
+    uint8_t key[64];
+    DocKey docKey(key,
+                  snprintf(reinterpret_cast<char*>(key),
+                           sizeof(key),
+                           "%s_%08d",
+                           prefix,
+                           index),
+                  DocKeyEncodesCollectionId::No);
+    auto ret = h->allocate(
+            cookie, docKey, nbytes, 0, 0, PROTOCOL_BINARY_RAW_BYTES, Vbid(0));
+    cb_assert(ret.first == cb::engine_errc::success);
+    uint64_t cas = 0;
+    cb_assert(h->store(cookie,
+                       ret.second.get(),
+                       cas,
+                       OPERATION_SET,
+                       {},
+                       DocumentState::Alive) == ENGINE_SUCCESS);
+}
+
+/*
+ * Fill the cache with small items, and then keep storing large ones so
+ * that only their slab class evicts; slab_automove should move a page of
+ * the (now idle) small class to the large one. The policy runs every 10
+ * seconds and needs 3 windows in a row, so this takes a while.
+ */
+static enum test_result slab_automove_test(EngineIface* h) {
+    const auto* cookie = test_harness->create_cookie();
+    int n_small = 0;
+    while (get_stat(h, cookie, {}, "evictions") == 0) {
+        cb_assert(n_small < 1000000);
+        store_sized_item(h, cookie, "small", n_small++, 100);
+    }
+
+    const auto deadline =
+            std::chrono::steady_clock::now() + std::chrono::seconds(120);
+    int n_large = 0;
+    while (get_stat(h, cookie, "slabs"_ccb, "slabs_moved") == 0) {
+        cb_assert(std::chrono::steady_clock::now() < deadline);
+        for (int ii = 0; ii < 10; ++ii) {
+            store_sized_item(h, cookie, "large", n_large++, 16384);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    /* The page was full of small items, which had to be evicted */
+    assert_ge(get_stat(h, cookie, "slabs"_ccb, "slab_reassign_evicted"),
+              uint64_t(1));
+    test_harness->destroy_cookie(cookie);
+    return SUCCESS;
+}
+
+/* The file backing the extstore in the extstore tests */
+#define EXTSTORE_FILE "basic_engine_testsuite.extstore"
+
+static std::map<std::string, std::string> collected_stats;
+static void collect_stats_handler(const char* key,
+                                  const uint16_t klen,
+                                  const char* val,
+                                  const uint32_t vlen,
+                                  gsl::not_null<const void*>) {
+    collected_stats[std::string(key, klen)] = std::string(val, vlen);
+}
+
+/* Get a (numeric) stat from a stat group */
+static uint64_t get_stat(EngineIface* h,
+                         const void* cookie,
+                         cb::const_char_buffer group,
+                         const std::string& name) {
+    collected_stats.clear();
+    cb_assert(h->get_stats(cookie, group, collect_stats_handler) ==
+              ENGINE_SUCCESS);
+    const auto iter = collected_stats.find(name);
+    cb_assert(iter != collected_stats.end());
+    return std::stoull(iter->second);
+}
+
+static uint64_t get_extstore_stat(EngineIface* h,
+                                  const void* cookie,
+                                  const char* name) {
+    return get_stat(
+            h, cookie, "extstore"_ccb, std::string("extstore:") + name);
+}
+
+/* Wait (for up to 30s) for the extstore stat to reach the value */
+static bool wait_for_extstore_stat(EngineIface* h,
+                                   const void* cookie,
+                                   const char* name,
+                                   uint64_t value) {
+    const auto deadline =
+            std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (get_extstore_stat(h, cookie, name) < value) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return true;
+}
+
+static void store_extstore_item(EngineIface* h,
+                                const void* cookie,
+                                int index) {
+    uint8_t key[64];
+    DocKey docKey(key,
+                  snprintf(reinterpret_cast<char*>(key),
+                           sizeof(key),
+                           "extstore_key_%08d",
+                           index),
+                  DocKeyEncodesCollectionId::No);
+    auto ret = h->allocate(
+            cookie, docKey, 4096, 0, 0, PROTOCOL_BINARY_RAW_BYTES, Vbid(0));
+    cb_assert(ret.first == cb::engine_errc::success);
+    item_info ii;
+    cb_assert(h->get_item_info(ret.second.get(), &ii));
+    memset(ii.value[0].iov_base, 'a' + (index % 26), ii.value[0].iov_len);
+    uint64_t cas = 0;
+    cb_assert(h->store(cookie,
+                       ret.second.get(),
+                       cas,
+                       OPERATION_SET,
+                       {},
+                       DocumentState::Alive) == ENGINE_SUCCESS);
+}
+
+/*
+ * Get the item (the mock server waits for the extstore read and retries
+ * the get if the value was written out). Returns false if it is gone.
+ */
+static bool check_extstore_item(EngineIface* h,
+                                const void* cookie,
+                                int index) {
+    uint8_t key[64];
+    DocKey docKey(key,
+                  snprintf(reinterpret_cast<char*>(key),
+                           sizeof(key),
+                           "extstore_key_%08d",
+                           index),
+                  DocKeyEncodesCollectionId::No);
+    auto ret = h->get(cookie, docKey, Vbid(0), DocStateFilter::Alive);
+    if (ret.first == cb::engine_errc::no_such_key) {
+        return false;
+    }
+    cb_assert(ret.first == cb::engine_errc::success);
+    item_info ii;
+    cb_assert(h->get_item_info(ret.second.get(), &ii));
+    assert_equal(4096u, ii.nbytes);
+    const auto* value = static_cast<const char*>(ii.value[0].iov_base);
+    for (size_t pos = 0; pos < 4096; ++pos) {
+        cb_assert(value[pos] == char('a' + (index % 26)));
+    }
+    return true;
+}
+
+/*
+ * Make sure the cold items are written to the extstore, and that getting
+ * them reads the values back into memory
+ */
+static enum test_result extstore_test(EngineIface* h) {
+    const int n_keys = 20;
+    const auto* cookie = test_harness->create_cookie();
+    for (int ii = 0; ii < n_keys; ++ii) {
+        store_extstore_item(h, cookie, ii);
+    }
+
+    /* Most of them go straight to COLD and get written out from there */
+    cb_assert(wait_for_extstore_stat(h, cookie, "objects_written", n_keys / 2));
+    const auto written = get_extstore_stat(h, cookie, "objects_written");
+
+    for (int ii = 0; ii < n_keys; ++ii) {
+        cb_assert(check_extstore_item(h, cookie, ii));
+    }
+    assert_ge(get_extstore_stat(h, cookie, "objects_read"), written);
+    assert_equal(uint64_t(0), get_extstore_stat(h, cookie, "read_misses"));
+
+    test_harness->destroy_cookie(cookie);
+    return SUCCESS;
+}
+
+/*
+ * Make sure that once the cache starts to evict, the items at the tail of
+ * COLD are written to the extstore (even though they're younger than
+ * ext_item_age) and may still be read back
+ */
+static enum test_result extstore_eviction_test(EngineIface* h) {
+    const auto* cookie = test_harness->create_cookie();
+    int n_keys = 0;
+    while (get_extstore_stat(h, cookie, "objects_written") == 0) {
+        cb_assert(n_keys < 10000);
+        store_extstore_item(h, cookie, n_keys++);
+        if (n_keys % 100 == 0) {
+            /* Give the LRU maintainer a chance to notice the evictions */
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+
+    int found = 0;
+    for (int ii = 0; ii < n_keys; ++ii) {
+        if (check_extstore_item(h, cookie, ii)) {
+            ++found;
+        }
+    }
+    assert_ge(get_extstore_stat(h, cookie, "objects_read"), uint64_t(1));
+    assert_ge(found, 1);
+
+    test_harness->destroy_cookie(cookie);
+    return SUCCESS;
+}
+
+static void extstore_cleanup(engine_test_t*, enum test_result) {
+    remove(EXTSTORE_FILE);
+}
+
+/*
+ * Sum a per slab class stat ("items:<id>:<name>") over all of the classes
+ * (at least one class must have the stat)
+ */
+static uint64_t get_items_stat(EngineIface* h,
+                               const void* cookie,
+                               const std::string& name) {
+    collected_stats.clear();
+    cb_assert(h->get_stats(cookie, "items"_ccb, collect_stats_handler) ==
+              ENGINE_SUCCESS);
+    const std::string suffix = ":" + name;
+    uint64_t total = 0;
+    bool found = false;
+    for (const auto& stat : collected_stats) {
+        const auto& key = stat.first;
+        if (key.compare(0, 6, "items:") == 0 && key.size() > suffix.size() &&
+            key.compare(key.size() - suffix.size(), suffix.size(), suffix) ==
+                    0) {
+            total += std::stoull(stat.second);
+            found = true;
+        }
+    }
+    cb_assert(found);
+    return total;
+}
+
+static bool get_sized_item(EngineIface* h,
+                           const void* cookie,
+                           const char* prefix,
+                           int index) {
+    uint8_t key[64];
+    DocKey docKey(key,
+                  snprintf(reinterpret_cast<char*>(key),
+                           sizeof(key),
+                           "%s_%08d",
+                           prefix,
+                           index),
+                  DocKeyEncodesCollectionId::No);
+    auto ret = h->get(cookie, docKey, Vbid(0), DocStateFilter::Alive);
+    if (ret.first == cb::engine_errc::no_such_key) {
+        return false;
+    }
+    cb_assert(ret.first == cb::engine_errc::success);
+    return true;
+}
+
+/* Wait (for up to 30s) for the LRU maintainer to reach the expected state */
+template <typename Predicate>
+static bool wait_for_lru(Predicate predicate) {
+    const auto deadline =
+            std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (!predicate()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return true;
+}
+
+/*
+ * New items are linked into HOT (the maintainer may only move what is
+ * above hot_lru_pct of the class, which is 1 of the 100 items here)
+ */
+static enum test_result lru_new_items_hot_test(EngineIface* h) {
+    const auto* cookie = test_harness->create_cookie();
+    for (int ii = 0; ii < 100; ++ii) {
+        store_sized_item(h, cookie, "new", ii, 100);
+    }
+    assert_equal(uint64_t(100), get_items_stat(h, cookie, "number"));
+    assert_ge(get_items_stat(h, cookie, "number_hot"), uint64_t(99));
+    assert_equal(uint64_t(0), get_items_stat(h, cookie, "number_warm"));
+    test_harness->destroy_cookie(cookie);
+    return SUCCESS;
+}
+
+/*
+ * The maintainer keeps HOT and WARM within hot_lru_pct and warm_lru_pct
+ * (50% and 30% here) of the class. The items which were accessed go to
+ * WARM and the rest to COLD.
+ */
+static enum test_result lru_segment_limits_test(EngineIface* h) {
+    const auto* cookie = test_harness->create_cookie();
+    const int n_keys = 100;
+    for (int ii = 0; ii < n_keys; ++ii) {
+        store_sized_item(h, cookie, "limit", ii, 100);
+    }
+    for (int ii = 0; ii < n_keys; ++ii) {
+        cb_assert(get_sized_item(h, cookie, "limit", ii));
+    }
+
+    cb_assert(wait_for_lru([h, cookie]() {
+        return get_items_stat(h, cookie, "number_hot") <= 50 &&
+               get_items_stat(h, cookie, "number_warm") <= 30 &&
+               get_items_stat(h, cookie, "moves_to_warm") >= 50 &&
+               get_items_stat(h, cookie, "number_cold") >= 20;
+    }));
+
+    /* Every item is in exactly one of the segments */
+    assert_equal(uint64_t(n_keys), get_items_stat(h, cookie, "number"));
+    assert_equal(uint64_t(n_keys),
+                 get_items_stat(h, cookie, "number_hot") +
+                         get_items_stat(h, cookie, "number_warm") +
+                         get_items_stat(h, cookie, "number_cold"));
+    /*
+     * All of the items were accessed, so the (at least) 50 which left HOT
+     * went through WARM (the wait above checks that), and the ones which
+     * didn't fit in WARM moved on to COLD
+     */
+    assert_ge(get_items_stat(h, cookie, "moves_to_cold"), uint64_t(20));
+    /* Nothing was accessed again once in WARM, but the stat is there */
+    assert_equal(uint64_t(0), get_items_stat(h, cookie, "moves_within_warm"));
+
+    for (int ii = 0; ii < n_keys; ++ii) {
+        cb_assert(get_sized_item(h, cookie, "limit", ii));
+    }
+    test_harness->destroy_cookie(cookie);
+    return SUCCESS;
+}
+
+/*
+ * An item which was accessed after it reached the tail of COLD is moved
+ * to WARM (by the maintainer or the eviction) instead of being evicted
+ */
+static enum test_result lru_active_not_evicted_test(EngineIface* h) {
+    const auto* cookie = test_harness->create_cookie();
+    store_sized_item(h, cookie, "active", 0, 4096);
+    const int n_filler = 20;
+    for (int ii = 0; ii < n_filler; ++ii) {
+        store_sized_item(h, cookie, "filler", ii, 4096);
+    }
+    /* HOT may hold 4 of the 21 items; the oldest are now at the tail of COLD */
+    cb_assert(wait_for_lru([h, cookie]() {
+        return get_items_stat(h, cookie, "number_cold") == 17;
+    }));
+    assert_equal(uint64_t(0), get_stat(h, cookie, {}, "evictions"));
+
+    cb_assert(get_sized_item(h, cookie, "active", 0));
+
+    int ii;
+    for (ii = n_filler; ii < 1000; ++ii) {
+        store_sized_item(h, cookie, "filler", ii, 4096);
+        if (get_stat(h, cookie, {}, "evictions") == 2) {
+            break;
+        }
+    }
+    cb_assert(ii < 1000);
+
+    cb_assert(get_sized_item(h, cookie, "active", 0));
+    cb_assert(!get_sized_item(h, cookie, "filler", 0));
+    cb_assert(!get_sized_item(h, cookie, "filler", 1));
+    cb_assert(get_sized_item(h, cookie, "filler", 2));
+    assert_ge(get_items_stat(h, cookie, "moves_to_warm"), uint64_t(1));
+
+    test_harness->destroy_cookie(cookie);
+    return SUCCESS;
+}
+
+/*
+ * Delete buckets while the LRU maintainer is busy moving their items
+ * (the maintainer must not touch an engine which is being destroyed)
+ */
+static enum test_result lru_bucket_destroy_test(engine_test_t* test) {
+    const int n_keys = 2000;
+    const auto* cookie = test_harness->create_cookie();
+    for (int b = 0; b < 10; b++) {
+        auto* h = test_harness->create_bucket(true, test->cfg);
+        cb_assert(h != nullptr);
+        for (int ii = 0; ii < n_keys; ii++) {
+            store_sized_item(h, cookie, "destroy", ii, 100);
+        }
+        /* Make them all active so the maintainer has plenty to move */
+        for (int ii = 0; ii < n_keys; ii++) {
+            cb_assert(get_sized_item(h, cookie, "destroy", ii));
+        }
+        test_harness->destroy_bucket(h, false);
+    }
+    test_harness->destroy_cookie(cookie);
+    return SUCCESS;
+}
+
+/* Get the status of the scrubber ("running" or "stopped") */
+static std::string get_scrubber_status(EngineIface* h, const void* cookie) {
+    collected_stats.clear();
+    cb_assert(h->get_stats(cookie, "scrub"_ccb, collect_stats_handler) ==
+              ENGINE_SUCCESS);
+    return collected_stats["scrubber:status"];
+}
+
+static void start_scrub(EngineIface* h, const void* cookie) {
+    cb::mcbp::Request request = {};
+    request.setMagic(cb::mcbp::Magic::ClientRequest);
+    request.setOpcode(cb::mcbp::ClientOpcode::Scrub);
+    cb::mcbp::Status status = cb::mcbp::Status::Einternal;
+    cb_assert(h->unknown_command(cookie,
+                                 request,
+                                 [&status](const void*,
+                                           uint16_t,
+                                           const void*,
+                                           uint8_t,
+                                           const void*,
+                                           uint32_t,
+                                           uint8_t,
+                                           cb::mcbp::Status s,
+                                           uint64_t,
+                                           const void*) {
+                                     status = s;
+                                     return true;
+                                 }) == ENGINE_SUCCESS);
+    cb_assert(status == cb::mcbp::Status::Success);
+}
+
+/*
+ * With the throttle on (one item per slice as scrub_slice_us is 0, and
+ * 2000 items per second) the scrub still runs to completion and removes
+ * all of the expired items, and it takes as long as the rate says.
+ * HOT may hold 99% of the items so the LRU maintainer doesn't reclaim the
+ * expired items before the scrubber gets to them.
+ */
+static enum test_result scrub_throttle_test(EngineIface* h) {
+    const int n_keys = 500;
+    const auto* cookie = test_harness->create_cookie();
+    /*
+     * The oldest (the only one the maintainer may move out of HOT) are the
+     * ones which don't expire
+     */
+    for (int ii = 0; ii < n_keys; ++ii) {
+        store_sized_item(h, cookie, "scrub_keep", ii, 100);
+    }
+    for (int ii = 0; ii < n_keys; ++ii) {
+        uint8_t key[64];
+        DocKey docKey(key,
+                      snprintf(reinterpret_cast<char*>(key),
+                               sizeof(key),
+                               "scrub_expire_%08d",
+                               ii),
+                      DocKeyEncodesCollectionId::No);
+        auto ret = h->allocate(
+                cookie, docKey, 100, 0, 10, PROTOCOL_BINARY_RAW_BYTES, Vbid(0));
+        cb_assert(ret.first == cb::engine_errc::success);
+        uint64_t cas = 0;
+        cb_assert(h->store(cookie,
+                           ret.second.get(),
+                           cas,
+                           OPERATION_SET,
+                           {},
+                           DocumentState::Alive) == ENGINE_SUCCESS);
+    }
+    test_harness->time_travel(11);
+
+    const auto start = std::chrono::steady_clock::now();
+    start_scrub(h, cookie);
+    const auto deadline = start + std::chrono::seconds(30);
+    while (get_scrubber_status(h, cookie) != "stopped") {
+        cb_assert(std::chrono::steady_clock::now() < deadline);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    assert_equal(uint64_t(2 * n_keys),
+                 get_stat(h, cookie, "scrub"_ccb, "scrubber:visited"));
+    assert_equal(uint64_t(n_keys),
+                 get_stat(h, cookie, "scrub"_ccb, "scrubber:cleaned"));
+    assert_equal(uint64_t(100),
+                 get_stat(h, cookie, "scrub"_ccb, "scrubber:progress"));
+    /* Every slice only looked at a single item */
+    assert_ge(get_stat(h, cookie, "scrub"_ccb, "scrubber:slices"),
+              uint64_t(2 * n_keys));
+    /* 1000 items at 2000/s; the last slice isn't followed by a sleep */
+    cb_assert(elapsed >= std::chrono::milliseconds(400));
+    assert_equal(uint64_t(n_keys), get_stat(h, cookie, {}, "curr_items"));
+
+    for (int ii = 0; ii < n_keys; ++ii) {
+        cb_assert(get_sized_item(h, cookie, "scrub_keep", ii));
+    }
+    test_harness->destroy_cookie(cookie);
+    return SUCCESS;
+}
+
 /*
  * Destroy many buckets - this test is really more interesting with valgrind
  *  destroy should invoke a background cleaner thread and at exit time there
@@ -665,6 +1234,33 @@ engine_test_t* get_tests(void) {
         TEST_CASE("get stats struct test", get_stats_struct_test, NULL, NULL, NULL, NULL, NULL),
         TEST_CASE("aggregate stats test", aggregate_stats_test, NULL, NULL, NULL, NULL, NULL),
         TEST_CASE("Test datatype", test_datatype, NULL, NULL, NULL, NULL, NULL),
+        TEST_CASE("hash table concurrency test", hash_table_concurrency_test,
+                  NULL, NULL, NULL, NULL, NULL),
+        TEST_CASE("slab automove test", slab_automove_test, NULL, NULL,
+                  "cache_size=4194304;slab_automove=true", NULL, NULL),
+        TEST_CASE("extstore test", extstore_test, NULL, NULL,
+                  "ext_path=" EXTSTORE_FILE ";ext_size=4194304;"
+                  "ext_page_size=1048576;ext_item_age=0",
+                  NULL, extstore_cleanup),
+        TEST_CASE("extstore eviction test", extstore_eviction_test, NULL, NULL,
+                  "cache_size=2097152;ext_path=" EXTSTORE_FILE ";"
+                  "ext_size=8388608;ext_page_size=1048576",
+                  NULL, extstore_cleanup),
+        TEST_CASE("LRU new items hot test", lru_new_items_hot_test, NULL, NULL,
+                  "hot_lru_pct=99;warm_lru_pct=0", NULL, NULL),
+        TEST_CASE("LRU segment limits test", lru_segment_limits_test, NULL,
+                  NULL, "hot_lru_pct=50;warm_lru_pct=30", NULL, NULL),
+#ifndef VALGRIND
+        // cache_size=48 and using malloc don't work (see the LRU test)
+        TEST_CASE("LRU active not evicted test", lru_active_not_evicted_test,
+                  NULL, NULL, "cache_size=48", NULL, NULL),
+#endif
+        TEST_CASE("scrub throttle test", scrub_throttle_test, NULL, NULL,
+                  "hot_lru_pct=99;warm_lru_pct=0;scrub_slice_us=0;"
+                  "scrub_rate=2000",
+                  NULL, NULL),
+        TEST_CASE_V2("LRU bucket destroy test", lru_bucket_destroy_test, NULL,
+                     NULL, NULL, NULL, NULL),
         TEST_CASE_V2("Bucket destroy", test_n_bucket_destroy, NULL, NULL, NULL, NULL, NULL),
         TEST_CASE_V2("Bucket destroy interleaved", test_bucket_destroy_interleaved, NULL, NULL, NULL, NULL, NULL),
         TEST_CASE(NULL, NULL, NULL, NULL, NULL, NULL, NULL)
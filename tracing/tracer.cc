@@ -31,20 +31,32 @@ std::chrono::microseconds to_micros(
 namespace cb {
 namespace tracing {
 
+constexpr size_t Tracer::MaxSpans;
+constexpr uint8_t Tracer::NoSpan;
+
 Tracer::SpanId Tracer::invalidSpanId() {
     return std::numeric_limits<SpanId>::max();
 }
 
 Tracer::SpanId Tracer::begin(const TraceCode tracecode,
                              std::chrono::steady_clock::time_point startTime) {
-    vecSpans.emplace_back(tracecode, startTime);
-    return vecSpans.size() - 1;
+    if (numSpans == MaxSpans) {
+        ++numDropped;
+        return invalidSpanId();
+    }
+    const auto spanId = numSpans++;
+    spans[spanId] = {tracecode, startTime};
+    auto& first = firstSpan[size_t(tracecode)];
+    if (first == NoSpan) {
+        first = spanId;
+    }
+    return spanId;
 }
 
 bool Tracer::end(SpanId spanId, std::chrono::steady_clock::time_point endTime) {
-    if (spanId >= vecSpans.size())
+    if (spanId >= numSpans)
         return false;
-    auto& span = vecSpans[spanId];
+    auto& span = spans[spanId];
     span.duration =
             std::chrono::duration_cast<Span::Duration>(endTime - span.start);
     return true;
@@ -53,25 +65,18 @@ bool Tracer::end(SpanId spanId, std::chrono::steady_clock::time_point endTime) {
 bool Tracer::end(const TraceCode tracecode,
                  std::chrono::steady_clock::time_point endTime) {
     // Locate the ID for this tracecode (when we begin the Span).
-    SpanId spanId = 0;
-    for (const auto& span : vecSpans) {
-        if (span.code == tracecode) {
-            break;
-        }
-        spanId++;
+    const auto spanId = firstSpan[size_t(tracecode)];
+    if (spanId == NoSpan) {
+        return false;
     }
     return end(spanId, endTime);
 }
 
-const std::vector<Span>& Tracer::getDurations() const {
-    return vecSpans;
-}
-
 Span::Duration Tracer::getTotalMicros() const {
-    if (vecSpans.empty()) {
+    if (numSpans == 0) {
         return std::chrono::microseconds(0);
     }
-    const auto& top = vecSpans[0];
+    const auto& top = spans[0];
     // If the Span has not yet been closed; return the duration up to now.
     if (top.duration == Span::Duration::max()) {
         return std::chrono::duration_cast<Span::Duration>(
@@ -102,7 +107,9 @@ std::chrono::microseconds Tracer::decodeMicros(uint16_t encoded) {
 }
 
 void Tracer::clear() {
-    vecSpans.clear();
+    numSpans = 0;
+    numDropped = 0;
+    firstSpan.fill(NoSpan);
 }
 
 } // end namespace tracing
@@ -115,10 +122,10 @@ MEMCACHED_PUBLIC_API std::ostream& operator<<(
 
 MEMCACHED_PUBLIC_API std::string to_string(const cb::tracing::Tracer& tracer,
                                            bool raw) {
-    const auto& vecSpans = tracer.getDurations();
+    const auto spans = tracer.getDurations();
     std::ostringstream os;
-    auto size = vecSpans.size();
-    for (const auto& span : vecSpans) {
+    auto size = spans.size();
+    for (const auto& span : spans) {
         os << to_string(span.code) << "="
            << span.start.time_since_epoch().count() << ":";
         if (span.duration == std::chrono::microseconds::max()) {
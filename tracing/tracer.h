@@ -17,8 +17,10 @@
 #pragma once
 
 #include "tracing/tracetypes.h"
+#include <platform/sized_buffer.h>
+#include <array>
 #include <chrono>
-#include <vector>
+#include <cstdint>
 
 namespace cb {
 namespace tracing {
@@ -44,24 +46,36 @@ public:
     /// gives maximum duration of 35.79minutes.
     using Duration = std::chrono::duration<int32_t, std::micro>;
 
+    Span() = default;
     Span(TraceCode code,
          std::chrono::steady_clock::time_point start,
          Duration duration = Duration::max())
         : start(start), duration(duration), code(code) {
     }
     std::chrono::steady_clock::time_point start;
-    Duration duration;
-    TraceCode code;
+    Duration duration = Duration::max();
+    TraceCode code = TraceCode::REQUEST;
 };
 
 /**
- * Tracer maintains an ordered vector of tracepoints
+ * Tracer maintains an ordered list of tracepoints
  * with name:time(micros)
+ *
+ * The spans are kept in a fixed size array inside the tracer so that
+ * tracing a request never allocates memory; the spans begun once the
+ * array is full are dropped (and counted).
  */
 class MEMCACHED_PUBLIC_CLASS Tracer {
 public:
     using SpanId = std::size_t;
 
+    /// The maximum number of spans recorded for a request
+    static constexpr size_t MaxSpans = 16;
+
+    Tracer() {
+        firstSpan.fill(NoSpan);
+    }
+
     static SpanId invalidSpanId();
 
     /// Begin a Span starting from the specified time point (defaults to now)
@@ -79,7 +93,14 @@ public:
                      std::chrono::steady_clock::now());
 
     // get the tracepoints as ordered durations
-    const std::vector<Span>& getDurations() const;
+    cb::sized_buffer<const Span> getDurations() const {
+        return {spans.data(), numSpans};
+    }
+
+    /// Get the number of spans dropped as the tracer was full
+    size_t getNumDroppedSpans() const {
+        return numDropped;
+    }
 
     Span::Duration getTotalMicros() const;
 
@@ -98,7 +119,17 @@ public:
                                     bool raw);
 
 protected:
-    std::vector<Span> vecSpans;
+    /// The marker in firstSpan for a TraceCode without spans
+    static constexpr uint8_t NoSpan = 0xff;
+    static_assert(MaxSpans < NoSpan, "MaxSpans must fit in firstSpan");
+
+    std::array<Span, MaxSpans> spans;
+    uint8_t numSpans = 0;
+    uint32_t numDropped = 0;
+
+    /// The id of the first span begun for each TraceCode (so end() with a
+    /// TraceCode doesn't have to search the spans)
+    std::array<uint8_t, NumTraceCodes> firstSpan;
 };
 
 struct MEMCACHED_PUBLIC_CLASS Traceable {
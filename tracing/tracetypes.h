@@ -16,6 +16,8 @@
  */
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
 #include <memcached/visibility.h>
@@ -36,6 +38,9 @@ enum class TraceCode : uint8_t {
     SETWITHMETA,
     STORE,
 };
+
+/// The number of trace codes (the last TraceCode + 1)
+constexpr size_t NumTraceCodes = size_t(TraceCode::STORE) + 1;
 } // namespace tracing
 } // namespace cb
 
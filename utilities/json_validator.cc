@@ -0,0 +1,370 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "json_validator.h"
+
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace cb {
+namespace json {
+
+static const uint8_t* skipWhitespace(const uint8_t* pos, const uint8_t* end) {
+    while (pos < end &&
+           (*pos == ' ' || *pos == '\n' || *pos == '\r' || *pos == '\t')) {
+        ++pos;
+    }
+    return pos;
+}
+
+static bool isDigit(uint8_t c) {
+    return c >= '0' && c <= '9';
+}
+
+static bool isHexDigit(uint8_t c) {
+    return isDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+/**
+ * Skip a multi-byte UTF-8 sequence, rejecting overlong encodings,
+ * surrogates and code points above U+10FFFF
+ *
+ * @param pos the first byte of the sequence (>= 0x80)
+ * @return the byte after the sequence, or nullptr if it isn't valid
+ */
+static const uint8_t* skipUtf8Sequence(const uint8_t* pos,
+                                       const uint8_t* end) {
+    const uint8_t c = *pos;
+    size_t length;
+    // The range of the second byte (the following ones are any
+    // continuation byte)
+    uint8_t min = 0x80;
+    uint8_t max = 0xbf;
+    if (c >= 0xc2 && c <= 0xdf) {
+        length = 2;
+    } else if (c >= 0xe0 && c <= 0xef) {
+        length = 3;
+        if (c == 0xe0) {
+            min = 0xa0;
+        } else if (c == 0xed) {
+            max = 0x9f;
+        }
+    } else if (c >= 0xf0 && c <= 0xf4) {
+        length = 4;
+        if (c == 0xf0) {
+            min = 0x90;
+        } else if (c == 0xf4) {
+            max = 0x8f;
+        }
+    } else {
+        return nullptr;
+    }
+
+    if (size_t(end - pos) < length || pos[1] < min || pos[1] > max) {
+        return nullptr;
+    }
+    for (size_t ii = 2; ii < length; ++ii) {
+        if ((pos[ii] & 0xc0) != 0x80) {
+            return nullptr;
+        }
+    }
+    return pos + length;
+}
+
+/**
+ * Find the first byte of the contents of a string which isn't plain
+ * (printable ASCII other than a quote or a backslash)
+ */
+static const uint8_t* findSpecialByte(const uint8_t* pos,
+                                      const uint8_t* end) {
+#ifdef __SSE2__
+    const auto quote = _mm_set1_epi8('"');
+    const auto backslash = _mm_set1_epi8('\\');
+    const auto space = _mm_set1_epi8(' ');
+    while (end - pos >= 16) {
+        const auto chunk =
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+        // The (signed) compare with space also catches the bytes >= 0x80
+        const auto special =
+                _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                                          _mm_cmpeq_epi8(chunk, backslash)),
+                             _mm_cmplt_epi8(chunk, space));
+        const int mask = _mm_movemask_epi8(special);
+        if (mask != 0) {
+            return pos + __builtin_ctz(mask);
+        }
+        pos += 16;
+    }
+#endif
+    while (pos < end && *pos != '"' && *pos != '\\' && *pos >= ' ' &&
+           *pos < 0x80) {
+        ++pos;
+    }
+    return pos;
+}
+
+/**
+ * Skip the rest of a string
+ *
+ * @param pos the byte after the opening quote
+ * @return the byte after the closing quote, or nullptr if the string isn't
+ *         valid
+ */
+static const uint8_t* skipString(const uint8_t* pos, const uint8_t* end) {
+    for (;;) {
+        pos = findSpecialByte(pos, end);
+        if (pos == end) {
+            return nullptr;
+        }
+
+        const uint8_t c = *pos;
+        if (c == '"') {
+            return pos + 1;
+        } else if (c == '\\') {
+            if (end - pos < 2) {
+                return nullptr;
+            }
+            switch (pos[1]) {
+            case '"':
+            case '\\':
+            case '/':
+            case 'b':
+            case 'f':
+            case 'n':
+            case 'r':
+            case 't':
+                pos += 2;
+                break;
+            case 'u':
+                if (end - pos < 6 || !isHexDigit(pos[2]) ||
+                    !isHexDigit(pos[3]) || !isHexDigit(pos[4]) ||
+                    !isHexDigit(pos[5])) {
+                    return nullptr;
+                }
+                pos += 6;
+                break;
+            default:
+                return nullptr;
+            }
+        } else if (c < ' ') {
+            // Control characters must be escaped
+            return nullptr;
+        } else {
+            pos = skipUtf8Sequence(pos, end);
+            if (pos == nullptr) {
+                return nullptr;
+            }
+        }
+    }
+}
+
+static const uint8_t* skipDigits(const uint8_t* pos, const uint8_t* end) {
+    while (pos < end && isDigit(*pos)) {
+        ++pos;
+    }
+    return pos;
+}
+
+/// Skip a number: -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+static const uint8_t* skipNumber(const uint8_t* pos, const uint8_t* end) {
+    if (*pos == '-') {
+        ++pos;
+    }
+    if (pos == end) {
+        return nullptr;
+    }
+    if (*pos == '0') {
+        ++pos;
+    } else if (isDigit(*pos)) {
+        pos = skipDigits(pos, end);
+    } else {
+        return nullptr;
+    }
+
+    if (pos < end && *pos == '.') {
+        const auto* digits = pos + 1;
+        pos = skipDigits(digits, end);
+        if (pos == digits) {
+            return nullptr;
+        }
+    }
+
+    if (pos < end && (*pos == 'e' || *pos == 'E')) {
+        ++pos;
+        if (pos < end && (*pos == '+' || *pos == '-')) {
+            ++pos;
+        }
+        const auto* digits = pos;
+        pos = skipDigits(digits, end);
+        if (pos == digits) {
+            return nullptr;
+        }
+    }
+    return pos;
+}
+
+static const uint8_t* skipLiteral(const uint8_t* pos,
+                                  const uint8_t* end,
+                                  const char* literal) {
+    const size_t length = strlen(literal);
+    if (size_t(end - pos) < length || memcmp(pos, literal, length) != 0) {
+        return nullptr;
+    }
+    return pos + length;
+}
+
+/**
+ * Skip the key of an object member and the colon after it
+ *
+ * @return the start of the member's value, or nullptr if the key isn't
+ *         valid
+ */
+static const uint8_t* skipKey(const uint8_t* pos, const uint8_t* end) {
+    if (pos == end || *pos != '"') {
+        return nullptr;
+    }
+    pos = skipString(pos + 1, end);
+    if (pos == nullptr) {
+        return nullptr;
+    }
+    pos = skipWhitespace(pos, end);
+    if (pos == end || *pos != ':') {
+        return nullptr;
+    }
+    return skipWhitespace(pos + 1, end);
+}
+
+bool Validator::validate(const uint8_t* data, size_t size) {
+    depth = 0;
+    const uint8_t* pos = skipWhitespace(data, data + size);
+    const uint8_t* const end = data + size;
+
+    for (;;) {
+        // Expect a value
+        if (pos == end) {
+            return false;
+        }
+        switch (*pos) {
+        case '{':
+            pos = skipWhitespace(pos + 1, end);
+            if (pos < end && *pos == '}') {
+                ++pos;
+                break;
+            }
+            push(true);
+            pos = skipKey(pos, end);
+            if (pos == nullptr) {
+                return false;
+            }
+            continue;
+        case '[':
+            pos = skipWhitespace(pos + 1, end);
+            if (pos < end && *pos == ']') {
+                ++pos;
+                break;
+            }
+            push(false);
+            continue;
+        case '"':
+            pos = skipString(pos + 1, end);
+            break;
+        case 't':
+            pos = skipLiteral(pos, end, "true");
+            break;
+        case 'f':
+            pos = skipLiteral(pos, end, "false");
+            break;
+        case 'n':
+            pos = skipLiteral(pos, end, "null");
+            break;
+        default:
+            pos = skipNumber(pos, end);
+        }
+        if (pos == nullptr) {
+            return false;
+        }
+
+        // A value is complete; close the containers it completes and
+        // move on to the next value
+        for (;;) {
+            pos = skipWhitespace(pos, end);
+            if (depth == 0) {
+                return pos == end;
+            }
+            if (pos == end) {
+                return false;
+            }
+            if (*pos == ',') {
+                pos = skipWhitespace(pos + 1, end);
+                if (inObject()) {
+                    pos = skipKey(pos, end);
+                    if (pos == nullptr) {
+                        return false;
+                    }
+                }
+                break;
+            }
+            if (*pos != (inObject() ? '}' : ']')) {
+                return false;
+            }
+            ++pos;
+            pop();
+        }
+    }
+}
+
+void Validator::push(bool isObject) {
+    uint64_t* word;
+    size_t bit;
+    if (depth < 64) {
+        word = &inlineStack;
+        bit = depth;
+    } else {
+        const size_t index = depth - 64;
+        if (index / 64 == stack.size()) {
+            stack.push_back(0);
+        }
+        word = &stack[index / 64];
+        bit = index % 64;
+    }
+    if (isObject) {
+        *word |= uint64_t(1) << bit;
+    } else {
+        *word &= ~(uint64_t(1) << bit);
+    }
+    ++depth;
+}
+
+bool Validator::inObject() const {
+    size_t index = depth - 1;
+    if (index < 64) {
+        return (inlineStack >> index) & 1;
+    }
+    index -= 64;
+    return (stack[index / 64] >> (index % 64)) & 1;
+}
+
+bool isValid(cb::const_char_buffer data) {
+    Validator validator;
+    return validator.validate(data);
+}
+
+} // namespace json
+} // namespace cb
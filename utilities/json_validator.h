@@ -0,0 +1,79 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <platform/sized_buffer.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace cb {
+namespace json {
+
+/**
+ * Check if a document is valid (UTF-8 encoded) JSON, accepting the same
+ * documents as JSON_checker: any JSON value (not only objects and arrays),
+ * optionally surrounded by whitespace.
+ *
+ * Unlike JSON_checker, which runs a state machine over every byte, the
+ * contents of strings (the bulk of most documents) are scanned 16 bytes
+ * at a time (with SSE2), only stopping at the bytes which need a closer
+ * look: quotes, escapes, control characters and multi-byte UTF-8
+ * sequences.
+ *
+ * An object may be reused (by one thread at a time) to avoid allocating
+ * memory for documents nested deeper than 64 levels.
+ */
+class Validator {
+public:
+    bool validate(const uint8_t* data, size_t size);
+
+    bool validate(cb::const_byte_buffer data) {
+        return validate(data.data(), data.size());
+    }
+
+    bool validate(cb::const_char_buffer data) {
+        return validate(reinterpret_cast<const uint8_t*>(data.data()),
+                        data.size());
+    }
+
+private:
+    /// Enter a container (an object if isObject is set, else an array)
+    void push(bool isObject);
+
+    /// Leave the innermost container
+    void pop() {
+        --depth;
+    }
+
+    /// Is the innermost container an object?
+    bool inObject() const;
+
+    /// The number of containers we're in
+    size_t depth = 0;
+    /// The kind of the outermost 64 containers, one bit each
+    uint64_t inlineStack = 0;
+    /// The kind of the containers nested deeper
+    std::vector<uint64_t> stack;
+};
+
+/// Check a document with a temporary Validator
+bool isValid(cb::const_char_buffer data);
+
+} // namespace json
+} // namespace cb
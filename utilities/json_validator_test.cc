@@ -0,0 +1,117 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "json_validator.h"
+
+#include <folly/portability/GTest.h>
+
+#include <string>
+
+using cb::json::isValid;
+
+TEST(JsonValidatorTest, Scalars) {
+    EXPECT_TRUE(isValid("1"));
+    EXPECT_TRUE(isValid(" -0.5e+3 "));
+    EXPECT_TRUE(isValid("true"));
+    EXPECT_TRUE(isValid("false"));
+    EXPECT_TRUE(isValid("null"));
+    EXPECT_TRUE(isValid(R"("string")"));
+
+    EXPECT_FALSE(isValid(""));
+    EXPECT_FALSE(isValid("  "));
+    EXPECT_FALSE(isValid("01"));
+    EXPECT_FALSE(isValid("1."));
+    EXPECT_FALSE(isValid("-"));
+    EXPECT_FALSE(isValid("1e"));
+    EXPECT_FALSE(isValid("tru"));
+    EXPECT_FALSE(isValid("true false"));
+    EXPECT_FALSE(isValid("nul1"));
+}
+
+TEST(JsonValidatorTest, Containers) {
+    EXPECT_TRUE(isValid("{}"));
+    EXPECT_TRUE(isValid("[]"));
+    EXPECT_TRUE(isValid(R"({"a": [1, 2, {"b": null}], "c": true})"));
+    EXPECT_TRUE(isValid("[[[[]]]]"));
+
+    EXPECT_FALSE(isValid(R"({"a":})"));
+    EXPECT_FALSE(isValid(R"({"a" 1})"));
+    EXPECT_FALSE(isValid(R"({1: 1})"));
+    EXPECT_FALSE(isValid("[1,]"));
+    EXPECT_FALSE(isValid("{,}"));
+    EXPECT_FALSE(isValid("[1 2]"));
+    EXPECT_FALSE(isValid("[[[[]]]"));
+    EXPECT_FALSE(isValid(R"({"a": 1}})"));
+    EXPECT_FALSE(isValid("[1}"));
+}
+
+TEST(JsonValidatorTest, DeepNesting) {
+    // Nest objects and arrays both within and beyond the 64 levels kept
+    // inline
+    std::string doc;
+    for (int ii = 0; ii < 200; ++ii) {
+        doc += (ii % 2) ? R"({"a":[)" : R"([{"a":)";
+    }
+    doc += "1";
+    for (int ii = 199; ii >= 0; --ii) {
+        doc += (ii % 2) ? "]}" : "}]";
+    }
+    cb::json::Validator validator;
+    EXPECT_TRUE(validator.validate(doc));
+
+    // Close the outermost array as an object
+    doc.back() = '}';
+    EXPECT_FALSE(validator.validate(doc));
+}
+
+TEST(JsonValidatorTest, Strings) {
+    EXPECT_TRUE(isValid(R"("\"\\\/\b\f\n\r\té")"));
+    EXPECT_FALSE(isValid(R"("\x")"));
+    EXPECT_FALSE(isValid(R"("\u00g9")"));
+    EXPECT_FALSE(isValid(R"("unterminated)"));
+
+    // Long enough to be scanned in blocks, with the special characters in
+    // various positions
+    const std::string plain(100, 'x');
+    for (size_t ii = 0; ii < plain.size(); ++ii) {
+        auto doc = plain;
+        doc[ii] = '\t';
+        EXPECT_FALSE(isValid("\"" + doc + "\"")) << ii;
+        doc[ii] = '"';
+        EXPECT_FALSE(isValid("\"" + doc + "\"")) << ii;
+        doc.replace(ii, 1, "\\n");
+        EXPECT_TRUE(isValid("\"" + doc + "\"")) << ii;
+    }
+}
+
+TEST(JsonValidatorTest, Utf8) {
+    EXPECT_TRUE(isValid("\"\xc3\xa9\""));
+    EXPECT_TRUE(isValid("\"\xe2\x82\xac\""));
+    EXPECT_TRUE(isValid("\"\xf0\x9f\x98\x80\""));
+
+    // Truncated
+    EXPECT_FALSE(isValid("\"\xc3\""));
+    // Overlong
+    EXPECT_FALSE(isValid("\"\xc0\xaf\""));
+    EXPECT_FALSE(isValid("\"\xe0\x80\xaf\""));
+    // Surrogate
+    EXPECT_FALSE(isValid("\"\xed\xa0\x80\""));
+    // Above U+10FFFF
+    EXPECT_FALSE(isValid("\"\xf4\x90\x80\x80\""));
+    // Outside of a string
+    EXPECT_FALSE(isValid("\xc3\xa9"));
+}
@@ -0,0 +1,208 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "thread_affinity.h"
+#include "string_utilities.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace cb {
+
+static int parseCpuNumber(const std::string& value, const std::string& list) {
+    if (value.empty() ||
+        value.find_first_not_of("0123456789") != std::string::npos ||
+        value.size() > 6) {
+        throw std::invalid_argument("parseCpuList: invalid CPU list \"" +
+                                    list + "\"");
+    }
+    return std::stoi(value);
+}
+
+std::vector<int> parseCpuList(const std::string& list) {
+    std::vector<int> ret;
+    std::string trimmed = list;
+    trimmed.erase(
+            std::remove_if(trimmed.begin(),
+                           trimmed.end(),
+                           [](unsigned char c) { return std::isspace(c); }),
+            trimmed.end());
+    if (trimmed.empty()) {
+        return ret;
+    }
+
+    for (const auto& element : split_string(trimmed, ",")) {
+        auto idx = element.find('-');
+        if (idx == std::string::npos) {
+            ret.push_back(parseCpuNumber(element, list));
+            continue;
+        }
+        const auto first = parseCpuNumber(element.substr(0, idx), list);
+        const auto last = parseCpuNumber(element.substr(idx + 1), list);
+        if (first > last) {
+            throw std::invalid_argument("parseCpuList: invalid range \"" +
+                                        element + "\"");
+        }
+        for (int cpu = first; cpu <= last; ++cpu) {
+            ret.push_back(cpu);
+        }
+    }
+
+    std::sort(ret.begin(), ret.end());
+    ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
+    return ret;
+}
+
+static std::vector<int> readSysfsList(const std::string& path) {
+    std::ifstream file(path);
+    std::string content;
+    if (!file.is_open() || !std::getline(file, content)) {
+        return {};
+    }
+    try {
+        return parseCpuList(content);
+    } catch (const std::invalid_argument&) {
+        return {};
+    }
+}
+
+std::vector<int> getNumaNodeCpus(int node) {
+    if (node < 0) {
+        return {};
+    }
+    return readSysfsList("/sys/devices/system/node/node" +
+                         std::to_string(node) + "/cpulist");
+}
+
+/**
+ * Locate the NUMA node all of the provided CPUs belong to, or -1 if they
+ * span multiple nodes (or the topology isn't available)
+ */
+static int getNumaNodeOfCpus(const std::vector<int>& cpus) {
+    for (const auto node : readSysfsList("/sys/devices/system/node/online")) {
+        const auto nodeCpus = getNumaNodeCpus(node);
+        if (std::includes(
+                    nodeCpus.begin(), nodeCpus.end(), cpus.begin(), cpus.end())) {
+            return node;
+        }
+    }
+    return -1;
+}
+
+ThreadAffinity::ThreadAffinity(const std::string& spec) {
+    const std::string prefix = "node:";
+    if (spec.compare(0, prefix.size(), prefix) == 0) {
+        numaNode = parseCpuNumber(spec.substr(prefix.size()), spec);
+        cpus = getNumaNodeCpus(numaNode);
+        if (cpus.empty()) {
+            throw std::invalid_argument("ThreadAffinity: unknown NUMA node " +
+                                        std::to_string(numaNode));
+        }
+        return;
+    }
+
+    cpus = parseCpuList(spec);
+    if (!cpus.empty()) {
+        numaNode = getNumaNodeOfCpus(cpus);
+    }
+}
+
+std::string ThreadAffinity::applyToCurrentThread() const {
+    if (cpus.empty()) {
+        return {};
+    }
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const auto cpu : cpus) {
+        if (cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+
+    std::string error;
+    auto rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (rc != 0) {
+        error = "pthread_setaffinity_np(" + to_string() +
+                ") failed: " + std::strerror(rc);
+    }
+
+    if (numaNode >= 0) {
+        // Prefer (but don't require) memory from the local node. Use the
+        // system call directly to avoid pulling libnuma into everything
+        // linking with mcd_util.
+        constexpr size_t bits = sizeof(unsigned long) * 8;
+        std::vector<unsigned long> mask(numaNode / bits + 1);
+        mask[numaNode / bits] |= 1UL << (numaNode % bits);
+        if (syscall(SYS_set_mempolicy,
+                    MPOL_PREFERRED,
+                    mask.data(),
+                    mask.size() * bits + 1) != 0) {
+            if (!error.empty()) {
+                error.append("; ");
+            }
+            error.append("set_mempolicy(MPOL_PREFERRED, " +
+                         std::to_string(numaNode) +
+                         ") failed: " + std::strerror(errno));
+        }
+    }
+    return error;
+#else
+    return "thread affinity is not supported on this platform";
+#endif
+}
+
+std::string ThreadAffinity::to_string() const {
+    if (cpus.empty()) {
+        return "none";
+    }
+
+    // Render as a compact cpu list (0-3,8)
+    std::string ret;
+    for (size_t ii = 0; ii < cpus.size(); ++ii) {
+        size_t jj = ii;
+        while (jj + 1 < cpus.size() && cpus[jj + 1] == cpus[jj] + 1) {
+            ++jj;
+        }
+        if (!ret.empty()) {
+            ret.push_back(',');
+        }
+        ret.append(std::to_string(cpus[ii]));
+        if (jj != ii) {
+            ret.push_back('-');
+            ret.append(std::to_string(cpus[jj]));
+        }
+        ii = jj;
+    }
+    if (numaNode >= 0) {
+        ret.append(" (node " + std::to_string(numaNode) + ")");
+    }
+    return ret;
+}
+
+} // namespace cb
@@ -0,0 +1,87 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2019 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace cb {
+
+/**
+ * A description of where a thread should run, parsed from the textual
+ * form used in the configuration:
+ *
+ *     ""            - no affinity (the default)
+ *     "0-3,8,10-11" - run on the listed CPUs
+ *     "node:1"      - run on the CPUs of NUMA node 1
+ *
+ * Memory allocated by a pinned thread prefers the NUMA node its CPUs
+ * belong to (when all of them belong to the same node).
+ */
+class ThreadAffinity {
+public:
+    ThreadAffinity() = default;
+
+    /**
+     * Parse the textual representation of the affinity
+     *
+     * @throws std::invalid_argument if the specification is malformed
+     */
+    explicit ThreadAffinity(const std::string& spec);
+
+    bool empty() const {
+        return cpus.empty();
+    }
+
+    const std::vector<int>& getCpus() const {
+        return cpus;
+    }
+
+    /// The NUMA node memory should be preferred from, or -1 for none
+    int getNumaNode() const {
+        return numaNode;
+    }
+
+    /**
+     * Apply the affinity to the calling thread. Pinning is best effort;
+     * a description of what failed is returned (and an empty string on
+     * success) so the caller may log it through its own logger.
+     */
+    std::string applyToCurrentThread() const;
+
+    std::string to_string() const;
+
+protected:
+    std::vector<int> cpus;
+    int numaNode = -1;
+};
+
+/**
+ * Parse a CPU list in the format used by the Linux kernel (and taskset),
+ * for instance "0-3,8,10-11".
+ *
+ * @throws std::invalid_argument if the list is malformed
+ */
+std::vector<int> parseCpuList(const std::string& list);
+
+/**
+ * Get the CPUs which belong to the given NUMA node (empty if the node
+ * does not exist or the platform doesn't expose the topology)
+ */
+std::vector<int> getNumaNodeCpus(int node);
+
+} // namespace cb
@@ -25,6 +25,7 @@
 #include <memcached/util.h>
 #include <memcached/config_parser.h>
 #include "string_utilities.h"
+#include "thread_affinity.h"
 
 #include <folly/portability/GMock.h>
 #include <folly/portability/GTest.h>
@@ -467,3 +468,29 @@ TEST(ConfigParserTest, A) {
     EXPECT_EQ(0, fclose(error));
     cb::io::rmrf(outfile);
 }
+
+TEST(ThreadAffinityTest, parseCpuList) {
+    EXPECT_TRUE(cb::parseCpuList("").empty());
+    EXPECT_EQ(std::vector<int>({0}), cb::parseCpuList("0"));
+    EXPECT_EQ(std::vector<int>({0, 1, 2, 3, 8, 10, 11}),
+              cb::parseCpuList("0-3,8,10-11"));
+    // Duplicates are removed and the result is sorted
+    EXPECT_EQ(std::vector<int>({1, 2, 3}), cb::parseCpuList("3, 1-2,2"));
+
+    EXPECT_THROW(cb::parseCpuList("a"), std::invalid_argument);
+    EXPECT_THROW(cb::parseCpuList("1,"), std::invalid_argument);
+    EXPECT_THROW(cb::parseCpuList("3-1"), std::invalid_argument);
+    EXPECT_THROW(cb::parseCpuList("-1"), std::invalid_argument);
+}
+
+TEST(ThreadAffinityTest, Spec) {
+    EXPECT_TRUE(cb::ThreadAffinity("").empty());
+    EXPECT_EQ("none", cb::ThreadAffinity("").to_string());
+
+    cb::ThreadAffinity affinity("0-3,8");
+    EXPECT_EQ(std::vector<int>({0, 1, 2, 3, 8}), affinity.getCpus());
+    EXPECT_EQ(0, affinity.to_string().find("0-3,8"));
+
+    EXPECT_THROW(cb::ThreadAffinity("node:"), std::invalid_argument);
+    EXPECT_THROW(cb::ThreadAffinity("node:100000"), std::invalid_argument);
+}
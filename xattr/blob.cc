@@ -29,15 +29,13 @@
 namespace cb {
 namespace xattr {
 
-Blob::Blob(const Blob& other)
+Blob::Blob(const Blob& other, size_t capacity)
     : allocator(default_allocator),
-      alloc_size(other.blob.size()) {
-    decompressed.resize(other.decompressed.size());
-    std::copy_n(other.decompressed.data(),
-                other.decompressed.size(),
-                decompressed.data());
+      alloc_size(std::max(capacity, other.blob.size())) {
+    // The copy lives in its own backing store, so there is no need to copy
+    // the decompressed document other.blob may point into
     allocator.reset(new char[alloc_size]);
-    blob = { allocator.get(), alloc_size };
+    blob = {allocator.get(), other.blob.size()};
     std::copy(other.blob.begin(), other.blob.end(), blob.begin());
 }
 
@@ -51,9 +49,9 @@ Blob::Blob(cb::char_buffer buffer,
 
 Blob& Blob::assign(cb::char_buffer buffer, bool compressed) {
     if (compressed && buffer.size()) {
-        // inflate and attach blob to the compression::buffer
-        if (!cb::compression::inflate(
-                    cb::compression::Algorithm::Snappy,
+        // inflate (only) the xattrs and attach blob to the
+        // compression::buffer
+        if (!cb::xattr::inflate_xattrs(
                     {static_cast<const char*>(buffer.data()), buffer.size()},
                     decompressed)) {
             // inflate (de-compress) failed.  Try to grab the
@@ -70,9 +68,6 @@ Blob& Blob::assign(cb::char_buffer buffer, bool compressed) {
                     std::to_string(uncompressedLength));
         }
 
-        // Connect blob to the decompressed xattrs after resizing which in
-        // theory /could/ release the now un-required non xattr data
-        decompressed.resize(cb::xattr::get_body_offset(decompressed));
         blob = {decompressed.data(), decompressed.size()};
     } else if (buffer.size()) {
         // incoming data is not compressed, just get the size and attach
@@ -84,33 +79,38 @@ Blob& Blob::assign(cb::char_buffer buffer, bool compressed) {
     return *this;
 }
 
-cb::char_buffer Blob::get(const cb::const_char_buffer& key) const {
+size_t Blob::find(const cb::const_char_buffer& key) const {
     try {
         size_t current = 4;
         while (current < blob.len) {
             // Get the length of the next kv-pair
             const auto size = read_length(current);
-            current += 4;
             if (size > key.len) {
                 // This may be the next key
-                if (blob.buf[current + key.len] == '\0' &&
-                    std::memcmp(blob.buf + current, key.buf, key.len) == 0) {
+                const auto* ptr = blob.buf + current + 4;
+                if (ptr[key.len] == '\0' &&
+                    std::memcmp(ptr, key.buf, key.len) == 0) {
                     // Yay this is the key!!!
-                    auto* value = blob.buf + current + key.len + 1;
-                    return {value, strlen(value)};
-                } else {
-                    // jump to the next key!!
-                    current += size;
+                    return current;
                 }
-            } else {
-                current += size;
             }
+            // jump to the next key!!
+            current += 4 + size;
         }
     } catch (const std::out_of_range&) {
     }
 
     // Not found!
-    return {nullptr, 0};
+    return 0;
+}
+
+cb::char_buffer Blob::get(const cb::const_char_buffer& key) const {
+    const auto offset = find(key);
+    if (offset == 0) {
+        return {nullptr, 0};
+    }
+    auto* value = blob.buf + offset + 4 + key.len + 1;
+    return {value, strlen(value)};
 }
 
 void Blob::prune_user_keys() {
@@ -132,17 +132,14 @@ void Blob::prune_user_keys() {
 
 void Blob::remove(const cb::const_char_buffer& key) {
     // Locate the old value
-    const auto old = get(key);
-    if (old.len == 0) {
+    const auto offset = find(key);
+    if (offset == 0) {
         // it's not there
         return;
     }
 
     // there is no need to reallocate as we can just pack the buffer
-    const auto offset = old.buf - blob.buf - 1 - key.len - 4;
-    const auto size = 4 + key.len + 1 + old.len + 1;
-
-    remove_segment(offset, size);
+    remove_segment(offset, 4 + read_length(offset));
 }
 
 void Blob::set(const cb::const_char_buffer& key,
@@ -153,52 +150,53 @@ void Blob::set(const cb::const_char_buffer& key,
     }
 
     // Locate the old value
-    const auto old = get(key);
-    if (old.len == value.len) {
-        // lets do an in-place replacement
-        std::copy(value.buf, value.buf + value.len, old.buf);
-        return;
-    } else if (old.len == 0) {
+    const auto offset = find(key);
+    if (offset == 0) {
         // The old one didn't exist
         append_kvpair(key, value);
-    } else {
-        // we need to reorganize the buffer. Determine the size of
-        // the resulting document
-        const size_t newsize = blob.len + value.len - old.len;
-        const auto old_offset = old.buf - blob.buf - 1 - key.len - 4;
-        const auto old_kv_size = 4 + key.len + 1 + old.len + 1;
-
-        if (newsize < alloc_size) {
-            // we can do an in-place removement
-            remove_segment(old_offset, old_kv_size);
-        } else {
-            std::unique_ptr<char[]> temp(new char[newsize]);
-            // copy everything up to the old one
-            std::copy(blob.buf, blob.buf + old_offset, temp.get());
-            // Skip the old value and copy the rest
-            std::copy(blob.buf + old_offset + old_kv_size,
-                      blob.buf + blob.len, temp.get() + old_offset);
-            allocator.swap(temp);
-            blob = {allocator.get(), newsize - 4 - key.len - 1 - value.len - 1};
-            alloc_size = newsize;
-        }
+        return;
+    }
 
-        append_kvpair(key, value);
+    // Replace the value where it is, moving the kv-pairs after it (if
+    // the size changes) rather than removing it and appending the new
+    // one (which would move everything after it twice)
+    const size_t old_size = 4 + read_length(offset);
+    const size_t new_size = 4 + key.len + 1 + value.len + 1;
+    if (new_size != old_size) {
+        move_tail(offset + old_size, offset + new_size);
+    }
+    write_kvpair(offset, key, value);
+}
+
+void Blob::reserve(size_t size) {
+    if (alloc_size < size) {
+        std::unique_ptr<char[]> temp(new char[size]);
+        std::copy(blob.buf, blob.buf + blob.len, temp.get());
+        allocator.swap(temp);
+        blob = {allocator.get(), blob.len};
+        alloc_size = size;
     }
 }
 
 void Blob::grow_buffer(uint32_t size) {
     if (blob.len < size) {
         if (alloc_size < size) {
-            std::unique_ptr<char[]> temp(new char[size]);
-            std::copy(blob.buf, blob.buf + blob.len, temp.get());
-            allocator.swap(temp);
-            blob = {allocator.get(), size};
-            alloc_size = size;
-        } else {
-            blob = {allocator.get(), size};
+            // Grow geometrically so that repeatedly adding to (or growing
+            // the values of) a blob doesn't copy all of it every time
+            reserve(std::max(size_t(size), alloc_size + alloc_size / 2));
         }
+        blob = {allocator.get(), size};
+    }
+}
+
+void Blob::move_tail(size_t offset, size_t newOffset) {
+    const size_t tail = blob.len - offset;
+    if (newOffset > offset) {
+        grow_buffer(gsl::narrow<uint32_t>(blob.len + newOffset - offset));
+    } else {
+        blob.len -= offset - newOffset;
     }
+    std::memmove(blob.buf + newOffset, blob.buf + offset, tail);
 }
 
 void Blob::write_kvpair(size_t offset,
@@ -21,6 +21,7 @@
 
 #include <nlohmann/json.hpp>
 
+#include <algorithm>
 #include <unordered_set>
 
 namespace cb {
@@ -152,6 +153,123 @@ char_buffer get_body(const cb::char_buffer& payload) {
     return {payload.buf + offset, payload.len - offset};
 }
 
+/**
+ * Inflate the first size bytes of a (raw format) Snappy compressed
+ * buffer. Snappy is a sequence of literals and copies of earlier output,
+ * so we can stop decoding as soon as we've got the bytes we want.
+ *
+ * @return true if success, false if the input isn't valid or is shorter
+ *         than size
+ */
+static bool inflate_prefix(const cb::const_char_buffer& input,
+                           size_t size,
+                           cb::compression::Buffer& output) {
+    const auto* in = reinterpret_cast<const uint8_t*>(input.data());
+    const auto* const end = in + input.size();
+
+    // The uncompressed length (a varint)
+    uint64_t length = 0;
+    for (int shift = 0;; shift += 7) {
+        if (in == end || shift > 28) {
+            return false;
+        }
+        const uint8_t c = *in++;
+        length |= uint64_t(c & 0x7f) << shift;
+        if ((c & 0x80) == 0) {
+            break;
+        }
+    }
+    if (size > length) {
+        return false;
+    }
+
+    output.resize(size);
+    auto* out = reinterpret_cast<uint8_t*>(output.data());
+    size_t produced = 0;
+    while (produced < size) {
+        if (in == end) {
+            return false;
+        }
+        const uint8_t tag = *in++;
+        size_t len;
+        size_t offset;
+        switch (tag & 0x3) {
+        case 0: {
+            // A literal, with the length in the tag or the next 1-4 bytes
+            len = tag >> 2;
+            if (len >= 60) {
+                const size_t bytes = len - 59;
+                if (size_t(end - in) < bytes) {
+                    return false;
+                }
+                len = 0;
+                for (size_t ii = 0; ii < bytes; ++ii) {
+                    len |= size_t(in[ii]) << (8 * ii);
+                }
+                in += bytes;
+            }
+            ++len;
+            if (size_t(end - in) < len) {
+                return false;
+            }
+            const auto n = std::min(len, size - produced);
+            std::copy_n(in, n, out + produced);
+            produced += n;
+            in += len;
+            continue;
+        }
+        case 1:
+            // A copy with an 11 bit offset
+            if (in == end) {
+                return false;
+            }
+            len = 4 + ((tag >> 2) & 0x7);
+            offset = (size_t(tag >> 5) << 8) | *in++;
+            break;
+        case 2:
+            // A copy with a 16 bit offset
+            if (end - in < 2) {
+                return false;
+            }
+            len = (tag >> 2) + 1;
+            offset = size_t(in[0]) | (size_t(in[1]) << 8);
+            in += 2;
+            break;
+        default:
+            // A copy with a 32 bit offset
+            if (end - in < 4) {
+                return false;
+            }
+            len = (tag >> 2) + 1;
+            offset = size_t(in[0]) | (size_t(in[1]) << 8) |
+                     (size_t(in[2]) << 16) | (size_t(in[3]) << 24);
+            in += 4;
+        }
+
+        if (offset == 0 || offset > produced) {
+            return false;
+        }
+        // The source and destination may overlap (that's how runs are
+        // encoded), so copy a byte at a time
+        const auto n = std::min(len, size - produced);
+        for (size_t ii = 0; ii < n; ++ii, ++produced) {
+            out[produced] = out[produced - offset];
+        }
+    }
+    return true;
+}
+
+bool inflate_xattrs(const cb::const_char_buffer& payload,
+                    cb::compression::Buffer& output) {
+    // Inflate the length of the xattrs, then the xattrs themselves
+    if (!inflate_prefix(payload, sizeof(uint32_t), output)) {
+        return false;
+    }
+    const auto length =
+            ntohl(*reinterpret_cast<const uint32_t*>(output.data()));
+    return inflate_prefix(payload, size_t(length) + sizeof(uint32_t), output);
+}
+
 size_t get_system_xattr_size(uint8_t datatype, const cb::const_char_buffer doc) {
     if (!::mcbp::datatype::is_xattr(datatype)) {
         return 0;